@@ -9,3 +9,5 @@
 
 ./run_test_polblogs.sh
 ./run_test_sets.sh
+./run_test_overlap_load.sh
+./run_test_conditional.sh
@@ -0,0 +1,35 @@
+#!/bin/sh
+#
+# File:    run_bench_polblogs.sh
+# Author:  Alex Stivala
+# Created: October 2026
+#
+# Benchmark of the change statistics functions with each two-path
+# lookup build variant (no tables, arrays, hash tables, and each method
+# of the run time selected build) on polblogs, with the same node pairs
+# as the regression test, writing CSV to bench_polblogs.csv (see
+# testChangeStatsDirectedMain.c for the columns). Options (e.g. -r 10
+# for ten timed repetitions) are passed on to testChangeStatsDirected.
+#
+
+OUTPUT=bench_polblogs.csv
+ARCLIST=../pythonDemo/polblogs/polblogs_arclist.txt
+NODEPAIRS=polblogs_nodepairs.txt
+
+rc=0
+rm -f ${OUTPUT}
+for variant in "" _array _hash _adaptive
+do
+  echo "testChangeStatsDirected${variant}"
+  if ! ./testChangeStatsDirected${variant} -b "$@" ${ARCLIST} ${NODEPAIRS} > ${OUTPUT}.tmp; then
+    echo "**** FAILED ****"
+    rc=1
+  elif [ -s ${OUTPUT} ]; then
+    tail -n +2 ${OUTPUT}.tmp >> ${OUTPUT}  # header only once
+  else
+    cat ${OUTPUT}.tmp > ${OUTPUT}
+  fi
+done
+rm -f ${OUTPUT}.tmp
+echo "results are in ${OUTPUT}"
+exit $rc
@@ -0,0 +1,87 @@
+#!/bin/sh
+#
+# File:    run_test_conditional.sh
+# Author:  Alex Stivala
+# Created: October 2026
+#
+#
+# run_test_conditional.sh - regression test for conditional estimation
+#                           of a snowball sample
+#
+# Estimates a model (short, with a fixed seed) by conditional
+# estimation on a snowball sample (2 waves from 5 seeds of the n500
+# pythonDemo network, made with SnowballSample -s 42) with the basic
+# sampler, and checks that:
+#
+#   - the theta and dzA output are the same as the known-correct output
+#     (conditional_test_theta_baseline.txt and
+#     conditional_test_dzA_baseline.txt)
+#   - the simulated network at the end has no duplicate arcs
+#
+# The basic sampler used to treat every conditional proposal as adding
+# an arc, so inner arcs were inserted again, duplicating them, and the
+# estimates were wrong; either check fails then.
+#
+# Needs ../src/EstimNetDirected built.
+#
+# Usage: run_test_conditional.sh
+#
+
+rc=0
+
+ESTIMNET=../src/EstimNetDirected
+THETA_BASELINE=conditional_test_theta_baseline.txt
+DZA_BASELINE=conditional_test_dzA_baseline.txt
+
+TMPDIR=conditional_test
+rm -rf ${TMPDIR}
+mkdir ${TMPDIR}
+
+cat > ${TMPDIR}/config.txt <<EOF
+ACA_S = 0.1
+ACA_EE = 1e-9
+compC = 1e-2
+Ssteps = 20
+EEsteps = 30
+EEinnerSteps = 10
+samplerSteps = 1000
+seed = 12345
+useConditionalEstimation = True
+outputSimulatedNetwork = True
+arclistFile = snowball_n500_arclist.txt
+zoneFile = snowball_n500_zones.txt
+thetaFilePrefix = ${TMPDIR}/theta
+dzAFilePrefix = ${TMPDIR}/dzA
+simNetFilePrefix = ${TMPDIR}/sim
+structParams = {Arc, Reciprocity, AltInStars, AltOutStars, AltKTrianglesT}
+EOF
+
+echo "Running conditional estimation test..."
+
+if ! ${ESTIMNET} ${TMPDIR}/config.txt > ${TMPDIR}/estimation.log 2>&1; then
+    echo
+    echo "**** FAILED ****"
+    echo "conditional estimation failed, see ${TMPDIR}/estimation.log"
+    exit 1
+fi
+
+if ! diff ${THETA_BASELINE} ${TMPDIR}/theta_0.txt > ${TMPDIR}/theta.diff ||
+   ! diff ${DZA_BASELINE} ${TMPDIR}/dzA_0.txt > ${TMPDIR}/dzA.diff; then
+    echo
+    echo "**** FAILED ****"
+    echo "diff results are in ${TMPDIR}/theta.diff and ${TMPDIR}/dzA.diff"
+    exit 1
+fi
+
+grep -v '^\*' ${TMPDIR}/sim_0.net | sort | uniq -d > ${TMPDIR}/duplicates.txt
+if [ -s ${TMPDIR}/duplicates.txt ]; then
+    echo
+    echo "**** FAILED ****"
+    echo "duplicate arcs in simulated network are in ${TMPDIR}/duplicates.txt"
+    exit 1
+fi
+
+echo
+echo "PASSED"
+rm -rf ${TMPDIR}
+exit $rc
@@ -0,0 +1,94 @@
+#!/bin/sh
+#
+# File:    run_test_overlap_load.sh
+# Author:  Alex Stivala
+# Created: October 2026
+#
+#
+# run_test_overlap_load.sh - regression test for overlapLoad with
+#                            compressed input files
+#
+# With overlapLoad the arc list is read by another thread while the
+# attribute files are loaded, so with gzipped files both threads open
+# decompressor streams at once. The estimation (short, with a fixed
+# seed) from the gzipped files with overlapLoad must give exactly the
+# same theta and dzA output as from the uncompressed files without it.
+# It is repeated several times, as a race would only show sometimes.
+#
+# Needs ../src/EstimNetDirected built and gzip in the PATH.
+#
+# Usage: run_test_overlap_load.sh
+#
+
+rc=0
+
+ESTIMNET=../src/EstimNetDirected
+ARCLIST=../pythonDemo/sample_statistics_n500_directed_binattr_sim420000000.txt
+BINATTR=../pythonDemo/binaryAttribute_50_50_n500.txt
+REPEATS=5
+
+TMPDIR=overlap_load_test
+rm -rf ${TMPDIR}
+mkdir ${TMPDIR}
+
+# the binary attribute is also used as a categorical attribute, so
+# that there are two attribute files
+cp ${ARCLIST} ${TMPDIR}/arclist.txt
+cp ${BINATTR} ${TMPDIR}/binattr.txt
+sed '1s/.*/category/' ${BINATTR} > ${TMPDIR}/catattr.txt
+for f in arclist binattr catattr; do
+    gzip -c ${TMPDIR}/${f}.txt > ${TMPDIR}/${f}_gz.txt
+done
+
+# write_config overlap suffix prefix
+write_config() {
+    cat > ${TMPDIR}/config_$3.txt <<EOF
+ACA_S = 0.1
+ACA_EE = 1e-9
+compC = 1e-2
+Ssteps = 20
+EEsteps = 20
+EEinnerSteps = 10
+samplerSteps = 1000
+seed = 12345
+overlapLoad = $1
+arclistFile = ${TMPDIR}/arclist$2.txt
+binattrFile = ${TMPDIR}/binattr$2.txt
+catattrFile = ${TMPDIR}/catattr$2.txt
+thetaFilePrefix = ${TMPDIR}/theta_$3
+dzAFilePrefix = ${TMPDIR}/dzA_$3
+structParams = {Arc, Reciprocity, AltInStars, AltOutStars, AltKTrianglesT, AltTwoPathsT}
+attrParams = {Sender(binaryAttribute), Receiver(binaryAttribute), Matching(category)}
+EOF
+}
+
+echo "Running overlapLoad test with gzipped arc list and attribute files..."
+
+write_config False "" plain
+if ! ${ESTIMNET} ${TMPDIR}/config_plain.txt > ${TMPDIR}/plain.log 2>&1; then
+    echo
+    echo "**** FAILED ****"
+    echo "estimation from uncompressed files failed, see ${TMPDIR}/plain.log"
+    exit 1
+fi
+
+write_config True _gz overlap
+i=1
+while [ $i -le ${REPEATS} ]; do
+    rm -f ${TMPDIR}/theta_overlap_0.txt ${TMPDIR}/dzA_overlap_0.txt
+    if ! ${ESTIMNET} ${TMPDIR}/config_overlap.txt > ${TMPDIR}/overlap.log 2>&1 ||
+       grep -q ERROR ${TMPDIR}/overlap.log ||
+       ! cmp -s ${TMPDIR}/theta_plain_0.txt ${TMPDIR}/theta_overlap_0.txt ||
+       ! cmp -s ${TMPDIR}/dzA_plain_0.txt ${TMPDIR}/dzA_overlap_0.txt; then
+        echo
+        echo "**** FAILED ****"
+        echo "run $i with overlapLoad differs or failed, see ${TMPDIR}"
+        exit 1
+    fi
+    i=`expr $i + 1`
+done
+
+echo
+echo "PASSED"
+rm -rf ${TMPDIR}
+exit $rc
@@ -66,4 +66,42 @@ else
   rc=2
 fi
 
+echo "4. run time selected two-path hash tables"
+
+OUTPUT=polblogs_test_results_adaptive.out
+DIFFILE=polblogs_test_results_adaptive.diff
+
+time ./testChangeStatsDirected_adaptive ../pythonDemo/polblogs/polblogs_arclist.txt  polblogs_nodepairs.txt | fgrep -v nnz | fgrep -v DEBUG  > ${OUTPUT}
+
+diff ${BASELINE} ${OUTPUT} > ${DIFFILE}
+
+if [ $? -eq 0 ]; then
+  echo
+  echo "PASSED"
+else 
+  echo
+  echo "**** FAILED ****"
+  echo "diff results are in ${DIFFILE}"
+  rc=3
+fi
+
+echo "5. single precision batch change statistics"
+
+OUTPUT=polblogs_test_results_float.out
+DIFFILE=polblogs_test_results_float.diff
+
+time ./testChangeStatsDirected_float ../pythonDemo/polblogs/polblogs_arclist.txt  polblogs_nodepairs.txt | fgrep -v nnz | fgrep -v DEBUG  > ${OUTPUT}
+
+diff ${BASELINE} ${OUTPUT} > ${DIFFILE}
+
+if [ $? -eq 0 ]; then
+  echo
+  echo "PASSED"
+else 
+  echo
+  echo "**** FAILED ****"
+  echo "diff results are in ${DIFFILE}"
+  rc=4
+fi
+
 exit $rc
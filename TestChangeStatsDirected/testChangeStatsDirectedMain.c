@@ -7,13 +7,22 @@
  * Test directed change stats and two-path table update.
  *
  *
- * Usage:  testChangeStatsDirected  <in_edgelistfile> [nodenums]
+ * Usage:  testChangeStatsDirected [-b] [-r reps] [-w warmup]
+ *                                 <in_edgelistfile> [nodenums]
  *
  * Reads graph from Pajek format <in_edgelistfile>.
  * If optional nodenums filename specified, then reads (two-column whitespace
  * separated, one pair per line) pairs of nodes to use from there,
  * otherwise randomly generated.
  *
+ * With -b, instead of the tests, each structural change statistic
+ * function is timed on the node pairs (the "random" dyad set) and on
+ * as many random pairs of the highest degree nodes (the "highdegree"
+ * set), and the results written to stdout as CSV (see
+ * benchmarkChangeStats()). Each timing is repeated reps times (default
+ * 5) after warmup untimed repetitions (default 1). The run time
+ * selected (adaptive) build times each two-path lookup method in turn.
+ *
  ****************************************************************************/
 
 #include <ctype.h>
@@ -23,32 +32,357 @@
 #include <string.h>
 #include <time.h>
 #include <assert.h>
+#include <math.h>
+#include <float.h>
+#include <getopt.h>
 #include "digraph.h"
 #include "changeStatisticsDirected.h"
 #include "loadDigraph.h"
 
 #define DEFAULT_NUM_TESTS 1000
 
-#ifdef TWOPATH_LOOKUP
-/* get stats and dump mix-two-path hash table */
+/* structural change statistics checked for delete moves */
+static change_stats_func_t *const STRUCT_FUNCS[] = {
+  changeArc, changeReciprocity, changeSink, changeSource, changeIsolates,
+  changeTwoPath, changeInTwoStars, changeOutTwoStars, changeTransitiveTriad,
+  changeCyclicTriad, changeAltInStars, changeAltOutStars,
+  changeAltKTrianglesT, changeAltKTrianglesC, changeAltKTrianglesD,
+  changeAltKTrianglesU, changeAltTwoPathsT, changeAltTwoPathsD,
+  changeAltTwoPathsU, changeAltTwoPathsTD
+};
+#define NUM_STRUCT_FUNCS (sizeof(STRUCT_FUNCS) / sizeof(STRUCT_FUNCS[0]))
+
+/* names of STRUCT_FUNCS, as in the configuration files */
+static const char *const STRUCT_FUNC_NAMES[] = {
+  "Arc", "Reciprocity", "Sink", "Source", "Isolates",
+  "TwoPaths", "InTwoStars", "OutTwoStars", "TransitiveTriangles",
+  "CyclicTriangles", "AltInStars", "AltOutStars",
+  "AltKTrianglesT", "AltKTrianglesC", "AltKTrianglesD",
+  "AltKTrianglesU", "AltTwoPathsT", "AltTwoPathsD",
+  "AltTwoPathsU", "AltTwoPathsTD"
+};
+
+/* name of the two-path lookup build variant, for benchmark output */
+#if defined(TWOPATH_ADAPTIVE)
+#define BUILD_VARIANT "adaptive"
+#elif defined(TWOPATH_HASHTABLES)
+#define BUILD_VARIANT "hashtables"
+#elif defined(TWOPATH_LOOKUP)
+#define BUILD_VARIANT "arrays"
+#else
+#define BUILD_VARIANT "none"
+#endif
+
+#define DEFAULT_BENCH_REPS   5
+#define DEFAULT_BENCH_WARMUP 1
+#define BENCH_MIN_USEC       20000.0 /* time of a repetition (at least) */
+#define BENCH_HIGH_DEGREE_NODES 50  /* nodes in high-degree dyad set */
+
+/* remove arc i->j from g, checking that the change statistics computed
+   beforehand as if it were absent (isDelete TRUE) are the same as those
+   computed on the graph without it */
+static void removeArcCheckChangeStats(digraph_t *g, uint_t i, uint_t j)
+{
+  double absentstats[NUM_STRUCT_FUNCS];
+  double stat;
+  uint_t l;
+
+  for (l = 0; l < NUM_STRUCT_FUNCS; l++)
+    absentstats[l] = (*STRUCT_FUNCS[l])(g, i, j, DEFAULT_LAMBDA, TRUE);
+  removeArc(g, i, j);
+  for (l = 0; l < NUM_STRUCT_FUNCS; l++) {
+    stat = (*STRUCT_FUNCS[l])(g, i, j, DEFAULT_LAMBDA, FALSE);
+    if (!DOUBLE_APPROX_EQ(stat, absentstats[l])) {
+      fprintf(stderr, "change stat %u for delete %u -> %u is %g "
+              "but %g after removing arc\n", l, i, j, absentstats[l], stat);
+      exit(1);
+    }
+  }
+}
+
+/* compute change statistics for all the dyads with calcChangeStatsBatch()
+   and check they are the same as from calcChangeStats() one dyad at a time;
+   dyads that are arcs in g are treated as delete moves, others as adds.
+   The times taken by each are written to stderr. If built with
+   BATCHSTATS_FLOAT the batch statistics must be those of calcChangeStats()
+   rounded to single precision, and the totals within the error of that
+   rounding, and the largest relative errors are written to stderr. */
+static void checkBatchChangeStats(const digraph_t *g, uint_t num_dyads,
+                                  const nodepair_t dyads[])
+{
+  change_stats_func_t *funcs[NUM_STRUCT_FUNCS];
+  double lambda_values[NUM_STRUCT_FUNCS];
+  double theta[NUM_STRUCT_FUNCS];
+  double onestats[NUM_STRUCT_FUNCS];
+  batchstat_t *batchstats = safe_malloc(NUM_STRUCT_FUNCS * num_dyads *
+                                        sizeof(batchstat_t));
+  double *batchtotals = safe_malloc(num_dyads * sizeof(double));
+  double *onetotals = safe_malloc(num_dyads * sizeof(double));
+  bool   *isDelete = safe_malloc(num_dyads * sizeof(bool));
+  struct timeval start_timeval, end_timeval, elapsed_timeval;
+  int    etime;
+  uint_t k, l;
+#ifdef BATCHSTATS_FLOAT
+  double abssum, err, maxStatErr = 0, maxTotalErr = 0;
+#endif /* BATCHSTATS_FLOAT */
+
+  for (l = 0; l < NUM_STRUCT_FUNCS; l++) {
+    funcs[l] = STRUCT_FUNCS[l];
+    lambda_values[l] = DEFAULT_LAMBDA;
+    theta[l] = 1.0 / (l + 1);
+  }
+  for (k = 0; k < num_dyads; k++)
+    isDelete[k] = isArc(g, dyads[k].i, dyads[k].j);
+
+  gettimeofday(&start_timeval, NULL);
+  for (k = 0; k < num_dyads; k++)
+    onetotals[k] = calcChangeStats(g, dyads[k].i, dyads[k].j,
+                                   NUM_STRUCT_FUNCS, 0, 0, 0, funcs,
+                                   lambda_values, NULL, NULL, NULL, NULL,
+                                   NULL, theta, isDelete[k], onestats);
+  gettimeofday(&end_timeval, NULL);
+  timeval_subtract(&elapsed_timeval, &end_timeval, &start_timeval);
+  etime = 1000000 * elapsed_timeval.tv_sec + elapsed_timeval.tv_usec;
+  fprintf(stderr, "calcChangeStats for %u dyads took %d us\n", num_dyads,
+          etime);
+
+  gettimeofday(&start_timeval, NULL);
+  calcChangeStatsBatch(g, num_dyads, dyads, isDelete, NUM_STRUCT_FUNCS,
+                       0, 0, 0, funcs, lambda_values, NULL, NULL, NULL,
+                       NULL, NULL, theta, batchstats, batchtotals);
+  gettimeofday(&end_timeval, NULL);
+  timeval_subtract(&elapsed_timeval, &end_timeval, &start_timeval);
+  etime = 1000000 * elapsed_timeval.tv_sec + elapsed_timeval.tv_usec;
+  fprintf(stderr, "calcChangeStatsBatch for %u dyads took %d us\n",
+          num_dyads, etime);
+
+  for (k = 0; k < num_dyads; k++) {
+    (void)calcChangeStats(g, dyads[k].i, dyads[k].j, NUM_STRUCT_FUNCS,
+                          0, 0, 0, funcs, lambda_values, NULL, NULL, NULL,
+                          NULL, NULL, theta, isDelete[k], onestats);
+    for (l = 0; l < NUM_STRUCT_FUNCS; l++) {
+      if (!DOUBLE_APPROX_EQ(batchstats[l*num_dyads + k],
+                            (batchstat_t)onestats[l])) {
+        fprintf(stderr, "batch change stat %u for %u -> %u is %g "
+                "but %g from calcChangeStats\n", l, dyads[k].i, dyads[k].j,
+                batchstats[l*num_dyads + k], onestats[l]);
+        exit(1);
+      }
+#ifdef BATCHSTATS_FLOAT
+      if (fabs(onestats[l]) > 0)
+        maxStatErr = MAX(maxStatErr, fabs(batchstats[l*num_dyads + k] -
+                                          onestats[l]) / fabs(onestats[l]));
+#endif /* BATCHSTATS_FLOAT */
+    }
+#ifdef BATCHSTATS_FLOAT
+    /* each statistic is rounded with relative error at most
+       FLT_EPSILON/2, so the total is within that of the sum of the
+       magnitudes of its terms */
+    abssum = 0;
+    for (l = 0; l < NUM_STRUCT_FUNCS; l++)
+      abssum += fabs(theta[l] * onestats[l]);
+    err = fabs(batchtotals[k] - onetotals[k]);
+    if (err > FLT_EPSILON * abssum + DBL_EPSILON) {
+#else
+    if (!DOUBLE_APPROX_EQ(batchtotals[k], onetotals[k])) {
+#endif /* BATCHSTATS_FLOAT */
+      fprintf(stderr, "batch total for %u -> %u is %g "
+              "but %g from calcChangeStats\n", dyads[k].i, dyads[k].j,
+              batchtotals[k], onetotals[k]);
+      exit(1);
+    }
+#ifdef BATCHSTATS_FLOAT
+    if (abssum > 0)
+      maxTotalErr = MAX(maxTotalErr, err / abssum);
+#endif /* BATCHSTATS_FLOAT */
+  }
+#ifdef BATCHSTATS_FLOAT
+  fprintf(stderr, "single precision batch change statistics: max relative "
+          "error %g, max error of totals %g (relative to sum of "
+          "|theta*changestat|)\n", maxStatErr, maxTotalErr);
+#endif /* BATCHSTATS_FLOAT */
+  free(isDelete);
+  free(onetotals);
+  free(batchtotals);
+  free(batchstats);
+}
+
+/* run one change statistic function (or calcChangeStats() with all of
+   them if func is NULL) over the dyads passes times, returning the
+   elapsed time in microseconds */
+static double timeChangeStats(const digraph_t *g, change_stats_func_t *func,
+                              uint_t num_dyads, const nodepair_t dyads[],
+                              const bool isDelete[], uint_t passes)
+{
+  change_stats_func_t *funcs[NUM_STRUCT_FUNCS];
+  double lambda_values[NUM_STRUCT_FUNCS];
+  double theta[NUM_STRUCT_FUNCS];
+  double changestats[NUM_STRUCT_FUNCS];
+  volatile double sink = 0; /* so the calls are not optimized away */
+  struct timeval start_timeval, end_timeval, elapsed_timeval;
+  uint_t p, k, l;
+
+  for (l = 0; l < NUM_STRUCT_FUNCS; l++) {
+    funcs[l] = STRUCT_FUNCS[l];
+    lambda_values[l] = DEFAULT_LAMBDA;
+    theta[l] = 1.0 / (l + 1);
+  }
+  gettimeofday(&start_timeval, NULL);
+  for (p = 0; p < passes; p++) {
+    for (k = 0; k < num_dyads; k++) {
+      if (func)
+        sink += (*func)(g, dyads[k].i, dyads[k].j, DEFAULT_LAMBDA,
+                        isDelete[k]);
+      else
+        sink += calcChangeStats(g, dyads[k].i, dyads[k].j,
+                                NUM_STRUCT_FUNCS, 0, 0, 0, funcs,
+                                lambda_values, NULL, NULL, NULL, NULL,
+                                NULL, theta, isDelete[k], changestats);
+    }
+  }
+  gettimeofday(&end_timeval, NULL);
+  (void)sink;
+  timeval_subtract(&elapsed_timeval, &end_timeval, &start_timeval);
+  return 1e6 * elapsed_timeval.tv_sec + elapsed_timeval.tv_usec;
+}
+
+/* time one change statistic function (or calcChangeStats() if func is
+   NULL) and write a CSV line of the results. The number of passes over
+   the dyads in each repetition is set from a first (untimed) pass so a
+   repetition takes at least BENCH_MIN_USEC. The fastest repetition
+   gives ns per call and calls per second, as it is the least disturbed */
+static void benchmarkOne(const digraph_t *g, const char *backend,
+                         const char *dyad_set, const char *name,
+                         change_stats_func_t *func, uint_t num_dyads,
+                         const nodepair_t dyads[], const bool isDelete[],
+                         uint_t reps, uint_t warmup)
+{
+  double usec, min_usec = 0, total_usec = 0, calls;
+  uint_t r, passes;
+
+  usec = timeChangeStats(g, func, num_dyads, dyads, isDelete, 1);
+  passes = usec >= BENCH_MIN_USEC ? 1 :
+    (uint_t)ceil(BENCH_MIN_USEC / MAX(usec, 1));
+  for (r = 0; r < warmup + reps; r++) {
+    usec = timeChangeStats(g, func, num_dyads, dyads, isDelete, passes);
+    if (r < warmup)
+      continue;
+    total_usec += usec;
+    if (r == warmup || usec < min_usec)
+      min_usec = usec;
+  }
+  calls = (double)passes * num_dyads;
+  printf("%s,%s,%s,%s,%u,%.0f,%.1f,%.1f,%.0f\n", BUILD_VARIANT, backend,
+         dyad_set, name, num_dyads, calls, 1000 * min_usec / calls,
+         1000 * total_usec / reps / calls,
+         min_usec > 0 ? calls / (min_usec / 1e6) : 0);
+  fflush(stdout);
+}
+
+/* compare nodes by total degree, descending, for qsort() */
+static const digraph_t *degree_cmp_graph;
+static int degreeCompare(const void *a, const void *b)
+{
+  uint_t u = *(const uint_t *)a, v = *(const uint_t *)b;
+  uint_t du = degree_cmp_graph->indegree[u] + degree_cmp_graph->outdegree[u];
+  uint_t dv = degree_cmp_graph->indegree[v] + degree_cmp_graph->outdegree[v];
+  return du < dv ? 1 : du > dv ? -1 : (u > v) - (u < v);
+}
+
+/* time each structural change statistic function, and calcChangeStats()
+   with all of them, on the given dyads ("random") and on as many random
+   pairs of the BENCH_HIGH_DEGREE_NODES highest degree nodes
+   ("highdegree"), where the two-path counts (and so the cost of some
+   statistics) are largest. Dyads that are arcs are timed as delete
+   moves, others as adds. The CSV written to stdout has a header line
+   then one line for each build variant, two-path lookup backend, dyad
+   set and statistic, with the ns per call and calls per second of the
+   fastest of the reps repetitions, and the mean ns per call. */
+static void benchmarkChangeStats(digraph_t *g, uint_t num_dyads,
+                                 const nodepair_t dyads[],
+                                 uint_t reps, uint_t warmup)
+{
+  static const char *const DYAD_SETS[] = {"random", "highdegree"};
+  const nodepair_t *sets[2];
+  nodepair_t *high = safe_malloc(num_dyads * sizeof(nodepair_t));
+  bool       *isDelete = safe_malloc(num_dyads * sizeof(bool));
+  uint_t     *nodes = safe_malloc(g->num_nodes * sizeof(uint_t));
+  uint_t      num_high = MIN(BENCH_HIGH_DEGREE_NODES, g->num_nodes);
+  uint_t      s, k, l, v;
+#ifdef TWOPATH_ADAPTIVE
+  static const twopath_backend_e BACKENDS[] = {
+    TWOPATH_BACKEND_NONE, TWOPATH_BACKEND_ARRAYS, TWOPATH_BACKEND_HASHTABLES
+  };
+  /* named as the build variants using them */
+  static const char *const BACKEND_NAMES[] = {"none", "arrays", "hashtables"};
+  uint_t b;
+#endif /*TWOPATH_ADAPTIVE*/
+  const char *backend = BUILD_VARIANT;
+
+  /* pairs of distinct nodes among those of highest degree */
+  for (v = 0; v < g->num_nodes; v++)
+    nodes[v] = v;
+  degree_cmp_graph = g;
+  qsort(nodes, g->num_nodes, sizeof(uint_t), degreeCompare);
+  for (k = 0; k < num_dyads; k++) {
+    do {
+      high[k].i = nodes[rand() % num_high];
+      high[k].j = nodes[rand() % num_high];
+    } while (high[k].i == high[k].j);
+  }
+  sets[0] = dyads;
+  sets[1] = high;
+
+  printf("variant,backend,dyad_set,statistic,dyads,calls,"
+         "ns_per_call,mean_ns_per_call,calls_per_sec\n");
+#ifdef TWOPATH_ADAPTIVE
+  for (b = 0; b < sizeof(BACKENDS) / sizeof(BACKENDS[0]); b++) {
+    set_twopath_backend(g, BACKENDS[b]);
+    backend = BACKEND_NAMES[b];
+#endif /*TWOPATH_ADAPTIVE*/
+    for (s = 0; s < 2; s++) {
+      for (k = 0; k < num_dyads; k++)
+        isDelete[k] = isArc(g, sets[s][k].i, sets[s][k].j);
+      for (l = 0; l < NUM_STRUCT_FUNCS; l++)
+        benchmarkOne(g, backend, DYAD_SETS[s], STRUCT_FUNC_NAMES[l],
+                     STRUCT_FUNCS[l], num_dyads, sets[s], isDelete,
+                     reps, warmup);
+      benchmarkOne(g, backend, DYAD_SETS[s], "calcChangeStats", NULL,
+                   num_dyads, sets[s], isDelete, reps, warmup);
+    }
+#ifdef TWOPATH_ADAPTIVE
+  }
+#endif /*TWOPATH_ADAPTIVE*/
+  free(high);
+  free(nodes);
+  free(isDelete);
+}
+
+#if defined(TWOPATH_LOOKUP) || defined(TWOPATH_ADAPTIVE)
+/* get stats and dump mix-two-path hash table. The in- and out-two-path
+   tables only store entries with i <= j, so off-diagonal entries are
+   counted twice to give totals over the full symmetric matrix */
 static void dumpTwoPathTables(const digraph_t *g) {
   uint_t inSum,outSum,mixSum,inMax,outMax,mixMax;
   uint_t inNnz, outNnz, mixNnz;
-#ifdef TWOPATH_HASHTABLES
+#if defined(TWOPATH_WITH_UTHASH) || defined(TWOPATH_WITH_OAHASH)
+#ifdef TWOPATH_WITH_UTHASH
   twopath_record_t *r;
-  uint_t val;
+#else
+  size_t k;
+#endif /*TWOPATH_WITH_UTHASH*/
+  uint_t val, mult;
 #else
   uint_t i, j;
-#endif /*TWOPATH_HASHTABLES*/
+#endif /*TWOPATH_WITH_UTHASH || TWOPATH_WITH_OAHASH*/
   
   inSum = outSum = mixSum = 0;
   inMax = outMax = mixMax = 0;
   inNnz = outNnz = mixNnz = 0;
 
-#ifdef TWOPATH_HASHTABLES
+#if defined(TWOPATH_WITH_UTHASH) || defined(TWOPATH_WITH_OAHASH)
+#ifdef TWOPATH_WITH_UTHASH
   mixNnz = HASH_COUNT(g->mixTwoPathHashTab);
-  inNnz = HASH_COUNT(g->inTwoPathHashTab);
-  outNnz = HASH_COUNT(g->outTwoPathHashTab);
 
   for (r = g->mixTwoPathHashTab; r !=NULL; r = r->hh.next) {
     val = r->value;
@@ -59,45 +393,86 @@ static void dumpTwoPathTables(const digraph_t *g) {
   }
   for (r = g->inTwoPathHashTab; r !=NULL; r = r->hh.next) {
     val = r->value;
-    inSum += val;
+    mult = r->key.i == r->key.j ? 1 : 2;
+    inNnz += mult;
+    inSum += mult * val;
     if (val > inMax) {
       inMax = val;
     }
   }
   for (r = g->outTwoPathHashTab; r !=NULL; r = r->hh.next) {
     val = r->value;
-    outSum += val;
+    mult = r->key.i == r->key.j ? 1 : 2;
+    outNnz += mult;
+    outSum += mult * val;
+    if (val > outMax) {
+      outMax = val;
+    }
+  }
+#else
+  mixNnz = TWOPATH_HASHTAB_COUNT(g->mixTwoPathHashTab);
+
+  for (k = 0; k < g->mixTwoPathHashTab.capacity; k++) {
+    if (g->mixTwoPathHashTab.keys[k] == TWOPATH_EMPTY_KEY)
+      continue;
+    val = g->mixTwoPathHashTab.values[k];
+    mixSum += val;
+    if (val > mixMax) {
+      mixMax = val;
+    }
+  }
+  for (k = 0; k < g->inTwoPathHashTab.capacity; k++) {
+    if (g->inTwoPathHashTab.keys[k] == TWOPATH_EMPTY_KEY)
+      continue;
+    val = g->inTwoPathHashTab.values[k];
+    mult = (g->inTwoPathHashTab.keys[k] >> 32) ==
+      (g->inTwoPathHashTab.keys[k] & 0xffffffff) ? 1 : 2;
+    inNnz += mult;
+    inSum += mult * val;
+    if (val > inMax) {
+      inMax = val;
+    }
+  }
+  for (k = 0; k < g->outTwoPathHashTab.capacity; k++) {
+    if (g->outTwoPathHashTab.keys[k] == TWOPATH_EMPTY_KEY)
+      continue;
+    val = g->outTwoPathHashTab.values[k];
+    mult = (g->outTwoPathHashTab.keys[k] >> 32) ==
+      (g->outTwoPathHashTab.keys[k] & 0xffffffff) ? 1 : 2;
+    outNnz += mult;
+    outSum += mult * val;
     if (val > outMax) {
       outMax = val;
     }
   }
+#endif /*TWOPATH_WITH_UTHASH*/
 #else
  for (i = 0; i < g->num_nodes; i++) {
     for (j = 0; j < g->num_nodes; j++) {
-      mixSum += g->mixTwoPathMatrix[INDEX2D(i, j, g->num_nodes)];
-      inSum += g->inTwoPathMatrix[INDEX2D(i, j, g->num_nodes)];
-      outSum += g->outTwoPathMatrix[INDEX2D(i, j, g->num_nodes)];
-      if (g->mixTwoPathMatrix[INDEX2D(i, j, g->num_nodes)] > 0) {
+      mixSum += GET_MIX2PATH_ENTRY(g, i, j);
+      inSum += GET_IN2PATH_ENTRY(g, i, j);
+      outSum += GET_OUT2PATH_ENTRY(g, i, j);
+      if (GET_MIX2PATH_ENTRY(g, i, j) > 0) {
         mixNnz++;
       }
-      if (g->mixTwoPathMatrix[INDEX2D(i, j, g->num_nodes)] > mixMax) {
-        mixMax = g->mixTwoPathMatrix[INDEX2D(i, j, g->num_nodes)];
+      if (GET_MIX2PATH_ENTRY(g, i, j) > mixMax) {
+        mixMax = GET_MIX2PATH_ENTRY(g, i, j);
       }
-      if (g->inTwoPathMatrix[INDEX2D(i, j, g->num_nodes)] > 0) {
+      if (GET_IN2PATH_ENTRY(g, i, j) > 0) {
         inNnz++;
       }
-      if (g->inTwoPathMatrix[INDEX2D(i, j, g->num_nodes)] > inMax) {
-        inMax = g->inTwoPathMatrix[INDEX2D(i, j, g->num_nodes)];
+      if (GET_IN2PATH_ENTRY(g, i, j) > inMax) {
+        inMax = GET_IN2PATH_ENTRY(g, i, j);
       }
-      if (g->outTwoPathMatrix[INDEX2D(i, j, g->num_nodes)] > 0) {
+      if (GET_OUT2PATH_ENTRY(g, i, j) > 0) {
         outNnz++;
       }
-      if (g->outTwoPathMatrix[INDEX2D(i, j, g->num_nodes)] > outMax) {
-        outMax = g->outTwoPathMatrix[INDEX2D(i, j, g->num_nodes)];
+      if (GET_OUT2PATH_ENTRY(g, i, j) > outMax) {
+        outMax = GET_OUT2PATH_ENTRY(g, i, j);
       }
     }
   }
- #endif /*TWOPATH_HASHTABLES*/
+ #endif /*TWOPATH_WITH_UTHASH || TWOPATH_WITH_OAHASH*/
 
   printf("mix2p sum = %u, max = %u\n", mixSum, mixMax);
   printf("in2p sum = %u, max = %u\n", inSum, inMax);
@@ -109,7 +484,7 @@ static void dumpTwoPathTables(const digraph_t *g) {
   printf("out nnz = %u (%.4f%%)\n", outNnz,
          100*(double)outNnz/(g->num_nodes*g->num_nodes));
 }
-#endif /*TWOPATH_LOOKUP*/
+#endif /*TWOPATH_LOOKUP || TWOPATH_ADAPTIVE*/
 
 
 int main(int argc, char *argv[]) 
@@ -126,19 +501,44 @@ int main(int argc, char *argv[])
   FILE  *nodenumfile     = NULL;
   struct timeval start_timeval, end_timeval, elapsed_timeval;
   int    etime;
+  nodepair_t *dyads      = NULL;
+  uint_t  num_dyads      = 0;
+  bool    benchmark      = FALSE;
+  int     reps           = DEFAULT_BENCH_REPS;
+  int     warmup         = DEFAULT_BENCH_WARMUP;
+  int     c;
  
   srand(time(NULL));
 
-  init_powtable(1-1/lambda); /* intialize pow(1-1/lambda, y) lookup table */
-
-  if (argc < 2 || argc > 3) {
-    fprintf(stderr, "Usage: %s <inedgelist_file> [nodenumsfile]\n", argv[0]);
+  while ((c = getopt(argc, argv, "br:w:")) != -1) {
+    switch (c) {
+      case 'b':
+        benchmark = TRUE;
+        break;
+      case 'r':
+        reps = atoi(optarg);
+        break;
+      case 'w':
+        warmup = atoi(optarg);
+        break;
+      default:
+        reps = 0; /* usage message below */
+        break;
+    }
+  }
+  if (argc - optind < 1 || argc - optind > 2 || reps < 1 || warmup < 0) {
+    fprintf(stderr, "Usage: %s [-b] [-r reps] [-w warmup] "
+            "<inedgelist_file> [nodenumsfile]\n"
+            "  -b : benchmark change statistics (CSV to stdout)\n"
+            "  -r : timed repetitions for benchmark (default %d)\n"
+            "  -w : untimed warm-up repetitions for benchmark (default %d)\n",
+            argv[0], DEFAULT_BENCH_REPS, DEFAULT_BENCH_WARMUP);
     exit(1);
   }
-  arclist_filename = argv[1];
-  if (argc == 3) {
+  arclist_filename = argv[optind];
+  if (argc - optind == 2) {
     readNodeNums = TRUE;
-    nodenumfilename = argv[2];
+    nodenumfilename = argv[optind + 1];
     if (!(nodenumfile = fopen(nodenumfilename, "r"))) {
       fprintf(stderr, "open %s for read failed (%s)\n", nodenumfilename,
               strerror(errno));
@@ -162,16 +562,18 @@ int main(int argc, char *argv[])
     fprintf(stderr, "loading arc list from %s...",
          arclist_filename);
 #endif
-  num_nodes = get_num_vertices_from_arclist_file(file); /* closes file */
+  if (!(num_nodes = get_num_vertices_from_arclist_file(file))) /* closes file */
+    return -1;
   g = allocate_digraph(num_nodes);
   if (!(file = fopen(arclist_filename, "r"))) {
     fprintf(stderr, "error opening file %s (%s)\n", 
             arclist_filename, strerror(errno));
     return -1;
   }
-  g = load_digraph_from_arclist_file(file, g, FALSE,
-                                     0, 0, 0, 0, NULL, NULL, NULL, NULL,
-                                     NULL, NULL, NULL, NULL);
+  if (!load_digraph_from_arclist_file(file, g, FALSE,
+                                      0, 0, 0, 0, NULL, NULL, NULL, NULL,
+                                      NULL, NULL, NULL, NULL, NULL))
+    return -1;
   gettimeofday(&end_timeval, NULL);
   timeval_subtract(&elapsed_timeval, &end_timeval, &start_timeval);
   etime = 1000 * elapsed_timeval.tv_sec + elapsed_timeval.tv_usec/1000;
@@ -180,9 +582,48 @@ int main(int argc, char *argv[])
   dump_digraph_arclist(g);
 #endif /*DEBUG_DIGRAPH*/
 
-#ifdef TWOPATH_LOOKUP
+  if (benchmark) {
+    /* the same dyads as the change stats test, without the output */
+    while (readNodeNums ? fgets(buf, sizeof(buf)-1, nodenumfile) != NULL :
+           num_dyads < DEFAULT_NUM_TESTS) {
+      if (readNodeNums) {
+        if (sscanf(buf, "%u %u\n", &i, &j) != 2 ||
+            i >= g->num_nodes || j >= g->num_nodes) {
+          fprintf(stderr, "error reading node nums\n");
+          exit(1);
+        }
+      } else {
+        i = rand() % g->num_nodes;
+        j = rand() % g->num_nodes;
+      }
+      if (i == j) {
+        continue;
+      }
+      dyads = safe_realloc(dyads, (num_dyads + 1) * sizeof(nodepair_t));
+      dyads[num_dyads].i = i;
+      dyads[num_dyads].j = j;
+      num_dyads++;
+    }
+    if (readNodeNums) {
+      fclose(nodenumfile);
+    }
+    if (num_dyads == 0) {
+      fprintf(stderr, "no node pairs to benchmark\n");
+      exit(1);
+    }
+    benchmarkChangeStats(g, num_dyads, dyads, (uint_t)reps, (uint_t)warmup);
+    free(dyads);
+    exit(0);
+  }
+
+#ifdef TWOPATH_ADAPTIVE
+  /* build the hash tables from scratch in set_twopath_backend() rather
+     than incrementally while loading, the results must be the same */
+  set_twopath_backend(g, TWOPATH_BACKEND_HASHTABLES);
+#endif /*TWOPATH_ADAPTIVE*/
+#if defined(TWOPATH_LOOKUP) || defined(TWOPATH_ADAPTIVE)
   dumpTwoPathTables(g);
-#endif /*TWOPATH_LOOKUP*/
+#endif /*TWOPATH_LOOKUP || TWOPATH_ADAPTIVE*/
 
   /* just change stats (no changes to graph) */
   printf("testing change stats\n");
@@ -216,23 +657,27 @@ int main(int argc, char *argv[])
       continue;
     }
     printf("i = %d, j = %d, changeOutKStars = %g, changeInKStars = %g, changeDiTKTriangles = %g, changeA2pTD = %g, changeDiCKTriangles = %g, changeDiUKTriangles = %g, changeDiDKTriangles = %g, changeDiUAltTwoPaths = %g, changeSource = %g, changeSink = %g, changeDiIso = %g, changeTwoMixStar = %g, change030c = %g, change030t = %g, changeIn2star = %g, changeOut2star = %g\n", i, j,
-           changeAltOutStars(g, i, j),
-           changeAltInStars(g, i, j),
-           changeAltKTrianglesT(g, i, j),
-           changeAltTwoPathsTD(g, i, j),
-           changeAltKTrianglesC(g, i, j),
-           changeAltKTrianglesU(g, i, j),
-           changeAltKTrianglesD(g, i, j),
-           changeAltTwoPathsU(g, i, j),
-           changeSource(g, i, j),
-           changeSink(g, i, j),
-           changeIsolates(g, i, j),
-	   changeTwoPath(g, i, j),
-	   changeCyclicTriad(g, i, j),
-	   changeTransitiveTriad(g, i, j),
-	   changeInTwoStars(g, i, j),
-	   changeOutTwoStars(g, i, j)
+           changeAltOutStars(g, i, j, DEFAULT_LAMBDA, FALSE),
+           changeAltInStars(g, i, j, DEFAULT_LAMBDA, FALSE),
+           changeAltKTrianglesT(g, i, j, DEFAULT_LAMBDA, FALSE),
+           changeAltTwoPathsTD(g, i, j, DEFAULT_LAMBDA, FALSE),
+           changeAltKTrianglesC(g, i, j, DEFAULT_LAMBDA, FALSE),
+           changeAltKTrianglesU(g, i, j, DEFAULT_LAMBDA, FALSE),
+           changeAltKTrianglesD(g, i, j, DEFAULT_LAMBDA, FALSE),
+           changeAltTwoPathsU(g, i, j, DEFAULT_LAMBDA, FALSE),
+           changeSource(g, i, j, DEFAULT_LAMBDA, FALSE),
+           changeSink(g, i, j, DEFAULT_LAMBDA, FALSE),
+           changeIsolates(g, i, j, DEFAULT_LAMBDA, FALSE),
+	   changeTwoPath(g, i, j, DEFAULT_LAMBDA, FALSE),
+	   changeCyclicTriad(g, i, j, DEFAULT_LAMBDA, FALSE),
+	   changeTransitiveTriad(g, i, j, DEFAULT_LAMBDA, FALSE),
+	   changeInTwoStars(g, i, j, DEFAULT_LAMBDA, FALSE),
+	   changeOutTwoStars(g, i, j, DEFAULT_LAMBDA, FALSE)
       );
+    dyads = safe_realloc(dyads, (num_dyads + 1) * sizeof(nodepair_t));
+    dyads[num_dyads].i = i;
+    dyads[num_dyads].j = j;
+    num_dyads++;
     num_tests++;
     if (!readNodeNums && num_tests >= DEFAULT_NUM_TESTS) {
       break;
@@ -250,6 +695,8 @@ int main(int argc, char *argv[])
   timeval_subtract(&elapsed_timeval, &end_timeval, &start_timeval);
   etime = 1000 * elapsed_timeval.tv_sec + elapsed_timeval.tv_usec/1000;
   fprintf(stderr, "Change stats computations took %.2f s\n", (double)etime/1000);
+  checkBatchChangeStats(g, num_dyads, dyads);
+  free(dyads);
   
 
   /* add arcs and update graph and 2-path hash tables */
@@ -286,12 +733,12 @@ int main(int argc, char *argv[])
     }
     insertArc(g, i, j);
     /* insertArc() called updateTwoPathsMatrices() itself */
-#ifdef TWOPATH_LOOKUP
+#if defined(TWOPATH_LOOKUP) || defined(TWOPATH_ADAPTIVE)
     printf("i = %d, j = %d, num_arcs = %d, ", i, j, g->num_arcs);
     dumpTwoPathTables(g);
 #else
     printf("i = %d, j = %d, num_arcs = %d\n", i, j, g->num_arcs);
-#endif /*TWOPATH_LOOKUP*/
+#endif /*TWOPATH_LOOKUP || TWOPATH_ADAPTIVE*/
     num_tests++;
     if (!readNodeNums && num_tests >= DEFAULT_NUM_TESTS) {
       break;
@@ -340,14 +787,14 @@ int main(int argc, char *argv[])
     if (i == j || !isArc(g, i, j)) {
       continue;
     }
-    removeArc(g, i, j);
+    removeArcCheckChangeStats(g, i, j);
     /* removeArc() calles updateTwoPathsMatrices() itself */
-#ifdef TWOPATH_LOOKUP
+#if defined(TWOPATH_LOOKUP) || defined(TWOPATH_ADAPTIVE)
     printf("i = %d, j = %d, num_arcs = %d, ", i, j, g->num_arcs);
     dumpTwoPathTables(g);
     #else
     printf("i = %d, j = %d, num_arcs = %d\n", i, j, g->num_arcs);
-#endif /*TWOPATH_LOOKUP*/
+#endif /*TWOPATH_LOOKUP || TWOPATH_ADAPTIVE*/
     num_tests++;
     if (!readNodeNums && num_tests >= DEFAULT_NUM_TESTS) {
       break;
@@ -26,6 +26,7 @@
 #include <stdlib.h>
 #include <errno.h>
 #include <string.h>
+#include <math.h>
 #include <assert.h>
 #include <time.h>
 #include "digraph.h"
@@ -43,6 +44,7 @@ int main(int argc, char *argv[])
   int pass;
   uint_t size = 0;
   set_elem_e *set[MAX_VALS];
+  uint64_t *bits[MAX_VALS];
   uint_t numvals = 0;
   double sim;
 
@@ -101,11 +103,17 @@ int main(int argc, char *argv[])
     }
   }
 
+  for (k = 0; k < numvals; k++) {
+    bits[k] = set_to_bitset(set[k], size);
+  }
+
   for (k = 0; k < NUM_TESTS; k++) {
     i = rand() % numvals;
     j = rand() % numvals;
     sim =  jaccard_index(set[i], set[j], size);
     assert(sim >= 0 && sim <= 1);
+    assert(DOUBLE_APPROX_EQ(sim, jaccard_index_bits(bits[i], bits[j],
+                                                    SETATTR_WORDS(size))));
     printf("%u %u %f\n", i , j, sim);
   }
   exit(0);
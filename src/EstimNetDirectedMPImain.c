@@ -7,9 +7,62 @@
  * The MPI version simply runs multiple instances of the estimation
  * (each parsing the same config file) in parallel, writing the output
  * to separpate files (common prefix with MPI rank suffix).
- * 
  *
- *   Usage: EstimNetDirected_mpi config_filename
+ * With sharedAttributes = True, the node attributes are loaded by only
+ * one task on each (shared memory) node, into an MPI-3 shared memory
+ * window, and the other tasks on that node use them from there, so
+ * there is only one copy of them per node rather than one per task.
+ *
+ * With EEcollectiveInterval set, every that many outer iterations of
+ * Algorithm EE the tasks combine their stop tests (summed in the master
+ * task and broadcast) and all stop together once a quorum of them have converged and/or the
+ * R-hat of theta between them is small enough, or any has reached its
+ * wall clock limit. A task that has finished (or failed) keeps taking
+ * part in these tests until every task has finished.
+ *
+ * With EEsharedThetaInterval set, the tasks (each with its own chain)
+ * step one shared theta in Algorithm EE, combining their dzA and theta
+ * (summed in the master task and broadcast) every that many inner
+ * iterations, see algorithm_EE().
+ *
+ * With summaryFile set, the summary of the estimates of each task is
+ * gathered to the master task, which writes the pooled estimates,
+ * standard errors and R-hat of all the tasks to the summary file.
+ *
+ * With -t task_list_filename, instead of one run per rank of a single
+ * configuration, the job runs a list of (configuration, run) tasks:
+ * the master task only schedules, handing the next task to each
+ * worker rank as it becomes free, so that runs of differing cost
+ * (different models or networks) keep all the ranks busy. Each line of
+ * the task list is a configuration file and the number of runs of it
+ * (default 1), numbered from 0 as the ranks would be. With -x, once
+ * there are no tasks left to hand out, a free rank starts an extra run
+ * (up to max_extra per configuration) of the configuration whose
+ * oldest unfinished run has been running longest, adding a chain to
+ * its summary rather than leaving the rank idle.
+ *
+ * With partitionGraph = True, instead of each task running its own
+ * chain on its own copy of the network, the tasks run a single chain
+ * on the network partitioned between them (see digraphPartition.h and
+ * partitionedSampler.h), for networks too large for one node. The
+ * partitioned network communicates through the MPI collectives here
+ * (partition_comm), and task 0 writes the output files.
+ *
+ * With seriesContainerFile set, instead of each task writing its own
+ * theta and dzA files, all the tasks write binary records into the one
+ * file with MPI-IO, each into its own fixed regions (sized for the
+ * most records the configuration can produce), so that hundreds of
+ * tasks do not make thousands of small writes to the file system. Full
+ * 1 MiB buffers are written as they fill (MPI_File_iwrite_at, as the
+ * chains are not in step); the last partial buffers, the table of
+ * record counts and the header (parameter names and layout, see
+ * open_series_container()) are written collectively at the end.
+ * scripts/extractEstimNetDirectedContainer.R writes the usual text
+ * theta and dzA files of any of the tasks from it.
+ *
+ *
+ *   Usage: EstimNetDirected_mpi [-h] config_filename
+ *          EstimNetDirected_mpi [-x max_extra] -t task_list_filename
  *
  ****************************************************************************/
 
@@ -19,6 +72,9 @@
 #include <errno.h>
 #include <getopt.h>
 #include <unistd.h>
+#include <string.h>
+#include <math.h>
+#include <limits.h>
 #include <mpi.h>
 #include "utils.h"
 #include "estimconfigparser.h"
@@ -32,6 +88,74 @@
 
 static const int MPI_RANK_MASTER  = 0; /* MPI master task rank number */
 
+/* message tags of the task scheduler (-t) */
+static const int TAG_RESULT  = 1; /* worker to master: task finished */
+static const int TAG_SUMMARY = 2; /* worker to master: its packed summary */
+static const int TAG_NAMES   = 3; /* worker to master: its parameter names */
+static const int TAG_TASK    = 4; /* master to worker: next task or stop */
+
+static const size_t TASK_LINE_MAX = 16384; /* line buffer for task list */
+
+/* seriesContainerFile layout: text header (NUL padded), then the table
+   of record counts, then the regions, each starting on a multiple of
+   CONTAINER_ALIGN bytes */
+static const long CONTAINER_HEADER_BYTES = 262144;
+static const long CONTAINER_ALIGN = 1048576;
+
+/*****************************************************************************
+ *
+ * Types
+ *
+ ****************************************************************************/
+
+/* an exchange started by partition_start_allgatherv() */
+typedef struct allgatherv_request_s
+{
+  MPI_Request request;
+  int        *counts;   /* number of values from each task */
+  int        *displs;   /* and their offsets in recvbuf */
+  uint_t     *recvbuf;  /* values from all the tasks */
+} allgatherv_request_t;
+
+/* a configuration in the task list of the scheduler (-t) */
+typedef struct task_config_s
+{
+  char            *config_filename;
+  uint_t           num_runs;        /* runs listed */
+  uint_t           num_extra;       /* extra runs added (-x) */
+  uint_t           num_started;     /* runs handed out so far */
+  uint_t           num_done;        /* runs finished (or failed) so far */
+  /* master task only: */
+  char            *summary_filename; /* summaryFile, or NULL */
+  uint_t           first_run;       /* outputFileSuffixBase */
+  chain_summary_t *summaries;       /* num_runs + max_extra summaries (n is
+                                       0 until received) */
+  char            *param_names;     /* from the first summary received */
+} task_config_t;
+
+/* a region of the seriesContainerFile written by this task, the data
+   of its series_sink_t */
+typedef struct container_region_s
+{
+  MPI_File    fh;
+  MPI_Request request;     /* write of the last full buffer */
+  double     *tail;        /* last (partial) buffer, written at close */
+  size_t      tail_len;    /* values in tail */
+  MPI_Offset  tail_offset; /* where tail goes in the file */
+} container_region_t;
+
+/* the seriesContainerFile: the theta (0) and dzA (1) regions of this
+   task */
+typedef struct series_container_s
+{
+  MPI_File           fh;
+  MPI_Offset         data_offset;     /* start of the regions of task 0 */
+  long               region_bytes[2]; /* size of each region */
+  series_sink_t      sinks[2];
+  container_region_t regions[2];
+  char               names[2][64];    /* for messages */
+} series_container_t;
+
 /*****************************************************************************
  *
  * File static variables
@@ -42,6 +166,873 @@ static char myname[MPI_MAX_PROCESSOR_NAME];   /* MPI name */
 static int  mynamelen;                        /* length of myname */
 static int  numtasks, rank;                   /* MPI number of tasks, rank */
 
+static MPI_Comm node_comm = MPI_COMM_NULL; /* tasks on same (shared mem) node */
+static MPI_Win  attr_win = MPI_WIN_NULL;   /* shared node attributes window */
+
+
+/*****************************************************************************
+ *
+ * Local functions
+ *
+ ****************************************************************************/
+
+/*
+ * Load the node attributes into memory shared by all the tasks on this
+ * node: the first task on the node loads them from the files and moves
+ * them into a shared memory window, and the others attach to it.
+ * Same parameters and return value as load_attributes().
+ */
+static int load_attributes_shared(digraph_t *g,
+                                  const char *binattr_filename,
+                                  const char *catattr_filename,
+                                  const char *contattr_filename,
+                                  const char *setattr_filename,
+                                  const char *dyadcov_filename)
+{
+  int       node_rank, rc = 0;
+  MPI_Aint  size = 0, qsize;
+  int       disp_unit;
+  void     *block;
+
+  MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, rank,
+                      MPI_INFO_NULL, &node_comm);
+  MPI_Comm_rank(node_comm, &node_rank);
+  if (node_rank == 0) {
+    rc = load_attributes(g, binattr_filename, catattr_filename,
+                         contattr_filename, setattr_filename,
+                         dyadcov_filename);
+    if (rc == 0)
+      size = (MPI_Aint)digraph_attributes_block_size(g);
+  }
+  MPI_Bcast(&rc, 1, MPI_INT, 0, node_comm);
+  if (rc != 0)
+    return rc;
+  MPI_Win_allocate_shared(size, 1, MPI_INFO_NULL, node_comm, &block,
+                          &attr_win);
+  MPI_Win_shared_query(attr_win, 0, &qsize, &disp_unit, &block);
+  MPI_Win_fence(0, attr_win);
+  if (node_rank == 0)
+    move_digraph_attributes(g, block);
+  MPI_Win_fence(0, attr_win);
+  if (node_rank != 0)
+    attach_digraph_attributes(g, block);
+  return 0;
+}
+
+/*
+ * Convert counts of values (for each task) to int counts and offsets
+ * for MPI, aborting if they do not fit.
+ *
+ * Parameters:
+ *   counts   - number of values for each task
+ *   icounts  - (Out) the counts as int
+ *   displs   - (Out) offset of the values of each task
+ *
+ * Return value:
+ *   Total number of values.
+ */
+static size_t mpi_counts(const uint_t counts[], int icounts[], int displs[])
+{
+  size_t total = 0;
+  int    r;
+
+  for (r = 0; r < numtasks; r++) {
+    if (total + counts[r] > INT_MAX) {
+      fprintf(stderr, "ERROR: partitioned network message too large\n");
+      MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    icounts[r] = (int)counts[r];
+    displs[r] = (int)total;
+    total += counts[r];
+  }
+  return total;
+}
+
+/*
+ * Exchange values between all the tasks of a partitioned network, see
+ * partition_comm_t: MPI_Alltoall of the counts, then MPI_Alltoallv.
+ */
+static uint_t *partition_alltoallv(void *data, const uint_t *sendbuf,
+                                   const uint_t sendcounts[],
+                                   uint_t recvcounts[])
+{
+  int    *scounts = (int *)safe_malloc(4 * numtasks * sizeof(int));
+  int    *sdispls = scounts + numtasks, *rcounts = scounts + 2 * numtasks;
+  int    *rdispls = scounts + 3 * numtasks;
+  uint_t *recvbuf;
+  size_t  total;
+  int     r;
+
+  (void)data;
+  (void)mpi_counts(sendcounts, scounts, sdispls);
+  MPI_Alltoall(scounts, 1, MPI_INT, rcounts, 1, MPI_INT, MPI_COMM_WORLD);
+  for (r = 0; r < numtasks; r++)
+    recvcounts[r] = (uint_t)rcounts[r];
+  total = mpi_counts(recvcounts, rcounts, rdispls);
+  recvbuf = (uint_t *)safe_malloc(MAX(total, 1) * sizeof(uint_t));
+  MPI_Alltoallv(sendbuf, scounts, sdispls, MPI_UNSIGNED, recvbuf, rcounts,
+                rdispls, MPI_UNSIGNED, MPI_COMM_WORLD);
+  free(scounts);
+  return recvbuf;
+}
+
+/*
+ * Start sending values to every task of a partitioned network, see
+ * partition_comm_t: MPI_Allgather of the counts, then the values with
+ * MPI_Iallgatherv, finished by partition_finish_allgatherv().
+ */
+static void *partition_start_allgatherv(void *data, const uint_t *sendbuf,
+                                        uint_t sendcount)
+{
+  allgatherv_request_t *req = (allgatherv_request_t *)
+    safe_malloc(sizeof(allgatherv_request_t));
+  uint_t *counts = (uint_t *)safe_malloc(numtasks * sizeof(uint_t));
+  size_t  total;
+
+  (void)data;
+  req->counts = (int *)safe_malloc(numtasks * sizeof(int));
+  req->displs = (int *)safe_malloc(numtasks * sizeof(int));
+  MPI_Allgather(&sendcount, 1, MPI_UNSIGNED, counts, 1, MPI_UNSIGNED,
+                MPI_COMM_WORLD);
+  total = mpi_counts(counts, req->counts, req->displs);
+  req->recvbuf = (uint_t *)safe_malloc(MAX(total, 1) * sizeof(uint_t));
+  MPI_Iallgatherv(sendbuf, (int)sendcount, MPI_UNSIGNED, req->recvbuf,
+                  req->counts, req->displs, MPI_UNSIGNED, MPI_COMM_WORLD,
+                  &req->request);
+  free(counts);
+  return req;
+}
+
+/*
+ * Wait for an exchange started by partition_start_allgatherv(), see
+ * partition_comm_t.
+ */
+static uint_t *partition_finish_allgatherv(void *data, void *request,
+                                           uint_t recvcounts[])
+{
+  allgatherv_request_t *req = (allgatherv_request_t *)request;
+  uint_t *recvbuf = req->recvbuf;
+  int     r;
+
+  (void)data;
+  MPI_Wait(&req->request, MPI_STATUS_IGNORE);
+  for (r = 0; r < numtasks; r++)
+    recvcounts[r] = (uint_t)req->counts[r];
+  free(req->counts);
+  free(req->displs);
+  free(req);
+  return recvbuf;
+}
+
+/*
+ * Sum values over all the tasks, see partition_comm_t. MPI_Allreduce
+ * need not give exactly the same sums in every task (the order of
+ * addition may differ), so they are summed in the master task and
+ * broadcast from there.
+ */
+static void partition_allreduce_sum_mpi(void *data, double values[],
+                                        uint_t n)
+{
+  (void)data;
+  MPI_Reduce(rank == MPI_RANK_MASTER ? MPI_IN_PLACE : values, values, (int)n,
+             MPI_DOUBLE, MPI_SUM, MPI_RANK_MASTER, MPI_COMM_WORLD);
+  MPI_Bcast(values, (int)n, MPI_DOUBLE, MPI_RANK_MASTER, MPI_COMM_WORLD);
+}
+
+/*
+ * Combine the Algorithm EE stop tests of this task with those of all
+ * the other tasks, see ee_collective_stop_func_t. The tasks all stop
+ * if any has reached the wall clock limit, or if they are converged:
+ * at least stop->quorum of the tasks still running have met the
+ * convergence criteria (if stop->window is nonzero) and the R-hat of
+ * every theta between them (since the last test) is less than
+ * stop->maxRhat (if it is nonzero).
+ *
+ * Each test is two sums over the tasks with
+ * partition_allreduce_sum_mpi(): the first of the number of tasks
+ * running, converged and out of time (and the number of parameters),
+ * and the second of the sample size and the mean, squared mean and
+ * variance of each theta. As these are exactly the same in every task,
+ * so is the R-hat computed from them, and every task makes the same
+ * decision (with MPI_Allreduce a task could stop while another went
+ * on, and then wait for it forever).
+ */
+static ee_stop_reason_e collective_stop(const ee_stop_criteria_t *stop,
+                                        bool converged, bool time_up,
+                                        const online_stats_t *theta_stats)
+{
+  uint_t  n = theta_stats->n, l;
+  double  counts[4], *sums, sd, num_tasks, num, w, var_plus;
+  bool    rhat_ok = TRUE;
+
+  counts[0] = 1;
+  counts[1] = converged;
+  counts[2] = time_up;
+  counts[3] = n;
+  partition_allreduce_sum_mpi(NULL, counts, 4);
+  sums = (double *)safe_malloc((1 + 3 * n) * sizeof(double));
+  sums[0] = theta_stats->count;
+  for (l = 0; l < n; l++) {
+    sd = online_stats_sd(theta_stats, l);
+    sums[1 + l] = theta_stats->mean[l];
+    sums[1 + n + l] = theta_stats->mean[l] * theta_stats->mean[l];
+    /* sample variance from population variance */
+    sums[1 + 2 * n + l] = theta_stats->count > 1 ?
+      sd * sd * theta_stats->count / (theta_stats->count - 1) : 0;
+  }
+  partition_allreduce_sum_mpi(NULL, sums, 1 + 3 * n);
+  num_tasks = counts[0];
+  if (stop->maxRhat > 0) {
+    rhat_ok = num_tasks > 1;
+    num = sums[0] / num_tasks;
+    for (l = 0; l < n && rhat_ok; l++) {
+      w = sums[1 + 2 * n + l] / num_tasks;
+      var_plus = (num - 1) / num * w +
+        MAX(sums[1 + n + l] - sums[1 + l] * sums[1 + l] / num_tasks, 0) /
+        (num_tasks - 1);
+      rhat_ok = w > 0 && sqrt(var_plus / w) < stop->maxRhat;
+    }
+  }
+  free(sums);
+  if (rank == MPI_RANK_MASTER)
+    printf("collective stop test: %g tasks running, %g converged, "
+           "%g out of time%s\n", num_tasks, counts[1], counts[2],
+           stop->maxRhat > 0 ? (rhat_ok ? ", R-hat below maximum" :
+                                ", R-hat not below maximum") : "");
+  if (counts[2] > 0)
+    return EE_STOP_TIME_LIMIT;
+  if ((stop->window > 0 || stop->maxRhat > 0) &&
+      (stop->window == 0 || counts[1] >= stop->quorum * num_tasks) &&
+      rhat_ok)
+    return EE_STOP_CONVERGED_TASKS;
+  return EE_STOP_MAX_STEPS;
+}
+
+/*
+ * Take part in the collective stop tests of the tasks still running
+ * Algorithm EE (contributing nothing) until every task has finished.
+ * Every task must call this after do_estimation() when collective
+ * tests are used.
+ */
+static void finish_collective_stop(void)
+{
+  double  counts[4], *sums;
+  uint_t  n, l;
+
+  for (;;) {
+    counts[0] = counts[1] = counts[2] = counts[3] = 0;
+    partition_allreduce_sum_mpi(NULL, counts, 4);
+    if (counts[0] < 1)
+      break; /* no task is running Algorithm EE */
+    n = (uint_t)(counts[3] / counts[0]);
+    sums = (double *)safe_malloc((1 + 3 * n) * sizeof(double));
+    for (l = 0; l < 1 + 3 * n; l++)
+      sums[l] = 0;
+    partition_allreduce_sum_mpi(NULL, sums, 1 + 3 * n);
+    free(sums);
+  }
+}
+
+/*
+ * Write values into a region of the seriesContainerFile, see
+ * series_sink_t: a full buffer is started writing (after the previous
+ * one has finished), and the last one kept for close_series_container().
+ */
+static int container_write_at(void *data, long offset, const double *values,
+                              size_t n, bool last)
+{
+  container_region_t *region = (container_region_t *)data;
+  int                 rc = MPI_SUCCESS;
+
+  if (region->request != MPI_REQUEST_NULL)
+    rc = MPI_Wait(&region->request, MPI_STATUS_IGNORE);
+  if (last) {
+    region->tail = (double *)safe_malloc(MAX(n, 1) * sizeof(double));
+    memcpy(region->tail, values, n * sizeof(double));
+    region->tail_len = n;
+    region->tail_offset = (MPI_Offset)offset;
+  } else if (rc == MPI_SUCCESS) {
+    rc = MPI_File_iwrite_at(region->fh, (MPI_Offset)offset, values, (int)n,
+                            MPI_DOUBLE, &region->request);
+  }
+  return rc != MPI_SUCCESS;
+}
+
+/*
+ * Round up to a multiple of CONTAINER_ALIGN.
+ */
+static MPI_Offset container_align(MPI_Offset bytes)
+{
+  return (bytes + CONTAINER_ALIGN - 1) / CONTAINER_ALIGN * CONTAINER_ALIGN;
+}
+
+/*
+ * Create the seriesContainerFile and set up the sinks of the theta and
+ * dzA regions of this task. Every task must call this, with the same
+ * configuration.
+ *
+ * The file starts with a text header of CONTAINER_HEADER_BYTES (padded
+ * with NUL characters), written by close_series_container(), of lines
+ * "key value":
+ *
+ *   EstimNetDirected seriesContainerFile 1
+ *   tasks           number of tasks
+ *   firstRun        run number of task 0 (outputFileSuffixBase)
+ *   countsOffset    offset of the table of record counts
+ *   dataOffset      offset of the regions of task 0
+ *   thetaRegionBytes, dzARegionBytes   size of each region
+ *   thetaColumns, dzAColumns   column names (the header lines of the
+ *                   theta and dzA files)
+ *
+ * The table of counts has two doubles for each task, the number of
+ * values in its theta and dzA regions. The theta region of task r is
+ * at dataOffset + r * (thetaRegionBytes + dzARegionBytes), followed by
+ * its dzA region, each holding records of one native double per
+ * column, as in the binaryOutput files.
+ *
+ * Parameters:
+ *   config     - configuration settings
+ *   container  - (out) the container, to be closed with
+ *                close_series_container()
+ *   theta_sink - (out) sink of the theta region of this task
+ *   dzA_sink   - (out) sink of the dzA region of this task
+ *
+ * Return value:
+ *   0 if OK else nonzero on error (on every task).
+ */
+static int open_series_container(const estim_config_t *config,
+                                 series_container_t *container,
+                                 series_sink_t **theta_sink,
+                                 series_sink_t **dzA_sink)
+{
+  MPI_Info   info;
+  size_t     values[2];
+  MPI_Offset region_offset;
+  int        k, err, any_err;
+
+  memset(container, 0, sizeof(series_container_t));
+  container->fh = MPI_FILE_NULL;
+  estimation_series_capacity(config, &values[0], &values[1]);
+  for (k = 0; k < 2; k++)
+    container->region_bytes[k] =
+      (long)container_align((MPI_Offset)(values[k] * sizeof(double)));
+  container->data_offset = container_align(CONTAINER_HEADER_BYTES +
+                                           2 * numtasks * sizeof(double));
+  MPI_Info_create(&info);
+  MPI_Info_set(info, "romio_cb_write", "enable");
+  err = MPI_File_open(MPI_COMM_WORLD, config->series_container_filename,
+                      MPI_MODE_CREATE | MPI_MODE_WRONLY, info,
+                      &container->fh) != MPI_SUCCESS;
+  MPI_Info_free(&info);
+  if (!err)
+    err = MPI_File_set_size(container->fh, 0) != MPI_SUCCESS;
+  MPI_Allreduce(&err, &any_err, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+  if (any_err) {
+    if (rank == MPI_RANK_MASTER)
+      fprintf(stderr, "ERROR: could not create seriesContainerFile %s\n",
+              config->series_container_filename);
+    if (container->fh != MPI_FILE_NULL)
+      MPI_File_close(&container->fh);
+    return 1;
+  }
+  region_offset = container->data_offset + (MPI_Offset)rank *
+    (container->region_bytes[0] + container->region_bytes[1]);
+  for (k = 0; k < 2; k++) {
+    container->regions[k].fh = container->fh;
+    container->regions[k].request = MPI_REQUEST_NULL;
+    snprintf(container->names[k], sizeof(container->names[k]),
+             "%s of task %d in seriesContainerFile", k ? "dzA" : "theta",
+             rank);
+    container->sinks[k].write_at = container_write_at;
+    container->sinks[k].data = &container->regions[k];
+    container->sinks[k].offset = (long)region_offset;
+    container->sinks[k].size = container->region_bytes[k];
+    container->sinks[k].name = container->names[k];
+    region_offset += container->region_bytes[k];
+  }
+  *theta_sink = &container->sinks[0];
+  *dzA_sink = &container->sinks[1];
+  if (rank == MPI_RANK_MASTER)
+    printf("seriesContainerFile %s: regions of %ld and %ld bytes per "
+           "task\n", config->series_container_filename,
+           container->region_bytes[0], container->region_bytes[1]);
+  return 0;
+}
+
+/*
+ * Finish writing the seriesContainerFile (see open_series_container())
+ * after do_estimation(): the last buffer of each region, the record
+ * counts, and the header (from the lowest numbered task that has the
+ * column names), and close it. Every task must call this.
+ *
+ * Parameters:
+ *   container - the container
+ *   first_run - run number of task 0 (as in the output filenames)
+ *
+ * Return value:
+ *   0 if OK else nonzero on error.
+ */
+static int close_series_container(series_container_t *container,
+                                  uint_t first_run)
+{
+  container_region_t *region;
+  series_sink_t      *sink;
+  double              counts[2];
+  int                 k, src, len[2], err = 0;
+  char               *names[2], *header;
+  MPI_Status          status;
+
+  for (k = 0; k < 2; k++) {
+    region = &container->regions[k];
+    if (region->request != MPI_REQUEST_NULL)
+      err |= MPI_Wait(&region->request, MPI_STATUS_IGNORE) != MPI_SUCCESS;
+    err |= MPI_File_write_at_all(container->fh, region->tail_offset,
+                                 region->tail, (int)region->tail_len,
+                                 MPI_DOUBLE, &status) != MPI_SUCCESS;
+    free(region->tail);
+    counts[k] = (double)container->sinks[k].num_values;
+  }
+  err |= MPI_File_write_at_all(container->fh, CONTAINER_HEADER_BYTES +
+                               (MPI_Offset)rank * 2 * sizeof(double),
+                               counts, 2, MPI_DOUBLE, &status) != MPI_SUCCESS;
+
+  /* the column names are the same for every task that got as far as
+     opening its series */
+  src = container->sinks[0].header ? rank : numtasks;
+  MPI_Allreduce(MPI_IN_PLACE, &src, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+  for (k = 0; k < 2; k++) {
+    sink = &container->sinks[k];
+    len[k] = src == rank && sink->header ? (int)strlen(sink->header) + 1 : 1;
+  }
+  if (src < numtasks)
+    MPI_Bcast(len, 2, MPI_INT, src, MPI_COMM_WORLD);
+  for (k = 0; k < 2; k++) {
+    names[k] = (char *)safe_calloc(len[k], 1);
+    if (src == rank && container->sinks[k].header)
+      strcpy(names[k], container->sinks[k].header);
+    if (src < numtasks)
+      MPI_Bcast(names[k], len[k], MPI_CHAR, src, MPI_COMM_WORLD);
+  }
+  if (rank == MPI_RANK_MASTER) {
+    header = (char *)safe_calloc(CONTAINER_HEADER_BYTES, 1);
+    if (snprintf(header, CONTAINER_HEADER_BYTES,
+                 "EstimNetDirected seriesContainerFile 1\n"
+                 "tasks %d\nfirstRun %u\ncountsOffset %ld\n"
+                 "dataOffset %lld\nthetaRegionBytes %ld\n"
+                 "dzARegionBytes %ld\nthetaColumns %s\ndzAColumns %s\n",
+                 numtasks, first_run, CONTAINER_HEADER_BYTES,
+                 (long long)container->data_offset,
+                 container->region_bytes[0], container->region_bytes[1],
+                 names[0], names[1]) >= CONTAINER_HEADER_BYTES) {
+      fprintf(stderr, "ERROR: seriesContainerFile header too long\n");
+      err = 1;
+    }
+    err |= MPI_File_write_at(container->fh, 0, header,
+                             (int)CONTAINER_HEADER_BYTES, MPI_CHAR,
+                             &status) != MPI_SUCCESS;
+    free(header);
+  }
+  err |= MPI_File_close(&container->fh) != MPI_SUCCESS;
+  if (err)
+    fprintf(stderr, "ERROR: task %d writing seriesContainerFile failed\n",
+            rank);
+  for (k = 0; k < 2; k++) {
+    free(names[k]);
+    free(container->sinks[k].header);
+  }
+  return err;
+}
+
+/*
+ * Gather the summary of the estimates of every task to the master
+ * task and write the summary file there. Every task must call this.
+ *
+ * Parameters:
+ *   filename - summary file to write
+ *   first_run - run number of task 0 (as in the output filenames)
+ *   summary  - summary of the estimates of this task, from
+ *              do_estimation() (n is 0 if it failed before making it)
+ *
+ * Return value:
+ *   0 if OK else nonzero on error writing the file (master task only).
+ */
+static int gather_summaries(const char *filename, uint_t first_run,
+                            chain_summary_t *summary)
+{
+  int              n, my_n = (int)summary->n, len, r, rc = 0;
+  double          *buf, *allbuf = NULL;
+  chain_summary_t *summaries;
+
+  MPI_Allreduce(&my_n, &n, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+  if (n == 0)
+    return 0; /* every task failed, nothing to summarize */
+  if (my_n != n) {
+    /* this task failed: send an invalid summary of the right size */
+    free_chain_summary(summary);
+    init_chain_summary(summary, n);
+  }
+  len = (int)CHAIN_SUMMARY_LEN(n);
+  buf = (double *)safe_malloc(len * sizeof(double));
+  pack_chain_summary(summary, buf);
+  if (rank == MPI_RANK_MASTER)
+    allbuf = (double *)safe_malloc((size_t)numtasks * len * sizeof(double));
+  MPI_Gather(buf, len, MPI_DOUBLE, allbuf, len, MPI_DOUBLE, MPI_RANK_MASTER,
+             MPI_COMM_WORLD);
+  if (rank == MPI_RANK_MASTER) {
+    summaries = (chain_summary_t *)safe_malloc(numtasks *
+                                               sizeof(chain_summary_t));
+    for (r = 0; r < numtasks; r++) {
+      init_chain_summary(&summaries[r], n);
+      unpack_chain_summary(allbuf + (size_t)r * len, &summaries[r]);
+    }
+    rc = write_estimation_summary(filename, summaries, numtasks, first_run,
+                                  summary->param_names);
+    for (r = 0; r < numtasks; r++)
+      free_chain_summary(&summaries[r]);
+    free(summaries);
+    free(allbuf);
+  }
+  free(buf);
+  return rc;
+}
+
+/*
+ * Read the task list of the scheduler: each non-blank line (other than
+ * comments starting with #) is a configuration file name, optionally
+ * followed by the number of runs of it (default 1).
+ *
+ * Parameters:
+ *   filename    - task list file
+ *   num_configs - (Out) number of configurations in the list
+ *
+ * Return value:
+ *   Array of num_configs configurations, or NULL on error (message
+ *   printed to stderr).
+ */
+static task_config_t *read_task_list(const char *filename,
+                                     uint_t *num_configs)
+{
+  const char    *delims = " \t\r\n";
+  FILE          *fp;
+  char          *buf, *saveptr, *token, *endptr;
+  task_config_t *tasks = NULL;
+  uint_t         num = 0;
+  long           runs;
+  bool           ok = TRUE;
+
+  if (!(fp = fopen(filename, "r"))) {
+    fprintf(stderr, "ERROR: could not open task list %s (%s)\n", filename,
+            strerror(errno));
+    return NULL;
+  }
+  buf = (char *)safe_malloc(TASK_LINE_MAX);
+  while (ok && fgets(buf, TASK_LINE_MAX, fp)) {
+    if (!(token = strtok_r(buf, delims, &saveptr)) || token[0] == '#')
+      continue;
+    tasks = (task_config_t *)safe_realloc(tasks, (num + 1) *
+                                          sizeof(task_config_t));
+    memset(&tasks[num], 0, sizeof(task_config_t));
+    tasks[num].config_filename = safe_strdup(token);
+    tasks[num].num_runs = 1;
+    if ((token = strtok_r(NULL, delims, &saveptr))) {
+      runs = strtol(token, &endptr, 10);
+      if (*endptr != '\0' || runs < 1) {
+        fprintf(stderr, "ERROR: bad number of runs %s for %s in task list "
+                "%s\n", token, tasks[num].config_filename, filename);
+        ok = FALSE;
+      }
+      tasks[num].num_runs = (uint_t)runs;
+    }
+    num++;
+  }
+  free(buf);
+  fclose(fp);
+  if (ok && num == 0) {
+    fprintf(stderr, "ERROR: no configurations in task list %s\n", filename);
+    ok = FALSE;
+  }
+  if (!ok) {
+    while (num > 0)
+      free(tasks[--num].config_filename);
+    free(tasks);
+    return NULL;
+  }
+  *num_configs = num;
+  return tasks;
+}
+
+/*
+ * Parse a configuration file of the task list, after freeing the
+ * previous configuration (if any) as the parser has only one, and
+ * check that it can be used as a task of the scheduler.
+ *
+ * Parameters:
+ *   config          - previous configuration, or NULL for none
+ *   config_filename - configuration file to parse
+ *
+ * Return value:
+ *   Configuration settings, or NULL on error (message printed to
+ *   stderr), in which case the previous configuration is freed.
+ */
+static estim_config_t *parse_task_config(estim_config_t *config,
+                                         const char *config_filename)
+{
+  if (config) {
+    free_estim_config_struct(config);
+    init_estim_config_parser();
+  }
+  if (!(config = parse_estim_config_file(config_filename))) {
+    fprintf(stderr, "ERROR parsing configuration file %s\n",
+            config_filename);
+    return NULL;
+  }
+  /* these are collective operations over all the ranks, which run
+     different tasks here */
+  if (config->EEcollectiveInterval > 0 || config->sharedAttributes ||
+      config->partitionGraph || config->EEsharedThetaInterval > 0 ||
+      config->series_container_filename) {
+    fprintf(stderr, "ERROR: EEcollectiveInterval, sharedAttributes, "
+            "partitionGraph, EEsharedThetaInterval and seriesContainerFile "
+            "cannot be used in a task list (%s)\n", config_filename);
+    free_estim_config_struct(config);
+    init_estim_config_parser();
+    return NULL;
+  }
+  return config;
+}
+
+/*
+ * Write the summary file of a configuration of the task list, once all
+ * its runs have finished. Runs that failed before making a summary are
+ * included as invalid runs.
+ *
+ * Parameters:
+ *   task - configuration whose runs have all finished
+ *
+ * Return value:
+ *   0 if OK else nonzero on error (message printed to stderr).
+ */
+static int write_task_summary(task_config_t *task)
+{
+  uint_t num_runs = task->num_runs + task->num_extra, n = 0, r;
+  int    rc;
+
+  for (r = 0; r < num_runs && n == 0; r++)
+    n = task->summaries[r].n;
+  if (n == 0) {
+    fprintf(stderr, "ERROR: no run of %s made a summary\n",
+            task->config_filename);
+    return -1;
+  }
+  for (r = 0; r < num_runs; r++) {
+    if (task->summaries[r].n == 0)
+      init_chain_summary(&task->summaries[r], n);
+  }
+  if ((rc = write_estimation_summary(task->summary_filename,
+                                     task->summaries, num_runs,
+                                     task->first_run, task->param_names)))
+    return rc;
+  printf("wrote summary of %u runs of %s to %s\n", num_runs,
+         task->config_filename, task->summary_filename);
+  return 0;
+}
+
+/*
+ * The master task of the scheduler: hand out the runs of the task list
+ * to the worker ranks as they become free, collecting the summaries,
+ * until there are none left, and then tell each worker to stop.
+ *
+ * Parameters:
+ *   tasks       - the task list
+ *   num_configs - number of configurations in tasks
+ *   max_extra   - maximum number of extra runs of each configuration
+ *                 started on free ranks once the list is exhausted
+ *
+ * Return value:
+ *   0 if OK else nonzero if any run failed or a summary could not be
+ *   written.
+ */
+static int run_task_master(task_config_t tasks[], uint_t num_configs,
+                           uint_t max_extra)
+{
+  estim_config_t  *config = NULL;
+  int              result[4], task[2], src, w, len;
+  int              num_workers = numtasks - 1;
+  int             *worker_config;
+  double          *worker_start, *buf, oldest;
+  uint_t           c, next = 0, num_runs;
+  chain_summary_t *summary;
+  MPI_Status       status;
+  int              rc = 0;
+
+  /* check all the configurations before starting any run; if one is
+     bad no runs are handed out, so the workers just stop */
+  for (c = 0; c < num_configs; c++)
+    tasks[c].summaries = (chain_summary_t *)safe_calloc(
+      tasks[c].num_runs + max_extra, sizeof(chain_summary_t));
+  for (c = 0; c < num_configs && rc == 0; c++) {
+    if (!(config = parse_task_config(config, tasks[c].config_filename))) {
+      rc = 1;
+      next = num_configs;
+    } else {
+      tasks[c].summary_filename = config->summary_filename ?
+        safe_strdup(config->summary_filename) : NULL;
+      tasks[c].first_run = config->outputFileSuffixBase;
+    }
+  }
+  if (config)
+    free_estim_config_struct(config);
+
+  worker_config = (int *)safe_malloc(numtasks * sizeof(int));
+  worker_start = (double *)safe_malloc(numtasks * sizeof(double));
+  for (w = 0; w < numtasks; w++)
+    worker_config[w] = -1;
+
+  while (num_workers > 0) {
+    /* result is configuration, run, return code and number of
+       parameters of its summary (0 for none), or -1 for no run yet */
+    MPI_Recv(result, 4, MPI_INT, MPI_ANY_SOURCE, TAG_RESULT, MPI_COMM_WORLD,
+             &status);
+    src = status.MPI_SOURCE;
+    if (result[0] >= 0) {
+      c = (uint_t)result[0];
+      printf("run %d of %s finished on rank %d in %.0f s%s\n", result[1],
+             tasks[c].config_filename, src, MPI_Wtime() - worker_start[src],
+             result[2] ? " (FAILED)" : "");
+      if (result[2])
+        rc = 1;
+      if (result[3] > 0) {
+        summary = &tasks[c].summaries[result[1]];
+        len = (int)CHAIN_SUMMARY_LEN(result[3]);
+        buf = (double *)safe_malloc(len * sizeof(double));
+        MPI_Recv(buf, len, MPI_DOUBLE, src, TAG_SUMMARY, MPI_COMM_WORLD,
+                 MPI_STATUS_IGNORE);
+        init_chain_summary(summary, (uint_t)result[3]);
+        unpack_chain_summary(buf, summary);
+        free(buf);
+        MPI_Probe(src, TAG_NAMES, MPI_COMM_WORLD, &status);
+        MPI_Get_count(&status, MPI_CHAR, &len);
+        summary->param_names = (char *)safe_malloc(len);
+        MPI_Recv(summary->param_names, len, MPI_CHAR, src, TAG_NAMES,
+                 MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        if (!tasks[c].param_names)
+          tasks[c].param_names = safe_strdup(summary->param_names);
+      }
+      worker_config[src] = -1;
+      tasks[c].num_done++;
+      if (tasks[c].num_done == tasks[c].num_started &&
+          tasks[c].num_started >= tasks[c].num_runs &&
+          tasks[c].summary_filename && write_task_summary(&tasks[c]))
+        rc = 1;
+    }
+
+    /* the next run in the list, or else an extra run of the
+       configuration with the longest running unfinished run */
+    while (next < num_configs && tasks[next].num_started ==
+           tasks[next].num_runs)
+      next++;
+    task[0] = task[1] = -1;
+    if (next < num_configs) {
+      task[0] = (int)next;
+    } else if (max_extra > 0) {
+      oldest = 0;
+      for (w = 1; w < numtasks; w++) {
+        if (worker_config[w] >= 0 &&
+            tasks[worker_config[w]].num_extra < max_extra &&
+            (task[0] < 0 || worker_start[w] < oldest)) {
+          task[0] = worker_config[w];
+          oldest = worker_start[w];
+        }
+      }
+      if (task[0] >= 0)
+        tasks[task[0]].num_extra++;
+    }
+    if (task[0] >= 0) {
+      task[1] = (int)tasks[task[0]].num_started++;
+      worker_config[src] = task[0];
+      worker_start[src] = MPI_Wtime();
+      printf("run %d of %s started on rank %d%s\n", task[1],
+             tasks[task[0]].config_filename, src,
+             (uint_t)task[1] >= tasks[task[0]].num_runs ? " (extra)" : "");
+    } else {
+      num_workers--;
+    }
+    fflush(stdout);
+    MPI_Send(task, 2, MPI_INT, src, TAG_TASK, MPI_COMM_WORLD);
+  }
+
+  for (c = 0; c < num_configs; c++) {
+    num_runs = tasks[c].num_runs + tasks[c].num_extra;
+    while (num_runs > 0)
+      free_chain_summary(&tasks[c].summaries[--num_runs]);
+    free(tasks[c].summaries);
+    free(tasks[c].summary_filename);
+    free(tasks[c].param_names);
+  }
+  free(worker_config);
+  free(worker_start);
+  return rc;
+}
+
+/*
+ * A worker task of the scheduler: ask the master for a run, do it and
+ * send back the result (and summary), until told to stop.
+ *
+ * Parameters:
+ *   tasks - the task list
+ *
+ * Return value:
+ *   0 (the master reports failed runs).
+ */
+static int run_task_worker(const task_config_t tasks[])
+{
+  estim_config_t  *config = NULL;
+  int              result[4] = {-1, -1, 0, 0}, task[2];
+  double          *buf;
+  chain_summary_t  summary;
+
+  memset(&summary, 0, sizeof(summary));
+  for (;;) {
+    MPI_Send(result, 4, MPI_INT, MPI_RANK_MASTER, TAG_RESULT,
+             MPI_COMM_WORLD);
+    if (result[3] > 0) {
+      buf = (double *)safe_malloc(CHAIN_SUMMARY_LEN(summary.n) *
+                                  sizeof(double));
+      pack_chain_summary(&summary, buf);
+      MPI_Send(buf, (int)CHAIN_SUMMARY_LEN(summary.n), MPI_DOUBLE,
+               MPI_RANK_MASTER, TAG_SUMMARY, MPI_COMM_WORLD);
+      free(buf);
+      MPI_Send(summary.param_names ? summary.param_names : "",
+               summary.param_names ? (int)strlen(summary.param_names) + 1 : 1,
+               MPI_CHAR, MPI_RANK_MASTER, TAG_NAMES, MPI_COMM_WORLD);
+    }
+    free_chain_summary(&summary);
+    memset(&summary, 0, sizeof(summary));
+
+    MPI_Recv(task, 2, MPI_INT, MPI_RANK_MASTER, TAG_TASK, MPI_COMM_WORLD,
+             MPI_STATUS_IGNORE);
+    if (task[0] < 0)
+      break;
+    result[0] = task[0];
+    result[1] = task[1];
+    result[2] = 1;
+    result[3] = 0;
+    if ((config = parse_task_config(config,
+                                    tasks[task[0]].config_filename))) {
+      init_prng(task[1]); /* as for the rank of the same number */
+      result[2] = do_estimation(config, (uint_t)task[1], load_attributes,
+                                NULL, NULL,
+                                config->summary_filename ? &summary : NULL,
+                                NULL, NULL, NULL, NULL, NULL) ? 1 : 0;
+      /* summary.n is 0 if it failed before making the summary */
+      result[3] = (int)summary.n;
+    }
+  }
+  if (config)
+    free_estim_config_struct(config);
+  return 0;
+}
+
 
 /*****************************************************************************
  *
@@ -52,8 +1043,13 @@ static int  numtasks, rank;                   /* MPI number of tasks, rank */
 static void usage(const char *progname)
 {
   fprintf(stderr, "Usage: %s [-h] config_filename\n"
+          "       %s [-x max_extra] -t task_list_filename\n"
           "  -h : write parameter names to stderr and exit\n"
-          , progname);
+          "  -t : run the (configuration, runs) tasks listed in the file,\n"
+          "       handing each run to the next free rank\n"
+          "  -x : start up to max_extra extra runs of each configuration\n"
+          "       on free ranks once the task list is exhausted\n"
+          , progname, progname);
   exit(1);
 }
 
@@ -63,6 +1059,15 @@ int main(int argc, char *argv[])
   char            *config_filename = NULL;
   estim_config_t  *config;
   int              rc;
+  chain_summary_t  summary;
+  char            *task_list_filename = NULL;
+  task_config_t   *tasks;
+  uint_t           num_configs, k;
+  long             max_extra = 0;
+  char            *endptr;
+  partition_comm_t partition_comm;
+  series_container_t container;
+  series_sink_t   *theta_sink = NULL, *dzA_sink = NULL;
 
   rc = MPI_Init(&argc,&argv);
   if (rc != MPI_SUCCESS) {
@@ -73,29 +1078,66 @@ int main(int argc, char *argv[])
   MPI_Comm_size(MPI_COMM_WORLD,&numtasks);
   MPI_Comm_rank(MPI_COMM_WORLD,&rank);
   MPI_Get_processor_name(myname, &mynamelen);
+  assert(sizeof(uint_t) == sizeof(unsigned int)); /* sent as MPI_UNSIGNED */
+  partition_comm.rank = (uint_t)rank;
+  partition_comm.num_ranks = (uint_t)numtasks;
+  partition_comm.alltoallv = partition_alltoallv;
+  partition_comm.start_allgatherv = partition_start_allgatherv;
+  partition_comm.finish_allgatherv = partition_finish_allgatherv;
+  partition_comm.allreduce_sum = partition_allreduce_sum_mpi;
+  partition_comm.data = NULL;
 
   init_prng(rank); /* initialize pseudorandom number generator */
-  init_powtable(1-1/lambda); /* intialize pow(1-1/lambda, y) lookup table */
-
   init_estim_config_parser();
 
-  while ((c = getopt(argc, argv, "h")) != -1)  {
+  while ((c = getopt(argc, argv, "ht:x:")) != -1)  {
     switch (c)   {
       case 'h':
         dump_config_names(&ESTIM_CONFIG, (const config_param_t *)&ESTIM_CONFIG_PARAMS, NUM_ESTIM_CONFIG_PARAMS);
         dump_parameter_names();
         exit(0);
         break;
+      case 't':
+        task_list_filename = optarg;
+        break;
+      case 'x':
+        max_extra = strtol(optarg, &endptr, 10);
+        if (*endptr != '\0' || max_extra < 0) {
+          fprintf(stderr, "maximum extra runs must be a nonnegative "
+                  "integer\n");
+          exit(1);
+        }
+        break;
       default:
         usage(argv[0]);
         break;
     }
   }
 
-  if (argc - optind != 1)
+  if (argc - optind != (task_list_filename ? 0 : 1))
     usage(argv[0]);
 
   printf("MPI name %s rank %d of total %d\n",myname,rank,numtasks);
+
+  if (task_list_filename) {
+    if (numtasks < 2) {
+      fprintf(stderr, "ERROR: a task list needs at least two MPI tasks "
+              "(the master only schedules)\n");
+      rc = 1;
+    } else if (!(tasks = read_task_list(task_list_filename, &num_configs))) {
+      rc = 1;
+    } else {
+      if (rank == MPI_RANK_MASTER)
+        rc = run_task_master(tasks, num_configs, (uint_t)max_extra);
+      else
+        rc = run_task_worker(tasks);
+      for (k = 0; k < num_configs; k++)
+        free(tasks[k].config_filename);
+      free(tasks);
+    }
+    MPI_Finalize();
+    exit(rc);
+  }
   
   config_filename = argv[optind];
   if (!(config = parse_estim_config_file(config_filename))) {
@@ -104,9 +1146,58 @@ int main(int argc, char *argv[])
     }
     rc = 1;
   } else {
-    rc = do_estimation(config, rank);
+    if (config->sharedAttributes &&
+        (node_order_from_name(config->nodeOrder) == NODE_ORDER_DEGREE ||
+         node_order_from_name(config->nodeOrder) == NODE_ORDER_RCM ||
+         node_order_from_name(config->nodeOrder) == NODE_ORDER_ZONE)) {
+      if (rank == MPI_RANK_MASTER)
+        fprintf(stderr, "ERROR: nodeOrder cannot be used with "
+                "sharedAttributes\n");
+      rc = 1;
+    } else if (config->series_container_filename &&
+               open_series_container(config, &container, &theta_sink,
+                                     &dzA_sink)) {
+      rc = 1;
+    } else if (config->partitionGraph) {
+      /* one chain for all the tasks, so the summary is that of task 0 */
+      memset(&summary, 0, sizeof(summary));
+      rc = do_estimation(config, rank, config->sharedAttributes ?
+                         load_attributes_shared : load_attributes, NULL,
+                         NULL, config->summary_filename ? &summary : NULL,
+                         NULL, NULL, theta_sink, dzA_sink, &partition_comm);
+      if (config->summary_filename) {
+        if (rc == 0 && rank == MPI_RANK_MASTER &&
+            write_estimation_summary(config->summary_filename, &summary, 1,
+                                     config->outputFileSuffixBase,
+                                     summary.param_names))
+          rc = 1;
+        free_chain_summary(&summary);
+      }
+    } else {
+      memset(&summary, 0, sizeof(summary));
+      rc = do_estimation(config, rank, config->sharedAttributes ?
+                         load_attributes_shared : load_attributes, NULL,
+                         collective_stop,
+                         config->summary_filename ? &summary : NULL,
+                         NULL, NULL, theta_sink, dzA_sink, &partition_comm);
+      if (config->EEcollectiveInterval > 0)
+        finish_collective_stop();
+      if (config->summary_filename) {
+        if (gather_summaries(config->summary_filename,
+                             config->outputFileSuffixBase, &summary))
+          rc = 1;
+        free_chain_summary(&summary);
+      }
+    }
   }
+  if (theta_sink && close_series_container(&container,
+                                            config->outputFileSuffixBase))
+    rc = 1;
   free_estim_config_struct(config);
+  if (attr_win != MPI_WIN_NULL)
+    MPI_Win_free(&attr_win);
+  if (node_comm != MPI_COMM_NULL)
+    MPI_Comm_free(&node_comm);
   MPI_Finalize();
   exit(rc);
 }
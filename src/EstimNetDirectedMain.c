@@ -4,8 +4,36 @@
  * Author:  Alex Stivala, Maksym Byshkin
  * Created: October 2017
  *
+ * With numChains greater than 1, that many chains (estimation tasks,
+ * numbered and with output files as for the MPI tasks of
+ * EstimNetDirected_mpi) are run in parallel, each in its own process
+ * forked from this one. The node attributes are loaded only once,
+ * before forking, and the chains share them (copy-on-write pages that
+ * are never written). The processes are used rather than threads as
+ * each estimation task has its own configuration and global state
+ * (built from the shared configuration while setting up the task),
+ * just as the MPI tasks do.
  *
- *   Usage: EstimNetDirected config_filename
+ * With several configuration files (models differing only in their
+ * parameters, and output files, for the same network), the network is
+ * loaded only once and each model is estimated in its own process forked
+ * from this one (so each starts from the loaded network, sharing its
+ * pages until it changes them). The -j option sets how many models are
+ * estimated at once (default one at a time).
+ *
+ * With --preflight (-p) nothing is estimated: the network of the
+ * configuration is loaded and the memory and time the estimation would
+ * take are estimated and written, with the recommended two-path backend
+ * and number of threads (see do_preflight()).
+ *
+ * With --serve (-s) job_dir it runs as a server: the networks of the
+ * configuration files are loaded once and kept loaded, and each job
+ * (an estimation configuration file put in job_dir) is estimated in its
+ * own process forked from this one, as for several configuration files,
+ * so it starts without loading its network again (see serve_jobs()).
+ *
+ *   Usage: EstimNetDirected [-p] [-j num_parallel] [-s job_dir]
+ *                           config_filename [config_filename ...]
  *
  ****************************************************************************/
 
@@ -15,10 +43,961 @@
 #include <errno.h>
 #include <getopt.h>
 #include <unistd.h>
+#include <string.h>
+#include <dirent.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/mman.h>
 #include "utils.h"
 #include "estimconfigparser.h"
 #include "equilibriumExpectation.h"
 #include "changeStatisticsDirected.h"
+#include "loadDigraph.h"
+
+/*****************************************************************************
+ *
+ * Constants
+ *
+ ****************************************************************************/
+
+/* space for the parameter names of each chain for the summary */
+#define SUMMARY_NAMES_MAX 65536
+
+/* server mode (--serve): job files are named name.job in the job
+   directory, renamed to name.running while the job runs then to
+   name.done or name.failed, with its output in name.log; a file named
+   stop in the job directory stops the server */
+#define SERVE_JOB_SUFFIX     ".job"
+#define SERVE_RUNNING_SUFFIX ".running"
+#define SERVE_DONE_SUFFIX    ".done"
+#define SERVE_FAILED_SUFFIX  ".failed"
+#define SERVE_LOG_SUFFIX     ".log"
+#define SERVE_STOP_FILE      "stop"
+#define SERVE_POLL_SECONDS   1 /* interval between job directory scans */
+
+/*****************************************************************************
+ *
+ * Types
+ *
+ ****************************************************************************/
+
+/* the configuration settings that determine the loaded network */
+typedef struct network_settings_s {
+  char            *arclist_filename;
+  arclist_format_e arclist_format;
+  char            *binattr_filename;
+  char            *catattr_filename;
+  char            *contattr_filename;
+  char            *setattr_filename;
+  char            *dyadcov_filename;
+  char            *zone_filename;
+  char            *snapshot_filename;
+  char            *network_list_filename;
+  node_order_e     node_order;
+  uint_t           maxMemoryMB;
+  uint_t           hubDegreeThreshold;
+  bool             useArcBitMatrix;
+} network_settings_t;
+
+/* a network loaded by the server, kept for all the jobs for it */
+typedef struct warm_network_s {
+  network_settings_t settings; /* the settings it was loaded with */
+  digraph_t         *g;        /* the loaded network */
+} warm_network_t;
+
+/* a job being run by the server */
+typedef struct server_job_s {
+  pid_t  pid;  /* process running it */
+  char  *name; /* job file name without SERVE_JOB_SUFFIX */
+} server_job_t;
+
+/*****************************************************************************
+ *
+ * File static variables
+ *
+ ****************************************************************************/
+
+static void *attr_block = NULL; /* node attributes loaded before forking */
+
+/* set by SIGTERM or SIGINT in server mode */
+static volatile sig_atomic_t stop_requested = 0;
+
+/*****************************************************************************
+ *
+ * Local functions
+ *
+ ****************************************************************************/
+
+/*
+ * Set the node attributes of g to those loaded before forking the
+ * chains (the filenames are not used). Same parameters and return value
+ * as load_attributes().
+ */
+static int load_attributes_preloaded(digraph_t *g,
+                                     const char *binattr_filename,
+                                     const char *catattr_filename,
+                                     const char *contattr_filename,
+                                     const char *setattr_filename,
+                                     const char *dyadcov_filename)
+{
+  (void)binattr_filename;
+  (void)catattr_filename;
+  (void)contattr_filename;
+  (void)setattr_filename;
+  (void)dyadcov_filename;
+  attach_digraph_attributes(g, attr_block);
+  return 0;
+}
+
+/*
+ * Set the attribute columns of g to load to those the model refers to
+ * (see set_attribute_columns()), unless a snapshot is to be written,
+ * as allocate_estimation_digraph() does for each chain.
+ *
+ * Parameters:
+ *   g      - (in/out) digraph with no attributes loaded yet
+ *   config - configuration settings
+ *
+ * Return value:
+ *   None.
+ */
+static void set_model_attribute_columns(digraph_t *g,
+                                        const estim_config_t *config)
+{
+  const char **columns;
+  uint_t       num_columns;
+
+  if (config->write_snapshot_filename)
+    return;
+  num_columns = get_model_attribute_names(&config->param_config, &columns);
+  set_attribute_columns(g, num_columns, columns);
+  free(columns);
+}
+
+/*
+ * Load the node attributes into attr_block, to be shared by the chains.
+ *
+ * Parameters:
+ *   config - configuration settings
+ *
+ * Return value:
+ *   0 if OK else nonzero on error (message printed to stderr).
+ */
+static int preload_attributes(const estim_config_t *config)
+{
+  arclist_format_e format = arclist_format_from_name(config->arclistFormat);
+  pooled_attr_files_t attr_files;
+  digraph_t *g;
+  int        rc;
+
+  if (format == ARCLIST_FORMAT_INVALID) {
+    fprintf(stderr, "ERROR: unknown arclistFormat %s (must be pajek or "
+            "edgelist)\n", config->arclistFormat);
+    return -1;
+  }
+  if (config->network_list_filename) {
+    if (!(g = allocate_pooled_digraph(config->network_list_filename, FALSE,
+                                      &attr_files)))
+      return -1;
+    set_twopath_build_threads(g, config->numThreadsLoad);
+    set_model_attribute_columns(g, config);
+    rc = load_attributes(g, attr_files.binattr_filename,
+                         attr_files.catattr_filename,
+                         attr_files.contattr_filename,
+                         attr_files.setattr_filename, NULL);
+    remove_pooled_attr_files(&attr_files);
+  } else {
+    if (!(g = allocate_digraph_from_arclist_file(config->arclist_filename,
+                                                 format, FALSE)))
+      return -1;
+    set_twopath_build_threads(g, config->numThreadsLoad);
+    set_model_attribute_columns(g, config);
+    rc = load_attributes(g, config->binattr_filename,
+                         config->catattr_filename,
+                         config->contattr_filename,
+                         config->setattr_filename,
+                         config->dyadcov_filename);
+  }
+  if (rc) {
+    fprintf(stderr, "ERROR: loading node attributes failed\n");
+    free_digraph(g);
+    return -1;
+  }
+  attr_block = safe_malloc(digraph_attributes_block_size(g));
+  move_digraph_attributes(g, attr_block);
+  free_digraph(g);
+  return 0;
+}
+
+/*
+ * Run config->numChains estimation tasks in parallel, each in its own
+ * process, and write the summary of all of them if summaryFile is set.
+ *
+ * Parameters:
+ *   config - configuration settings
+ *
+ * Return value:
+ *   0 if OK else nonzero if any chain failed.
+ */
+static int run_chains(estim_config_t *config)
+{
+  uint_t           num_chains = config->numChains, chain, n = 0;
+  pid_t           *pids;
+  int              status, rc = 0;
+  /* maximum number of parameters (build_dyadic_indices_from_names()
+     can reduce it) */
+  uint_t           max_param = config->param_config.num_change_stats_funcs +
+    config->param_config.num_attr_change_stats_funcs +
+    config->param_config.num_dyadic_change_stats_funcs +
+    config->param_config.num_attr_interaction_change_stats_funcs;
+  size_t           slot_len = 1 + CHAIN_SUMMARY_LEN(max_param);
+  size_t           shared_size = 0;
+  double          *slots = NULL; /* each chain: n then packed summary */
+  char            *names = NULL; /* each chain: parameter names */
+  chain_summary_t  summary, *summaries;
+  const char      *param_names = NULL;
+
+  if (node_order_from_name(config->nodeOrder) == NODE_ORDER_DEGREE ||
+      node_order_from_name(config->nodeOrder) == NODE_ORDER_RCM ||
+      node_order_from_name(config->nodeOrder) == NODE_ORDER_ZONE) {
+    fprintf(stderr, "ERROR: nodeOrder cannot be used with numChains\n");
+    return -1;
+  }
+  /* with a snapshot each chain maps the same file, so its attributes
+     are shared already */
+  if (!config->snapshot_filename && preload_attributes(config))
+    return -1;
+  if (config->summary_filename) {
+    /* summaries are written by the chains into shared memory */
+    shared_size = num_chains * (slot_len * sizeof(double) + SUMMARY_NAMES_MAX);
+    slots = (double *)mmap(NULL, shared_size, PROT_READ | PROT_WRITE,
+                           MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (slots == MAP_FAILED) {
+      fprintf(stderr, "ERROR: could not map shared memory for summaries "
+              "(%s)\n", strerror(errno));
+      return -1;
+    }
+    names = (char *)(slots + num_chains * slot_len);
+  }
+
+  pids = (pid_t *)safe_malloc(num_chains * sizeof(pid_t));
+  fflush(stdout);
+  fflush(stderr);
+  for (chain = 0; chain < num_chains; chain++) {
+    if ((pids[chain] = fork()) < 0) {
+      fprintf(stderr, "ERROR: could not fork chain %u (%s)\n", chain,
+              strerror(errno));
+      rc = -1;
+      break;
+    }
+    if (pids[chain] == 0) {
+      init_prng(chain); /* independent streams, as for MPI rank */
+      memset(&summary, 0, sizeof(summary));
+      rc = do_estimation(config, chain, load_attributes_preloaded, NULL, NULL,
+                         slots ? &summary : NULL, NULL, NULL, NULL, NULL,
+                         NULL);
+      if (slots && rc == 0) {
+        slots[chain * slot_len] = summary.n;
+        pack_chain_summary(&summary, slots + chain * slot_len + 1);
+        strncpy(names + (size_t)chain * SUMMARY_NAMES_MAX,
+                summary.param_names, SUMMARY_NAMES_MAX - 1);
+      }
+      free_chain_summary(&summary);
+      exit(rc ? 1 : 0);
+    }
+  }
+  num_chains = chain; /* only wait for those started */
+  for (chain = 0; chain < num_chains; chain++) {
+    if (waitpid(pids[chain], &status, 0) < 0 || !WIFEXITED(status) ||
+        WEXITSTATUS(status) != 0) {
+      fprintf(stderr, "ERROR: chain %u failed\n", chain);
+      rc = -1;
+    }
+  }
+  free(pids);
+
+  if (slots) {
+    /* failed chains have no summary, so get the number of parameters
+       and their names from the first that has one */
+    for (chain = 0; chain < num_chains && n == 0; chain++) {
+      n = (uint_t)slots[chain * slot_len];
+      param_names = names + (size_t)chain * SUMMARY_NAMES_MAX;
+    }
+  }
+  if (n > 0) {
+    summaries = (chain_summary_t *)safe_malloc(num_chains *
+                                               sizeof(chain_summary_t));
+    for (chain = 0; chain < num_chains; chain++) {
+      init_chain_summary(&summaries[chain], n); /* not valid if it failed */
+      if (slots[chain * slot_len] > 0)
+        unpack_chain_summary(slots + chain * slot_len + 1, &summaries[chain]);
+    }
+    if (write_estimation_summary(config->summary_filename, summaries,
+                                 num_chains, config->outputFileSuffixBase,
+                                 param_names))
+      rc = -1;
+    for (chain = 0; chain < num_chains; chain++)
+      free_chain_summary(&summaries[chain]);
+    free(summaries);
+  }
+  if (slots)
+    munmap(slots, shared_size);
+  free(attr_block);
+  return rc;
+}
+
+/*
+ * Copy a string that may be NULL (for an unset configuration setting).
+ */
+static char *strdup_or_null(const char *s)
+{
+  return s ? safe_strdup(s) : NULL;
+}
+
+/*
+ * Compare strings that may be NULL (for unset configuration settings).
+ */
+static bool same_string(const char *s1, const char *s2)
+{
+  return s1 == s2 || (s1 && s2 && strcmp(s1, s2) == 0);
+}
+
+/*
+ * Copy the settings of a configuration that determine the loaded
+ * network (see load_estimation_digraph()), so they can be compared with
+ * those of other configurations after it is freed.
+ *
+ * Parameters:
+ *   config   - configuration settings
+ *   settings - (Out) the network settings, to be freed with
+ *              free_network_settings()
+ *
+ * Return value:
+ *   None.
+ */
+static void get_network_settings(const estim_config_t *config,
+                                 network_settings_t *settings)
+{
+  settings->arclist_filename = strdup_or_null(config->arclist_filename);
+  settings->arclist_format = arclist_format_from_name(config->arclistFormat);
+  settings->binattr_filename = strdup_or_null(config->binattr_filename);
+  settings->catattr_filename = strdup_or_null(config->catattr_filename);
+  settings->contattr_filename = strdup_or_null(config->contattr_filename);
+  settings->setattr_filename = strdup_or_null(config->setattr_filename);
+  settings->dyadcov_filename = strdup_or_null(config->dyadcov_filename);
+  settings->zone_filename = strdup_or_null(config->zone_filename);
+  settings->snapshot_filename = strdup_or_null(config->snapshot_filename);
+  settings->network_list_filename =
+    strdup_or_null(config->network_list_filename);
+  settings->node_order = node_order_from_name(config->nodeOrder);
+  settings->maxMemoryMB = config->maxMemoryMB;
+  settings->hubDegreeThreshold = config->hubDegreeThreshold;
+  settings->useArcBitMatrix = config->useArcBitMatrix;
+}
+
+/*
+ * Check that two sets of network settings are the same, so one loaded
+ * digraph can be used for both.
+ */
+static bool same_network(const network_settings_t *settings1,
+                         const network_settings_t *settings2)
+{
+  return same_string(settings1->arclist_filename,
+                     settings2->arclist_filename) &&
+    settings1->arclist_format == settings2->arclist_format &&
+    same_string(settings1->binattr_filename, settings2->binattr_filename) &&
+    same_string(settings1->catattr_filename, settings2->catattr_filename) &&
+    same_string(settings1->contattr_filename, settings2->contattr_filename) &&
+    same_string(settings1->setattr_filename, settings2->setattr_filename) &&
+    same_string(settings1->dyadcov_filename, settings2->dyadcov_filename) &&
+    same_string(settings1->zone_filename, settings2->zone_filename) &&
+    same_string(settings1->snapshot_filename,
+                settings2->snapshot_filename) &&
+    same_string(settings1->network_list_filename,
+                settings2->network_list_filename) &&
+    settings1->node_order == settings2->node_order &&
+    settings1->maxMemoryMB == settings2->maxMemoryMB &&
+    settings1->hubDegreeThreshold == settings2->hubDegreeThreshold &&
+    settings1->useArcBitMatrix == settings2->useArcBitMatrix;
+}
+
+/*
+ * Free the strings in network settings from get_network_settings().
+ */
+static void free_network_settings(network_settings_t *settings)
+{
+  free(settings->arclist_filename);
+  free(settings->binattr_filename);
+  free(settings->catattr_filename);
+  free(settings->contattr_filename);
+  free(settings->setattr_filename);
+  free(settings->dyadcov_filename);
+  free(settings->zone_filename);
+  free(settings->snapshot_filename);
+  free(settings->network_list_filename);
+}
+
+/*
+ * Parse a configuration file, after freeing the previous configuration
+ * (if any) as the parser has only one.
+ *
+ * Parameters:
+ *   config          - previous configuration, or NULL for none
+ *   config_filename - configuration file to parse
+ *
+ * Return value:
+ *   Configuration settings, or NULL on error (message printed to stderr).
+ */
+static estim_config_t *reparse_estim_config_file(estim_config_t *config,
+                                                 const char *config_filename)
+{
+  if (config) {
+    free_estim_config_struct(config);
+    init_estim_config_parser();
+  }
+  if (!(config = parse_estim_config_file(config_filename)))
+    fprintf(stderr, "ERROR parsing configuration file %s\n",
+            config_filename);
+  return config;
+}
+
+/*
+ * Estimate a model in a forked process, using the loaded network,
+ * and write its summary if summaryFile is set. Does not return.
+ *
+ * With a seed the streams are those of the model run on its own. Without
+ * one the seed is the time, which is the same for jobs started in the
+ * same second, so the process id (different for every process running
+ * at once) is used as the task number to give each its own streams.
+ *
+ * Parameters:
+ *   config - configuration settings of the model
+ *   g      - the loaded network (the process's own copy)
+ */
+static void run_model(estim_config_t *config, digraph_t *g)
+{
+  chain_summary_t summary;
+  int             rc;
+
+  init_prng(config->seed ? 0 : (int)getpid());
+  memset(&summary, 0, sizeof(summary));
+  rc = do_estimation(config, 0, NULL, g, NULL,
+                     config->summary_filename ? &summary : NULL,
+                     NULL, NULL, NULL, NULL, NULL);
+  if (rc == 0 && config->summary_filename &&
+      write_estimation_summary(config->summary_filename, &summary, 1,
+                               config->outputFileSuffixBase,
+                               summary.param_names))
+    rc = -1;
+  free_chain_summary(&summary);
+  exit(rc ? 1 : 0);
+}
+
+/*
+ * Check that the configuration files are all for the same network and
+ * have different output files, before anything is estimated.
+ *
+ * Parameters:
+ *   num_configs      - number of configuration files
+ *   config_filenames - the configuration files, one for each model
+ *
+ * Return value:
+ *   0 if OK else nonzero on error (message printed to stderr).
+ */
+static int check_models(uint_t num_configs, char *config_filenames[])
+{
+  estim_config_t     *config = NULL;
+  network_settings_t  first, settings;
+  char              **theta_prefixes;
+  uint_t             *suffix_bases;
+  uint_t              m, k;
+  int                 rc = 0;
+
+  theta_prefixes = (char **)safe_calloc(num_configs, sizeof(char *));
+  suffix_bases = (uint_t *)safe_calloc(num_configs, sizeof(uint_t));
+  for (m = 0; m < num_configs && rc == 0; m++) {
+    if (!(config = reparse_estim_config_file(config, config_filenames[m]))) {
+      rc = -1;
+      break;
+    }
+    if (config->numChains != 1) {
+      fprintf(stderr, "ERROR: numChains cannot be used with several "
+              "configuration files (%s)\n", config_filenames[m]);
+      rc = -1;
+    }
+    get_network_settings(config, m == 0 ? &first : &settings);
+    if (m > 0) {
+      if (!same_network(&first, &settings)) {
+        fprintf(stderr, "ERROR: configuration files %s and %s are not for "
+                "the same network (arc list, attribute and zone files, "
+                "nodeOrder, maxMemoryMB, hubDegreeThreshold and "
+                "useArcBitMatrix must be the same)\n",
+                config_filenames[0], config_filenames[m]);
+        rc = -1;
+      }
+      free_network_settings(&settings);
+    }
+    theta_prefixes[m] = strdup_or_null(config->theta_file_prefix);
+    suffix_bases[m] = config->outputFileSuffixBase;
+    for (k = 0; k < m; k++) {
+      if (same_string(theta_prefixes[k], theta_prefixes[m]) &&
+          suffix_bases[k] == suffix_bases[m]) {
+        fprintf(stderr, "ERROR: configuration files %s and %s have the "
+                "same output files\n", config_filenames[k],
+                config_filenames[m]);
+        rc = -1;
+      }
+    }
+  }
+  if (m > 0)
+    free_network_settings(&first);
+  if (config) {
+    free_estim_config_struct(config);
+    init_estim_config_parser();
+  }
+  for (k = 0; k < num_configs; k++)
+    free(theta_prefixes[k]);
+  free(theta_prefixes);
+  free(suffix_bases);
+  return rc;
+}
+
+/*
+ * Estimate several models for the same network, loading it only once,
+ * with up to num_parallel of them at once, each in its own process.
+ *
+ * Parameters:
+ *   num_configs      - number of configuration files
+ *   config_filenames - the configuration files, one for each model
+ *   num_parallel     - maximum number of models estimated at once
+ *
+ * Return value:
+ *   0 if OK else nonzero if any model failed.
+ */
+static int run_models(uint_t num_configs, char *config_filenames[],
+                      uint_t num_parallel)
+{
+  estim_config_t *config = NULL;
+  digraph_t      *g = NULL;
+  pid_t          *pids;
+  pid_t           pid;
+  uint_t          m, started = 0, running = 0;
+  int             status, rc = 0;
+
+  if (check_models(num_configs, config_filenames))
+    return -1;
+
+  pids = (pid_t *)safe_calloc(num_configs, sizeof(pid_t));
+  /* after an error, no more are started but those running finish */
+  while (running > 0 || (rc == 0 && started < num_configs)) {
+    if (rc == 0 && started < num_configs && running < num_parallel) {
+      if (!(config = reparse_estim_config_file(config,
+                                               config_filenames[started]))) {
+        rc = -1;
+        continue;
+      }
+      if (!g && !(g = load_estimation_digraph(config, FALSE))) {
+        rc = -1;
+        continue;
+      }
+      printf("estimating model %u of %u (%s)\n", started + 1, num_configs,
+             config_filenames[started]);
+      fflush(stdout);
+      fflush(stderr);
+      if ((pids[started] = fork()) < 0) {
+        fprintf(stderr, "ERROR: could not fork for %s (%s)\n",
+                config_filenames[started], strerror(errno));
+        rc = -1;
+        continue;
+      }
+      if (pids[started] == 0)
+        run_model(config, g);
+      started++;
+      running++;
+      continue;
+    }
+    if ((pid = wait(&status)) < 0)
+      break;
+    running--;
+    for (m = 0; m < started && pids[m] != pid; m++)
+      /*nothing*/;
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+      fprintf(stderr, "ERROR: estimation for %s failed\n",
+              config_filenames[m]);
+      rc = -1;
+    }
+  }
+  free(pids);
+  if (g)
+    free_digraph(g);
+  free_estim_config_struct(config);
+  return rc;
+}
+
+/*
+ * Signal handler for SIGTERM and SIGINT in server mode: the server
+ * stops starting jobs and exits when those running have finished.
+ */
+static void serve_stop_handler(int sig)
+{
+  (void)sig;
+  stop_requested = 1;
+}
+
+/*
+ * Path of a file of a job in the job directory.
+ *
+ * Parameters:
+ *   job_dir - job directory
+ *   name    - job name
+ *   suffix  - suffix of the file (e.g. SERVE_LOG_SUFFIX), or "" for
+ *             none
+ *
+ * Return value:
+ *   Path of the file, to be freed by caller.
+ */
+static char *job_file_path(const char *job_dir, const char *name,
+                           const char *suffix)
+{
+  size_t len = strlen(job_dir) + 1 + strlen(name) + strlen(suffix) + 1;
+  char  *path = (char *)safe_malloc(len);
+
+  snprintf(path, len, "%s/%s%s", job_dir, name, suffix);
+  return path;
+}
+
+/*
+ * Rename a job file from one state (suffix) to another.
+ *
+ * Parameters:
+ *   job_dir     - job directory
+ *   name        - job name
+ *   from_suffix - suffix of the job file now
+ *   to_suffix   - suffix to rename it to
+ *
+ * Return value:
+ *   0 if OK else -1 (errno set).
+ */
+static int rename_job_file(const char *job_dir, const char *name,
+                           const char *from_suffix, const char *to_suffix)
+{
+  char *from_path = job_file_path(job_dir, name, from_suffix);
+  char *to_path = job_file_path(job_dir, name, to_suffix);
+  int   rc = rename(from_path, to_path);
+
+  free(from_path);
+  free(to_path);
+  return rc;
+}
+
+/*
+ * Directory entry filter for scandir(): job files waiting to be run.
+ */
+static int is_job_file(const struct dirent *entry)
+{
+  size_t len = strlen(entry->d_name);
+  size_t suffix_len = strlen(SERVE_JOB_SUFFIX);
+
+  return len > suffix_len && entry->d_name[0] != '.' &&
+    strcmp(entry->d_name + len - suffix_len, SERVE_JOB_SUFFIX) == 0;
+}
+
+/*
+ * Claim the next job waiting in the job directory (the first in name
+ * order), by renaming its job file from name.job to name.running, so
+ * that it is not started again (nor by another server sharing the
+ * directory).
+ *
+ * Parameters:
+ *   job_dir - job directory
+ *
+ * Return value:
+ *   Name of the job claimed, to be freed by caller, or NULL if there
+ *   is none.
+ */
+static char *claim_next_job(const char *job_dir)
+{
+  struct dirent **entries;
+  char           *name = NULL;
+  int             num_entries, k;
+
+  if ((num_entries = scandir(job_dir, &entries, is_job_file,
+                             alphasort)) < 0) {
+    fprintf(stderr, "ERROR: could not read job directory %s (%s)\n",
+            job_dir, strerror(errno));
+    return NULL;
+  }
+  for (k = 0; k < num_entries; k++) {
+    if (!name) {
+      name = safe_strdup(entries[k]->d_name);
+      name[strlen(name) - strlen(SERVE_JOB_SUFFIX)] = '\0';
+      if (rename_job_file(job_dir, name, SERVE_JOB_SUFFIX,
+                          SERVE_RUNNING_SUFFIX)) {
+        /* ENOENT: claimed by another server */
+        if (errno != ENOENT)
+          fprintf(stderr, "ERROR: could not claim job %s (%s)\n", name,
+                  strerror(errno));
+        free(name);
+        name = NULL;
+      }
+    }
+    free(entries[k]);
+  }
+  free(entries);
+  return name;
+}
+
+/*
+ * Find the loaded network for a configuration, or load it (with all
+ * the attribute columns, for later jobs whose models refer to other
+ * attributes) and keep it if there is none yet.
+ *
+ * Parameters:
+ *   config      - configuration settings
+ *   warm        - (in/out) the loaded networks, reallocated when one is
+ *                 added
+ *   num_warm    - (in/out) number of loaded networks
+ *
+ * Return value:
+ *   The loaded network, or NULL on error (message printed to stderr).
+ */
+static digraph_t *get_warm_network(const estim_config_t *config,
+                                   warm_network_t **warm, uint_t *num_warm)
+{
+  network_settings_t settings;
+  digraph_t         *g;
+  uint_t             k;
+
+  get_network_settings(config, &settings);
+  for (k = 0; k < *num_warm; k++) {
+    if (same_network(&(*warm)[k].settings, &settings)) {
+      free_network_settings(&settings);
+      return (*warm)[k].g;
+    }
+  }
+  printf("loading network %s\n", settings.arclist_filename ?
+         settings.arclist_filename : settings.snapshot_filename ?
+         settings.snapshot_filename : settings.network_list_filename ?
+         settings.network_list_filename : "(none)");
+  fflush(stdout);
+  if (!(g = load_estimation_digraph(config, TRUE))) {
+    free_network_settings(&settings);
+    return NULL;
+  }
+  *warm = (warm_network_t *)safe_realloc(*warm, (*num_warm + 1) *
+                                         sizeof(warm_network_t));
+  (*warm)[*num_warm].settings = settings;
+  (*warm)[*num_warm].g = g;
+  (*num_warm)++;
+  printf("network loaded (%u nodes, %lu arcs), %u network%s loaded\n",
+         g->num_nodes, (unsigned long)g->num_arcs, *num_warm,
+         *num_warm == 1 ? "" : "s");
+  fflush(stdout);
+  return g;
+}
+
+/*
+ * Start a job claimed from the job directory: parse its configuration
+ * (the job file), get the loaded network for it, and estimate the model
+ * in a forked process writing its output to the job's log file.
+ *
+ * Parameters:
+ *   job_dir  - job directory
+ *   name     - job name (the job file is name.running)
+ *   config   - (in/out) the previous configuration, or NULL, replaced
+ *              by that of the job (as the parser has only one)
+ *   warm     - (in/out) the loaded networks (see get_warm_network())
+ *   num_warm - (in/out) number of loaded networks
+ *
+ * Return value:
+ *   Process running the job, or -1 if it could not be started (message
+ *   printed to stderr).
+ */
+static pid_t start_job(const char *job_dir, const char *name,
+                       estim_config_t **config, warm_network_t **warm,
+                       uint_t *num_warm)
+{
+  char      *job_path = job_file_path(job_dir, name, SERVE_RUNNING_SUFFIX);
+  char      *log_path = job_file_path(job_dir, name, SERVE_LOG_SUFFIX);
+  digraph_t *g = NULL;
+  pid_t      pid = -1;
+
+  if (!(*config = reparse_estim_config_file(*config, job_path))) {
+    /* nothing */
+  } else if ((*config)->numChains != 1) {
+    fprintf(stderr, "ERROR: numChains cannot be used in a job (%s)\n",
+            job_path);
+  } else if (!(*config)->arclist_filename && !(*config)->snapshot_filename &&
+             !(*config)->network_list_filename) {
+    fprintf(stderr, "ERROR: no arclistFile, snapshotFile or "
+            "networkListFile in job (%s)\n", job_path);
+  } else if ((g = get_warm_network(*config, warm, num_warm))) {
+    printf("starting job %s\n", name);
+    fflush(stdout);
+    fflush(stderr);
+    if ((pid = fork()) < 0) {
+      fprintf(stderr, "ERROR: could not fork for job %s (%s)\n", name,
+              strerror(errno));
+    } else if (pid == 0) {
+      signal(SIGTERM, SIG_DFL);
+      signal(SIGINT, SIG_DFL);
+      if (!freopen(log_path, "w", stdout) ||
+          dup2(fileno(stdout), fileno(stderr)) < 0) {
+        fprintf(stderr, "ERROR: could not open log file %s (%s)\n",
+                log_path, strerror(errno));
+        exit(1);
+      }
+      setvbuf(stdout, NULL, _IOLBF, 0); /* so the log can be followed */
+      run_model(*config, g);
+    }
+  }
+  free(job_path);
+  free(log_path);
+  return pid;
+}
+
+/*
+ * Mark a job as finished, by renaming its job file from name.running
+ * to name.done or name.failed.
+ *
+ * Parameters:
+ *   job_dir - job directory
+ *   name    - job name
+ *   ok      - True if the job succeeded
+ *
+ * Return value:
+ *   None.
+ */
+static void finish_job(const char *job_dir, const char *name, bool ok)
+{
+  printf("job %s %s\n", name, ok ? "done" : "failed");
+  fflush(stdout);
+  if (rename_job_file(job_dir, name, SERVE_RUNNING_SUFFIX,
+                      ok ? SERVE_DONE_SUFFIX : SERVE_FAILED_SUFFIX))
+    fprintf(stderr, "ERROR: could not rename job file of %s (%s)\n", name,
+            strerror(errno));
+}
+
+/*
+ * Check for a stop file in the job directory, and remove it (so it does
+ * not stop the next server started).
+ *
+ * Parameters:
+ *   job_dir - job directory
+ *
+ * Return value:
+ *   True if there was a stop file.
+ */
+static bool stop_file_found(const char *job_dir)
+{
+  char *stop_path = job_file_path(job_dir, SERVE_STOP_FILE, "");
+  bool  found = remove(stop_path) == 0;
+
+  free(stop_path);
+  return found;
+}
+
+/*
+ * Run as a server: load the networks of the configuration files once
+ * and keep them loaded, then run the jobs put in the job directory
+ * (estimation configuration files named name.job) against them until
+ * stopped, with up to num_parallel jobs at once, each in its own
+ * process forked from this one (so each starts from the loaded network,
+ * sharing its pages until it changes them, without loading it again).
+ * A job for a network that is not loaded yet loads it, and it is kept
+ * for later jobs. The server stops, after the jobs running have
+ * finished, when a file named stop is put in the job directory or on
+ * SIGTERM or SIGINT.
+ *
+ * Parameters:
+ *   num_configs      - number of configuration files
+ *   config_filenames - the configuration files, one for each network
+ *                      to load at the start
+ *   job_dir          - job directory
+ *   num_parallel     - maximum number of jobs run at once
+ *
+ * Return value:
+ *   0 if OK else nonzero if a network could not be loaded at the start
+ *   (failed jobs do not stop the server).
+ */
+static int serve_jobs(uint_t num_configs, char *config_filenames[],
+                      const char *job_dir, uint_t num_parallel)
+{
+  estim_config_t   *config = NULL;
+  warm_network_t   *warm = NULL;
+  uint_t            num_warm = 0, running = 0, m, k;
+  server_job_t     *jobs;
+  struct sigaction  action;
+  bool              stopping = FALSE;
+  pid_t             pid;
+  char             *name;
+  int               status, rc = 0;
+
+  for (m = 0; m < num_configs && rc == 0; m++) {
+    if (!(config = reparse_estim_config_file(config, config_filenames[m])) ||
+        !get_warm_network(config, &warm, &num_warm))
+      rc = -1;
+  }
+
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = serve_stop_handler;
+  sigemptyset(&action.sa_mask);
+  sigaction(SIGTERM, &action, NULL);
+  sigaction(SIGINT, &action, NULL);
+
+  if (rc == 0) {
+    printf("serving jobs in %s with up to %u at once\n", job_dir,
+           num_parallel);
+    fflush(stdout);
+  }
+  jobs = (server_job_t *)safe_calloc(num_parallel, sizeof(server_job_t));
+  while (rc == 0 && (running > 0 || !stopping)) {
+    if (!stopping && (stop_requested || stop_file_found(job_dir))) {
+      printf("stopping after %u running job%s\n", running,
+             running == 1 ? "" : "s");
+      fflush(stdout);
+      stopping = TRUE;
+    }
+    if (!stopping && running < num_parallel &&
+        (name = claim_next_job(job_dir))) {
+      if ((pid = start_job(job_dir, name, &config, &warm, &num_warm)) < 0) {
+        finish_job(job_dir, name, FALSE);
+        free(name);
+      } else {
+        for (k = 0; jobs[k].name; k++)
+          /*nothing*/;
+        jobs[k].pid = pid;
+        jobs[k].name = name;
+        running++;
+      }
+      continue;
+    }
+    if (running > 0 && (pid = waitpid(-1, &status, WNOHANG)) > 0) {
+      for (k = 0; k < num_parallel && jobs[k].pid != pid; k++)
+        /*nothing*/;
+      if (k < num_parallel && jobs[k].name) {
+        finish_job(job_dir, jobs[k].name,
+                   WIFEXITED(status) && WEXITSTATUS(status) == 0);
+        free(jobs[k].name);
+        jobs[k].name = NULL;
+        jobs[k].pid = 0;
+        running--;
+      }
+      continue;
+    }
+    sleep(SERVE_POLL_SECONDS); /* interrupted by a signal */
+  }
+  free(jobs);
+  for (k = 0; k < num_warm; k++) {
+    free_digraph(warm[k].g);
+    free_network_settings(&warm[k].settings);
+  }
+  free(warm);
+  if (config)
+    free_estim_config_struct(config);
+  return rc;
+}
 
 /*****************************************************************************
  *
@@ -28,8 +1007,18 @@
 
 static void usage(const char *progname)
 {
-  fprintf(stderr, "Usage: %s [-h] config_filename\n"
+  fprintf(stderr, "Usage: %s [-h] [-p] [-j num_parallel] [-s job_dir] "
+          "config_filename [config_filename ...]\n"
           "  -h : write parameter names to stderr and exit\n"
+          "  -p, --preflight : estimate the memory and time of the\n"
+          "                    estimation and exit without estimating\n"
+          "  -j num_parallel : with several configuration files, estimate\n"
+          "                    up to num_parallel models at once (or run\n"
+          "                    up to num_parallel jobs at once with -s)\n"
+          "  -s, --serve job_dir : keep the networks of the configuration\n"
+          "                    files loaded and run the jobs (name.job\n"
+          "                    configuration files) put in job_dir until\n"
+          "                    a file named stop is put there\n"
           , progname);
   exit(1);
 }
@@ -40,34 +1029,80 @@ int main(int argc, char *argv[])
   char            *config_filename = NULL;
   estim_config_t  *config;
   int              rc;
+  chain_summary_t  summary;
+  long             num_parallel = 1;
+  char            *endptr;
+  bool             preflight = FALSE;
+  char            *job_dir = NULL;
+  static const struct option long_options[] = {
+    {"preflight", no_argument, NULL, 'p'},
+    {"serve", required_argument, NULL, 's'},
+    {NULL, 0, NULL, 0}
+  };
 
   init_prng(0); /* initialize pseudorandom number generator */
-  init_powtable(1-1/lambda); /* intialize pow(1-1/lambda, y) lookup table */
-
   init_estim_config_parser();
   
-  while ((c = getopt(argc, argv, "h")) != -1)  {
+  while ((c = getopt_long(argc, argv, "hj:ps:", long_options,
+                          NULL)) != -1)  {
     switch (c)   {
       case 'h':
         dump_config_names(&ESTIM_CONFIG, (const config_param_t *)&ESTIM_CONFIG_PARAMS, NUM_ESTIM_CONFIG_PARAMS);
         dump_parameter_names();
         exit(0);
         break;
+      case 'j':
+        num_parallel = strtol(optarg, &endptr, 10);
+        if (*endptr != '\0' || num_parallel < 1) {
+          fprintf(stderr, "number of models at once must be a positive "
+                  "integer\n");
+          exit(1);
+        }
+        break;
+      case 'p':
+        preflight = TRUE;
+        break;
+      case 's':
+        job_dir = optarg;
+        break;
       default:
         usage(argv[0]);
         break;
     }
   }
 
-  if (argc - optind != 1)
+  if (argc - optind < 1)
+    usage(argv[0]);
+  if (preflight && (argc - optind > 1 || job_dir))
     usage(argv[0]);
+  if (job_dir)
+    exit(serve_jobs(argc - optind, argv + optind, job_dir,
+                    num_parallel) ? 1 : 0);
+  if (argc - optind > 1)
+    exit(run_models(argc - optind, argv + optind, num_parallel) ? 1 : 0);
 
   config_filename = argv[optind];
   if (!(config = parse_estim_config_file(config_filename))) {
     fprintf(stderr, "ERROR parsing configuration file %s\n", config_filename);
     rc = 1;
+  } else if (config->numChains < 1) {
+    fprintf(stderr, "ERROR: numChains must be at least 1\n");
+    rc = 1;
+  } else if (preflight) {
+    rc = do_preflight(config) ? 1 : 0;
+  } else if (config->numChains > 1) {
+    rc = run_chains(config) ? 1 : 0;
   } else {
-    rc = do_estimation(config, 0);
+    memset(&summary, 0, sizeof(summary));
+    rc = do_estimation(config, 0, load_attributes, NULL, NULL,
+                       config->summary_filename ? &summary : NULL,
+                       NULL, NULL, NULL, NULL, NULL);
+    if (rc == 0 && config->summary_filename &&
+        write_estimation_summary(config->summary_filename, &summary, 1,
+                                 config->outputFileSuffixBase,
+                                 summary.param_names))
+      rc = 1;
+    free_chain_summary(&summary);
   }
   free_estim_config_struct(config);
   exit(rc);
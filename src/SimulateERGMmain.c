@@ -4,6 +4,19 @@
  * Author:  Alex Stivala
  * Created: October 2019
  *
+ * With numChains greater than 1, that many independent chains are run
+ * in parallel, each in its own process forked from this one (as for
+ * the chains of EstimNetDirected), with its own pseudorandom number
+ * streams, burn-in and share of the samples. The node attributes are
+ * loaded only once, before forking, and shared by the chains. Each
+ * chain writes its own output files (see sim_chain_filename()), and
+ * the statistics of all the chains are then merged into statsFile.
+ *
+ * With thetaFile (a parameter sweep), the processes instead divide the
+ * rows of thetaFile between them, each simulating its rows one after
+ * another with the full sampleSize and writing the output files of each
+ * row (named by sim_chain_filename() with the row number), which are
+ * not merged.
  *
  *   Usage: SimulateERGM sim_config_filename
  *
@@ -15,11 +28,213 @@
 #include <errno.h>
 #include <getopt.h>
 #include <unistd.h>
+#include <string.h>
+#include <limits.h>
+#include <sys/types.h>
+#include <sys/wait.h>
 #include "utils.h"
 #include "simconfigparser.h"
 #include "simulation.h"
 #include "changeStatisticsDirected.h"
 
+/*****************************************************************************
+ *
+ * File static variables
+ *
+ ****************************************************************************/
+
+static void *attr_block = NULL; /* node attributes loaded before forking */
+
+/*****************************************************************************
+ *
+ * Local functions
+ *
+ ****************************************************************************/
+
+/*
+ * Set the node attributes of g to those loaded before forking the
+ * chains (the filenames are not used). Same parameters and return value
+ * as load_attributes().
+ */
+static int load_attributes_preloaded(digraph_t *g,
+                                     const char *binattr_filename,
+                                     const char *catattr_filename,
+                                     const char *contattr_filename,
+                                     const char *setattr_filename,
+                                     const char *dyadcov_filename)
+{
+  (void)binattr_filename;
+  (void)catattr_filename;
+  (void)contattr_filename;
+  (void)setattr_filename;
+  (void)dyadcov_filename;
+  attach_digraph_attributes(g, attr_block);
+  return 0;
+}
+
+/*
+ * Load the node attributes into attr_block, to be shared by the chains.
+ *
+ * Parameters:
+ *   config - configuration settings
+ *
+ * Return value:
+ *   0 if OK else nonzero on error (message printed to stderr).
+ */
+static int preload_attributes(const sim_config_t *config)
+{
+  digraph_t   *g = allocate_digraph(config->numNodes);
+  const char **columns;
+  uint_t       num_columns;
+
+  set_twopath_build_threads(g, config->numThreadsLoad);
+  /* only the attribute columns the model refers to, as do_simulation()
+     loads them */
+  if (!config->write_snapshot_filename &&
+      !config->estimation_config_filename) {
+    num_columns = get_model_attribute_names(&config->param_config, &columns);
+    set_attribute_columns(g, num_columns, columns);
+    free(columns);
+  }
+  if (load_attributes(g, config->binattr_filename, config->catattr_filename,
+                      config->contattr_filename, config->setattr_filename,
+                      config->dyadcov_filename)) {
+    fprintf(stderr, "ERROR: loading node attributes failed\n");
+    free_digraph(g);
+    return -1;
+  }
+  attr_block = safe_malloc(digraph_attributes_block_size(g));
+  move_digraph_attributes(g, attr_block);
+  free_digraph(g);
+  return 0;
+}
+
+/*
+ * Merge the statistics (or goodness-of-fit) files written by the
+ * chains into one file: the header line of the first, then the
+ * statistics lines of each in chain order (the iteration in the first
+ * column is that of the chain).
+ *
+ * Parameters:
+ *   filename   - name of merged file, the chain files being named
+ *                from it by sim_chain_filename()
+ *   num_chains - number of chains
+ *
+ * Return value:
+ *   0 if OK else nonzero on error (message printed to stderr).
+ */
+static int merge_chain_stats(const char *filename, uint_t num_chains)
+{
+  uint_t chain;
+  char   chain_filename[PATH_MAX+1];
+  char   buf[BUFSIZ];
+  FILE  *outfile, *infile;
+  bool   header;
+  size_t len;
+  int    rc = 0;
+
+  if (!(outfile = fopen(filename, "w"))) {
+    fprintf(stderr, "ERROR: could not open file %s for writing (%s)\n",
+            filename, strerror(errno));
+    return -1;
+  }
+  for (chain = 0; chain < num_chains && rc == 0; chain++) {
+    sim_chain_filename(chain_filename, sizeof(chain_filename),
+                       filename, num_chains, chain);
+    if (!(infile = fopen(chain_filename, "r"))) {
+      fprintf(stderr, "ERROR: could not open file %s (%s)\n",
+              chain_filename, strerror(errno));
+      rc = -1;
+      break;
+    }
+    /* the header is the first line, which may be longer than buf */
+    header = TRUE;
+    while (fgets(buf, sizeof(buf), infile)) {
+      len = strlen(buf);
+      if (!header || chain == 0)
+        fputs(buf, outfile);
+      if (len > 0 && buf[len - 1] == '\n')
+        header = FALSE;
+    }
+    if (ferror(infile)) {
+      fprintf(stderr, "ERROR: reading %s failed\n", chain_filename);
+      rc = -1;
+    }
+    fclose(infile);
+  }
+  if (fclose(outfile) != 0) {
+    fprintf(stderr, "ERROR: writing %s failed (%s)\n",
+            filename, strerror(errno));
+    rc = -1;
+  }
+  return rc;
+}
+
+/*
+ * Run config->numChains simulation chains in parallel, each in its own
+ * process, and merge their statistics into statsFile (and goodness-of-fit
+ * statistics into gofFile). For a parameter sweep (thetaFile) the
+ * processes each do some of the rows instead, and nothing is merged.
+ *
+ * Parameters:
+ *   config - configuration settings
+ *
+ * Return value:
+ *   0 if OK else nonzero if any chain failed.
+ */
+static int run_chains(sim_config_t *config)
+{
+  uint_t num_chains = config->numChains, chain;
+  pid_t *pids;
+  int    status, rc = 0;
+
+  if (!config->stats_filename) {
+    fprintf(stderr, "ERROR: statistics output filename statsFile not set\n");
+    return -1;
+  }
+  /* with a snapshot each chain maps the same file, so its attributes
+     are shared already */
+  if (!config->snapshot_filename && preload_attributes(config))
+    return -1;
+
+  pids = (pid_t *)safe_malloc(num_chains * sizeof(pid_t));
+  fflush(stdout);
+  fflush(stderr);
+  for (chain = 0; chain < num_chains; chain++) {
+    if ((pids[chain] = fork()) < 0) {
+      fprintf(stderr, "ERROR: could not fork chain %u (%s)\n", chain,
+              strerror(errno));
+      rc = -1;
+      break;
+    }
+    if (pids[chain] == 0) {
+      /* independent streams, as for MPI rank, except in a sweep where
+         the stream of each row is its row number */
+      if (!config->theta_filename)
+        init_prng(chain);
+      rc = do_simulation(config, chain,
+                         config->snapshot_filename ? NULL :
+                         load_attributes_preloaded);
+      exit(rc ? 1 : 0);
+    }
+  }
+  num_chains = chain; /* only wait for those started */
+  for (chain = 0; chain < num_chains; chain++) {
+    if (waitpid(pids[chain], &status, 0) < 0 || !WIFEXITED(status) ||
+        WEXITSTATUS(status) != 0) {
+      fprintf(stderr, "ERROR: chain %u failed\n", chain);
+      rc = -1;
+    }
+  }
+  free(pids);
+  free(attr_block);
+  if (rc == 0 && !config->theta_filename)
+    rc = merge_chain_stats(config->stats_filename, num_chains);
+  if (rc == 0 && config->gof_filename && !config->theta_filename)
+    rc = merge_chain_stats(config->gof_filename, num_chains);
+  return rc;
+}
+
 /*****************************************************************************
  *
  * Main
@@ -42,8 +257,6 @@ int main(int argc, char *argv[])
   int              rc;
 
   init_prng(0); /* initialize pseudorandom number generator */
-  init_powtable(1-1/lambda); /* intialize pow(1-1/lambda, y) lookup table */
-
   init_sim_config_parser();
   
   while ((c = getopt(argc, argv, "h")) != -1)  {
@@ -66,8 +279,10 @@ int main(int argc, char *argv[])
   if (!(config = parse_sim_config_file(config_filename))) {
     fprintf(stderr, "ERROR parsing configuration file %s\n", config_filename);
     rc = 1;
+  } else if (config->numChains > 1) {
+    rc = run_chains(config) ? 1 : 0;
   } else {
-    rc = do_simulation(config);
+    rc = do_simulation(config, 0, NULL);
   }
   free_sim_config_struct(config);
   exit(rc);
@@ -0,0 +1,282 @@
+/*****************************************************************************
+ *
+ * File:    SnowballSampleMain.c
+ * Author:  Alex Stivala
+ * Created: October 2026
+ *
+ * Take snowball samples of a network, writing for each sample the
+ * sampled network, the zone of each node, and the node attributes, for
+ * conditional estimation with EstimNetDirected (useConditionalEstimation
+ * with arclistFile, zoneFile and the attribute files of a sample), as
+ * done by scripts/snowballSample.py but fast enough for networks of
+ * tens of millions of arcs (see snowballSample.c).
+ *
+ * The seeds of all the samples are distinct nodes chosen uniformly at
+ * random. The samples are taken and written in parallel, by num_threads
+ * threads (default 1), each sample in its own thread, and the sample
+ * description file sampledesc.txt (one line per sample, giving the
+ * number of nodes and the filenames of the sample) written in order
+ * of sample number. The output directory must exist.
+ *
+ * The arc list (Pajek format, or an edge list with arbitrary node ids
+ * with -e, as for arclistFormat=edgelist) and attribute files can be
+ * compressed (see open_input_file()).
+ *
+ *   Usage: SnowballSample [-e] [-s seed] [-t num_threads]
+ *                         [-b binattr_file] [-c catattr_file]
+ *                         [-f contattr_file] [-a setattr_file]
+ *                         arclist_file num_samples num_seeds num_waves
+ *                         outputdir
+ *
+ ****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include "utils.h"
+#include "digraph.h"
+#include "loadDigraph.h"
+#include "snowballSample.h"
+
+#define DESC_LINE_LEN (6 * (PATH_MAX + 1)) /* sampledesc.txt line length */
+
+/* shared state of the sampling threads */
+typedef struct snowball_job_s {
+  const digraph_t             *g;
+  const uint_t                *seeds;       /* num_seeds for each sample */
+  uint_t                       num_samples;
+  uint_t                       num_seeds;
+  uint_t                       num_waves;
+  const char                  *outputdir;
+  const snowball_attr_files_t *attr_files;
+  char                        *desc_lines;  /* DESC_LINE_LEN per sample */
+  int                         *status;      /* 0 or -1 for each sample */
+  uint_t                       num_threads;
+} snowball_job_t;
+
+typedef struct snowball_thread_arg_s {
+  snowball_job_t *job;
+  uint_t          thread_num; /* samples thread_num, +num_threads, ... */
+} snowball_thread_arg_t;
+
+/*****************************************************************************
+ *
+ * Local functions
+ *
+ ****************************************************************************/
+
+static void usage(const char *progname)
+{
+  fprintf(stderr,
+          "Usage: %s [-e] [-s seed] [-t num_threads] [-b binattr_file] "
+          "[-c catattr_file] [-f contattr_file] [-a setattr_file] "
+          "arclist_file num_samples num_seeds num_waves outputdir\n",
+          progname);
+  exit(1);
+}
+
+/*
+ * Take and write the samples of one thread.
+ *
+ * Parameters:
+ *   arg - pointer to snowball_thread_arg_t
+ *
+ * Return value:
+ *   NULL.
+ */
+static void *snowball_thread(void *arg)
+{
+  snowball_thread_arg_t *targ = (snowball_thread_arg_t *)arg;
+  snowball_job_t        *job = targ->job;
+  uint_t                *work;
+  uint_t                 i, samplenum;
+  snowball_sample_t      sample;
+
+  work = (uint_t *)safe_malloc(MAX(job->g->num_nodes, 1) * sizeof(uint_t));
+  for (i = 0; i < job->g->num_nodes; i++)
+    work[i] = SNOWBALL_NOT_SAMPLED;
+  for (samplenum = targ->thread_num; samplenum < job->num_samples;
+       samplenum += job->num_threads) {
+    snowball_sample(job->g, job->seeds + (size_t)samplenum * job->num_seeds,
+                    job->num_seeds, job->num_waves, work, &sample);
+    job->status[samplenum] =
+      write_snowball_sample(job->g, &sample, work, job->outputdir,
+                            samplenum, job->attr_files,
+                            job->desc_lines +
+                            (size_t)samplenum * DESC_LINE_LEN,
+                            DESC_LINE_LEN);
+    free_snowball_sample(&sample);
+  }
+  free(work);
+  return NULL;
+}
+
+/*****************************************************************************
+ *
+ * Main
+ *
+ ****************************************************************************/
+
+int main(int argc, char *argv[])
+{
+  int                    c, rc = 0;
+  char                  *endptr;
+  unsigned long long     seed = 0;
+  arclist_format_e       format = ARCLIST_FORMAT_PAJEK;
+  snowball_attr_files_t  attr_files = {NULL, NULL, NULL, NULL};
+  unsigned long          val;
+  uint_t                 num_threads = 1, num_samples, num_seeds, num_waves;
+  uint_t                 i;
+  const char            *arclist_filename, *outputdir;
+  char                   filename[PATH_MAX + 1];
+  digraph_t             *g;
+  prng_t                 prng;
+  uint_t                *seeds;
+  snowball_job_t         job;
+  snowball_thread_arg_t *targs;
+  pthread_t             *threads;
+  bool                  *started;
+  FILE                  *fp;
+  struct timeval         start_timeval, end_timeval, elapsed_timeval;
+  int                    etime;
+
+  init_prng(0); /* initialize pseudorandom number generator */
+
+  while ((c = getopt(argc, argv, "es:t:b:c:f:a:")) != -1) {
+    switch (c) {
+      case 'e':
+        format = ARCLIST_FORMAT_EDGELIST;
+        break;
+      case 's':
+        seed = strtoull(optarg, &endptr, 10);
+        if (*endptr != '\0')
+          usage(argv[0]);
+        break;
+      case 't':
+        num_threads = (uint_t)strtoul(optarg, &endptr, 10);
+        if (*endptr != '\0' || num_threads == 0)
+          usage(argv[0]);
+        break;
+      case 'b':
+        attr_files.binattr_filename = optarg;
+        break;
+      case 'c':
+        attr_files.catattr_filename = optarg;
+        break;
+      case 'f':
+        attr_files.contattr_filename = optarg;
+        break;
+      case 'a':
+        attr_files.setattr_filename = optarg;
+        break;
+      default:
+        usage(argv[0]);
+        break;
+    }
+  }
+  if (argc - optind != 5)
+    usage(argv[0]);
+  arclist_filename = argv[optind];
+  val = strtoul(argv[optind + 1], &endptr, 10);
+  if (*endptr != '\0' || val == 0 || val > UINT_MAX)
+    usage(argv[0]);
+  num_samples = (uint_t)val;
+  val = strtoul(argv[optind + 2], &endptr, 10);
+  if (*endptr != '\0' || val == 0 || val > UINT_MAX)
+    usage(argv[0]);
+  num_seeds = (uint_t)val;
+  val = strtoul(argv[optind + 3], &endptr, 10);
+  if (*endptr != '\0' || val > UINT_MAX)
+    usage(argv[0]);
+  num_waves = (uint_t)val;
+  outputdir = argv[optind + 4];
+
+  if (seed != 0) /* reproducible run instead of seed from time */
+    set_prng_seed(seed);
+  prng_init_stream(&prng, 0);
+
+  gettimeofday(&start_timeval, NULL);
+  if (!(g = allocate_digraph_from_arclist_file(arclist_filename, format,
+                                               TRUE)))
+    exit(1);
+  if (!load_digraph_from_arclist_mmap(arclist_filename, g, FALSE,
+                                      0, 0, 0, 0, NULL, NULL, NULL,
+                                      NULL, NULL, NULL, NULL, NULL, NULL))
+    exit(1);
+  gettimeofday(&end_timeval, NULL);
+  timeval_subtract(&elapsed_timeval, &end_timeval, &start_timeval);
+  etime = 1000 * elapsed_timeval.tv_sec + elapsed_timeval.tv_usec/1000;
+  fprintf(stderr, "loaded %u nodes, %lu arcs from %s in %.2f s\n",
+          g->num_nodes, (unsigned long)g->num_arcs, arclist_filename,
+          (double)etime / 1000);
+
+  if (!(seeds = snowball_seeds(g, num_samples, num_seeds, &prng)))
+    exit(1);
+
+  gettimeofday(&start_timeval, NULL);
+  job.g = g;
+  job.seeds = seeds;
+  job.num_samples = num_samples;
+  job.num_seeds = num_seeds;
+  job.num_waves = num_waves;
+  job.outputdir = outputdir;
+  job.attr_files = &attr_files;
+  job.desc_lines = (char *)safe_calloc((size_t)num_samples, DESC_LINE_LEN);
+  job.status = (int *)safe_calloc(num_samples, sizeof(int));
+  job.num_threads = MIN(num_threads, num_samples);
+  targs = (snowball_thread_arg_t *)safe_malloc(job.num_threads *
+                                               sizeof(snowball_thread_arg_t));
+  threads = (pthread_t *)safe_malloc(job.num_threads * sizeof(pthread_t));
+  started = (bool *)safe_calloc(job.num_threads, sizeof(bool));
+  for (i = 0; i < job.num_threads; i++) {
+    targs[i].job = &job;
+    targs[i].thread_num = i;
+  }
+  /* threads 1.. in their own threads, thread 0 (and any that could
+     not be created) in this one */
+  for (i = 1; i < job.num_threads; i++)
+    started[i] = pthread_create(&threads[i], NULL, snowball_thread,
+                                &targs[i]) == 0;
+  for (i = 0; i < job.num_threads; i++)
+    if (!started[i])
+      snowball_thread(&targs[i]);
+  for (i = 1; i < job.num_threads; i++)
+    if (started[i])
+      pthread_join(threads[i], NULL);
+  gettimeofday(&end_timeval, NULL);
+  timeval_subtract(&elapsed_timeval, &end_timeval, &start_timeval);
+  etime = 1000 * elapsed_timeval.tv_sec + elapsed_timeval.tv_usec/1000;
+  fprintf(stderr, "%u samples taken and written in %.2f s\n", num_samples,
+          (double)etime / 1000);
+
+  for (i = 0; i < num_samples; i++)
+    if (job.status[i] != 0)
+      rc = 1;
+  if (rc == 0) {
+    snprintf(filename, sizeof(filename), "%s/sampledesc.txt", outputdir);
+    if (!(fp = fopen(filename, "w"))) {
+      perror("opening sample description file");
+      rc = 1;
+    } else {
+      for (i = 0; i < num_samples; i++)
+        fprintf(fp, "%s\n", job.desc_lines + (size_t)i * DESC_LINE_LEN);
+      if (fclose(fp) != 0) {
+        perror("writing sample description file");
+        rc = 1;
+      }
+    }
+  }
+
+  free(started);
+  free(threads);
+  free(targs);
+  free(job.status);
+  free(job.desc_lines);
+  free(seeds);
+  free_digraph(g);
+  return rc;
+}
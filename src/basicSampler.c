@@ -45,12 +45,110 @@
  *
  ****************************************************************************/
 
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 #include <math.h>
+#include <pthread.h>
 #include "utils.h"
 #include "changeStatisticsDirected.h"
 #include "basicSampler.h"
 
+/*
+ * Number of proposals the basic sampler draws ahead of the one it is
+ * evaluating (see basicSamplerLoop()), and how far ahead of it the
+ * adjacency lists are prefetched, the per-node entries they are found
+ * from having been prefetched when the proposal was drawn.
+ */
+#define SAMPLER_LOOKAHEAD 4
+static const uint_t LOOKAHEAD_LISTS_DISTANCE = 2;
+
+/*
+ * Only networks with at least this many nodes use the lookahead, as for
+ * smaller ones the node entries and lists are mostly in cache anyway.
+ */
+static const uint_t LOOKAHEAD_MIN_NODES = 65536;
+
+typedef struct proposal_ahead_s /* proposal drawn ahead of its evaluation */
+{
+  uint_t i, j;   /* dyad to toggle arc i -> j of */
+  double u;      /* acceptance random number */
+  double log_u;  /* and its (approximate) log */
+} proposal_ahead_t;
+
+/*
+ * Insert arc i -> j into g, also updating the flat arc list (allinnerarcs
+ * for conditional estimation, otherwise allarcs).
+ *
+ * Parameters:
+ *   g - digraph
+ *   i - node to insert arc from
+ *   j - node to insert arc to
+ *   useConditionalEstimation - if True arc is in allinnerarcs not allarcs
+ *
+ * Return value:
+ *   None
+ */
+static void sampler_insertArc(digraph_t *g, uint_t i, uint_t j,
+                              bool useConditionalEstimation)
+{
+  if (useConditionalEstimation)
+    insertArc_allinnerarcs(g, i, j);
+  else
+    insertArc_allarcs(g, i, j);
+}
+
+/*
+ * Remove arc i -> j from g, also updating the flat arc list (allinnerarcs
+ * for conditional estimation, otherwise allarcs), finding its position
+ * in the list from the arc position index.
+ *
+ * Parameters:
+ *   g - digraph
+ *   i - node to remove arc from
+ *   j - node to remove arc to
+ *   useConditionalEstimation - if True arc is in allinnerarcs not allarcs
+ *
+ * Return value:
+ *   None
+ */
+static void sampler_removeArc(digraph_t *g, uint_t i, uint_t j,
+                              bool useConditionalEstimation)
+{
+  if (useConditionalEstimation)
+    removeArc_allinnerarcs(g, i, j, get_allinnerarcs_index(g, i, j));
+  else
+    removeArc_allarcs(g, i, j, get_allarcs_index(g, i, j));
+}
+
+/*
+ * Draw the next proposal of the basic sampler without conditional
+ * estimation or forbidden reciprocity: the dyad and the acceptance
+ * random number, in the same order as basicSamplerLoop() draws them
+ * otherwise. As neither depends on the graph, proposals can be drawn
+ * ahead of the evaluation of those before them, so the per-node
+ * entries the proposal will read are prefetched here.
+ *
+ * Parameters:
+ *   g    - digraph
+ *   prng - pseudorandom number generator stream to use (updated)
+ *   p    - (Out) proposal
+ *
+ * Return value:
+ *   None
+ */
+static inline void draw_proposal_ahead(const digraph_t *g, prng_t *prng,
+                                       proposal_ahead_t *p)
+{
+  if (g->block)
+    sample_block_pair(g, prng, &p->i, &p->j);
+  else
+    prng_int_urand_pair(prng, g->num_nodes, &p->i, &p->j);
+  p->u = prng_urand_log(prng, &p->log_u);
+  prefetch_dyad_nodes(g, p->i, p->j);
+}
+
 /*
  * Basic ERGM MCMC sampler. Uniformly at random a dyad i, j is chosen
  * and the arc i->j is toggled, ie added if it does not exist, removed
@@ -65,6 +163,8 @@
  *   n_attr_interaction - number of attribute interaction change stats funcs
  *   change_stats_funcs - array of pointers to change statistics functions
  *                        length is n-n_attr-n_dyadic-n_attr_interaction
+ *   lambda_values - array of lambda (decay) values corresponding to
+ *                   change_stats_funcs (used by alternating statistics)
  *   attr_change_stats_funcs - array of pointers to change statistics functions
  *                             length is n_attr
  *   dyadic_change_stats_funcs - array of pointers to dyadic change stats funcs
@@ -91,6 +191,13 @@
  *   useConditionalEstimation - if True do conditional estimation of snowball
  *                              network sample.
  *   forbidReciprocity - if True do not allow reciprocated arcs.
+ *   earlyReject - if True draw the acceptance random number first and
+ *                 reject moves without computing the statistics that
+ *                 scan neighbour lists when a bound on them shows the
+ *                 move cannot be accepted (calcChangeStatsEarlyReject()).
+ *                 The result is the same either way.
+ *   prng - pseudorandom number generator stream to use (updated)
+ *   ws   - sampler workspace (scratch buffers for n parameters)
  *
  * Return value:
  *   Acceptance rate.
@@ -100,40 +207,93 @@
  * function pointer array. On exit they are set to the sum values of the
  * change statistics for add and delete moves respectively.
  *
- * Note that this sampler does not update the digraph allarcs flat arc list
- * as it does not need to use it at all, so that it remains as it was 
- * and therefore becomes inconsistent with the actual graph when it is modified
- * in this function, so should therefore not be used afterwards.
+ * This sampler does not use the digraph allarcs (or allinnerarcs) flat
+ * arc list itself, but keeps it consistent with the graph (using the arc
+ * position index to remove arcs in O(1) time) so that other samplers
+ * can still be used on the graph afterwards.
+ *
+ * Without conditional estimation or forbidden reciprocity, on a large
+ * network the proposals are drawn SAMPLER_LOOKAHEAD ahead of the one
+ * being evaluated, into a ring buffer, and what they will read is
+ * prefetched (see draw_proposal_ahead()), so the cache misses on the
+ * node entries and adjacency lists of the next proposals overlap with
+ * the evaluation of this one rather than each adding to the time of a
+ * proposal. The random numbers are drawn in the same order either
+ * way, so the results are identical. Whether the proposal is to
+ * delete an arc is only tested when it is evaluated, so moves made in
+ * the meantime are taken into account.
+ *
+ * If g has a dyad cache (see set_dyad_cache()), the change statistics
+ * of a dyad whose neighbourhood has not changed since they were last
+ * computed are taken from it, and the total computed from them as in
+ * calcChangeStats(), so again the results are identical.
  */
-double basicSampler(digraph_t *g,  uint_t n, uint_t n_attr, uint_t n_dyadic,
-                    uint_t n_attr_interaction,
-                    change_stats_func_t *change_stats_funcs[],
-                    attr_change_stats_func_t *attr_change_stats_funcs[],
-                    dyadic_change_stats_func_t *dyadic_change_stats_funcs[],
-                    attr_interaction_change_stats_func_t
+static inline double basicSamplerLoop(digraph_t *g,  uint_t n, uint_t n_attr,
+                                     uint_t n_dyadic, uint_t n_attr_interaction,
+                                     change_stats_func_t *change_stats_funcs[],
+                                     double lambda_values[],
+                                     attr_change_stats_func_t
+                                                  *attr_change_stats_funcs[],
+                                     dyadic_change_stats_func_t
+                                                *dyadic_change_stats_funcs[],
+                                     attr_interaction_change_stats_func_t
                                      *attr_interaction_change_stats_funcs[],
-                    uint_t attr_indices[],
-                    uint_pair_t attr_interaction_pair_indices[],
-                    double theta[],
-                    double addChangeStats[], double delChangeStats[],
-                    uint_t sampler_m,
-                    bool performMove,
-                    bool useConditionalEstimation,
-                    bool forbidReciprocity)
+                                     uint_t attr_indices[],
+                                     uint_pair_t
+                                           attr_interaction_pair_indices[],
+                                     double theta[],
+                                     double addChangeStats[],
+                                     double delChangeStats[],
+                                     uint_t sampler_m,
+                                     bool performMove,
+                                     bool useConditionalEstimation,
+                                     bool forbidReciprocity,
+                                     bool earlyReject,
+                                     prng_t *prng, sampler_workspace_t *ws)
 {
   uint_t accepted = 0;    /* number of accepted moves */
   double acceptance_rate;
   uint_t i,j,k,l;
   bool   isDelete = FALSE; /* only init to fix warning */
-  double *changestats = (double *)safe_malloc(n*sizeof(double));
+  double *changestats = ws->changestats;
   double total;  /* sum of theta*changestats */
+  double u = 0, log_u = 0; /* acceptance random number and (approximate)
+                              log (only init to fix warning) */
+  proposal_ahead_t ahead[SAMPLER_LOOKAHEAD]; /* proposal k + d in entry
+                                                (k + d) % SAMPLER_LOOKAHEAD */
+  proposal_ahead_t *p;
+  bool   lookahead = !useConditionalEstimation && !forbidReciprocity &&
+                     g->num_nodes >= LOOKAHEAD_MIN_NODES;
+  bool   use_dyad_cache = g->dyad_cache && g->dyad_cache->num_stats == n;
+  const double *cached; /* change statistics of i->j in dyad cache or NULL */
+  bool   accept;
 
   for (i = 0; i < n; i++)
     addChangeStats[i] = delChangeStats[i] = 0;
 
+  if (lookahead) {
+    for (k = 0; k < SAMPLER_LOOKAHEAD && k < sampler_m; k++)
+      draw_proposal_ahead(g, prng, &ahead[k]);
+  }
+
   for (k = 0; k < sampler_m; k++) {
 
-    if (useConditionalEstimation) {
+    if (lookahead) {
+      p = &ahead[k % SAMPLER_LOOKAHEAD];
+      i = p->i;
+      j = p->j;
+      u = p->u;
+      log_u = p->log_u;
+      isDelete = isArc(g, i, j);
+      /* the entry of this proposal is reused for the one
+         SAMPLER_LOOKAHEAD after it */
+      if (k + SAMPLER_LOOKAHEAD < sampler_m)
+        draw_proposal_ahead(g, prng, p);
+      if (k + LOOKAHEAD_LISTS_DISTANCE < sampler_m) {
+        p = &ahead[(k + LOOKAHEAD_LISTS_DISTANCE) % SAMPLER_LOOKAHEAD];
+        prefetch_dyad_lists(g, p->i, p->j);
+      }
+    } else if (useConditionalEstimation) {
       /* Select two nodes i, j in inner waves (i.e. fixing ties in
          outermost wave and between outermost and second-outermost
          waves) uniformly at random, and toggle arc between them,
@@ -141,64 +301,95 @@ double basicSampler(digraph_t *g,  uint_t n, uint_t n_attr, uint_t n_dyadic,
          conditional estimation that a tie can only be between adjacent
          waves and a tie cannot be deleted if it is last reamainign tie
          connecting node to preceding wave. Note ignoring arc direction
-         here as assumed snowball sample ignored arc directions. */
+         here as assumed snowball sample ignored arc directions.
+         The pair is drawn directly from the same or adjacent zones
+         so only the last remaining tie constraint needs rejection. */
       assert(!forbidReciprocity); /* TODO not implemented for snowball */
       do {
-        i = g->inner_nodes[int_urand(g->num_inner_nodes)];
-        do {
-          j = g->inner_nodes[int_urand(g->num_inner_nodes)];        
-        } while (i == j);
+        sample_zone_pair(g, prng, &i, &j);
         assert(g->zone[i] < g->max_zone && g->zone[j] < g->max_zone);
-        /* any tie must be within same zone or between adjacent zones */
-        assert(labs((long)g->zone[i] - (long)g->zone[j]) <= 1 ||
-               !isArcIgnoreDirection(g, i, j));
-      } while (labs((long)g->zone[i] - (long)g->zone[j]) > 1 ||
-               (isArcIgnoreDirection(g, i, j) &&
+        assert(labs((long)g->zone[i] - (long)g->zone[j]) <= 1);
+      } while ((isArcIgnoreDirection(g, i, j) &&
                 ((g->zone[i] > g->zone[j] && g->prev_wave_degree[i] == 1) ||
                  (g->zone[j] > g->zone[i] && g->prev_wave_degree[j] == 1))));
+      /* (without this every conditional proposal was an add,
+         duplicating existing inner arcs; see
+         TestChangeStatsDirected/run_test_conditional.sh) */
+      isDelete = isArc(g, i, j);
     } else {
       /* Basic sampler (no conditional estimation): select two
-         nodes i and j uniformly at random and toggle arc between
-         them. */
+         nodes i and j (in the same network if several are pooled)
+         uniformly at random and toggle arc between them. */
       do {
-        i = int_urand(g->num_nodes);
-        do {
-          j = int_urand(g->num_nodes);
-        } while (i == j);
+        if (g->block)
+          sample_block_pair(g, prng, &i, &j);
+        else
+          prng_int_urand_pair(prng, g->num_nodes, &i, &j);
         isDelete = isArc(g, i ,j);
       }
       while (forbidReciprocity && !isDelete && isArc(g, j, i));
     }
     
     /* The change statistics are all computed on the basis of adding arc i->j
-       so if if the arc exists, we temporarily remove it to compute the
-       change statistics, and negate them */
+       so if if the arc exists, they are computed as if it did not
+       (without modifying g), and negated */
     SAMPLER_DEBUG_PRINT(("%s %d -> %d\n",isDelete ? "del" : "add", i, j));
-    if (isDelete) {
-      removeArc(g, i, j);
-    }
 
-    total = calcChangeStats(g, i, j, n, n_attr, n_dyadic,
-                            n_attr_interaction, change_stats_funcs,
-                            attr_change_stats_funcs, dyadic_change_stats_funcs,
-                            attr_interaction_change_stats_funcs,
-                            attr_indices, attr_interaction_pair_indices,
-                            theta, isDelete, changestats);
+    cached = use_dyad_cache ? dyad_cache_lookup(g, i, j) : NULL;
+    if (cached) {
+      /* nothing the statistics of this dyad depend on has changed since
+         they were last computed */
+      memcpy(changestats, cached, n * sizeof(double));
+      total = changeStatsTotal(n, theta, isDelete, changestats);
+      if (!lookahead)
+        u = prng_urand_log(prng, &log_u);
+    } else if (earlyReject) {
+      /* the acceptance random number is drawn next in either case */
+      if (!lookahead)
+        u = prng_urand_log(prng, &log_u);
+      total = calcChangeStatsEarlyReject(g, i, j, n, n_attr, n_dyadic,
+                                         n_attr_interaction,
+                                         change_stats_funcs, lambda_values,
+                                         attr_change_stats_funcs,
+                                         dyadic_change_stats_funcs,
+                                         attr_interaction_change_stats_funcs,
+                                         attr_indices,
+                                         attr_interaction_pair_indices,
+                                         theta, isDelete,
+                                         log_u - PRNG_LOG_URAND_ERROR,
+                                         changestats);
+    } else {
+      total = calcChangeStats(g, i, j, n, n_attr, n_dyadic,
+                              n_attr_interaction, change_stats_funcs,
+                              lambda_values,
+                              attr_change_stats_funcs,
+                              dyadic_change_stats_funcs,
+                              attr_interaction_change_stats_funcs,
+                              attr_indices, attr_interaction_pair_indices,
+                              theta, isDelete, changestats);
+      if (!lookahead)
+        u = prng_urand_log(prng, &log_u);
+    }
+    /* a move rejected early does not have all its statistics computed */
+    if (use_dyad_cache && !cached && total > -HUGE_VAL)
+      dyad_cache_store(g, i, j, changestats);
     
     /* now exp(total) is the acceptance probability */
-    if (urand() < exp(total)) {
+    accept = urand_accept(u, log_u, total);
+    if (ws->trace)
+      trace_proposal(ws->trace, i, j,
+                     (isDelete ? PROPOSAL_TRACE_DELETE : 0) |
+                     (accept ? PROPOSAL_TRACE_ACCEPTED : 0) |
+                     (accept && performMove ? PROPOSAL_TRACE_MOVED : 0),
+                     prng, total > -HUGE_VAL ? changestats : NULL);
+    if (accept) {
       accepted++;
       if (performMove) {
-        /* actually do the move. If deleting, already done it. For add, add
-           the arc now */
-        if (!isDelete)
-          insertArc(g, i, j);
-      } else {
-        /* not actually doing the moves, so reverse change for delete move
-           to restore g to original state */
-        if (isDelete) {
-          insertArc(g, i, j);
-        }
+        /* actually do the move */
+        if (isDelete)
+          sampler_removeArc(g, i, j, useConditionalEstimation);
+        else
+          sampler_insertArc(g, i, j, useConditionalEstimation);
       }
       /* accumulate the change statistics for add and del moves separately */
       if (isDelete) {
@@ -208,15 +399,658 @@ double basicSampler(digraph_t *g,  uint_t n, uint_t n_attr, uint_t n_dyadic,
         for (l = 0; l < n; l++)
           addChangeStats[l] += changestats[l];
       }
-    } else {
-      /* move not acceptd, so reverse change for delete */
-      if (isDelete) {
-        insertArc(g, i, j);
-      }
     }
   }
   
   acceptance_rate = (double)accepted / sampler_m;
-  free(changestats);
   return acceptance_rate;
 }
+
+/*
+ * Call basicSamplerLoop() with constant flags: each call is a separate
+ * instance of the loop specialised for them (inlined or cloned by the
+ * compiler), so the branches on the flags are resolved at compile time
+ * rather than for every proposal.
+ */
+#define BASIC_SAMPLER_LOOP(performMove, useConditionalEstimation,         \
+                           forbidReciprocity)                              \
+  basicSamplerLoop(g, n, n_attr, n_dyadic, n_attr_interaction,             \
+                   change_stats_funcs, lambda_values,                      \
+                   attr_change_stats_funcs, dyadic_change_stats_funcs,     \
+                   attr_interaction_change_stats_funcs, attr_indices,      \
+                   attr_interaction_pair_indices, theta, addChangeStats,   \
+                   delChangeStats, sampler_m, (performMove),               \
+                   (useConditionalEstimation), (forbidReciprocity),        \
+                   earlyReject, prng, ws)
+
+/*
+ * Basic ERGM MCMC sampler: basicSamplerLoop() (see that for the
+ * parameters and return value), dispatching once on the flags to the
+ * instance of the loop specialised for them.
+ */
+double basicSampler(digraph_t *g,  uint_t n, uint_t n_attr, uint_t n_dyadic,
+                    uint_t n_attr_interaction,
+                    change_stats_func_t *change_stats_funcs[],
+                    double lambda_values[],
+                    attr_change_stats_func_t *attr_change_stats_funcs[],
+                    dyadic_change_stats_func_t *dyadic_change_stats_funcs[],
+                    attr_interaction_change_stats_func_t
+                                     *attr_interaction_change_stats_funcs[],
+                    uint_t attr_indices[],
+                    uint_pair_t attr_interaction_pair_indices[],
+                    double theta[],
+                    double addChangeStats[], double delChangeStats[],
+                    uint_t sampler_m,
+                    bool performMove,
+                    bool useConditionalEstimation,
+                    bool forbidReciprocity,
+                    bool earlyReject,
+                    prng_t *prng, sampler_workspace_t *ws)
+{
+  if (useConditionalEstimation) {
+    assert(!forbidReciprocity); /* TODO not implemented for snowball */
+    return performMove ? BASIC_SAMPLER_LOOP(TRUE, TRUE, FALSE) :
+      BASIC_SAMPLER_LOOP(FALSE, TRUE, FALSE);
+  }
+  if (forbidReciprocity)
+    return performMove ? BASIC_SAMPLER_LOOP(TRUE, FALSE, TRUE) :
+      BASIC_SAMPLER_LOOP(FALSE, FALSE, TRUE);
+  return performMove ? BASIC_SAMPLER_LOOP(TRUE, FALSE, FALSE) :
+    BASIC_SAMPLER_LOOP(FALSE, FALSE, FALSE);
+}
+
+
+/*
+ * Draw a node for one end of a degree-weighted dyad proposal (see
+ * degreeProposalSampler()): with probability 1 - degree_weight
+ * uniformly, otherwise with probability proportional to one more than
+ * its out-degree (or in-degree). The latter is drawn in O(1) time
+ * from the flat arc list, which the basic sampler keeps up to date as
+ * arcs are added and removed: an entry of the num_nodes nodes followed
+ * by the num_arcs arcs is chosen uniformly, and an arc stands for its
+ * tail (or head), so a node with d arcs from (or to) it has d + 1 of
+ * the entries.
+ *
+ * Parameters:
+ *   g             - digraph (with allarcs)
+ *   prng          - pseudorandom number generator stream to use (updated)
+ *   degree_weight - weight of the degree-weighted distribution, in (0, 1]
+ *   head          - if True weight by in-degree, else by out-degree
+ *
+ * Return value:
+ *   Node drawn.
+ */
+static inline uint_t draw_degree_node(const digraph_t *g, prng_t *prng,
+                                      double degree_weight, bool head)
+{
+  uint64_t r;
+
+  if (degree_weight < 1 && prng_urand(prng) >= degree_weight)
+    return prng_int_urand(prng, g->num_nodes);
+  r = prng_int_urand64(prng, (uint64_t)g->num_nodes + g->num_arcs);
+  if (r < g->num_nodes)
+    return (uint_t)r;
+  r -= g->num_nodes;
+  return head ? g->allarcs[r].j : g->allarcs[r].i;
+}
+
+/*
+ * Probability that draw_degree_node() draws a given node.
+ *
+ * Parameters:
+ *   degree        - out-degree (or in-degree) of the node
+ *   num_arcs      - number of arcs in the digraph
+ *   num_nodes     - number of nodes in the digraph
+ *   degree_weight - weight of the degree-weighted distribution
+ *
+ * Return value:
+ *   Probability of drawing the node.
+ */
+static inline double degree_node_prob(double degree, double num_arcs,
+                                      double num_nodes, double degree_weight)
+{
+  return (1 - degree_weight) / num_nodes +
+    degree_weight * (degree + 1) / (num_arcs + num_nodes);
+}
+
+/*
+ * Probability that degreeProposalSampler() proposes the dyad i -> j:
+ * i is drawn by out-degree, then j by in-degree until it is not i, so
+ * it is p_out(i) p_in(j) / (1 - p_in(i)).
+ *
+ * Parameters:
+ *   outdegree_i   - out-degree of i
+ *   indegree_j    - in-degree of j
+ *   indegree_i    - in-degree of i
+ *   num_arcs      - number of arcs in the digraph
+ *   num_nodes     - number of nodes in the digraph
+ *   degree_weight - weight of the degree-weighted distribution
+ *
+ * Return value:
+ *   Probability of proposing i -> j.
+ */
+static inline double degree_dyad_prob(double outdegree_i, double indegree_j,
+                                      double indegree_i, double num_arcs,
+                                      double num_nodes, double degree_weight)
+{
+  return degree_node_prob(outdegree_i, num_arcs, num_nodes, degree_weight) *
+    degree_node_prob(indegree_j, num_arcs, num_nodes, degree_weight) /
+    (1 - degree_node_prob(indegree_i, num_arcs, num_nodes, degree_weight));
+}
+
+/*
+ * ERGM MCMC sampler that toggles the arc i->j of a dyad drawn with a
+ * mix of uniform and degree-weighted probabilities: i with probability
+ * (1 - degreeProposalWeight) / N + degreeProposalWeight * (outdegree(i)
+ * + 1) / (A + N), where N is the number of nodes and A the number of
+ * arcs, and j likewise by in-degree (redrawn until it is not i), see
+ * draw_degree_node(). In a sparse network with a heavy tailed degree
+ * distribution, uniformly drawn dyads are nearly always between two
+ * nodes of low degree, so most proposals are to add an arc that is
+ * then rejected; this proposes more of the dyads around the hubs,
+ * where arcs and the triangles and two-paths they close are.
+ *
+ * Since toggling i->j changes A, the out-degree of i and the in-degree
+ * of j, the probability of proposing the same dyad to toggle it back
+ * differs from that of this move, so the acceptance probability is
+ * multiplied by the exact Hastings ratio of the two (computed in O(1)
+ * time from the degrees, see degree_dyad_prob()), and the chain has
+ * the same stationary distribution as the basic sampler.
+ *
+ * Not for conditional estimation, forbidReciprocity, or pooled
+ * networks (the nodes drawn could be in different networks), as the
+ * flat arc list allarcs is used. The parameters and return value are
+ * as for basicSampler(), with:
+ *
+ *   degreeProposalWeight - weight of the degree-weighted distribution
+ *                          in the mix, in (0, 1]
+ *
+ * The dyad cache (see set_dyad_cache()) and earlyReject are used as
+ * in basicSamplerLoop().
+ */
+double degreeProposalSampler(digraph_t *g,  uint_t n, uint_t n_attr,
+                             uint_t n_dyadic, uint_t n_attr_interaction,
+                             change_stats_func_t *change_stats_funcs[],
+                             double lambda_values[],
+                             attr_change_stats_func_t
+                                         *attr_change_stats_funcs[],
+                             dyadic_change_stats_func_t
+                                         *dyadic_change_stats_funcs[],
+                             attr_interaction_change_stats_func_t
+                                     *attr_interaction_change_stats_funcs[],
+                             uint_t attr_indices[],
+                             uint_pair_t attr_interaction_pair_indices[],
+                             double theta[],
+                             double addChangeStats[], double delChangeStats[],
+                             uint_t sampler_m,
+                             bool performMove,
+                             bool earlyReject,
+                             double degreeProposalWeight,
+                             prng_t *prng, sampler_workspace_t *ws)
+{
+  uint_t accepted = 0;    /* number of accepted moves */
+  uint_t i, j, k, l;
+  bool   isDelete;
+  double *changestats = ws->changestats;
+  double total;  /* sum of theta*changestats */
+  double log_hastings; /* log of q(reverse move) / q(move) */
+  double u, log_u;
+  double N = g->num_nodes, A, delta;
+  bool   use_dyad_cache = g->dyad_cache && g->dyad_cache->num_stats == n;
+  const double *cached; /* change statistics of i->j in dyad cache or NULL */
+  bool   accept;
+
+  assert(!g->block);
+  for (l = 0; l < n; l++)
+    addChangeStats[l] = delChangeStats[l] = 0;
+
+  for (k = 0; k < sampler_m; k++) {
+    i = draw_degree_node(g, prng, degreeProposalWeight, FALSE);
+    do {
+      j = draw_degree_node(g, prng, degreeProposalWeight, TRUE);
+    } while (j == i);
+    isDelete = isArc(g, i, j);
+    SAMPLER_DEBUG_PRINT(("%s %d -> %d\n",isDelete ? "del" : "add", i, j));
+
+    /* the toggle changes the number of arcs, the out-degree of i and
+       the in-degree of j (but not the in-degree of i) by delta */
+    A = g->num_arcs;
+    delta = isDelete ? -1 : 1;
+    log_hastings =
+      log(degree_dyad_prob(g->outdegree[i] + delta, g->indegree[j] + delta,
+                           g->indegree[i], A + delta, N,
+                           degreeProposalWeight) /
+          degree_dyad_prob(g->outdegree[i], g->indegree[j], g->indegree[i],
+                           A, N, degreeProposalWeight));
+
+    cached = use_dyad_cache ? dyad_cache_lookup(g, i, j) : NULL;
+    u = prng_urand_log(prng, &log_u);
+    if (cached) {
+      memcpy(changestats, cached, n * sizeof(double));
+      total = changeStatsTotal(n, theta, isDelete, changestats);
+    } else if (earlyReject) {
+      total = calcChangeStatsEarlyReject(g, i, j, n, n_attr, n_dyadic,
+                                         n_attr_interaction,
+                                         change_stats_funcs, lambda_values,
+                                         attr_change_stats_funcs,
+                                         dyadic_change_stats_funcs,
+                                         attr_interaction_change_stats_funcs,
+                                         attr_indices,
+                                         attr_interaction_pair_indices,
+                                         theta, isDelete,
+                                         log_u - PRNG_LOG_URAND_ERROR -
+                                         log_hastings,
+                                         changestats);
+    } else {
+      total = calcChangeStats(g, i, j, n, n_attr, n_dyadic,
+                              n_attr_interaction, change_stats_funcs,
+                              lambda_values,
+                              attr_change_stats_funcs,
+                              dyadic_change_stats_funcs,
+                              attr_interaction_change_stats_funcs,
+                              attr_indices, attr_interaction_pair_indices,
+                              theta, isDelete, changestats);
+    }
+    /* a move rejected early does not have all its statistics computed */
+    if (use_dyad_cache && !cached && total > -HUGE_VAL)
+      dyad_cache_store(g, i, j, changestats);
+
+    /* now exp(total + log_hastings) is the acceptance probability */
+    accept = urand_accept(u, log_u, total + log_hastings);
+    if (ws->trace)
+      trace_proposal(ws->trace, i, j,
+                     (isDelete ? PROPOSAL_TRACE_DELETE : 0) |
+                     (accept ? PROPOSAL_TRACE_ACCEPTED : 0) |
+                     (accept && performMove ? PROPOSAL_TRACE_MOVED : 0),
+                     prng, total > -HUGE_VAL ? changestats : NULL);
+    if (accept) {
+      accepted++;
+      if (performMove) {
+        if (isDelete)
+          sampler_removeArc(g, i, j, FALSE);
+        else
+          sampler_insertArc(g, i, j, FALSE);
+      }
+      if (isDelete) {
+        for (l = 0; l < n; l++)
+          delChangeStats[l] += changestats[l];
+      } else {
+        for (l = 0; l < n; l++)
+          addChangeStats[l] += changestats[l];
+      }
+    }
+  }
+  return (double)accepted / sampler_m;
+}
+
+
+/*
+ * Number of proposals per thread in each batch evaluated in parallel by
+ * basicSamplerThreaded(). Larger batches mean less synchronization but
+ * more proposals that have to be evaluated again after earlier moves in
+ * the batch changed the graph near them.
+ */
+static const uint_t PROPOSALS_PER_THREAD = 16;
+
+/*
+ * State shared by the threads of basicSamplerThreaded(): the model, and
+ * the current batch of proposals and their change statistics.
+ */
+typedef struct sampler_batch_s {
+  digraph_t *g;
+  uint_t n, n_attr, n_dyadic, n_attr_interaction;
+  change_stats_func_t **change_stats_funcs;
+  double *lambda_values;
+  attr_change_stats_func_t **attr_change_stats_funcs;
+  dyadic_change_stats_func_t **dyadic_change_stats_funcs;
+  attr_interaction_change_stats_func_t **attr_interaction_change_stats_funcs;
+  uint_t *attr_indices;
+  uint_pair_t *attr_interaction_pair_indices;
+  double *theta;
+  uint_t      num_threads;
+  uint_t      batch_size;  /* number of proposals in current batch */
+  nodepair_t *dyads;       /* batch_size proposed dyads */
+  bool       *isDelete;    /* for each dyad, TRUE if it is an arc in g */
+  double     *changestats; /* n change statistics for each dyad */
+  double     *totals;      /* sum of theta*changestats for each dyad */
+  bool        earlyReject; /* see calcChangeStatsEarlyReject() */
+  double     *urands;      /* acceptance random number for each dyad */
+  double     *log_urands;  /* and its approximate log */
+  bool        finished;    /* set when there are no more batches */
+  pthread_barrier_t start_barrier; /* batch ready to evaluate */
+  pthread_barrier_t done_barrier;  /* batch evaluated */
+} sampler_batch_t;
+
+typedef struct sampler_batch_thread_s {
+  sampler_batch_t *batch;
+  uint_t           thread_index;
+} sampler_batch_thread_t;
+
+/*
+ * Compute change statistics for proposal b of the batch on the current
+ * graph (which is not modified).
+ */
+static void evaluate_proposal(sampler_batch_t *s, uint_t b)
+{
+  uint_t i = s->dyads[b].i, j = s->dyads[b].j;
+
+  s->isDelete[b] = isArc(s->g, i, j);
+  if (s->earlyReject) {
+    s->totals[b] = calcChangeStatsEarlyReject(s->g, i, j, s->n, s->n_attr,
+                                    s->n_dyadic, s->n_attr_interaction,
+                                    s->change_stats_funcs, s->lambda_values,
+                                    s->attr_change_stats_funcs,
+                                    s->dyadic_change_stats_funcs,
+                                    s->attr_interaction_change_stats_funcs,
+                                    s->attr_indices,
+                                    s->attr_interaction_pair_indices,
+                                    s->theta, s->isDelete[b],
+                                    s->log_urands[b] - PRNG_LOG_URAND_ERROR,
+                                    &s->changestats[b * s->n]);
+    return;
+  }
+  s->totals[b] = calcChangeStats(s->g, i, j, s->n, s->n_attr, s->n_dyadic,
+                                 s->n_attr_interaction, s->change_stats_funcs,
+                                 s->lambda_values, s->attr_change_stats_funcs,
+                                 s->dyadic_change_stats_funcs,
+                                 s->attr_interaction_change_stats_funcs,
+                                 s->attr_indices,
+                                 s->attr_interaction_pair_indices, s->theta,
+                                 s->isDelete[b], &s->changestats[b * s->n]);
+}
+
+/*
+ * Evaluate this thread's share (every num_threads-th proposal) of a batch.
+ */
+static void evaluate_batch_share(sampler_batch_t *s, uint_t thread_index)
+{
+  uint_t b;
+
+  for (b = thread_index; b < s->batch_size; b += s->num_threads)
+    evaluate_proposal(s, b);
+}
+
+/*
+ * Worker thread for basicSamplerThreaded(): evaluate its share of each
+ * batch between the start and done barriers until finished.
+ */
+static void *sampler_batch_thread(void *arg)
+{
+  sampler_batch_thread_t *t = (sampler_batch_thread_t *)arg;
+  sampler_batch_t *s = t->batch;
+
+  while (TRUE) {
+    pthread_barrier_wait(&s->start_barrier);
+    if (s->finished)
+      break;
+    evaluate_batch_share(s, t->thread_index);
+    pthread_barrier_wait(&s->done_barrier);
+  }
+  return NULL;
+}
+
+/*
+ * Mark node i and all its neighbours (either direction) as changed in
+ * this batch. A proposal whose change statistics were computed before
+ * the change must then be evaluated again if either of its nodes is
+ * marked, as the statistics only read arcs and two-path counts between
+ * nodes that are in or adjacent to the proposed dyad.
+ */
+static void mark_changed(const digraph_t *g, uint_t i, uint_t stamp[],
+                         uint_t batch_num)
+{
+  uint_t k;
+
+  stamp[i] = batch_num;
+  for (k = 0; k < g->outdegree[i]; k++)
+    stamp[g->arclist[i][k]] = batch_num;
+  for (k = 0; k < g->indegree[i]; k++)
+    stamp[g->revarclist[i][k]] = batch_num;
+}
+
+/*
+ * Basic ERGM MCMC sampler as basicSampler() but with the change
+ * statistics of the proposals computed by num_threads threads in
+ * parallel. Proposals are drawn and evaluated in batches on the current
+ * graph, then accepted or rejected (and the moves performed) one at a
+ * time in order. A proposal near a move already performed in the same
+ * batch (i.e. one of its nodes is, or is adjacent to, a node of the
+ * changed arc) is evaluated again on the changed graph before it is
+ * accepted or rejected. The random numbers are drawn in the same order
+ * as basicSampler() and each proposal is accepted or rejected on the
+ * basis of its change statistics on the graph as it is at that point in
+ * the chain, so the result is exactly the same as from basicSampler().
+ *
+ * Conditional estimation and forbidReciprocity depend on the current
+ * graph to draw the proposal, so in those cases (or if num_threads <= 1,
+ * or if built with USE_POW_LOOKUP whose tables are extended on demand)
+ * this just calls basicSampler().
+ *
+ * Parameters:
+ *   As for basicSampler(), and
+ *   num_threads - number of threads (including the calling thread)
+ *
+ * Return value:
+ *   Acceptance rate.
+ */
+double basicSamplerThreaded(digraph_t *g,  uint_t n, uint_t n_attr,
+                            uint_t n_dyadic, uint_t n_attr_interaction,
+                            change_stats_func_t *change_stats_funcs[],
+                            double lambda_values[],
+                            attr_change_stats_func_t *attr_change_stats_funcs[],
+                            dyadic_change_stats_func_t *dyadic_change_stats_funcs[],
+                            attr_interaction_change_stats_func_t
+                                     *attr_interaction_change_stats_funcs[],
+                            uint_t attr_indices[],
+                            uint_pair_t attr_interaction_pair_indices[],
+                            double theta[],
+                            double addChangeStats[], double delChangeStats[],
+                            uint_t sampler_m,
+                            bool performMove,
+                            bool useConditionalEstimation,
+                            bool forbidReciprocity,
+                            bool earlyReject,
+                            prng_t *prng, sampler_workspace_t *ws,
+                            uint_t num_threads)
+{
+  sampler_batch_t s;
+  sampler_batch_thread_t *targs;
+  pthread_t *threads;
+  uint_t    *stamp;      /* batch number in which node last marked changed */
+  double    *urands;     /* acceptance random number for each proposal */
+  uint_t     max_batch;
+  uint_t     accepted = 0, reevaluated = 0;
+  uint_t     i, j, k, b, l;
+  double    *changestats;
+
+#ifdef USE_POW_LOOKUP
+  num_threads = 1;
+#endif
+  if (num_threads <= 1 || useConditionalEstimation || forbidReciprocity)
+    return basicSampler(g, n, n_attr, n_dyadic, n_attr_interaction,
+                        change_stats_funcs, lambda_values,
+                        attr_change_stats_funcs, dyadic_change_stats_funcs,
+                        attr_interaction_change_stats_funcs, attr_indices,
+                        attr_interaction_pair_indices, theta,
+                        addChangeStats, delChangeStats, sampler_m,
+                        performMove, useConditionalEstimation,
+                        forbidReciprocity, earlyReject, prng, ws);
+
+  max_batch = num_threads * PROPOSALS_PER_THREAD;
+  s.g = g;
+  s.n = n;
+  s.n_attr = n_attr;
+  s.n_dyadic = n_dyadic;
+  s.n_attr_interaction = n_attr_interaction;
+  s.change_stats_funcs = change_stats_funcs;
+  s.lambda_values = lambda_values;
+  s.attr_change_stats_funcs = attr_change_stats_funcs;
+  s.dyadic_change_stats_funcs = dyadic_change_stats_funcs;
+  s.attr_interaction_change_stats_funcs = attr_interaction_change_stats_funcs;
+  s.attr_indices = attr_indices;
+  s.attr_interaction_pair_indices = attr_interaction_pair_indices;
+  s.theta = theta;
+  s.num_threads = num_threads;
+  s.batch_size = 0;
+  sampler_workspace_reserve_batch(ws, max_batch, g->num_nodes);
+  s.dyads = ws->dyads;
+  s.isDelete = ws->isDelete;
+  s.changestats = ws->batch_changestats;
+  s.totals = ws->totals;
+  s.earlyReject = earlyReject;
+  s.urands = ws->urands;
+  s.log_urands = ws->log_urands;
+  s.finished = FALSE;
+  urands = ws->urands;
+  stamp = ws->stamp; /* batch numbers continue from earlier calls */
+  targs = (sampler_batch_thread_t *)safe_malloc(num_threads *
+                                              sizeof(sampler_batch_thread_t));
+  threads = (pthread_t *)safe_malloc(num_threads * sizeof(pthread_t));
+
+  pthread_barrier_init(&s.start_barrier, NULL, num_threads);
+  pthread_barrier_init(&s.done_barrier, NULL, num_threads);
+  for (k = 1; k < num_threads; k++) {
+    targs[k].batch = &s;
+    targs[k].thread_index = k;
+    if (pthread_create(&threads[k], NULL, sampler_batch_thread,
+                       &targs[k]) != 0) {
+      fprintf(stderr, "ERROR: could not create sampler thread %u\n", k);
+      exit(1);
+    }
+  }
+
+  for (l = 0; l < n; l++)
+    addChangeStats[l] = delChangeStats[l] = 0;
+
+  for (k = 0; k < sampler_m; k += s.batch_size) {
+    /* draw the proposals and acceptance random numbers in the same
+       order as basicSampler() */
+    s.batch_size = MIN(max_batch, sampler_m - k);
+    for (b = 0; b < s.batch_size; b++) {
+      if (g->block)
+        sample_block_pair(g, prng, &i, &j);
+      else
+        prng_int_urand_pair(prng, g->num_nodes, &i, &j);
+      s.dyads[b].i = i;
+      s.dyads[b].j = j;
+      urands[b] = prng_urand_log(prng, &s.log_urands[b]);
+    }
+    ws->batch_num++;
+
+    pthread_barrier_wait(&s.start_barrier);
+    evaluate_batch_share(&s, 0);
+    pthread_barrier_wait(&s.done_barrier);
+
+    for (b = 0; b < s.batch_size; b++) {
+      i = s.dyads[b].i;
+      j = s.dyads[b].j;
+      if (stamp[i] == ws->batch_num || stamp[j] == ws->batch_num) {
+        evaluate_proposal(&s, b);
+        reevaluated++;
+      }
+      SAMPLER_DEBUG_PRINT(("%s %d -> %d\n", s.isDelete[b] ? "del" : "add",
+                           i, j));
+      if (urand_accept(urands[b], s.log_urands[b], s.totals[b])) {
+        accepted++;
+        if (performMove) {
+          mark_changed(g, i, stamp, ws->batch_num);
+          mark_changed(g, j, stamp, ws->batch_num);
+          if (s.isDelete[b])
+            sampler_removeArc(g, i, j, FALSE);
+          else
+            sampler_insertArc(g, i, j, FALSE);
+        }
+        changestats = &s.changestats[b * n];
+        if (s.isDelete[b]) {
+          for (l = 0; l < n; l++)
+            delChangeStats[l] += changestats[l];
+        } else {
+          for (l = 0; l < n; l++)
+            addChangeStats[l] += changestats[l];
+        }
+      }
+    }
+  }
+  SAMPLER_DEBUG_PRINT(("threaded sampler reevaluated %u of %u proposals\n",
+                       reevaluated, sampler_m));
+
+  s.finished = TRUE;
+  pthread_barrier_wait(&s.start_barrier);
+  for (k = 1; k < num_threads; k++)
+    pthread_join(threads[k], NULL);
+  pthread_barrier_destroy(&s.start_barrier);
+  pthread_barrier_destroy(&s.done_barrier);
+  free(threads);
+  free(targs);
+  return (double)accepted / sampler_m;
+}
+
+/*****************************************************************************
+ *
+ * sampler interface (see sampler.h)
+ *
+ ****************************************************************************/
+
+/*
+ * Run the basic sampler, computing change statistics with
+ * options.num_threads threads (basicSamplerThreaded()) when moves are
+ * performed, or with degree-weighted dyad proposals
+ * (degreeProposalSampler()) if options.degreeProposalWeight is set.
+ */
+static double basic_sampler_run(sampler_t *s, digraph_t *g, double theta[],
+                                double addChangeStats[],
+                                double delChangeStats[],
+                                uint_t sampler_m, bool performMove)
+{
+  const sampler_model_t *m = s->model;
+
+  if (s->options.degreeProposalWeight > 0)
+    return degreeProposalSampler(g, m->n, m->n_attr, m->n_dyadic,
+                                 m->n_attr_interaction, m->change_stats_funcs,
+                                 m->lambda_values, m->attr_change_stats_funcs,
+                                 m->dyadic_change_stats_funcs,
+                                 m->attr_interaction_change_stats_funcs,
+                                 m->attr_indices,
+                                 m->attr_interaction_pair_indices,
+                                 theta, addChangeStats, delChangeStats,
+                                 sampler_m, performMove,
+                                 s->options.earlyReject,
+                                 s->options.degreeProposalWeight,
+                                 s->prng, s->ws);
+  if (performMove && s->options.num_threads > 1)
+    return basicSamplerThreaded(g, m->n, m->n_attr, m->n_dyadic,
+                                m->n_attr_interaction, m->change_stats_funcs,
+                                m->lambda_values, m->attr_change_stats_funcs,
+                                m->dyadic_change_stats_funcs,
+                                m->attr_interaction_change_stats_funcs,
+                                m->attr_indices,
+                                m->attr_interaction_pair_indices, theta,
+                                addChangeStats, delChangeStats, sampler_m,
+                                performMove,
+                                s->options.useConditionalEstimation,
+                                s->options.forbidReciprocity,
+                                s->options.earlyReject, s->prng, s->ws,
+                                s->options.num_threads);
+  else
+    return basicSampler(g, m->n, m->n_attr, m->n_dyadic,
+                        m->n_attr_interaction, m->change_stats_funcs,
+                        m->lambda_values, m->attr_change_stats_funcs,
+                        m->dyadic_change_stats_funcs,
+                        m->attr_interaction_change_stats_funcs,
+                        m->attr_indices, m->attr_interaction_pair_indices,
+                        theta, addChangeStats, delChangeStats, sampler_m,
+                        performMove, s->options.useConditionalEstimation,
+                        s->options.forbidReciprocity,
+                        s->options.earlyReject, s->prng, s->ws);
+}
+
+const sampler_ops_t basic_sampler_ops = {
+  "basic",            /* name */
+  TRUE,               /* divisible */
+  0,                  /* state_size */
+  NULL,               /* create */
+  NULL,               /* init */
+  basic_sampler_run,  /* run */
+  NULL,               /* arc_stats */
+  NULL                /* destroy */
+};
@@ -48,10 +48,14 @@
  ****************************************************************************/
 
 #include "changeStatisticsDirected.h"
+#include "sampler.h"
+
+extern const sampler_ops_t basic_sampler_ops;
 
 double basicSampler(digraph_t *g,  uint_t n, uint_t n_attr, uint_t n_dyadic,
                     uint_t n_attr_interaction,
                     change_stats_func_t *change_stats_funcs[],
+                    double lambda_values[],
                     attr_change_stats_func_t *attr_change_stats_funcs[],
                     dyadic_change_stats_func_t *dyadic_change_stats_funcs[],
                     attr_interaction_change_stats_func_t
@@ -63,7 +67,49 @@ double basicSampler(digraph_t *g,  uint_t n, uint_t n_attr, uint_t n_dyadic,
                     uint_t sampler_m,
                     bool performMove,
                     bool useConditionalEstimation,
-                    bool forbidReciprocity);
+                    bool forbidReciprocity,
+                    bool earlyReject,
+                    prng_t *prng, sampler_workspace_t *ws);
+
+double basicSamplerThreaded(digraph_t *g,  uint_t n, uint_t n_attr,
+                            uint_t n_dyadic, uint_t n_attr_interaction,
+                            change_stats_func_t *change_stats_funcs[],
+                            double lambda_values[],
+                            attr_change_stats_func_t *attr_change_stats_funcs[],
+                            dyadic_change_stats_func_t *dyadic_change_stats_funcs[],
+                            attr_interaction_change_stats_func_t
+                                     *attr_interaction_change_stats_funcs[],
+                            uint_t attr_indices[],
+                            uint_pair_t attr_interaction_pair_indices[],
+                            double theta[],
+                            double addChangeStats[], double delChangeStats[],
+                            uint_t sampler_m,
+                            bool performMove,
+                            bool useConditionalEstimation,
+                            bool forbidReciprocity,
+                            bool earlyReject,
+                            prng_t *prng, sampler_workspace_t *ws,
+                            uint_t num_threads);
+
+double degreeProposalSampler(digraph_t *g,  uint_t n, uint_t n_attr,
+                             uint_t n_dyadic, uint_t n_attr_interaction,
+                             change_stats_func_t *change_stats_funcs[],
+                             double lambda_values[],
+                             attr_change_stats_func_t
+                                         *attr_change_stats_funcs[],
+                             dyadic_change_stats_func_t
+                                         *dyadic_change_stats_funcs[],
+                             attr_interaction_change_stats_func_t
+                                     *attr_interaction_change_stats_funcs[],
+                             uint_t attr_indices[],
+                             uint_pair_t attr_interaction_pair_indices[],
+                             double theta[],
+                             double addChangeStats[], double delChangeStats[],
+                             uint_t sampler_m,
+                             bool performMove,
+                             bool earlyReject,
+                             double degreeProposalWeight,
+                             prng_t *prng, sampler_workspace_t *ws);
 
 #endif /* BASICSAMPLER_H */
 
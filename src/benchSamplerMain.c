@@ -0,0 +1,851 @@
+/*****************************************************************************
+ *
+ * File:    benchSamplerMain.c
+ * Author:  Alex Stivala
+ * Created: October 2026
+ *
+ * End-to-end throughput benchmark of the MCMC samplers. Each sampler
+ * (basic, IFD, TNT and MTM, or the conditional variant of each if the
+ * network has snowball sampling zones, or both with synthetic zones) is run for a fixed number of
+ * proposals on the same network, with the model and parameter values
+ * of a SimulateERGM configuration file, and the results written to
+ * stdout as CSV with the columns:
+ *
+ *   sampler            name of the sampler
+ *   conditional        1 for the conditional (snowball sample) variant
+ *   nodes              number of nodes
+ *   arcs               number of arcs (inner arcs if conditional)
+ *   proposals          number of proposals (MTM steps for MTM)
+ *   seconds            elapsed time of the proposals with moves made
+ *   proposals_per_sec  throughput
+ *   acceptance_rate    fraction of proposals accepted
+ *   changestats_seconds elapsed time of the same number of proposals
+ *                      without making the moves (the change statistics
+ *                      and proposal generation only)
+ *   update_seconds     seconds minus changestats_seconds: the time
+ *                      spent updating the graph (arc lists and two-path
+ *                      tables) for the accepted moves
+ *   update_fraction    update_seconds / seconds
+ *   peak_rss_kb        peak resident set size of the process so far
+ *
+ * The network is that of the configuration (initialArclistFile, or
+ * snapshotFile with initialSnapshotArcs, and zoneFile or the zones of
+ * the snapshot), or with -n a synthetic network generated here, so the
+ * benchmark needs no data files and can show the scaling from 10^4 to
+ * 10^7 nodes: an Erdos-Renyi random digraph (-g er, the default) or a
+ * Chung-Lu random digraph with power law expected in- and out-degree
+ * distributions (-g powerlaw), with the given mean degree, and with -z
+ * snowball sampling zones from a breadth-first search of the given
+ * number of waves from random seed nodes. The synthetic networks have
+ * no node attributes, so the model can have only structural
+ * parameters.
+ *
+ * The network is restored to its initial arcs after each sampler, so
+ * every sampler starts from the same network. The unconditional
+ * samplers cannot be used on a network with zones, so with the zones
+ * of the configuration only the conditional variants are run.
+ *
+ * With -r the samplers are not run, but instead a trace of the
+ * proposals of a SimulateERGM run (proposalTraceFile, see
+ * proposalTrace.h) with the same configuration is replayed: starting
+ * from the initial arcs of the trace, the change statistics of each
+ * proposal are computed and the moves made as in the run traced, so
+ * the exact same work can be timed with each two-path lookup method
+ * (-b, overriding twoPathBackend) and its change statistics checked
+ * to agree bit for bit with those of the run. The result is one CSV
+ * line with the columns:
+ *
+ *   backend            two-path lookup method (quoted)
+ *   proposals          number of proposals in the trace
+ *   seconds            elapsed time of the change statistics and moves
+ *   proposals_per_sec  throughput
+ *   mismatches         number of proposals whose change statistics
+ *                      differ from those of the run traced
+ *   unchecked          number of proposals rejected early in the run
+ *                      (earlyReject), so not checked
+ *   first_mismatch     number (from 0) of the first proposal that
+ *                      differs, or -1 if none
+ *
+ *   Usage: bench_sampler [-p proposals] [-s seed] [-n nodes
+ *                        [-d meandegree] [-g er|powerlaw] [-z waves
+ *                        [-k seeds]]] [-r trace_file] [-b backend]
+ *                        sim_config_filename
+ *
+ ****************************************************************************/
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <math.h>
+#include <limits.h>
+#include <getopt.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include "utils.h"
+#include "digraph.h"
+#include "loadDigraph.h"
+#include "digraphSnapshot.h"
+#include "simconfigparser.h"
+#include "sampler.h"
+#include "ifdSampler.h"
+#include "largeAlloc.h"
+#include "proposalTrace.h"
+
+#define DEFAULT_PROPOSALS   1000000
+#define DEFAULT_MEAN_DEGREE 5.0
+#define DEFAULT_NUM_SEEDS   10
+#define POWERLAW_EXPONENT   2.5  /* of the Chung-Lu degree distribution */
+#define TRACE_BATCH         65536 /* proposal trace records read at once */
+
+/*****************************************************************************
+ *
+ * Local functions
+ *
+ ****************************************************************************/
+
+static void usage(const char *progname)
+{
+  fprintf(stderr,
+          "Usage: %s [-p proposals] [-s seed] [-n nodes [-d meandegree] "
+          "[-g er|powerlaw] [-z waves [-k seeds]]] [-r trace_file] "
+          "[-b backend] sim_config_filename\n",
+          progname);
+  exit(1);
+}
+
+/*
+ * Peak resident set size of this process.
+ *
+ * Parameters:
+ *   None
+ *
+ * Return value:
+ *   Peak resident set size in kilobytes.
+ */
+static long peak_rss_kb(void)
+{
+  struct rusage usage;
+
+  getrusage(RUSAGE_SELF, &usage);
+  return (long)usage.ru_maxrss; /* kilobytes on Linux */
+}
+
+/*
+ * Index of the first entry of an ascending array of cumulative weights
+ * that is greater than x (or the last entry if there is none).
+ *
+ * Parameters:
+ *   cumweight - cumulative weights, ascending
+ *   n         - length of cumweight
+ *   x         - value to find
+ *
+ * Return value:
+ *   Index k with cumweight[k-1] <= x < cumweight[k].
+ */
+static uint_t bsearch_cumulative(const double cumweight[], uint_t n, double x)
+{
+  uint_t lo = 0, hi = n - 1, mid;
+
+  while (lo < hi) {
+    mid = lo + (hi - lo) / 2;
+    if (cumweight[mid] > x)
+      hi = mid;
+    else
+      lo = mid + 1;
+  }
+  return lo;
+}
+
+/*
+ * Add random arcs to the empty digraph g: num_arcs arcs i->j (i != j)
+ * with i and j uniform (Erdos-Renyi) or drawn independently with
+ * probability proportional to the Chung-Lu weight (k+1)^(-1/(gamma-1))
+ * of node k, which gives power law in- and out-degree distributions
+ * with exponent gamma. Duplicate arcs are dropped, so there can be
+ * slightly fewer than num_arcs arcs.
+ *
+ * Parameters:
+ *   g         - empty digraph (no arcs) to add arcs to
+ *   num_arcs  - number of arcs to draw
+ *   powerlaw  - TRUE for Chung-Lu, FALSE for Erdos-Renyi
+ *   prng      - pseudorandom number generator stream (updated)
+ *
+ * Return value:
+ *   None.
+ */
+static void make_synthetic_digraph(digraph_t *g, arcidx_t num_arcs,
+                                   bool powerlaw, prng_t *prng)
+{
+  uint_t      n = g->num_nodes;
+  nodepair_t *arcs = (nodepair_t *)safe_malloc(num_arcs * sizeof(nodepair_t));
+  double     *cumweight = NULL;
+  arcidx_t    a;
+  uint_t      k, i, j;
+
+  if (powerlaw) {
+    cumweight = (double *)safe_malloc(n * sizeof(double));
+    for (k = 0; k < n; k++)
+      cumweight[k] = (k > 0 ? cumweight[k-1] : 0) +
+        pow(k + 1, -1.0 / (POWERLAW_EXPONENT - 1));
+  }
+  for (a = 0; a < num_arcs; a++) {
+    if (powerlaw) {
+      do {
+        i = bsearch_cumulative(cumweight, n, prng_urand(prng) * cumweight[n-1]);
+        j = bsearch_cumulative(cumweight, n, prng_urand(prng) * cumweight[n-1]);
+      } while (i == j);
+    } else {
+      prng_int_urand_pair(prng, n, &i, &j);
+    }
+    arcs[a].i = i;
+    arcs[a].j = j;
+  }
+  build_digraph_arcs(g, arcs, num_arcs);
+  free(cumweight);
+  free(arcs);
+}
+
+/*
+ * Set snowball sampling zones of the digraph g from a breadth-first
+ * search (ignoring arc direction) of up to num_waves waves from
+ * num_seeds distinct random seed nodes (zone 0). Nodes not reached
+ * are put in the last zone, which is num_waves unless the search
+ * ended before that.
+ *
+ * Parameters:
+ *   g         - digraph with its arcs, zones set here
+ *   num_waves - number of waves (maximum zone)
+ *   num_seeds - number of seed nodes
+ *   prng      - pseudorandom number generator stream (updated)
+ *
+ * Return value:
+ *   0 if OK else nonzero on error (message printed to stderr).
+ */
+static int make_snowball_zones(digraph_t *g, uint_t num_waves,
+                               uint_t num_seeds, prng_t *prng)
+{
+  uint_t  n = g->num_nodes;
+  uint_t *zone = (uint_t *)safe_malloc(n * sizeof(uint_t));
+  uint_t *queue = (uint_t *)safe_malloc(n * sizeof(uint_t));
+  uint_t  head = 0, tail = 0, max_zone = 0, unreached_zone;
+  uint_t  i, k, u, v;
+  bool    unreached = FALSE;
+  int     rc;
+
+  if (num_seeds > n)
+    num_seeds = n;
+  for (i = 0; i < n; i++)
+    zone[i] = UINT_MAX;
+  while (tail < num_seeds) {
+    u = prng_int_urand(prng, n);
+    if (zone[u] == UINT_MAX) {
+      zone[u] = 0;
+      queue[tail++] = u;
+    }
+  }
+  while (head < tail) {
+    u = queue[head++];
+    max_zone = MAX(max_zone, zone[u]);
+    if (zone[u] == num_waves)
+      continue;
+    for (k = 0; k < g->outdegree[u] + g->indegree[u]; k++) {
+      v = k < g->outdegree[u] ? g->arclist[u][k] :
+        g->revarclist[u][k - g->outdegree[u]];
+      if (zone[v] == UINT_MAX) {
+        zone[v] = zone[u] + 1;
+        queue[tail++] = v;
+      }
+    }
+  }
+  /* the unreached nodes are adjacent only to each other and to nodes
+     of the last wave, so can be in the zone after the last one found
+     (or in the last wave) */
+  unreached_zone = MIN(max_zone + 1, num_waves);
+  for (i = 0; i < n; i++) {
+    if (zone[i] == UINT_MAX) {
+      zone[i] = unreached_zone;
+      unreached = TRUE;
+    }
+  }
+  if (unreached)
+    max_zone = MAX(max_zone, unreached_zone);
+  rc = set_digraph_zones(g, zone);
+  if (!rc && max_zone < 1) {
+    fprintf(stderr, "ERROR: snowball sample has only one zone\n");
+    rc = -1;
+  }
+  free(queue);
+  free(zone);
+  return rc;
+}
+
+/*
+ * Load the network of the configuration: its nodes and attributes,
+ * the arcs of initialArclistFile or the snapshot (initialSnapshotArcs)
+ * and the snowball sampling zones. As in do_simulation() but with no
+ * output files.
+ *
+ * Parameters:
+ *   config - configuration settings
+ *
+ * Return value:
+ *   Digraph loaded, or NULL on error (message printed to stderr).
+ */
+static digraph_t *load_config_digraph(const sim_config_t *config)
+{
+  digraph_t   *g;
+  const char **columns;
+  uint_t       num_columns;
+
+  /* only the attribute columns the model refers to */
+  num_columns = get_model_attribute_names(&config->param_config, &columns);
+  if (config->snapshot_filename) {
+    g = load_digraph_snapshot(config->snapshot_filename, num_columns,
+                              columns);
+    free(columns);
+    if (!g)
+      return NULL;
+  } else {
+    g = allocate_digraph(config->numNodes);
+    set_attribute_columns(g, num_columns, columns);
+    free(columns);
+    if (load_attributes(g, config->binattr_filename,
+                        config->catattr_filename,
+                        config->contattr_filename,
+                        config->setattr_filename,
+                        config->dyadcov_filename)) {
+      fprintf(stderr, "ERROR: loading node attributes failed\n");
+      return NULL;
+    }
+  }
+  set_hub_degree_threshold(g, config->hubDegreeThreshold);
+  set_arc_bitmatrix(g, config->useArcBitMatrix);
+  set_twopath_build_threads(g, config->numThreadsLoad);
+  set_twopath_update_threads(g, config->numThreadsHubUpdate,
+                             config->hubUpdateDegree);
+  if (config->initial_arclist_filename) {
+    if (!load_digraph_from_arclist_mmap(config->initial_arclist_filename, g,
+                                        FALSE, 0, 0, 0, 0, NULL, NULL, NULL,
+                                        NULL, NULL, NULL, NULL, NULL, NULL))
+      return NULL;
+  } else if (config->initialSnapshotArcs && config->snapshot_filename) {
+    if (load_digraph_snapshot_arcs(g))
+      return NULL;
+  }
+  if (config->snapshot_filename) {
+    if (load_digraph_snapshot_zones(g)) {
+      fprintf(stderr, "ERROR: snowball sampling zones in %s are invalid\n",
+              config->snapshot_filename);
+      return NULL;
+    }
+  } else if (config->zone_filename) {
+    if (add_snowball_zones_to_digraph(g, config->zone_filename)) {
+      fprintf(stderr, "ERROR: reading snowball sampling zones from %s failed\n",
+              config->zone_filename);
+      return NULL;
+    }
+  }
+  return g;
+}
+
+/*
+ * Run a sampler for a number of proposals and time it.
+ *
+ * Parameters:
+ *   s           - sampler, initialized with sampler_init()
+ *   g           - digraph (updated if performMove)
+ *   theta       - parameter values
+ *   proposals   - number of proposals
+ *   performMove - if TRUE make the accepted moves
+ *   acceptance  - (out) acceptance rate
+ *
+ * Return value:
+ *   Elapsed time in seconds.
+ */
+static double timed_sampler_run(sampler_t *s, digraph_t *g, double theta[],
+                                uint_t proposals, bool performMove,
+                                double *acceptance)
+{
+  struct timeval start_timeval, end_timeval, elapsed_timeval;
+
+  gettimeofday(&start_timeval, NULL);
+  *acceptance = sampler_run(s, g, theta, s->ws->addChangeStats,
+                            s->ws->delChangeStats, proposals, performMove);
+  gettimeofday(&end_timeval, NULL);
+  timeval_subtract(&elapsed_timeval, &end_timeval, &start_timeval);
+  return elapsed_timeval.tv_sec + 1e-6 * elapsed_timeval.tv_usec;
+}
+
+/*
+ * Benchmark one sampler: run it for the proposals without making the
+ * moves, then again (from the same initial state) making them, write
+ * the CSV line of results to stdout, and restore the initial arcs of g.
+ *
+ * Parameters:
+ *   g            - digraph
+ *   type         - sampler type
+ *   model        - model (change statistics)
+ *   options      - sampler options
+ *   prng         - pseudorandom number generator stream (updated)
+ *   ws           - sampler workspace for model->n parameters
+ *   theta        - parameter values
+ *   arc_param_index - index of Arc parameter (for IFD sampler)
+ *   proposals    - number of proposals
+ *   arcs         - initial arcs (inner arcs if conditional)
+ *   num_arcs     - number of initial arcs
+ *
+ * Return value:
+ *   None.
+ */
+static void bench_sampler(digraph_t *g, sampler_type_e type,
+                          const sampler_model_t *model,
+                          const sampler_options_t *options, prng_t *prng,
+                          sampler_workspace_t *ws, double theta[],
+                          uint_t arc_param_index, uint_t proposals,
+                          const nodepair_t *arcs, arcidx_t num_arcs)
+{
+  sampler_t *s = allocate_sampler(type, model, options, prng, ws);
+  double     ifd_aux_param = 0, acceptance, stats_secs, secs, update_secs;
+
+  if (type == SAMPLER_IFD)
+    ifd_aux_param = theta[arc_param_index] + arcCorrection(g);
+  fprintf(stderr, "%s sampler%s: %u proposals\n", s->ops->name,
+          options->useConditionalEstimation ? " (conditional)" : "",
+          proposals);
+  set_change_stats_caches(g, model->n - model->n_attr - model->n_dyadic -
+                          model->n_attr_interaction,
+                          model->change_stats_funcs, model->lambda_values,
+                          model->n_attr, model->attr_change_stats_funcs,
+                          model->attr_indices, model->n_attr_interaction,
+                          model->attr_interaction_change_stats_funcs,
+                          model->attr_interaction_pair_indices);
+  sampler_init(s, g, ifd_aux_param);
+  stats_secs = timed_sampler_run(s, g, theta, proposals, FALSE, &acceptance);
+  sampler_init(s, g, ifd_aux_param);
+  secs = timed_sampler_run(s, g, theta, proposals, TRUE, &acceptance);
+  /* the difference is not exact as the graph changes as moves are made,
+     so can be slightly negative if there are few accepted moves */
+  update_secs = MAX(secs - stats_secs, 0);
+  printf("%s,%d,%u,%lu,%u,%.6f,%.1f,%.6f,%.6f,%.6f,%.4f,%ld\n",
+         s->ops->name, options->useConditionalEstimation ? 1 : 0,
+         g->num_nodes, (unsigned long)num_arcs, proposals, secs,
+         secs > 0 ? proposals / secs : 0, acceptance, stats_secs,
+         update_secs, secs > 0 ? update_secs / secs : 0, peak_rss_kb());
+  fflush(stdout);
+  replace_digraph_arcs(g, arcs, num_arcs, options->useConditionalEstimation);
+  free_sampler(s);
+}
+
+/*
+ * Replay a proposal trace: put the initial arcs of the trace in g, then
+ * for each proposal compute the change statistics, check them against
+ * those of the run traced, and make the move if it was made in the run,
+ * and write the CSV line of results to stdout.
+ *
+ * Parameters:
+ *   g              - digraph of the configuration of the run traced
+ *   model          - model (change statistics) of the run traced
+ *   theta          - parameter values
+ *   trace_filename - name of the trace file
+ *
+ * Return value:
+ *   0 if OK else -1 on error (message printed to stderr). Statistics
+ *   that do not agree are not an error, but are counted in the results.
+ */
+static int replay_proposal_trace(digraph_t *g, const sampler_model_t *model,
+                                 double theta[], const char *trace_filename)
+{
+  proposal_trace_t        *trace;
+  proposal_trace_record_t *records;
+  nodepair_t              *arcs;
+  arcidx_t                 num_arcs;
+  double                  *changestats;
+  struct timeval           start_timeval, end_timeval, elapsed_timeval;
+  double                   secs = 0;
+  ulonglong_t              num = 0, mismatches = 0, unchecked = 0;
+  long long                first_mismatch = -1;
+  uint_t                   num_records, k, i, j;
+#ifdef BATCHSTATS_FLOAT
+  uint_t                   l;
+#endif /* BATCHSTATS_FLOAT */
+  bool                     isDelete;
+  int                      rc = 0;
+
+  if (!(trace = open_proposal_trace_replay(trace_filename, &arcs,
+                                           &num_arcs)))
+    return -1;
+  if (trace->num_nodes != g->num_nodes || trace->n != model->n ||
+      (trace->inner && g->max_zone == 0)) {
+    fprintf(stderr, "ERROR: proposal trace %s (%u nodes, %u parameters%s) "
+            "is not of this network and model (%u nodes, %u parameters%s)\n",
+            trace_filename, trace->num_nodes, trace->n,
+            trace->inner ? ", conditional" : "", g->num_nodes, model->n,
+            g->max_zone > 0 ? ", zones" : "");
+    free(arcs);
+    close_proposal_trace(trace);
+    return -1;
+  }
+  replace_digraph_arcs(g, arcs, num_arcs, trace->inner);
+  free(arcs);
+  set_change_stats_caches(g, model->n - model->n_attr - model->n_dyadic -
+                          model->n_attr_interaction,
+                          model->change_stats_funcs, model->lambda_values,
+                          model->n_attr, model->attr_change_stats_funcs,
+                          model->attr_indices, model->n_attr_interaction,
+                          model->attr_interaction_change_stats_funcs,
+                          model->attr_interaction_pair_indices);
+  fprintf(stderr, "replaying proposal trace %s from %lu %sarcs\n",
+          trace_filename, (unsigned long)num_arcs,
+          trace->inner ? "inner " : "");
+  records = (proposal_trace_record_t *)safe_malloc(
+    TRACE_BATCH * sizeof(proposal_trace_record_t));
+  changestats = (double *)safe_malloc(MAX(model->n, 1) * sizeof(double));
+  while (rc == 0 &&
+         (num_records = read_proposal_trace(trace, records, TRACE_BATCH))) {
+    gettimeofday(&start_timeval, NULL);
+    for (k = 0; k < num_records; k++, num++) {
+      i = records[k].i;
+      j = records[k].j;
+      isDelete = (records[k].flags & PROPOSAL_TRACE_DELETE) != 0;
+      if (i >= g->num_nodes || j >= g->num_nodes || i == j ||
+          isArc(g, i, j) != isDelete) {
+        fprintf(stderr, "ERROR: proposal %llu (%u -> %u) of trace %s does "
+                "not match the network\n", num, i, j, trace_filename);
+        rc = -1;
+        break;
+      }
+      calcChangeStats(g, i, j, model->n, model->n_attr, model->n_dyadic,
+                      model->n_attr_interaction, model->change_stats_funcs,
+                      model->lambda_values, model->attr_change_stats_funcs,
+                      model->dyadic_change_stats_funcs,
+                      model->attr_interaction_change_stats_funcs,
+                      model->attr_indices,
+                      model->attr_interaction_pair_indices, theta, isDelete,
+                      changestats);
+#ifdef BATCHSTATS_FLOAT
+      /* the MTM sampler has the statistics of calcChangeStatsBatch() */
+      if (records[k].flags & PROPOSAL_TRACE_JOURNAL)
+        for (l = 0; l < model->n; l++)
+          changestats[l] = (batchstat_t)changestats[l];
+#endif /* BATCHSTATS_FLOAT */
+      if (records[k].flags & PROPOSAL_TRACE_PARTIAL) {
+        unchecked++;
+      } else if (change_stats_hash(model->n, changestats) !=
+                 records[k].stats_hash) {
+        if (mismatches++ == 0)
+          first_mismatch = (long long)num;
+      }
+      if (!(records[k].flags & PROPOSAL_TRACE_MOVED))
+        continue;
+      /* make the move the same way as the sampler did, so the arc
+         lists are in the same order */
+      if (records[k].flags & PROPOSAL_TRACE_JOURNAL) {
+        begin_arc_journal(g);
+        journal_toggle_arc(g, i, j, isDelete, trace->inner);
+        commit_arc_journal(g);
+      } else if (isDelete) {
+        if (trace->inner)
+          removeArc_allinnerarcs(g, i, j, get_allinnerarcs_index(g, i, j));
+        else
+          removeArc_allarcs(g, i, j, get_allarcs_index(g, i, j));
+      } else {
+        if (trace->inner)
+          insertArc_allinnerarcs(g, i, j);
+        else
+          insertArc_allarcs(g, i, j);
+      }
+    }
+    gettimeofday(&end_timeval, NULL);
+    timeval_subtract(&elapsed_timeval, &end_timeval, &start_timeval);
+    secs += elapsed_timeval.tv_sec + 1e-6 * elapsed_timeval.tv_usec;
+  }
+  if (rc == 0) {
+#ifdef TWOPATH_ADAPTIVE
+    /* quoted as the name can have a comma */
+    printf("\"%s\",", twopath_backend_name(g->twopath_backend));
+#else
+    printf("default,");
+#endif /* TWOPATH_ADAPTIVE */
+    printf("%llu,%.6f,%.1f,%llu,%llu,%lld\n", num, secs,
+           secs > 0 ? num / secs : 0, mismatches, unchecked, first_mismatch);
+    fflush(stdout);
+  }
+  free(changestats);
+  free(records);
+  close_proposal_trace(trace);
+  return rc;
+}
+
+/*****************************************************************************
+ *
+ * Main
+ *
+ ****************************************************************************/
+
+int main(int argc, char *argv[])
+{
+  static const sampler_type_e types[] = {
+    SAMPLER_BASIC, SAMPLER_IFD, SAMPLER_TNT, SAMPLER_MTM
+  };
+  int                  c;
+  char                *endptr;
+  sim_config_t        *config;
+  digraph_t           *g;
+  prng_t               prng;
+  uint_t               proposals = DEFAULT_PROPOSALS;
+  uint64_t             seed = 0;
+  uint_t               num_nodes = 0;
+  double               mean_degree = DEFAULT_MEAN_DEGREE;
+  double               num_arcs;
+  bool                 powerlaw = FALSE;
+  uint_t               num_waves = 0;
+  uint_t               num_seeds = DEFAULT_NUM_SEEDS;
+  uint_t               n_struct, n_attr, n_dyadic, n_attr_interaction;
+  uint_t               num_param, i, t, cond;
+  uint_t               arc_param_index = 0;
+  bool                 foundArc = FALSE;
+  double              *theta;
+  sampler_workspace_t *ws;
+  sampler_model_t      model;
+  sampler_options_t    options;
+  nodepair_t          *arcs;
+  arcidx_t             num_initial_arcs;
+  const char          *trace_filename = NULL;
+  const char          *backend_name = NULL;
+#ifdef TWOPATH_ADAPTIVE
+  twopath_backend_e    backend;
+#endif /* TWOPATH_ADAPTIVE */
+
+  init_prng(0); /* initialize pseudorandom number generator */
+  init_sim_config_parser();
+
+  while ((c = getopt(argc, argv, "p:s:n:d:g:z:k:r:b:")) != -1) {
+    switch (c) {
+      case 'p':
+        proposals = (uint_t)strtoul(optarg, &endptr, 10);
+        if (*endptr != '\0' || proposals == 0)
+          usage(argv[0]);
+        break;
+      case 's':
+        seed = strtoull(optarg, &endptr, 10);
+        if (*endptr != '\0')
+          usage(argv[0]);
+        break;
+      case 'n':
+        num_nodes = (uint_t)strtoul(optarg, &endptr, 10);
+        if (*endptr != '\0' || num_nodes < 2)
+          usage(argv[0]);
+        break;
+      case 'd':
+        mean_degree = strtod(optarg, &endptr);
+        if (*endptr != '\0' || mean_degree <= 0)
+          usage(argv[0]);
+        break;
+      case 'g':
+        if (strcasecmp(optarg, "powerlaw") == 0)
+          powerlaw = TRUE;
+        else if (strcasecmp(optarg, "er") == 0)
+          powerlaw = FALSE;
+        else
+          usage(argv[0]);
+        break;
+      case 'z':
+        num_waves = (uint_t)strtoul(optarg, &endptr, 10);
+        if (*endptr != '\0' || num_waves == 0)
+          usage(argv[0]);
+        break;
+      case 'k':
+        num_seeds = (uint_t)strtoul(optarg, &endptr, 10);
+        if (*endptr != '\0' || num_seeds == 0)
+          usage(argv[0]);
+        break;
+      case 'r':
+        trace_filename = optarg;
+        break;
+      case 'b':
+        backend_name = optarg;
+        break;
+      default:
+        usage(argv[0]);
+        break;
+    }
+  }
+  if (argc - optind != 1 || (num_waves > 0 && num_nodes == 0) ||
+      (trace_filename && num_nodes > 0))
+    usage(argv[0]);
+
+  if (!(config = parse_sim_config_file(argv[optind]))) {
+    fprintf(stderr, "ERROR parsing configuration file %s\n", argv[optind]);
+    exit(1);
+  }
+  if (seed == 0)
+    seed = config->seed;
+  if (seed != 0) /* reproducible run instead of seed from time */
+    set_prng_seed(seed);
+  prng_init_stream(&prng, 0);
+  if (huge_pages_from_name(config->hugePages) == HUGE_PAGES_INVALID ||
+      numa_policy_from_name(config->numaPolicy) == NUMA_POLICY_INVALID) {
+    fprintf(stderr, "ERROR: unknown hugePages or numaPolicy\n");
+    exit(1);
+  }
+  set_large_alloc_policy(huge_pages_from_name(config->hugePages),
+                         numa_policy_from_name(config->numaPolicy));
+#ifdef TWOPATH_ADAPTIVE
+  if (!backend_name)
+    backend_name = config->twoPathBackend;
+  backend = twopath_backend_from_name(backend_name);
+  if (backend == TWOPATH_BACKEND_INVALID) {
+    fprintf(stderr, "ERROR: unknown twoPathBackend %s\n", backend_name);
+    exit(1);
+  }
+#endif /* TWOPATH_ADAPTIVE */
+
+  if (num_nodes > 0) {
+    num_arcs = floor(num_nodes * mean_degree + 0.5);
+    if (num_arcs > (double)MAX_NUM_ARCS ||
+        num_arcs > (double)num_nodes * (num_nodes - 1)) {
+      fprintf(stderr, "ERROR: mean degree %g too large for %u nodes\n",
+              mean_degree, num_nodes);
+      exit(1);
+    }
+    g = allocate_digraph(num_nodes);
+    set_hub_degree_threshold(g, config->hubDegreeThreshold);
+    set_arc_bitmatrix(g, config->useArcBitMatrix);
+    set_twopath_build_threads(g, config->numThreadsLoad);
+    set_twopath_update_threads(g, config->numThreadsHubUpdate,
+                               config->hubUpdateDegree);
+    make_synthetic_digraph(g, (arcidx_t)num_arcs, powerlaw, &prng);
+  } else if (!(g = load_config_digraph(config))) {
+    exit(1);
+  }
+  fprintf(stderr, "%u nodes, %lu arcs, %u zones, %u inner nodes, "
+          "%lu inner arcs\n", g->num_nodes, (unsigned long)g->num_arcs,
+          g->max_zone + 1, g->num_inner_nodes,
+          (unsigned long)g->num_inner_arcs);
+
+  if (build_attr_indices_from_names(&config->param_config, g) != 0) {
+    fprintf(stderr, "ERROR in attribute parameters\n");
+    exit(1);
+  }
+  if (build_dyadic_indices_from_names(&config->param_config, g, TRUE) != 0) {
+    fprintf(stderr, "ERROR in dyadic covariate parameters\n");
+    exit(1);
+  }
+  if (build_attr_interaction_pair_indices_from_names(&config->param_config,
+                                                     g) != 0) {
+    fprintf(stderr, "ERROR in attribute interaction parameters\n");
+    exit(1);
+  }
+  n_struct = config->param_config.num_change_stats_funcs;
+  n_attr = config->param_config.num_attr_change_stats_funcs;
+  n_dyadic = config->param_config.num_dyadic_change_stats_funcs;
+  n_attr_interaction =
+    config->param_config.num_attr_interaction_change_stats_funcs;
+  num_param = n_struct + n_attr + n_dyadic + n_attr_interaction;
+  if (n_attr_interaction > 0) {
+    fprintf(stderr, "ERROR: attribute interaction parameters not "
+            "supported\n");
+    exit(1);
+  }
+  theta = (double *)safe_calloc(num_param, sizeof(double));
+  for (i = 0; i < n_struct; i++) {
+    theta[i] = config->param_config.param_values[i];
+    if (strcasecmp(config->param_config.param_names[i], ARC_PARAM_STR) == 0) {
+      arc_param_index = i;
+      foundArc = TRUE;
+    }
+  }
+  for (i = 0; i < n_attr; i++)
+    theta[n_struct + i] = config->param_config.attr_param_values[i];
+  for (i = 0; i < n_dyadic; i++)
+    theta[n_struct + n_attr + i] = config->param_config.dyadic_param_values[i];
+
+#ifdef TWOPATH_ADAPTIVE
+  set_twopath_tables(g, twopath_tables_used(
+                       n_struct, config->param_config.change_stats_funcs));
+  if (backend == TWOPATH_BACKEND_AUTO)
+    backend = choose_twopath_backend(g, g->num_arcs, config->maxMemoryMB);
+  if (backend == TWOPATH_BACKEND_HYBRID)
+    set_twopath_hub_cutoff(g, choose_twopath_hub_cutoff(g,
+                                                        config->maxMemoryMB));
+  set_twopath_backend(g, backend);
+  fprintf(stderr, "two-path lookup: %s\n",
+          twopath_backend_name(g->twopath_backend));
+#endif /* TWOPATH_ADAPTIVE */
+
+  ws = allocate_sampler_workspace(num_param);
+  model.n = num_param;
+  model.n_attr = n_attr;
+  model.n_dyadic = n_dyadic;
+  model.n_attr_interaction = n_attr_interaction;
+  model.change_stats_funcs = config->param_config.change_stats_funcs;
+  model.lambda_values = config->param_config.param_lambdas;
+  model.attr_change_stats_funcs = config->param_config.attr_change_stats_funcs;
+  model.dyadic_change_stats_funcs =
+    config->param_config.dyadic_change_stats_funcs;
+  model.attr_interaction_change_stats_funcs =
+    config->param_config.attr_interaction_change_stats_funcs;
+  model.attr_indices = config->param_config.attr_indices;
+  model.attr_interaction_pair_indices =
+    config->param_config.attr_interaction_pair_indices;
+  options.ifd_K = config->ifd_K;
+  options.forbidReciprocity = config->forbidReciprocity;
+  options.num_threads = 1;
+  options.mtm_tries = config->mtmTries;
+  options.earlyReject = config->earlyReject;
+  options.degreeProposalWeight = config->degreeProposalWeight;
+  options.partition = NULL;
+
+  if (trace_filename) {
+    printf("backend,proposals,seconds,proposals_per_sec,mismatches,"
+           "unchecked,first_mismatch\n");
+    if (replay_proposal_trace(g, &model, theta, trace_filename))
+      exit(1);
+    free_sampler_workspace(ws);
+    free(theta);
+    free_sim_config_struct(config);
+    exit(0);
+  }
+
+  printf("sampler,conditional,nodes,arcs,proposals,seconds,"
+         "proposals_per_sec,acceptance_rate,changestats_seconds,"
+         "update_seconds,update_fraction,peak_rss_kb\n");
+  /* the unconditional samplers cannot be used once there are zones, as
+     they can remove the arcs connecting a node to the previous wave,
+     so with the zones of the configuration only the conditional
+     variants are run, and the synthetic zones are made after the
+     unconditional samplers are run */
+  for (cond = g->max_zone > 0 ? 1 : 0;
+       cond < (g->max_zone > 0 || num_waves > 0 ? 2 : 1); cond++) {
+    if (cond && num_waves > 0) {
+      if (make_snowball_zones(g, num_waves, num_seeds, &prng))
+        exit(1);
+      fprintf(stderr, "%u zones, %u inner nodes, %lu inner arcs\n",
+              g->max_zone + 1, g->num_inner_nodes,
+              (unsigned long)g->num_inner_arcs);
+    }
+    options.useConditionalEstimation = cond;
+    num_initial_arcs = cond ? g->num_inner_arcs : g->num_arcs;
+    arcs = (nodepair_t *)safe_malloc((num_initial_arcs + 1) *
+                                     sizeof(nodepair_t));
+    memcpy(arcs, cond ? g->allinnerarcs : g->allarcs,
+           num_initial_arcs * sizeof(nodepair_t));
+    for (t = 0; t < sizeof(types) / sizeof(types[0]); t++) {
+      if (types[t] == SAMPLER_IFD && !foundArc) {
+        fprintf(stderr, "IFD sampler skipped as there is no %s parameter\n",
+                ARC_PARAM_STR);
+        continue;
+      }
+      bench_sampler(g, types[t], &model, &options, &prng, ws, theta,
+                    arc_param_index, proposals, arcs, num_initial_arcs);
+    }
+    free(arcs);
+  }
+
+  free_sampler_workspace(ws);
+  free(theta);
+  free_sim_config_struct(config);
+  exit(0);
+}
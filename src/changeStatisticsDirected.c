@@ -45,11 +45,26 @@
  *
  * Do NOT compile with -ffast-math on gcc as we depend on IEEE handling of NaN
  *
+ * The loops over words and over dyads that the compiler can vectorize
+ * (CPU_DISPATCH, see utils.h) are compiled for several instruction
+ * sets, and the best one the CPU supports is chosen when the program
+ * starts, so one executable uses the full vector width on every machine
+ * (see changestats_isa_name()). Build with -DNO_CPU_DISPATCH to compile
+ * them for the target of the build only.
+ *
  ****************************************************************************/
 
+#include <stdio.h>
+#include <string.h>
 #include <math.h>
 #include <assert.h>
+#include <pthread.h>
+#if defined(__aarch64__) && defined(__linux__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif /* __aarch64__ && __linux__ */
 #include "changeStatisticsDirected.h"
+#include "changeStatsProfile.h"
 
    
 /*****************************************************************************
@@ -59,9 +74,21 @@
  ****************************************************************************/
 
 /* 
- * lambda decay parameter for alternating statistics 
+ * default lambda decay parameter for alternating statistics 
+ */
+const double DEFAULT_LAMBDA = 2.0;
+
+/* dyads whose distances are computed at once by batch_geo_distance()
+   and batch_euclidean_distance() */
+#define BATCH_BLOCK 64
+
+/*
+ * Number of neighbours ahead in the adjacency list to prefetch the
+ * two-path table entry for in the alternating statistics, so that
+ * the (almost always missing) cache lines for several neighbours are
+ * being fetched at once rather than each lookup waiting in turn.
  */
-const double lambda = 2.0; /* TODO make it a configuration setting */
+static const uint_t TWOPATH_PREFETCH_DISTANCE = 8;
 
 
 /*****************************************************************************
@@ -79,6 +106,22 @@ static double signum(double x)
   return (0 < x) - (x < 0);
 }
 
+/*
+ * Number of bits set in a 64 bit word. Uses the compiler builtin
+ * (a single instruction where the target has one) if available.
+ */
+static inline uint_t popcount64(uint64_t x)
+{
+#ifdef __GNUC__
+  return (uint_t)__builtin_popcountll(x);
+#else
+  x = x - ((x >> 1) & 0x5555555555555555ULL);
+  x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+  x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+  return (uint_t)((x * 0x0101010101010101ULL) >> 56);
+#endif /* __GNUC__ */
+}
+
 
 /*
  * Size of the intersection of two sets.  Each set is represented by
@@ -158,6 +201,237 @@ double jaccard_index(set_elem_e a[], set_elem_e b[], uint_t n)
   return (union_size == 0) ? 1 : (double)intersection_size / (double)union_size;
 }
 
+/*
+ * Jaccard index (similarity) for two sets packed as bit sets (see
+ * set_to_bitset()). Gives the same value as jaccard_index() on the
+ * unpacked sets, but with word-at-a-time AND, OR and popcount.
+ *
+ * Parameters:
+ *      a      - set as bitset
+ *      b      - set as bitset
+ *      nwords - number of words in a and b
+ *
+ * Return value:
+ *      Jaccard coefficient (similarity) of the two sets a and b
+ */
+CPU_DISPATCH
+double jaccard_index_bits(const uint64_t a[], const uint64_t b[],
+                          uint_t nwords)
+{
+  uint_t k;
+  uint_t intersection_size = 0, union_size = 0;
+
+  for (k = 0; k < nwords; k++) {
+    intersection_size += popcount64(a[k] & b[k]);
+    union_size += popcount64(a[k] | b[k]);
+  }
+  return (union_size == 0) ? 1 : (double)intersection_size / (double)union_size;
+}
+
+/*
+ * Gather a binary attribute (as 0 or 1, NA as 0) of the sender (or
+ * receiver) of each of K dyads, for calcChangeStatsBatch().
+ *
+ * Parameters:
+ *      row      - (out) row[k] is the value for dyad k
+ *      bits     - bit set of the attribute over nodes (g->binattr[a])
+ *      dyads    - the K dyads
+ *      K        - number of dyads
+ *      receiver - if TRUE the value of node j of each dyad, else of i
+ *
+ * Return value:
+ *      None
+ */
+CPU_DISPATCH
+static void gather_binattr(batchstat_t row[], const uint64_t bits[],
+                           const nodepair_t dyads[], uint_t K, bool receiver)
+{
+  uint_t k, v;
+
+  for (k = 0; k < K; k++) {
+    v = receiver ? dyads[k].j : dyads[k].i;
+    row[k] = (batchstat_t)SETATTR_BIT_TEST(bits, v);
+  }
+}
+
+/*
+ * Gather a per-node attribute term (g->contattr_term[a]) of the sender
+ * (or receiver) of each of K dyads, for calcChangeStatsBatch().
+ *
+ * Parameters:
+ *      row      - (out) row[k] is the value for dyad k
+ *      term     - term[v] is the value for node v
+ *      dyads    - the K dyads
+ *      K        - number of dyads
+ *      receiver - if TRUE the value of node j of each dyad, else of i
+ *
+ * Return value:
+ *      None
+ */
+CPU_DISPATCH
+static void gather_attr_term(batchstat_t row[], const contattr_t term[],
+                             const nodepair_t dyads[], uint_t K,
+                             bool receiver)
+{
+  uint_t k;
+
+  if (receiver) {
+    for (k = 0; k < K; k++)
+      row[k] = term[dyads[k].j];
+  } else {
+    for (k = 0; k < K; k++)
+      row[k] = term[dyads[k].i];
+  }
+}
+
+/*
+ * Gather a statistic from the category pair table (see
+ * cat_pair_table_t) for each of K dyads, for calcChangeStatsBatch().
+ * For the Reciprocity statistics this is before the reciprocal arc
+ * is checked.
+ *
+ * Parameters:
+ *      row   - (out) row[k] is the value for dyad k
+ *      t     - category pair table
+ *      bit   - bit of the statistic in the table entries
+ *      dyads - the K dyads
+ *      K     - number of dyads
+ *
+ * Return value:
+ *      None
+ */
+CPU_DISPATCH
+static void gather_cat_pair(batchstat_t row[], const cat_pair_table_t *t,
+                            uint_t bit, const nodepair_t dyads[], uint_t K)
+{
+  uint_t k;
+
+  for (k = 0; k < K; k++)
+    row[k] = (batchstat_t)((CAT_PAIR_BITS(t, dyads[k].i, dyads[k].j) >> bit) &
+                           1);
+}
+
+/*
+ * Geographical distance (GeoDistance, or with logdist LogGeoDistance)
+ * of each of K dyads, for calcChangeStatsBatch(). The dot products of
+ * the unit vectors of a block of dyads are computed first (gathers and
+ * arithmetic that vectorize), in double whatever batchstat_t is, then
+ * the distances from them, giving the same values as
+ * changeGeoDistance() and changeLogGeoDistance().
+ *
+ * Parameters:
+ *      row      - (out) row[k] is the value for dyad k
+ *      coords   - unit vector of each node (g->geo_coords)
+ *      dyads    - the K dyads
+ *      K        - number of dyads
+ *      logdist  - if TRUE the logarithm of the distance (0 if the
+ *                 distance is 0)
+ *
+ * Return value:
+ *      None
+ */
+CPU_DISPATCH
+static void batch_geo_distance(batchstat_t row[], const point3_t coords[],
+                               const nodepair_t dyads[], uint_t K,
+                               bool logdist)
+{
+  const point3_t *pti, *ptj;
+  double          dot[BATCH_BLOCK];
+  uint_t          k, b, len;
+  double          dist;
+
+  for (b = 0; b < K; b += BATCH_BLOCK) {
+    len = MIN(BATCH_BLOCK, K - b);
+    for (k = 0; k < len; k++) {
+      pti = &coords[dyads[b + k].i];
+      ptj = &coords[dyads[b + k].j];
+      /* NaN (all coordinates are NaN for a node with missing lat/long) */
+      dot[k] = pti->x*ptj->x + pti->y*ptj->y + pti->z*ptj->z;
+    }
+    for (k = 0; k < len; k++) {
+      if (isnan(dot[k])) {
+        row[b + k] = 0;
+      } else {
+        dist = geo_distance_cos(dot[k]);
+        row[b + k] = !logdist ? dist : dist > 0 ? log(dist) : 0;
+      }
+    }
+  }
+}
+
+/*
+ * Euclidean distance (EuclideanDistance) of each of K dyads, for
+ * calcChangeStatsBatch(), giving the same values as
+ * changeEuclideanDistance(): the sums of squares of a block of dyads
+ * first (in double), then the square roots.
+ *
+ * Parameters:
+ *      row      - (out) row[k] is the value for dyad k
+ *      coords   - coordinates of each node (g->euclidean_coords)
+ *      dyads    - the K dyads
+ *      K        - number of dyads
+ *
+ * Return value:
+ *      None
+ */
+CPU_DISPATCH
+static void batch_euclidean_distance(batchstat_t row[],
+                                     const point3_t coords[],
+                                     const nodepair_t dyads[], uint_t K)
+{
+  const point3_t *pti, *ptj;
+  double          sumsq[BATCH_BLOCK];
+  uint_t          k, b, len;
+
+  for (b = 0; b < K; b += BATCH_BLOCK) {
+    len = MIN(BATCH_BLOCK, K - b);
+    for (k = 0; k < len; k++) {
+      pti = &coords[dyads[b + k].i];
+      ptj = &coords[dyads[b + k].j];
+      /* -1 (not a sum of squares) if either has missing coordinates */
+      sumsq[k] = (isnan(pti->x) || isnan(ptj->x)) ? -1 :
+        (ptj->x-pti->x)*(ptj->x-pti->x) + (ptj->y-pti->y)*(ptj->y-pti->y) +
+        (ptj->z-pti->z)*(ptj->z-pti->z);
+    }
+    for (k = 0; k < len; k++)
+      row[b + k] = sumsq[k] < 0 ? 0 : sqrt(sumsq[k]);
+  }
+}
+
+/*
+ * Sums of theta*changestats for each of K dyads, for
+ * calcChangeStatsBatch(). The statistics are summed in the same order
+ * as calcChangeStats() (vectorized over the dyads, not the statistics)
+ * so the totals are identical (with BATCHSTATS_FLOAT, identical to those
+ * of the statistics rounded to single precision, summed in double).
+ *
+ * Parameters:
+ *      n           - number of statistics
+ *      K           - number of dyads
+ *      theta       - the n parameter values
+ *      changestats - n x K change statistics, changestats[l*K + k]
+ *                    is statistic l for dyad k
+ *      totals      - (out) the K sums
+ *
+ * Return value:
+ *      None
+ */
+CPU_DISPATCH
+static void batch_totals(uint_t n, uint_t K, const double theta[],
+                         const batchstat_t changestats[], double totals[])
+{
+  const batchstat_t *row;
+  uint_t        l, k;
+
+  for (k = 0; k < K; k++)
+    totals[k] = 0;
+  for (l = 0; l < n; l++) {
+    row = &changestats[l*K];
+    for (k = 0; k < K; k++)
+      totals[k] += theta[l] * row[k];
+  }
+}
+
 
 
 /*****************************************************************************
@@ -173,30 +447,36 @@ double jaccard_index(set_elem_e a[], set_elem_e b[], uint_t n)
 /* 
  * Change statistic for Ac
  */
-double changeArc(const digraph_t *g, uint_t i, uint_t j)
+double changeArc(const digraph_t *g, uint_t i, uint_t j,
+                 double lambda, bool isDelete)
 {
-  (void)g; (void)i; (void)j; /* unused parameters */
+  (void)g; (void)i; (void)j; (void)lambda; (void)isDelete; /* unused */
   return 1;
 }
 
 /*
  * Change statistic for Reciprocity
  */
-double changeReciprocity(const digraph_t *g, uint_t i, uint_t j)
+double changeReciprocity(const digraph_t *g, uint_t i, uint_t j,
+                         double lambda, bool isDelete)
 {
+  (void)lambda; (void)isDelete; /* unused parameters */
   return isArc(g, j, i);
 }
 
 /*
  * Change statistic for Sink 
  */
-double changeSink(const digraph_t *g, uint_t i, uint_t j)
+double changeSink(const digraph_t *g, uint_t i, uint_t j,
+                  double lambda, bool isDelete)
 {
   double delta = 0;
-  if (g->outdegree[i] == 0 && g->indegree[i] != 0) {
+  uint_t adj = isDelete ? 1 : 0; /* arc i->j in g so counted in degrees */
+  (void)lambda; /* unused parameter */
+  if (g->outdegree[i] - adj == 0 && g->indegree[i] != 0) {
     delta--;
   }
-  if (g->outdegree[j] == 0 && g->indegree[j] == 0) {
+  if (g->outdegree[j] == 0 && g->indegree[j] - adj == 0) {
     delta++;
   }
   return delta;
@@ -205,13 +485,16 @@ double changeSink(const digraph_t *g, uint_t i, uint_t j)
 /*
  * Change statistic for Source
  */
-double changeSource(const digraph_t *g, uint_t i, uint_t j)
+double changeSource(const digraph_t *g, uint_t i, uint_t j,
+                    double lambda, bool isDelete)
 {
   double delta = 0;
-  if (g->outdegree[i] == 0 && g->indegree[i] == 0) {
+  uint_t adj = isDelete ? 1 : 0; /* arc i->j in g so counted in degrees */
+  (void)lambda; /* unused parameter */
+  if (g->outdegree[i] - adj == 0 && g->indegree[i] == 0) {
     delta++;
   }
-  if (g->indegree[j] == 0 && g->outdegree[j] != 0) {
+  if (g->indegree[j] - adj == 0 && g->outdegree[j] != 0) {
     delta--;
   }
   return delta;
@@ -220,13 +503,16 @@ double changeSource(const digraph_t *g, uint_t i, uint_t j)
 /*
  * Change statistic for Isolates
  */
-double changeIsolates(const digraph_t *g, uint_t i, uint_t j)
+double changeIsolates(const digraph_t *g, uint_t i, uint_t j,
+                      double lambda, bool isDelete)
 {
   double delta = 0;
-  if (g->indegree[i] == 0 && g->outdegree[i] == 0) {
+  uint_t adj = isDelete ? 1 : 0; /* arc i->j in g so counted in degrees */
+  (void)lambda; /* unused parameter */
+  if (g->indegree[i] == 0 && g->outdegree[i] - adj == 0) {
     delta--;
   }
-  if (g->indegree[j] == 0 && g->outdegree[j] == 0) {
+  if (g->indegree[j] - adj == 0 && g->outdegree[j] == 0) {
     delta--;
   }
   return delta;
@@ -236,36 +522,49 @@ double changeIsolates(const digraph_t *g, uint_t i, uint_t j)
  * Change statistic for two-path (triad census 021C)
  * also known as TwoMixStar
  */
-double changeTwoPath(const digraph_t *g, uint_t i, uint_t j)
+double changeTwoPath(const digraph_t *g, uint_t i, uint_t j,
+                     double lambda, bool isDelete)
 {
+  (void)lambda; (void)isDelete; /* unused parameters */
   return g->indegree[i] + g->outdegree[j] - (isArc(g, j, i) ? 2 : 0);
 }
 
 /*
  * Change statistic for in-2-star (triad census 021U)
  */
-double changeInTwoStars(const digraph_t *g, uint_t i, uint_t j)
+double changeInTwoStars(const digraph_t *g, uint_t i, uint_t j,
+                        double lambda, bool isDelete)
 {
-  (void)i; /* unused parameter */
-  return g->indegree[j];
+  (void)i; (void)lambda; /* unused parameters */
+  return g->indegree[j] - (isDelete ? 1 : 0);
 }
 
 /*
  * Change statistic for out-2-star (triad census 021D)
  */
-double changeOutTwoStars(const digraph_t *g, uint_t i, uint_t j)
+double changeOutTwoStars(const digraph_t *g, uint_t i, uint_t j,
+                         double lambda, bool isDelete)
 {
-  (void)j; /* unused parameter */
-  return g->outdegree[i];
+  (void)j; (void)lambda; /* unused parameters */
+  return g->outdegree[i] - (isDelete ? 1 : 0);
 }
 
 /*
  * Change statistic for transitive triangle (triad census 030T)
  */
-double changeTransitiveTriad(const digraph_t *g, uint_t i, uint_t j)
+double changeTransitiveTriad(const digraph_t *g, uint_t i, uint_t j,
+                             double lambda, bool isDelete)
 {
+#ifdef ORDERED_ARCLIST
+  /* with sorted adjacency lists the neighbour intersections below are
+     exactly the in-, mixed and out-two-path counts for (i, j) */
+  (void)lambda; (void)isDelete; /* unused parameters */
+  return (double)(GET_IN2PATH_ENTRY(g, i, j) + GET_MIX2PATH_ENTRY(g, i, j) +
+                  GET_OUT2PATH_ENTRY(g, i, j));
+#else
   uint_t v,k,l,w;
   uint_t  delta = 0;
+  (void)lambda; (void)isDelete; /* unused parameters */
   for (k = 0; k < g->outdegree[i]; k++) {
     v = g->arclist[i][k];
     if (v == i || v == j)
@@ -283,15 +582,23 @@ double changeTransitiveTriad(const digraph_t *g, uint_t i, uint_t j)
       delta++;
   }
   return (double)delta;
+#endif /* ORDERED_ARCLIST */
 }
 
 /*
  * Change statistic for cyclic triangle (triad census 030C)
  */
-double changeCyclicTriad(const digraph_t *g, uint_t i, uint_t j)
+double changeCyclicTriad(const digraph_t *g, uint_t i, uint_t j,
+                         double lambda, bool isDelete)
 {
+#ifdef ORDERED_ARCLIST
+  /* cyclic triangles j -> v -> i closed by i -> j */
+  (void)lambda; (void)isDelete; /* unused parameters */
+  return (double)GET_MIX2PATH_ENTRY(g, j, i);
+#else
   uint_t v,k;
   uint_t  delta = 0;
+  (void)lambda; (void)isDelete; /* unused parameters */
   for (k = 0; k < g->indegree[i]; k++) {
     v = g->revarclist[i][k];
     if (v == i || v == j)
@@ -300,54 +607,69 @@ double changeCyclicTriad(const digraph_t *g, uint_t i, uint_t j)
       delta++;
   }
   return (double)delta;
+#endif /* ORDERED_ARCLIST */
 }
 
 /*
  * Change statistic for alternating k-in-stars (popularity spread, AinS)
+ * (looked up if g keeps it for lambda, see set_altstar_cache())
  */
-double changeAltInStars(const digraph_t *g, uint_t i, uint_t j)
+double changeAltInStars(const digraph_t *g, uint_t i, uint_t j,
+                        double lambda, bool isDelete)
 {
-  uint_t jindegree = g->indegree[j];
+  uint_t jindegree = g->indegree[j] - (isDelete ? 1 : 0);
   (void)i; /*unused parameter*/
   assert(lambda > 1);
+  if (g->altinstar && !islessgreater(lambda, g->altinstar_lambda))
+    return g->altinstar[2*j + isDelete];
   return lambda * (1 - POW_LOOKUP(1-1/lambda, jindegree));
 }
 
 /*
  * Change statistic for alternating k-out-stars (activity spread, AoutS)
+ * (looked up if g keeps it for lambda, see set_altstar_cache())
  */
-double changeAltOutStars(const digraph_t *g, uint_t i, uint_t j)
+double changeAltOutStars(const digraph_t *g, uint_t i, uint_t j,
+                         double lambda, bool isDelete)
 {
-  uint_t ioutdegree = g->outdegree[i];
+  uint_t ioutdegree = g->outdegree[i] - (isDelete ? 1 : 0);
   (void)j;/*unused parameter*/
   assert(lambda > 1);
+  if (g->altoutstar && !islessgreater(lambda, g->altoutstar_lambda))
+    return g->altoutstar[2*i + isDelete];
   return lambda * (1 - POW_LOOKUP(1-1/lambda, ioutdegree));
 }
 
 /*
  * Change statistic for alternating k-triangles AT-T (path closure)
  */
-double changeAltKTrianglesT(const digraph_t *g, uint_t i, uint_t j)
+double changeAltKTrianglesT(const digraph_t *g, uint_t i, uint_t j,
+                            double lambda, bool isDelete)
 {
-  uint_t v,k;
+  uint_t v,k,kp;
   double  delta = 0;
+  uint_t adj = isDelete ? 1 : 0; /* paths via arc i->j in g */
   assert(lambda > 1);
 
   for (k = 0; k < g->outdegree[i]; k++) {
+    if ((kp = k + TWOPATH_PREFETCH_DISTANCE) < g->outdegree[i])
+      PREFETCH_MIX2PATH_ENTRY(g, i, g->arclist[i][kp]);
     v = g->arclist[i][k];
     if (v == i || v == j)
       continue;
     if (isArc(g, j, v))
       delta += POW_LOOKUP(1-1/lambda,
-                   GET_MIX2PATH_ENTRY(g, i, v));
+                   GET_MIX2PATH_ENTRY(g, i, v) - adj);
   }
   for (k = 0; k < g->indegree[i]; k++) {
+    if ((kp = k + TWOPATH_PREFETCH_DISTANCE) < g->indegree[i])
+      PREFETCH_MIX2PATH_ENTRY(g, g->revarclist[i][kp], j);
     v = g->revarclist[i][k];
     if (v == i || v == j)
       continue;
     if (isArc(g, v, j))
       delta += POW_LOOKUP(1-1/lambda,
-                   GET_MIX2PATH_ENTRY(g, v, j));
+                   GET_MIX2PATH_ENTRY(g, v, j) - adj);
   }
   delta += lambda * (1 - POW_LOOKUP(1-1/lambda,
                              GET_MIX2PATH_ENTRY(g, i, j)));
@@ -358,21 +680,27 @@ double changeAltKTrianglesT(const digraph_t *g, uint_t i, uint_t j)
 /*
  * Change statistic for alternating k-triangles AT-C (cyclic closure)
  */
-double changeAltKTrianglesC(const digraph_t *g, uint_t i, uint_t j)
+double changeAltKTrianglesC(const digraph_t *g, uint_t i, uint_t j,
+                            double lambda, bool isDelete)
 {
-  uint_t v,k;
+  uint_t v,k,kp;
   double delta =0;
+  uint_t adj = isDelete ? 1 : 0; /* paths via arc i->j in g */
   assert(lambda > 1);
 
   for (k = 0; k < g->indegree[i]; k++) {
+    if ((kp = k + TWOPATH_PREFETCH_DISTANCE) < g->indegree[i]) {
+      PREFETCH_MIX2PATH_ENTRY(g, i, g->revarclist[i][kp]);
+      PREFETCH_MIX2PATH_ENTRY(g, g->revarclist[i][kp], j);
+    }
     v = g->revarclist[i][k];
     /*removed as slows significantly: assert(isArc(g, v, i));*/
     if (v == i || v == j)
       continue;
     if (isArc(g, j, v)) {
       delta +=
-        POW_LOOKUP(1-1/lambda, GET_MIX2PATH_ENTRY(g, i, v)) +
-        POW_LOOKUP(1-1/lambda, GET_MIX2PATH_ENTRY(g, v, j));
+        POW_LOOKUP(1-1/lambda, GET_MIX2PATH_ENTRY(g, i, v) - adj) +
+        POW_LOOKUP(1-1/lambda, GET_MIX2PATH_ENTRY(g, v, j) - adj);
     }
   }
   delta +=
@@ -384,23 +712,27 @@ double changeAltKTrianglesC(const digraph_t *g, uint_t i, uint_t j)
 /*
  * Change statistic for alternating k-triangles AT-D (popularity closure)
  */
-double changeAltKTrianglesD(const digraph_t *g, uint_t i, uint_t j)
+double changeAltKTrianglesD(const digraph_t *g, uint_t i, uint_t j,
+                            double lambda, bool isDelete)
 {
-  uint_t v,k;
+  uint_t v,k,kp;
   double delta = 0;
+  uint_t adj = isDelete ? 1 : 0; /* paths via arc i->j in g */
   assert(lambda > 1);
 
   for (k = 0; k < g->outdegree[i]; k++) {
+    if ((kp = k + TWOPATH_PREFETCH_DISTANCE) < g->outdegree[i])
+      PREFETCH_OUT2PATH_ENTRY(g, j, g->arclist[i][kp]);
     v = g->arclist[i][k];
     if (v == i || v == j)
       continue;
     if (isArc(g, j, v)) {
       delta +=
-        POW_LOOKUP(1-1/lambda, GET_OUT2PATH_ENTRY(g, j, v));
+        POW_LOOKUP(1-1/lambda, GET_OUT2PATH_ENTRY(g, j, v) - adj);
     }
     if (isArc(g, v, j)) {
       delta += 
-        POW_LOOKUP(1-1/lambda, GET_OUT2PATH_ENTRY(g, v, j));
+        POW_LOOKUP(1-1/lambda, GET_OUT2PATH_ENTRY(g, v, j) - adj);
     }
   }
   delta +=
@@ -413,23 +745,27 @@ double changeAltKTrianglesD(const digraph_t *g, uint_t i, uint_t j)
 /*
  * Change statistic for alternating k-triangles AT-U (activity closure)
  */
-double changeAltKTrianglesU(const digraph_t *g, uint_t i, uint_t j)
+double changeAltKTrianglesU(const digraph_t *g, uint_t i, uint_t j,
+                            double lambda, bool isDelete)
 {
-  uint_t v,k;
+  uint_t v,k,kp;
   double delta = 0;
+  uint_t adj = isDelete ? 1 : 0; /* paths via arc i->j in g */
   assert(lambda > 1);
 
   for (k = 0; k < g->indegree[j]; k++) {
+    if ((kp = k + TWOPATH_PREFETCH_DISTANCE) < g->indegree[j])
+      PREFETCH_IN2PATH_ENTRY(g, i, g->revarclist[j][kp]);
     v = g->revarclist[j][k];
     if (v == i || v == j)
       continue;
     if (isArc(g, i, v)) {
       delta +=
-        POW_LOOKUP(1-1/lambda, GET_IN2PATH_ENTRY(g, i, v));
+        POW_LOOKUP(1-1/lambda, GET_IN2PATH_ENTRY(g, i, v) - adj);
     }
     if (isArc(g, v, i)) {
       delta += 
-        POW_LOOKUP(1-1/lambda, GET_IN2PATH_ENTRY(g, v, i));
+        POW_LOOKUP(1-1/lambda, GET_IN2PATH_ENTRY(g, v, i) - adj);
     }
   }
   delta +=
@@ -441,23 +777,29 @@ double changeAltKTrianglesU(const digraph_t *g, uint_t i, uint_t j)
 /*
  * Change statistics for alternating two-path A2P-T (multiple 2-paths)
  */
-double changeAltTwoPathsT(const digraph_t *g, uint_t i, uint_t j)
+double changeAltTwoPathsT(const digraph_t *g, uint_t i, uint_t j,
+                          double lambda, bool isDelete)
 {
-  uint_t v,k;
+  uint_t v,k,kp;
   double delta = 0;
+  uint_t adj = isDelete ? 1 : 0; /* paths via arc i->j in g */
   assert(lambda > 1);
 
   for (k = 0; k < g->outdegree[j]; k++) {
+    if ((kp = k + TWOPATH_PREFETCH_DISTANCE) < g->outdegree[j])
+      PREFETCH_MIX2PATH_ENTRY(g, i, g->arclist[j][kp]);
     v = g->arclist[j][k];
     if (v == i || v == j)
       continue;
-    delta += POW_LOOKUP(1-1/lambda, GET_MIX2PATH_ENTRY(g, i, v));
+    delta += POW_LOOKUP(1-1/lambda, GET_MIX2PATH_ENTRY(g, i, v) - adj);
   }
   for (k = 0; k < g->indegree[i]; k++) {
+    if ((kp = k + TWOPATH_PREFETCH_DISTANCE) < g->indegree[i])
+      PREFETCH_MIX2PATH_ENTRY(g, g->revarclist[i][kp], j);
     v = g->revarclist[i][k];
     if (v == i || v == j)
       continue;
-    delta += POW_LOOKUP(1-1/lambda, GET_MIX2PATH_ENTRY(g, v, j));
+    delta += POW_LOOKUP(1-1/lambda, GET_MIX2PATH_ENTRY(g, v, j) - adj);
   }
 
   return delta;
@@ -466,17 +808,21 @@ double changeAltTwoPathsT(const digraph_t *g, uint_t i, uint_t j)
 /*
  * Change statistic for alternating two-paths A2P-D (shared popularity) 
  */
-double changeAltTwoPathsD(const digraph_t *g, uint_t i, uint_t j)
+double changeAltTwoPathsD(const digraph_t *g, uint_t i, uint_t j,
+                          double lambda, bool isDelete)
 {
-  uint_t v,k;
+  uint_t v,k,kp;
   double delta = 0;
+  uint_t adj = isDelete ? 1 : 0; /* paths via arc i->j in g */
   assert(lambda > 1);
 
   for (k = 0; k < g->outdegree[i]; k++) {
+    if ((kp = k + TWOPATH_PREFETCH_DISTANCE) < g->outdegree[i])
+      PREFETCH_OUT2PATH_ENTRY(g, j, g->arclist[i][kp]);
     v = g->arclist[i][k];
     if (v == i || v == j) 
       continue;
-    delta += POW_LOOKUP(1-1/lambda, GET_OUT2PATH_ENTRY(g, j, v));
+    delta += POW_LOOKUP(1-1/lambda, GET_OUT2PATH_ENTRY(g, j, v) - adj);
   }
   return delta;
 }
@@ -484,17 +830,21 @@ double changeAltTwoPathsD(const digraph_t *g, uint_t i, uint_t j)
 /*
  * Change statistic for alternating two-paths A2P-U (shared activity) 
  */
-double changeAltTwoPathsU(const digraph_t *g, uint_t i, uint_t j)
+double changeAltTwoPathsU(const digraph_t *g, uint_t i, uint_t j,
+                          double lambda, bool isDelete)
 {
-  uint_t v,k;
+  uint_t v,k,kp;
   double delta = 0;
+  uint_t adj = isDelete ? 1 : 0; /* paths via arc i->j in g */
   assert(lambda > 1);
 
   for (k = 0; k < g->indegree[j]; k++) {
+    if ((kp = k + TWOPATH_PREFETCH_DISTANCE) < g->indegree[j])
+      PREFETCH_IN2PATH_ENTRY(g, i, g->revarclist[j][kp]);
     v = g->revarclist[j][k];
     if (v == i || v == j) 
       continue;
-    delta += POW_LOOKUP(1-1/lambda, GET_IN2PATH_ENTRY(g, i, v));
+    delta += POW_LOOKUP(1-1/lambda, GET_IN2PATH_ENTRY(g, i, v) - adj);
   }
 
   return delta;
@@ -504,9 +854,11 @@ double changeAltTwoPathsU(const digraph_t *g, uint_t i, uint_t j)
  * Change statisic for alternating two-paths A2P-TD (shared popularity +
  * multiple two-paths), adjusting for multiple counting
  */
-double changeAltTwoPathsTD(const digraph_t *g, uint_t i, uint_t j)
+double changeAltTwoPathsTD(const digraph_t *g, uint_t i, uint_t j,
+                           double lambda, bool isDelete)
 {
-  return 0.5 * (changeAltTwoPathsT(g, i, j) + changeAltTwoPathsD(g, i, j));
+  return 0.5 * (changeAltTwoPathsT(g, i, j, lambda, isDelete) +
+                changeAltTwoPathsD(g, i, j, lambda, isDelete));
 }
 
 
@@ -519,7 +871,7 @@ double changeAltTwoPathsTD(const digraph_t *g, uint_t i, uint_t j)
 double changeSender(const digraph_t *g, uint_t i, uint_t j, uint_t a) 
 {
   (void)j;/*unused parameter*/
-  return g->binattr[a][i] != BIN_NA && g->binattr[a][i];
+  return BINATTR_VALUE(g, a, i);
 }
 
 /*
@@ -528,7 +880,7 @@ double changeSender(const digraph_t *g, uint_t i, uint_t j, uint_t a)
 double changeReceiver(const digraph_t *g, uint_t i, uint_t j, uint_t a)
 {
   (void)i;/*unused parameter*/
-  return g->binattr[a][j] != BIN_NA && g->binattr[a][j];
+  return BINATTR_VALUE(g, a, j);
 }
 
 /*
@@ -536,8 +888,7 @@ double changeReceiver(const digraph_t *g, uint_t i, uint_t j, uint_t a)
  */
 double changeInteraction(const digraph_t *g, uint_t i, uint_t j, uint_t a)
 {
-  return g->binattr[a][i] != BIN_NA && g->binattr[a][j] != BIN_NA &&
-         g->binattr[a][i] && g->binattr[a][j];
+  return BINATTR_VALUE(g, a, i) & BINATTR_VALUE(g, a, j);
 }
 
 /********************* Actor attribute (categorical) *************************/
@@ -548,8 +899,8 @@ double changeInteraction(const digraph_t *g, uint_t i, uint_t j, uint_t a)
  */
 double changeMatching(const digraph_t *g, uint_t i, uint_t j, uint_t a)
 {
-  return g->catattr[a][i] != CAT_NA && g->catattr[a][j] != CAT_NA &&
-         g->catattr[a][i] == g->catattr[a][j];
+  uint32_t ci = CATATTR_CODE(g, a, i), cj = CATATTR_CODE(g, a, j);
+  return ci != CATATTR_CODE_NA && ci == cj;
 }
 
 /*
@@ -557,8 +908,8 @@ double changeMatching(const digraph_t *g, uint_t i, uint_t j, uint_t a)
  */
 double changeMatchingReciprocity(const digraph_t *g, uint_t i, uint_t j, uint_t a)
 {
-  return g->catattr[a][i] != CAT_NA && g->catattr[a][j] != CAT_NA &&
-         g->catattr[a][i] == g->catattr[a][j] && isArc(g, j, i);
+  uint32_t ci = CATATTR_CODE(g, a, i), cj = CATATTR_CODE(g, a, j);
+  return ci != CATATTR_CODE_NA && ci == cj && isArc(g, j, i);
 }
 
 /*
@@ -566,8 +917,8 @@ double changeMatchingReciprocity(const digraph_t *g, uint_t i, uint_t j, uint_t
  */
 double changeMismatching(const digraph_t *g, uint_t i, uint_t j, uint_t a)
 {
-  return g->catattr[a][i] != CAT_NA && g->catattr[a][j] != CAT_NA &&
-         g->catattr[a][i] != g->catattr[a][j];
+  uint32_t ci = CATATTR_CODE(g, a, i), cj = CATATTR_CODE(g, a, j);
+  return ci != CATATTR_CODE_NA && cj != CATATTR_CODE_NA && ci != cj;
 }
 
 /*
@@ -575,8 +926,9 @@ double changeMismatching(const digraph_t *g, uint_t i, uint_t j, uint_t a)
  */
 double changeMismatchingReciprocity(const digraph_t *g, uint_t i, uint_t j, uint_t a)
 {
-  return g->catattr[a][i] != CAT_NA && g->catattr[a][j] != CAT_NA &&
-         g->catattr[a][i] != g->catattr[a][j] && isArc(g, j, i);
+  uint32_t ci = CATATTR_CODE(g, a, i), cj = CATATTR_CODE(g, a, j);
+  return ci != CATATTR_CODE_NA && cj != CATATTR_CODE_NA && ci != cj &&
+         isArc(g, j, i);
 }
 
 /********************* Actor attribute (continuous) *************************/
@@ -588,10 +940,7 @@ double changeMismatchingReciprocity(const digraph_t *g, uint_t i, uint_t j, uint
 double changeContinuousSender(const digraph_t *g, uint_t i, uint_t j, uint_t a)
 {
   (void)j;/*unused parameter*/
-  if (isnan(g->contattr[a][i]))
-    return 0;
-  else
-    return g->contattr[a][i];
+  return g->contattr_term[a][i];
 }
 
 /*
@@ -600,10 +949,7 @@ double changeContinuousSender(const digraph_t *g, uint_t i, uint_t j, uint_t a)
 double changeContinuousReceiver(const digraph_t *g, uint_t i, uint_t j, uint_t a)
 {
   (void)i;/*unused parameter*/
-  if (isnan(g->contattr[a][j]))
-    return 0;
-  else
-    return g->contattr[a][j];
+  return g->contattr_term[a][j];
 }
 
 
@@ -612,10 +958,11 @@ double changeContinuousReceiver(const digraph_t *g, uint_t i, uint_t j, uint_t a
  */
 double changeDiff(const digraph_t *g, uint_t i, uint_t j, uint_t a)
 {
-  if (isnan(g->contattr[a][i]) || isnan(g->contattr[a][j]))
+  double xi = g->contattr[a][i], xj = g->contattr[a][j];
+  if (isnan(xi) || isnan(xj))
     return 0;
   else
-    return fabs(g->contattr[a][i] - g->contattr[a][j]);
+    return fabs(xi - xj);
 }
 
 
@@ -625,10 +972,11 @@ double changeDiff(const digraph_t *g, uint_t i, uint_t j, uint_t a)
  */
 double changeDiffReciprocity(const digraph_t *g, uint_t i, uint_t j, uint_t a)
 {
-  if (isnan(g->contattr[a][i]) || isnan(g->contattr[a][j]))
+  double xi = g->contattr[a][i], xj = g->contattr[a][j];
+  if (isnan(xi) || isnan(xj))
     return 0;
   else  
-    return fabs(g->contattr[a][i] - g->contattr[a][j]) * isArc(g, j, i);
+    return fabs(xi - xj) * isArc(g, j, i);
 }
 
 
@@ -639,10 +987,11 @@ double changeDiffReciprocity(const digraph_t *g, uint_t i, uint_t j, uint_t a)
  */
 double changeDiffSign(const digraph_t *g, uint_t i, uint_t j, uint_t a)
 {
-  if (isnan(g->contattr[a][i]) || isnan(g->contattr[a][j]))
+  double xi = g->contattr[a][i], xj = g->contattr[a][j];
+  if (isnan(xi) || isnan(xj))
     return 0;
   else
-    return signum(g->contattr[a][i] - g->contattr[a][j]);
+    return signum(xi - xj);
 }
 
 /*
@@ -656,13 +1005,14 @@ double changeDiffSign(const digraph_t *g, uint_t i, uint_t j, uint_t a)
  */
 double changeDiffDirSR(const digraph_t *g, uint_t i, uint_t j, uint_t a)
 {
-  if (isnan(g->contattr[a][i]) || isnan(g->contattr[a][j]))
+  double xi = g->contattr[a][i], xj = g->contattr[a][j];
+  if (isnan(xi) || isnan(xj))
   {
     return 0;
   }
   else {
-    if (g->contattr[a][i] > g->contattr[a][j])
-      return g->contattr[a][i] - g->contattr[a][j];
+    if (xi > xj)
+      return xi - xj;
     else
       return 0;
   }
@@ -679,13 +1029,14 @@ double changeDiffDirSR(const digraph_t *g, uint_t i, uint_t j, uint_t a)
  */
 double changeDiffDirRS(const digraph_t *g, uint_t i, uint_t j, uint_t a)
 {
-  if (isnan(g->contattr[a][i]) || isnan(g->contattr[a][j]))
+  double xi = g->contattr[a][i], xj = g->contattr[a][j];
+  if (isnan(xi) || isnan(xj))
   {
     return 0;
   }
   else {
-    if (g->contattr[a][j] > g->contattr[a][i])
-      return g->contattr[a][j] - g->contattr[a][i];
+    if (xj > xi)
+      return xj - xi;
     else
       return 0;
   }
@@ -702,12 +1053,12 @@ double changeDiffDirRS(const digraph_t *g, uint_t i, uint_t j, uint_t a)
  */
 double changeJaccardSimilarity(const digraph_t *g, uint_t i, uint_t j, uint_t a)
 {
-  /* For NA values all elements of set are set to NA so just check first */
-  if (g->setattr[a][i][0] == SET_ELEM_NA || g->setattr[a][j][0] == SET_ELEM_NA)
+  if (SETATTR_BIT_TEST(g->setattr_na[a], i) ||
+      SETATTR_BIT_TEST(g->setattr_na[a], j))
     return 0;
   else
-    return jaccard_index(g->setattr[a][i], g->setattr[a][j],
-                         g->setattr_lengths[a]);
+    return jaccard_index_bits(g->setattr_bits[a][i], g->setattr_bits[a][j],
+                              SETATTR_WORDS(g->setattr_lengths[a]));
 }
 
 
@@ -718,21 +1069,19 @@ double changeJaccardSimilarity(const digraph_t *g, uint_t i, uint_t j, uint_t a)
  * using for each node the pair of continuous attributes labelled 
  * as being latitude and longitude
  */
-double changeGeoDistance(const digraph_t *g, uint_t i, uint_t j)
+double changeGeoDistance(const digraph_t *g, uint_t i, uint_t j, uint_t l)
 {
-  double dist, lati, longi, latj, longj;
+  const point3_t *pti = &g->geo_coords[i], *ptj = &g->geo_coords[j];
 
-  lati  = g->contattr[g->latitude_index][i];
-  longi = g->contattr[g->longitude_index][i];
-  latj  = g->contattr[g->latitude_index][j];
-  longj = g->contattr[g->longitude_index][j];
-
-  if (isnan(lati) || isnan(longi) || isnan(latj) || isnan(longj)) {
+  (void)l; /* unused parameter */
+  /* lat/long as unit vectors precomputed by build_dyadic_coords(),
+     with all coordinates NaN if either is missing */
+  if (isnan(pti->x) || isnan(ptj->x)) {
     return 0;
   }
   else {
-    dist = geo_distance(lati, longi, latj, longj);
-    return dist;
+    return geo_distance_unit_vectors(pti->x, pti->y, pti->z,
+                                     ptj->x, ptj->y, ptj->z);
   }
 }
 
@@ -741,11 +1090,11 @@ double changeGeoDistance(const digraph_t *g, uint_t i, uint_t j)
  * using for each node the pair of continuous attributes labelled 
  * as being latitude and longitude
  */
-double changeLogGeoDistance(const digraph_t *g, uint_t i, uint_t j)
+double changeLogGeoDistance(const digraph_t *g, uint_t i, uint_t j, uint_t l)
 {
   double dist;
 
-  dist = changeGeoDistance(g, i, j);
+  dist = changeGeoDistance(g, i, j, l);
   if (dist > 0) {
     return log(dist);
   } else {
@@ -759,28 +1108,34 @@ double changeLogGeoDistance(const digraph_t *g, uint_t i, uint_t j)
  * using for each node the triple of continuous attributes labelled 
  * as being x, y, and z coordinates.
  */
-double changeEuclideanDistance(const digraph_t *g, uint_t i, uint_t j)
+double changeEuclideanDistance(const digraph_t *g, uint_t i, uint_t j,
+                               uint_t l)
 {
-  double dist, xi, xj, yi, yj, zi, zj;
-
-  xi  = g->contattr[g->x_index][i];
-  xj  = g->contattr[g->x_index][j];
-  yi  = g->contattr[g->y_index][i];
-  yj  = g->contattr[g->y_index][j];
-  zi  = g->contattr[g->z_index][i];
-  zj  = g->contattr[g->z_index][j];
-  
+  const point3_t *pti = &g->euclidean_coords[i];
+  const point3_t *ptj = &g->euclidean_coords[j];
 
-  if (isnan(xi) || isnan(yi) || isnan(zi) ||
-      isnan(xj) || isnan(yj) || isnan(zj)) {
+  (void)l; /* unused parameter */
+  /* coordinates precomputed by build_dyadic_coords(), with all
+     coordinates NaN if any is missing */
+  if (isnan(pti->x) || isnan(ptj->x)) {
     return 0;
   }
   else {
-    dist = euclidean_distance(xi, yi, zi, xj, yj, zj);
-    return dist;
+    return euclidean_distance(pti->x, pti->y, pti->z, ptj->x, ptj->y, ptj->z);
   }
 }
 
+/*
+ * Change statistic for a general dyadic covariate from the dyadic
+ * covariates file: adding arc i->j increases the statistic by the
+ * value of the covariate for the pair (i, j), which is 0 if the pair
+ * is not in the file.
+ */
+double changeDyadicCovariate(const digraph_t *g, uint_t i, uint_t j, uint_t l)
+{
+  return get_dyadic_covariate(g, g->dyadcov_index[l], i, j);
+}
+
 
 /******************Attribute interaction (categorical) ***********************/
 
@@ -795,10 +1150,1109 @@ double changeEuclideanDistance(const digraph_t *g, uint_t i, uint_t j)
 double changeMatchingInteraction(const digraph_t *g, uint_t i, uint_t j,
                                  uint_t a, uint_t b)
 {
-  return g->catattr[a][i] != CAT_NA && g->catattr[a][j] != CAT_NA &&
-    g->catattr[b][i] != CAT_NA && g->catattr[b][j] != CAT_NA &&
-    g->catattr[a][i] == g->catattr[a][j] &&
-    g->catattr[b][i] == g->catattr[b][j];
+  uint32_t ai = CATATTR_CODE(g, a, i), bi = CATATTR_CODE(g, b, i);
+  return ai != CATATTR_CODE_NA && bi != CATATTR_CODE_NA &&
+    ai == CATATTR_CODE(g, a, j) && bi == CATATTR_CODE(g, b, j);
+}
+
+
+/*****************************************************************************
+ *
+ * category pair tables
+ *
+ ****************************************************************************/
+
+/*
+ * Kind of category pair table statistic (see cat_pair_table_t) of a
+ * nodal attribute change statistic function.
+ *
+ * Parameters:
+ *   f - nodal attribute change statistic function
+ *
+ * Return value:
+ *   cat_pair_kind_e of f, CAT_PAIR_NONE if it cannot be in a table.
+ */
+static cat_pair_kind_e cat_pair_attr_kind(attr_change_stats_func_t *f)
+{
+  if (f == changeMatching)
+    return CAT_PAIR_MATCHING;
+  else if (f == changeMatchingReciprocity)
+    return CAT_PAIR_MATCHING_RECIPROCITY;
+  else if (f == changeMismatching)
+    return CAT_PAIR_MISMATCHING;
+  else if (f == changeMismatchingReciprocity)
+    return CAT_PAIR_MISMATCHING_RECIPROCITY;
+  return CAT_PAIR_NONE;
+}
+
+/*
+ * Kind of category pair table statistic (see cat_pair_table_t) of an
+ * attribute interaction change statistic function.
+ *
+ * Parameters:
+ *   f - attribute interaction change statistic function
+ *
+ * Return value:
+ *   cat_pair_kind_e of f, CAT_PAIR_NONE if it cannot be in a table.
+ */
+static cat_pair_kind_e cat_pair_interaction_kind(
+  attr_interaction_change_stats_func_t *f)
+{
+  return f == changeMatchingInteraction ? CAT_PAIR_MATCHING_INTERACTION :
+    CAT_PAIR_NONE;
+}
+
+/*
+ * Statistic of nodal attribute effect l of a model in a category pair
+ * table, if it is the one the table was built for.
+ *
+ * Parameters:
+ *   t - category pair table, or NULL
+ *   l - index of the effect in the nodal attribute effects of the model
+ *   f - its change statistic function
+ *   a - its attribute index
+ *
+ * Return value:
+ *   The statistic in t, or NULL if it is not in t (so must be computed
+ *   by calling f).
+ */
+static inline const cat_pair_term_t *cat_pair_attr_term(
+  const cat_pair_table_t *t, uint_t l, attr_change_stats_func_t *f, uint_t a)
+{
+  const cat_pair_term_t *term;
+
+  if (!t || l >= t->n_attr)
+    return NULL;
+  term = &t->terms[l];
+  if (term->kind == CAT_PAIR_NONE || term->a != a ||
+      cat_pair_attr_kind(f) != term->kind)
+    return NULL;
+  return term;
+}
+
+/*
+ * Statistic of attribute interaction effect l of a model in a category
+ * pair table, if it is the one the table was built for.
+ *
+ * Parameters:
+ *   t - category pair table, or NULL
+ *   l - index of the effect in the attribute interaction effects of
+ *       the model
+ *   f - its change statistic function
+ *   a - its first attribute index
+ *   b - its second attribute index
+ *
+ * Return value:
+ *   The statistic in t, or NULL if it is not in t (so must be computed
+ *   by calling f).
+ */
+static inline const cat_pair_term_t *cat_pair_interaction_term(
+  const cat_pair_table_t *t, uint_t l,
+  attr_interaction_change_stats_func_t *f, uint_t a, uint_t b)
+{
+  const cat_pair_term_t *term;
+
+  if (!t || l >= t->n_attr_interaction)
+    return NULL;
+  term = &t->terms[t->n_attr + l];
+  if (term->kind == CAT_PAIR_NONE || term->a != a || term->b != b ||
+      cat_pair_interaction_kind(f) != term->kind)
+    return NULL;
+  return term;
+}
+
+/*
+ * Whether a category pair table statistic also depends on the
+ * reciprocal arc.
+ */
+static inline bool cat_pair_reciprocity(const cat_pair_term_t *term)
+{
+  return term->kind == CAT_PAIR_MATCHING_RECIPROCITY ||
+    term->kind == CAT_PAIR_MISMATCHING_RECIPROCITY;
+}
+
+/*
+ * Change statistic for adding arc i->j from a category pair table,
+ * the same as the change statistic function of the term gives.
+ *
+ * Parameters:
+ *   g    - digraph
+ *   term - statistic in the category pair table of g
+ *   bits - table entry for i->j (CAT_PAIR_BITS(g->cat_pair_table, i, j))
+ *   i    - node arc is from
+ *   j    - node arc is to
+ *
+ * Return value:
+ *   Change statistic for adding arc i->j.
+ */
+static inline double cat_pair_stat(const digraph_t *g,
+                                   const cat_pair_term_t *term,
+                                   uint32_t bits, uint_t i, uint_t j)
+{
+  if (!((bits >> term->bit) & 1))
+    return 0;
+  return cat_pair_reciprocity(term) ? isArc(g, j, i) : 1;
+}
+
+/*
+ * Build a category pair table (see cat_pair_table_t) for the
+ * categorical attribute statistics (Matching, Mismatching, their
+ * Reciprocity variants, and MatchingInteraction) of a model. The node
+ * codes are found one attribute at a time, each code and the value of
+ * the next attribute giving the next code, and the table entries by
+ * calling the change statistic functions for a node of each code, so
+ * the statistics are exactly those the functions give. There is no
+ * table if the model has none of these statistics, or if the nodes
+ * have more than CAT_PAIR_MAX_CODES combinations of their values.
+ *
+ * Parameters:
+ *   g                  - digraph with the categorical attributes
+ *   n_attr, attr_change_stats_funcs, attr_indices, n_attr_interaction,
+ *   attr_interaction_change_stats_funcs,
+ *   attr_interaction_pair_indices - the nodal attribute and attribute
+ *                                   interaction effects of the model,
+ *                                   as for calcChangeStats()
+ *
+ * Return value:
+ *   Category pair table to give to set_cat_pair_table(), or NULL if
+ *   there is none.
+ */
+cat_pair_table_t *build_cat_pair_table(const digraph_t *g, uint_t n_attr,
+                           attr_change_stats_func_t *attr_change_stats_funcs[],
+                           const uint_t attr_indices[],
+                           uint_t n_attr_interaction,
+                           attr_interaction_change_stats_func_t
+                                       *attr_interaction_change_stats_funcs[],
+                           const uint_pair_t attr_interaction_pair_indices[])
+{
+  const uint_t      N = g->num_nodes;
+  const uint_t      num_terms = n_attr + n_attr_interaction;
+  cat_pair_table_t *t;
+  cat_pair_term_t  *terms, *term;
+  uint_t           *used; /* the attributes of the statistics */
+  uint_t            num_used = 0, num_bits = 0, l, k, u, v;
+  uint32_t         *node_code, *remap, *rep;
+  uint32_t          num_codes = 1, num_values, code, ci, cj, bits;
+  size_t            key;
+  double            x = 0;
+
+  terms = (cat_pair_term_t *)safe_calloc(MAX(num_terms, 1),
+                                         sizeof(cat_pair_term_t));
+  used = (uint_t *)safe_malloc(MAX(2 * num_terms, 1) * sizeof(uint_t));
+  for (l = 0; l < num_terms && num_bits < CAT_PAIR_MAX_TERMS; l++) {
+    term = &terms[l];
+    if (l < n_attr) {
+      term->kind = cat_pair_attr_kind(attr_change_stats_funcs[l]);
+      term->a = term->b = attr_indices[l];
+    } else {
+      term->kind = cat_pair_interaction_kind(
+        attr_interaction_change_stats_funcs[l - n_attr]);
+      term->a = attr_interaction_pair_indices[l - n_attr].first;
+      term->b = attr_interaction_pair_indices[l - n_attr].second;
+    }
+    if (term->kind == CAT_PAIR_NONE)
+      continue;
+    term->bit = num_bits++;
+    for (k = 0; k < num_used && used[k] != term->a; k++)
+      ;
+    if (k == num_used)
+      used[num_used++] = term->a;
+    for (k = 0; k < num_used && used[k] != term->b; k++)
+      ;
+    if (k == num_used)
+      used[num_used++] = term->b;
+  }
+  if (num_bits == 0 || N == 0) {
+    free(used);
+    free(terms);
+    return NULL;
+  }
+
+  /* code of each node for the attributes so far, renumbered compactly
+     after each attribute */
+  node_code = (uint32_t *)safe_calloc(N, sizeof(uint32_t));
+  for (k = 0; k < num_used && num_codes > 0; k++) {
+    u = used[k];
+    num_values = 0;
+    for (v = 0; v < N; v++)
+      num_values = MAX(num_values, CATATTR_CODE(g, u, v));
+    num_values++; /* and CATATTR_CODE_NA */
+    if (num_values > CAT_PAIR_MAX_CODES + 1) {
+      num_codes = 0;
+      break;
+    }
+    remap = (uint32_t *)safe_malloc((size_t)num_codes * num_values *
+                                    sizeof(uint32_t));
+    memset(remap, 0xff, (size_t)num_codes * num_values * sizeof(uint32_t));
+    code = 0;
+    for (v = 0; v < N; v++) {
+      key = (size_t)node_code[v] * num_values + CATATTR_CODE(g, u, v);
+      if (remap[key] == UINT32_MAX)
+        remap[key] = code++;
+      node_code[v] = remap[key];
+    }
+    free(remap);
+    num_codes = code <= CAT_PAIR_MAX_CODES ? code : 0;
+  }
+  free(used);
+  if (num_codes == 0) {
+    free(node_code);
+    free(terms);
+    return NULL;
+  }
+
+  /* a node of each code (the first) */
+  rep = (uint32_t *)safe_malloc(num_codes * sizeof(uint32_t));
+  memset(rep, 0xff, num_codes * sizeof(uint32_t));
+  for (v = 0; v < N; v++)
+    if (rep[node_code[v]] == UINT32_MAX)
+      rep[node_code[v]] = v;
+
+  t = (cat_pair_table_t *)safe_malloc(sizeof(cat_pair_table_t));
+  t->num_codes = num_codes;
+  t->node_code = node_code;
+  t->pair_bits = (uint32_t *)safe_malloc((size_t)num_codes * num_codes *
+                                         sizeof(uint32_t));
+  t->n_attr = n_attr;
+  t->n_attr_interaction = n_attr_interaction;
+  t->terms = terms;
+  for (ci = 0; ci < num_codes; ci++) {
+    for (cj = 0; cj < num_codes; cj++) {
+      bits = 0;
+      for (l = 0; l < num_terms; l++) {
+        term = &terms[l];
+        switch (term->kind) {
+          case CAT_PAIR_MATCHING:
+          case CAT_PAIR_MATCHING_RECIPROCITY:
+            x = changeMatching(g, rep[ci], rep[cj], term->a);
+            break;
+          case CAT_PAIR_MISMATCHING:
+          case CAT_PAIR_MISMATCHING_RECIPROCITY:
+            x = changeMismatching(g, rep[ci], rep[cj], term->a);
+            break;
+          case CAT_PAIR_MATCHING_INTERACTION:
+            x = changeMatchingInteraction(g, rep[ci], rep[cj], term->a,
+                                          term->b);
+            break;
+          default:
+            continue;
+        }
+        if (x > 0)
+          bits |= (uint32_t)1 << term->bit;
+      }
+      t->pair_bits[(size_t)ci * num_codes + cj] = bits;
+    }
+  }
+  free(rep);
+  return t;
+}
+
+
+/*****************************************************************************
+ *
+ * fused structural change statistics
+ *
+ ****************************************************************************/
+
+/*
+ * Structural change statistics that scan the neighbour lists of i
+ * and j. When more than one of these is in the model, calcChangeStats()
+ * computes them all with fusedStructuralChangeStats() which walks each
+ * neighbour list only once, sharing the isArc() and two-path lookups,
+ * rather than calling each change statistic function in turn.
+ * The alternating statistics are only computed together when they
+ * share the same lambda (decay) value.
+ * The order of FUSED_STATS_FUNCS[] must match fused_stat_e.
+ */
+typedef enum fused_stat_e {
+  FUSED_TRANSITIVE_TRIAD,
+  FUSED_CYCLIC_TRIAD,
+  FUSED_ALTKTRIANGLES_T,
+  FUSED_ALTKTRIANGLES_C,
+  FUSED_ALTKTRIANGLES_D,
+  FUSED_ALTKTRIANGLES_U,
+  FUSED_ALTTWOPATHS_T,
+  FUSED_ALTTWOPATHS_D,
+  FUSED_ALTTWOPATHS_U,
+  FUSED_ALTTWOPATHS_TD,
+  NUM_FUSED_STATS
+} fused_stat_e;
+
+static change_stats_func_t *const FUSED_STATS_FUNCS[NUM_FUSED_STATS] = {
+  changeTransitiveTriad,
+  changeCyclicTriad,
+  changeAltKTrianglesT,
+  changeAltKTrianglesC,
+  changeAltKTrianglesD,
+  changeAltKTrianglesU,
+  changeAltTwoPathsT,
+  changeAltTwoPathsD,
+  changeAltTwoPathsU,
+  changeAltTwoPathsTD
+};
+
+#define FUSED_BIT(s) (1U << (s))
+
+/*
+ * Return the fused_stat_e index of a structural change statistic
+ * function f with decay value lambda, or -1 if it is not one computed
+ * by fusedStructuralChangeStats() with decay value *fused_lambda.
+ * If *fused_lambda is zero (not yet fixed) it is set to the lambda of
+ * the first alternating statistic found. Transitive and cyclic triads
+ * do not depend on lambda.
+ */
+static int fused_stat_index(change_stats_func_t *f, double lambda,
+                            double *fused_lambda)
+{
+  int s;
+  for (s = 0; s < NUM_FUSED_STATS; s++) {
+    if (FUSED_STATS_FUNCS[s] == f) {
+      if (s == FUSED_TRANSITIVE_TRIAD || s == FUSED_CYCLIC_TRIAD)
+        return s;
+      if (*fused_lambda <= 0)
+        *fused_lambda = lambda;
+      return DOUBLE_APPROX_EQ(lambda, *fused_lambda) ? s : -1;
+    }
+  }
+  return -1;
+}
+
+/*
+ * Upper bound on the value of a structural change statistic function f
+ * with decay value lambda for the dyad i, j, from the degrees of i and
+ * j only, or -1 if f is not one of the FUSED_STATS_FUNCS[] (which all
+ * scan neighbour lists). These statistics are all nonnegative, and each
+ * neighbour contributes at most 1 (as lambda > 1), so the number of
+ * neighbours of i and j in common (of each direction) is bounded by the
+ * smaller degree. The term of the alternating k-triangles for the
+ * two-paths i, j themselves is lambda * (1 - (1-1/lambda)^m) for m
+ * such two-paths, which is at most MIN(lambda, m). Used by
+ * calcChangeStatsEarlyReject() to reject a move without scanning the
+ * neighbour lists.
+ */
+static double fused_stat_bound(change_stats_func_t *f, const digraph_t *g,
+                               uint_t i, uint_t j, double lambda)
+{
+  uint_t out_i = g->outdegree[i], in_i = g->indegree[i];
+  uint_t out_j = g->outdegree[j], in_j = g->indegree[j];
+  int    s;
+
+  for (s = 0; s < NUM_FUSED_STATS && FUSED_STATS_FUNCS[s] != f; s++)
+    /*nothing*/;
+  switch (s) {
+    case FUSED_TRANSITIVE_TRIAD:
+      return (double)MIN(out_i, out_j) + MIN(out_i, in_j) + MIN(in_i, in_j);
+    case FUSED_CYCLIC_TRIAD:
+      return MIN(out_j, in_i);
+    case FUSED_ALTKTRIANGLES_T:
+      return (double)MIN(out_i, out_j) + MIN(in_i, in_j) +
+        MIN(lambda, MIN(out_i, in_j));
+    case FUSED_ALTKTRIANGLES_C:
+      return 2.0 * MIN(in_i, out_j) + MIN(lambda, MIN(out_j, in_i));
+    case FUSED_ALTKTRIANGLES_D:
+      return (double)MIN(out_i, out_j) + MIN(out_i, in_j) +
+        MIN(lambda, MIN(out_i, out_j));
+    case FUSED_ALTKTRIANGLES_U:
+      return (double)MIN(in_j, out_i) + MIN(in_j, in_i) +
+        MIN(lambda, MIN(in_i, in_j));
+    case FUSED_ALTTWOPATHS_T:
+      return (double)out_j + in_i;
+    case FUSED_ALTTWOPATHS_D:
+      return out_i;
+    case FUSED_ALTTWOPATHS_U:
+      return in_j;
+    case FUSED_ALTTWOPATHS_TD:
+      return 0.5 * ((double)out_j + in_i + out_i);
+    default:
+      return -1;
+  }
+}
+
+/*
+ * Compute the change statistics selected by mask (bitwise OR of
+ * FUSED_BIT(s) for fused_stat_e values s) for adding the arc i -> j,
+ * in a single pass over each of the neighbour lists involved.
+ * As for the individual functions, if isDelete is TRUE the arc i -> j
+ * is in g and the statistics are computed as if it were not.
+ *
+ * Each statistic accumulates its terms in the same order as its
+ * individual change statistic function, so the results are identical.
+ * That is why the out-neighbours of j are scanned before the
+ * in-neighbours of i (A2P-T sums them in that order).
+ *
+ * Parameters:
+ *   g          - digraph object
+ *   i          - node source of arc being added
+ *   j          - node dest of arc being added
+ *   mask       - bit set of statistics to compute
+ *   lambda     - decay value for the alternating statistics
+ *   isDelete   - TRUE if arc i -> j is in g (delete move)
+ *   fusedstats - (OUT) array of NUM_FUSED_STATS values indexed by
+ *                fused_stat_e, only those in mask are set
+ *
+ * Return value:
+ *   None
+ *
+ * This is inline so that the pre-instantiated kernels below get the
+ * tests on a constant mask folded away by the compiler.
+ */
+static inline void fusedStructuralChangeStats(const digraph_t *g,
+                                              uint_t i, uint_t j,
+                                              uint_t mask, double lambda,
+                                              bool isDelete,
+                                              double fusedstats[])
+{
+  const double base = 1-1/lambda;
+  const uint_t adj = isDelete ? 1 : 0; /* two-paths via arc i->j in g */
+  const bool tt   = mask & FUSED_BIT(FUSED_TRANSITIVE_TRIAD);
+  const bool ct   = mask & FUSED_BIT(FUSED_CYCLIC_TRIAD);
+  const bool aktT = mask & FUSED_BIT(FUSED_ALTKTRIANGLES_T);
+  const bool aktC = mask & FUSED_BIT(FUSED_ALTKTRIANGLES_C);
+  const bool aktD = mask & FUSED_BIT(FUSED_ALTKTRIANGLES_D);
+  const bool aktU = mask & FUSED_BIT(FUSED_ALTKTRIANGLES_U);
+  const bool a2pT = mask & (FUSED_BIT(FUSED_ALTTWOPATHS_T) |
+                            FUSED_BIT(FUSED_ALTTWOPATHS_TD));
+  const bool a2pD = mask & (FUSED_BIT(FUSED_ALTTWOPATHS_D) |
+                            FUSED_BIT(FUSED_ALTTWOPATHS_TD));
+  const bool a2pU = mask & FUSED_BIT(FUSED_ALTTWOPATHS_U);
+  uint_t v, k;
+  uint_t tt_delta = 0, ct_delta = 0;
+  double aktT_delta = 0, aktC_delta = 0, aktD_delta = 0, aktU_delta = 0;
+  double a2pT_delta = 0, a2pD_delta = 0, a2pU_delta = 0;
+  double p;
+  uint_t kp; /* index of neighbour whose two-path entry is prefetched */
+  bool arc_jv, arc_vj, arc_iv, arc_vi;
+
+  assert(lambda > 1);
+
+  /* out-neighbours of i: T, AT-T, AT-D, A2P-D */
+  if (tt || aktT || aktD || a2pD) {
+    for (k = 0; k < g->outdegree[i]; k++) {
+      if ((kp = k + TWOPATH_PREFETCH_DISTANCE) < g->outdegree[i]) {
+        if (aktT)
+          PREFETCH_MIX2PATH_ENTRY(g, i, g->arclist[i][kp]);
+        if (aktD || a2pD)
+          PREFETCH_OUT2PATH_ENTRY(g, j, g->arclist[i][kp]);
+      }
+      v = g->arclist[i][k];
+      if (v == i || v == j)
+        continue;
+      arc_jv = (tt || aktT || aktD) && isArc(g, j, v);
+      arc_vj = (tt || aktD) && isArc(g, v, j);
+      if (tt)
+        tt_delta += arc_jv + arc_vj;
+      if (aktT && arc_jv)
+        aktT_delta += POW_LOOKUP(base, GET_MIX2PATH_ENTRY(g, i, v) - adj);
+      if (a2pD || (aktD && arc_jv)) {
+        p = POW_LOOKUP(base, GET_OUT2PATH_ENTRY(g, j, v) - adj);
+        if (aktD && arc_jv)
+          aktD_delta += p;
+        if (a2pD)
+          a2pD_delta += p;
+      }
+      if (aktD && arc_vj)
+        aktD_delta += POW_LOOKUP(base, GET_OUT2PATH_ENTRY(g, v, j) - adj);
+    }
+  }
+
+  /* out-neighbours of j: A2P-T */
+  if (a2pT) {
+    for (k = 0; k < g->outdegree[j]; k++) {
+      if ((kp = k + TWOPATH_PREFETCH_DISTANCE) < g->outdegree[j])
+        PREFETCH_MIX2PATH_ENTRY(g, i, g->arclist[j][kp]);
+      v = g->arclist[j][k];
+      if (v == i || v == j)
+        continue;
+      a2pT_delta += POW_LOOKUP(base, GET_MIX2PATH_ENTRY(g, i, v) - adj);
+    }
+  }
+
+  /* in-neighbours of i: T, C, AT-T, AT-C, A2P-T */
+  if (tt || ct || aktT || aktC || a2pT) {
+    for (k = 0; k < g->indegree[i]; k++) {
+      if ((kp = k + TWOPATH_PREFETCH_DISTANCE) < g->indegree[i]) {
+        if (a2pT || aktT || aktC)
+          PREFETCH_MIX2PATH_ENTRY(g, g->revarclist[i][kp], j);
+        if (aktC)
+          PREFETCH_MIX2PATH_ENTRY(g, i, g->revarclist[i][kp]);
+      }
+      v = g->revarclist[i][k];
+      if (v == i || v == j)
+        continue;
+      arc_jv = (ct || aktC) && isArc(g, j, v);
+      arc_vj = (tt || aktT) && isArc(g, v, j);
+      if (tt)
+        tt_delta += arc_vj;
+      if (ct)
+        ct_delta += arc_jv;
+      if (a2pT || (aktT && arc_vj) || (aktC && arc_jv)) {
+        p = POW_LOOKUP(base, GET_MIX2PATH_ENTRY(g, v, j) - adj);
+        if (aktT && arc_vj)
+          aktT_delta += p;
+        if (aktC && arc_jv)
+          aktC_delta += POW_LOOKUP(base, GET_MIX2PATH_ENTRY(g, i, v) - adj) +
+            p;
+        if (a2pT)
+          a2pT_delta += p;
+      }
+    }
+  }
+
+  /* in-neighbours of j: AT-U, A2P-U (in-two-paths are symmetric) */
+  if (aktU || a2pU) {
+    for (k = 0; k < g->indegree[j]; k++) {
+      if ((kp = k + TWOPATH_PREFETCH_DISTANCE) < g->indegree[j])
+        PREFETCH_IN2PATH_ENTRY(g, i, g->revarclist[j][kp]);
+      v = g->revarclist[j][k];
+      if (v == i || v == j)
+        continue;
+      arc_iv = aktU && isArc(g, i, v);
+      arc_vi = aktU && isArc(g, v, i);
+      if (a2pU || arc_iv || arc_vi) {
+        p = POW_LOOKUP(base, GET_IN2PATH_ENTRY(g, i, v) - adj);
+        if (arc_iv)
+          aktU_delta += p;
+        if (arc_vi)
+          aktU_delta += p;
+        if (a2pU)
+          a2pU_delta += p;
+      }
+    }
+  }
+
+  if (aktT)
+    aktT_delta += lambda * (1 - POW_LOOKUP(base, GET_MIX2PATH_ENTRY(g, i, j)));
+  if (aktC)
+    aktC_delta += lambda * (1 - POW_LOOKUP(base, GET_MIX2PATH_ENTRY(g, j, i)));
+  if (aktD)
+    aktD_delta += lambda * (1 - POW_LOOKUP(base, GET_OUT2PATH_ENTRY(g, i, j)));
+  if (aktU)
+    aktU_delta += lambda * (1 - POW_LOOKUP(base, GET_IN2PATH_ENTRY(g, i, j)));
+
+  fusedstats[FUSED_TRANSITIVE_TRIAD] = (double)tt_delta;
+  fusedstats[FUSED_CYCLIC_TRIAD]     = (double)ct_delta;
+  fusedstats[FUSED_ALTKTRIANGLES_T]  = aktT_delta;
+  fusedstats[FUSED_ALTKTRIANGLES_C]  = aktC_delta;
+  fusedstats[FUSED_ALTKTRIANGLES_D]  = aktD_delta;
+  fusedstats[FUSED_ALTKTRIANGLES_U]  = aktU_delta;
+  fusedstats[FUSED_ALTTWOPATHS_T]    = a2pT_delta;
+  fusedstats[FUSED_ALTTWOPATHS_D]    = a2pD_delta;
+  fusedstats[FUSED_ALTTWOPATHS_U]    = a2pU_delta;
+  fusedstats[FUSED_ALTTWOPATHS_TD]   = 0.5 * (a2pT_delta + a2pD_delta);
+}
+
+/*
+ * Pre-instantiated fused kernels for the structural model specifications
+ * in common use (as in the example configurations), with the set of
+ * statistics known at compile time. Any other set of statistics uses
+ * fusedStructuralChangeStats() with the mask tested at run time.
+ */
+
+/* AltKTrianglesT, AltTwoPathsTD */
+#define FUSED_MODEL_T_TD (FUSED_BIT(FUSED_ALTKTRIANGLES_T) |   \
+                          FUSED_BIT(FUSED_ALTTWOPATHS_TD))
+
+/* AltTwoPaths T, D, U and AltKTriangles T, C, D, U */
+#define FUSED_MODEL_ALL_ALT (FUSED_BIT(FUSED_ALTTWOPATHS_T) |   \
+                             FUSED_BIT(FUSED_ALTTWOPATHS_D) |   \
+                             FUSED_BIT(FUSED_ALTTWOPATHS_U) |   \
+                             FUSED_BIT(FUSED_ALTKTRIANGLES_T) | \
+                             FUSED_BIT(FUSED_ALTKTRIANGLES_C) | \
+                             FUSED_BIT(FUSED_ALTKTRIANGLES_D) | \
+                             FUSED_BIT(FUSED_ALTKTRIANGLES_U))
+
+static void fusedChangeStatsModelTTD(const digraph_t *g, uint_t i, uint_t j,
+                                     double lambda, bool isDelete,
+                                     double fusedstats[])
+{
+  fusedStructuralChangeStats(g, i, j, FUSED_MODEL_T_TD, lambda, isDelete,
+                             fusedstats);
+}
+
+static void fusedChangeStatsModelAllAlt(const digraph_t *g, uint_t i, uint_t j,
+                                        double lambda, bool isDelete,
+                                        double fusedstats[])
+{
+  fusedStructuralChangeStats(g, i, j, FUSED_MODEL_ALL_ALT, lambda, isDelete,
+                             fusedstats);
+}
+
+/*
+ * Return the mask (bitwise OR of FUSED_BIT(s)) of the structural
+ * change statistics to compute with the fused kernels, or 0 if there
+ * are fewer than two of them (then the individual function is just
+ * as good, as there are no scans to share). *fused_lambda is set as
+ * in fused_stat_index(). Built with -DNO_FUSED_CHANGESTATS this is
+ * always 0, so that each statistic is computed (and profiled, see
+ * changeStatsProfile.h) separately.
+ */
+static uint_t fused_stats_mask(uint_t n_struct,
+                               change_stats_func_t *change_stats_funcs[],
+                               double lambda_values[], double *fused_lambda)
+{
+  uint_t l, fused_mask = 0;
+  int    s;
+
+  for (l = 0; l < n_struct; l++) {
+    if ((s = fused_stat_index(change_stats_funcs[l], lambda_values[l],
+                              fused_lambda)) >= 0)
+      fused_mask |= FUSED_BIT(s);
+  }
+#ifdef NO_FUSED_CHANGESTATS
+  fused_mask = 0;
+#endif /* NO_FUSED_CHANGESTATS */
+  return (fused_mask & (fused_mask - 1)) ? fused_mask : 0;
+}
+
+/*
+ * Compute the fused change statistics in mask, using a pre-instantiated
+ * kernel if there is one for that mask.
+ */
+static void fusedDispatch(const digraph_t *g, uint_t i, uint_t j,
+                          uint_t mask, double lambda, bool isDelete,
+                          double fusedstats[])
+{
+  switch (mask) {
+    case FUSED_MODEL_T_TD:
+      fusedChangeStatsModelTTD(g, i, j, lambda, isDelete, fusedstats);
+      break;
+    case FUSED_MODEL_ALL_ALT:
+      fusedChangeStatsModelAllAlt(g, i, j, lambda, isDelete, fusedstats);
+      break;
+    default:
+      fusedStructuralChangeStats(g, i, j, mask, lambda, isDelete, fusedstats);
+      break;
+  }
+}
+
+/* number of structural statistics whose fused_stat_e index is cached by
+   calcChangeStatsBatch(), any more are looked up each time */
+#define MAX_FUSED_BATCH_STATS 64
+
+
+/*****************************************************************************
+ *
+ * statistics of a whole graph
+ *
+ ****************************************************************************/
+
+/*
+ * The statistics of a graph computed directly by graph_stats() rather
+ * than by summing the change statistics as the arcs are added one at a
+ * time. Each is the value that summing the change statistics would
+ * give, e.g. for alternating k-in-stars
+ *
+ *   sum_{k=0}^{d-1} lambda(1 - (1-1/lambda)^k)
+ *       = lambda d - lambda^2 (1 - (1-1/lambda)^d)
+ *
+ * for each node with in-degree d, and for the alternating k-triangles
+ * and two-paths the usual lambda sum_{i,j} (1 - (1-1/lambda)^L_ij) over
+ * arcs or dyads, where L_ij is the number of two-paths of the relevant
+ * kind. The order of GRAPH_STATS_FUNCS[] must match graph_stat_e.
+ */
+typedef enum graph_stat_e {
+  GRAPH_ARC,
+  GRAPH_RECIPROCITY,
+  GRAPH_SINK,
+  GRAPH_SOURCE,
+  GRAPH_ISOLATES,
+  GRAPH_TWOPATH,
+  GRAPH_IN_TWOSTARS,
+  GRAPH_OUT_TWOSTARS,
+  GRAPH_TRANSITIVE_TRIAD,
+  GRAPH_CYCLIC_TRIAD,
+  GRAPH_ALTINSTARS,
+  GRAPH_ALTOUTSTARS,
+  GRAPH_ALTKTRIANGLES_T,
+  GRAPH_ALTKTRIANGLES_C,
+  GRAPH_ALTKTRIANGLES_D,
+  GRAPH_ALTKTRIANGLES_U,
+  GRAPH_ALTTWOPATHS_T,
+  GRAPH_ALTTWOPATHS_D,
+  GRAPH_ALTTWOPATHS_U,
+  GRAPH_ALTTWOPATHS_TD,
+  NUM_GRAPH_STATS
+} graph_stat_e;
+
+static change_stats_func_t *const GRAPH_STATS_FUNCS[NUM_GRAPH_STATS] = {
+  changeArc,
+  changeReciprocity,
+  changeSink,
+  changeSource,
+  changeIsolates,
+  changeTwoPath,
+  changeInTwoStars,
+  changeOutTwoStars,
+  changeTransitiveTriad,
+  changeCyclicTriad,
+  changeAltInStars,
+  changeAltOutStars,
+  changeAltKTrianglesT,
+  changeAltKTrianglesC,
+  changeAltKTrianglesD,
+  changeAltKTrianglesU,
+  changeAltTwoPathsT,
+  changeAltTwoPathsD,
+  changeAltTwoPathsU,
+  changeAltTwoPathsTD
+};
+
+/* statistics needing the counts of each kind of two-path from a node */
+#define GRAPH_BIT(s) (1U << (s))
+#define GRAPH_MIX_STATS (GRAPH_BIT(GRAPH_TRANSITIVE_TRIAD) |    \
+                         GRAPH_BIT(GRAPH_CYCLIC_TRIAD) |        \
+                         GRAPH_BIT(GRAPH_ALTKTRIANGLES_T) |     \
+                         GRAPH_BIT(GRAPH_ALTKTRIANGLES_C) |     \
+                         GRAPH_BIT(GRAPH_ALTTWOPATHS_T) |       \
+                         GRAPH_BIT(GRAPH_ALTTWOPATHS_TD))
+#define GRAPH_OUT_STATS (GRAPH_BIT(GRAPH_ALTKTRIANGLES_D) |     \
+                         GRAPH_BIT(GRAPH_ALTTWOPATHS_D) |       \
+                         GRAPH_BIT(GRAPH_ALTTWOPATHS_TD))
+#define GRAPH_IN_STATS  (GRAPH_BIT(GRAPH_ALTKTRIANGLES_U) |     \
+                         GRAPH_BIT(GRAPH_ALTTWOPATHS_U))
+
+/*
+ * Attribute, dyadic covariate and attribute interaction statistics
+ * whose change statistic for i -> j does not depend on the arcs, so the
+ * statistic is the sum of the change statistics over the arcs of the
+ * graph, and those whose change statistic is that times the indicator
+ * of the reciprocal arc j -> i (and symmetric in i and j), so the sum
+ * counts each reciprocated pair twice.
+ */
+static attr_change_stats_func_t *const GRAPH_ATTR_FUNCS[] = {
+  changeSender, changeReceiver, changeInteraction, changeMatching,
+  changeMismatching, changeContinuousSender, changeContinuousReceiver,
+  changeDiff, changeDiffSign, changeDiffDirSR, changeDiffDirRS,
+  changeJaccardSimilarity
+};
+static attr_change_stats_func_t *const GRAPH_ATTR_RECIPROCITY_FUNCS[] = {
+  changeMatchingReciprocity, changeMismatchingReciprocity,
+  changeDiffReciprocity
+};
+static dyadic_change_stats_func_t *const GRAPH_DYADIC_FUNCS[] = {
+  changeGeoDistance, changeLogGeoDistance, changeEuclideanDistance,
+  changeDyadicCovariate
+};
+static attr_interaction_change_stats_func_t *const
+                                          GRAPH_ATTR_INTERACTION_FUNCS[] = {
+  changeMatchingInteraction
+};
+
+typedef struct graph_stats_thread_s /* for graph_stats() threads */
+{
+  const digraph_t   *g;            /* digraph */
+  uint_t             n;            /* number of statistics */
+  uint_t             n_attr;       /* number of attribute statistics */
+  uint_t             n_dyadic;     /* number of dyadic covariate statistics */
+  uint_t             n_attr_interaction; /* number of interaction stats */
+  const int         *kind;         /* graph_stat_e of each structural
+                                      statistic */
+  const double      *lambda_values;/* lambda of each structural statistic */
+  const double      *attr_factor;  /* multiplier of the sum of each
+                                      non-structural statistic */
+  attr_change_stats_func_t **attr_change_stats_funcs;
+  dyadic_change_stats_func_t **dyadic_change_stats_funcs;
+  attr_interaction_change_stats_func_t **attr_interaction_change_stats_funcs;
+  const uint_t      *attr_indices;
+  const uint_pair_t *attr_interaction_pair_indices;
+  uint_t             mask;         /* GRAPH_BIT() of statistics in model */
+  uint_t             first_node;   /* first node to sum over */
+  uint_t             step;         /* sum over every step-th node */
+  uint_t            *mixcount;     /* mixed two-paths a -> v -> b to each b */
+  uint_t            *outcount;     /* out-two-paths a <- v -> b to each b */
+  uint_t            *incount;      /* in-two-paths a -> v <- b to each b */
+  uint_t            *touched;      /* nodes b with nonzero count */
+  double            *stats;        /* (out) sum of each statistic over
+                                      the nodes */
+} graph_stats_thread_t;
+
+/*
+ * Index of a structural change statistic function in graph_stat_e.
+ *
+ * Parameters:
+ *   func - change statistic function
+ *
+ * Return value:
+ *   graph_stat_e index of func, or -1 if its statistic cannot be
+ *   computed directly
+ */
+static int graph_stat_index(change_stats_func_t *func)
+{
+  int s;
+  for (s = 0; s < NUM_GRAPH_STATS; s++)
+    if (GRAPH_STATS_FUNCS[s] == func)
+      return s;
+  return -1;
+}
+
+/*
+ * Multiplier of the sum over arcs of the change statistics of an
+ * attribute statistic to give its value (1, or 0.5 for the reciprocity
+ * statistics which count each pair twice).
+ *
+ * Parameters:
+ *   func - attribute change statistic function
+ *
+ * Return value:
+ *   multiplier, or 0 if the statistic cannot be computed directly
+ */
+static double graph_attr_factor(attr_change_stats_func_t *func)
+{
+  size_t k;
+  for (k = 0; k < sizeof(GRAPH_ATTR_FUNCS)/sizeof(GRAPH_ATTR_FUNCS[0]); k++)
+    if (GRAPH_ATTR_FUNCS[k] == func)
+      return 1;
+  for (k = 0; k < sizeof(GRAPH_ATTR_RECIPROCITY_FUNCS) /
+         sizeof(GRAPH_ATTR_RECIPROCITY_FUNCS[0]); k++)
+    if (GRAPH_ATTR_RECIPROCITY_FUNCS[k] == func)
+      return 0.5;
+  return 0;
+}
+
+/*
+ * Count the two-paths from node a to every other node b: mixed
+ * a -> v -> b if kind is GRAPH_MIX_STATS, out a <- v -> b (shared
+ * in-neighbour) if GRAPH_OUT_STATS, in a -> v <- b (shared
+ * out-neighbour) if GRAPH_IN_STATS. As when building the two-path
+ * tables, self-loops are ignored.
+ *
+ * Parameters:
+ *   g       - digraph
+ *   a       - node
+ *   kind    - GRAPH_MIX_STATS, GRAPH_OUT_STATS or GRAPH_IN_STATS
+ *   count   - (in/out) count of two-paths to each node (all zero on entry)
+ *   touched - (out) nodes with nonzero count
+ *
+ * Return value:
+ *   number of nodes in touched
+ */
+static uint_t count_twopaths_from(const digraph_t *g, uint_t a, uint_t kind,
+                                  uint_t *count, uint_t *touched)
+{
+  uint_t nt = 0, k, l, v, b;
+
+  if (kind == GRAPH_MIX_STATS) {
+    for (k = 0; k < g->outdegree[a]; k++) {
+      v = g->arclist[a][k];
+      if (v == a)
+        continue;
+      for (l = 0; l < g->outdegree[v]; l++) {
+        b = g->arclist[v][l];
+        if (b == v || b == a)
+          continue;
+        if (count[b]++ == 0)
+          touched[nt++] = b;
+      }
+    }
+  } else if (kind == GRAPH_OUT_STATS) {
+    for (k = 0; k < g->indegree[a]; k++) {
+      v = g->revarclist[a][k];
+      if (v == a)
+        continue;
+      for (l = 0; l < g->outdegree[v]; l++) {
+        b = g->arclist[v][l];
+        if (b == v || b == a)
+          continue;
+        if (count[b]++ == 0)
+          touched[nt++] = b;
+      }
+    }
+  } else {
+    for (k = 0; k < g->outdegree[a]; k++) {
+      v = g->arclist[a][k];
+      if (v == a)
+        continue;
+      for (l = 0; l < g->indegree[v]; l++) {
+        b = g->revarclist[v][l];
+        if (b == v || b == a)
+          continue;
+        if (count[b]++ == 0)
+          touched[nt++] = b;
+      }
+    }
+  }
+  return nt;
+}
+
+/*
+ * graph_stats() thread: sum the statistics over the nodes
+ * first_node, first_node + step, ... (each node with its out-arcs and
+ * the two-paths from it).
+ */
+static void *graph_stats_thread(void *arg)
+{
+  graph_stats_thread_t *t = (graph_stats_thread_t *)arg;
+  const digraph_t *g = t->g;
+  uint_t n_struct = t->n - t->n_attr - t->n_dyadic - t->n_attr_interaction;
+  uint_t a, b, k, l, nt, param_i;
+  double lambda, r, d, x;
+  bool   recip;
+
+  for (a = t->first_node; a < g->num_nodes; a += t->step) {
+    /* statistics of the node and its out-arcs */
+    for (k = 0; k < g->outdegree[a]; k++) {
+      b = g->arclist[a][k];
+      recip = isArc(g, b, a);
+      for (l = 0; l < n_struct; l++) {
+        if (t->kind[l] == GRAPH_ARC)
+          t->stats[l] += 1;
+        else if (t->kind[l] == GRAPH_RECIPROCITY)
+          t->stats[l] += 0.5 * recip;
+        else if (t->kind[l] == GRAPH_TWOPATH)
+          t->stats[l] -= recip; /* a -> b -> a is not a two-path */
+      }
+      param_i = n_struct;
+      for (l = 0; l < t->n_attr; l++, param_i++)
+        t->stats[param_i] += t->attr_factor[param_i - n_struct] *
+          (*t->attr_change_stats_funcs[l])(g, a, b, t->attr_indices[l]);
+      for (l = 0; l < t->n_dyadic; l++, param_i++)
+        t->stats[param_i] += t->attr_factor[param_i - n_struct] *
+          (*t->dyadic_change_stats_funcs[l])(g, a, b, l);
+      for (l = 0; l < t->n_attr_interaction; l++, param_i++)
+        t->stats[param_i] += t->attr_factor[param_i - n_struct] *
+          (*t->attr_interaction_change_stats_funcs[l])
+          (g, a, b, t->attr_interaction_pair_indices[l].first,
+           t->attr_interaction_pair_indices[l].second);
+    }
+    for (l = 0; l < n_struct; l++) {
+      lambda = t->lambda_values[l];
+      r = 1 - 1/lambda;
+      switch (t->kind[l]) {
+        case GRAPH_SINK:
+          t->stats[l] += g->outdegree[a] == 0 && g->indegree[a] != 0;
+          break;
+        case GRAPH_SOURCE:
+          t->stats[l] += g->outdegree[a] != 0 && g->indegree[a] == 0;
+          break;
+        case GRAPH_ISOLATES:
+          t->stats[l] += g->outdegree[a] == 0 && g->indegree[a] == 0;
+          break;
+        case GRAPH_TWOPATH:
+          t->stats[l] += (double)g->indegree[a] * g->outdegree[a];
+          break;
+        case GRAPH_IN_TWOSTARS:
+          d = g->indegree[a];
+          t->stats[l] += d * (d - 1) / 2;
+          break;
+        case GRAPH_OUT_TWOSTARS:
+          d = g->outdegree[a];
+          t->stats[l] += d * (d - 1) / 2;
+          break;
+        case GRAPH_ALTINSTARS:
+          d = g->indegree[a];
+          t->stats[l] += lambda * d - lambda * lambda * (1 - pow(r, d));
+          break;
+        case GRAPH_ALTOUTSTARS:
+          d = g->outdegree[a];
+          t->stats[l] += lambda * d - lambda * lambda * (1 - pow(r, d));
+          break;
+        default:
+          break;
+      }
+    }
+
+    /* statistics of the mixed two-paths from a */
+    if (t->mask & GRAPH_MIX_STATS) {
+      nt = count_twopaths_from(g, a, GRAPH_MIX_STATS, t->mixcount, t->touched);
+      for (l = 0; l < n_struct; l++) {
+        lambda = t->lambda_values[l];
+        r = 1 - 1/lambda;
+        x = 0;
+        switch (t->kind[l]) {
+          case GRAPH_TRANSITIVE_TRIAD: /* a -> v -> b closed by a -> b */
+            for (k = 0; k < g->outdegree[a]; k++)
+              x += t->mixcount[g->arclist[a][k]];
+            break;
+          case GRAPH_CYCLIC_TRIAD: /* closed by b -> a, each counted 3 times */
+            for (k = 0; k < g->indegree[a]; k++)
+              x += t->mixcount[g->revarclist[a][k]] / 3.0;
+            break;
+          case GRAPH_ALTKTRIANGLES_T:
+            for (k = 0; k < g->outdegree[a]; k++)
+              x += lambda * (1 - pow(r, t->mixcount[g->arclist[a][k]]));
+            break;
+          case GRAPH_ALTKTRIANGLES_C:
+            for (k = 0; k < g->indegree[a]; k++)
+              x += lambda * (1 - pow(r, t->mixcount[g->revarclist[a][k]]));
+            break;
+          case GRAPH_ALTTWOPATHS_T:
+          case GRAPH_ALTTWOPATHS_TD:
+            for (k = 0; k < nt; k++)
+              x += lambda * (1 - pow(r, t->mixcount[t->touched[k]]));
+            if (t->kind[l] == GRAPH_ALTTWOPATHS_TD)
+              x *= 0.5;
+            break;
+          default:
+            break;
+        }
+        t->stats[l] += x;
+      }
+      for (k = 0; k < nt; k++)
+        t->mixcount[t->touched[k]] = 0;
+    }
+
+    /* statistics of the out-two-paths from a */
+    if (t->mask & GRAPH_OUT_STATS) {
+      nt = count_twopaths_from(g, a, GRAPH_OUT_STATS, t->outcount, t->touched);
+      for (l = 0; l < n_struct; l++) {
+        lambda = t->lambda_values[l];
+        r = 1 - 1/lambda;
+        x = 0;
+        switch (t->kind[l]) {
+          case GRAPH_ALTKTRIANGLES_D:
+            for (k = 0; k < g->outdegree[a]; k++) {
+              b = g->arclist[a][k];
+              if (b != a)
+                x += lambda * (1 - pow(r, t->outcount[b]));
+            }
+            break;
+          case GRAPH_ALTTWOPATHS_D:
+          case GRAPH_ALTTWOPATHS_TD:
+            for (k = 0; k < nt; k++)  /* each pair once, from the lower */
+              if (t->touched[k] > a)
+                x += lambda * (1 - pow(r, t->outcount[t->touched[k]]));
+            if (t->kind[l] == GRAPH_ALTTWOPATHS_TD)
+              x *= 0.5;
+            break;
+          default:
+            break;
+        }
+        t->stats[l] += x;
+      }
+      for (k = 0; k < nt; k++)
+        t->outcount[t->touched[k]] = 0;
+    }
+
+    /* statistics of the in-two-paths from a */
+    if (t->mask & GRAPH_IN_STATS) {
+      nt = count_twopaths_from(g, a, GRAPH_IN_STATS, t->incount, t->touched);
+      for (l = 0; l < n_struct; l++) {
+        lambda = t->lambda_values[l];
+        r = 1 - 1/lambda;
+        x = 0;
+        switch (t->kind[l]) {
+          case GRAPH_ALTKTRIANGLES_U:
+            for (k = 0; k < g->outdegree[a]; k++) {
+              b = g->arclist[a][k];
+              if (b != a)
+                x += lambda * (1 - pow(r, t->incount[b]));
+            }
+            break;
+          case GRAPH_ALTTWOPATHS_U:
+            for (k = 0; k < nt; k++)  /* each pair once, from the lower */
+              if (t->touched[k] > a)
+                x += lambda * (1 - pow(r, t->incount[t->touched[k]]));
+            break;
+          default:
+            break;
+        }
+        t->stats[l] += x;
+      }
+      for (k = 0; k < nt; k++)
+        t->incount[t->touched[k]] = 0;
+    }
+  }
+  return NULL;
 }
 
 
@@ -814,9 +2268,12 @@ double changeMatchingInteraction(const digraph_t *g, uint_t i, uint_t j,
  * This involves summing over all the statistics specified for structural
  * effects, nodal attribute effects, dyadic covariate effects, and attribute
  * interaction effects.
+ * For a delete move the arc i->j must still be in g: the statistics
+ * are computed as if it were absent (see change_stats_func_t), so the
+ * caller only needs to actually remove it if the move is accepted.
  *
  * Parameters:
- *   g      - digraph object. Modifed if performMove is true.
+ *   g      - digraph object (not modified)
  *   i      - node source of arc being added (or deleted)
  *   j      - node dest of arc being added (or deleted)
  *   n      - number of parameters (length of theta vector and total
@@ -826,6 +2283,8 @@ double changeMatchingInteraction(const digraph_t *g, uint_t i, uint_t j,
  *   n_attr_interaction - number of attribute interaction change stats funcs
  *   change_stats_funcs - array of pointers to change statistics functions
  *                        length is n-n_attr-n_dyadic-n_attr_interaction
+ *   lambda_values - array of lambda (decay) values corresponding to
+ *                   change_stats_funcs (used by alternating statistics)
  *   attr_change_stats_funcs - array of pointers to change statistics functions
  *                             length is n_attr
  *   dyadic_change_stats_funcs - array of pointers to dyadic change stats funcs
@@ -844,7 +2303,8 @@ double changeMatchingInteraction(const digraph_t *g, uint_t i, uint_t j,
  *                                   a pair of such indices) for attribute
  *                                   interaction effects.
  *   theta  - array of n parameter values corresponding to change stats funcs
- *   isDelete - TRUE if arc is being deleted (statistics negated then)
+ *   isDelete - TRUE if arc is being deleted (statistics negated then),
+ *              in which case arc i->j is in g
  *   changestats - (OUT) array of n change statistics values corresponding to
  *                 change stats funcs. Allocated by caller.
  *
@@ -855,6 +2315,7 @@ double calcChangeStats(const digraph_t *g, uint_t i, uint_t j,
                        uint_t n, uint_t n_attr, uint_t n_dyadic,
                        uint_t n_attr_interaction,
                        change_stats_func_t *change_stats_funcs[],
+                       double lambda_values[],
                        attr_change_stats_func_t *attr_change_stats_funcs[],
                        dyadic_change_stats_func_t *dyadic_change_stats_funcs[],
                        attr_interaction_change_stats_func_t 
@@ -866,39 +2327,462 @@ double calcChangeStats(const digraph_t *g, uint_t i, uint_t j,
                        double changestats[])
 {
   double total = 0;  /* sum of theta*changestats */
+  const double sign = isDelete ? -1 : 1; /* statistics negated for delete */
   uint_t l, param_i = 0;
-  
+  uint_t n_struct = n - n_attr - n_dyadic - n_attr_interaction;
+  uint_t fused_mask;
+  double fused_lambda = 0; /* not yet fixed, see fused_stat_index() */
+  double fusedstats[NUM_FUSED_STATS];
+  const cat_pair_table_t *cat_table = g->cat_pair_table;
+  const cat_pair_term_t *term;
+  uint32_t cat_bits = cat_table ? CAT_PAIR_BITS(cat_table, i, j) : 0;
+  int s;
+#ifdef PROFILE_CHANGESTATS
+  uint64_t prof_t;
+#endif /* PROFILE_CHANGESTATS */
+
+  PROFILE_DYAD(g, i, j);
+  /* structural effects that scan neighbour lists are computed together
+     in one pass */
+  fused_mask = fused_stats_mask(n_struct, change_stats_funcs, lambda_values,
+                                &fused_lambda);
+  if (fused_mask) {
+    PROFILE_START(prof_t);
+    fusedDispatch(g, i, j, fused_mask, fused_lambda, isDelete, fusedstats);
+    PROFILE_FUSED(prof_t, 1);
+  }
+
   /* structural effects */
-  for (l = 0; l < n - n_attr - n_dyadic - n_attr_interaction; l++) { 
-    changestats[param_i] = (*change_stats_funcs[l])(g, i, j);
-    total += theta[param_i] * (isDelete ? -1 : 1) * changestats[param_i];
+  for (l = 0; l < n_struct; l++) { 
+    if (fused_mask && (s = fused_stat_index(change_stats_funcs[l],
+                                            lambda_values[l],
+                                            &fused_lambda)) >= 0) {
+      changestats[param_i] = fusedstats[s];
+      PROFILE_FUSED_STAT(param_i, 1);
+    } else {
+      PROFILE_START(prof_t);
+      changestats[param_i] = (*change_stats_funcs[l])(g, i, j,
+                                                      lambda_values[l],
+                                                      isDelete);
+      PROFILE_STAT(param_i, prof_t, 1);
+    }
+    total += theta[param_i] * sign * changestats[param_i];
     param_i++;
   }
-  /* nodal attribute effects */
+  /* nodal attribute effects, the categorical ones from the category
+     pair table if there is one */
   for (l = 0; l < n_attr; l++) {
-    changestats[param_i] = (*attr_change_stats_funcs[l])
-      (g, i, j, attr_indices[l]);
-    total += theta[param_i] * (isDelete ? -1 : 1) * changestats[param_i];
+    PROFILE_START(prof_t);
+    if ((term = cat_pair_attr_term(cat_table, l, attr_change_stats_funcs[l],
+                                   attr_indices[l])))
+      changestats[param_i] = cat_pair_stat(g, term, cat_bits, i, j);
+    else
+      changestats[param_i] = (*attr_change_stats_funcs[l])
+        (g, i, j, attr_indices[l]);
+    PROFILE_STAT(param_i, prof_t, 1);
+    total += theta[param_i] * sign * changestats[param_i];
     param_i++;
   }
   /* dyadic covariate effects */
   for (l = 0; l < n_dyadic; l++) {
-    changestats[param_i] = (*dyadic_change_stats_funcs[l])(g, i, j);
-    total += theta[param_i] * (isDelete ? -1 : 1) * changestats[param_i];
+    PROFILE_START(prof_t);
+    changestats[param_i] = (*dyadic_change_stats_funcs[l])(g, i, j, l);
+    PROFILE_STAT(param_i, prof_t, 1);
+    total += theta[param_i] * sign * changestats[param_i];
     param_i++;
   }
   /* attribute pair interaction effects */
   for (l = 0; l < n_attr_interaction; l++) {
-    changestats[param_i] = (*attr_interaction_change_stats_funcs[l])
-      (g, i, j, attr_interaction_pair_indices[l].first,
-       attr_interaction_pair_indices[l].second);
-    total += theta[param_i] * (isDelete ? -1 : 1) * changestats[param_i]; 
+    PROFILE_START(prof_t);
+    if ((term = cat_pair_interaction_term(
+           cat_table, l, attr_interaction_change_stats_funcs[l],
+           attr_interaction_pair_indices[l].first,
+           attr_interaction_pair_indices[l].second)))
+      changestats[param_i] = cat_pair_stat(g, term, cat_bits, i, j);
+    else
+      changestats[param_i] = (*attr_interaction_change_stats_funcs[l])
+        (g, i, j, attr_interaction_pair_indices[l].first,
+         attr_interaction_pair_indices[l].second);
+    PROFILE_STAT(param_i, prof_t, 1);
+    total += theta[param_i] * sign * changestats[param_i]; 
+    param_i++;
+  }
+  return total;
+}
+
+
+/*
+ * Compute the change statistics for addition of arc i->j as
+ * calcChangeStats(), but given the log of the acceptance random number
+ * so that a move that cannot be accepted is rejected without computing
+ * all the statistics. The statistics that do not scan neighbour lists
+ * (nodal attribute, dyadic covariate, attribute interaction, and the
+ * structural statistics depending only on degrees and single arcs) are
+ * computed first. If their sum plus an upper bound (from the degrees of
+ * i and j, see fused_stat_bound()) on the contribution of the remaining
+ * structural statistics is still less than log_u, the move is rejected
+ * and the neighbour lists are never scanned. Otherwise the remaining
+ * statistics are computed as in calcChangeStats() and the total is
+ * summed in the same order, so it is identical to that from
+ * calcChangeStats().
+ *
+ * Parameters:
+ *   As for calcChangeStats(), and
+ *   log_u  - log of the uniform random number the acceptance probability
+ *            exp(total) is to be compared against
+ *
+ * Return value:
+ *   Sum of all change statistics for addition of arc i->j (as
+ *   calcChangeStats()), or -HUGE_VAL if the move is rejected early, in
+ *   which case not all of the changestats are set.
+ */
+double calcChangeStatsEarlyReject(const digraph_t *g, uint_t i, uint_t j,
+                                  uint_t n, uint_t n_attr, uint_t n_dyadic,
+                                  uint_t n_attr_interaction,
+                                  change_stats_func_t *change_stats_funcs[],
+                                  double lambda_values[],
+                                  attr_change_stats_func_t
+                                               *attr_change_stats_funcs[],
+                                  dyadic_change_stats_func_t
+                                             *dyadic_change_stats_funcs[],
+                                  attr_interaction_change_stats_func_t
+                                  *attr_interaction_change_stats_funcs[],
+                                  uint_t attr_indices[],
+                                  uint_pair_t attr_interaction_pair_indices[],
+                                  const double theta[],
+                                  bool isDelete,
+                                  double log_u,
+                                  double changestats[])
+{
+  /* margin for the different order of summation of the partial total */
+  static const double EARLY_REJECT_EPSILON = 1e-9;
+  double total = 0;  /* sum of theta*changestats */
+  double partial = 0; /* sum of theta*changestats computed so far */
+  double bound = 0;   /* upper bound on theta*changestats not computed */
+  double bound_l, weight;
+  const double sign = isDelete ? -1 : 1; /* statistics negated for delete */
+  uint_t l, param_i;
+  uint_t n_struct = n - n_attr - n_dyadic - n_attr_interaction;
+  uint_t fused_mask;
+  double fused_lambda = 0; /* not yet fixed, see fused_stat_index() */
+  double fusedstats[NUM_FUSED_STATS];
+  const cat_pair_table_t *cat_table = g->cat_pair_table;
+  const cat_pair_term_t *term;
+  uint32_t cat_bits = cat_table ? CAT_PAIR_BITS(cat_table, i, j) : 0;
+  int s;
+#ifdef PROFILE_CHANGESTATS
+  uint64_t prof_t;
+#endif /* PROFILE_CHANGESTATS */
+
+  PROFILE_DYAD(g, i, j);
+  /* nodal attribute, dyadic covariate and attribute interaction effects */
+  param_i = n_struct;
+  for (l = 0; l < n_attr; l++) {
+    PROFILE_START(prof_t);
+    if ((term = cat_pair_attr_term(cat_table, l, attr_change_stats_funcs[l],
+                                   attr_indices[l])))
+      changestats[param_i] = cat_pair_stat(g, term, cat_bits, i, j);
+    else
+      changestats[param_i] = (*attr_change_stats_funcs[l])
+        (g, i, j, attr_indices[l]);
+    PROFILE_STAT(param_i, prof_t, 1);
+    partial += theta[param_i] * sign * changestats[param_i];
+    param_i++;
+  }
+  for (l = 0; l < n_dyadic; l++) {
+    PROFILE_START(prof_t);
+    changestats[param_i] = (*dyadic_change_stats_funcs[l])(g, i, j, l);
+    PROFILE_STAT(param_i, prof_t, 1);
+    partial += theta[param_i] * sign * changestats[param_i];
+    param_i++;
+  }
+  for (l = 0; l < n_attr_interaction; l++) {
+    PROFILE_START(prof_t);
+    if ((term = cat_pair_interaction_term(
+           cat_table, l, attr_interaction_change_stats_funcs[l],
+           attr_interaction_pair_indices[l].first,
+           attr_interaction_pair_indices[l].second)))
+      changestats[param_i] = cat_pair_stat(g, term, cat_bits, i, j);
+    else
+      changestats[param_i] = (*attr_interaction_change_stats_funcs[l])
+        (g, i, j, attr_interaction_pair_indices[l].first,
+         attr_interaction_pair_indices[l].second);
+    PROFILE_STAT(param_i, prof_t, 1);
+    partial += theta[param_i] * sign * changestats[param_i];
     param_i++;
   }
+
+  /* structural effects not scanning neighbour lists, and the bound on
+     the (nonnegative) statistics of those that do, which are marked
+     NaN as not yet computed */
+  for (l = 0; l < n_struct; l++) {
+    if ((bound_l = fused_stat_bound(change_stats_funcs[l], g, i, j,
+                                    lambda_values[l])) >= 0) {
+      changestats[l] = NAN;
+      weight = theta[l] * sign;
+      if (weight > 0)
+        bound += weight * bound_l;
+    } else {
+      PROFILE_START(prof_t);
+      changestats[l] = (*change_stats_funcs[l])(g, i, j, lambda_values[l],
+                                                isDelete);
+      PROFILE_STAT(l, prof_t, 1);
+      partial += theta[l] * sign * changestats[l];
+    }
+  }
+  if (partial + bound <
+      log_u - EARLY_REJECT_EPSILON * (1 + fabs(partial) + bound))
+    return -HUGE_VAL;
+
+  /* remaining structural effects, those that scan neighbour lists
+     computed together in one pass as in calcChangeStats() */
+  fused_mask = fused_stats_mask(n_struct, change_stats_funcs, lambda_values,
+                                &fused_lambda);
+  if (fused_mask) {
+    PROFILE_START(prof_t);
+    fusedDispatch(g, i, j, fused_mask, fused_lambda, isDelete, fusedstats);
+    PROFILE_FUSED(prof_t, 1);
+  }
+  for (l = 0; l < n_struct; l++) {
+    if (!isnan(changestats[l]))
+      continue; /* already computed */
+    if (fused_mask && (s = fused_stat_index(change_stats_funcs[l],
+                                            lambda_values[l],
+                                            &fused_lambda)) >= 0) {
+      changestats[l] = fusedstats[s];
+      PROFILE_FUSED_STAT(l, 1);
+    } else {
+      PROFILE_START(prof_t);
+      changestats[l] = (*change_stats_funcs[l])(g, i, j, lambda_values[l],
+                                                isDelete);
+      PROFILE_STAT(l, prof_t, 1);
+    }
+  }
+
+  /* sum in the same order as calcChangeStats() */
+  for (l = 0; l < n; l++)
+    total += theta[l] * sign * changestats[l];
   return total;
 }
 
 
+/*
+ * Sum of the change statistics for a move weighted by the parameters,
+ * summed in the same order as calcChangeStats() so it is the same as
+ * its return value, for when the statistics are already known (e.g.
+ * from the dyad cache, see set_dyad_cache()).
+ *
+ * Parameters:
+ *   n           - number of parameters
+ *   theta       - array of n parameter values
+ *   isDelete    - TRUE if arc is being deleted (statistics negated then)
+ *   changestats - array of n change statistics for addition of the arc
+ *
+ * Return value:
+ *   Sum of theta times the change statistics.
+ */
+double changeStatsTotal(uint_t n, const double theta[], bool isDelete,
+                        const double changestats[])
+{
+  double total = 0;  /* sum of theta*changestats */
+  const double sign = isDelete ? -1 : 1; /* statistics negated for delete */
+  uint_t l;
+
+  for (l = 0; l < n; l++)
+    total += theta[l] * sign * changestats[l];
+  return total;
+}
+
+
+/*
+ * Compute the change statistics for a batch of dyads on the same
+ * (unchanging) graph. This gives the same values as calling
+ * calcChangeStats() for each dyad in turn (rounded to single precision
+ * if built with BATCHSTATS_FLOAT), but computes each statistic
+ * for all the dyads together, so the choice of fused kernel is made only
+ * once, the attribute terms with per-node arrays (and the categorical
+ * ones in the category pair table) are simple gather loops the compiler
+ * can vectorize, and the adjacency lists of the next dyad
+ * are prefetched while the neighbour-based statistics of the current one
+ * are computed.
+ *
+ * Parameters:
+ *   g         - digraph object (not modified)
+ *   num_dyads - number of dyads K
+ *   dyads     - array of K (i, j) node pairs, each the source and dest of
+ *               arc being added (or deleted)
+ *   isDelete  - array of K flags, TRUE if arc is being deleted for that
+ *               dyad (so arc i->j is in g, as for calcChangeStats()), or
+ *               NULL if all are add moves
+ *   n, n_attr, n_dyadic, n_attr_interaction, change_stats_funcs,
+ *   lambda_values, attr_change_stats_funcs, dyadic_change_stats_funcs,
+ *   attr_interaction_change_stats_funcs, attr_indices,
+ *   attr_interaction_pair_indices, theta - as for calcChangeStats()
+ *   changestats - (OUT) array of n x K change statistics values, with
+ *                 the values of statistic l for all dyads contiguous:
+ *                 changestats[l*K + k] is statistic l for dyad k.
+ *                 Single precision if built with BATCHSTATS_FLOAT
+ *                 (see batchstat_t). Allocated by caller.
+ *   totals      - (OUT) array of K sums of theta*changestats (negated for
+ *                 delete moves), as returned by calcChangeStats().
+ *                 Allocated by caller.
+ *
+ * Return value:
+ *   None
+ */
+void calcChangeStatsBatch(const digraph_t *g, uint_t num_dyads,
+                          const nodepair_t dyads[], const bool isDelete[],
+                          uint_t n, uint_t n_attr, uint_t n_dyadic,
+                          uint_t n_attr_interaction,
+                          change_stats_func_t *change_stats_funcs[],
+                          double lambda_values[],
+                          attr_change_stats_func_t *attr_change_stats_funcs[],
+                          dyadic_change_stats_func_t *dyadic_change_stats_funcs[],
+                          attr_interaction_change_stats_func_t
+                                        *attr_interaction_change_stats_funcs[],
+                          uint_t attr_indices[],
+                          uint_pair_t attr_interaction_pair_indices[],
+                          const double theta[],
+                          batchstat_t changestats[],
+                          double totals[])
+{
+  const uint_t K = num_dyads;
+  uint_t l, k, a, b, param_i = 0;
+  uint_t n_struct = n - n_attr - n_dyadic - n_attr_interaction;
+  uint_t fused_mask;
+  double fused_lambda = 0; /* not yet fixed, see fused_stat_index() */
+  double fusedstats[NUM_FUSED_STATS];
+  batchstat_t *row;
+  int    fused_index[MAX_FUSED_BATCH_STATS]; /* fused_stat_e or -1 */
+  const cat_pair_term_t *term;
+  int    s;
+#ifdef PROFILE_CHANGESTATS
+  uint64_t prof_t;
+
+  for (k = 0; k < K; k++)
+    PROFILE_DYAD(g, dyads[k].i, dyads[k].j);
+#endif /* PROFILE_CHANGESTATS */
+
+  fused_mask = fused_stats_mask(n_struct, change_stats_funcs, lambda_values,
+                                &fused_lambda);
+
+  /* structural effects, neighbour-based ones fused together, and a
+     dyad at a time so that the next dyad's lists can be prefetched */
+  if (fused_mask) {
+    PROFILE_START(prof_t);
+    for (l = 0; l < n_struct && l < MAX_FUSED_BATCH_STATS; l++)
+      fused_index[l] = fused_stat_index(change_stats_funcs[l],
+                                        lambda_values[l], &fused_lambda);
+    for (k = 0; k < K; k++) {
+      if (k + 1 < K) {
+        PREFETCH(g->arclist[dyads[k+1].i]);
+        PREFETCH(g->revarclist[dyads[k+1].i]);
+        PREFETCH(g->arclist[dyads[k+1].j]);
+        PREFETCH(g->revarclist[dyads[k+1].j]);
+      }
+      fusedDispatch(g, dyads[k].i, dyads[k].j, fused_mask, fused_lambda,
+                    isDelete ? isDelete[k] : FALSE, fusedstats);
+      for (l = 0; l < n_struct; l++) {
+        s = l < MAX_FUSED_BATCH_STATS ? fused_index[l] :
+          fused_stat_index(change_stats_funcs[l], lambda_values[l],
+                           &fused_lambda);
+        if (s >= 0)
+          changestats[l*K + k] = fusedstats[s];
+      }
+    }
+    PROFILE_FUSED(prof_t, K);
+  }
+  for (l = 0; l < n_struct; l++) {
+    if (fused_mask && fused_stat_index(change_stats_funcs[l], lambda_values[l],
+                                       &fused_lambda) >= 0) {
+      PROFILE_FUSED_STAT(l, K);
+      continue;
+    }
+    PROFILE_START(prof_t);
+    row = &changestats[l*K];
+    for (k = 0; k < K; k++)
+      row[k] = (*change_stats_funcs[l])(g, dyads[k].i, dyads[k].j,
+                                        lambda_values[l],
+                                        isDelete ? isDelete[k] : FALSE);
+    PROFILE_STAT(l, prof_t, K);
+  }
+  param_i = n_struct;
+
+  /* nodal attribute effects, those that are just a per-node term
+     as a gather from the precomputed term arrays */
+  for (l = 0; l < n_attr; l++) {
+    PROFILE_START(prof_t);
+    row = &changestats[param_i*K];
+    a = attr_indices[l];
+    if (attr_change_stats_funcs[l] == changeSender) {
+      gather_binattr(row, g->binattr[a], dyads, K, FALSE);
+    } else if (attr_change_stats_funcs[l] == changeReceiver) {
+      gather_binattr(row, g->binattr[a], dyads, K, TRUE);
+    } else if (attr_change_stats_funcs[l] == changeContinuousSender) {
+      gather_attr_term(row, g->contattr_term[a], dyads, K, FALSE);
+    } else if (attr_change_stats_funcs[l] == changeContinuousReceiver) {
+      gather_attr_term(row, g->contattr_term[a], dyads, K, TRUE);
+    } else if ((term = cat_pair_attr_term(g->cat_pair_table, l,
+                                          attr_change_stats_funcs[l], a))) {
+      gather_cat_pair(row, g->cat_pair_table, term->bit, dyads, K);
+      if (cat_pair_reciprocity(term))
+        for (k = 0; k < K; k++)
+          if (row[k] > 0)
+            row[k] = isArc(g, dyads[k].j, dyads[k].i);
+    } else {
+      for (k = 0; k < K; k++)
+        row[k] = (*attr_change_stats_funcs[l])(g, dyads[k].i, dyads[k].j, a);
+    }
+    PROFILE_STAT(param_i, prof_t, K);
+    param_i++;
+  }
+  /* dyadic covariate effects, the distances computed for all the dyads
+     at once */
+  for (l = 0; l < n_dyadic; l++) {
+    PROFILE_START(prof_t);
+    row = &changestats[param_i*K];
+    if (dyadic_change_stats_funcs[l] == changeGeoDistance)
+      batch_geo_distance(row, g->geo_coords, dyads, K, FALSE);
+    else if (dyadic_change_stats_funcs[l] == changeLogGeoDistance)
+      batch_geo_distance(row, g->geo_coords, dyads, K, TRUE);
+    else if (dyadic_change_stats_funcs[l] == changeEuclideanDistance)
+      batch_euclidean_distance(row, g->euclidean_coords, dyads, K);
+    else
+      for (k = 0; k < K; k++)
+        row[k] = (*dyadic_change_stats_funcs[l])(g, dyads[k].i, dyads[k].j,
+                                                 l);
+    PROFILE_STAT(param_i, prof_t, K);
+    param_i++;
+  }
+  /* attribute pair interaction effects */
+  for (l = 0; l < n_attr_interaction; l++) {
+    PROFILE_START(prof_t);
+    row = &changestats[param_i*K];
+    a = attr_interaction_pair_indices[l].first;
+    b = attr_interaction_pair_indices[l].second;
+    if ((term = cat_pair_interaction_term(
+           g->cat_pair_table, l, attr_interaction_change_stats_funcs[l], a,
+           b)))
+      gather_cat_pair(row, g->cat_pair_table, term->bit, dyads, K);
+    else
+      for (k = 0; k < K; k++)
+        row[k] = (*attr_interaction_change_stats_funcs[l])(g, dyads[k].i,
+                                                           dyads[k].j, a, b);
+    PROFILE_STAT(param_i, prof_t, K);
+    param_i++;
+  }
+
+  /* sum in the same order as calcChangeStats() so totals are identical
+     (negating at the end is exact) */
+  batch_totals(n, K, theta, changestats, totals);
+  if (isDelete) {
+    for (k = 0; k < K; k++)
+      if (isDelete[k])
+        totals[k] = -totals[k];
+  }
+}
+
+
 /*
  *
  * Compute the observed statistics for the empty graph (no arcs; all nodes
@@ -917,6 +2801,8 @@ double calcChangeStats(const digraph_t *g, uint_t i, uint_t j,
  *   n_attr_interaction - number of attribute interaction change stats funcs
  *   change_stats_funcs - array of pointers to change statistics functions
  *                        length is n-n_attr-n_dyadic-n_attr_interaction
+ *   lambda_values - array of lambda (decay) values corresponding to
+ *                   change_stats_funcs (used by alternating statistics)
  *   attr_change_stats_funcs - array of pointers to change statistics functions
  *                             length is n_attr
  *   dyadic_change_stats_funcs - array of pointers to dyadic change stats funcs
@@ -944,6 +2830,7 @@ double *empty_graph_stats(const digraph_t *g,
 			  uint_t n, uint_t n_attr, uint_t n_dyadic,
 			  uint_t n_attr_interaction,
 			  change_stats_func_t *change_stats_funcs[],
+			  double lambda_values[],
 			  attr_change_stats_func_t *attr_change_stats_funcs[],
 			  dyadic_change_stats_func_t *dyadic_change_stats_funcs[],
 			  attr_interaction_change_stats_func_t 
@@ -954,6 +2841,7 @@ double *empty_graph_stats(const digraph_t *g,
 {
   uint_t l, param_i = 0;
   
+  (void)lambda_values; /* unused parameter */
   (void)attr_change_stats_funcs; /* unused parameter */
   (void)dyadic_change_stats_funcs; /* unused parameter */
   (void)attr_interaction_change_stats_funcs; /* unused parameter */
@@ -989,3 +2877,343 @@ double *empty_graph_stats(const digraph_t *g,
   }
   return emptystats;
 }
+
+
+/*
+ * Test if all the statistics of a model can be computed directly by
+ * graph_stats().
+ *
+ * Parameters:
+ *   n      - number of parameters (length of theta vector and total
+ *            number of change statistic functions)
+ *   n_attr - number of attribute change stats functions
+ *   n_dyadic -number of dyadic covariate change stats funcs
+ *   n_attr_interaction - number of attribute interaction change stats funcs
+ *   change_stats_funcs - array of pointers to change statistics functions
+ *                        length is n-n_attr-n_dyadic-n_attr_interaction
+ *   attr_change_stats_funcs - array of pointers to change statistics functions
+ *                             length is n_attr
+ *   dyadic_change_stats_funcs - array of pointers to dyadic change stats funcs
+ *                             length is n_dyadic
+ *   attr_interaction_change_stats_funcs - array of pointers to attribute
+ *                                        interaction change statistics
+ *                                        functions. Length is
+ *                                        n_attr_interaction.
+ *
+ * Return value:
+ *   TRUE if graph_stats() can compute all the statistics else FALSE.
+ */
+bool graph_stats_supported(uint_t n, uint_t n_attr, uint_t n_dyadic,
+                           uint_t n_attr_interaction,
+                           change_stats_func_t *change_stats_funcs[],
+                           attr_change_stats_func_t *attr_change_stats_funcs[],
+                           dyadic_change_stats_func_t *dyadic_change_stats_funcs[],
+                           attr_interaction_change_stats_func_t
+                           *attr_interaction_change_stats_funcs[])
+{
+  uint_t l;
+  size_t k;
+
+  for (l = 0; l < n - n_attr - n_dyadic - n_attr_interaction; l++)
+    if (graph_stat_index(change_stats_funcs[l]) < 0)
+      return FALSE;
+  for (l = 0; l < n_attr; l++)
+    if (!(graph_attr_factor(attr_change_stats_funcs[l]) > 0))
+      return FALSE;
+  for (l = 0; l < n_dyadic; l++) {
+    for (k = 0; k < sizeof(GRAPH_DYADIC_FUNCS) /
+           sizeof(GRAPH_DYADIC_FUNCS[0]) &&
+           GRAPH_DYADIC_FUNCS[k] != dyadic_change_stats_funcs[l]; k++)
+      /*nothing*/;
+    if (k == sizeof(GRAPH_DYADIC_FUNCS) / sizeof(GRAPH_DYADIC_FUNCS[0]))
+      return FALSE;
+  }
+  for (l = 0; l < n_attr_interaction; l++) {
+    for (k = 0; k < sizeof(GRAPH_ATTR_INTERACTION_FUNCS) /
+           sizeof(GRAPH_ATTR_INTERACTION_FUNCS[0]) &&
+           GRAPH_ATTR_INTERACTION_FUNCS[k] !=
+           attr_interaction_change_stats_funcs[l]; k++)
+      /*nothing*/;
+    if (k == sizeof(GRAPH_ATTR_INTERACTION_FUNCS) /
+        sizeof(GRAPH_ATTR_INTERACTION_FUNCS[0]))
+      return FALSE;
+  }
+  return TRUE;
+}
+
+/*
+ * Compute the observed statistics of a graph directly from its
+ * degrees, arcs and two-paths, rather than by summing the change
+ * statistics as its arcs are added one at a time to the empty graph
+ * (which gives the same values, up to rounding). This is much faster
+ * for a large graph built all at once with build_digraph_arcs(), and
+ * does not need the two-path tables. The nodes are divided between
+ * g->build_threads threads (see set_twopath_build_threads()).
+ *
+ * Parameters:
+ *   g      - digraph (without self-loops)
+ *   n      - number of parameters (length of theta vector and total
+ *            number of change statistic functions)
+ *   n_attr - number of attribute change stats functions
+ *   n_dyadic -number of dyadic covariate change stats funcs
+ *   n_attr_interaction - number of attribute interaction change stats funcs
+ *   change_stats_funcs - array of pointers to change statistics functions
+ *                        length is n-n_attr-n_dyadic-n_attr_interaction
+ *   lambda_values - array of lambda (decay) values corresponding to
+ *                   change_stats_funcs (used by alternating statistics)
+ *   attr_change_stats_funcs - array of pointers to change statistics functions
+ *                             length is n_attr
+ *   dyadic_change_stats_funcs - array of pointers to dyadic change stats funcs
+ *                             length is n_dyadic
+ *   attr_interaction_change_stats_funcs - array of pointers to attribute
+ *                                        interaction change statistics
+ *                                        functions. Length is
+ *                                        n_attr_interaction.
+ *   attr_indices   - array of n_attr attribute indices (index into g->binattr
+ *                    or g->catattr) corresponding to attr_change_stats_funcs
+ *   attr_interaction_pair_indices - array of n_attr_interaction attribute pair
+ *                                   indices for attribute interaction effects.
+ *   stats - (OUT) array of n observed statistics values corresponding to
+ *           change stats funcs. Allocated by caller.
+ *
+ * Return value:
+ *   0 if OK, -1 if some statistic cannot be computed directly (see
+ *   graph_stats_supported()), in which case stats is not changed.
+ */
+int graph_stats(const digraph_t *g,
+                uint_t n, uint_t n_attr, uint_t n_dyadic,
+                uint_t n_attr_interaction,
+                change_stats_func_t *change_stats_funcs[],
+                double lambda_values[],
+                attr_change_stats_func_t *attr_change_stats_funcs[],
+                dyadic_change_stats_func_t *dyadic_change_stats_funcs[],
+                attr_interaction_change_stats_func_t
+                *attr_interaction_change_stats_funcs[],
+                uint_t attr_indices[],
+                uint_pair_t attr_interaction_pair_indices[],
+                double stats[])
+{
+  uint_t                n_struct = n - n_attr - n_dyadic - n_attr_interaction;
+  uint_t                num_threads = MAX(1, MIN(g->build_threads,
+                                                 g->num_nodes));
+  graph_stats_thread_t *args;
+  pthread_t            *threads;
+  bool                 *started;
+  int                  *kind;
+  double               *attr_factor;
+  uint_t                mask = 0, k, l;
+
+  if (!graph_stats_supported(n, n_attr, n_dyadic, n_attr_interaction,
+                             change_stats_funcs, attr_change_stats_funcs,
+                             dyadic_change_stats_funcs,
+                             attr_interaction_change_stats_funcs))
+    return -1;
+
+  kind = (int *)safe_malloc((n_struct + 1) * sizeof(int));
+  for (l = 0; l < n_struct; l++) {
+    kind[l] = graph_stat_index(change_stats_funcs[l]);
+    mask |= GRAPH_BIT(kind[l]);
+  }
+  attr_factor = (double *)safe_malloc((n - n_struct + 1) * sizeof(double));
+  for (l = 0; l < n_attr; l++)
+    attr_factor[l] = graph_attr_factor(attr_change_stats_funcs[l]);
+  for (l = n_attr; l < n - n_struct; l++)
+    attr_factor[l] = 1; /* dyadic and interaction statistics are all linear */
+
+  args = (graph_stats_thread_t *)safe_calloc(num_threads,
+                                             sizeof(graph_stats_thread_t));
+  threads = (pthread_t *)safe_malloc(num_threads * sizeof(pthread_t));
+  started = (bool *)safe_calloc(num_threads, sizeof(bool));
+  for (k = 0; k < num_threads; k++) {
+    args[k].g = g;
+    args[k].n = n;
+    args[k].n_attr = n_attr;
+    args[k].n_dyadic = n_dyadic;
+    args[k].n_attr_interaction = n_attr_interaction;
+    args[k].kind = kind;
+    args[k].lambda_values = lambda_values;
+    args[k].attr_factor = attr_factor;
+    args[k].attr_change_stats_funcs = attr_change_stats_funcs;
+    args[k].dyadic_change_stats_funcs = dyadic_change_stats_funcs;
+    args[k].attr_interaction_change_stats_funcs =
+      attr_interaction_change_stats_funcs;
+    args[k].attr_indices = attr_indices;
+    args[k].attr_interaction_pair_indices = attr_interaction_pair_indices;
+    args[k].mask = mask;
+    args[k].first_node = k;
+    args[k].step = num_threads;
+    if (mask & GRAPH_MIX_STATS)
+      args[k].mixcount = (uint_t *)safe_calloc(g->num_nodes, sizeof(uint_t));
+    if (mask & GRAPH_OUT_STATS)
+      args[k].outcount = (uint_t *)safe_calloc(g->num_nodes, sizeof(uint_t));
+    if (mask & GRAPH_IN_STATS)
+      args[k].incount = (uint_t *)safe_calloc(g->num_nodes, sizeof(uint_t));
+    if (mask & (GRAPH_MIX_STATS | GRAPH_OUT_STATS | GRAPH_IN_STATS))
+      args[k].touched = (uint_t *)safe_malloc(g->num_nodes * sizeof(uint_t));
+    args[k].stats = (double *)safe_calloc(n + 1, sizeof(double));
+  }
+  for (k = 1; k < num_threads; k++) {
+    if (pthread_create(&threads[k], NULL, graph_stats_thread, &args[k]) == 0)
+      started[k] = TRUE;
+    else
+      fprintf(stderr, "WARNING: could not create graph statistics thread, "
+              "running in main thread\n");
+  }
+  for (k = 0; k < num_threads; k++) {
+    if (!started[k])
+      graph_stats_thread(&args[k]);
+  }
+  /* sum the threads' totals in order so the result does not depend on
+     which finishes first */
+  for (l = 0; l < n; l++)
+    stats[l] = 0;
+  for (k = 0; k < num_threads; k++) {
+    if (started[k])
+      pthread_join(threads[k], NULL);
+    for (l = 0; l < n; l++)
+      stats[l] += args[k].stats[l];
+    free(args[k].mixcount);
+    free(args[k].outcount);
+    free(args[k].incount);
+    free(args[k].touched);
+    free(args[k].stats);
+  }
+  free(started);
+  free(threads);
+  free(args);
+  free(attr_factor);
+  free(kind);
+  return 0;
+}
+
+/*
+ * Name of the instruction set the multiversioned change statistics
+ * kernels (CPU_DISPATCH) run with on this CPU, for the log.
+ * The tests are in the same order of preference as the resolver's.
+ *
+ * Parameters:
+ *   None
+ *
+ * Return value:
+ *   Name of the instruction set (static string).
+ */
+const char *changestats_isa_name(void)
+{
+#if defined(CPU_DISPATCH_X86)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("x86-64-v4"))
+    return "x86-64-v4 (AVX-512)";
+  if (__builtin_cpu_supports("x86-64-v3"))
+    return "x86-64-v3 (AVX2)";
+  if (__builtin_cpu_supports("x86-64-v2"))
+    return "x86-64-v2 (SSE4.2, POPCNT)";
+  return "x86-64 (baseline)";
+#elif defined(CPU_DISPATCH_AARCH64)
+  if (getauxval(AT_HWCAP2) & HWCAP2_SVE2)
+    return "SVE2";
+  if (getauxval(AT_HWCAP) & HWCAP_SVE)
+    return "SVE";
+  return "NEON (baseline)";
+#else
+  return "build target (no dispatch)";
+#endif
+}
+
+/*
+ * Get the two-path tables (see set_twopath_tables()) that the change
+ * statistics of a model look up, so that only those need be kept
+ * up to date as arcs are toggled. The fused kernels
+ * (fusedStructuralChangeStats()) only look up the tables of the
+ * statistics they compute, so need no more.
+ *
+ * Parameters:
+ *   n_struct           - number of structural parameters
+ *   change_stats_funcs - array of pointers to change statistics functions
+ *                        length is n_struct
+ *
+ * Return value:
+ *   Bitwise OR of TWOPATH_TABLE_MIX, TWOPATH_TABLE_IN, TWOPATH_TABLE_OUT
+ *   for the tables used, 0 if none are.
+ */
+uint8_t twopath_tables_used(uint_t n_struct,
+                            change_stats_func_t *change_stats_funcs[])
+{
+  uint8_t tables = 0;
+  uint_t  l;
+
+  for (l = 0; l < n_struct; l++) {
+    if (change_stats_funcs[l] == changeAltKTrianglesT ||
+        change_stats_funcs[l] == changeAltKTrianglesC ||
+        change_stats_funcs[l] == changeAltTwoPathsT ||
+        change_stats_funcs[l] == changeCyclicTriad)
+      tables |= TWOPATH_TABLE_MIX;
+    else if (change_stats_funcs[l] == changeAltKTrianglesD ||
+             change_stats_funcs[l] == changeAltTwoPathsD)
+      tables |= TWOPATH_TABLE_OUT;
+    else if (change_stats_funcs[l] == changeAltKTrianglesU ||
+             change_stats_funcs[l] == changeAltTwoPathsU)
+      tables |= TWOPATH_TABLE_IN;
+    else if (change_stats_funcs[l] == changeAltTwoPathsTD)
+      tables |= TWOPATH_TABLE_MIX | TWOPATH_TABLE_OUT;
+    else if (change_stats_funcs[l] == changeTransitiveTriad)
+      tables |= TWOPATH_TABLE_IN | TWOPATH_TABLE_OUT;
+  }
+  return tables;
+}
+
+/*
+ * Set up the per-node values kept in a digraph for the structural
+ * statistics of a model whose change statistics depend only on node
+ * degrees (AltInStars and AltOutStars, see set_altstar_cache()), or
+ * stop keeping them if the model does not have those statistics, and
+ * the category pair table for its categorical attribute statistics
+ * (see build_cat_pair_table()).
+ * Must be called (from a single thread) before sampling from the model,
+ * as the values are for its lambda values and attributes.
+ *
+ * Parameters:
+ *   g                  - digraph, modified
+ *   n_struct           - number of structural parameters
+ *   change_stats_funcs - array of pointers to change statistics functions
+ *                        length is n_struct
+ *   lambda_values      - array of lambda values for change stats funcs
+ *                        same length as change_stats_funcs
+ *   n_attr, attr_change_stats_funcs, attr_indices, n_attr_interaction,
+ *   attr_interaction_change_stats_funcs,
+ *   attr_interaction_pair_indices - the nodal attribute and attribute
+ *                                   interaction effects of the model,
+ *                                   as for calcChangeStats()
+ *
+ * Return value:
+ *   None.
+ */
+void set_change_stats_caches(digraph_t *g, uint_t n_struct,
+                             change_stats_func_t *change_stats_funcs[],
+                             const double lambda_values[],
+                             uint_t n_attr,
+                             attr_change_stats_func_t
+                                             *attr_change_stats_funcs[],
+                             const uint_t attr_indices[],
+                             uint_t n_attr_interaction,
+                             attr_interaction_change_stats_func_t
+                                 *attr_interaction_change_stats_funcs[],
+                             const uint_pair_t attr_interaction_pair_indices[])
+{
+  double in_lambda = 0, out_lambda = 0;
+  uint_t l;
+
+  for (l = 0; l < n_struct; l++) {
+    if (change_stats_funcs[l] == changeAltInStars)
+      in_lambda = lambda_values[l];
+    else if (change_stats_funcs[l] == changeAltOutStars)
+      out_lambda = lambda_values[l];
+  }
+  if (islessgreater(in_lambda, g->altinstar_lambda) ||
+      islessgreater(out_lambda, g->altoutstar_lambda))
+    set_altstar_cache(g, in_lambda, out_lambda);
+  set_cat_pair_table(g, build_cat_pair_table(
+                       g, n_attr, attr_change_stats_funcs, attr_indices,
+                       n_attr_interaction,
+                       attr_interaction_change_stats_funcs,
+                       attr_interaction_pair_indices));
+}
@@ -56,9 +56,10 @@
  ****************************************************************************/
 
 /* 
- * lambda decay parameter for alternating statistics 
+ * default lambda decay parameter for alternating statistics, used when
+ * no value is given for the statistic in the configuration
  */
-extern const double lambda; /* TODO make it a configuration setting */
+extern const double DEFAULT_LAMBDA;
 
 
 /*****************************************************************************
@@ -67,42 +68,86 @@ extern const double lambda; /* TODO make it a configuration setting */
  *
  ****************************************************************************/
 
-/* typedef for change statistics function  */
-typedef double (change_stats_func_t)(const digraph_t *g, uint_t i, uint_t j);
+/* typedef for change statistics function. The lambda parameter is the
+   decay value for alternating statistics, and unused by the others.
+   The change statistic is always for adding arc i->j to g without it.
+   If isDelete is FALSE arc i->j is not in g, if TRUE it is in g (delete
+   move) and the statistic is computed as if it were not, correcting for
+   the degrees and two-paths it contributes, so the graph does not have
+   to be modified to evaluate a delete move. Attribute and dyadic
+   change statistics do not depend on the arcs in g so do not need this. */
+typedef double (change_stats_func_t)(const digraph_t *g, uint_t i, uint_t j,
+                                     double lambda, bool isDelete);
 
 /* version for change statistics with nodal attribute */
 typedef double (attr_change_stats_func_t)(const digraph_t *g, uint_t i, uint_t j, uint_t a);
 
-/* version for change statistics with dyadic covariate */
-/* for the moment just hte same as change_stats_func_t as treated specially,
-   only used for GeoDistance for now */
-typedef double (dyadic_change_stats_func_t)(const digraph_t *g, uint_t i, uint_t );
+/* version for change statistics with dyadic covariate. l is the
+   position of the statistic among the dyadic covariate statistics of the
+   model, used by changeDyadicCovariate() to find its covariate
+   (g->dyadcov_index[l]), and unused by the others, which are treated
+   specially as they use node attributes (e.g. latitude and longitude
+   for GeoDistance) marked in g by build_dyadic_indices_from_names() */
+typedef double (dyadic_change_stats_func_t)(const digraph_t *g, uint_t i,
+                                            uint_t j, uint_t l);
 
 /* change statistics with pairs of nodal attributes (attribute interactions) */
 typedef double (attr_interaction_change_stats_func_t)(const digraph_t *g, uint_t i, uint_t j, uint_t a, uint_t b);
 
+/* the change statistics of a batch of dyads (calcChangeStatsBatch())
+   are stored in single precision if BATCHSTATS_FLOAT is defined
+   (halving the memory and memory traffic of the batch, and doubling the
+   number in each vector register), else double. They are still computed
+   in double, and all sums of them (the totals, the accumulated change
+   statistics of the samplers, dzA) are double. */
+#ifdef BATCHSTATS_FLOAT
+typedef float  batchstat_t;
+#else
+typedef double batchstat_t;
+#endif /* BATCHSTATS_FLOAT */
+
 /************************* Structural ****************************************/
 
-double changeArc(const digraph_t *g, uint_t i, uint_t j);
-double changeReciprocity(const digraph_t *g, uint_t i, uint_t j);
-double changeSink(const digraph_t *g, uint_t i, uint_t j);
-double changeSource(const digraph_t *g, uint_t i, uint_t j);
-double changeInTwoStars(const digraph_t *g, uint_t i, uint_t j);
-double changeOutTwoStars(const digraph_t *g, uint_t i, uint_t j);
-double changeIsolates(const digraph_t *g, uint_t i, uint_t j);
-double changeTwoPath(const digraph_t *g, uint_t i, uint_t j);
-double changeTransitiveTriad(const digraph_t *g, uint_t i, uint_t j);
-double changeCyclicTriad(const digraph_t *g, uint_t i, uint_t j);
-double changeAltInStars(const digraph_t *g, uint_t i, uint_t j);
-double changeAltOutStars(const digraph_t *g, uint_t i, uint_t j);
-double changeAltKTrianglesT(const digraph_t *g, uint_t i, uint_t j);
-double changeAltKTrianglesC(const digraph_t *g, uint_t i, uint_t j);
-double changeAltKTrianglesD(const digraph_t *g, uint_t i, uint_t j);
-double changeAltKTrianglesU(const digraph_t *g, uint_t i, uint_t j);
-double changeAltTwoPathsT(const digraph_t *g, uint_t i, uint_t j);
-double changeAltTwoPathsD(const digraph_t *g, uint_t i, uint_t j);
-double changeAltTwoPathsU(const digraph_t *g, uint_t i, uint_t j);
-double changeAltTwoPathsTD(const digraph_t *g, uint_t i, uint_t j);
+double changeArc(const digraph_t *g, uint_t i, uint_t j,
+                 double lambda, bool isDelete);
+double changeReciprocity(const digraph_t *g, uint_t i, uint_t j,
+                         double lambda, bool isDelete);
+double changeSink(const digraph_t *g, uint_t i, uint_t j,
+                  double lambda, bool isDelete);
+double changeSource(const digraph_t *g, uint_t i, uint_t j,
+                    double lambda, bool isDelete);
+double changeInTwoStars(const digraph_t *g, uint_t i, uint_t j,
+                        double lambda, bool isDelete);
+double changeOutTwoStars(const digraph_t *g, uint_t i, uint_t j,
+                         double lambda, bool isDelete);
+double changeIsolates(const digraph_t *g, uint_t i, uint_t j,
+                      double lambda, bool isDelete);
+double changeTwoPath(const digraph_t *g, uint_t i, uint_t j,
+                     double lambda, bool isDelete);
+double changeTransitiveTriad(const digraph_t *g, uint_t i, uint_t j,
+                             double lambda, bool isDelete);
+double changeCyclicTriad(const digraph_t *g, uint_t i, uint_t j,
+                         double lambda, bool isDelete);
+double changeAltInStars(const digraph_t *g, uint_t i, uint_t j,
+                        double lambda, bool isDelete);
+double changeAltOutStars(const digraph_t *g, uint_t i, uint_t j,
+                         double lambda, bool isDelete);
+double changeAltKTrianglesT(const digraph_t *g, uint_t i, uint_t j,
+                            double lambda, bool isDelete);
+double changeAltKTrianglesC(const digraph_t *g, uint_t i, uint_t j,
+                            double lambda, bool isDelete);
+double changeAltKTrianglesD(const digraph_t *g, uint_t i, uint_t j,
+                            double lambda, bool isDelete);
+double changeAltKTrianglesU(const digraph_t *g, uint_t i, uint_t j,
+                            double lambda, bool isDelete);
+double changeAltTwoPathsT(const digraph_t *g, uint_t i, uint_t j,
+                          double lambda, bool isDelete);
+double changeAltTwoPathsD(const digraph_t *g, uint_t i, uint_t j,
+                          double lambda, bool isDelete);
+double changeAltTwoPathsU(const digraph_t *g, uint_t i, uint_t j,
+                          double lambda, bool isDelete);
+double changeAltTwoPathsTD(const digraph_t *g, uint_t i, uint_t j,
+                           double lambda, bool isDelete);
 
 /************************* Actor attribute (binary) **************************/
 
@@ -135,9 +180,11 @@ double changeJaccardSimilarity(const digraph_t *g, uint_t i, uint_t j, uint_t a)
 
 /********************* Dyadic covariate (continuous) *************************/
 
-double changeGeoDistance(const digraph_t *g, uint_t i, uint_t j);
-double changeLogGeoDistance(const digraph_t *g, uint_t i, uint_t j);
-double changeEuclideanDistance(const digraph_t *g, uint_t i, uint_t j);
+double changeGeoDistance(const digraph_t *g, uint_t i, uint_t j, uint_t l);
+double changeLogGeoDistance(const digraph_t *g, uint_t i, uint_t j, uint_t l);
+double changeEuclideanDistance(const digraph_t *g, uint_t i, uint_t j,
+                               uint_t l);
+double changeDyadicCovariate(const digraph_t *g, uint_t i, uint_t j, uint_t l);
 
 
 /************ Actor attribute interaction (categorical) *********************/
@@ -152,6 +199,7 @@ double calcChangeStats(const digraph_t *g, uint_t i, uint_t j,
                        uint_t n, uint_t n_attr, uint_t n_dyadic,
                        uint_t n_attr_interaction,
                        change_stats_func_t *change_stats_funcs[],
+                       double lambda_values[],
                        attr_change_stats_func_t *attr_change_stats_funcs[],
                        dyadic_change_stats_func_t *dyadic_change_stats_funcs[],
                        attr_interaction_change_stats_func_t 
@@ -162,13 +210,74 @@ double calcChangeStats(const digraph_t *g, uint_t i, uint_t j,
                        bool isDelete,
                        double changestats[]);
 
+double calcChangeStatsEarlyReject(const digraph_t *g, uint_t i, uint_t j,
+                                  uint_t n, uint_t n_attr, uint_t n_dyadic,
+                                  uint_t n_attr_interaction,
+                                  change_stats_func_t *change_stats_funcs[],
+                                  double lambda_values[],
+                                  attr_change_stats_func_t
+                                               *attr_change_stats_funcs[],
+                                  dyadic_change_stats_func_t
+                                             *dyadic_change_stats_funcs[],
+                                  attr_interaction_change_stats_func_t
+                                  *attr_interaction_change_stats_funcs[],
+                                  uint_t attr_indices[],
+                                  uint_pair_t attr_interaction_pair_indices[],
+                                  const double theta[],
+                                  bool isDelete,
+                                  double log_u,
+                                  double changestats[]);
+
+double changeStatsTotal(uint_t n, const double theta[], bool isDelete,
+                        const double changestats[]);
+
+
+void calcChangeStatsBatch(const digraph_t *g, uint_t num_dyads,
+                          const nodepair_t dyads[], const bool isDelete[],
+                          uint_t n, uint_t n_attr, uint_t n_dyadic,
+                          uint_t n_attr_interaction,
+                          change_stats_func_t *change_stats_funcs[],
+                          double lambda_values[],
+                          attr_change_stats_func_t *attr_change_stats_funcs[],
+                          dyadic_change_stats_func_t *dyadic_change_stats_funcs[],
+                          attr_interaction_change_stats_func_t
+                                        *attr_interaction_change_stats_funcs[],
+                          uint_t attr_indices[],
+                          uint_pair_t attr_interaction_pair_indices[],
+                          const double theta[],
+                          batchstat_t changestats[],
+                          double totals[]);
 
 double jaccard_index(set_elem_e a[], set_elem_e b[], uint_t n);
+double jaccard_index_bits(const uint64_t a[], const uint64_t b[],
+                          uint_t nwords);
+const char *changestats_isa_name(void);
+uint8_t twopath_tables_used(uint_t n_struct,
+                            change_stats_func_t *change_stats_funcs[]);
+cat_pair_table_t *build_cat_pair_table(const digraph_t *g, uint_t n_attr,
+                           attr_change_stats_func_t *attr_change_stats_funcs[],
+                           const uint_t attr_indices[],
+                           uint_t n_attr_interaction,
+                           attr_interaction_change_stats_func_t
+                                       *attr_interaction_change_stats_funcs[],
+                           const uint_pair_t attr_interaction_pair_indices[]);
+void set_change_stats_caches(digraph_t *g, uint_t n_struct,
+                             change_stats_func_t *change_stats_funcs[],
+                             const double lambda_values[],
+                             uint_t n_attr,
+                             attr_change_stats_func_t
+                                             *attr_change_stats_funcs[],
+                             const uint_t attr_indices[],
+                             uint_t n_attr_interaction,
+                             attr_interaction_change_stats_func_t
+                                 *attr_interaction_change_stats_funcs[],
+                             const uint_pair_t attr_interaction_pair_indices[]);
 
 double *empty_graph_stats(const digraph_t *g,
 			  uint_t n, uint_t n_attr, uint_t n_dyadic,
 			  uint_t n_attr_interaction,
 			  change_stats_func_t *change_stats_funcs[],
+			  double lambda_values[],
 			  attr_change_stats_func_t *attr_change_stats_funcs[],
 			  dyadic_change_stats_func_t *dyadic_change_stats_funcs[],
 			  attr_interaction_change_stats_func_t 
@@ -177,5 +286,25 @@ double *empty_graph_stats(const digraph_t *g,
 			  uint_pair_t attr_interaction_pair_indices[],
 			  double emptystats[]);
 
+bool graph_stats_supported(uint_t n, uint_t n_attr, uint_t n_dyadic,
+                           uint_t n_attr_interaction,
+                           change_stats_func_t *change_stats_funcs[],
+                           attr_change_stats_func_t *attr_change_stats_funcs[],
+                           dyadic_change_stats_func_t *dyadic_change_stats_funcs[],
+                           attr_interaction_change_stats_func_t
+                           *attr_interaction_change_stats_funcs[]);
+int graph_stats(const digraph_t *g,
+                uint_t n, uint_t n_attr, uint_t n_dyadic,
+                uint_t n_attr_interaction,
+                change_stats_func_t *change_stats_funcs[],
+                double lambda_values[],
+                attr_change_stats_func_t *attr_change_stats_funcs[],
+                dyadic_change_stats_func_t *dyadic_change_stats_funcs[],
+                attr_interaction_change_stats_func_t
+                *attr_interaction_change_stats_funcs[],
+                uint_t attr_indices[],
+                uint_pair_t attr_interaction_pair_indices[],
+                double stats[]);
+
 #endif /* CHANGESTATISTICSDIRECTED_H */
 
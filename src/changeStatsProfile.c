@@ -0,0 +1,262 @@
+/*****************************************************************************
+ *
+ * File:    changeStatsProfile.c
+ * Author:  Alex Stivala
+ * Created: October 2026
+ *
+ * Profiling counters for the change statistics and graph updates (see
+ * changeStatsProfile.h).
+ *
+ ****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "changeStatsProfile.h"
+
+/*****************************************************************************
+ *
+ * File static variables
+ *
+ ****************************************************************************/
+
+static uint64_t stat_calls[PROFILE_MAX_PARAMS];
+static uint64_t stat_ticks[PROFILE_MAX_PARAMS];
+static bool     stat_fused[PROFILE_MAX_PARAMS];
+static uint64_t fused_calls, fused_ticks;
+static uint64_t dyad_calls, dyad_neighbours;
+static uint64_t op_calls[NUM_PROFILE_OPS];
+static uint64_t op_ticks[NUM_PROFILE_OPS];
+static uint64_t op_neighbours[NUM_PROFILE_OPS];
+
+static const char *const OP_NAMES[NUM_PROFILE_OPS] = {
+  "insertArc", "removeArc", "updateTwoPathsMatrices"
+};
+
+#ifndef PROFILE_CLOCK_UNIT
+#define PROFILE_CLOCK_UNIT "cycles"
+#endif
+
+/*****************************************************************************
+ *
+ * Local functions
+ *
+ ****************************************************************************/
+
+typedef struct profile_row_s {
+  uint_t   param_i;   /* parameter index, or n for the fused statistics */
+  uint64_t calls;
+  uint64_t ticks;
+} profile_row_t;
+
+/* qsort comparison: descending ticks, then ascending parameter index */
+static int compare_rows(const void *a, const void *b)
+{
+  const profile_row_t *ra = (const profile_row_t *)a;
+  const profile_row_t *rb = (const profile_row_t *)b;
+
+  if (ra->ticks != rb->ticks)
+    return ra->ticks > rb->ticks ? -1 : 1;
+  return ra->param_i < rb->param_i ? -1 : (ra->param_i > rb->param_i);
+}
+
+static void atomic_add(uint64_t *counter, uint64_t value)
+{
+  (void)__atomic_fetch_add(counter, value, __ATOMIC_RELAXED);
+}
+
+/*****************************************************************************
+ *
+ * externally visible functions
+ *
+ ****************************************************************************/
+
+/*
+ * Set all the counters to zero.
+ *
+ * Parameters:
+ *   None
+ *
+ * Return value:
+ *   None.
+ */
+void profile_reset(void)
+{
+  memset(stat_calls, 0, sizeof(stat_calls));
+  memset(stat_ticks, 0, sizeof(stat_ticks));
+  memset(stat_fused, 0, sizeof(stat_fused));
+  fused_calls = fused_ticks = 0;
+  dyad_calls = dyad_neighbours = 0;
+  memset(op_calls, 0, sizeof(op_calls));
+  memset(op_ticks, 0, sizeof(op_ticks));
+  memset(op_neighbours, 0, sizeof(op_neighbours));
+}
+
+/*
+ * Add calls of the change statistic of a parameter and their time.
+ *
+ * Parameters:
+ *   param_i - parameter index
+ *   ticks   - cycles (or ns) spent
+ *   calls   - number of calls (dyads)
+ *
+ * Return value:
+ *   None.
+ */
+void profile_add_stat(uint_t param_i, uint64_t ticks, uint64_t calls)
+{
+  if (param_i >= PROFILE_MAX_PARAMS)
+    return;
+  atomic_add(&stat_calls[param_i], calls);
+  atomic_add(&stat_ticks[param_i], ticks);
+}
+
+/*
+ * Add calls of the change statistic of a parameter that is computed by
+ * the fused kernel, whose time is added with profile_add_fused().
+ *
+ * Parameters:
+ *   param_i - parameter index
+ *   calls   - number of calls (dyads)
+ *
+ * Return value:
+ *   None.
+ */
+void profile_add_fused_stat(uint_t param_i, uint64_t calls)
+{
+  if (param_i >= PROFILE_MAX_PARAMS)
+    return;
+  atomic_add(&stat_calls[param_i], calls);
+  __atomic_store_n(&stat_fused[param_i], TRUE, __ATOMIC_RELAXED);
+}
+
+/*
+ * Add calls of the fused structural statistics kernel and their time.
+ *
+ * Parameters:
+ *   ticks   - cycles (or ns) spent
+ *   calls   - number of calls (dyads)
+ *
+ * Return value:
+ *   None.
+ */
+void profile_add_fused(uint64_t ticks, uint64_t calls)
+{
+  atomic_add(&fused_calls, calls);
+  atomic_add(&fused_ticks, ticks);
+}
+
+/*
+ * Add a dyad whose change statistics are computed.
+ *
+ * Parameters:
+ *   neighbours - total length of the neighbour lists of its nodes
+ *
+ * Return value:
+ *   None.
+ */
+void profile_add_dyad(uint64_t neighbours)
+{
+  atomic_add(&dyad_calls, 1);
+  atomic_add(&dyad_neighbours, neighbours);
+}
+
+/*
+ * Add a call of a graph update and its time.
+ *
+ * Parameters:
+ *   op         - graph update
+ *   ticks      - cycles (or ns) spent
+ *   neighbours - total length of the neighbour lists of the arc nodes
+ *
+ * Return value:
+ *   None.
+ */
+void profile_add_op(profile_op_e op, uint64_t ticks, uint64_t neighbours)
+{
+  atomic_add(&op_calls[op], 1);
+  atomic_add(&op_ticks[op], ticks);
+  atomic_add(&op_neighbours[op], neighbours);
+}
+
+/*
+ * Write the counters as tables: the change statistics ranked by time,
+ * with the fused kernel as one row (and the statistics it computes
+ * marked with *), then the graph updates.
+ *
+ * Parameters:
+ *   fp     - open (write) file to write to
+ *   n      - number of parameters
+ *   names  - names of the n parameters separated by spaces, or NULL
+ *   prefix - written at the start of each line (e.g. "task 0: ")
+ *
+ * Return value:
+ *   None.
+ */
+void profile_write_report(FILE *fp, uint_t n, const char *names,
+                          const char *prefix)
+{
+  char          **name = (char **)safe_calloc(n + 1, sizeof(char *));
+  char           *names_copy = safe_strdup(names ? names : "");
+  char           *saveptr = NULL;
+  char            label[64];
+  profile_row_t  *rows;
+  uint_t          num_rows = 0, i, k;
+  uint64_t        total = fused_ticks;
+  double          percent;
+
+  if (n > PROFILE_MAX_PARAMS)
+    n = PROFILE_MAX_PARAMS;
+  name[0] = strtok_r(names_copy, " ", &saveptr);
+  for (i = 1; i < n && name[i-1]; i++)
+    name[i] = strtok_r(NULL, " ", &saveptr);
+
+  rows = (profile_row_t *)safe_malloc((n + 1) * sizeof(profile_row_t));
+  for (i = 0; i < n; i++) {
+    rows[num_rows].param_i = i;
+    rows[num_rows].calls = stat_calls[i];
+    rows[num_rows++].ticks = stat_ticks[i];
+    total += stat_ticks[i];
+  }
+  if (fused_calls > 0) {
+    rows[num_rows].param_i = n;
+    rows[num_rows].calls = fused_calls;
+    rows[num_rows++].ticks = fused_ticks;
+  }
+  qsort(rows, num_rows, sizeof(profile_row_t), compare_rows);
+
+  fprintf(fp, "%schange statistics profile (%s):\n", prefix,
+          PROFILE_CLOCK_UNIT);
+  fprintf(fp, "%s%4s %-34s %14s %16s %12s %7s\n", prefix, "Rank",
+          "Statistic", "Calls", "Total", "PerCall", "%Total");
+  for (k = 0; k < num_rows; k++) {
+    i = rows[k].param_i;
+    if (i == n)
+      snprintf(label, sizeof(label), "(fused statistics *)");
+    else
+      snprintf(label, sizeof(label), "%s%s",
+               name[i] ? name[i] : "?", stat_fused[i] ? " *" : "");
+    percent = total > 0 ? 100.0 * rows[k].ticks / total : 0;
+    fprintf(fp, "%s%4u %-34s %14llu %16llu %12.1f %7.2f\n", prefix, k + 1,
+            label, (unsigned long long)rows[k].calls,
+            (unsigned long long)rows[k].ticks,
+            rows[k].calls > 0 ? (double)rows[k].ticks / rows[k].calls : 0,
+            percent);
+  }
+  fprintf(fp, "%sdyads %llu, neighbour list entries of dyad nodes %llu "
+          "(%.1f per dyad)\n", prefix, (unsigned long long)dyad_calls,
+          (unsigned long long)dyad_neighbours,
+          dyad_calls > 0 ? (double)dyad_neighbours / dyad_calls : 0);
+
+  fprintf(fp, "%s%-27s %14s %16s %12s %16s\n", prefix, "Graph update",
+          "Calls", "Total", "PerCall", "Neighbours");
+  for (k = 0; k < NUM_PROFILE_OPS; k++)
+    fprintf(fp, "%s%-27s %14llu %16llu %12.1f %16llu\n", prefix,
+            OP_NAMES[k], (unsigned long long)op_calls[k],
+            (unsigned long long)op_ticks[k],
+            op_calls[k] > 0 ? (double)op_ticks[k] / op_calls[k] : 0,
+            (unsigned long long)op_neighbours[k]);
+  free(rows);
+  free(names_copy);
+  free(name);
+}
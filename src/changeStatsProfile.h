@@ -0,0 +1,99 @@
+#ifndef CHANGESTATSPROFILE_H
+#define CHANGESTATSPROFILE_H
+/*****************************************************************************
+ *
+ * File:    changeStatsProfile.h
+ * Author:  Alex Stivala
+ * Created: October 2026
+ *
+ * Profiling counters for the hot paths of the samplers, to find which
+ * term of a slow model is responsible: the number of calls and the
+ * cycles (rdtsc, or nanoseconds where there is no time stamp counter)
+ * spent in each change statistic, by parameter index, in
+ * calcChangeStats() and calcChangeStatsBatch(), and in the graph
+ * updates insertArc(), removeArc() and updateTwoPathsMatrices(), with
+ * the lengths of the neighbour lists of the dyad nodes (their in- plus
+ * out-degrees), which is what most change statistics and the two-path
+ * updates scan. EstimNetDirected prints the counters as a ranked table
+ * after ee_estimate() has finished.
+ *
+ * The counters are only compiled in with -DPROFILE_CHANGESTATS (see
+ * common.mk), as reading the clock around every change statistic
+ * slows the sampler. They are updated atomically so the threads of
+ * Algorithm S can share them. The structural statistics computed
+ * together in one pass by the fused kernels (fusedDispatch()) are
+ * timed together, as the "fused statistics" row, and marked in the
+ * table; build also with -DNO_FUSED_CHANGESTATS to time them
+ * separately.
+ *
+ ****************************************************************************/
+
+#include <stdio.h>
+#include <stdint.h>
+#include "utils.h"
+
+#define PROFILE_MAX_PARAMS 1024 /* parameters beyond this are not counted */
+
+typedef enum profile_op_e {
+  PROFILE_OP_INSERT_ARC,      /* insertArc() (including two-path update) */
+  PROFILE_OP_REMOVE_ARC,      /* removeArc() (including two-path update) */
+  PROFILE_OP_TWOPATH_UPDATE,  /* updateTwoPathsMatrices() */
+  NUM_PROFILE_OPS
+} profile_op_e;
+
+#ifdef PROFILE_CHANGESTATS
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+static inline uint64_t profile_clock(void)
+{
+  return __rdtsc();
+}
+#define PROFILE_CLOCK_UNIT "cycles"
+#else
+#include <time.h>
+static inline uint64_t profile_clock(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
+#define PROFILE_CLOCK_UNIT "ns"
+#endif /* x86 */
+
+#define PROFILE_START(t)             ((t) = profile_clock())
+#define PROFILE_STAT(param_i, t, calls) \
+  profile_add_stat((param_i), profile_clock() - (t), (calls))
+#define PROFILE_FUSED_STAT(param_i, calls) \
+  profile_add_fused_stat((param_i), (calls))
+#define PROFILE_FUSED(t, calls)      profile_add_fused(profile_clock() - (t), \
+                                                       (calls))
+#define PROFILE_DYAD(g, i, j)        profile_add_dyad( \
+    (uint64_t)(g)->outdegree[i] + (g)->indegree[i] + \
+    (g)->outdegree[j] + (g)->indegree[j])
+#define PROFILE_OP(op, t, g, i, j)   profile_add_op((op), \
+    profile_clock() - (t), \
+    (uint64_t)(g)->outdegree[i] + (g)->indegree[i] + \
+    (g)->outdegree[j] + (g)->indegree[j])
+
+#else /* no profiling: the macros do nothing */
+
+#define PROFILE_START(t)
+#define PROFILE_STAT(param_i, t, calls)
+#define PROFILE_FUSED_STAT(param_i, calls)
+#define PROFILE_FUSED(t, calls)
+#define PROFILE_DYAD(g, i, j)
+#define PROFILE_OP(op, t, g, i, j)
+
+#endif /* PROFILE_CHANGESTATS */
+
+void profile_reset(void);
+void profile_add_stat(uint_t param_i, uint64_t ticks, uint64_t calls);
+void profile_add_fused_stat(uint_t param_i, uint64_t calls);
+void profile_add_fused(uint64_t ticks, uint64_t calls);
+void profile_add_dyad(uint64_t neighbours);
+void profile_add_op(profile_op_e op, uint64_t ticks, uint64_t neighbours);
+void profile_write_report(FILE *fp, uint_t n, const char *names,
+                          const char *prefix);
+
+#endif /* CHANGESTATSPROFILE_H */
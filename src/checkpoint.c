@@ -0,0 +1,224 @@
+/*****************************************************************************
+ *
+ * File:    checkpoint.c
+ * Author:  Alex Stivala, Maksym Byshkin
+ * Created: October 2026
+ *
+ * Checkpoint files holding the full state of Algorithm EE for one
+ * estimation task (see checkpoint.h).
+ *
+ * A checkpoint is written to a temporary file which is then renamed
+ * over the previous one, so that a run killed while writing a
+ * checkpoint still leaves the previous (complete) one.
+ *
+ ****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include "checkpoint.h"
+
+/*****************************************************************************
+ *
+ * local constants
+ *
+ ****************************************************************************/
+
+/* magic string at start of checkpoint file, last character is version;
+   the sixth and seventh are different in NODEID16 and ARCS64 builds, as
+   the sizes of the arcs (nodepair_t) and num_arcs are different */
+#ifdef NODEID16
+#define CHECKPOINT_MAGIC_NODEID '1'
+#else
+#define CHECKPOINT_MAGIC_NODEID 'P'
+#endif /* NODEID16 */
+#ifdef ARCS64
+#define CHECKPOINT_MAGIC_ARCS   '6'
+#else
+#define CHECKPOINT_MAGIC_ARCS   'T'
+#endif /* ARCS64 */
+static const char CHECKPOINT_MAGIC[8] = {'E','N','D','C','K',
+                                         CHECKPOINT_MAGIC_NODEID,
+                                         CHECKPOINT_MAGIC_ARCS, '2'};
+
+/*****************************************************************************
+ *
+ * local functions
+ *
+ ****************************************************************************/
+
+/*
+ * Write count items of size bytes to fp, returning nonzero on error
+ */
+static int write_items(FILE *fp, const void *data, size_t size, size_t count)
+{
+  return count > 0 && fwrite(data, size, count, fp) != count;
+}
+
+/*
+ * Read count items of size bytes from fp, returning nonzero on error
+ */
+static int read_items(FILE *fp, void *data, size_t size, size_t count)
+{
+  return count > 0 && fread(data, size, count, fp) != count;
+}
+
+/*****************************************************************************
+ *
+ * externally visible functions
+ *
+ ****************************************************************************/
+
+/*
+ * Write Algorithm EE state to checkpoint file.
+ *
+ * Parameters:
+ *   filename - name of checkpoint file, replaced if it exists
+ *   ckpt     - state to write
+ *
+ * Return value:
+ *   0 if OK else nonzero on error (message printed to stderr, and any
+ *   previous checkpoint file left unchanged).
+ */
+int write_ee_checkpoint(const char *filename, const ee_checkpoint_t *ckpt)
+{
+  char  tmp_filename[PATH_MAX+1];
+  FILE *fp;
+  int   err = 0;
+
+  snprintf(tmp_filename, sizeof(tmp_filename), "%s.tmp", filename);
+  if (!(fp = fopen(tmp_filename, "wb"))) {
+    fprintf(stderr, "ERROR: could not open checkpoint file %s for writing "
+            "(%s)\n", tmp_filename, strerror(errno));
+    return -1;
+  }
+  err |= write_items(fp, CHECKPOINT_MAGIC, 1, sizeof(CHECKPOINT_MAGIC));
+  err |= write_items(fp, &ckpt->num_nodes, sizeof(ckpt->num_nodes), 1);
+  err |= write_items(fp, &ckpt->n, sizeof(ckpt->n), 1);
+  err |= write_items(fp, &ckpt->touter, sizeof(ckpt->touter), 1);
+  err |= write_items(fp, &ckpt->t, sizeof(ckpt->t), 1);
+  err |= write_items(fp, &ckpt->iterations, sizeof(ckpt->iterations), 1);
+  err |= write_items(fp, &ckpt->sampler_m, sizeof(ckpt->sampler_m), 1);
+  err |= write_items(fp, &ckpt->max_sampler_m, sizeof(ckpt->max_sampler_m), 1);
+  err |= write_items(fp, &ckpt->prev_rho_dzA, sizeof(ckpt->prev_rho_dzA), 1);
+  err |= write_items(fp, &ckpt->doubled, sizeof(ckpt->doubled), 1);
+  err |= write_items(fp, &ckpt->prng, sizeof(ckpt->prng), 1);
+  err |= write_items(fp, &ckpt->theta_file_pos,
+                     sizeof(ckpt->theta_file_pos), 1);
+  err |= write_items(fp, &ckpt->dzA_file_pos, sizeof(ckpt->dzA_file_pos), 1);
+  err |= write_items(fp, &ckpt->inner_arcs, sizeof(ckpt->inner_arcs), 1);
+  err |= write_items(fp, &ckpt->num_arcs, sizeof(ckpt->num_arcs), 1);
+  err |= write_items(fp, &ckpt->sampler_state_size,
+                     sizeof(ckpt->sampler_state_size), 1);
+  err |= write_items(fp, ckpt->theta, sizeof(double), ckpt->n);
+  err |= write_items(fp, ckpt->D0, sizeof(double), ckpt->n);
+  err |= write_items(fp, ckpt->dzA, sizeof(double), ckpt->n);
+  err |= write_items(fp, ckpt->sampler_state, 1, ckpt->sampler_state_size);
+  err |= write_items(fp, ckpt->arcs, sizeof(nodepair_t), ckpt->num_arcs);
+  err |= fclose(fp);
+  if (err) {
+    fprintf(stderr, "ERROR: writing checkpoint file %s failed (%s)\n",
+            tmp_filename, strerror(errno));
+    remove(tmp_filename);
+    return -1;
+  }
+  if (rename(tmp_filename, filename)) {
+    fprintf(stderr, "ERROR: could not rename %s to %s (%s)\n",
+            tmp_filename, filename, strerror(errno));
+    return -1;
+  }
+  return 0;
+}
+
+/*
+ * Read Algorithm EE state from checkpoint file.
+ *
+ * Parameters:
+ *   filename - name of checkpoint file
+ *   ckpt     - (Out) state read, its arrays allocated here, free with
+ *              free_ee_checkpoint()
+ *
+ * Return value:
+ *   0 if OK else nonzero on error (message printed to stderr, and ckpt
+ *   has no arrays allocated).
+ */
+int read_ee_checkpoint(const char *filename, ee_checkpoint_t *ckpt)
+{
+  char  magic[sizeof(CHECKPOINT_MAGIC)];
+  FILE *fp;
+  int   err = 0;
+
+  memset(ckpt, 0, sizeof(*ckpt));
+  if (!(fp = fopen(filename, "rb"))) {
+    fprintf(stderr, "ERROR: could not open checkpoint file %s (%s)\n",
+            filename, strerror(errno));
+    return -1;
+  }
+  if (read_items(fp, magic, 1, sizeof(magic)) ||
+      memcmp(magic, CHECKPOINT_MAGIC, sizeof(magic)) != 0) {
+    fprintf(stderr, "ERROR: %s is not a checkpoint file of this version\n",
+            filename);
+    fclose(fp);
+    return -1;
+  }
+  err |= read_items(fp, &ckpt->num_nodes, sizeof(ckpt->num_nodes), 1);
+  err |= read_items(fp, &ckpt->n, sizeof(ckpt->n), 1);
+  err |= read_items(fp, &ckpt->touter, sizeof(ckpt->touter), 1);
+  err |= read_items(fp, &ckpt->t, sizeof(ckpt->t), 1);
+  err |= read_items(fp, &ckpt->iterations, sizeof(ckpt->iterations), 1);
+  err |= read_items(fp, &ckpt->sampler_m, sizeof(ckpt->sampler_m), 1);
+  err |= read_items(fp, &ckpt->max_sampler_m, sizeof(ckpt->max_sampler_m), 1);
+  err |= read_items(fp, &ckpt->prev_rho_dzA, sizeof(ckpt->prev_rho_dzA), 1);
+  err |= read_items(fp, &ckpt->doubled, sizeof(ckpt->doubled), 1);
+  err |= read_items(fp, &ckpt->prng, sizeof(ckpt->prng), 1);
+  err |= read_items(fp, &ckpt->theta_file_pos,
+                    sizeof(ckpt->theta_file_pos), 1);
+  err |= read_items(fp, &ckpt->dzA_file_pos, sizeof(ckpt->dzA_file_pos), 1);
+  err |= read_items(fp, &ckpt->inner_arcs, sizeof(ckpt->inner_arcs), 1);
+  err |= read_items(fp, &ckpt->num_arcs, sizeof(ckpt->num_arcs), 1);
+  err |= read_items(fp, &ckpt->sampler_state_size,
+                    sizeof(ckpt->sampler_state_size), 1);
+  if (!err) {
+    ckpt->theta = (double *)safe_malloc(ckpt->n * sizeof(double));
+    ckpt->D0 = (double *)safe_malloc(ckpt->n * sizeof(double));
+    ckpt->dzA = (double *)safe_malloc(ckpt->n * sizeof(double));
+    ckpt->sampler_state = safe_malloc(ckpt->sampler_state_size + 1);
+    ckpt->arcs = (nodepair_t *)safe_malloc((ckpt->num_arcs + 1) *
+                                           sizeof(nodepair_t));
+    err |= read_items(fp, ckpt->theta, sizeof(double), ckpt->n);
+    err |= read_items(fp, ckpt->D0, sizeof(double), ckpt->n);
+    err |= read_items(fp, ckpt->dzA, sizeof(double), ckpt->n);
+    err |= read_items(fp, ckpt->sampler_state, 1, ckpt->sampler_state_size);
+    err |= read_items(fp, ckpt->arcs, sizeof(nodepair_t), ckpt->num_arcs);
+  }
+  fclose(fp);
+  if (err) {
+    fprintf(stderr, "ERROR: checkpoint file %s is truncated\n", filename);
+    free_ee_checkpoint(ckpt);
+    return -1;
+  }
+  return 0;
+}
+
+/*
+ * Free the arrays of a checkpoint read by read_ee_checkpoint().
+ *
+ * Parameters:
+ *   ckpt - checkpoint state
+ *
+ * Return value:
+ *   None.
+ */
+void free_ee_checkpoint(ee_checkpoint_t *ckpt)
+{
+  free(ckpt->theta);
+  free(ckpt->D0);
+  free(ckpt->dzA);
+  free(ckpt->sampler_state);
+  free(ckpt->arcs);
+  ckpt->theta = ckpt->D0 = ckpt->dzA = NULL;
+  ckpt->sampler_state = NULL;
+  ckpt->arcs = NULL;
+}
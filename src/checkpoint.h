@@ -0,0 +1,57 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+/*****************************************************************************
+ *
+ * File:    checkpoint.h
+ * Author:  Alex Stivala, Maksym Byshkin
+ * Created: October 2026
+ *
+ * Checkpoint files holding the full state of Algorithm EE for one
+ * estimation task, so that a run that is killed (e.g. preempted by the
+ * job scheduler) can be restarted from its last checkpoint rather than
+ * from the beginning, continuing the same Markov chain. SimulateERGM
+ * uses the same files for the state of a simulation chain at the end
+ * of a run (only num_nodes, n, iterations, prng, inner_arcs, arcs,
+ * theta, dzA and the sampler state are used), so that the next run can
+ * continue the chain (see stateFile and writeStateFile).
+ *
+ * The file is binary, in the native byte order and type sizes (it is
+ * for restarting on the same system, not for exchange): a magic
+ * string and version, then the fields of ee_checkpoint_t in order,
+ * then the arrays.
+ *
+ ****************************************************************************/
+
+#include <stdio.h>
+#include "utils.h"
+#include "digraph.h"
+
+typedef struct ee_checkpoint_s {
+  uint_t      num_nodes;      /* number of nodes in the digraph */
+  uint_t      n;              /* number of parameters */
+  uint_t      touter;         /* outer iterations of Algorithm EE done */
+  uint_t      t;              /* (inner) iterations of Algorithm EE done */
+  ulonglong_t iterations;     /* sampler iterations of simulation done */
+  uint_t      sampler_m;      /* sampler steps (adaptiveSamplerSteps) */
+  uint_t      max_sampler_m;  /* limit on sampler_m (adaptiveSamplerSteps) */
+  double      prev_rho_dzA;   /* dzA autocorrelation before last doubling */
+  bool        doubled;        /* sampler_m doubled after last outer iter */
+  prng_t      prng;           /* random stream of the task */
+  long        theta_file_pos; /* length of theta output file */
+  long        dzA_file_pos;   /* length of dzA output file */
+  bool        inner_arcs;     /* arcs are allinnerarcs (conditional
+                                 estimation) rather than allarcs */
+  arcidx_t    num_arcs;       /* length of arcs */
+  size_t      sampler_state_size; /* bytes of sampler_state */
+  double     *theta;          /* n parameter values */
+  double     *D0;             /* n values of D0 */
+  double     *dzA;            /* n accumulated statistic differences */
+  void       *sampler_state;  /* sampler state (e.g. IFD auxiliary param) */
+  nodepair_t *arcs;           /* flat arc list, in order */
+} ee_checkpoint_t;
+
+int write_ee_checkpoint(const char *filename, const ee_checkpoint_t *ckpt);
+int read_ee_checkpoint(const char *filename, ee_checkpoint_t *ckpt);
+void free_ee_checkpoint(ee_checkpoint_t *ckpt);
+
+#endif /* CHECKPOINT_H */
@@ -33,7 +33,12 @@ WARNFLAGS  += -Wextra -Wfloat-equal  \
 
 CDEBUG = -g -DDEBUG_CONFIG  -DDEBUG_SAMPLER  -DDEBUG_DIGRAPH -DDEBUG_ALGS -DDEBUG_SNOWBALL -DDEBUG_MEMUSAGE -DDEBUG_SIMULATE
 # Do NOT use -ffast-math as we depend on IEEE handling of NaN
-OPTFLAGS = -O3  #-pg
+# -ffp-contract=off so that the change statistics kernels compiled for
+# CPUs with FMA (see CPU_DISPATCH in utils.h)
+# give the same results as on those without; add -DNO_CPU_DISPATCH to
+# CPPFLAGS to compile them only for the build target (e.g. with
+# -march=native for one machine)
+OPTFLAGS = -O3 -ffp-contract=off #-pg
 CFLAGS     = $(OPTFLAGS) $(WARNFLAGS)
 
 # Use the Random123 library
@@ -42,7 +47,22 @@ CPPFLAGS =  -DUSE_RANDOM123 -IRandom123-1.09/include
 ## Use lookup table for pow()
 #CPPFLAGS += -DUSE_POW_LOOKUP
 
-# Using the uthash hash table 
+## Store the dense two-path arrays in 64 x 64 tiles rather than row-major
+## (see digraph.h), so the column accesses of the two-path updates are
+## not each a cache and TLB miss in a large network. Best together with
+## nodeOrder = RCM (or degree) so neighbours are in nearby tiles.
+#CPPFLAGS += -DTWOPATH_TILED
+
+## Count calls and cycles of each change statistic and of the graph
+## updates, reported at the end of EstimNetDirected (see
+## changeStatsProfile.h). Slows the sampler, so off by default.
+## The statistics computed together by the fused kernels are timed
+## together unless they are disabled with -DNO_FUSED_CHANGESTATS.
+#CPPFLAGS += -DPROFILE_CHANGESTATS
+#CPPFLAGS += -DNO_FUSED_CHANGESTATS
+
+# Using the uthash hash table (only if TWOPATH_UTHASH defined, otherwise
+# the two-path hash tables are open addressing hash tables in digraph.c)
 # See https://troydhanson.github.io/uthash/userguide.html
 # and https://github.com/troydhanson/uthash
 # Enable the Bloom filter (max size 32 bits = 512 MB)
@@ -76,5 +96,10 @@ LDLIBS     = -lm
 # Program to build TAGS file for EMACS
 MAKETAGS   = etags
 
+# for the Python extension module (make python)
+PYTHON_CONFIG     = python3-config
+PYTHON_CPPFLAGS   = $(shell $(PYTHON_CONFIG) --includes 2>/dev/null)
+PYTHON_EXT_SUFFIX = $(shell $(PYTHON_CONFIG) --extension-suffix 2>/dev/null)
+
 MAKEDEPEND = gcc -MM -x c++ $(CPPFLAGS)
 
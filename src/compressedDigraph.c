@@ -0,0 +1,277 @@
+/*****************************************************************************
+ *
+ * File:    compressedDigraph.c
+ * Author:  Alex Stivala
+ * Created: October 2026
+ *
+ * Compressed read-only snapshot of the adjacency of a digraph (see
+ * compressedDigraph.h).
+ *
+ ****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "compressedDigraph.h"
+
+#define VARINT_MAX_BYTES 5 /* bytes to encode any 32 bit gap */
+
+/*****************************************************************************
+ *
+ * local functions
+ *
+ ****************************************************************************/
+
+/*
+ * Comparison function for qsort() of node numbers into ascending order.
+ *
+ * Parameters:
+ *   a, b - pointers to uint_t node numbers to compare
+ *
+ * Return value:
+ *   <0, 0, >0 if a is less than, equal to, or greater than b
+ */
+static int compare_uint(const void *a, const void *b)
+{
+  uint_t u = *(const uint_t *)a, v = *(const uint_t *)b;
+  return (u > v) - (u < v);
+}
+
+/*
+ * Make sure the scratch list of cd can hold len neighbours.
+ *
+ * Parameters:
+ *   cd  - compressed digraph (scratch updated)
+ *   len - number of neighbours needed
+ *
+ * Return value:
+ *   None.
+ */
+static void reserve_scratch(cdigraph_t *cd, size_t len)
+{
+  if (len > cd->scratch_capacity) {
+    cd->scratch_capacity = MAX(len, 2 * cd->scratch_capacity);
+    cd->scratch = (uint_t *)safe_realloc(cd->scratch, cd->scratch_capacity *
+                                         sizeof(uint_t));
+  }
+}
+
+/*
+ * Sort a list of neighbours and append it, without duplicates, to the
+ * compressed lists as the list of the next node.
+ *
+ * Parameters:
+ *   a   - compressed neighbour lists (updated)
+ *   i   - node whose list it is; offset[i] is already set
+ *   v   - neighbours (sorted in place)
+ *   len - number of neighbours in v
+ *
+ * Return value:
+ *   None. offset[i+1] and degree[i] are set.
+ */
+static void append_list(cadj_t *a, uint_t i, uint_t *v, uint_t len)
+{
+  size_t  pos = a->offset[i];
+  uint_t  k, gap, prev = (uint_t)-1, count = 0;
+
+  if (pos + (size_t)len * VARINT_MAX_BYTES > a->capacity) {
+    a->capacity = MAX(pos + (size_t)len * VARINT_MAX_BYTES, 2 * a->capacity);
+    a->bytes = (uint8_t *)safe_realloc(a->bytes, a->capacity);
+  }
+  qsort(v, len, sizeof(uint_t), compare_uint);
+  for (k = 0; k < len; k++) {
+    if (k > 0 && v[k] == v[k - 1])
+      continue;
+    gap = v[k] - prev - 1;
+    while (gap >= 0x80) {
+      a->bytes[pos++] = (uint8_t)(gap | 0x80);
+      gap >>= 7;
+    }
+    a->bytes[pos++] = (uint8_t)gap;
+    prev = v[k];
+    count++;
+  }
+  a->degree[i] = count;
+  a->offset[i + 1] = pos;
+}
+
+/*
+ * Allocate the per-node arrays of compressed lists if not already.
+ *
+ * Parameters:
+ *   a         - compressed neighbour lists (updated)
+ *   num_nodes - number of nodes
+ *
+ * Return value:
+ *   None.
+ */
+static void allocate_cadj(cadj_t *a, uint_t num_nodes)
+{
+  if (!a->offset) {
+    a->degree = (uint_t *)safe_calloc((size_t)MAX(num_nodes, 1),
+                                      sizeof(uint_t));
+    a->offset = (size_t *)safe_calloc((size_t)num_nodes + 1, sizeof(size_t));
+  }
+}
+
+/*
+ * Free a set of compressed lists.
+ *
+ * Parameters:
+ *   a - compressed neighbour lists
+ *
+ * Return value:
+ *   None.
+ */
+static void free_cadj(cadj_t *a)
+{
+  free(a->degree);
+  free(a->offset);
+  free(a->bytes);
+  memset(a, 0, sizeof(cadj_t));
+}
+
+/*****************************************************************************
+ *
+ * externally visible functions
+ *
+ ****************************************************************************/
+
+/*
+ * Build (or rebuild) the compressed adjacency of a digraph. A
+ * cdigraph_t initialized to all zero is empty; on rebuilding, its
+ * memory is reused, so the digraph must have the same number of nodes.
+ *
+ * Parameters:
+ *   cd    - compressed digraph (built here)
+ *   g     - digraph
+ *   lists - CDIGRAPH_OUT, CDIGRAPH_IN and/or CDIGRAPH_NBR for the
+ *           lists to build
+ *
+ * Return value:
+ *   None.
+ */
+void build_cdigraph(cdigraph_t *cd, const digraph_t *g, uint_t lists)
+{
+  uint_t i, k;
+
+  assert(!cd->lists || cd->num_nodes == g->num_nodes);
+  cd->num_nodes = g->num_nodes;
+  cd->num_arcs = g->num_arcs;
+  cd->lists = lists;
+  if (lists & CDIGRAPH_OUT)
+    allocate_cadj(&cd->out, g->num_nodes);
+  if (lists & CDIGRAPH_IN)
+    allocate_cadj(&cd->in, g->num_nodes);
+  if (lists & CDIGRAPH_NBR)
+    allocate_cadj(&cd->nbr, g->num_nodes);
+  for (i = 0; i < g->num_nodes; i++) {
+    reserve_scratch(cd, (size_t)g->outdegree[i] + g->indegree[i]);
+    /* copied element by element as nodeid_t may be narrower than uint_t */
+    if (lists & CDIGRAPH_OUT) {
+      for (k = 0; k < g->outdegree[i]; k++)
+        cd->scratch[k] = g->arclist[i][k];
+      append_list(&cd->out, i, cd->scratch, g->outdegree[i]);
+    }
+    if (lists & CDIGRAPH_IN) {
+      for (k = 0; k < g->indegree[i]; k++)
+        cd->scratch[k] = g->revarclist[i][k];
+      append_list(&cd->in, i, cd->scratch, g->indegree[i]);
+    }
+    if (lists & CDIGRAPH_NBR) {
+      /* reciprocated arcs put the neighbour in both, once in the list */
+      for (k = 0; k < g->outdegree[i]; k++)
+        cd->scratch[k] = g->arclist[i][k];
+      for (k = 0; k < g->indegree[i]; k++)
+        cd->scratch[g->outdegree[i] + k] = g->revarclist[i][k];
+      append_list(&cd->nbr, i, cd->scratch,
+                  g->outdegree[i] + g->indegree[i]);
+    }
+  }
+}
+
+/*
+ * Free the memory of a compressed digraph, leaving it empty.
+ *
+ * Parameters:
+ *   cd - compressed digraph
+ *
+ * Return value:
+ *   None.
+ */
+void free_cdigraph(cdigraph_t *cd)
+{
+  free_cadj(&cd->out);
+  free_cadj(&cd->in);
+  free_cadj(&cd->nbr);
+  free(cd->scratch);
+  memset(cd, 0, sizeof(cdigraph_t));
+}
+
+/*
+ * Test if arc i->j is in a compressed digraph, by scanning the
+ * out-neighbours of i (or in-neighbours of j if only those were built)
+ * up to j.
+ *
+ * Parameters:
+ *   cd - compressed digraph, with CDIGRAPH_OUT or CDIGRAPH_IN lists
+ *   i  - node arc is from
+ *   j  - node arc is to
+ *
+ * Return value:
+ *   TRUE if arc i->j is in cd else FALSE
+ */
+bool cdigraph_is_arc(const cdigraph_t *cd, uint_t i, uint_t j)
+{
+  cadj_iter_t it;
+
+  assert(cd->lists & (CDIGRAPH_OUT | CDIGRAPH_IN));
+  if (cd->lists & CDIGRAPH_OUT) {
+    CADJ_FOR_EACH(&cd->out, i, it)
+      if (it.v >= j)
+        return it.v == j;
+  } else {
+    CADJ_FOR_EACH(&cd->in, j, it)
+      if (it.v >= i)
+        return it.v == i;
+  }
+  return FALSE;
+}
+
+/*
+ * Number of nodes in both the list of node i in a and the list of node
+ * j in b, by merging the two ascending lists. E.g. with a the
+ * out-neighbours and b the in-neighbours it is the number of two-paths
+ * i -> v -> j.
+ *
+ * Parameters:
+ *   a - compressed neighbour lists
+ *   i - node whose list in a is used
+ *   b - compressed neighbour lists
+ *   j - node whose list in b is used
+ *
+ * Return value:
+ *   Number of common neighbours.
+ */
+uint_t cadj_count_common(const cadj_t *a, uint_t i, const cadj_t *b,
+                         uint_t j)
+{
+  cadj_iter_t ita, itb;
+  uint_t      count = 0;
+
+  cadj_iter_init(a, i, &ita);
+  cadj_iter_init(b, j, &itb);
+  while (!ita.done && !itb.done) {
+    if (ita.v < itb.v) {
+      cadj_iter_next(&ita);
+    } else if (itb.v < ita.v) {
+      cadj_iter_next(&itb);
+    } else {
+      count++;
+      cadj_iter_next(&ita);
+      cadj_iter_next(&itb);
+    }
+  }
+  return count;
+}
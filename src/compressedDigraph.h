@@ -0,0 +1,110 @@
+#ifndef COMPRESSEDDIGRAPH_H
+#define COMPRESSEDDIGRAPH_H
+/*****************************************************************************
+ *
+ * File:    compressedDigraph.h
+ * Author:  Alex Stivala
+ * Created: October 2026
+ *
+ * Compressed read-only snapshot of the adjacency of a digraph, for the
+ * phases that only read the graph (such as the goodness-of-fit
+ * statistics of simulated networks) rather than keeping a second copy
+ * of the neighbour lists as 32 bit node numbers. It is a compressed
+ * sparse row structure: the neighbours of each node are in ascending
+ * order and stored as the gaps between them, each gap a variable length
+ * integer of 7 bits per byte (the high bit set on all but the last
+ * byte). In a sparse network with good locality (such as after the
+ * node reordering of reorder_digraph_nodes()) most gaps take one or two
+ * bytes, so the lists take a half to a quarter of the memory.
+ *
+ * Any of the out-neighbour, in-neighbour and (ignoring arc direction)
+ * neighbour lists can be built. They are iterated in ascending order
+ * with CADJ_FOR_EACH() (in place of the arclist[i][k], k < outdegree[i]
+ * loops over a digraph_t), and the ascending order allows neighbour
+ * lists to be merged and intersected in linear time.
+ *
+ * The snapshot is not updated when the digraph changes, but can be
+ * rebuilt from it with build_cdigraph(), reusing its memory.
+ *
+ ****************************************************************************/
+
+#include <stdint.h>
+#include "utils.h"
+#include "digraph.h"
+
+/* lists to build in build_cdigraph() */
+#define CDIGRAPH_OUT 0x01 /* out-neighbours */
+#define CDIGRAPH_IN  0x02 /* in-neighbours */
+#define CDIGRAPH_NBR 0x04 /* neighbours ignoring direction (no duplicates) */
+
+typedef struct cadj_s {    /* compressed ascending neighbour lists */
+  uint_t   *degree;        /* number of neighbours of each node */
+  size_t   *offset;        /* list of node i is bytes[offset[i]] to
+                              bytes[offset[i+1]-1] */
+  uint8_t  *bytes;         /* gaps between neighbours as varints */
+  size_t    capacity;      /* allocated length of bytes */
+} cadj_t;
+
+typedef struct cdigraph_s {
+  uint_t    num_nodes;     /* number of nodes */
+  arcidx_t  num_arcs;      /* number of arcs */
+  uint_t    lists;         /* CDIGRAPH_OUT etc. of the lists built */
+  cadj_t    out;           /* out-neighbours (if CDIGRAPH_OUT) */
+  cadj_t    in;            /* in-neighbours (if CDIGRAPH_IN) */
+  cadj_t    nbr;           /* neighbours either way (if CDIGRAPH_NBR) */
+  uint_t   *scratch;       /* neighbours of one node while building */
+  size_t    scratch_capacity; /* allocated length of scratch */
+} cdigraph_t;
+
+typedef struct cadj_iter_s { /* position in a compressed neighbour list */
+  const uint8_t *p;        /* next gap */
+  uint_t         left;     /* neighbours after the current one */
+  uint_t         v;        /* current neighbour (valid if !done) */
+  bool           done;     /* past the end of the list */
+} cadj_iter_t;
+
+/*
+ * Move a neighbour list iterator to the next neighbour, or set done if
+ * there are no more.
+ */
+static inline void cadj_iter_next(cadj_iter_t *it)
+{
+  uint_t  gap = 0, shift = 0;
+  uint8_t b;
+
+  if (it->left == 0) {
+    it->done = TRUE;
+    return;
+  }
+  do {
+    b = *it->p++;
+    gap |= (uint_t)(b & 0x7f) << shift;
+    shift += 7;
+  } while (b & 0x80);
+  it->v += gap + 1;
+  it->left--;
+}
+
+/*
+ * Start an iterator at the first (smallest) neighbour of node i.
+ */
+static inline void cadj_iter_init(const cadj_t *a, uint_t i, cadj_iter_t *it)
+{
+  it->p = a->bytes + a->offset[i];
+  it->left = a->degree[i];
+  it->v = (uint_t)-1; /* the first gap is from -1 */
+  it->done = FALSE;
+  cadj_iter_next(it);
+}
+
+/* iterate it.v over the neighbours of node i in ascending order */
+#define CADJ_FOR_EACH(a, i, it) \
+  for (cadj_iter_init((a), (i), &(it)); !(it).done; cadj_iter_next(&(it)))
+
+void build_cdigraph(cdigraph_t *cd, const digraph_t *g, uint_t lists);
+void free_cdigraph(cdigraph_t *cd);
+bool cdigraph_is_arc(const cdigraph_t *cd, uint_t i, uint_t j);
+uint_t cadj_count_common(const cadj_t *a, uint_t i, const cadj_t *b,
+                         uint_t j);
+
+#endif /* COMPRESSEDDIGRAPH_H */
@@ -60,30 +60,33 @@ static const char *FALSE_STR = "false";
 
 /*
  * Structural parameters allowed as the names in the set for the 
- * structParams parameter. Names are not case sensitive 
+ * structParams parameter. Names are not case sensitive. Those with
+ * has_lambda TRUE (the alternating statistics) may be followed by
+ * a lambda (decay) value in parentheses e.g. AltKTrianglesT(3.0),
+ * otherwise lambda is DEFAULT_LAMBDA.
  */
 static const struct_param_t STRUCT_PARAMS[] =
 {
-  {ARC_PARAM_STR,       changeArc},
-  {"Reciprocity",       changeReciprocity},
-  {"Sink",              changeSink},
-  {"Source",            changeSource},
-  {"Isolates",          changeIsolates},
-  {"TwoPaths",          changeTwoPath},
-  {"InTwoStars",        changeInTwoStars},
-  {"OutTwoStars",       changeOutTwoStars},
-  {"TransitiveTriangles",changeTransitiveTriad},
-  {"CyclicTriangles",   changeCyclicTriad},
-  {"AltInStars",        changeAltInStars},
-  {"AltOutStars",       changeAltOutStars},
-  {"AltKTrianglesT",    changeAltKTrianglesT},
-  {"AltKTrianglesC",    changeAltKTrianglesC},
-  {"AltKTrianglesD",    changeAltKTrianglesD},
-  {"AltKTrianglesU",    changeAltKTrianglesU},  
-  {"AltTwoPathsT",      changeAltTwoPathsT},
-  {"AltTwoPathsD",      changeAltTwoPathsD},
-  {"AltTwoPathsU",      changeAltTwoPathsU},
-  {"AltTwoPathsTD",     changeAltTwoPathsTD}
+  {ARC_PARAM_STR,         changeArc,             FALSE},
+  {"Reciprocity",         changeReciprocity,     FALSE},
+  {"Sink",                changeSink,            FALSE},
+  {"Source",              changeSource,          FALSE},
+  {"Isolates",            changeIsolates,        FALSE},
+  {"TwoPaths",            changeTwoPath,         FALSE},
+  {"InTwoStars",          changeInTwoStars,      FALSE},
+  {"OutTwoStars",         changeOutTwoStars,     FALSE},
+  {"TransitiveTriangles", changeTransitiveTriad, FALSE},
+  {"CyclicTriangles",     changeCyclicTriad,     FALSE},
+  {"AltInStars",          changeAltInStars,      TRUE},
+  {"AltOutStars",         changeAltOutStars,     TRUE},
+  {"AltKTrianglesT",      changeAltKTrianglesT,  TRUE},
+  {"AltKTrianglesC",      changeAltKTrianglesC,  TRUE},
+  {"AltKTrianglesD",      changeAltKTrianglesD,  TRUE},
+  {"AltKTrianglesU",      changeAltKTrianglesU,  TRUE},
+  {"AltTwoPathsT",        changeAltTwoPathsT,    TRUE},
+  {"AltTwoPathsD",        changeAltTwoPathsD,    TRUE},
+  {"AltTwoPathsU",        changeAltTwoPathsU,    TRUE},
+  {"AltTwoPathsTD",       changeAltTwoPathsTD,   TRUE}
 };
 static const uint_t NUM_STRUCT_PARAMS = sizeof(STRUCT_PARAMS) /
   sizeof(STRUCT_PARAMS[0]);
@@ -122,7 +125,8 @@ static const dyadic_param_t DYADIC_PARAMS[] =
 {
   {"GeoDistance",    DYADIC_TYPE_GEODISTANCE,   changeGeoDistance},
   {"logGeoDistance", DYADIC_TYPE_GEODISTANCE,   changeLogGeoDistance},
-  {"EuclideanDistance", DYADIC_TYPE_EUCLIDEANDISTANCE, changeEuclideanDistance}
+  {"EuclideanDistance", DYADIC_TYPE_EUCLIDEANDISTANCE, changeEuclideanDistance},
+  {"DyadicCovariate", DYADIC_TYPE_COVARIATE, changeDyadicCovariate}
 };
 static const uint_t NUM_DYADIC_PARAMS = sizeof(DYADIC_PARAMS) /
   sizeof(DYADIC_PARAMS[0]);
@@ -152,8 +156,12 @@ static const uint_t NUM_ATTR_INTERACTION_PARAMS =
  * These are the set type, comma delimited names of structural parameters
  * enclosed in braces, eg.:
  * "{Arc, Reciprocity, AltInStars, AltOutStars, AltKTrianglesT}"
+ * The alternating statistics can have their lambda (decay) value
+ * in parentheses e.g. "AltKTrianglesT(3.0)", otherwise DEFAULT_LAMBDA
+ * is used.
  * The change_stats_funcs field in the CONFIG (file static) structure
- * is set to corresponding list of change statistics function pointers.
+ * is set to corresponding list of change statistics function pointers,
+ * and param_lambdas to the corresponding lambda values.
  * The STRUCT_PARAMS constant has the table of parameter names and
  * corresponding change statistic functions.
  * If requireErgmValue is TRUE then ERGM parameters require a value
@@ -172,6 +180,7 @@ static int parse_struct_params(FILE *infile, param_config_t *pconfig,
   char        *endptr; /* for strtod() */
   char        paramname[TOKSIZE];  /* parameter name buffer */
   double      value = 0;
+  double      lambda_value;
   
   if (!(token = get_token(infile, tokenbuf))) {
     fprintf(stderr, "ERROR: no tokens for structParams\n");
@@ -202,12 +211,54 @@ static int parse_struct_params(FILE *infile, param_config_t *pconfig,
       last_token_was_paramname = TRUE;
       strncpy(paramname, token, TOKSIZE);
 
-      if (requireErgmValue) {
+      /* optional lambda value in parentheses for alternating statistics.
+         As there is no lookahead, the token after the parameter name
+         (and lambda) has already been read on leaving this block */
+      lambda_value = DEFAULT_LAMBDA;
+      if (!(token = get_token(infile, tokenbuf))) {
+        fprintf(stderr, "ERROR: unexpected end of structParams after %s\n",
+                paramname);
+        return 1;
+      }
+      CONFIG_DEBUG_PRINT(("parse_struct_params token '%s'\n", token));
+      if (strlen(token) == 1 && token[0] == OPEN_PAREN_CHAR) {
+        if (!STRUCT_PARAMS[i].has_lambda) {
+          fprintf(stderr, "ERROR: structParam %s does not have a lambda "
+                  "value\n", paramname);
+          return 1;
+        }
         if (!(token = get_token(infile, tokenbuf))) {
-          fprintf(stderr, "ERROR: structParams expecting 'name = value' pairs separated by comma (%s)\n", paramname);
-          return -1;
+          fprintf(stderr, "ERROR: Did not find lambda value for "
+                  "structParams %s\n", paramname);
+          return 1;
         }
-        CONFIG_DEBUG_PRINT(("parse_struct_params token '%s'\n", token));        
+        lambda_value = strtod(token, &endptr);
+        if (*endptr != '\0') {
+          fprintf(stderr, "ERROR: expecting floating point lambda value for "
+                  "structParam %s but got '%s'\n", paramname, token);
+          return 1;
+        }
+        if (lambda_value <= 1) {
+          fprintf(stderr, "ERROR: lambda value for structParam %s must be "
+                  "greater than 1 but got %g\n", paramname, lambda_value);
+          return 1;
+        }
+        if (!(token = get_token(infile, tokenbuf)) ||
+            !(strlen(token) == 1 && token[0] == CLOSE_PAREN_CHAR)) {
+          fprintf(stderr, "ERROR: expecting %c after lambda value for "
+                  "structParam %s\n", CLOSE_PAREN_CHAR, paramname);
+          return 1;
+        }
+        CONFIG_DEBUG_PRINT(("structParam lambda %g\n", lambda_value));
+        if (!(token = get_token(infile, tokenbuf))) {
+          fprintf(stderr, "ERROR: unexpected end of structParams after %s\n",
+                  paramname);
+          return 1;
+        }
+        CONFIG_DEBUG_PRINT(("parse_struct_params token '%s'\n", token));
+      }
+
+      if (requireErgmValue) {
         if (strcmp(token, "=") != 0) {
           fprintf(stderr, "ERROR: structParams expecting 'name = value' pairs separated by comma (%s)\n", paramname);
           return 1;
@@ -224,6 +275,11 @@ static int parse_struct_params(FILE *infile, param_config_t *pconfig,
           return 1;
         }
         CONFIG_DEBUG_PRINT(("structParam value %g\n", value));
+        if (!(token = get_token(infile, tokenbuf))) {
+          fprintf(stderr, "ERROR: unexpected end of structParams after %s\n",
+                  paramname);
+          return 1;
+        }
       }
       
       pconfig->param_names = (const char **)safe_realloc(pconfig->param_names,
@@ -237,12 +293,16 @@ static int parse_struct_params(FILE *infile, param_config_t *pconfig,
         STRUCT_PARAMS[i].name;
       pconfig->change_stats_funcs[pconfig->num_change_stats_funcs] =
         STRUCT_PARAMS[i].change_stats_func;
+      pconfig->param_lambdas = (double *)safe_realloc(pconfig->param_lambdas,
+                         (pconfig->num_change_stats_funcs + 1) * sizeof(double));
+      pconfig->param_lambdas[pconfig->num_change_stats_funcs] = lambda_value;
       if (requireErgmValue) {
         pconfig->param_values = (double *)safe_realloc(pconfig->param_values,
                          (pconfig->num_change_stats_funcs + 1) * sizeof(double));
         pconfig->param_values[pconfig->num_change_stats_funcs] = value;
       }
       pconfig->num_change_stats_funcs++;
+      continue; /* already have the next token */
     }
     token = get_token(infile, tokenbuf);
   }
@@ -546,11 +606,8 @@ static int parse_one_dyadic_param(const char *paramName,
 
     /* Because is has multiple attribute names, we get multiple entries for the
        change statistic - so put the a copy of the value for each one.
-       This will be fixed up later in build_dyadic_indices_from_names(). */
-    /* TODO this system of ad hoc handling of dyadic parameters was
-       alright when there was only one (or now two) types but it will
-       be a real mess for any more, should make it more general (and
-       hopefully simpler) */
+       This will be fixed up later in build_dyadic_indices_from_names()
+       (for DyadicCovariate each one is a separate statistic). */
     for (i = old_num_dyadic; i < pconfig->num_dyadic_change_stats_funcs; i++) {
       pconfig->dyadic_param_values =
         (double *)safe_realloc(pconfig->dyadic_param_values,
@@ -1009,7 +1066,9 @@ void dump_parameter_names(void)
             DYADIC_PARAMS[i].type == DYADIC_TYPE_GEODISTANCE ?
             "latitude,longitude" :
             (DYADIC_PARAMS[i].type == DYADIC_TYPE_EUCLIDEANDISTANCE ?
-             "x, y, z" : "*UNKNOWN*"));
+             "x, y, z" :
+             (DYADIC_PARAMS[i].type == DYADIC_TYPE_COVARIATE ?
+              "dyadic covariate" : "*UNKNOWN*")));
   }
   fprintf(stderr, "Attribute interaction parameters (%s)\n",
           ATTR_INTERACTION_PARAMS_STR);
@@ -1156,24 +1215,32 @@ int build_attr_indices_from_names(param_config_t *pconfig, const digraph_t *g)
 int build_dyadic_indices_from_names(param_config_t *pconfig,  digraph_t *g,
                                     bool requireErgmValue)
 {
-  uint_t i, j;
+  uint_t i, j, k;
   bool   found;
   dyadic_type_e dyadicType;
   uint_t numGeoAttr     = 0; /* number of GeoDistance or LogGeodistance attrs */
   uint_t numEuclideanAttr = 0; /* number of EuclideanDistance attrs */
-  uint_t numAttrs; /* total number of dyadic attributes */
+  uint_t numAttrs = pconfig->num_dyadic_change_stats_funcs; /* total number
+                                                  of dyadic attributes */
   uint_t geoIndex              = 0;
   uint_t euclideanIndex        = 0;
-  int    firstGeoIndex         = -1; /* -1 until set to first index */
-  int    firstEuclideanIndex   = -1;
-  char  *tmpGeoName, *tmpEuclideanName, *tmpGeoParamName, *tmpEuclideanParamName;
-  dyadic_change_stats_func_t *tmpGeoFunc, *tmpEuclideanFunc;
-  double tmpGeoValue, tmpEuclideanValue;
+  uint_t numKept               = 0; /* number of entries kept */
+  uint_t *kept; /* index of each entry kept, in their new order */
+  static const dyadic_type_e keptOrder[] = {
+    DYADIC_TYPE_GEODISTANCE, DYADIC_TYPE_EUCLIDEANDISTANCE,
+    DYADIC_TYPE_COVARIATE
+  };
+  char  **names;
+  const char **paramNames;
+  dyadic_change_stats_func_t **funcs;
+  uint_t *indices;
+  dyadic_type_e *types;
+  double *values = NULL;
   
   pconfig->dyadic_indices = safe_malloc(pconfig->num_dyadic_change_stats_funcs *
                                      sizeof(uint_t));
   pconfig->dyadic_types = safe_malloc(pconfig->num_dyadic_change_stats_funcs *
-                                     sizeof(uint_t));  
+                                     sizeof(dyadic_type_e));
   
   for (i = 0; i < pconfig->num_dyadic_change_stats_funcs; i++) {
     found = FALSE;
@@ -1213,6 +1280,27 @@ int build_dyadic_indices_from_names(param_config_t *pconfig,  digraph_t *g,
         }
         break;
 
+      case DYADIC_TYPE_COVARIATE:
+
+        for (j = 0; j < g->num_dyadcov; j++) {
+          if (strcasecmp(pconfig->dyadic_names[i], g->dyadcov_names[j]) == 0) {
+            found = TRUE;
+            pconfig->dyadic_indices[i] = j;
+            pconfig->dyadic_types[i] = dyadicType;
+            CONFIG_DEBUG_PRINT(("dyadic covariate type COVARIATE "
+                                "%s(%s) index %u\n",
+                                pconfig->dyadic_param_names[i],
+                                pconfig->dyadic_names[i], j));
+          }
+        }
+
+        if (!found) {
+          fprintf(stderr, "ERROR: dyadic covariate %s not found (in "
+                  "dyadicCovariateFile)\n", pconfig->dyadic_names[i]);
+          return 1;
+        }
+        break;
+
       default:
         fprintf(stderr, "ERROR (internal): unknown dyadic covariate type %u\n",
                 get_dyadic_param_type(pconfig->dyadic_param_names[i]));
@@ -1220,14 +1308,14 @@ int build_dyadic_indices_from_names(param_config_t *pconfig,  digraph_t *g,
         break;
     }
   }
-  numAttrs = i;
   
   if (numAttrs > 0) {
-    /* only two defined so far, GeoDistance, which requires exactly 2
-       continuous attributes, for latitude and longitude respectively
-       (logGeoDistance is just the same, but funciton does log of distance)
-       and EuclideanDistance, which requires exactly 3 continuous attribute,
-       for x, y, and z coordinates respectively.
+    /* GeoDistance (logGeoDistance is just the same, but function does
+       log of distance) requires exactly 2 continuous attributes, for
+       latitude and longitude respectively, and EuclideanDistance
+       requires exactly 3 continuous attributes, for x, y, and z
+       coordinates respectively. DyadicCovariate has one covariate
+       from the dyadic covariates file.
     */
     if (numGeoAttr > 0 && numGeoAttr != 2) {
       fprintf(stderr,
@@ -1256,9 +1344,6 @@ int build_dyadic_indices_from_names(param_config_t *pconfig,  digraph_t *g,
               return 1;
               break;
           }
-          if (firstGeoIndex < 0) {
-            firstGeoIndex = j;
-          }
           geoIndex++;
           break;
           
@@ -1279,11 +1364,11 @@ int build_dyadic_indices_from_names(param_config_t *pconfig,  digraph_t *g,
               return 1;
               break;
           }
-          if (firstEuclideanIndex < 0) {
-            firstEuclideanIndex = j;
-          }
           euclideanIndex++;
           break;
+
+        case DYADIC_TYPE_COVARIATE:
+          break;
           
         default:
           fprintf(stderr, "ERROR (internal): unknown dyadic type %d\n",
@@ -1292,83 +1377,73 @@ int build_dyadic_indices_from_names(param_config_t *pconfig,  digraph_t *g,
           break;
       }
     }
-    /* Because is has two attribute names, we get two entries for the
-       change statistic. But for [log]GeoDistance we only want one (it uses
-       two attributes at each node), so delete the second. 
-       Similarly for EuclideanDistance (But with 3 attribute names and hence
-       dyadic change statistic entries).
+    /* Because [log]GeoDistance has two attribute names, we get two
+       entries for the change statistic. But we only want one (it uses
+       two attributes at each node), so keep only the first. Similarly
+       for EuclideanDistance (but with 3 attribute names and hence
+       dyadic change statistic entries). These come first, GeoDistance
+       then EuclideanDistance, followed by the DyadicCovariate entries
+       (one for each covariate) in the order given.
     */
-    /* TODO this system of ad hoc handling of dyadic parameters was
-       alright when there was only one (or now two) types but it will
-       be a real mess for any more, should make it more general (and
-       hopefully simpler) */
-    
-    if (numGeoAttr > 0 && numEuclideanAttr > 0) {
-      /* [log]GeoDistance and EuclideanDistance */
-      assert(firstGeoIndex >= 0);
-      assert(firstEuclideanIndex >= 0);
-      assert(firstGeoIndex != firstEuclideanIndex);
-      assert(get_dyadic_param_type(pconfig->dyadic_param_names[firstGeoIndex]) == DYADIC_TYPE_GEODISTANCE);
-      assert(get_dyadic_param_type(pconfig->dyadic_param_names[firstEuclideanIndex]) == DYADIC_TYPE_EUCLIDEANDISTANCE);
-      assert(pconfig->num_dyadic_change_stats_funcs == 5);
-      tmpGeoName = safe_strdup(pconfig->dyadic_names[firstGeoIndex]);
-      tmpGeoParamName = safe_strdup(pconfig->dyadic_param_names[firstGeoIndex]);
-      tmpGeoFunc = pconfig->dyadic_change_stats_funcs[firstGeoIndex];
-      tmpEuclideanName = safe_strdup(pconfig->dyadic_names[firstEuclideanIndex]);
-      tmpEuclideanParamName = safe_strdup(pconfig->dyadic_param_names[firstEuclideanIndex]);
-      tmpEuclideanFunc = pconfig->dyadic_change_stats_funcs[firstEuclideanIndex];
-      if (requireErgmValue) {
-        tmpGeoValue = pconfig->dyadic_param_values[firstGeoIndex];
-        tmpEuclideanValue = pconfig->dyadic_param_values[firstEuclideanIndex];
-      }
-      pconfig->dyadic_names[0] = tmpGeoName;
-      pconfig->dyadic_param_names[0] = tmpGeoParamName;
-      pconfig->dyadic_change_stats_funcs[0] = tmpGeoFunc;
-      pconfig->dyadic_types[0] = DYADIC_TYPE_GEODISTANCE;
-      pconfig->dyadic_names[1] = tmpEuclideanName;
-      pconfig->dyadic_param_names[1] = tmpEuclideanParamName;
-      pconfig->dyadic_change_stats_funcs[1] = tmpEuclideanFunc;
-      pconfig->dyadic_types[1] = DYADIC_TYPE_EUCLIDEANDISTANCE;
-      pconfig->num_dyadic_change_stats_funcs = 2;      
-      free(pconfig->dyadic_names[2]);
-      free(pconfig->dyadic_names[3]);
-      free(pconfig->dyadic_names[4]);
-      if (requireErgmValue) {
-        pconfig->dyadic_param_values[0] = tmpGeoValue;
-        pconfig->dyadic_param_values[1] = tmpEuclideanValue;
+    kept = (uint_t *)safe_malloc(numAttrs * sizeof(uint_t));
+    for (k = 0; k < sizeof(keptOrder) / sizeof(keptOrder[0]); k++) {
+      found = FALSE;
+      for (j = 0; j < numAttrs; j++) {
+        if (pconfig->dyadic_types[j] != keptOrder[k])
+          continue;
+        if (keptOrder[k] == DYADIC_TYPE_COVARIATE || !found)
+          kept[numKept++] = j;
+        else
+          free(pconfig->dyadic_names[j]);
+        found = TRUE;
       }
-    } else if (numGeoAttr > 0) {
-      /* only [log]GeoDistance */
-      assert(firstGeoIndex >= 0);
-      assert(pconfig->num_dyadic_change_stats_funcs == 2);
-      assert(get_dyadic_param_type(pconfig->dyadic_param_names[0])
-             == DYADIC_TYPE_GEODISTANCE &&
-             get_dyadic_param_type(pconfig->dyadic_param_names[1])
-             == DYADIC_TYPE_GEODISTANCE);
-      pconfig->num_dyadic_change_stats_funcs = 1;
-      free(pconfig->dyadic_names[1]);
-    } else if (numEuclideanAttr > 0) {
-      /* only EuclideanDistance */
-      assert(firstEuclideanIndex >= 0);
-      assert(pconfig->num_dyadic_change_stats_funcs == 3);
-      assert(get_dyadic_param_type(pconfig->dyadic_param_names[0])
-             == DYADIC_TYPE_EUCLIDEANDISTANCE &&
-             get_dyadic_param_type(pconfig->dyadic_param_names[1])
-             == DYADIC_TYPE_EUCLIDEANDISTANCE &&
-             get_dyadic_param_type(pconfig->dyadic_param_names[2])
-             == DYADIC_TYPE_EUCLIDEANDISTANCE);
-      pconfig->num_dyadic_change_stats_funcs = 1;
-      free(pconfig->dyadic_names[1]);
-      free(pconfig->dyadic_names[2]);
-    } else {
-      assert(FALSE);
     }
-    
+    names = (char **)safe_malloc(numKept * sizeof(char *));
+    paramNames = (const char **)safe_malloc(numKept * sizeof(const char *));
+    funcs = (dyadic_change_stats_func_t **)
+      safe_malloc(numKept * sizeof(dyadic_change_stats_func_t *));
+    indices = (uint_t *)safe_malloc(numKept * sizeof(uint_t));
+    types = (dyadic_type_e *)safe_malloc(numKept * sizeof(dyadic_type_e));
+    if (requireErgmValue)
+      values = (double *)safe_malloc(numKept * sizeof(double));
+    for (k = 0; k < numKept; k++) {
+      names[k] = pconfig->dyadic_names[kept[k]];
+      paramNames[k] = pconfig->dyadic_param_names[kept[k]];
+      funcs[k] = pconfig->dyadic_change_stats_funcs[kept[k]];
+      indices[k] = pconfig->dyadic_indices[kept[k]];
+      types[k] = pconfig->dyadic_types[kept[k]];
+      if (requireErgmValue)
+        values[k] = pconfig->dyadic_param_values[kept[k]];
+    }
+    free(kept);
+    free(pconfig->dyadic_names);
+    free(pconfig->dyadic_param_names);
+    free(pconfig->dyadic_change_stats_funcs);
+    free(pconfig->dyadic_indices);
+    free(pconfig->dyadic_types);
+    pconfig->dyadic_names = names;
+    pconfig->dyadic_param_names = paramNames;
+    pconfig->dyadic_change_stats_funcs = funcs;
+    pconfig->dyadic_indices = indices;
+    pconfig->dyadic_types = types;
+    if (requireErgmValue) {
+      free(pconfig->dyadic_param_values);
+      pconfig->dyadic_param_values = values;
+    }
+    pconfig->num_dyadic_change_stats_funcs = numKept;
+
+    /* the covariate of each DyadicCovariate statistic, for
+       changeDyadicCovariate() */
+    free(g->dyadcov_index);
+    g->dyadcov_index = (uint_t *)safe_calloc(numKept, sizeof(uint_t));
+    for (k = 0; k < numKept; k++)
+      if (types[k] == DYADIC_TYPE_COVARIATE)
+        g->dyadcov_index[k] = indices[k];
+    build_dyadic_coords(g, numGeoAttr > 0, numEuclideanAttr > 0);
   }
   return 0;
 }
 
-
 /*
  * build_attr_interaction_pair_indices_from_names() is called after the
  * config file is parsed by parse_config_file() and also after the
@@ -1456,6 +1531,45 @@ int build_attr_interaction_pair_indices_from_names(param_config_t *pconfig,
   return 0;
 }
 
+/*
+ * Get the names of the node attributes the parameters of a model refer
+ * to (attribute, dyadic and attribute interaction parameters), e.g.
+ * to load only those columns of the attribute files (see
+ * set_attribute_columns()). Names may be repeated.
+ *
+ * Parameters:
+ *     pconfig - param config struct of the parsed model
+ *     names   - (out) the names, pointing into pconfig, allocated by
+ *               this function (even if there are none) to be freed by
+ *               the caller
+ *
+ * Return value:
+ *     Number of names.
+ */
+uint_t get_model_attribute_names(const param_config_t *pconfig,
+                                 const char ***names)
+{
+  uint_t i, n = 0;
+
+  *names = (const char **)safe_malloc(
+    MAX(pconfig->num_attr_change_stats_funcs +
+        pconfig->num_dyadic_change_stats_funcs +
+        2 * pconfig->num_attr_interaction_change_stats_funcs, 1) *
+    sizeof(const char *));
+  for (i = 0; i < pconfig->num_attr_change_stats_funcs; i++)
+    (*names)[n++] = pconfig->attr_names[i];
+  /* the continuous attributes of [log]GeoDistance and EuclideanDistance,
+     and the (dyadic covariate) names of DyadicCovariate */
+  for (i = 0; i < pconfig->num_dyadic_change_stats_funcs; i++)
+    (*names)[n++] = pconfig->dyadic_names[i];
+  for (i = 0; i < pconfig->num_attr_interaction_change_stats_funcs; i++) {
+    if (pconfig->attr_interaction_pair_names[i].first)
+      (*names)[n++] = pconfig->attr_interaction_pair_names[i].first;
+    if (pconfig->attr_interaction_pair_names[i].second)
+      (*names)[n++] = pconfig->attr_interaction_pair_names[i].second;
+  }
+  return n;
+}
 
 /*
  * Free the param config structure
@@ -1473,6 +1587,7 @@ void free_param_config_struct(param_config_t *pconfig)
   free(pconfig->change_stats_funcs);
   free(pconfig->param_names);
   free(pconfig->param_values);
+  free(pconfig->param_lambdas);
   free(pconfig->attr_param_names);
   for (i = 0; i < pconfig->num_attr_change_stats_funcs; i++) 
     free(pconfig->attr_names[i]);
@@ -33,6 +33,7 @@
 
 
 #define DEFAULT_IFD_K                 0.1     /* default value of ifd_K  */
+#define DEFAULT_MTM_TRIES             8       /* default value of mtmTries */
 
 
 /*****************************************************************************
@@ -74,7 +75,8 @@ typedef enum attr_type_e {
 typedef enum dyadic_type_e {
   DYADIC_TYPE_INVALID,       /* invalid type, used as error return value */
   DYADIC_TYPE_GEODISTANCE,   /* continuous geographic distance from lat/long */
-  DYADIC_TYPE_EUCLIDEANDISTANCE /* continuous Euclidean distance from x/y/z */
+  DYADIC_TYPE_EUCLIDEANDISTANCE, /* continuous Euclidean distance from x/y/z */
+  DYADIC_TYPE_COVARIATE      /* covariate from the dyadic covariates file */
 } dyadic_type_e;
 
 
@@ -91,6 +93,7 @@ typedef struct config_param_s {
 typedef struct struct_param_s {
   const char          *name;                 /* structural parameter name */
   change_stats_func_t *change_stats_func;    /* corresponding change stat */
+  bool                 has_lambda;           /* TRUE if takes lambda value */
 } struct_param_t;
 
 /* ERGM attribute parameter */
@@ -124,6 +127,7 @@ typedef struct param_config_s {
   change_stats_func_t **change_stats_funcs; /* structural parameter stats */
   const char          **param_names;        /* names corresponding to above */
   double               *param_values;       /* initial values corr. to above */
+  double               *param_lambdas;      /* lambda values corr. to above */
   uint_t num_attr_change_stats_funcs;  /* length of attr_change_stats_funcs */
   attr_change_stats_func_t **attr_change_stats_funcs; /* attr param stats */
   char                     **attr_names; /* names of attributes for above */
@@ -171,6 +175,8 @@ int build_dyadic_indices_from_names(param_config_t *pconfig, digraph_t *g,
                                     bool requireErgmValues);
 int build_attr_interaction_pair_indices_from_names(param_config_t *pconfig,
                                                    const digraph_t *g);
+uint_t get_model_attribute_names(const param_config_t *pconfig,
+                                 const char ***names);
 
 void free_param_config_struct(param_config_t *pconfig);
 
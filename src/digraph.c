@@ -13,7 +13,12 @@
  *
  *    TWOPATH_LOOKUP      - use two-path lookup tables (arrays by default)
  *    TWOPATH_HASHTABLES  - use hash tables (only if TWOPATH_LOOKUP defined)
- *    ORDERED_ARCLIST     - keep arclists sorted (not completely implemented)
+ *    TWOPATH_UTHASH      - use uthash rather than open addressing hash
+ *                          tables (only if TWOPATH_HASHTABLES defined)
+ *    ORDERED_ARCLIST     - keep arclists sorted so that two-path counts
+ *                          and isArc() can use sorted list intersection
+ *                          and binary search
+ *    CONTATTR_FLOAT      - store continuous attributes as float not double
  *
  *
  ****************************************************************************/
@@ -26,10 +31,159 @@
 #include <string.h>
 #include <errno.h>
 #include <math.h>
+#include <limits.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
 #include "digraph.h"
+#include "changeStatsProfile.h"
+#include "largeAlloc.h"
 
 
    
+/*****************************************************************************
+ *
+ * local types
+ *
+ ****************************************************************************/
+
+typedef struct node_degree_s /* node and its degree, for sorting by degree */
+{
+  uint_t node;
+  uint_t degree;
+} node_degree_t;
+
+typedef enum twopath_kind_e /* which two-path table (or cache) */
+{
+  TWOPATH_MIX,
+  TWOPATH_IN,
+  TWOPATH_OUT,
+  NUM_TWOPATH_KINDS
+} twopath_kind_e;
+
+#if defined(TWOPATH_LOOKUP) || defined(TWOPATH_ADAPTIVE)
+typedef struct twopath_build_thread_s /* for buildTwoPathTables() threads */
+{
+  digraph_t       *g;          /* digraph whose tables are being built */
+  bool             useArrays;  /* tables are arrays, not hash tables */
+  bool             perNode;    /* tables are per-node tables (of each
+                                  row), with rows of in- and out-two-paths
+                                  in full rather than only b > a */
+  uint_t           first_row;  /* first node (row of tables) to count */
+  uint_t           step;       /* count every step-th row from first_row */
+  uint_t          *count;      /* count of two-paths to each node in row */
+  uint_t          *touched;    /* nodes with nonzero count */
+  pthread_mutex_t *mutex;      /* lock for hash tables, NULL if only one
+                                  thread */
+} twopath_build_thread_t;
+#endif /* TWOPATH_LOOKUP || TWOPATH_ADAPTIVE */
+
+#ifdef TWOPATH_WITH_ARRAYS
+typedef enum twopath_cells_e /* cells of a two-path array for neighbours v
+                                of an arc update, with w the other node */
+{
+  TWOPATH_CELLS_SYM, /* (v, w) of a symmetric (in or out) array */
+  TWOPATH_CELLS_COL, /* (v, w) of the mixed array */
+  TWOPATH_CELLS_ROW  /* (w, v) of the mixed array */
+} twopath_cells_e;
+
+/*
+ * Threads that divide the two-path array updates of an arc of a
+ * high degree node (see set_twopath_update_threads()). The threads wait
+ * at start_barrier for a job, each updates its share of the cells (the
+ * calling thread doing the first share), and they meet at done_barrier.
+ * The cells updated for one arc are all different, so only the spill
+ * hash table needs a lock.
+ */
+typedef struct twopath_update_pool_s
+{
+  uint_t             num_threads;  /* threads including the caller */
+  pid_t              pid;          /* process the threads are in */
+  pthread_t         *threads;      /* num_threads-1 worker threads */
+  pthread_barrier_t  start_barrier;/* job ready (or quit set) */
+  pthread_barrier_t  done_barrier; /* job finished by all threads */
+  pthread_mutex_t    spill_mutex;  /* lock for spill hash table */
+  bool               quit;         /* threads exit at next start_barrier */
+  /* current job: add incval to the cells of m for each node v in
+     nodes[0..len-1] other than i and j, with w the other node */
+  twopath_cell_t    *m;            /* two-path array */
+  twopath_hashtab_t *spill;        /* its spill hash table */
+  const nodeid_t    *nodes;        /* neighbours */
+  uint_t             len;          /* number of neighbours */
+  uint_t             i, j;         /* nodes of the arc */
+  uint_t             w;            /* other node of each cell */
+  uint_t             n;            /* number of nodes in digraph */
+  twopath_cells_e    cells;        /* which cells */
+  int                incval;       /* +1 or -1 */
+} twopath_update_pool_t;
+
+typedef struct twopath_update_thread_s /* argument of a pool thread */
+{
+  twopath_update_pool_t *pool;
+  uint_t                 k;        /* thread number, 1..num_threads-1 */
+} twopath_update_thread_t;
+#endif /* TWOPATH_WITH_ARRAYS */
+
+#ifdef TWOPATH_CACHE
+#define TWOPATH_CACHE_BITS 10  /* log2 of entries of each kind in cache */
+#define TWOPATH_CACHE_SIZE (1 << TWOPATH_CACHE_BITS)
+
+typedef struct twopath_cache_entry_s /* two-path count of node pair */
+{
+  uint_t   i, j;             /* node pair (i <= j for in and out) */
+  uint32_t stamp_i, stamp_j; /* version stamps of the lists counted */
+  uint32_t epoch;            /* cache epoch the entry was made in */
+  uint_t   count;            /* number of two-paths */
+} twopath_cache_entry_t;
+
+typedef struct twopath_cache_s /* direct mapped cache of two-path counts */
+{
+  uint64_t graph_id; /* twopath_cache_id of the digraph it is for */
+  uint32_t epoch;    /* entries of earlier epochs are not valid */
+  twopath_cache_entry_t entries[NUM_TWOPATH_KINDS][TWOPATH_CACHE_SIZE];
+} twopath_cache_t;
+#endif /* TWOPATH_CACHE */
+
+typedef enum attr_kind_e /* type of values in a column attributes file */
+{
+  ATTR_KIND_BINARY,      /* 0, 1 or NA */
+  ATTR_KIND_CATEGORICAL, /* integer >= 0 or NA */
+  ATTR_KIND_CONTINUOUS   /* floating point or NA */
+} attr_kind_e;
+
+typedef struct attr_chunk_s /* lines of attributes file for one thread */
+{
+  const char        *start;         /* first line of chunk */
+  const char        *end;           /* end of chunk (after a newline, or
+                                       end of file) */
+  uint_t             first_row;     /* line number (from 0 after the
+                                       header) of first line of chunk */
+  attr_kind_e        kind;          /* type of values */
+  uint_t             num_nodes;     /* number of nodes */
+  uint_t             num_columns;   /* number of values on each line */
+  const int         *column_attr;   /* for each column, the attribute
+                                       its values are stored as, or -1
+                                       if it is skipped */
+  char             **attr_names;    /* attribute names (for messages) */
+  const nodeidmap_t *node_ids;      /* node id map or NULL */
+  bool              *seen;          /* with node_ids, nodes with a line
+                                       read (shared by all chunks) */
+  const char        *filename;      /* attributes file (for messages) */
+  int              **ivalues;       /* binary or categorical values */
+  double           **dvalues;       /* continuous values */
+  uint_t             num_seen;      /* (out) with node_ids, number of
+                                       nodes whose line is in chunk */
+  int                status;        /* (out) 0 if OK, -1 on error */
+} attr_chunk_t;
+
+typedef struct dyadcov_entry_s /* pair in a row of the dyadic covariates */
+{
+  uint_t   j;  /* node the pair is to */
+  uint64_t k;  /* line of file (loading) or old position (renumbering)
+                  of its values */
+} dyadcov_entry_t;
+
+
 /*****************************************************************************
  *
  * local constants
@@ -39,1208 +193,7915 @@
 static const size_t BUFSIZE = 16384;  /* line buffer size for reading files */
 static const char *NA_STRING = "NA"; /* string in attributes files to indicate
                                         missing data (case insensitive) */
+static const size_t ATTR_TOKEN_MAX = 256; /* longest value in a column
+                                             attributes file */
+static const size_t ATTR_MIN_CHUNK = 1 << 16; /* fewest bytes of attributes
+                                                 file for each thread */
 static const char *SET_NONE_STRING = "NONE"; /* string in set attribute file
                                                 to indicate no elements in
                                                 set (case insensitive) */
 
-   
+static const size_t ADJ_SLAB_SIZE = 1 << 18; /* nodeid_t entries in each
+                                                adjacency list slab */
+static const uint_t ADJ_MAX_SLAB_CLASS = 14; /* blocks of capacity above
+                                                2^14 get malloc()ed */
+static const uint_t ADJ_MIN_CLASS = sizeof(nodeid_t) < 4 ? 2 : 1;
+                                             /* smallest block is 2 (or 4
+                                                16 bit) entries, big enough
+                                                for free list pointer */
+static const uint_t NODESET_EMPTY = UINT_MAX; /* empty slot in hub set */
+static const uint_t NODESET_MIN_CAPACITY = 64; /* smallest hub set */
+static const uint64_t ARCINDEX_EMPTY_KEY = UINT64_MAX; /* empty slot in arc
+                                                          position index */
+static const size_t ARCINDEX_INITIAL_CAPACITY = 1024; /* slots in new arc
+                                                         position index */
+static const uint64_t NODEIDMAP_EMPTY_KEY = UINT64_MAX; /* empty slot in
+                                                          node id map */
+static const size_t NODEIDMAP_INITIAL_CAPACITY = 1024; /* slots in new node
+                                                          id map */
+
+#ifdef TWOPATH_CACHE
+static const uint64_t TWOPATH_CACHE_MIN_WORK = 64; /* only counts that take
+                                                     at least this many
+                                                     comparisons are cached */
+#endif /* TWOPATH_CACHE */
+#ifdef TWOPATH_WITH_OATABLES
+static const size_t TWOPATH_HASHTAB_INITIAL_CAPACITY = 1024; /* slots in new
+                                                                hash table */
+#endif /* TWOPATH_WITH_OATABLES */
+#if defined(TWOPATH_LOOKUP) || defined(TWOPATH_ADAPTIVE)
+static const uint_t TWOPATH_UPDATE_PREFETCH_DISTANCE = 8; /* neighbours ahead
+                                                            to prefetch the
+                                                            two-path entries
+                                                            of when updating
+                                                            them for an arc */
+#endif /* TWOPATH_LOOKUP || TWOPATH_ADAPTIVE */
+#ifdef TWOPATH_ADAPTIVE
+static const double TWOPATH_HASHTAB_BYTES_PER_ENTRY =
+  2 * (sizeof(twopath_key_t) + sizeof(uint32_t)) / 0.7; /* worst case
+                      bytes per entry: 12 (8 with NODEID16) byte slots,
+                      load factor up to 0.7, capacity up to double after
+                      growing */
+#endif /* TWOPATH_ADAPTIVE */
+
+
+/* update entry (i,j) of two-path hash table tab in digraph g */
+#ifdef TWOPATH_WITH_UTHASH
+#define UPDATE_TWOPATH_HASHTAB(g, tab, i, j, incval) \
+  update_twopath_entry(&(g)->twopath_pool, &(g)->tab, (i), (j), (incval))
+#else
+#define UPDATE_TWOPATH_HASHTAB(g, tab, i, j, incval) \
+  update_twopath_entry(&(g)->tab, (i), (j), (incval))
+#endif /* TWOPATH_WITH_UTHASH */
+
+/* prefetch entry (i,j) of two-path hash table tab in digraph g, for a
+   later UPDATE_TWOPATH_HASHTAB() (no effect with uthash) */
+#ifdef TWOPATH_WITH_UTHASH
+#define PREFETCH_TWOPATH_HASHTAB(g, tab, i, j) ((void)(i), (void)(j))
+#else
+#define PREFETCH_TWOPATH_HASHTAB(g, tab, i, j) \
+  prefetch_twopath_entry(&(g)->tab, (i), (j))
+#endif /* TWOPATH_WITH_UTHASH */
+
+/* arc i -> j packed into 64 bit key for arc position index */
+#define ARC_KEY(i, j)  (((uint64_t)(i) << 32) | (uint64_t)(j))
+
+/* test, set and clear bit k in arc bit matrix */
+#define ARC_BIT_TEST(m, k)  (((m)[(k) >> 6] >> ((k) & 63)) & 1)
+#define ARC_BIT_SET(m, k)   ((m)[(k) >> 6] |= (uint64_t)1 << ((k) & 63))
+#define ARC_BIT_CLEAR(m, k) ((m)[(k) >> 6] &= ~((uint64_t)1 << ((k) & 63)))
+
+/* TRUE if node v is a two-path hub, whose two-paths (as the middle
+   node) are not in the two-path tables (TWOPATH_BACKEND_HYBRID) */
+#ifdef TWOPATH_ADAPTIVE
+#define TWOPATH_HUB(g, v)   ((g)->twopath_hub && (g)->twopath_hub[v])
+#else
+#define TWOPATH_HUB(g, v)   FALSE
+#endif /* TWOPATH_ADAPTIVE */
+
+/* TRUE if the two-path table (TWOPATH_TABLE_MIX etc.) is kept, as all
+   of them are unless TWOPATH_ADAPTIVE (see set_twopath_tables()) */
+#ifdef TWOPATH_ADAPTIVE
+#define TWOPATH_KEPT(g, table) (((g)->twopath_tables & (table)) != 0)
+#else
+#define TWOPATH_KEPT(g, table) TRUE
+#endif /* TWOPATH_ADAPTIVE */
+
+
+#ifdef TWOPATH_CACHE
+/*****************************************************************************
+ *
+ * File static variables
+ *
+ ****************************************************************************/
+
+/* each thread has its own cache, as threads sample from the same digraph
+   at once (e.g. Algorithm S) */
+static __thread twopath_cache_t twopath_cache;
+static uint64_t twopath_cache_next_id = 0; /* last twopath_cache_id given */
+#endif /* TWOPATH_CACHE */
+
+
 /*****************************************************************************
  *
  * local functions
  *
  ****************************************************************************/
 
-#ifdef TWOPATH_LOOKUP
-#ifdef TWOPATH_HASHTABLES
 /*
- * Update entry for (i, j) in hashtable.
- *
- * Used for the two-path hash tables to count two-paths between nodes
- * i and j. Much more efficient to use a hash table (or some other way
- * of storing a sparse matrix) as typically at most only on the order of 1% to
- * 10% of entries are nonzero, and for large networks (on the order
- * of a million nodes) this can be orders of magnitude smaller still e.g.
- * 0.01% to 0.1%. In such cases storing in dense matrix format
- * is entirely infeasible.
+ * Get a block of 2^sizeclass nodeid_t entries for an adjacency list,
+ * either from the free list for that size class, or carved from the
+ * current slab (allocating a new slab if required), or for large size
+ * classes directly from malloc().
  *
  * Parameters:
- *     h - pointer to hash table (pointer itself)
- *     i - node id of source
- *     j - node id of destination
- *     incval - value to add to existing value (or insert if not exists)
- *              NB this can be negative (it is either -1 or +1)
+ *    arena     - adjacency list arena
+ *    sizeclass - log2 of required capacity
  *
  * Return value:
- *     None.
+ *    Pointer to the block.
  */
-static void update_twopath_entry(twopath_record_t **h, uint_t i, uint_t j,
-                                 int incval)
+static nodeid_t *adjarena_alloc(adjarena_t *arena, uint_t sizeclass)
 {
-  twopath_record_t rec;
-  twopath_record_t *newrec;
-  twopath_record_t *p;
+  nodeid_t *block;
+  size_t  capacity = (size_t)1 << sizeclass;
 
-  /* there is no reason this function cannot have other values of incval
-     but in updateTwoPathsMatrices() only +1 or -1 is used */
-  assert(incval == 1 || incval == -1);
-  
-  memset(&rec, 0, sizeof(twopath_record_t));
-  rec.key.i = i;
-  rec.key.j = j;
-  HASH_FIND(hh, *h, &rec.key, sizeof(nodepair_t), p);
-  if (p) {
-    p->value += incval;
-    if (p->value == 0) {
-      assert(incval < 0); /* value added must have been -ve to get to zero */
-      /* delete entry with value 0 to save memory (get_twopath_entry() 
-         returns 0 for value if key not in hash table, so having key in table
-         with value 0 is the same as having it not present).
-         If we don't do this then the hash table will just keep growing
-         and could use far more memory than if we do this */
-      HASH_DELETE(hh, *h, p);
-      free(p);
-    }
-  } else {
-    newrec = (twopath_record_t *)safe_malloc(sizeof(*newrec));
-    newrec->key.i = i;
-    newrec->key.j = j;
-    newrec->value = incval;
-    HASH_ADD(hh, *h, key, sizeof(nodepair_t), newrec);
+  assert(sizeclass >= ADJ_MIN_CLASS && sizeclass < ADJ_NUM_SIZE_CLASSES);
+  if (sizeclass > ADJ_MAX_SLAB_CLASS)
+    return (nodeid_t *)safe_malloc(capacity * sizeof(nodeid_t));
+
+  if (arena->freelist[sizeclass]) {
+    block = (nodeid_t *)arena->freelist[sizeclass];
+    /* next pointer is stored in the free block itself */
+    memcpy(&arena->freelist[sizeclass], block, sizeof(void *));
+    return block;
   }
-} 
-#endif /* TWOPATH_HASHTABLES */
+  if (arena->num_slabs == 0 || arena->slab_used + capacity > ADJ_SLAB_SIZE) {
+    /* Note remainder of current slab (if any) is just wasted, but as
+       there are only a few size classes that fit in a slab it is small */
+    arena->slabs = (nodeid_t **)safe_realloc(arena->slabs,
+                                           (arena->num_slabs + 1) *
+                                           sizeof(nodeid_t *));
+    arena->slabs[arena->num_slabs++] =
+      (nodeid_t *)safe_malloc(ADJ_SLAB_SIZE * sizeof(nodeid_t));
+    arena->slab_used = 0;
+  }
+  block = arena->slabs[arena->num_slabs - 1] + arena->slab_used;
+  arena->slab_used += capacity;
+  return block;
+}
 
+/*
+ * Return a block allocated by adjarena_alloc() for reuse.
+ *
+ * Parameters:
+ *    arena     - adjacency list arena
+ *    block     - block to free
+ *    sizeclass - log2 of capacity of block
+ *
+ * Return value:
+ *    None.
+ */
+static void adjarena_free(adjarena_t *arena, nodeid_t *block, uint_t sizeclass)
+{
+  if (sizeclass > ADJ_MAX_SLAB_CLASS) {
+    free(block);
+    return;
+  }
+  memcpy(block, &arena->freelist[sizeclass], sizeof(void *));
+  arena->freelist[sizeclass] = block;
+}
 
-#ifdef TWOPATH_HASHTABLES
 /*
- * Update the two-paths hash tables used for fast computation of change
- * statistics for either adding or removing arc i->j
- * The hash tables in the digraph are updated in-place
+ * Ensure an adjacency list has space for (at least) one more entry,
+ * doubling its capacity (moving it to a new block) if it is full.
  *
  * Parameters:
- *   g     - digraph
- *   i     - node arc is from
- *   j     - node arc is to
- *   isAdd - TRUE for inserting arc, FALSE for deleting arc
+ *    arena    - adjacency list arena
+ *    list     - (in/out) pointer to adjacency list (arclist[i] etc.)
+ *    degree   - current number of entries in list
+ *    capacity - (in/out) current capacity of list (0 if list is NULL)
  *
  * Return value:
- *   None.
+ *    None.
  */
-static void updateTwoPathsMatrices(digraph_t *g, uint_t i, uint_t j, bool isAdd)
+static void adjlist_reserve(adjarena_t *arena, nodeid_t **list, uint_t degree,
+                            uint_t *capacity)
 {
-  uint_t v,k;
-  int incval = isAdd ? 1 : -1;
+  uint_t  sizeclass;
+  nodeid_t *newlist;
 
-  for (k = 0; k < g->outdegree[i]; k++) {
-    v = g->arclist[i][k];
-    if (v == i || v == j)
-      continue;
-    /*removed as slows significantly: assert(isArc(g,i,v)); */
-    update_twopath_entry(&g->outTwoPathHashTab, v, j, incval);
-    update_twopath_entry(&g->outTwoPathHashTab, j, v, incval);
-  }
-  for (k = 0; k < g->indegree[j]; k++) {
-    v = g->revarclist[j][k];
-    if (v == i || v == j)
-      continue;
-    /*removed as slows significantly: assert(isArc(g,v,j)); */
-    update_twopath_entry(&g->inTwoPathHashTab, v, i, incval);
-    update_twopath_entry(&g->inTwoPathHashTab, i, v, incval);
-  }
-  for (k = 0; k < g->indegree[i]; k++)  {
-    v = g->revarclist[i][k];
-    if (v == i || v == j)
-      continue;
-    /*removed as slows significantly: assert(isArc(g,v,i));*/
-    update_twopath_entry(&g->mixTwoPathHashTab, v, j, incval);
+  if (degree < *capacity)
+    return;
+  if (*capacity == 0) {
+    sizeclass = ADJ_MIN_CLASS;
+  } else {
+    for (sizeclass = 0; ((uint_t)1 << sizeclass) < *capacity; sizeclass++)
+      /*nothing*/;
+    if (sizeclass > ADJ_MAX_SLAB_CLASS) {
+      /* large lists are malloc()ed so can just realloc() them */
+      *list = (nodeid_t *)safe_realloc(*list, 2 * (size_t)*capacity *
+                                     sizeof(nodeid_t));
+      *capacity *= 2;
+      return;
+    }
+    sizeclass++;
   }
-  for (k = 0; k < g->outdegree[j]; k++) {
-    v = g->arclist[j][k];
-    if (v == i || v == j)
-      continue;
-    /*removed as slows significantly: assert(isArc(g,j,v));*/
-    update_twopath_entry(&g->mixTwoPathHashTab, i, v, incval);
+  newlist = adjarena_alloc(arena, sizeclass);
+  if (*list) {
+    memcpy(newlist, *list, degree * sizeof(nodeid_t));
+    adjarena_free(arena, *list, sizeclass - 1);
   }
+  *list = newlist;
+  *capacity = (uint_t)1 << sizeclass;
 }
-#else /* using arrays not hash tables for two-path lookup */
+
 /*
- * Update the two-paths matrices used for fast computation of change
- * statistics for either adding or removing arc i->j
- * The matcies in the digraph are updated in-place
+ * Allocate an empty adjacency list with capacity for a given number of
+ * entries, the same capacity adjlist_reserve() would have grown it to.
  *
  * Parameters:
- *   g     - digraph
- *   i     - node arc is from
- *   j     - node arc is to
- *   isAdd - TRUE for inserting arc, FALSE for deleting arc
+ *    arena    - adjacency list arena
+ *    list     - (out) pointer to adjacency list (arclist[i] etc.),
+ *               must be NULL
+ *    degree   - number of entries required (nonzero)
+ *    capacity - (out) capacity of list
  *
  * Return value:
- *   None.
+ *    None.
  */
-static void updateTwoPathsMatrices(digraph_t *g, uint_t i, uint_t j, bool isAdd)
+static void adjlist_allocate(adjarena_t *arena, nodeid_t **list, uint_t degree,
+                             uint_t *capacity)
 {
-  uint_t v,k;
-  int incval = isAdd ? 1 : -1;
+  uint_t sizeclass;
 
-  for (k = 0; k < g->outdegree[i]; k++) {
-    v = g->arclist[i][k];
-    if (v == i || v == j)
-      continue;
-    /*removed as slows significantly: assert(isArc(g,i,v)); */
-    g->outTwoPathMatrix[INDEX2D(v, j, g->num_nodes)] += incval;
-    g->outTwoPathMatrix[INDEX2D(j, v, g->num_nodes)] += incval;
-  }
-  for (k = 0; k < g->indegree[j]; k++) {
-    v = g->revarclist[j][k];
-    if (v == i || v == j)
-      continue;
-    /*removed as slows significantly: assert(isArc(g,v,j)); */
-    g->inTwoPathMatrix[INDEX2D(v, i, g->num_nodes)] += incval;
-    g->inTwoPathMatrix[INDEX2D(i, v, g->num_nodes)] += incval;
-  }
-  for (k = 0; k < g->indegree[i]; k++)  {
-    v = g->revarclist[i][k];
-    if (v == i || v == j)
-      continue;
-    /*removed as slows significantly: assert(isArc(g,v,i));*/
-    g->mixTwoPathMatrix[INDEX2D(v, j, g->num_nodes)]+=incval;
-  }
-  for (k = 0; k < g->outdegree[j]; k++) {
-    v = g->arclist[j][k];
-    if (v == i || v == j)
-      continue;
-    /*removed as slows significantly: assert(isArc(g,j,v));*/
-    g->mixTwoPathMatrix[INDEX2D(i, v, g->num_nodes)] += incval;
-  }
+  assert(*list == NULL && degree > 0);
+  for (sizeclass = ADJ_MIN_CLASS; ((uint_t)1 << sizeclass) < degree;
+       sizeclass++)
+    /*nothing*/;
+  *list = adjarena_alloc(arena, sizeclass);
+  *capacity = (uint_t)1 << sizeclass;
 }
-#endif /*TWOPATH_HASHTABLES*/
-#endif /*TWOPATH_LOOKUP */
 
-#ifdef TWOPATH_LOOKUP
-#ifdef TWOPATH_HASHTABLES
+#ifdef ORDERED_ARCLIST
 /*
- * Delete all entries and entire hash table.
+ * Find position of node v in a sorted adjacency list (binary search)
  *
  * Parameters:
- *   h - hash table to destroy
+ *    list - sorted adjacency list
+ *    len  - number of entries in list
+ *    v    - node to find
  *
  * Return value:
- *  None.
+ *    Index of first entry in list that is >= v (len if there is none)
  */
-static void deleteAllHashTable(twopath_record_t *h)
+static uint_t sorted_list_position(const nodeid_t *list, uint_t len, uint_t v)
 {
-#ifdef DO_DELETE_HASH_ENTRIES
-  twopath_record_t *curr, *tmp;
-  HASH_ITER(hh, h, curr, tmp) {
-    HASH_DEL(h, curr);
-    free(curr);
+  uint_t lo = 0, hi = len, mid;
+
+  while (lo < hi) {
+    mid = lo + (hi - lo) / 2;
+    if (list[mid] < v)
+      lo = mid + 1;
+    else
+      hi = mid;
   }
-#else
-  (void)h; /* suppress unused parameter warning */
-  /* actually deleting all the entries can take a lot of time
-     and there is really no point since this is only called on exit anyway
-     so do nothing here */
-#endif /*DO_DELETE_HASH_ENTRIES*/
+  return lo;
 }
-#endif /*TWOPATH_HASHTABLES*/
-#endif /*TWOPATH_LOOKUP*/
 
 /*
- * Load integer (binary or categorical) attributes from file.
- * The format of the file is a header line with whitespace
- * delimited attribute names, and each subsequent line
- * the attribute values for each attribute.
- * The first line (after the header) has the values for
- * node 0, then the next line node 1, and so on.
- * 
- * E.g.:
+ * Insert node v into its sorted position in an adjacency list,
+ * which must already have space for it.
  *
- * gender class
- * 0      1
- * 1      2
- * 1      3
+ * Parameters:
+ *    list - (in/out) sorted adjacency list
+ *    len  - number of entries in list (before insertion)
+ *    v    - node to insert
+ *
+ * Return value:
+ *    None
+ */
+static void sorted_list_insert(nodeid_t *list, uint_t len, uint_t v)
+{
+  uint_t k = sorted_list_position(list, len, v);
+
+  memmove(&list[k+1], &list[k], sizeof(nodeid_t) * (len - k));
+  list[k] = v;
+}
+
+/*
+ * Remove node v from a sorted adjacency list, moving all the entries
+ * after it back one so the list stays sorted.
  *
+ * Parameters:
+ *    list - (in/out) sorted adjacency list
+ *    len  - number of entries in list (before removal)
+ *    v    - node to remove, must be in list
  *
- * Valid values are integer >= 0 for categorical or 0 or 1 for binary, 
- * or NA (case insensitve) for missing data.
+ * Return value:
+ *    None
+ */
+static void sorted_list_remove(nodeid_t *list, uint_t len, uint_t v)
+{
+  uint_t k = sorted_list_position(list, len, v);
+
+  assert(k < len && list[k] == v);
+  memmove(&list[k], &list[k+1], sizeof(nodeid_t) * (len - k - 1));
+}
+
+/*
+ * Comparison function for qsort() of adjacency list into node order.
  *
  * Parameters:
- *   attr_filenname - filename of file to read
- *   num_nodes - number of nodes (must be this many values)
- *   isBinary  - TRUE if binary (only 0 or 1 allowed)
- *               also any integer is allowed
- *   out_attr_names - (Out) attribute names array
- *   out_attr_values - (Out) (*attr_values)[u][i] is value of attr u for node i
- * 
+ *   a, b - pointers to nodeid_t node numbers to compare
+ *
  * Return value:
- *   Number of attributes, or -1 on error.
+ *   <0, 0, >0 if a is less than, equal to, or greater than b
+ */
+static int compare_node(const void *a, const void *b)
+{
+  uint_t u = *(const nodeid_t *)a, v = *(const nodeid_t *)b;
+  return (u > v) - (u < v);
+}
+
+#ifndef TWOPATH_LOOKUP /* only used for counting on the fly */
+/*
+ * Count the nodes in both of two sorted adjacency lists, not counting
+ * the nodes i and j. If one list is very much shorter than the other
+ * each of its entries is found in the longer one by binary search
+ * (O(m log n)), otherwise the lists are merged (O(m + n)).
  *
- * The attribute names and values arrays are allocated by 
- * this function.
+ * Parameters:
+ *    a  - sorted adjacency list
+ *    na - number of entries in a
+ *    b  - sorted adjacency list
+ *    nb - number of entries in b
+ *    i  - node not to count
+ *    j  - node not to count
+ *
+ * Return value:
+ *    Number of nodes other than i and j in both a and b
  */
-static int load_integer_attributes(const char *attr_filename,
-                                   uint_t num_nodes,
-                                   bool isBinary,
-                                   char ***out_attr_names,
-                                   int  ***out_attr_values)
+static uint_t sorted_intersection_count(const nodeid_t *a, uint_t na,
+                                        const nodeid_t *b, uint_t nb,
+                                        uint_t i, uint_t j)
 {
-  const char *delims    = " \t\r\n"; /* strtok_r() delimiters  */
-  uint_t nodenum        = 0;   /* node number values are for */
-  uint_t num_attributes = 0;   /* number of different attributes */
-  uint_t thisline_values= 0;   /* number values read this line */
-  char  **attr_names   = NULL; /* array of attribute names */
-  int   **attr_values = NULL; /* attr_values[u][i] is value of attr u for node i */
-  char *saveptr        = NULL; /* for strtok_r() */
-  char *token          = NULL; /* from strtok_r() */
-  FILE *attr_file;
-  char buf[BUFSIZE];
-  uint_t  i;
-  int     val;
+  static const uint_t SEARCH_RATIO = 32; /* search rather than merge if
+                                            longer > ratio * shorter */
+  const nodeid_t *tmp;
+  uint_t        ntmp, ka = 0, kb = 0, lo = 0, count = 0;
 
-  if (!(attr_file = fopen(attr_filename, "r"))) {
-    fprintf(stderr, "ERROR: could not open attribute file %s (%s)\n",
-            attr_filename, strerror(errno));
-    return -1;
+  if (na > nb) {
+    tmp = a; a = b; b = tmp;
+    ntmp = na; na = nb; nb = ntmp;
   }
-  if (!fgets(buf, sizeof(buf)-1, attr_file)) {
-    fprintf(stderr, "ERROR: could not read header line in attribuutes file %s (%s)\n",
-            attr_filename, strerror(errno));
-    return -1;
+  if (na == 0)
+    return 0;
+  if (nb / na > SEARCH_RATIO) {
+    for (ka = 0; ka < na; ka++) {
+      /* entries of a are increasing so can start from last position */
+      lo += sorted_list_position(b + lo, nb - lo, a[ka]);
+      if (lo == nb)
+        break;
+      if (b[lo] == a[ka] && a[ka] != i && a[ka] != j)
+        count++;
+    }
+    return count;
   }
-  token = strtok_r(buf, delims, &saveptr);
-  while(token) {
-    attr_names = (char **)safe_realloc(attr_names, 
-                                       (num_attributes + 1) * sizeof(char *));
-    attr_names[num_attributes++] = safe_strdup(token);
-    token = strtok_r(NULL, delims, &saveptr);
+  while (ka < na && kb < nb) {
+    if (a[ka] < b[kb]) {
+      ka++;
+    } else if (a[ka] > b[kb]) {
+      kb++;
+    } else {
+      if (a[ka] != i && a[ka] != j)
+        count++;
+      ka++;
+      kb++;
+    }
   }
-  saveptr = NULL; /* reset strtok() for next line */
-
-  /* Now that we know how many attributes there are, allocate space for values */
-  attr_values = (int **)safe_malloc(num_attributes * sizeof(int *));
-  for (i = 0; i < num_attributes; i++)
-    attr_values[i] = (int *)safe_malloc(num_nodes * sizeof(int));
+  return count;
+}
+#endif /* TWOPATH_LOOKUP */
+#endif /* ORDERED_ARCLIST */
 
-  if (!fgets(buf, sizeof(buf)-1, attr_file)) {
-    fprintf(stderr, "ERROR: could not read first values line in attributes file %s (%s)\n",
-            attr_filename, strerror(errno));
-    return -1;
-  }
-  while (!feof(attr_file)) {
-    thisline_values = 0;
-    token = strtok_r(buf, delims, &saveptr);
-    while(token) {
-      if (strcasecmp(token, NA_STRING) == 0) {
-        val = isBinary ? BIN_NA : CAT_NA;
-      } else {
-        if (sscanf(token, "%u", &val) != 1) {
-          fprintf(stderr, "ERROR: bad value '%s' for node %u\n", token, nodenum);
-          return -1;
-        }
-        if (isBinary && (val != 0 && val != 1)) {
-          fprintf(stderr, "ERROR: bad value %d for binary attribute %s on node %u in attributes file %s\n",
-                  val,  thisline_values < num_attributes? attr_names[thisline_values] : "UNKNOWN", 
-                  nodenum, attr_filename);
-          return -1;
-        } else if (!isBinary && val < 0) {
-          fprintf(stderr, "ERROR: bad value %d for categorical attribute %s on node %u in attributes file %s\n",
-                  val,  thisline_values < num_attributes? attr_names[thisline_values] : "UNKNOWN", 
-                  nodenum, attr_filename);
-          return -1;
-        }
-      }
-      if (thisline_values < num_attributes && nodenum < num_nodes) 
-        attr_values[thisline_values][nodenum] = val;
-      thisline_values++;
-      token = strtok_r(NULL, delims, &saveptr);
-    }
-    if (thisline_values != num_attributes) {
-      fprintf(stderr, "ERROR: %u values for node %u but expected %u in file %s\n",
-              thisline_values, nodenum, num_attributes, attr_filename);
-      return -1;
-    }
-    if (!fgets(buf, sizeof(buf)-1, attr_file)) {
-      if (!feof(attr_file)) {
-        fprintf(stderr, "ERROR: attempting to read attributes in file %s (%s)\n",
-                attr_filename, strerror(errno));
-        return -1;
-      }
+/*
+ * Hash function for node id in hub neighbour set. This is the 32 bit
+ * finalizer from MurmurHash3.
+ *
+ * Parameters:
+ *    x - node id
+ *
+ * Return value:
+ *    hash value of x
+ */
+static uint_t nodeset_hash(uint_t x)
+{
+  x ^= x >> 16;
+  x *= 0x85ebca6bU;
+  x ^= x >> 13;
+  x *= 0xc2b2ae35U;
+  x ^= x >> 16;
+  return x;
+}
+
+/*
+ * Resize hub neighbour set to new capacity, reinserting all entries.
+ *
+ * Parameters:
+ *    set          - hub neighbour set
+ *    new_capacity - new number of slots, power of two greater than count
+ *
+ * Return value:
+ *    None.
+ */
+static void nodeset_resize(nodeset_t *set, uint_t new_capacity)
+{
+  uint_t *old_slots    = set->slots;
+  uint_t  old_capacity = set->capacity;
+  uint_t  mask         = new_capacity - 1;
+  uint_t  k, pos;
+
+  assert((new_capacity & mask) == 0 && new_capacity > set->count);
+  set->slots = (uint_t *)safe_malloc(new_capacity * sizeof(uint_t));
+  for (k = 0; k < new_capacity; k++)
+    set->slots[k] = NODESET_EMPTY;
+  set->capacity = new_capacity;
+  for (k = 0; k < old_capacity; k++) {
+    if (old_slots[k] != NODESET_EMPTY) {
+      for (pos = nodeset_hash(old_slots[k]) & mask;
+           set->slots[pos] != NODESET_EMPTY; pos = (pos + 1) & mask)
+        /*nothing*/;
+      set->slots[pos] = old_slots[k];
     }
-    nodenum++;
-    saveptr = NULL; /* reset strtok() for next line */
-  }
-  if (nodenum != num_nodes) {
-    fprintf(stderr, "ERROR: %u rows after header but expected %u in file %s\n",
-            nodenum, num_nodes, attr_filename);
-    return -1;
   }
-  fclose(attr_file);
-  *out_attr_names = attr_names;
-  *out_attr_values = attr_values;
-  return num_attributes;
+  free(old_slots);
 }
 
 /*
- * Load floating point (double) attributes from file.
- * The format of the file is a header line with whitespace
- * delimited attribute names, and each subsequent line
- * the attribute values for each attribute.
- * The first line (after the header) has the values for
- * node 0, then the next line node 1, and so on.
- * 
- * Valid values are standard C library floating point format, or
- * NA for missing data (note internally this is converted to IEEE floating
- * point NaN value, so nan entered here will also be treated as missing data).
+ * Insert node into hub neighbour set (which must have been built).
  *
  * Parameters:
- *   attr_filenname - filename of file to read
- *   num_nodes - number of nodes (must be this many values)
- *   out_attr_names - (Out) attribute names array
- *   out_attr_values - (Out) (*attr_values)[u][i] is value of attr u for node i
- * 
- * Return value:
- *   Number of attributes, or -1 on error.
+ *    set - hub neighbour set
+ *    v   - node id to insert (not already in set)
  *
- * The attribute names and values arrays are allocated by 
- * this function.
+ * Return value:
+ *    None.
  */
-static int load_float_attributes(const char *attr_filename,
-                                 uint_t num_nodes,
-                                 char ***out_attr_names,
-                                 double ***out_attr_values)
+static void nodeset_insert(nodeset_t *set, uint_t v)
 {
-  const char *delims    = " \t\r\n"; /* strtok_r() delimiters  */
-  uint_t nodenum        = 0;   /* node number values are for */
-  uint_t num_attributes = 0;   /* number of different attributes */
-  uint_t thisline_values= 0;   /* number values read this line */
-  char  **attr_names   = NULL; /* array of attribute names */
-  double **attr_values = NULL; /* attr_values[u][i] is value of attr u for node i */
-  char *saveptr        = NULL; /* for strtok_r() */
-  char *token          = NULL; /* from strtok_r() */
-  char  *endptr;               /* for strtod() */
-  FILE *attr_file;
-  char buf[BUFSIZE];
-  uint_t  i;
-  double  val;
+  uint_t mask, pos;
 
-  if (!(attr_file = fopen(attr_filename, "r"))) {
-    fprintf(stderr, "ERROR: could not open continuous attribute file %s (%s)\n",
-            attr_filename, strerror(errno));
-    return -1;
-  }
-  if (!fgets(buf, sizeof(buf)-1, attr_file)) {
-    fprintf(stderr, "ERROR: could not read header line in continuous attributes file %s (%s)\n",
-            attr_filename, strerror(errno));
-    return -1;
-  }
-  token = strtok_r(buf, delims, &saveptr);
-  while(token) {
-    attr_names = (char **)safe_realloc(attr_names, 
-                                       (num_attributes + 1) * sizeof(char *));
-    attr_names[num_attributes++] = safe_strdup(token);
-    token = strtok_r(NULL, delims, &saveptr);
-  }
-  saveptr = NULL; /* reset strtok() for next line */
+  /* keep load factor at most 0.5 so probe sequences are very short */
+  if (2 * (set->count + 1) > set->capacity)
+    nodeset_resize(set, 2 * set->capacity);
+  mask = set->capacity - 1;
+  for (pos = nodeset_hash(v) & mask; set->slots[pos] != NODESET_EMPTY;
+       pos = (pos + 1) & mask)
+    assert(set->slots[pos] != v);
+  set->slots[pos] = v;
+  set->count++;
+}
 
-  /* Now that we know how many attributes there are, allocate space for values */
-  attr_values = (double **)safe_malloc(num_attributes * sizeof(double *));
-  for (i = 0; i < num_attributes; i++)
-    attr_values[i] = (double *)safe_malloc(num_nodes * sizeof(double));
+/*
+ * Delete node from hub neighbour set, using backward shift deletion
+ * (as for the two-path hash tables) so there are no tombstones.
+ *
+ * Parameters:
+ *    set - hub neighbour set
+ *    v   - node id to delete (must be in set)
+ *
+ * Return value:
+ *    None.
+ */
+static void nodeset_delete(nodeset_t *set, uint_t v)
+{
+  uint_t mask = set->capacity - 1;
+  uint_t pos, hole, ideal;
 
-  if (!fgets(buf, sizeof(buf)-1, attr_file)) {
-    fprintf(stderr, "ERROR: could not read first values line in continuous attributes file %s (%s)\n",
-            attr_filename, strerror(errno));
-    return -1;
-  }
-  while (!feof(attr_file)) {
-    thisline_values = 0;
-    token = strtok_r(buf, delims, &saveptr);
-    while(token) {
-      if (strcasecmp(token, NA_STRING) == 0) {
-        val = NAN; /* NA value for continuous is floating point NaN */
-      } else {
-        val = strtod(token, &endptr);
-        if (*endptr != '\0') {
-          fprintf(stderr, "ERROR: bad floating point value '%s' for node %u\n", token, nodenum);
-          return -1;        
-        }
-      }
-      if (thisline_values < num_attributes && nodenum < num_nodes) 
-        attr_values[thisline_values][nodenum] = val;
-      thisline_values++;
-      token = strtok_r(NULL, delims, &saveptr);
-    }
-    if (thisline_values != num_attributes) {
-      fprintf(stderr, "ERROR: %u values for node %u but expected %u in file %s\n",
-              thisline_values, nodenum, num_attributes, attr_filename);
-      return -1;
+  for (pos = nodeset_hash(v) & mask; set->slots[pos] != v;
+       pos = (pos + 1) & mask)
+    assert(set->slots[pos] != NODESET_EMPTY);
+  hole = pos;
+  for (pos = (hole + 1) & mask; set->slots[pos] != NODESET_EMPTY;
+       pos = (pos + 1) & mask) {
+    ideal = nodeset_hash(set->slots[pos]) & mask;
+    if (((pos - ideal) & mask) >= ((pos - hole) & mask)) {
+      set->slots[hole] = set->slots[pos];
+      hole = pos;
     }
-    if (!fgets(buf, sizeof(buf)-1, attr_file)) {
-      if (!feof(attr_file)) {
-        fprintf(stderr, "ERROR: attempting to read attributes in file %s (%s)\n",
-                attr_filename, strerror(errno));
-        return -1;
-      }
-    }
-    nodenum++;
-    saveptr = NULL; /* reset strtok() for next line */
   }
-  if (nodenum != num_nodes) {
-    fprintf(stderr, "ERROR: %u rows after header but expected %u in file %s\n",
-            nodenum, num_nodes, attr_filename);
-    return -1;
+  set->slots[hole] = NODESET_EMPTY;
+  set->count--;
+}
+
+/*
+ * Test if node is in hub neighbour set.
+ *
+ * Parameters:
+ *    set - hub neighbour set
+ *    v   - node id to look up
+ *
+ * Return value:
+ *    TRUE iff v is in set
+ */
+static bool nodeset_contains(const nodeset_t *set, uint_t v)
+{
+  uint_t mask = set->capacity - 1;
+  uint_t pos;
+
+  for (pos = nodeset_hash(v) & mask; set->slots[pos] != NODESET_EMPTY;
+       pos = (pos + 1) & mask) {
+    if (set->slots[pos] == v)
+      return TRUE;
   }
-  fclose(attr_file);
-  *out_attr_names = attr_names;
-  *out_attr_values = attr_values;
-  return num_attributes;
+  return FALSE;
 }
 
+/*
+ * Build hub neighbour set from adjacency list.
+ *
+ * Parameters:
+ *    set    - hub neighbour set (must be empty)
+ *    list   - adjacency list
+ *    degree - number of entries in list
+ *
+ * Return value:
+ *    None.
+ */
+static void nodeset_build(nodeset_t *set, const nodeid_t *list, uint_t degree)
+{
+  uint_t capacity = NODESET_MIN_CAPACITY;
+  uint_t k;
+
+  assert(set->capacity == 0);
+  while (capacity < 2 * degree)
+    capacity *= 2;
+  set->count = 0;
+  nodeset_resize(set, capacity);
+  for (k = 0; k < degree; k++)
+    nodeset_insert(set, list[k]);
+}
 
 /*
- * Load set (of categorical) attributes from file.
- * The format of the file is a header line with whitespace
- * delimited attribute names, and each subsequent line
- * the attribute values for each attribute.
- * The format of the attribute values (set of categories) is a comma
- * delimited (note must have no whitespace as different attributes
- * are delimited by whitespace) list of integers making up the set of
- * categories.
- * The first line (after the header) has the values for
- * node 0, then the next line node 1, and so on.
- * 
- * E.g.:
+ * Free hub neighbour set, leaving it empty.
  *
- * type   class
- * 0,9    1
- * 3,1    2,3,4,5,6
- * 2      3,10,98
- * none   0
+ * Parameters:
+ *    set - hub neighbour set
+ *
+ * Return value:
+ *    None.
+ */
+static void nodeset_free(nodeset_t *set)
+{
+  free(set->slots);
+  set->slots = NULL;
+  set->capacity = set->count = 0;
+}
+
+/*
+ * Copy hub neighbour set.
  *
+ * Parameters:
+ *    dst - (out) copy of src (its previous contents are ignored)
+ *    src - hub neighbour set
  *
- * Valid values are integer >= 0 for each of the comma-delimited categories,
- * or a single NONE (case insensitive) for empty set, 
- * or a single NA (case insensitve) for missing data.
+ * Return value:
+ *    None.
+ */
+static void nodeset_copy(nodeset_t *dst, const nodeset_t *src)
+{
+  *dst = *src;
+  if (src->capacity) {
+    dst->slots = (uint_t *)safe_malloc(src->capacity * sizeof(uint_t));
+    memcpy(dst->slots, src->slots, src->capacity * sizeof(uint_t));
+  }
+}
+
+/*
+ * Update the hub neighbour sets of i and j (if they are hubs) after
+ * arc i -> j has been added to or removed from the arc lists, building
+ * the set if the degree has just gone above the hub threshold and
+ * freeing it if it has fallen below half of it.
  *
- * The highest value of any integer for an attribute gives the size of
- * the set for that attribute. The values do not need to be contiguous,
- * and the set is stored as an array of set_elem_e for maximum flexibility
- * (rather than more efficient fixed size bit set),
- * so e.g. for 'type' in the example above the set is an array of size
- * 10 indexed 0..9 as 9 is the highest value, and for 'class' an array
- * of size 99 indexed 0..98 as 98 is the highest value.
- * 
- * Note that NONE results simply in all elements of the set being
- * absent with the normal semantics of the set, however NA results in
- * all elements of the set (array) being set to SET_ELEM_NA meaning there is
- * really a single NA for that set attribute on that node, there is
- * no individual meaning of SET_ELEM_NA at a particular index in the array.
+ * Parameters:
+ *   g     - digraph
+ *   i     - node arc is from
+ *   j     - node arc is to
+ *   isAdd - TRUE for inserting arc, FALSE for deleting arc
  *
+ * Return value:
+ *   None.
+ */
+static void updateHubSets(digraph_t *g, uint_t i, uint_t j, bool isAdd)
+{
+  if (isAdd) {
+    if (g->outhubset[i].capacity)
+      nodeset_insert(&g->outhubset[i], j);
+    else if (g->hub_threshold && g->outdegree[i] > g->hub_threshold)
+      nodeset_build(&g->outhubset[i], g->arclist[i], g->outdegree[i]);
+    if (g->inhubset[j].capacity)
+      nodeset_insert(&g->inhubset[j], i);
+    else if (g->hub_threshold && g->indegree[j] > g->hub_threshold)
+      nodeset_build(&g->inhubset[j], g->revarclist[j], g->indegree[j]);
+  } else {
+    if (g->outhubset[i].capacity) {
+      if (g->outdegree[i] < g->hub_threshold / 2)
+        nodeset_free(&g->outhubset[i]);
+      else
+        nodeset_delete(&g->outhubset[i], j);
+    }
+    if (g->inhubset[j].capacity) {
+      if (g->indegree[j] < g->hub_threshold / 2)
+        nodeset_free(&g->inhubset[j]);
+      else
+        nodeset_delete(&g->inhubset[j], i);
+    }
+  }
+}
+
+/*
+ * Hash function for (i,j) node pair packed into 64 bit key (two-path
+ * tables and arc position index). This is the 64 bit finalizer from
+ * MurmurHash3, which mixes all bits of the key so that the low bits
+ * used as the slot index are well distributed even though node numbers
+ * are small consecutive integers.
  *
  * Parameters:
- *   attr_filenname - filename of file to read
- *   num_nodes - number of nodes (must be this many values)
- *   out_attr_names - (Out) attribute names array
- *   out_attr_values - (Out) (*attr_values)[u][i] is value of attr u for node i
- *   out_set_sizes   - (Out) size of set for each attribute
- * 
+ *    key - packed (i,j) key
+ *
  * Return value:
- *   Number of attributes, or -1 on error.
+ *    hash value of key
+ */
+static uint64_t pair_hash(uint64_t key)
+{
+  key ^= key >> 33;
+  key *= 0xff51afd7ed558ccdULL;
+  key ^= key >> 33;
+  key *= 0xc4ceb9fe1a85ec53ULL;
+  key ^= key >> 33;
+  return key;
+}
+
+/*
+ * Resize arc position index to new capacity, reinserting all entries.
  *
- * The attribute names and values arrays are allocated by 
- * this function.
+ * Parameters:
+ *    idx          - arc position index
+ *    new_capacity - new number of slots, power of two greater than count
+ *
+ * Return value:
+ *    None.
  */
-static int load_set_attributes(const char   *attr_filename,
-                               uint_t        num_nodes,
-                               char        ***out_attr_names,
-                               set_elem_e ****out_attr_values,
-                               uint_t       **out_set_sizes)
+static void arcindex_resize(arcindex_t *idx, size_t new_capacity)
 {
-  const char *delims    = " \t\r\n"; /* strtok_r() delimiters  */
-  uint_t nodenum        = 0;   /* node number values are for */
-  uint_t num_attributes = 0;   /* number of different attributes */
-  uint_t thisline_values= 0;   /* number values read this line */
-  char  **attr_names   = NULL; /* array of attribute names */
-  set_elem_e ***attr_values = NULL; /* attr_values[u][i] is value of attr u for node i */
-  char *saveptr        = NULL; /* for strtok_r() */
-  char *token          = NULL; /* from strtok_r() */
-  uint_t  *setsizes    = NULL; /* max integer in set for each attribute */
-  FILE *attr_file;
-  char buf[BUFSIZE];
-  uint_t  i;
-  set_elem_e   *setval = NULL;
-  int     pass;
-  bool    firstpass;
+  uint64_t *old_keys     = idx->keys;
+  arcidx_t *old_values   = idx->values;
+  size_t    old_capacity = idx->capacity;
+  size_t    mask         = new_capacity - 1;
+  size_t    k, pos;
 
-  if (!(attr_file = fopen(attr_filename, "r"))) {
-    fprintf(stderr, "ERROR: could not open set attribute file %s (%s)\n",
-            attr_filename, strerror(errno));
-    return -1;
-  }
-  if (!fgets(buf, sizeof(buf)-1, attr_file)) {
-    fprintf(stderr, "ERROR: could not read header line in set attributes file %s (%s)\n",
-            attr_filename, strerror(errno));
-    return -1;
-  }
-  token = strtok_r(buf, delims, &saveptr);
-  while(token) {
-    attr_names = (char **)safe_realloc(attr_names, 
-                                       (num_attributes + 1) * sizeof(char *));
-    attr_names[num_attributes++] = safe_strdup(token);
-    token = strtok_r(NULL, delims, &saveptr);
+  assert((new_capacity & mask) == 0 && new_capacity > idx->count);
+  idx->keys = (uint64_t *)safe_malloc(new_capacity * sizeof(uint64_t));
+  idx->values = (arcidx_t *)safe_malloc(new_capacity * sizeof(arcidx_t));
+  for (k = 0; k < new_capacity; k++)
+    idx->keys[k] = ARCINDEX_EMPTY_KEY;
+  idx->capacity = new_capacity;
+  for (k = 0; k < old_capacity; k++) {
+    if (old_keys[k] != ARCINDEX_EMPTY_KEY) {
+      for (pos = pair_hash(old_keys[k]) & mask;
+           idx->keys[pos] != ARCINDEX_EMPTY_KEY; pos = (pos + 1) & mask)
+        /*nothing*/;
+      idx->keys[pos] = old_keys[k];
+      idx->values[pos] = old_values[k];
+    }
   }
-  saveptr = NULL; /* reset strtok() for next line */
+  free(old_keys);
+  free(old_values);
+}
 
-  /* Now that we know how many attributes there are, allocate space for values */
-  setsizes = (uint_t *)safe_calloc((size_t)num_attributes, sizeof(uint_t));
-  attr_values = (set_elem_e ***)safe_malloc(num_attributes * sizeof(set_elem_e **));
-  for (i = 0; i < num_attributes; i++)
-    attr_values[i] = (set_elem_e **)safe_malloc(num_nodes * sizeof(set_elem_e *));
+/*
+ * Find the slot for arc i -> j in arc position index, which is either
+ * the slot containing it or the empty slot where it would be inserted.
+ *
+ * Parameters:
+ *    idx - arc position index (must have nonzero capacity)
+ *    i   - node arc is from
+ *    j   - node arc is to
+ *
+ * Return value:
+ *    slot number in idx
+ */
+static size_t arcindex_slot(const arcindex_t *idx, uint_t i, uint_t j)
+{
+  uint64_t key  = ARC_KEY(i, j);
+  size_t   mask = idx->capacity - 1;
+  size_t   pos;
 
-  for (pass = 0; pass < 2; pass++) {
-    /* on first pass, get max int in set for each attribute so can allocate
-       arrays, actually build them on second pass */
-    firstpass = (pass == 0);
-    if (!firstpass) {
-      /* on second pass have to reopen file and skip over header line */
-      if (!(attr_file = fopen(attr_filename, "r"))) {
-        fprintf(stderr, "ERROR: could not open set attribute file %s (%s)\n",
-            attr_filename, strerror(errno));
-        return -1;
-      }
-      if (!fgets(buf, sizeof(buf)-1, attr_file)) {
-        fprintf(stderr, "ERROR: could not read header line in set attributes file %s (%s)\n",
-                attr_filename, strerror(errno));
-        return -1;
-      }
-      DIGRAPH_DEBUG_PRINT(("load_set_attributes pass %d reopen %s at '%s'\n",
-                           pass, attr_filename, buf));
+  for (pos = pair_hash(key) & mask;
+       idx->keys[pos] != ARCINDEX_EMPTY_KEY && idx->keys[pos] != key;
+       pos = (pos + 1) & mask)
+    /*nothing*/;
+  return pos;
+}
+
+/*
+ * Set the position of arc i -> j in arc position index, inserting
+ * it if it is not already there.
+ *
+ * Parameters:
+ *    idx      - arc position index
+ *    i        - node arc is from
+ *    j        - node arc is to
+ *    position - index of the arc in the flat arc list
+ *
+ * Return value:
+ *    None.
+ */
+static void arcindex_put(arcindex_t *idx, uint_t i, uint_t j,
+                         arcidx_t position)
+{
+  size_t pos;
+
+  /* keep load factor at most 0.5 (capacity is 0 before first insert) */
+  if (2 * (idx->count + 1) > idx->capacity)
+    arcindex_resize(idx, idx->capacity ? 2 * idx->capacity :
+                    ARCINDEX_INITIAL_CAPACITY);
+  pos = arcindex_slot(idx, i, j);
+  if (idx->keys[pos] == ARCINDEX_EMPTY_KEY) {
+    idx->keys[pos] = ARC_KEY(i, j);
+    idx->count++;
+  }
+  idx->values[pos] = position;
+}
+
+/*
+ * Get the position of arc i -> j from arc position index.
+ *
+ * Parameters:
+ *    idx - arc position index
+ *    i   - node arc is from
+ *    j   - node arc is to
+ *
+ * Return value:
+ *    index of the arc in the flat arc list (the arc must be in idx)
+ */
+static arcidx_t arcindex_get(const arcindex_t *idx, uint_t i, uint_t j)
+{
+  size_t pos;
+
+  assert(idx->capacity > 0);
+  pos = arcindex_slot(idx, i, j);
+  assert(idx->keys[pos] == ARC_KEY(i, j));
+  return idx->values[pos];
+}
+
+/*
+ * Delete arc i -> j from arc position index, shifting back later
+ * entries in the probe sequence so no tombstones are needed.
+ *
+ * Parameters:
+ *    idx - arc position index
+ *    i   - node arc is from
+ *    j   - node arc is to (arc must be in idx)
+ *
+ * Return value:
+ *    None.
+ */
+static void arcindex_delete(arcindex_t *idx, uint_t i, uint_t j)
+{
+  size_t mask = idx->capacity - 1;
+  size_t pos, hole, ideal;
+
+  hole = arcindex_slot(idx, i, j);
+  assert(idx->keys[hole] == ARC_KEY(i, j));
+  for (pos = (hole + 1) & mask; idx->keys[pos] != ARCINDEX_EMPTY_KEY;
+       pos = (pos + 1) & mask) {
+    ideal = pair_hash(idx->keys[pos]) & mask;
+    /* entry at pos can move to hole if hole is cyclically in [ideal, pos] */
+    if (((pos - ideal) & mask) >= ((pos - hole) & mask)) {
+      idx->keys[hole] = idx->keys[pos];
+      idx->values[hole] = idx->values[pos];
+      hole = pos;
     }
-    if (!fgets(buf, sizeof(buf)-1, attr_file)) {
-      fprintf(stderr, "ERROR: could not read first values line in set attributes file %s (%s)\n",
-              attr_filename, strerror(errno));
-      return -1;
+  }
+  idx->keys[hole] = ARCINDEX_EMPTY_KEY;
+  idx->count--;
+}
+
+/*
+ * Free arc position index, leaving it empty.
+ *
+ * Parameters:
+ *    idx - arc position index
+ *
+ * Return value:
+ *    None.
+ */
+static void arcindex_free(arcindex_t *idx)
+{
+  free(idx->keys);
+  free(idx->values);
+  idx->keys = NULL;
+  idx->values = NULL;
+  idx->capacity = idx->count = 0;
+}
+
+/*
+ * Rebuild arc position index for a flat arc list.
+ *
+ * Parameters:
+ *    idx      - arc position index
+ *    arcs     - flat arc list
+ *    num_arcs - number of arcs in list
+ *
+ * Return value:
+ *    None.
+ */
+static void arcindex_build(arcindex_t *idx, const nodepair_t *arcs,
+                           arcidx_t num_arcs)
+{
+  arcidx_t a;
+
+  arcindex_free(idx);
+  for (a = 0; a < num_arcs; a++)
+    arcindex_put(idx, arcs[a].i, arcs[a].j, a);
+}
+
+/*
+ * Copy arc position index.
+ *
+ * Parameters:
+ *    dst - (out) copy of src (its previous contents are ignored)
+ *    src - arc position index
+ *
+ * Return value:
+ *    None.
+ */
+static void arcindex_copy(arcindex_t *dst, const arcindex_t *src)
+{
+  *dst = *src;
+  if (src->capacity) {
+    dst->keys = (uint64_t *)safe_malloc(src->capacity * sizeof(uint64_t));
+    dst->values = (arcidx_t *)safe_malloc(src->capacity * sizeof(arcidx_t));
+    memcpy(dst->keys, src->keys, src->capacity * sizeof(uint64_t));
+    memcpy(dst->values, src->values, src->capacity * sizeof(arcidx_t));
+  }
+}
+
+/*
+ * Resize node id map to new capacity, reinserting all entries.
+ *
+ * Parameters:
+ *    map          - node id map
+ *    new_capacity - new number of slots, power of two greater than
+ *                   number of ids
+ *
+ * Return value:
+ *    None.
+ */
+static void nodeidmap_resize(nodeidmap_t *map, size_t new_capacity)
+{
+  uint64_t *old_keys     = map->keys;
+  uint_t   *old_values   = map->values;
+  size_t    old_capacity = map->capacity;
+  size_t    mask         = new_capacity - 1;
+  size_t    k, pos;
+
+  assert((new_capacity & mask) == 0 && new_capacity > map->num_nodes);
+  map->keys = (uint64_t *)safe_malloc(new_capacity * sizeof(uint64_t));
+  map->values = (uint_t *)safe_malloc(new_capacity * sizeof(uint_t));
+  for (k = 0; k < new_capacity; k++)
+    map->keys[k] = NODEIDMAP_EMPTY_KEY;
+  map->capacity = new_capacity;
+  for (k = 0; k < old_capacity; k++) {
+    if (old_keys[k] != NODEIDMAP_EMPTY_KEY) {
+      for (pos = pair_hash(old_keys[k]) & mask;
+           map->keys[pos] != NODEIDMAP_EMPTY_KEY; pos = (pos + 1) & mask)
+        /*nothing*/;
+      map->keys[pos] = old_keys[k];
+      map->values[pos] = old_values[k];
     }
-    nodenum = 0;
-    saveptr = NULL; /* reset strtok() for next line */
-    while (!feof(attr_file)) {
-      thisline_values = 0;
-      token = strtok_r(buf, delims, &saveptr);
-      while(token) {
-        DIGRAPH_DEBUG_PRINT(("load_set_attributes pass %u token '%s'\n",
-                             pass, token));
-        if (!firstpass) {
-          setval = (set_elem_e *)safe_malloc(setsizes[thisline_values] *
-                                       sizeof(set_elem_e));
-        }
-        if (parse_category_set(token, firstpass,
-                               &setsizes[thisline_values], setval) < 0) {
-          fprintf(stderr, "ERROR: bad set value '%s' for node %u\n", token,
-                  nodenum);
-          return -1;
-        }
-        if (thisline_values < num_attributes && nodenum < num_nodes) {
-          if (!firstpass) {
-            attr_values[thisline_values][nodenum] = setval;
-          }
-        }
-        thisline_values++;
-        token = strtok_r(NULL, delims, &saveptr);
-      }
-      if (thisline_values != num_attributes) {
-        fprintf(stderr, "ERROR: %u set values for node %u but expected %u in file %s\n",
-                thisline_values, nodenum, num_attributes, attr_filename);
-        return -1;
-      }
-      if (!fgets(buf, sizeof(buf)-1, attr_file)) {
-        if (!feof(attr_file)) {
-          fprintf(stderr, "ERROR: attempting to read set attributes in file %s (%s)\n",
-                  attr_filename, strerror(errno));
-          return -1;
-        }
-      }
-      nodenum++;
-      saveptr = NULL; /* reset strtok() for next line */
+  }
+  free(old_keys);
+  free(old_values);
+}
+
+/*
+ * Find the slot for a node id in node id map, which is either the slot
+ * containing it or the empty slot where it would be inserted.
+ *
+ * Parameters:
+ *    map - node id map (must have nonzero capacity)
+ *    id  - node id
+ *
+ * Return value:
+ *    slot number in map
+ */
+static size_t nodeidmap_slot(const nodeidmap_t *map, uint64_t id)
+{
+  size_t mask = map->capacity - 1;
+  size_t pos;
+
+  for (pos = pair_hash(id) & mask;
+       map->keys[pos] != NODEIDMAP_EMPTY_KEY && map->keys[pos] != id;
+       pos = (pos + 1) & mask)
+    /*nothing*/;
+  return pos;
+}
+
+/*
+ * Comparison function for qsort() of node ids into ascending order.
+ *
+ * Parameters:
+ *   a, b - pointers to uint64_t node ids to compare
+ *
+ * Return value:
+ *   <0, 0, >0 if a is less than, equal to, or greater than b
+ */
+static int compare_node_id(const void *a, const void *b)
+{
+  uint64_t u = *(const uint64_t *)a, v = *(const uint64_t *)b;
+  return (u > v) - (u < v);
+}
+
+#ifdef TWOPATH_WITH_UTHASH
+/*
+ * Get a hash table record from the pool, either one on the free list
+ * or carved from the current slab (allocating a new slab if required).
+ *
+ * Parameters:
+ *     pool - hash table record pool
+ *
+ * Return value:
+ *     Pointer to (uninitialized) record.
+ */
+static twopath_record_t *twopath_pool_alloc(twopath_pool_t *pool)
+{
+  twopath_record_t *rec;
+
+  if (pool->freelist) {
+    rec = pool->freelist;
+    pool->freelist = (twopath_record_t *)rec->hh.next;
+    return rec;
+  }
+  if (pool->num_slabs == 0 || pool->slab_used == TWOPATH_POOL_SLAB_RECORDS) {
+    pool->slabs = (twopath_record_t **)safe_realloc(pool->slabs,
+                                                    (pool->num_slabs + 1) *
+                                                    sizeof(twopath_record_t *));
+    pool->slabs[pool->num_slabs++] = (twopath_record_t *)
+      safe_malloc(TWOPATH_POOL_SLAB_RECORDS * sizeof(twopath_record_t));
+    pool->slab_used = 0;
+  }
+  return &pool->slabs[pool->num_slabs - 1][pool->slab_used++];
+}
+
+/*
+ * Return a hash table record (already removed from its hash table)
+ * to the pool free list.
+ *
+ * Parameters:
+ *     pool - hash table record pool
+ *     rec  - record to release
+ *
+ * Return value:
+ *     None.
+ */
+static void twopath_pool_release(twopath_pool_t *pool, twopath_record_t *rec)
+{
+  rec->hh.next = pool->freelist;
+  pool->freelist = rec;
+}
+
+/*
+ * Free all the records in the pool at once, leaving it empty.
+ *
+ * Parameters:
+ *     pool - hash table record pool
+ *
+ * Return value:
+ *     None.
+ */
+static void twopath_pool_free(twopath_pool_t *pool)
+{
+  uint_t k;
+
+  for (k = 0; k < pool->num_slabs; k++)
+    free(pool->slabs[k]);
+  free(pool->slabs);
+  memset(pool, 0, sizeof(twopath_pool_t));
+}
+
+/*
+ * Update entry for (i, j) in hashtable.
+ *
+ * Used for the two-path hash tables to count two-paths between nodes
+ * i and j. Much more efficient to use a hash table (or some other way
+ * of storing a sparse matrix) as typically at most only on the order of 1% to
+ * 10% of entries are nonzero, and for large networks (on the order
+ * of a million nodes) this can be orders of magnitude smaller still e.g.
+ * 0.01% to 0.1%. In such cases storing in dense matrix format
+ * is entirely infeasible.
+ *
+ * Parameters:
+ *     pool - pool to allocate records from and release them to
+ *     h - pointer to hash table (pointer itself)
+ *     i - node id of source
+ *     j - node id of destination
+ *     incval - value to add to existing value (or insert if not exists)
+ *              NB this can be negative (it is -1 or +1 when updating
+ *              for one arc, or a whole count when building the tables)
+ *
+ * Return value:
+ *     None.
+ */
+static void update_twopath_entry(twopath_pool_t *pool, twopath_record_t **h,
+                                 uint_t i, uint_t j, int incval)
+{
+  twopath_record_t rec;
+  twopath_record_t *newrec;
+  twopath_record_t *p;
+
+  assert(incval != 0);
+  
+  memset(&rec, 0, sizeof(twopath_record_t));
+  rec.key.i = i;
+  rec.key.j = j;
+  HASH_FIND(hh, *h, &rec.key, sizeof(nodepair_t), p);
+  if (p) {
+    p->value += incval;
+    if (p->value == 0) {
+      assert(incval < 0); /* value added must have been -ve to get to zero */
+      /* delete entry with value 0 to save memory (get_twopath_entry() 
+         returns 0 for value if key not in hash table, so having key in table
+         with value 0 is the same as having it not present).
+         If we don't do this then the hash table will just keep growing
+         and could use far more memory than if we do this */
+      HASH_DELETE(hh, *h, p);
+      twopath_pool_release(pool, p);
     }
-    if (nodenum != num_nodes) {
-      fprintf(stderr, "ERROR: %u rows after header but expected %u in file %s\n",
-              nodenum, num_nodes, attr_filename);
-      return -1;
+  } else {
+    newrec = twopath_pool_alloc(pool);
+    newrec->key.i = i;
+    newrec->key.j = j;
+    newrec->value = incval;
+    HASH_ADD(hh, *h, key, sizeof(nodepair_t), newrec);
+  }
+} 
+#endif /* TWOPATH_WITH_UTHASH */
+
+#ifdef TWOPATH_WITH_OATABLES
+/*
+ * Resize open addressing hash table to new capacity, reinserting
+ * all existing entries.
+ *
+ * Parameters:
+ *     h            - hash table
+ *     new_capacity - new number of slots, must be a power of two and
+ *                    greater than number of entries in table
+ *
+ * Return value:
+ *     None.
+ */
+static void twopath_hashtab_resize(twopath_hashtab_t *h, size_t new_capacity)
+{
+  twopath_key_t *old_keys     = h->keys;
+  uint32_t      *old_values   = h->values;
+  size_t         old_capacity = h->capacity;
+  size_t         mask         = new_capacity - 1;
+  size_t         k, pos;
+
+  assert((new_capacity & mask) == 0 && new_capacity > h->count);
+  h->keys = (twopath_key_t *)large_calloc(new_capacity,
+                                           sizeof(twopath_key_t));
+  h->values = (uint32_t *)large_calloc(new_capacity, sizeof(uint32_t));
+  for (k = 0; k < new_capacity; k++)
+    h->keys[k] = TWOPATH_EMPTY_KEY;
+  h->capacity = new_capacity;
+  for (k = 0; k < old_capacity; k++) {
+    if (old_keys[k] != TWOPATH_EMPTY_KEY) {
+      for (pos = pair_hash(old_keys[k]) & mask;
+           h->keys[pos] != TWOPATH_EMPTY_KEY; pos = (pos + 1) & mask)
+        /*nothing*/;
+      h->keys[pos] = old_keys[k];
+      h->values[pos] = old_values[k];
+    }
+  }
+  large_free(old_keys, old_capacity, sizeof(twopath_key_t));
+  large_free(old_values, old_capacity, sizeof(uint32_t));
+}
+
+/*
+ * Copy two-path hash table.
+ *
+ * Parameters:
+ *     dst - (out) copy of src (its previous contents are ignored)
+ *     src - two-path hash table
+ *
+ * Return value:
+ *     None.
+ */
+static void twopath_hashtab_copy(twopath_hashtab_t *dst,
+                                 const twopath_hashtab_t *src)
+{
+  *dst = *src;
+  if (src->capacity) {
+    dst->keys = (twopath_key_t *)large_calloc(src->capacity,
+                                              sizeof(twopath_key_t));
+    dst->values = (uint32_t *)large_calloc(src->capacity, sizeof(uint32_t));
+    memcpy(dst->keys, src->keys, src->capacity * sizeof(twopath_key_t));
+    memcpy(dst->values, src->values, src->capacity * sizeof(uint32_t));
+  }
+}
+
+/*
+ * Update entry for (i, j) in open addressing hashtable.
+ *
+ * Used for the two-path hash tables to count two-paths between nodes
+ * i and j. As for the uthash version, an entry whose value becomes 0
+ * is removed from the table (here by backward shift deletion, moving
+ * subsequent entries in the probe sequence back to fill the gap) so
+ * that the table only contains nonzero entries.
+ *
+ * Parameters:
+ *     h - hash table
+ *     i - node id of source
+ *     j - node id of destination
+ *     incval - value to add to existing value (or insert if not exists)
+ *              NB this can be negative (it is -1 or +1 when updating
+ *              for one arc, or a whole count when building the tables)
+ *
+ * Return value:
+ *     None.
+ */
+static void update_twopath_entry(twopath_hashtab_t *h, uint_t i, uint_t j,
+                                 int incval)
+{
+  twopath_key_t key = TWOPATH_KEY(i, j);
+  size_t        mask, pos, hole, ideal;
+
+  assert(incval != 0);
+
+  /* keep load factor at most 0.7 (capacity is 0 before first insert) */
+  if (10 * (h->count + 1) > 7 * h->capacity)
+    twopath_hashtab_resize(h, h->capacity ? 2 * h->capacity :
+                           TWOPATH_HASHTAB_INITIAL_CAPACITY);
+  mask = h->capacity - 1;
+  for (pos = pair_hash(key) & mask;
+       h->keys[pos] != TWOPATH_EMPTY_KEY && h->keys[pos] != key;
+       pos = (pos + 1) & mask)
+    /*nothing*/;
+
+  if (h->keys[pos] == TWOPATH_EMPTY_KEY) {
+    assert(incval > 0); /* can only decrement an existing entry */
+    h->keys[pos] = key;
+    h->values[pos] = (uint32_t)incval;
+    h->count++;
+    return;
+  }
+
+  h->values[pos] += incval;
+  if (h->values[pos] != 0)
+    return;
+
+  /* value is now zero, delete entry by shifting back later entries in
+     the probe sequence that would otherwise become unreachable */
+  hole = pos;
+  for (pos = (hole + 1) & mask; h->keys[pos] != TWOPATH_EMPTY_KEY;
+       pos = (pos + 1) & mask) {
+    ideal = pair_hash(h->keys[pos]) & mask;
+    /* entry at pos can move to hole if hole is on its probe path,
+       i.e. cyclically in [ideal, pos] */
+    if (((pos - ideal) & mask) >= ((pos - hole) & mask)) {
+      h->keys[hole] = h->keys[pos];
+      h->values[hole] = h->values[pos];
+      hole = pos;
+    }
+  }
+  h->keys[hole] = TWOPATH_EMPTY_KEY;
+  h->count--;
+}
+#endif /* TWOPATH_WITH_OATABLES */
+
+
+#if defined(TWOPATH_WITH_UTHASH) || defined(TWOPATH_WITH_OAHASH)
+/*
+ * Update the two-paths hash tables used for fast computation of change
+ * statistics for either adding or removing arc i->j
+ * The hash tables in the digraph are updated in-place
+ *
+ * The entry for each neighbour is prefetched TWOPATH_UPDATE_PREFETCH_DISTANCE
+ * neighbours ahead, so that for a high degree node the cache misses on
+ * the scattered entries overlap rather than each stalling in turn.
+ *
+ * Parameters:
+ *   g     - digraph
+ *   i     - node arc is from
+ *   j     - node arc is to
+ *   isAdd - TRUE for inserting arc, FALSE for deleting arc
+ *
+ * Return value:
+ *   None.
+ */
+static void updateTwoPathsHashTables(digraph_t *g, uint_t i, uint_t j,
+                                     bool isAdd)
+{
+  const uint_t D = TWOPATH_UPDATE_PREFETCH_DISTANCE;
+  uint_t v,k,w;
+  int incval = isAdd ? 1 : -1;
+  /* two-paths through a two-path hub are not stored (hybrid backend) */
+  bool through_i = !TWOPATH_HUB(g, i);
+  bool through_j = !TWOPATH_HUB(g, j);
+  bool mix = TWOPATH_KEPT(g, TWOPATH_TABLE_MIX);
+  bool in = TWOPATH_KEPT(g, TWOPATH_TABLE_IN);
+  bool out = TWOPATH_KEPT(g, TWOPATH_TABLE_OUT);
+
+  for (k = 0; out && through_i && k < g->outdegree[i]; k++) {
+    if (k + D < g->outdegree[i]) {
+      w = g->arclist[i][k + D];
+      PREFETCH_TWOPATH_HASHTAB(g, outTwoPathHashTab, MIN(w, j), MAX(w, j));
+    }
+    v = g->arclist[i][k];
+    if (v == i || v == j)
+      continue;
+    /*removed as slows significantly: assert(isArc(g,i,v)); */
+    /* out-two-paths are symmetric so only (min, max) entry is stored */
+    UPDATE_TWOPATH_HASHTAB(g, outTwoPathHashTab, MIN(v, j), MAX(v, j), incval);
+  }
+  for (k = 0; in && through_j && k < g->indegree[j]; k++) {
+    if (k + D < g->indegree[j]) {
+      w = g->revarclist[j][k + D];
+      PREFETCH_TWOPATH_HASHTAB(g, inTwoPathHashTab, MIN(w, i), MAX(w, i));
+    }
+    v = g->revarclist[j][k];
+    if (v == i || v == j)
+      continue;
+    /*removed as slows significantly: assert(isArc(g,v,j)); */
+    /* in-two-paths are symmetric so only (min, max) entry is stored */
+    UPDATE_TWOPATH_HASHTAB(g, inTwoPathHashTab, MIN(v, i), MAX(v, i), incval);
+  }
+  for (k = 0; mix && through_i && k < g->indegree[i]; k++)  {
+    if (k + D < g->indegree[i]) {
+      w = g->revarclist[i][k + D];
+      PREFETCH_TWOPATH_HASHTAB(g, mixTwoPathHashTab, w, j);
+    }
+    v = g->revarclist[i][k];
+    if (v == i || v == j)
+      continue;
+    /*removed as slows significantly: assert(isArc(g,v,i));*/
+    UPDATE_TWOPATH_HASHTAB(g, mixTwoPathHashTab, v, j, incval);
+  }
+  for (k = 0; mix && through_j && k < g->outdegree[j]; k++) {
+    if (k + D < g->outdegree[j]) {
+      w = g->arclist[j][k + D];
+      PREFETCH_TWOPATH_HASHTAB(g, mixTwoPathHashTab, i, w);
+    }
+    v = g->arclist[j][k];
+    if (v == i || v == j)
+      continue;
+    /*removed as slows significantly: assert(isArc(g,j,v));*/
+    UPDATE_TWOPATH_HASHTAB(g, mixTwoPathHashTab, i, v, incval);
+  }
+}
+#endif /* TWOPATH_WITH_UTHASH || TWOPATH_WITH_OAHASH */
+
+#ifdef TWOPATH_WITH_ARRAYS
+/*
+ * Add incval (+1 or -1) to the two-path count in cell k of a narrow
+ * two-path array, with the excess over TWOPATH_CELL_MAX kept in the
+ * spill hash table (see twopath_cell_t in digraph.h).
+ *
+ * Parameters:
+ *   m      - two-path array
+ *   spill  - spill hash table for m
+ *   k      - index of cell in m
+ *   incval - value to add to count, either +1 or -1
+ *
+ * Return value:
+ *   None.
+ */
+static void twopath_cell_update(twopath_cell_t *m, twopath_hashtab_t *spill,
+                                size_t k, int incval)
+{
+  uint_t hi = TWOPATH_KEY_HI(k), lo = TWOPATH_KEY_LO(k);
+
+  if (incval > 0) {
+    if (m[k] < TWOPATH_CELL_MAX)
+      m[k]++;
+    else
+      update_twopath_entry(spill, hi, lo, 1);
+  } else {
+    assert(m[k] > 0);
+    if (m[k] == TWOPATH_CELL_MAX && get_twopath_entry(spill, hi, lo) > 0)
+      update_twopath_entry(spill, hi, lo, -1);
+    else
+      m[k]--;
+  }
+}
+
+/* index of the cell of a two-path array for neighbour v and other node w */
+#define TWOPATH_CELL_INDEX(cells, v, w, n) \
+  ((cells) == TWOPATH_CELLS_SYM ? TWOPATH_INDEX_SYM2D((v), (w), (n)) : \
+   (cells) == TWOPATH_CELLS_COL ? TWOPATH_INDEX2D((v), (w), (n)) : \
+   TWOPATH_INDEX2D((w), (v), (n)))
+
+/*
+ * Add incval to the cells of a two-path array for the neighbours
+ * nodes[first..end-1] (other than i and j) of an arc i->j being
+ * added or removed, prefetching each cell
+ * TWOPATH_UPDATE_PREFETCH_DISTANCE neighbours ahead.
+ *
+ * Parameters:
+ *   m       - two-path array
+ *   spill   - spill hash table of m
+ *   mutex   - lock for spill, or NULL if only one thread updates m
+ *   nodes   - neighbours
+ *   first   - first neighbour to update cell of
+ *   end     - one past the last neighbour to update cell of
+ *   i       - node arc is from
+ *   j       - node arc is to
+ *   w       - other node of each cell
+ *   n       - number of nodes in digraph
+ *   cells   - which cells of m
+ *   incval  - +1 or -1
+ *
+ * Return value:
+ *   None.
+ */
+static inline void twopath_cells_update(twopath_cell_t *m,
+                                        twopath_hashtab_t *spill,
+                                        pthread_mutex_t *mutex,
+                                        const nodeid_t *nodes,
+                                        uint_t first, uint_t end,
+                                        uint_t i, uint_t j, uint_t w,
+                                        uint_t n, twopath_cells_e cells,
+                                        int incval)
+{
+  const uint_t D = TWOPATH_UPDATE_PREFETCH_DISTANCE;
+  uint_t k, v;
+  size_t c;
+
+  for (k = first; k < end; k++) {
+    if (k + D < end)
+      PREFETCH(&m[TWOPATH_CELL_INDEX(cells, nodes[k + D], w, n)]);
+    v = nodes[k];
+    if (v == i || v == j)
+      continue;
+    c = TWOPATH_CELL_INDEX(cells, v, w, n);
+    /* only a cell at its maximum uses the (shared) spill table */
+    if (mutex && m[c] == TWOPATH_CELL_MAX) {
+      pthread_mutex_lock(mutex);
+      twopath_cell_update(m, spill, c, incval);
+      pthread_mutex_unlock(mutex);
+    } else {
+      twopath_cell_update(m, spill, c, incval);
+    }
+  }
+}
+
+/*
+ * Update the share of the current job of a two-path update pool of
+ * thread k (0 being the calling thread).
+ *
+ * Parameters:
+ *   pool - two-path update pool with job set
+ *   k    - thread number
+ *
+ * Return value:
+ *   None.
+ */
+static void twopath_update_share(twopath_update_pool_t *pool, uint_t k)
+{
+  uint_t first = (uint_t)((uint64_t)pool->len * k / pool->num_threads);
+  uint_t end = (uint_t)((uint64_t)pool->len * (k + 1) / pool->num_threads);
+
+  twopath_cells_update(pool->m, pool->spill, &pool->spill_mutex,
+                       pool->nodes, first, end, pool->i, pool->j, pool->w,
+                       pool->n, pool->cells, pool->incval);
+}
+
+/*
+ * Worker thread of a two-path update pool: do its share of each job
+ * until told to quit.
+ *
+ * Parameters:
+ *   arg - twopath_update_thread_t for the thread
+ *
+ * Return value:
+ *   NULL.
+ */
+static void *twopath_update_thread(void *arg)
+{
+  twopath_update_thread_t *t = (twopath_update_thread_t *)arg;
+
+  /* wait until all the threads are created and the barriers set up */
+  pthread_mutex_lock(&t->pool->spill_mutex);
+  pthread_mutex_unlock(&t->pool->spill_mutex);
+  for (;;) {
+    pthread_barrier_wait(&t->pool->start_barrier);
+    if (t->pool->quit)
+      break;
+    twopath_update_share(t->pool, t->k);
+    pthread_barrier_wait(&t->pool->done_barrier);
+  }
+  free(t);
+  return NULL;
+}
+
+/*
+ * Create a pool of threads for two-path array updates.
+ *
+ * Parameters:
+ *   num_threads - number of threads including the caller (at least 2)
+ *
+ * Return value:
+ *   Pool, or NULL if no threads could be created (warning printed).
+ */
+static twopath_update_pool_t *create_twopath_update_pool(uint_t num_threads)
+{
+  twopath_update_pool_t   *pool;
+  twopath_update_thread_t *t;
+  uint_t                   k;
+
+  assert(num_threads > 1);
+  pool = (twopath_update_pool_t *)safe_calloc(1,
+                                              sizeof(twopath_update_pool_t));
+  pool->pid = getpid();
+  pool->threads = (pthread_t *)safe_malloc((num_threads - 1) *
+                                           sizeof(pthread_t));
+  pthread_mutex_init(&pool->spill_mutex, NULL);
+  /* the threads wait for this lock before using the barriers, which
+     are for however many threads could be created */
+  pthread_mutex_lock(&pool->spill_mutex);
+  for (k = 1; k < num_threads; k++) {
+    t = (twopath_update_thread_t *)safe_malloc(
+      sizeof(twopath_update_thread_t));
+    t->pool = pool;
+    t->k = k;
+    if (pthread_create(&pool->threads[k - 1], NULL, twopath_update_thread,
+                       t) != 0) {
+      fprintf(stderr, "WARNING: could not create two-path update thread, "
+              "using %u threads\n", k);
+      free(t);
+      break;
+    }
+  }
+  pool->num_threads = k;
+  if (k > 1) {
+    pthread_barrier_init(&pool->start_barrier, NULL, k);
+    pthread_barrier_init(&pool->done_barrier, NULL, k);
+  }
+  pthread_mutex_unlock(&pool->spill_mutex);
+  if (k == 1) {
+    pthread_mutex_destroy(&pool->spill_mutex);
+    free(pool->threads);
+    free(pool);
+    return NULL;
+  }
+  return pool;
+}
+
+/*
+ * Stop the threads of a two-path update pool and free it. In a process
+ * forked from the one that made the pool the threads do not exist, so
+ * only the memory is freed.
+ *
+ * Parameters:
+ *   pool - two-path update pool
+ *
+ * Return value:
+ *   None.
+ */
+static void free_twopath_update_pool(twopath_update_pool_t *pool)
+{
+  uint_t k;
+
+  if (pool->pid != getpid()) {
+    free(pool->threads);
+    free(pool);
+    return;
+  }
+  pool->quit = TRUE;
+  pthread_barrier_wait(&pool->start_barrier);
+  for (k = 1; k < pool->num_threads; k++)
+    pthread_join(pool->threads[k - 1], NULL);
+  pthread_barrier_destroy(&pool->start_barrier);
+  pthread_barrier_destroy(&pool->done_barrier);
+  pthread_mutex_destroy(&pool->spill_mutex);
+  free(pool->threads);
+  free(pool);
+}
+
+/*
+ * Add incval to the cells of a two-path array for the neighbours of an
+ * arc i->j, dividing them between the g->update_threads threads of the
+ * update pool of g if there are at least g->hub_update_degree of them.
+ * The pool is made the first time it is needed (in each process, as a
+ * digraph may be loaded and then the process forked).
+ *
+ * Parameters:
+ *   g       - digraph
+ *   m       - two-path array of g
+ *   spill   - spill hash table of m
+ *   nodes   - neighbours
+ *   len     - number of neighbours
+ *   i       - node arc is from
+ *   j       - node arc is to
+ *   w       - other node of each cell
+ *   cells   - which cells of m
+ *   incval  - +1 or -1
+ *
+ * Return value:
+ *   None.
+ */
+static inline void update_twopath_cells(digraph_t *g, twopath_cell_t *m,
+                                        twopath_hashtab_t *spill,
+                                        const nodeid_t *nodes, uint_t len,
+                                        uint_t i, uint_t j, uint_t w,
+                                        twopath_cells_e cells, int incval)
+{
+  twopath_update_pool_t *pool;
+
+  if (g->update_threads > 1 && len >= g->hub_update_degree &&
+      (!g->update_pool || g->update_pool->pid != getpid())) {
+    if (g->update_pool)
+      free_twopath_update_pool(g->update_pool);
+    if (!(g->update_pool = create_twopath_update_pool(g->update_threads)))
+      g->update_threads = 1;
+  }
+  pool = g->update_pool;
+  if (!pool || len < g->hub_update_degree) {
+    twopath_cells_update(m, spill, NULL, nodes, 0, len, i, j, w,
+                         g->num_nodes, cells, incval);
+    return;
+  }
+  pool->m = m;
+  pool->spill = spill;
+  pool->nodes = nodes;
+  pool->len = len;
+  pool->i = i;
+  pool->j = j;
+  pool->w = w;
+  pool->n = g->num_nodes;
+  pool->cells = cells;
+  pool->incval = incval;
+  pthread_barrier_wait(&pool->start_barrier);
+  twopath_update_share(pool, 0);
+  pthread_barrier_wait(&pool->done_barrier);
+}
+
+/*
+ * Update the two-paths matrices used for fast computation of change
+ * statistics for either adding or removing arc i->j
+ * The matcies in the digraph are updated in-place
+ *
+ * The cells for the neighbours of a node of degree at least
+ * g->hub_update_degree are updated by the threads of g->update_pool
+ * if there is one (see set_twopath_update_threads()).
+ *
+ * Parameters:
+ *   g     - digraph
+ *   i     - node arc is from
+ *   j     - node arc is to
+ *   isAdd - TRUE for inserting arc, FALSE for deleting arc
+ *
+ * Return value:
+ *   None.
+ */
+static void updateTwoPathsArrays(digraph_t *g, uint_t i, uint_t j, bool isAdd)
+{
+  int incval = isAdd ? 1 : -1;
+
+  /* out-two-paths v <- i -> j (symmetric so only upper triangle stored) */
+  if (TWOPATH_KEPT(g, TWOPATH_TABLE_OUT))
+    update_twopath_cells(g, g->outTwoPathMatrix, &g->outTwoPathSpill,
+                         g->arclist[i], g->outdegree[i], i, j, j,
+                         TWOPATH_CELLS_SYM, incval);
+  /* in-two-paths v -> j <- i (symmetric so only upper triangle stored) */
+  if (TWOPATH_KEPT(g, TWOPATH_TABLE_IN))
+    update_twopath_cells(g, g->inTwoPathMatrix, &g->inTwoPathSpill,
+                         g->revarclist[j], g->indegree[j], i, j, i,
+                         TWOPATH_CELLS_SYM, incval);
+  if (TWOPATH_KEPT(g, TWOPATH_TABLE_MIX)) {
+    /* two-paths v -> i -> j */
+    update_twopath_cells(g, g->mixTwoPathMatrix, &g->mixTwoPathSpill,
+                         g->revarclist[i], g->indegree[i], i, j, j,
+                         TWOPATH_CELLS_COL, incval);
+    /* two-paths i -> j -> v */
+    update_twopath_cells(g, g->mixTwoPathMatrix, &g->mixTwoPathSpill,
+                         g->arclist[j], g->outdegree[j], i, j, i,
+                         TWOPATH_CELLS_ROW, incval);
+  }
+}
+#endif /* TWOPATH_WITH_ARRAYS */
+
+#ifdef TWOPATH_ADAPTIVE
+/*
+ * Add node v to a list of two-path hubs.
+ *
+ * Parameters:
+ *   l - hub list
+ *   v - hub node to add
+ *
+ * Return value:
+ *   None.
+ */
+static void hublist_add(hublist_t *l, uint_t v)
+{
+  if (l->len == l->capacity) {
+    l->capacity = l->capacity ? 2 * l->capacity : 4;
+    l->nodes = (uint_t *)safe_realloc(l->nodes, l->capacity * sizeof(uint_t));
+  }
+  l->nodes[l->len++] = v;
+}
+
+/*
+ * Remove node v from a list of two-path hubs, replacing it with the
+ * last entry (the list is not ordered).
+ *
+ * Parameters:
+ *   l - hub list, must contain v
+ *   v - hub node to remove
+ *
+ * Return value:
+ *   None.
+ */
+static void hublist_remove(hublist_t *l, uint_t v)
+{
+  uint_t k;
+
+  for (k = 0; k < l->len && l->nodes[k] != v; k++)
+    /*nothing*/;
+  assert(k < l->len);
+  l->nodes[k] = l->nodes[--l->len];
+}
+
+/*
+ * Update the lists of adjacent two-path hubs (TWOPATH_BACKEND_HYBRID)
+ * for either adding or removing arc i->j
+ *
+ * Parameters:
+ *   g     - digraph
+ *   i     - node arc is from
+ *   j     - node arc is to
+ *   isAdd - TRUE for inserting arc, FALSE for deleting arc
+ *
+ * Return value:
+ *   None.
+ */
+static void updateTwoPathHubLists(digraph_t *g, uint_t i, uint_t j,
+                                  bool isAdd)
+{
+  if (g->twopath_hub[j]) {
+    if (isAdd)
+      hublist_add(&g->hub_out[i], j);
+    else
+      hublist_remove(&g->hub_out[i], j);
+  }
+  if (g->twopath_hub[i]) {
+    if (isAdd)
+      hublist_add(&g->hub_in[j], i);
+    else
+      hublist_remove(&g->hub_in[j], i);
+  }
+}
+
+/*
+ * Build the lists of adjacent two-path hubs (TWOPATH_BACKEND_HYBRID)
+ * from scratch from the arcs currently in g.
+ *
+ * Parameters:
+ *   g - digraph
+ *
+ * Return value:
+ *   None.
+ */
+static void buildTwoPathHubLists(digraph_t *g)
+{
+  uint_t i, k;
+
+  for (i = 0; i < g->num_nodes; i++)
+    g->hub_out[i].len = g->hub_in[i].len = 0;
+  for (i = 0; i < g->num_nodes; i++)
+    for (k = 0; k < g->outdegree[i]; k++)
+      updateTwoPathHubLists(g, i, g->arclist[i][k], TRUE);
+}
+
+/*
+ * Allocate the two-path hub flags of g, marking as hubs the nodes with
+ * total degree over g->twopath_hub_cutoff, and the (empty) lists of
+ * adjacent hubs.
+ *
+ * Parameters:
+ *   g - digraph
+ *
+ * Return value:
+ *   None.
+ */
+static void allocateTwoPathHubs(digraph_t *g)
+{
+  uint_t v;
+
+  g->twopath_hub = (uint8_t *)safe_calloc(g->num_nodes, sizeof(uint8_t));
+  for (v = 0; v < g->num_nodes; v++)
+    g->twopath_hub[v] = ((uint64_t)g->outdegree[v] + g->indegree[v] >
+                         g->twopath_hub_cutoff);
+  g->hub_out = (hublist_t *)safe_calloc(g->num_nodes, sizeof(hublist_t));
+  g->hub_in = (hublist_t *)safe_calloc(g->num_nodes, sizeof(hublist_t));
+}
+
+/*
+ * Free the two-path hub flags and lists of g.
+ *
+ * Parameters:
+ *   g - digraph
+ *
+ * Return value:
+ *   None.
+ */
+static void freeTwoPathHubs(digraph_t *g)
+{
+  uint_t i;
+
+  if (g->hub_out && g->hub_in) {
+    for (i = 0; i < g->num_nodes; i++) {
+      free(g->hub_out[i].nodes);
+      free(g->hub_in[i].nodes);
+    }
+  }
+  free(g->hub_out);
+  free(g->hub_in);
+  free(g->twopath_hub);
+  g->hub_out = g->hub_in = NULL;
+  g->twopath_hub = NULL;
+}
+
+/*
+ * Hash of a node number for its slot in a per-node two-path table.
+ * The neighbours of a node often have nearby numbers (especially after
+ * reorder_digraph_nodes()), so the bits are mixed rather than just
+ * using the low bits.
+ */
+static inline uint32_t nodetab_hash(uint32_t j)
+{
+  j *= 0x9E3779B1U;
+  return j ^ (j >> 16);
+}
+
+/*
+ * Resize a per-node two-path table to new capacity, reinserting all
+ * existing entries.
+ *
+ * Parameters:
+ *     t            - per-node two-path table
+ *     new_capacity - new number of slots, must be a power of two and
+ *                    greater than number of entries in table
+ *
+ * Return value:
+ *     None.
+ */
+static void nodetab_resize(twopath_nodetab_t *t, uint32_t new_capacity)
+{
+  twopath_nodeentry_t *old_slots    = t->slots;
+  uint32_t             old_capacity = t->capacity;
+  uint32_t             mask         = new_capacity - 1;
+  uint32_t             k, pos;
+
+  assert((new_capacity & mask) == 0 && new_capacity > t->count);
+  t->slots = (twopath_nodeentry_t *)safe_malloc(new_capacity *
+                                                sizeof(twopath_nodeentry_t));
+  for (k = 0; k < new_capacity; k++)
+    t->slots[k].node = TWOPATH_NODETAB_EMPTY;
+  t->capacity = new_capacity;
+  for (k = 0; k < old_capacity; k++) {
+    if (old_slots[k].node != TWOPATH_NODETAB_EMPTY) {
+      for (pos = nodetab_hash(old_slots[k].node) & mask;
+           t->slots[pos].node != TWOPATH_NODETAB_EMPTY;
+           pos = (pos + 1) & mask)
+        /*nothing*/;
+      t->slots[pos] = old_slots[k];
+    }
+  }
+  free(old_slots);
+}
+
+/*
+ * Make sure a per-node two-path table has room for count entries
+ * (at load factor at most 0.7) without resizing.
+ *
+ * Parameters:
+ *     t     - per-node two-path table
+ *     count - number of entries
+ *
+ * Return value:
+ *     None.
+ */
+static void nodetab_reserve(twopath_nodetab_t *t, uint32_t count)
+{
+  uint32_t capacity = t->capacity ? t->capacity : 4;
+
+  while (10 * (uint64_t)count > 7 * (uint64_t)capacity)
+    capacity *= 2;
+  if (capacity != t->capacity)
+    nodetab_resize(t, capacity);
+}
+
+/*
+ * Update entry for node j in a per-node two-path table, in the same
+ * way as update_twopath_entry() for the global hash tables: an entry
+ * whose count becomes zero is removed by backward shift deletion.
+ *
+ * Parameters:
+ *     t      - per-node two-path table
+ *     j      - other end node of the two-paths
+ *     incval - value to add to existing value (or insert if not exists),
+ *              -1 or +1 when updating for one arc, or a whole count
+ *              when building the tables
+ *
+ * Return value:
+ *     None.
+ */
+static void nodetab_update(twopath_nodetab_t *t, uint_t j, int incval)
+{
+  uint32_t mask, pos, hole, ideal;
+
+  assert(incval != 0);
+  nodetab_reserve(t, t->count + 1);
+  mask = t->capacity - 1;
+  for (pos = nodetab_hash(j) & mask;
+       t->slots[pos].node != TWOPATH_NODETAB_EMPTY && t->slots[pos].node != j;
+       pos = (pos + 1) & mask)
+    /*nothing*/;
+
+  if (t->slots[pos].node == TWOPATH_NODETAB_EMPTY) {
+    assert(incval > 0); /* can only decrement an existing entry */
+    t->slots[pos].node = j;
+    t->slots[pos].count = (uint32_t)incval;
+    t->count++;
+    return;
+  }
+
+  t->slots[pos].count += incval;
+  if (t->slots[pos].count != 0)
+    return;
+
+  /* count is now zero, delete entry by shifting back later entries in
+     the probe sequence that would otherwise become unreachable */
+  hole = pos;
+  for (pos = (hole + 1) & mask; t->slots[pos].node != TWOPATH_NODETAB_EMPTY;
+       pos = (pos + 1) & mask) {
+    ideal = nodetab_hash(t->slots[pos].node) & mask;
+    if (((pos - ideal) & mask) >= ((pos - hole) & mask)) {
+      t->slots[hole] = t->slots[pos];
+      hole = pos;
+    }
+  }
+  t->slots[hole].node = TWOPATH_NODETAB_EMPTY;
+  t->count--;
+}
+
+/*
+ * Update the per-node two-path tables (TWOPATH_BACKEND_PERNODE) for
+ * either adding or removing arc i->j. The same two-paths change as in
+ * updateTwoPathsHashTables(), but the symmetric in- and out-two-path
+ * counts are updated in the tables of both end nodes.
+ *
+ * Parameters:
+ *   g     - digraph
+ *   i     - node arc is from
+ *   j     - node arc is to
+ *   isAdd - TRUE for inserting arc, FALSE for deleting arc
+ *
+ * Return value:
+ *   None.
+ */
+static void updateTwoPathsNodeTabs(digraph_t *g, uint_t i, uint_t j,
+                                   bool isAdd)
+{
+  uint_t v,k;
+  int incval = isAdd ? 1 : -1;
+  bool mix = TWOPATH_KEPT(g, TWOPATH_TABLE_MIX);
+  bool in = TWOPATH_KEPT(g, TWOPATH_TABLE_IN);
+  bool out = TWOPATH_KEPT(g, TWOPATH_TABLE_OUT);
+
+  for (k = 0; out && k < g->outdegree[i]; k++) {
+    v = g->arclist[i][k];
+    if (v == i || v == j)
+      continue;
+    /* out-two-path v <- i -> j */
+    nodetab_update(&g->outTwoPathNodeTabs[v], j, incval);
+    nodetab_update(&g->outTwoPathNodeTabs[j], v, incval);
+  }
+  for (k = 0; in && k < g->indegree[j]; k++) {
+    v = g->revarclist[j][k];
+    if (v == i || v == j)
+      continue;
+    /* in-two-path v -> j <- i */
+    nodetab_update(&g->inTwoPathNodeTabs[v], i, incval);
+    nodetab_update(&g->inTwoPathNodeTabs[i], v, incval);
+  }
+  for (k = 0; mix && k < g->indegree[i]; k++)  {
+    v = g->revarclist[i][k];
+    if (v == i || v == j)
+      continue;
+    /* two-path v -> i -> j */
+    nodetab_update(&g->mixTwoPathNodeTabs[v], j, incval);
+  }
+  for (k = 0; mix && k < g->outdegree[j]; k++) {
+    v = g->arclist[j][k];
+    if (v == i || v == j)
+      continue;
+    /* two-path i -> j -> v */
+    nodetab_update(&g->mixTwoPathNodeTabs[i], v, incval);
+  }
+}
+
+/*
+ * Allocate the (empty) per-node two-path tables of g, of the kinds
+ * kept (the others are left NULL).
+ *
+ * Parameters:
+ *   g - digraph
+ *
+ * Return value:
+ *   None.
+ */
+static void allocateTwoPathNodeTabs(digraph_t *g)
+{
+  size_t n = MAX(g->num_nodes, 1);
+
+  if (TWOPATH_KEPT(g, TWOPATH_TABLE_MIX))
+    g->mixTwoPathNodeTabs = (twopath_nodetab_t *)safe_calloc(
+      n, sizeof(twopath_nodetab_t));
+  if (TWOPATH_KEPT(g, TWOPATH_TABLE_IN))
+    g->inTwoPathNodeTabs = (twopath_nodetab_t *)safe_calloc(
+      n, sizeof(twopath_nodetab_t));
+  if (TWOPATH_KEPT(g, TWOPATH_TABLE_OUT))
+    g->outTwoPathNodeTabs = (twopath_nodetab_t *)safe_calloc(
+      n, sizeof(twopath_nodetab_t));
+}
+
+/*
+ * Free the per-node two-path tables of g.
+ *
+ * Parameters:
+ *   g - digraph
+ *
+ * Return value:
+ *   None.
+ */
+static void freeTwoPathNodeTabs(digraph_t *g)
+{
+  uint_t i;
+
+  for (i = 0; i < g->num_nodes; i++) {
+    if (g->mixTwoPathNodeTabs)
+      free(g->mixTwoPathNodeTabs[i].slots);
+    if (g->inTwoPathNodeTabs)
+      free(g->inTwoPathNodeTabs[i].slots);
+    if (g->outTwoPathNodeTabs)
+      free(g->outTwoPathNodeTabs[i].slots);
+  }
+  free(g->mixTwoPathNodeTabs);
+  free(g->inTwoPathNodeTabs);
+  free(g->outTwoPathNodeTabs);
+  g->mixTwoPathNodeTabs = g->inTwoPathNodeTabs = g->outTwoPathNodeTabs = NULL;
+}
+
+/*
+ * Bytes of memory used by a set of per-node two-path tables (one for
+ * each node of g).
+ *
+ * Parameters:
+ *   g    - digraph
+ *   tabs - per-node tables of g of one kind, or NULL
+ *
+ * Return value:
+ *   Bytes used, 0 if tabs is NULL.
+ */
+static size_t nodetabs_bytes(const digraph_t *g, const twopath_nodetab_t *tabs)
+{
+  size_t bytes = 0;
+  uint_t i;
+
+  if (!tabs)
+    return 0;
+  bytes = (size_t)g->num_nodes * sizeof(twopath_nodetab_t);
+  for (i = 0; i < g->num_nodes; i++)
+    bytes += (size_t)tabs[i].capacity * sizeof(twopath_nodeentry_t);
+  return bytes;
+}
+
+/*
+ * Number of entries in a set of per-node two-path tables (one for each
+ * node of g).
+ *
+ * Parameters:
+ *   g    - digraph
+ *   tabs - per-node tables of g of one kind, or NULL
+ *
+ * Return value:
+ *   Number of entries, 0 if tabs is NULL.
+ */
+static double nodetabs_count(const digraph_t *g, const twopath_nodetab_t *tabs)
+{
+  double count = 0;
+  uint_t i;
+
+  for (i = 0; tabs && i < g->num_nodes; i++)
+    count += tabs[i].count;
+  return count;
+}
+#endif /* TWOPATH_ADAPTIVE */
+
+#if defined(TWOPATH_LOOKUP) || defined(TWOPATH_ADAPTIVE)
+/*
+ * Update the two-path lookup tables (whichever kind are in use) for
+ * either adding or removing arc i->j
+ *
+ * Parameters:
+ *   g     - digraph
+ *   i     - node arc is from
+ *   j     - node arc is to
+ *   isAdd - TRUE for inserting arc, FALSE for deleting arc
+ *
+ * Return value:
+ *   None.
+ */
+static void updateTwoPathsMatrices(digraph_t *g, uint_t i, uint_t j, bool isAdd)
+{
+#ifdef PROFILE_CHANGESTATS
+  uint64_t prof_t;
+#endif /* PROFILE_CHANGESTATS */
+
+  PROFILE_START(prof_t);
+#ifdef TWOPATH_ADAPTIVE
+  if (g->twopath_backend == TWOPATH_BACKEND_ARRAYS)
+    updateTwoPathsArrays(g, i, j, isAdd);
+  else if (g->twopath_backend == TWOPATH_BACKEND_HASHTABLES)
+    updateTwoPathsHashTables(g, i, j, isAdd);
+  else if (g->twopath_backend == TWOPATH_BACKEND_HYBRID) {
+    updateTwoPathsHashTables(g, i, j, isAdd);
+    updateTwoPathHubLists(g, i, j, isAdd);
+  }
+  else if (g->twopath_backend == TWOPATH_BACKEND_PERNODE)
+    updateTwoPathsNodeTabs(g, i, j, isAdd);
+#elif defined(TWOPATH_WITH_ARRAYS)
+  updateTwoPathsArrays(g, i, j, isAdd);
+#else
+  updateTwoPathsHashTables(g, i, j, isAdd);
+#endif /* TWOPATH_ADAPTIVE */
+  PROFILE_OP(PROFILE_OP_TWOPATH_UPDATE, prof_t, g, i, j);
+}
+#endif /* TWOPATH_LOOKUP || TWOPATH_ADAPTIVE */
+
+#if defined(TWOPATH_WITH_UTHASH) || defined(TWOPATH_WITH_OATABLES)
+/*
+ * Delete all entries and entire hash table.
+ *
+ * For uthash the records themselves are not freed here, as they all
+ * belong to the digraph's record pool, which is freed (all at once)
+ * with twopath_pool_free().
+ *
+ * Parameters:
+ *   h - hash table to destroy
+ *
+ * Return value:
+ *  None.
+ */
+#ifdef TWOPATH_WITH_UTHASH
+static void deleteAllHashTable(twopath_record_t **h)
+{
+  HASH_CLEAR(hh, *h);
+}
+#else /* open addressing hash table */
+static void deleteAllHashTable(twopath_hashtab_t *h)
+{
+  large_free(h->keys, h->capacity, sizeof(twopath_key_t));
+  large_free(h->values, h->capacity, sizeof(uint32_t));
+  h->keys = NULL;
+  h->values = NULL;
+  h->capacity = h->count = 0;
+}
+#endif /* TWOPATH_WITH_UTHASH */
+#endif /* TWOPATH_WITH_UTHASH || TWOPATH_WITH_OATABLES */
+
+#ifdef TWOPATH_WITH_ARRAYS
+/*
+ * Allocate the (zeroed) two-path arrays for the number of nodes in g,
+ * of the kinds kept (the others are left NULL).
+ *
+ * Parameters:
+ *   g - digraph
+ *
+ * Return value:
+ *   None.
+ */
+static void allocateTwoPathArrays(digraph_t *g)
+{
+  size_t mix_cells = TWOPATH_MIX_CELLS(g->num_nodes);
+  size_t sym_cells = TWOPATH_SYM_CELLS(g->num_nodes);
+
+  if (TWOPATH_KEPT(g, TWOPATH_TABLE_MIX))
+    g->mixTwoPathMatrix = (twopath_cell_t *)large_calloc(
+      mix_cells, sizeof(twopath_cell_t));
+  /* in- and out-two-path matrices are symmetric so stored as upper
+     triangle only */
+  if (TWOPATH_KEPT(g, TWOPATH_TABLE_IN))
+    g->inTwoPathMatrix = (twopath_cell_t *)large_calloc(
+      sym_cells, sizeof(twopath_cell_t));
+  if (TWOPATH_KEPT(g, TWOPATH_TABLE_OUT))
+    g->outTwoPathMatrix = (twopath_cell_t *)large_calloc(
+      sym_cells, sizeof(twopath_cell_t));
+  /* spill hash tables are allocated on first insertion */
+  memset(&g->mixTwoPathSpill, 0, sizeof(twopath_hashtab_t));
+  memset(&g->inTwoPathSpill, 0, sizeof(twopath_hashtab_t));
+  memset(&g->outTwoPathSpill, 0, sizeof(twopath_hashtab_t));
+#ifdef DEBUG_MEMUSAGE
+  MEMUSAGE_DEBUG_PRINT(("mixTwoPathMatrix size %f MB\n", 
+                        (double)mix_cells*
+                        sizeof(twopath_cell_t)/(1024*1024)));
+  MEMUSAGE_DEBUG_PRINT(("inTwoPathMatrix size %f MB\n", 
+                        (double)sym_cells*
+                        sizeof(twopath_cell_t)/(1024*1024)));
+  MEMUSAGE_DEBUG_PRINT(("outTwoPathMatrix size %f MB\n", 
+                        (double)sym_cells*
+                        sizeof(twopath_cell_t)/(1024*1024)));
+#endif /*DEBUG_MEMUSAGE*/
+}
+
+/*
+ * Free the two-path arrays in g.
+ *
+ * Parameters:
+ *   g - digraph
+ *
+ * Return value:
+ *   None.
+ */
+static void freeTwoPathArrays(digraph_t *g)
+{
+  large_free(g->mixTwoPathMatrix, TWOPATH_MIX_CELLS(g->num_nodes),
+             sizeof(twopath_cell_t));
+  large_free(g->inTwoPathMatrix, TWOPATH_SYM_CELLS(g->num_nodes),
+             sizeof(twopath_cell_t));
+  large_free(g->outTwoPathMatrix, TWOPATH_SYM_CELLS(g->num_nodes),
+             sizeof(twopath_cell_t));
+  g->mixTwoPathMatrix = NULL;
+  g->inTwoPathMatrix = NULL;
+  g->outTwoPathMatrix = NULL;
+  deleteAllHashTable(&g->mixTwoPathSpill);
+  deleteAllHashTable(&g->inTwoPathSpill);
+  deleteAllHashTable(&g->outTwoPathSpill);
+}
+
+/*
+ * Allocate two-path arrays in g that are copies of those in src (with
+ * the same number of nodes).
+ *
+ * Parameters:
+ *   g   - digraph
+ *   src - digraph to copy the two-path arrays of
+ *
+ * Return value:
+ *   None.
+ */
+static void copyTwoPathArrays(digraph_t *g, const digraph_t *src)
+{
+  size_t mix_cells = TWOPATH_MIX_CELLS(g->num_nodes);
+  size_t sym_cells = TWOPATH_SYM_CELLS(g->num_nodes);
+
+  allocateTwoPathArrays(g);
+  if (g->mixTwoPathMatrix)
+    memcpy(g->mixTwoPathMatrix, src->mixTwoPathMatrix,
+           mix_cells * sizeof(twopath_cell_t));
+  if (g->inTwoPathMatrix)
+    memcpy(g->inTwoPathMatrix, src->inTwoPathMatrix,
+           sym_cells * sizeof(twopath_cell_t));
+  if (g->outTwoPathMatrix)
+    memcpy(g->outTwoPathMatrix, src->outTwoPathMatrix,
+           sym_cells * sizeof(twopath_cell_t));
+  twopath_hashtab_copy(&g->mixTwoPathSpill, &src->mixTwoPathSpill);
+  twopath_hashtab_copy(&g->inTwoPathSpill, &src->inTwoPathSpill);
+  twopath_hashtab_copy(&g->outTwoPathSpill, &src->outTwoPathSpill);
+}
+#endif /* TWOPATH_WITH_ARRAYS */
+
+#if defined(TWOPATH_LOOKUP) || defined(TWOPATH_ADAPTIVE)
+/*
+ * Add a count of two-paths to a hash table (or spill table of an
+ * array) being built by buildTwoPathTables().
+ *
+ * Parameters:
+ *   g         - digraph
+ *   useArrays - TRUE if the tables are arrays
+ *   kind      - table the count is for
+ *   i         - first node, or for an array the high half of the index
+ *               of its cell (for the spill table)
+ *   j         - second node, or low half of array cell index
+ *   count     - number of two-paths to add
+ *
+ * Return value:
+ *   None.
+ */
+static void add_twopath_count(digraph_t *g, bool useArrays,
+                              twopath_kind_e kind, uint_t i, uint_t j,
+                              uint_t count)
+{
+#ifdef TWOPATH_WITH_ARRAYS
+  if (useArrays) {
+    update_twopath_entry(kind == TWOPATH_MIX ? &g->mixTwoPathSpill :
+                         kind == TWOPATH_IN ? &g->inTwoPathSpill :
+                         &g->outTwoPathSpill, i, j, (int)count);
+    return;
+  }
+#else
+  (void)useArrays;
+#endif /* TWOPATH_WITH_ARRAYS */
+#if defined(TWOPATH_WITH_UTHASH) || defined(TWOPATH_WITH_OAHASH)
+  if (kind == TWOPATH_MIX)
+    UPDATE_TWOPATH_HASHTAB(g, mixTwoPathHashTab, i, j, (int)count);
+  else if (kind == TWOPATH_IN)
+    UPDATE_TWOPATH_HASHTAB(g, inTwoPathHashTab, i, j, (int)count);
+  else
+    UPDATE_TWOPATH_HASHTAB(g, outTwoPathHashTab, i, j, (int)count);
+#endif /* TWOPATH_WITH_UTHASH || TWOPATH_WITH_OAHASH */
+}
+
+/*
+ * Write the two-path counts of node a and each node in touched[] (the
+ * nonzero entries of count[], which are reset to zero) to row a of
+ * a two-path table being built by twopath_build_thread(). The counts
+ * are written directly into the cells of an array, which belong only
+ * to this row, but hash tables (and the spill tables for counts over
+ * TWOPATH_CELL_MAX in an array) are shared so are locked while
+ * the row is added.
+ *
+ * Parameters:
+ *   t           - two-path table build thread
+ *   kind        - table the counts are for
+ *   a           - first node of each two-path counted
+ *   num_touched - number of entries in t->touched
+ *
+ * Return value:
+ *   None.
+ */
+static void twopath_row_flush(twopath_build_thread_t *t, twopath_kind_e kind,
+                              uint_t a, uint_t num_touched)
+{
+  uint_t          b, k;
+#ifdef TWOPATH_WITH_ARRAYS
+  uint_t          c;
+  size_t          cell;
+  twopath_cell_t *m;
+
+  if (t->useArrays) {
+    m = kind == TWOPATH_MIX ? t->g->mixTwoPathMatrix :
+      kind == TWOPATH_IN ? t->g->inTwoPathMatrix : t->g->outTwoPathMatrix;
+    for (k = 0; k < num_touched; k++) {
+      b = t->touched[k];
+      c = t->count[b];
+      t->count[b] = 0;
+      cell = kind == TWOPATH_MIX ? TWOPATH_INDEX2D(a, b, t->g->num_nodes) :
+        TWOPATH_INDEX_SYM2D(a, b, t->g->num_nodes);
+      m[cell] = (twopath_cell_t)MIN(c, TWOPATH_CELL_MAX);
+      if (c > TWOPATH_CELL_MAX) {
+        /* excess goes in spill table keyed by cell index as in
+           twopath_cell_update() */
+        if (t->mutex)
+          pthread_mutex_lock(t->mutex);
+        add_twopath_count(t->g, TRUE, kind, TWOPATH_KEY_HI(cell),
+                          TWOPATH_KEY_LO(cell), c - TWOPATH_CELL_MAX);
+        if (t->mutex)
+          pthread_mutex_unlock(t->mutex);
+      }
+    }
+    return;
+  }
+#endif /* TWOPATH_WITH_ARRAYS */
+#ifdef TWOPATH_ADAPTIVE
+  if (t->perNode) {
+    /* the table of node a only belongs to this row so is not locked */
+    twopath_nodetab_t *tab = kind == TWOPATH_MIX ?
+      &t->g->mixTwoPathNodeTabs[a] : kind == TWOPATH_IN ?
+      &t->g->inTwoPathNodeTabs[a] : &t->g->outTwoPathNodeTabs[a];
+    nodetab_reserve(tab, tab->count + num_touched);
+    for (k = 0; k < num_touched; k++) {
+      b = t->touched[k];
+      nodetab_update(tab, b, (int)t->count[b]);
+      t->count[b] = 0;
+    }
+    return;
+  }
+#endif /* TWOPATH_ADAPTIVE */
+  if (t->mutex && num_touched > 0)
+    pthread_mutex_lock(t->mutex);
+  for (k = 0; k < num_touched; k++) {
+    b = t->touched[k];
+    add_twopath_count(t->g, FALSE, kind, a, b, t->count[b]);
+    t->count[b] = 0;
+  }
+  if (t->mutex && num_touched > 0)
+    pthread_mutex_unlock(t->mutex);
+}
+
+/*
+ * Thread to count the two-paths for rows first_row, first_row + step,
+ * ... of the two-path tables, where row a of each table has the
+ * two-paths a -- v -- b for all v and b (b > a for the symmetric in-
+ * and out-two-path tables). Each thread writes only its own rows of
+ * the arrays, so they do not have to be locked.
+ *
+ * Parameters:
+ *   arg - twopath_build_thread_t for the thread
+ *
+ * Return value:
+ *   NULL.
+ */
+static void *twopath_build_thread(void *arg)
+{
+  twopath_build_thread_t *t = (twopath_build_thread_t *)arg;
+  const digraph_t *g = t->g;
+  uint_t a, v, b, k, l, nt;
+
+  for (a = t->first_row; a < g->num_nodes; a += t->step) {
+    /* mix two-paths a -> v -> b */
+    if (TWOPATH_KEPT(g, TWOPATH_TABLE_MIX)) {
+      nt = 0;
+      for (k = 0; k < g->outdegree[a]; k++) {
+        v = g->arclist[a][k];
+        if (v == a || TWOPATH_HUB(g, v))
+          continue;
+        for (l = 0; l < g->outdegree[v]; l++) {
+          b = g->arclist[v][l];
+          if (b == v || b == a)
+            continue;
+          if (t->count[b]++ == 0)
+            t->touched[nt++] = b;
+        }
+      }
+      twopath_row_flush(t, TWOPATH_MIX, a, nt);
+    }
+    /* in-two-paths a -> v <- b */
+    if (TWOPATH_KEPT(g, TWOPATH_TABLE_IN)) {
+      nt = 0;
+      for (k = 0; k < g->outdegree[a]; k++) {
+        v = g->arclist[a][k];
+        if (v == a || TWOPATH_HUB(g, v))
+          continue;
+        for (l = 0; l < g->indegree[v]; l++) {
+          b = g->revarclist[v][l];
+          if (b == v || b == a || (b < a && !t->perNode))
+            continue;
+          if (t->count[b]++ == 0)
+            t->touched[nt++] = b;
+        }
+      }
+      twopath_row_flush(t, TWOPATH_IN, a, nt);
+    }
+    /* out-two-paths a <- v -> b */
+    if (TWOPATH_KEPT(g, TWOPATH_TABLE_OUT)) {
+      nt = 0;
+      for (k = 0; k < g->indegree[a]; k++) {
+        v = g->revarclist[a][k];
+        if (v == a || TWOPATH_HUB(g, v))
+          continue;
+        for (l = 0; l < g->outdegree[v]; l++) {
+          b = g->arclist[v][l];
+          if (b == v || b == a || (b < a && !t->perNode))
+            continue;
+          if (t->count[b]++ == 0)
+            t->touched[nt++] = b;
+        }
+      }
+      twopath_row_flush(t, TWOPATH_OUT, a, nt);
+    }
+  }
+  return NULL;
+}
+
+/*
+ * Build the two-path tables (for the backend selected in g, and only
+ * those kept, if TWOPATH_ADAPTIVE) from scratch from the arcs currently
+ * in g. The tables must be empty (all zero).
+ *
+ * Rather than adding each two-path one at a time, the counts of each
+ * row of the tables (all the two-paths from one node) are accumulated
+ * in a dense array and then each written once, and the rows are
+ * divided between g->build_threads threads. The counts are the same
+ * as from incrementally updating the tables one arc at a time with
+ * updateTwoPathsMatrices().
+ *
+ * Parameters:
+ *   g - digraph
+ *
+ * Return value:
+ *   None.
+ */
+static void buildTwoPathTables(digraph_t *g)
+{
+  uint_t                  num_threads = MAX(1, MIN(g->build_threads,
+                                                   g->num_nodes));
+  twopath_build_thread_t *args;
+  pthread_t              *threads;
+  pthread_mutex_t         mutex;
+  bool                   *started;
+  bool                    useArrays, perNode = FALSE;
+  uint_t                  k;
+
+#ifdef TWOPATH_ADAPTIVE
+  assert(g->twopath_backend != TWOPATH_BACKEND_NONE);
+  useArrays = (g->twopath_backend == TWOPATH_BACKEND_ARRAYS);
+  perNode = (g->twopath_backend == TWOPATH_BACKEND_PERNODE);
+#elif defined(TWOPATH_WITH_ARRAYS)
+  useArrays = TRUE;
+#else
+  useArrays = FALSE;
+#endif /* TWOPATH_ADAPTIVE */
+
+  args = (twopath_build_thread_t *)safe_calloc(num_threads,
+                                               sizeof(twopath_build_thread_t));
+  threads = (pthread_t *)safe_malloc(num_threads * sizeof(pthread_t));
+  started = (bool *)safe_calloc(num_threads, sizeof(bool));
+  pthread_mutex_init(&mutex, NULL);
+  for (k = 0; k < num_threads; k++) {
+    args[k].g = g;
+    args[k].useArrays = useArrays;
+    args[k].perNode = perNode;
+    args[k].first_row = k;
+    args[k].step = num_threads;
+    args[k].count = (uint_t *)safe_calloc(g->num_nodes, sizeof(uint_t));
+    args[k].touched = (uint_t *)safe_malloc(g->num_nodes * sizeof(uint_t));
+    args[k].mutex = num_threads > 1 ? &mutex : NULL;
+  }
+  for (k = 1; k < num_threads; k++) {
+    if (pthread_create(&threads[k], NULL, twopath_build_thread, &args[k]) == 0)
+      started[k] = TRUE;
+    else
+      fprintf(stderr, "WARNING: could not create two-path table thread, "
+              "running in main thread\n");
+  }
+  for (k = 0; k < num_threads; k++) {
+    if (!started[k])
+      twopath_build_thread(&args[k]);
+  }
+  for (k = 0; k < num_threads; k++) {
+    if (started[k])
+      pthread_join(threads[k], NULL);
+    free(args[k].count);
+    free(args[k].touched);
+  }
+  pthread_mutex_destroy(&mutex);
+  free(started);
+  free(threads);
+  free(args);
+#ifdef TWOPATH_ADAPTIVE
+  if (g->twopath_backend == TWOPATH_BACKEND_HYBRID)
+    buildTwoPathHubLists(g);
+#endif /* TWOPATH_ADAPTIVE */
+}
+#endif /* TWOPATH_LOOKUP || TWOPATH_ADAPTIVE */
+
+#ifdef TWOPATH_LOOKUP
+/*
+ * Reset the two-path tables of g to all zero (no two-paths), for use
+ * when the arcs are about to be reinserted.
+ * Not used for TWOPATH_ADAPTIVE, where set_twopath_backend() is used
+ * to drop and then rebuild the tables instead.
+ *
+ * Parameters:
+ *   g - digraph
+ *
+ * Return value:
+ *   None.
+ */
+static void resetTwoPathTables(digraph_t *g)
+{
+#ifdef TWOPATH_WITH_UTHASH
+  deleteAllHashTable(&g->mixTwoPathHashTab);
+  deleteAllHashTable(&g->inTwoPathHashTab);
+  deleteAllHashTable(&g->outTwoPathHashTab);
+  twopath_pool_free(&g->twopath_pool);
+#elif defined(TWOPATH_WITH_OAHASH)
+  deleteAllHashTable(&g->mixTwoPathHashTab);
+  deleteAllHashTable(&g->inTwoPathHashTab);
+  deleteAllHashTable(&g->outTwoPathHashTab);
+#else
+  freeTwoPathArrays(g);
+  allocateTwoPathArrays(g);
+#endif /* TWOPATH_WITH_UTHASH */
+}
+#endif /* TWOPATH_LOOKUP */
+
+/*
+ * Comparison function for qsort() of node_degree_t by degree
+ * descending, with ties in node number order so the result does not
+ * depend on the qsort() implementation.
+ *
+ * Parameters:
+ *   a, b - pointers to node_degree_t to compare
+ *
+ * Return value:
+ *   <0, 0, >0 if a should come before, is equal to, or after b
+ */
+static int compare_degree_descending(const void *a, const void *b)
+{
+  const node_degree_t *x = (const node_degree_t *)a;
+  const node_degree_t *y = (const node_degree_t *)b;
+
+  if (x->degree != y->degree)
+    return x->degree > y->degree ? -1 : 1;
+  return x->node < y->node ? -1 : (x->node > y->node ? 1 : 0);
+}
+
+/*
+ * Order the nodes of g by total (in plus out) degree, highest first,
+ * so the hubs, which are involved in most two-paths, are close
+ * together in the adjacency lists and two-path arrays.
+ *
+ * Parameters:
+ *   g     - digraph
+ *   oldid - (out) array of num_nodes nodes in their new order, i.e.
+ *           oldid[v] is the current number of the node to become v
+ *
+ * Return value:
+ *   None.
+ */
+static void degree_node_order(const digraph_t *g, uint_t *oldid)
+{
+  node_degree_t *nodes = (node_degree_t *)safe_malloc(g->num_nodes *
+                                                      sizeof(node_degree_t));
+  uint_t         v;
+
+  for (v = 0; v < g->num_nodes; v++) {
+    nodes[v].node = v;
+    nodes[v].degree = g->outdegree[v] + g->indegree[v];
+  }
+  qsort(nodes, g->num_nodes, sizeof(node_degree_t),
+        compare_degree_descending);
+  for (v = 0; v < g->num_nodes; v++)
+    oldid[v] = nodes[v].node;
+  free(nodes);
+}
+
+/*
+ * Order the nodes of g by the reverse Cuthill-McKee algorithm on the
+ * underlying undirected graph: breadth-first search from a lowest
+ * degree node of each component, visiting neighbours in increasing
+ * degree order, then reversing the order. This numbers neighbours
+ * close together, giving good locality in the adjacency lists and
+ * two-path arrays.
+ *
+ * Parameters:
+ *   g     - digraph
+ *   oldid - (out) array of num_nodes nodes in their new order, i.e.
+ *           oldid[v] is the current number of the node to become v
+ *
+ * Return value:
+ *   None.
+ */
+static void rcm_node_order(const digraph_t *g, uint_t *oldid)
+{
+  node_degree_t *nodes = (node_degree_t *)safe_malloc(g->num_nodes *
+                                                      sizeof(node_degree_t));
+  node_degree_t *nbrs;
+  bool          *visited = (bool *)safe_calloc(g->num_nodes, sizeof(bool));
+  uint_t         maxdegree = 0, head = 0, tail = 0;
+  uint_t         s, u, v, k, num_nbrs, tmp;
+
+  for (v = 0; v < g->num_nodes; v++) {
+    nodes[v].node = v;
+    nodes[v].degree = g->outdegree[v] + g->indegree[v];
+    maxdegree = MAX(maxdegree, nodes[v].degree);
+  }
+  nbrs = (node_degree_t *)safe_malloc((maxdegree + 1) * sizeof(node_degree_t));
+  /* start each component at a lowest degree node: these are the last
+     of the nodes sorted by degree descending */
+  qsort(nodes, g->num_nodes, sizeof(node_degree_t),
+        compare_degree_descending);
+  for (s = g->num_nodes; s-- > 0; ) {
+    if (visited[nodes[s].node])
+      continue;
+    visited[nodes[s].node] = TRUE;
+    oldid[tail++] = nodes[s].node;
+    while (head < tail) {
+      u = oldid[head++];
+      num_nbrs = 0;
+      for (k = 0; k < g->outdegree[u]; k++) {
+        v = g->arclist[u][k];
+        if (!visited[v]) {
+          visited[v] = TRUE;
+          nbrs[num_nbrs].node = v;
+          nbrs[num_nbrs++].degree = g->outdegree[v] + g->indegree[v];
+        }
+      }
+      for (k = 0; k < g->indegree[u]; k++) {
+        v = g->revarclist[u][k];
+        if (!visited[v]) {
+          visited[v] = TRUE;
+          nbrs[num_nbrs].node = v;
+          nbrs[num_nbrs++].degree = g->outdegree[v] + g->indegree[v];
+        }
+      }
+      /* sorted descending so add to queue from the end for ascending */
+      qsort(nbrs, num_nbrs, sizeof(node_degree_t), compare_degree_descending);
+      for (k = num_nbrs; k-- > 0; )
+        oldid[tail++] = nbrs[k].node;
+    }
+  }
+  assert(tail == g->num_nodes);
+  for (k = 0; k < g->num_nodes / 2; k++) {
+    tmp = oldid[k];
+    oldid[k] = oldid[g->num_nodes - 1 - k];
+    oldid[g->num_nodes - 1 - k] = tmp;
+  }
+  free(visited);
+  free(nbrs);
+  free(nodes);
+}
+
+/*
+ * Order the nodes of g by snowball sampling zone (wave), keeping their
+ * current order within each zone. For conditional estimation this puts
+ * the inner wave nodes, which are the only ones whose arcs change,
+ * together at the start (so the inner_nodes array becomes 0, 1, ...,
+ * num_inner_nodes-1), and the fixed outermost wave, which the change
+ * statistics only read, after them, so the sampler works on a compact
+ * part of the adjacency lists, two-path tables and attributes.
+ *
+ * Parameters:
+ *   g     - digraph with zones
+ *   oldid - (out) array of num_nodes nodes in their new order, i.e.
+ *           oldid[v] is the current number of the node to become v
+ *
+ * Return value:
+ *   None.
+ */
+static void zone_node_order(const digraph_t *g, uint_t *oldid)
+{
+  uint_t *zone_start = (uint_t *)safe_calloc((size_t)g->max_zone + 2,
+                                             sizeof(uint_t));
+  uint_t  v, z;
+
+  for (v = 0; v < g->num_nodes; v++)
+    zone_start[g->zone[v] + 1]++;
+  for (z = 0; z <= g->max_zone; z++)
+    zone_start[z + 1] += zone_start[z];
+  for (v = 0; v < g->num_nodes; v++)
+    oldid[zone_start[g->zone[v]]++] = v;
+  free(zone_start);
+}
+
+/*
+ * Find whether an attribute column is one of those to keep (see
+ * set_attribute_columns()).
+ *
+ * Parameters:
+ *   num_columns - number of names in columns
+ *   columns     - names of the columns to keep, or NULL for all
+ *   name        - name of the column
+ *
+ * Return value:
+ *   TRUE if the column is kept else FALSE.
+ */
+static bool attr_column_kept(uint_t num_columns, char *const columns[],
+                             const char *name)
+{
+  uint_t u;
+
+  if (!columns)
+    return TRUE;
+  for (u = 0; u < num_columns; u++)
+    if (strcasecmp(columns[u], name) == 0)
+      return TRUE;
+  return FALSE;
+}
+
+/*
+ * Get the node that a line of an attributes file is for, for a network
+ * loaded from an edge list file, where each line starts with the
+ * original id of its node rather than the lines being in node order.
+ *
+ * Parameters:
+ *   node_ids - node id map of the network
+ *   token    - first token on the line (node id), or NULL if none
+ *   seen     - (in/out) for each node, TRUE once its line has been read
+ *              (set atomically, so may be shared between threads)
+ *   num_seen - (in/out) number of nodes whose line has been read
+ *   filename - name of attributes file, for error messages
+ *   nodenum  - (Out) node number, or number of nodes if the id is not
+ *              a node of the network (so the line is ignored)
+ *
+ * Return value:
+ *   0 if OK else -1 on error (message printed to stderr).
+ */
+static int attr_line_node(const nodeidmap_t *node_ids, const char *token,
+                          bool *seen, uint_t *num_seen, const char *filename,
+                          uint_t *nodenum)
+{
+  unsigned long long id;
+  char  *endptr;
+  uint_t v;
+
+  if (!token) {
+    fprintf(stderr, "ERROR: missing node id in attributes file %s\n",
+            filename);
+    return -1;
+  }
+  errno = 0;
+  id = strtoull(token, &endptr, 10);
+  if (!isdigit((unsigned char)token[0]) || *endptr != '\0' || errno) {
+    fprintf(stderr, "ERROR: bad node id '%s' in attributes file %s\n",
+            token, filename);
+    return -1;
+  }
+  if ((v = nodeidmap_get(node_ids, (uint64_t)id)) == NODEIDMAP_NONE) {
+    *nodenum = node_ids->num_nodes;
+    return 0;
+  }
+  if (__atomic_exchange_n(&seen[v], TRUE, __ATOMIC_RELAXED)) {
+    fprintf(stderr, "ERROR: node id %s is on more than one line in "
+            "attributes file %s\n", token, filename);
+    return -1;
+  }
+  (*num_seen)++;
+  *nodenum = v;
+  return 0;
+}
+
+/*
+ * Copy the next whitespace delimited token on a line of a column
+ * attributes file (see load_column_attributes()) into a buffer as a
+ * NUL terminated string.
+ *
+ * Parameters:
+ *   p     - position in line
+ *   eol   - end of line (its newline, or end of file)
+ *   token - (out) buffer of ATTR_TOKEN_MAX chars for the token
+ *   len   - (out) length of the token, which is truncated in the
+ *           buffer if this is ATTR_TOKEN_MAX or more
+ *
+ * Return value:
+ *   Position after the token, or NULL if there are no more tokens on
+ *   the line.
+ */
+static const char *attr_token(const char *p, const char *eol, char *token,
+                              size_t *len)
+{
+  const char *q;
+
+  while (p < eol && (*p == ' ' || *p == '\t' || *p == '\r'))
+    p++;
+  if (p == eol)
+    return NULL;
+  for (q = p; q < eol && *q != ' ' && *q != '\t' && *q != '\r'; q++)
+    /*nothing*/;
+  *len = (size_t)(q - p);
+  memcpy(token, p, MIN(*len, ATTR_TOKEN_MAX - 1));
+  token[MIN(*len, ATTR_TOKEN_MAX - 1)] = '\0';
+  return q;
+}
+
+/*
+ * Skip the next whitespace delimited token on a line of a column
+ * attributes file, without copying it (for a column not kept).
+ *
+ * Parameters:
+ *   p     - position in line
+ *   eol   - end of line (its newline, or end of file)
+ *
+ * Return value:
+ *   Position after the token, or NULL if there are no more tokens on
+ *   the line.
+ */
+static const char *attr_skip_token(const char *p, const char *eol)
+{
+  while (p < eol && (*p == ' ' || *p == '\t' || *p == '\r'))
+    p++;
+  if (p == eol)
+    return NULL;
+  while (p < eol && *p != ' ' && *p != '\t' && *p != '\r')
+    p++;
+  return p;
+}
+
+/*
+ * Parse the lines of one chunk of a column attributes file (see
+ * load_column_attributes()) into the value arrays. This is the start
+ * routine of the threads of load_column_attributes().
+ *
+ * Parameters:
+ *   arg - attr_chunk_t for the chunk, whose status is set to -1 at the
+ *         first line with an error (message printed to stderr) else 0
+ *
+ * Return value:
+ *   NULL
+ */
+static void *parse_attr_chunk(void *arg)
+{
+  attr_chunk_t *c = (attr_chunk_t *)arg;
+  const char   *p, *eol;
+  char          token[ATTR_TOKEN_MAX];
+  char         *endptr;
+  size_t        len;
+  uint_t        row, nodenum, k;
+  int           ival, a;
+  double        dval;
+
+  c->status = 0;
+  c->num_seen = 0;
+  for (row = c->first_row, p = c->start; p < c->end; row++, p = eol + 1) {
+    if (!(eol = memchr(p, '\n', (size_t)(c->end - p))))
+      eol = c->end;
+    nodenum = row;
+    if (c->node_ids) {
+      p = attr_token(p, eol, token, &len);
+      if (attr_line_node(c->node_ids, p ? token : NULL, c->seen,
+                         &c->num_seen, c->filename, &nodenum)) {
+        c->status = -1;
+        return NULL;
+      }
+    }
+    for (k = 0; ; k++) {
+      a = k < c->num_columns ? c->column_attr[k] : -1;
+      if (a < 0 && k < c->num_columns) {
+        /* column not kept: not parsed */
+        if (!(p = attr_skip_token(p, eol)))
+          break;
+        continue;
+      }
+      if (!(p = attr_token(p, eol, token, &len)))
+        break;
+      if (len >= ATTR_TOKEN_MAX) {
+        fprintf(stderr, "ERROR: value '%s...' too long for node %u in "
+                "attributes file %s\n", token, nodenum, c->filename);
+        c->status = -1;
+        return NULL;
+      }
+      if (c->kind == ATTR_KIND_CONTINUOUS) {
+        if (strcasecmp(token, NA_STRING) == 0) {
+          dval = NAN; /* NA value for continuous is floating point NaN */
+        } else {
+          dval = strtod(token, &endptr);
+          if (*endptr != '\0') {
+            fprintf(stderr, "ERROR: bad floating point value '%s' for node %u\n", token, nodenum);
+            c->status = -1;
+            return NULL;
+          }
+        }
+        if (a >= 0 && nodenum < c->num_nodes)
+          c->dvalues[a][nodenum] = dval;
+      } else {
+        if (strcasecmp(token, NA_STRING) == 0) {
+          ival = c->kind == ATTR_KIND_BINARY ? BIN_NA : CAT_NA;
+        } else {
+          /* same values accepted as sscanf() %u */
+          ival = (int)strtoul(token, &endptr, 10);
+          if (endptr == token) {
+            fprintf(stderr, "ERROR: bad value '%s' for node %u\n", token, nodenum);
+            c->status = -1;
+            return NULL;
+          }
+          if (c->kind == ATTR_KIND_BINARY && (ival != 0 && ival != 1)) {
+            fprintf(stderr, "ERROR: bad value %d for binary attribute %s on node %u in attributes file %s\n",
+                    ival, a >= 0 ? c->attr_names[a] : "UNKNOWN",
+                    nodenum, c->filename);
+            c->status = -1;
+            return NULL;
+          } else if (c->kind == ATTR_KIND_CATEGORICAL && ival < 0) {
+            fprintf(stderr, "ERROR: bad value %d for categorical attribute %s on node %u in attributes file %s\n",
+                    ival, a >= 0 ? c->attr_names[a] : "UNKNOWN",
+                    nodenum, c->filename);
+            c->status = -1;
+            return NULL;
+          }
+        }
+        if (a >= 0 && nodenum < c->num_nodes)
+          c->ivalues[a][nodenum] = ival;
+      }
+    }
+    if (k != c->num_columns) {
+      fprintf(stderr, "ERROR: %u values for node %u but expected %u in file %s\n",
+              k, nodenum, c->num_columns, c->filename);
+      c->status = -1;
+      return NULL;
+    }
+  }
+  return NULL;
+}
+
+/*
+ * Load binary, categorical or continuous attributes from file.
+ * The format of the file is a header line with whitespace
+ * delimited attribute names, and each subsequent line
+ * the attribute values for each attribute.
+ * The first line (after the header) has the values for
+ * node 0, then the next line node 1, and so on.
+ * 
+ * E.g.:
+ *
+ * gender class
+ * 0      1
+ * 1      2
+ * 1      3
+ *
+ *
+ * Valid values are 0 or 1 for binary, integer >= 0 for categorical,
+ * or standard C library floating point format for continuous, or
+ * NA (case insensitve) for missing data (note for continuous this is
+ * converted to IEEE floating point NaN value, so nan entered here will
+ * also be treated as missing data).
+ *
+ * The file is read into memory (see map_input_file()) and the lines
+ * after the header are divided into chunks (at line boundaries) that
+ * are parsed in parallel by up to num_threads threads. Only the
+ * columns named in columns (if given) are parsed and stored; the
+ * values of the others are skipped over.
+ *
+ * Parameters:
+ *   attr_filenname - filename of file to read
+ *   num_nodes - number of nodes (must be this many values)
+ *   node_ids  - node id map if the network was loaded from an edge list
+ *               file, else NULL. Then the first column of the file
+ *               is the original id of the node (the first name in the
+ *               header is for it), the lines can be in any order, and
+ *               those for ids not in the network are ignored.
+ *   kind      - type of values (binary, categorical or continuous)
+ *   num_threads - number of threads to parse the file with
+ *   num_columns - number of names in columns
+ *   columns   - names of the columns to keep (see
+ *               set_attribute_columns()), or NULL for all
+ *   out_attr_names - (Out) attribute names array (of those kept)
+ *   out_int_values - (Out) for binary or categorical,
+ *                    (*out_int_values)[u][i] is value of attr u for
+ *                    node i (BIN_NA or CAT_NA for missing data),
+ *                    else not used (may be NULL)
+ *   out_double_values - (Out) for continuous,
+ *                    (*out_double_values)[u][i] is value of attr u
+ *                    for node i, else not used (may be NULL)
+ * 
+ * Return value:
+ *   Number of attributes (kept), or -1 on error.
+ *
+ * The attribute names and values arrays are allocated by 
+ * this function.
+ */
+static int load_column_attributes(const char *attr_filename,
+                                  uint_t num_nodes,
+                                  const nodeidmap_t *node_ids,
+                                  attr_kind_e kind,
+                                  uint_t num_threads,
+                                  uint_t num_columns,
+                                  char *const columns[],
+                                  char ***out_attr_names,
+                                  int  ***out_int_values,
+                                  double ***out_double_values)
+{
+  const char *delims    = " \t\r\n"; /* strtok_r() delimiters  */
+  uint_t num_attributes = 0;   /* number of different attributes kept */
+  uint_t num_file_columns = 0; /* number of values on each line */
+  uint_t num_rows       = 0;   /* number of lines after header */
+  char  **attr_names   = NULL; /* array of attribute names */
+  int    *column_attr  = NULL; /* attribute of each column, -1 if skipped */
+  int   **ivalues      = NULL; /* ivalues[u][i] is int value of attr u for node i */
+  double **dvalues     = NULL; /* dvalues[u][i] is double value of attr u for node i */
+  char *saveptr        = NULL; /* for strtok_r() */
+  char *token          = NULL; /* from strtok_r() */
+  bool *seen          = NULL;  /* with node_ids, nodes with a line read */
+  uint_t num_seen      = 0;     /* with node_ids, number of nodes seen */
+  char         *text, *header;
+  const char   *data, *end, *p, *q;
+  size_t        size;
+  bool          compressed;
+  attr_chunk_t *chunks;
+  pthread_t    *threads;
+  bool         *started;
+  int           status = 0;
+  uint_t        i, k;
+
+  if (!(text = map_input_file(attr_filename, &size, &compressed)))
+    return -1;
+  if (size == 0) {
+    fprintf(stderr, "ERROR: could not read header line in attributes file %s\n",
+            attr_filename);
+    unmap_input_file(text, size, compressed);
+    return -1;
+  }
+  end = text + size;
+  if (!(p = memchr(text, '\n', size)))
+    p = end;
+  header = (char *)safe_malloc((size_t)(p - text) + 1);
+  memcpy(header, text, (size_t)(p - text));
+  header[p - text] = '\0';
+  data = p < end ? p + 1 : end;
+  token = strtok_r(header, delims, &saveptr);
+  if (node_ids && token)
+    token = strtok_r(NULL, delims, &saveptr); /* node id column name */
+  while(token) {
+    column_attr = (int *)safe_realloc(column_attr, (num_file_columns + 1) *
+                                      sizeof(int));
+    if (attr_column_kept(num_columns, columns, token)) {
+      attr_names = (char **)safe_realloc(attr_names, 
+                                         (num_attributes + 1) *
+                                         sizeof(char *));
+      column_attr[num_file_columns++] = (int)num_attributes;
+      attr_names[num_attributes++] = safe_strdup(token);
+    } else {
+      column_attr[num_file_columns++] = -1;
+    }
+    token = strtok_r(NULL, delims, &saveptr);
+  }
+  free(header);
+
+  /* divide the lines into chunks, counting the lines before each */
+  num_threads = MAX(1, MIN(num_threads,
+                           1 + (size_t)(end - data) / ATTR_MIN_CHUNK));
+  chunks = (attr_chunk_t *)safe_calloc(num_threads, sizeof(attr_chunk_t));
+  for (k = 0, p = data; k < num_threads; k++) {
+    if (k == num_threads - 1) {
+      q = end;
+    } else {
+      q = MAX(p, data + (size_t)(end - data) / num_threads * (k + 1));
+      q = (q = memchr(q, '\n', (size_t)(end - q))) ? q + 1 : end;
+    }
+    chunks[k].start = p;
+    chunks[k].end = q;
+    chunks[k].first_row = num_rows;
+    for (; p < q && (p = memchr(p, '\n', (size_t)(q - p))) != NULL; p++)
+      num_rows++;
+    if (q == end && q > chunks[k].start && end[-1] != '\n')
+      num_rows++; /* last line has no newline */
+    p = q;
+  }
+  if (!node_ids && num_rows != num_nodes) {
+    fprintf(stderr, "ERROR: %u rows after header but expected %u in file %s\n",
+            num_rows, num_nodes, attr_filename);
+    status = -1;
+  }
+
+  /* Now that we know how many attributes there are, allocate space for values */
+  if (kind == ATTR_KIND_CONTINUOUS) {
+    dvalues = (double **)safe_malloc(num_attributes * sizeof(double *));
+    for (i = 0; i < num_attributes; i++)
+      dvalues[i] = (double *)safe_malloc(num_nodes * sizeof(double));
+  } else {
+    ivalues = (int **)safe_malloc(num_attributes * sizeof(int *));
+    for (i = 0; i < num_attributes; i++)
+      ivalues[i] = (int *)safe_malloc(num_nodes * sizeof(int));
+  }
+  if (node_ids)
+    seen = (bool *)safe_calloc(num_nodes, sizeof(bool));
+
+  threads = (pthread_t *)safe_malloc(num_threads * sizeof(pthread_t));
+  started = (bool *)safe_calloc(num_threads, sizeof(bool));
+  for (k = 0; k < num_threads; k++) {
+    chunks[k].kind = kind;
+    chunks[k].num_nodes = num_nodes;
+    chunks[k].num_columns = num_file_columns;
+    chunks[k].column_attr = column_attr;
+    chunks[k].attr_names = attr_names;
+    chunks[k].node_ids = node_ids;
+    chunks[k].seen = seen;
+    chunks[k].filename = attr_filename;
+    chunks[k].ivalues = ivalues;
+    chunks[k].dvalues = dvalues;
+  }
+  for (k = 1; status == 0 && k < num_threads; k++) {
+    if (pthread_create(&threads[k], NULL, parse_attr_chunk, &chunks[k]) == 0)
+      started[k] = TRUE;
+    else
+      fprintf(stderr, "WARNING: could not create attributes file thread, "
+              "running in main thread\n");
+  }
+  for (k = 0; status == 0 && k < num_threads; k++) {
+    if (!started[k])
+      parse_attr_chunk(&chunks[k]);
+  }
+  for (k = 0; k < num_threads; k++) {
+    if (started[k])
+      pthread_join(threads[k], NULL);
+    if (chunks[k].status)
+      status = -1;
+    num_seen += chunks[k].num_seen;
+  }
+  if (status == 0 && node_ids && num_seen != num_nodes) {
+    fprintf(stderr, "ERROR: %u of %u node ids in network found in file %s\n",
+            num_seen, num_nodes, attr_filename);
+    status = -1;
+  }
+  free(started);
+  free(threads);
+  free(chunks);
+  free(seen);
+  free(column_attr);
+  unmap_input_file(text, size, compressed);
+
+  if (status != 0) {
+    for (i = 0; i < num_attributes; i++) {
+      free(attr_names[i]);
+      if (ivalues)
+        free(ivalues[i]);
+      if (dvalues)
+        free(dvalues[i]);
+    }
+    free(attr_names);
+    free(ivalues);
+    free(dvalues);
+    return -1;
+  }
+  *out_attr_names = attr_names;
+  if (out_int_values)
+    *out_int_values = ivalues;
+  if (out_double_values)
+    *out_double_values = dvalues;
+  return num_attributes;
+}
+
+
+/*
+ * Load set (of categorical) attributes from file.
+ * The format of the file is a header line with whitespace
+ * delimited attribute names, and each subsequent line
+ * the attribute values for each attribute.
+ * The format of the attribute values (set of categories) is a comma
+ * delimited (note must have no whitespace as different attributes
+ * are delimited by whitespace) list of integers making up the set of
+ * categories.
+ * The first line (after the header) has the values for
+ * node 0, then the next line node 1, and so on.
+ * 
+ * E.g.:
+ *
+ * type   class
+ * 0,9    1
+ * 3,1    2,3,4,5,6
+ * 2      3,10,98
+ * none   0
+ *
+ *
+ * Valid values are integer >= 0 for each of the comma-delimited categories,
+ * or a single NONE (case insensitive) for empty set, 
+ * or a single NA (case insensitve) for missing data.
+ *
+ * The highest value of any integer for an attribute gives the size of
+ * the set for that attribute. The values do not need to be contiguous,
+ * and the set is stored as an array of set_elem_e for maximum flexibility,
+ * so e.g. for 'type' in the example above the set is an array of size
+ * 10 indexed 0..9 as 9 is the highest value, and for 'class' an array
+ * of size 99 indexed 0..98 as 98 is the highest value.
+ * Each set is also stored packed as a fixed size bit set of present
+ * elements (with NA recorded in a separate bit set over nodes), which
+ * is what the change statistics use.
+ * 
+ * Note that NONE results simply in all elements of the set being
+ * absent with the normal semantics of the set, however NA results in
+ * all elements of the set (array) being set to SET_ELEM_NA meaning there is
+ * really a single NA for that set attribute on that node, there is
+ * no individual meaning of SET_ELEM_NA at a particular index in the array.
+ *
+ *
+ * Parameters:
+ *   attr_filenname - filename of file to read
+ *   num_nodes - number of nodes (must be this many values)
+ *   node_ids  - node id map if the network was loaded from an edge list
+ *               file, else NULL. Then the first column of the file
+ *               is the original id of the node (the first name in the
+ *               header is for it), the lines can be in any order, and
+ *               those for ids not in the network are ignored.
+ *   num_columns - number of names in columns
+ *   columns   - names of the columns to keep (see
+ *               set_attribute_columns()), or NULL for all; the values
+ *               of the others are not parsed
+ *   out_attr_names - (Out) attribute names array (of those kept)
+ *   out_attr_values - (Out) (*attr_values)[u][i] is value of attr u for node i
+ *   out_set_sizes   - (Out) size of set for each attribute
+ *   out_attr_bits   - (Out) (*attr_bits)[u][i] is packed bitset of
+ *                     present elements of attr u for node i
+ *   out_attr_na     - (Out) (*attr_na)[u] is bitset over nodes of
+ *                     NA values of attr u
+ * 
+ * Return value:
+ *   Number of attributes (kept), or -1 on error.
+ *
+ * The attribute names, values, and bitset arrays are allocated by 
+ * this function.
+ */
+static int load_set_attributes(const char   *attr_filename,
+                               uint_t        num_nodes,
+                               const nodeidmap_t *node_ids,
+                               uint_t        num_columns,
+                               char *const   columns[],
+                               char        ***out_attr_names,
+                               set_elem_e ****out_attr_values,
+                               uint_t       **out_set_sizes,
+                               uint64_t   ****out_attr_bits,
+                               uint64_t    ***out_attr_na)
+{
+  const char *delims    = " \t\r\n"; /* strtok_r() delimiters  */
+  uint_t nodenum        = 0;   /* node number values are for */
+  uint_t num_attributes = 0;   /* number of different attributes kept */
+  uint_t num_file_columns = 0; /* number of values on each line */
+  uint_t thisline_values= 0;   /* number values read this line */
+  char  **attr_names   = NULL; /* array of attribute names */
+  int    *column_attr  = NULL; /* attribute of each column, -1 if skipped */
+  set_elem_e ***attr_values = NULL; /* attr_values[u][i] is value of attr u for node i */
+  uint64_t   ***attr_bits  = NULL; /* attr_bits[u][i] is packed attr_values[u][i] */
+  uint64_t    **attr_na    = NULL; /* attr_na[u] bitset of nodes with u NA */
+  char *saveptr        = NULL; /* for strtok_r() */
+  char *token          = NULL; /* from strtok_r() */
+  uint_t  *setsizes    = NULL; /* max integer in set for each attribute */
+  FILE *attr_file;
+  char buf[BUFSIZE];
+  bool *seen          = NULL;  /* with node_ids, nodes with a line read */
+  uint_t num_seen      = 0;     /* with node_ids, number of nodes seen */
+  uint_t  i;
+  set_elem_e   *setval = NULL;
+  int     pass, a;
+  bool    firstpass;
+
+  if (!(attr_file = open_input_file(attr_filename))) {
+    fprintf(stderr, "ERROR: could not open set attribute file %s (%s)\n",
+            attr_filename, strerror(errno));
+    return -1;
+  }
+  if (!fgets(buf, sizeof(buf)-1, attr_file)) {
+    fprintf(stderr, "ERROR: could not read header line in set attributes file %s (%s)\n",
+            attr_filename, strerror(errno));
+    return -1;
+  }
+  token = strtok_r(buf, delims, &saveptr);
+  if (node_ids && token)
+    token = strtok_r(NULL, delims, &saveptr); /* node id column name */
+  while(token) {
+    column_attr = (int *)safe_realloc(column_attr, (num_file_columns + 1) *
+                                      sizeof(int));
+    if (attr_column_kept(num_columns, columns, token)) {
+      attr_names = (char **)safe_realloc(attr_names, 
+                                         (num_attributes + 1) *
+                                         sizeof(char *));
+      column_attr[num_file_columns++] = (int)num_attributes;
+      attr_names[num_attributes++] = safe_strdup(token);
+    } else {
+      column_attr[num_file_columns++] = -1;
+    }
+    token = strtok_r(NULL, delims, &saveptr);
+  }
+  saveptr = NULL; /* reset strtok() for next line */
+
+  if (node_ids)
+    seen = (bool *)safe_calloc(num_nodes, sizeof(bool));
+
+  /* Now that we know how many attributes there are, allocate space for values */
+  setsizes = (uint_t *)safe_calloc((size_t)num_attributes, sizeof(uint_t));
+  attr_values = (set_elem_e ***)safe_malloc(num_attributes * sizeof(set_elem_e **));
+  for (i = 0; i < num_attributes; i++)
+    attr_values[i] = (set_elem_e **)safe_malloc(num_nodes * sizeof(set_elem_e *));
+  attr_bits = (uint64_t ***)safe_malloc(num_attributes * sizeof(uint64_t **));
+  attr_na = (uint64_t **)safe_malloc(num_attributes * sizeof(uint64_t *));
+  for (i = 0; i < num_attributes; i++) {
+    attr_bits[i] = (uint64_t **)safe_malloc(num_nodes * sizeof(uint64_t *));
+    attr_na[i] = (uint64_t *)safe_calloc(SETATTR_WORDS(num_nodes),
+                                         sizeof(uint64_t));
+  }
+
+  for (pass = 0; pass < 2; pass++) {
+    /* on first pass, get max int in set for each attribute so can allocate
+       arrays, actually build them on second pass */
+    firstpass = (pass == 0);
+    if (!firstpass) {
+      /* on second pass have to reopen file and skip over header line */
+      if (!(attr_file = open_input_file(attr_filename))) {
+        fprintf(stderr, "ERROR: could not open set attribute file %s (%s)\n",
+            attr_filename, strerror(errno));
+        return -1;
+      }
+      if (!fgets(buf, sizeof(buf)-1, attr_file)) {
+        fprintf(stderr, "ERROR: could not read header line in set attributes file %s (%s)\n",
+                attr_filename, strerror(errno));
+        return -1;
+      }
+      DIGRAPH_DEBUG_PRINT(("load_set_attributes pass %d reopen %s at '%s'\n",
+                           pass, attr_filename, buf));
+    }
+    if (!fgets(buf, sizeof(buf)-1, attr_file)) {
+      fprintf(stderr, "ERROR: could not read first values line in set attributes file %s (%s)\n",
+              attr_filename, strerror(errno));
+      return -1;
+    }
+    nodenum = 0;
+    if (node_ids) {
+      memset(seen, 0, num_nodes * sizeof(bool));
+      num_seen = 0;
+    }
+    saveptr = NULL; /* reset strtok() for next line */
+    while (!feof(attr_file)) {
+      thisline_values = 0;
+      token = strtok_r(buf, delims, &saveptr);
+      if (node_ids) {
+        if (attr_line_node(node_ids, token, seen, &num_seen, attr_filename,
+                           &nodenum))
+          return -1;
+        token = strtok_r(NULL, delims, &saveptr);
+      }
+      while(token) {
+        DIGRAPH_DEBUG_PRINT(("load_set_attributes pass %u token '%s'\n",
+                             pass, token));
+        /* values of columns not kept (or extra values) are not parsed */
+        a = thisline_values < num_file_columns ?
+          column_attr[thisline_values] : -1;
+        if (a >= 0) {
+          if (!firstpass) {
+            setval = (set_elem_e *)safe_malloc(setsizes[a] *
+                                               sizeof(set_elem_e));
+          }
+          if (parse_category_set(token, firstpass, &setsizes[a],
+                                 setval) < 0) {
+            fprintf(stderr, "ERROR: bad set value '%s' for node %u\n", token,
+                    nodenum);
+            return -1;
+          }
+          if (!firstpass) {
+            if (nodenum < num_nodes) {
+              attr_values[a][nodenum] = setval;
+              attr_bits[a][nodenum] = set_to_bitset(setval, setsizes[a]);
+              /* for NA all elements of set are NA so just check first */
+              if (setsizes[a] > 0 && setval[0] == SET_ELEM_NA)
+                attr_na[a][nodenum >> 6] |= (uint64_t)1 << (nodenum & 63);
+            } else {
+              free(setval); /* id not in network */
+            }
+          }
+        }
+        thisline_values++;
+        token = strtok_r(NULL, delims, &saveptr);
+      }
+      if (thisline_values != num_file_columns) {
+        fprintf(stderr, "ERROR: %u set values for node %u but expected %u in file %s\n",
+                thisline_values, nodenum, num_file_columns, attr_filename);
+        return -1;
+      }
+      if (!fgets(buf, sizeof(buf)-1, attr_file)) {
+        if (!feof(attr_file)) {
+          fprintf(stderr, "ERROR: attempting to read set attributes in file %s (%s)\n",
+                  attr_filename, strerror(errno));
+          return -1;
+        }
+      }
+      nodenum++;
+      saveptr = NULL; /* reset strtok() for next line */
+    }
+    if (node_ids && num_seen != num_nodes) {
+      fprintf(stderr, "ERROR: %u of %u node ids in network found in file %s\n",
+              num_seen, num_nodes, attr_filename);
+      return -1;
+    }
+    if (!node_ids && nodenum != num_nodes) {
+      fprintf(stderr, "ERROR: %u rows after header but expected %u in file %s\n",
+              nodenum, num_nodes, attr_filename);
+      return -1;
+    }
+    close_input_file(attr_file);
+  }
+  free(seen);
+  free(column_attr);
+  *out_attr_names = attr_names;
+  *out_attr_values = attr_values;
+  *out_set_sizes = setsizes;
+  *out_attr_bits = attr_bits;
+  *out_attr_na = attr_na;
+  return num_attributes;
+}
+
+/*
+ * Comparison function for qsort() and bsearch() of (categorical
+ * attribute) integer values into ascending order.
+ *
+ * Parameters:
+ *   a, b - pointers to int values to compare
+ *
+ * Return value:
+ *   <0, 0, >0 if a is less than, equal to, or greater than b
+ */
+static int compare_int(const void *a, const void *b)
+{
+  int x = *(const int *)a, y = *(const int *)b;
+  return (x > y) - (x < y);
+}
+
+/*
+ * Set the code of categorical attribute u of node i in g, in the
+ * width of g->catattr[u].
+ *
+ * Parameters:
+ *   g    - (in/out) digraph object
+ *   u    - categorical attribute index
+ *   i    - node
+ *   code - code (see catattr in digraph_t)
+ *
+ * Return value:
+ *   None
+ */
+static void set_catattr_code(digraph_t *g, uint_t u, uint_t i, uint32_t code)
+{
+  switch (g->catattr_width[u]) {
+    case 1:
+      ((uint8_t *)g->catattr[u])[i] = (uint8_t)code;
+      break;
+    case 2:
+      ((uint16_t *)g->catattr[u])[i] = (uint16_t)code;
+      break;
+    default:
+      ((uint32_t *)g->catattr[u])[i] = code;
+      break;
+  }
+}
+
+/*
+ * Store the binary attribute values loaded from a file as the bit sets
+ * of binary attribute u in g.
+ *
+ * Parameters:
+ *   g      - (in/out) digraph object
+ *   u      - binary attribute index
+ *   values - values[i] is 0, 1 or BIN_NA for node i
+ *
+ * Return value:
+ *   None
+ */
+static void pack_binattr(digraph_t *g, uint_t u, const int *values)
+{
+  size_t words = SETATTR_WORDS(g->num_nodes);
+  uint_t i;
+
+  g->binattr[u] = (uint64_t *)safe_calloc(words, sizeof(uint64_t));
+  g->binattr_na[u] = (uint64_t *)safe_calloc(words, sizeof(uint64_t));
+  for (i = 0; i < g->num_nodes; i++) {
+    if (values[i] == BIN_NA)
+      g->binattr_na[u][i >> 6] |= (uint64_t)1 << (i & 63);
+    else if (values[i])
+      g->binattr[u][i >> 6] |= (uint64_t)1 << (i & 63);
+  }
+}
+
+/*
+ * Store the categorical attribute values loaded from a file as the
+ * codes of categorical attribute u in g: the distinct values are
+ * numbered from 1 in ascending order, in the fewest bytes (1, 2 or 4)
+ * that hold the largest code. The change statistics only compare
+ * values for equality, which the codes preserve.
+ *
+ * Parameters:
+ *   g      - (in/out) digraph object
+ *   u      - categorical attribute index
+ *   values - values[i] is integer >= 0 or CAT_NA for node i
+ *
+ * Return value:
+ *   None
+ */
+static void pack_catattr(digraph_t *g, uint_t u, const int *values)
+{
+  uint_t    n = g->num_nodes;
+  uint_t    i, num_values = 0, num_distinct = 0;
+  int       maxval = -1;
+  int      *sorted = NULL;
+  uint32_t *codes = NULL;
+  bool      direct;
+
+  for (i = 0; i < n; i++)
+    maxval = MAX(maxval, values[i]);
+  /* look up codes directly by value unless the values are too sparse */
+  direct = ((size_t)maxval + 1 <= 4 * (size_t)n + 1024);
+  if (direct) {
+    codes = (uint32_t *)safe_calloc((size_t)maxval + 1, sizeof(uint32_t));
+    for (i = 0; i < n; i++)
+      if (values[i] != CAT_NA)
+        codes[values[i]] = 1;
+    for (i = 0; i < (uint_t)(maxval + 1); i++)
+      if (codes[i])
+        codes[i] = ++num_distinct;
+  } else {
+    sorted = (int *)safe_malloc(n * sizeof(int));
+    for (i = 0; i < n; i++)
+      if (values[i] != CAT_NA)
+        sorted[num_values++] = values[i];
+    qsort(sorted, num_values, sizeof(int), compare_int);
+    for (i = 0; i < num_values; i++)
+      if (num_distinct == 0 || sorted[i] != sorted[num_distinct - 1])
+        sorted[num_distinct++] = sorted[i];
+  }
+  g->catattr_width[u] = num_distinct <= UINT8_MAX ? 1 :
+    num_distinct <= UINT16_MAX ? 2 : 4;
+  g->catattr[u] = safe_malloc((size_t)n * g->catattr_width[u]);
+  for (i = 0; i < n; i++) {
+    if (values[i] == CAT_NA)
+      set_catattr_code(g, u, i, CATATTR_CODE_NA);
+    else if (direct)
+      set_catattr_code(g, u, i, codes[values[i]]);
+    else
+      set_catattr_code(g, u, i, 1 + (uint32_t)((int *)bsearch(&values[i],
+                                                  sorted, num_distinct,
+                                                  sizeof(int), compare_int)
+                                               - sorted));
+  }
+  free(codes);
+  free(sorted);
+}
+
+/*
+ * Build the per-node attribute terms contattr_term from the
+ * continuous attributes, so that change statistics that depend only
+ * on the attribute of one node are a single array load with missing
+ * values already handled. (The binary attributes need no such term as
+ * their bit sets already have missing values folded to 0.)
+ *
+ * Parameters:
+ *   g - (in/out) digraph object with attributes loaded
+ *
+ * Return value:
+ *   None
+ */
+static void build_attr_terms(digraph_t *g)
+{
+  uint_t u, i;
+
+  if (g->num_contattr > 0) {
+    g->contattr_term = (contattr_t **)safe_malloc(g->num_contattr *
+                                                  sizeof(contattr_t *));
+  }
+  for (u = 0; u < g->num_contattr; u++) {
+    g->contattr_term[u] = (contattr_t *)safe_malloc(g->num_nodes *
+                                                    sizeof(contattr_t));
+    for (i = 0; i < g->num_nodes; i++)
+      g->contattr_term[u][i] = isnan(g->contattr[u][i]) ? 0 :
+        g->contattr[u][i];
+  }
+}
+
+/*
+ * Shared attributes block (see move_digraph_attributes()): a header,
+ * then the set attribute lengths, the categorical attribute code
+ * widths, the attribute and dyadic covariate names (each NUL
+ * terminated) and then the value arrays, each starting on an 8 byte
+ * boundary, the dyadic covariates last.
+ */
+typedef struct attr_block_header_s {
+  uint64_t num_nodes;
+  uint64_t num_binattr;
+  uint64_t num_catattr;
+  uint64_t num_contattr;
+  uint64_t num_setattr;
+  uint64_t contattr_size; /* sizeof(contattr_t) */
+  uint64_t num_dyadcov;
+  uint64_t dyadcov_nnz;   /* pairs stored, with no rows if num_dyadcov 0 */
+} attr_block_header_t;
+
+typedef enum attr_block_mode_e {
+  ATTR_BLOCK_SIZE,   /* only compute size of block */
+  ATTR_BLOCK_MOVE,   /* copy attributes into block and free them */
+  ATTR_BLOCK_COPY,   /* copy attributes into block, g unchanged */
+  ATTR_BLOCK_ATTACH  /* point attributes into block */
+} attr_block_mode_e;
+
+#define ATTR_BLOCK_ALIGN(bytes) (((bytes) + 7) & ~(size_t)7)
+
+/*
+ * Place one value array of a shared attributes block at *offset.
+ *
+ * Parameters:
+ *   block  - the block (NULL for ATTR_BLOCK_SIZE)
+ *   offset - (in/out) offset of array in block, advanced past it
+ *   array  - (in/out) pointer to the array, moved into or pointed
+ *            into the block according to mode
+ *   bytes  - size of the array
+ *   mode   - what to do
+ *
+ * Return value:
+ *   None
+ */
+static void attr_block_place(char *block, size_t *offset, void **array,
+                             size_t bytes, attr_block_mode_e mode)
+{
+  switch (mode) {
+    case ATTR_BLOCK_MOVE:
+      memcpy(block + *offset, *array, bytes);
+      free(*array);
+      *array = block + *offset;
+      break;
+    case ATTR_BLOCK_COPY:
+      memcpy(block + *offset, *array, bytes);
+      break;
+    case ATTR_BLOCK_ATTACH:
+      *array = block + *offset;
+      break;
+    default:
+      break;
+  }
+  *offset += ATTR_BLOCK_ALIGN(bytes);
+}
+
+/*
+ * Place one attribute name of a shared attributes block at *offset.
+ * The names are not moved into the block but copied (and with
+ * ATTR_BLOCK_ATTACH, copied out of it) so that every process owns its
+ * names.
+ *
+ * Parameters: as attr_block_place()
+ *
+ * Return value:
+ *   None
+ */
+static void attr_block_name(char *block, size_t *offset, char **name,
+                            attr_block_mode_e mode)
+{
+  size_t bytes;
+
+  if (mode == ATTR_BLOCK_ATTACH) {
+    *name = safe_strdup(block + *offset);
+    bytes = strlen(*name) + 1;
+  } else {
+    bytes = strlen(*name) + 1;
+    if (mode == ATTR_BLOCK_MOVE || mode == ATTR_BLOCK_COPY)
+      memcpy(block + *offset, *name, bytes);
+  }
+  *offset += bytes;
+}
+
+/*
+ * Remove the binary, categorical, continuous and set attributes that
+ * are not among the columns to keep (see set_attribute_columns()) from
+ * g after they are attached to a shared attributes block, so only
+ * their names (and the arrays of pointers to their values, not made
+ * for the set attributes) are freed.
+ *
+ * Parameters:
+ *   g - (in/out) digraph object with attributes attached
+ *
+ * Return value:
+ *   None
+ */
+static void drop_attr_columns(digraph_t *g)
+{
+  uint_t u, k;
+
+  for (u = k = 0; u < g->num_binattr; u++) {
+    if (!attr_column_kept(g->num_attr_columns, g->attr_columns,
+                          g->binattr_names[u])) {
+      free(g->binattr_names[u]);
+      continue;
+    }
+    g->binattr_names[k] = g->binattr_names[u];
+    g->binattr[k] = g->binattr[u];
+    g->binattr_na[k++] = g->binattr_na[u];
+  }
+  g->num_binattr = k;
+  for (u = k = 0; u < g->num_catattr; u++) {
+    if (!attr_column_kept(g->num_attr_columns, g->attr_columns,
+                          g->catattr_names[u])) {
+      free(g->catattr_names[u]);
+      continue;
+    }
+    g->catattr_names[k] = g->catattr_names[u];
+    g->catattr[k] = g->catattr[u];
+    g->catattr_width[k++] = g->catattr_width[u];
+  }
+  g->num_catattr = k;
+  for (u = k = 0; u < g->num_contattr; u++) {
+    if (!attr_column_kept(g->num_attr_columns, g->attr_columns,
+                          g->contattr_names[u])) {
+      free(g->contattr_names[u]);
+      continue;
+    }
+    g->contattr_names[k] = g->contattr_names[u];
+    g->contattr[k] = g->contattr[u];
+    g->contattr_term[k++] = g->contattr_term[u];
+  }
+  g->num_contattr = k;
+  for (u = k = 0; u < g->num_setattr; u++) {
+    if (!g->setattr[u]) {
+      free(g->setattr_names[u]);
+      continue;
+    }
+    g->setattr_names[k] = g->setattr_names[u];
+    g->setattr_lengths[k] = g->setattr_lengths[u];
+    g->setattr[k] = g->setattr[u];
+    g->setattr_bits[k] = g->setattr_bits[u];
+    g->setattr_na[k++] = g->setattr_na[u];
+  }
+  g->num_setattr = k;
+}
+
+/*
+ * Compute the layout of, move or copy the attributes of g into, or
+ * attach the attributes of g to, a shared attributes block.
+ * When attaching, only the columns to keep (see
+ * set_attribute_columns()) are kept, the values of the others (e.g.
+ * in a mapped snapshot file) never being touched.
+ *
+ * Parameters:
+ *   g     - (in/out) digraph object
+ *   block - the block (NULL for ATTR_BLOCK_SIZE)
+ *   mode  - what to do
+ *
+ * Return value:
+ *   Size of the block in bytes
+ */
+static size_t walk_attr_block(digraph_t *g, char *block,
+                              attr_block_mode_e mode)
+{
+  attr_block_header_t *hdr = (attr_block_header_t *)block;
+  size_t offset = ATTR_BLOCK_ALIGN(sizeof(attr_block_header_t));
+  size_t n = g->num_nodes;
+  uint_t u, i;
+
+  if (mode == ATTR_BLOCK_MOVE || mode == ATTR_BLOCK_COPY) {
+    hdr->num_nodes = g->num_nodes;
+    hdr->num_binattr = g->num_binattr;
+    hdr->num_catattr = g->num_catattr;
+    hdr->num_contattr = g->num_contattr;
+    hdr->num_setattr = g->num_setattr;
+    hdr->contattr_size = sizeof(contattr_t);
+    hdr->num_dyadcov = g->num_dyadcov;
+    hdr->dyadcov_nnz = g->dyadcov_nnz;
+  } else if (mode == ATTR_BLOCK_ATTACH) {
+    assert(hdr->num_nodes == g->num_nodes);
+    assert(hdr->contattr_size == sizeof(contattr_t));
+    assert(g->num_binattr + g->num_catattr + g->num_contattr +
+           g->num_setattr + g->num_dyadcov == 0);
+    g->num_binattr = (uint_t)hdr->num_binattr;
+    g->num_catattr = (uint_t)hdr->num_catattr;
+    g->num_contattr = (uint_t)hdr->num_contattr;
+    g->num_setattr = (uint_t)hdr->num_setattr;
+    g->num_dyadcov = (uint_t)hdr->num_dyadcov;
+    g->dyadcov_nnz = hdr->dyadcov_nnz;
+    if (g->num_binattr > 0) {
+      g->binattr_names = (char **)safe_malloc(g->num_binattr * sizeof(char *));
+      g->binattr = (uint64_t **)safe_malloc(g->num_binattr *
+                                            sizeof(uint64_t *));
+      g->binattr_na = (uint64_t **)safe_malloc(g->num_binattr *
+                                               sizeof(uint64_t *));
+    }
+    if (g->num_catattr > 0) {
+      g->catattr_names = (char **)safe_malloc(g->num_catattr * sizeof(char *));
+      g->catattr = (void **)safe_malloc(g->num_catattr * sizeof(void *));
+      g->catattr_width = (uint8_t *)safe_malloc(g->num_catattr *
+                                                sizeof(uint8_t));
+    }
+    if (g->num_contattr > 0) {
+      g->contattr_names = (char **)safe_malloc(g->num_contattr *
+                                               sizeof(char *));
+      g->contattr = (contattr_t **)safe_malloc(g->num_contattr *
+                                               sizeof(contattr_t *));
+      g->contattr_term = (contattr_t **)safe_malloc(g->num_contattr *
+                                                    sizeof(contattr_t *));
+    }
+    if (g->num_setattr > 0) {
+      g->setattr_names = (char **)safe_malloc(g->num_setattr * sizeof(char *));
+      g->setattr_lengths = (uint_t *)safe_malloc(g->num_setattr *
+                                                 sizeof(uint_t));
+      g->setattr = (set_elem_e ***)safe_malloc(g->num_setattr *
+                                               sizeof(set_elem_e **));
+      g->setattr_bits = (uint64_t ***)safe_malloc(g->num_setattr *
+                                                  sizeof(uint64_t **));
+      g->setattr_na = (uint64_t **)safe_malloc(g->num_setattr *
+                                               sizeof(uint64_t *));
+    }
+    if (g->num_dyadcov > 0) {
+      g->dyadcov_names = (char **)safe_malloc(g->num_dyadcov * sizeof(char *));
+      g->dyadcov_values = (contattr_t **)safe_malloc(g->num_dyadcov *
+                                                     sizeof(contattr_t *));
+    }
+  }
+
+  if ((mode == ATTR_BLOCK_MOVE || mode == ATTR_BLOCK_COPY) &&
+      g->num_setattr > 0)
+    memcpy(block + offset, g->setattr_lengths,
+           g->num_setattr * sizeof(uint_t));
+  else if (mode == ATTR_BLOCK_ATTACH && g->num_setattr > 0)
+    memcpy(g->setattr_lengths, block + offset,
+           g->num_setattr * sizeof(uint_t));
+  offset += ATTR_BLOCK_ALIGN(g->num_setattr * sizeof(uint_t));
+  if ((mode == ATTR_BLOCK_MOVE || mode == ATTR_BLOCK_COPY) &&
+      g->num_catattr > 0)
+    memcpy(block + offset, g->catattr_width, g->num_catattr * sizeof(uint8_t));
+  else if (mode == ATTR_BLOCK_ATTACH && g->num_catattr > 0)
+    memcpy(g->catattr_width, block + offset, g->num_catattr * sizeof(uint8_t));
+  offset += ATTR_BLOCK_ALIGN(g->num_catattr * sizeof(uint8_t));
+
+  for (u = 0; u < g->num_binattr; u++)
+    attr_block_name(block, &offset, &g->binattr_names[u], mode);
+  for (u = 0; u < g->num_catattr; u++)
+    attr_block_name(block, &offset, &g->catattr_names[u], mode);
+  for (u = 0; u < g->num_contattr; u++)
+    attr_block_name(block, &offset, &g->contattr_names[u], mode);
+  for (u = 0; u < g->num_setattr; u++)
+    attr_block_name(block, &offset, &g->setattr_names[u], mode);
+  for (u = 0; u < g->num_dyadcov; u++)
+    attr_block_name(block, &offset, &g->dyadcov_names[u], mode);
+  offset = ATTR_BLOCK_ALIGN(offset);
+
+  for (u = 0; u < g->num_binattr; u++) {
+    attr_block_place(block, &offset, (void **)&g->binattr[u],
+                     SETATTR_WORDS(n) * sizeof(uint64_t), mode);
+    attr_block_place(block, &offset, (void **)&g->binattr_na[u],
+                     SETATTR_WORDS(n) * sizeof(uint64_t), mode);
+  }
+  for (u = 0; u < g->num_catattr; u++)
+    attr_block_place(block, &offset, &g->catattr[u],
+                     n * g->catattr_width[u], mode);
+  for (u = 0; u < g->num_contattr; u++) {
+    attr_block_place(block, &offset, (void **)&g->contattr[u],
+                     n * sizeof(contattr_t), mode);
+    attr_block_place(block, &offset, (void **)&g->contattr_term[u],
+                     n * sizeof(contattr_t), mode);
+  }
+  for (u = 0; u < g->num_setattr; u++) {
+    if (mode == ATTR_BLOCK_ATTACH) {
+      /* the pointers to the values of each node are only made for the
+         set attributes kept (see drop_attr_columns()) */
+      if (attr_column_kept(g->num_attr_columns, g->attr_columns,
+                           g->setattr_names[u])) {
+        g->setattr[u] = (set_elem_e **)safe_malloc(n * sizeof(set_elem_e *));
+        g->setattr_bits[u] = (uint64_t **)safe_malloc(n * sizeof(uint64_t *));
+      } else {
+        g->setattr[u] = NULL;
+        g->setattr_bits[u] = NULL;
+        offset += n * (ATTR_BLOCK_ALIGN(g->setattr_lengths[u] *
+                                        sizeof(set_elem_e)) +
+                       ATTR_BLOCK_ALIGN(SETATTR_WORDS(g->setattr_lengths[u]) *
+                                        sizeof(uint64_t)));
+        attr_block_place(block, &offset, (void **)&g->setattr_na[u],
+                         SETATTR_WORDS(n) * sizeof(uint64_t), mode);
+        continue;
+      }
+    }
+    for (i = 0; i < n; i++) {
+      attr_block_place(block, &offset, (void **)&g->setattr[u][i],
+                       g->setattr_lengths[u] * sizeof(set_elem_e), mode);
+      attr_block_place(block, &offset, (void **)&g->setattr_bits[u][i],
+                       SETATTR_WORDS(g->setattr_lengths[u]) *
+                       sizeof(uint64_t), mode);
+    }
+    attr_block_place(block, &offset, (void **)&g->setattr_na[u],
+                     SETATTR_WORDS(n) * sizeof(uint64_t), mode);
+  }
+  if (g->num_dyadcov > 0) {
+    attr_block_place(block, &offset, (void **)&g->dyadcov_rowstart,
+                     (n + 1) * sizeof(uint64_t), mode);
+    attr_block_place(block, &offset, (void **)&g->dyadcov_cols,
+                     g->dyadcov_nnz * sizeof(uint_t), mode);
+    for (u = 0; u < g->num_dyadcov; u++)
+      attr_block_place(block, &offset, (void **)&g->dyadcov_values[u],
+                       g->dyadcov_nnz * sizeof(contattr_t), mode);
+  }
+  if (mode == ATTR_BLOCK_ATTACH && g->attr_columns)
+    drop_attr_columns(g);
+  if (mode == ATTR_BLOCK_MOVE || mode == ATTR_BLOCK_ATTACH)
+    g->shared_attributes = TRUE;
+  return offset;
+}
+
+/*
+ * Is inner wave arc i -> j one that can be deleted in conditional
+ * estimation, i.e. not the last tie (ignoring direction) of the node in
+ * the later wave to the preceding wave?
+ *
+ * Parameters:
+ *    g - digraph with zone information
+ *    i - node arc is from
+ *    j - node arc is to
+ *
+ * Return value:
+ *    TRUE if the arc can be deleted else FALSE
+ */
+static bool is_deletable_inner_arc(const digraph_t *g, uint_t i, uint_t j)
+{
+  return !((g->zone[i] > g->zone[j] && g->prev_wave_degree[i] == 1) ||
+           (g->zone[j] > g->zone[i] && g->prev_wave_degree[j] == 1));
+}
+
+/*
+ * Add one to, or subtract one from, the count of deletable arcs at a
+ * position in allinnerarcs in the Fenwick tree deletable_inner_tree
+ * (which is stored from index 1).
+ *
+ * Parameters:
+ *    g         - digraph
+ *    pos       - position in allinnerarcs
+ *    increment - TRUE to add one, FALSE to subtract one
+ *
+ * Return value:
+ *    None
+ */
+static void deletable_inner_tree_add(digraph_t *g, arcidx_t pos,
+                                     bool increment)
+{
+  arcidx_t k;
+
+  for (k = pos + 1; k <= g->deletable_inner_tree_size; k += k & (~k + 1)) {
+    if (increment)
+      g->deletable_inner_tree[k]++;
+    else
+      g->deletable_inner_tree[k]--;
+  }
+  if (increment)
+    g->num_deletable_inner_arcs++;
+  else
+    g->num_deletable_inner_arcs--;
+}
+
+/*
+ * Number of deletable arcs in the first pos positions of allinnerarcs,
+ * from the Fenwick tree deletable_inner_tree.
+ *
+ * Parameters:
+ *    g   - digraph
+ *    pos - number of positions
+ *
+ * Return value:
+ *    number of deletable arcs in positions 0 .. pos-1
+ */
+static arcidx_t deletable_inner_tree_prefix(const digraph_t *g, arcidx_t pos)
+{
+  arcidx_t k, sum = 0;
+
+  for (k = pos; k > 0; k -= k & (~k + 1))
+    sum += g->deletable_inner_tree[k];
+  return sum;
+}
+
+/*
+ * Record whether the arc at a position in allinnerarcs (or, with
+ * deletable FALSE, a position past the end of it) is deletable in
+ * conditional estimation, updating deletable_inner_tree and
+ * num_deletable_inner_arcs. Nothing is done if the tree has not been
+ * built.
+ *
+ * Parameters:
+ *    g         - digraph
+ *    pos       - position in allinnerarcs
+ *    deletable - TRUE if the arc at pos can be deleted
+ *
+ * Return value:
+ *    None
+ */
+static void set_inner_arc_deletable(digraph_t *g, arcidx_t pos,
+                                    bool deletable)
+{
+  bool was_deletable;
+
+  if (!g->deletable_inner_tree)
+    return;
+  assert(pos < g->deletable_inner_tree_size);
+  was_deletable = deletable_inner_tree_prefix(g, pos + 1) >
+    deletable_inner_tree_prefix(g, pos);
+  if (deletable != was_deletable)
+    deletable_inner_tree_add(g, pos, deletable);
+}
+
+/*
+ * Build the Fenwick tree deletable_inner_tree (and
+ * num_deletable_inner_arcs) from allinnerarcs and prev_wave_degree,
+ * with room for at least min_size arcs.
+ *
+ * Parameters:
+ *    g        - digraph with zone information
+ *    min_size - number of positions needed
+ *
+ * Return value:
+ *    None
+ */
+static void build_deletable_inner_tree(digraph_t *g, arcidx_t min_size)
+{
+  arcidx_t a, k, parent;
+
+  free(g->deletable_inner_tree);
+  for (g->deletable_inner_tree_size = 1;
+       g->deletable_inner_tree_size < min_size;
+       g->deletable_inner_tree_size *= 2)
+    /*nothing*/;
+  g->deletable_inner_tree = (arcidx_t *)safe_calloc(
+    (size_t)g->deletable_inner_tree_size + 1, sizeof(arcidx_t));
+  g->num_deletable_inner_arcs = 0;
+  for (a = 0; a < g->num_inner_arcs; a++) {
+    if (is_deletable_inner_arc(g, g->allinnerarcs[a].i,
+                               g->allinnerarcs[a].j)) {
+      g->deletable_inner_tree[a + 1] = 1;
+      g->num_deletable_inner_arcs++;
+    }
+  }
+  /* each entry adds its count to its parent, in one pass from the leaves */
+  for (k = 1; k <= g->deletable_inner_tree_size; k++) {
+    parent = k + (k & (~k + 1));
+    if (parent <= g->deletable_inner_tree_size)
+      g->deletable_inner_tree[parent] += g->deletable_inner_tree[k];
+  }
+}
+
+/*
+ * When the number of ties of node v to the preceding wave changes
+ * between one and two, because arc i -> j was inserted or removed, its
+ * other tie to the preceding wave becomes deletable (or not) in
+ * conditional estimation, so update deletable_inner_tree for it.
+ *
+ * Parameters:
+ *    g     - digraph with zone information, arc i -> j already
+ *            inserted or removed in the adjacency lists
+ *    v     - node (i or j) in the later wave
+ *    i     - node arc is from
+ *    j     - node arc is to
+ *    isAdd - TRUE if the arc was inserted, FALSE if removed
+ *
+ * Return value:
+ *    None
+ */
+static void update_prev_wave_tie(digraph_t *g, uint_t v, uint_t i, uint_t j,
+                                 bool isAdd)
+{
+  uint_t k, w, a = 0, b = 0;
+  bool   found = FALSE;
+  size_t pos;
+
+  if (!g->deletable_inner_tree || g->zone[v] >= g->max_zone ||
+      g->prev_wave_degree[v] != (isAdd ? 2 : 1))
+    return;
+  for (k = 0; k < g->outdegree[v] && !found; k++) {
+    w = g->arclist[v][k];
+    if (g->zone[w] + 1 == g->zone[v] && !(v == i && w == j)) {
+      a = v;
+      b = w;
+      found = TRUE;
+    }
+  }
+  for (k = 0; k < g->indegree[v] && !found; k++) {
+    w = g->revarclist[v][k];
+    if (g->zone[w] + 1 == g->zone[v] && !(w == i && v == j)) {
+      a = w;
+      b = v;
+      found = TRUE;
+    }
+  }
+  assert(found);
+  /* the arc may not be in allinnerarcs if it is not being maintained
+     (the sampler is not doing conditional estimation) */
+  pos = g->allinnerarcs_index.capacity ?
+    arcindex_slot(&g->allinnerarcs_index, a, b) : 0;
+  if (g->allinnerarcs_index.capacity &&
+      g->allinnerarcs_index.keys[pos] == ARC_KEY(a, b))
+    set_inner_arc_deletable(g, g->allinnerarcs_index.values[pos], isAdd);
+}
+
+/*
+ * Build the snowball sampling zone information of g from the zone of
+ * each node (already in g->zone): the max_zone, num_inner_nodes,
+ * inner_nodes, inner_zone_start, zone_pair_cumcount, prev_wave_degree,
+ * num_inner_arcs and allinnerarcs fields.
+ *
+ * Parameters:
+ *    g - (in/out) digraph with arcs and g->zone set
+ *
+ * Return value:
+ *    0 if OK else nonzero for error (message printed to stderr).
+ */
+static int build_zone_index(digraph_t *g)
+{
+  uint_t   i, u, v;
+  arcidx_t a;
+  uint_t  *zone_sizes; /* number of nodes in each zone */
+  uint_t   num_zones;
+
+  for (i = 0; i < g->num_nodes; i++) {
+    if (g->zone[i] > g->max_zone) {
+      g->max_zone = g->zone[i];
+    }
+  }
+
+  num_zones = g->max_zone + 1;
+
+  /* check that the zones are not invalid, no skipped zones */
+  zone_sizes = (uint_t *)safe_calloc(num_zones, sizeof(uint_t));
+  for (i = 0; i < g->num_nodes; i++) {
+    assert(g->zone[i] < num_zones);
+    zone_sizes[g->zone[i]]++;
+  }
+  for (i = 0; i < num_zones; i++) {
+    if (zone_sizes[i] == 0) {
+      fprintf(stderr,
+              "ERROR: Max zone is %u but there are no nodes in zone %u\n",
+              g->max_zone, i);
+      free(zone_sizes);
+      return -1;
+    }
+  }
+
+  /*
+   * For conditional estimation, the zone of each node is fixed, as
+   * well as all the ties between nodes in the outermost wave (last
+   * zone) and ties from nodes in the last zone to nodes in the
+   * second-last zone. So in MCMC procedure we to need find nodes only
+   * in the inner waves (i.e. all those apart from the outermost). So
+   * to all this done to be done efficiently we build the inner_nodes
+   * array which is an array of size num_inner_nodes (the number of
+   * nodes in zones other than the last) of each node id in an inner
+   * zone. The nodes are in zone order, with inner_zone_start[] giving
+   * where each zone begins, and zone_pair_cumcount[] counts the pairs
+   * of nodes in the same or adjacent zones (the only ones that can be
+   * tied), so that sample_zone_pair() can draw such a pair directly.
+   */
+  g->inner_zone_start = (uint_t *)safe_calloc(num_zones, sizeof(uint_t));
+  for (i = 0; i < g->max_zone; i++) {
+    g->inner_zone_start[i] = g->num_inner_nodes;
+    g->num_inner_nodes += zone_sizes[i];
+  }
+  g->inner_zone_start[g->max_zone] = g->num_inner_nodes;
+  g->inner_nodes = (uint_t *)safe_calloc(g->num_inner_nodes, sizeof(uint_t));
+  for (i = 0; i < g->max_zone; i++)
+    zone_sizes[i] = 0; /* now count of nodes placed in each zone */
+  for (u = 0; u < g->num_nodes; u++) {
+    if (g->zone[u] < g->max_zone) {
+      i = g->inner_zone_start[g->zone[u]] + zone_sizes[g->zone[u]]++;
+      assert(i < g->num_inner_nodes);
+      g->inner_nodes[i] = u;
+    }
+  }
+  if (g->max_zone > 0) {
+    g->zone_pair_cumcount = (uint64_t *)safe_malloc((2*g->max_zone - 1) *
+                                                    sizeof(uint64_t));
+    for (i = 0; i < g->max_zone; i++) {
+      g->zone_pair_cumcount[2*i] = (i > 0 ? g->zone_pair_cumcount[2*i-1] : 0)
+        + (uint64_t)zone_sizes[i] * (zone_sizes[i] - 1);
+      if (i + 1 < g->max_zone)
+        g->zone_pair_cumcount[2*i+1] = g->zone_pair_cumcount[2*i] +
+          2 * (uint64_t)zone_sizes[i] * zone_sizes[i+1];
+    }
+  }
+  
+  /*
+   * build prev_wave_degree[] which for each node gives the number of
+   * edges to or from (i.e. ignoring direction of arc) that node
+   * to/from nodes in the immediately preceding zone. (This value will always
+   * be zero for all seed nodes i.e. nodes in zone 0).
+   * Also build allinnerarcs flat arcs list of arcs between nodes in inner waves
+   * used for conditional estimation fast lookup of such an arc to delete
+   */
+  for (a = 0; a < g->num_arcs; a++) {
+    u = g->allarcs[a].i;
+    v = g->allarcs[a].j;
+    if (g->zone[u] != g->zone[v] &&
+        g->zone[u] != g->zone[v] + 1 && g->zone[v] != g->zone[u] + 1){
+      fprintf(stderr, "ERROR: invalid snowball zones for adjacent nodes %u "
+              "(zone %u) and %u (zone %u)\n", u, g->zone[u], v, g->zone[v]);
+      free(zone_sizes);
+      return -1;
+    }
+    if (g->zone[u] > g->zone[v]) {
+      assert(g->zone[u] == g->zone[v] + 1);
+      g->prev_wave_degree[u]++;
+    } else if (g->zone[v] > g->zone[u]) {
+      assert(g->zone[v] == g->zone[u] + 1);
+      g->prev_wave_degree[v]++;
+    }
+    if (g->zone[u] < g->max_zone && g->zone[v] < g->max_zone) {
+      g->num_inner_arcs++;
+      DIGRAPH_DEBUG_PRINT(("inner arc %lu: %u -> %u (zones %u %u)\n", (unsigned long)g->num_inner_arcs-1, u, v, g->zone[u], g->zone[v]));
+      g->allinnerarcs = (nodepair_t *)safe_realloc(g->allinnerarcs,
+                                                   g->num_inner_arcs *
+                                                   sizeof(nodepair_t));
+      g->allinnerarcs[g->num_inner_arcs-1].i = u;
+      g->allinnerarcs[g->num_inner_arcs-1].j = v;
+      arcindex_put(&g->allinnerarcs_index, u, v, g->num_inner_arcs-1);
+    }
+  }
+  build_deletable_inner_tree(g, g->num_inner_arcs);
+  
+  free(zone_sizes);
+  return 0;
+}
+
+#ifdef TWOPATH_CACHE
+/* comparisons to count two-paths from lists of lengths da and db, see
+   mixTwoPaths() */
+#ifdef ORDERED_ARCLIST
+#define TWOPATH_COUNT_WORK(da, db) ((uint64_t)(da) + (db))
+#else
+#define TWOPATH_COUNT_WORK(da, db) ((uint64_t)(da) * (db))
+#endif /* ORDERED_ARCLIST */
+
+/*
+ * Update the version stamps of the out-list of node i and the in-list
+ * of node j when arc i -> j is inserted or removed, so that the cached
+ * two-path counts depending on them are no longer used.
+ *
+ * Parameters:
+ *   g - digraph
+ *   i - node arc is from
+ *   j - node arc is to
+ *
+ * Return value:
+ *   None.
+ */
+static inline void touch_twopath_stamps(digraph_t *g, uint_t i, uint_t j)
+{
+  g->twopath_stamp[i].out++;
+  g->twopath_stamp[j].in++;
+  /* after a stamp wraps around an old entry could match it again */
+  if (g->twopath_stamp[i].out == 0 || g->twopath_stamp[j].in == 0)
+    invalidate_twopath_cache(g);
+}
+
+/*
+ * Get a two-path count from the two-path cache of the calling thread,
+ * or if it is not there (or not valid any more) count it and put it
+ * there. Counts that take few comparisons are just counted.
+ *
+ * Parameters:
+ *   g          - digraph
+ *   kind       - which two-paths
+ *   i          - first node (i <= j for in- and out-two-paths)
+ *   j          - second node
+ *   stamp_i    - version stamp of the list of i the count depends on
+ *   stamp_j    - version stamp of the list of j the count depends on
+ *   work       - comparisons to count it (TWOPATH_COUNT_WORK())
+ *   count_func - function to count the two-paths for (i, j)
+ *
+ * Return value:
+ *   Number of two-paths.
+ */
+static inline uint_t cached_two_paths(const digraph_t *g, twopath_kind_e kind,
+                                      uint_t i, uint_t j,
+                                      uint32_t stamp_i, uint32_t stamp_j,
+                                      uint64_t work,
+                                      uint_t (*count_func)(const digraph_t *,
+                                                           uint_t, uint_t))
+{
+  twopath_cache_t       *cache = &twopath_cache;
+  twopath_cache_entry_t *e;
+
+  if (work < TWOPATH_CACHE_MIN_WORK)
+    return count_func(g, i, j);
+  if (cache->graph_id != g->twopath_cache_id) {
+    /* entries are for another digraph, or invalidated */
+    cache->graph_id = g->twopath_cache_id;
+    if (++cache->epoch == 0) {
+      memset(cache->entries, 0, sizeof(cache->entries));
+      cache->epoch = 1;
+    }
+  }
+  /* Fibonacci hashing of the pair */
+  e = &cache->entries[kind][(ARC_KEY(i, j) * 0x9E3779B97F4A7C15ULL) >>
+                            (64 - TWOPATH_CACHE_BITS)];
+  if (e->epoch != cache->epoch || e->i != i || e->j != j ||
+      e->stamp_i != stamp_i || e->stamp_j != stamp_j) {
+    e->i = i;
+    e->j = j;
+    e->stamp_i = stamp_i;
+    e->stamp_j = stamp_j;
+    e->epoch = cache->epoch;
+    e->count = count_func(g, i, j);
+  }
+  return e->count;
+}
+#endif /* TWOPATH_CACHE */
+
+   
+/*****************************************************************************
+ *
+ * externally visible functions
+ *
+ ****************************************************************************/
+
+#if defined(TWOPATH_WITH_UTHASH) || defined(TWOPATH_WITH_OATABLES)
+/*
+ * Get entry for (i, j) in hashtable.
+ *
+ *
+ * Parameters:
+ *     h - hash table
+ *     i - node id of source
+ *     j - node id of destination
+ *
+ * Return value:
+ *     value for key (i, j) in hashtable or 0 if none
+ */
+#ifdef TWOPATH_WITH_UTHASH
+uint_t get_twopath_entry(twopath_record_t *h, uint_t i, uint_t j)
+{
+  twopath_record_t rec, *p = NULL;
+  rec.key.i = i;
+  rec.key.j = j;
+  HASH_FIND(hh, h, &rec.key, sizeof(nodepair_t), p);
+  return (p ? p->value : 0);
+}
+#else /* open addressing hash table */
+uint_t get_twopath_entry(const twopath_hashtab_t *h, uint_t i, uint_t j)
+{
+  twopath_key_t key = TWOPATH_KEY(i, j);
+  size_t        mask, pos;
+
+  if (h->capacity == 0)
+    return 0;
+  mask = h->capacity - 1;
+  for (pos = pair_hash(key) & mask; h->keys[pos] != TWOPATH_EMPTY_KEY;
+       pos = (pos + 1) & mask) {
+    if (h->keys[pos] == key)
+      return h->values[pos];
+  }
+  return 0;
+}
+
+/*
+ * Prefetch the slot where the probe for (i, j) in hashtable starts,
+ * for a later get_twopath_entry(h, i, j).
+ *
+ * Parameters:
+ *     h - hash table
+ *     i - node id of source
+ *     j - node id of destination
+ *
+ * Return value:
+ *     None
+ */
+void prefetch_twopath_entry(const twopath_hashtab_t *h, uint_t i, uint_t j)
+{
+  size_t pos;
+
+  if (h->capacity == 0)
+    return;
+  pos = pair_hash(TWOPATH_KEY(i, j)) & (h->capacity - 1);
+  PREFETCH(&h->keys[pos]);
+  PREFETCH(&h->values[pos]);
+}
+#endif /* TWOPATH_WITH_UTHASH */
+#endif /* TWOPATH_WITH_UTHASH || TWOPATH_WITH_OATABLES */
+
+#ifndef TWOPATH_LOOKUP /* counting on the fly (always possible if adaptive) */
+
+/* In these functions we have to count paths i -- v -- j for different
+   directions (i.e -- can be <- or ->) depending on the function. So we
+   can iterate over neighbours of i or of j in the outermost loop. The 
+   result is the same but it can be faster if the outermost loop is over
+   the node with smallest degree. Note that in the inner loop we could also
+   iterate neighbours of v or of i or j, but in practice I found it far
+   faster to always just use j or i rather than v for large network with very
+   high maximum degree and very skewed degree distribution (physician referral
+   network). On most networks (smaller, less skewed, lower max degree) it
+   makes no real difference.
+   If ORDERED_ARCLIST is defined the adjacency lists are sorted, so instead
+   the count is just the size of the intersection of the two lists,
+   which is O(d_i + d_j) rather than O(d_i * d_j). */
+
+/* 
+ * Count two-paths for (i, j): paths  i -> v -> j for some v
+ */
+uint_t mixTwoPaths(const digraph_t *g, uint_t i, uint_t j)
+{
+#ifdef ORDERED_ARCLIST
+  return sorted_intersection_count(g->arclist[i], g->outdegree[i],
+                                   g->revarclist[j], g->indegree[j], i, j);
+#else
+  uint_t v,k,l;
+  uint_t count = 0;
+
+  if (g->outdegree[i] < g->indegree[j]) {
+    for (k = 0; k < g->outdegree[i]; k++)  {
+      v = g->arclist[i][k];   /* i -> v */
+      if (v == i || v == j)
+	continue;
+      for (l = 0; l < g->indegree[j]; l++) {
+	if (g->revarclist[j][l] == v) {   /* v -> j */
+	  count++;
+	}
+      }
+    }
+  } else {
+    for (k = 0; k < g->indegree[j]; k++) {
+      v = g->revarclist[j][k];  /* v -> j */
+      if (v == i || v == j)
+	continue;
+      for (l = 0; l < g->outdegree[i]; l++) {
+	if (g->arclist[i][l] == v) { /* i -> v */
+	  count++;
+	}
+      }
+    }
+  }
+  return count;
+#endif /* ORDERED_ARCLIST */
+}
+
+/* 
+ * Count out-two-paths for (i, j): paths  i <- v -> j for some v
+ */
+uint_t outTwoPaths(const digraph_t *g, uint_t i, uint_t j)
+{
+#ifdef ORDERED_ARCLIST
+  return sorted_intersection_count(g->revarclist[i], g->indegree[i],
+                                   g->revarclist[j], g->indegree[j], i, j);
+#else
+  uint_t v,k,l;
+  uint_t count = 0;
+
+  if (g->indegree[i] < g->indegree[j]) {
+    for (k = 0; k < g->indegree[i]; k++)  {
+      v = g->revarclist[i][k];   /* i <- v */
+      if (v == i || v == j)
+	continue;
+      for (l = 0; l < g->indegree[j]; l++) {
+	if (g->revarclist[j][l] == v) {   /* v -> j */
+	  count++;
+	}
+      }
+    }
+  } else {
+    for (k = 0; k < g->indegree[j]; k++) {
+      v = g->revarclist[j][k]; /* v -> j */
+      if (v == i || v == j) 
+	continue;
+      for (l = 0; l < g->indegree[i]; l++) {
+	if (g->revarclist[i][l] == v) { /* i <- v */
+	  count++;
+	}
+      }
+    }
+  }
+  return count;
+#endif /* ORDERED_ARCLIST */
+}
+
+/* 
+ * Count in-two-paths for (i, j): paths  i -> v <- j for some v
+ */
+uint_t inTwoPaths(const digraph_t *g, uint_t i, uint_t j)
+{
+#ifdef ORDERED_ARCLIST
+  return sorted_intersection_count(g->arclist[i], g->outdegree[i],
+                                   g->arclist[j], g->outdegree[j], i, j);
+#else
+  uint_t v,k,l;
+  uint_t count = 0;
+
+  if (g->outdegree[i] < g->outdegree[j]) {
+    for (k = 0; k < g->outdegree[i]; k++)  {
+      v = g->arclist[i][k];   /* i -> v */
+      if (v == i || v == j)
+	continue;
+      for (l = 0; l < g->outdegree[j]; l++) {
+	if (g->arclist[j][l] == v) {   /* v <- j */
+	  count++;
+	}
+      }
+    }
+  } else {
+    for (k = 0; k < g->outdegree[j]; k++) {
+      v = g->arclist[j][k]; /* v <- j */
+      if (v == i || v == j)
+	continue;
+      for (l = 0; l < g->outdegree[i]; l++) {
+	if (g->arclist[i][l] == v) { /* i -> v */
+	  count++;
+	}
+      }
+    }
+  }
+  return count;
+#endif /* ORDERED_ARCLIST */
+}
+
+#endif /*TWOPATH_LOOKUP*/
+
+#ifdef TWOPATH_CACHE
+/* The two-path cache memoises the counts of the functions above.
+   Successive proposals often share nodes (especially hubs, which are
+   in many arcs) and one change statistic computation often asks for
+   the same pair more than once, while each count is a scan of two
+   adjacency lists. Each node has version stamps for its out- and
+   in-list, updated by insertArc() and removeArc(), and a cached count
+   is only used if the stamps of the two lists it was counted from are
+   the same, so it is invalidated exactly when it could change. */
+
+/*
+ * Count two-paths for (i, j): paths  i -> v -> j for some v,
+ * using the two-path cache.
+ */
+uint_t cachedMixTwoPaths(const digraph_t *g, uint_t i, uint_t j)
+{
+  return cached_two_paths(g, TWOPATH_MIX, i, j, g->twopath_stamp[i].out,
+                          g->twopath_stamp[j].in,
+                          TWOPATH_COUNT_WORK(g->outdegree[i], g->indegree[j]),
+                          mixTwoPaths);
+}
+
+/*
+ * Count out-two-paths for (i, j): paths  i <- v -> j for some v,
+ * using the two-path cache.
+ */
+uint_t cachedOutTwoPaths(const digraph_t *g, uint_t i, uint_t j)
+{
+  uint_t a = MIN(i, j), b = MAX(i, j); /* symmetric */
+  return cached_two_paths(g, TWOPATH_OUT, a, b, g->twopath_stamp[a].in,
+                          g->twopath_stamp[b].in,
+                          TWOPATH_COUNT_WORK(g->indegree[a], g->indegree[b]),
+                          outTwoPaths);
+}
+
+/*
+ * Count in-two-paths for (i, j): paths  i -> v <- j for some v,
+ * using the two-path cache.
+ */
+uint_t cachedInTwoPaths(const digraph_t *g, uint_t i, uint_t j)
+{
+  uint_t a = MIN(i, j), b = MAX(i, j); /* symmetric */
+  return cached_two_paths(g, TWOPATH_IN, a, b, g->twopath_stamp[a].out,
+                          g->twopath_stamp[b].out,
+                          TWOPATH_COUNT_WORK(g->outdegree[a], g->outdegree[b]),
+                          inTwoPaths);
+}
+
+/*
+ * Invalidate all the cached two-path counts of a digraph (in the caches
+ * of all threads), for when its adjacency lists are changed other than
+ * by insertArc() and removeArc(), by giving it a new identifier.
+ *
+ * Parameters:
+ *   g - digraph
+ *
+ * Return value:
+ *   None.
+ */
+void invalidate_twopath_cache(digraph_t *g)
+{
+  g->twopath_cache_id = __sync_add_and_fetch(&twopath_cache_next_id, 1);
+}
+#endif /* TWOPATH_CACHE */
+
+/* 
+ * Return density of graph
+ * 
+ * Parameters:
+ *   g  - digraph 
+ *
+ * Return value:
+ *   Density of g
+ */
+double density(const digraph_t *g)
+{
+  return (double)g->num_arcs / ((double)g->num_nodes * (g->num_nodes - 1));
+}
+
+/*
+ * Test if arc i -> j exists
+ *
+ * Parameters:
+ *   g - digraph
+ *   i - node to test arc from
+ *   j - node to test arc to
+ *
+ * Return value:
+ *   TRUE iff arc i->j exists
+ */
+bool isArc(const digraph_t *g, uint_t i, uint_t j)
+{
+  uint_t k;
+  assert(i < g->num_nodes);
+  assert(j < g->num_nodes);
+  if (g->arcbitmatrix)
+    return ARC_BIT_TEST(g->arcbitmatrix, INDEX2D(i, j, g->num_nodes));
+  if (g->outdegree[i] < g->indegree[j]) {
+    if (g->outhubset[i].capacity)
+      return nodeset_contains(&g->outhubset[i], j);
+#ifdef ORDERED_ARCLIST
+    k = sorted_list_position(g->arclist[i], g->outdegree[i], j);
+    return k < g->outdegree[i] && g->arclist[i][k] == j;
+#endif /* ORDERED_ARCLIST */
+    for (k = 0; k < g->outdegree[i]; k++)  {
+      if (g->arclist[i][k] == j) {
+        return TRUE;
+      }
+    }
+  } else {
+    if (g->inhubset[j].capacity)
+      return nodeset_contains(&g->inhubset[j], i);
+#ifdef ORDERED_ARCLIST
+    k = sorted_list_position(g->revarclist[j], g->indegree[j], i);
+    return k < g->indegree[j] && g->revarclist[j][k] == i;
+#endif /* ORDERED_ARCLIST */
+    for (k = 0; k < g->indegree[j]; k++) {
+      if (g->revarclist[j][k] == i) {
+        return TRUE;
+      }
+    }
+  }
+  return FALSE;
+}
+
+/*
+ * Test if an arc in either direction between i and j (i.e. either
+ *  i -> j or j -> i) exists
+ *
+ * Parameters:
+ *   g - digraph
+ *   i - node to test arc from/to
+ *   j - node to test arc from/to
+ *
+ * Return value:
+ *   TRUE iff arc i->j or j->i exists
+ */
+bool isArcIgnoreDirection(const digraph_t *g, uint_t i, uint_t j)
+{
+  return isArc(g, i, j) || isArc(g, j, i);
+}
+
+/*
+ * First stage of prefetching what a proposal to toggle arc i -> j will
+ * read, for a proposal some way ahead of the one being evaluated: the
+ * per-node entries of i and j (degrees, adjacency list pointers, hub
+ * set headers and alternating star cache) and the bit matrix word for
+ * i -> j. The adjacency lists themselves can only be prefetched once
+ * these have arrived, by prefetch_dyad_lists().
+ *
+ * Parameters:
+ *   g - digraph
+ *   i - node arc is from
+ *   j - node arc is to
+ *
+ * Return value:
+ *   None
+ */
+void prefetch_dyad_nodes(const digraph_t *g, uint_t i, uint_t j)
+{
+  if (g->arcbitmatrix)
+    PREFETCH(&g->arcbitmatrix[INDEX2D(i, j, g->num_nodes) / 64]);
+  PREFETCH(&g->outdegree[i]);
+  PREFETCH(&g->indegree[i]);
+  PREFETCH(&g->outdegree[j]);
+  PREFETCH(&g->indegree[j]);
+  PREFETCH(&g->arclist[i]);
+  PREFETCH(&g->revarclist[i]);
+  PREFETCH(&g->arclist[j]);
+  PREFETCH(&g->revarclist[j]);
+  PREFETCH(&g->outhubset[i]);
+  PREFETCH(&g->inhubset[j]);
+  if (g->altinstar)
+    PREFETCH(&g->altinstar[2*j]);
+  if (g->altoutstar)
+    PREFETCH(&g->altoutstar[2*i]);
+}
+
+/*
+ * Second stage of prefetching for a proposal to toggle arc i -> j,
+ * after prefetch_dyad_nodes() for it: the start of the adjacency lists
+ * of i and j and the two-path count of i -> v -> j.
+ *
+ * Parameters:
+ *   g - digraph
+ *   i - node arc is from
+ *   j - node arc is to
+ *
+ * Return value:
+ *   None
+ */
+void prefetch_dyad_lists(const digraph_t *g, uint_t i, uint_t j)
+{
+  /* (prefetching the NULL list of a node with no arcs is harmless) */
+  PREFETCH(g->arclist[i]);
+  PREFETCH(g->revarclist[i]);
+  PREFETCH(g->arclist[j]);
+  PREFETCH(g->revarclist[j]);
+  PREFETCH_MIX2PATH_ENTRY(g, i, j);
+}
+
+/*
+ * Set the cached alternating star change statistics of a node for
+ * adding and deleting an arc (see set_altstar_cache()) from its degree.
+ * They are computed exactly as changeAltInStars() and changeAltOutStars()
+ * compute them, so that using them gives identical results.
+ *
+ * Parameters:
+ *   cache  - altinstar or altoutstar array of digraph
+ *   lambda - decay parameter of the statistic
+ *   v      - node to set values of
+ *   degree - in-degree (altinstar) or out-degree (altoutstar) of v
+ *
+ * Return value:
+ *   None
+ */
+static void set_altstar_entry(double *cache, double lambda, uint_t v,
+                              uint_t degree)
+{
+  cache[2*v] = lambda * (1 - POW_LOOKUP(1-1/lambda, degree));
+  cache[2*v+1] = degree > 0 ?
+    lambda * (1 - POW_LOOKUP(1-1/lambda, degree - 1)) : 0;
+}
+
+/*
+ * Allocate an empty dyad cache (see set_dyad_cache()).
+ *
+ * Parameters:
+ *   num_nodes - number of nodes in the digraph
+ *   num_stats - number of change statistics of each dyad
+ *
+ * Return value:
+ *   Dyad cache with no valid entries, to be freed with free_dyad_cache()
+ */
+static dyad_cache_t *allocate_dyad_cache(uint_t num_nodes, uint_t num_stats)
+{
+  dyad_cache_t *dc = (dyad_cache_t *)safe_malloc(sizeof(dyad_cache_t));
+  size_t        num_dyads = (size_t)num_nodes * num_nodes;
+  uint_t        v;
+
+  dc->num_stats = num_stats;
+  dc->version = (uint32_t *)safe_malloc((size_t)num_nodes * sizeof(uint32_t));
+  for (v = 0; v < num_nodes; v++)
+    dc->version[v] = 1;
+  dc->stamp = (uint64_t *)large_calloc(num_dyads, sizeof(uint64_t));
+  dc->stats = (double *)large_calloc(num_dyads * num_stats, sizeof(double));
+  dc->hits = dc->misses = 0;
+  return dc;
+}
+
+/*
+ * Free a dyad cache allocated with allocate_dyad_cache().
+ *
+ * Parameters:
+ *   dc        - dyad cache
+ *   num_nodes - number of nodes in the digraph
+ *
+ * Return value:
+ *   None
+ */
+static void free_dyad_cache(dyad_cache_t *dc, uint_t num_nodes)
+{
+  size_t num_dyads = (size_t)num_nodes * num_nodes;
+
+  free(dc->version);
+  large_free(dc->stamp, num_dyads, sizeof(uint64_t));
+  large_free(dc->stats, num_dyads * dc->num_stats, sizeof(double));
+  free(dc);
+}
+
+/*
+ * Copy a category pair table (see cat_pair_table_t), for a clone of
+ * the digraph it is for.
+ *
+ * Parameters:
+ *    t         - category pair table
+ *    num_nodes - number of nodes in the digraph
+ *
+ * Return value:
+ *    Copy of t, to be freed with free_cat_pair_table().
+ */
+static cat_pair_table_t *clone_cat_pair_table(const cat_pair_table_t *t,
+                                              uint_t num_nodes)
+{
+  cat_pair_table_t *c = (cat_pair_table_t *)safe_malloc(
+    sizeof(cat_pair_table_t));
+  size_t entries = (size_t)t->num_codes * t->num_codes;
+  uint_t num_terms = t->n_attr + t->n_attr_interaction;
+
+  *c = *t;
+  c->node_code = (uint32_t *)safe_malloc(MAX(num_nodes, 1) *
+                                         sizeof(uint32_t));
+  memcpy(c->node_code, t->node_code, num_nodes * sizeof(uint32_t));
+  c->pair_bits = (uint32_t *)safe_malloc(entries * sizeof(uint32_t));
+  memcpy(c->pair_bits, t->pair_bits, entries * sizeof(uint32_t));
+  c->terms = (cat_pair_term_t *)safe_malloc(MAX(num_terms, 1) *
+                                            sizeof(cat_pair_term_t));
+  memcpy(c->terms, t->terms, num_terms * sizeof(cat_pair_term_t));
+  return c;
+}
+
+/*
+ * Invalidate all the entries of a dyad cache, for when a node version
+ * wraps around (so an old entry could match it again) or the nodes
+ * are renumbered.
+ *
+ * Parameters:
+ *   dc        - dyad cache
+ *   num_nodes - number of nodes in the digraph
+ *
+ * Return value:
+ *   None
+ */
+static void clear_dyad_cache(dyad_cache_t *dc, uint_t num_nodes)
+{
+  uint_t v;
+
+  for (v = 0; v < num_nodes; v++)
+    dc->version[v] = 1;
+  memset(dc->stamp, 0, (size_t)num_nodes * num_nodes * sizeof(uint64_t));
+}
+
+/*
+ * Increment the versions in the dyad cache of nodes i and j and of all
+ * their neighbours when arc i -> j is inserted or removed, as the
+ * change statistics of every dyad with one of them as an end may have
+ * changed (see dyad_cache_t).
+ *
+ * Parameters:
+ *   g - digraph, with a dyad cache
+ *   i - node arc is from
+ *   j - node arc is to
+ *
+ * Return value:
+ *   None
+ */
+static void touch_dyad_cache(digraph_t *g, uint_t i, uint_t j)
+{
+  uint32_t *version = g->dyad_cache->version;
+  uint32_t  wrapped = 0; /* zero unless some version wrapped to 0 */
+  uint_t    k;
+
+  wrapped |= !++version[i];
+  wrapped |= !++version[j];
+  for (k = 0; k < g->outdegree[i]; k++)
+    wrapped |= !++version[g->arclist[i][k]];
+  for (k = 0; k < g->indegree[i]; k++)
+    wrapped |= !++version[g->revarclist[i][k]];
+  for (k = 0; k < g->outdegree[j]; k++)
+    wrapped |= !++version[g->arclist[j][k]];
+  for (k = 0; k < g->indegree[j]; k++)
+    wrapped |= !++version[g->revarclist[j][k]];
+  if (wrapped)
+    clear_dyad_cache(g->dyad_cache, g->num_nodes);
+}
+
+/*
+ * Update what depends on the arc lists other than the two-path tables
+ * after arc i -> j has been added to or removed from them (and the
+ * degrees changed): the hub sets, bit matrix, alternating star cache,
+ * dyad cache and zone information.
+ *
+ * Parameters:
+ *   g     - digraph
+ *   i     - node arc is from
+ *   j     - node arc is to
+ *   isAdd - TRUE for inserting arc, FALSE for deleting arc
+ *
+ * Return value:
+ *   None
+ */
+static inline void update_arc_node_state(digraph_t *g, uint_t i, uint_t j,
+                                         bool isAdd)
+{
+  updateHubSets(g, i, j, isAdd);
+  if (g->arcbitmatrix) {
+    if (isAdd)
+      ARC_BIT_SET(g->arcbitmatrix, INDEX2D(i, j, g->num_nodes));
+    else
+      ARC_BIT_CLEAR(g->arcbitmatrix, INDEX2D(i, j, g->num_nodes));
+  }
+  if (g->altinstar)
+    set_altstar_entry(g->altinstar, g->altinstar_lambda, j, g->indegree[j]);
+  if (g->altoutstar)
+    set_altstar_entry(g->altoutstar, g->altoutstar_lambda, i,
+                      g->outdegree[i]);
+  if (g->dyad_cache)
+    touch_dyad_cache(g, i, j);
+
+  /* update zone information for snowball conditional estimation
+     (all nodes are in zone 0 if there is no snowball sample) */
+  if (g->max_zone > 0) {
+    if (g->zone[i] > g->zone[j]) {
+      assert(isAdd ? g->zone[i] == g->zone[j] + 1 :
+             g->prev_wave_degree[i] > 1);
+      if (isAdd)
+        g->prev_wave_degree[i]++;
+      else
+        g->prev_wave_degree[i]--;
+      update_prev_wave_tie(g, i, i, j, isAdd);
+    } else if (g->zone[j] > g->zone[i]) {
+      assert(isAdd ? g->zone[j] == g->zone[i] + 1 :
+             g->prev_wave_degree[j] > 1);
+      if (isAdd)
+        g->prev_wave_degree[j]++;
+      else
+        g->prev_wave_degree[j]--;
+      update_prev_wave_tie(g, j, i, j, isAdd);
+    }
+  }
+}
+
+/*
+ * Insert arc i -> j into digraph g, updating everything but the
+ * two-path tables (and cache) and the flat arc lists: the adjacency
+ * lists and degrees, hub sets, bit matrix, alternating star cache and
+ * zone information. Used by insertArc() and by apply_arc_batch() when
+ * it rebuilds the two-path tables after the batch instead.
+ *
+ * Parameters:
+ *   g - digraph
+ *   i - node to insert arc from
+ *   j - node to insert arc to
+ *
+ * Return value:
+ *   None
+ */
+static inline void insert_arc_nodes(digraph_t *g, uint_t i, uint_t j)
+{
+  assert(i < g->num_nodes);
+  assert(j < g->num_nodes);
+  g->num_arcs++;
+  adjlist_reserve(&g->adjarena, &g->arclist[i], g->outdegree[i],
+                  &g->outcapacity[i]);
+  adjlist_reserve(&g->adjarena, &g->revarclist[j], g->indegree[j],
+                  &g->incapacity[j]);
+#ifdef ORDERED_ARCLIST
+  sorted_list_insert(g->arclist[i], g->outdegree[i]++, j);
+  sorted_list_insert(g->revarclist[j], g->indegree[j]++, i);
+#else
+  g->arclist[i][g->outdegree[i]++] = j;
+  g->revarclist[j][g->indegree[j]++] = i;
+#endif /* ORDERED_ARCLIST */
+  DIGRAPH_DEBUG_PRINT(("insertArc %u -> %u indegree(%u) = %u outdegre(%u) = %u\n", i, j, j, g->indegree[j], i, g->outdegree[i]));
+  /*removed as slows significantly: assert(isArc(g, i, j));*/
+  update_arc_node_state(g, i, j, TRUE);
+}
+
+/*
+ * Insert arc i -> j into digraph g, WITHOUT updating allarcs flat arc list
+ *
+ * Parameters:
+ *   g - digraph
+ *   i - node to insert arc from
+ *   j - node to insert arc to
+ *
+ * Return value:
+ *   None
+ */
+void insertArc(digraph_t *g, uint_t i, uint_t j)
+{
+#ifdef PROFILE_CHANGESTATS
+  uint64_t prof_t;
+#endif /* PROFILE_CHANGESTATS */
+
+  PROFILE_START(prof_t);
+  insert_arc_nodes(g, i, j);
+#if defined(TWOPATH_LOOKUP) || defined(TWOPATH_ADAPTIVE)
+  updateTwoPathsMatrices(g, i, j, TRUE);
+#endif /* TWOPATH_LOOKUP || TWOPATH_ADAPTIVE */
+#ifdef TWOPATH_CACHE
+  touch_twopath_stamps(g, i, j);
+#endif /* TWOPATH_CACHE */
+  PROFILE_OP(PROFILE_OP_INSERT_ARC, prof_t, g, i, j);
+}
+
+/*
+ * Remove arc i -> j from digraph g, updating everything but the
+ * two-path tables (and cache) and the flat arc lists, the counterpart
+ * of insert_arc_nodes().
+ *
+ * Parameters:
+ *   g      - digraph
+ *   i      - node to remove arc from
+ *   j      - node to remove arc to
+ *   outpos - (output) position j was removed from in arclist[i]
+ *   inpos  - (output) position i was removed from in revarclist[j]
+ *            (neither is set with ORDERED_ARCLIST, as the lists are
+ *            kept sorted so an arc has only one place to go back to)
+ *
+ * Return value:
+ *   None
+ */
+static inline void remove_arc_nodes(digraph_t *g, uint_t i, uint_t j,
+                                    uint_t *outpos, uint_t *inpos)
+{
+#ifndef ORDERED_ARCLIST
+  uint_t k;
+#endif /* ORDERED_ARCLIST */
+
+  DIGRAPH_DEBUG_PRINT(("removeArc %u -> %u indegree(%u) = %u outdegre(%u) = %u\n", i, j, j, g->indegree[j], i, g->outdegree[i]));
+  /*removed as slows significantly: assert(isArc(g, i, j));*/
+  assert(i < g->num_nodes);
+  assert(j < g->num_nodes);
+  assert(g->num_arcs > 0);
+  assert(g->outdegree[i] > 0);
+  assert(g->indegree[j] > 0);
+#ifdef ORDERED_ARCLIST
+  /* find the entry for j in the (sorted) arc list by binary search and
+     then move everything after it back one, overwriting it.
+     Same for reverse arc list. */
+  sorted_list_remove(g->arclist[i], g->outdegree[i], j);
+  sorted_list_remove(g->revarclist[j], g->indegree[j], i);
+#else
+  /* arclist is not ordered, so  just replace deleted entry
+     with last entry */
+  for (k = 0; k < g->outdegree[i] && g->arclist[i][k] != j; k++)
+    /*nothing*/;
+  assert(g->arclist[i][k] == j);
+  g->arclist[i][k] = g->arclist[i][g->outdegree[i]-1];
+  *outpos = k;
+  for (k = 0; k < g->indegree[j] && g->revarclist[j][k] != i; k++)
+    /*nothing*/;
+  assert(g->revarclist[j][k] == i);
+  g->revarclist[j][k] = g->revarclist[j][g->indegree[j]-1];
+  *inpos = k;
+#endif
+
+  g->num_arcs--;
+  g->outdegree[i]--;
+  g->indegree[j]--;
+  update_arc_node_state(g, i, j, FALSE);
+}
+
+/*
+ * Remove arc i -> j from digraph g, WITHOUT updating allarcs flat arc
+ * list, as removeArc(), also giving the positions it was removed from
+ * in the adjacency lists, for the arc journal.
+ *
+ * Parameters:
+ *   g      - digraph
+ *   i      - node to remove arc from
+ *   j      - node to remove arc to
+ *   outpos - (output) position j was removed from in arclist[i]
+ *   inpos  - (output) position i was removed from in revarclist[j]
+ *
+ * Return value:
+ *   None
+ */
+static void remove_arc_recorded(digraph_t *g, uint_t i, uint_t j,
+                                uint_t *outpos, uint_t *inpos)
+{
+#ifdef PROFILE_CHANGESTATS
+  uint64_t prof_t;
+#endif /* PROFILE_CHANGESTATS */
+
+  PROFILE_START(prof_t);
+  remove_arc_nodes(g, i, j, outpos, inpos);
+#if defined(TWOPATH_LOOKUP) || defined(TWOPATH_ADAPTIVE)
+  updateTwoPathsMatrices(g, i, j, FALSE);
+#endif /* TWOPATH_LOOKUP || TWOPATH_ADAPTIVE */
+#ifdef TWOPATH_CACHE
+  touch_twopath_stamps(g, i, j);
+#endif /* TWOPATH_CACHE */
+  PROFILE_OP(PROFILE_OP_REMOVE_ARC, prof_t, g, i, j);
+}
+
+/*
+ * Remove arc i -> j from digraph g, WITHOUT updating allarcs flat arc list
+ *
+ * Parameters:
+ *   g - digraph
+ *   i - node to remove arc from
+ *   j - node to remove arc to
+ *
+ * Return value:
+ *   None
+ */
+void removeArc(digraph_t *g, uint_t i, uint_t j)
+{
+  uint_t outpos, inpos;
+
+  remove_arc_recorded(g, i, j, &outpos, &inpos);
+}
+
+
+/*
+ * Append arc i -> j, just inserted (so counted in g->num_arcs), to the
+ * allarcs flat arc list.
+ *
+ * Parameters:
+ *   g - digraph
+ *   i - node arc is from
+ *   j - node arc is to
+ *
+ * Return value:
+ *   None
+ */
+static void append_allarcs(digraph_t *g, uint_t i, uint_t j)
+{
+  if (g->num_arcs > g->allarcs_capacity) {
+    g->allarcs_capacity = MAX(g->num_arcs, 2 * g->allarcs_capacity);
+    g->allarcs = (nodepair_t *)safe_realloc(g->allarcs, g->allarcs_capacity *
+                                            sizeof(nodepair_t));
+  }
+  g->allarcs[g->num_arcs-1].i = i;
+  g->allarcs[g->num_arcs-1].j = j;
+  arcindex_put(&g->allarcs_index, i, j, g->num_arcs-1);
+}
+
+/*
+ * Insert arc i -> j into digraph g, updating allarcs flat arc list
+ *
+ * Parameters:
+ *   g - digraph
+ *   i - node to insert arc from
+ *   j - node to insert arc to
+ *
+ * Return value:
+ *   None
+ */
+void insertArc_allarcs(digraph_t *g, uint_t i, uint_t j)
+{
+  insertArc(g, i, j);
+  append_allarcs(g, i, j);
+}
+
+
+/*
+ * Delete arc i -> j, just removed (so no longer counted in
+ * g->num_arcs), from position arcidx of the allarcs flat arc list.
+ *
+ * Parameters:
+ *   g      - digraph
+ *   i      - node arc is from
+ *   j      - node arc is to
+ *   arcidx - index in allarcs of the i->j entry
+ *
+ * Return value:
+ *   None
+ */
+static void delete_allarcs(digraph_t *g, uint_t i, uint_t j, arcidx_t arcidx)
+{
+  /* remove entry from the flat all arcs list */
+  assert(g->allarcs[arcidx].i == i && g->allarcs[arcidx].j == j);
+  /* replace deleted entry with last entry */
+  /* g->num_arcs already decremented by removeArc() */
+  g->allarcs[arcidx].i = g->allarcs[g->num_arcs].i;
+  g->allarcs[arcidx].j = g->allarcs[g->num_arcs].j;
+  arcindex_delete(&g->allarcs_index, i, j);
+  if (arcidx != g->num_arcs)
+    arcindex_put(&g->allarcs_index, g->allarcs[arcidx].i,
+                 g->allarcs[arcidx].j, arcidx);
+}
+
+/*
+ * Remove arc i -> j from digraph g, updating allarcs flat arc list
+ *
+ * Parameters:
+ *   g - digraph
+ *   i - node to remove arc from
+ *   j - node to remove arc to
+ *   arcidx - index in allarcs flat arc list of the i->j entry, either
+ *            known as the arc has been selected from this list, or
+ *            from get_allarcs_index()
+ *
+ * Return value:
+ *   None
+ */
+void removeArc_allarcs(digraph_t *g, uint_t i, uint_t j, arcidx_t arcidx)
+{
+  removeArc(g, i, j);
+  delete_allarcs(g, i, j, arcidx);
+}
+
+
+/*
+ * Get the position of arc i -> j in the allarcs flat arc list, so that
+ * any arc (not just one selected from the list) can be removed with
+ * removeArc_allarcs() in O(1) time.
+ *
+ * Parameters:
+ *   g - digraph
+ *   i - node arc is from
+ *   j - node arc is to (arc i -> j must be in allarcs)
+ *
+ * Return value:
+ *   index of i -> j in allarcs
+ */
+arcidx_t get_allarcs_index(const digraph_t *g, uint_t i, uint_t j)
+{
+  return arcindex_get(&g->allarcs_index, i, j);
+}
+
+
+/*
+ * Append arc i -> j, just inserted, to the allinnerarcs flat arc list.
+ *
+ * Parameters:
+ *   g - digraph
+ *   i - node arc is from
+ *   j - node arc is to
+ *
+ * Return value:
+ *   None
+ */
+static void append_allinnerarcs(digraph_t *g, uint_t i, uint_t j)
+{
+  g->num_inner_arcs++;
+  g->allinnerarcs = (nodepair_t *)safe_realloc(g->allinnerarcs,
+                                               g->num_inner_arcs *
+                                               sizeof(nodepair_t));
+  g->allinnerarcs[g->num_inner_arcs-1].i = i;
+  g->allinnerarcs[g->num_inner_arcs-1].j = j;
+  arcindex_put(&g->allinnerarcs_index, i, j, g->num_inner_arcs-1);
+  if (g->deletable_inner_tree &&
+      g->num_inner_arcs > g->deletable_inner_tree_size)
+    build_deletable_inner_tree(g, 2 * g->deletable_inner_tree_size);
+  else
+    set_inner_arc_deletable(g, g->num_inner_arcs-1,
+                            is_deletable_inner_arc(g, i, j));
+}
+
+/*
+ * Insert arc i -> j into digraph g, updating allinnerarcs flat arc list
+ *
+ * Used for conditional estimation when we must add an arc that is
+ * between nodes in inner zones and in same zone or adjacent zones only.
+ *
+ * Parameters:
+ *   g - digraph
+ *   i - node to insert arc from
+ *   j - node to insert arc to
+ *
+ * Return value:
+ *   None
+ */
+void insertArc_allinnerarcs(digraph_t *g, uint_t i, uint_t j)
+{
+  assert(g->zone[i] < g->max_zone && g->zone[j] < g->max_zone);
+  assert(labs((long)g->zone[i] - (long)g->zone[j]) <= 1);
+  insertArc(g, i, j);
+  append_allinnerarcs(g, i, j);
+}
+
+
+/*
+ * Delete arc i -> j, just removed, from position arcidx of the
+ * allinnerarcs flat arc list.
+ *
+ * Parameters:
+ *   g      - digraph
+ *   i      - node arc is from
+ *   j      - node arc is to
+ *   arcidx - index in allinnerarcs of the i->j entry
+ *
+ * Return value:
+ *   None
+ */
+static void delete_allinnerarcs(digraph_t *g, uint_t i, uint_t j,
+                                arcidx_t arcidx)
+{
+  /* remove entry from the flat all arcs list */
+  assert(g->allinnerarcs[arcidx].i == i && g->allinnerarcs[arcidx].j == j);
+  /* replace deleted entry with last entry */
+  g->num_inner_arcs--;
+  g->allinnerarcs[arcidx].i = g->allinnerarcs[g->num_inner_arcs].i;
+  g->allinnerarcs[arcidx].j = g->allinnerarcs[g->num_inner_arcs].j;
+  arcindex_delete(&g->allinnerarcs_index, i, j);
+  if (arcidx != g->num_inner_arcs) {
+    arcindex_put(&g->allinnerarcs_index, g->allinnerarcs[arcidx].i,
+                 g->allinnerarcs[arcidx].j, arcidx);
+    set_inner_arc_deletable(g, arcidx,
+                            is_deletable_inner_arc(g,
+                                                   g->allinnerarcs[arcidx].i,
+                                                   g->allinnerarcs[arcidx].j));
+  }
+  set_inner_arc_deletable(g, g->num_inner_arcs, FALSE);
+}
+
+/*
+ * Remove arc i -> j from digraph g, updating allinnerarcs flat arc list
+ *
+ * Used for conditional estimation when we must delete an arc that is
+ * between nodes in inner zones and in same zone or adjacent zones only.
+ *
+ * Parameters:
+ *   g - digraph
+ *   i - node to remove arc from
+ *   j - node to remove arc to
+ *   arcidx - index in allinnerarcs flat arc list of the i->j entry, either
+ *            known as the arc has been selected from this list, or
+ *            from get_allinnerarcs_index()
+ *
+ * Return value:
+ *   None
+ */
+void removeArc_allinnerarcs(digraph_t *g, uint_t i, uint_t j,
+                            arcidx_t arcidx)
+{
+  assert(g->zone[i] < g->max_zone && g->zone[j] < g->max_zone);
+  assert(labs((long)g->zone[i] - (long)g->zone[j]) <= 1);
+  removeArc(g, i, j);
+  delete_allinnerarcs(g, i, j, arcidx);
+}
+
+
+/*
+ * Get the position of arc i -> j in the allinnerarcs flat arc list, so
+ * that any inner wave arc can be removed with removeArc_allinnerarcs()
+ * in O(1) time.
+ *
+ * Parameters:
+ *   g - digraph
+ *   i - node arc is from
+ *   j - node arc is to (arc i -> j must be in allinnerarcs)
+ *
+ * Return value:
+ *   index of i -> j in allinnerarcs
+ */
+arcidx_t get_allinnerarcs_index(const digraph_t *g, uint_t i, uint_t j)
+{
+  return arcindex_get(&g->allinnerarcs_index, i, j);
+}
+
+/*
+ * Get the position in the allinnerarcs flat arc list of the k-th (from
+ * 0) of the arcs that can be deleted in conditional estimation, i.e.
+ * those that are not the last tie of a node to the preceding wave, so
+ * that one can be chosen uniformly at random in O(log num_inner_arcs)
+ * time.
+ *
+ * Parameters:
+ *   g - digraph with zone information
+ *   k - which deletable arc, less than g->num_deletable_inner_arcs
+ *
+ * Return value:
+ *   index in allinnerarcs of the k-th deletable arc
+ */
+arcidx_t get_deletable_inner_arc(const digraph_t *g, arcidx_t k)
+{
+  arcidx_t pos = 0, step;
+
+  assert(g->deletable_inner_tree && k < g->num_deletable_inner_arcs);
+  /* descend the Fenwick tree to the last position with at most k
+     deletable arcs before it */
+  for (step = g->deletable_inner_tree_size; step > 0; step /= 2) {
+    if (pos + step <= g->deletable_inner_tree_size &&
+        g->deletable_inner_tree[pos + step] <= k) {
+      pos += step;
+      k -= g->deletable_inner_tree[pos];
+    }
+  }
+  assert(pos < g->num_inner_arcs);
+  assert(is_deletable_inner_arc(g, g->allinnerarcs[pos].i,
+                                g->allinnerarcs[pos].j));
+  return pos;
+}
+
+/*
+ * Number of inner arcs that would be deletable in conditional
+ * estimation after inserting or removing inner arc i -> j, without
+ * changing g. Removing an arc can also make the other tie of a node to
+ * the preceding wave its last one, and inserting one can give a node
+ * with only one such tie a second, making both deletable.
+ *
+ * Parameters:
+ *   g        - digraph with zone information
+ *   i        - node arc is from
+ *   j        - node arc is to
+ *   isDelete - TRUE if arc i -> j (deletable) is to be removed, else it
+ *              is to be inserted
+ *
+ * Return value:
+ *   number of deletable inner arcs after the move
+ */
+arcidx_t num_deletable_inner_arcs_after(const digraph_t *g, uint_t i, uint_t j,
+                                        bool isDelete)
+{
+  uint_t v = g->zone[i] > g->zone[j] ? i : j; /* node in later wave */
+  uint_t prev_degree = g->zone[i] != g->zone[j] ? g->prev_wave_degree[v] : 0;
+
+  if (isDelete)
+    return g->num_deletable_inner_arcs - (prev_degree == 2 ? 2 : 1);
+  if (g->zone[i] == g->zone[j] || prev_degree >= 2)
+    return g->num_deletable_inner_arcs + 1;
+  return g->num_deletable_inner_arcs + (prev_degree == 1 ? 2 : 0);
+}
+
+/*
+ * Add a list of arcs to a digraph with no arcs, as if by calling
+ * insertArc_allarcs() for each arc in order (ignoring any that are
+ * already in g, i.e. duplicates), but without growing the adjacency
+ * lists and updating the two-path tables one arc at a time: the
+ * degrees are counted first so each adjacency list is allocated once
+ * and filled (in the same order as inserting them would), and then
+ * the hub sets, bit matrix and two-path tables are built from the
+ * complete lists. This is much faster for loading large networks.
+ *
+ * Parameters:
+ *   g        - digraph as allocated by allocate_digraph() (with no
+ *              arcs ever inserted), modified
+ *   arcs     - list of arcs
+ *   num_arcs - length of arcs list
+ *
+ * Return value:
+ *   None.
+ */
+void build_digraph_arcs(digraph_t *g, const nodepair_t *arcs,
+                        arcidx_t num_arcs)
+{
+  uint_t   n = g->num_nodes;
+  uint_t   i, j, v;
+  arcidx_t a;
+  size_t   capacity, pos;
+
+  assert(g->num_arcs == 0 && !g->allarcs);
+  /* flat arc list without the duplicates, indexed as it is built */
+  g->allarcs = (nodepair_t *)safe_malloc(num_arcs * sizeof(nodepair_t));
+  g->allarcs_capacity = num_arcs;
+  for (capacity = ARCINDEX_INITIAL_CAPACITY; capacity < 2 * (size_t)num_arcs;
+       capacity *= 2)
+    /*nothing*/;
+  arcindex_free(&g->allarcs_index);
+  arcindex_resize(&g->allarcs_index, capacity);
+  for (a = 0; a < num_arcs; a++) {
+    i = arcs[a].i;
+    j = arcs[a].j;
+    assert(i < n && j < n);
+    pos = arcindex_slot(&g->allarcs_index, i, j);
+    if (g->allarcs_index.keys[pos] == ARC_KEY(i, j))
+      continue; /* duplicate */
+    arcindex_put(&g->allarcs_index, i, j, g->num_arcs);
+    g->allarcs[g->num_arcs++] = arcs[a];
+    g->outdegree[i]++;
+    g->indegree[j]++;
+  }
+
+  /* allocate each adjacency list once, then count the degrees again
+     as the lists are filled */
+  for (v = 0; v < n; v++) {
+    if (g->outdegree[v])
+      adjlist_allocate(&g->adjarena, &g->arclist[v], g->outdegree[v],
+                       &g->outcapacity[v]);
+    if (g->indegree[v])
+      adjlist_allocate(&g->adjarena, &g->revarclist[v], g->indegree[v],
+                       &g->incapacity[v]);
+    g->outdegree[v] = g->indegree[v] = 0;
+  }
+  for (a = 0; a < g->num_arcs; a++) {
+    i = g->allarcs[a].i;
+    j = g->allarcs[a].j;
+    g->arclist[i][g->outdegree[i]++] = j;
+    g->revarclist[j][g->indegree[j]++] = i;
+    if (g->arcbitmatrix)
+      ARC_BIT_SET(g->arcbitmatrix, INDEX2D(i, j, n));
+    if (g->zone[i] > g->zone[j]) {
+      assert(g->zone[i] == g->zone[j] + 1);
+      g->prev_wave_degree[i]++;
+    } else if (g->zone[j] > g->zone[i]) {
+      assert(g->zone[j] == g->zone[i] + 1);
+      g->prev_wave_degree[j]++;
+    }
+  }
+
+  for (v = 0; v < n; v++) {
+#ifdef ORDERED_ARCLIST
+    qsort(g->arclist[v], g->outdegree[v], sizeof(nodeid_t), compare_node);
+    qsort(g->revarclist[v], g->indegree[v], sizeof(nodeid_t), compare_node);
+#endif /* ORDERED_ARCLIST */
+    if (g->hub_threshold && g->outdegree[v] > g->hub_threshold)
+      nodeset_build(&g->outhubset[v], g->arclist[v], g->outdegree[v]);
+    if (g->hub_threshold && g->indegree[v] > g->hub_threshold)
+      nodeset_build(&g->inhubset[v], g->revarclist[v], g->indegree[v]);
+  }
+#ifdef TWOPATH_ADAPTIVE
+  if (g->twopath_backend != TWOPATH_BACKEND_NONE)
+    buildTwoPathTables(g);
+#elif defined(TWOPATH_LOOKUP)
+  buildTwoPathTables(g);
+#endif /* TWOPATH_ADAPTIVE */
+#ifdef TWOPATH_CACHE
+  invalidate_twopath_cache(g);
+#endif /* TWOPATH_CACHE */
+}
+
+/*
+ * Allocate the allarcs flat arc list and the adjacency lists of a
+ * digraph with no arcs with enough capacity for a list of arcs that
+ * will then be inserted one at a time by insertArc_allarcs() (e.g. to
+ * compute the change statistics of each), so they are not grown and
+ * copied repeatedly as the arcs are inserted.
+ *
+ * Parameters:
+ *   g        - digraph as allocated by allocate_digraph() (with no
+ *              arcs ever inserted), modified
+ *   arcs     - list of arcs (duplicates are counted, so the capacity
+ *              may be more than needed)
+ *   num_arcs - length of arcs list
+ *
+ * Return value:
+ *   None.
+ */
+void reserve_digraph_arcs(digraph_t *g, const nodepair_t *arcs,
+                          arcidx_t num_arcs)
+{
+  arcidx_t a;
+  uint_t   v;
+
+  assert(g->num_arcs == 0 && !g->allarcs);
+  if (num_arcs == 0)
+    return;
+  g->allarcs = (nodepair_t *)safe_malloc(num_arcs * sizeof(nodepair_t));
+  g->allarcs_capacity = num_arcs;
+  /* the capacities are counted in outcapacity and incapacity and then
+     replaced by those of the allocated lists */
+  for (a = 0; a < num_arcs; a++) {
+    g->outcapacity[arcs[a].i]++;
+    g->incapacity[arcs[a].j]++;
+  }
+  for (v = 0; v < g->num_nodes; v++) {
+    assert(!g->arclist[v] && !g->revarclist[v]);
+    if (g->outcapacity[v])
+      adjlist_allocate(&g->adjarena, &g->arclist[v], g->outcapacity[v],
+                       &g->outcapacity[v]);
+    if (g->incapacity[v])
+      adjlist_allocate(&g->adjarena, &g->revarclist[v], g->incapacity[v],
+                       &g->incapacity[v]);
+  }
+}
+
+/*
+ * Comparison function for qsort() of nodepair_t arcs by the node the
+ * arc is from, then the node it is to.
+ *
+ * Parameters:
+ *   a, b - pointers to nodepair_t to compare
+ *
+ * Return value:
+ *   <0, 0, >0 if a should come before, is equal to, or after b
+ */
+static int compare_arc(const void *a, const void *b)
+{
+  const nodepair_t *x = (const nodepair_t *)a;
+  const nodepair_t *y = (const nodepair_t *)b;
+
+  if (x->i != y->i)
+    return x->i < y->i ? -1 : 1;
+  return x->j < y->j ? -1 : (x->j > y->j ? 1 : 0);
+}
+
+#if defined(TWOPATH_LOOKUP) || defined(TWOPATH_ADAPTIVE)
+/*
+ * Decide whether apply_arc_batch() should rebuild the two-path tables
+ * from scratch after the batch rather than update them one arc at a
+ * time. Updating them for arc i -> j changes an entry for each
+ * neighbour of i and j, so costs about the sum of their degrees, while
+ * building them visits each two-path through each node, about the sum
+ * over the nodes of the square of the degree. The sum of the squares
+ * is at least (2 num_arcs)^2 / num_nodes, so it is only computed when
+ * the batch could cost more than that.
+ *
+ * Parameters:
+ *   g        - digraph (before the batch)
+ *   adds     - arcs to insert
+ *   num_adds - number of arcs to insert
+ *   dels     - arcs to remove
+ *   num_dels - number of arcs to remove
+ *
+ * Return value:
+ *   TRUE to rebuild the two-path tables, FALSE to update them.
+ */
+static bool arc_batch_rebuilds_twopaths(const digraph_t *g,
+                                        const nodepair_t adds[],
+                                        arcidx_t num_adds,
+                                        const nodepair_t dels[],
+                                        arcidx_t num_dels)
+{
+  double   update_cost = 0, build_cost = 0, degree;
+  arcidx_t a;
+  uint_t   v;
+
+#ifdef TWOPATH_ADAPTIVE
+  if (g->twopath_backend == TWOPATH_BACKEND_NONE)
+    return FALSE; /* no tables */
+#endif /* TWOPATH_ADAPTIVE */
+  for (a = 0; a < num_adds; a++)
+    update_cost += 1 + g->indegree[adds[a].i] + g->outdegree[adds[a].i] +
+      g->indegree[adds[a].j] + g->outdegree[adds[a].j];
+  for (a = 0; a < num_dels; a++)
+    update_cost += 1 + g->indegree[dels[a].i] + g->outdegree[dels[a].i] +
+      g->indegree[dels[a].j] + g->outdegree[dels[a].j];
+  degree = 2.0 * (g->num_arcs + num_adds) / MAX(g->num_nodes, 1);
+  if (update_cost <= degree * degree * g->num_nodes)
+    return FALSE;
+  for (v = 0; v < g->num_nodes; v++) {
+    degree = (double)g->indegree[v] + g->outdegree[v];
+    build_cost += degree * degree;
+  }
+  return update_cost > build_cost;
+}
+#endif /* TWOPATH_LOOKUP || TWOPATH_ADAPTIVE */
+
+/*
+ * Insert and remove a batch of arcs, updating the allarcs (or
+ * allinnerarcs) flat arc list as insertArc_allarcs() and
+ * removeArc_allarcs() (or the allinnerarcs versions) would, but as a
+ * bulk operation. The arcs are applied in node order (each batch
+ * sorted by the node the arc is from, then to), so the changes to the
+ * adjacency lists and two-path tables of each node are together, and
+ * the insertions before the removals (so that, for conditional
+ * estimation, no node loses its last tie to the preceding wave on the
+ * way). If the batch is large enough that updating the two-path tables
+ * one arc at a time would cost more than building them again (see
+ * arc_batch_rebuilds_twopaths()), the tables are instead rebuilt from
+ * scratch after the batch, with buildTwoPathTables().
+ *
+ * Parameters:
+ *   g        - digraph, modified
+ *   adds     - arcs to insert (none already in g, no duplicates)
+ *   num_adds - number of arcs to insert
+ *   dels     - arcs to remove (all in g, none in adds, no duplicates)
+ *   num_dels - number of arcs to remove
+ *   inner    - if True the arcs are inner wave arcs (allinnerarcs) for
+ *              conditional estimation, else allarcs is updated
+ *
+ * Return value:
+ *   None.
+ */
+void apply_arc_batch(digraph_t *g, const nodepair_t adds[], arcidx_t num_adds,
+                     const nodepair_t dels[], arcidx_t num_dels, bool inner)
+{
+  nodepair_t *sorted_adds = NULL, *sorted_dels = NULL;
+  bool        rebuild = FALSE;
+  arcidx_t    a, idx;
+  uint_t      i, j, outpos, inpos;
+#ifdef TWOPATH_ADAPTIVE
+  twopath_backend_e backend = g->twopath_backend;
+#endif /* TWOPATH_ADAPTIVE */
+
+  if (num_adds > 0) {
+    sorted_adds = (nodepair_t *)safe_malloc(num_adds * sizeof(nodepair_t));
+    memcpy(sorted_adds, adds, num_adds * sizeof(nodepair_t));
+    qsort(sorted_adds, num_adds, sizeof(nodepair_t), compare_arc);
+  }
+  if (num_dels > 0) {
+    sorted_dels = (nodepair_t *)safe_malloc(num_dels * sizeof(nodepair_t));
+    memcpy(sorted_dels, dels, num_dels * sizeof(nodepair_t));
+    qsort(sorted_dels, num_dels, sizeof(nodepair_t), compare_arc);
+  }
+#if defined(TWOPATH_LOOKUP) || defined(TWOPATH_ADAPTIVE)
+  rebuild = arc_batch_rebuilds_twopaths(g, adds, num_adds, dels, num_dels);
+#endif /* TWOPATH_LOOKUP || TWOPATH_ADAPTIVE */
+#ifdef TWOPATH_ADAPTIVE
+  if (rebuild)
+    set_twopath_backend(g, TWOPATH_BACKEND_NONE);
+#endif /* TWOPATH_ADAPTIVE */
+
+  for (a = 0; a < num_adds; a++) {
+    i = sorted_adds[a].i;
+    j = sorted_adds[a].j;
+    assert(!isArc(g, i, j));
+    if (rebuild)
+      insert_arc_nodes(g, i, j);
+    else
+      insertArc(g, i, j);
+    if (inner)
+      append_allinnerarcs(g, i, j);
+    else
+      append_allarcs(g, i, j);
+  }
+  for (a = 0; a < num_dels; a++) {
+    i = sorted_dels[a].i;
+    j = sorted_dels[a].j;
+    assert(isArc(g, i, j));
+    idx = inner ? get_allinnerarcs_index(g, i, j) : get_allarcs_index(g, i, j);
+    if (rebuild)
+      remove_arc_nodes(g, i, j, &outpos, &inpos);
+    else
+      removeArc(g, i, j);
+    if (inner)
+      delete_allinnerarcs(g, i, j, idx);
+    else
+      delete_allarcs(g, i, j, idx);
+  }
+
+  if (rebuild) {
+#ifdef TWOPATH_ADAPTIVE
+    set_twopath_backend(g, backend);
+#elif defined(TWOPATH_LOOKUP)
+    resetTwoPathTables(g);
+    buildTwoPathTables(g);
+#endif /* TWOPATH_ADAPTIVE */
+#ifdef TWOPATH_CACHE
+    invalidate_twopath_cache(g);
+#endif /* TWOPATH_CACHE */
+  }
+  free(sorted_adds);
+  free(sorted_dels);
+}
+
+/*
+ * Replace the arcs in the allarcs (or allinnerarcs) flat arc list of a
+ * digraph with those in a given list, in the same order, e.g. to
+ * restore the state of a digraph saved in a checkpoint. Arcs not in g
+ * are inserted before those not in the list are removed, so that (for
+ * conditional estimation) no node loses its last tie to the preceding
+ * wave on the way. Then the flat arc list is put in the order of the
+ * given list, so that arcs chosen from it by position are the same.
+ *
+ * Parameters:
+ *   g        - digraph, modified
+ *   arcs     - list of arcs (no duplicates)
+ *   num_arcs - length of arcs list
+ *   inner    - if True replace inner wave arcs (allinnerarcs) for
+ *              conditional estimation, else all arcs (allarcs)
+ *
+ * Return value:
+ *   None.
+ */
+void replace_digraph_arcs(digraph_t *g, const nodepair_t *arcs,
+                          arcidx_t num_arcs, bool inner)
+{
+  arcindex_t  wanted = {NULL, NULL, 0, 0};
+  nodepair_t *list, *adds, *dels;
+  arcidx_t    k, num_adds = 0, num_dels = 0, num_current;
+  size_t      pos;
+
+  adds = (nodepair_t *)safe_malloc((num_arcs + 1) * sizeof(nodepair_t));
+  for (k = 0; k < num_arcs; k++) {
+    arcindex_put(&wanted, arcs[k].i, arcs[k].j, k);
+    if (!isArc(g, arcs[k].i, arcs[k].j))
+      adds[num_adds++] = arcs[k];
+  }
+  list = inner ? g->allinnerarcs : g->allarcs;
+  num_current = inner ? g->num_inner_arcs : g->num_arcs;
+  dels = (nodepair_t *)safe_malloc((num_current + 1) * sizeof(nodepair_t));
+  for (k = 0; k < num_current; k++) {
+    pos = wanted.capacity ? arcindex_slot(&wanted, list[k].i, list[k].j) : 0;
+    if (!wanted.capacity || wanted.keys[pos] != ARC_KEY(list[k].i, list[k].j))
+      dels[num_dels++] = list[k];
+  }
+  apply_arc_batch(g, adds, num_adds, dels, num_dels, inner);
+  free(adds);
+  free(dels);
+  assert((inner ? g->num_inner_arcs : g->num_arcs) == num_arcs);
+  list = inner ? g->allinnerarcs : g->allarcs;
+  memcpy(list, arcs, num_arcs * sizeof(nodepair_t));
+  arcindex_build(inner ? &g->allinnerarcs_index : &g->allarcs_index,
+                 list, num_arcs);
+  if (inner && g->deletable_inner_tree)
+    build_deletable_inner_tree(g, g->deletable_inner_tree_size);
+  arcindex_free(&wanted);
+}
+
+
+/*
+ * Undo the removal of arc i -> j recorded in journal entry e, putting
+ * the arc back in the slots it was removed from in the adjacency lists
+ * and the flat arc list, and moving the entries that were moved into
+ * those slots back to the ends of the lists.
+ *
+ * Parameters:
+ *   g - digraph
+ *   e - journal entry of the removal (the last not yet undone)
+ *
+ * Return value:
+ *   None
+ */
+static void undo_arc_removal(digraph_t *g, const arc_journal_entry_t *e)
+{
+  uint_t    i = e->i, j = e->j;
+  arcidx_t  last;
+  nodepair_t *list;
+
+  /* removal never shrinks the lists, so there is room for the arc */
+#ifdef ORDERED_ARCLIST
+  sorted_list_insert(g->arclist[i], g->outdegree[i]++, j);
+  sorted_list_insert(g->revarclist[j], g->indegree[j]++, i);
+#else
+  g->arclist[i][g->outdegree[i]++] = g->arclist[i][e->outpos];
+  g->arclist[i][e->outpos] = j;
+  g->revarclist[j][g->indegree[j]++] = g->revarclist[j][e->inpos];
+  g->revarclist[j][e->inpos] = i;
+#endif /* ORDERED_ARCLIST */
+  g->num_arcs++;
+  update_arc_node_state(g, i, j, TRUE);
+#if defined(TWOPATH_LOOKUP) || defined(TWOPATH_ADAPTIVE)
+  updateTwoPathsMatrices(g, i, j, TRUE);
+#endif /* TWOPATH_LOOKUP || TWOPATH_ADAPTIVE */
+#ifdef TWOPATH_CACHE
+  touch_twopath_stamps(g, i, j);
+#endif /* TWOPATH_CACHE */
+
+  if (e->inner) {
+    list = g->allinnerarcs;
+    last = g->num_inner_arcs++;
+  } else {
+    list = g->allarcs;
+    last = g->num_arcs - 1;
+  }
+  list[last] = list[e->arcidx];
+  list[e->arcidx].i = i;
+  list[e->arcidx].j = j;
+  if (e->arcidx != last)
+    arcindex_put(e->inner ? &g->allinnerarcs_index : &g->allarcs_index,
+                 list[last].i, list[last].j, last);
+  arcindex_put(e->inner ? &g->allinnerarcs_index : &g->allarcs_index,
+               i, j, e->arcidx);
+  if (e->inner) {
+    set_inner_arc_deletable(g, last, is_deletable_inner_arc(g, list[last].i,
+                                                            list[last].j));
+    set_inner_arc_deletable(g, e->arcidx, is_deletable_inner_arc(g, i, j));
+  }
+}
+
+/*
+ * Undo the insertion of arc i -> j recorded in journal entry e. As
+ * insertion appends the arc to the lists and everything toggled after
+ * it has already been undone, it is at the end of each of them.
+ *
+ * Parameters:
+ *   g - digraph
+ *   e - journal entry of the insertion (the last not yet undone)
+ *
+ * Return value:
+ *   None
+ */
+static void undo_arc_insertion(digraph_t *g, const arc_journal_entry_t *e)
+{
+  uint_t i = e->i, j = e->j;
+
+#ifdef ORDERED_ARCLIST
+  sorted_list_remove(g->arclist[i], g->outdegree[i], j);
+  sorted_list_remove(g->revarclist[j], g->indegree[j], i);
+#else
+  assert(g->arclist[i][g->outdegree[i]-1] == j);
+  assert(g->revarclist[j][g->indegree[j]-1] == i);
+#endif /* ORDERED_ARCLIST */
+  g->num_arcs--;
+  g->outdegree[i]--;
+  g->indegree[j]--;
+  update_arc_node_state(g, i, j, FALSE);
+#if defined(TWOPATH_LOOKUP) || defined(TWOPATH_ADAPTIVE)
+  updateTwoPathsMatrices(g, i, j, FALSE);
+#endif /* TWOPATH_LOOKUP || TWOPATH_ADAPTIVE */
+#ifdef TWOPATH_CACHE
+  touch_twopath_stamps(g, i, j);
+#endif /* TWOPATH_CACHE */
+
+  if (e->inner) {
+    g->num_inner_arcs--;
+    assert(g->allinnerarcs[g->num_inner_arcs].i == i &&
+           g->allinnerarcs[g->num_inner_arcs].j == j);
+    arcindex_delete(&g->allinnerarcs_index, i, j);
+    set_inner_arc_deletable(g, g->num_inner_arcs, FALSE);
+  } else {
+    assert(g->allarcs[g->num_arcs].i == i && g->allarcs[g->num_arcs].j == j);
+    arcindex_delete(&g->allarcs_index, i, j);
+  }
+}
+
+/*
+ * Start recording arc toggles made with journal_toggle_arc() so that
+ * they can be undone by rollback_arc_journal(). Until the journal is
+ * rolled back or committed, g must not be changed in any other way.
+ *
+ * Parameters:
+ *   g - digraph
+ *
+ * Return value:
+ *   None
+ */
+void begin_arc_journal(digraph_t *g)
+{
+  assert(!g->journal.active);
+  g->journal.len = 0;
+  g->journal.active = TRUE;
+}
+
+/*
+ * Toggle arc i -> j in g, updating the allinnerarcs or allarcs flat
+ * arc list as insertArc_allinnerarcs() etc. do, and record the toggle
+ * in the journal started by begin_arc_journal().
+ *
+ * Parameters:
+ *   g        - digraph
+ *   i        - node arc is from
+ *   j        - node arc is to
+ *   isDelete - TRUE if arc i -> j is in g (and is removed), else it is
+ *              inserted
+ *   inner    - TRUE if the arc is in allinnerarcs (conditional
+ *              estimation), else allarcs
+ *
+ * Return value:
+ *   None
+ */
+void journal_toggle_arc(digraph_t *g, uint_t i, uint_t j, bool isDelete,
+                        bool inner)
+{
+  arc_journal_t       *jn = &g->journal;
+  arc_journal_entry_t *e;
+
+  assert(jn->active);
+  if (jn->len == jn->capacity) {
+    jn->capacity = jn->capacity ? 2 * jn->capacity : 16;
+    jn->entries = (arc_journal_entry_t *)safe_realloc(jn->entries,
+                                                      jn->capacity *
+                                                 sizeof(arc_journal_entry_t));
+  }
+  e = &jn->entries[jn->len++];
+  e->i = (nodeid_t)i;
+  e->j = (nodeid_t)j;
+  e->isDelete = isDelete;
+  e->inner = inner;
+  if (isDelete) {
+    if (inner) {
+      assert(g->zone[i] < g->max_zone && g->zone[j] < g->max_zone);
+      e->arcidx = get_allinnerarcs_index(g, i, j);
+      remove_arc_recorded(g, i, j, &e->outpos, &e->inpos);
+      delete_allinnerarcs(g, i, j, e->arcidx);
+    } else {
+      e->arcidx = get_allarcs_index(g, i, j);
+      remove_arc_recorded(g, i, j, &e->outpos, &e->inpos);
+      delete_allarcs(g, i, j, e->arcidx);
+    }
+  } else {
+    if (inner)
+      insertArc_allinnerarcs(g, i, j);
+    else
+      insertArc_allarcs(g, i, j);
+  }
+}
+
+/*
+ * Undo all the arc toggles recorded since begin_arc_journal(), last
+ * first, leaving g exactly as it was then (including the order of the
+ * adjacency and flat arc lists), and stop recording.
+ *
+ * Parameters:
+ *   g - digraph
+ *
+ * Return value:
+ *   None
+ */
+void rollback_arc_journal(digraph_t *g)
+{
+  arc_journal_t *jn = &g->journal;
+
+  assert(jn->active);
+  while (jn->len > 0) {
+    jn->len--;
+    if (jn->entries[jn->len].isDelete)
+      undo_arc_removal(g, &jn->entries[jn->len]);
+    else
+      undo_arc_insertion(g, &jn->entries[jn->len]);
+  }
+  jn->active = FALSE;
+}
+
+/*
+ * Keep the arc toggles recorded since begin_arc_journal() and stop
+ * recording.
+ *
+ * Parameters:
+ *   g - digraph
+ *
+ * Return value:
+ *   None
+ */
+void commit_arc_journal(digraph_t *g)
+{
+  assert(g->journal.active);
+  g->journal.len = 0;
+  g->journal.active = FALSE;
+}
+
+
+
+/*
+ * Allocate the  digraph structure for empty digraph with given
+ * number of nodes.
+ *
+ * Parameters:
+ *    num_vertices - number of nodes in digraph
+ *
+ * Return values:
+ *    Allocated and initizlied to empty digraph (exits if there are
+ *    more than MAX_NUM_NODES nodes)
+ */
+digraph_t *allocate_digraph(uint_t num_vertices)
+{
+  digraph_t *g;
+
+#ifdef NODEID16
+  if (num_vertices > MAX_NUM_NODES) {
+    fprintf(stderr, "ERROR: %u nodes but this build (NODEID16) allows at "
+            "most %u\n", num_vertices, MAX_NUM_NODES);
+    exit(1);
+  }
+#endif /* NODEID16 */
+  g = (digraph_t *)safe_malloc(sizeof(digraph_t));
+  g->num_nodes = num_vertices;
+  g->num_arcs = 0;
+  g->outdegree = (uint_t *)safe_calloc((size_t)num_vertices, sizeof(uint_t));
+  g->arclist = (nodeid_t **)safe_calloc((size_t)num_vertices,
+                                        sizeof(nodeid_t *));
+  g->indegree = (uint_t *)safe_calloc((size_t)num_vertices, sizeof(uint_t));
+  g->revarclist = (nodeid_t **)safe_calloc((size_t)num_vertices,
+                                           sizeof(nodeid_t *));
+  g->outcapacity = (uint_t *)safe_calloc((size_t)num_vertices, sizeof(uint_t));
+  g->incapacity = (uint_t *)safe_calloc((size_t)num_vertices, sizeof(uint_t));
+  memset(&g->adjarena, 0, sizeof(adjarena_t));
+  g->hub_threshold = DEFAULT_HUB_DEGREE_THRESHOLD;
+  g->build_threads = 1;
+  g->update_threads = 1;
+  g->hub_update_degree = DEFAULT_HUB_UPDATE_DEGREE;
+  g->update_pool = NULL;
+  g->outhubset = (nodeset_t *)safe_calloc((size_t)num_vertices,
+                                          sizeof(nodeset_t));
+  g->inhubset = (nodeset_t *)safe_calloc((size_t)num_vertices,
+                                         sizeof(nodeset_t));
+  g->arcbitmatrix = NULL;
+  g->allarcs = NULL;
+  g->allarcs_capacity = 0;
+  memset(&g->allarcs_index, 0, sizeof(arcindex_t));
+  memset(&g->journal, 0, sizeof(arc_journal_t));
+  g->orig_node = NULL;
+  g->node_ids = NULL;
+  g->pending_arcs = NULL;
+  g->num_pending_arcs = 0;
+
+#ifdef TWOPATH_ADAPTIVE
+  /* no two-path tables until set_twopath_backend() is used to choose some */
+  g->twopath_backend = TWOPATH_BACKEND_NONE;
+  g->twopath_tables = TWOPATH_TABLES_ALL;
+  g->twopath_hub_cutoff = UINT_MAX;
+  g->twopath_hub = NULL;
+  g->hub_out = NULL;
+  g->hub_in = NULL;
+  g->mixTwoPathNodeTabs = NULL;
+  g->inTwoPathNodeTabs = NULL;
+  g->outTwoPathNodeTabs = NULL;
+  g->mixTwoPathMatrix = NULL;
+  g->inTwoPathMatrix = NULL;
+  g->outTwoPathMatrix = NULL;
+  memset(&g->mixTwoPathHashTab, 0, sizeof(twopath_hashtab_t));
+  memset(&g->inTwoPathHashTab, 0, sizeof(twopath_hashtab_t));
+  memset(&g->outTwoPathHashTab, 0, sizeof(twopath_hashtab_t));
+  memset(&g->mixTwoPathSpill, 0, sizeof(twopath_hashtab_t));
+  memset(&g->inTwoPathSpill, 0, sizeof(twopath_hashtab_t));
+  memset(&g->outTwoPathSpill, 0, sizeof(twopath_hashtab_t));
+#elif defined(TWOPATH_WITH_UTHASH)
+  g->mixTwoPathHashTab = NULL;
+  g->inTwoPathHashTab = NULL;
+  g->outTwoPathHashTab = NULL;
+  memset(&g->twopath_pool, 0, sizeof(twopath_pool_t));
+
+  assert(sizeof(void *) == 8); /* require 64 bit addressing for large uthash */
+#ifdef DEBUG_MEMUSAGE
+#ifdef HASH_BLOOM
+  /* https://troydhanson.github.io/uthash/userguide.html#_bloom_filter_faster_misses */
+  MEMUSAGE_DEBUG_PRINT(("Bloom filter n = %u overhead %f MB (three times)\n",
+                        HASH_BLOOM, (pow(2, HASH_BLOOM)/8192)/(1024)));
+#endif /* HASH_BLOOM */
+#endif /* DEBUG_MEMUSAGE */
+#elif defined(TWOPATH_WITH_OAHASH)
+  /* open addressing hash table, allocated on first insertion */
+  memset(&g->mixTwoPathHashTab, 0, sizeof(twopath_hashtab_t));
+  memset(&g->inTwoPathHashTab, 0, sizeof(twopath_hashtab_t));
+  memset(&g->outTwoPathHashTab, 0, sizeof(twopath_hashtab_t));
+#elif defined(TWOPATH_WITH_ARRAYS)
+  allocateTwoPathArrays(g);
+#endif /* TWOPATH_ADAPTIVE */
+  
+  g->num_binattr = 0;
+  g->binattr_names = NULL;
+  g->binattr = NULL;
+  g->binattr_na = NULL;
+  g->num_catattr = 0;
+  g->catattr_names = NULL;
+  g->catattr = NULL;
+  g->catattr_width = NULL;
+  g->num_contattr = 0;
+  g->contattr_names = NULL;
+  g->contattr = NULL;
+  g->contattr_term = NULL;
+  g->num_setattr = 0;
+  g->setattr_names = NULL;
+  g->setattr_lengths = NULL;
+  g->setattr = NULL;
+  g->setattr_bits = NULL;
+  g->setattr_na = NULL;
+  g->num_dyadcov = 0;
+  g->dyadcov_names = NULL;
+  g->dyadcov_nnz = 0;
+  g->dyadcov_rowstart = NULL;
+  g->dyadcov_cols = NULL;
+  g->dyadcov_values = NULL;
+  g->dyadcov_index = NULL;
+  g->shared_attributes = FALSE;
+  g->attr_columns = NULL;
+  g->num_attr_columns = 0;
+  g->snapshot = NULL;
+  g->snapshot_size = 0;
+  g->is_clone = FALSE;
+  g->geo_coords = NULL;
+  g->euclidean_coords = NULL;
+  g->altinstar_lambda = g->altoutstar_lambda = 0;
+  g->altinstar = g->altoutstar = NULL;
+  g->dyad_cache = NULL;
+  g->cat_pair_table = NULL;
+
+  g->zone  = (uint_t *)safe_calloc((size_t)num_vertices, sizeof(uint_t));
+  g->max_zone = 0;
+  g->num_inner_nodes = 0;
+  g->inner_nodes = NULL;
+  g->inner_zone_start = NULL;
+  g->zone_pair_cumcount = NULL;
+  g->prev_wave_degree  = (uint_t *)safe_calloc((size_t)num_vertices, sizeof(uint_t));
+  g->num_inner_arcs = 0;
+  g->allinnerarcs = NULL;
+  memset(&g->allinnerarcs_index, 0, sizeof(arcindex_t));
+  g->num_deletable_inner_arcs = 0;
+  g->deletable_inner_tree = NULL;
+  g->deletable_inner_tree_size = 0;
+  g->num_blocks = 0;
+  g->block = NULL;
+  g->block_nodes = NULL;
+  g->block_start = NULL;
+  g->block_pair_cumcount = NULL;
+#ifdef TWOPATH_CACHE
+  g->twopath_stamp = (twopath_stamp_t *)safe_calloc((size_t)num_vertices,
+                                                    sizeof(twopath_stamp_t));
+  invalidate_twopath_cache(g);
+#endif /* TWOPATH_CACHE */
+  return g;
+}
+
+/*
+ * Make a copy of a digraph, for example to run another chain or
+ * estimation on, much faster than loading it again. What changes as
+ * arcs are inserted and removed (the adjacency lists, flat arc lists
+ * and their indexes, hub sets, bit matrix, alternating star cache and
+ * two-path tables) is copied in bulk. The information about the nodes
+ * (attributes, coordinates, zones, pooled networks and original node
+ * numbers or ids) is shared with g rather than copied, so g must not
+ * be freed, nor that information changed, while the clone is in use.
+ *
+ * The two-path arrays and open addressing hash tables are copied, but
+ * the other kinds of two-path tables (uthash, and the hybrid and
+ * per-node backends) are built again from the arcs.
+ *
+ * Parameters:
+ *    g - digraph to copy (with no arc journal open)
+ *
+ * Return value:
+ *    Copy of g, to be freed with free_digraph()
+ */
+digraph_t *clone_digraph(const digraph_t *g)
+{
+  uint_t     n = g->num_nodes;
+  uint_t     v;
+  digraph_t *c;
+
+  assert(!g->journal.active);
+  c = (digraph_t *)safe_malloc(sizeof(digraph_t));
+  *c = *g;
+  c->is_clone = TRUE;
+  c->update_pool = NULL; /* the clone makes its own threads */
+  c->pending_arcs = NULL;
+  c->num_pending_arcs = 0;
+  memset(&c->journal, 0, sizeof(arc_journal_t));
+
+  c->outdegree = (uint_t *)safe_malloc((size_t)n * sizeof(uint_t));
+  memcpy(c->outdegree, g->outdegree, (size_t)n * sizeof(uint_t));
+  c->indegree = (uint_t *)safe_malloc((size_t)n * sizeof(uint_t));
+  memcpy(c->indegree, g->indegree, (size_t)n * sizeof(uint_t));
+  c->arclist = (nodeid_t **)safe_calloc((size_t)n, sizeof(nodeid_t *));
+  c->revarclist = (nodeid_t **)safe_calloc((size_t)n, sizeof(nodeid_t *));
+  c->outcapacity = (uint_t *)safe_calloc((size_t)n, sizeof(uint_t));
+  c->incapacity = (uint_t *)safe_calloc((size_t)n, sizeof(uint_t));
+  memset(&c->adjarena, 0, sizeof(adjarena_t));
+  c->outhubset = (nodeset_t *)safe_malloc((size_t)n * sizeof(nodeset_t));
+  c->inhubset = (nodeset_t *)safe_malloc((size_t)n * sizeof(nodeset_t));
+  for (v = 0; v < n; v++) {
+    if (g->outdegree[v]) {
+      adjlist_allocate(&c->adjarena, &c->arclist[v], g->outdegree[v],
+                       &c->outcapacity[v]);
+      memcpy(c->arclist[v], g->arclist[v],
+             g->outdegree[v] * sizeof(nodeid_t));
+    }
+    if (g->indegree[v]) {
+      adjlist_allocate(&c->adjarena, &c->revarclist[v], g->indegree[v],
+                       &c->incapacity[v]);
+      memcpy(c->revarclist[v], g->revarclist[v],
+             g->indegree[v] * sizeof(nodeid_t));
+    }
+    nodeset_copy(&c->outhubset[v], &g->outhubset[v]);
+    nodeset_copy(&c->inhubset[v], &g->inhubset[v]);
+  }
+  if (g->arcbitmatrix) {
+    c->arcbitmatrix = (uint64_t *)large_calloc(((size_t)n * n + 63) / 64,
+                                               sizeof(uint64_t));
+    memcpy(c->arcbitmatrix, g->arcbitmatrix,
+           ((size_t)n * n + 63) / 64 * sizeof(uint64_t));
+  }
+  if (g->altinstar) {
+    c->altinstar = (double *)safe_malloc(2 * (size_t)n * sizeof(double));
+    memcpy(c->altinstar, g->altinstar, 2 * (size_t)n * sizeof(double));
+  }
+  if (g->altoutstar) {
+    c->altoutstar = (double *)safe_malloc(2 * (size_t)n * sizeof(double));
+    memcpy(c->altoutstar, g->altoutstar, 2 * (size_t)n * sizeof(double));
+  }
+  /* the clone has its own (initially empty) dyad cache */
+  if (g->dyad_cache)
+    c->dyad_cache = allocate_dyad_cache(n, g->dyad_cache->num_stats);
+  if (g->cat_pair_table)
+    c->cat_pair_table = clone_cat_pair_table(g->cat_pair_table, n);
+
+  if (g->allarcs) {
+    c->allarcs = (nodepair_t *)safe_malloc(g->allarcs_capacity *
+                                           sizeof(nodepair_t));
+    memcpy(c->allarcs, g->allarcs, g->num_arcs * sizeof(nodepair_t));
+  }
+  arcindex_copy(&c->allarcs_index, &g->allarcs_index);
+  c->prev_wave_degree = (uint_t *)safe_malloc((size_t)n * sizeof(uint_t));
+  memcpy(c->prev_wave_degree, g->prev_wave_degree, (size_t)n * sizeof(uint_t));
+  if (g->allinnerarcs) {
+    /* allinnerarcs is reallocated to its exact length on each insertion */
+    c->allinnerarcs = (nodepair_t *)safe_malloc((g->num_inner_arcs + 1) *
+                                                sizeof(nodepair_t));
+    memcpy(c->allinnerarcs, g->allinnerarcs,
+           g->num_inner_arcs * sizeof(nodepair_t));
+  }
+  arcindex_copy(&c->allinnerarcs_index, &g->allinnerarcs_index);
+  if (g->deletable_inner_tree) {
+    c->deletable_inner_tree = (arcidx_t *)safe_malloc(
+      ((size_t)g->deletable_inner_tree_size + 1) * sizeof(arcidx_t));
+    memcpy(c->deletable_inner_tree, g->deletable_inner_tree,
+           ((size_t)g->deletable_inner_tree_size + 1) * sizeof(arcidx_t));
+  }
+
+#ifdef TWOPATH_ADAPTIVE
+  c->twopath_backend = TWOPATH_BACKEND_NONE;
+  c->twopath_hub = NULL;
+  c->hub_out = NULL;
+  c->hub_in = NULL;
+  c->mixTwoPathNodeTabs = NULL;
+  c->inTwoPathNodeTabs = NULL;
+  c->outTwoPathNodeTabs = NULL;
+  c->mixTwoPathMatrix = NULL;
+  c->inTwoPathMatrix = NULL;
+  c->outTwoPathMatrix = NULL;
+  memset(&c->mixTwoPathHashTab, 0, sizeof(twopath_hashtab_t));
+  memset(&c->inTwoPathHashTab, 0, sizeof(twopath_hashtab_t));
+  memset(&c->outTwoPathHashTab, 0, sizeof(twopath_hashtab_t));
+  memset(&c->mixTwoPathSpill, 0, sizeof(twopath_hashtab_t));
+  memset(&c->inTwoPathSpill, 0, sizeof(twopath_hashtab_t));
+  memset(&c->outTwoPathSpill, 0, sizeof(twopath_hashtab_t));
+  if (g->twopath_backend == TWOPATH_BACKEND_ARRAYS) {
+    copyTwoPathArrays(c, g);
+    c->twopath_backend = TWOPATH_BACKEND_ARRAYS;
+  } else if (g->twopath_backend == TWOPATH_BACKEND_HASHTABLES) {
+    twopath_hashtab_copy(&c->mixTwoPathHashTab, &g->mixTwoPathHashTab);
+    twopath_hashtab_copy(&c->inTwoPathHashTab, &g->inTwoPathHashTab);
+    twopath_hashtab_copy(&c->outTwoPathHashTab, &g->outTwoPathHashTab);
+    c->twopath_backend = TWOPATH_BACKEND_HASHTABLES;
+  } else {
+    set_twopath_backend(c, g->twopath_backend);
+  }
+#elif defined(TWOPATH_WITH_ARRAYS)
+  copyTwoPathArrays(c, g);
+#elif defined(TWOPATH_WITH_OAHASH)
+  twopath_hashtab_copy(&c->mixTwoPathHashTab, &g->mixTwoPathHashTab);
+  twopath_hashtab_copy(&c->inTwoPathHashTab, &g->inTwoPathHashTab);
+  twopath_hashtab_copy(&c->outTwoPathHashTab, &g->outTwoPathHashTab);
+#elif defined(TWOPATH_WITH_UTHASH)
+  c->mixTwoPathHashTab = NULL;
+  c->inTwoPathHashTab = NULL;
+  c->outTwoPathHashTab = NULL;
+  memset(&c->twopath_pool, 0, sizeof(twopath_pool_t));
+  buildTwoPathTables(c);
+#endif /* TWOPATH_ADAPTIVE */
+#ifdef TWOPATH_CACHE
+  c->twopath_stamp = (twopath_stamp_t *)safe_calloc((size_t)n,
+                                                    sizeof(twopath_stamp_t));
+  invalidate_twopath_cache(c);
+#endif /* TWOPATH_CACHE */
+  return c;
+}
+
+/*
+ * Set the degree above which nodes in g have hub neighbour sets for
+ * fast isArc(), building or freeing the sets of nodes already in g
+ * accordingly.
+ *
+ * Parameters:
+ *    g         - digraph
+ *    threshold - degree above which to use hub sets, 0 for never
+ *
+ * Return values:
+ *    None.
+ */
+void set_hub_degree_threshold(digraph_t *g, uint_t threshold)
+{
+  uint_t i;
+
+  g->hub_threshold = threshold;
+  for (i = 0; i < g->num_nodes; i++) {
+    nodeset_free(&g->outhubset[i]);
+    nodeset_free(&g->inhubset[i]);
+    if (threshold && g->outdegree[i] > threshold)
+      nodeset_build(&g->outhubset[i], g->arclist[i], g->outdegree[i]);
+    if (threshold && g->indegree[i] > threshold)
+      nodeset_build(&g->inhubset[i], g->revarclist[i], g->indegree[i]);
+  }
+}
+
+/*
+ * Set the number of threads used to build the two-path tables of g
+ * from scratch (after loading the network in bulk, and with
+ * TWOPATH_ADAPTIVE when the two-path lookup method is chosen or the
+ * nodes are renumbered), and to parse the attribute files in
+ * load_attributes().
+ *
+ * Parameters:
+ *    g           - digraph
+ *    num_threads - number of threads (0 is the same as 1)
+ *
+ * Return values:
+ *    None.
+ */
+void set_twopath_build_threads(digraph_t *g, uint_t num_threads)
+{
+  g->build_threads = MAX(num_threads, 1);
+}
+
+/*
+ * Set the number of threads that divide the two-path array updates for
+ * an arc added or removed (TWOPATH_WITH_ARRAYS, or the arrays backend
+ * with TWOPATH_ADAPTIVE) when the node whose neighbours are updated has
+ * degree at least min_degree. The scattered updates for the arcs of a
+ * hub can take milliseconds, and are then divided between the threads,
+ * which wait between them (a thread pool owned by g, made when first
+ * needed, and not shared with clones). The results are exactly the same
+ * as with one thread.
+ *
+ * Parameters:
+ *    g           - digraph
+ *    num_threads - number of threads including the caller (0 is the
+ *                  same as 1, no pool)
+ *    min_degree  - degree from which updates are divided between the
+ *                  threads (0 for DEFAULT_HUB_UPDATE_DEGREE)
+ *
+ * Return values:
+ *    None.
+ */
+void set_twopath_update_threads(digraph_t *g, uint_t num_threads,
+                                uint_t min_degree)
+{
+  g->update_threads = MAX(num_threads, 1);
+  g->hub_update_degree = min_degree ? min_degree : DEFAULT_HUB_UPDATE_DEGREE;
+#ifdef TWOPATH_WITH_ARRAYS
+  if (g->update_pool) {
+    free_twopath_update_pool(g->update_pool);
+    g->update_pool = NULL;
+  }
+#endif /* TWOPATH_WITH_ARRAYS */
+}
+
+/*
+ * Start or stop keeping an n x n bit matrix of arcs in g, which makes
+ * isArc() a single bit test. It takes n^2/8 bytes so is only suitable
+ * for small and medium size networks (e.g. 312 MB for 50000 nodes).
+ * When started, the matrix is built from the arcs already in g.
+ *
+ * Parameters:
+ *    g            - digraph
+ *    useBitMatrix - TRUE to keep bit matrix, FALSE to not use (free) it
+ *
+ * Return values:
+ *    None.
+ */
+void set_arc_bitmatrix(digraph_t *g, bool useBitMatrix)
+{
+  size_t nbits = (size_t)g->num_nodes * g->num_nodes;
+  uint_t i, k;
+
+  large_free(g->arcbitmatrix, (nbits + 63) / 64, sizeof(uint64_t));
+  g->arcbitmatrix = NULL;
+  if (!useBitMatrix)
+    return;
+  g->arcbitmatrix = (uint64_t *)large_calloc((nbits + 63) / 64,
+                                             sizeof(uint64_t));
+  MEMUSAGE_DEBUG_PRINT(("arcbitmatrix size %f MB\n",
+                        (double)((nbits + 63) / 64) * sizeof(uint64_t) /
+                        (1024*1024)));
+  for (i = 0; i < g->num_nodes; i++)
+    for (k = 0; k < g->outdegree[i]; k++)
+      ARC_BIT_SET(g->arcbitmatrix, INDEX2D(i, g->arclist[i][k], g->num_nodes));
+}
+
+/*
+ * Set the names of the binary, categorical, continuous and set
+ * attribute columns that load_attributes() keeps (e.g. those the
+ * model refers to), so that the other columns of the attribute files,
+ * which can have many more, are skipped without being parsed or
+ * stored. Names are matched without regard to case, as the attribute
+ * parameters are. The same columns are kept when the attributes are
+ * attached from a block (see attach_digraph_attributes()), such as
+ * that of a snapshot. Dyadic covariates are not affected.
+ *
+ * Parameters:
+ *    g           - digraph with no attributes loaded yet
+ *    num_columns - number of names in columns
+ *    columns     - names of the columns to keep, or NULL for all of
+ *                  them (the default)
+ *
+ * Return values:
+ *    None.
+ */
+void set_attribute_columns(digraph_t *g, uint_t num_columns,
+                           const char *const columns[])
+{
+  uint_t u;
+
+  for (u = 0; u < g->num_attr_columns; u++)
+    free(g->attr_columns[u]);
+  free(g->attr_columns);
+  g->attr_columns = NULL;
+  g->num_attr_columns = 0;
+  if (!columns)
+    return;
+  /* allocated even for no names, as NULL is all of them */
+  g->attr_columns = (char **)safe_malloc(MAX(num_columns, 1) *
+                                         sizeof(char *));
+  for (u = 0; u < num_columns; u++)
+    g->attr_columns[u] = safe_strdup(columns[u]);
+  g->num_attr_columns = num_columns;
+}
+
+/*
+ * Start or stop keeping the AltInStars and AltOutStars change
+ * statistics of each node in g, for a given lambda value of each. They
+ * depend only on the in- or out-degree of the node so change only when
+ * an arc is inserted or removed, and then changeAltInStars() and
+ * changeAltOutStars() are just an array lookup rather than a pow() call
+ * for each proposal. When started, the values are computed from the
+ * arcs already in g.
+ *
+ * Parameters:
+ *    g          - digraph
+ *    in_lambda  - lambda of AltInStars, or 0 to not keep (free) altinstar
+ *    out_lambda - lambda of AltOutStars, or 0 to not keep (free) altoutstar
+ *
+ * Return values:
+ *    None.
+ */
+void set_altstar_cache(digraph_t *g, double in_lambda, double out_lambda)
+{
+  uint_t i;
+
+  free(g->altinstar);
+  free(g->altoutstar);
+  g->altinstar = g->altoutstar = NULL;
+  g->altinstar_lambda = in_lambda;
+  g->altoutstar_lambda = out_lambda;
+  if (in_lambda > 0) {
+    g->altinstar = (double *)safe_malloc(2 * (size_t)g->num_nodes *
+                                         sizeof(double));
+    for (i = 0; i < g->num_nodes; i++)
+      set_altstar_entry(g->altinstar, in_lambda, i, g->indegree[i]);
+  }
+  if (out_lambda > 0) {
+    g->altoutstar = (double *)safe_malloc(2 * (size_t)g->num_nodes *
+                                          sizeof(double));
+    for (i = 0; i < g->num_nodes; i++)
+      set_altstar_entry(g->altoutstar, out_lambda, i, g->outdegree[i]);
+  }
+}
+
+/*
+ * Memory used by the dyad cache (see set_dyad_cache()) of a digraph.
+ *
+ * Parameters:
+ *    num_nodes - number of nodes in the digraph
+ *    num_stats - number of change statistics of each dyad
+ *
+ * Return value:
+ *    Bytes used by the dyad cache.
+ */
+size_t dyad_cache_bytes(uint_t num_nodes, uint_t num_stats)
+{
+  return sizeof(dyad_cache_t) + (size_t)num_nodes * sizeof(uint32_t) +
+    (size_t)num_nodes * num_nodes * (sizeof(uint64_t) +
+                                     num_stats * sizeof(double));
+}
+
+/*
+ * Start or stop keeping the change statistics of each dyad (i, j) as
+ * last computed by the sampler, so that proposing the same dyad again
+ * before anything it depends on has changed (as happens many times for
+ * each accepted move in a long simulation of a small network) is just
+ * a lookup (dyad_cache_lookup()) rather than computing them again. The
+ * change statistics of a dyad depend only on the arcs of its two nodes
+ * and their neighbours, so insertArc() and removeArc() invalidate just
+ * the dyads with an end in the neighbourhood of the arc (see
+ * dyad_cache_t). The cache takes n^2 (8 + 8 num_stats) bytes, so is
+ * only for small networks. The entries are only valid for one model
+ * (the change statistics functions), so the cache must be started
+ * again for another, but not for a change of its parameters, as the
+ * total of the change statistics weighted by the parameters is not
+ * cached.
+ *
+ * Parameters:
+ *    g             - digraph
+ *    num_stats     - number of change statistics of each dyad, or 0 to
+ *                    not keep (free) the cache
+ *    max_memory_mb - the cache is not kept if it would take more than
+ *                    this many megabytes
+ *
+ * Return values:
+ *    TRUE if the cache is kept, else FALSE.
+ */
+bool set_dyad_cache(digraph_t *g, uint_t num_stats, uint_t max_memory_mb)
+{
+  if (g->dyad_cache)
+    free_dyad_cache(g->dyad_cache, g->num_nodes);
+  g->dyad_cache = NULL;
+  if (num_stats == 0 || dyad_cache_bytes(g->num_nodes, num_stats) >
+      (size_t)max_memory_mb * 1024 * 1024)
+    return FALSE;
+  g->dyad_cache = allocate_dyad_cache(g->num_nodes, num_stats);
+  MEMUSAGE_DEBUG_PRINT(("dyad cache size %f MB\n",
+                        (double)dyad_cache_bytes(g->num_nodes, num_stats) /
+                        (1024*1024)));
+  return TRUE;
+}
+
+/*
+ * Get the change statistics of dyad (i, j) from the dyad cache (see
+ * set_dyad_cache()) if they are there and still valid.
+ *
+ * Parameters:
+ *    g - digraph, with a dyad cache
+ *    i - node arc is from
+ *    j - node arc is to
+ *
+ * Return value:
+ *    Pointer to the num_stats change statistics of dyad (i, j) in the
+ *    cache, valid until the next arc insertion or removal, or NULL if
+ *    they are not in the cache.
+ */
+const double *dyad_cache_lookup(digraph_t *g, uint_t i, uint_t j)
+{
+  dyad_cache_t *dc = g->dyad_cache;
+  size_t        d = INDEX2D(i, j, g->num_nodes);
+
+  if (dc->stamp[d] == ((uint64_t)dc->version[i] << 32 | dc->version[j])) {
+    dc->hits++;
+    return &dc->stats[d * dc->num_stats];
+  }
+  dc->misses++;
+  return NULL;
+}
+
+/*
+ * Put the change statistics of dyad (i, j) in the dyad cache (see
+ * set_dyad_cache()).
+ *
+ * Parameters:
+ *    g     - digraph, with a dyad cache
+ *    i     - node arc is from
+ *    j     - node arc is to
+ *    stats - the num_stats change statistics of dyad (i, j) as
+ *            computed by calcChangeStats() for the current arcs of g
+ *
+ * Return value:
+ *    None.
+ */
+void dyad_cache_store(digraph_t *g, uint_t i, uint_t j, const double stats[])
+{
+  dyad_cache_t *dc = g->dyad_cache;
+  size_t        d = INDEX2D(i, j, g->num_nodes);
+
+  memcpy(&dc->stats[d * dc->num_stats], stats,
+         dc->num_stats * sizeof(double));
+  dc->stamp[d] = (uint64_t)dc->version[i] << 32 | dc->version[j];
+}
+
+/*
+ * Free a category pair table (see cat_pair_table_t).
+ *
+ * Parameters:
+ *    table - category pair table
+ *
+ * Return value:
+ *    None.
+ */
+void free_cat_pair_table(cat_pair_table_t *table)
+{
+  free(table->node_code);
+  free(table->pair_bits);
+  free(table->terms);
+  free(table);
+}
+
+/*
+ * Start or stop using a category pair table (built by
+ * build_cat_pair_table() for the model to be sampled from) for the
+ * categorical attribute statistics of a digraph. The table is for the
+ * node attributes of g, so must be set again if they change.
+ *
+ * Parameters:
+ *    g     - digraph
+ *    table - category pair table, owned by g from now on (freed with
+ *            it), or NULL to not use (free) a table
+ *
+ * Return value:
+ *    None.
+ */
+void set_cat_pair_table(digraph_t *g, cat_pair_table_t *table)
+{
+  if (g->cat_pair_table)
+    free_cat_pair_table(g->cat_pair_table);
+  g->cat_pair_table = table;
+}
+
+/*
+ * Get node ordering from its name as used in config files.
+ *
+ * Parameters:
+ *    name - name of node ordering ("none", "degree", "rcm" or "zone",
+ *           case insensitive), or NULL for none
+ *
+ * Return value:
+ *    node ordering, or NODE_ORDER_INVALID if name is not recognized
+ */
+node_order_e node_order_from_name(const char *name)
+{
+  if (!name || strcasecmp(name, "none") == 0)
+    return NODE_ORDER_NONE;
+  if (strcasecmp(name, "degree") == 0)
+    return NODE_ORDER_DEGREE;
+  if (strcasecmp(name, "rcm") == 0)
+    return NODE_ORDER_RCM;
+  if (strcasecmp(name, "zone") == 0)
+    return NODE_ORDER_ZONE;
+  return NODE_ORDER_INVALID;
+}
+
+/*
+ * Return descriptive name of node ordering.
+ *
+ * Parameters:
+ *   order - node ordering
+ *
+ * Return value:
+ *   Name of the ordering (static string)
+ */
+const char *node_order_name(node_order_e order)
+{
+  switch (order) {
+    case NODE_ORDER_NONE:
+      return "none";
+    case NODE_ORDER_DEGREE:
+      return "degree";
+    case NODE_ORDER_RCM:
+      return "reverse Cuthill-McKee";
+    case NODE_ORDER_ZONE:
+      return "snowball zone (inner waves first)";
+    default:
+      return "invalid";
+  }
+}
+
+/* replace per-node array a of given type by its elements in order oldid[] */
+#define PERMUTE_NODE_ARRAY(type, a, oldid, n) do {                    \
+    type *permuted_ = (type *)safe_malloc((n) * sizeof(type));         \
+    uint_t v_;                                                         \
+    for (v_ = 0; v_ < (n); v_++)                                       \
+      permuted_[v_] = (a)[(oldid)[v_]];                                \
+    free(a);                                                           \
+    (a) = permuted_;                                                   \
+  } while (0)
+
+/*
+ * Permute a bit set over nodes as PERMUTE_NODE_ARRAY() (the new bit v
+ * is old bit oldid[v]).
+ *
+ * Parameters:
+ *    bits  - (in/out) bit set of SETATTR_WORDS(n) words, replaced by
+ *            the permuted bit set
+ *    oldid - for each new node number, its old node number
+ *    n     - number of nodes
+ *
+ * Return value:
+ *    None.
+ */
+static void permute_node_bits(uint64_t **bits, const uint_t *oldid, uint_t n)
+{
+  uint64_t *permuted = (uint64_t *)safe_calloc(SETATTR_WORDS(n),
+                                               sizeof(uint64_t));
+  uint_t    v;
+
+  for (v = 0; v < n; v++)
+    if (SETATTR_BIT_TEST(*bits, oldid[v]))
+      permuted[v >> 6] |= (uint64_t)1 << (v & 63);
+  free(*bits);
+  *bits = permuted;
+}
+
+/*
+ * Permute the codes of categorical attribute u of g as
+ * PERMUTE_NODE_ARRAY().
+ *
+ * Parameters:
+ *    g     - (in/out) digraph
+ *    u     - categorical attribute index
+ *    oldid - for each new node number, its old node number
+ *
+ * Return value:
+ *    None.
+ */
+static void permute_catattr(digraph_t *g, uint_t u, const uint_t *oldid)
+{
+  void   *old = g->catattr[u];
+  uint_t  v;
+
+  g->catattr[u] = safe_malloc((size_t)g->num_nodes * g->catattr_width[u]);
+  for (v = 0; v < g->num_nodes; v++) {
+    switch (g->catattr_width[u]) {
+      case 1:
+        ((uint8_t *)g->catattr[u])[v] = ((uint8_t *)old)[oldid[v]];
+        break;
+      case 2:
+        ((uint16_t *)g->catattr[u])[v] = ((uint16_t *)old)[oldid[v]];
+        break;
+      default:
+        ((uint32_t *)g->catattr[u])[v] = ((uint32_t *)old)[oldid[v]];
+        break;
     }
-    fclose(attr_file);
   }
-  *out_attr_names = attr_names;
-  *out_attr_values = attr_values;
-  *out_set_sizes = setsizes;
-  return num_attributes;
+  free(old);
 }
 
-   
-/*****************************************************************************
+/*
+ * Compare two pairs in a row of the dyadic covariates by node, for qsort().
  *
- * externally visible functions
+ * Parameters:
+ *   a, b - pointers to dyadcov_entry_t to compare
  *
- ****************************************************************************/
+ * Return value:
+ *   <0, 0, >0 if node of a is less than, equal to, or greater than that of b
+ */
+static int compare_dyadcov_entry(const void *a, const void *b)
+{
+  uint_t x = ((const dyadcov_entry_t *)a)->j;
+  uint_t y = ((const dyadcov_entry_t *)b)->j;
+  return (x > y) - (x < y);
+}
 
-#ifdef TWOPATH_LOOKUP
-#ifdef TWOPATH_HASHTABLES
 /*
- * Get entry for (i, j) in hashtable.
- *
+ * Set the dyadic covariate pairs of g from entries grouped by the node
+ * they are from, sorting each row by the node the pairs are to.
  *
  * Parameters:
- *     h - hash table
- *     i - node id of source
- *     j - node id of destination
+ *    g        - (in/out) digraph, with dyadcov_rowstart set and
+ *               dyadcov_cols and dyadcov_values allocated
+ *    entries  - (in/out) the pairs of each row (dyadcov_rowstart
+ *               positions), sorted by this function
+ *    values   - values of covariate u for the pair of entry e are at
+ *               values[e.k * stride + u * ustride]
+ *    stride   - see values
+ *    ustride  - see values
  *
  * Return value:
- *     value for key (i, j) in hashtable or 0 if none
+ *    None
  */
-uint_t get_twopath_entry(twopath_record_t *h, uint_t i, uint_t j)
+static void set_dyadcov_rows(digraph_t *g, dyadcov_entry_t *entries,
+                             const contattr_t *values, uint64_t stride,
+                             uint64_t ustride)
 {
-  twopath_record_t rec, *p = NULL;
-  rec.key.i = i;
-  rec.key.j = j;
-  HASH_FIND(hh, h, &rec.key, sizeof(nodepair_t), p);
-  return (p ? p->value : 0);
-}
-#endif /*TWOPATH_HASHTABLES*/
-#else /* not using two-path lookup tables (either arrays or hashtables) */
+  uint64_t k;
+  uint_t   i, u;
 
-/* In these functions we have to count paths i -- v -- j for different
-   directions (i.e -- can be <- or ->) depending on the function. So we
-   can iterate over neighbours of i or of j in the outermost loop. The 
-   result is the same but it can be faster if the outermost loop is over
-   the node with smallest degree. Note that in the inner loop we could also
-   iterate neighbours of v or of i or j, but in practice I found it far
-   faster to always just use j or i rather than v for large network with very
-   high maximum degree and very skewed degree distribution (physician referral
-   network). On most networks (smaller, less skewed, lower max degree) it
-   makes no real difference */
+  for (i = 0; i < g->num_nodes; i++)
+    qsort(entries + g->dyadcov_rowstart[i],
+          g->dyadcov_rowstart[i+1] - g->dyadcov_rowstart[i],
+          sizeof(dyadcov_entry_t), compare_dyadcov_entry);
+  for (k = 0; k < g->dyadcov_nnz; k++) {
+    g->dyadcov_cols[k] = entries[k].j;
+    for (u = 0; u < g->num_dyadcov; u++)
+      g->dyadcov_values[u][k] = values[entries[k].k * stride + u * ustride];
+  }
+}
 
-/* 
- * Count two-paths for (i, j): paths  i -> v -> j for some v
+/*
+ * Renumber the dyadic covariates of g: the pairs of new node v are
+ * those of old node oldid[v], with the nodes they are to renumbered.
+ *
+ * Parameters:
+ *    g     - (in/out) digraph
+ *    oldid - for each new node number, its old node number
+ *    newid - for each old node number, its new node number
+ *
+ * Return value:
+ *    None.
  */
-uint_t mixTwoPaths(const digraph_t *g, uint_t i, uint_t j)
+static void permute_dyadcov(digraph_t *g, const uint_t *oldid,
+                            const uint_t *newid)
 {
-  uint_t v,k,l;
-  uint_t count = 0;
+  uint64_t        *old_rowstart = g->dyadcov_rowstart;
+  contattr_t      *old_values;
+  dyadcov_entry_t *entries;
+  uint64_t         k, pos = 0;
+  uint_t           v, u;
 
-  if (g->outdegree[i] < g->indegree[j]) {
-    for (k = 0; k < g->outdegree[i]; k++)  {
-      v = g->arclist[i][k];   /* i -> v */
-      if (v == i || v == j)
-	continue;
-      for (l = 0; l < g->indegree[j]; l++) {
-	if (g->revarclist[j][l] == v) {   /* v -> j */
-	  count++;
-	}
-      }
-    }
-  } else {
-    for (k = 0; k < g->indegree[j]; k++) {
-      v = g->revarclist[j][k];  /* v -> j */
-      if (v == i || v == j)
-	continue;
-      for (l = 0; l < g->outdegree[i]; l++) {
-	if (g->arclist[i][l] == v) { /* i -> v */
-	  count++;
-	}
-      }
+  /* the old values one covariate after another, so set_dyadcov_rows()
+     can take them from old positions */
+  old_values = (contattr_t *)safe_malloc(g->num_dyadcov * g->dyadcov_nnz *
+                                         sizeof(contattr_t));
+  for (u = 0; u < g->num_dyadcov; u++)
+    memcpy(old_values + u * g->dyadcov_nnz, g->dyadcov_values[u],
+           g->dyadcov_nnz * sizeof(contattr_t));
+  g->dyadcov_rowstart = (uint64_t *)safe_malloc((g->num_nodes + 1) *
+                                                sizeof(uint64_t));
+  entries = (dyadcov_entry_t *)safe_malloc(g->dyadcov_nnz *
+                                           sizeof(dyadcov_entry_t));
+  g->dyadcov_rowstart[0] = 0;
+  for (v = 0; v < g->num_nodes; v++) {
+    for (k = old_rowstart[oldid[v]]; k < old_rowstart[oldid[v]+1]; k++) {
+      entries[pos].j = newid[g->dyadcov_cols[k]];
+      entries[pos++].k = k;
     }
+    g->dyadcov_rowstart[v+1] = pos;
   }
-  return count;
+  set_dyadcov_rows(g, entries, old_values, 1, g->dyadcov_nnz);
+  free(entries);
+  free(old_values);
+  free(old_rowstart);
 }
 
-/* 
- * Count out-two-paths for (i, j): paths  i <- v -> j for some v
+/*
+ * Renumber the nodes of g to improve memory locality in the arc lists
+ * and two-path tables, which can make a large difference to the speed of
+ * the change statistics on networks whose input numbering is arbitrary.
+ *
+ * The new numbering is applied to everything indexed by node: arcs,
+ * attributes, dyadic covariates, snowball sampling zones, the allarcs and allinnerarcs
+ * lists, and all the lookup structures (which are rebuilt). The original
+ * numbers are kept in orig_node so that write_digraph_arclist_to_file()
+ * writes the network with the input file node numbers. Statistics of
+ * the network are unchanged by renumbering so do not need to be
+ * recomputed.
+ *
+ * Parameters:
+ *    g     - digraph (with attributes and zones already loaded) to renumber
+ *    order - node ordering to use
+ *
+ * Return values:
+ *    None.
  */
-uint_t outTwoPaths(const digraph_t *g, uint_t i, uint_t j)
+void reorder_digraph_nodes(digraph_t *g, node_order_e order)
 {
-  uint_t v,k,l;
-  uint_t count = 0;
+  uint_t      n = g->num_nodes;
+  uint_t     *oldid, *newid;
+  nodepair_t *arcs;
+  arcidx_t    num_arcs = g->num_arcs;
+  arcidx_t    a = 0;
+  uint_t      i, k;
+  bool        has_deletable_tree;
+#ifdef TWOPATH_ADAPTIVE
+  twopath_backend_e backend = g->twopath_backend;
+#endif /* TWOPATH_ADAPTIVE */
 
-  if (g->indegree[i] < g->indegree[j]) {
-    for (k = 0; k < g->indegree[i]; k++)  {
-      v = g->revarclist[i][k];   /* i <- v */
-      if (v == i || v == j)
-	continue;
-      for (l = 0; l < g->indegree[j]; l++) {
-	if (g->revarclist[j][l] == v) {   /* v -> j */
-	  count++;
-	}
-      }
+  assert(order != NODE_ORDER_INVALID);
+  assert(!g->shared_attributes); /* would permute other processes' too */
+  if (order == NODE_ORDER_NONE)
+    return;
+
+  oldid = (uint_t *)safe_malloc(n * sizeof(uint_t));
+  if (order == NODE_ORDER_DEGREE)
+    degree_node_order(g, oldid);
+  else if (order == NODE_ORDER_ZONE)
+    zone_node_order(g, oldid);
+  else
+    rcm_node_order(g, oldid);
+  newid = (uint_t *)safe_malloc(n * sizeof(uint_t));
+  for (i = 0; i < n; i++)
+    newid[oldid[i]] = i;
+
+  /* take out all the arcs (with new numbers), to be reinserted below */
+  arcs = (nodepair_t *)safe_malloc(num_arcs * sizeof(nodepair_t));
+  for (i = 0; i < n; i++) {
+    for (k = 0; k < g->outdegree[i]; k++) {
+      arcs[a].i = newid[i];
+      arcs[a++].j = newid[g->arclist[i][k]];
     }
-  } else {
-    for (k = 0; k < g->indegree[j]; k++) {
-      v = g->revarclist[j][k]; /* v -> j */
-      if (v == i || v == j) 
-	continue;
-      for (l = 0; l < g->indegree[i]; l++) {
-	if (g->revarclist[i][l] == v) { /* i <- v */
-	  count++;
-	}
-      }
+    g->outdegree[i] = g->indegree[i] = 0;
+    g->prev_wave_degree[i] = 0;
+    nodeset_free(&g->outhubset[i]);
+    nodeset_free(&g->inhubset[i]);
+  }
+  assert(a == num_arcs);
+  g->num_arcs = 0;
+  if (g->arcbitmatrix)
+    memset(g->arcbitmatrix, 0, ((size_t)n * n + 63) / 64 * sizeof(uint64_t));
+#ifdef TWOPATH_ADAPTIVE
+  set_twopath_backend(g, TWOPATH_BACKEND_NONE);
+#elif defined(TWOPATH_LOOKUP)
+  resetTwoPathTables(g);
+#endif /* TWOPATH_ADAPTIVE */
+
+  /* each node keeps its (now empty) adjacency lists, so they still have
+     the right capacity for its arcs */
+  PERMUTE_NODE_ARRAY(nodeid_t *, g->arclist, oldid, n);
+  PERMUTE_NODE_ARRAY(nodeid_t *, g->revarclist, oldid, n);
+  PERMUTE_NODE_ARRAY(uint_t, g->outcapacity, oldid, n);
+  PERMUTE_NODE_ARRAY(uint_t, g->incapacity, oldid, n);
+  for (i = 0; i < g->num_binattr; i++) {
+    permute_node_bits(&g->binattr[i], oldid, n);
+    permute_node_bits(&g->binattr_na[i], oldid, n);
+  }
+  for (i = 0; i < g->num_catattr; i++)
+    permute_catattr(g, i, oldid);
+  for (i = 0; i < g->num_contattr; i++) {
+    PERMUTE_NODE_ARRAY(contattr_t, g->contattr[i], oldid, n);
+    if (g->contattr_term)
+      PERMUTE_NODE_ARRAY(contattr_t, g->contattr_term[i], oldid, n);
+  }
+  for (i = 0; i < g->num_setattr; i++) {
+    PERMUTE_NODE_ARRAY(set_elem_e *, g->setattr[i], oldid, n);
+    PERMUTE_NODE_ARRAY(uint64_t *, g->setattr_bits[i], oldid, n);
+    /* NA bit set is over nodes so rebuild it from the permuted sets */
+    memset(g->setattr_na[i], 0, SETATTR_WORDS(n) * sizeof(uint64_t));
+    for (k = 0; k < n; k++)
+      if (g->setattr_lengths[i] > 0 && g->setattr[i][k][0] == SET_ELEM_NA)
+        g->setattr_na[i][k >> 6] |= (uint64_t)1 << (k & 63);
+  }
+  if (g->dyadcov_rowstart)
+    permute_dyadcov(g, oldid, newid);
+  if (g->geo_coords)
+    PERMUTE_NODE_ARRAY(point3_t, g->geo_coords, oldid, n);
+  if (g->euclidean_coords)
+    PERMUTE_NODE_ARRAY(point3_t, g->euclidean_coords, oldid, n);
+  PERMUTE_NODE_ARRAY(uint_t, g->zone, oldid, n);
+  for (i = 0; i < g->num_inner_nodes; i++)
+    g->inner_nodes[i] = newid[g->inner_nodes[i]];
+  if (g->block) {
+    PERMUTE_NODE_ARRAY(uint_t, g->block, oldid, n);
+    for (i = 0; i < n; i++)
+      g->block_nodes[i] = newid[g->block_nodes[i]];
+  }
+
+  /* reinserting arcs rebuilds degrees, prev_wave_degree (zones are
+     already renumbered), hub sets, bit matrix and two-path tables (the
+     deletable inner arcs are counted again below, once allinnerarcs is
+     renumbered) */
+  has_deletable_tree = g->deletable_inner_tree != NULL;
+  free(g->deletable_inner_tree);
+  g->deletable_inner_tree = NULL;
+  for (a = 0; a < num_arcs; a++)
+    insertArc(g, arcs[a].i, arcs[a].j);
+  free(arcs);
+  /* nodes left with no arcs still have the old node's star values */
+  set_altstar_cache(g, g->altinstar_lambda, g->altoutstar_lambda);
+  if (g->dyad_cache)
+    clear_dyad_cache(g->dyad_cache, n); /* entries are for old numbers */
+  if (g->cat_pair_table)
+    PERMUTE_NODE_ARRAY(uint32_t, g->cat_pair_table->node_code, oldid, n);
+#ifdef TWOPATH_CACHE
+  invalidate_twopath_cache(g); /* cached counts are for old node numbers */
+#endif /* TWOPATH_CACHE */
+#ifdef TWOPATH_ADAPTIVE
+  set_twopath_backend(g, backend);
+#endif /* TWOPATH_ADAPTIVE */
+  /* allarcs and allinnerarcs keep their order, just renumbered */
+  if (g->allarcs) {
+    for (a = 0; a < g->num_arcs; a++) {
+      g->allarcs[a].i = newid[g->allarcs[a].i];
+      g->allarcs[a].j = newid[g->allarcs[a].j];
     }
   }
-  return count;
+  for (a = 0; a < g->num_inner_arcs; a++) {
+    g->allinnerarcs[a].i = newid[g->allinnerarcs[a].i];
+    g->allinnerarcs[a].j = newid[g->allinnerarcs[a].j];
+  }
+  if (g->allarcs)
+    arcindex_build(&g->allarcs_index, g->allarcs, g->num_arcs);
+  arcindex_build(&g->allinnerarcs_index, g->allinnerarcs, g->num_inner_arcs);
+  if (has_deletable_tree)
+    build_deletable_inner_tree(g, g->deletable_inner_tree_size);
+
+  /* compose with any previous renumbering to keep input file numbers */
+  if (g->orig_node) {
+    for (i = 0; i < n; i++)
+      oldid[i] = g->orig_node[oldid[i]];
+    free(g->orig_node);
+  }
+  g->orig_node = oldid;
+  free(newid);
 }
 
-/* 
- * Count in-two-paths for (i, j): paths  i -> v <- j for some v
+/*
+ * Free the information about the nodes of a digraph that does not
+ * change as arcs are inserted and removed, and so is shared by
+ * clone_digraph() with its clones: the attributes, coordinates, zones,
+ * pooled networks and original node numbers or ids.
+ *
+ * Parameters:
+ *    g - digraph
+ *
+ * Return value:
+ *    None
  */
-uint_t inTwoPaths(const digraph_t *g, uint_t i, uint_t j)
+static void free_digraph_node_info(digraph_t *g)
 {
-  uint_t v,k,l;
-  uint_t count = 0;
+  uint_t i, k;
 
-  if (g->outdegree[i] < g->outdegree[j]) {
-    for (k = 0; k < g->outdegree[i]; k++)  {
-      v = g->arclist[i][k];   /* i -> v */
-      if (v == i || v == j)
-	continue;
-      for (l = 0; l < g->outdegree[j]; l++) {
-	if (g->arclist[j][l] == v) {   /* v <- j */
-	  count++;
-	}
-      }
-    }
-  } else {
-    for (k = 0; k < g->outdegree[j]; k++) {
-      v = g->arclist[j][k]; /* v <- j */
-      if (v == i || v == j)
-	continue;
-      for (l = 0; l < g->outdegree[i]; l++) {
-	if (g->arclist[i][l] == v) { /* i -> v */
-	  count++;
-	}
-      }
+  for (i = 0; i < g->num_binattr; i++) {
+    free(g->binattr_names[i]);
+    if (g->shared_attributes)
+      continue;
+    free(g->binattr[i]);
+    free(g->binattr_na[i]);
+  }
+  free(g->binattr);
+  free(g->binattr_na);
+  free(g->binattr_names);
+  for (i = 0; i < g->num_catattr; i++) {
+    free(g->catattr_names[i]);
+    if (!g->shared_attributes)
+      free(g->catattr[i]);
+  }
+  free(g->catattr);
+  free(g->catattr_width);
+  free(g->catattr_names);
+  for (i = 0; i < g->num_contattr; i++) {
+    free(g->contattr_names[i]);
+    if (g->shared_attributes)
+      continue;
+    free(g->contattr[i]);
+    if (g->contattr_term)
+      free(g->contattr_term[i]);
+  }
+  free(g->contattr);
+  free(g->contattr_names);
+  free(g->contattr_term);
+  for (i = 0; i < g->num_setattr; i++) {
+    free(g->setattr_names[i]);
+    free(g->setattr[i]);
+    if (!g->shared_attributes) {
+      for (k = 0; k < g->num_nodes; k++)
+        free(g->setattr_bits[i][k]);
+      free(g->setattr_na[i]);
     }
+    free(g->setattr_bits[i]);
   }
-  return count;
+  free(g->setattr);
+  free(g->setattr_bits);
+  free(g->setattr_na);
+  free(g->setattr_names);
+  for (i = 0; i < g->num_dyadcov; i++) {
+    free(g->dyadcov_names[i]);
+    if (!g->shared_attributes)
+      free(g->dyadcov_values[i]);
+  }
+  if (!g->shared_attributes) {
+    free(g->dyadcov_rowstart);
+    free(g->dyadcov_cols);
+  }
+  free(g->dyadcov_values);
+  free(g->dyadcov_names);
+  free(g->dyadcov_index);
+  for (i = 0; i < g->num_attr_columns; i++)
+    free(g->attr_columns[i]);
+  free(g->attr_columns);
+  free(g->geo_coords);
+  free(g->euclidean_coords);
+  free(g->orig_node);
+  if (g->node_ids) {
+    free_nodeidmap(g->node_ids);
+    free(g->node_ids);
+  }
+  free(g->zone);
+  free(g->inner_nodes);
+  free(g->inner_zone_start);
+  free(g->zone_pair_cumcount);
+  free(g->block);
+  free(g->block_nodes);
+  free(g->block_start);
+  free(g->block_pair_cumcount);
+  if (g->snapshot)
+    munmap(g->snapshot, g->snapshot_size);
 }
 
-#endif /*TWOPATH_LOOKUP*/
+/*
+ * Free the digraph internal structures and digraph itself
+ *
+ * Parameters:
+ *    g - digraph to deallocate
+ * Return value:
+ *    None
+ * Note the pointer g itelf is freed in this function
+ */
+void free_digraph(digraph_t *g)
+{
+  uint_t i;
 
-/* 
- * Return density of graph
- * 
+  if (!g->is_clone)
+    free_digraph_node_info(g);
+  free(g->altinstar);
+  free(g->altoutstar);
+  if (g->dyad_cache)
+    free_dyad_cache(g->dyad_cache, g->num_nodes);
+  if (g->cat_pair_table)
+    free_cat_pair_table(g->cat_pair_table);
+#ifdef TWOPATH_WITH_ARRAYS
+  if (g->update_pool)
+    free_twopath_update_pool(g->update_pool);
+#endif /* TWOPATH_WITH_ARRAYS */
+  for (i = 0; i < g->num_nodes; i++)  {
+    /* only lists too large for the slabs were individually allocated */
+    if (g->outcapacity[i] > (1U << ADJ_MAX_SLAB_CLASS))
+      free(g->arclist[i]);
+    if (g->incapacity[i] > (1U << ADJ_MAX_SLAB_CLASS))
+      free(g->revarclist[i]);
+    free(g->outhubset[i].slots);
+    free(g->inhubset[i].slots);
+  }
+  free(g->outhubset);
+  free(g->inhubset);
+  large_free(g->arcbitmatrix, ((size_t)g->num_nodes * g->num_nodes + 63) / 64,
+             sizeof(uint64_t));
+  for (i = 0; i < g->adjarena.num_slabs; i++)
+    free(g->adjarena.slabs[i]);
+  free(g->adjarena.slabs);
+  free(g->allarcs);
+  arcindex_free(&g->allarcs_index);
+  free(g->journal.entries);
+  free(g->pending_arcs);
+  free(g->arclist);
+  free(g->revarclist);
+  free(g->outcapacity);
+  free(g->incapacity);
+  free(g->indegree);
+  free(g->outdegree);
+#if defined(TWOPATH_WITH_UTHASH) || defined(TWOPATH_WITH_OAHASH)
+  deleteAllHashTable(&g->mixTwoPathHashTab);
+  deleteAllHashTable(&g->inTwoPathHashTab);
+  deleteAllHashTable(&g->outTwoPathHashTab);
+#endif /* TWOPATH_WITH_UTHASH || TWOPATH_WITH_OAHASH */
+#ifdef TWOPATH_WITH_UTHASH
+  twopath_pool_free(&g->twopath_pool);
+#endif /* TWOPATH_WITH_UTHASH */
+#ifdef TWOPATH_WITH_ARRAYS
+  freeTwoPathArrays(g);
+#endif /* TWOPATH_WITH_ARRAYS */
+#ifdef TWOPATH_ADAPTIVE
+  freeTwoPathHubs(g);
+  freeTwoPathNodeTabs(g);
+#endif /* TWOPATH_ADAPTIVE */
+  free(g->prev_wave_degree);
+#ifdef TWOPATH_CACHE
+  free(g->twopath_stamp);
+#endif /* TWOPATH_CACHE */
+  free(g->allinnerarcs);
+  arcindex_free(&g->allinnerarcs_index);
+  free(g->deletable_inner_tree);
+  free(g);
+}
+
+
+#ifdef TWOPATH_ADAPTIVE
+/*
+ * Number of two-paths of the kinds kept in the tables of g that have
+ * node v as the middle node.
+ *
+ * Parameters:
+ *   g - digraph
+ *   v - node
+ *
+ * Return value:
+ *   Number of two-paths through v (as a double, as it can be large).
+ */
+static double twopaths_through_node(const digraph_t *g, uint_t v)
+{
+  double outdeg = (double)g->outdegree[v];
+  double indeg = (double)g->indegree[v];
+  double twopaths = 0;
+
+  if (TWOPATH_KEPT(g, TWOPATH_TABLE_MIX))
+    twopaths += indeg * outdeg;
+  if (TWOPATH_KEPT(g, TWOPATH_TABLE_IN))
+    twopaths += indeg * (indeg - 1) / 2;
+  if (TWOPATH_KEPT(g, TWOPATH_TABLE_OUT))
+    twopaths += outdeg * (outdeg - 1) / 2;
+  return twopaths;
+}
+
+/*
+ * Estimate the memory of the two-path tables of g with each backend.
+ * Only the tables kept (see set_twopath_tables()) are counted.
+ *
+ * The number of nonzero two-path counts (hash table entries) is
+ * estimated as the larger of the number of two-paths in g currently
+ * (an upper bound on the number of distinct node pairs they join) and
+ * that expected in a uniform random digraph with num_arcs arcs, so an
+ * expected number of arcs can be given for a digraph that does not yet
+ * have them (e.g. simulation), but no more than the number of array
+ * cells. The per-node tables have the in- and out-two-paths, which are
+ * symmetric, in the tables of both end nodes. The hash table sizes are
+ * worst cases, just after growing.
+ *
+ * Parameters:
+ *   g        - digraph (with arcs, if any, already inserted)
+ *   num_arcs - expected number of arcs (or 0 to use those in g)
+ *   est      - (out) estimated number of entries and bytes
+ *
+ * Return value:
+ *   None.
+ */
+void estimate_twopath_memory(const digraph_t *g, arcidx_t num_arcs,
+                             twopath_memory_estimate_t *est)
+{
+  double n           = (double)g->num_nodes;
+  double m           = (double)MAX(num_arcs, g->num_arcs);
+  double array_cells = 0; /* cells of the arrays kept */
+  double uniform     = 0; /* two-paths kept if uniform random */
+  double uniform_sym = 0; /* of which in- and out-two-paths */
+  double twopaths    = 0;
+  double twopaths_sym = 0; /* of which in- and out-two-paths */
+  double outdeg, indeg;
+  uint_t num_kept    = 0;
+  uint_t v;
+
+  /* mix two-paths m^2/n, in- and out-two-paths m^2/(2n) each, if uniform */
+  if (TWOPATH_KEPT(g, TWOPATH_TABLE_MIX)) {
+    array_cells += (double)TWOPATH_MIX_CELLS(g->num_nodes);
+    uniform += m * m / n;
+    num_kept++;
+  }
+  if (TWOPATH_KEPT(g, TWOPATH_TABLE_IN)) {
+    array_cells += (double)TWOPATH_SYM_CELLS(g->num_nodes);
+    uniform_sym += m * m / (2 * n);
+    num_kept++;
+  }
+  if (TWOPATH_KEPT(g, TWOPATH_TABLE_OUT)) {
+    array_cells += (double)TWOPATH_SYM_CELLS(g->num_nodes);
+    uniform_sym += m * m / (2 * n);
+    num_kept++;
+  }
+  uniform += uniform_sym;
+  for (v = 0; v < g->num_nodes; v++) {
+    twopaths += twopaths_through_node(g, v);
+    outdeg = (double)g->outdegree[v];
+    indeg = (double)g->indegree[v];
+    if (TWOPATH_KEPT(g, TWOPATH_TABLE_IN))
+      twopaths_sym += indeg * (indeg - 1) / 2;
+    if (TWOPATH_KEPT(g, TWOPATH_TABLE_OUT))
+      twopaths_sym += outdeg * (outdeg - 1) / 2;
+  }
+  if (uniform > twopaths) {
+    twopaths = uniform;
+    twopaths_sym = uniform_sym;
+  }
+  /* but cannot be more entries than in the arrays */
+  if (twopaths > array_cells) {
+    twopaths_sym *= array_cells / twopaths;
+    twopaths = array_cells;
+  }
+
+  est->twopaths = twopaths;
+  est->arrays = array_cells * sizeof(twopath_cell_t);
+  est->hashtables = twopaths * TWOPATH_HASHTAB_BYTES_PER_ENTRY;
+  /* load factor up to 0.7, capacity up to double after growing */
+  est->pernode = (twopaths + twopaths_sym) * 2 *
+    sizeof(twopath_nodeentry_t) / 0.7 +
+    num_kept * n * sizeof(twopath_nodetab_t);
+}
+
+/*
+ * Choose the two-path lookup method that is expected to be fastest while
+ * fitting in the memory limit. Dense arrays are fastest but need
+ * O(n^2) memory; otherwise hash tables are used if the (estimated, see
+ * estimate_twopath_memory()) number of nonzero two-path counts fits,
+ * else hash tables of only the two-paths through nodes of low degree
+ * (see choose_twopath_hub_cutoff()) if they fit, else two-paths are
+ * counted on the fly, which needs no extra memory. Only the tables kept
+ * (see set_twopath_tables()) are counted, and if none are, two-paths
+ * are counted on the fly.
+ *
+ * Parameters:
+ *   g             - digraph (with arcs, if any, already inserted)
+ *   num_arcs      - expected number of arcs (or 0 to use those in g)
+ *   max_memory_mb - memory limit (MB) for two-path tables
+ *
+ * Return value:
+ *   Two-path backend to use in set_twopath_backend()
+ */
+twopath_backend_e choose_twopath_backend(const digraph_t *g, arcidx_t num_arcs,
+                                         uint_t max_memory_mb)
+{
+  double budget = (double)max_memory_mb * 1024 * 1024;
+  twopath_memory_estimate_t est;
+
+  if (!g->twopath_tables)
+    return TWOPATH_BACKEND_NONE;
+  estimate_twopath_memory(g, num_arcs, &est);
+  if (est.arrays <= budget)
+    return TWOPATH_BACKEND_ARRAYS;
+  MEMUSAGE_DEBUG_PRINT(("choose_twopath_backend: arrays %f MB, "
+                        "estimated hash tables %f MB, limit %u MB\n",
+                        est.arrays / (1024*1024),
+                        est.hashtables / (1024*1024), max_memory_mb));
+  if (est.hashtables <= budget)
+    return TWOPATH_BACKEND_HASHTABLES;
+  /* the hub cutoff is from the degrees in g, so only if it has the arcs */
+  if (num_arcs <= g->num_arcs &&
+      choose_twopath_hub_cutoff(g, max_memory_mb) > 0)
+    return TWOPATH_BACKEND_HYBRID;
+  return TWOPATH_BACKEND_NONE;
+}
+
+/*
+ * Choose the degree cutoff for two-path hubs with the hybrid two-path
+ * backend (see set_twopath_hub_cutoff()): the largest cutoff for which
+ * the hash tables of the two-paths through the nodes of at most that
+ * (total) degree, and the lists of adjacent hubs, fit in the memory
+ * limit. A node with in-degree d_in and out-degree d_out is the middle
+ * of d_in*d_out + d_in(d_in-1)/2 + d_out(d_out-1)/2 two-paths (of
+ * those only the kinds kept in the tables count here), so
+ * counting those through the few nodes of very high degree on the fly
+ * instead saves most of the memory of the tables in a network with
+ * a skewed degree distribution.
+ *
  * Parameters:
- *   g  - digraph 
+ *   g             - digraph (with arcs already inserted)
+ *   max_memory_mb - memory limit (MB) for two-path tables
  *
  * Return value:
- *   Density of g
+ *   Degree cutoff: nodes of higher total degree are hubs. 0 if only
+ *   isolated nodes fit, or the maximum degree if no node need be a hub.
  */
-double density(const digraph_t *g)
+uint_t choose_twopath_hub_cutoff(const digraph_t *g, uint_t max_memory_mb)
 {
-  return (double)g->num_arcs / ((double)g->num_nodes * (g->num_nodes - 1));
+  uint_t         n = g->num_nodes;
+  double         budget = (double)max_memory_mb * 1024 * 1024;
+  double         fixed = (double)n * (sizeof(uint8_t) + 2 * sizeof(hublist_t));
+  double         twopaths = 0, hub_entries = 0;
+  node_degree_t *nd;
+  uint_t         cutoff = 0, v;
+  int            k;
+
+  nd = (node_degree_t *)safe_malloc(n * sizeof(node_degree_t));
+  for (v = 0; v < n; v++) {
+    nd[v].node = v;
+    nd[v].degree = g->outdegree[v] + g->indegree[v];
+    /* every arc to or from a hub is in the hub list of the other node */
+    hub_entries += nd[v].degree;
+  }
+  qsort(nd, n, sizeof(node_degree_t), compare_degree_descending);
+  /* take nodes out of the hubs in ascending order of degree, all of
+     those with the same degree at once */
+  for (k = (int)n - 1; k >= 0; k--) {
+    v = nd[k].node;
+    twopaths += twopaths_through_node(g, v);
+    hub_entries -= nd[k].degree;
+    if (k > 0 && nd[k - 1].degree == nd[k].degree)
+      continue;
+    /* hub lists can have up to double the capacity of their entries */
+    if (twopaths * TWOPATH_HASHTAB_BYTES_PER_ENTRY + fixed +
+        hub_entries * 2 * sizeof(uint_t) <= budget)
+      cutoff = nd[k].degree;
+  }
+  MEMUSAGE_DEBUG_PRINT(("choose_twopath_hub_cutoff: cutoff %u, "
+                        "limit %u MB\n", cutoff, max_memory_mb));
+  free(nd);
+  return cutoff;
 }
 
 /*
- * Test if arc i -> j exists
+ * Set the degree cutoff for two-path hubs with the hybrid two-path
+ * backend: the nodes with total degree over the cutoff (when the
+ * backend is set) are two-path hubs, and the two-paths with a hub as
+ * the middle node are counted on the fly rather than stored in the
+ * hash tables. If the hybrid backend is in use its tables are rebuilt.
  *
  * Parameters:
- *   g - digraph
- *   i - node to test arc from
- *   j - node to test arc to
+ *   g      - digraph
+ *   cutoff - degree above which nodes are two-path hubs
  *
  * Return value:
- *   TRUE iff arc i->j exists
+ *   None.
  */
-bool isArc(const digraph_t *g, uint_t i, uint_t j)
+void set_twopath_hub_cutoff(digraph_t *g, uint_t cutoff)
 {
-  uint_t k;
-  assert(i < g->num_nodes);
-  assert(j < g->num_nodes);
-  if (g->outdegree[i] < g->indegree[j]) {
-    for (k = 0; k < g->outdegree[i]; k++)  {
-      if (g->arclist[i][k] == j) {
-        return TRUE;
-      }
-    }
-  } else {
-    for (k = 0; k < g->indegree[j]; k++) {
-      if (g->revarclist[j][k] == i) {
-        return TRUE;
-      }
-    }
+  if (g->twopath_hub_cutoff == cutoff)
+    return;
+  g->twopath_hub_cutoff = cutoff;
+  if (g->twopath_backend == TWOPATH_BACKEND_HYBRID) {
+    set_twopath_backend(g, TWOPATH_BACKEND_NONE);
+    set_twopath_backend(g, TWOPATH_BACKEND_HYBRID);
   }
-  return FALSE;
 }
 
 /*
- * Test if an arc in either direction between i and j (i.e. either
- *  i -> j or j -> i) exists
+ * Change the two-path lookup method used for g, freeing the tables
+ * of the previous one (if any) and building the new tables from the
+ * arcs currently in g. Does nothing if already using the backend.
  *
  * Parameters:
- *   g - digraph
- *   i - node to test arc from/to
- *   j - node to test arc from/to
+ *   g       - digraph
+ *   backend - two-path lookup method to use
  *
  * Return value:
- *   TRUE iff arc i->j or j->i exists
+ *   None.
  */
-bool isArcIgnoreDirection(const digraph_t *g, uint_t i, uint_t j)
+void set_twopath_backend(digraph_t *g, twopath_backend_e backend)
 {
-  return isArc(g, i, j) || isArc(g, j, i);
+  if (g->twopath_backend == backend)
+    return;
+  freeTwoPathArrays(g);
+  deleteAllHashTable(&g->mixTwoPathHashTab);
+  deleteAllHashTable(&g->inTwoPathHashTab);
+  deleteAllHashTable(&g->outTwoPathHashTab);
+  freeTwoPathHubs(g);
+  freeTwoPathNodeTabs(g);
+  g->twopath_backend = backend;
+  if (backend == TWOPATH_BACKEND_ARRAYS)
+    allocateTwoPathArrays(g);
+  else if (backend == TWOPATH_BACKEND_HYBRID)
+    allocateTwoPathHubs(g);
+  else if (backend == TWOPATH_BACKEND_PERNODE)
+    allocateTwoPathNodeTabs(g);
+  /* hash tables are allocated on first insertion */
+  if (backend != TWOPATH_BACKEND_NONE)
+    buildTwoPathTables(g);
 }
 
 /*
- * Insert arc i -> j into digraph g, WITHOUT updating allarcs flat arc list
+ * Set which two-path tables are kept by the two-path backend of g.
+ * The others are not allocated or updated as arcs are inserted and
+ * removed, and their counts are computed on the fly when looked up
+ * (GET_MIX2PATH_ENTRY() etc.), so this only affects speed and memory
+ * use, not results. Best set before the backend is chosen (as
+ * choose_twopath_backend() only counts the memory of the tables
+ * kept), but if a backend is in use its tables are rebuilt.
  *
  * Parameters:
- *   g - digraph
- *   i - node to insert arc from
- *   j - node to insert arc to
+ *   g      - digraph
+ *   tables - bitwise OR of TWOPATH_TABLE_MIX, TWOPATH_TABLE_IN,
+ *            TWOPATH_TABLE_OUT (TWOPATH_TABLES_ALL by default)
  *
  * Return value:
- *   None
+ *   None.
  */
-void insertArc(digraph_t *g, uint_t i, uint_t j)
+void set_twopath_tables(digraph_t *g, uint8_t tables)
 {
-  assert(i < g->num_nodes);
-  assert(j < g->num_nodes);
-  g->num_arcs++;
-  g->arclist[i] = (uint_t *)safe_realloc(g->arclist[i],
-                                         (g->outdegree[i]+1) * sizeof(uint_t));
-  g->arclist[i][g->outdegree[i]++] = j;
-  g->revarclist[j] = (uint_t *)safe_realloc(g->revarclist[j],
-                                            (g->indegree[j]+1) * sizeof(uint_t));
-  g->revarclist[j][g->indegree[j]++] = i;
-#ifdef TWOPATH_LOOKUP
-  updateTwoPathsMatrices(g, i, j, TRUE);
-#endif /* TWOPATH_LOOKUP */
-  DIGRAPH_DEBUG_PRINT(("insertArc %u -> %u indegree(%u) = %u outdegre(%u) = %u\n", i, j, j, g->indegree[j], i, g->outdegree[i]));
-  /*removed as slows significantly: assert(isArc(g, i, j));*/
+  twopath_backend_e backend = g->twopath_backend;
 
-  /* update zone information for snowball conditional estimation */
-  if (g->zone[i] > g->zone[j]) {
-    assert(g->zone[i] == g->zone[j] + 1);
-    g->prev_wave_degree[i]++;
-  } else if (g->zone[j] > g->zone[i]) {
-    assert(g->zone[j] == g->zone[i] + 1);
-    g->prev_wave_degree[j]++;
-  }
+  assert((tables & ~TWOPATH_TABLES_ALL) == 0);
+  if (g->twopath_tables == tables)
+    return;
+  set_twopath_backend(g, TWOPATH_BACKEND_NONE);
+  g->twopath_tables = tables;
+  set_twopath_backend(g, backend);
 }
 
 /*
- * Remove arc i -> j from digraph g, WITHOUT updating allarcs flat arc list
+ * Return descriptive name of two-path lookup method.
  *
  * Parameters:
- *   g - digraph
- *   i - node to remove arc from
- *   j - node to remove arc to
+ *   backend - two-path lookup method
  *
  * Return value:
- *   None
+ *   Name of the method (static string)
  */
-void removeArc(digraph_t *g, uint_t i, uint_t j)
+const char *twopath_backend_name(twopath_backend_e backend)
 {
-  uint_t k;
-  DIGRAPH_DEBUG_PRINT(("removeArc %u -> %u indegree(%u) = %u outdegre(%u) = %u\n", i, j, j, g->indegree[j], i, g->outdegree[i]));
-  /*removed as slows significantly: assert(isArc(g, i, j));*/
-  assert(i < g->num_nodes);
-  assert(j < g->num_nodes);
-  assert(g->num_arcs > 0);
-  assert(g->outdegree[i] > 0);
-  assert(g->indegree[j] > 0);
-#ifdef ORDERED_ARCLIST
-  /* we have to find the entry for j in the arc list and then move 
-     everything after it back one, overwriting it. Note if it is
-     last entry then memmove() has size 0 but that is fine.
-     Same for reverse arc list. */
-  for (k = 0; k < g->outdegree[i] && g->arclist[i][k] != j; k++)
-    /*nothing*/;
-  assert(g->arclist[i][k] == j);
-  memmove(&g->arclist[i][k], &g->arclist[i][k+1],
-          sizeof(uint_t)*(g->outdegree[i]-k));
-  //     This is needed to keep the arclist ordered.
-  //     However  this code is only used when ORDERD_ARCLIST is
-  //     defined, which it is not, as I decided we did not need it. (We do
-  //     not keep the arc list in any order -- but I tested the code to
-  //     do it in case we do want to do so in the future).
-  for (k = 0; k < g->indegree[j] && g->revarclist[j][k] != i; k++)
-    /*nothing*/;
-  assert(g->revarclist[j][k] == i);
-  memmove(&g->revarclist[j][k], &g->revarclist[j][k+1],
-          sizeof(uint_t)*(g->indegree[j]-k));
-#else
-  /* arclist is not ordered, so  just replace deleted entry
-     with last entry */
-  for (k = 0; k < g->outdegree[i] && g->arclist[i][k] != j; k++)
-    /*nothing*/;
-  assert(g->arclist[i][k] == j);
-  g->arclist[i][k] = g->arclist[i][g->outdegree[i]-1];
-  for (k = 0; k < g->indegree[j] && g->revarclist[j][k] != i; k++)
-    /*nothing*/;
-  assert(g->revarclist[j][k] == i);
-  g->revarclist[j][k] = g->revarclist[j][g->indegree[j]-1];
-#endif
-
-  g->num_arcs--;
-  g->outdegree[i]--;
-  g->indegree[j]--;
-#ifdef TWOPATH_LOOKUP
-  updateTwoPathsMatrices(g, i, j, FALSE);
-#endif /* TWOPATH_LOOKUP */
-
-  /* update zone information for snowball conditional estimation */ 
-  if (g->zone[i] > g->zone[j]) {
-    assert(g->prev_wave_degree[i] > 1);
-    g->prev_wave_degree[i]--;
-  } else if (g->zone[j] > g->zone[i]) {
-    assert(g->prev_wave_degree[j] > 1);
-    g->prev_wave_degree[j]--;
+  switch (backend) {
+    case TWOPATH_BACKEND_ARRAYS:
+      return "arrays";
+    case TWOPATH_BACKEND_HASHTABLES:
+      return "hash tables";
+    case TWOPATH_BACKEND_HYBRID:
+      return "hybrid (hash tables, hubs counted on the fly)";
+    case TWOPATH_BACKEND_PERNODE:
+      return "per-node hash tables";
+    default:
+      return "none (counted on the fly)";
   }
 }
 
-
 /*
- * Insert arc i -> j into digraph g, updating allarcs flat arc list
+ * Get two-path lookup method from its name as used in config files.
  *
  * Parameters:
- *   g - digraph
- *   i - node to insert arc from
- *   j - node to insert arc to
+ *    name - "auto", "arrays", "hashtables", "hybrid", "pernode" or
+ *           "none" (case insensitive), or NULL for auto
  *
  * Return value:
- *   None
+ *    two-path lookup method (TWOPATH_BACKEND_AUTO to choose it with
+ *    choose_twopath_backend()), or TWOPATH_BACKEND_INVALID if name is
+ *    not recognized
  */
-void insertArc_allarcs(digraph_t *g, uint_t i, uint_t j)
+twopath_backend_e twopath_backend_from_name(const char *name)
 {
-  insertArc(g, i, j);
-  g->allarcs = (nodepair_t *)safe_realloc(g->allarcs,
-                                          g->num_arcs * sizeof(nodepair_t));
-  g->allarcs[g->num_arcs-1].i = i;
-  g->allarcs[g->num_arcs-1].j = j;
+  if (!name || strcasecmp(name, "auto") == 0)
+    return TWOPATH_BACKEND_AUTO;
+  if (strcasecmp(name, "arrays") == 0)
+    return TWOPATH_BACKEND_ARRAYS;
+  if (strcasecmp(name, "hashtables") == 0)
+    return TWOPATH_BACKEND_HASHTABLES;
+  if (strcasecmp(name, "hybrid") == 0)
+    return TWOPATH_BACKEND_HYBRID;
+  if (strcasecmp(name, "pernode") == 0)
+    return TWOPATH_BACKEND_PERNODE;
+  if (strcasecmp(name, "none") == 0)
+    return TWOPATH_BACKEND_NONE;
+  return TWOPATH_BACKEND_INVALID;
 }
 
 /*
- * Remove arc i -> j from digraph g, updating allarcs flat arc list
+ * Get the count for node j in a per-node two-path table.
  *
  * Parameters:
- *   g - digraph
- *   i - node to remove arc from
- *   j - node to remove arc to
- *   arcidx - index in allarcs flat arc list of the i->j entry for fast removal
- *            as this is known (arc has been selected from this list)
+ *     t - per-node two-path table of node i
+ *     j - other end node
  *
  * Return value:
- *   None
+ *     Number of two-paths between i and j (of the kind of the table).
  */
-void removeArc_allarcs(digraph_t *g, uint_t i, uint_t j, uint_t arcidx)
+uint_t get_twopath_nodetab_entry(const twopath_nodetab_t *t, uint_t j)
 {
-  removeArc(g, i, j);
-  /* remove entry from the flat all arcs list */
-  assert(g->allarcs[arcidx].i == i && g->allarcs[arcidx].j == j);
-  /* replace deleted entry with last entry */
-  /* g->num_arcs already decremented by removeArc() */
-  g->allarcs[arcidx].i = g->allarcs[g->num_arcs].i;
-  g->allarcs[arcidx].j = g->allarcs[g->num_arcs].j;
-}
+  uint32_t mask, pos;
 
+  if (t->capacity == 0)
+    return 0;
+  mask = t->capacity - 1;
+  for (pos = nodetab_hash(j) & mask; t->slots[pos].node != TWOPATH_NODETAB_EMPTY;
+       pos = (pos + 1) & mask) {
+    if (t->slots[pos].node == j)
+      return t->slots[pos].count;
+  }
+  return 0;
+}
 
 /*
- * Insert arc i -> j into digraph g, updating allinnerarcs flat arc list
- *
- * Used for conditional estimation when we must add an arc that is
- * between nodes in inner zones and in same zone or adjacent zones only.
+ * Prefetch the slot where the probe for node j in a per-node two-path
+ * table starts, for a later get_twopath_nodetab_entry(t, j).
  *
  * Parameters:
- *   g - digraph
- *   i - node to insert arc from
- *   j - node to insert arc to
+ *     t - per-node two-path table
+ *     j - other end node
  *
  * Return value:
- *   None
+ *     None
  */
-void insertArc_allinnerarcs(digraph_t *g, uint_t i, uint_t j)
+void prefetch_twopath_nodetab_entry(const twopath_nodetab_t *t, uint_t j)
 {
-  assert(g->zone[i] < g->max_zone && g->zone[j] < g->max_zone);
-  assert(labs((long)g->zone[i] - (long)g->zone[j]) <= 1);
-  insertArc(g, i, j);
-  g->num_inner_arcs++;
-  g->allinnerarcs = (nodepair_t *)safe_realloc(g->allinnerarcs,
-                                               g->num_inner_arcs *
-                                               sizeof(nodepair_t));
-  g->allinnerarcs[g->num_inner_arcs-1].i = i;
-  g->allinnerarcs[g->num_inner_arcs-1].j = j;
+  if (t->capacity == 0)
+    return;
+  PREFETCH(&t->slots[nodetab_hash(j) & (t->capacity - 1)]);
 }
 
 /*
- * Remove arc i -> j from digraph g, updating allinnerarcs flat arc list
- *
- * Used for conditional estimation when we must delete an arc that is
- * between nodes in inner zones and in same zone or adjacent zones only.
+ * Count the two-paths i -> v -> j through two-path hubs v, which are
+ * not in the hash tables with the hybrid backend, by testing the arcs
+ * to or from the hubs in the shorter of the hub lists of i and j.
  *
  * Parameters:
- *   g - digraph
- *   i - node to remove arc from
- *   j - node to remove arc to
- *   arcidx - index in allinnerarcs flat arc list of the i->j entry for fast 
- *            removal as this is known (arc has been selected from this list)
+ *   g - digraph (using TWOPATH_BACKEND_HYBRID)
+ *   i - first node
+ *   j - last node
  *
  * Return value:
- *   None
+ *   Number of two-paths i -> v -> j with v a two-path hub.
  */
-void removeArc_allinnerarcs(digraph_t *g, uint_t i, uint_t j, uint_t arcidx)
+uint_t hubMixTwoPaths(const digraph_t *g, uint_t i, uint_t j)
 {
-  assert(g->zone[i] < g->max_zone && g->zone[j] < g->max_zone);
-  assert(labs((long)g->zone[i] - (long)g->zone[j]) <= 1);
-  removeArc(g, i, j);
-  /* remove entry from the flat all arcs list */
-  assert(g->allinnerarcs[arcidx].i == i && g->allinnerarcs[arcidx].j == j);
-  /* replace deleted entry with last entry */
-  g->num_inner_arcs--;
-  g->allinnerarcs[arcidx].i = g->allinnerarcs[g->num_inner_arcs].i;
-  g->allinnerarcs[arcidx].j = g->allinnerarcs[g->num_inner_arcs].j;
+  const hublist_t *l;
+  uint_t           k, v, count = 0;
+
+  if (g->hub_out[i].len <= g->hub_in[j].len) {
+    l = &g->hub_out[i];
+    for (k = 0; k < l->len; k++) {
+      v = l->nodes[k];  /* i -> v */
+      if (v != i && v != j && isArc(g, v, j))
+        count++;
+    }
+  } else {
+    l = &g->hub_in[j];
+    for (k = 0; k < l->len; k++) {
+      v = l->nodes[k];  /* v -> j */
+      if (v != i && v != j && isArc(g, i, v))
+        count++;
+    }
+  }
+  return count;
 }
 
+/*
+ * Count the out-two-paths i <- v -> j through two-path hubs v, which are
+ * not in the hash tables with the hybrid backend.
+ *
+ * Parameters:
+ *   g - digraph (using TWOPATH_BACKEND_HYBRID)
+ *   i - first node
+ *   j - last node
+ *
+ * Return value:
+ *   Number of two-paths i <- v -> j with v a two-path hub.
+ */
+uint_t hubOutTwoPaths(const digraph_t *g, uint_t i, uint_t j)
+{
+  const hublist_t *l;
+  uint_t           k, v, count = 0, other;
 
+  if (g->hub_in[i].len <= g->hub_in[j].len) {
+    l = &g->hub_in[i];
+    other = j;
+  } else {
+    l = &g->hub_in[j];
+    other = i;
+  }
+  for (k = 0; k < l->len; k++) {
+    v = l->nodes[k];
+    if (v != i && v != j && isArc(g, v, other))
+      count++;
+  }
+  return count;
+}
 
 /*
- * Allocate the  digraph structure for empty digraph with given
- * number of nodes.
+ * Count the in-two-paths i -> v <- j through two-path hubs v, which are
+ * not in the hash tables with the hybrid backend.
  *
  * Parameters:
- *    num_vertices - number of nodes in digraph
+ *   g - digraph (using TWOPATH_BACKEND_HYBRID)
+ *   i - first node
+ *   j - last node
  *
- * Return values:
- *    Allocated and initizlied to empty digraph
+ * Return value:
+ *   Number of two-paths i -> v <- j with v a two-path hub.
  */
-digraph_t *allocate_digraph(uint_t num_vertices)
+uint_t hubInTwoPaths(const digraph_t *g, uint_t i, uint_t j)
 {
-  digraph_t *g = (digraph_t *)safe_malloc(sizeof(digraph_t));
-  
-  g->num_nodes = num_vertices;
-  g->num_arcs = 0;
-  g->outdegree = (uint_t *)safe_calloc((size_t)num_vertices, sizeof(uint_t));
-  g->arclist = (uint_t **)safe_calloc((size_t)num_vertices, sizeof(uint_t *));
-  g->indegree = (uint_t *)safe_calloc((size_t)num_vertices, sizeof(uint_t));
-  g->revarclist = (uint_t **)safe_calloc((size_t)num_vertices, sizeof(uint_t *));
-  g->allarcs = NULL;
+  const hublist_t *l;
+  uint_t           k, v, count = 0, other;
 
-#ifdef TWOPATH_LOOKUP
-#ifdef TWOPATH_HASHTABLES
-  g->mixTwoPathHashTab = NULL;
-  g->inTwoPathHashTab = NULL;
-  g->outTwoPathHashTab = NULL;
-
-  assert(sizeof(void *) == 8); /* require 64 bit addressing for large uthash */
-#ifdef DEBUG_MEMUSAGE
-#ifdef HASH_BLOOM
-  /* https://troydhanson.github.io/uthash/userguide.html#_bloom_filter_faster_misses */
-  MEMUSAGE_DEBUG_PRINT(("Bloom filter n = %u overhead %f MB (three times)\n",
-                        HASH_BLOOM, (pow(2, HASH_BLOOM)/8192)/(1024)));
-#endif /* HASH_BLOOM */
-#endif /* DEBUG_MEMUSAGE */
-#else
-  g->mixTwoPathMatrix = (uint_t *)safe_calloc((size_t)num_vertices * num_vertices,
-                                              sizeof(uint_t));
-  g->inTwoPathMatrix = (uint_t *)safe_calloc((size_t)num_vertices * num_vertices,
-                                             sizeof(uint_t));
-  g->outTwoPathMatrix = (uint_t *)safe_calloc((size_t)num_vertices * num_vertices,
-                                              sizeof(uint_t));
-#ifdef DEBUG_MEMUSAGE
-  MEMUSAGE_DEBUG_PRINT(("mixTwoPathMatrix size %f MB\n", 
-                        (double)num_vertices*num_vertices*sizeof(uint_t)/
-                        (1024*1024)));
-  MEMUSAGE_DEBUG_PRINT(("inTwoPathMatrix size %f MB\n", 
-                        (double)num_vertices*num_vertices*sizeof(uint_t)/
-                        (1024*1024)));
-  MEMUSAGE_DEBUG_PRINT(("outTwoPathMatrix size %f MB\n", 
-                        (double)num_vertices*num_vertices*sizeof(uint_t)/
-                        (1024*1024)));
-#endif /*DEBUG_MEMUSAGE*/
-#endif /* TWOPATH_HASHTABLES */
-#endif /* TWOPATH_LOOKUP */
-  
-  g->num_binattr = 0;
-  g->binattr_names = NULL;
-  g->binattr = NULL;
-  g->num_catattr = 0;
-  g->catattr_names = NULL;
-  g->catattr = NULL;
-  g->num_contattr = 0;
-  g->contattr_names = NULL;
-  g->contattr = NULL;
-  g->num_setattr = 0;
-  g->setattr_names = NULL;
-  g->setattr_lengths = NULL;
-  g->setattr = NULL;
+  if (g->hub_out[i].len <= g->hub_out[j].len) {
+    l = &g->hub_out[i];
+    other = j;
+  } else {
+    l = &g->hub_out[j];
+    other = i;
+  }
+  for (k = 0; k < l->len; k++) {
+    v = l->nodes[k];
+    if (v != i && v != j && isArc(g, other, v))
+      count++;
+  }
+  return count;
+}
+#endif /* TWOPATH_ADAPTIVE */
 
-  g->zone  = (uint_t *)safe_calloc((size_t)num_vertices, sizeof(uint_t));
-  g->max_zone = 0;
-  g->num_inner_nodes = 0;
-  g->inner_nodes = NULL;
-  g->prev_wave_degree  = (uint_t *)safe_calloc((size_t)num_vertices, sizeof(uint_t));
-  g->num_inner_arcs = 0;
-  g->allinnerarcs = NULL;
-  return g;
+/*
+ * Get the size of the two-path lookup tables of g (for reporting).
+ *
+ * Parameters:
+ *   g       - digraph
+ *   bytes   - (Out) memory used by the tables
+ *   entries - (Out) number of counts the tables hold: every cell of
+ *             the arrays (plus the spill entries), or the entries of
+ *             the hash tables
+ *
+ * Return value:
+ *   None. Both are 0 if two-paths are counted on the fly.
+ */
+void twopath_table_size(const digraph_t *g, double *bytes, double *entries)
+{
+  *bytes = 0;
+  *entries = 0;
+#ifdef TWOPATH_WITH_ARRAYS
+  /* only the arrays of the kinds kept are allocated */
+  if (g->mixTwoPathMatrix) {
+    *entries += (double)TWOPATH_MIX_CELLS(g->num_nodes) +
+      TWOPATH_HASHTAB_COUNT(g->mixTwoPathSpill);
+    *bytes += (double)TWOPATH_MIX_CELLS(g->num_nodes) *
+      sizeof(twopath_cell_t) + TWOPATH_HASHTAB_BYTES(g->mixTwoPathSpill);
+  }
+  if (g->inTwoPathMatrix) {
+    *entries += (double)TWOPATH_SYM_CELLS(g->num_nodes) +
+      TWOPATH_HASHTAB_COUNT(g->inTwoPathSpill);
+    *bytes += (double)TWOPATH_SYM_CELLS(g->num_nodes) *
+      sizeof(twopath_cell_t) + TWOPATH_HASHTAB_BYTES(g->inTwoPathSpill);
+  }
+  if (g->outTwoPathMatrix) {
+    *entries += (double)TWOPATH_SYM_CELLS(g->num_nodes) +
+      TWOPATH_HASHTAB_COUNT(g->outTwoPathSpill);
+    *bytes += (double)TWOPATH_SYM_CELLS(g->num_nodes) *
+      sizeof(twopath_cell_t) + TWOPATH_HASHTAB_BYTES(g->outTwoPathSpill);
+  }
+#endif /* TWOPATH_WITH_ARRAYS */
+#if defined(TWOPATH_WITH_UTHASH) || defined(TWOPATH_WITH_OAHASH)
+  *entries += TWOPATH_HASHTAB_COUNT(g->mixTwoPathHashTab) +
+    TWOPATH_HASHTAB_COUNT(g->inTwoPathHashTab) +
+    TWOPATH_HASHTAB_COUNT(g->outTwoPathHashTab);
+  *bytes += TWOPATH_HASHTAB_BYTES(g->mixTwoPathHashTab) +
+    TWOPATH_HASHTAB_BYTES(g->inTwoPathHashTab) +
+    TWOPATH_HASHTAB_BYTES(g->outTwoPathHashTab);
+#endif /* TWOPATH_WITH_UTHASH || TWOPATH_WITH_OAHASH */
+#ifdef TWOPATH_ADAPTIVE
+  *entries += nodetabs_count(g, g->mixTwoPathNodeTabs) +
+    nodetabs_count(g, g->inTwoPathNodeTabs) +
+    nodetabs_count(g, g->outTwoPathNodeTabs);
+  *bytes += (double)(nodetabs_bytes(g, g->mixTwoPathNodeTabs) +
+                     nodetabs_bytes(g, g->inTwoPathNodeTabs) +
+                     nodetabs_bytes(g, g->outTwoPathNodeTabs));
+#endif /* TWOPATH_ADAPTIVE */
+  (void)g; /* unused if no two-path tables */
 }
 
+
 /*
- * Free the digraph internal structures and digraph itself
+ * Bytes of memory used by the node attributes of g, including the
+ * arrays of pointers to them and their names.
  *
  * Parameters:
- *    g - digraph to deallocate
+ *   g      - digraph
+ *   values - (out) bytes of the attribute values
+ *   other  - (out) bytes of the names and arrays of pointers
+ *
  * Return value:
- *    None
- * Note the pointer g itelf is freed in this function
+ *   None.
  */
-void free_digraph(digraph_t *g)
+static void attributes_memory_usage(const digraph_t *g, size_t *values,
+                                    size_t *other)
 {
-  uint_t i;
+  size_t n = g->num_nodes;
+  size_t bitset = SETATTR_WORDS(n) * sizeof(uint64_t);
+  uint_t u;
 
-  for (i = 0; i < g->num_binattr; i++) {
-    free(g->binattr_names[i]);
-    free(g->binattr[i]);
+  *values = 0;
+  *other = 0;
+  for (u = 0; u < g->num_binattr; u++) {
+    *values += 2 * bitset; /* binattr and binattr_na */
+    *other += strlen(g->binattr_names[u]) + 1 + 3 * sizeof(void *);
   }
-  free(g->binattr);
-  free(g->binattr_names);
-  for (i = 0; i < g->num_catattr; i++) {
-    free(g->catattr_names[i]);
-    free(g->catattr[i]);
+  for (u = 0; u < g->num_catattr; u++) {
+    *values += n * g->catattr_width[u];
+    *other += strlen(g->catattr_names[u]) + 1 + 2 * sizeof(void *) +
+      sizeof(uint8_t);
   }
-  free(g->catattr);
-  free(g->catattr_names);
-  for (i = 0; i < g->num_contattr; i++) {
-    free(g->contattr_names[i]);
-    free(g->contattr[i]);
+  for (u = 0; u < g->num_contattr; u++) {
+    *values += 2 * n * sizeof(contattr_t); /* contattr and contattr_term */
+    *other += strlen(g->contattr_names[u]) + 1 + 3 * sizeof(void *);
   }
-  free(g->contattr);
-  free(g->contattr_names);
-  for (i = 0; i < g->num_setattr; i++) {
-    free(g->setattr_names[i]);
-    free(g->setattr[i]);
+  for (u = 0; u < g->num_setattr; u++) {
+    *values += n * (g->setattr_lengths[u] * sizeof(set_elem_e) +
+                    SETATTR_WORDS(g->setattr_lengths[u]) * sizeof(uint64_t))
+      + bitset;
+    *other += strlen(g->setattr_names[u]) + 1 + 4 * sizeof(void *) +
+      sizeof(uint_t) + 2 * n * sizeof(void *);
   }
-  free(g->setattr);
-  free(g->setattr_names);
-  for (i = 0; i < g->num_nodes; i++)  {
-    free(g->arclist[i]);
-    free(g->revarclist[i]);
+  if (g->dyadcov_rowstart) {
+    *values += (n + 1) * sizeof(uint64_t) + g->dyadcov_nnz *
+      (sizeof(uint_t) + g->num_dyadcov * sizeof(contattr_t));
+    for (u = 0; u < g->num_dyadcov; u++)
+      *other += strlen(g->dyadcov_names[u]) + 1 + 2 * sizeof(void *);
   }
-  free(g->allarcs);
-  free(g->arclist);
-  free(g->revarclist);
-  free(g->indegree);
-  free(g->outdegree);
-#ifdef TWOPATH_LOOKUP
-#ifdef TWOPATH_HASHTABLES
-  deleteAllHashTable(g->mixTwoPathHashTab);
-  deleteAllHashTable(g->inTwoPathHashTab);
-  deleteAllHashTable(g->outTwoPathHashTab);
-#else /* using arrays not hash tables for two-path lookup */
-  free(g->mixTwoPathMatrix);
-  free(g->inTwoPathMatrix);
-  free(g->outTwoPathMatrix);
-#endif /* TWOPATH_HASHTABLES */
-#endif /* TWOPATH_LOOKUP */
-  free(g->zone);
-  free(g->inner_nodes);
-  free(g->prev_wave_degree);
-  free(g->allinnerarcs);
-  free(g);
+}
+
+/*
+ * Measure the memory used by a digraph: its adjacency lists, flat arc
+ * lists, attributes and each two-path table, including allocated but
+ * unused capacity. This is a walk over the structures, O(N) in the
+ * number of nodes, so it is cheap enough to call between phases or
+ * now and then while sampling.
+ *
+ * Parameters:
+ *   g   - digraph
+ *   mem - (out) bytes used by each part of g
+ *
+ * Return value:
+ *   None.
+ */
+void digraph_memory_usage(const digraph_t *g, digraph_memory_t *mem)
+{
+  size_t n = g->num_nodes;
+  size_t values, other;
+  uint_t i;
+#ifdef TWOPATH_WITH_UTHASH
+  size_t live_records;
+#endif /* TWOPATH_WITH_UTHASH */
+
+  memset(mem, 0, sizeof(digraph_memory_t));
+
+  /* outdegree, indegree, outcapacity, incapacity, arclist, revarclist */
+  mem->adjacency = n * (4 * sizeof(uint_t) + 2 * sizeof(nodeid_t *)) +
+    g->adjarena.num_slabs * (ADJ_SLAB_SIZE * sizeof(nodeid_t) +
+                             sizeof(nodeid_t *));
+  for (i = 0; i < n; i++) {
+    /* only lists too large for the slabs were individually allocated */
+    if (g->outcapacity[i] > (1U << ADJ_MAX_SLAB_CLASS))
+      mem->adjacency += (size_t)g->outcapacity[i] * sizeof(nodeid_t);
+    if (g->incapacity[i] > (1U << ADJ_MAX_SLAB_CLASS))
+      mem->adjacency += (size_t)g->incapacity[i] * sizeof(nodeid_t);
+    mem->hub_sets += ((size_t)g->outhubset[i].capacity +
+                      g->inhubset[i].capacity) * sizeof(uint_t);
+  }
+  mem->hub_sets += 2 * n * sizeof(nodeset_t);
+  if (g->arcbitmatrix)
+    mem->arc_bitmatrix = (n * n + 63) / 64 * sizeof(uint64_t);
+  if (g->dyad_cache)
+    mem->dyad_cache = dyad_cache_bytes(n, g->dyad_cache->num_stats);
+
+  mem->arc_lists = (size_t)g->allarcs_capacity * sizeof(nodepair_t) +
+    (size_t)g->num_inner_arcs * sizeof(nodepair_t) +
+    (size_t)g->num_pending_arcs * sizeof(nodepair_t) +
+    (g->allarcs_index.capacity + g->allinnerarcs_index.capacity) *
+    (sizeof(uint64_t) + sizeof(uint_t)) +
+    (g->deletable_inner_tree ?
+     ((size_t)g->deletable_inner_tree_size + 1) * sizeof(arcidx_t) : 0);
+
+  attributes_memory_usage(g, &values, &other);
+  mem->attributes = other;
+  if (g->shared_attributes)
+    mem->shared_attributes = values;
+  else
+    mem->attributes += values;
+
+  if (g->orig_node)
+    mem->nodes += n * sizeof(uint_t);
+  if (g->node_ids)
+    mem->nodes += g->node_ids->capacity * (sizeof(uint64_t) + sizeof(uint_t))
+      + (g->node_ids->ids ? MAX(n, 1) * sizeof(uint64_t) : 0);
+  if (g->geo_coords)
+    mem->nodes += n * sizeof(point3_t);
+  if (g->euclidean_coords)
+    mem->nodes += n * sizeof(point3_t);
+  if (g->altinstar)
+    mem->nodes += 2 * n * sizeof(double);
+  if (g->altoutstar)
+    mem->nodes += 2 * n * sizeof(double);
+  if (g->cat_pair_table)
+    mem->nodes += n * sizeof(uint32_t) +
+      (size_t)g->cat_pair_table->num_codes * g->cat_pair_table->num_codes *
+      sizeof(uint32_t);
+  if (g->block)
+    mem->nodes += 2 * n * sizeof(uint_t) + /* block and block_nodes */
+      (g->num_blocks + 1) * sizeof(uint_t) +
+      g->num_blocks * sizeof(uint64_t);
+  if (g->zone)
+    mem->nodes += 2 * n * sizeof(uint_t) + /* zone and prev_wave_degree */
+      (size_t)g->num_inner_nodes * sizeof(uint_t) +
+      (g->max_zone + 1) * sizeof(uint_t) +
+      (g->max_zone > 0 ? (2 * (size_t)g->max_zone - 1) * sizeof(uint64_t) :
+       0);
+#ifdef TWOPATH_CACHE
+  mem->nodes += n * sizeof(twopath_stamp_t);
+#endif /* TWOPATH_CACHE */
+
+#ifdef TWOPATH_WITH_ARRAYS
+  if (g->mixTwoPathMatrix)
+    mem->twopath_mix = TWOPATH_MIX_CELLS(n) * sizeof(twopath_cell_t) +
+      TWOPATH_HASHTAB_BYTES(g->mixTwoPathSpill);
+  if (g->inTwoPathMatrix)
+    mem->twopath_in = TWOPATH_SYM_CELLS(n) * sizeof(twopath_cell_t) +
+      TWOPATH_HASHTAB_BYTES(g->inTwoPathSpill);
+  if (g->outTwoPathMatrix)
+    mem->twopath_out = TWOPATH_SYM_CELLS(n) * sizeof(twopath_cell_t) +
+      TWOPATH_HASHTAB_BYTES(g->outTwoPathSpill);
+#endif /* TWOPATH_WITH_ARRAYS */
+#if defined(TWOPATH_WITH_UTHASH) || defined(TWOPATH_WITH_OAHASH)
+  mem->twopath_mix += TWOPATH_HASHTAB_BYTES(g->mixTwoPathHashTab);
+  mem->twopath_in += TWOPATH_HASHTAB_BYTES(g->inTwoPathHashTab);
+  mem->twopath_out += TWOPATH_HASHTAB_BYTES(g->outTwoPathHashTab);
+#endif /* TWOPATH_WITH_UTHASH || TWOPATH_WITH_OAHASH */
+#ifdef TWOPATH_WITH_UTHASH
+  /* the records of the tables are counted above, the rest of the pool
+     slabs is free records */
+  live_records = TWOPATH_HASHTAB_COUNT(g->mixTwoPathHashTab) +
+    TWOPATH_HASHTAB_COUNT(g->inTwoPathHashTab) +
+    TWOPATH_HASHTAB_COUNT(g->outTwoPathHashTab);
+  mem->twopath_free = g->twopath_pool.num_slabs *
+    (TWOPATH_POOL_SLAB_RECORDS * sizeof(twopath_record_t) +
+     sizeof(twopath_record_t *)) - live_records * sizeof(twopath_record_t);
+#endif /* TWOPATH_WITH_UTHASH */
+#ifdef TWOPATH_ADAPTIVE
+  mem->twopath_mix += nodetabs_bytes(g, g->mixTwoPathNodeTabs);
+  mem->twopath_in += nodetabs_bytes(g, g->inTwoPathNodeTabs);
+  mem->twopath_out += nodetabs_bytes(g, g->outTwoPathNodeTabs);
+  if (g->twopath_hub) {
+    mem->twopath_hubs = n * (sizeof(uint8_t) + 2 * sizeof(hublist_t));
+    for (i = 0; i < n; i++)
+      mem->twopath_hubs += ((size_t)g->hub_out[i].capacity +
+                            g->hub_in[i].capacity) * sizeof(uint_t);
+  }
+#endif /* TWOPATH_ADAPTIVE */
+
+  mem->total = sizeof(digraph_t) + mem->adjacency + mem->hub_sets +
+    mem->arc_bitmatrix + mem->dyad_cache + mem->arc_lists + mem->attributes + mem->nodes +
+    mem->twopath_mix + mem->twopath_in + mem->twopath_out +
+    mem->twopath_free + mem->twopath_hubs;
+}
+
+/*
+ * Write the memory used by a digraph (see digraph_memory_usage()) to
+ * stdout
+ */
+void print_memory_summary(const digraph_t *g)
+{
+  digraph_memory_t mem;
+  const double MB = 1024.0 * 1024.0;
+
+  digraph_memory_usage(g, &mem);
+  printf("Digraph memory %.1f MB: adjacency %.1f MB, hub sets %.1f MB, "
+         "arc bit matrix %.1f MB, dyad cache %.1f MB, arc lists %.1f MB, "
+         "attributes %.1f MB "
+         "(shared %.1f MB not included), nodes %.1f MB, "
+         "two-path tables %.1f MB (mix %.1f MB, in %.1f MB, out %.1f MB, "
+         "free %.1f MB, hubs %.1f MB)\n",
+         mem.total / MB, mem.adjacency / MB, mem.hub_sets / MB,
+         mem.arc_bitmatrix / MB, mem.dyad_cache / MB, mem.arc_lists / MB, mem.attributes / MB,
+         mem.shared_attributes / MB, mem.nodes / MB,
+         (mem.twopath_mix + mem.twopath_in + mem.twopath_out +
+          mem.twopath_free + mem.twopath_hubs) / MB, mem.twopath_mix / MB,
+         mem.twopath_in / MB, mem.twopath_out / MB, mem.twopath_free / MB,
+         mem.twopath_hubs / MB);
 }
 
 
@@ -1252,13 +8113,12 @@ void free_digraph(digraph_t *g)
  * line. In this program the nodes must be numbered 1..N.
  *
  * Parameters:
- *    pajek_file   - Pajek format arclist file handle (open read).
- *                   Closed by this function at end.
+ *    pajek_file   - Pajek format arclist file handle (opened with
+ *                   open_input_file()). Closed by this function at end.
  *
  * Return value:
- *    number of vertices as read from Pajek file.
- *
- * Note this function calls exit() on error.
+ *    number of vertices as read from Pajek file, or 0 on error
+ *    (message printed to stderr).
  */
 uint_t get_num_vertices_from_arclist_file(FILE *pajek_file)
 {
@@ -1270,22 +8130,150 @@ uint_t get_num_vertices_from_arclist_file(FILE *pajek_file)
    * *vertices 36
    * for Pajek format
    */
-  fgets(buf, sizeof(buf)-1, pajek_file);
+  if (!fgets(buf, sizeof(buf)-1, pajek_file))
+    buf[0] = '\0';
   for (p = buf; *p !='\0'; p++) {
     *p = tolower(*p);
   }
   if (sscanf(buf, "*vertices %d\n", &num_vertices) != 1) {
     fprintf(stderr, "ERROR: expected *vertices n line but didn't find it\n");
-    exit(1);
-  }
-  if (num_vertices < 1) {
+    num_vertices = 0;
+  } else if (num_vertices < 1) {
     fprintf(stderr, "ERROR: number of vertices is %d\n", num_vertices);
-    exit(1);
+    num_vertices = 0;
   }
-  fclose(pajek_file);
+  close_input_file(pajek_file);
   return (uint_t)num_vertices;
 }
 
+/*
+ * Add a node id to a node id map, if it is not already in it.
+ *
+ * Parameters:
+ *    map - (in/out) node id map (initially all zero), not yet numbered
+ *          by number_node_ids()
+ *    id  - node id (not UINT64_MAX)
+ *
+ * Return value:
+ *    None.
+ */
+void nodeidmap_add(nodeidmap_t *map, uint64_t id)
+{
+  size_t pos;
+
+  assert(id != NODEIDMAP_EMPTY_KEY && !map->ids);
+  /* keep load factor at most 0.5 (capacity is 0 before first insert) */
+  if (2 * ((size_t)map->num_nodes + 1) > map->capacity)
+    nodeidmap_resize(map, map->capacity ? 2 * map->capacity :
+                     NODEIDMAP_INITIAL_CAPACITY);
+  pos = nodeidmap_slot(map, id);
+  if (map->keys[pos] == NODEIDMAP_EMPTY_KEY) {
+    map->keys[pos] = id;
+    map->values[pos] = map->num_nodes++;
+  }
+}
+
+/*
+ * Get the node number of a node id.
+ *
+ * Parameters:
+ *    map - node id map, numbered by number_node_ids()
+ *    id  - node id
+ *
+ * Return value:
+ *    node number of id, or NODEIDMAP_NONE if it is not in map
+ */
+uint_t nodeidmap_get(const nodeidmap_t *map, uint64_t id)
+{
+  size_t pos;
+
+  if (map->capacity == 0 || id == NODEIDMAP_EMPTY_KEY)
+    return NODEIDMAP_NONE;
+  pos = nodeidmap_slot(map, id);
+  return map->keys[pos] == id ? map->values[pos] : NODEIDMAP_NONE;
+}
+
+/*
+ * Number the nodes in a node id map 0..N-1 in ascending order of id
+ * (so ids that are already 0..N-1 keep their numbers) once all the ids
+ * have been added, and build the list of ids of the nodes.
+ *
+ * Parameters:
+ *    map - (in/out) node id map
+ *
+ * Return value:
+ *    None.
+ */
+void number_node_ids(nodeidmap_t *map)
+{
+  size_t k, n = 0;
+
+  map->ids = (uint64_t *)safe_malloc(MAX(map->num_nodes, 1) *
+                                     sizeof(uint64_t));
+  for (k = 0; k < map->capacity; k++)
+    if (map->keys[k] != NODEIDMAP_EMPTY_KEY)
+      map->ids[n++] = map->keys[k];
+  assert(n == map->num_nodes);
+  qsort(map->ids, n, sizeof(uint64_t), compare_node_id);
+  for (k = 0; k < n; k++)
+    map->values[nodeidmap_slot(map, map->ids[k])] = (uint_t)k;
+}
+
+/*
+ * Free the contents of a node id map (not the map itself).
+ *
+ * Parameters:
+ *    map - node id map
+ *
+ * Return value:
+ *    None.
+ */
+void free_nodeidmap(nodeidmap_t *map)
+{
+  free(map->keys);
+  free(map->values);
+  free(map->ids);
+  memset(map, 0, sizeof(nodeidmap_t));
+}
+
+/*
+ * Write the original id of each node of a digraph loaded from an edge
+ * list file to a file, with a header line then one line for each node
+ * with its number as in the Pajek arc list files written (from 1) and
+ * its id.
+ *
+ * Parameters:
+ *    g        - digraph with node_ids
+ *    filename - name of file to write (overwritten)
+ *
+ * Return value:
+ *    0 if OK else -1 on error (message printed to stderr).
+ */
+int write_node_ids(const digraph_t *g, const char *filename)
+{
+  FILE  *fp;
+  uint_t i;
+  int    err;
+
+  assert(g->node_ids && g->node_ids->ids);
+  if (!(fp = fopen(filename, "w"))) {
+    fprintf(stderr, "ERROR: could not open node id file %s for writing "
+            "(%s)\n", filename, strerror(errno));
+    return -1;
+  }
+  fprintf(fp, "node id\n");
+  for (i = 0; i < g->num_nodes; i++)
+    fprintf(fp, "%u %lu\n", i + 1, (unsigned long)g->node_ids->ids[i]);
+  err = ferror(fp);
+  err |= fclose(fp) != 0;
+  if (err) {
+    fprintf(stderr, "ERROR: writing node id file %s failed (%s)\n",
+            filename, strerror(errno));
+    return -1;
+  }
+  return 0;
+}
+
 
 
 /*
@@ -1311,14 +8299,17 @@ void print_data_summary(const digraph_t * g)
   uint_t i,j;
   uint_t num_na_values;
   
-  printf("Digraph with %u vertices and %u arcs (density %g)\n",
-         g->num_nodes, g->num_arcs, density(g));
+  printf("Digraph with %u vertices and %lu arcs (density %g)\n",
+         g->num_nodes, (unsigned long)g->num_arcs, density(g));
+  if (g->num_blocks > 0)
+    printf("%u networks pooled (arcs only within each network)\n",
+           g->num_blocks);
   printf("%u binary attributes\n", g->num_binattr);
   for (i = 0; i < g->num_binattr; i++) {
     printf("  %s", g->binattr_names[i]);
     num_na_values = 0;
     for (j = 0; j < g->num_nodes; j++) {
-      if (g->binattr[i][j] == BIN_NA) {
+      if (BINATTR_IS_NA(g, i, j)) {
         num_na_values++;
       }
     }
@@ -1329,7 +8320,7 @@ void print_data_summary(const digraph_t * g)
     printf("  %s", g->catattr_names[i]);
     num_na_values = 0;
     for (j = 0; j < g->num_nodes; j++) {
-      if (g->catattr[i][j] == CAT_NA) {
+      if (CATATTR_CODE(g, i, j) == CATATTR_CODE_NA) {
         num_na_values++;
       }
     }
@@ -1379,7 +8370,8 @@ void print_zone_summary(const digraph_t *g)
   }
   printf("Number of zones: %u (%u waves)\n", num_zones, num_zones-1);
   printf("Number of nodes in inner waves: %u\n", g->num_inner_nodes);
-  printf("Number of arcs in inner waves: %u\n", g->num_inner_arcs);
+  printf("Number of arcs in inner waves: %lu\n",
+         (unsigned long)g->num_inner_arcs);
   printf("Number of nodes in each zone:\n");
   for (i = 0; i < num_zones; i++) {
     printf(" %u: %u\n", i, zone_sizes[i]);
@@ -1389,7 +8381,8 @@ void print_zone_summary(const digraph_t *g)
 
 /*
  * Write arc list in Pajek format to file. The node numbers are
- * 1..n in this format (not 0..n-1).
+ * 1..n in this format (not 0..n-1). If the nodes have been renumbered
+ * by reorder_digraph_nodes() the original (input file) numbers are used.
  *
  * Parameters:
  *     fp - open (write) file pointer to write to
@@ -1401,7 +8394,8 @@ void print_zone_summary(const digraph_t *g)
  */
 void write_digraph_arclist_to_file(FILE *fp, const digraph_t *g)
 {
-  uint_t i, j, count=0;
+  uint_t   i, j;
+  arcidx_t count = 0;
 
   fprintf(fp, "*vertices %u\n", g->num_nodes);
   for (i = 0; i < g->num_nodes; i++)
@@ -1410,13 +8404,69 @@ void write_digraph_arclist_to_file(FILE *fp, const digraph_t *g)
   for (i = 0; i < g->num_nodes; i++)  {
     for (j = 0; j < g->outdegree[i]; j++) {
       count++;
-      fprintf(fp, "%u %u\n", i+1, g->arclist[i][j]+1); /* output is 1 based */
+      /* output is 1 based, and in input file numbering if reordered */
+      if (g->orig_node)
+        fprintf(fp, "%u %u\n", g->orig_node[i]+1,
+                g->orig_node[g->arclist[i][j]]+1);
+      else
+        fprintf(fp, "%u %u\n", i+1, g->arclist[i][j]+1);
       /*removed as slows significantly: assert(isArc(g, i, g->arclist[i][j]));*/
     }
   }
   assert(count == g->num_arcs);
 }
 
+/*
+ * Build the per-node coordinates used by the GeoDistance (and
+ * LogGeoDistance) and EuclideanDistance change statistics from the
+ * continuous attributes marked by latitude_index, longitude_index,
+ * x_index, y_index and z_index, so that those change statistics do
+ * not need any trigonometric functions or missing value tests on the
+ * individual attributes.
+ *
+ * Parameters:
+ *    g         - (in/out) digraph with continuous attributes loaded and
+ *                the relevant attribute indices set
+ *    geo       - if TRUE build geo_coords
+ *    euclidean - if TRUE build euclidean_coords
+ *
+ * Return value:
+ *    None
+ */
+void build_dyadic_coords(digraph_t *g, bool geo, bool euclidean)
+{
+  uint_t   i;
+  double   lat, lon;
+  point3_t p;
+
+  if (geo) {
+    free(g->geo_coords);
+    g->geo_coords = (point3_t *)safe_malloc(g->num_nodes * sizeof(point3_t));
+    for (i = 0; i < g->num_nodes; i++) {
+      lat = g->contattr[g->latitude_index][i];
+      lon = g->contattr[g->longitude_index][i];
+      if (isnan(lat) || isnan(lon))
+        p.x = p.y = p.z = NAN;
+      else
+        geo_unit_vector(lat, lon, &p.x, &p.y, &p.z);
+      g->geo_coords[i] = p;
+    }
+  }
+  if (euclidean) {
+    free(g->euclidean_coords);
+    g->euclidean_coords = (point3_t *)safe_malloc(g->num_nodes *
+                                                  sizeof(point3_t));
+    for (i = 0; i < g->num_nodes; i++) {
+      p.x = g->contattr[g->x_index][i];
+      p.y = g->contattr[g->y_index][i];
+      p.z = g->contattr[g->z_index][i];
+      if (isnan(p.x) || isnan(p.y) || isnan(p.z))
+        p.x = p.y = p.z = NAN;
+      g->euclidean_coords[i] = p;
+    }
+  }
+}
+
 
 /*
  * Read snowball sampling zone file and put zone information in digraph g
@@ -1428,8 +8478,9 @@ void write_digraph_arclist_to_file(FILE *fp, const digraph_t *g)
  * Return value:
  *    0 if OK else nonzero for error.
  * 
- * The zone, max_zone, num_inner_nodes, inner_nodes, prev_wave_degree,
- * num_inner_arcs and allinnerarcs fields of g are set here.
+ * The zone, max_zone, num_inner_nodes, inner_nodes, inner_zone_start,
+ * zone_pair_cumcount, prev_wave_degree, num_inner_arcs and allinnerarcs
+ * fields of g are set here.
  *
  * The format of the file is the same as that for categorical
  * attributes (and the same function is used to parse it): a header
@@ -1437,122 +8488,47 @@ void write_digraph_arclist_to_file(FILE *fp, const digraph_t *g)
  * the the snowball sampling zone for each node.  The first line (after the
  * header) has the value for node 0, then the next line node 1, and
  * so on. The zones are numbered from 0 for the seed nodes.
+ * If g was loaded from an edge list file, each line starts with the
+ * original id of its node instead, as for load_attributes().
  * 
  * E.g.:
- *
- * zone
- * 0
- * 1
- * 1
- * 2
- */
-int add_snowball_zones_to_digraph(digraph_t *g, const char *zone_filename)
-{
-  int      num_attr, j;
-  char   **attr_names;
-  int    **zones;
-  uint_t   i, u, v;
-  uint_t  *zone_sizes; /* number of nodes in each zone */
-  uint_t   num_zones;
-
-  
-  if ((num_attr = load_integer_attributes(zone_filename, g->num_nodes,
-                                          FALSE, &attr_names,
-                                          &zones)) < 0){
-    fprintf(stderr, "ERROR: loading zones from file %s failed\n", 
-            zone_filename);
-    return -1;
-  }
-  if (num_attr != 1) {
-    fprintf(stderr, "ERROR: expecting only zone attribute in zone file %s "
-            "but found %d attributes\n", zone_filename, num_attr);
-    return -1;
-  }
-  if (strcasecmp(attr_names[0], "zone") != 0) {
-    fprintf(stderr, "ERROR: expecting only zone attribute in zone file %s "
-            " but found %s\n", zone_filename, attr_names[0]);
-    return -1;
-  }
-  for (i = 0; i < g->num_nodes; i++) {
-    g->zone[i] = zones[0][i];
-    if (g->zone[i] > g->max_zone) {
-      g->max_zone = g->zone[i];
-    }
-  }
-
-  num_zones = g->max_zone + 1;
-
-  /* check that the zones are not invalid, no skipped zones */
-  zone_sizes = (uint_t *)safe_calloc(num_zones, sizeof(uint_t));
-  for (i = 0; i < g->num_nodes; i++) {
-    assert(g->zone[i] < num_zones);
-    zone_sizes[g->zone[i]]++;
-  }
-  for (i = 0; i < num_zones; i++) {
-    if (zone_sizes[i] == 0) {
-      fprintf(stderr,
-              "ERROR: Max zone is %u but there are no nodes in zone %u\n",
-              g->max_zone, i);
-      return -1;
-    }
-  }
-
-  /*
-   * For conditional estimation, the zone of each node is fixed, as
-   * well as all the ties between nodes in the outermost wave (last
-   * zone) and ties from nodes in the last zone to nodes in the
-   * second-last zone. So in MCMC procedure we to need find nodes only
-   * in the inner waves (i.e. all those apart from the outermost). So
-   * to all this done to be done efficiently we build the inner_nodes
-   * array which is an array of size num_inner_nodes (the number of
-   * nodes in zones other than the last) of each node id in an inner
-   * zone.
-   */
-  for (i = 0; i < g->max_zone; i++) {
-    g->num_inner_nodes += zone_sizes[i];
-  }
-  g->inner_nodes = (uint_t *)safe_calloc(g->num_inner_nodes, sizeof(uint_t));
-  for (u = 0, i = 0; u < g->num_nodes; u++) {
-    if (g->zone[u] < g->max_zone) {
-      assert(i < g->num_inner_nodes);
-      g->inner_nodes[i++] = u;
-    }
-  }
-  
-  /*
-   * build prev_wave_degree[] which for each node gives the number of
-   * edges to or from (i.e. ignoring direction of arc) that node
-   * to/from nodes in the immediately preceding zone. (This value will always
-   * be zero for all seed nodes i.e. nodes in zone 0).
-   * Also build allinnerarcs flat arcs list of arcs between nodes in inner waves
-   * used for conditional estimation fast lookup of such an arc to delete
-   */
-  for (i = 0; i < g->num_arcs; i++) {
-    u = g->allarcs[i].i;
-    v = g->allarcs[i].j;
-    if (g->zone[u] != g->zone[v] &&
-        g->zone[u] != g->zone[v] + 1 && g->zone[v] != g->zone[u] + 1){
-      fprintf(stderr, "ERROR: invalid snowball zones for adjacent nodes %u "
-              "(zone %u) and %u (zone %u)\n", u, g->zone[u], v, g->zone[v]);
-      return -1;
-    }
-    if (g->zone[u] > g->zone[v]) {
-      assert(g->zone[u] == g->zone[v] + 1);
-      g->prev_wave_degree[u]++;
-    } else if (g->zone[v] > g->zone[u]) {
-      assert(g->zone[v] == g->zone[u] + 1);
-      g->prev_wave_degree[v]++;
-    }
-    if (g->zone[u] < g->max_zone && g->zone[v] < g->max_zone) {
-      g->num_inner_arcs++;
-      DIGRAPH_DEBUG_PRINT(("inner arc %u: %u -> %u (zones %u %u)\n", g->num_inner_arcs-1, u, v, g->zone[i], g->zone[v]));
-      g->allinnerarcs = (nodepair_t *)safe_realloc(g->allinnerarcs,
-                                                   g->num_inner_arcs *
-                                                   sizeof(nodepair_t));
-      g->allinnerarcs[g->num_inner_arcs-1].i = u;
-      g->allinnerarcs[g->num_inner_arcs-1].j = v;
-    }
+ *
+ * zone
+ * 0
+ * 1
+ * 1
+ * 2
+ */
+int add_snowball_zones_to_digraph(digraph_t *g, const char *zone_filename)
+{
+  int      num_attr, j;
+  char   **attr_names;
+  int    **zones;
+  uint_t   i;
+  int      rc;
+
+  
+  if ((num_attr = load_column_attributes(zone_filename, g->num_nodes,
+                                         g->node_ids, ATTR_KIND_CATEGORICAL,
+                                         g->build_threads, 0, NULL,
+                                         &attr_names, &zones, NULL)) < 0){
+    fprintf(stderr, "ERROR: loading zones from file %s failed\n", 
+            zone_filename);
+    return -1;
+  }
+  if (num_attr != 1) {
+    fprintf(stderr, "ERROR: expecting only zone attribute in zone file %s "
+            "but found %d attributes\n", zone_filename, num_attr);
+    return -1;
+  }
+  if (strcasecmp(attr_names[0], "zone") != 0) {
+    fprintf(stderr, "ERROR: expecting only zone attribute in zone file %s "
+            " but found %s\n", zone_filename, attr_names[0]);
+    return -1;
   }
+  for (i = 0; i < g->num_nodes; i++)
+    g->zone[i] = zones[0][i];
+  rc = build_zone_index(g);
   
   for (j = 0; j < num_attr; j++) {
     free(attr_names[j]);
@@ -1560,8 +8536,24 @@ int add_snowball_zones_to_digraph(digraph_t *g, const char *zone_filename)
   }
   free(attr_names);
   free(zones);
-  free(zone_sizes);
-  return 0;
+  return rc;
+}
+
+/*
+ * Set the snowball sampling zone of each node of g (as
+ * add_snowball_zones_to_digraph() does from a zone file).
+ *
+ * Parameters:
+ *    g    - (in/out) digraph to put zone information in
+ *    zone - for each node, its snowball sampling zone (0 for seeds)
+ *
+ * Return value:
+ *    0 if OK else nonzero for error (message printed to stderr).
+ */
+int set_digraph_zones(digraph_t *g, const uint_t *zone)
+{
+  memcpy(g->zone, zone, g->num_nodes * sizeof(uint_t));
+  return build_zone_index(g);
 }
 
 
@@ -1604,6 +8596,198 @@ void dump_zone_info(const digraph_t *g)
 }
 
 
+/*
+ * Choose uniformly at random an ordered pair of distinct nodes in the
+ * inner waves that are in the same or adjacent zones (the only pairs
+ * that can be tied in a snowball sample). A pair of zones (or single
+ * zone) is chosen with probability proportional to its number of
+ * ordered node pairs using zone_pair_cumcount[], then a pair within it.
+ * This gives the same distribution as drawing pairs from inner_nodes
+ * and rejecting those whose zones differ by more than one, without the
+ * rejections.
+ *
+ * Parameters:
+ *   g    - digraph with snowball zone information
+ *   prng - pseudorandom number generator stream (updated)
+ *   i    - (Out) first node
+ *   j    - (Out) second node, not equal to i
+ *
+ * Return value:
+ *   None.
+ */
+void sample_zone_pair(const digraph_t *g, prng_t *prng, uint_t *i, uint_t *j)
+{
+  uint_t   nblocks = 2*g->max_zone - 1;
+  uint_t   lo = 0, hi = nblocks - 1, mid, z, a, b, size_a, size_b;
+  uint64_t r, offset;
+
+  assert(g->max_zone > 0 && g->zone_pair_cumcount[nblocks-1] > 0);
+  r = prng_int_urand64(prng, g->zone_pair_cumcount[nblocks-1]);
+  while (lo < hi) { /* first block with cumulative count greater than r */
+    mid = (lo + hi) / 2;
+    if (g->zone_pair_cumcount[mid] > r)
+      hi = mid;
+    else
+      lo = mid + 1;
+  }
+  offset = r - (lo > 0 ? g->zone_pair_cumcount[lo-1] : 0);
+  z = lo / 2;
+  size_a = g->inner_zone_start[z+1] - g->inner_zone_start[z];
+  if (lo % 2 == 0) {
+    /* both in zone z: offset is a*(size_a-1) + b, b skipping over a */
+    a = (uint_t)(offset / (size_a - 1));
+    b = (uint_t)(offset % (size_a - 1));
+    b += (b >= a);
+    *i = g->inner_nodes[g->inner_zone_start[z] + a];
+    *j = g->inner_nodes[g->inner_zone_start[z] + b];
+  } else {
+    /* one in zone z and the other in zone z+1, in either order */
+    size_b = g->inner_zone_start[z+2] - g->inner_zone_start[z+1];
+    if (offset < (uint64_t)size_a * size_b) {
+      *i = g->inner_nodes[g->inner_zone_start[z] + offset / size_b];
+      *j = g->inner_nodes[g->inner_zone_start[z+1] + offset % size_b];
+    } else {
+      offset -= (uint64_t)size_a * size_b;
+      *j = g->inner_nodes[g->inner_zone_start[z] + offset / size_b];
+      *i = g->inner_nodes[g->inner_zone_start[z+1] + offset % size_b];
+    }
+  }
+}
+
+
+/*
+ * Divide the nodes of g into blocks (networks) for pooled estimation
+ * of one model on several networks, which are numbered consecutively:
+ * the first block_sizes[0] nodes are network 0, the next block_sizes[1]
+ * network 1, and so on. The samplers then only choose pairs of nodes
+ * in the same network (sample_block_pair()), so all the arcs are within
+ * the networks and the statistics (and change statistics) of g are the
+ * sums of those of the networks.
+ *
+ * Parameters:
+ *    g           - (in/out) digraph to put block information in
+ *    num_blocks  - number of networks
+ *    block_sizes - number of nodes in each network, summing to the
+ *                  number of nodes in g
+ *
+ * Return value:
+ *    0 if OK else nonzero for error (message printed to stderr).
+ */
+int set_digraph_blocks(digraph_t *g, uint_t num_blocks,
+                       const uint_t *block_sizes)
+{
+  uint_t   b, k, v = 0;
+  uint64_t size, pairs = 0;
+
+  free(g->block);
+  free(g->block_nodes);
+  free(g->block_start);
+  free(g->block_pair_cumcount);
+  g->num_blocks = num_blocks;
+  g->block = (uint_t *)safe_malloc(g->num_nodes * sizeof(uint_t));
+  g->block_nodes = (uint_t *)safe_malloc(g->num_nodes * sizeof(uint_t));
+  g->block_start = (uint_t *)safe_malloc((num_blocks + 1) * sizeof(uint_t));
+  g->block_pair_cumcount = (uint64_t *)safe_malloc(num_blocks *
+                                                   sizeof(uint64_t));
+  for (b = 0; b < num_blocks; b++) {
+    if (block_sizes[b] > g->num_nodes - v) {
+      fprintf(stderr, "ERROR: networks have more than the %u nodes of "
+              "the digraph\n", g->num_nodes);
+      return -1;
+    }
+    g->block_start[b] = v;
+    for (k = 0; k < block_sizes[b]; k++) {
+      g->block[v] = b;
+      g->block_nodes[v] = v;
+      v++;
+    }
+    size = block_sizes[b];
+    pairs += size * (size > 0 ? size - 1 : 0);
+    g->block_pair_cumcount[b] = pairs;
+  }
+  g->block_start[num_blocks] = v;
+  if (v != g->num_nodes) {
+    fprintf(stderr, "ERROR: networks have %u nodes but digraph has %u\n",
+            v, g->num_nodes);
+    return -1;
+  }
+  if (pairs == 0) {
+    fprintf(stderr, "ERROR: no network has more than one node\n");
+    return -1;
+  }
+  return 0;
+}
+
+/*
+ * Choose uniformly at random an ordered pair of distinct nodes in the
+ * same network of a pooled digraph (see set_digraph_blocks()). A
+ * network is chosen with probability proportional to its number of
+ * ordered node pairs using block_pair_cumcount[], then a pair within
+ * it, as sample_zone_pair() does for a single zone.
+ *
+ * Parameters:
+ *   g    - digraph with block information
+ *   prng - pseudorandom number generator stream (updated)
+ *   i    - (Out) first node
+ *   j    - (Out) second node, not equal to i
+ *
+ * Return value:
+ *   None.
+ */
+void sample_block_pair(const digraph_t *g, prng_t *prng, uint_t *i, uint_t *j)
+{
+  uint_t   lo = 0, hi = g->num_blocks - 1, mid, a, b, size;
+  uint64_t r, offset;
+
+  assert(g->num_blocks > 0 && g->block_pair_cumcount[hi] > 0);
+  r = prng_int_urand64(prng, g->block_pair_cumcount[hi]);
+  while (lo < hi) { /* first block with cumulative count greater than r */
+    mid = (lo + hi) / 2;
+    if (g->block_pair_cumcount[mid] > r)
+      hi = mid;
+    else
+      lo = mid + 1;
+  }
+  offset = r - (lo > 0 ? g->block_pair_cumcount[lo-1] : 0);
+  size = g->block_start[lo+1] - g->block_start[lo];
+  /* offset is a*(size-1) + b, b skipping over a */
+  a = (uint_t)(offset / (size - 1));
+  b = (uint_t)(offset % (size - 1));
+  b += (b >= a);
+  *i = g->block_nodes[g->block_start[lo] + a];
+  *j = g->block_nodes[g->block_start[lo] + b];
+}
+
+
+/*
+ * Choose uniformly at random an ordered pair of distinct nodes i, j
+ * with no arc i->j (and, if forbidReciprocity, no arc j->i either),
+ * i.e. a dyad where an arc can be added. Pairs are drawn until one is
+ * empty, which takes expected O(1) draws in a sparse graph, with each
+ * one tested in O(1) time by isArc() (using the arc bit matrix or hub
+ * neighbour sets if present). This is the same distribution as the
+ * nested loop of redrawing the pair while arc i->j exists and then
+ * again while j->i exists, but with a single loop.
+ *
+ * Parameters:
+ *   g                 - digraph (must have at least one empty dyad)
+ *   prng              - pseudorandom number generator stream (updated)
+ *   forbidReciprocity - if True the dyad must also have no arc j->i
+ *   i                 - (Out) first node
+ *   j                 - (Out) second node, not equal to i
+ *
+ * Return value:
+ *   None.
+ */
+void sample_empty_dyad(const digraph_t *g, prng_t *prng,
+                       bool forbidReciprocity, uint_t *i, uint_t *j)
+{
+  do {
+    prng_int_urand_pair(prng, g->num_nodes, i, j);
+  } while (isArc(g, *i, *j) || (forbidReciprocity && isArc(g, *j, *i)));
+}
+
+
 /*
  * Parse comma-delimited list of int into set.
  *
@@ -1695,6 +8879,31 @@ int parse_category_set(char *str, bool firstpass, uint_t *size,
   return 0;
 }
 
+/*
+ * Pack a set (of categorical) value into a fixed size bit set.
+ *
+ * Parameters:
+ *    setval - set value as array of set_elem_e
+ *    size   - number of elements in setval
+ *
+ * Return value:
+ *    Newly allocated array of SETATTR_WORDS(size) words with bit k set
+ *    iff setval[k] is SET_ELEM_PRESENT (so NA is all bits clear).
+ *
+ * This function has external linkage only so it can be used in unit tests.
+ */
+uint64_t *set_to_bitset(const set_elem_e *setval, uint_t size)
+{
+  uint64_t *bits = (uint64_t *)safe_calloc(SETATTR_WORDS(size),
+                                           sizeof(uint64_t));
+  uint_t    k;
+
+  for (k = 0; k < size; k++)
+    if (setval[k] == SET_ELEM_PRESENT)
+      bits[k >> 6] |= (uint64_t)1 << (k & 63);
+  return bits;
+}
+
 
 /*
  * Load the nodal attributes from files.
@@ -1703,6 +8912,15 @@ int parse_category_set(char *str, bool firstpass, uint_t *size,
  * attribute names, followed by (whitespace delimited) attributes 
  * one line per node (corresponding to node number order).
  * If the attribute file handles are NULL then no attributes.
+ * If g was loaded from an edge list file (g->node_ids is set), each
+ * line starts with the original id of its node instead, in any order.
+ * The binary, categorical and continuous attribute files are parsed
+ * by g->build_threads threads (see set_twopath_build_threads()), and
+ * stored compactly: binary as bit sets, categorical as 1, 2 or 4 byte
+ * codes, and continuous as contattr_t (see digraph_t).
+ * If columns to keep have been set (see set_attribute_columns()), only
+ * those columns of the binary, categorical, continuous and set
+ * attribute files are parsed and stored.
  *
  * Parameters:
  *    g                - (in/out) digraph object
@@ -1712,6 +8930,8 @@ int parse_category_set(char *str, bool firstpass, uint_t *size,
  *    catattr_filename - categorical attribute filename or NULL
  *    contattr_filename- continuous attribute filename or NULL
  *    setattr_filename - set attribute filename or NULL
+ *    dyadcov_filename - dyadic covariates filename or NULL
+ *                       (see load_dyadic_covariates())
  *
  * Return value:
  *    nonzero on error
@@ -1721,48 +8941,103 @@ int load_attributes(digraph_t *g,
                     const char *binattr_filename,
                     const char *catattr_filename,
                     const char *contattr_filename,
-                    const char *setattr_filename)
+                    const char *setattr_filename,
+                    const char *dyadcov_filename)
 {
-  int  num_attr;
-  int  i;
-  bool setFailed = FALSE;
+  int      num_attr;
+  int      i;
+  bool     setFailed = FALSE;
+  int    **ivalues;  /* binary or categorical values as loaded */
+  double **dvalues;  /* continuous values as loaded */
+#ifdef CONTATTR_FLOAT
+  uint_t   v;
+#endif /* CONTATTR_FLOAT */
     
   if (binattr_filename) {
-    if ((num_attr = load_integer_attributes(binattr_filename, g->num_nodes,
-                                            TRUE, &g->binattr_names,
-                                            &g->binattr)) < 0){
+    if ((num_attr = load_column_attributes(binattr_filename, g->num_nodes,
+                                           g->node_ids, ATTR_KIND_BINARY,
+                                           g->build_threads,
+                                           g->num_attr_columns,
+                                           g->attr_columns,
+                                           &g->binattr_names,
+                                           &ivalues, NULL)) < 0){
       fprintf(stderr, "ERROR: loading binary attributes from file %s failed\n", 
               binattr_filename);
       return 1;
     }
     g->num_binattr = (uint_t)num_attr;
+    if (num_attr > 0) {
+      g->binattr = (uint64_t **)safe_malloc(num_attr * sizeof(uint64_t *));
+      g->binattr_na = (uint64_t **)safe_malloc(num_attr * sizeof(uint64_t *));
+    }
+    for (i = 0; i < num_attr; i++) {
+      pack_binattr(g, (uint_t)i, ivalues[i]);
+      free(ivalues[i]);
+    }
+    free(ivalues);
   }
 
   if (catattr_filename) {
-    if ((num_attr = load_integer_attributes(catattr_filename, g->num_nodes,
-                                            FALSE, &g->catattr_names,
-                                            &g->catattr)) < 0){
+    if ((num_attr = load_column_attributes(catattr_filename, g->num_nodes,
+                                           g->node_ids, ATTR_KIND_CATEGORICAL,
+                                           g->build_threads,
+                                           g->num_attr_columns,
+                                           g->attr_columns,
+                                           &g->catattr_names,
+                                           &ivalues, NULL)) < 0){
       fprintf(stderr, "ERROR: loading categorical attributes from file %s failed\n", 
               catattr_filename);
       return 1;
     }
     g->num_catattr = (uint_t)num_attr;
+    if (num_attr > 0) {
+      g->catattr = (void **)safe_malloc(num_attr * sizeof(void *));
+      g->catattr_width = (uint8_t *)safe_malloc(num_attr * sizeof(uint8_t));
+    }
+    for (i = 0; i < num_attr; i++) {
+      pack_catattr(g, (uint_t)i, ivalues[i]);
+      free(ivalues[i]);
+    }
+    free(ivalues);
   }
   if (contattr_filename) {
-    if ((num_attr = load_float_attributes(contattr_filename, g->num_nodes,
-                                          &g->contattr_names,
-                                          &g->contattr)) < 0){
+    if ((num_attr = load_column_attributes(contattr_filename, g->num_nodes,
+                                           g->node_ids, ATTR_KIND_CONTINUOUS,
+                                           g->build_threads,
+                                           g->num_attr_columns,
+                                           g->attr_columns,
+                                           &g->contattr_names,
+                                           NULL, &dvalues)) < 0){
       fprintf(stderr, "ERROR: loading continuous attributes from file %s failed\n", 
               contattr_filename);
       return 1;
     }
     g->num_contattr = (uint_t)num_attr;
+#ifdef CONTATTR_FLOAT
+    if (num_attr > 0)
+      g->contattr = (contattr_t **)safe_malloc(num_attr *
+                                               sizeof(contattr_t *));
+    for (i = 0; i < num_attr; i++) {
+      g->contattr[i] = (contattr_t *)safe_malloc(g->num_nodes *
+                                                 sizeof(contattr_t));
+      for (v = 0; v < g->num_nodes; v++)
+        g->contattr[i][v] = (contattr_t)dvalues[i][v];
+      free(dvalues[i]);
+    }
+    free(dvalues);
+#else
+    g->contattr = dvalues;
+#endif /* CONTATTR_FLOAT */
   }  
   if (setattr_filename) {
     if ((num_attr = load_set_attributes(setattr_filename, g->num_nodes,
+                                        g->node_ids, g->num_attr_columns,
+                                        g->attr_columns,
                                         &g->setattr_names,
                                         &g->setattr,
-                                        &g->setattr_lengths)) < 0){
+                                        &g->setattr_lengths,
+                                        &g->setattr_bits,
+                                        &g->setattr_na)) < 0){
       fprintf(stderr, "ERROR: loading set attributes from file %s failed\n", 
               setattr_filename);
       return 1;
@@ -1782,7 +9057,439 @@ int load_attributes(digraph_t *g,
       }
     }
   }
+  build_attr_terms(g);
+  if (dyadcov_filename && load_dyadic_covariates(g, dyadcov_filename) != 0) {
+    fprintf(stderr, "ERROR: loading dyadic covariates from file %s failed\n",
+            dyadcov_filename);
+    return 1;
+  }
+  return 0;
+}
+
+/*
+ * Get the node in a line of a dyadic covariates file (see
+ * load_dyadic_covariates()).
+ *
+ * Parameters:
+ *    g        - digraph
+ *    token    - the node number (from 1) or, if g was loaded from an
+ *               edge list file, its original id, or NULL if none
+ *    filename - name of dyadic covariates file, for error messages
+ *    nodenum  - (out) node number, or number of nodes if the id is not
+ *               a node of the network (so the line is ignored)
+ *
+ * Return value:
+ *    0 if OK else -1 on error (message printed to stderr).
+ */
+static int dyadcov_line_node(const digraph_t *g, const char *token,
+                             const char *filename, uint_t *nodenum)
+{
+  unsigned long long num;
+  char              *endptr;
+
+  if (!token) {
+    fprintf(stderr, "ERROR: missing node in dyadic covariates file %s\n",
+            filename);
+    return -1;
+  }
+  errno = 0;
+  num = strtoull(token, &endptr, 10);
+  if (!isdigit((unsigned char)token[0]) || *endptr != '\0' || errno ||
+      (!g->node_ids && (num < 1 || num > g->num_nodes))) {
+    fprintf(stderr, "ERROR: bad node '%s' in dyadic covariates file %s\n",
+            token, filename);
+    return -1;
+  }
+  if (g->node_ids) {
+    *nodenum = nodeidmap_get(g->node_ids, (uint64_t)num);
+    if (*nodenum == NODEIDMAP_NONE)
+      *nodenum = g->num_nodes;
+  } else {
+    *nodenum = (uint_t)(num - 1);
+  }
+  return 0;
+}
+
+/*
+ * Load dyadic covariates, values for ordered pairs of nodes (such as
+ * prior collaboration between two people, or being at the same
+ * institution), from a file. Only the pairs in the file are stored, in
+ * compressed sparse row form (see digraph_t), so the file and the
+ * memory are proportional to the number of pairs with a nonzero value
+ * rather than the square of the number of nodes.
+ *
+ * The file has a header line with whitespace delimited names, the first
+ * two for the node columns and the rest those of the covariates, then a
+ * line for each pair (i, j): the number of node i and node j (from 1,
+ * as in a Pajek arc list) then the value of each covariate for the pair
+ * (NA for missing data). A covariate is 0 for every pair not in the
+ * file, and for NA. The pairs are ordered, so a symmetric covariate
+ * needs lines for both (i, j) and (j, i). The lines can be in any
+ * order but each pair can be on only one. If g was loaded from an edge
+ * list file (g->node_ids is set), the nodes are given by their original
+ * ids instead, and lines with an id not in the network are ignored.
+ *
+ * E.g.:
+ *
+ * from to collaborated same_institution
+ * 1    2  3            1
+ * 2    1  3            1
+ * 4    1  0            1
+ * 1    4  NA           1
+ *
+ * Parameters:
+ *    g                - (in/out) digraph object with no dyadic
+ *                       covariates, updated with those loaded
+ *    dyadcov_filename - dyadic covariates filename
+ *
+ * Return value:
+ *    nonzero on error (message printed to stderr)
+ */
+int load_dyadic_covariates(digraph_t *g, const char *dyadcov_filename)
+{
+  const char *delims   = " \t\r\n"; /* strtok_r() delimiters  */
+  char      **names    = NULL; /* names in header line */
+  uint_t      num_names= 0;    /* number of names in header line */
+  uint_t     *from     = NULL; /* node i of the pair on each line */
+  uint_t     *to       = NULL; /* node j of the pair on each line */
+  contattr_t *values   = NULL; /* the values on each line */
+  uint64_t    num_lines= 0;    /* number of pairs read */
+  uint64_t    capacity = 0;    /* lines from, to and values can hold */
+  uint64_t   *pos;             /* next position in each row */
+  dyadcov_entry_t *entries;
+  FILE       *fp;
+  char        buf[BUFSIZE];
+  char       *saveptr, *token, *endptr;
+  uint_t      num_cov, i, j, u;
+  uint64_t    k;
+  double      value;
+  int         rc = 0;
+
+  assert(g->num_dyadcov == 0);
+  if (!(fp = open_input_file(dyadcov_filename))) {
+    fprintf(stderr, "ERROR: could not open dyadic covariates file %s (%s)\n",
+            dyadcov_filename, strerror(errno));
+    return -1;
+  }
+  if (!fgets(buf, sizeof(buf)-1, fp)) {
+    fprintf(stderr, "ERROR: could not read header line in dyadic "
+            "covariates file %s\n", dyadcov_filename);
+    close_input_file(fp);
+    return -1;
+  }
+  for (token = strtok_r(buf, delims, &saveptr); token;
+       token = strtok_r(NULL, delims, &saveptr)) {
+    names = (char **)safe_realloc(names, (num_names + 1) * sizeof(char *));
+    names[num_names++] = safe_strdup(token);
+  }
+  if (num_names < 3) {
+    fprintf(stderr, "ERROR: header line of dyadic covariates file %s "
+            "must have two node column names and at least one covariate "
+            "name\n", dyadcov_filename);
+    rc = -1;
+  }
+  num_cov = num_names < 3 ? 0 : num_names - 2;
+
+  while (rc == 0 && fgets(buf, sizeof(buf)-1, fp)) {
+    saveptr = NULL; /* reset strtok() for next line */
+    if (!(token = strtok_r(buf, delims, &saveptr)))
+      continue; /* blank line */
+    if (dyadcov_line_node(g, token, dyadcov_filename, &i) != 0 ||
+        dyadcov_line_node(g, strtok_r(NULL, delims, &saveptr),
+                          dyadcov_filename, &j) != 0) {
+      rc = -1;
+      break;
+    }
+    if (num_lines == capacity) {
+      capacity = capacity ? 2 * capacity : 1024;
+      from = (uint_t *)safe_realloc(from, capacity * sizeof(uint_t));
+      to = (uint_t *)safe_realloc(to, capacity * sizeof(uint_t));
+      values = (contattr_t *)safe_realloc(values, capacity * num_cov *
+                                          sizeof(contattr_t));
+    }
+    for (u = 0; rc == 0 && u < num_cov; u++) {
+      if (!(token = strtok_r(NULL, delims, &saveptr))) {
+        fprintf(stderr, "ERROR: expected %u values on a line in dyadic "
+                "covariates file %s\n", num_cov, dyadcov_filename);
+        rc = -1;
+      } else if (strcasecmp(token, NA_STRING) == 0) {
+        values[num_lines * num_cov + u] = 0;
+      } else {
+        value = strtod(token, &endptr);
+        if (*endptr != '\0') {
+          fprintf(stderr, "ERROR: bad value '%s' for %s in dyadic "
+                  "covariates file %s\n", token, names[u + 2],
+                  dyadcov_filename);
+          rc = -1;
+        }
+        values[num_lines * num_cov + u] = (contattr_t)value;
+      }
+    }
+    if (rc == 0 && strtok_r(NULL, delims, &saveptr)) {
+      fprintf(stderr, "ERROR: more than %u values on a line in dyadic "
+              "covariates file %s\n", num_cov, dyadcov_filename);
+      rc = -1;
+    }
+    if (i < g->num_nodes && j < g->num_nodes) { /* else id not in network */
+      from[num_lines] = i;
+      to[num_lines++] = j;
+    }
+  }
+  close_input_file(fp);
+
+  if (rc == 0) {
+    g->num_dyadcov = num_cov;
+    g->dyadcov_names = (char **)safe_malloc(num_cov * sizeof(char *));
+    for (u = 0; u < num_cov; u++)
+      g->dyadcov_names[u] = names[u + 2];
+    /* group the pairs by node i, then sort each row by node j */
+    g->dyadcov_nnz = num_lines;
+    g->dyadcov_rowstart = (uint64_t *)safe_calloc(g->num_nodes + 1,
+                                                  sizeof(uint64_t));
+    for (k = 0; k < num_lines; k++)
+      g->dyadcov_rowstart[from[k] + 1]++;
+    for (i = 0; i < g->num_nodes; i++)
+      g->dyadcov_rowstart[i + 1] += g->dyadcov_rowstart[i];
+    pos = (uint64_t *)safe_malloc(g->num_nodes * sizeof(uint64_t));
+    memcpy(pos, g->dyadcov_rowstart, g->num_nodes * sizeof(uint64_t));
+    entries = (dyadcov_entry_t *)safe_malloc(num_lines *
+                                             sizeof(dyadcov_entry_t));
+    for (k = 0; k < num_lines; k++) {
+      entries[pos[from[k]]].j = to[k];
+      entries[pos[from[k]]++].k = k;
+    }
+    free(pos);
+    g->dyadcov_cols = (uint_t *)safe_malloc(num_lines * sizeof(uint_t));
+    g->dyadcov_values = (contattr_t **)safe_malloc(num_cov *
+                                                   sizeof(contattr_t *));
+    for (u = 0; u < num_cov; u++)
+      g->dyadcov_values[u] = (contattr_t *)safe_malloc(num_lines *
+                                                       sizeof(contattr_t));
+    set_dyadcov_rows(g, entries, values, num_cov, 1);
+    free(entries);
+    for (i = 0; rc == 0 && i < g->num_nodes; i++) {
+      for (k = g->dyadcov_rowstart[i] + 1; k < g->dyadcov_rowstart[i+1]; k++) {
+        if (g->dyadcov_cols[k] == g->dyadcov_cols[k-1]) {
+          fprintf(stderr, "ERROR: pair of nodes %u and %u is on more than "
+                  "one line in dyadic covariates file %s\n", i + 1,
+                  g->dyadcov_cols[k] + 1, dyadcov_filename);
+          rc = -1;
+          break;
+        }
+      }
+    }
+  }
+  /* the node column names, and the covariate names unless they are now
+     in g */
+  for (u = 0; u < num_names; u++)
+    if (u < 2 || g->num_dyadcov == 0)
+      free(names[u]);
+  free(names);
+  free(from);
+  free(to);
+  free(values);
+  return rc;
+}
+
+/*
+ * Get the value of a dyadic covariate for an ordered pair of nodes, by
+ * binary search of the (sorted) pairs stored for node i, so in time
+ * logarithmic in their number.
+ *
+ * Parameters:
+ *    g - digraph with dyadic covariates loaded
+ *    u - dyadic covariate index
+ *    i - node the pair is from
+ *    j - node the pair is to
+ *
+ * Return value:
+ *    Value of covariate u for the pair (i, j), 0 if it is not stored.
+ */
+double get_dyadic_covariate(const digraph_t *g, uint_t u, uint_t i, uint_t j)
+{
+  uint64_t lo = g->dyadcov_rowstart[i], end = g->dyadcov_rowstart[i+1];
+  uint64_t hi = end, mid;
+
+  while (lo < hi) {
+    mid = lo + (hi - lo) / 2;
+    if (g->dyadcov_cols[mid] < j)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  if (lo < end && g->dyadcov_cols[lo] == j)
+    return g->dyadcov_values[u][lo];
+  return 0;
+}
+
+/*
+ * Set the binary, categorical and continuous nodal attributes from
+ * columns in memory (e.g. arrays from another program through
+ * estimNetLib.h) rather than files. The values are stored compactly
+ * as by load_attributes(), so the columns are not needed afterwards.
+ * The digraph must not already have attributes.
+ *
+ * Parameters:
+ *    g             - (in/out) digraph object updated with attributes
+ *    num_binattr   - number of binary attributes
+ *    binattr_names - names of the binary attributes
+ *    binattr       - binattr[u][i] is 0, 1 or BIN_NA for node i
+ *    num_catattr   - number of categorical attributes
+ *    catattr_names - names of the categorical attributes
+ *    catattr       - catattr[u][i] is >= 0 or CAT_NA for node i
+ *    num_contattr  - number of continuous attributes
+ *    contattr_names- names of the continuous attributes
+ *    contattr      - contattr[u][i] is value (NaN for NA) for node i
+ *
+ * Return value:
+ *    nonzero on error (message printed to stderr)
+ */
+int set_column_attributes(digraph_t *g,
+                          uint_t num_binattr,
+                          const char *const binattr_names[],
+                          const int *const binattr[],
+                          uint_t num_catattr,
+                          const char *const catattr_names[],
+                          const int *const catattr[],
+                          uint_t num_contattr,
+                          const char *const contattr_names[],
+                          const double *const contattr[])
+{
+  uint_t u, i;
+
+  for (u = 0; u < num_binattr; u++) {
+    for (i = 0; i < g->num_nodes; i++) {
+      if (binattr[u][i] != 0 && binattr[u][i] != 1 &&
+          binattr[u][i] != BIN_NA) {
+        fprintf(stderr, "ERROR: binary attribute %s has value %d for "
+                "node %u\n", binattr_names[u], binattr[u][i], i);
+        return 1;
+      }
+    }
+  }
+  for (u = 0; u < num_catattr; u++) {
+    for (i = 0; i < g->num_nodes; i++) {
+      if (catattr[u][i] < 0 && catattr[u][i] != CAT_NA) {
+        fprintf(stderr, "ERROR: categorical attribute %s has value %d for "
+                "node %u\n", catattr_names[u], catattr[u][i], i);
+        return 1;
+      }
+    }
+  }
+
+  g->num_binattr = num_binattr;
+  if (num_binattr > 0) {
+    g->binattr_names = (char **)safe_malloc(num_binattr * sizeof(char *));
+    g->binattr = (uint64_t **)safe_malloc(num_binattr * sizeof(uint64_t *));
+    g->binattr_na = (uint64_t **)safe_malloc(num_binattr *
+                                             sizeof(uint64_t *));
+  }
+  for (u = 0; u < num_binattr; u++) {
+    g->binattr_names[u] = safe_strdup(binattr_names[u]);
+    pack_binattr(g, u, binattr[u]);
+  }
+  g->num_catattr = num_catattr;
+  if (num_catattr > 0) {
+    g->catattr_names = (char **)safe_malloc(num_catattr * sizeof(char *));
+    g->catattr = (void **)safe_malloc(num_catattr * sizeof(void *));
+    g->catattr_width = (uint8_t *)safe_malloc(num_catattr * sizeof(uint8_t));
+  }
+  for (u = 0; u < num_catattr; u++) {
+    g->catattr_names[u] = safe_strdup(catattr_names[u]);
+    pack_catattr(g, u, catattr[u]);
+  }
+  g->num_contattr = num_contattr;
+  if (num_contattr > 0) {
+    g->contattr_names = (char **)safe_malloc(num_contattr * sizeof(char *));
+    g->contattr = (contattr_t **)safe_malloc(num_contattr *
+                                             sizeof(contattr_t *));
+  }
+  for (u = 0; u < num_contattr; u++) {
+    g->contattr_names[u] = safe_strdup(contattr_names[u]);
+    g->contattr[u] = (contattr_t *)safe_malloc(g->num_nodes *
+                                               sizeof(contattr_t));
+    for (i = 0; i < g->num_nodes; i++)
+      g->contattr[u][i] = (contattr_t)contattr[u][i];
+  }
+  build_attr_terms(g);
   return 0;
 }
 
 
+/*
+ * Size of the block of memory needed to hold the attributes of g
+ * for move_digraph_attributes().
+ *
+ * Parameters:
+ *    g - digraph object with attributes loaded
+ *
+ * Return value:
+ *    Size of block in bytes
+ */
+size_t digraph_attributes_block_size(digraph_t *g)
+{
+  return walk_attr_block(g, NULL, ATTR_BLOCK_SIZE);
+}
+
+/*
+ * Move the attribute values of g into a block of memory (e.g. shared
+ * with other processes on the same node), freeing the private
+ * copies. The names and the arrays of pointers to the values are not
+ * moved, but copies of the names are also put in the block, so that
+ * attach_digraph_attributes() can set up another digraph object with
+ * the same attributes from the block alone. g->shared_attributes is
+ * set so that free_digraph() does not free the values.
+ *
+ * The attribute values must not be changed after this (in particular
+ * reorder_digraph_nodes() cannot be used).
+ *
+ * Parameters:
+ *    g     - (in/out) digraph object with attributes loaded
+ *    block - memory of at least digraph_attributes_block_size(g) bytes,
+ *            8 byte aligned, not freed while g is used
+ *
+ * Return value:
+ *    None
+ */
+void move_digraph_attributes(digraph_t *g, void *block)
+{
+  walk_attr_block(g, (char *)block, ATTR_BLOCK_MOVE);
+}
+
+/*
+ * Copy the attributes of g into a block of memory in the same layout
+ * as move_digraph_attributes(), without changing g (e.g. to write
+ * the block to a file).
+ *
+ * Parameters:
+ *    g     - digraph object with attributes loaded (not changed)
+ *    block - memory of at least digraph_attributes_block_size(g) bytes,
+ *            8 byte aligned and zeroed (so alignment padding is zero)
+ *
+ * Return value:
+ *    None
+ */
+void copy_digraph_attributes(digraph_t *g, void *block)
+{
+  walk_attr_block(g, (char *)block, ATTR_BLOCK_COPY);
+}
+
+/*
+ * Set the attributes of g to those in a block written by
+ * move_digraph_attributes() or copy_digraph_attributes() (for a digraph
+ * with the same number of nodes), without copying the values.
+ *
+ * Parameters:
+ *    g     - (in/out) digraph object with no attributes loaded
+ *    block - block written by move_digraph_attributes(), not freed
+ *            (nor written, it can be read-only) while g is used
+ *
+ * Return value:
+ *    None
+ */
+void attach_digraph_attributes(digraph_t *g, void *block)
+{
+  walk_attr_block(g, (char *)block, ATTR_BLOCK_ATTACH);
+}
+
+
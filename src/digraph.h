@@ -18,6 +18,16 @@
  *
  *    TWOPATH_LOOKUP      - use two-path lookup tables (arrays by default)
  *    TWOPATH_HASHTABLES  - use hash tables (only if TWOPATH_LOOKUP defined)
+ *    TWOPATH_UTHASH      - use uthash rather than open addressing hash
+ *                          tables (only if TWOPATH_HASHTABLES defined)
+ *    TWOPATH_ADAPTIVE    - compile in both arrays and (open addressing)
+ *                          hash tables, and choose between them or no
+ *                          lookup at run time (not with TWOPATH_LOOKUP)
+ *    TWOPATH_CELL8       - use 8 bit rather than 16 bit two-path array cells
+ *    TWOPATH_TILED       - store the two-path arrays in square tiles
+ *                          rather than row-major
+ *    NO_TWOPATH_CACHE    - do not memoise the two-path counts counted
+ *                          on the fly (without TWOPATH_LOOKUP)
  *
  ****************************************************************************/
 
@@ -25,7 +35,9 @@
 #include "utils.h"
 #ifdef TWOPATH_LOOKUP
 #ifdef TWOPATH_HASHTABLES
+#ifdef TWOPATH_UTHASH
 #include "uthash.h"
+#endif /* TWOPATH_UTHASH */
 #endif /* TWOPATH_HASHTABLES */
 #endif /* TWOPATH_LOOKUP */
 
@@ -35,6 +47,17 @@
 
 
 
+/* categorical attribute code for missing data (see catattr in digraph_t) */
+#define CATATTR_CODE_NA 0
+
+/* continuous attribute values are stored in single precision if
+   CONTATTR_FLOAT is defined (halving their memory), else double */
+#ifdef CONTATTR_FLOAT
+typedef float  contattr_t;
+#else
+typedef double contattr_t;
+#endif /* CONTATTR_FLOAT */
+
 /* set element type, each element in array is either present, absent, or NA */
 typedef enum set_elem_e {
   SET_ELEM_NA        = -1,
@@ -42,14 +65,136 @@ typedef enum set_elem_e {
   SET_ELEM_PRESENT   =  1
 } set_elem_e;
 
+/* number of 64 bit words in packed bitset for a set of n elements */
+#define SETATTR_WORDS(n)  (((n) + 63) / 64)
+/* test bit k in bitset b (array of uint64_t) */
+#define SETATTR_BIT_TEST(b, k) (((b)[(k) >> 6] >> ((k) & 63)) & 1)
+
+/* binary attribute u of node i in digraph g folded to 0 or 1 (0 for NA) */
+#define BINATTR_VALUE(g, u, i)  SETATTR_BIT_TEST((g)->binattr[u], (i))
+/* TRUE if binary attribute u of node i in digraph g is NA */
+#define BINATTR_IS_NA(g, u, i)  SETATTR_BIT_TEST((g)->binattr_na[u], (i))
+/* code of categorical attribute u of node i in digraph g (equal codes
+   iff equal values, CATATTR_CODE_NA for missing data) */
+#define CATATTR_CODE(g, u, i)                                           \
+  ((g)->catattr_width[u] == 1 ? (uint32_t)((uint8_t *)(g)->catattr[u])[i] : \
+   (g)->catattr_width[u] == 2 ? (uint32_t)((uint16_t *)(g)->catattr[u])[i] : \
+   ((uint32_t *)(g)->catattr[u])[i])
+
+/*
+ * Node ids as stored in the arc lists, the lists of all arcs and the
+ * two-path hash table keys. They are 32 bit, or with -DNODEID16 (the
+ * _small executables) 16 bit, for networks of at most MAX_NUM_NODES
+ * (65535) nodes, which halves the memory (and memory bandwidth) of the
+ * arc lists and lets a two-path hash table key (i,j) pack into 32 bits.
+ * Node ids are still passed to and returned from functions as uint_t.
+ */
+#ifdef NODEID16
+typedef uint16_t nodeid_t;
+typedef uint32_t twopath_key_t; /* packed (i,j) two-path hash table key */
+#define NODEID_BITS   16
+#define MAX_NUM_NODES ((uint_t)UINT16_MAX) /* so no key is all ones */
+#else
+typedef uint_t   nodeid_t;
+typedef uint64_t twopath_key_t; /* packed (i,j) two-path hash table key */
+#define NODEID_BITS   32
+#define MAX_NUM_NODES ((uint_t)UINT_MAX)
+#endif /* NODEID16 */
+
+/*
+ * Numbers of arcs, and positions in the flat lists of all arcs
+ * (allarcs and allinnerarcs). They are 32 bit, or with -DARCS64 (the
+ * _bigarcs executables) 64 bit for networks of more than UINT_MAX
+ * arcs. Node ids (and so degrees, and the counts of two-paths between
+ * a pair of nodes, which are less than the number of nodes) stay 32 bit
+ * so the arc lists and two-path tables are as compact as before.
+ * ARC_URAND(prng, n) is a uniform random arc position in 0..n-1.
+ */
+#ifdef ARCS64
+typedef uint64_t arcidx_t;
+#define MAX_NUM_ARCS     UINT64_MAX
+#define ARC_URAND(prng, n) prng_int_urand64((prng), (n))
+#else
+typedef uint_t   arcidx_t;
+#define MAX_NUM_ARCS     ((arcidx_t)UINT_MAX)
+#define ARC_URAND(prng, n) prng_int_urand((prng), (n))
+#endif /* ARCS64 */
+
 typedef struct nodepair_s /* pair of nodes (i, j) */
 {
-  uint_t  i;    /* from node */
-  uint_t  j;    /* to node */
+  nodeid_t  i;    /* from node */
+  nodeid_t  j;    /* to node */
 } nodepair_t;
 
+typedef struct point3_s /* point in three dimensions */
+{
+  double x;
+  double y;
+  double z;
+} point3_t;
+
+/* two-path lookup method, chosen at run time if TWOPATH_ADAPTIVE */
+typedef enum twopath_backend_e {
+  TWOPATH_BACKEND_INVALID    = -2, /* invalid name, used as error return */
+  TWOPATH_BACKEND_AUTO       = -1, /* choose with choose_twopath_backend() */
+  TWOPATH_BACKEND_NONE       = 0, /* no lookup, count two-paths on the fly */
+  TWOPATH_BACKEND_ARRAYS     = 1, /* dense two-path arrays */
+  TWOPATH_BACKEND_HASHTABLES = 2, /* sparse two-path hash tables */
+  TWOPATH_BACKEND_HYBRID     = 3, /* hash tables except for two-paths
+                                     through hubs, counted on the fly */
+  TWOPATH_BACKEND_PERNODE    = 4  /* small hash table of two-path partners
+                                     for each node */
+} twopath_backend_e;
+
+/* two-path tables, combined with bitwise OR in a mask of the tables
+   kept (see set_twopath_tables()) */
+#define TWOPATH_TABLE_MIX  0x01 /* two-paths i -> v -> j */
+#define TWOPATH_TABLE_IN   0x02 /* in-two-paths i -> v <- j */
+#define TWOPATH_TABLE_OUT  0x04 /* out-two-paths i <- v -> j */
+#define TWOPATH_TABLES_ALL (TWOPATH_TABLE_MIX | TWOPATH_TABLE_IN | \
+                            TWOPATH_TABLE_OUT)
+
+/* node renumbering applied after loading for better memory locality */
+typedef enum node_order_e {
+  NODE_ORDER_INVALID = -1, /* invalid name, used as error return value */
+  NODE_ORDER_NONE    =  0, /* keep numbering from input file */
+  NODE_ORDER_DEGREE  =  1, /* by total degree, highest first */
+  NODE_ORDER_RCM     =  2, /* reverse Cuthill-McKee (BFS) ordering */
+  NODE_ORDER_ZONE    =  3  /* by snowball zone, inner waves first */
+} node_order_e;
+
+/* Work out which two-path table implementations are compiled in:
+   with TWOPATH_ADAPTIVE both arrays and open addressing hash tables are,
+   otherwise at most one kind as chosen by TWOPATH_LOOKUP etc. */
+#ifdef TWOPATH_ADAPTIVE
 #ifdef TWOPATH_LOOKUP
+#error "TWOPATH_ADAPTIVE cannot be used with TWOPATH_LOOKUP"
+#endif /* TWOPATH_LOOKUP */
+#define TWOPATH_WITH_ARRAYS
+#define TWOPATH_WITH_OAHASH
+#elif defined(TWOPATH_LOOKUP)
 #ifdef TWOPATH_HASHTABLES
+#ifdef TWOPATH_UTHASH
+#define TWOPATH_WITH_UTHASH
+#else
+#define TWOPATH_WITH_OAHASH
+#endif /* TWOPATH_UTHASH */
+#else
+#define TWOPATH_WITH_ARRAYS
+#endif /* TWOPATH_HASHTABLES */
+#endif /* TWOPATH_ADAPTIVE */
+/* two-paths counted on the fly (without lookup tables, or the
+   TWOPATH_BACKEND_NONE backend) are memoised in a small cache */
+#if !defined(TWOPATH_LOOKUP) && !defined(NO_TWOPATH_CACHE)
+#define TWOPATH_CACHE
+#endif /* !TWOPATH_LOOKUP && !NO_TWOPATH_CACHE */
+/* the arrays use open addressing hash tables for counts too large to
+   fit in the array cells */
+#if defined(TWOPATH_WITH_OAHASH) || defined(TWOPATH_WITH_ARRAYS)
+#define TWOPATH_WITH_OATABLES
+#endif /* TWOPATH_WITH_OAHASH || TWOPATH_WITH_ARRAYS */
+
+#ifdef TWOPATH_WITH_UTHASH
 /* uthash hash table entry has (i,j) as key and number of tw-paths as value */
 typedef struct {
   nodepair_t     key;   /* i, j indices */
@@ -57,62 +202,600 @@ typedef struct {
   UT_hash_handle hh;    /* uthash hash handle */
 } twopath_record_t;
 
-#define GET_MIX2PATH_ENTRY(g, i, j) get_twopath_entry((g)->mixTwoPathHashTab, (i), (j))
-#define GET_IN2PATH_ENTRY(g, i, j) get_twopath_entry((g)->inTwoPathHashTab, (i), (j))
-#define GET_OUT2PATH_ENTRY(g, i, j) get_twopath_entry((g)->outTwoPathHashTab, (i), (j))
+#define TWOPATH_HASHTAB_COUNT(h) HASH_COUNT(h)
+#define TWOPATH_HASHTAB_BYTES(h) (HASH_COUNT(h) * sizeof(twopath_record_t) + \
+                                  HASH_OVERHEAD(hh, (h)))
+
+/*
+ * The hash table records are not each allocated with malloc() but
+ * carved from large slabs, with deleted records kept on a free list
+ * for reuse, as records are created and deleted constantly by the
+ * sampler. All records are freed at once with the digraph.
+ */
+#define TWOPATH_POOL_SLAB_RECORDS 65536 /* records in each pool slab */
+
+typedef struct twopath_pool_s
+{
+  twopath_record_t **slabs;     /* array of num_slabs slabs */
+  uint_t             num_slabs; /* number of slabs allocated */
+  size_t             slab_used; /* number of records used in last slab */
+  twopath_record_t  *freelist;  /* deleted records, linked by hh.next */
+} twopath_pool_t;
+#endif /* TWOPATH_WITH_UTHASH */
+
+#ifdef TWOPATH_WITH_OATABLES
+/*
+ * Flat open addressing hash table with linear probing. The (i,j) key
+ * is packed into 64 bits (32 bits with NODEID16), and stored in a
+ * separate array from the 32 bit counts so that probing only touches
+ * the keys. Entries whose count drops to zero are removed with backward
+ * shift deletion so there are no tombstones and probe sequences stay
+ * short.
+ */
+#define TWOPATH_EMPTY_KEY  ((twopath_key_t)~(twopath_key_t)0) /* unused slot */
+#define TWOPATH_KEY(i, j)  (((twopath_key_t)(i) << NODEID_BITS) | \
+                            (twopath_key_t)(j))
+/* (i,j) such that TWOPATH_KEY(i,j) is k, for keying by array index k */
+#define TWOPATH_KEY_HI(k)  ((uint_t)((uint64_t)(k) >> NODEID_BITS))
+#define TWOPATH_KEY_LO(k)  ((uint_t)((uint64_t)(k) & \
+                                     ((1ULL << NODEID_BITS) - 1)))
+
+typedef struct twopath_hashtab_s
+{
+  twopath_key_t *keys;  /* packed (i,j) keys or TWOPATH_EMPTY_KEY */
+  uint32_t *values;     /* count of two-paths for corresponding key */
+  size_t    capacity;   /* number of slots (power of two, or 0 if empty) */
+  size_t    count;      /* number of slots in use */
+} twopath_hashtab_t;
+
+#define TWOPATH_HASHTAB_COUNT(h) ((h).count)
+#define TWOPATH_HASHTAB_BYTES(h) ((h).capacity * (sizeof(twopath_key_t) + \
+                                                  sizeof(uint32_t)))
+#endif /* TWOPATH_WITH_OATABLES */
+
+#ifdef TWOPATH_ADAPTIVE
+/*
+ * With the per-node two-path backend, each node i has its own small
+ * open addressing hash table for each kind of two-path, holding the
+ * nonzero counts of the two-paths from i keyed by the other end node.
+ * The in- and out-two-path counts (which are symmetric) are in the
+ * tables of both nodes, so the counts for i and its neighbours, as
+ * looked up by the change statistics looping over the neighbours of
+ * i, are all in the one small table rather than scattered over a
+ * global hash table.
+ */
+#define TWOPATH_NODETAB_EMPTY UINT32_MAX /* node of unused slot */
+
+typedef struct twopath_nodeentry_s
+{
+  uint32_t node;  /* other end node, or TWOPATH_NODETAB_EMPTY */
+  uint32_t count; /* number of two-paths */
+} twopath_nodeentry_t;
+
+typedef struct twopath_nodetab_s
+{
+  twopath_nodeentry_t *slots; /* slots of the table */
+  uint32_t  capacity; /* number of slots (power of two, or 0 if empty) */
+  uint32_t  count;    /* number of slots in use */
+} twopath_nodetab_t;
+#endif /* TWOPATH_ADAPTIVE */
+
+#ifdef TWOPATH_WITH_ARRAYS
+/*
+ * The two-path arrays have narrow (16 bit, or 8 bit if TWOPATH_CELL8)
+ * cells as almost all counts are small, which reduces memory bandwidth
+ * and lets much larger arrays fit in memory and cache. A cell at its
+ * maximum value TWOPATH_CELL_MAX means the count is that plus the value
+ * (if any) in a "spill" open addressing hash table keyed by the array
+ * index, which holds the excess for the rare larger counts.
+ */
+#ifdef TWOPATH_CELL8
+typedef uint8_t twopath_cell_t;
+#define TWOPATH_CELL_MAX  UINT8_MAX
 #else
-#define GET_MIX2PATH_ENTRY(g, i, j) ((g)->mixTwoPathMatrix[INDEX2D((i), (j), (g)->num_nodes)])
-#define GET_IN2PATH_ENTRY(g, i, j) ((g)->inTwoPathMatrix[INDEX2D((i), (j), (g)->num_nodes)])
-#define GET_OUT2PATH_ENTRY(g, i, j) ((g)->outTwoPathMatrix[INDEX2D((i), (j), (g)->num_nodes)])
-#endif /* TWOPATH_HASHTABLES */
+typedef uint16_t twopath_cell_t;
+#define TWOPATH_CELL_MAX  UINT16_MAX
+#endif /* TWOPATH_CELL8 */
+
+#define TWOPATH_CELL_GET(m, spill, k) \
+  ((m)[(k)] != TWOPATH_CELL_MAX ? (uint_t)(m)[(k)] : \
+   TWOPATH_CELL_MAX + get_twopath_entry((spill), \
+                                        TWOPATH_KEY_HI(k), \
+                                        TWOPATH_KEY_LO(k)))
+
+/*
+ * Index of cell (i, j) in the two-path arrays of a digraph with n
+ * nodes: TWOPATH_INDEX2D for the n x n mixed two-path array and
+ * TWOPATH_INDEX_SYM2D for the packed upper triangles of the symmetric
+ * in- and out-two-path arrays, which have TWOPATH_MIX_CELLS(n) and
+ * TWOPATH_SYM_CELLS(n) cells respectively.
+ *
+ * Updating the two-paths for arc i -> j touches row j and column j
+ * (over the neighbours v of i and j), and in a row-major array of
+ * a large network every entry of a column is on a different cache line
+ * and page. With TWOPATH_TILED the arrays are instead stored as
+ * TWOPATH_TILE x TWOPATH_TILE tiles (each row-major, the tiles
+ * themselves in row-major order, and only the tiles on or above the
+ * diagonal for the symmetric arrays), so nearby rows and columns are
+ * in the same tiles. This works best with the nodes renumbered so that
+ * neighbours have nearby numbers (nodeOrder = RCM, or degree so the
+ * hubs that are in most two-paths are together). The arrays are
+ * padded to a whole number of tiles.
+ */
+#ifdef TWOPATH_TILED
+#define TWOPATH_TILE_SHIFT 6                         /* log2 TWOPATH_TILE */
+#define TWOPATH_TILE       (1 << TWOPATH_TILE_SHIFT) /* cells per tile side */
+#define TWOPATH_NUM_TILES(n) \
+  (((size_t)(n) + TWOPATH_TILE - 1) >> TWOPATH_TILE_SHIFT)
+#define TWOPATH_TILE_CELL(tile, i, j) \
+  (((size_t)(tile) << (2 * TWOPATH_TILE_SHIFT)) + \
+   (((size_t)(i) & (TWOPATH_TILE - 1)) << TWOPATH_TILE_SHIFT) + \
+   ((size_t)(j) & (TWOPATH_TILE - 1)))
+#define TWOPATH_INDEX2D(i, j, n) \
+  TWOPATH_TILE_CELL(INDEX2D((i) >> TWOPATH_TILE_SHIFT, \
+                            (j) >> TWOPATH_TILE_SHIFT, \
+                            TWOPATH_NUM_TILES(n)), (i), (j))
+#define TWOPATH_INDEX_UPPERTRI(i, j, n) \
+  TWOPATH_TILE_CELL(INDEX_UPPERTRI((i) >> TWOPATH_TILE_SHIFT, \
+                                   (j) >> TWOPATH_TILE_SHIFT, \
+                                   TWOPATH_NUM_TILES(n)), (i), (j))
+#define TWOPATH_INDEX_SYM2D(i, j, n) \
+  ((i) <= (j) ? TWOPATH_INDEX_UPPERTRI((i), (j), (n)) : \
+                TWOPATH_INDEX_UPPERTRI((j), (i), (n)))
+#define TWOPATH_MIX_CELLS(n) \
+  (TWOPATH_NUM_TILES(n) * TWOPATH_NUM_TILES(n) << (2 * TWOPATH_TILE_SHIFT))
+#define TWOPATH_SYM_CELLS(n) \
+  (TWOPATH_NUM_TILES(n) * (TWOPATH_NUM_TILES(n) + 1) / 2 << \
+   (2 * TWOPATH_TILE_SHIFT))
+#else
+#define TWOPATH_INDEX2D(i, j, n)     INDEX2D((i), (j), (n))
+#define TWOPATH_INDEX_SYM2D(i, j, n) INDEX_SYM2D((i), (j), (n))
+#define TWOPATH_MIX_CELLS(n)         ((size_t)(n) * (n))
+#define TWOPATH_SYM_CELLS(n)         ((size_t)(n) * ((n) + 1) / 2)
+#endif /* TWOPATH_TILED */
+#endif /* TWOPATH_WITH_ARRAYS */
+
+/* two-paths counted on the fly, through the cache if it is used */
+#ifdef TWOPATH_CACHE
+#define COUNT_MIX2PATHS(g, i, j) cachedMixTwoPaths((g), (i), (j))
+#define COUNT_OUT2PATHS(g, i, j) cachedOutTwoPaths((g), (i), (j))
+#define COUNT_IN2PATHS(g, i, j)  cachedInTwoPaths((g), (i), (j))
+#else
+#define COUNT_MIX2PATHS(g, i, j) mixTwoPaths((g), (i), (j))
+#define COUNT_OUT2PATHS(g, i, j) outTwoPaths((g), (i), (j))
+#define COUNT_IN2PATHS(g, i, j)  inTwoPaths((g), (i), (j))
+#endif /* TWOPATH_CACHE */
+
+/*
+ * Two-path count lookups. With TWOPATH_ADAPTIVE, the two-paths of
+ * a kind whose table is not kept (see set_twopath_tables()) are
+ * counted on the fly whatever the backend.
+ */
+#ifdef TWOPATH_ADAPTIVE
+#define GET_MIX2PATH_ENTRY(g, i, j) \
+  (!((g)->twopath_tables & TWOPATH_TABLE_MIX) ? \
+   COUNT_MIX2PATHS((g), (i), (j)) : \
+   (g)->twopath_backend == TWOPATH_BACKEND_ARRAYS ? \
+   TWOPATH_CELL_GET((g)->mixTwoPathMatrix, &(g)->mixTwoPathSpill, \
+                    TWOPATH_INDEX2D((i), (j), (g)->num_nodes)) : \
+   (g)->twopath_backend == TWOPATH_BACKEND_HASHTABLES ? \
+   get_twopath_entry(&(g)->mixTwoPathHashTab, (i), (j)) : \
+   (g)->twopath_backend == TWOPATH_BACKEND_HYBRID ? \
+   get_twopath_entry(&(g)->mixTwoPathHashTab, (i), (j)) + \
+   hubMixTwoPaths((g), (i), (j)) : \
+   (g)->twopath_backend == TWOPATH_BACKEND_PERNODE ? \
+   get_twopath_nodetab_entry(&(g)->mixTwoPathNodeTabs[(i)], (j)) : \
+   COUNT_MIX2PATHS((g), (i), (j)))
+#define GET_IN2PATH_ENTRY(g, i, j) \
+  (!((g)->twopath_tables & TWOPATH_TABLE_IN) ? \
+   COUNT_IN2PATHS((g), (i), (j)) : \
+   (g)->twopath_backend == TWOPATH_BACKEND_ARRAYS ? \
+   TWOPATH_CELL_GET((g)->inTwoPathMatrix, &(g)->inTwoPathSpill, \
+                    TWOPATH_INDEX_SYM2D((i), (j), (g)->num_nodes)) : \
+   (g)->twopath_backend == TWOPATH_BACKEND_HASHTABLES ? \
+   get_twopath_entry(&(g)->inTwoPathHashTab, MIN((i), (j)), MAX((i), (j))) : \
+   (g)->twopath_backend == TWOPATH_BACKEND_HYBRID ? \
+   get_twopath_entry(&(g)->inTwoPathHashTab, MIN((i), (j)), MAX((i), (j))) + \
+   hubInTwoPaths((g), (i), (j)) : \
+   (g)->twopath_backend == TWOPATH_BACKEND_PERNODE ? \
+   get_twopath_nodetab_entry(&(g)->inTwoPathNodeTabs[(i)], (j)) : \
+   COUNT_IN2PATHS((g), (i), (j)))
+#define GET_OUT2PATH_ENTRY(g, i, j) \
+  (!((g)->twopath_tables & TWOPATH_TABLE_OUT) ? \
+   COUNT_OUT2PATHS((g), (i), (j)) : \
+   (g)->twopath_backend == TWOPATH_BACKEND_ARRAYS ? \
+   TWOPATH_CELL_GET((g)->outTwoPathMatrix, &(g)->outTwoPathSpill, \
+                    TWOPATH_INDEX_SYM2D((i), (j), (g)->num_nodes)) : \
+   (g)->twopath_backend == TWOPATH_BACKEND_HASHTABLES ? \
+   get_twopath_entry(&(g)->outTwoPathHashTab, MIN((i), (j)), MAX((i), (j))) : \
+   (g)->twopath_backend == TWOPATH_BACKEND_HYBRID ? \
+   get_twopath_entry(&(g)->outTwoPathHashTab, MIN((i), (j)), MAX((i), (j))) + \
+   hubOutTwoPaths((g), (i), (j)) : \
+   (g)->twopath_backend == TWOPATH_BACKEND_PERNODE ? \
+   get_twopath_nodetab_entry(&(g)->outTwoPathNodeTabs[(i)], (j)) : \
+   COUNT_OUT2PATHS((g), (i), (j)))
+#elif defined(TWOPATH_WITH_UTHASH)
+#define GET_MIX2PATH_ENTRY(g, i, j) get_twopath_entry((g)->mixTwoPathHashTab, (i), (j))
+#define GET_IN2PATH_ENTRY(g, i, j) get_twopath_entry((g)->inTwoPathHashTab, MIN((i), (j)), MAX((i), (j)))
+#define GET_OUT2PATH_ENTRY(g, i, j) get_twopath_entry((g)->outTwoPathHashTab, MIN((i), (j)), MAX((i), (j)))
+#elif defined(TWOPATH_WITH_OAHASH)
+#define GET_MIX2PATH_ENTRY(g, i, j) get_twopath_entry(&(g)->mixTwoPathHashTab, (i), (j))
+#define GET_IN2PATH_ENTRY(g, i, j) get_twopath_entry(&(g)->inTwoPathHashTab, MIN((i), (j)), MAX((i), (j)))
+#define GET_OUT2PATH_ENTRY(g, i, j) get_twopath_entry(&(g)->outTwoPathHashTab, MIN((i), (j)), MAX((i), (j)))
+#elif defined(TWOPATH_WITH_ARRAYS)
+#define GET_MIX2PATH_ENTRY(g, i, j) TWOPATH_CELL_GET((g)->mixTwoPathMatrix, &(g)->mixTwoPathSpill, TWOPATH_INDEX2D((i), (j), (g)->num_nodes))
+#define GET_IN2PATH_ENTRY(g, i, j) TWOPATH_CELL_GET((g)->inTwoPathMatrix, &(g)->inTwoPathSpill, TWOPATH_INDEX_SYM2D((i), (j), (g)->num_nodes))
+#define GET_OUT2PATH_ENTRY(g, i, j) TWOPATH_CELL_GET((g)->outTwoPathMatrix, &(g)->outTwoPathSpill, TWOPATH_INDEX_SYM2D((i), (j), (g)->num_nodes))
 #else /* not using two-path lookup tables (either arrays or hashtables) */
-#define GET_MIX2PATH_ENTRY(g, i, j) mixTwoPaths((g), (i), (j))
-#define GET_OUT2PATH_ENTRY(g, i, j) outTwoPaths((g), (i), (j))
-#define GET_IN2PATH_ENTRY(g, i, j) inTwoPaths((g), (i), (j))
+#define GET_MIX2PATH_ENTRY(g, i, j) COUNT_MIX2PATHS((g), (i), (j))
+#define GET_OUT2PATH_ENTRY(g, i, j) COUNT_OUT2PATHS((g), (i), (j))
+#define GET_IN2PATH_ENTRY(g, i, j) COUNT_IN2PATHS((g), (i), (j))
+#endif /* TWOPATH_ADAPTIVE */
 
-#endif /* TWOPATH_LOOKUP */
+/*
+ * Prefetch the memory that GET_MIX2PATH_ENTRY(g, i, j) etc. will read,
+ * so that a loop over neighbours can issue the lookup for a neighbour
+ * some way ahead and have the cache miss overlap with the work on the
+ * current one. No effect when counting on the fly or with uthash.
+ */
+#ifdef TWOPATH_WITH_ARRAYS
+#define PREFETCH_MIX2PATH_ARRAY(g, i, j)   PREFETCH(&(g)->mixTwoPathMatrix[TWOPATH_INDEX2D((i), (j), (g)->num_nodes)])
+#define PREFETCH_IN2PATH_ARRAY(g, i, j)   PREFETCH(&(g)->inTwoPathMatrix[TWOPATH_INDEX_SYM2D((i), (j), (g)->num_nodes)])
+#define PREFETCH_OUT2PATH_ARRAY(g, i, j)   PREFETCH(&(g)->outTwoPathMatrix[TWOPATH_INDEX_SYM2D((i), (j), (g)->num_nodes)])
+#endif /* TWOPATH_WITH_ARRAYS */
+#ifdef TWOPATH_ADAPTIVE
+#define PREFETCH_MIX2PATH_ENTRY(g, i, j)   (!((g)->twopath_tables & TWOPATH_TABLE_MIX) ? (void)0 :    (g)->twopath_backend == TWOPATH_BACKEND_ARRAYS ?    PREFETCH_MIX2PATH_ARRAY((g), (i), (j)) :    (g)->twopath_backend == TWOPATH_BACKEND_PERNODE ?    prefetch_twopath_nodetab_entry(&(g)->mixTwoPathNodeTabs[(i)], (j)) :    (g)->twopath_backend >= TWOPATH_BACKEND_HASHTABLES ?    prefetch_twopath_entry(&(g)->mixTwoPathHashTab, (i), (j)) : (void)0)
+#define PREFETCH_IN2PATH_ENTRY(g, i, j)   (!((g)->twopath_tables & TWOPATH_TABLE_IN) ? (void)0 :    (g)->twopath_backend == TWOPATH_BACKEND_ARRAYS ?    PREFETCH_IN2PATH_ARRAY((g), (i), (j)) :    (g)->twopath_backend == TWOPATH_BACKEND_PERNODE ?    prefetch_twopath_nodetab_entry(&(g)->inTwoPathNodeTabs[(i)], (j)) :    (g)->twopath_backend >= TWOPATH_BACKEND_HASHTABLES ?    prefetch_twopath_entry(&(g)->inTwoPathHashTab, MIN((i), (j)), MAX((i), (j))) : (void)0)
+#define PREFETCH_OUT2PATH_ENTRY(g, i, j)   (!((g)->twopath_tables & TWOPATH_TABLE_OUT) ? (void)0 :    (g)->twopath_backend == TWOPATH_BACKEND_ARRAYS ?    PREFETCH_OUT2PATH_ARRAY((g), (i), (j)) :    (g)->twopath_backend == TWOPATH_BACKEND_PERNODE ?    prefetch_twopath_nodetab_entry(&(g)->outTwoPathNodeTabs[(i)], (j)) :    (g)->twopath_backend >= TWOPATH_BACKEND_HASHTABLES ?    prefetch_twopath_entry(&(g)->outTwoPathHashTab, MIN((i), (j)), MAX((i), (j))) : (void)0)
+#elif defined(TWOPATH_WITH_OAHASH)
+#define PREFETCH_MIX2PATH_ENTRY(g, i, j) prefetch_twopath_entry(&(g)->mixTwoPathHashTab, (i), (j))
+#define PREFETCH_IN2PATH_ENTRY(g, i, j) prefetch_twopath_entry(&(g)->inTwoPathHashTab, MIN((i), (j)), MAX((i), (j)))
+#define PREFETCH_OUT2PATH_ENTRY(g, i, j) prefetch_twopath_entry(&(g)->outTwoPathHashTab, MIN((i), (j)), MAX((i), (j)))
+#elif defined(TWOPATH_WITH_ARRAYS)
+#define PREFETCH_MIX2PATH_ENTRY(g, i, j) PREFETCH_MIX2PATH_ARRAY((g), (i), (j))
+#define PREFETCH_IN2PATH_ENTRY(g, i, j) PREFETCH_IN2PATH_ARRAY((g), (i), (j))
+#define PREFETCH_OUT2PATH_ENTRY(g, i, j) PREFETCH_OUT2PATH_ARRAY((g), (i), (j))
+#else /* uthash or not using two-path lookup tables */
+#define PREFETCH_MIX2PATH_ENTRY(g, i, j) ((void)0)
+#define PREFETCH_IN2PATH_ENTRY(g, i, j) ((void)0)
+#define PREFETCH_OUT2PATH_ENTRY(g, i, j) ((void)0)
+#endif /* TWOPATH_ADAPTIVE */
+
+/*
+ * Adjacency list blocks are carved out of large contiguous slabs rather
+ * than each being separately allocated with malloc(). Each block has
+ * a power of two capacity (number of nodeid_t entries), and when a node's
+ * list is full it is moved to a block of twice the capacity, so inserting
+ * an arc is amortized O(1) and almost never calls the allocator. Freed
+ * blocks are kept on a free list for their size class and reused.
+ * Blocks too large to be sensibly carved from a slab (only for very high
+ * degree nodes) are allocated individually with malloc().
+ */
+#define ADJ_NUM_SIZE_CLASSES  32  /* capacities 2^0 .. 2^31 */
+
+typedef struct adjarena_s
+{
+  nodeid_t **slabs;     /* array of num_slabs slabs each ADJ_SLAB_SIZE long */
+  uint_t    num_slabs;  /* number of slabs allocated */
+  size_t    slab_used;  /* number of entries used in last slab */
+  void     *freelist[ADJ_NUM_SIZE_CLASSES]; /* free blocks for each
+                                               size class (log2 capacity) */
+} adjarena_t;
+
+/*
+ * Nodes with high degree also have a hash set of their neighbours (for
+ * each direction separately) so that isArc() is O(1) rather than a linear
+ * scan of the arc list. The set is built when the degree exceeds
+ * hub_threshold and freed again when it falls below half that.
+ */
+#define DEFAULT_HUB_DEGREE_THRESHOLD 128 /* degree above which to use set */
+#define DEFAULT_HUB_UPDATE_DEGREE 8192   /* degree from which two-path array
+                                            updates are divided between
+                                            threads */
+
+typedef struct nodeset_s
+{
+  uint_t *slots;    /* node ids, or empty slot marker */
+  uint_t  capacity; /* number of slots (power of two, or 0 if no set) */
+  uint_t  count;    /* number of slots in use */
+} nodeset_t;
+
+/*
+ * The position of each arc in the allarcs (and allinnerarcs) flat
+ * arc lists is kept in an open addressing hash table keyed by the arc,
+ * so that any arc can be removed from the list in O(1) time, not just
+ * one chosen from the list whose position is already known.
+ */
+typedef struct arcindex_s
+{
+  uint64_t *keys;     /* packed (i,j) arcs, or empty slot marker */
+  arcidx_t *values;   /* position of arc in flat arc list */
+  size_t    capacity; /* number of slots (power of two, or 0 if empty) */
+  size_t    count;    /* number of slots in use */
+} arcindex_t;
+
+/*
+ * Journal of arc toggles made since begin_arc_journal(), so that a
+ * speculative change to the network (e.g. the chosen try of a multiple
+ * try move, before it is accepted or rejected) can be undone by
+ * rollback_arc_journal() rather than by the inverse insert or remove.
+ * Each entry records the slots the toggle changed in the adjacency
+ * lists and the flat arc list, so the rollback puts the arcs back in
+ * exactly the positions they were in without searching for them or
+ * looking them up, and the network is left as if the toggles had
+ * never been made (not just with the same arcs in a different order).
+ */
+typedef struct arc_journal_entry_s
+{
+  nodeid_t i, j;     /* arc i -> j toggled */
+  bool     isDelete; /* TRUE if the arc was removed, else inserted */
+  bool     inner;    /* TRUE if in allinnerarcs, else allarcs */
+  uint_t   outpos;   /* position j was removed from in arclist[i] */
+  uint_t   inpos;    /* position i was removed from in revarclist[j] */
+  arcidx_t arcidx;   /* position the arc was removed from in flat list */
+} arc_journal_entry_t;
+
+typedef struct arc_journal_s
+{
+  arc_journal_entry_t *entries;  /* toggles in the order they were made */
+  uint_t               len;      /* number of entries */
+  uint_t               capacity; /* allocated length of entries */
+  bool                 active;   /* TRUE between begin_arc_journal() and
+                                    rollback or commit */
+} arc_journal_t;
+
+#ifdef TWOPATH_CACHE
+/*
+ * Version stamps of the adjacency lists of a node, incremented whenever
+ * the list changes. A two-path count in the cache is valid only while
+ * the stamps of the lists it was counted from are unchanged, e.g. the
+ * mixed two-paths i -> v -> j depend only on the out-list of i and the
+ * in-list of j.
+ */
+typedef struct twopath_stamp_s
+{
+  uint32_t out; /* version of arclist[i] */
+  uint32_t in;  /* version of revarclist[i] */
+} twopath_stamp_t;
+#endif /* TWOPATH_CACHE */
+
+/*
+ * Change statistics of each dyad as last computed by the sampler (see
+ * set_dyad_cache()). The change statistics of dyad (i, j) depend only
+ * on the arcs of i, j and their neighbours, so the version of a node
+ * is incremented whenever an arc of it or of one of its neighbours is
+ * inserted or removed, and the statistics of a dyad are valid only
+ * while the versions of both its nodes are those they were stored with.
+ */
+typedef struct dyad_cache_s
+{
+  uint_t    num_stats; /* change statistics per dyad */
+  uint32_t *version;   /* for each node, version (from 1) */
+  uint64_t *stamp;     /* for each dyad INDEX2D(i, j, n), versions of i
+                          (high 32 bits) and j its statistics were stored
+                          with, or 0 if none */
+  double   *stats;     /* num_stats change statistics of each dyad */
+  double    hits;      /* lookups that found valid statistics */
+  double    misses;    /* lookups that did not */
+} dyad_cache_t;
+
+/*
+ * The categorical attribute statistics that can be looked up in a
+ * category pair table (see cat_pair_table_t).
+ */
+typedef enum cat_pair_kind_e {
+  CAT_PAIR_NONE,                    /* not in the table */
+  CAT_PAIR_MATCHING,                /* Matching */
+  CAT_PAIR_MATCHING_RECIPROCITY,    /* MatchingReciprocity */
+  CAT_PAIR_MISMATCHING,             /* Mismatching */
+  CAT_PAIR_MISMATCHING_RECIPROCITY, /* MismatchingReciprocity */
+  CAT_PAIR_MATCHING_INTERACTION     /* MatchingInteraction */
+} cat_pair_kind_e;
+
+#define CAT_PAIR_MAX_TERMS 32  /* statistics in a table (bits of an entry) */
+#define CAT_PAIR_MAX_CODES 256 /* node codes in a table (so J*J entries are
+                                  at most 256 kB) */
+
+typedef struct cat_pair_term_s
+{
+  uint8_t kind; /* cat_pair_kind_e, CAT_PAIR_NONE if not in the table */
+  uint8_t bit;  /* bit of the statistic in the entries of pair_bits */
+  uint_t  a;    /* attribute index (into catattr) */
+  uint_t  b;    /* second attribute index for MatchingInteraction */
+} cat_pair_term_t;
+
+/*
+ * Categorical attribute statistics of a model precomputed for each
+ * pair of categories (see build_cat_pair_table()). Each node has a
+ * compact code for its combination of values (or NA) of all the
+ * categorical attributes used by those statistics, and the table has
+ * for each pair of codes a bit for each statistic, set if the statistic
+ * is 1 for an arc between nodes with those codes (for the Reciprocity
+ * statistics, if the reciprocal arc is there). So all the categorical
+ * statistics of a dyad are from one table entry rather than two code
+ * loads for each attribute of each statistic.
+ */
+typedef struct cat_pair_table_s
+{
+  uint32_t  num_codes;  /* number of node codes J */
+  uint32_t *node_code;  /* code (0 to J-1) of each node */
+  uint32_t *pair_bits;  /* J x J entries, pair_bits[ci*J + cj] for an arc
+                           from a node with code ci to one with code cj */
+  uint_t    n_attr;     /* number of nodal attribute statistics */
+  uint_t    n_attr_interaction; /* number of attribute interaction stats */
+  cat_pair_term_t *terms; /* n_attr + n_attr_interaction: each nodal
+                             attribute statistic, then each attribute
+                             interaction statistic, of the model */
+} cat_pair_table_t;
+
+/* table entry for an arc i->j */
+#define CAT_PAIR_BITS(t, i, j)                                          \
+  ((t)->pair_bits[(size_t)(t)->node_code[i] * (t)->num_codes +          \
+                  (t)->node_code[j]])
+
+/*
+ * With the hybrid two-path backend, the two-paths through a "two-path
+ * hub" (a node whose total degree was over twopath_hub_cutoff when the
+ * backend was set) are not in the hash tables, as a node of degree d is
+ * the middle of O(d^2) two-paths. Instead each node has a list of the
+ * hubs it has an arc to and one of the hubs that have an arc to it, and
+ * the two-paths through those hubs are counted at lookup time.
+ */
+typedef struct hublist_s
+{
+  uint_t *nodes;    /* hub nodes */
+  uint_t  len;      /* number of hub nodes in list */
+  uint_t  capacity; /* allocated length of nodes */
+} hublist_t;
+
+/*
+ * Map from the original node ids in an edge list file (arbitrary 64 bit
+ * integers) to node numbers 0..N-1, in an open addressing hash table
+ * keyed by id. Once all the ids are added, number_node_ids() numbers
+ * the nodes in ascending order of id.
+ */
+#define NODEIDMAP_NONE UINT_MAX /* nodeidmap_get() value for unknown id */
+typedef struct nodeidmap_s
+{
+  uint64_t *keys;      /* node ids, or empty slot marker (UINT64_MAX) */
+  uint_t   *values;    /* node number of each id */
+  size_t    capacity;  /* number of slots (power of two, or 0 if empty) */
+  uint_t    num_nodes; /* number of ids in map */
+  uint64_t *ids;       /* for each node, its id (from number_node_ids()) */
+} nodeidmap_t;
 
 typedef struct digraph_s
 {
   uint_t   num_nodes;  /* number of nodes */
-  uint_t   num_arcs;   /* number of arcs */
+  arcidx_t num_arcs;   /* number of arcs */
   uint_t  *outdegree;  /* for each node, number of nodes it has an arc to */
-  uint_t **arclist;    /* arc adjacency lists: for each node i, array of
+  nodeid_t **arclist;  /* arc adjacency lists: for each node i, array of
                           outdegree[i] nodes it has an arc to */
   uint_t  *indegree;   /* for each node, number of nodes that have an arc to it*/
-  uint_t **revarclist; /* reverse arc adjacency list: for each node i, array of 
-                          indegree[i] nodes that have an arc to it */
+  nodeid_t **revarclist; /* reverse arc adjacency list: for each node i,
+                            array of indegree[i] nodes that have an arc
+                            to it */
+  uint_t  *outcapacity;/* for each node, allocated length of arclist[i] */
+  uint_t  *incapacity; /* for each node, allocated length of revarclist[i] */
+  adjarena_t adjarena; /* slab storage for arclist and revarclist blocks */
+  uint_t   hub_threshold;/* degree above which hub sets are used, 0 for never */
+  uint_t   build_threads;/* threads to build two-path tables from scratch
+                            and to parse attribute files */
+  uint_t   update_threads;    /* threads for two-path array updates */
+  uint_t   hub_update_degree; /* degree from which the two-path array
+                                 updates for an arc use update_pool */
+  struct twopath_update_pool_s *update_pool; /* the update_threads threads,
+                                                made on first use, or NULL */
+  nodeset_t *outhubset;/* for each node, set of arclist[i] if hub else empty */
+  nodeset_t *inhubset; /* for each node, set of revarclist[i] if hub else empty */
+  uint64_t *arcbitmatrix; /* n x n bit matrix, bit INDEX2D(i,j,n) set iff
+                             arc i->j, or NULL if not used */
+  double   altinstar_lambda;  /* lambda of altinstar, 0 if not used */
+  double  *altinstar;  /* for each node v, AltInStars change statistic for
+                          adding an arc to v in altinstar[2*v] and for
+                          deleting one in altinstar[2*v+1], kept up to date
+                          by insertArc() and removeArc(), or NULL if not
+                          used (see set_altstar_cache()) */
+  double   altoutstar_lambda; /* lambda of altoutstar, 0 if not used */
+  double  *altoutstar; /* same for AltOutStars and arcs from v */
+  dyad_cache_t *dyad_cache; /* change statistics of each dyad, or NULL if
+                               not used (see set_dyad_cache()) */
+  cat_pair_table_t *cat_pair_table; /* categorical attribute statistics of
+                                       each category pair, or NULL if not
+                                       used (see set_cat_pair_table()) */
   nodepair_t *allarcs; /* list of all arcs specified as i->j for each. */
+  arcidx_t allarcs_capacity; /* allocated length of allarcs */
+  arcindex_t allarcs_index; /* position of each arc in allarcs */
+  arc_journal_t journal;    /* toggles to undo (see begin_arc_journal()) */
+  uint_t  *orig_node;  /* for each node, its number in the input files
+                          if reorder_digraph_nodes() was used, else NULL */
+  nodeidmap_t *node_ids; /* ids of nodes in an edge list input file (before
+                            any reorder_digraph_nodes()), else NULL */
+  nodepair_t *pending_arcs; /* arcs read from the arc list file by
+                               allocate_digraph_from_arclist_file() and not
+                               yet added to g, else NULL */
+  arcidx_t num_pending_arcs; /* length of pending_arcs */
 
-#ifdef TWOPATH_LOOKUP
-#ifdef TWOPATH_HASHTABLES
-  /* the keys for hash tables are 64 bits: 32 bits each for i and j index */
+#ifdef TWOPATH_ADAPTIVE
+  twopath_backend_e twopath_backend; /* two-path lookup method in use */
+  uint8_t    twopath_tables; /* TWOPATH_TABLE_MIX etc. of the tables kept by
+                                the backend, others counted on the fly */
+  uint_t     twopath_hub_cutoff; /* degree above which a node is a two-path
+                                    hub with TWOPATH_BACKEND_HYBRID */
+  uint8_t   *twopath_hub; /* for each node, nonzero if two-path hub, or
+                             NULL if not TWOPATH_BACKEND_HYBRID */
+  hublist_t *hub_out;     /* for each node, two-path hubs it has an arc to
+                             (NULL if not TWOPATH_BACKEND_HYBRID) */
+  hublist_t *hub_in;      /* for each node, two-path hubs with an arc to it
+                             (NULL if not TWOPATH_BACKEND_HYBRID) */
+  twopath_nodetab_t *mixTwoPathNodeTabs; /* for each node i, counts of
+                                            two-paths i -> v -> j by j (NULL
+                                            if not TWOPATH_BACKEND_PERNODE) */
+  twopath_nodetab_t *inTwoPathNodeTabs;  /* same for in-two-paths */
+  twopath_nodetab_t *outTwoPathNodeTabs; /* same for out-two-paths */
+#endif /* TWOPATH_ADAPTIVE */
+#ifdef TWOPATH_CACHE
+  twopath_stamp_t *twopath_stamp; /* for each node, version stamps of its
+                                     adjacency lists for the two-path cache */
+  uint64_t   twopath_cache_id; /* identifies g in the two-path cache, changed
+                                  to invalidate all its cached counts */
+#endif /* TWOPATH_CACHE */
+#if defined(TWOPATH_WITH_UTHASH) || defined(TWOPATH_WITH_OAHASH)
+  /* the keys for hash tables are 64 bits: 32 bits each for i and j index.
+     The in- and out-two-path counts are symmetric, so only entries with
+     i <= j are stored in those tables */
+#ifdef TWOPATH_WITH_UTHASH
   twopath_record_t *mixTwoPathHashTab; /* hash table counting two-paths */
   twopath_record_t *inTwoPathHashTab;  /* hash table counting in-two-paths */
   twopath_record_t *outTwoPathHashTab; /* hash table counting out-two-paths */
-#else /* using array not hashtables for two-path lookup */
-  uint_t *mixTwoPathMatrix; /* n x n contiguous matrix counting two-paths */
-  uint_t *inTwoPathMatrix;  /* n x n contiguous matrix counting in-two-paths */
-  uint_t *outTwoPathMatrix; /* n x n contiguous matrix counting out-two-paths */
-#endif /*TWOPATH_HASHTABLES*/
-#endif /* TWOPATH_LOOKUP */
+  twopath_pool_t    twopath_pool;      /* records for all three tables */
+#else
+  twopath_hashtab_t mixTwoPathHashTab; /* hash table counting two-paths */
+  twopath_hashtab_t inTwoPathHashTab;  /* hash table counting in-two-paths */
+  twopath_hashtab_t outTwoPathHashTab; /* hash table counting out-two-paths */
+#endif /* TWOPATH_WITH_UTHASH */
+#endif /* TWOPATH_WITH_UTHASH || TWOPATH_WITH_OAHASH */
+#ifdef TWOPATH_WITH_ARRAYS
+  twopath_cell_t *mixTwoPathMatrix; /* n x n contiguous matrix counting
+                                       two-paths */
+  twopath_cell_t *inTwoPathMatrix;  /* n(n+1)/2 packed upper triangle of
+                                       symmetric matrix counting
+                                       in-two-paths */
+  twopath_cell_t *outTwoPathMatrix; /* n(n+1)/2 packed upper triangle of
+                                       symmetric matrix counting
+                                       out-two-paths */
+  twopath_hashtab_t mixTwoPathSpill; /* excess of mixTwoPathMatrix counts
+                                        over TWOPATH_CELL_MAX */
+  twopath_hashtab_t inTwoPathSpill;  /* same for inTwoPathMatrix */
+  twopath_hashtab_t outTwoPathSpill; /* same for outTwoPathMatrix */
+#endif /* TWOPATH_WITH_ARRAYS */
   
   /* node attributes */
   uint_t   num_binattr;   /* number of binary attributes */
   char   **binattr_names; /* binary attribute names */
-  int    **binattr;       /* binary attributes. For each binary attribute u,
-                             binattr[u][i] is the value for node i or BIN_NA 
-                             for missing data */
+  uint64_t **binattr;     /* binary attributes. For each binary attribute u,
+                             binattr[u] is bitset over nodes with bit i set
+                             iff the value for node i is 1 (so not set for
+                             missing data), see BINATTR_VALUE() */
+  uint64_t **binattr_na;  /* binattr_na[u] is bitset over nodes with bit i
+                             set iff attribute u of node i is BIN_NA */
   uint_t   num_catattr;   /* number of categorical attributes */
   char   **catattr_names; /* categorical attributes names */
-  int    **catattr;       /* categorical attribute. For each categorical
-                             attribute u, catattr[u][i] is value for node i  or
-                             CAT_NA for missing data */
+  void   **catattr;       /* categorical attribute. For each categorical
+                             attribute u, catattr[u] is array of unsigned
+                             codes of catattr_width[u] bytes, the code for
+                             node i being CATATTR_CODE_NA for missing data
+                             else the rank of its value (from 1) among the
+                             distinct values of u, see CATATTR_CODE() */
+  uint8_t *catattr_width; /* bytes per code in catattr[u] (1, 2 or 4) */
   uint_t   num_contattr;  /* number of continuous attributes */
   char   **contattr_names;/* continuous attributes names */
-  double **contattr;      /* continuous attribute. For each continuous
+  contattr_t **contattr;  /* continuous attribute. For each continuous
                              attribute u, contattr[u][i] is value for node i 
                              or IEEE NaN for missin data (test with isnan()) */
+  contattr_t **contattr_term; /* contattr[u][i] with NaN folded to 0,
+                                 the per-node term of the continuous
+                                 sender and receiver change statistics */
   uint_t        num_setattr;   /* number of set (of categorical) attributes */
   char       **setattr_names;  /* set attributes names */
   uint_t      *setattr_lengths;/* size of each set array cattr[u][i][] */
@@ -120,6 +803,53 @@ typedef struct digraph_s
                                   attribute u, catattr[u][i][j] is the
                                   present, absent, or NA value for
                                   element j of node i. */
+  uint64_t   ***setattr_bits;  /* packed set attribute. setattr_bits[u][i]
+                                  is bitset of SETATTR_WORDS(setattr_lengths[u])
+                                  words with bit j set iff element j of
+                                  set for node i is present */
+  uint64_t    **setattr_na;    /* setattr_na[u] is bitset over nodes with
+                                  bit i set iff attribute u of node i is NA */
+
+  /* dyadic covariates (values for ordered pairs of nodes, see
+     load_dyadic_covariates()), in compressed sparse row form: the pairs
+     (i, j) in the file are j = dyadcov_cols[k] for k from
+     dyadcov_rowstart[i] up to dyadcov_rowstart[i+1], in increasing
+     order of j, and the value of covariate u for the pair is
+     dyadcov_values[u][k] (0 for NA). All other pairs have value 0, see
+     get_dyadic_covariate(). These are part of the attributes (they are
+     in the shared attributes block and snapshot). */
+  uint_t        num_dyadcov;     /* number of dyadic covariates */
+  char        **dyadcov_names;   /* dyadic covariate names */
+  uint64_t      dyadcov_nnz;     /* number of pairs stored */
+  uint64_t     *dyadcov_rowstart;/* num_nodes+1 offsets in dyadcov_cols,
+                                    NULL if no dyadic covariates */
+  uint_t       *dyadcov_cols;    /* node j of each pair stored */
+  contattr_t  **dyadcov_values;  /* dyadcov_values[u][k] is value of
+                                    covariate u for k-th pair stored */
+  uint_t       *dyadcov_index;   /* for each dyadic covariate statistic of
+                                    the model, the covariate it is for
+                                    (DyadicCovariate only), set by
+                                    build_dyadic_indices_from_names() */
+  bool          shared_attributes; /* the attribute values (not names or
+                                      the arrays of pointers to them) are
+                                      in a block of memory shared with
+                                      other processes, not owned by g */
+  char        **attr_columns;  /* names of the binary, categorical,
+                                  continuous and set attribute columns
+                                  load_attributes() keeps (see
+                                  set_attribute_columns()), or NULL for
+                                  all of them */
+  uint_t        num_attr_columns; /* number of names in attr_columns */
+  void         *snapshot;      /* snapshot file mapped into memory that
+                                  the attributes are in (see
+                                  digraphSnapshot.h), unmapped by
+                                  free_digraph(), or NULL */
+  size_t        snapshot_size; /* size of the mapping */
+  bool          is_clone;      /* made by clone_digraph(), so the
+                                  attributes, coordinates, zones, pooled
+                                  networks and original node numbers
+                                  belong to the digraph it was cloned
+                                  from, not g */
 
   /* use for GeoDistance, need to mark continuous attributes for lat/long */
   uint_t latitude_index;  /* index in digraph contattr of latitude */
@@ -130,33 +860,145 @@ typedef struct digraph_s
   uint_t y_index;         /* index in digraph contattr of y coordinate */
   uint_t z_index;         /* index in digraph contattr of z coordinate */
 
+  /* per-node coordinates built from the above by build_dyadic_coords()
+     (NULL if not used). All coordinates are NaN for a node with any
+     of its attributes missing. */
+  point3_t *geo_coords;       /* lat/long as point on the unit sphere */
+  point3_t *euclidean_coords; /* x, y, z coordinates */
+
   /* snowball sampling information, only used for conditional estimation */
   uint_t *zone;        /* for each node, snowball sampling zone (0 for seeds) */
   uint_t max_zone;     /* highest zone number (zone number of outermost wave) */
   uint_t num_inner_nodes;/*number of nodes in inner waves (all but last zone)*/
   uint_t *inner_nodes; /* id of each of the num_inner_nodes inner wave nodes */
+                       /* (in zone order) */
+  uint_t *inner_zone_start; /* index in inner_nodes of first node of each
+                               inner zone, max_zone+1 entries (last is
+                               num_inner_nodes) */
+  uint64_t *zone_pair_cumcount; /* cumulative count of ordered node pairs
+                                   within zone z (entry 2z) and between
+                                   zone z and z+1 (entry 2z+1), for
+                                   sample_zone_pair(); 2*max_zone-1 entries */
   uint_t *prev_wave_degree; /* for each  node, number of edges 
                                to/from a node in earlier wave (node zone -1 ) */
-  uint_t num_inner_arcs;  /* number of arcs in inner waves, length of
+  arcidx_t num_inner_arcs; /* number of arcs in inner waves, length of
                              allinnerarcs list */
   nodepair_t *allinnerarcs; /* list of all inner wave arcs specified
                              * as i->j for each. */
+  arcindex_t allinnerarcs_index; /* position of each arc in allinnerarcs */
+  arcidx_t num_deletable_inner_arcs; /* number of arcs in allinnerarcs
+                                       that can be deleted, i.e. are not
+                                       the last tie of a node to the
+                                       preceding wave */
+  arcidx_t *deletable_inner_tree; /* Fenwick tree over the positions in
+                                     allinnerarcs counting those arcs, to
+                                     find the k-th of them, see
+                                     get_deletable_inner_arc() */
+  arcidx_t deletable_inner_tree_size; /* positions in deletable_inner_tree
+                                         (a power of two, at least
+                                         num_inner_arcs) */
+
+  /* networks pooled into one for estimation (see set_digraph_blocks()),
+     which can only have arcs within each network */
+  uint_t num_blocks;   /* number of networks, 0 if not pooled */
+  uint_t *block;       /* for each node, its network (NULL if not pooled) */
+  uint_t *block_nodes; /* nodes in network order */
+  uint_t *block_start; /* index in block_nodes of first node of each
+                          network, num_blocks+1 entries (last is
+                          num_nodes) */
+  uint64_t *block_pair_cumcount; /* cumulative count of ordered node pairs
+                                    within each network, for
+                                    sample_block_pair() */
 } digraph_t;
 
-#ifdef TWOPATH_LOOKUP
-#ifdef TWOPATH_HASHTABLES
+/*
+ * Bytes of memory used by the parts of a digraph (see
+ * digraph_memory_usage()), including allocated but unused capacity
+ * (empty hash table slots, the unused ends of adjacency list blocks and
+ * slabs, free records) but not the malloc() overhead of each block.
+ */
+typedef struct digraph_memory_s
+{
+  size_t adjacency;   /* degrees, arc lists and their slabs */
+  size_t hub_sets;    /* neighbour hash sets of hub nodes */
+  size_t arc_bitmatrix; /* n x n arc bit matrix */
+  size_t dyad_cache;  /* change statistics of each dyad */
+  size_t arc_lists;   /* allarcs, allinnerarcs and pending arcs, with the
+                         index tables of allarcs and allinnerarcs */
+  size_t attributes;  /* node attributes and their names (excluding
+                         values in shared memory or a snapshot mapping) */
+  size_t shared_attributes; /* attribute values shared with other
+                               processes or mapped from a snapshot file
+                               (not included in total) */
+  size_t nodes;       /* node ids, original numbers, coordinates,
+                         star values, zones */
+  size_t twopath_mix; /* mixed two-path table (and its spill table) */
+  size_t twopath_in;  /* in-two-path table (and its spill table) */
+  size_t twopath_out; /* out-two-path table (and its spill table) */
+  size_t twopath_free;/* allocated but unused two-path records (uthash) */
+  size_t twopath_hubs;/* two-path hub flags and lists (hybrid backend) */
+  size_t total;       /* sum of all the above except shared_attributes */
+} digraph_memory_t;
+
+#ifdef TWOPATH_ADAPTIVE
+/*
+ * Estimated memory of the two-path tables with each backend that
+ * stores them (see estimate_twopath_memory()).
+ */
+typedef struct twopath_memory_estimate_s
+{
+  double twopaths;    /* estimated number of nonzero two-path counts */
+  double arrays;      /* bytes of the dense arrays */
+  double hashtables;  /* bytes of the hash tables */
+  double pernode;     /* bytes of the per-node tables */
+} twopath_memory_estimate_t;
+#endif /* TWOPATH_ADAPTIVE */
+
+#ifdef TWOPATH_WITH_UTHASH
 uint_t get_twopath_entry(twopath_record_t *h, uint_t i, uint_t j);
-#endif /*TWOPATH_HASHTABLES */
-#else /* not using two-path lookup tables (either arrays or hashtables) */
+#endif /* TWOPATH_WITH_UTHASH */
+#ifdef TWOPATH_WITH_OATABLES
+uint_t get_twopath_entry(const twopath_hashtab_t *h, uint_t i, uint_t j);
+void prefetch_twopath_entry(const twopath_hashtab_t *h, uint_t i, uint_t j);
+#endif /* TWOPATH_WITH_OATABLES */
+#ifndef TWOPATH_LOOKUP /* counting on the fly (always possible if adaptive) */
 uint_t mixTwoPaths(const digraph_t *g, uint_t i, uint_t j);
 uint_t outTwoPaths(const digraph_t *g, uint_t i, uint_t j);
 uint_t inTwoPaths(const digraph_t *g, uint_t i, uint_t j);
 #endif /*TWOPATH_LOOKUP */
+#ifdef TWOPATH_CACHE
+uint_t cachedMixTwoPaths(const digraph_t *g, uint_t i, uint_t j);
+uint_t cachedOutTwoPaths(const digraph_t *g, uint_t i, uint_t j);
+uint_t cachedInTwoPaths(const digraph_t *g, uint_t i, uint_t j);
+void invalidate_twopath_cache(digraph_t *g);
+#endif /* TWOPATH_CACHE */
+#ifdef TWOPATH_ADAPTIVE
+void estimate_twopath_memory(const digraph_t *g, arcidx_t num_arcs,
+                             twopath_memory_estimate_t *est);
+twopath_backend_e choose_twopath_backend(const digraph_t *g, arcidx_t num_arcs,
+                                         uint_t max_memory_mb);
+uint_t choose_twopath_hub_cutoff(const digraph_t *g, uint_t max_memory_mb);
+void set_twopath_hub_cutoff(digraph_t *g, uint_t cutoff);
+void set_twopath_backend(digraph_t *g, twopath_backend_e backend);
+void set_twopath_tables(digraph_t *g, uint8_t tables);
+const char *twopath_backend_name(twopath_backend_e backend);
+twopath_backend_e twopath_backend_from_name(const char *name);
+uint_t get_twopath_nodetab_entry(const twopath_nodetab_t *t, uint_t j);
+void prefetch_twopath_nodetab_entry(const twopath_nodetab_t *t, uint_t j);
+uint_t hubMixTwoPaths(const digraph_t *g, uint_t i, uint_t j);
+uint_t hubOutTwoPaths(const digraph_t *g, uint_t i, uint_t j);
+uint_t hubInTwoPaths(const digraph_t *g, uint_t i, uint_t j);
+#endif /* TWOPATH_ADAPTIVE */
+void twopath_table_size(const digraph_t *g, double *bytes, double *entries);
+void digraph_memory_usage(const digraph_t *g, digraph_memory_t *mem);
+void print_memory_summary(const digraph_t *g);
   
 
 double density(const digraph_t *g); /* graph density of g */
 bool isArc(const digraph_t *g, uint_t i, uint_t j); /* test if arc i->j is in g */
 bool isArcIgnoreDirection(const digraph_t *g, uint_t i, uint_t j); /* test if arc i->j or j->i is in g */
+void prefetch_dyad_nodes(const digraph_t *g, uint_t i, uint_t j);
+void prefetch_dyad_lists(const digraph_t *g, uint_t i, uint_t j);
 
 /* these two version do not update the allarcs flat arclist */
 void insertArc(digraph_t *g, uint_t i, uint_t j); /* add arc i->j to g */
@@ -164,13 +1006,53 @@ void removeArc(digraph_t *g, uint_t i, uint_t j); /* delete arc i->j from g */
 
 /* this two versions update the allarcs flat arclist also */
 void insertArc_allarcs(digraph_t *g, uint_t i, uint_t j); /* add arc i->j to g */
-void removeArc_allarcs(digraph_t *g, uint_t i, uint_t j, uint_t arcidx); /* delete arc i->j from g */
+void removeArc_allarcs(digraph_t *g, uint_t i, uint_t j, arcidx_t arcidx); /* delete arc i->j from g */
 
 /* this two versions update the allinnerarcs flat arclist also */
 void insertArc_allinnerarcs(digraph_t *g, uint_t i, uint_t j); /* add arc i->j to g */
-void removeArc_allinnerarcs(digraph_t *g, uint_t i, uint_t j, uint_t arcidx); /* delete arc i->j from g */
+void removeArc_allinnerarcs(digraph_t *g, uint_t i, uint_t j, arcidx_t arcidx); /* delete arc i->j from g */
+
+/* position of arc i->j in allarcs or allinnerarcs, for removing any arc */
+arcidx_t get_allarcs_index(const digraph_t *g, uint_t i, uint_t j);
+arcidx_t get_allinnerarcs_index(const digraph_t *g, uint_t i, uint_t j);
+/* inner arcs that can be deleted in conditional estimation */
+arcidx_t get_deletable_inner_arc(const digraph_t *g, arcidx_t k);
+arcidx_t num_deletable_inner_arcs_after(const digraph_t *g, uint_t i, uint_t j,
+                                        bool isDelete);
+void build_digraph_arcs(digraph_t *g, const nodepair_t *arcs,
+                        arcidx_t num_arcs);
+void reserve_digraph_arcs(digraph_t *g, const nodepair_t *arcs,
+                          arcidx_t num_arcs);
+void apply_arc_batch(digraph_t *g, const nodepair_t adds[], arcidx_t num_adds,
+                     const nodepair_t dels[], arcidx_t num_dels, bool inner);
+void replace_digraph_arcs(digraph_t *g, const nodepair_t *arcs,
+                          arcidx_t num_arcs, bool inner);
+void begin_arc_journal(digraph_t *g);
+void journal_toggle_arc(digraph_t *g, uint_t i, uint_t j, bool isDelete,
+                        bool inner);
+void rollback_arc_journal(digraph_t *g);
+void commit_arc_journal(digraph_t *g);
 
 digraph_t *allocate_digraph(uint_t num_vertices);
+digraph_t *clone_digraph(const digraph_t *g);
+void set_hub_degree_threshold(digraph_t *g, uint_t threshold);
+void set_twopath_build_threads(digraph_t *g, uint_t num_threads);
+void set_twopath_update_threads(digraph_t *g, uint_t num_threads,
+                                uint_t min_degree);
+void set_arc_bitmatrix(digraph_t *g, bool useBitMatrix);
+void set_attribute_columns(digraph_t *g, uint_t num_columns,
+                           const char *const columns[]);
+void set_altstar_cache(digraph_t *g, double in_lambda, double out_lambda);
+size_t dyad_cache_bytes(uint_t num_nodes, uint_t num_stats);
+bool set_dyad_cache(digraph_t *g, uint_t num_stats, uint_t max_memory_mb);
+const double *dyad_cache_lookup(digraph_t *g, uint_t i, uint_t j);
+void dyad_cache_store(digraph_t *g, uint_t i, uint_t j,
+                      const double stats[]);
+void set_cat_pair_table(digraph_t *g, cat_pair_table_t *table);
+void free_cat_pair_table(cat_pair_table_t *table);
+node_order_e node_order_from_name(const char *name);
+const char *node_order_name(node_order_e order);
+void reorder_digraph_nodes(digraph_t *g, node_order_e order);
 void free_digraph(digraph_t *g);
 void dump_digraph_arclist(const digraph_t *g);
 void print_data_summary(const digraph_t *g);
@@ -178,19 +1060,58 @@ void print_zone_summary(const digraph_t *g);
 
 void write_digraph_arclist_to_file(FILE *fp, const digraph_t *g);
 
+void build_dyadic_coords(digraph_t *g, bool geo, bool euclidean);
+
 int add_snowball_zones_to_digraph(digraph_t *g, const char *zone_filename);
+int set_digraph_zones(digraph_t *g, const uint_t *zone);
 void dump_zone_info(const digraph_t *g);
+void sample_zone_pair(const digraph_t *g, prng_t *prng, uint_t *i, uint_t *j);
+int set_digraph_blocks(digraph_t *g, uint_t num_blocks,
+                       const uint_t *block_sizes);
+void sample_block_pair(const digraph_t *g, prng_t *prng, uint_t *i, uint_t *j);
+void sample_empty_dyad(const digraph_t *g, prng_t *prng,
+                       bool forbidReciprocity, uint_t *i, uint_t *j);
 
 int parse_category_set(char *str, bool firstpass, uint_t *size,
                        set_elem_e *setval);
+uint64_t *set_to_bitset(const set_elem_e *setval, uint_t size);
 
 int load_attributes(digraph_t *g, 
                     const char *binattr_filename,
                     const char *catattr_filename,
                     const char *contattr_filename,
-                    const char *setattr_filename);
+                    const char *setattr_filename,
+                    const char *dyadcov_filename);
+int load_dyadic_covariates(digraph_t *g, const char *dyadcov_filename);
+double get_dyadic_covariate(const digraph_t *g, uint_t u, uint_t i, uint_t j);
+int set_column_attributes(digraph_t *g,
+                          uint_t num_binattr,
+                          const char *const binattr_names[],
+                          const int *const binattr[],
+                          uint_t num_catattr,
+                          const char *const catattr_names[],
+                          const int *const catattr[],
+                          uint_t num_contattr,
+                          const char *const contattr_names[],
+                          const double *const contattr[]);
+typedef int load_attributes_func_t(digraph_t *g,
+                                   const char *binattr_filename,
+                                   const char *catattr_filename,
+                                   const char *contattr_filename,
+                                   const char *setattr_filename,
+                                   const char *dyadcov_filename);
+size_t digraph_attributes_block_size(digraph_t *g);
+void move_digraph_attributes(digraph_t *g, void *block);
+void copy_digraph_attributes(digraph_t *g, void *block);
+void attach_digraph_attributes(digraph_t *g, void *block);
 
 uint_t get_num_vertices_from_arclist_file(FILE *pajek_file);
 
+void nodeidmap_add(nodeidmap_t *map, uint64_t id);
+uint_t nodeidmap_get(const nodeidmap_t *map, uint64_t id);
+void number_node_ids(nodeidmap_t *map);
+void free_nodeidmap(nodeidmap_t *map);
+int write_node_ids(const digraph_t *g, const char *filename);
+
 #endif /* DIGRAPH_H */
 
@@ -0,0 +1,466 @@
+/*****************************************************************************
+ *
+ * File:    digraphPartition.c
+ * Author:  Alex Stivala, Maksym Byshkin
+ * Created: October 2026
+ *
+ * A network partitioned between the tasks of a distributed estimation,
+ * see digraphPartition.h.
+ *
+ * A remote node is fetched with two collective exchanges: the nodes
+ * needed, in order of their owners, then for each of them its out and
+ * in degrees followed by its out and in adjacency lists. Only the arcs
+ * to (or from) nodes that are not present are inserted, as the others
+ * are already in the local digraph, and the node is marked present
+ * straight after its arcs are inserted, so an arc between two nodes
+ * fetched together is inserted once.
+ *
+ ****************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "digraphPartition.h"
+
+/*****************************************************************************
+ *
+ * local functions
+ *
+ ****************************************************************************/
+
+/*
+ * Make sure a uint_t array can hold at least len values, growing it
+ * (by doubling) if not.
+ */
+static void reserve_uints(uint_t **array, uint_t *capacity, uint_t len)
+{
+  if (len > *capacity) {
+    *capacity = MAX(len, 2 * *capacity);
+    *array = (uint_t *)safe_realloc(*array, *capacity * sizeof(uint_t));
+  }
+}
+
+/*
+ * Task that owns node v, see partition_node_range().
+ */
+static uint_t node_owner(const digraph_partition_t *part, uint_t v)
+{
+  uint_t r = (uint_t)((uint64_t)v * part->comm->num_ranks / part->num_nodes);
+  uint_t first, end;
+
+  for (;;) {
+    partition_node_range(part->num_nodes, part->comm->num_ranks, r,
+                         &first, &end);
+    if (v < first)
+      r--;
+    else if (v >= end)
+      r++;
+    else
+      return r;
+  }
+}
+
+/*
+ * Toggle arc i -> j in the local digraph (and its flat arc list).
+ */
+static void toggle_local_arc(digraph_t *g, uint_t i, uint_t j,
+                             bool isDelete)
+{
+  if (isDelete)
+    removeArc_allarcs(g, i, j, get_allarcs_index(g, i, j));
+  else
+    insertArc_allarcs(g, i, j);
+}
+
+/*
+ * Remove all the remote nodes from the cache, with their arcs to (and
+ * from) nodes that are not present. The lists are scanned backwards as
+ * removing an arc only moves the entries after it.
+ */
+static void evict_cached_nodes(digraph_partition_t *part, digraph_t *g)
+{
+  uint_t c, k, v, w;
+
+  for (c = 0; c < part->num_cached; c++)
+    part->state[part->cached[c]] = PARTITION_NODE_ABSENT;
+  for (c = 0; c < part->num_cached; c++) {
+    v = part->cached[c];
+    for (k = g->outdegree[v]; k > 0; k--) {
+      w = g->arclist[v][k-1];
+      if (!PARTITION_NODE_PRESENT(part, w))
+        removeArc_allarcs(g, v, w, get_allarcs_index(g, v, w));
+    }
+    for (k = g->indegree[v]; k > 0; k--) {
+      w = g->revarclist[v][k-1];
+      if (!PARTITION_NODE_PRESENT(part, w))
+        removeArc_allarcs(g, w, v, get_allarcs_index(g, w, v));
+    }
+  }
+  part->num_cached = 0;
+}
+
+/*
+ * Insert the arcs of a remote node v, from the reply of its owner, into
+ * the local digraph, and add it to the cache.
+ *
+ * Parameters:
+ *   part  - partition
+ *   g     - local digraph
+ *   v     - fetched node
+ *   reply - out degree and in degree of v then its out and in lists
+ *
+ * Return value:
+ *   Number of values of reply used.
+ */
+static uint_t install_node(digraph_partition_t *part, digraph_t *g,
+                           uint_t v, const uint_t *reply)
+{
+  uint_t outdegree = reply[0], indegree = reply[1], k, w;
+  const uint_t *out = reply + 2, *in = reply + 2 + outdegree;
+
+  assert(part->state[v] == PARTITION_NODE_REQUESTED);
+  for (k = 0; k < outdegree; k++) {
+    w = out[k];
+    if (!PARTITION_NODE_PRESENT(part, w))
+      insertArc_allarcs(g, v, w);
+  }
+  for (k = 0; k < indegree; k++) {
+    w = in[k];
+    if (!PARTITION_NODE_PRESENT(part, w))
+      insertArc_allarcs(g, w, v);
+  }
+  part->state[v] = PARTITION_NODE_CACHED;
+  reserve_uints(&part->cached, &part->cached_capacity, part->num_cached + 1);
+  part->cached[part->num_cached++] = v;
+  part->num_fetched++;
+  return 2 + outdegree + indegree;
+}
+
+/*****************************************************************************
+ *
+ * externally visible functions
+ *
+ ****************************************************************************/
+
+/*
+ * Get the nodes owned by a task: the nodes are divided into num_ranks
+ * contiguous blocks of (as nearly as possible) equal size.
+ *
+ * Parameters:
+ *   num_nodes  - number of nodes in the network
+ *   num_ranks  - number of tasks
+ *   rank       - task
+ *   first_node - (Out) first node owned by the task
+ *   end_node   - (Out) one past the last node owned by the task
+ *
+ * Return value:
+ *   None.
+ */
+void partition_node_range(uint_t num_nodes, uint_t num_ranks, uint_t rank,
+                          uint_t *first_node, uint_t *end_node)
+{
+  *first_node = (uint_t)((uint64_t)num_nodes * rank / num_ranks);
+  *end_node = (uint_t)((uint64_t)num_nodes * (rank + 1) / num_ranks);
+}
+
+/*
+ * Allocate the partition of a network for this task. The local digraph
+ * must have exactly the arcs with at least one end owned by this task
+ * (see load_digraph_partition_arcs()).
+ *
+ * Parameters:
+ *   num_nodes  - number of nodes in the network
+ *   comm       - communication between the tasks (not copied so must
+ *                remain valid until the partition is freed)
+ *   max_cached - the cache is emptied when it has more than this many
+ *                remote nodes, or 0 for the number owned by a task
+ *
+ * Return value:
+ *   Pointer to new partition, free with free_digraph_partition().
+ */
+digraph_partition_t *allocate_digraph_partition(uint_t num_nodes,
+                                                const partition_comm_t *comm,
+                                                uint_t max_cached)
+{
+  digraph_partition_t *part = (digraph_partition_t *)
+    safe_calloc(1, sizeof(digraph_partition_t));
+
+  assert(comm->rank < comm->num_ranks);
+  part->comm = comm;
+  part->num_nodes = num_nodes;
+  partition_node_range(num_nodes, comm->num_ranks, comm->rank,
+                       &part->first_node, &part->end_node);
+  part->state = (uint8_t *)safe_calloc(num_nodes, sizeof(uint8_t));
+  memset(part->state + part->first_node, PARTITION_NODE_OWNED,
+         part->end_node - part->first_node);
+  part->max_cached = max_cached > 0 ? max_cached :
+    MAX(part->end_node - part->first_node, 1);
+  part->counts = (uint_t *)safe_calloc(comm->num_ranks, sizeof(uint_t));
+  part->recvcounts = (uint_t *)safe_calloc(comm->num_ranks, sizeof(uint_t));
+  return part;
+}
+
+/*
+ * Free a partition allocated with allocate_digraph_partition(),
+ * finishing the exchange of moves if one was started (so every task
+ * must call this).
+ *
+ * Parameters:
+ *   part - partition to free
+ *
+ * Return value:
+ *   None.
+ */
+void free_digraph_partition(digraph_partition_t *part)
+{
+  if (part->pending)
+    free(part->comm->finish_allgatherv(part->comm->data, part->pending,
+                                       part->recvcounts));
+  free(part->state);
+  free(part->cached);
+  free(part->moves);
+  free(part->sent_moves);
+  free(part->received);
+  free(part->counts);
+  free(part->recvcounts);
+  free(part->needed);
+  free(part);
+}
+
+/*
+ * Bring the local digraph up to date: wait for the moves of the other
+ * tasks sent by partition_start_exchange() and apply those that touch
+ * present nodes, then empty the cache if it has grown too large.
+ * The moves of all the tasks are then in part->received (none if no
+ * exchange was started since the last sync). Every task must call this.
+ *
+ * Parameters:
+ *   part - partition
+ *   g    - local digraph (modified)
+ *
+ * Return value:
+ *   None.
+ */
+void partition_sync(digraph_partition_t *part, digraph_t *g)
+{
+  const partition_comm_t *comm = part->comm;
+  uint_t *m, r, k;
+
+  free(part->received);
+  part->received = NULL;
+  part->num_received = part->own_begin = part->own_end = 0;
+  if (part->pending) {
+    part->received = comm->finish_allgatherv(comm->data, part->pending,
+                                             part->recvcounts);
+    part->pending = NULL;
+    m = part->received;
+    for (r = 0; r < comm->num_ranks; r++) {
+      assert(part->recvcounts[r] % 3 == 0);
+      if (r == comm->rank) {
+        part->own_begin = part->num_received;
+        part->own_end = part->num_received + part->recvcounts[r];
+      } else {
+        for (k = 0; k < part->recvcounts[r]; k += 3) {
+          if (partition_apply_move(part, g, m[k], m[k+1], m[k+2]))
+            part->num_remote_moves++;
+        }
+      }
+      m += part->recvcounts[r];
+      part->num_received += part->recvcounts[r];
+    }
+  }
+  if (part->num_cached > part->max_cached)
+    evict_cached_nodes(part, g);
+}
+
+/*
+ * Add a node to those to fetch with the next partition_fetch(), if it
+ * is not already present (or to be fetched).
+ *
+ * Parameters:
+ *   part - partition
+ *   v    - node needed
+ *
+ * Return value:
+ *   None.
+ */
+void partition_need_node(digraph_partition_t *part, uint_t v)
+{
+  if (part->state[v] == PARTITION_NODE_ABSENT) {
+    part->state[v] = PARTITION_NODE_REQUESTED;
+    reserve_uints(&part->needed, &part->needed_capacity,
+                  part->num_needed + 1);
+    part->needed[part->num_needed++] = v;
+  }
+}
+
+/*
+ * Fetch the nodes added with partition_need_node() from their owners,
+ * and answer the requests of the other tasks for the nodes of this
+ * one. Every task must call this (with or without nodes to fetch).
+ * The fetched nodes are present, with all their arcs, until the cache
+ * is next emptied by partition_sync().
+ *
+ * Parameters:
+ *   part - partition
+ *   g    - local digraph (modified)
+ *
+ * Return value:
+ *   None.
+ */
+void partition_fetch(digraph_partition_t *part, digraph_t *g)
+{
+  const partition_comm_t *comm = part->comm;
+  uint_t  P = comm->num_ranks;
+  uint_t *requests, *asked, *replies, *reply, *pos;
+  uint_t  r, k, a, v, len, num_asked = 0;
+  size_t  reply_len = 0;
+
+  /* the nodes needed in order of their owners */
+  for (r = 0; r < P; r++)
+    part->counts[r] = 0;
+  for (k = 0; k < part->num_needed; k++)
+    part->counts[node_owner(part, part->needed[k])]++;
+  pos = (uint_t *)safe_malloc(P * sizeof(uint_t));
+  for (r = 0, len = 0; r < P; r++) {
+    pos[r] = len;
+    len += part->counts[r];
+  }
+  requests = (uint_t *)safe_malloc(MAX(part->num_needed, 1) *
+                                   sizeof(uint_t));
+  for (k = 0; k < part->num_needed; k++) {
+    v = part->needed[k];
+    requests[pos[node_owner(part, v)]++] = v;
+  }
+  asked = comm->alltoallv(comm->data, requests, part->counts,
+                          part->recvcounts);
+
+  /* the lists of the nodes of this task asked for, in the same order */
+  for (r = 0; r < P; r++) {
+    part->counts[r] = 0;
+    for (k = 0; k < part->recvcounts[r]; k++) {
+      v = asked[num_asked + k];
+      assert(part->state[v] == PARTITION_NODE_OWNED);
+      part->counts[r] += 2 + g->outdegree[v] + g->indegree[v];
+    }
+    num_asked += part->recvcounts[r];
+    reply_len += part->counts[r];
+  }
+  reply = (uint_t *)safe_malloc(MAX(reply_len, 1) * sizeof(uint_t));
+  for (k = 0, len = 0; k < num_asked; k++) {
+    v = asked[k];
+    reply[len++] = g->outdegree[v];
+    reply[len++] = g->indegree[v];
+    for (a = 0; a < g->outdegree[v]; a++)
+      reply[len++] = g->arclist[v][a];
+    for (a = 0; a < g->indegree[v]; a++)
+      reply[len++] = g->revarclist[v][a];
+  }
+  replies = comm->alltoallv(comm->data, reply, part->counts,
+                            part->recvcounts);
+
+  /* the replies to this task are in the order of its requests */
+  for (k = 0, len = 0; k < part->num_needed; k++)
+    len += install_node(part, g, requests[k], replies + len);
+  part->num_needed = 0;
+  free(pos);
+  free(requests);
+  free(asked);
+  free(reply);
+  free(replies);
+}
+
+/*
+ * Toggle arc i -> j, where i is owned by this task, in the local
+ * digraph, and record the move to send to the other tasks with the
+ * next partition_start_exchange().
+ *
+ * Parameters:
+ *   part     - partition
+ *   g        - local digraph (modified)
+ *   i        - node arc is from (owned by this task)
+ *   j        - node arc is to
+ *   isDelete - TRUE to remove the arc, FALSE to insert it
+ *
+ * Return value:
+ *   None.
+ */
+void partition_toggle_arc(digraph_partition_t *part, digraph_t *g,
+                          uint_t i, uint_t j, bool isDelete)
+{
+  assert(part->state[i] == PARTITION_NODE_OWNED);
+  toggle_local_arc(g, i, j, isDelete);
+  reserve_uints(&part->moves, &part->moves_capacity, part->num_moves + 3);
+  part->moves[part->num_moves++] = i;
+  part->moves[part->num_moves++] = j;
+  part->moves[part->num_moves++] = isDelete;
+}
+
+/*
+ * Start sending the moves recorded since the last exchange to the other
+ * tasks, without waiting for them to arrive; they are applied by the
+ * next partition_sync(). Every task must call this.
+ *
+ * Parameters:
+ *   part - partition
+ *
+ * Return value:
+ *   None.
+ */
+void partition_start_exchange(digraph_partition_t *part)
+{
+  uint_t *moves = part->moves, capacity = part->moves_capacity;
+
+  assert(!part->pending);
+  /* the moves being sent are kept until the exchange is finished, and
+     the next moves recorded in the other buffer */
+  part->moves = part->sent_moves;
+  part->moves_capacity = part->sent_capacity;
+  part->sent_moves = moves;
+  part->sent_capacity = capacity;
+  part->pending = part->comm->start_allgatherv(part->comm->data,
+                                               part->sent_moves,
+                                               part->num_moves);
+  part->num_moves = 0;
+}
+
+/*
+ * Toggle an arc in the local digraph if it has a present end, e.g. to
+ * apply (or undo) a move of another task, without recording it as a
+ * move of this task.
+ *
+ * Parameters:
+ *   part     - partition
+ *   g        - local digraph (modified)
+ *   i, j     - toggle arc i->j
+ *   isDelete - if true the arc is removed, otherwise inserted
+ *
+ * Return value:
+ *   True if the arc was toggled, false if it is not in the local digraph.
+ */
+bool partition_apply_move(const digraph_partition_t *part, digraph_t *g,
+                          uint_t i, uint_t j, bool isDelete)
+{
+  if (!PARTITION_NODE_PRESENT(part, i) && !PARTITION_NODE_PRESENT(part, j))
+    return FALSE;
+  toggle_local_arc(g, i, j, isDelete);
+  return TRUE;
+}
+
+/*
+ * Replace each of n values with its sum over all the tasks. Every task
+ * must call this.
+ *
+ * Parameters:
+ *   part   - partition
+ *   values - (in/out) n values
+ *   n      - number of values
+ *
+ * Return value:
+ *   None.
+ */
+void partition_allreduce_sum(const digraph_partition_t *part,
+                             double values[], uint_t n)
+{
+  part->comm->allreduce_sum(part->comm->data, values, n);
+}
@@ -0,0 +1,136 @@
+#ifndef DIGRAPHPARTITION_H
+#define DIGRAPHPARTITION_H
+/*****************************************************************************
+ *
+ * File:    digraphPartition.h
+ * Author:  Alex Stivala, Maksym Byshkin
+ * Created: October 2026
+ *
+ * A network partitioned between the tasks of a distributed estimation
+ * (EstimNetDirected_mpi with partitionGraph), so that one chain runs on
+ * a network too large for the memory of one node.
+ *
+ * The nodes are divided into contiguous blocks, one owned by each
+ * task. A task always has every arc of its own nodes, and also has
+ * remote nodes it has fetched from their owners (the cache), with all
+ * their arcs too. These are the present nodes. The local digraph of a
+ * task has exactly the arcs with at least one present end, kept with
+ * insertArc_allarcs() and removeArc_allarcs() like any other, so the
+ * degrees and adjacency lists of present nodes, and the two-path
+ * counts between pairs of present nodes, are those of the whole
+ * network. Every other table (hub sets, bit matrix, alternating star
+ * cache) is likewise consistent for the present nodes.
+ *
+ * Remote nodes are fetched in batches: each task sends the nodes it
+ * needs to their owners and gets back their adjacency lists in one
+ * collective exchange. The cache is emptied when it has more than
+ * max_cached nodes (at the start of a sampler call, when no proposal is
+ * using it).
+ *
+ * Each arc is only ever toggled by the task that owns its source node,
+ * which records the move. The moves of all the tasks are sent to each
+ * other without waiting for them to arrive (start_exchange), and each
+ * task applies the moves of the others that touch its present nodes
+ * when it next needs the network (partition_sync()). Until then, the
+ * arcs of the remote nodes it has are as they were at the last sync.
+ * The moves of the last exchange, of all the tasks in rank order, are
+ * kept until the next one (received), so that a task can replay them
+ * in that order (partition_apply_move()) to find what its own moves
+ * did given those of the others.
+ *
+ * The communication is through callbacks (partition_comm_t) so that
+ * this module (and the estimation code using it) does not depend on
+ * MPI; EstimNetDirectedMPImain.c provides them.
+ *
+ ****************************************************************************/
+
+#include "utils.h"
+#include "digraph.h"
+
+/*
+ * Collective communication between the tasks of a partitioned network.
+ * Every task must call each function in the same order. Messages are
+ * arrays of uint_t. Buffers returned are allocated with malloc and
+ * freed by the caller.
+ */
+typedef struct partition_comm_s {
+  uint_t rank;          /* this task, 0..num_ranks-1 */
+  uint_t num_ranks;     /* number of tasks */
+  /* send sendcounts[r] values to each task r (in rank order in
+     sendbuf), returning those received, recvcounts[r] from task r in
+     rank order */
+  uint_t *(*alltoallv)(void *data, const uint_t *sendbuf,
+                       const uint_t sendcounts[], uint_t recvcounts[]);
+  /* start sending sendcount values (sendbuf must not be changed until
+     finished) to every task, returning a request for finish_allgatherv */
+  void   *(*start_allgatherv)(void *data, const uint_t *sendbuf,
+                              uint_t sendcount);
+  /* wait for a request from start_allgatherv, returning the values of
+     every task (including this one), recvcounts[r] from task r in rank
+     order */
+  uint_t *(*finish_allgatherv)(void *data, void *request,
+                               uint_t recvcounts[]);
+  /* replace each of the n values with their sum over all tasks,
+     exactly the same in every task */
+  void    (*allreduce_sum)(void *data, double values[], uint_t n);
+  void   *data;         /* passed to each function */
+} partition_comm_t;
+
+typedef struct digraph_partition_s {
+  const partition_comm_t *comm;
+  uint_t    num_nodes;   /* nodes in the whole network */
+  uint_t    first_node;  /* nodes owned by this task are */
+  uint_t    end_node;    /*   first_node..end_node-1 */
+  uint8_t  *state;       /* for each node, PARTITION_NODE_ABSENT etc. */
+  uint_t    max_cached;  /* cache is emptied when it has more nodes */
+  uint_t    num_cached;  /* remote nodes in cache */
+  uint_t   *cached;      /* the num_cached remote nodes */
+  uint_t    cached_capacity; /* allocated length of cached */
+  uint_t   *moves;       /* arc toggles since the last exchange started,
+                            3 values (i, j, isDelete) each */
+  uint_t    num_moves;   /* number of values (3 per move) in moves */
+  uint_t    moves_capacity; /* allocated length of moves */
+  uint_t   *sent_moves;  /* moves being exchanged (not to be changed) */
+  uint_t    sent_capacity; /* allocated length of sent_moves */
+  void     *pending;     /* request of exchange started, or NULL */
+  uint_t   *received;    /* moves of all tasks in the last exchange */
+  uint_t    num_received; /* number of values (3 per move) in received */
+  uint_t    own_begin;   /* moves of this task are received[own_begin] */
+  uint_t    own_end;     /*   to received[own_end-1] */
+  uint_t   *counts;      /* num_ranks scratch message counts */
+  uint_t   *recvcounts;  /* num_ranks scratch message counts */
+  uint_t   *needed;      /* nodes to fetch being collected */
+  uint_t    num_needed;  /* length of needed */
+  uint_t    needed_capacity; /* allocated length of needed */
+  double    num_fetched; /* remote nodes fetched so far */
+  double    num_remote_moves; /* moves of other tasks applied so far */
+} digraph_partition_t;
+
+/* values of state[] */
+#define PARTITION_NODE_ABSENT    0 /* remote node not in this task */
+#define PARTITION_NODE_OWNED     1 /* node of this task */
+#define PARTITION_NODE_CACHED    2 /* remote node fetched from its owner */
+#define PARTITION_NODE_REQUESTED 3 /* remote node being fetched */
+
+#define PARTITION_NODE_PRESENT(part, v) \
+  ((part)->state[v] == PARTITION_NODE_OWNED || \
+   (part)->state[v] == PARTITION_NODE_CACHED)
+
+void partition_node_range(uint_t num_nodes, uint_t num_ranks, uint_t rank,
+                          uint_t *first_node, uint_t *end_node);
+digraph_partition_t *allocate_digraph_partition(uint_t num_nodes,
+                                                const partition_comm_t *comm,
+                                                uint_t max_cached);
+void free_digraph_partition(digraph_partition_t *part);
+void partition_sync(digraph_partition_t *part, digraph_t *g);
+void partition_need_node(digraph_partition_t *part, uint_t v);
+void partition_fetch(digraph_partition_t *part, digraph_t *g);
+void partition_toggle_arc(digraph_partition_t *part, digraph_t *g,
+                          uint_t i, uint_t j, bool isDelete);
+void partition_start_exchange(digraph_partition_t *part);
+bool partition_apply_move(const digraph_partition_t *part, digraph_t *g,
+                          uint_t i, uint_t j, bool isDelete);
+void partition_allreduce_sum(const digraph_partition_t *part,
+                             double values[], uint_t n);
+
+#endif /* DIGRAPHPARTITION_H */
@@ -0,0 +1,474 @@
+/*****************************************************************************
+ *
+ * File:    digraphSnapshot.c
+ * Author:  Alex Stivala, Maksym Byshkin
+ * Created: October 2026
+ *
+ * Binary snapshot of a digraph, loaded by mapping it into memory
+ * (see digraphSnapshot.h).
+ *
+ * The file is a header followed by sections, each starting at an
+ * offset (from the start of the file) that is a multiple of 8 bytes:
+ *
+ *   arcs     - num_arcs nodepair_t (with nodeid_size byte node ids,
+ *              so snapshots of NODEID16 builds differ), in the order
+ *              write_digraph_arclist_to_file() writes them
+ *   attr     - node attributes block (see move_digraph_attributes())
+ *   zone     - num_nodes uint_t snowball sampling zones (if any)
+ *   twopath  - mix, in and out two-path open addressing hash tables
+ *              (if written): the capacity and count of each, then for
+ *              each its keys and values arrays as in twopath_hashtab_t
+ *
+ ****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include "digraphSnapshot.h"
+#include "largeAlloc.h"
+
+/*****************************************************************************
+ *
+ * constants and types
+ *
+ ****************************************************************************/
+
+#define SNAPSHOT_MAGIC       "ENDGSNAP" /* first 8 bytes of file (no NUL) */
+#define SNAPSHOT_VERSION     4          /* increment when format changes */
+#define SNAPSHOT_BYTE_ORDER  0x01020304U /* reads differently if swapped */
+#define SNAPSHOT_ALIGN(bytes) (((bytes) + 7) & ~(uint64_t)7)
+#define SNAPSHOT_NUM_TWOPATH 3          /* mix, in and out tables */
+
+typedef struct snapshot_header_s
+{
+  char     magic[8];       /* SNAPSHOT_MAGIC */
+  uint32_t version;        /* SNAPSHOT_VERSION */
+  uint32_t byte_order;     /* SNAPSHOT_BYTE_ORDER */
+  uint64_t num_nodes;      /* number of nodes */
+  uint64_t num_arcs;       /* number of arcs */
+  uint64_t arcs_offset;    /* offset of arcs */
+  uint64_t attr_offset;    /* offset of node attributes block */
+  uint64_t attr_size;      /* size of node attributes block */
+  uint64_t contattr_size;  /* bytes in each continuous attribute value */
+  uint64_t zone_offset;    /* offset of zones, or 0 if none */
+  uint64_t twopath_offset; /* offset of two-path tables, or 0 if none */
+  uint64_t file_size;      /* size of whole file */
+  uint64_t nodeid_size;    /* bytes in each node id (nodeid_t) */
+} snapshot_header_t;
+
+typedef struct snapshot_twopath_s /* each two-path table in twopath section */
+{
+  uint64_t capacity;       /* number of slots (power of two, or 0) */
+  uint64_t count;          /* number of slots in use */
+} snapshot_twopath_t;
+
+/*****************************************************************************
+ *
+ * local functions
+ *
+ ****************************************************************************/
+
+/*
+ * Write a section of the snapshot, padded with zeros to a multiple of
+ * 8 bytes. Errors are found with ferror() afterwards.
+ */
+static void write_section(FILE *fp, const void *data, size_t bytes)
+{
+  static const char zeros[8] = {0};
+
+  if (bytes > 0)
+    fwrite(data, 1, bytes, fp);
+  fwrite(zeros, 1, SNAPSHOT_ALIGN(bytes) - bytes, fp);
+}
+
+/*
+ * Test if a section of bytes at offset is within a file of the given
+ * size and aligned.
+ */
+static bool section_ok(uint64_t offset, uint64_t bytes, uint64_t size)
+{
+  return offset % 8 == 0 && offset <= size && bytes <= size - offset;
+}
+
+/*
+ * Check the two-path tables section of a snapshot.
+ *
+ * Parameters:
+ *   map  - the mapped snapshot file
+ *   hdr  - its header, with twopath_offset nonzero
+ *
+ * Return value:
+ *   True if the section is valid else False.
+ */
+static bool twopath_section_ok(const char *map, const snapshot_header_t *hdr)
+{
+  const snapshot_twopath_t *tp;
+  uint64_t offset = hdr->twopath_offset + SNAPSHOT_NUM_TWOPATH * sizeof(*tp);
+  uint_t   k;
+
+  if (!section_ok(hdr->twopath_offset, SNAPSHOT_NUM_TWOPATH * sizeof(*tp),
+                  hdr->file_size))
+    return FALSE;
+  tp = (const snapshot_twopath_t *)(map + hdr->twopath_offset);
+  for (k = 0; k < SNAPSHOT_NUM_TWOPATH; k++) {
+    if ((tp[k].capacity & (tp[k].capacity - 1)) != 0 ||
+        tp[k].count > tp[k].capacity || tp[k].capacity > hdr->file_size)
+      return FALSE;
+    offset += tp[k].capacity * sizeof(twopath_key_t) +
+      SNAPSHOT_ALIGN(tp[k].capacity * sizeof(uint32_t));
+    if (offset > hdr->file_size)
+      return FALSE;
+  }
+  return TRUE;
+}
+
+/*****************************************************************************
+ *
+ * externally visible functions
+ *
+ ****************************************************************************/
+
+/*
+ * Write a snapshot of a digraph: its arcs, node attributes, snowball
+ * sampling zones (if set) and optionally its two-path tables.
+ *
+ * Only the open addressing hash tables chosen by the adaptive two-path
+ * lookup (TWOPATH_ADAPTIVE), with all the tables kept (see
+ * set_twopath_tables()), can be written; otherwise the two-path
+ * tables (if any) are built again when the snapshot is loaded.
+ *
+ * Parameters:
+ *   g        - digraph object (not changed), with the original node
+ *              numbering (not reorder_digraph_nodes())
+ *   filename - name of file to write
+ *   twopaths - if True write the two-path hash tables too (if in use)
+ *
+ * Return value:
+ *   0 if OK else nonzero on error (message printed to stderr).
+ */
+int write_digraph_snapshot(digraph_t *g, const char *filename,
+                           bool twopaths)
+{
+  FILE              *fp;
+  snapshot_header_t  hdr;
+  snapshot_twopath_t tp[SNAPSHOT_NUM_TWOPATH];
+  twopath_hashtab_t *tabs[SNAPSHOT_NUM_TWOPATH];
+  uint_t             num_tabs = 0;
+  nodepair_t        *arcs;
+  char              *attr_block;
+  uint64_t           offset;
+  uint_t             i, k;
+  arcidx_t           a = 0;
+  int                err;
+
+  if (g->orig_node) {
+    fprintf(stderr, "ERROR: cannot write snapshot of digraph with "
+            "renumbered nodes\n");
+    return -1;
+  }
+  memset(&hdr, 0, sizeof(hdr));
+  memcpy(hdr.magic, SNAPSHOT_MAGIC, sizeof(hdr.magic));
+  hdr.version = SNAPSHOT_VERSION;
+  hdr.byte_order = SNAPSHOT_BYTE_ORDER;
+  hdr.num_nodes = g->num_nodes;
+  hdr.num_arcs = g->num_arcs;
+  hdr.nodeid_size = sizeof(nodeid_t);
+  offset = SNAPSHOT_ALIGN(sizeof(hdr));
+  hdr.arcs_offset = offset;
+  offset += SNAPSHOT_ALIGN(hdr.num_arcs * sizeof(nodepair_t));
+  hdr.attr_offset = offset;
+  hdr.attr_size = digraph_attributes_block_size(g);
+  hdr.contattr_size = sizeof(contattr_t);
+  offset += SNAPSHOT_ALIGN(hdr.attr_size);
+  if (g->inner_zone_start) { /* zones were set */
+    hdr.zone_offset = offset;
+    offset += SNAPSHOT_ALIGN(hdr.num_nodes * sizeof(uint_t));
+  }
+#if defined(TWOPATH_ADAPTIVE) && defined(TWOPATH_WITH_OAHASH)
+  if (twopaths && g->twopath_backend == TWOPATH_BACKEND_HASHTABLES &&
+      g->twopath_tables == TWOPATH_TABLES_ALL) {
+    tabs[0] = &g->mixTwoPathHashTab;
+    tabs[1] = &g->inTwoPathHashTab;
+    tabs[2] = &g->outTwoPathHashTab;
+    num_tabs = SNAPSHOT_NUM_TWOPATH;
+    hdr.twopath_offset = offset;
+    offset += sizeof(tp);
+    for (k = 0; k < num_tabs; k++) {
+      tp[k].capacity = tabs[k]->capacity;
+      tp[k].count = tabs[k]->count;
+      offset += tp[k].capacity * sizeof(twopath_key_t) +
+        SNAPSHOT_ALIGN(tp[k].capacity * sizeof(uint32_t));
+    }
+  }
+#else
+  (void)twopaths;
+  (void)tabs;
+#endif /* TWOPATH_ADAPTIVE && TWOPATH_WITH_OAHASH */
+  hdr.file_size = offset;
+
+  if (!(fp = fopen(filename, "wb"))) {
+    fprintf(stderr, "ERROR: could not open file %s for writing (%s)\n",
+            filename, strerror(errno));
+    return -1;
+  }
+  write_section(fp, &hdr, sizeof(hdr));
+
+  arcs = (nodepair_t *)safe_malloc(g->num_arcs * sizeof(nodepair_t));
+  for (i = 0; i < g->num_nodes; i++) {
+    for (k = 0; k < g->outdegree[i]; k++) {
+      arcs[a].i = i;
+      arcs[a].j = g->arclist[i][k];
+      a++;
+    }
+  }
+  write_section(fp, arcs, hdr.num_arcs * sizeof(nodepair_t));
+  free(arcs);
+
+  /* zeroed so the alignment padding in it is written as zeros */
+  attr_block = (char *)safe_calloc(1, hdr.attr_size);
+  copy_digraph_attributes(g, attr_block);
+  write_section(fp, attr_block, hdr.attr_size);
+  free(attr_block);
+
+  if (hdr.zone_offset)
+    write_section(fp, g->zone, hdr.num_nodes * sizeof(uint_t));
+
+  if (num_tabs > 0) {
+    write_section(fp, tp, sizeof(tp));
+    for (k = 0; k < num_tabs; k++) {
+      write_section(fp, tabs[k]->keys,
+                    tp[k].capacity * sizeof(twopath_key_t));
+      write_section(fp, tabs[k]->values, tp[k].capacity * sizeof(uint32_t));
+    }
+  }
+
+  err = ferror(fp);
+  err |= fclose(fp) != 0;
+  if (err)
+    fprintf(stderr, "ERROR: writing file %s failed\n", filename);
+  return err;
+}
+
+/*
+ * Map a snapshot file into memory and allocate a digraph with its
+ * nodes and node attributes, which are used in place in the mapping.
+ * The arcs, zones and two-path tables are then loaded with
+ * load_digraph_snapshot_arcs() etc., after any settings (such as
+ * set_hub_degree_threshold()) that have to be made before the arcs
+ * are added. The mapping is unmapped by free_digraph().
+ *
+ * Only the attribute columns in columns (if given) are used (see
+ * set_attribute_columns()), so the pages of the others are not read.
+ *
+ * Parameters:
+ *   filename    - name of snapshot file written by write_digraph_snapshot()
+ *   num_columns - number of names in columns
+ *   columns     - names of the attribute columns to use, or NULL for all
+ *
+ * Return value:
+ *   Digraph with the attributes but no arcs, or NULL on error
+ *   (message printed to stderr).
+ */
+digraph_t *load_digraph_snapshot(const char *filename, uint_t num_columns,
+                                 const char *const columns[])
+{
+  int                      fd;
+  struct stat              st;
+  char                    *map;
+  const snapshot_header_t *hdr;
+  digraph_t               *g;
+
+  if ((fd = open(filename, O_RDONLY)) < 0 || fstat(fd, &st) != 0) {
+    fprintf(stderr, "ERROR: could not open file %s (%s)\n", filename,
+            strerror(errno));
+    return NULL;
+  }
+  if ((size_t)st.st_size < sizeof(snapshot_header_t)) {
+    fprintf(stderr, "ERROR: %s is not a digraph snapshot file\n", filename);
+    close(fd);
+    return NULL;
+  }
+  map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    fprintf(stderr, "ERROR: could not map file %s (%s)\n", filename,
+            strerror(errno));
+    return NULL;
+  }
+  hdr = (const snapshot_header_t *)map;
+  if (memcmp(hdr->magic, SNAPSHOT_MAGIC, sizeof(hdr->magic)) != 0) {
+    fprintf(stderr, "ERROR: %s is not a digraph snapshot file\n", filename);
+  } else if (hdr->version != SNAPSHOT_VERSION) {
+    fprintf(stderr, "ERROR: snapshot file %s is version %u but "
+            "version %u is required\n", filename, hdr->version,
+            SNAPSHOT_VERSION);
+  } else if (hdr->byte_order != SNAPSHOT_BYTE_ORDER) {
+    fprintf(stderr, "ERROR: snapshot file %s was written on a machine "
+            "with different byte order\n", filename);
+  } else if (hdr->contattr_size != sizeof(contattr_t)) {
+    fprintf(stderr, "ERROR: snapshot file %s has %u byte continuous "
+            "attributes but %u byte are required (CONTATTR_FLOAT)\n",
+            filename, (uint_t)hdr->contattr_size, (uint_t)sizeof(contattr_t));
+  } else if (hdr->nodeid_size != sizeof(nodeid_t)) {
+    fprintf(stderr, "ERROR: snapshot file %s has %u byte node ids "
+            "but %u byte are required (NODEID16)\n",
+            filename, (uint_t)hdr->nodeid_size, (uint_t)sizeof(nodeid_t));
+  } else if (hdr->file_size != (uint64_t)st.st_size ||
+             hdr->num_nodes > UINT_MAX || hdr->num_arcs > MAX_NUM_ARCS ||
+             !section_ok(hdr->arcs_offset,
+                         hdr->num_arcs * sizeof(nodepair_t), hdr->file_size) ||
+             !section_ok(hdr->attr_offset, hdr->attr_size, hdr->file_size) ||
+             (hdr->zone_offset &&
+              !section_ok(hdr->zone_offset, hdr->num_nodes * sizeof(uint_t),
+                          hdr->file_size)) ||
+             (hdr->twopath_offset && !twopath_section_ok(map, hdr)) ||
+             hdr->attr_size < sizeof(uint64_t) ||
+             *(const uint64_t *)(map + hdr->attr_offset) != hdr->num_nodes) {
+    /* the attributes block starts with its number of nodes */
+    fprintf(stderr, "ERROR: snapshot file %s is truncated or corrupt\n",
+            filename);
+  } else {
+    g = allocate_digraph((uint_t)hdr->num_nodes);
+    g->snapshot = map;
+    g->snapshot_size = (size_t)st.st_size;
+    set_attribute_columns(g, num_columns, columns);
+    attach_digraph_attributes(g, map + hdr->attr_offset);
+    return g;
+  }
+  munmap(map, (size_t)st.st_size);
+  return NULL;
+}
+
+/*
+ * Add the arcs of the snapshot that g was loaded from with
+ * load_digraph_snapshot() to g, building the two-path tables (if used)
+ * as for build_digraph_arcs().
+ *
+ * Parameters:
+ *   g - (in/out) digraph from load_digraph_snapshot() with no arcs
+ *
+ * Return value:
+ *   0 if OK else nonzero on error (message printed to stderr).
+ */
+int load_digraph_snapshot_arcs(digraph_t *g)
+{
+  const snapshot_header_t *hdr = (const snapshot_header_t *)g->snapshot;
+  const nodepair_t        *arcs;
+  arcidx_t                 a;
+
+  /* the mapping starts on a page boundary, and so the advice does */
+  (void)madvise(g->snapshot, hdr->arcs_offset +
+                hdr->num_arcs * sizeof(nodepair_t), MADV_SEQUENTIAL);
+  arcs = (const nodepair_t *)((const char *)g->snapshot + hdr->arcs_offset);
+  for (a = 0; a < hdr->num_arcs; a++) {
+    if (arcs[a].i >= g->num_nodes || arcs[a].j >= g->num_nodes) {
+      fprintf(stderr, "ERROR: snapshot arc %lu (%u -> %u) has node number "
+              "out of range\n", (unsigned long)a, arcs[a].i, arcs[a].j);
+      return -1;
+    }
+  }
+  build_digraph_arcs(g, arcs, (arcidx_t)hdr->num_arcs);
+  return 0;
+}
+
+/*
+ * Set the snowball sampling zones of g to those of the snapshot it was
+ * loaded from (if it has any, otherwise nothing is done), as
+ * add_snowball_zones_to_digraph() does from a zone file.
+ *
+ * Parameters:
+ *   g - (in/out) digraph from load_digraph_snapshot() with the arcs
+ *       added by load_digraph_snapshot_arcs()
+ *
+ * Return value:
+ *   0 if OK else nonzero on error (message printed to stderr).
+ */
+int load_digraph_snapshot_zones(digraph_t *g)
+{
+  const snapshot_header_t *hdr = (const snapshot_header_t *)g->snapshot;
+
+  if (!hdr->zone_offset)
+    return 0;
+  return set_digraph_zones(g, (const uint_t *)((const char *)g->snapshot +
+                                               hdr->zone_offset));
+}
+
+/*
+ * Test if the snapshot g was loaded from has snowball sampling zones.
+ *
+ * Parameters:
+ *   g - digraph from load_digraph_snapshot()
+ *
+ * Return value:
+ *   True if the snapshot has zones else False.
+ */
+bool digraph_snapshot_has_zones(const digraph_t *g)
+{
+  return ((const snapshot_header_t *)g->snapshot)->zone_offset != 0;
+}
+
+#ifdef TWOPATH_ADAPTIVE
+/*
+ * Set the two-path hash tables of g to those in the snapshot it was
+ * loaded from, if it has them, instead of building them with
+ * set_twopath_backend(g, TWOPATH_BACKEND_HASHTABLES). The tables are
+ * copied out of the mapping as the sampler changes them. Only the
+ * tables kept (see set_twopath_tables()) are loaded.
+ *
+ * Parameters:
+ *   g - (in/out) digraph from load_digraph_snapshot() with the arcs
+ *       added by load_digraph_snapshot_arcs()
+ *
+ * Return value:
+ *   True if the hash tables were loaded (and are now in use) else False
+ *   (the snapshot does not have them).
+ */
+bool load_digraph_snapshot_twopaths(digraph_t *g)
+{
+#ifdef TWOPATH_WITH_OAHASH
+  const snapshot_header_t  *hdr = (const snapshot_header_t *)g->snapshot;
+  const snapshot_twopath_t *tp;
+  twopath_hashtab_t        *tabs[SNAPSHOT_NUM_TWOPATH];
+  const uint8_t             kinds[SNAPSHOT_NUM_TWOPATH] =
+    {TWOPATH_TABLE_MIX, TWOPATH_TABLE_IN, TWOPATH_TABLE_OUT};
+  const char               *p;
+  uint_t                    k;
+
+  if (!hdr->twopath_offset)
+    return FALSE;
+  set_twopath_backend(g, TWOPATH_BACKEND_NONE);
+  tabs[0] = &g->mixTwoPathHashTab;
+  tabs[1] = &g->inTwoPathHashTab;
+  tabs[2] = &g->outTwoPathHashTab;
+  tp = (const snapshot_twopath_t *)((const char *)g->snapshot +
+                                    hdr->twopath_offset);
+  p = (const char *)(tp + SNAPSHOT_NUM_TWOPATH);
+  for (k = 0; k < SNAPSHOT_NUM_TWOPATH; k++) {
+    if ((g->twopath_tables & kinds[k]) && tp[k].capacity > 0) {
+      tabs[k]->capacity = (size_t)tp[k].capacity;
+      tabs[k]->count = (size_t)tp[k].count;
+      tabs[k]->keys = (twopath_key_t *)large_calloc(tp[k].capacity,
+                                                    sizeof(twopath_key_t));
+      memcpy(tabs[k]->keys, p, tp[k].capacity * sizeof(twopath_key_t));
+      tabs[k]->values = (uint32_t *)large_calloc(tp[k].capacity,
+                                                 sizeof(uint32_t));
+      memcpy(tabs[k]->values, p + tp[k].capacity * sizeof(twopath_key_t),
+             tp[k].capacity * sizeof(uint32_t));
+    }
+    p += tp[k].capacity * sizeof(twopath_key_t) +
+      SNAPSHOT_ALIGN(tp[k].capacity * sizeof(uint32_t));
+  }
+  g->twopath_backend = TWOPATH_BACKEND_HASHTABLES;
+  return TRUE;
+#else
+  (void)g;
+  return FALSE;
+#endif /* TWOPATH_WITH_OAHASH */
+}
+#endif /* TWOPATH_ADAPTIVE */
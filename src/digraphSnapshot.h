@@ -0,0 +1,37 @@
+#ifndef DIGRAPHSNAPSHOT_H
+#define DIGRAPHSNAPSHOT_H
+/*****************************************************************************
+ *
+ * File:    digraphSnapshot.h
+ * Author:  Alex Stivala, Maksym Byshkin
+ * Created: October 2026
+ *
+ * Binary snapshot of a digraph: its arcs, node attributes (including
+ * any dyadic covariates), snowball sampling zones and (optionally)
+ * two-path hash tables in one file,
+ * which is mapped into memory to load it rather than parsing the
+ * text arc list and attribute files. The node attributes are used in
+ * place in the mapping (as a shared attributes block, see
+ * move_digraph_attributes()), so processes on the same machine loading
+ * the same snapshot share one copy of them in the page cache; the arcs
+ * and two-path tables, which the sampler changes, are copied out of it.
+ *
+ * The file is native byte order and is not portable between machines
+ * of different byte order (this is checked when it is loaded).
+ *
+ ****************************************************************************/
+
+#include "digraph.h"
+
+int write_digraph_snapshot(digraph_t *g, const char *filename,
+                           bool twopaths);
+digraph_t *load_digraph_snapshot(const char *filename, uint_t num_columns,
+                                 const char *const columns[]);
+int load_digraph_snapshot_arcs(digraph_t *g);
+int load_digraph_snapshot_zones(digraph_t *g);
+bool digraph_snapshot_has_zones(const digraph_t *g);
+#ifdef TWOPATH_ADAPTIVE
+bool load_digraph_snapshot_twopaths(digraph_t *g);
+#endif /* TWOPATH_ADAPTIVE */
+
+#endif /* DIGRAPHSNAPSHOT_H */
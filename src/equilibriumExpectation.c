@@ -37,6 +37,7 @@
  *
  *    TWOPATH_LOOKUP      - use two-path lookup tables (arrays by default)
  *    TWOPATH_HASHTABLES  - use hash tables (only if TWOPATH_LOOKUP defined)
+ *    TWOPATH_ADAPTIVE    - choose two-path lookup method at run time
  *
  *
  ****************************************************************************/
@@ -48,20 +49,673 @@
 #include <math.h>
 #include <assert.h>
 #include <limits.h>
+#include <pthread.h>
+#include <unistd.h>
 #include "utils.h"
 #include "digraph.h"
 #include "loadDigraph.h"
-#include "basicSampler.h"
+#include "digraphSnapshot.h"
 #include "ifdSampler.h"
-#include "tntSampler.h"
+#include "checkpoint.h"
+#include "seriesWriter.h"
+#include "changeStatsProfile.h"
+#include "largeAlloc.h"
+#include "postEstimation.h"
 #include "equilibriumExpectation.h"
 
+/*****************************************************************************
+ *
+ * local types and functions
+ *
+ ****************************************************************************/
+
+/*
+ * Arguments for a thread running the sampler on its share of the
+ * proposals of one step of Algorithm S. The model and graph are shared
+ * by all threads (the sampler does not modify the graph when moves are
+ * not performed), each thread has its own sampler, with its own random
+ * stream and workspace (which holds its output change statistics).
+ */
+typedef struct sampler_S_thread_s {
+  sampler_t *sampler;      /* sampler for this thread */
+  digraph_t *g;
+  double *theta;
+  uint_t  sampler_m;       /* number of proposals for this thread */
+  prng_t  thread_prng;     /* own stream of threads other than the caller */
+  double  acceptance_rate; /* (Out) acceptance rate of this thread's moves */
+} sampler_S_thread_t;
+
+/*
+ * Run the sampler (without performing moves) for the share
+ * of proposals in the sampler_S_thread_t that arg points to.
+ */
+static void *sampler_S_thread(void *arg)
+{
+  sampler_S_thread_t *s = (sampler_S_thread_t *)arg;
+
+  s->acceptance_rate = sampler_run(s->sampler, s->g, s->theta,
+                                   s->sampler->ws->addChangeStats,
+                                   s->sampler->ws->delChangeStats,
+                                   s->sampler_m, FALSE);
+  return NULL;
+}
+
+/*
+ * One step of Algorithm S with the sampler_m proposals divided between
+ * num_threads threads. Since moves are not performed the graph is not
+ * changed, so the threads can all sample from it at once. The calling
+ * thread does the first share with its own random stream, the others
+ * each use a stream of their own (numbered from first_stream). Each
+ * share has its own sampler and workspace, and the change statistics
+ * sums in them are then added up in thread order.
+ *
+ * Parameters:
+ *   g               - digraph object (not modified)
+ *   theta           - array of n parameter values
+ *   thread_samplers - array of num_threads samplers, one for each share
+ *                     (their random streams are set here)
+ *   num_threads     - number of threads (including the calling thread)
+ *   sampler_m       - total number of proposals
+ *   first_stream    - random stream number for the second thread, the rest
+ *                     use the following numbers
+ *   prng            - random stream of the calling thread (updated)
+ *   addChangeStats  - (Out) vector of n change stats for add moves
+ *   delChangeStats  - (Out) vector of n change stats for delete moves
+ *
+ * Return value:
+ *   Acceptance rate over all the proposals.
+ */
+static double parallel_sampler_S(digraph_t *g, double theta[],
+                                 sampler_t *thread_samplers[],
+                                 uint_t num_threads, uint_t sampler_m,
+                                 uint64_t first_stream, prng_t *prng,
+                                 double addChangeStats[],
+                                 double delChangeStats[])
+{
+  sampler_S_thread_t *args = (sampler_S_thread_t *)
+    safe_malloc(num_threads * sizeof(sampler_S_thread_t));
+  pthread_t *threads = (pthread_t *)safe_malloc(num_threads *
+                                                sizeof(pthread_t));
+  bool   *started = (bool *)safe_calloc(num_threads, sizeof(bool));
+  double  accepted = 0;
+  uint_t  n = thread_samplers[0]->model->n;
+  uint_t  k, l;
+
+  for (k = 0; k < num_threads; k++) {
+    args[k].sampler = thread_samplers[k];
+    args[k].g = g;
+    args[k].theta = theta;
+    args[k].sampler_m = sampler_m / num_threads +
+      (k < sampler_m % num_threads ? 1 : 0);
+    if (k == 0) {
+      args[k].sampler->prng = prng;
+    } else {
+      prng_init_stream(&args[k].thread_prng, first_stream + k - 1);
+      args[k].sampler->prng = &args[k].thread_prng;
+    }
+  }
+  for (k = 1; k < num_threads; k++) {
+    if (args[k].sampler_m == 0)
+      continue;
+    if (pthread_create(&threads[k], NULL, sampler_S_thread, &args[k]) == 0) {
+      started[k] = TRUE;
+    } else {
+      fprintf(stderr, "WARNING: could not create Algorithm S thread, "
+              "running in main thread\n");
+      args[k].sampler->prng = prng; /* continue the calling thread's stream */
+    }
+  }
+  for (k = 0; k < num_threads; k++) {
+    if (args[k].sampler_m > 0 && !started[k])
+      sampler_S_thread(&args[k]);
+  }
+  for (l = 0; l < n; l++)
+    addChangeStats[l] = delChangeStats[l] = 0;
+  for (k = 0; k < num_threads; k++) {
+    if (started[k])
+      pthread_join(threads[k], NULL);
+    if (args[k].sampler_m == 0)
+      continue;
+    for (l = 0; l < n; l++) {
+      addChangeStats[l] += args[k].sampler->ws->addChangeStats[l];
+      delChangeStats[l] += args[k].sampler->ws->delChangeStats[l];
+    }
+    accepted += args[k].acceptance_rate * args[k].sampler_m;
+  }
+  free(started);
+  free(threads);
+  free(args);
+  return accepted / sampler_m;
+}
+
+/*
+ * Estimate the lag-1 autocorrelation of a series (such as dzA in
+ * Algorithm EE, whose mean drifts as theta changes) after removing its
+ * least squares linear trend, which would otherwise make the series
+ * look highly autocorrelated however well the sampler mixes.
+ *
+ * Parameters:
+ *    values  - array of values of the series in order, overwritten
+ *              with the residuals from the linear trend
+ *    nvalues - length of values array (at least 2)
+ *    ess     - (Out) effective sample size of the series
+ *
+ * Return value:
+ *   Estimated lag-1 autocorrelation of the series.
+ */
+static double detrended_autocorrelation(double values[], uint_t nvalues,
+                                        double *ess)
+{
+  uint_t i;
+  double tmean = (nvalues - 1) / 2.0, vmean = 0, stt = 0, stv = 0, slope;
+
+  for (i = 0; i < nvalues; i++)
+    vmean += values[i];
+  vmean /= nvalues;
+  for (i = 0; i < nvalues; i++) {
+    stt += (i - tmean) * (i - tmean);
+    stv += (i - tmean) * (values[i] - vmean);
+  }
+  slope = stv / stt;
+  for (i = 0; i < nvalues; i++)
+    values[i] -= vmean + slope * (i - tmean);
+  return lag1_autocorrelation(values, nvalues, ess);
+}
+
+/*
+ * Arguments for a thread reading the arc list file into the pending arcs
+ * of the digraph (read_pending_arcs()) while the calling thread loads
+ * the node attributes into it (overlapLoad). The two write different
+ * fields of the digraph, but both may open compressed files at once,
+ * which open_input_file() and close_input_file() allow.
+ */
+typedef struct read_arcs_thread_s {
+  const char *filename;    /* Pajek format arc list file */
+  digraph_t  *g;
+  int         rc;          /* (Out) return value of read_pending_arcs() */
+} read_arcs_thread_t;
+
+/*
+ * Read the arc list for the read_arcs_thread_t that arg points to.
+ */
+static void *read_arcs_thread(void *arg)
+{
+  read_arcs_thread_t *r = (read_arcs_thread_t *)arg;
+
+  r->rc = read_pending_arcs(r->filename, r->g);
+  return NULL;
+}
+
+/*
+ * Compute the observed statistics of a network that is already loaded.
+ * If graph_stats() supports all the statistics in the model they are
+ * computed directly from the final graph (in parallel with
+ * numThreadsLoad threads). Otherwise they are computed the same way
+ * as load_digraph_from_arclist_file() does while loading it:
+ * the arcs are removed one at a time (last first), accumulating the
+ * change statistics for adding each one back to the graph without it,
+ * and then all put back in their original order, so g is the same
+ * as before (including the order of the arc lists) afterwards. The
+ * snowball sampling zones are set to all 0 meanwhile, so the previous
+ * wave degrees (which must stay above 0) are not changed.
+ *
+ * Parameters:
+ *   config     - configuration settings (with the attribute indices built)
+ *   g          - (in/out) digraph, unchanged on return
+ *   num_param  - number of parameters
+ *   graphStats - (in/out) statistics of the empty graph, to which those
+ *                of the network are added
+ *   theta      - parameter values (not used, see calcChangeStats())
+ *
+ * Return value:
+ *   None.
+ */
+static void compute_loaded_digraph_stats(const estim_config_t *config,
+                                         digraph_t *g, uint_t num_param,
+                                         double *graphStats, double *theta)
+{
+  const param_config_t *pc = &config->param_config;
+  double  *changestats;
+  arcidx_t num_arcs = g->num_arcs, k = num_arcs;
+  uint_t   l;
+  uint_t  *zone = g->zone;
+
+  /* graph_stats() gives the total including the empty graph values */
+  if (graph_stats(g, num_param, pc->num_attr_change_stats_funcs,
+                  pc->num_dyadic_change_stats_funcs,
+                  pc->num_attr_interaction_change_stats_funcs,
+                  pc->change_stats_funcs,
+                  pc->param_lambdas,
+                  pc->attr_change_stats_funcs,
+                  pc->dyadic_change_stats_funcs,
+                  pc->attr_interaction_change_stats_funcs,
+                  pc->attr_indices,
+                  pc->attr_interaction_pair_indices,
+                  graphStats) == 0)
+    return;
+  changestats = (double *)safe_malloc(num_param * sizeof(double));
+  g->zone = (uint_t *)safe_calloc(g->num_nodes, sizeof(uint_t));
+  while (k-- > 0) {
+    removeArc(g, g->allarcs[k].i, g->allarcs[k].j);
+    (void)calcChangeStats(g, g->allarcs[k].i, g->allarcs[k].j, num_param,
+                          pc->num_attr_change_stats_funcs,
+                          pc->num_dyadic_change_stats_funcs,
+                          pc->num_attr_interaction_change_stats_funcs,
+                          pc->change_stats_funcs,
+                          pc->param_lambdas,
+                          pc->attr_change_stats_funcs,
+                          pc->dyadic_change_stats_funcs,
+                          pc->attr_interaction_change_stats_funcs,
+                          pc->attr_indices,
+                          pc->attr_interaction_pair_indices,
+                          theta, FALSE, changestats);
+    for (l = 0; l < num_param; l++)
+      graphStats[l] += changestats[l];
+  }
+  /* removeArc() does not change allarcs, so it still has them all */
+  for (k = 0; k < num_arcs; k++)
+    insertArc(g, g->allarcs[k].i, g->allarcs[k].j);
+  free(g->zone);
+  g->zone = zone;
+  free(changestats);
+}
+
+/*
+ * Allocate the digraph for the network in the arclist file of the
+ * configuration (with no arcs yet) and load its node attributes,
+ * or map the snapshot file instead if there is one, or pool the
+ * networks in the network list file (see allocate_pooled_digraph()).
+ * Only the attribute columns the model refers to are loaded (see
+ * set_attribute_columns()), unless a snapshot is to be written, which
+ * keeps them all so it can be used for other models, or all_columns
+ * is set.
+ * With overlapLoad (and a Pajek format arclist file) the arcs are read
+ * by another thread while the attributes are loaded, to be added to
+ * the digraph by load_estimation_arcs().
+ *
+ * Parameters:
+ *   config     - configuration settings
+ *   load_attrs - function to load the node attributes into the digraph
+ *                (not used with a snapshot)
+ *   partitioned - if True only read the number of nodes from the arc
+ *                list file, as each task loads only its own part of
+ *                the arcs (see load_estimation_arcs())
+ *   all_columns - if True load all the attribute columns, not only
+ *                those the model refers to
+ *
+ * Return value:
+ *   Digraph with the node attributes but no arcs, or NULL on error
+ *   (message printed to stderr).
+ */
+static digraph_t *allocate_estimation_digraph(const estim_config_t *config,
+                                              load_attributes_func_t
+                                              *load_attrs, bool partitioned,
+                                              bool all_columns)
+{
+  arclist_format_e format = arclist_format_from_name(config->arclistFormat);
+  huge_pages_e     huge_pages = huge_pages_from_name(config->hugePages);
+  numa_policy_e    numa = numa_policy_from_name(config->numaPolicy);
+  pooled_attr_files_t attr_files;
+  digraph_t *g;
+  const char **columns = NULL;
+  uint_t     num_columns = 0;
+  int        rc = 0;
+  /* the number of nodes of an edge list comes from reading all of it */
+  bool       overlap = config->overlapLoad && !partitioned &&
+    format == ARCLIST_FORMAT_PAJEK && !config->snapshot_filename &&
+    !config->network_list_filename;
+  read_arcs_thread_t read_arcs;
+  pthread_t  read_arcs_tid;
+  bool       started = FALSE;
+
+  if (format == ARCLIST_FORMAT_INVALID) {
+    fprintf(stderr, "ERROR: unknown arclistFormat %s (must be pajek or "
+            "edgelist)\n", config->arclistFormat);
+    return NULL;
+  }
+  if (huge_pages == HUGE_PAGES_INVALID) {
+    fprintf(stderr, "ERROR: unknown hugePages %s (must be none, "
+            "transparent, or explicit)\n", config->hugePages);
+    return NULL;
+  }
+  if (numa == NUMA_POLICY_INVALID) {
+    fprintf(stderr, "ERROR: unknown numaPolicy %s (must be local or "
+            "interleave)\n", config->numaPolicy);
+    return NULL;
+  }
+  set_large_alloc_policy(huge_pages, numa);
+  if (config->node_id_filename && (format != ARCLIST_FORMAT_EDGELIST ||
+                                   config->snapshot_filename)) {
+    fprintf(stderr, "ERROR: nodeIdFile can only be used with an edge list "
+            "arclistFile\n");
+    return NULL;
+  }
+  if (config->snapshot_filename) {
+    if (config->arclist_filename || config->binattr_filename ||
+        config->catattr_filename || config->contattr_filename ||
+        config->setattr_filename || config->dyadcov_filename ||
+        config->zone_filename || config->network_list_filename) {
+      fprintf(stderr, "ERROR: arc list, attribute, dyadic covariate, zone "
+              "and network list files cannot be used with snapshotFile\n");
+      return NULL;
+    }
+    /* the attributes are used in place in the snapshot so cannot be
+       renumbered */
+    if (node_order_from_name(config->nodeOrder) != NODE_ORDER_NONE) {
+      fprintf(stderr, "ERROR: nodeOrder cannot be used with snapshotFile\n");
+      return NULL;
+    }
+    if (!config->write_snapshot_filename && !all_columns)
+      num_columns = get_model_attribute_names(&config->param_config,
+                                              &columns);
+    g = load_digraph_snapshot(config->snapshot_filename, num_columns,
+                              columns);
+    free(columns);
+    if (!g)
+      return NULL;
+  } else if (config->network_list_filename) {
+    if (config->arclist_filename || config->binattr_filename ||
+        config->catattr_filename || config->contattr_filename ||
+        config->setattr_filename) {
+      fprintf(stderr, "ERROR: arc list and attribute files cannot be used "
+              "with networkListFile (they are in the list file)\n");
+      return NULL;
+    }
+    if (config->dyadcov_filename) {
+      fprintf(stderr, "ERROR: dyadicCovariateFile cannot be used with "
+              "networkListFile\n");
+      return NULL;
+    }
+    if (format != ARCLIST_FORMAT_PAJEK || config->zone_filename ||
+        config->useConditionalEstimation || config->write_snapshot_filename ||
+        config->useIFDsampler || config->useTNTsampler) {
+      fprintf(stderr, "ERROR: networkListFile can only be used with Pajek "
+              "format arc lists, without zoneFile, "
+              "useConditionalEstimation, writeSnapshotFile, useIFDsampler "
+              "or useTNTsampler\n");
+      return NULL;
+    }
+    if (!(g = allocate_pooled_digraph(config->network_list_filename, TRUE,
+                                      &attr_files)))
+      return NULL;
+  } else {
+    /* with overlapLoad only the *vertices line is read here, the arcs
+       are read below while the attributes are loaded */
+    if (!(g = allocate_digraph_from_arclist_file(config->arclist_filename,
+                                                 format,
+                                                 !partitioned && !overlap)))
+      return NULL;
+  }
+  if (!config->snapshot_filename && !config->write_snapshot_filename &&
+      !all_columns) {
+    num_columns = get_model_attribute_names(&config->param_config, &columns);
+    set_attribute_columns(g, num_columns, columns);
+    free(columns);
+  }
+  set_hub_degree_threshold(g, config->hubDegreeThreshold);
+  set_arc_bitmatrix(g, config->useArcBitMatrix);
+  set_twopath_build_threads(g, config->numThreadsLoad);
+  set_twopath_update_threads(g, config->numThreadsHubUpdate,
+                             config->hubUpdateDegree);
+  if (overlap) {
+    read_arcs.filename = config->arclist_filename;
+    read_arcs.g = g;
+    read_arcs.rc = 0;
+    if (pthread_create(&read_arcs_tid, NULL, read_arcs_thread,
+                       &read_arcs) == 0)
+      started = TRUE;
+    else
+      fprintf(stderr, "WARNING: could not create arc list reading thread, "
+              "reading it after the attributes\n");
+  }
+  if (config->network_list_filename) {
+    rc = load_attrs(g, attr_files.binattr_filename,
+                    attr_files.catattr_filename,
+                    attr_files.contattr_filename,
+                    attr_files.setattr_filename, NULL);
+    remove_pooled_attr_files(&attr_files);
+  } else if (!config->snapshot_filename) {
+    rc = load_attrs(g, config->binattr_filename,
+                    config->catattr_filename,
+                    config->contattr_filename,
+                    config->setattr_filename,
+                    config->dyadcov_filename);
+  }
+  if (overlap) {
+    if (started)
+      pthread_join(read_arcs_tid, NULL);
+    else
+      read_arcs_thread(&read_arcs);
+  }
+  if (rc) {
+    fprintf(stderr, "ERROR: loading node attributes failed\n");
+    free_digraph(g);
+    return NULL;
+  }
+  if (overlap && read_arcs.rc) {
+    fprintf(stderr, "ERROR: reading arc list from %s failed\n",
+            config->arclist_filename);
+    free_digraph(g);
+    return NULL;
+  }
+  return g;
+}
+
+/*
+ * Load the arcs of the network in the arclist (or snapshot) file of the
+ * configuration into g (allocated by allocate_estimation_digraph()),
+ * optionally computing the observed statistics (directly from the
+ * loaded graph if graph_stats() supports them all, else as the arcs
+ * are added), then add the snowball sampling zones, write the snapshot
+ * and node id files and renumber the nodes as configured.
+ *
+ * Parameters:
+ *   config       - configuration settings (with the attribute indices
+ *                  built if computeStats is True)
+ *   g            - (in/out) digraph with no arcs
+ *   computeStats - if True compute the observed statistics in graphStats
+ *   num_param    - number of parameters
+ *   graphStats   - (in/out) if computeStats, statistics of the empty graph,
+ *                  to which those of the network are added
+ *   theta        - parameter values (not used, see
+ *                  load_digraph_from_arclist_mmap())
+ *   metrics      - (in/out) if not NULL, the loading (from the start of
+ *                  the current phase), two-path table building, zones,
+ *                  snapshot writing and renumbering are added as phases
+ *   writeFiles   - if True write writeSnapshotFile and nodeIdFile (if set)
+ *   partition    - if not NULL, only load the arcs of the nodes owned by
+ *                  this task of a partitioned network (see
+ *                  load_digraph_partition_arcs())
+ *   buildTwoPaths - if False do not build any two-path tables (whatever
+ *                   twoPathBackend is), e.g. to only estimate their size
+ *
+ * Return value:
+ *   0 if OK else -1 on error (message printed to stderr).
+ */
+static int load_estimation_arcs(const estim_config_t *config, digraph_t *g,
+                                bool computeStats, uint_t num_param,
+                                double *graphStats, double *theta,
+                                run_metrics_t *metrics, bool writeFiles,
+                                const digraph_partition_t *partition,
+                                bool buildTwoPaths)
+{
+  struct timeval start_timeval, end_timeval, elapsed_timeval;
+  int            etime;
+  node_order_e   node_order = node_order_from_name(config->nodeOrder);
+  const param_config_t *pc = &config->param_config;
+  const char    *zone_filename = config->zone_filename;
+  const char    *filename = config->snapshot_filename ?
+    config->snapshot_filename : config->network_list_filename ?
+    config->network_list_filename : config->arclist_filename;
+#ifdef TWOPATH_ADAPTIVE
+  twopath_backend_e backend = twopath_backend_from_name(config->twoPathBackend);
+#endif /* TWOPATH_ADAPTIVE */
+
+#ifdef TWOPATH_ADAPTIVE
+  if (backend == TWOPATH_BACKEND_INVALID) {
+    fprintf(stderr, "ERROR: unknown twoPathBackend %s (must be auto, arrays, "
+            "hashtables, hybrid, pernode, or none)\n", config->twoPathBackend);
+    return -1;
+  }
+  if (!buildTwoPaths)
+    backend = TWOPATH_BACKEND_NONE;
+  /* only keep the two-path tables the model's statistics look up */
+  set_twopath_tables(g, twopath_tables_used(pc->num_change_stats_funcs,
+                                            pc->change_stats_funcs));
+  /* dense arrays only depend on number of nodes so if they fit they
+     can be chosen now and built while loading (and computing statistics) */
+  if (backend == TWOPATH_BACKEND_ARRAYS ||
+      (backend == TWOPATH_BACKEND_AUTO &&
+       choose_twopath_backend(g, 0, config->maxMemoryMB) ==
+       TWOPATH_BACKEND_ARRAYS))
+    set_twopath_backend(g, TWOPATH_BACKEND_ARRAYS);
+#else
+  (void)buildTwoPaths; /* tables are fixed at compile time */
+#endif /* TWOPATH_ADAPTIVE */
+  gettimeofday(&start_timeval, NULL);
+#ifdef TWOPATH_LOOKUP
+  printf("loading arc list from %s and building two-path matrices",
+         filename);
+#else
+  printf("loading arc list from %s", filename);
+#endif /*TWOPATH_LOOKUP*/
+  if (computeStats)
+    printf(" and computing observed statistics");
+  printf("..\n");
+  if (partition) {
+    if (!load_digraph_partition_arcs(config->arclist_filename, g,
+                                     partition->first_node,
+                                     partition->end_node))
+      return -1;
+  } else if (config->snapshot_filename) {
+    if (load_digraph_snapshot_arcs(g))
+      return -1;
+    if (computeStats)
+      compute_loaded_digraph_stats(config, g, num_param, graphStats, theta);
+    if (digraph_snapshot_has_zones(g))
+      zone_filename = config->snapshot_filename;
+  } else if (computeStats &&
+             graph_stats_supported(num_param,
+                                   pc->num_attr_change_stats_funcs,
+                                   pc->num_dyadic_change_stats_funcs,
+                                   pc->num_attr_interaction_change_stats_funcs,
+                                   pc->change_stats_funcs,
+                                   pc->attr_change_stats_funcs,
+                                   pc->dyadic_change_stats_funcs,
+                                   pc->attr_interaction_change_stats_funcs)) {
+    /* build the graph all at once and compute the statistics from it
+       directly, rather than adding one arc at a time */
+    if (!load_digraph_from_arclist_mmap(config->arclist_filename, g,
+                                        FALSE, 0, 0, 0, 0, NULL, NULL, NULL,
+                                        NULL, NULL, NULL, NULL, NULL, NULL))
+      return -1;
+    compute_loaded_digraph_stats(config, g, num_param, graphStats, theta);
+  } else {
+    if (!load_digraph_from_arclist_mmap(config->arclist_filename, g,
+                                        computeStats,
+                                        num_param,
+                                        pc->num_attr_change_stats_funcs,
+                                        pc->num_dyadic_change_stats_funcs,
+                                        pc->num_attr_interaction_change_stats_funcs,
+                                        pc->change_stats_funcs,
+                                        pc->param_lambdas,
+                                        pc->attr_change_stats_funcs,
+                                        pc->dyadic_change_stats_funcs,
+                                        pc->attr_interaction_change_stats_funcs,
+                                        pc->attr_indices,
+                                        pc->attr_interaction_pair_indices,
+                                        graphStats, theta))
+      return -1;
+  }
+  gettimeofday(&end_timeval, NULL);
+  timeval_subtract(&elapsed_timeval, &end_timeval, &start_timeval);
+  etime = 1000 * elapsed_timeval.tv_sec + elapsed_timeval.tv_usec/1000;
+  printf("%.2f s\n", (double)etime/1000);
+  end_run_phase(metrics, "load", 0, 0);
+#ifdef DEBUG_DIGRAPH
+  dump_digraph_arclist(g);
+#endif /*DEBUG_DIGRAPH*/
+#ifdef TWOPATH_ADAPTIVE
+  if (backend == TWOPATH_BACKEND_AUTO)
+    backend = choose_twopath_backend(g, 0, config->maxMemoryMB);
+  if (backend == TWOPATH_BACKEND_HYBRID)
+    set_twopath_hub_cutoff(g, choose_twopath_hub_cutoff(g,
+                                                        config->maxMemoryMB));
+  /* use the hash tables in the snapshot rather than building them */
+  if (!(config->snapshot_filename && backend == TWOPATH_BACKEND_HASHTABLES &&
+        load_digraph_snapshot_twopaths(g)))
+    set_twopath_backend(g, backend);
+  printf("two-path lookup: %s\n", twopath_backend_name(g->twopath_backend));
+  if (g->twopath_backend != TWOPATH_BACKEND_NONE)
+    printf("two-path tables kept:%s%s%s\n",
+           g->twopath_tables & TWOPATH_TABLE_MIX ? " mix" : "",
+           g->twopath_tables & TWOPATH_TABLE_IN ? " in" : "",
+           g->twopath_tables & TWOPATH_TABLE_OUT ? " out" : "");
+  if (g->twopath_backend == TWOPATH_BACKEND_HYBRID)
+    printf("two-path hubs: nodes of degree over %u\n", g->twopath_hub_cutoff);
+  end_run_phase(metrics, "twopath_build", 0, 0);
+#endif /* TWOPATH_ADAPTIVE */
+  printf("change statistics kernels: %s\n", changestats_isa_name());
+
+  if (zone_filename) {
+    if (config->snapshot_filename ? load_digraph_snapshot_zones(g) :
+        add_snowball_zones_to_digraph(g, zone_filename)) {
+      fprintf(stderr, "ERROR: reading snowball sampling zones from %s failed\n",
+              zone_filename);
+      return -1;
+    }
+#ifdef DEBUG_SNOWBALL
+    dump_zone_info(g);
+#endif /* DEBUG_SNOWBALL */
+    end_run_phase(metrics, "zones", 0, 0);
+  }
+
+  if (writeFiles && config->node_id_filename) {
+    printf("writing node ids to %s\n", config->node_id_filename);
+    if (write_node_ids(g, config->node_id_filename))
+      return -1;
+  }
+
+  if (writeFiles && config->write_snapshot_filename) {
+    printf("writing network snapshot to %s\n",
+           config->write_snapshot_filename);
+    if (write_digraph_snapshot(g, config->write_snapshot_filename,
+                               config->snapshotTwoPaths))
+      return -1;
+    end_run_phase(metrics, "write_snapshot", 0, 0);
+  }
+
+  if (node_order == NODE_ORDER_ZONE && g->max_zone == 0) {
+    printf("(warning) nodeOrder zone has no effect without snowball "
+           "sampling zones\n");
+  } else if (node_order != NODE_ORDER_NONE) {
+    printf("renumbering nodes in %s order\n", node_order_name(node_order));
+    reorder_digraph_nodes(g, node_order);
+    end_run_phase(metrics, "reorder", 0, 0);
+  }
+  return 0;
+}
+
+
 /*****************************************************************************
  *
  * externally visible functions
  *
  ****************************************************************************/
 
+/*
+ * Name of the reason Algorithm EE stopped, for output.
+ */
+const char *ee_stop_reason_name(ee_stop_reason_e reason)
+{
+  switch (reason) {
+    case EE_STOP_MAX_STEPS:  return "maximum steps";
+    case EE_STOP_CONVERGED:  return "converged";
+    case EE_STOP_TIME_LIMIT: return "time limit";
+    case EE_STOP_CONVERGED_TASKS: return "converged across tasks";
+  }
+  return "unknown";
+}
 
 /*
  * Algorithm S for estimating parameters of digraph generated by ERGM,
@@ -69,75 +723,50 @@
  *
  * Parameters:
  *   g      - digraph object.
- *   n      - number of parameters (length of theta vector = total
- *            length of all change statistics functions)
- *   n_attr - number of attribute change stats funcs
- *   n_dyadic -number of dyadic covariate change stats funcs
- *   n_attr_interaction - number of attribute interaction change stats funcs
- *   change_stats_funcs - array of pointers to change statistics functions
- *                        length is n - n_attr - n_dyadic - n_attr_interacion
- *   attr_change_stats_funcs - array of pointers to change statistics functions
- *                             length is n_attr
- *   dyadic_change_stats_funcs - array of pointers to dyadic change stats funcs
- *                             length is n_dyadic
- *   attr_interaction_change_stats_funcs - array of pointers to attribute
- *                           interaction (pair) change statistics functions.
- *                           length is n_attr_interaction.
- *   attr_indices   - array of n_attr attribute indices (index into g->binattr
- *                    or g->catattr) corresponding to attr_change_stats_funcs
- *                    E.g. for Sender effect on the first binary attribute,
- *                    attr_indices[x] = 0 and attr_change_stats_funcs[x] =
- *                    changeSender
- *   attr_interaction_pair_indices - array of n_attr_interaction pairs
- *                          of attribute inidices similar to above but
- *                          for attr_interaction_change_setats_funcs which
- *                          requires pairs of indices.
+ *   sampler - sampler for the model (with n parameters) to estimate
  *   M1          - Number of iterations of Algorithm S
  *   sampler_m   - Number of proposals (sampling iterations) [per step of Alg.S]
  *   ACA         -  multiplier of da to get K1A step size multiplier 
- *   theta  - (Out) array of n parameter values corresponding to
- *                  change stats funcs. Allocated by caller.
+ *   theta  - (In/Out) array of n parameter values corresponding to
+ *                  change stats funcs, starting values on input (zero
+ *                  unless warm starting). Allocated by caller.
  *   Dmean - (Out) array of n derivative estimate values corresponding to theta.
  *                 Allocated by caller
- *   theta_outfile - open (write) file to write theta values to
- *   useIFDsampler - use IFD sampler instead of basic sampler
- *   ifd_K         - constant for multipliying IFD auxiliary parameter
- *                   (only used if useIFDsampler is True).
- *   useConditionalEstimation - do conditional estimation of snowball sample
- *   forbidReciprocity - if True do not allow reciprocated arcs.
- *   useTNTsampler     - use TNT sampler not IFD or basic.
+ *   theta_outfile - series writer to write theta values to
+ *   num_threads       - number of threads to divide the sampler proposals
+ *                       of each step between (not used for IFD or
+ *                       MTM sampler).
+ *   heartbeat         - (in/out) progress heartbeat, or NULL
  *
  * Return value:
  *   None.
  *
  * The theta and Dmean array parameters, which must be allocted by caller,
  * are set to the parameter estimtes and derivative estimtes respectively.
+ *
+ * Since Algorithm S does not perform the sampler moves, the graph is not
+ * changed and the proposals of each step can be sampled by several threads
+ * at once. The IFD sampler is not divided in this way as its auxiliary
+ * parameter is adjusted according to all the proposals of the step, nor
+ * is the MTM sampler as it toggles arcs temporarily to draw its
+ * reference sets.
  */
 
-void algorithm_S(digraph_t *g, uint_t n, uint_t n_attr, uint_t n_dyadic,
-                 uint_t n_attr_interaction,
-                 change_stats_func_t *change_stats_funcs[],
-                 attr_change_stats_func_t *attr_change_stats_funcs[],
-                 dyadic_change_stats_func_t *dyadic_change_stats_funcs[],
-                 attr_interaction_change_stats_func_t
-                                  *attr_interaction_change_stats_funcs[],
-                 uint_t attr_indices[],
-                 uint_pair_t attr_interaction_pair_indices[],
+void algorithm_S(digraph_t *g, sampler_t *sampler,
                  uint_t M1,
                  uint_t sampler_m,
                  double ACA,
                  double theta[],
                  double Dmean[],
-                 FILE * theta_outfile,
-                 bool useIFDsampler,
-                 double ifd_K,
-                 bool useConditionalEstimation,
-                 bool forbidReciprocity, bool useTNTsampler)
+                 series_writer_t *theta_outfile,
+                 uint_t num_threads,
+                 heartbeat_t *heartbeat)
 {
   uint_t t, l;
+  uint_t n = sampler->model->n;
   double acceptance_rate;
-  double *addChangeStats = (double *)safe_malloc(n*sizeof(double));
-  double *delChangeStats = (double *)safe_malloc(n*sizeof(double));
+  double *addChangeStats = sampler->ws->addChangeStats;
+  double *delChangeStats = sampler->ws->delChangeStats;
   double *sumChangeStats = (double *)safe_malloc(n*sizeof(double));
   double *dzA = (double *)safe_malloc(n*sizeof(double));
   double *da = (double *)safe_malloc(n*sizeof(double));
@@ -145,60 +774,47 @@ void algorithm_S(digraph_t *g, uint_t n, uint_t n_attr, uint_t n_dyadic,
   /* 1/D0 is squared derivatives */  
   double *D0 = (double *)safe_calloc(n, sizeof(double));
   double  dzArc; /* (unused) required only for IFD sampler */
-  double  arc_correction_val; /* only used for IFD sampler */
-  double ifd_aux_param = 0; /* auxiliary parameter for IFD sampler */
+  double  arc_param; /* Arc parameter, only for IFD sampler */
+  sampler_t **thread_samplers = NULL; /* sampler of each thread */
+  sampler_options_t thread_options = sampler->options;
+  double  proposals = 0, accepted = 0; /* for heartbeat */
 
-  if (useIFDsampler)
-    arc_correction_val = arcCorrection(g);
+  sampler_init(sampler, g, 0);
+#ifdef USE_POW_LOOKUP
+  /* the pow() lookup tables are extended on demand so cannot be shared */
+  num_threads = 1;
+#endif
+  /* a sampler with an auxiliary parameter (IFD) adjusts it according to
+     all the proposals of the step, and the MTM sampler changes the graph
+     temporarily, so their proposals cannot be divided */
+  if (num_threads > 1 && sampler->ops->divisible) {
+    thread_options.num_threads = 1;
+    thread_samplers = (sampler_t **)safe_malloc(num_threads *
+                                                sizeof(sampler_t *));
+    for (l = 0; l < num_threads; l++) {
+      thread_samplers[l] = allocate_sampler(sampler->type, sampler->model,
+                                            &thread_options, sampler->prng,
+                                            allocate_sampler_workspace(n));
+      sampler_init(thread_samplers[l], g, 0);
+    }
+  }
 
-  for (l = 0; l < n; l++)
-    theta[l] = 0;
+  start_heartbeat_phase(heartbeat, "algorithm_S", 0, M1);
   for (t = 0; t < M1; t++) {
-    fprintf(theta_outfile, "%d ", t-M1);
-    if (useIFDsampler) {
-      acceptance_rate = ifdSampler(g, n, n_attr, n_dyadic,
-                                   n_attr_interaction,
-                                   change_stats_funcs,
-                                   attr_change_stats_funcs,
-                                   dyadic_change_stats_funcs,
-                                   attr_interaction_change_stats_funcs,
-                                   attr_indices,
-                                   attr_interaction_pair_indices,
-                                   theta,
-                                   addChangeStats, delChangeStats, sampler_m,
-                                   FALSE,
-                                   ifd_K, &dzArc, &ifd_aux_param,
-                                   useConditionalEstimation,
-                                   forbidReciprocity);
-      /* Arc parameter for IFD is auxiliary parameter adjusted by correction value */
-      fprintf(theta_outfile, "%g ", ifd_aux_param - arc_correction_val);
-    } else if (useTNTsampler) {
-      acceptance_rate = tntSampler(g, n, n_attr, n_dyadic,
-				   n_attr_interaction,
-				   change_stats_funcs,
-				   attr_change_stats_funcs,
-				   dyadic_change_stats_funcs,
-				   attr_interaction_change_stats_funcs,
-				   attr_indices,
-				   attr_interaction_pair_indices,
-				   theta,
-				   addChangeStats, delChangeStats, sampler_m,
-                                     FALSE, useConditionalEstimation,
-				   forbidReciprocity);
-      
+    series_write_int(theta_outfile, (long)t - (long)M1);
+    if (thread_samplers) {
+      /* each step uses new random streams for its threads */
+      acceptance_rate = parallel_sampler_S(g, theta, thread_samplers,
+                                           num_threads, sampler_m,
+                                           1 + (uint64_t)t * (num_threads - 1),
+                                           sampler->prng,
+                                           addChangeStats, delChangeStats);
     } else {
-      acceptance_rate = basicSampler(g, n, n_attr, n_dyadic,
-                                     n_attr_interaction,
-                                     change_stats_funcs,
-                                     attr_change_stats_funcs,
-                                     dyadic_change_stats_funcs,
-                                     attr_interaction_change_stats_funcs,
-                                     attr_indices,
-                                     attr_interaction_pair_indices,
-                                     theta,
-                                     addChangeStats, delChangeStats, sampler_m,
-                                     FALSE, useConditionalEstimation,
-                                     forbidReciprocity);
+      acceptance_rate = sampler_run(sampler, g, theta,
+                                    addChangeStats, delChangeStats, sampler_m,
+                                    FALSE);
+      if (sampler_arc_stats(sampler, &dzArc, &arc_param))
+        series_write_double(theta_outfile, arc_param);
     }
     for (l = 0; l < n; l++) {
       dzA[l] = delChangeStats[l] - addChangeStats[l];
@@ -213,55 +829,106 @@ void algorithm_S(digraph_t *g, uint_t n, uint_t n_attr, uint_t n_dyadic,
         da[l] = ACA / (sumChangeStats[l]*sumChangeStats[l]);
       theta_step[l] = (dzA[l] < 0 ? -1 : 1) * da[l] * dzA[l]*dzA[l];
       theta[l] += theta_step[l];
-      fprintf(theta_outfile, "%g ", theta[l]);
+      series_write_double(theta_outfile, theta[l]);
     }
-    fprintf(theta_outfile, "%g\n", acceptance_rate);
+    series_write_double(theta_outfile, acceptance_rate);
+    series_end_record(theta_outfile);
+    proposals += sampler_m;
+    accepted += acceptance_rate * sampler_m;
+    update_heartbeat(heartbeat, t, 0, t + 1, proposals, accepted, theta, dzA);
   }
   for (l = 0; l < n; l++)
     Dmean[l] = sampler_m / D0[l];
-  
+
+  if (thread_samplers) {
+    for (l = 0; l < num_threads; l++) {
+      /* count the threads' proposals as the sampler's own */
+      sampler->num_proposals += thread_samplers[l]->num_proposals;
+      sampler->num_accepted += thread_samplers[l]->num_accepted;
+      free_sampler_workspace(thread_samplers[l]->ws);
+      free_sampler(thread_samplers[l]);
+    }
+    free(thread_samplers);
+  }
   free(D0);
   free(theta_step);
   free(da);
   free(dzA);
   free(sumChangeStats);
-  free(delChangeStats);
-  free(addChangeStats);
 }
 
 
+/*
+ * Replace each of n values with its mean over the tasks sharing theta.
+ *
+ * Parameters:
+ *   shared - tasks sharing theta
+ *   values - (in/out) n values
+ *   n      - number of values
+ *
+ * Return value:
+ *   None.
+ */
+static void mean_over_tasks(const ee_shared_theta_t *shared, double values[],
+                            uint_t n)
+{
+  uint_t l;
+
+  shared->comm->allreduce_sum(shared->comm->data, values, n);
+  for (l = 0; l < n; l++)
+    values[l] /= shared->comm->num_ranks;
+}
+
+/*
+ * Combine the change in dzA of the chain of this task since the last
+ * time (including the change statistics of the last sampler call) and
+ * theta with those of the other tasks sharing theta, see algorithm_EE().
+ *
+ * Parameters:
+ *   shared     - tasks sharing theta
+ *   n          - number of parameters
+ *   theta      - (in/out) theta of this task, set to the mean over tasks
+ *   dzA        - (in/out) dzA of this task, set to the shared dzA
+ *   dzA_shared - (in/out) shared dzA as of the last time, updated
+ *   addChangeStats, delChangeStats - change statistics of the last
+ *                sampler call, not yet added to dzA
+ *   buf        - scratch space for 2n values
+ *
+ * Return value:
+ *   None.
+ */
+static void combine_shared_theta(const ee_shared_theta_t *shared, uint_t n,
+                                 double theta[], double dzA[],
+                                 double dzA_shared[],
+                                 const double addChangeStats[],
+                                 const double delChangeStats[],
+                                 double buf[])
+{
+  uint_t l;
+
+  for (l = 0; l < n; l++) {
+    buf[l] = dzA[l] - dzA_shared[l] + addChangeStats[l] - delChangeStats[l];
+    buf[n + l] = theta[l];
+  }
+  mean_over_tasks(shared, buf, 2 * n);
+  for (l = 0; l < n; l++) {
+    dzA_shared[l] += buf[l];
+    dzA[l] = dzA_shared[l];
+    theta[l] = buf[n + l];
+  }
+}
+
 /*
  * Algorithm EE for estimating ERGM parameters of arbitrary digraph.
  *
  * Parameters:
  *   g      - digraph object. NB modifed by sampler.
- *   n      - number of parameters (length of theta vector = 
- *            total number of change stats funcs)
- *   n_attr - number of attribute change stats functions
- *   n_dyadic -number of dyadic covariate change stats funcs
- *   n_attr_interaction - number of attribute interaction change stats funcs
- *   change_stats_funcs - array of pointers to change statistics functions
- *                        length is n - n_attr - n_dyadic - n_attr_interaction
- *   attr_change_stats_funcs - array of pointers to change statistics functions
- *                              length is n_attr
- *   dyadic_change_stats_funcs - array of pointers to dyadic change stats funcs
- *                             length is n_dyadic
- *   attr_interaction_change_stats_funcs - array of pointers to attribute
- *                           interaction (pair) change statistics functions.
- *                           length is n_attr_interaction.
- *   attr_indices   - array of n_attr attribute indices (index into g->binattr
- *                    or g->catattr) corresponding to attr_change_stats_funcs
- *                    E.g. for Sender effect on the first binary attribute,
- *                    attr_indices[x] = 0 and attr_change_stats_funcs[x] =
- *                    changeSender
- *   attr_interaction_pair_indices - array of n_attr_interaction pairs
- *                          of attribute inidices similar to above but
- *                          for attr_interaction_change_setats_funcs which
- *                          requires pairs of indices.
+ *   sampler - sampler for the model (with n parameters) to estimate
  *   Mouter     - Number of iterations of Algorithm EE (outer loop)
  *   Minner     - Number of iterations of Algorithm EE (inner loop)
  *   sampler_m  - Number of proposals (sampling iterations) 
- *                 [per step of Alg.EE]
+ *                 [per step of Alg.EE], initial value if
+ *                 adaptiveSamplerSteps is True
  *   ACA        - multiplier of D0 to get K_A step size multiplier
  *                (not used if useBorisenkUpdate is True)
  *   compC      - multiplier of sd(theta)/mean(theta) to limit
@@ -277,145 +944,269 @@ void algorithm_S(digraph_t *g, uint_t n, uint_t n_attr, uint_t n_dyadic,
  *  dzA_outfile   - open (write) file to write dzA values to.
  *  outputAllSteps - if True, output theta and dzA values every iteration,
  *                   otherwise only on every outer iteration.
- *  useIFDsampler  - if True, use IFD sampler instead of basic sampler.
- *  ifd_K          - constant for multipliying IFD auxiliary parameter step
- *                   size (only used if useIFDsampler is True).
- *  useConditionalEstimation - if True, do conditional estimation for snowball
- *                             network samples.
- *  forbidReciprocity - if True do not allow reciprocated arcs.
  *  useBorisenkoUpdate- if True use the Borisenko et al. (2019) theta update
  *  learningRate      - learning rate (step size multiplier) if 
  *                      useBorisenkoUpdate is True
  *  minTheta          - small positive constant c in Borisenko update step
  *                      to avoid zero step at zero parameter values if
  *                      useBorisenkoUpdate is true.
- *   useTNTsampler     - use TNT sampler not IFD or basic.
+ *  adaptiveSamplerSteps - if True adjust sampler_m after each outer
+ *                      iteration according to the lag-1 autocorrelation
+ *                      of the dzA values over its inner iterations
+ *                      (after removing their linear trend, see
+ *                      detrended_autocorrelation())
+ *  minSamplerSteps   - lower bound on sampler_m if adaptiveSamplerSteps
+ *  maxSamplerSteps   - upper bound on sampler_m if adaptiveSamplerSteps
+ *  targetAutocorr    - target maximum (over parameters) lag-1
+ *                      autocorrelation of dzA if adaptiveSamplerSteps,
+ *                      in (0, 1)
+ *  stop              - early termination criteria (see below)
+ *  shared            - tasks stepping a shared theta (see below), or
+ *                      NULL for this task alone
+ *  checkpoint_filename - file to write checkpoints to
+ *  checkpoint_interval - write a checkpoint every this many outer
+ *                      iterations, 0 for no checkpoints
+ *  restart           - checkpoint to continue from, or NULL to start
+ *                      from the beginning
+ *  theta_stats       - (In/Out) if not NULL, every theta vector of
+ *                      Algorithm EE is added to these running statistics
+ *  batches           - (In/Out) if not NULL, the statistics of theta and
+ *                      dzA over the inner iterations of each outer
+ *                      iteration are added to these as a batch
+ *  heartbeat         - (In/Out) progress heartbeat, or NULL
  *
  * Return value:
- *   None.
+ *   Reason the algorithm stopped.
  *
  * The theta and Dmean array parameters, which must be allocted by caller,
  * are set to the parameter estimtes and derivative estimtes respectively.
+ *
+ * If adaptiveSamplerSteps is True, sampler_m is doubled (up to
+ * maxSamplerSteps) after an outer iteration in which the lag-1
+ * autocorrelation of the dzA values of any parameter is above
+ * targetAutocorr, and halved (down to minSamplerSteps) if they are
+ * all below targetAutocorr squared: for an AR(1) series, doubling the
+ * proposals per step squares the lag-1 autocorrelation and halving
+ * them takes its square root, so a halving should not take it above
+ * the target. If a doubling does not reduce the autocorrelation (as
+ * when it comes from the theta updates rather than the sampler) it is
+ * undone and sampler_m is not increased beyond that value again. Each
+ * change is written to theta_outfile as a comment line
+ * (starting with '#', so ignored by R read.table()) with the largest
+ * lag-1 autocorrelation and smallest effective sample size of the dzA
+ * and theta values over the inner iterations.
+ *
+ * After each outer iteration the algorithm stops early if
+ * stop->window is nonzero and, over the last stop->window outer
+ * iterations, the mean theta (over inner iterations) of every
+ * parameter has changed by less than stop->thetaDrift relative to its
+ * magnitude (at least minTheta), and |mean(dzA)|/sd(dzA) of every
+ * parameter is less than stop->tRatio (each criterion not tested if
+ * zero). It also stops if stop->maxSeconds is nonzero and Algorithm EE
+ * has run for that many seconds. The reason is written to theta_outfile
+ * as a comment line, as for the samplerSteps changes.
+ *
+ * If stop->collective is not NULL, these tests do not stop this task
+ * by themselves: instead every stop->collectiveInterval outer
+ * iterations their results, and the statistics of theta since the
+ * last time, are passed to stop->collective, which combines them with
+ * those of the other tasks (which must all call it at the same outer
+ * iterations) and decides whether they all stop.
+ *
+ * If shared is not NULL, the tasks (which must all call this with the
+ * same Mouter and Minner, and stop at the same outer iteration, e.g.
+ * with stop->collective) step one shared theta instead of each its
+ * own: theta and D0 (from Algorithm S in each task) start as their
+ * means over the tasks, and every shared->interval inner iterations,
+ * and at the end of every outer iteration, the changes in dzA of the
+ * chains of all the tasks since the last time are combined (as their
+ * mean, so that the step size is as for one chain, but with less
+ * noise) into a shared dzA, and theta set to its mean over the tasks
+ * (the same as that of each task if shared->interval is 1). In between,
+ * each task steps its own theta with the changes of its own chain.
+ * D0 is also set to its mean after each adjustment.
+ *
+ * Every checkpoint_interval outer iterations, the state of the
+ * algorithm (digraph arcs, theta, D0, dzA, sampler state and random
+ * stream, the iteration counts, and the lengths of the output files)
+ * is written to checkpoint_filename, so that it can continue from there
+ * (with restart) with the same results as if it had not stopped. The
+ * convergence test window and the wall clock limit start again on
+ * restart, however. theta and D0 are not set from restart here (the
+ * caller does that, as they are also the results of Algorithm S).
+ *
+ * The mean and sd of theta over inner iterations (for the D0
+ * adjustment) are computed online, so the theta values are not stored
+ * (except with adaptiveSamplerSteps, which needs the whole series).
  */
-void algorithm_EE(digraph_t *g, uint_t n, uint_t n_attr, uint_t n_dyadic,
-                  uint_t n_attr_interaction,
-                  change_stats_func_t *change_stats_funcs[],
-                  attr_change_stats_func_t *attr_change_stats_funcs[],
-                  dyadic_change_stats_func_t *dyadic_change_stats_funcs[],
-                  attr_interaction_change_stats_func_t
-                                   *attr_interaction_change_stats_funcs[],
-                  uint_t attr_indices[],
-                  uint_pair_t attr_interaction_pair_indices[],
+ee_stop_reason_e algorithm_EE(digraph_t *g, sampler_t *sampler,
                   uint_t Mouter, uint_t Minner,
                   uint_t sampler_m,
                   double ACA, double compC,
                   double D0[],
                   double theta[],
-                  FILE *theta_outfile, FILE *dzA_outfile, bool outputAllSteps,
-                  bool useIFDsampler, double ifd_K,
-                  bool useConditionalEstimation,
-                  bool forbidReciprocity, bool useBorisenkoUpdate,
+                  series_writer_t *theta_outfile, series_writer_t *dzA_outfile,
+                  bool outputAllSteps,
+                  bool useBorisenkoUpdate,
                   double learningRate, double minTheta,
-		  bool useTNTsampler)
+                  bool adaptiveSamplerSteps, uint_t minSamplerSteps,
+                  uint_t maxSamplerSteps, double targetAutocorr,
+                  const ee_stop_criteria_t *stop,
+                  const ee_shared_theta_t *shared,
+                  const char *checkpoint_filename,
+                  uint_t checkpoint_interval,
+                  const ee_checkpoint_t *restart,
+                  online_stats_t *theta_stats,
+                  ee_batches_t *batches,
+                  heartbeat_t *heartbeat)
 {
   uint_t touter, tinner, l, t = 0;
+  uint_t n = sampler->model->n;
   double acceptance_rate;
   double theta_mean, theta_sd;
-  double *addChangeStats = (double *)safe_malloc(n*sizeof(double));
-  double *delChangeStats = (double *)safe_malloc(n*sizeof(double));
+  double *addChangeStats = sampler->ws->addChangeStats;
+  double *delChangeStats = sampler->ws->delChangeStats;
   double *sumChangeStats = (double *)safe_malloc(n*sizeof(double));
   double *da = (double *)safe_malloc(n*sizeof(double));
   double *theta_step = (double *)safe_malloc(n*sizeof(double));
   /* dzA is only zeroed here, and accumulates in the loop */
   double *dzA = (double *)safe_calloc(n, sizeof(double));
-  /* each element of thetamatrix is an array of Minner theta[l]
-     values, one for each of the 0 <= l < n elements of theta, used to
-     accumulate them to compute mean and sd over innter iterations for
-     each outer iteration */
-  double **thetamatrix = (double **)safe_malloc(n*sizeof(double *));
-  double arc_correction_val; /* only used for IFD sampler */
+  /* running mean and sd of each theta value over the inner iterations
+     of each outer iteration */
+  online_stats_t inner_theta_stats;
+  /* and of each dzA value, only used for batches */
+  online_stats_t inner_dzA_stats;
   double dzArc; /* only used for IFD sampler */
-  double ifd_aux_param = 0; /* auxiliary parameter for IFD sampler */
+  double arc_param; /* only used for IFD sampler */
+  /* theta and dzA over inner iterations, each element an array of
+     Minner values for one of the 0 <= l < n parameters, only used for
+     adaptiveSamplerSteps (which needs the whole series) */
+  double **thetamatrix = NULL;
+  double **dzAmatrix = NULL;
+  double rho, ess;
+  double max_rho_dzA, min_ess_dzA, max_rho_theta, min_ess_theta;
+  uint_t new_sampler_m, max_sampler_m = maxSamplerSteps;
+  double prev_rho_dzA = 1; /* max_rho_dzA before last doubling of sampler_m */
+  bool   doubled = FALSE;  /* sampler_m was doubled after last outer iter */
+  /* for convergence test: mean theta over inner iterations of each of
+     the last window+1 outer iterations, and sum and sum of squares of
+     dzA over inner iterations of each of the last window outer
+     iterations, each n values per outer iteration in circular buffers */
+  uint_t window = stop->window;
+  double *theta_means = NULL, *dzA_sums = NULL, *dzA_sumsqs = NULL;
+  double *theta_now, *theta_old, *sums = NULL, *sumsqs = NULL;
+  double drift, max_drift, tratio, max_tratio, sum, sumsq, num, sd;
+  bool   converged, time_up; /* stop tests met in this outer iteration */
+  /* theta since the last collective stop test */
+  online_stats_t collective_theta_stats;
+  /* dzA combined over the tasks sharing theta as of the last time, and
+     scratch space for combining */
+  double *dzA_shared = NULL, *shared_buf = NULL;
+  bool   combine = FALSE; /* combine with the tasks sharing theta now */
+  ee_stop_reason_e reason = EE_STOP_MAX_STEPS;
+  struct timeval start_timeval, now_timeval, elapsed_timeval;
+  ee_checkpoint_t ckpt;
+  double proposals = 0, accepted = 0; /* for heartbeat */
 
-  if (useIFDsampler) 
-    arc_correction_val = arcCorrection(g);
+  gettimeofday(&start_timeval, NULL);
+  sampler_init(sampler, g, 0);
+  if (window > 0) {
+    theta_means = (double *)safe_malloc((window + 1) * n * sizeof(double));
+    dzA_sums = (double *)safe_malloc(window * n * sizeof(double));
+    dzA_sumsqs = (double *)safe_malloc(window * n * sizeof(double));
+  }
+  if (adaptiveSamplerSteps) {
+    thetamatrix = (double **)safe_malloc(n*sizeof(double *));
+    dzAmatrix = (double **)safe_malloc(n*sizeof(double *));
+    for (l = 0; l < n; l++) {
+      thetamatrix[l] = (double *)safe_malloc(Minner*sizeof(double));
+      dzAmatrix[l] = (double *)safe_malloc(Minner*sizeof(double));
+    }
+  }
+  init_online_stats(&inner_theta_stats, n, FALSE);
+  if (batches)
+    init_online_stats(&inner_dzA_stats, n, FALSE);
+  if (stop->collective)
+    init_online_stats(&collective_theta_stats, n, FALSE);
 
-  for (l = 0; l < n; l++)
-    thetamatrix[l] = (double *)safe_malloc(Minner*sizeof(double));
+  if (restart) {
+    t = restart->t;
+    sampler_m = restart->sampler_m;
+    max_sampler_m = restart->max_sampler_m;
+    prev_rho_dzA = restart->prev_rho_dzA;
+    doubled = restart->doubled;
+    memcpy(dzA, restart->dzA, n * sizeof(double));
+    *sampler->prng = restart->prng;
+    assert(restart->sampler_state_size == sampler->ops->state_size);
+    if (sampler->ops->state_size > 0)
+      memcpy(sampler->state, restart->sampler_state,
+             sampler->ops->state_size);
+  }
+  if (shared) {
+    assert(shared->interval > 0);
+    shared_buf = (double *)safe_malloc(2 * n * sizeof(double));
+    /* dzA was combined at the end of the outer iteration before the
+       checkpoint, so it is the shared dzA */
+    dzA_shared = (double *)safe_malloc(n * sizeof(double));
+    memcpy(dzA_shared, dzA, n * sizeof(double));
+    if (!restart) {
+      mean_over_tasks(shared, theta, n);
+      mean_over_tasks(shared, D0, n);
+    }
+  }
 
-  for (touter = 0; touter < Mouter; touter++) {
+  start_heartbeat_phase(heartbeat, "algorithm_EE", t,
+                        (ulonglong_t)Mouter * Minner);
+  for (touter = restart ? restart->touter : 0; touter < Mouter; touter++) {
+    if (window > 0) {
+      sums = dzA_sums + (touter % window) * n;
+      sumsqs = dzA_sumsqs + (touter % window) * n;
+      for (l = 0; l < n; l++)
+        sums[l] = sumsqs[l] = 0;
+    }
+    reset_online_stats(&inner_theta_stats);
+    converged = time_up = FALSE;
+    if (batches)
+      reset_online_stats(&inner_dzA_stats);
     for (tinner = 0; tinner < Minner; tinner++) {
       if (outputAllSteps || tinner == 0) {
-        fprintf(theta_outfile, "%u ", t);
-        fprintf(dzA_outfile, "%u ", t);
+        series_write_int(theta_outfile, t);
+        series_write_int(dzA_outfile, t);
 #ifdef TWOPATH_HASHTABLES
         MEMUSAGE_DEBUG_PRINT(("MixTwoPath hash table has %u entries (%f MB)\n",
-                        HASH_COUNT(g->mixTwoPathHashTab),
-                        (double)(HASH_COUNT(g->mixTwoPathHashTab)*2*
-                                 sizeof(twopath_record_t))/(1024*1024)));
+                              (uint_t)TWOPATH_HASHTAB_COUNT(g->mixTwoPathHashTab),
+                              (double)TWOPATH_HASHTAB_BYTES(g->mixTwoPathHashTab)/
+                              (1024*1024)));
         MEMUSAGE_DEBUG_PRINT(("InTwoPath hash table has %u entries (%f MB)\n",
-                              HASH_COUNT(g->inTwoPathHashTab),
-                              (double)(HASH_COUNT(g->inTwoPathHashTab)*
-                                       (sizeof(twopath_record_t)))/(1024*1024)));
+                              (uint_t)TWOPATH_HASHTAB_COUNT(g->inTwoPathHashTab),
+                              (double)TWOPATH_HASHTAB_BYTES(g->inTwoPathHashTab)/
+                              (1024*1024)));
         MEMUSAGE_DEBUG_PRINT(("OutTwoPath hash table has %u entries (%f MB)\n",
-                              HASH_COUNT(g->outTwoPathHashTab),
-                              (double)(HASH_COUNT(g->outTwoPathHashTab)*2*
-                                       sizeof(twopath_record_t))/(1024*1024)));
+                              (uint_t)TWOPATH_HASHTAB_COUNT(g->outTwoPathHashTab),
+                              (double)TWOPATH_HASHTAB_BYTES(g->outTwoPathHashTab)/
+                              (1024*1024)));
 #endif /* DEBUG_MEMUSAGE */
       }
-      if (useIFDsampler) {
-        acceptance_rate = ifdSampler(g, n, n_attr, n_dyadic, n_attr_interaction,
-                                     change_stats_funcs, 
-                                     attr_change_stats_funcs,
-                                     dyadic_change_stats_funcs,
-                                     attr_interaction_change_stats_funcs,
-                                     attr_indices,
-                                     attr_interaction_pair_indices,
-                                     theta,
-                                     addChangeStats, delChangeStats, sampler_m,
-                                     TRUE, /*Algorithm EE actually does moves */
-                                     ifd_K, &dzArc, &ifd_aux_param,
-                                     useConditionalEstimation,
-                                     forbidReciprocity);
-        if (useIFDsampler && (outputAllSteps || tinner == 0)) {
-          /* difference of Arc statistic for IFD sampler is just Ndel-Nadd */
-          fprintf(dzA_outfile, "%g ", dzArc);
-          /* Arc parameter for IFD sampler is auxiliary parameter adjusted */
-          fprintf(theta_outfile, "%g ", ifd_aux_param - arc_correction_val);
-        }
-      } else if (useTNTsampler) {
-        acceptance_rate = tntSampler(g, n, n_attr, n_dyadic,
-				     n_attr_interaction,
-				     change_stats_funcs, 
-				     attr_change_stats_funcs,
-				     dyadic_change_stats_funcs,
-				     attr_interaction_change_stats_funcs,
-				     attr_indices,
-				     attr_interaction_pair_indices,
-				     theta,
-				     addChangeStats, delChangeStats,
-				     sampler_m,
-				     TRUE,/*Algorithm EE actually does moves*/
-				     useConditionalEstimation,
-				     forbidReciprocity);
-      } else {
-        acceptance_rate = basicSampler(g, n, n_attr, n_dyadic,
-                                       n_attr_interaction,
-                                       change_stats_funcs, 
-                                       attr_change_stats_funcs,
-                                       dyadic_change_stats_funcs,
-                                       attr_interaction_change_stats_funcs,
-                                       attr_indices,
-                                       attr_interaction_pair_indices,
-                                       theta,
-                                       addChangeStats, delChangeStats,
-                                       sampler_m,
-                                       TRUE,/*Algorithm EE actually does moves*/
-                                       useConditionalEstimation,
-                                       forbidReciprocity);
+      acceptance_rate = sampler_run(sampler, g, theta,
+                                    addChangeStats, delChangeStats, sampler_m,
+                                    TRUE /*Algorithm EE actually does moves */);
+      if (sampler_arc_stats(sampler, &dzArc, &arc_param) &&
+          (outputAllSteps || tinner == 0)) {
+        /* difference of Arc statistic for IFD sampler is just Ndel-Nadd */
+        series_write_double(dzA_outfile, dzArc);
+        /* Arc parameter for IFD sampler is auxiliary parameter adjusted */
+        series_write_double(theta_outfile, arc_param);
+      }
+      if (shared) {
+        combine = (tinner + 1) % shared->interval == 0 ||
+          tinner + 1 == Minner;
+        if (combine)
+          combine_shared_theta(shared, n, theta, dzA, dzA_shared,
+                               addChangeStats, delChangeStats, shared_buf);
       }
       for (l = 0; l < n; l++) {
-        dzA[l] += addChangeStats[l] - delChangeStats[l]; /* dzA accumulates */
+        if (!combine) /* otherwise already in the shared dzA */
+          dzA[l] += addChangeStats[l] - delChangeStats[l]; /* dzA accumulates */
         ALGEE_DEBUG_PRINT(("addChangeStats[%u] = %g delChangeStats[%u] = %g\n",
                           l, addChangeStats[l], l, delChangeStats[l]));
         if (useBorisenkoUpdate) {
@@ -427,22 +1218,44 @@ void algorithm_EE(digraph_t *g, uint_t n, uint_t n_attr, uint_t n_dyadic,
         }
         theta[l] += theta_step[l];
         if (outputAllSteps || tinner == 0) {
-          fprintf(dzA_outfile, "%g ", dzA[l]);
-          fprintf(theta_outfile, "%g ", theta[l]);
+          series_write_double(dzA_outfile, dzA[l]);
+          series_write_double(theta_outfile, theta[l]);
+        }
+        if (dzAmatrix) {
+          thetamatrix[l][tinner] = theta[l];
+          dzAmatrix[l][tinner] = dzA[l];
+        }
+        if (window > 0) {
+          sums[l] += dzA[l];
+          sumsqs[l] += dzA[l] * dzA[l];
         }
-        thetamatrix[l][tinner] = theta[l];
       }
+      add_online_stats(&inner_theta_stats, theta);
+      if (theta_stats)
+        add_online_stats(theta_stats, theta);
+      if (batches)
+        add_online_stats(&inner_dzA_stats, dzA);
+      if (stop->collective)
+        add_online_stats(&collective_theta_stats, theta);
       if (outputAllSteps || tinner == 0) {      
-        fprintf(theta_outfile, "%g\n", acceptance_rate);
-        fprintf(dzA_outfile, "\n");
+        series_write_double(theta_outfile, acceptance_rate);
+        series_end_record(theta_outfile);
+        series_end_record(dzA_outfile);
       }
       t++;
+      proposals += sampler_m;
+      accepted += acceptance_rate * sampler_m;
+      update_heartbeat(heartbeat, touter, tinner, t, proposals, accepted,
+                       theta, dzA);
     }
+    if (batches)
+      add_ee_batch(batches, &inner_theta_stats, &inner_dzA_stats);
     if (!useBorisenkoUpdate) {
       /* get mean and sd of each theta value over inner loop iterations
          and adjust D0 to limit variance of theta (see S.I.) */
       for (l = 0; l < n; l++) {
-        theta_mean = mean_and_sd(thetamatrix[l], Minner, &theta_sd);
+        theta_mean = inner_theta_stats.mean[l];
+        theta_sd = online_stats_sd(&inner_theta_stats, l);
         /* force minimum magnitude to stop theta sticking at zero */
         /* TODO 0.1 in next two lines was changed in an earlier commit
            from another value with no explanation. It should be made a
@@ -458,19 +1271,145 @@ void algorithm_EE(digraph_t *g, uint_t n, uint_t n_attr, uint_t n_dyadic,
           D0[l] *= sqrt(compC / (theta_sd / fabs(theta_mean)));
         }
       }
+      if (shared)
+        mean_over_tasks(shared, D0, n);
+    }
+    if (dzAmatrix && Minner > 2) {
+      max_rho_dzA = max_rho_theta = -1;
+      min_ess_dzA = min_ess_theta = Minner;
+      for (l = 0; l < n; l++) {
+        rho = detrended_autocorrelation(dzAmatrix[l], Minner, &ess);
+        max_rho_dzA = MAX(max_rho_dzA, rho);
+        min_ess_dzA = MIN(min_ess_dzA, ess);
+        rho = lag1_autocorrelation(thetamatrix[l], Minner, &ess);
+        max_rho_theta = MAX(max_rho_theta, rho);
+        min_ess_theta = MIN(min_ess_theta, ess);
+      }
+      new_sampler_m = sampler_m;
+      if (doubled && max_rho_dzA >= prev_rho_dzA) {
+        /* doubling did not help: undo it and do not try again */
+        max_sampler_m = new_sampler_m = MAX(sampler_m / 2, minSamplerSteps);
+      } else if (max_rho_dzA > targetAutocorr) {
+        new_sampler_m = MIN(2 * sampler_m, max_sampler_m);
+      } else if (max_rho_dzA < targetAutocorr * targetAutocorr) {
+        new_sampler_m = MAX(sampler_m / 2, minSamplerSteps);
+      }
+      doubled = new_sampler_m > sampler_m;
+      prev_rho_dzA = max_rho_dzA;
+      if (new_sampler_m != sampler_m) {
+        series_comment(theta_outfile, "t = %u samplerSteps %u -> %u "
+                "dzA autocorrelation %g ESS %g "
+                "theta autocorrelation %g ESS %g", t,
+                sampler_m, new_sampler_m, max_rho_dzA, min_ess_dzA,
+                max_rho_theta, min_ess_theta);
+        sampler_m = new_sampler_m;
+      }
+    }
+    if (window > 0) {
+      theta_now = theta_means + (touter % (window + 1)) * n;
+      for (l = 0; l < n; l++)
+        theta_now[l] = inner_theta_stats.mean[l];
+      if (touter >= window) {
+        theta_old = theta_means + ((touter - window) % (window + 1)) * n;
+        max_drift = max_tratio = 0;
+        num = (double)window * Minner;
+        for (l = 0; l < n; l++) {
+          drift = fabs(theta_now[l] - theta_old[l]) /
+            MAX(fabs(theta_now[l]), minTheta);
+          max_drift = MAX(max_drift, drift);
+          sum = sumsq = 0;
+          for (tinner = 0; tinner < window; tinner++) {
+            sum += dzA_sums[tinner * n + l];
+            sumsq += dzA_sumsqs[tinner * n + l];
+          }
+          sd = num > 1 ? sqrt(MAX(sumsq - sum * sum / num, 0) / (num - 1)) : 0;
+          tratio = sd > 0 ? fabs(sum / num) / sd :
+            (fabs(sum) > 0 ? HUGE_VAL : 0);
+          max_tratio = MAX(max_tratio, tratio);
+        }
+        converged = (stop->thetaDrift <= 0 || max_drift < stop->thetaDrift) &&
+          (stop->tRatio <= 0 || max_tratio < stop->tRatio);
+        if (converged && !stop->collective) {
+          series_comment(theta_outfile, "t = %u stopping Algorithm EE: %s "
+                  "(theta drift %g dzA t-ratio %g over %u outer "
+                  "iterations)", t, ee_stop_reason_name(EE_STOP_CONVERGED),
+                  max_drift, max_tratio, window);
+          reason = EE_STOP_CONVERGED;
+        }
+      }
+    }
+    if (reason == EE_STOP_MAX_STEPS && stop->maxSeconds > 0) {
+      gettimeofday(&now_timeval, NULL);
+      timeval_subtract(&elapsed_timeval, &now_timeval, &start_timeval);
+      time_up = elapsed_timeval.tv_sec >= (long)stop->maxSeconds;
+      if (time_up && !stop->collective) {
+        series_comment(theta_outfile, "t = %u stopping Algorithm EE: %s "
+                "(%u s)", t, ee_stop_reason_name(EE_STOP_TIME_LIMIT),
+                stop->maxSeconds);
+        reason = EE_STOP_TIME_LIMIT;
+      }
+    }
+    if (stop->collective && (touter + 1) % stop->collectiveInterval == 0) {
+      reason = stop->collective(stop, converged, time_up,
+                                &collective_theta_stats);
+      reset_online_stats(&collective_theta_stats);
+      if (reason != EE_STOP_MAX_STEPS)
+        series_comment(theta_outfile, "t = %u stopping Algorithm EE: %s",
+                       t, ee_stop_reason_name(reason));
+    }
+    series_flush(dzA_outfile);
+    series_flush(theta_outfile);
+    if (reason != EE_STOP_MAX_STEPS)
+      break;
+    if (checkpoint_interval > 0 && (touter + 1) % checkpoint_interval == 0 &&
+        touter + 1 < Mouter) {
+      ckpt.num_nodes = g->num_nodes;
+      ckpt.n = n;
+      ckpt.touter = touter + 1;
+      ckpt.t = t;
+      ckpt.iterations = 0; /* only used by SimulateERGM */
+      ckpt.sampler_m = sampler_m;
+      ckpt.max_sampler_m = max_sampler_m;
+      ckpt.prev_rho_dzA = prev_rho_dzA;
+      ckpt.doubled = doubled;
+      ckpt.prng = *sampler->prng;
+      ckpt.theta_file_pos = series_tell(theta_outfile);
+      ckpt.dzA_file_pos = series_tell(dzA_outfile);
+      ckpt.inner_arcs = sampler->options.useConditionalEstimation;
+      ckpt.num_arcs = ckpt.inner_arcs ? g->num_inner_arcs : g->num_arcs;
+      ckpt.arcs = ckpt.inner_arcs ? g->allinnerarcs : g->allarcs;
+      ckpt.sampler_state_size = sampler->ops->state_size;
+      ckpt.sampler_state = sampler->state;
+      ckpt.theta = theta;
+      ckpt.D0 = D0;
+      ckpt.dzA = dzA;
+      /* on failure (message already printed) just carry on without it */
+      (void)write_ee_checkpoint(checkpoint_filename, &ckpt);
     }
-    fflush(dzA_outfile);
-    fflush(theta_outfile); 
   }
-  for (l = 0; l < n; l++)
-    free(thetamatrix[l]);
-  free(thetamatrix);
+  free(theta_means);
+  free(dzA_sums);
+  free(dzA_sumsqs);
+  if (dzAmatrix) {
+    for (l = 0; l < n; l++) {
+      free(thetamatrix[l]);
+      free(dzAmatrix[l]);
+    }
+    free(thetamatrix);
+    free(dzAmatrix);
+  }
+  free_online_stats(&inner_theta_stats);
+  if (batches)
+    free_online_stats(&inner_dzA_stats);
+  if (stop->collective)
+    free_online_stats(&collective_theta_stats);
+  free(dzA_shared);
+  free(shared_buf);
   free(theta_step);
   free(da);
   free(dzA);
   free(sumChangeStats);
-  free(delChangeStats);
-  free(addChangeStats);
+  return reason;
 }
 
 
@@ -487,6 +1426,8 @@ void algorithm_EE(digraph_t *g, uint_t n, uint_t n_attr, uint_t n_dyadic,
  *   n_attr_interaction - number of attribute interaction change stats funcs
  *   change_stats_funcs - array of pointers to change statistics functions
  *                        length is n - n_attr - n_dyadic - n_attr_interaction
+ *   lambda_values - array of lambda (decay) values corresponding to
+ *                   change_stats_funcs (used by alternating statistics)
  *   attr_change_stats_funcs - array of pointers to change statistics functions
  *                             length is n_attr
  *   dyadic_change_stats_funcs - array of pointers to dyadic change stats funcs
@@ -514,8 +1455,8 @@ void algorithm_EE(digraph_t *g, uint_t n, uint_t n_attr, uint_t n_dyadic,
  *   theta  - (Out) array of n parameter values corresponding to
  *                  change stats funcs. Allocated by caller.
  *   tasknum - task number (MPI rank)
- *   theta_outfile - open (write) file to write theta values to
- *   dzA_outfile   - open (write) file to write dzA values to
+ *   theta_outfile - series writer to write theta values to
+ *   dzA_outfile   - series writer to write dzA values to
  *   outputAllSteps - in Algorithm EE, output theta and dzA values on every
  *                    iteration, not just every outer iteration.
  *   useIFDsampler  - if true, use the IFD sampler instead of the basic 
@@ -535,6 +1476,49 @@ void algorithm_EE(digraph_t *g, uint_t n, uint_t n_attr, uint_t n_dyadic,
  *                      to avoid zero step at zero parameter values if
  *                      useBorisenkoUpdate is true.
  *  useTNTsampler     - use TNT sampler not IFD or basic.
+ *  useMTMsampler     - use multiple-try Metropolis sampler not IFD, TNT
+ *                      or basic.
+ *  mtm_tries         - number of tries per step for MTM sampler.
+ *  earlyReject       - reject moves using bounds on the change statistics
+ *                      before computing them all (basic sampler only),
+ *                      see calcChangeStatsEarlyReject().
+ *  degreeProposalWeight - weight of degree-weighted dyad proposals, 0 for
+ *                      uniform (basic sampler only), see
+ *                      degreeProposalSampler().
+ *  partition         - if not NULL, g is this task's part of a network
+ *                      partitioned between tasks, and the partitioned
+ *                      sampler is used (the sampler options are not)
+ *  adaptiveSamplerSteps, minSamplerSteps, maxSamplerSteps,
+ *  targetAutocorr    - adaptive sampler_m in Algorithm EE, see
+ *                      algorithm_EE()
+ *  stop              - early termination criteria for Algorithm EE, see
+ *                      algorithm_EE()
+ *  shared            - tasks stepping a shared theta in Algorithm EE, see
+ *                      algorithm_EE(), or NULL
+ *  checkpoint_filename, checkpoint_interval - checkpoints of Algorithm EE,
+ *                      see algorithm_EE()
+ *  restart           - checkpoint to continue Algorithm EE from, skipping
+ *                      Algorithm S, or NULL to start from the beginning
+ *  warm_start        - if not NULL (and restart is NULL), starting theta
+ *                      for Algorithm S, whose D0 replaces the Algorithm S
+ *                      estimate of the parameters that have one; if it
+ *                      has D0 for every parameter and its Ssteps is 0,
+ *                      Algorithm S is skipped (see warmStart.h)
+ *  final_D0          - (Out) if not NULL, array of n D0 values at the
+ *                      end of Algorithm EE. Allocated by caller.
+ *  theta_stats       - (In/Out) if not NULL, running statistics (see
+ *                      init_online_stats()) that every theta vector of
+ *                      Algorithm EE is added to
+ *  batches           - (In/Out) if not NULL, batch statistics for
+ *                      each outer iteration of Algorithm EE, see
+ *                      algorithm_EE()
+ *  metrics           - (In/Out) if not NULL, the times and sampler
+ *                      proposals of Algorithm S and Algorithm EE are
+ *                      added as phases (see runMetrics.h)
+ *  num_threads_S     - number of threads for the Algorithm S sampler.
+ *  num_threads_EE    - number of threads for the Algorithm EE sampler.
+ *  heartbeat         - (In/Out) progress heartbeat of Algorithm S and
+ *                      Algorithm EE, or NULL
  *
  * Return value:
  *   Nonzero on error, 0 if OK.
@@ -545,6 +1529,7 @@ void algorithm_EE(digraph_t *g, uint_t n, uint_t n_attr, uint_t n_dyadic,
 int ee_estimate(digraph_t *g, uint_t n, uint_t n_attr, uint_t n_dyadic,
                 uint_t n_attr_interaction,
                 change_stats_func_t *change_stats_funcs[],
+                double lambda_values[],
                 attr_change_stats_func_t *attr_change_stats_funcs[],
                 dyadic_change_stats_func_t *dyadic_change_stats_funcs[],
                 attr_interaction_change_stats_func_t
@@ -554,129 +1539,859 @@ int ee_estimate(digraph_t *g, uint_t n, uint_t n_attr, uint_t n_dyadic,
                 uint_t sampler_m, uint_t M1_steps, uint_t Mouter,
                 uint_t Msteps, double ACA_S, double ACA_EE, double compC,
                 double theta[], uint_t tasknum,
-                FILE *theta_outfile, FILE *dzA_outfile, bool outputAllSteps,
+                series_writer_t *theta_outfile, series_writer_t *dzA_outfile,
+                bool outputAllSteps,
                 bool useIFDsampler, double ifd_K,
                 bool useConditionalEstimation,
                 bool forbidReciprocity, bool useBorisenkoUpdate,
                 double learningRate, double minTheta,
-		bool useTNTsampler)
+		bool useTNTsampler, bool useMTMsampler, uint_t mtm_tries,
+                bool earlyReject, double degreeProposalWeight,
+                digraph_partition_t *partition, uint_t num_threads_S, uint_t num_threads_EE,
+                bool adaptiveSamplerSteps, uint_t minSamplerSteps,
+                uint_t maxSamplerSteps, double targetAutocorr,
+                const ee_stop_criteria_t *stop,
+                const ee_shared_theta_t *shared,
+                const char *checkpoint_filename, uint_t checkpoint_interval,
+                const ee_checkpoint_t *restart,
+                const ee_warm_start_t *warm_start, double final_D0[],
+                online_stats_t *theta_stats,
+                ee_batches_t *batches, run_metrics_t *metrics,
+                heartbeat_t *heartbeat)
+{
+  struct timeval start_timeval, end_timeval, elapsed_timeval;
+  int            etime;
+  ee_stop_reason_e stop_reason;
+  double         S_proposals, S_accepted; /* sampler totals after S */
+  uint_t         i;
+  int            errcode = 0;
+  double         failed; /* number of tasks sharing theta that failed */
+  prng_t         prng; /* random stream of the main thread of this task */
+  sampler_workspace_t *ws = allocate_sampler_workspace(n);
+  sampler_model_t   model;
+  sampler_options_t options;
+  sampler_t        *sampler;
+
+  /*array of n derivative estimate values corresponding to theta. */  
+  double *Dmean = (double *)safe_malloc(n*sizeof(double));
+
+  prng_init_stream(&prng, 0);
+#ifdef PROFILE_CHANGESTATS
+  profile_reset(); /* reported by do_estimation() */
+#endif /* PROFILE_CHANGESTATS */
+  model.n = n;
+  model.n_attr = n_attr;
+  model.n_dyadic = n_dyadic;
+  model.n_attr_interaction = n_attr_interaction;
+  model.change_stats_funcs = change_stats_funcs;
+  model.lambda_values = lambda_values;
+  model.attr_change_stats_funcs = attr_change_stats_funcs;
+  model.dyadic_change_stats_funcs = dyadic_change_stats_funcs;
+  model.attr_interaction_change_stats_funcs =
+    attr_interaction_change_stats_funcs;
+  model.attr_indices = attr_indices;
+  model.attr_interaction_pair_indices = attr_interaction_pair_indices;
+  options.ifd_K = ifd_K;
+  options.useConditionalEstimation = useConditionalEstimation;
+  options.forbidReciprocity = forbidReciprocity;
+  options.num_threads = num_threads_EE;
+  options.mtm_tries = mtm_tries;
+  options.earlyReject = earlyReject;
+  options.degreeProposalWeight = degreeProposalWeight;
+  options.partition = partition;
+  set_change_stats_caches(g, n - n_attr - n_dyadic - n_attr_interaction,
+                          change_stats_funcs, lambda_values, n_attr,
+                          attr_change_stats_funcs, attr_indices,
+                          n_attr_interaction,
+                          attr_interaction_change_stats_funcs,
+                          attr_interaction_pair_indices);
+  sampler = allocate_sampler(partition ? SAMPLER_PARTITIONED :
+                             get_sampler_type(useIFDsampler, useTNTsampler,
+                                              useMTMsampler),
+                             &model, &options, &prng, ws);
+    
+  if (useBorisenkoUpdate) {
+    printf("task %u:  ACA_S = %g, Borisenko update learningRate = %g, "
+           "minTheta = %g, samplerSteps = %u, "
+           "Ssteps = %u, EEsteps = %u, EEinnerSteps = %u\n", tasknum,
+           ACA_S, learningRate, minTheta, sampler_m, M1_steps, Mouter, Msteps);
+  } else {
+    printf("task %u: ACA_S = %g, ACA_EE = %g, compC = %g, samplerSteps = %u, "
+           "Ssteps = %u, EEsteps = %u, EEinnerSteps = %u\n", tasknum,
+           ACA_S, ACA_EE, compC, sampler_m, M1_steps, Mouter, Msteps);
+  }
+    
+  if (useIFDsampler)
+    printf("task %u: IFD sampler ifd_K = %g, arcCorrection = %g\n",
+           tasknum, ifd_K, arcCorrection(g));
+  else if (useTNTsampler)
+    printf("task %u: TNT sampler\n", tasknum);
+  else if (useMTMsampler)
+    printf("task %u: MTM sampler mtmTries = %u\n", tasknum, mtm_tries);
+  else if (partition)
+    printf("task %u: partitioned sampler, nodes %u to %u of %u\n",
+           tasknum, partition->first_node, partition->end_node - 1,
+           partition->num_nodes);
+  else if (earlyReject)
+    printf("task %u: basic sampler with early rejection\n", tasknum);
+
+  if (num_threads_S > 1) {
+    if (!sampler->ops->divisible)
+      printf("task %u: %s sampler Algorithm S is not multithreaded\n",
+             tasknum, sampler->ops->name);
+    else
+      printf("task %u: Algorithm S using %u threads\n", tasknum,
+             num_threads_S);
+  }
+  if (num_threads_EE > 1) {
+    if (useIFDsampler || useTNTsampler || useMTMsampler ||
+        useConditionalEstimation || forbidReciprocity)
+      printf("task %u: Algorithm EE is only multithreaded for basic sampler "
+             "without conditional estimation or forbidReciprocity\n",
+             tasknum);
+    else
+      printf("task %u: Algorithm EE using %u threads\n", tasknum,
+             num_threads_EE);
+  }
+
+  if (adaptiveSamplerSteps)
+    printf("task %u: Algorithm EE adaptive samplerSteps in [%u, %u] "
+           "targetAutocorr = %g\n", tasknum, minSamplerSteps,
+           maxSamplerSteps, targetAutocorr);
+
+  if (stop->window > 0)
+    printf("task %u: Algorithm EE stops when over %u outer iterations "
+           "theta drift < %g and dzA t-ratio < %g\n", tasknum, stop->window,
+           stop->thetaDrift, stop->tRatio);
+  if (stop->maxSeconds > 0)
+    printf("task %u: Algorithm EE stops after %u s\n", tasknum,
+           stop->maxSeconds);
+
+  if (useConditionalEstimation)
+    printf("task %u: Doing conditional estimation of snowball sample\n",
+      tasknum);
+
+  if (forbidReciprocity)
+    printf("task %u: estimation is conditional on no reciprocated arcs\n",
+      tasknum);
+
+  /* steps of algorithm S (M1_steps */
+  /*uint_t M1 = (uint_t)(M1_steps *g->num_nodes / sampler_m);*/
+  /* just as for Msteps below, no longer scale by network size
+   * as that results in excessive values for very large networks */
+  uint_t M1 = M1_steps;
+  if (warm_start && warm_start->Ssteps > 0)
+    M1 = warm_start->Ssteps;
+
+  /* inner steps of Algorithm EE */
+  /*uint_t M = (uint_t)(Msteps *g->num_nodes / sampler_m);*/
+  /* as per email from Max 20 July 2018, better to have this as constant
+   * rather than scaled by network size */
+  uint_t M = Msteps;
+  
+
+
+  printf("task %u: M1 = %u, Mouter = %u, M = %u\n", tasknum, M1, Mouter, M);
+
+
+  if (restart) {
+    printf("task %u: restarting Algorithm EE from checkpoint at t = %u\n",
+           tasknum, restart->t);
+    memcpy(theta, restart->theta, n * sizeof(double));
+    memcpy(Dmean, restart->D0, n * sizeof(double));
+  } else if (warm_start && warm_start->num_D0 == n && warm_start->Ssteps == 0) {
+    printf("task %u: warm start from theta and D0 of a previous estimation, "
+           "skipping Algorithm S\n", tasknum);
+    memcpy(theta, warm_start->theta, n * sizeof(double));
+    memcpy(Dmean, warm_start->D0, n * sizeof(double));
+  } else {
+    if (warm_start) {
+      printf("task %u: warm start from theta of a previous estimation\n",
+             tasknum);
+      memcpy(theta, warm_start->theta, n * sizeof(double));
+    } else {
+      for (i = 0; i < n; i++)
+        theta[i] = 0;
+    }
+    printf("task %u: running Algorithm S...\n", tasknum);
+    gettimeofday(&start_timeval, NULL);
+    start_run_phase(metrics);
+
+    algorithm_S(g, sampler, M1, sampler_m, ACA_S, theta, Dmean, theta_outfile,
+                num_threads_S, heartbeat);
+
+    gettimeofday(&end_timeval, NULL);
+    timeval_subtract(&elapsed_timeval, &end_timeval, &start_timeval);
+    etime = 1000 * elapsed_timeval.tv_sec + elapsed_timeval.tv_usec/1000;
+    printf("task %u: Algorithm S took %.2f s\n", tasknum, (double)etime/1000);
+    end_run_phase(metrics, "algorithm_S", sampler->num_proposals,
+                  sampler->num_accepted);
+    if (warm_start) {
+      /* D0 from the end of the previous estimation is better than that
+         of a short Algorithm S */
+      for (i = 0; i < n; i++)
+        if (warm_start->D0[i] > 0)
+          Dmean[i] = warm_start->D0[i];
+    }
+  }
+  printf("task %u: theta = ", tasknum);
+  for (i = 0; i < n; i++) 
+    printf("%g ", theta[i]);
+  printf("\ntask %u: Dmean = ", tasknum);
+  for (i = 0; i < n; i++) 
+    printf("%g ", Dmean[i]);
+  printf("\n");
+  series_flush(theta_outfile);
+
+  if (!useBorisenkoUpdate) {
+    /* D0 not used for Borisenko et al. 2019 update theta algorithm in EE */
+    printf("\ntask %u: initial value of D0 for algorithm_EE = ", tasknum);
+    for (i = 0; i < n; i++) {
+      printf("%g ", Dmean[i]);
+    }
+    printf("\n");
+  }
+
+  /* but it is still useful to test for possible model degeneracy */
+  for (i = 0; i < n; i++) {
+    if (isinf(Dmean[i])) {
+      fprintf(stderr, "task %u: WARNING: D0 is NaN for parameter %d, "
+	      "model may be degenerate, not continuing this run\n", tasknum, i);
+      errcode = 1;
+    }
+  }
+  if (shared) {
+    /* the tasks sharing theta run Algorithm EE together or not at all */
+    failed = errcode != 0;
+    shared->comm->allreduce_sum(shared->comm->data, &failed, 1);
+    if (failed > 0)
+      errcode = 1;
+  }
+
+  if (errcode == 0) {
+    printf("task %u: running Algorithm EE...\n", tasknum);
+    gettimeofday(&start_timeval, NULL);
+    start_run_phase(metrics);
+    S_proposals = sampler->num_proposals;
+    S_accepted = sampler->num_accepted;
+
+    stop_reason = algorithm_EE(g, sampler, Mouter, M, sampler_m, ACA_EE, compC,
+                               Dmean, theta, theta_outfile, dzA_outfile,
+                               outputAllSteps, useBorisenkoUpdate,
+                               learningRate, minTheta, adaptiveSamplerSteps,
+                               minSamplerSteps, maxSamplerSteps,
+                               targetAutocorr, stop, shared,
+                               checkpoint_filename,
+                               checkpoint_interval, restart, theta_stats,
+                               batches, heartbeat);
+
+    gettimeofday(&end_timeval, NULL);
+    timeval_subtract(&elapsed_timeval, &end_timeval, &start_timeval);
+    etime = 1000 * elapsed_timeval.tv_sec + elapsed_timeval.tv_usec/1000;
+    printf("task %u: Algorithm EE took %.2f s\n", tasknum, (double)etime/1000);
+    printf("task %u: Algorithm EE stopped: %s\n", tasknum,
+           ee_stop_reason_name(stop_reason));
+    if (partition)
+      printf("task %u: fetched %.0f remote nodes, applied %.0f moves of "
+             "other tasks\n", tasknum, partition->num_fetched,
+             partition->num_remote_moves);
+    if (g->dyad_cache)
+      printf("task %u: dyad change statistics cache: %.0f hits, "
+             "%.0f misses\n", tasknum, g->dyad_cache->hits,
+             g->dyad_cache->misses);
+    printf("task %u: ", tasknum);
+    print_memory_summary(g);
+    end_run_phase(metrics, "algorithm_EE",
+                  sampler->num_proposals - S_proposals,
+                  sampler->num_accepted - S_accepted);
+    if (metrics)
+      metrics->stop_reason = ee_stop_reason_name(stop_reason);
+  }
+  if (final_D0)
+    memcpy(final_D0, Dmean, n * sizeof(double));
+  free_sampler(sampler);
+  free_sampler_workspace(ws);
+  free(Dmean);
+  return errcode;
+}
+
+/*
+ * Load the network (arcs, node attributes and snowball sampling zones)
+ * for estimation with the given configuration, as do_estimation() does,
+ * so that several estimations can use it (see do_estimation()) without
+ * each loading it again.
+ *
+ * Parameters:
+ *   config      - configuration settings
+ *   all_columns - if True load all the attribute columns, not only those
+ *                 the model of config refers to, so that models
+ *                 referring to other attributes can use it too
+ *
+ * Return value:
+ *   Loaded digraph, or NULL on error (message printed to stderr).
+ */
+digraph_t *load_estimation_digraph(const estim_config_t *config,
+                                   bool all_columns)
+{
+  digraph_t *g;
+
+  if (node_order_from_name(config->nodeOrder) == NODE_ORDER_INVALID) {
+    fprintf(stderr, "ERROR: unknown nodeOrder %s (must be none, degree, "
+            "rcm or zone)\n", config->nodeOrder);
+    return NULL;
+  }
+  if (!(g = allocate_estimation_digraph(config, load_attributes, FALSE,
+                                        all_columns)))
+    return NULL;
+  if (load_estimation_arcs(config, g, FALSE, 0, NULL, NULL, NULL, TRUE,
+                           NULL, TRUE)) {
+    free_digraph(g);
+    return NULL;
+  }
+  return g;
+}
+
+/* preflight timing runs are at least this long (seconds) */
+#define PREFLIGHT_MIN_SECONDS 0.5
+/* preflight runs performing moves have this fraction of the arcs as
+   proposals, but at least PREFLIGHT_MIN_MOVES */
+#define PREFLIGHT_MOVE_FRACTION 0.05
+#define PREFLIGHT_MIN_MOVES     100
+
+/*
+ * Time a sampler on g without performing moves: run it for more and
+ * more proposals (doubling each time) until one run takes at least
+ * PREFLIGHT_MIN_SECONDS.
+ *
+ * Parameters:
+ *   sampler     - sampler (initialized) for the model
+ *   g           - digraph
+ *   theta       - parameter values
+ *
+ * Return value:
+ *   Elapsed time per proposal (seconds) of the last run.
+ */
+static double time_sampler_proposals(sampler_t *sampler, digraph_t *g,
+                                     double theta[])
+{
+  struct timeval start_timeval, end_timeval, elapsed_timeval;
+  double         seconds;
+  uint_t         sampler_m = 1000;
+
+  for (;;) {
+    gettimeofday(&start_timeval, NULL);
+    (void)sampler_run(sampler, g, theta, sampler->ws->addChangeStats,
+                      sampler->ws->delChangeStats, sampler_m, FALSE);
+    gettimeofday(&end_timeval, NULL);
+    timeval_subtract(&elapsed_timeval, &end_timeval, &start_timeval);
+    seconds = elapsed_timeval.tv_sec + elapsed_timeval.tv_usec / 1e6;
+    if (seconds >= PREFLIGHT_MIN_SECONDS || sampler_m > UINT_MAX / 2)
+      return seconds / sampler_m;
+    sampler_m *= 2;
+  }
+}
+
+/*
+ * Time a sampler on g performing moves. As the moves change the
+ * network, each run of sampler_m proposals starts from a new copy of
+ * g, and runs are repeated until they take at least
+ * PREFLIGHT_MIN_SECONDS in all.
+ *
+ * Parameters:
+ *   sampler     - sampler for the model
+ *   g           - digraph (not changed)
+ *   theta       - parameter values
+ *   sampler_m   - number of proposals in each run
+ *
+ * Return value:
+ *   Elapsed time per proposal (seconds) of all the runs.
+ */
+static double time_sampler_moves(sampler_t *sampler, const digraph_t *g,
+                                 double theta[], uint_t sampler_m)
+{
+  struct timeval start_timeval, end_timeval, elapsed_timeval;
+  double         seconds = 0, proposals = 0;
+  digraph_t     *h;
+
+  while (seconds < PREFLIGHT_MIN_SECONDS) {
+    h = clone_digraph(g);
+    sampler_init(sampler, h, 0);
+    gettimeofday(&start_timeval, NULL);
+    (void)sampler_run(sampler, h, theta, sampler->ws->addChangeStats,
+                      sampler->ws->delChangeStats, sampler_m, TRUE);
+    gettimeofday(&end_timeval, NULL);
+    timeval_subtract(&elapsed_timeval, &end_timeval, &start_timeval);
+    seconds += elapsed_timeval.tv_sec + elapsed_timeval.tv_usec / 1e6;
+    proposals += sampler_m;
+    free_digraph(h);
+  }
+  return seconds / proposals;
+}
+
+/*
+ * Check the degreeProposalWeight setting against the sampler and the
+ * other settings (see degreeProposalSampler()).
+ *
+ * Parameters:
+ *   config - configuration settings
+ *
+ * Return value:
+ *   0 if OK else -1 (message printed to stderr).
+ */
+static int check_degree_proposal_config(const estim_config_t *config)
+{
+  if (config->degreeProposalWeight < 0 || config->degreeProposalWeight > 1) {
+    fprintf(stderr, "ERROR: degreeProposalWeight must be in [0, 1]\n");
+    return -1;
+  }
+  if (config->degreeProposalWeight > 0 &&
+      (config->useIFDsampler || config->useTNTsampler ||
+       config->useMTMsampler || config->useConditionalEstimation ||
+       config->forbidReciprocity || config->network_list_filename ||
+       config->partitionGraph || config->numThreadsEE > 1)) {
+    fprintf(stderr, "ERROR: degreeProposalWeight can only be used with the "
+            "basic sampler, without useConditionalEstimation, "
+            "forbidReciprocity, networkListFile, partitionGraph or "
+            "numThreadsEE\n");
+    return -1;
+  }
+  return 0;
+}
+
+/*
+ * Estimate the cost of an estimation before running it: load the
+ * network of the configuration (without building any two-path tables),
+ * write its size and degrees, the memory of the network and of the
+ * two-path tables with each backend, and the backend the estimation
+ * would choose, then build the tables of that backend and time the
+ * sampler of the model on the network (with all parameters zero, the
+ * starting point of Algorithm S), and write the projected time of the
+ * configured steps of Algorithm S, Algorithm EE and post-estimation
+ * simulation. For the basic sampler the time with moves performed is
+ * also measured with increasing numbers of threads (as numThreadsEE),
+ * relative to one thread, and the fastest recommended. With all
+ * parameters zero nearly every move is accepted, so these runs are kept
+ * short (PREFLIGHT_MOVE_FRACTION of the arcs) and start from copies of
+ * the network; only their ratios are used.
+ *
+ * Parameters:
+ *   config - configuration settings
+ *
+ * Return value:
+ *   0 if OK else -1 on error (message printed to stderr).
+ */
+int do_preflight(estim_config_t *config)
 {
+  const double   MB = 1024.0 * 1024.0;
+  const param_config_t *pc = &config->param_config;
   struct timeval start_timeval, end_timeval, elapsed_timeval;
-  int            etime;
-  uint_t         i;
-  int            errcode = 0;
+  double         load_seconds, build_seconds = 0;
+  double         proposal_seconds, move_seconds = 0, best_seconds, seconds;
+  double         S_proposals, EE_proposals, post_proposals, total;
+  digraph_t     *g;
+  digraph_memory_t mem;
+  uint_t         num_param, v, max_indeg = 0, max_outdeg = 0;
+  uint_t         num_threads, best_threads = 1, max_threads, move_m;
+  double        *theta;
+  sampler_workspace_t *ws;
+  sampler_model_t   model;
+  sampler_options_t options;
+  sampler_t        *sampler;
+  sampler_type_e    type;
+  prng_t            prng;
+#ifdef TWOPATH_ADAPTIVE
+  twopath_memory_estimate_t est;
+  twopath_backend_e backend = twopath_backend_from_name(config->twoPathBackend);
+#endif /* TWOPATH_ADAPTIVE */
 
-  /*array of n derivative estimate values corresponding to theta. */  
-  double *Dmean = (double *)safe_malloc(n*sizeof(double));
+  if (config->useIFDsampler + config->useTNTsampler +
+      config->useMTMsampler > 1) {
+    fprintf(stderr, "ERROR: Only one of the useIFDsampler,"
+	     " useTNTsampler and useMTMsampler options may be used\n");
+    return -1;
+  }
+  if (check_degree_proposal_config(config))
+    return -1;
+  if (node_order_from_name(config->nodeOrder) == NODE_ORDER_INVALID) {
+    fprintf(stderr, "ERROR: unknown nodeOrder %s (must be none, degree, "
+            "rcm or zone)\n", config->nodeOrder);
+    return -1;
+  }
+  if (config->seed != 0)
+    set_prng_seed(config->seed);
 
-  assert(!(useIFDsampler && useTNTsampler));
-    
-  if (useBorisenkoUpdate) {
-    printf("task %u:  ACA_S = %g, Borisenko update learningRate = %g, "
-           "minTheta = %g, samplerSteps = %u, "
-           "Ssteps = %u, EEsteps = %u, EEinnerSteps = %u\n", tasknum,
-           ACA_S, learningRate, minTheta, sampler_m, M1_steps, Mouter, Msteps);
-  } else {
-    printf("task %u: ACA_S = %g, ACA_EE = %g, compC = %g, samplerSteps = %u, "
-           "Ssteps = %u, EEsteps = %u, EEinnerSteps = %u\n", tasknum,
-           ACA_S, ACA_EE, compC, sampler_m, M1_steps, Mouter, Msteps);
+  gettimeofday(&start_timeval, NULL);
+  if (!(g = allocate_estimation_digraph(config, load_attributes, FALSE,
+                                        FALSE)))
+    return -1;
+  if (build_attr_indices_from_names(&config->param_config, g) != 0 ||
+      build_dyadic_indices_from_names(&config->param_config, g, FALSE) != 0 ||
+      build_attr_interaction_pair_indices_from_names(&config->param_config,
+                                                     g) != 0) {
+    fprintf(stderr, "ERROR in attribute parameters\n");
+    free_digraph(g);
+    return -1;
   }
-    
-  if (useIFDsampler)
-    printf("task %u: IFD sampler ifd_K = %g, arcCorrection = %g\n",
-           tasknum, ifd_K, arcCorrection(g));
-  else if (useTNTsampler)
-    printf("task %u: TNT sampler\n", tasknum);
+  num_param = pc->num_change_stats_funcs + pc->num_attr_change_stats_funcs +
+    pc->num_dyadic_change_stats_funcs +
+    pc->num_attr_interaction_change_stats_funcs;
+  if (load_estimation_arcs(config, g, FALSE, 0, NULL, NULL, NULL, FALSE,
+                           NULL, FALSE)) {
+    free_digraph(g);
+    return -1;
+  }
+  gettimeofday(&end_timeval, NULL);
+  timeval_subtract(&elapsed_timeval, &end_timeval, &start_timeval);
+  load_seconds = elapsed_timeval.tv_sec + elapsed_timeval.tv_usec / 1e6;
 
-  if (useConditionalEstimation)
-    printf("task %u: Doing conditional estimation of snowball sample\n",
-      tasknum);
+  for (v = 0; v < g->num_nodes; v++) {
+    max_indeg = MAX(max_indeg, g->indegree[v]);
+    max_outdeg = MAX(max_outdeg, g->outdegree[v]);
+  }
+  printf("\npreflight: %u nodes, %lu arcs, density %g, mean degree %g, "
+         "max in-degree %u, max out-degree %u, %u parameters\n",
+         g->num_nodes, (unsigned long)g->num_arcs, density(g),
+         g->num_nodes ? (double)g->num_arcs / g->num_nodes : 0,
+         max_indeg, max_outdeg, num_param);
+  printf("preflight: loading took %.2f s\n", load_seconds);
+  digraph_memory_usage(g, &mem);
+  printf("preflight: network memory %.1f MB (shared attributes %.1f MB "
+         "not included)\n", mem.total / MB, mem.shared_attributes / MB);
+  if (config->dyadCacheMB > 0)
+    printf("preflight: dyad change statistics cache would take %.1f MB\n",
+           dyad_cache_bytes(g->num_nodes, num_param) / MB);
 
-  if (forbidReciprocity)
-    printf("task %u: estimation is conditional on no reciprocated arcs\n",
-      tasknum);
+#ifdef TWOPATH_ADAPTIVE
+  estimate_twopath_memory(g, 0, &est);
+  printf("preflight: estimated two-path tables (%.0f nonzero counts):\n"
+         "  arrays %.1f MB, hashtables %.1f MB, pernode %.1f MB, "
+         "none 0 MB\n", est.twopaths, est.arrays / MB, est.hashtables / MB,
+         est.pernode / MB);
+  if (backend == TWOPATH_BACKEND_AUTO) {
+    backend = choose_twopath_backend(g, 0, config->maxMemoryMB);
+    printf("preflight: recommended two-path backend within maxMemoryMB = "
+           "%u: %s\n", config->maxMemoryMB, twopath_backend_name(backend));
+  } else {
+    printf("preflight: configured two-path backend: %s\n",
+           twopath_backend_name(backend));
+  }
+  if (backend == TWOPATH_BACKEND_HYBRID)
+    set_twopath_hub_cutoff(g, choose_twopath_hub_cutoff(g,
+                                                        config->maxMemoryMB));
+  gettimeofday(&start_timeval, NULL);
+  set_twopath_backend(g, backend);
+  gettimeofday(&end_timeval, NULL);
+  timeval_subtract(&elapsed_timeval, &end_timeval, &start_timeval);
+  build_seconds = elapsed_timeval.tv_sec + elapsed_timeval.tv_usec / 1e6;
+  digraph_memory_usage(g, &mem);
+  printf("preflight: building two-path tables took %.2f s, network memory "
+         "now %.1f MB\n", build_seconds, mem.total / MB);
+#endif /* TWOPATH_ADAPTIVE */
+  if (config->numChains > 1)
+    printf("preflight: %u chains (processes) take %.1f MB\n",
+           config->numChains, config->numChains * mem.total / MB +
+           mem.shared_attributes / MB);
 
-  /* steps of algorithm S (M1_steps */
-  /*uint_t M1 = (uint_t)(M1_steps *g->num_nodes / sampler_m);*/
-  /* just as for Msteps below, no longer scale by network size
-   * as that results in excessive values for very large networks */
-  uint_t M1 = M1_steps;
+  /* time the sampler of the model with all parameters zero */
+  theta = (double *)safe_calloc(num_param, sizeof(double));
+  ws = allocate_sampler_workspace(num_param);
+  prng_init_stream(&prng, 0);
+  model.n = num_param;
+  model.n_attr = pc->num_attr_change_stats_funcs;
+  model.n_dyadic = pc->num_dyadic_change_stats_funcs;
+  model.n_attr_interaction = pc->num_attr_interaction_change_stats_funcs;
+  model.change_stats_funcs = pc->change_stats_funcs;
+  model.lambda_values = pc->param_lambdas;
+  model.attr_change_stats_funcs = pc->attr_change_stats_funcs;
+  model.dyadic_change_stats_funcs = pc->dyadic_change_stats_funcs;
+  model.attr_interaction_change_stats_funcs =
+    pc->attr_interaction_change_stats_funcs;
+  model.attr_indices = pc->attr_indices;
+  model.attr_interaction_pair_indices = pc->attr_interaction_pair_indices;
+  options.ifd_K = config->ifd_K;
+  options.useConditionalEstimation = config->useConditionalEstimation;
+  options.forbidReciprocity = config->forbidReciprocity;
+  options.num_threads = 1;
+  options.mtm_tries = config->mtmTries;
+  options.earlyReject = config->earlyReject;
+  options.degreeProposalWeight = config->degreeProposalWeight;
+  options.partition = NULL;
+  set_change_stats_caches(g, pc->num_change_stats_funcs,
+                          pc->change_stats_funcs, pc->param_lambdas,
+                          model.n_attr, model.attr_change_stats_funcs,
+                          model.attr_indices, model.n_attr_interaction,
+                          model.attr_interaction_change_stats_funcs,
+                          model.attr_interaction_pair_indices);
+  type = get_sampler_type(config->useIFDsampler, config->useTNTsampler,
+                          config->useMTMsampler);
+  sampler = allocate_sampler(type, &model, &options, &prng, ws);
+  sampler_init(sampler, g, 0);
+  proposal_seconds = time_sampler_proposals(sampler, g, theta);
+  free_sampler(sampler);
+  printf("preflight: %.3g us per proposal\n", proposal_seconds * 1e6);
 
-  /* inner steps of Algorithm EE */
-  /*uint_t M = (uint_t)(Msteps *g->num_nodes / sampler_m);*/
-  /* as per email from Max 20 July 2018, better to have this as constant
-   * rather than scaled by network size */
-  uint_t M = Msteps;
-  
+  /* the threaded basic sampler is only used when moves are performed,
+     and with all parameters zero the moves make the network denser, so
+     only the speedup over one thread is measured, and applied to the
+     time per proposal without moves (as the network stays close to the
+     observed one in Algorithm EE) */
+  best_seconds = proposal_seconds;
+  max_threads = (uint_t)get_num_cores();
+  if (type == SAMPLER_BASIC && !config->useConditionalEstimation &&
+      !config->forbidReciprocity && max_threads > 1) {
+    move_m = MAX(PREFLIGHT_MIN_MOVES,
+                 (uint_t)(PREFLIGHT_MOVE_FRACTION * g->num_arcs));
+    for (num_threads = 1; num_threads <= max_threads; num_threads *= 2) {
+      options.num_threads = num_threads;
+      sampler = allocate_sampler(type, &model, &options, &prng, ws);
+      seconds = time_sampler_moves(sampler, g, theta, move_m);
+      free_sampler(sampler);
+      if (num_threads == 1)
+        move_seconds = seconds;
+      printf("preflight: %u threads speedup %.2f with moves performed\n",
+             num_threads, move_seconds / seconds);
+      if (proposal_seconds * seconds / move_seconds < best_seconds) {
+        best_seconds = proposal_seconds * seconds / move_seconds;
+        best_threads = num_threads;
+      }
+    }
+  }
+  printf("preflight: recommended numThreadsEE = %u, numThreadsS = %u "
+         "(%u cores)\n", best_threads, max_threads, max_threads);
 
+  /* Algorithm S does not perform moves, and its proposals are divided
+     between numThreadsS threads */
+  S_proposals = (double)config->Ssteps * config->samplerSteps;
+  EE_proposals = (double)config->EEsteps * config->EEinnerSteps *
+    config->samplerSteps;
+  post_proposals = config->postSimSamples > 0 ?
+    (double)config->postSimBurnin +
+    (double)config->postSimSamples * config->postSimInterval : 0;
+  total = load_seconds + build_seconds +
+    S_proposals * proposal_seconds / MAX(config->numThreadsS, 1) +
+    post_proposals * proposal_seconds;
+  printf("preflight: Algorithm S %.3g proposals, Algorithm EE %.3g "
+         "proposals, post-estimation %.3g proposals\n",
+         S_proposals, EE_proposals, post_proposals);
+  printf("preflight: projected time with samplerSteps = %u%s:\n",
+         config->samplerSteps, config->adaptiveSamplerSteps ?
+         " (initial value, adaptiveSamplerSteps changes it)" : "");
+  printf("  %.0f s (%.2f h) with numThreadsEE = 1, "
+         "%.0f s (%.2f h) with numThreadsEE = %u\n",
+         total + EE_proposals * proposal_seconds,
+         (total + EE_proposals * proposal_seconds) / 3600,
+         total + EE_proposals * best_seconds,
+         (total + EE_proposals * best_seconds) / 3600, best_threads);
 
-  printf("task %u: M1 = %u, Mouter = %u, M = %u\n", tasknum, M1, Mouter, M);
+  free_sampler_workspace(ws);
+  free(theta);
+  free_digraph(g);
+  return 0;
+}
 
+/*
+ * Run ee_estimate() on g with the model and settings of the configuration.
+ *
+ * Parameters:
+ *   config - configuration settings (attribute indices already built)
+ *   g - digraph to estimate on (modified by the sampler)
+ *   num_param - number of parameters
+ *   theta - (in/out) parameter values, set to the estimates
+ *   tasknum - task number
+ *   theta_outfile, dzA_outfile - writers for the theta and dzA series
+ *   stop - early termination criteria for Algorithm EE
+ *   shared - tasks stepping a shared theta, or NULL
+ *   checkpoint_filename, checkpoint_interval - checkpoints of Algorithm EE
+ *   restart - checkpoint to continue from, or NULL
+ *   warm_start - starting values from a previous estimation, or NULL
+ *   final_D0 - (out) if not NULL, D0 at the end of Algorithm EE
+ *   theta_stats, batches, metrics, heartbeat, partition - as for
+ *                       ee_estimate(), each may be NULL
+ *
+ * Return value:
+ *   As ee_estimate().
+ */
+static int run_ee_estimate(const estim_config_t *config, digraph_t *g,
+                           uint_t num_param, double theta[], uint_t tasknum,
+                           series_writer_t *theta_outfile,
+                           series_writer_t *dzA_outfile,
+                           const ee_stop_criteria_t *stop,
+                           const ee_shared_theta_t *shared,
+                           const char *checkpoint_filename,
+                           uint_t checkpoint_interval,
+                           const ee_checkpoint_t *restart,
+                           const ee_warm_start_t *warm_start,
+                           double final_D0[],
+                           online_stats_t *theta_stats,
+                           ee_batches_t *batches, run_metrics_t *metrics,
+                           heartbeat_t *heartbeat,
+                           digraph_partition_t *partition)
+{
+  const param_config_t *pconfig = &config->param_config;
 
-  printf("task %u: running Algorithm S...\n", tasknum);
-  gettimeofday(&start_timeval, NULL);
+  return ee_estimate(g, num_param, pconfig->num_attr_change_stats_funcs,
+                     pconfig->num_dyadic_change_stats_funcs,
+                     pconfig->num_attr_interaction_change_stats_funcs,
+                     pconfig->change_stats_funcs,
+                     pconfig->param_lambdas,
+                     pconfig->attr_change_stats_funcs,
+                     pconfig->dyadic_change_stats_funcs,
+                     pconfig->attr_interaction_change_stats_funcs,
+                     pconfig->attr_indices,
+                     pconfig->attr_interaction_pair_indices,
+                     config->samplerSteps, config->Ssteps,
+                     config->EEsteps, config->EEinnerSteps,
+                     config->ACA_S, config->ACA_EE, config->compC,
+                     theta, tasknum, theta_outfile, dzA_outfile,
+                     config->outputAllSteps,
+                     config->useIFDsampler, config->ifd_K,
+                     config->useConditionalEstimation,
+                     config->forbidReciprocity,
+                     config->useBorisenkoUpdate, config->learningRate,
+                     config->minTheta, config->useTNTsampler,
+                     config->useMTMsampler, config->mtmTries,
+                     config->earlyReject, config->degreeProposalWeight,
+                     partition,
+                     config->numThreadsS, config->numThreadsEE,
+                     config->adaptiveSamplerSteps, config->minSamplerSteps,
+                     config->maxSamplerSteps, config->targetAutocorr, stop,
+                     shared, checkpoint_filename, checkpoint_interval, restart,
+                     warm_start, final_D0, theta_stats, batches, metrics,
+                     heartbeat);
+}
 
-  algorithm_S(g, n, n_attr, n_dyadic, n_attr_interaction, change_stats_funcs,
-              attr_change_stats_funcs, dyadic_change_stats_funcs,
-              attr_interaction_change_stats_funcs,
-              attr_indices, attr_interaction_pair_indices,
-              M1, sampler_m, ACA_S, theta, Dmean, theta_outfile, useIFDsampler,
-              ifd_K, useConditionalEstimation, forbidReciprocity,
-	      useTNTsampler);
+/* what estimate_bootstrap_replicate() needs to estimate a replicate */
+typedef struct replicate_settings_s {
+  const estim_config_t *config;
+  uint_t               num_param;
+  uint_t               tasknum;
+  ee_stop_criteria_t   stop;  /* as the task's but with no collective test */
+} replicate_settings_t;
 
-  gettimeofday(&end_timeval, NULL);
-  timeval_subtract(&elapsed_timeval, &end_timeval, &start_timeval);
-  etime = 1000 * elapsed_timeval.tv_sec + elapsed_timeval.tv_usec/1000;
-  printf("task %u: Algorithm S took %.2f s\n", tasknum, (double)etime/1000);
-  printf("task %u: theta = ", tasknum);
-  for (i = 0; i < n; i++) 
-    printf("%g ", theta[i]);
-  printf("\ntask %u: Dmean = ", tasknum);
-  for (i = 0; i < n; i++) 
-    printf("%g ", Dmean[i]);
-  printf("\n");
-  fflush(theta_outfile);
+/*
+ * Estimate the model on a parametric bootstrap replicate network (called
+ * from post_estimation(), see postEstimation.h) in the same way as the
+ * task estimates it on the observed network, but discarding the theta
+ * and dzA series and taking the estimates from their summary.
+ *
+ * Parameters:
+ *   g - the replicate network (modified)
+ *   theta - (in/out) starting parameter values, set to the estimates
+ *   data - pointer to replicate_settings_t
+ *
+ * Return value:
+ *   0 if OK, nonzero if the estimates cannot be used.
+ */
+static int estimate_bootstrap_replicate(digraph_t *g, double theta[],
+                                        void *data)
+{
+  const replicate_settings_t *rep = (const replicate_settings_t *)data;
+  series_writer_t *theta_outfile = open_series_writer(NULL, FALSE, FALSE, "");
+  series_writer_t *dzA_outfile = open_series_writer(NULL, FALSE, FALSE, "");
+  ee_batches_t     batches;
+  chain_summary_t  summary;
+  int              rc;
 
-  if (!useBorisenkoUpdate) {
-    /* D0 not used for Borisenko et al. 2019 update theta algorithm in EE */
-    printf("\ntask %u: initial value of D0 for algorithm_EE = ", tasknum);
-    for (i = 0; i < n; i++) {
-      printf("%g ", Dmean[i]);
-    }
-    printf("\n");
-  }
+  init_ee_batches(&batches, rep->num_param, rep->config->EEsteps);
+  rc = run_ee_estimate(rep->config, g, rep->num_param, theta, rep->tasknum,
+                       theta_outfile, dzA_outfile, &rep->stop, NULL, NULL, 0,
+                       NULL, NULL, NULL,
+                       NULL, &batches, NULL, NULL, NULL);
+  close_series_writer(theta_outfile);
+  close_series_writer(dzA_outfile);
+  memset(&summary, 0, sizeof(summary));
+  init_chain_summary(&summary, rep->num_param);
+  if (rc == 0 && !compute_chain_summary(&batches, &summary))
+    memcpy(theta, summary.est, rep->num_param * sizeof(double));
+  else
+    rc = -1;
+  free_chain_summary(&summary);
+  free_ee_batches(&batches);
+  return rc;
+}
 
-  /* but it is still useful to test for possible model degeneracy */
-  for (i = 0; i < n; i++) {
-    if (isinf(Dmean[i])) {
-      fprintf(stderr, "task %u: WARNING: D0 is NaN for parameter %d, "
-	      "model may be degenerate, not continuing this run\n", tasknum, i);
-      errcode = 1;
-    }
+/*
+ * Check that the settings of a configuration can be used with a
+ * network partitioned between tasks (partitionGraph). The tasks run a
+ * single chain in step, so nothing can depend on the whole network
+ * being in one task, or on anything (such as the time) that could
+ * differ between tasks.
+ *
+ * Parameters:
+ *   config - configuration settings
+ *
+ * Return value:
+ *   0 if OK else -1 (message printed to stderr).
+ */
+static int check_partition_config(const estim_config_t *config)
+{
+  if (!config->arclist_filename || config->snapshot_filename ||
+      config->network_list_filename ||
+      arclist_format_from_name(config->arclistFormat) !=
+      ARCLIST_FORMAT_PAJEK) {
+    fprintf(stderr, "ERROR: partitionGraph requires a Pajek format "
+            "arclistFile (not snapshotFile or networkListFile)\n");
+    return -1;
   }
+  if (config->useIFDsampler || config->useTNTsampler ||
+      config->useMTMsampler || config->useConditionalEstimation ||
+      config->zone_filename || config->forbidReciprocity) {
+    fprintf(stderr, "ERROR: partitionGraph cannot be used with "
+            "useIFDsampler, useTNTsampler, useMTMsampler, "
+            "useConditionalEstimation, zoneFile or forbidReciprocity\n");
+    return -1;
+  }
+  if (node_order_from_name(config->nodeOrder) != NODE_ORDER_NONE ||
+      config->computeStats || config->write_snapshot_filename ||
+      config->outputSimulatedNetwork) {
+    fprintf(stderr, "ERROR: partitionGraph cannot be used with nodeOrder, "
+            "computeStats, writeSnapshotFile or outputSimulatedNetwork\n");
+    return -1;
+  }
+  if (config->EEmaxSeconds > 0 || config->EEcollectiveInterval > 0 ||
+      config->checkpointInterval > 0 || config->restartFromCheckpoint ||
+      config->postSimSamples > 0 || config->EEsharedThetaInterval > 0) {
+    fprintf(stderr, "ERROR: partitionGraph cannot be used with "
+            "EEmaxSeconds, EEcollectiveInterval, checkpointInterval, "
+            "restartFromCheckpoint, postSimSamples or "
+            "EEsharedThetaInterval\n");
+    return -1;
+  }
+  return 0;
+}
 
-  if (errcode == 0) {
-    printf("task %u: running Algorithm EE...\n", tasknum);
-    gettimeofday(&start_timeval, NULL);
-
-    algorithm_EE(g, n, n_attr, n_dyadic, n_attr_interaction,
-                 change_stats_funcs, 
-		 attr_change_stats_funcs, dyadic_change_stats_funcs,
-                 attr_interaction_change_stats_funcs,
-                 attr_indices, attr_interaction_pair_indices,
-		 Mouter, M, sampler_m, ACA_EE, compC,
-		 Dmean, theta, theta_outfile, dzA_outfile, outputAllSteps,
-		 useIFDsampler, ifd_K, useConditionalEstimation,
-		 forbidReciprocity, useBorisenkoUpdate, learningRate,
-                 minTheta, useTNTsampler);
+/*
+ * Largest number of values the theta and dzA series of an estimation
+ * with the given configuration can have (one record for each step of
+ * Algorithm S and each outer iteration, or with outputAllSteps inner
+ * iteration, of Algorithm EE), e.g. to size the regions of the
+ * seriesContainerFile. The number of parameters is taken from the
+ * configuration as parsed, before any are dropped for the network.
+ *
+ * Parameters:
+ *   config       - configuration settings
+ *   theta_values - (out) values in the theta series
+ *   dzA_values   - (out) values in the dzA series
+ *
+ * Return value:
+ *   None.
+ */
+void estimation_series_capacity(const estim_config_t *config,
+                                size_t *theta_values, size_t *dzA_values)
+{
+  const param_config_t *pconfig = &config->param_config;
+  size_t num_param = pconfig->num_change_stats_funcs +
+    pconfig->num_attr_change_stats_funcs +
+    pconfig->num_dyadic_change_stats_funcs +
+    pconfig->num_attr_interaction_change_stats_funcs +
+    (config->useIFDsampler ? 1 : 0); /* IFD Arc column */
+  size_t EE_records = (size_t)config->EEsteps *
+    (config->outputAllSteps ? config->EEinnerSteps : 1);
+  size_t S_records = MAX(config->Ssteps, config->warmStartSsteps);
 
-    gettimeofday(&end_timeval, NULL);
-    timeval_subtract(&elapsed_timeval, &end_timeval, &start_timeval);
-    etime = 1000 * elapsed_timeval.tv_sec + elapsed_timeval.tv_usec/1000;
-    printf("task %u: Algorithm EE took %.2f s\n", tasknum, (double)etime/1000);
-  }
-  free(Dmean);
-  return errcode;
+  /* t, the parameters and AcceptanceRate; t and the parameters */
+  *theta_values = (S_records + EE_records) * (num_param + 2);
+  *dzA_values = EE_records * (num_param + 1);
 }
 
 /*
@@ -687,53 +2402,148 @@ int ee_estimate(digraph_t *g, uint_t n, uint_t n_attr, uint_t n_dyadic,
  *   config - (in/out)configuration settings structure  - this is modified
  *            by calling build_attr_indices_from_names() etc.
  *   tasknum - task number (MPI rank)
+ *   load_attrs - function to load the node attributes into the digraph,
+ *            load_attributes() or one that shares them between
+ *            processes (EstimNetDirected_mpi with sharedAttributes)
+ *   network - if not NULL, the digraph loaded (with the settings in this
+ *            configuration) by load_estimation_digraph(), which is used
+ *            (and modified and freed) instead of loading it here, in
+ *            which case load_attrs is not used
+ *   collective_stop - function combining the Algorithm EE stop tests of
+ *            all the tasks (EstimNetDirected_mpi), used if
+ *            EEcollectiveInterval is nonzero, or NULL for none
+ *   summary - (Out) if not NULL, summary of the estimates of this task
+ *            (see estimSummary.h), allocated here unless there is an
+ *            error first; the caller zeroes it before and frees it with
+ *            free_chain_summary() after
+ *   theta_series - (Out) if not NULL, the theta series is kept here
+ *            (instead of written to the thetaFilePrefix file), to be
+ *            freed with free_series_data()
+ *   dzA_series - (Out) if not NULL, the dzA series is kept here
+ *            (instead of written to the dzAFilePrefix file), to be
+ *            freed with free_series_data()
+ *   theta_sink, dzA_sink - (in/out) if not NULL (and theta_series and
+ *            dzA_series are NULL), the theta and dzA series are written
+ *            to these regions of a shared file (seriesContainerFile)
+ *            instead of to the thetaFilePrefix and dzAFilePrefix files,
+ *            see open_sink_series_writer()
+ *   partition_comm - communication between the tasks
+ *            (EstimNetDirected_mpi) for partitionGraph, in which case
+ *            every task calls this with the same configuration, and
+ *            they run one chain on the network partitioned between
+ *            them (see digraphPartition.h), only task 0 writing the
+ *            theta and dzA files; and for EEsharedThetaInterval; or NULL
  *
  * Return value:
  *    0 if OK else -ve value for error.
  */
-int do_estimation(estim_config_t * config, uint_t tasknum)
+int do_estimation(estim_config_t * config, uint_t tasknum,
+                  load_attributes_func_t *load_attrs, digraph_t *network,
+                  ee_collective_stop_func_t *collective_stop,
+                  chain_summary_t *summary, series_data_t *theta_series,
+                  series_data_t *dzA_series, series_sink_t *theta_sink,
+                  series_sink_t *dzA_sink,
+                  const partition_comm_t *partition_comm)
 {
-  struct timeval start_timeval, end_timeval, elapsed_timeval;
-  int            etime;
-  FILE          *arclist_file;
-  digraph_t     *g;
-  uint_t         num_nodes;
+  digraph_t     *g = network;
   uint_t         i;
-  FILE          *theta_outfile;
-  FILE          *dzA_outfile;
+  series_writer_t *theta_outfile;
+  series_writer_t *dzA_outfile;
   FILE          *sim_outfile;
   FILE          *obs_stats_outfile = NULL;
   char           theta_outfilename[PATH_MAX+1];
   char           dzA_outfilename[PATH_MAX+1];
   char           sim_outfilename[PATH_MAX+1];
   char           obs_stats_outfilename[PATH_MAX+1];
+  char           checkpoint_filename[PATH_MAX+1];
+  ee_checkpoint_t restart;
+  FILE          *theta_cov_outfile;
+  char           theta_cov_outfilename[PATH_MAX+1];
+  online_stats_t theta_stats;
+  ee_batches_t   batches;
+  uint_t         j;
+  const char    *theta_names;
+  const char    *reason;
+#ifdef PROFILE_CHANGESTATS
+  char           profile_prefix[32];
+#endif /* PROFILE_CHANGESTATS */
   char           suffix[16]; /* only has to be large enough for "_xx.txt" 
                                 where xx is tasknum */
+  char           series_suffix[16]; /* as suffix for theta and dzA files */
   uint_t         n_struct, n_attr, n_dyadic, n_attr_interaction, num_param;
   double        *theta;
   double        *graphStats = NULL;
 #define HEADER_MAX 65536
-  char fileheader[HEADER_MAX];
+  char fileheader[HEADER_MAX] = ""; /* appended to, so must start empty
+                                      on every call (the library calls
+                                      this repeatedly) */
+  char series_header[HEADER_MAX+32]; /* fileheader with t etc. */
   /* only compute the observed sufficient statistics in task 0 */
   bool          computeStats = config->computeStats && tasknum == 0;
   bool          first_header_field = TRUE;
+  node_order_e  node_order = node_order_from_name(config->nodeOrder);
+  ee_stop_criteria_t stop; /* early termination criteria for Algorithm EE */
+  ee_shared_theta_t  shared; /* tasks stepping a shared theta */
+  run_metrics_t  run_metrics;
+  run_metrics_t *metrics = config->metrics_file_prefix ? &run_metrics : NULL;
+  char           metrics_filename[PATH_MAX+1];
+  heartbeat_t    run_heartbeat;
+  heartbeat_t   *heartbeat = config->heartbeat_file_prefix ? &run_heartbeat :
+    NULL;
+  char           heartbeat_filename[PATH_MAX+1];
+  chain_summary_t post_summary; /* summary if none asked for, to simulate
+                                   from in the post-estimation phase */
+  replicate_settings_t replicate;
+  ee_warm_start_t warm_start; /* starting values from warmStartFile */
+  double        *final_D0 = NULL; /* D0 at end, for writeWarmStartFilePrefix */
+  char           warm_start_filename[PATH_MAX+1];
+  digraph_partition_t *partition = NULL;
+  /* with a partitioned network the tasks run one chain, written by task 0 */
+  bool          writeSeries = !config->partitionGraph || tasknum == 0;
+
+  init_run_metrics(metrics);
 
-  if (!(arclist_file = fopen(config->arclist_filename, "r"))) {
-    fprintf(stderr, "error opening file %s (%s)\n", 
-            config->arclist_filename, strerror(errno));
+  if (node_order == NODE_ORDER_INVALID) {
+    fprintf(stderr, "ERROR: unknown nodeOrder %s (must be none, degree, "
+            "rcm or zone)\n", config->nodeOrder);
     return -1;
   }
-  num_nodes = get_num_vertices_from_arclist_file(arclist_file);/* closes file */
-  g = allocate_digraph(num_nodes);
 
-
-  if (load_attributes(g, config->binattr_filename,
-                      config->catattr_filename,
-                      config->contattr_filename,
-                      config->setattr_filename)) {
-    fprintf(stderr, "ERROR: loading node attributes failed\n");
+  if (config->bootstrapReplicates > 0 && config->postSimSamples == 0) {
+    fprintf(stderr, "ERROR: bootstrapReplicates requires postSimSamples\n");
     return -1;
   }
+  if ((theta_sink || dzA_sink) && config->restartFromCheckpoint) {
+    fprintf(stderr, "ERROR: restartFromCheckpoint cannot be used with "
+            "seriesContainerFile\n");
+    return -1;
+  }
+  if (!summary && config->postSimSamples > 0) {
+    memset(&post_summary, 0, sizeof(post_summary));
+    summary = &post_summary;
+  }
+
+  if (config->partitionGraph) {
+    if (!partition_comm || network) {
+      fprintf(stderr, "ERROR: partitionGraph can only be used with "
+              "EstimNetDirected_mpi\n");
+      return -1;
+    }
+    if (check_partition_config(config))
+      return -1;
+  }
+
+  if (config->seed != 0) /* reproducible run instead of seed from time */
+    set_prng_seed(config->seed);
+
+  if (!g && !(g = allocate_estimation_digraph(config, load_attrs,
+                                              config->partitionGraph,
+                                              FALSE)))
+    return -1;
+  if (config->partitionGraph)
+    partition = allocate_digraph_partition(g->num_nodes, partition_comm,
+                                           config->partitionCacheNodes);
+  set_run_metrics_digraph(metrics, g);
 
 
   /* now that we have attributes loaded in g, build the attr_indices
@@ -766,9 +2576,63 @@ int do_estimation(estim_config_t * config, uint_t tasknum)
 
   /* Only one sampler can be used (only binary attributes in config,
      did not include multiple options (maybe should) */
-  if (config->useIFDsampler && config->useTNTsampler) {
-    fprintf(stderr, "ERROR: Only one of the useIFDsampler and"
-	     " useTNTsampler options may be used\n");
+  if (config->useIFDsampler + config->useTNTsampler +
+      config->useMTMsampler > 1) {
+    fprintf(stderr, "ERROR: Only one of the useIFDsampler,"
+	     " useTNTsampler and useMTMsampler options may be used\n");
+    return -1;
+  }
+  if (config->mtmTries < 1) {
+    fprintf(stderr, "ERROR: mtmTries must be at least 1\n");
+    return -1;
+  }
+  if (check_degree_proposal_config(config))
+    return -1;
+  if (config->adaptiveSamplerSteps) {
+    if (config->minSamplerSteps < 1 ||
+        config->minSamplerSteps > config->samplerSteps ||
+        config->samplerSteps > config->maxSamplerSteps) {
+      fprintf(stderr, "ERROR: must have 1 <= minSamplerSteps <= samplerSteps"
+              " <= maxSamplerSteps for adaptiveSamplerSteps\n");
+      return -1;
+    }
+    if (config->targetAutocorr <= 0 || config->targetAutocorr >= 1) {
+      fprintf(stderr, "ERROR: targetAutocorr must be in (0, 1)\n");
+      return -1;
+    }
+  }
+  if ((config->EEconvergenceWindow > 0) !=
+      (config->EEmaxThetaDrift > 0 || config->EEmaxTratio > 0)) {
+    fprintf(stderr, "ERROR: EEconvergenceWindow requires EEmaxThetaDrift "
+            "or EEmaxTratio (or both) and they require "
+            "EEconvergenceWindow\n");
+    return -1;
+  }
+  if (config->EEconvergenceWindow > 0 &&
+      config->EEconvergenceWindow >= config->EEsteps) {
+    fprintf(stderr, "ERROR: EEconvergenceWindow must be less than EEsteps\n");
+    return -1;
+  }
+  stop.window = config->EEconvergenceWindow;
+  stop.thetaDrift = config->EEmaxThetaDrift;
+  stop.tRatio = config->EEmaxTratio;
+  stop.maxSeconds = config->EEmaxSeconds;
+  if (!(config->EEquorum > 0 && config->EEquorum <= 1)) {
+    fprintf(stderr, "ERROR: EEquorum must be greater than 0 and at most 1\n");
+    return -1;
+  }
+  stop.collectiveInterval = config->EEcollectiveInterval;
+  stop.quorum = config->EEquorum;
+  stop.maxRhat = config->EEmaxRhat;
+  stop.collective = config->EEcollectiveInterval > 0 ? collective_stop : NULL;
+  /* like the collective stop tests, ignored without other tasks */
+  shared.interval = config->EEsharedThetaInterval;
+  shared.comm = partition_comm;
+  if (shared.interval > 0 && partition_comm && !stop.collective &&
+      (stop.window > 0 || stop.maxSeconds > 0)) {
+    fprintf(stderr, "ERROR: EEsharedThetaInterval with EEconvergenceWindow "
+            "or EEmaxSeconds requires EEcollectiveInterval, so that the "
+            "tasks stop together\n");
     return -1;
   }
   
@@ -779,6 +2643,7 @@ int do_estimation(estim_config_t * config, uint_t tasknum)
     empty_graph_stats(g, num_param, n_attr, n_dyadic,
                       n_attr_interaction,
                       config->param_config.change_stats_funcs,
+                      config->param_config.param_lambdas,
                       config->param_config.attr_change_stats_funcs,
                       config->param_config.dyadic_change_stats_funcs,
                       config->param_config.attr_interaction_change_stats_funcs,
@@ -787,49 +2652,29 @@ int do_estimation(estim_config_t * config, uint_t tasknum)
                       graphStats);
   }
   
-  if (!(arclist_file = fopen(config->arclist_filename, "r"))) {
-    fprintf(stderr, "error opening file %s (%s)\n", 
-            config->arclist_filename, strerror(errno));
+  if (network) {
+    if (computeStats) {
+      start_run_phase(metrics);
+      compute_loaded_digraph_stats(config, g, num_param, graphStats, theta);
+      end_run_phase(metrics, "observed_stats", 0, 0);
+    }
+  } else if (load_estimation_arcs(config, g, computeStats, num_param,
+                                  graphStats, theta, metrics,
+                                  tasknum == 0, partition, TRUE)) {
     return -1;
   }
-  gettimeofday(&start_timeval, NULL);
-#ifdef TWOPATH_LOOKUP
-  printf("loading arc list from %s and building two-path matrices",
-         config->arclist_filename);
-#else
-  printf("loading arc list from %s", config->arclist_filename);
-#endif /*TWOPATH_LOOKUP*/
-  if (computeStats)
-    printf(" and computing observed statistics");
-  printf("..\n");
-  g = load_digraph_from_arclist_file(arclist_file, g,
-                                     computeStats,
-                                     num_param,
-                                     n_attr, n_dyadic, n_attr_interaction,
-                                     config->param_config.change_stats_funcs,
-                                     config->param_config.attr_change_stats_funcs,
-                                     config->param_config.dyadic_change_stats_funcs,
-                                     config->param_config.attr_interaction_change_stats_funcs,
-                                     config->param_config.attr_indices,
-                                     config->param_config.attr_interaction_pair_indices,
-                                     graphStats, theta);
-  gettimeofday(&end_timeval, NULL);
-  timeval_subtract(&elapsed_timeval, &end_timeval, &start_timeval);
-  etime = 1000 * elapsed_timeval.tv_sec + elapsed_timeval.tv_usec/1000;
-  printf("%.2f s\n", (double)etime/1000);
-#ifdef DEBUG_DIGRAPH
-  dump_digraph_arclist(g);
-#endif /*DEBUG_DIGRAPH*/
 
-  if (config->zone_filename) {
-    if (add_snowball_zones_to_digraph(g, config->zone_filename)) {
-      fprintf(stderr, "ERROR: reading snowball sampling zones from %s failed\n",
-              config->zone_filename);
-      return -1;
-    }
-#ifdef DEBUG_SNOWBALL
-    dump_zone_info(g);
-#endif /* DEBUG_SNOWBALL */
+  /* the dyad cache is only used by the basic sampler */
+  if (config->dyadCacheMB > 0 && !partition &&
+      get_sampler_type(config->useIFDsampler, config->useTNTsampler,
+                       config->useMTMsampler) == SAMPLER_BASIC) {
+    if (set_dyad_cache(g, num_param, config->dyadCacheMB))
+      printf("task %u: dyad change statistics cache %.1f MB\n", tasknum,
+             dyad_cache_bytes(g->num_nodes, num_param) / (1024.0 * 1024.0));
+    else
+      printf("task %u: (warning) dyad change statistics cache would take "
+             "%.1f MB, more than dyadCacheMB, not used\n", tasknum,
+             dyad_cache_bytes(g->num_nodes, num_param) / (1024.0 * 1024.0));
   }
 
   if (computeStats) {
@@ -840,22 +2685,43 @@ int do_estimation(estim_config_t * config, uint_t tasknum)
   }
 
   
-  /* Open the output files (separate ones for each task), for writing */
-  strncpy(theta_outfilename, config->theta_file_prefix,
-          sizeof(theta_outfilename)-1);
-  strncpy(dzA_outfilename, config->dzA_file_prefix,
-          sizeof(dzA_outfilename)-1);
+  /* Open the output files (separate ones for each task), for writing.
+     A NULL prefix (only set through estimNetLib.h) means no file. */
+  strncpy(theta_outfilename, config->theta_file_prefix ?
+          config->theta_file_prefix : "", sizeof(theta_outfilename)-1);
+  strncpy(dzA_outfilename, config->dzA_file_prefix ?
+          config->dzA_file_prefix : "", sizeof(dzA_outfilename)-1);
   sprintf(suffix, "_%d.txt", config->outputFileSuffixBase + tasknum);
-  strncat(theta_outfilename, suffix, sizeof(theta_outfilename) - 1 -
-          strlen(suffix));
-  strncat(dzA_outfilename, suffix, sizeof(dzA_outfilename) - 1 -
-          strlen(suffix));
-  if (!(theta_outfile = fopen(theta_outfilename, "w"))) {
-    fprintf(stderr, "ERROR: task %d could not open file %s for writing "
-            "(%s)\n", tasknum, theta_outfilename, strerror(errno));
-    return -1;
+  sprintf(series_suffix, "_%d.%s", config->outputFileSuffixBase + tasknum,
+          config->binaryOutput ? "bin" : "txt");
+  strncat(theta_outfilename, series_suffix, sizeof(theta_outfilename) - 1 -
+          strlen(series_suffix));
+  strncat(dzA_outfilename, series_suffix, sizeof(dzA_outfilename) - 1 -
+          strlen(series_suffix));
+  snprintf(checkpoint_filename, sizeof(checkpoint_filename), "%s_%d.ckpt",
+           config->checkpoint_file_prefix,
+           config->outputFileSuffixBase + tasknum);
+  if (config->restartFromCheckpoint) {
+    /* continue from checkpoint: the output files are cut back to where
+       they were when it was written, and appended to (without headers) */
+    if (read_ee_checkpoint(checkpoint_filename, &restart))
+      return -1;
+    if (restart.n != num_param || restart.num_nodes != g->num_nodes ||
+        restart.touter >= config->EEsteps) {
+      fprintf(stderr, "ERROR: task %d checkpoint file %s does not match "
+              "the configuration\n", tasknum, checkpoint_filename);
+      return -1;
+    }
+    if ((config->theta_file_prefix &&
+         truncate(theta_outfilename, restart.theta_file_pos)) ||
+        (config->dzA_file_prefix &&
+         truncate(dzA_outfilename, restart.dzA_file_pos))) {
+      fprintf(stderr, "ERROR: task %d could not truncate output files "
+              "for restart (%s)\n", tasknum, strerror(errno));
+      return -1;
+    }
   }
-  if (computeStats) {
+  if (computeStats && config->obs_stats_file_prefix) {
     strncpy(obs_stats_outfilename, config->obs_stats_file_prefix,
             sizeof(obs_stats_outfilename)-1);
     strncat(obs_stats_outfilename, suffix,
@@ -916,7 +2782,8 @@ int do_estimation(estim_config_t * config, uint_t tasknum)
    /* Ensure that if conditional estimation is to be used, the snowball
       sampling zone structure was specified */
    if (config->useConditionalEstimation) {
-     if (!config->zone_filename) {
+     if (!config->zone_filename &&
+         !(config->snapshot_filename && digraph_snapshot_has_zones(g))) {
        fprintf(stderr,
            "ERROR: conditional estimation requested but no zones specified\n");
        return -1;
@@ -928,17 +2795,11 @@ int do_estimation(estim_config_t * config, uint_t tasknum)
      }
    }
 
-   if (tasknum == 0) {
+   if (tasknum == 0 && !partition) {
     print_data_summary(g);
     print_zone_summary(g);
    }
    
-  if (!(dzA_outfile = fopen(dzA_outfilename, "w"))) {
-    fprintf(stderr, "ERROR: task %d could not open file %s for writing "
-            "(%s)\n", tasknum, dzA_outfilename, strerror(errno));
-    return -1;
-  }
-
   /* write headers for output files */
   if (config->useIFDsampler){/* IFD sampler always computes an Arc parameter */
     snprintf(fileheader+strlen(fileheader), HEADER_MAX,"%s", ARC_PARAM_STR);
@@ -963,8 +2824,13 @@ int do_estimation(estim_config_t * config, uint_t tasknum)
   for (i = 0; i < config->param_config.num_dyadic_change_stats_funcs; i++) {
     if (!first_header_field)
       snprintf(fileheader+strlen(fileheader), HEADER_MAX," ");
-    snprintf(fileheader+strlen(fileheader), HEADER_MAX, "%s",
-             config->param_config.dyadic_param_names[i]);
+    if (config->param_config.dyadic_types[i] == DYADIC_TYPE_COVARIATE)
+      snprintf(fileheader+strlen(fileheader), HEADER_MAX, "%s_%s",
+               config->param_config.dyadic_param_names[i],
+               config->param_config.dyadic_names[i]);
+    else
+      snprintf(fileheader+strlen(fileheader), HEADER_MAX, "%s",
+               config->param_config.dyadic_param_names[i]);
     first_header_field = FALSE;
   }
   
@@ -979,14 +2845,39 @@ int do_estimation(estim_config_t * config, uint_t tasknum)
   }
   
   
-  fprintf(theta_outfile,  "t %s AcceptanceRate\n", fileheader);
-  fprintf(dzA_outfile, "t %s\n", fileheader);
+  /* on restart from a checkpoint, append to the output files (which
+     already have headers) */
+  snprintf(series_header, sizeof(series_header), "t %s AcceptanceRate",
+           fileheader);
+  if (theta_series)
+    theta_outfile = open_memory_series_writer(theta_series, series_header);
+  else if (theta_sink && config->theta_file_prefix && writeSeries)
+    theta_outfile = open_sink_series_writer(theta_sink, series_header);
+  else if (!(theta_outfile = open_series_writer(config->theta_file_prefix &&
+                                                writeSeries ?
+                                                theta_outfilename : NULL,
+                                                config->binaryOutput,
+                                                config->restartFromCheckpoint,
+                                                series_header)))
+    return -1;
+  snprintf(series_header, sizeof(series_header), "t %s", fileheader);
+  if (dzA_series)
+    dzA_outfile = open_memory_series_writer(dzA_series, series_header);
+  else if (dzA_sink && config->dzA_file_prefix && writeSeries)
+    dzA_outfile = open_sink_series_writer(dzA_sink, series_header);
+  else if (!(dzA_outfile = open_series_writer(config->dzA_file_prefix &&
+                                              writeSeries ?
+                                              dzA_outfilename : NULL,
+                                              config->binaryOutput,
+                                              config->restartFromCheckpoint,
+                                              series_header)))
+    return -1;
 
   /* output the observed sufficient statistics if selected */
-  if (computeStats) {
+  if (obs_stats_outfile) {
     fprintf(obs_stats_outfile, "%s\n", fileheader);
     if (config->useIFDsampler) { /* Arc stat not in array, output separately */
-      fprintf(obs_stats_outfile, "%u ", g->num_arcs);
+      fprintf(obs_stats_outfile, "%lu ", (unsigned long)g->num_arcs);
     }
     for (i = 0; i < num_param; i++) {
       fprintf(obs_stats_outfile, "%g", graphStats[i]);
@@ -997,28 +2888,149 @@ int do_estimation(estim_config_t * config, uint_t tasknum)
     }
     fclose(obs_stats_outfile);
   }
+
+  if (config->outputThetaCovariance)
+    init_online_stats(&theta_stats, num_param, TRUE);
+  if (summary)
+    init_ee_batches(&batches, num_param, config->EEsteps);
+
+  if (config->restartFromCheckpoint) {
+    if (restart.inner_arcs != config->useConditionalEstimation) {
+      fprintf(stderr, "ERROR: task %d checkpoint file %s does not match "
+              "useConditionalEstimation\n", tasknum, checkpoint_filename);
+      return -1;
+    }
+    replace_digraph_arcs(g, restart.arcs, restart.num_arcs,
+                         restart.inner_arcs);
+  }
+
+  /* parameter names for the heartbeat, theta covariance and summary (no
+     Arc parameter for the IFD sampler, as it is not in theta) */
+  theta_names = fileheader;
+  if (config->useIFDsampler)
+    theta_names = strchr(fileheader, ' ') ? strchr(fileheader, ' ') + 1 : "";
+
+  if (config->warm_start_filename) {
+    if (read_warm_start(config->warm_start_filename, theta_names, num_param,
+                        &warm_start))
+      return -1;
+    warm_start.Ssteps = config->warmStartSsteps;
+    printf("task %u: warm start values for %u of %u parameters "
+           "(%u with D0) from %s\n", tasknum, warm_start.num_theta,
+           num_param, warm_start.num_D0, config->warm_start_filename);
+  }
+  if (config->write_warm_start_file_prefix)
+    final_D0 = (double *)safe_calloc(num_param, sizeof(double));
+
+  if (heartbeat) {
+    snprintf(heartbeat_filename, sizeof(heartbeat_filename), "%s_%d.json",
+             config->heartbeat_file_prefix, tasknum);
+    init_heartbeat(heartbeat, heartbeat_filename, tasknum,
+                   config->heartbeatInterval, num_param, theta_names);
+  }
   
-  ee_estimate(g, num_param, n_attr, n_dyadic, n_attr_interaction,
-              config->param_config.change_stats_funcs,
-              config->param_config.attr_change_stats_funcs,
-              config->param_config.dyadic_change_stats_funcs,
-              config->param_config.attr_interaction_change_stats_funcs,
-              config->param_config.attr_indices,
-              config->param_config.attr_interaction_pair_indices,
-              config->samplerSteps, config->Ssteps,
-              config->EEsteps, config->EEinnerSteps,
-              config->ACA_S, config->ACA_EE, config->compC,
-              theta, tasknum, theta_outfile, dzA_outfile,
-              config->outputAllSteps,
-              config->useIFDsampler, config->ifd_K,
-              config->useConditionalEstimation,
-              config->forbidReciprocity,
-              config->useBorisenkoUpdate, config->learningRate,
-              config->minTheta, config->useTNTsampler);
-
-  fclose(theta_outfile);
-  fclose(dzA_outfile);
-  if (config->outputSimulatedNetwork) {
+  run_ee_estimate(config, g, num_param, theta, tasknum, theta_outfile,
+                  dzA_outfile, &stop,
+                  shared.interval > 0 && partition_comm ? &shared : NULL,
+                  checkpoint_filename,
+                  config->checkpointInterval,
+                  config->restartFromCheckpoint ? &restart : NULL,
+                  config->warm_start_filename ? &warm_start : NULL, final_D0,
+                  config->outputThetaCovariance ? &theta_stats : NULL,
+                  summary ? &batches : NULL, metrics, heartbeat, partition);
+  finish_heartbeat(heartbeat);
+
+  if (config->restartFromCheckpoint)
+    free_ee_checkpoint(&restart);
+  if (config->warm_start_filename)
+    free_warm_start(&warm_start);
+
+#ifdef PROFILE_CHANGESTATS
+  snprintf(profile_prefix, sizeof(profile_prefix), "task %u: ", tasknum);
+  profile_write_report(stdout, num_param, theta_names, profile_prefix);
+#endif /* PROFILE_CHANGESTATS */
+
+  if (summary) {
+    init_chain_summary(summary, num_param);
+    if ((reason = compute_chain_summary(&batches, summary)))
+      fprintf(stderr, "task %u: estimates not used in summary due to %s\n",
+              tasknum, reason);
+    summary->param_names = safe_strdup(theta_names);
+    free_ee_batches(&batches);
+  }
+
+  if (final_D0 && writeSeries) {
+    /* the estimates (or last theta) and D0, to warm start another
+       estimation from */
+    snprintf(warm_start_filename, sizeof(warm_start_filename), "%s_%d.txt",
+             config->write_warm_start_file_prefix,
+             config->outputFileSuffixBase + tasknum);
+    if (write_warm_start(warm_start_filename, theta_names, num_param,
+                         summary && summary->valid ? summary->est : theta,
+                         final_D0))
+      return -1;
+  }
+  free(final_D0);
+
+  if (config->postSimSamples > 0) {
+    if (!summary->valid)
+      fprintf(stderr, "task %u: post-estimation simulation at the last "
+              "theta instead of the estimates\n", tasknum);
+    replicate.config = config;
+    replicate.num_param = num_param;
+    replicate.tasknum = tasknum;
+    replicate.stop = stop;
+    replicate.stop.collective = NULL; /* replicates are not in step */
+    if (post_estimation(config, g, num_param,
+                        summary->valid ? summary->est : theta, theta_names,
+                        tasknum, estimate_bootstrap_replicate, &replicate))
+      return -1;
+    if (summary == &post_summary)
+      free_chain_summary(&post_summary);
+  }
+
+  if (config->outputThetaCovariance && config->theta_file_prefix &&
+      writeSeries) {
+    /* write the covariance matrix of theta over the Algorithm EE
+       iterations, with a header line of parameter names */
+    snprintf(theta_cov_outfilename, sizeof(theta_cov_outfilename),
+             "%s_cov%s", config->theta_file_prefix, suffix);
+    if (!(theta_cov_outfile = fopen(theta_cov_outfilename, "w"))) {
+      fprintf(stderr, "ERROR: task %d could not open file %s for writing "
+              "(%s)\n", tasknum, theta_cov_outfilename, strerror(errno));
+      return -1;
+    }
+    fprintf(theta_cov_outfile, "%s\n", theta_names);
+    for (i = 0; i < num_param; i++) {
+      for (j = 0; j < num_param; j++)
+        fprintf(theta_cov_outfile, "%g%s",
+                online_stats_covariance(&theta_stats, i, j),
+                j == num_param - 1 ? "\n" : " ");
+    }
+    fclose(theta_cov_outfile);
+  }
+  if (config->outputThetaCovariance) {
+    printf("task %u: mean theta over %u Algorithm EE iterations = ",
+           tasknum, theta_stats.count);
+    for (i = 0; i < num_param; i++)
+      printf("%g ", theta_stats.mean[i]);
+    printf("\ntask %u: sd theta = ", tasknum);
+    for (i = 0; i < num_param; i++)
+      printf("%g ", sqrt(online_stats_covariance(&theta_stats, i, i)));
+    printf("\n");
+    free_online_stats(&theta_stats);
+  }
+
+  close_series_writer(theta_outfile);
+  close_series_writer(dzA_outfile);
+  if (metrics) {
+    snprintf(metrics_filename, sizeof(metrics_filename), "%s_%d.json",
+             config->metrics_file_prefix,
+             config->outputFileSuffixBase + tasknum);
+    write_run_metrics(metrics_filename, metrics, "EstimNetDirected",
+                      tasknum, g);
+  }
+  if (config->outputSimulatedNetwork && config->sim_net_file_prefix) {
     strncpy(sim_outfilename, config->sim_net_file_prefix,
             sizeof(sim_outfilename)-1);
     sprintf(suffix, "_%d.net", config->outputFileSuffixBase + tasknum);
@@ -1028,6 +3040,8 @@ int do_estimation(estim_config_t * config, uint_t tasknum)
     write_digraph_arclist_to_file(sim_outfile, g);
     fclose(sim_outfile);
   }
+  if (partition)
+    free_digraph_partition(partition);
   free_digraph(g);
   free(theta);
   free(graphStats);
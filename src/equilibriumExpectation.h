@@ -33,53 +33,101 @@
 
 #include "estimconfigparser.h"
 #include "changeStatisticsDirected.h"
+#include "sampler.h"
+#include "checkpoint.h"
+#include "seriesWriter.h"
+#include "estimSummary.h"
+#include "runMetrics.h"
+#include "warmStart.h"
 
-void algorithm_S(digraph_t *g, uint_t n, uint_t n_attr, uint_t n_dyadic,
-                 uint_t n_attr_interaction,
-                 change_stats_func_t *change_stats_funcs[],
-                 attr_change_stats_func_t *attr_change_stats_funcs[],
-                 dyadic_change_stats_func_t *dyadic_change_stats_funcs[],
-                 attr_interaction_change_stats_func_t
-                                  *attr_interaction_change_stats_funcs[],
-                 uint_t attr_indices[],
-                 uint_pair_t attr_interaction_pair_indices[],
+/* why Algorithm EE stopped */
+typedef enum ee_stop_reason_e {
+  EE_STOP_MAX_STEPS,  /* ran all Mouter (EEsteps) outer iterations */
+  EE_STOP_CONVERGED,  /* theta drift and dzA t-ratio criteria met */
+  EE_STOP_TIME_LIMIT, /* wall clock limit reached */
+  EE_STOP_CONVERGED_TASKS /* enough tasks converged (collective test) */
+} ee_stop_reason_e;
+
+struct ee_stop_criteria_s;
+
+/* Combine the stop tests of this task with those of the other tasks
+   (e.g. MPI tasks, all calling it at the same outer iteration):
+   converged and time_up are the results of the tests in this task and
+   theta_stats the running statistics of theta since the last call.
+   Returns the reason to stop, the same in every task, or
+   EE_STOP_MAX_STEPS to continue. */
+typedef ee_stop_reason_e ee_collective_stop_func_t(
+  const struct ee_stop_criteria_s *stop, bool converged, bool time_up,
+  const online_stats_t *theta_stats);
+
+/* Optional early termination criteria for Algorithm EE, tested after
+   each outer iteration (all zero to always run Mouter iterations) */
+typedef struct ee_stop_criteria_s {
+  uint_t window;      /* outer iterations to test convergence over,
+                         0 for no convergence test */
+  double thetaDrift;  /* max relative change in mean theta over window,
+                         0 to not test */
+  double tRatio;      /* max |mean(dzA)|/sd(dzA) over window, 0 to not test */
+  uint_t maxSeconds;  /* wall clock limit for Algorithm EE, 0 for none */
+  uint_t collectiveInterval; /* outer iterations between collective
+                                tests, 0 for none */
+  double quorum;      /* (collective) fraction of tasks that must meet
+                         the convergence criteria above */
+  double maxRhat;     /* (collective) max R-hat of theta between tasks,
+                         0 to not test */
+  ee_collective_stop_func_t *collective; /* (collective) combines the
+                                            tests of all tasks, NULL for
+                                            no collective tests */
+} ee_stop_criteria_t;
+
+/* Algorithm EE of several tasks (e.g. MPI tasks, each with its own
+   chain on the same network, all running the same number of
+   iterations) stepping one shared theta with their combined dzA */
+typedef struct ee_shared_theta_s {
+  uint_t interval;    /* inner iterations between combining theta and dzA
+                         over the tasks (also at the end of each outer
+                         iteration) */
+  const partition_comm_t *comm; /* communication between the tasks */
+} ee_shared_theta_t;
+
+const char *ee_stop_reason_name(ee_stop_reason_e reason);
+
+void algorithm_S(digraph_t *g, sampler_t *sampler,
                  uint_t M1,
                  uint_t sampler_m,
                  double ACA,
                  double theta[],
                  double Dmean[],
-                 FILE *theta_outfile,
-                 bool useIFDsampler, double ifd_K,
-                 bool useConditionalEstimation,
-                 bool forbidReciprocity,
-		 bool useTNTsampler);
+                 series_writer_t *theta_outfile,
+                 uint_t num_threads,
+                 heartbeat_t *heartbeat);
 
-void algorithm_EE(digraph_t *g, uint_t n, uint_t n_attr, uint_t n_dyadic,
-                  uint_t n_attr_interaction,
-                  change_stats_func_t *change_stats_funcs[],
-                  attr_change_stats_func_t *attr_change_stats_funcs[],
-                  dyadic_change_stats_func_t *dyadic_change_stats_funcs[],
-                  attr_interaction_change_stats_func_t
-                                   *attr_interaction_change_stats_funcs[],
-                  uint_t attr_indices[],
-                  uint_pair_t attr_interaction_pair_indices[],
+ee_stop_reason_e algorithm_EE(digraph_t *g, sampler_t *sampler,
                   uint_t Mouter, uint_t Minner,
                   uint_t sampler_m,
                   double ACA, double compC,
                   double D0[],
                   double theta[],
-                  FILE *theta_outfile, FILE *dzA_outfile, bool outputAllSteps,
-                  bool useIFDsampler, double ifd_K,
-                  bool useConditionalEstimation,
-                  bool forbidReciprocity,
+                  series_writer_t *theta_outfile, series_writer_t *dzA_outfile,
+                  bool outputAllSteps,
                   bool useBorisenkoUpdate,
                   double learningRate, double minTheta,
-		  bool useTNTsampler);
+                  bool adaptiveSamplerSteps, uint_t minSamplerSteps,
+                  uint_t maxSamplerSteps, double targetAutocorr,
+                  const ee_stop_criteria_t *stop,
+                  const ee_shared_theta_t *shared,
+                  const char *checkpoint_filename,
+                  uint_t checkpoint_interval,
+                  const ee_checkpoint_t *restart,
+                  online_stats_t *theta_stats,
+                  ee_batches_t *batches,
+                  heartbeat_t *heartbeat);
 
 
 int ee_estimate(digraph_t *g, uint_t n, uint_t n_attr, uint_t n_dyadic,
                 uint_t n_attr_interaction,
                 change_stats_func_t *change_stats_funcs[],
+                double lambda_values[],
                 attr_change_stats_func_t *attr_change_stats_funcs[],
                 dyadic_change_stats_func_t *dyadic_change_stats_funcs[],
                 attr_interaction_change_stats_func_t
@@ -89,14 +137,38 @@ int ee_estimate(digraph_t *g, uint_t n, uint_t n_attr, uint_t n_dyadic,
                 uint_t sampler_m, uint_t M1_steps, uint_t Mouter,
                 uint_t Msteps, double ACA_S, double ACA_EE, double compC,
                 double theta[], uint_t tasknum,
-                FILE *theta_outfile, FILE *dzA_outfile, bool outputAllSteps,
+                series_writer_t *theta_outfile, series_writer_t *dzA_outfile,
+                bool outputAllSteps,
                 bool useIFDsampler, double ifd_K,
                 bool useConditionalEstimation,
                 bool forbidReciprocity,
                 bool useBorisenkoUpdate, double learningRate, double minTheta,
-		bool useTNTsampler);
+		bool useTNTsampler, bool useMTMsampler, uint_t mtm_tries,
+                bool earlyReject, double degreeProposalWeight,
+                digraph_partition_t *partition, uint_t num_threads_S, uint_t num_threads_EE,
+                bool adaptiveSamplerSteps, uint_t minSamplerSteps,
+                uint_t maxSamplerSteps, double targetAutocorr,
+                const ee_stop_criteria_t *stop,
+                const ee_shared_theta_t *shared,
+                const char *checkpoint_filename, uint_t checkpoint_interval,
+                const ee_checkpoint_t *restart,
+                const ee_warm_start_t *warm_start, double final_D0[],
+                online_stats_t *theta_stats,
+                ee_batches_t *batches, run_metrics_t *metrics,
+                heartbeat_t *heartbeat);
 
-int do_estimation(estim_config_t *config, uint_t tasknum);
+digraph_t *load_estimation_digraph(const estim_config_t *config,
+                                   bool all_columns);
+int do_preflight(estim_config_t *config);
+void estimation_series_capacity(const estim_config_t *config,
+                                size_t *theta_values, size_t *dzA_values);
+int do_estimation(estim_config_t *config, uint_t tasknum,
+                  load_attributes_func_t *load_attrs, digraph_t *network,
+                  ee_collective_stop_func_t *collective_stop,
+                  chain_summary_t *summary, series_data_t *theta_series,
+                  series_data_t *dzA_series, series_sink_t *theta_sink,
+                  series_sink_t *dzA_sink,
+                  const partition_comm_t *partition_comm);
 
 
 #endif /* EQUILIBRIUMEXPECTATION_H */
@@ -0,0 +1,490 @@
+/*****************************************************************************
+ *
+ * File:    estimNetLib.c
+ * Author:  Alex Stivala
+ * Created: October 2026
+ *
+ * Library interface to run estimations from another program, with
+ * in-memory inputs and outputs (see estimNetLib.h).
+ *
+ ****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "estimNetLib.h"
+#include "equilibriumExpectation.h"
+
+/*****************************************************************************
+ *
+ * local functions
+ *
+ ****************************************************************************/
+
+/*
+ * Parse the configuration text of a model, and set it to write no
+ * output files (the results are returned in memory).
+ *
+ * Parameters:
+ *   config_text - configuration settings
+ *
+ * Return value:
+ *   Parsed configuration (to be freed with free_estim_config_struct()),
+ *   or NULL on error (message printed to stderr).
+ */
+static estim_config_t *parse_model_config(const char *config_text)
+{
+  estim_config_t *config;
+
+  if (!(config = parse_estim_config_string(config_text)))
+    return NULL;
+  free(config->theta_file_prefix);
+  free(config->dzA_file_prefix);
+  free(config->sim_net_file_prefix);
+  free(config->obs_stats_file_prefix);
+  free(config->metrics_file_prefix);
+  free(config->heartbeat_file_prefix);
+  free(config->write_warm_start_file_prefix);
+  config->theta_file_prefix = config->dzA_file_prefix = NULL;
+  config->sim_net_file_prefix = config->obs_stats_file_prefix = NULL;
+  config->metrics_file_prefix = config->heartbeat_file_prefix = NULL;
+  config->write_warm_start_file_prefix = NULL;
+  return config;
+}
+
+/*
+ * Choose the two-path lookup method of the digraph of an estimation
+ * (as load_estimation_digraph() does) and run the estimation.
+ *
+ * Parameters:
+ *   config       - parsed model configuration, freed here
+ *   g            - digraph with the arcs and attributes, freed here
+ *   rng          - seed and stream of pseudorandom numbers
+ *   result       - (out) estimates and standard errors
+ *   theta_series - (out) if not NULL, theta series
+ *   dzA_series   - (out) if not NULL, dzA series
+ *
+ * Return value:
+ *   ESTIMNET_OK, or ESTIMNET_ERROR_ESTIMATION (message printed to
+ *   stderr, and nothing to be freed).
+ */
+static estimnet_status_e run_model_estimation(estim_config_t *config,
+                                              digraph_t *g,
+                                              const estimnet_rng_t *rng,
+                                              chain_summary_t *result,
+                                              series_data_t *theta_series,
+                                              series_data_t *dzA_series)
+{
+  int rc;
+#ifdef TWOPATH_ADAPTIVE
+  twopath_backend_e backend;
+#endif /* TWOPATH_ADAPTIVE */
+
+  set_twopath_update_threads(g, config->numThreadsHubUpdate,
+                             config->hubUpdateDegree);
+#ifdef TWOPATH_ADAPTIVE
+  backend = twopath_backend_from_name(config->twoPathBackend);
+  set_twopath_tables(g, twopath_tables_used(
+                       config->param_config.num_change_stats_funcs,
+                       config->param_config.change_stats_funcs));
+  if (backend == TWOPATH_BACKEND_AUTO)
+    backend = choose_twopath_backend(g, 0, config->maxMemoryMB);
+  if (backend == TWOPATH_BACKEND_HYBRID)
+    set_twopath_hub_cutoff(g, choose_twopath_hub_cutoff(g,
+                                                        config->maxMemoryMB));
+  set_twopath_backend(g, backend);
+#endif /* TWOPATH_ADAPTIVE */
+
+  /* do_estimation() frees g */
+  rc = do_estimation(config, rng->stream, NULL, g, NULL, result,
+                     theta_series, dzA_series, NULL, NULL, NULL);
+  free_estim_config_struct(config);
+  if (rc) {
+    free_chain_summary(result);
+    if (theta_series)
+      free_series_data(theta_series);
+    if (dzA_series)
+      free_series_data(dzA_series);
+    return ESTIMNET_ERROR_ESTIMATION;
+  }
+  return ESTIMNET_OK;
+}
+
+/*****************************************************************************
+ *
+ * externally visible functions
+ *
+ ****************************************************************************/
+
+/*
+ * Create a model from configuration text, in the same format as an
+ * EstimNetDirected configuration file. The settings of input and
+ * output files (arclistFile, thetaFilePrefix, etc.) are not used.
+ *
+ * Parameters:
+ *   config_text - configuration settings, one "keyword = value" per line
+ *   model       - (out) model, to be freed with estimnet_free_model()
+ *
+ * Return value:
+ *   ESTIMNET_OK, or ESTIMNET_ERROR_CONFIG if the configuration is not
+ *   valid (message printed to stderr).
+ */
+estimnet_status_e estimnet_model_from_string(const char *config_text,
+                                             estimnet_model_t *model)
+{
+  estim_config_t *config;
+  estimnet_status_e status = ESTIMNET_OK;
+
+  model->config_text = NULL;
+  if (!(config = parse_model_config(config_text)))
+    return ESTIMNET_ERROR_CONFIG;
+  if (config->useConditionalEstimation || config->restartFromCheckpoint ||
+      config->checkpointInterval > 0 || config->snapshot_filename ||
+      config->write_snapshot_filename) {
+    fprintf(stderr, "ERROR: conditional estimation, checkpoints and "
+            "snapshot files cannot be used through the library\n");
+    status = ESTIMNET_ERROR_CONFIG;
+  }
+#ifdef TWOPATH_ADAPTIVE
+  if (twopath_backend_from_name(config->twoPathBackend) ==
+      TWOPATH_BACKEND_INVALID) {
+    fprintf(stderr, "ERROR: unknown twoPathBackend %s\n",
+            config->twoPathBackend);
+    status = ESTIMNET_ERROR_CONFIG;
+  }
+#endif /* TWOPATH_ADAPTIVE */
+  free_estim_config_struct(config);
+  if (status == ESTIMNET_OK)
+    model->config_text = safe_strdup(config_text);
+  return status;
+}
+
+/*
+ * Free a model created by estimnet_model_from_string().
+ *
+ * Parameters:
+ *   model - model to free
+ *
+ * Return value:
+ *   None.
+ */
+void estimnet_free_model(estimnet_model_t *model)
+{
+  free(model->config_text);
+  model->config_text = NULL;
+}
+
+/*
+ * Create a graph (with no node attributes) from arcs in memory.
+ * Duplicate arcs are ignored (as in an arc list file).
+ *
+ * Parameters:
+ *   num_nodes - number of nodes
+ *   from      - node each arc is from (0 to num_nodes-1)
+ *   to        - node each arc is to (0 to num_nodes-1)
+ *   num_arcs  - number of arcs (length of from and to)
+ *   graph     - (out) graph, to be freed with estimnet_free_graph()
+ *
+ * Return value:
+ *   ESTIMNET_OK, or ESTIMNET_ERROR_GRAPH if a node number is out of
+ *   range (message printed to stderr).
+ */
+estimnet_status_e estimnet_graph_from_arcs(uint_t num_nodes,
+                                           const uint_t from[],
+                                           const uint_t to[],
+                                           arcidx_t num_arcs,
+                                           estimnet_graph_t *graph)
+{
+  arcidx_t a;
+
+  memset(graph, 0, sizeof(estimnet_graph_t));
+  if (num_nodes < 1 || num_nodes > MAX_NUM_NODES) {
+    fprintf(stderr, "ERROR: number of nodes is %u\n", num_nodes);
+    return ESTIMNET_ERROR_GRAPH;
+  }
+  for (a = 0; a < num_arcs; a++) {
+    if (from[a] >= num_nodes || to[a] >= num_nodes) {
+      fprintf(stderr, "ERROR: num nodes %u but got arc %u,%u\n",
+              num_nodes, from[a], to[a]);
+      return ESTIMNET_ERROR_GRAPH;
+    }
+  }
+  graph->num_nodes = num_nodes;
+  graph->num_arcs = num_arcs;
+  graph->arcs = (nodepair_t *)safe_malloc(MAX(num_arcs, 1) *
+                                          sizeof(nodepair_t));
+  graph->owns_arcs = TRUE;
+  for (a = 0; a < num_arcs; a++) {
+    graph->arcs[a].i = (nodeid_t)from[a];
+    graph->arcs[a].j = (nodeid_t)to[a];
+  }
+  return ESTIMNET_OK;
+}
+
+/*
+ * Create a graph (with no node attributes) from an array of arcs in
+ * memory, which is used in place rather than copied (e.g. a buffer
+ * shared with Python). Duplicate arcs are ignored.
+ *
+ * Parameters:
+ *   num_nodes - number of nodes
+ *   arcs      - arcs (0-based node numbers), not changed, and to remain
+ *               valid until estimnet_free_graph()
+ *   num_arcs  - number of arcs (length of arcs)
+ *   graph     - (out) graph, to be freed with estimnet_free_graph()
+ *
+ * Return value:
+ *   ESTIMNET_OK, or ESTIMNET_ERROR_GRAPH if a node number is out of
+ *   range (message printed to stderr).
+ */
+estimnet_status_e estimnet_graph_from_pairs(uint_t num_nodes,
+                                            nodepair_t arcs[],
+                                            arcidx_t num_arcs,
+                                            estimnet_graph_t *graph)
+{
+  arcidx_t a;
+
+  memset(graph, 0, sizeof(estimnet_graph_t));
+  if (num_nodes < 1 || num_nodes > MAX_NUM_NODES) {
+    fprintf(stderr, "ERROR: number of nodes is %u\n", num_nodes);
+    return ESTIMNET_ERROR_GRAPH;
+  }
+  for (a = 0; a < num_arcs; a++) {
+    if (arcs[a].i >= num_nodes || arcs[a].j >= num_nodes) {
+      fprintf(stderr, "ERROR: num nodes %u but got arc %u,%u\n",
+              num_nodes, (uint_t)arcs[a].i, (uint_t)arcs[a].j);
+      return ESTIMNET_ERROR_GRAPH;
+    }
+  }
+  graph->num_nodes = num_nodes;
+  graph->num_arcs = num_arcs;
+  graph->arcs = arcs;
+  graph->owns_arcs = FALSE;
+  return ESTIMNET_OK;
+}
+
+/*
+ * Load node attributes for a graph from attribute files (in the same
+ * formats as for binattrFile etc., with a line for each node in order).
+ * They are loaded once and shared by all estimations with the graph.
+ *
+ * Parameters:
+ *   graph             - (in/out) graph from estimnet_graph_from_arcs()
+ *   binattr_filename  - binary attributes file or NULL
+ *   catattr_filename  - categorical attributes file or NULL
+ *   contattr_filename - continuous attributes file or NULL
+ *   setattr_filename  - set attributes file or NULL
+ *
+ * Return value:
+ *   ESTIMNET_OK, or ESTIMNET_ERROR_GRAPH if the attributes cannot be
+ *   loaded (message printed to stderr).
+ */
+estimnet_status_e estimnet_graph_load_attributes(estimnet_graph_t *graph,
+                                                 const char *binattr_filename,
+                                                 const char *catattr_filename,
+                                                 const char *contattr_filename,
+                                                 const char *setattr_filename)
+{
+  digraph_t *g = allocate_digraph(graph->num_nodes);
+
+  if (load_attributes(g, binattr_filename, catattr_filename,
+                      contattr_filename, setattr_filename, NULL)) {
+    fprintf(stderr, "ERROR: loading node attributes failed\n");
+    free_digraph(g);
+    return ESTIMNET_ERROR_GRAPH;
+  }
+  free(graph->attr_block);
+  graph->attr_block = safe_malloc(digraph_attributes_block_size(g));
+  move_digraph_attributes(g, graph->attr_block);
+  free_digraph(g);
+  return ESTIMNET_OK;
+}
+
+/*
+ * Set the node attributes of a graph from columns in memory, one value
+ * for each node in order (see set_column_attributes() for the values).
+ * They are stored once and shared by all estimations with the graph,
+ * so the columns are not needed afterwards.
+ *
+ * Parameters:
+ *   graph          - (in/out) graph from estimnet_graph_from_arcs()
+ *   num_binattr    - number of binary attributes
+ *   binattr_names  - names of the binary attributes
+ *   binattr        - binary attribute columns
+ *   num_catattr    - number of categorical attributes
+ *   catattr_names  - names of the categorical attributes
+ *   catattr        - categorical attribute columns
+ *   num_contattr   - number of continuous attributes
+ *   contattr_names - names of the continuous attributes
+ *   contattr       - continuous attribute columns
+ *
+ * Return value:
+ *   ESTIMNET_OK, or ESTIMNET_ERROR_GRAPH if a value is not valid
+ *   (message printed to stderr).
+ */
+estimnet_status_e estimnet_graph_set_attributes(estimnet_graph_t *graph,
+                                  uint_t num_binattr,
+                                  const char *const binattr_names[],
+                                  const int *const binattr[],
+                                  uint_t num_catattr,
+                                  const char *const catattr_names[],
+                                  const int *const catattr[],
+                                  uint_t num_contattr,
+                                  const char *const contattr_names[],
+                                  const double *const contattr[])
+{
+  digraph_t *g = allocate_digraph(graph->num_nodes);
+
+  if (set_column_attributes(g, num_binattr, binattr_names, binattr,
+                            num_catattr, catattr_names, catattr,
+                            num_contattr, contattr_names, contattr)) {
+    free_digraph(g);
+    return ESTIMNET_ERROR_GRAPH;
+  }
+  free(graph->attr_block);
+  graph->attr_block = safe_malloc(digraph_attributes_block_size(g));
+  move_digraph_attributes(g, graph->attr_block);
+  free_digraph(g);
+  return ESTIMNET_OK;
+}
+
+/*
+ * Free a graph created by estimnet_graph_from_arcs() or
+ * estimnet_graph_from_pairs().
+ *
+ * Parameters:
+ *   graph - graph to free
+ *
+ * Return value:
+ *   None.
+ */
+void estimnet_free_graph(estimnet_graph_t *graph)
+{
+  if (graph->owns_arcs)
+    free(graph->arcs);
+  free(graph->attr_block);
+  memset(graph, 0, sizeof(estimnet_graph_t));
+}
+
+/*
+ * Estimate a model of a graph with Algorithm S and EE, as
+ * EstimNetDirected does for one task, but returning the estimates in
+ * memory rather than writing the theta and dzA files. The model and
+ * graph are not changed, so they can be used by other estimations at
+ * the same time (in other threads).
+ *
+ * Parameters:
+ *   model  - model from estimnet_model_from_string()
+ *   graph  - graph from estimnet_graph_from_arcs()
+ *   rng    - seed and stream of pseudorandom numbers
+ *   result - (out) estimates and standard errors (over the Algorithm
+ *            EE iterations), to be freed with free_chain_summary()
+ *
+ * Return value:
+ *   ESTIMNET_OK, or an error status (message printed to stderr).
+ */
+estimnet_status_e estimnet_estimate(const estimnet_model_t *model,
+                                    const estimnet_graph_t *graph,
+                                    const estimnet_rng_t *rng,
+                                    chain_summary_t *result)
+{
+  return estimnet_estimate_series(model, graph, rng, result, NULL, NULL);
+}
+
+/*
+ * Estimate a model of a graph as estimnet_estimate(), also returning
+ * the theta and dzA series (the records that EstimNetDirected would
+ * write to the theta and dzA files, with the same columns).
+ *
+ * Parameters:
+ *   model        - model from estimnet_model_from_string()
+ *   graph        - graph from estimnet_graph_from_arcs()
+ *   rng          - seed and stream of pseudorandom numbers
+ *   result       - (out) estimates and standard errors, to be freed
+ *                  with free_chain_summary()
+ *   theta_series - (out) if not NULL, theta series, to be freed with
+ *                  free_series_data()
+ *   dzA_series   - (out) if not NULL, dzA series, to be freed with
+ *                  free_series_data()
+ *
+ * Return value:
+ *   ESTIMNET_OK, or an error status (message printed to stderr, and
+ *   nothing to be freed).
+ */
+estimnet_status_e estimnet_estimate_series(const estimnet_model_t *model,
+                                           const estimnet_graph_t *graph,
+                                           const estimnet_rng_t *rng,
+                                           chain_summary_t *result,
+                                           series_data_t *theta_series,
+                                           series_data_t *dzA_series)
+{
+  estim_config_t *config;
+  digraph_t      *g;
+
+  memset(result, 0, sizeof(chain_summary_t));
+  if (theta_series)
+    memset(theta_series, 0, sizeof(series_data_t));
+  if (dzA_series)
+    memset(dzA_series, 0, sizeof(series_data_t));
+  if (!(config = parse_model_config(model->config_text)))
+    return ESTIMNET_ERROR_CONFIG;
+  init_prng(rng->stream);
+  if (rng->seed != 0)
+    config->seed = rng->seed;
+
+  g = allocate_digraph(graph->num_nodes);
+  set_hub_degree_threshold(g, config->hubDegreeThreshold);
+  set_arc_bitmatrix(g, config->useArcBitMatrix);
+  set_twopath_build_threads(g, config->numThreadsLoad);
+  if (graph->attr_block)
+    attach_digraph_attributes(g, graph->attr_block);
+  build_digraph_arcs(g, graph->arcs, graph->num_arcs);
+  return run_model_estimation(config, g, rng, result, theta_series,
+                              dzA_series);
+}
+
+/*
+ * Estimate a model of a network already in a digraph_t, as
+ * estimnet_estimate(), e.g. a clone (clone_digraph()) of a network
+ * simulated by SimulateERGM, so that it does not have to be written
+ * and loaded again. The settings of the model for the digraph (hub
+ * sets, bit matrix, two-path lookup method and tables) are applied to
+ * g, rebuilding only what differs from how g was built, and g is then
+ * changed by the estimation and freed.
+ *
+ * Parameters:
+ *   model  - model from estimnet_model_from_string()
+ *   g      - digraph (with the node attributes of the model), which is
+ *            freed here (also on error); if a clone, the digraph it
+ *            was cloned from must not be freed or changed until this
+ *            returns
+ *   rng    - seed and stream of pseudorandom numbers
+ *   result - (out) estimates and standard errors, to be freed with
+ *            free_chain_summary()
+ *
+ * Return value:
+ *   ESTIMNET_OK, or an error status (message printed to stderr).
+ */
+estimnet_status_e estimnet_estimate_digraph(const estimnet_model_t *model,
+                                            digraph_t *g,
+                                            const estimnet_rng_t *rng,
+                                            chain_summary_t *result)
+{
+  estim_config_t *config;
+
+  memset(result, 0, sizeof(chain_summary_t));
+  if (!(config = parse_model_config(model->config_text))) {
+    free_digraph(g);
+    return ESTIMNET_ERROR_CONFIG;
+  }
+  init_prng(rng->stream);
+  if (rng->seed != 0)
+    config->seed = rng->seed;
+
+  if (g->hub_threshold != config->hubDegreeThreshold)
+    set_hub_degree_threshold(g, config->hubDegreeThreshold);
+  if ((g->arcbitmatrix != NULL) != config->useArcBitMatrix)
+    set_arc_bitmatrix(g, config->useArcBitMatrix);
+  set_twopath_build_threads(g, config->numThreadsLoad);
+  return run_model_estimation(config, g, rng, result, NULL, NULL);
+}
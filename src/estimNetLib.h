@@ -0,0 +1,133 @@
+#ifndef ESTIMNETLIB_H
+#define ESTIMNETLIB_H
+/*****************************************************************************
+ *
+ * File:    estimNetLib.h
+ * Author:  Alex Stivala
+ * Created: October 2026
+ *
+ * Library interface (libestimnet.a) to run Algorithm S and EE estimation
+ * from another program, without starting an EstimNetDirected process
+ * and writing and reading files for each estimation. The state of an
+ * estimation is in context objects owned by the caller rather than in
+ * global variables, errors are returned as status codes (with a message
+ * on stderr) rather than exiting, and the inputs and outputs are in
+ * memory:
+ *
+ *   estimnet_model_t - the model and algorithm settings (including the
+ *                      sampler), parsed from configuration text in the
+ *                      same format as an EstimNetDirected configuration
+ *                      file; the settings for input and output files
+ *                      are not used
+ *   estimnet_graph_t - the network, as an arc list in memory (copied,
+ *                      or with estimnet_graph_from_pairs() used in
+ *                      place), and optionally node attributes (loaded
+ *                      once, from attribute files or columns in memory)
+ *   estimnet_rng_t   - the seed and stream (chain number) of the
+ *                      pseudorandom numbers
+ *   chain_summary_t  - the result: estimates and standard errors as in
+ *                      a summaryFile (see estimSummary.h)
+ *   series_data_t    - optionally, the theta and dzA series, as would
+ *                      be written to the theta and dzA files (see
+ *                      seriesWriter.h)
+ *
+ * A model and a graph are not changed by an estimation, so the same
+ * ones can be used for any number of estimations, including at the
+ * same time in different threads. Each estimation builds its own
+ * digraph_t from the graph. The pseudorandom number seeds and the
+ * pow_lookup() tables are per thread, so estimations in different
+ * threads do not share any state (but the hugePages and numaPolicy
+ * settings, if used, are for the whole process).
+ *
+ * A network already in a digraph_t (e.g. a clone of a network simulated
+ * by SimulateERGM, see simEstimate.h) can also be estimated directly
+ * with estimnet_estimate_digraph(), without converting it to arcs and
+ * building it again.
+ *
+ * Conditional estimation (snowball sampling zones), checkpoints and
+ * snapshot files are not supported through this interface.
+ *
+ ****************************************************************************/
+
+#include "utils.h"
+#include "digraph.h"
+#include "estimSummary.h"
+#include "seriesWriter.h"
+
+/* status returned by the library functions */
+typedef enum estimnet_status_e {
+  ESTIMNET_OK               =  0, /* success */
+  ESTIMNET_ERROR_CONFIG     = -1, /* configuration not valid */
+  ESTIMNET_ERROR_GRAPH      = -2, /* network or attributes not valid */
+  ESTIMNET_ERROR_ESTIMATION = -3  /* estimation failed */
+} estimnet_status_e;
+
+typedef struct estimnet_model_s { /* model and algorithm settings */
+  char      *config_text;  /* validated configuration text (parsed again
+                              for each estimation, as estimation changes
+                              the parsed configuration) */
+} estimnet_model_t;
+
+typedef struct estimnet_graph_s { /* network to estimate models of */
+  uint_t      num_nodes;   /* number of nodes */
+  arcidx_t    num_arcs;    /* length of arcs */
+  nodepair_t *arcs;        /* arcs (0-based node numbers) */
+  bool        owns_arcs;   /* arcs allocated here (else the caller's) */
+  void       *attr_block;  /* node attributes (see
+                              move_digraph_attributes()) or NULL */
+} estimnet_graph_t;
+
+typedef struct estimnet_rng_s { /* pseudorandom numbers of an estimation */
+  uint64_t  seed;          /* seed, 0 for the seed in the configuration
+                              (or if that is not set, the time) */
+  uint_t    stream;        /* stream (task or chain) number, so that
+                              estimations with the same seed are
+                              independent */
+} estimnet_rng_t;
+
+estimnet_status_e estimnet_model_from_string(const char *config_text,
+                                             estimnet_model_t *model);
+void estimnet_free_model(estimnet_model_t *model);
+
+estimnet_status_e estimnet_graph_from_arcs(uint_t num_nodes,
+                                           const uint_t from[],
+                                           const uint_t to[],
+                                           arcidx_t num_arcs,
+                                           estimnet_graph_t *graph);
+estimnet_status_e estimnet_graph_from_pairs(uint_t num_nodes,
+                                            nodepair_t arcs[],
+                                            arcidx_t num_arcs,
+                                            estimnet_graph_t *graph);
+estimnet_status_e estimnet_graph_load_attributes(estimnet_graph_t *graph,
+                                                 const char *binattr_filename,
+                                                 const char *catattr_filename,
+                                                 const char *contattr_filename,
+                                                 const char *setattr_filename);
+estimnet_status_e estimnet_graph_set_attributes(estimnet_graph_t *graph,
+                                  uint_t num_binattr,
+                                  const char *const binattr_names[],
+                                  const int *const binattr[],
+                                  uint_t num_catattr,
+                                  const char *const catattr_names[],
+                                  const int *const catattr[],
+                                  uint_t num_contattr,
+                                  const char *const contattr_names[],
+                                  const double *const contattr[]);
+void estimnet_free_graph(estimnet_graph_t *graph);
+
+estimnet_status_e estimnet_estimate(const estimnet_model_t *model,
+                                    const estimnet_graph_t *graph,
+                                    const estimnet_rng_t *rng,
+                                    chain_summary_t *result);
+estimnet_status_e estimnet_estimate_series(const estimnet_model_t *model,
+                                           const estimnet_graph_t *graph,
+                                           const estimnet_rng_t *rng,
+                                           chain_summary_t *result,
+                                           series_data_t *theta_series,
+                                           series_data_t *dzA_series);
+estimnet_status_e estimnet_estimate_digraph(const estimnet_model_t *model,
+                                            digraph_t *g,
+                                            const estimnet_rng_t *rng,
+                                            chain_summary_t *result);
+
+#endif /* ESTIMNETLIB_H */
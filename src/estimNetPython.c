@@ -0,0 +1,583 @@
+/*****************************************************************************
+ *
+ * File:    estimNetPython.c
+ * Author:  Alex Stivala
+ * Created: October 2026
+ *
+ * CPython extension module "estimnet" over the estimNetLib.h library, so
+ * that estimations can be run from Python (e.g. interactively, with
+ * NumPy) at the speed of the C code rather than with the pure Python
+ * pythonDemo/ implementation. Built with "make python" (see README).
+ *
+ * Arrays are passed through the Python buffer protocol, so NumPy arrays
+ * (or array.array, memoryview etc.) are used without copying, and the
+ * results support the buffer protocol, so numpy.asarray() of them does
+ * not copy either:
+ *
+ *   estimnet.Model(config)
+ *       config is the text of an EstimNetDirected configuration file
+ *       (the settings of input and output files are not used).
+ *
+ *   estimnet.Graph(num_nodes, arcs, binattr=None, catattr=None,
+ *                  contattr=None)
+ *       arcs is a C contiguous num_arcs x 2 array of 32 bit integers
+ *       (0-based node numbers), used in place (not copied) for as long
+ *       as the Graph exists. binattr, catattr and contattr are dicts
+ *       of attribute name to a C contiguous array of num_nodes values:
+ *       int32 (0, 1 or -1 for NA) for binary, int32 (>= 0 or -1 for
+ *       NA) for categorical and float64 (NaN for NA) for continuous.
+ *       The attributes are read directly from the arrays into the
+ *       compact form the change statistics use, once for all
+ *       estimations with the Graph.
+ *
+ *   estimnet.estimate(model, graph, seed=0, stream=0)
+ *       Runs Algorithm S and EE (with the GIL released, so estimations
+ *       in other Python threads run at the same time) and returns a
+ *       dict: "names" (parameter names), "estimate" and "stderr"
+ *       (arrays of the estimates and their standard errors), "valid"
+ *       (False if the estimates are not usable, as for a summaryFile),
+ *       "theta" and "dzA" (2-d arrays of the theta and dzA series, a
+ *       row for each record that would be written to the theta and dzA
+ *       files) and "theta_columns" and "dzA_columns" (their column
+ *       names). seed 0 uses the seed in the configuration (or the
+ *       time); estimations with the same seed and different stream
+ *       numbers are independent.
+ *
+ * Simulation (SimulateERGM) is not available through the module.
+ *
+ ****************************************************************************/
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <string.h>
+#include "estimNetLib.h"
+
+/*****************************************************************************
+ *
+ * type definitions
+ *
+ ****************************************************************************/
+
+typedef struct model_object_s { /* estimnet.Model */
+  PyObject_HEAD
+  estimnet_model_t model;
+} model_object_t;
+
+typedef struct graph_object_s { /* estimnet.Graph */
+  PyObject_HEAD
+  estimnet_graph_t graph;
+  Py_buffer        arcs_view; /* the arcs array, held while in use */
+  bool             have_view; /* arcs_view is held */
+} graph_object_t;
+
+typedef struct array_object_s { /* estimnet.Array (result arrays) */
+  PyObject_HEAD
+  double     *values;     /* the values, owned by this object */
+  int         ndim;       /* 1 or 2 */
+  Py_ssize_t  shape[2];   /* number of rows (and columns) */
+  Py_ssize_t  strides[2]; /* bytes between rows (and columns) */
+} array_object_t;
+
+static PyTypeObject ModelType;
+static PyTypeObject GraphType;
+static PyTypeObject ArrayType;
+
+/*****************************************************************************
+ *
+ * local functions
+ *
+ ****************************************************************************/
+
+/*
+ * Result array taking ownership of values (allocated with malloc()).
+ * For a 1-d array num_cols is 0. Returns NULL (with exception set)
+ * on error, in which case values is freed.
+ */
+static PyObject *new_array(double *values, Py_ssize_t num_rows,
+                           Py_ssize_t num_cols)
+{
+  array_object_t *a = PyObject_New(array_object_t, &ArrayType);
+
+  if (!a) {
+    free(values);
+    return NULL;
+  }
+  a->values = values;
+  a->ndim = num_cols ? 2 : 1;
+  a->shape[0] = num_rows;
+  a->shape[1] = num_cols;
+  a->strides[0] = (num_cols ? num_cols : 1) * (Py_ssize_t)sizeof(double);
+  a->strides[1] = sizeof(double);
+  return (PyObject *)a;
+}
+
+/*
+ * Copy of an array of n doubles as a result array.
+ */
+static PyObject *copy_array(const double *values, uint_t n)
+{
+  double *copy = (double *)malloc(MAX(n, 1) * sizeof(double));
+
+  if (!copy)
+    return PyErr_NoMemory();
+  if (n > 0)
+    memcpy(copy, values, n * sizeof(double));
+  return new_array(copy, n, 0);
+}
+
+/*
+ * List of the names in a string of names separated by spaces.
+ */
+static PyObject *split_names(const char *names)
+{
+  PyObject *str, *list;
+
+  if (!(str = PyUnicode_FromString(names ? names : "")))
+    return NULL;
+  list = PyUnicode_Split(str, NULL, -1);
+  Py_DECREF(str);
+  return list;
+}
+
+/*
+ * Check that a buffer holds C contiguous values of the given size
+ * and struct module type codes (e.g. "iI" for 32 bit integers).
+ * Returns nonzero (with exception set) if not.
+ */
+static int check_buffer(const Py_buffer *view, const char *what,
+                        Py_ssize_t itemsize, const char *codes)
+{
+  const char *fmt = view->format ? view->format : "B";
+  size_t      len = strlen(fmt);
+
+  /* allow a byte order character, e.g. "<i" */
+  if (len == 2 && strchr("@=<>!", fmt[0]))
+    fmt++, len--;
+  if (len != 1 || !strchr(codes, fmt[0]) || view->itemsize != itemsize) {
+    PyErr_Format(PyExc_TypeError, "%s must be an array of %s", what,
+                 itemsize == sizeof(double) && strchr(codes, 'd') ?
+                 "float64" : "int32");
+    return 1;
+  }
+  return 0;
+}
+
+/*
+ * Get the names and (C contiguous) column buffers of one kind of
+ * attributes from a dict of name to array (or None for none). The
+ * names and columns arrays and views are allocated here, and the views
+ * are to be released with release_columns(). Returns nonzero (with
+ * exception set) on error.
+ */
+static int get_columns(PyObject *dict, const char *what, uint_t num_nodes,
+                       Py_ssize_t itemsize, const char *codes,
+                       uint_t *num_attr, const char ***names,
+                       const void ***columns, Py_buffer **views)
+{
+  PyObject  *key, *value;
+  Py_ssize_t pos = 0;
+  uint_t     n = 0;
+
+  *num_attr = 0;
+  *names = NULL;
+  *columns = NULL;
+  *views = NULL;
+  if (!dict || dict == Py_None)
+    return 0;
+  if (!PyDict_Check(dict)) {
+    PyErr_Format(PyExc_TypeError, "%s must be a dict of name to array",
+                 what);
+    return 1;
+  }
+  *names = (const char **)PyMem_Calloc(PyDict_Size(dict) + 1,
+                                       sizeof(const char *));
+  *columns = (const void **)PyMem_Calloc(PyDict_Size(dict) + 1,
+                                         sizeof(const void *));
+  *views = (Py_buffer *)PyMem_Calloc(PyDict_Size(dict) + 1,
+                                     sizeof(Py_buffer));
+  if (!*names || !*columns || !*views) {
+    PyErr_NoMemory();
+    return 1;
+  }
+  while (PyDict_Next(dict, &pos, &key, &value)) {
+    if (!((*names)[n] = PyUnicode_AsUTF8(key)))
+      return 1;
+    if (PyObject_GetBuffer(value, &(*views)[n],
+                           PyBUF_C_CONTIGUOUS | PyBUF_FORMAT))
+      return 1;
+    *num_attr = ++n;
+    if (check_buffer(&(*views)[n-1], what, itemsize, codes))
+      return 1;
+    if ((*views)[n-1].ndim != 1 ||
+        (*views)[n-1].shape[0] != (Py_ssize_t)num_nodes) {
+      PyErr_Format(PyExc_ValueError, "%s %s must have %u values", what,
+                   (*names)[n-1], num_nodes);
+      return 1;
+    }
+    (*columns)[n-1] = (*views)[n-1].buf;
+  }
+  return 0;
+}
+
+/*
+ * Release the buffers and free the arrays from get_columns().
+ */
+static void release_columns(uint_t num_attr, const char **names,
+                            const void **columns, Py_buffer *views)
+{
+  uint_t i;
+
+  for (i = 0; i < num_attr; i++)
+    PyBuffer_Release(&views[i]);
+  PyMem_Free((void *)names);
+  PyMem_Free((void *)columns);
+  PyMem_Free(views);
+}
+
+/*****************************************************************************
+ *
+ * estimnet.Model
+ *
+ ****************************************************************************/
+
+static int Model_init(model_object_t *self, PyObject *args, PyObject *kwds)
+{
+  static char *kwlist[] = {"config", NULL};
+  const char  *config_text;
+
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "s", kwlist, &config_text))
+    return -1;
+  estimnet_free_model(&self->model);
+  if (estimnet_model_from_string(config_text, &self->model) != ESTIMNET_OK) {
+    PyErr_SetString(PyExc_ValueError,
+                    "configuration not valid (see messages on stderr)");
+    return -1;
+  }
+  return 0;
+}
+
+static void Model_dealloc(model_object_t *self)
+{
+  estimnet_free_model(&self->model);
+  Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static PyTypeObject ModelType = {
+  PyVarObject_HEAD_INIT(NULL, 0)
+  .tp_name = "estimnet.Model",
+  .tp_doc = "Model(config): model and algorithm settings, from the text of "
+            "an EstimNetDirected configuration file",
+  .tp_basicsize = sizeof(model_object_t),
+  .tp_flags = Py_TPFLAGS_DEFAULT,
+  .tp_new = PyType_GenericNew,
+  .tp_init = (initproc)Model_init,
+  .tp_dealloc = (destructor)Model_dealloc,
+};
+
+/*****************************************************************************
+ *
+ * estimnet.Graph
+ *
+ ****************************************************************************/
+
+static void Graph_clear(graph_object_t *self)
+{
+  estimnet_free_graph(&self->graph);
+  if (self->have_view)
+    PyBuffer_Release(&self->arcs_view);
+  self->have_view = FALSE;
+}
+
+static int Graph_init(graph_object_t *self, PyObject *args, PyObject *kwds)
+{
+  static char *kwlist[] = {"num_nodes", "arcs", "binattr", "catattr",
+                           "contattr", NULL};
+  unsigned int num_nodes;
+  PyObject    *arcs, *binattr = NULL, *catattr = NULL, *contattr = NULL;
+  uint_t       num_bin = 0, num_cat = 0, num_cont = 0;
+  const char **bin_names = NULL, **cat_names = NULL, **cont_names = NULL;
+  const void **bin_cols = NULL, **cat_cols = NULL, **cont_cols = NULL;
+  Py_buffer   *bin_views = NULL, *cat_views = NULL, *cont_views = NULL;
+  int          rc = -1;
+
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "IO|OOO", kwlist,
+                                   &num_nodes, &arcs, &binattr, &catattr,
+                                   &contattr))
+    return -1;
+  Graph_clear(self);
+  if (PyObject_GetBuffer(arcs, &self->arcs_view,
+                         PyBUF_C_CONTIGUOUS | PyBUF_FORMAT))
+    return -1;
+  self->have_view = TRUE;
+  if (check_buffer(&self->arcs_view, "arcs", sizeof(nodeid_t), "iIlL"))
+    return -1;
+  if (!((self->arcs_view.ndim == 2 && self->arcs_view.shape[1] == 2) ||
+        (self->arcs_view.ndim == 1 && self->arcs_view.shape[0] == 0))) {
+    PyErr_SetString(PyExc_ValueError, "arcs must have shape (num_arcs, 2)");
+    return -1;
+  }
+  if (estimnet_graph_from_pairs(num_nodes,
+                                (nodepair_t *)self->arcs_view.buf,
+                                (arcidx_t)(self->arcs_view.len /
+                                           sizeof(nodepair_t)),
+                                &self->graph) != ESTIMNET_OK) {
+    PyErr_SetString(PyExc_ValueError,
+                    "graph not valid (see messages on stderr)");
+    return -1;
+  }
+
+  if (!get_columns(binattr, "binattr", num_nodes, sizeof(int), "il",
+                   &num_bin, &bin_names, &bin_cols, &bin_views) &&
+      !get_columns(catattr, "catattr", num_nodes, sizeof(int), "il",
+                   &num_cat, &cat_names, &cat_cols, &cat_views) &&
+      !get_columns(contattr, "contattr", num_nodes, sizeof(double), "d",
+                   &num_cont, &cont_names, &cont_cols, &cont_views)) {
+    if (num_bin + num_cat + num_cont == 0)
+      rc = 0;
+    else if (estimnet_graph_set_attributes(&self->graph,
+                                           num_bin, bin_names,
+                                           (const int *const *)bin_cols,
+                                           num_cat, cat_names,
+                                           (const int *const *)cat_cols,
+                                           num_cont, cont_names,
+                                           (const double *const *)cont_cols)
+             == ESTIMNET_OK)
+      rc = 0;
+    else
+      PyErr_SetString(PyExc_ValueError,
+                      "attributes not valid (see messages on stderr)");
+  }
+  /* ones not got are NULL (and 0) */
+  release_columns(num_bin, bin_names, bin_cols, bin_views);
+  release_columns(num_cat, cat_names, cat_cols, cat_views);
+  release_columns(num_cont, cont_names, cont_cols, cont_views);
+  return rc;
+}
+
+static void Graph_dealloc(graph_object_t *self)
+{
+  Graph_clear(self);
+  Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static PyTypeObject GraphType = {
+  PyVarObject_HEAD_INIT(NULL, 0)
+  .tp_name = "estimnet.Graph",
+  .tp_doc = "Graph(num_nodes, arcs, binattr=None, catattr=None, "
+            "contattr=None): network (arcs used in place, not copied) "
+            "and node attributes",
+  .tp_basicsize = sizeof(graph_object_t),
+  .tp_flags = Py_TPFLAGS_DEFAULT,
+  .tp_new = PyType_GenericNew,
+  .tp_init = (initproc)Graph_init,
+  .tp_dealloc = (destructor)Graph_dealloc,
+};
+
+/*****************************************************************************
+ *
+ * estimnet.Array
+ *
+ ****************************************************************************/
+
+static int Array_getbuffer(array_object_t *self, Py_buffer *view, int flags)
+{
+  if (flags & PyBUF_WRITABLE) {
+    PyErr_SetString(PyExc_BufferError, "estimnet.Array is read-only");
+    return -1;
+  }
+  view->obj = (PyObject *)self;
+  Py_INCREF(self);
+  view->buf = self->values;
+  view->itemsize = sizeof(double);
+  view->len = self->shape[0] * (self->ndim == 2 ? self->shape[1] : 1) *
+    (Py_ssize_t)sizeof(double);
+  view->readonly = 1;
+  view->ndim = self->ndim;
+  view->format = (flags & PyBUF_FORMAT) ? "d" : NULL;
+  view->shape = (flags & PyBUF_ND) ? self->shape : NULL;
+  view->strides = (flags & PyBUF_STRIDES) == PyBUF_STRIDES ? self->strides
+    : NULL;
+  view->suboffsets = NULL;
+  view->internal = NULL;
+  return 0;
+}
+
+static Py_ssize_t Array_length(array_object_t *self)
+{
+  return self->shape[0];
+}
+
+static PyObject *Array_tolist(array_object_t *self,
+                              PyObject *Py_UNUSED(ignored))
+{
+  PyObject *view = PyMemoryView_FromObject((PyObject *)self);
+  PyObject *list;
+
+  if (!view)
+    return NULL;
+  list = PyObject_CallMethod(view, "tolist", NULL);
+  Py_DECREF(view);
+  return list;
+}
+
+static PyObject *Array_get_shape(array_object_t *self,
+                                 void *Py_UNUSED(closure))
+{
+  return self->ndim == 2 ? Py_BuildValue("(nn)", self->shape[0],
+                                         self->shape[1])
+    : Py_BuildValue("(n)", self->shape[0]);
+}
+
+static void Array_dealloc(array_object_t *self)
+{
+  free(self->values);
+  Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static PyBufferProcs Array_as_buffer = {
+  .bf_getbuffer = (getbufferproc)Array_getbuffer,
+};
+
+static PySequenceMethods Array_as_sequence = {
+  .sq_length = (lenfunc)Array_length,
+};
+
+static PyMethodDef Array_methods[] = {
+  {"tolist", (PyCFunction)Array_tolist, METH_NOARGS,
+   "The values as a list (of lists of rows for a 2-d array)"},
+  {NULL, NULL, 0, NULL}
+};
+
+static PyGetSetDef Array_getset[] = {
+  {"shape", (getter)Array_get_shape, NULL, "Shape of the array", NULL},
+  {NULL, NULL, NULL, NULL, NULL}
+};
+
+static PyTypeObject ArrayType = {
+  PyVarObject_HEAD_INIT(NULL, 0)
+  .tp_name = "estimnet.Array",
+  .tp_doc = "Read-only array of float64 results; numpy.asarray() "
+            "uses it without copying",
+  .tp_basicsize = sizeof(array_object_t),
+  .tp_flags = Py_TPFLAGS_DEFAULT,
+  .tp_dealloc = (destructor)Array_dealloc,
+  .tp_as_buffer = &Array_as_buffer,
+  .tp_as_sequence = &Array_as_sequence,
+  .tp_methods = Array_methods,
+  .tp_getset = Array_getset,
+};
+
+/*****************************************************************************
+ *
+ * module functions
+ *
+ ****************************************************************************/
+
+/*
+ * Result array of a series, taking ownership of its values.
+ */
+static PyObject *series_array(series_data_t *series)
+{
+  double *values = series->values;
+
+  series->values = NULL;
+  if (!values && !(values = (double *)malloc(sizeof(double))))
+    return PyErr_NoMemory();
+  return new_array(values, (Py_ssize_t)series->num_records,
+                   (Py_ssize_t)series->num_columns);
+}
+
+static PyObject *estimnet_estimate_py(PyObject *Py_UNUSED(module),
+                                      PyObject *args, PyObject *kwds)
+{
+  static char       *kwlist[] = {"model", "graph", "seed", "stream", NULL};
+  model_object_t    *model;
+  graph_object_t    *graph;
+  unsigned long long seed = 0;
+  unsigned int       stream = 0;
+  estimnet_rng_t     rng;
+  chain_summary_t    summary;
+  series_data_t      theta_series, dzA_series;
+  estimnet_status_e  status;
+  PyObject          *result;
+
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "O!O!|KI", kwlist,
+                                   &ModelType, &model, &GraphType, &graph,
+                                   &seed, &stream))
+    return NULL;
+  if (!model->model.config_text || !graph->have_view) {
+    PyErr_SetString(PyExc_ValueError, "model or graph not initialized");
+    return NULL;
+  }
+  rng.seed = seed;
+  rng.stream = stream;
+  Py_BEGIN_ALLOW_THREADS
+  status = estimnet_estimate_series(&model->model, &graph->graph, &rng,
+                                    &summary, &theta_series, &dzA_series);
+  Py_END_ALLOW_THREADS
+  if (status != ESTIMNET_OK) {
+    PyErr_SetString(PyExc_RuntimeError,
+                    "estimation failed (see messages on stderr)");
+    return NULL;
+  }
+
+  result = Py_BuildValue("{s:N,s:N,s:N,s:O,s:N,s:N,s:N,s:N}",
+                         "names", split_names(summary.param_names),
+                         "estimate", copy_array(summary.est, summary.n),
+                         "stderr", copy_array(summary.se, summary.n),
+                         "valid", summary.valid ? Py_True : Py_False,
+                         "theta", series_array(&theta_series),
+                         "theta_columns", split_names(theta_series.header),
+                         "dzA", series_array(&dzA_series),
+                         "dzA_columns", split_names(dzA_series.header));
+  free_chain_summary(&summary);
+  free_series_data(&theta_series);
+  free_series_data(&dzA_series);
+  return result;
+}
+
+static PyMethodDef estimnet_methods[] = {
+  {"estimate", (PyCFunction)(void (*)(void))estimnet_estimate_py,
+   METH_VARARGS | METH_KEYWORDS,
+   "estimate(model, graph, seed=0, stream=0): run Algorithm S and EE, "
+   "returning a dict of the estimates, standard errors and theta and dzA "
+   "series"},
+  {NULL, NULL, 0, NULL}
+};
+
+static struct PyModuleDef estimnet_module = {
+  PyModuleDef_HEAD_INIT,
+  .m_name = "estimnet",
+  .m_doc = "EstimNetDirected estimation (see src/estimNetPython.c)",
+  .m_size = -1,
+  .m_methods = estimnet_methods,
+};
+
+/*****************************************************************************
+ *
+ * externally visible functions
+ *
+ ****************************************************************************/
+
+PyMODINIT_FUNC PyInit_estimnet(void);
+
+PyMODINIT_FUNC PyInit_estimnet(void)
+{
+  PyObject *m;
+
+  if (PyType_Ready(&ModelType) < 0 || PyType_Ready(&GraphType) < 0 ||
+      PyType_Ready(&ArrayType) < 0)
+    return NULL;
+  if (!(m = PyModule_Create(&estimnet_module)))
+    return NULL;
+  Py_INCREF(&ModelType);
+  Py_INCREF(&GraphType);
+  Py_INCREF(&ArrayType);
+  if (PyModule_AddObject(m, "Model", (PyObject *)&ModelType) < 0 ||
+      PyModule_AddObject(m, "Graph", (PyObject *)&GraphType) < 0 ||
+      PyModule_AddObject(m, "Array", (PyObject *)&ArrayType) < 0) {
+    Py_DECREF(m);
+    return NULL;
+  }
+  return m;
+}
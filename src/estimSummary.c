@@ -0,0 +1,541 @@
+/*****************************************************************************
+ *
+ * File:    estimSummary.c
+ * Author:  Alex Stivala, Maksym Byshkin
+ * Created: October 2026
+ *
+ * Summary of the estimates from one or more Algorithm EE runs (see
+ * estimSummary.h), following computeEstimNetDirectedCovariance.R.
+ *
+ ****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <float.h>
+#include <math.h>
+#include "estimSummary.h"
+
+/*****************************************************************************
+ *
+ * local constants
+ *
+ ****************************************************************************/
+
+/* abs t-ratio must be <= this value for convergence (as in R script) */
+static const double T_RATIO_THRESHOLD = 0.3;
+
+/* z-score for alpha = 0.05 (95% confidence interval) */
+static const double Z_SIGMA = 1.959964;
+
+/* runs with any estimate larger in magnitude than this are removed */
+static const double HUGE_ESTIMATE = 1e10;
+
+/*****************************************************************************
+ *
+ * local functions
+ *
+ ****************************************************************************/
+
+/*
+ * Combine the batches first..num_batches-1 of one statistic (theta or
+ * dzA) of parameter l into the overall mean and sample variance.
+ */
+static void combine_batches(const ee_batches_t *b, uint_t first,
+                            const double *batch_mean, const double *batch_var,
+                            uint_t l, double *mean, double *var)
+{
+  uint_t k;
+  double num = 0, sum = 0, ss = 0, d;
+
+  for (k = first; k < b->num_batches; k++) {
+    num += b->count[k];
+    sum += b->count[k] * batch_mean[k * b->n + l];
+  }
+  *mean = sum / num;
+  for (k = first; k < b->num_batches; k++) {
+    d = batch_mean[k * b->n + l] - *mean;
+    ss += b->count[k] * (batch_var[k * b->n + l] + d * d);
+  }
+  *var = num > 1 ? ss / (num - 1) : 0;
+}
+
+/*
+ * Write one line of estimate results in the format of
+ * computeEstimNetDirectedCovariance.R: name, estimate, sd(theta),
+ * standard error, t-ratio, and '*' if significant (and converged).
+ */
+static void write_estimate_line(FILE *fp, const char *name, double est,
+                                double sd, double se, double tratio)
+{
+  bool signif = fabs(tratio) <= T_RATIO_THRESHOLD &&
+    fabs(est) > Z_SIGMA * se;
+  fprintf(fp, "%s %g %g %g %g %s\n", name, est, sd, se, tratio,
+          signif ? "*" : "");
+}
+
+/*****************************************************************************
+ *
+ * externally visible functions
+ *
+ ****************************************************************************/
+
+/*
+ * Invert the n x n matrix a (row major) in place by Gauss-Jordan
+ * elimination with partial pivoting.
+ *
+ * Parameters:
+ *   a - (in/out) matrix to invert, replaced by its inverse (or
+ *       destroyed if it is singular)
+ *   n - number of rows and columns of a
+ *
+ * Return value:
+ *   0 if OK else nonzero if a is computationally singular.
+ */
+int invert_matrix(double *a, uint_t n)
+{
+  uint_t *perm = (uint_t *)safe_malloc(n * sizeof(uint_t));
+  uint_t  i, j, k, p;
+  double  scale = 0, pivot, factor, tmp;
+  int     singular = 0;
+
+  for (i = 0; i < n * n; i++)
+    scale = MAX(scale, fabs(a[i]));
+  for (k = 0; k < n && !singular; k++) {
+    p = k;
+    for (i = k + 1; i < n; i++)
+      if (fabs(a[i * n + k]) > fabs(a[p * n + k]))
+        p = i;
+    perm[k] = p;
+    if (!(fabs(a[p * n + k]) > DBL_EPSILON * n * scale)) {
+      singular = 1;
+      break;
+    }
+    if (p != k) {
+      for (j = 0; j < n; j++) {
+        tmp = a[k * n + j];
+        a[k * n + j] = a[p * n + j];
+        a[p * n + j] = tmp;
+      }
+    }
+    pivot = a[k * n + k];
+    a[k * n + k] = 1;
+    for (j = 0; j < n; j++)
+      a[k * n + j] /= pivot;
+    for (i = 0; i < n; i++) {
+      if (i != k) {
+        factor = a[i * n + k];
+        a[i * n + k] = 0;
+        for (j = 0; j < n; j++)
+          a[i * n + j] -= factor * a[k * n + j];
+      }
+    }
+  }
+  if (!singular) {
+    /* undo the row interchanges by interchanging columns in reverse */
+    for (k = n; k-- > 0; ) {
+      if (perm[k] != k) {
+        for (i = 0; i < n; i++) {
+          tmp = a[i * n + k];
+          a[i * n + k] = a[i * n + perm[k]];
+          a[i * n + perm[k]] = tmp;
+        }
+      }
+    }
+  }
+  free(perm);
+  return singular;
+}
+
+/*
+ * Allocate per outer iteration statistics for Algorithm EE.
+ *
+ * Parameters:
+ *   batches     - (Out) batch statistics, with no batches
+ *   n           - number of parameters
+ *   max_batches - maximum number of batches (outer iterations)
+ *
+ * Return value:
+ *   None.
+ */
+void init_ee_batches(ee_batches_t *batches, uint_t n, uint_t max_batches)
+{
+  batches->n = n;
+  batches->max_batches = max_batches;
+  batches->num_batches = 0;
+  batches->count = (double *)safe_malloc(max_batches * sizeof(double));
+  batches->theta_mean = (double *)safe_malloc((size_t)max_batches * n *
+                                              sizeof(double));
+  batches->theta_var = (double *)safe_malloc((size_t)max_batches * n *
+                                             sizeof(double));
+  batches->dzA_mean = (double *)safe_malloc((size_t)max_batches * n *
+                                            sizeof(double));
+  batches->dzA_var = (double *)safe_malloc((size_t)max_batches * n *
+                                           sizeof(double));
+}
+
+/*
+ * Add the statistics of theta and dzA over the inner iterations of an
+ * outer iteration of Algorithm EE as the next batch.
+ *
+ * Parameters:
+ *   batches     - batch statistics
+ *   theta_stats - running statistics of theta over the inner iterations
+ *   dzA_stats   - running statistics of dzA over the inner iterations
+ *
+ * Return value:
+ *   None.
+ */
+void add_ee_batch(ee_batches_t *batches, const online_stats_t *theta_stats,
+                  const online_stats_t *dzA_stats)
+{
+  uint_t k = batches->num_batches, l;
+  double sd;
+
+  if (k >= batches->max_batches)
+    return;
+  batches->count[k] = theta_stats->count;
+  for (l = 0; l < batches->n; l++) {
+    batches->theta_mean[k * batches->n + l] = theta_stats->mean[l];
+    sd = online_stats_sd(theta_stats, l);
+    batches->theta_var[k * batches->n + l] = sd * sd;
+    batches->dzA_mean[k * batches->n + l] = dzA_stats->mean[l];
+    sd = online_stats_sd(dzA_stats, l);
+    batches->dzA_var[k * batches->n + l] = sd * sd;
+  }
+  batches->num_batches++;
+}
+
+/*
+ * Free per outer iteration statistics.
+ *
+ * Parameters:
+ *   batches - batch statistics initialized with init_ee_batches()
+ *
+ * Return value:
+ *   None.
+ */
+void free_ee_batches(ee_batches_t *batches)
+{
+  free(batches->count);
+  free(batches->theta_mean);
+  free(batches->theta_var);
+  free(batches->dzA_mean);
+  free(batches->dzA_var);
+  batches->count = batches->theta_mean = batches->theta_var = NULL;
+  batches->dzA_mean = batches->dzA_var = NULL;
+}
+
+/*
+ * Allocate the arrays of a chain summary.
+ *
+ * Parameters:
+ *   summary - (Out) chain summary, not valid
+ *   n       - number of parameters
+ *
+ * Return value:
+ *   None.
+ */
+void init_chain_summary(chain_summary_t *summary, uint_t n)
+{
+  summary->n = n;
+  summary->valid = FALSE;
+  summary->num_samples = 0;
+  summary->est = (double *)safe_calloc(n, sizeof(double));
+  summary->theta_var = (double *)safe_calloc(n, sizeof(double));
+  summary->se = (double *)safe_calloc(n, sizeof(double));
+  summary->dzA_mean = (double *)safe_calloc(n, sizeof(double));
+  summary->dzA_var = (double *)safe_calloc(n, sizeof(double));
+  summary->param_names = NULL;
+}
+
+/*
+ * Summarize the estimates from the second half of the batches of one
+ * chain. The chain is not valid (and is not used in pooled estimates)
+ * if there are fewer than two batches in the second half, or any
+ * estimate is NaN or huge, or the covariance matrix of dzA is
+ * computationally singular (possibly degenerate model, or not more
+ * batches in the second half than there are parameters).
+ *
+ * Parameters:
+ *   batches - batch statistics of Algorithm EE
+ *   summary - (Out) chain summary, initialized with init_chain_summary()
+ *
+ * Return value:
+ *   NULL if the chain is valid, else the reason it is not.
+ */
+const char *compute_chain_summary(const ee_batches_t *batches,
+                           chain_summary_t *summary)
+{
+  uint_t  n = batches->n;
+  uint_t  first = batches->num_batches / 2;
+  double  a = batches->num_batches - first; /* number of batches used */
+  double *acov;
+  double  mcmc_var, d, di, dj;
+  uint_t  i, j, k;
+
+  summary->valid = FALSE;
+  summary->num_samples = 0;
+  if (a < 2)
+    return "not enough iterations";
+  for (k = first; k < batches->num_batches; k++)
+    summary->num_samples += batches->count[k];
+  for (i = 0; i < n; i++) {
+    combine_batches(batches, first, batches->theta_mean, batches->theta_var,
+                    i, &summary->est[i], &summary->theta_var[i]);
+    combine_batches(batches, first, batches->dzA_mean, batches->dzA_var,
+                    i, &summary->dzA_mean[i], &summary->dzA_var[i]);
+    if (!isfinite(summary->est[i]))
+      return "NaN";
+    if (fabs(summary->est[i]) > HUGE_ESTIMATE)
+      return "huge values";
+  }
+
+  /* covariance matrix of the dzA estimate (batch means, as
+     mcse.multi() divided by the number of samples) */
+  acov = (double *)safe_malloc((size_t)n * n * sizeof(double));
+  for (i = 0; i < n; i++) {
+    for (j = 0; j < n; j++) {
+      acov[i * n + j] = 0;
+      for (k = first; k < batches->num_batches; k++) {
+        di = batches->dzA_mean[k * n + i] - summary->dzA_mean[i];
+        dj = batches->dzA_mean[k * n + j] - summary->dzA_mean[j];
+        acov[i * n + j] += di * dj;
+      }
+      acov[i * n + j] /= a * (a - 1);
+    }
+  }
+  /* ERGM MLE covariance is its inverse */
+  if (invert_matrix(acov, n)) {
+    free(acov);
+    return "computationally singular covariance matrix";
+  }
+  for (i = 0; i < n; i++) {
+    /* MCMC variance of the estimate (batch means) */
+    mcmc_var = 0;
+    for (k = first; k < batches->num_batches; k++) {
+      d = batches->theta_mean[k * n + i] - summary->est[i];
+      mcmc_var += d * d;
+    }
+    mcmc_var /= a * (a - 1);
+    summary->se[i] = sqrt(mcmc_var + acov[i * n + i]);
+  }
+  free(acov);
+  summary->valid = TRUE;
+  return NULL;
+}
+
+/*
+ * Pack a chain summary into an array of doubles.
+ *
+ * Parameters:
+ *   summary - chain summary
+ *   buf     - (Out) array of CHAIN_SUMMARY_LEN(summary->n) doubles
+ *
+ * Return value:
+ *   None.
+ */
+void pack_chain_summary(const chain_summary_t *summary, double buf[])
+{
+  uint_t n = summary->n;
+
+  buf[0] = summary->valid;
+  buf[1] = summary->num_samples;
+  memcpy(buf + 2, summary->est, n * sizeof(double));
+  memcpy(buf + 2 + n, summary->theta_var, n * sizeof(double));
+  memcpy(buf + 2 + 2 * n, summary->se, n * sizeof(double));
+  memcpy(buf + 2 + 3 * n, summary->dzA_mean, n * sizeof(double));
+  memcpy(buf + 2 + 4 * n, summary->dzA_var, n * sizeof(double));
+}
+
+/*
+ * Unpack a chain summary from an array of doubles.
+ *
+ * Parameters:
+ *   buf     - array of CHAIN_SUMMARY_LEN(summary->n) doubles
+ *             written by pack_chain_summary()
+ *   summary - (Out) chain summary, initialized with init_chain_summary()
+ *
+ * Return value:
+ *   None.
+ */
+void unpack_chain_summary(const double buf[], chain_summary_t *summary)
+{
+  uint_t n = summary->n;
+
+  summary->valid = buf[0] > 0;
+  summary->num_samples = buf[1];
+  memcpy(summary->est, buf + 2, n * sizeof(double));
+  memcpy(summary->theta_var, buf + 2 + n, n * sizeof(double));
+  memcpy(summary->se, buf + 2 + 2 * n, n * sizeof(double));
+  memcpy(summary->dzA_mean, buf + 2 + 3 * n, n * sizeof(double));
+  memcpy(summary->dzA_var, buf + 2 + 4 * n, n * sizeof(double));
+}
+
+/*
+ * Free the arrays of a chain summary.
+ *
+ * Parameters:
+ *   summary - chain summary initialized with init_chain_summary()
+ *
+ * Return value:
+ *   None.
+ */
+void free_chain_summary(chain_summary_t *summary)
+{
+  free(summary->est);
+  free(summary->theta_var);
+  free(summary->se);
+  free(summary->dzA_mean);
+  free(summary->dzA_var);
+  free(summary->param_names);
+  summary->param_names = NULL;
+  summary->est = summary->theta_var = summary->se = NULL;
+  summary->dzA_mean = summary->dzA_var = NULL;
+}
+
+/*
+ * Write the summary file: the estimates of each valid run then the
+ * pooled estimates, in the same format as the output of
+ * computeEstimNetDirectedCovariance.R (so the scripts that make tables
+ * from that work on it too), followed by the R-hat of each parameter
+ * (NA if fewer than two valid runs).
+ *
+ * Parameters:
+ *   filename    - name of summary file to write
+ *   summaries   - summary of each chain (run), numbered from 0
+ *   num_chains  - number of chains
+ *   first_run   - run number of the first chain (as in output filenames)
+ *   param_names - parameter names separated by spaces, or NULL
+ *
+ * Return value:
+ *   0 if OK else nonzero on error (message printed to stderr).
+ */
+int write_estimation_summary(const char *filename,
+                             const chain_summary_t summaries[],
+                             uint_t num_chains, uint_t first_run,
+                             const char *param_names)
+{
+  FILE   *fp;
+  char   *names_copy, *saveptr = NULL, *name;
+  const char **names;
+  uint_t  n = num_chains > 0 ? summaries[0].n : 0;
+  uint_t  r, l, kept = 0;
+  double  num, sum, ss, mean, d, w, sum_means, sum_sqmeans, var_plus;
+  double  inv_var, est, se, sd, tratio, rhat;
+
+  if (!(fp = fopen(filename, "w"))) {
+    fprintf(stderr, "ERROR: could not open summary file %s for writing "
+            "(%s)\n", filename, strerror(errno));
+    return -1;
+  }
+  names_copy = safe_strdup(param_names ? param_names : "");
+  names = (const char **)safe_malloc((n + 1) * sizeof(char *));
+  for (l = 0; l < n; l++) {
+    name = strtok_r(l == 0 ? names_copy : NULL, " ", &saveptr);
+    names[l] = name ? name : "?";
+  }
+
+  for (r = 0; r < num_chains; r++) {
+    if (!summaries[r].valid)
+      continue;
+    kept++;
+    fprintf(fp, "\nRun %u\n", first_run + r);
+    for (l = 0; l < n; l++)
+      write_estimate_line(fp, names[l], summaries[r].est[l],
+                          sqrt(summaries[r].theta_var[l]), summaries[r].se[l],
+                          summaries[r].dzA_mean[l] /
+                          sqrt(summaries[r].dzA_var[l]));
+  }
+
+  fprintf(fp, "\nPooled\n");
+  for (l = 0; l < n; l++) {
+    if (kept == 0) {
+      fprintf(fp, "%s NA NA NA NA \n", names[l]);
+      continue;
+    }
+    /* inverse-variance weighted mean of estimates */
+    sum = inv_var = 0;
+    for (r = 0; r < num_chains; r++) {
+      if (summaries[r].valid) {
+        sum += summaries[r].est[l] / (summaries[r].se[l] * summaries[r].se[l]);
+        inv_var += 1 / (summaries[r].se[l] * summaries[r].se[l]);
+      }
+    }
+    est = sum / inv_var;
+    se = sqrt(1 / inv_var);
+    /* sd of theta and t-ratio of dzA over all runs combined */
+    num = sum = 0;
+    for (r = 0; r < num_chains; r++) {
+      if (summaries[r].valid) {
+        num += summaries[r].num_samples;
+        sum += summaries[r].num_samples * summaries[r].est[l];
+      }
+    }
+    mean = sum / num;
+    ss = 0;
+    for (r = 0; r < num_chains; r++) {
+      if (summaries[r].valid) {
+        d = summaries[r].est[l] - mean;
+        ss += (summaries[r].num_samples - 1) * summaries[r].theta_var[l] +
+          summaries[r].num_samples * d * d;
+      }
+    }
+    sd = sqrt(ss / (num - 1));
+    sum = 0;
+    for (r = 0; r < num_chains; r++)
+      if (summaries[r].valid)
+        sum += summaries[r].num_samples * summaries[r].dzA_mean[l];
+    mean = sum / num;
+    ss = 0;
+    for (r = 0; r < num_chains; r++) {
+      if (summaries[r].valid) {
+        d = summaries[r].dzA_mean[l] - mean;
+        ss += (summaries[r].num_samples - 1) * summaries[r].dzA_var[l] +
+          summaries[r].num_samples * d * d;
+      }
+    }
+    tratio = mean / sqrt(ss / (num - 1));
+    write_estimate_line(fp, names[l], est, sd, se, tratio);
+  }
+  fprintf(fp, "TotalRuns %u \n", num_chains);
+  fprintf(fp, "ConvergedRuns %u \n", kept);
+
+  /* Gelman-Rubin R-hat: W is mean within-chain variance, and the
+     between-chain variance B/N is the variance of the chain means */
+  fprintf(fp, "\nRhat\n");
+  for (l = 0; l < n; l++) {
+    rhat = NAN;
+    if (kept > 1) {
+      num = w = sum_means = sum_sqmeans = 0;
+      for (r = 0; r < num_chains; r++) {
+        if (summaries[r].valid) {
+          num += summaries[r].num_samples;
+          w += summaries[r].theta_var[l];
+          sum_means += summaries[r].est[l];
+          sum_sqmeans += summaries[r].est[l] * summaries[r].est[l];
+        }
+      }
+      num /= kept;
+      w /= kept;
+      var_plus = (num - 1) / num * w +
+        MAX(sum_sqmeans - sum_means * sum_means / kept, 0) / (kept - 1);
+      if (w > 0)
+        rhat = sqrt(var_plus / w);
+    }
+    if (isnan(rhat))
+      fprintf(fp, "%s NA\n", names[l]);
+    else
+      fprintf(fp, "%s %g\n", names[l], rhat);
+  }
+
+  free(names);
+  free(names_copy);
+  if (fclose(fp)) {
+    fprintf(stderr, "ERROR: writing summary file %s failed (%s)\n",
+            filename, strerror(errno));
+    return -1;
+  }
+  return 0;
+}
@@ -0,0 +1,82 @@
+#ifndef ESTIMSUMMARY_H
+#define ESTIMSUMMARY_H
+/*****************************************************************************
+ *
+ * File:    estimSummary.h
+ * Author:  Alex Stivala, Maksym Byshkin
+ * Created: October 2026
+ *
+ * Summary of the estimates from one or more Algorithm EE runs (chains),
+ * computed in the estimation program itself so the theta and dzA files
+ * do not have to be read again by computeEstimNetDirectedCovariance.R.
+ *
+ * Algorithm EE records the mean and variance of theta and dzA over the
+ * inner iterations of each outer iteration (a batch). The summary of a
+ * chain uses the batches of the second half of the outer iterations
+ * (the first half is burn-in), as the R script does with the
+ * iterations after firstiter: the estimate is the mean theta, and its
+ * standard error includes both the MCMC error (batch means of theta)
+ * and the ERGM MLE error (inverse of the batch means covariance of dzA).
+ * The estimates of all the chains are pooled by inverse-variance
+ * weighting, and the Gelman-Rubin potential scale reduction factor
+ * (R-hat) of each parameter is computed from the between-chain and
+ * within-chain variance.
+ *
+ * The summary of a chain packs into a single array of doubles (length
+ * CHAIN_SUMMARY_LEN) so that the MPI version can gather them all
+ * in one call.
+ *
+ ****************************************************************************/
+
+#include <stdio.h>
+#include "utils.h"
+
+/* length of array holding a packed chain summary of n parameters */
+#define CHAIN_SUMMARY_LEN(n) (2 + 5 * (size_t)(n))
+
+typedef struct ee_batches_s /* per outer iteration stats of Algorithm EE */
+{
+  uint_t  n;              /* number of parameters */
+  uint_t  max_batches;    /* number of batches allocated */
+  uint_t  num_batches;    /* number of batches (outer iterations) added */
+  double *count;          /* inner iterations in each batch */
+  double *theta_mean;     /* n means of theta for each batch */
+  double *theta_var;      /* n variances (dividing by count) of theta */
+  double *dzA_mean;       /* n means of dzA for each batch */
+  double *dzA_var;        /* n variances (dividing by count) of dzA */
+} ee_batches_t;
+
+typedef struct chain_summary_s /* summary of estimates from one chain */
+{
+  uint_t  n;              /* number of parameters */
+  bool    valid;          /* estimates usable (else excluded from pooling) */
+  double  num_samples;    /* number of theta values summarized */
+  double *est;            /* n parameter estimates (mean theta) */
+  double *theta_var;      /* n sample variances of theta */
+  double *se;             /* n standard errors of estimates */
+  double *dzA_mean;       /* n means of dzA */
+  double *dzA_var;        /* n sample variances of dzA */
+  char   *param_names;    /* parameter names separated by spaces, or
+                             NULL (not packed) */
+} chain_summary_t;
+
+void init_ee_batches(ee_batches_t *batches, uint_t n, uint_t max_batches);
+void add_ee_batch(ee_batches_t *batches, const online_stats_t *theta_stats,
+                  const online_stats_t *dzA_stats);
+void free_ee_batches(ee_batches_t *batches);
+
+void init_chain_summary(chain_summary_t *summary, uint_t n);
+const char *compute_chain_summary(const ee_batches_t *batches,
+                                  chain_summary_t *summary);
+void pack_chain_summary(const chain_summary_t *summary, double buf[]);
+void unpack_chain_summary(const double buf[], chain_summary_t *summary);
+void free_chain_summary(chain_summary_t *summary);
+
+int invert_matrix(double *a, uint_t n);
+
+int write_estimation_summary(const char *filename,
+                             const chain_summary_t summaries[],
+                             uint_t num_chains, uint_t first_run,
+                             const char *param_names);
+
+#endif /* ESTIMSUMMARY_H */
@@ -25,6 +25,7 @@
 #include <errno.h>
 #include <stddef.h>
 #include <assert.h>
+#include <pthread.h>
 #include "estimconfigparser.h"
 
 /*****************************************************************************
@@ -70,6 +71,15 @@ const config_param_t ESTIM_CONFIG_PARAMS[] = {
   {"useTNTsampler", PARAM_TYPE_BOOL,    offsetof(estim_config_t, useTNTsampler),
    "use Tie-No-Tie sampler instead of basic or IFD sampler"},
 
+  {"useMTMsampler", PARAM_TYPE_BOOL,    offsetof(estim_config_t, useMTMsampler),
+   "use multiple-try Metropolis sampler instead of basic, IFD or TNT sampler"},
+
+  {"mtmTries",      PARAM_TYPE_UINT,    offsetof(estim_config_t, mtmTries),
+   "number of tries per step in multiple-try Metropolis sampler"},
+
+  {"earlyReject",   PARAM_TYPE_BOOL,    offsetof(estim_config_t, earlyReject),
+   "reject moves early using bounds on the change statistics (basic sampler)"},
+
   {"ifd_K",         PARAM_TYPE_DOUBLE,  offsetof(estim_config_t, ifd_K),
    "multiplier for auxiliary parameter step size in IFD sampler"},
 
@@ -92,6 +102,12 @@ const config_param_t ESTIM_CONFIG_PARAMS[] = {
   {"setattrFile",   PARAM_TYPE_STRING,   offsetof(estim_config_t, setattr_filename),
   "set attributes file"},
 
+  {"dyadicCovariateFile", PARAM_TYPE_STRING, offsetof(estim_config_t, dyadcov_filename),
+  "dyadic covariates file"},
+
+  {"networkListFile", PARAM_TYPE_STRING, offsetof(estim_config_t, network_list_filename),
+  "list of networks (arc list and attribute files) to estimate one model of"},
+
   {"thetaFilePrefix",PARAM_TYPE_STRING,  offsetof(estim_config_t, theta_file_prefix),
    "theta output file prefix"},
 
@@ -138,6 +154,181 @@ const config_param_t ESTIM_CONFIG_PARAMS[] = {
    offsetof(estim_config_t, outputFileSuffixBase),
    "number to add task number to for output file suffixes"},
 
+  {"maxMemoryMB",      PARAM_TYPE_UINT,  offsetof(estim_config_t, maxMemoryMB),
+   "memory limit (MB) for two-path tables when choosing lookup method"},
+
+  {"hubDegreeThreshold", PARAM_TYPE_UINT,
+   offsetof(estim_config_t, hubDegreeThreshold),
+   "degree above which nodes have neighbour hash sets (0 for never)"},
+
+  {"useArcBitMatrix", PARAM_TYPE_BOOL,  offsetof(estim_config_t, useArcBitMatrix),
+   "keep n x n bit matrix of arcs for fast arc lookup (n^2/8 bytes)"},
+
+  {"nodeOrder",       PARAM_TYPE_STRING, offsetof(estim_config_t, nodeOrder),
+   "renumber nodes after loading for memory locality (none, degree, rcm, "
+   "zone)"},
+
+  {"twoPathBackend",  PARAM_TYPE_STRING, offsetof(estim_config_t, twoPathBackend),
+   "two-path lookup method (auto, arrays, hashtables, hybrid, pernode, none)"},
+
+  {"hugePages",       PARAM_TYPE_STRING, offsetof(estim_config_t, hugePages),
+   "huge pages for large two-path tables (none, transparent, explicit)"},
+
+  {"numaPolicy",      PARAM_TYPE_STRING, offsetof(estim_config_t, numaPolicy),
+   "NUMA placement of large two-path tables (local, interleave)"},
+
+  {"numThreadsS",     PARAM_TYPE_UINT,   offsetof(estim_config_t, numThreadsS),
+   "number of threads to run the Algorithm S sampler (not IFD) with"},
+
+  {"numThreadsEE",    PARAM_TYPE_UINT,   offsetof(estim_config_t, numThreadsEE),
+   "number of threads to run the Algorithm EE basic sampler with"},
+
+  {"numThreadsLoad",  PARAM_TYPE_UINT,   offsetof(estim_config_t, numThreadsLoad),
+   "number of threads to load attributes, two-path tables and observed stats"},
+
+  {"seed",            PARAM_TYPE_UINT,   offsetof(estim_config_t, seed),
+   "pseudorandom number generator seed (0 for seed from time)"},
+
+  {"adaptiveSamplerSteps", PARAM_TYPE_BOOL, offsetof(estim_config_t, adaptiveSamplerSteps),
+   "adjust samplerSteps in Algorithm EE from autocorrelation of dzA"},
+
+  {"minSamplerSteps", PARAM_TYPE_UINT,   offsetof(estim_config_t, minSamplerSteps),
+   "minimum samplerSteps if adaptiveSamplerSteps is True"},
+
+  {"maxSamplerSteps", PARAM_TYPE_UINT,   offsetof(estim_config_t, maxSamplerSteps),
+   "maximum samplerSteps if adaptiveSamplerSteps is True"},
+
+  {"targetAutocorr",  PARAM_TYPE_DOUBLE, offsetof(estim_config_t, targetAutocorr),
+   "target lag-1 autocorrelation of dzA if adaptiveSamplerSteps is True"},
+
+  {"EEconvergenceWindow", PARAM_TYPE_UINT, offsetof(estim_config_t, EEconvergenceWindow),
+   "outer iterations of Algorithm EE to test convergence over (0 for no test)"},
+
+  {"EEmaxThetaDrift", PARAM_TYPE_DOUBLE, offsetof(estim_config_t, EEmaxThetaDrift),
+   "stop Algorithm EE when relative theta drift over window is below this"},
+
+  {"EEmaxTratio",     PARAM_TYPE_DOUBLE, offsetof(estim_config_t, EEmaxTratio),
+   "stop Algorithm EE when dzA t-ratios over window are below this"},
+
+  {"EEmaxSeconds",    PARAM_TYPE_UINT,   offsetof(estim_config_t, EEmaxSeconds),
+   "wall clock limit in seconds for Algorithm EE (0 for no limit)"},
+
+  {"EEcollectiveInterval", PARAM_TYPE_UINT,
+   offsetof(estim_config_t, EEcollectiveInterval),
+   "outer iterations between stop tests across MPI tasks (0 for none)"},
+
+  {"EEquorum",        PARAM_TYPE_DOUBLE, offsetof(estim_config_t, EEquorum),
+   "fraction of MPI tasks that must converge for all to stop"},
+
+  {"EEmaxRhat",       PARAM_TYPE_DOUBLE, offsetof(estim_config_t, EEmaxRhat),
+   "stop all MPI tasks when R-hat of theta between them is below this"},
+
+  {"checkpointFilePrefix", PARAM_TYPE_STRING,
+   offsetof(estim_config_t, checkpoint_file_prefix),
+   "Algorithm EE checkpoint file prefix"},
+
+  {"checkpointInterval", PARAM_TYPE_UINT, offsetof(estim_config_t, checkpointInterval),
+   "outer iterations of Algorithm EE between checkpoints (0 for none)"},
+
+  {"restartFromCheckpoint", PARAM_TYPE_BOOL,
+   offsetof(estim_config_t, restartFromCheckpoint),
+   "continue Algorithm EE from checkpoint file instead of starting again"},
+
+  {"outputThetaCovariance", PARAM_TYPE_BOOL,
+   offsetof(estim_config_t, outputThetaCovariance),
+   "write covariance of theta over Algorithm EE iterations to file"},
+
+  {"binaryOutput",   PARAM_TYPE_BOOL,    offsetof(estim_config_t, binaryOutput),
+   "write theta and dzA output files in binary rather than text"},
+
+  {"sharedAttributes", PARAM_TYPE_BOOL,  offsetof(estim_config_t, sharedAttributes),
+   "share node attributes between MPI tasks on the same node"},
+
+  {"numChains",     PARAM_TYPE_UINT,     offsetof(estim_config_t, numChains),
+   "number of chains run in parallel (non-MPI version)"},
+
+  {"summaryFile",   PARAM_TYPE_STRING,   offsetof(estim_config_t, summary_filename),
+   "summary of estimates (pooled over MPI tasks) output filename"},
+
+  {"metricsFilePrefix", PARAM_TYPE_STRING, offsetof(estim_config_t, metrics_file_prefix),
+   "timing and other metrics (JSON) output filename prefix"},
+
+  {"snapshotFile",  PARAM_TYPE_STRING,   offsetof(estim_config_t, snapshot_filename),
+   "binary network snapshot to load instead of arc list, attribute and zone files"},
+
+  {"writeSnapshotFile", PARAM_TYPE_STRING, offsetof(estim_config_t, write_snapshot_filename),
+   "binary network snapshot output filename"},
+
+  {"snapshotTwoPaths", PARAM_TYPE_BOOL,   offsetof(estim_config_t, snapshotTwoPaths),
+   "include the two-path hash tables in writeSnapshotFile"},
+
+  {"arclistFormat", PARAM_TYPE_STRING,   offsetof(estim_config_t, arclistFormat),
+   "format of arclistFile: pajek (default) or edgelist (with any node ids)"},
+
+  {"nodeIdFile",    PARAM_TYPE_STRING,   offsetof(estim_config_t, node_id_filename),
+   "node id of each node (with edge list arclistFile) output filename"},
+
+  {"heartbeatFilePrefix", PARAM_TYPE_STRING, offsetof(estim_config_t, heartbeat_file_prefix),
+   "progress heartbeat (JSON) output filename prefix"},
+
+  {"heartbeatInterval", PARAM_TYPE_UINT,  offsetof(estim_config_t, heartbeatInterval),
+   "seconds between rewrites of the heartbeat file"},
+
+  {"postSimSamples", PARAM_TYPE_UINT,    offsetof(estim_config_t, postSimSamples),
+   "samples per chain of simulation from the estimates for standard errors (0 for none)"},
+
+  {"postSimInterval", PARAM_TYPE_UINT,   offsetof(estim_config_t, postSimInterval),
+   "sampler proposals between samples of post-estimation simulation"},
+
+  {"postSimBurnin", PARAM_TYPE_UINT,     offsetof(estim_config_t, postSimBurnin),
+   "sampler proposals discarded at start of post-estimation simulation"},
+
+  {"postSimChains", PARAM_TYPE_UINT,     offsetof(estim_config_t, postSimChains),
+   "number of post-estimation simulation chains run in parallel"},
+
+  {"bootstrapReplicates", PARAM_TYPE_UINT, offsetof(estim_config_t, bootstrapReplicates),
+   "number of parametric bootstrap replicates estimated (0 for none)"},
+
+  {"postEstimationFilePrefix", PARAM_TYPE_STRING, offsetof(estim_config_t, post_estimation_file_prefix),
+   "standard errors and confidence intervals from simulation output filename prefix"},
+
+  {"partitionGraph", PARAM_TYPE_BOOL,    offsetof(estim_config_t, partitionGraph),
+   "partition the network between MPI tasks for a single chain (MPI version)"},
+
+  {"partitionCacheNodes", PARAM_TYPE_UINT, offsetof(estim_config_t, partitionCacheNodes),
+   "remote nodes cached by each task with partitionGraph (0 for one partition)"},
+
+  {"EEsharedThetaInterval", PARAM_TYPE_UINT,
+   offsetof(estim_config_t, EEsharedThetaInterval),
+   "inner iterations between combining theta across MPI tasks (0 for none)"},
+
+  {"dyadCacheMB", PARAM_TYPE_UINT,       offsetof(estim_config_t, dyadCacheMB),
+   "memory limit (MB) for cache of change statistics of each dyad (0 for none)"},
+
+  {"numThreadsHubUpdate", PARAM_TYPE_UINT, offsetof(estim_config_t, numThreadsHubUpdate),
+   "number of threads for two-path array updates of arcs of high degree nodes"},
+
+  {"hubUpdateDegree", PARAM_TYPE_UINT,   offsetof(estim_config_t, hubUpdateDegree),
+   "degree from which two-path array updates use numThreadsHubUpdate threads"},
+
+  {"warmStartFile", PARAM_TYPE_STRING,   offsetof(estim_config_t, warm_start_filename),
+   "starting theta (and D0) from a previous estimation, matched by parameter name"},
+
+  {"warmStartSsteps", PARAM_TYPE_UINT,   offsetof(estim_config_t, warmStartSsteps),
+   "Algorithm S steps from warmStartFile values (0 to skip S if it has D0)"},
+
+  {"writeWarmStartFilePrefix", PARAM_TYPE_STRING, offsetof(estim_config_t, write_warm_start_file_prefix),
+   "estimates and final D0 (for warmStartFile) output filename prefix"},
+
+  {"seriesContainerFile", PARAM_TYPE_STRING, offsetof(estim_config_t, series_container_filename),
+   "theta and dzA of all tasks written to this one binary file (MPI version)"},
+
+  {"overlapLoad", PARAM_TYPE_BOOL,       offsetof(estim_config_t, overlapLoad),
+   "parse the Pajek arc list in a thread while the attribute files are loaded"},
+
+  {"degreeProposalWeight", PARAM_TYPE_DOUBLE, offsetof(estim_config_t, degreeProposalWeight),
+   "weight of degree-weighted dyad proposals in the basic sampler (0 uniform)"},
+
   {STRUCT_PARAMS_STR,  PARAM_TYPE_SET,      0, /*no offset, coded explicitly*/
   "structural parameters to estimate"},
 
@@ -179,6 +370,9 @@ estim_config_t ESTIM_CONFIG = {
   FALSE, /* outputAllSteps */
   FALSE, /* useIFDsampler */
   FALSE, /* useTNTsampler */
+  FALSE, /* useMTMsampler */
+  DEFAULT_MTM_TRIES, /* mtmTries */
+  FALSE, /* earlyReject */
   DEFAULT_IFD_K,   /* ifd_K */
   FALSE, /* outputSimulatedNetwork */
   NULL,  /* arclist_filename */
@@ -186,6 +380,8 @@ estim_config_t ESTIM_CONFIG = {
   NULL,  /* catattr_filename */
   NULL,  /* contattr_filename */
   NULL,  /* setattr_filename */
+  NULL,  /* dyadcov_filename */
+  NULL,  /* network_list_filename */
   NULL,  /* theta_file_prefix */
   NULL,  /* dzA_file_prefix */
   NULL,  /* sim_net_file_prefix */
@@ -198,11 +394,68 @@ estim_config_t ESTIM_CONFIG = {
   FALSE, /* computeStats */
   NULL,  /* obs_stats_file_prefix */
   0,     /* outputFileSuffixBase */
+  DEFAULT_MAX_MEMORY_MB, /* maxMemoryMB */
+  DEFAULT_HUB_DEGREE_THRESHOLD, /* hubDegreeThreshold */
+  FALSE, /* useArcBitMatrix */
+  NULL,  /* nodeOrder */
+  NULL,  /* twoPathBackend */
+  NULL,  /* hugePages */
+  NULL,  /* numaPolicy */
+  1,     /* numThreadsS */
+  1,     /* numThreadsEE */
+  1,     /* numThreadsLoad */
+  0,     /* seed */
+  FALSE, /* adaptiveSamplerSteps */
+  DEFAULT_MIN_SAMPLER_STEPS, /* minSamplerSteps */
+  DEFAULT_MAX_SAMPLER_STEPS, /* maxSamplerSteps */
+  DEFAULT_TARGET_AUTOCORR,   /* targetAutocorr */
+  0,     /* EEconvergenceWindow */
+  0.0,   /* EEmaxThetaDrift */
+  0.0,   /* EEmaxTratio */
+  0,     /* EEmaxSeconds */
+  0,     /* EEcollectiveInterval */
+  DEFAULT_EE_QUORUM, /* EEquorum */
+  0.0,   /* EEmaxRhat */
+  NULL,  /* checkpointFilePrefix */
+  0,     /* checkpointInterval */
+  FALSE, /* restartFromCheckpoint */
+  FALSE, /* outputThetaCovariance */
+  FALSE, /* binaryOutput */
+  FALSE, /* sharedAttributes */
+  1,     /* numChains */
+  NULL,  /* summary_filename */
+  NULL,  /* metrics_file_prefix */
+  NULL,  /* snapshot_filename */
+  NULL,  /* write_snapshot_filename */
+  FALSE, /* snapshotTwoPaths */
+  NULL,  /* arclistFormat */
+  NULL,  /* node_id_filename */
+  NULL,  /* heartbeat_file_prefix */
+  60,    /* heartbeatInterval */
+  0,     /* postSimSamples */
+  1000,  /* postSimInterval */
+  10000, /* postSimBurnin */
+  1,     /* postSimChains */
+  0,     /* bootstrapReplicates */
+  NULL,  /* post_estimation_file_prefix */
+  FALSE, /* partitionGraph */
+  0,     /* partitionCacheNodes */
+  0,     /* EEsharedThetaInterval */
+  0,     /* dyadCacheMB */
+  1,     /* numThreadsHubUpdate */
+  DEFAULT_HUB_UPDATE_DEGREE, /* hubUpdateDegree */
+  NULL,  /* warm_start_filename */
+  0,     /* warmStartSsteps */
+  NULL,  /* write_warm_start_file_prefix */
+  NULL,  /* series_container_filename */
+  FALSE, /* overlapLoad */
+  0,     /* degreeProposalWeight */
   {
     0,     /* num_change_stats_funcs */
     NULL,  /* change_stats_funcs */
     NULL,  /* param_names */
     NULL,  /* param_values */
+    NULL,  /* param_lambdas */
     0,     /* num_attr_change_stats_funcs */
     NULL,  /* attr_change_stats_funcs */
     NULL,  /* attr_names */
@@ -255,6 +508,9 @@ static bool ESTIM_CONFIG_IS_SET[] = {
   FALSE, /* outputAllSteps */
   FALSE, /* useIFDsampler */
   FALSE, /* useTNTsampler */
+  FALSE, /* useMTMsampler */
+  FALSE, /* mtmTries */
+  FALSE, /* earlyReject */
   FALSE, /* ifd_K */
   FALSE, /* outputSimulatedNetwork */
   FALSE, /* arclist_filename */
@@ -262,6 +518,8 @@ static bool ESTIM_CONFIG_IS_SET[] = {
   FALSE, /* catattr_filename */
   FALSE, /* contattr_filename */
   FALSE, /* setattr_filename */
+  FALSE, /* dyadcov_filename */
+  FALSE, /* network_list_filename */
   FALSE, /* theta_file_prefix */
   FALSE, /* dzA_file_prefix */
   FALSE, /* sim_net_file_prefix */
@@ -274,6 +532,62 @@ static bool ESTIM_CONFIG_IS_SET[] = {
   FALSE, /* computeStats */
   FALSE, /* obs_stats_file_prefix */
   FALSE, /* outputFileSuffixBase */
+  FALSE, /* maxMemoryMB */
+  FALSE, /* hubDegreeThreshold */
+  FALSE, /* useArcBitMatrix */
+  FALSE, /* nodeOrder */
+  FALSE, /* twoPathBackend */
+  FALSE, /* hugePages */
+  FALSE, /* numaPolicy */
+  FALSE, /* numThreadsS */
+  FALSE, /* numThreadsEE */
+  FALSE, /* numThreadsLoad */
+  FALSE, /* seed */
+  FALSE, /* adaptiveSamplerSteps */
+  FALSE, /* minSamplerSteps */
+  FALSE, /* maxSamplerSteps */
+  FALSE, /* targetAutocorr */
+  FALSE, /* EEconvergenceWindow */
+  FALSE, /* EEmaxThetaDrift */
+  FALSE, /* EEmaxTratio */
+  FALSE, /* EEmaxSeconds */
+  FALSE, /* EEcollectiveInterval */
+  FALSE, /* EEquorum */
+  FALSE, /* EEmaxRhat */
+  FALSE, /* checkpointFilePrefix */
+  FALSE, /* checkpointInterval */
+  FALSE, /* restartFromCheckpoint */
+  FALSE, /* outputThetaCovariance */
+  FALSE, /* binaryOutput */
+  FALSE, /* sharedAttributes */
+  FALSE, /* numChains */
+  FALSE, /* summary_filename */
+  FALSE, /* metrics_file_prefix */
+  FALSE, /* snapshot_filename */
+  FALSE, /* write_snapshot_filename */
+  FALSE, /* snapshotTwoPaths */
+  FALSE, /* arclistFormat */
+  FALSE, /* node_id_filename */
+  FALSE, /* heartbeat_file_prefix */
+  FALSE, /* heartbeatInterval */
+  FALSE, /* postSimSamples */
+  FALSE, /* postSimInterval */
+  FALSE, /* postSimBurnin */
+  FALSE, /* postSimChains */
+  FALSE, /* bootstrapReplicates */
+  FALSE, /* post_estimation_file_prefix */
+  FALSE, /* partitionGraph */
+  FALSE, /* partitionCacheNodes */
+  FALSE, /* EEsharedThetaInterval */
+  FALSE, /* dyadCacheMB */
+  FALSE, /* numThreadsHubUpdate */
+  FALSE, /* hubUpdateDegree */
+  FALSE, /* warm_start_filename */
+  FALSE, /* warmStartSsteps */
+  FALSE, /* write_warm_start_file_prefix */
+  FALSE, /* series_container_filename */
+  FALSE, /* overlapLoad */
+  FALSE, /* degreeProposalWeight */
   FALSE, /* (NOT USED) structParams */
   FALSE, /* (NOT USED) attrParams */
   FALSE, /* (NOT USED) dyadicParams */
@@ -281,6 +595,12 @@ static bool ESTIM_CONFIG_IS_SET[] = {
 };
 static const uint_t NUM_ESTIM_CONFIG_IS_SET = sizeof(ESTIM_CONFIG_IS_SET)/sizeof(ESTIM_CONFIG_IS_SET[0]);
 
+/* ESTIM_CONFIG before any parsing, saved once (by whichever of
+   init_estim_config_parser() and parse_estim_config_string() is first
+   called) so that configurations can be parsed into other structures */
+static estim_config_t ESTIM_CONFIG_DEFAULTS;
+static pthread_once_t estim_config_defaults_once = PTHREAD_ONCE_INIT;
+
 
 
 /*****************************************************************************
@@ -289,7 +609,76 @@ static const uint_t NUM_ESTIM_CONFIG_IS_SET = sizeof(ESTIM_CONFIG_IS_SET)/sizeof
  *
  ****************************************************************************/
 
+/*
+ * Save the default values in ESTIM_CONFIG to ESTIM_CONFIG_DEFAULTS
+ * (called once with pthread_once()).
+ */
+static void save_estim_config_defaults(void)
+{
+  ESTIM_CONFIG_DEFAULTS = ESTIM_CONFIG;
+}
 
+/*
+ * Set a configuration structure to the default values, including the
+ * default string values (which are allocated so they can be freed
+ * like specified values).
+ *
+ * Parameters:
+ *   config - (out) configuration structure
+ *
+ * Return value:
+ *   None.
+ */
+static void set_estim_config_defaults(estim_config_t *config)
+{
+  pthread_once(&estim_config_defaults_once, save_estim_config_defaults);
+  *config = ESTIM_CONFIG_DEFAULTS;
+  config->theta_file_prefix = safe_strdup("theta_values");
+  config->dzA_file_prefix = safe_strdup("dzA_values");
+  config->sim_net_file_prefix = safe_strdup("sim");
+  config->obs_stats_file_prefix = safe_strdup("obs_stats");
+  config->checkpoint_file_prefix = safe_strdup("checkpoint");
+}
+
+/*
+ * Parse configuration settings from an open stream into a
+ * configuration structure.
+ *
+ * Parameters:
+ *   config_file - stream to read (not closed here)
+ *   name        - name of the stream for error messages
+ *   config      - (in/out) configuration structure, with the default
+ *                 values or those already parsed
+ *   is_set      - (in/out) NUM_ESTIM_CONFIG_PARAMS flags of parameters
+ *                 already set (so each can only be set once)
+ *
+ * Return value:
+ *   0 if OK else nonzero on error (message printed to stderr).
+ */
+static int parse_estim_config_stream(FILE *config_file, const char *name,
+                                     estim_config_t *config, bool *is_set)
+{
+  char        paramname[TOKSIZE];  /* parameter name buffer */
+  char        value[TOKSIZE];      /* parameter value buffer */
+  int         rc;
+
+  while (!feof(config_file) && !ferror(config_file)) {
+    if ((rc = get_paramname_value(config_file, paramname, value)) == 0) {
+      if (check_and_set_param_value(paramname, value, config_file,
+                                    config, is_set, &config->param_config,
+                                    ESTIM_CONFIG_PARAMS,
+                                    NUM_ESTIM_CONFIG_PARAMS, FALSE) != 0)
+        return -1;
+    } else if (rc < 0)
+      return -1;
+  }
+  if (ferror(config_file)) {
+    fprintf(stderr, "ERROR: error reading configuration file %s (%s)\n",
+            name, strerror(errno));
+    return -1;
+  }
+  return 0;
+}
 
 
 
@@ -311,8 +700,6 @@ static const uint_t NUM_ESTIM_CONFIG_IS_SET = sizeof(ESTIM_CONFIG_IS_SET)/sizeof
  */
 estim_config_t *parse_estim_config_file(const char *config_filename)
 {
-  char        paramname[TOKSIZE];  /* parameter name buffer */
-  char        value[TOKSIZE];      /* parameter value buffer */
   FILE       *config_file;
   int         rc;
 
@@ -321,69 +708,130 @@ estim_config_t *parse_estim_config_file(const char *config_filename)
             config_filename, strerror(errno));
     return NULL;
   }
-  while (!feof(config_file) && !ferror(config_file)) {
-    if ((rc = get_paramname_value(config_file, paramname, value)) == 0) {
-      if (check_and_set_param_value(paramname, value, config_file,
-                                    &ESTIM_CONFIG, ESTIM_CONFIG_IS_SET,
-                                    &ESTIM_CONFIG.param_config,
-                                    ESTIM_CONFIG_PARAMS,
-                                    NUM_ESTIM_CONFIG_PARAMS, FALSE) != 0)
-        return NULL;
-    } else if (rc < 0)
+  rc = parse_estim_config_stream(config_file, config_filename, &ESTIM_CONFIG,
+                                 ESTIM_CONFIG_IS_SET);
+  fclose(config_file);
+  if (rc)
+    return NULL;
+  return &ESTIM_CONFIG; /* return pointer to static CONFIG structure */
+}
+
+/*
+ * Parse configuration settings from a string (in the same format as a
+ * configuration file) into a new configuration structure, rather than
+ * the static one of parse_estim_config_file(), so that this can be
+ * used for any number of configurations at once and in any thread.
+ * init_estim_config_parser() does not have to be called first.
+ *
+ * Parameters:
+ *   config_text - configuration settings, one "keyword = value" per
+ *                 line as in a configuration file
+ *
+ * Return value:
+ *   Pointer to new structure with parsed configuration values, to be
+ *   freed with free_estim_config_struct(), or NULL on error (message
+ *   printed to stderr).
+ */
+estim_config_t *parse_estim_config_string(const char *config_text)
+{
+  estim_config_t *config;
+  bool           *is_set;
+  FILE           *config_file;
+  char           *text;
+  size_t          len = strlen(config_text);
+  int             rc = 0;
+
+  config = (estim_config_t *)safe_malloc(sizeof(estim_config_t));
+  set_estim_config_defaults(config);
+  if (len > 0) {
+    text = safe_strdup(config_text); /* fmemopen() buffer is not const */
+    if (!(config_file = fmemopen(text, len, "r"))) {
+      fprintf(stderr, "ERROR: could not read configuration string (%s)\n",
+              strerror(errno));
+      free(text);
+      free_estim_config_struct(config);
       return NULL;
+    }
+    is_set = (bool *)safe_calloc(NUM_ESTIM_CONFIG_PARAMS, sizeof(bool));
+    rc = parse_estim_config_stream(config_file, "(string)", config, is_set);
+    fclose(config_file);
+    free(text);
+    free(is_set);
   }
-  if (ferror(config_file)) {
-    fprintf(stderr, "ERROR: error reading configuration file %s (%s)\n",
-            config_filename, strerror(errno));
+  if (rc) {
+    free_estim_config_struct(config);
     return NULL;
   }
-  fclose(config_file);
-  return &ESTIM_CONFIG; /* return pointer to static CONFIG structure */
+  return config;
 }
 
 
 
 /*
- * Free the config structure returned by parse_config_file()
+ * Free the config structure returned by parse_estim_config_file() or
+ * parse_estim_config_string()
  *
  * Parameters:
- *     config - pointer to config struct returned by parse_config_file()
+ *     config - pointer to config struct returned by
+ *              parse_estim_config_file() or parse_estim_config_string()
  *
  * Return value:
  *     None
  */
 void free_estim_config_struct(estim_config_t *config)
 {
-  /* In fact parse_config_file() returns pointer to static CONFIG struct,
-     so just free the pointers inside it */
+  /* parse_estim_config_file() returns pointer to static CONFIG struct,
+     so just free the pointers inside it, but the struct itself too if
+     it is from parse_estim_config_string() */
   if (!config)
     return;
-  assert(config == &ESTIM_CONFIG);
   free(config->arclist_filename);
   free(config->binattr_filename);
   free(config->catattr_filename);
   free(config->contattr_filename);
   free(config->setattr_filename);
+  free(config->dyadcov_filename);
+  free(config->network_list_filename);
   free(config->theta_file_prefix);
   free(config->dzA_file_prefix);
   free(config->sim_net_file_prefix);
+  free(config->obs_stats_file_prefix);
   free(config->zone_filename);
+  free(config->nodeOrder);
+  free(config->twoPathBackend);
+  free(config->hugePages);
+  free(config->numaPolicy);
+  free(config->checkpoint_file_prefix);
+  free(config->summary_filename);
+  free(config->metrics_file_prefix);
+  free(config->snapshot_filename);
+  free(config->write_snapshot_filename);
+  free(config->arclistFormat);
+  free(config->node_id_filename);
+  free(config->heartbeat_file_prefix);
+  free(config->post_estimation_file_prefix);
+  free(config->warm_start_filename);
+  free(config->write_warm_start_file_prefix);
+  free(config->series_container_filename);
   free_param_config_struct(&config->param_config);
+  if (config != &ESTIM_CONFIG)
+    free(config);
 }
 
 
 
 /*
  * Initialize the parser. This consists only of setting the default string
- * parameter values (see comments on initialization of static CONFIG struct)
+ * parameter values (see comments on initialization of static CONFIG struct).
+ * It can be called again after free_estim_config_struct() to parse
+ * another configuration file, in which case all the parameters are
+ * first set back to their default values.
  */
 void init_estim_config_parser(void)
 {
   assert(NUM_ESTIM_CONFIG_IS_SET == NUM_ESTIM_CONFIG_PARAMS);
-  ESTIM_CONFIG.theta_file_prefix = safe_strdup("theta_values");
-  ESTIM_CONFIG.dzA_file_prefix = safe_strdup("dzA_values");
-  ESTIM_CONFIG.sim_net_file_prefix = safe_strdup("sim");
-  ESTIM_CONFIG.obs_stats_file_prefix = safe_strdup("obs_stats");
+  memset(ESTIM_CONFIG_IS_SET, 0, sizeof(ESTIM_CONFIG_IS_SET));
+  set_estim_config_defaults(&ESTIM_CONFIG);
 }
 
 
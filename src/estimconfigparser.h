@@ -25,6 +25,11 @@
 #define DEFAULT_COMPC         1e-02   /* default value for compC */
 #define DEFAULT_LEARNING_RATE 0.001   /* default value of learningRate */
 #define DEFAULT_MIN_THETA     0.01    /* default value of minTheta */
+#define DEFAULT_MIN_SAMPLER_STEPS 100     /* default value of minSamplerSteps */
+#define DEFAULT_MAX_SAMPLER_STEPS 1000000 /* default value of maxSamplerSteps */
+#define DEFAULT_TARGET_AUTOCORR   0.5     /* default value of targetAutocorr */
+#define DEFAULT_EE_QUORUM         1.0     /* default value of EEquorum */
+#define DEFAULT_MAX_MEMORY_MB 4096    /* default value of maxMemoryMB */
 
 
 /*****************************************************************************
@@ -47,6 +52,9 @@ typedef struct estim_config_s {
   bool   outputAllSteps;   /* write theta and dzA every iteration not just outer*/
   bool   useIFDsampler;   /* Use IFD sampler instead of basic sampler */
   bool   useTNTsampler;   /* Use TNT sampler (not basic or IFD sampler) */
+  bool   useMTMsampler;   /* Use multiple-try Metropolis sampler */
+  uint_t mtmTries;        /* number of tries per step in MTM sampler */
+  bool   earlyReject;     /* reject using change statistic bounds */
   double ifd_K;           /* multiplier for aux parameter step size in IFD sampler */
   bool  outputSimulatedNetwork; /* output simulated network at end */
   char *arclist_filename; /* filename of Pajek file with digraph to estimate */
@@ -54,6 +62,9 @@ typedef struct estim_config_s {
   char *catattr_filename; /* filename of categorical attributes file or NULL */
   char *contattr_filename;/* filename of continuous attributes file or NULL */
   char *setattr_filename; /* filename of set attributes file or NULL */
+  char *dyadcov_filename; /* filename of dyadic covariates file or NULL */
+  char *network_list_filename; /* filename of list of networks to pool
+                                  instead of the above, or NULL */
   char *theta_file_prefix;/* theta output filename prefix */
   char *dzA_file_prefix;  /* dzA output filename prefix */
   char *sim_net_file_prefix; /* simulated network output filename prefix */
@@ -66,6 +77,71 @@ typedef struct estim_config_s {
   bool  computeStats;       /* compute observed statistics in digraph */
   char *obs_stats_file_prefix; /* observed stats output filename prefix */
   uint_t outputFileSuffixBase;/* task number added to this for output suffixes*/
+  uint_t maxMemoryMB;       /* memory limit (MB) for two-path tables */
+  uint_t hubDegreeThreshold;/* degree above which to use hub neighbour sets */
+  bool  useArcBitMatrix;    /* keep n x n bit matrix of arcs */
+  char *nodeOrder;          /* node renumbering after load or NULL for none */
+  char *twoPathBackend;     /* two-path lookup method or NULL for auto */
+  char *hugePages;          /* huge pages for large tables or NULL for none */
+  char *numaPolicy;         /* NUMA placement of large tables or NULL */
+  uint_t numThreadsS;       /* number of threads for Algorithm S sampler */
+  uint_t numThreadsEE;      /* number of threads for Algorithm EE sampler */
+  uint_t numThreadsLoad;    /* number of threads to build two-path tables */
+  uint_t seed;              /* PRNG seed, 0 to seed from time */
+  bool  adaptiveSamplerSteps; /* adjust samplerSteps in Algorithm EE */
+  uint_t minSamplerSteps;   /* lower bound of adaptive samplerSteps */
+  uint_t maxSamplerSteps;   /* upper bound of adaptive samplerSteps */
+  double targetAutocorr;    /* target lag-1 autocorrelation of dzA */
+  uint_t EEconvergenceWindow; /* outer iterations to test convergence over */
+  double EEmaxThetaDrift;   /* relative theta drift to stop Algorithm EE */
+  double EEmaxTratio;       /* dzA t-ratio to stop Algorithm EE */
+  uint_t EEmaxSeconds;      /* wall clock limit for Algorithm EE */
+  uint_t EEcollectiveInterval; /* outer iterations between tests across
+                                  MPI tasks */
+  double EEquorum;          /* fraction of tasks converged to stop all */
+  double EEmaxRhat;         /* R-hat of theta between tasks to stop all */
+  char  *checkpoint_file_prefix; /* Algorithm EE checkpoint file prefix */
+  uint_t checkpointInterval; /* outer iterations between checkpoints */
+  bool   restartFromCheckpoint; /* continue from checkpoint file */
+  bool   outputThetaCovariance; /* write covariance of theta in EE */
+  bool   binaryOutput;      /* theta and dzA files binary not text */
+  bool   sharedAttributes;  /* share attributes between MPI tasks on node */
+  uint_t numChains;         /* chains run in parallel (non-MPI) */
+  char  *summary_filename;  /* summary of estimates output filename */
+  char  *metrics_file_prefix; /* timing metrics output filename prefix */
+  char  *snapshot_filename; /* network snapshot to load or NULL */
+  char  *write_snapshot_filename; /* network snapshot to write or NULL */
+  bool   snapshotTwoPaths;  /* write two-path tables in snapshot */
+  char  *arclistFormat;     /* arclist_filename format or NULL for Pajek */
+  char  *node_id_filename;  /* node ids (edge list input) to write or NULL */
+  char  *heartbeat_file_prefix; /* progress heartbeat filename prefix */
+  uint_t heartbeatInterval; /* seconds between heartbeat file rewrites */
+  uint_t postSimSamples;    /* samples per chain of simulation from the
+                               estimates, 0 for no post-estimation */
+  uint_t postSimInterval;   /* proposals between post-estimation samples */
+  uint_t postSimBurnin;     /* proposals before first of them */
+  uint_t postSimChains;     /* post-estimation chains run in parallel */
+  uint_t bootstrapReplicates; /* parametric bootstrap replicates */
+  char  *post_estimation_file_prefix; /* standard errors from simulation
+                                         output filename prefix */
+  bool   partitionGraph;    /* partition network between MPI tasks */
+  uint_t partitionCacheNodes; /* remote nodes cached by each task */
+  uint_t EEsharedThetaInterval; /* inner iterations between combining
+                                   theta and dzA across MPI tasks */
+  uint_t dyadCacheMB;       /* memory limit (MB) for dyad change statistics
+                               cache, 0 for none */
+  uint_t numThreadsHubUpdate; /* number of threads for two-path array
+                                 updates of arcs of high degree nodes */
+  uint_t hubUpdateDegree;   /* degree from which they use the threads */
+  char  *warm_start_filename; /* starting theta and D0 or NULL */
+  uint_t warmStartSsteps;   /* Algorithm S steps from the warm start */
+  char  *write_warm_start_file_prefix; /* estimates and final D0 output
+                                          filename prefix */
+  char  *series_container_filename; /* theta and dzA of all MPI tasks
+                                       output filename or NULL */
+  bool   overlapLoad;       /* read arc list while loading attributes */
+  double degreeProposalWeight; /* weight of degree-weighted dyad proposals
+                                  in the basic sampler, 0 for uniform */
   /*
    * values built by confiparser.c functions from parsed config settings
    */
@@ -97,6 +173,7 @@ extern estim_config_t ESTIM_CONFIG;
  ****************************************************************************/
 
 estim_config_t *parse_estim_config_file(const char *config_filename);
+estim_config_t *parse_estim_config_string(const char *config_text);
 
 void free_estim_config_struct(estim_config_t *config);
 
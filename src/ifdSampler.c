@@ -48,6 +48,7 @@
  *
  ****************************************************************************/
 
+#include <stdlib.h>
 #include <assert.h>
 #include <math.h>
 #include "utils.h"
@@ -93,6 +94,8 @@ double arcCorrection(const digraph_t *g) {
  *   n_attr_interaction - number of attribute interaction change stats funcs
  *   change_stats_funcs - array of pointers to change statistics functions
  *                        length is n-n_attr-n_dyadic-n_attr_interaction
+ *   lambda_values - array of lambda (decay) values corresponding to
+ *                   change_stats_funcs (used by alternating statistics)
  *   attr_change_stats_funcs - array of pointers to change statistics functions
  *                             length is n_attr
  *   dyadic_change_stats_funcs - array of pointers to dyadic change stats funcs
@@ -121,9 +124,13 @@ double arcCorrection(const digraph_t *g) {
  *   dzArc       - (Out) Arc statistic differnce from observed: just Ndel-Nadd
  *   ifd_aux_param  - (In/Out) IFD auxiliary parameter. Pass zero initially, then
  *                    reuse each call to update.
+ *   ifd_isDelete   - (In/Out) if the next move is a delete move (moves
+ *                    alternate). Pass FALSE initially, then reuse each call.
  *   useConditionalEstimation - if True do conditional estimation of snowball
  *                              network sample.
  *   forbidReciprocity - if True do not allow reciprocated arcs.
+ *   prng - pseudorandom number generator stream to use (updated)
+ *   ws   - sampler workspace (scratch buffers for n parameters)
  *
  * Return value:
  *   Acceptance rate.
@@ -133,26 +140,34 @@ double arcCorrection(const digraph_t *g) {
  * function pointer array. On exit they are set to the sum values of the
  * change statistics for add and delete moves respectively.
  */
-double ifdSampler(digraph_t *g,  uint_t n, uint_t n_attr, uint_t n_dyadic,
-                  uint_t n_attr_interaction,
-                  change_stats_func_t *change_stats_funcs[],
-                  attr_change_stats_func_t *attr_change_stats_funcs[],
-                  dyadic_change_stats_func_t *dyadic_change_stats_funcs[],
-                  attr_interaction_change_stats_func_t
+static inline double ifdSamplerLoop(digraph_t *g,  uint_t n, uint_t n_attr,
+                                   uint_t n_dyadic, uint_t n_attr_interaction,
+                                   change_stats_func_t *change_stats_funcs[],
+                                   double lambda_values[],
+                                   attr_change_stats_func_t
+                                                  *attr_change_stats_funcs[],
+                                   dyadic_change_stats_func_t
+                                                *dyadic_change_stats_funcs[],
+                                   attr_interaction_change_stats_func_t
                                    *attr_interaction_change_stats_funcs[],
-                  uint_t attr_indices[],
-                  uint_pair_t attr_interaction_pair_indices[],
-                  double theta[],
-                  double addChangeStats[], double delChangeStats[],
-                  uint_t sampler_m,
-                  bool performMove,
-                  double ifd_K, double *dzArc, double *ifd_aux_param,
-                  bool useConditionalEstimation,
-                  bool forbidReciprocity)
+                                   uint_t attr_indices[],
+                                   uint_pair_t
+                                           attr_interaction_pair_indices[],
+                                   double theta[],
+                                   double addChangeStats[],
+                                   double delChangeStats[],
+                                   uint_t sampler_m,
+                                   bool performMove,
+                                   double ifd_K, double *dzArc,
+                                   double *ifd_aux_param,
+                                   bool *ifd_isDelete,
+                                   bool useConditionalEstimation,
+                                   bool forbidReciprocity,
+                                   prng_t *prng, sampler_workspace_t *ws)
 {
-  static bool   isDelete = FALSE; /* delete or add move. FIXME don't use static, make param */
+  bool    isDelete = *ifd_isDelete; /* delete or add move */
 
-  double *changestats = (double *)safe_malloc(n*sizeof(double));
+  double *changestats = ws->changestats;
   double  total;        /* sum of theta*changestats */
   uint_t  accepted = 0; /* number of accepted moves */
   /* Ndel and Nadd are int not uint_t as we do signed math with them */
@@ -161,7 +176,8 @@ double ifdSampler(digraph_t *g,  uint_t n, uint_t n_attr, uint_t n_dyadic,
   double  ifd_aux_param_step;
   double  acceptance_rate;
   uint_t  i,j,k,l;
-  uint_t  arcidx = 0;
+  arcidx_t arcidx = 0;
+  bool    accept;
 
   
   for (i = 0; i < n; i++) {
@@ -172,26 +188,28 @@ double ifdSampler(digraph_t *g,  uint_t n, uint_t n_attr, uint_t n_dyadic,
 
     if (useConditionalEstimation) {
       assert(!forbidReciprocity); /* TODO not implemented for snowball */
+      /* if no arc can be deleted the move must be an add */
+      if (isDelete && g->num_deletable_inner_arcs == 0)
+        isDelete = FALSE;
       if (isDelete) {
         /* Delete move for conditional estimation. Find an existing
            arc between nodes in inner waves (i.e. fixing ties in
            outermost wave and between outermost and second-outermost
            waves) uniformly at random to delete.  Extra constraint for
            conditional estimation that a tie cannot be deleted if it
-           is last remaining tie connecting node to preceding wave.
+           is last remaining tie connecting node to preceding wave,
+           so it is chosen from only the arcs that can be deleted.
            Note ignoring arc direction here as assumed snowball sample
            ignored arc directions.
          */
-        do {
-          arcidx = int_urand(g->num_inner_arcs);
-          i = g->allinnerarcs[arcidx].i;
-          j = g->allinnerarcs[arcidx].j;
-          SAMPLER_DEBUG_PRINT(("conditional del arcidx %u (%u -> %u) zones %u %u\n", arcidx, i, j, g->zone[i], g->zone[j]));
-          assert(g->zone[i] < g->max_zone && g->zone[j] < g->max_zone);
-          /* any tie must be within same zone or between adjacent zones */
-          assert(labs((long)g->zone[i] - (long)g->zone[j]) <= 1);
-        } while ((g->zone[i] > g->zone[j] && g->prev_wave_degree[i] == 1) ||
-                 (g->zone[j] > g->zone[i] && g->prev_wave_degree[j] == 1));
+        arcidx = get_deletable_inner_arc(g, ARC_URAND(prng,
+                                             g->num_deletable_inner_arcs));
+        i = g->allinnerarcs[arcidx].i;
+        j = g->allinnerarcs[arcidx].j;
+        SAMPLER_DEBUG_PRINT(("conditional del arcidx %lu (%u -> %u) zones %u %u\n", (unsigned long)arcidx, i, j, g->zone[i], g->zone[j]));
+        assert(g->zone[i] < g->max_zone && g->zone[j] < g->max_zone);
+        /* any tie must be within same zone or between adjacent zones */
+        assert(labs((long)g->zone[i] - (long)g->zone[j]) <= 1);
       } else {
         /* Add move for conditional estimation. Find two nodes i, j in
            inner waves without arc i->j uniformly at random. Because
@@ -199,21 +217,18 @@ double ifdSampler(digraph_t *g,  uint_t n, uint_t n_attr, uint_t n_dyadic,
            random nodes until such a pair is found. For conditional
            estimation we also have the extra constraint that the nodes
            must be in the same wave or adjacent waves for the tie to
-           be added. */
+           be added, which sample_zone_pair() ensures. */
         do {
-          i = g->inner_nodes[int_urand(g->num_inner_nodes)];          
-          do {
-            j = g->inner_nodes[int_urand(g->num_inner_nodes)];        
-          } while (i == j);
+          sample_zone_pair(g, prng, &i, &j);
           assert(g->zone[i] < g->max_zone && g->zone[j] < g->max_zone);
-        } while (isArc(g, i, j) ||
-                 (labs((long)g->zone[i] - (long)g->zone[j]) > 1));
+          assert(labs((long)g->zone[i] - (long)g->zone[j]) <= 1);
+        } while (isArc(g, i, j));
       }
     } else {
       /* not using conditional estimation */
       if (isDelete) {
         /* Delete move. Find an existing arc uniformly at random to delete. */
-        arcidx = int_urand(g->num_arcs);
+        arcidx = ARC_URAND(prng, g->num_arcs);
         i = g->allarcs[arcidx].i;
         j = g->allarcs[arcidx].j;
         /*removed as slows significantly: assert(isArc(g, i, j));*/
@@ -222,27 +237,16 @@ double ifdSampler(digraph_t *g,  uint_t n, uint_t n_attr, uint_t n_dyadic,
         /* Add move. Find two nodes i, j without arc i->j uniformly at
            random. Because graph is sparse, it is not too inefficient
            to just pick random nodes until such a pair is found */
-        do {
-          do {
-            i = int_urand(g->num_nodes);
-            do {
-              j = int_urand(g->num_nodes);
-            } while (i == j);
-          } while (isArc(g, i, j));
-        } while (forbidReciprocity && isArc(g, j, i));
+        sample_empty_dyad(g, prng, forbidReciprocity, &i, &j);
       }
     }
     
     /* The change statistics are all computed on the basis of adding arc i->j
-       so for a delete move, we (perhaps temporarily) remove it to compute the
-       change statistics, and negate them */
+       so for a delete move, they are computed as if it were absent
+       (without modifying g), and negated. The arc is only removed if
+       the move is accepted. */
     SAMPLER_DEBUG_PRINT(("%s %d -> %d\n",isDelete ? "del" : "add", i, j));
     if (isDelete) {
-      if (useConditionalEstimation){
-        removeArc_allinnerarcs(g, i, j, arcidx);
-      } else {
-        removeArc_allarcs(g, i, j, arcidx);        
-      }
       Ndel++;
     } else {
       Nadd++;
@@ -250,6 +254,7 @@ double ifdSampler(digraph_t *g,  uint_t n, uint_t n_attr, uint_t n_dyadic,
 
     total = calcChangeStats(g, i, j, n, n_attr, n_dyadic, n_attr_interaction,
                             change_stats_funcs,
+                            lambda_values,
                             attr_change_stats_funcs,
                             dyadic_change_stats_funcs,
                             attr_interaction_change_stats_funcs,
@@ -262,22 +267,24 @@ double ifdSampler(digraph_t *g,  uint_t n, uint_t n_attr, uint_t n_dyadic,
     total += (isDelete ? -1 : 1) * *ifd_aux_param;
 
     /* now exp(total) is the acceptance probability */
-    if (urand() < exp(total)) {
+    accept = prng_accept(prng, total);
+    if (ws->trace)
+      trace_proposal(ws->trace, i, j,
+                     (isDelete ? PROPOSAL_TRACE_DELETE : 0) |
+                     (accept ? PROPOSAL_TRACE_ACCEPTED : 0) |
+                     (accept && performMove ? PROPOSAL_TRACE_MOVED : 0),
+                     prng, changestats);
+    if (accept) {
       accepted++;
       if (performMove) {
-        /* actually do the move. If deleting, already done it. For add, add
-           the arc now */
-        if (!isDelete) {
+        /* actually do the move */
+        if (isDelete) {
           if (useConditionalEstimation) {
-            insertArc_allinnerarcs(g, i, j);
+            removeArc_allinnerarcs(g, i, j, arcidx);
           } else {
-            insertArc_allarcs(g, i, j);
+            removeArc_allarcs(g, i, j, arcidx);
           }
-        }
-      } else {
-        /* not actually doing the moves, so reverse change for delete move
-           to restore g to original state */
-        if (isDelete) {
+        } else {
           if (useConditionalEstimation) {
             insertArc_allinnerarcs(g, i, j);
           } else {
@@ -294,15 +301,6 @@ double ifdSampler(digraph_t *g,  uint_t n, uint_t n_attr, uint_t n_dyadic,
           addChangeStats[l] += changestats[l];
       }
       isDelete = !isDelete;
-    } else {
-      /* move not acceptd, so reverse change for delete */
-      if (isDelete) {
-        if (useConditionalEstimation) {
-          insertArc_allinnerarcs(g, i, j);
-        } else {
-          insertArc_allarcs(g, i, j);          
-        }
-      }
     }
   }
   
@@ -323,7 +321,139 @@ double ifdSampler(digraph_t *g,  uint_t n, uint_t n_attr, uint_t n_dyadic,
   }
 
   *dzArc = (double)Ndel - (double)Nadd;
+  *ifd_isDelete = isDelete;
   acceptance_rate = (double)accepted / sampler_m;
-  free(changestats);
   return acceptance_rate;
 }
+
+/*
+ * Call ifdSamplerLoop() with constant flags, so each call is an instance
+ * of the loop specialised for them, as BASIC_SAMPLER_LOOP() in
+ * basicSampler.c.
+ */
+#define IFD_SAMPLER_LOOP(performMove, useConditionalEstimation,           \
+                         forbidReciprocity)                                \
+  ifdSamplerLoop(g, n, n_attr, n_dyadic, n_attr_interaction,               \
+                 change_stats_funcs, lambda_values,                        \
+                 attr_change_stats_funcs, dyadic_change_stats_funcs,       \
+                 attr_interaction_change_stats_funcs, attr_indices,        \
+                 attr_interaction_pair_indices, theta, addChangeStats,     \
+                 delChangeStats, sampler_m, (performMove), ifd_K, dzArc,   \
+                 ifd_aux_param, ifd_isDelete, (useConditionalEstimation),  \
+                 (forbidReciprocity), prng, ws)
+
+/*
+ * IFD sampler: ifdSamplerLoop() (see that for the parameters and return
+ * value), dispatching once on the flags to the instance of the loop
+ * specialised for them.
+ */
+double ifdSampler(digraph_t *g,  uint_t n, uint_t n_attr, uint_t n_dyadic,
+                  uint_t n_attr_interaction,
+                  change_stats_func_t *change_stats_funcs[],
+                  double lambda_values[],
+                  attr_change_stats_func_t *attr_change_stats_funcs[],
+                  dyadic_change_stats_func_t *dyadic_change_stats_funcs[],
+                  attr_interaction_change_stats_func_t
+                                   *attr_interaction_change_stats_funcs[],
+                  uint_t attr_indices[],
+                  uint_pair_t attr_interaction_pair_indices[],
+                  double theta[],
+                  double addChangeStats[], double delChangeStats[],
+                  uint_t sampler_m,
+                  bool performMove,
+                  double ifd_K, double *dzArc, double *ifd_aux_param,
+                  bool *ifd_isDelete,
+                  bool useConditionalEstimation,
+                  bool forbidReciprocity,
+                  prng_t *prng, sampler_workspace_t *ws)
+{
+  if (useConditionalEstimation) {
+    assert(!forbidReciprocity); /* TODO not implemented for snowball */
+    return performMove ? IFD_SAMPLER_LOOP(TRUE, TRUE, FALSE) :
+      IFD_SAMPLER_LOOP(FALSE, TRUE, FALSE);
+  }
+  if (forbidReciprocity)
+    return performMove ? IFD_SAMPLER_LOOP(TRUE, FALSE, TRUE) :
+      IFD_SAMPLER_LOOP(FALSE, FALSE, TRUE);
+  return performMove ? IFD_SAMPLER_LOOP(TRUE, FALSE, FALSE) :
+    IFD_SAMPLER_LOOP(FALSE, FALSE, FALSE);
+}
+
+/*****************************************************************************
+ *
+ * sampler interface (see sampler.h)
+ *
+ ****************************************************************************/
+
+/* state of the IFD sampler between calls */
+typedef struct ifd_sampler_state_s {
+  double aux_param;      /* IFD auxiliary parameter */
+  double arc_correction; /* arcCorrection() of the digraph at start of run */
+  double dzArc;          /* Arc statistic difference from the last call */
+  bool   isDelete;       /* next move is a delete move */
+} ifd_sampler_state_t;
+
+static void ifd_sampler_create(sampler_t *s)
+{
+  s->state = safe_calloc(1, sizeof(ifd_sampler_state_t));
+}
+
+static void ifd_sampler_init(sampler_t *s, const digraph_t *g,
+                             double aux_param)
+{
+  ifd_sampler_state_t *st = (ifd_sampler_state_t *)s->state;
+
+  st->aux_param = aux_param;
+  st->arc_correction = arcCorrection(g);
+  st->dzArc = 0;
+  st->isDelete = FALSE;
+}
+
+static double ifd_sampler_run(sampler_t *s, digraph_t *g, double theta[],
+                              double addChangeStats[], double delChangeStats[],
+                              uint_t sampler_m, bool performMove)
+{
+  const sampler_model_t *m = s->model;
+  ifd_sampler_state_t   *st = (ifd_sampler_state_t *)s->state;
+
+  return ifdSampler(g, m->n, m->n_attr, m->n_dyadic, m->n_attr_interaction,
+                    m->change_stats_funcs, m->lambda_values,
+                    m->attr_change_stats_funcs, m->dyadic_change_stats_funcs,
+                    m->attr_interaction_change_stats_funcs, m->attr_indices,
+                    m->attr_interaction_pair_indices, theta,
+                    addChangeStats, delChangeStats, sampler_m, performMove,
+                    s->options.ifd_K, &st->dzArc, &st->aux_param,
+                    &st->isDelete,
+                    s->options.useConditionalEstimation,
+                    s->options.forbidReciprocity, s->prng, s->ws);
+}
+
+/*
+ * The Arc statistic difference for the IFD sampler is just Ndel-Nadd,
+ * and the Arc parameter is the auxiliary parameter adjusted by the
+ * correction value.
+ */
+static void ifd_sampler_arc_stats(const sampler_t *s, double *dzArc,
+                                  double *arc_param)
+{
+  const ifd_sampler_state_t *st = (const ifd_sampler_state_t *)s->state;
+
+  *dzArc = st->dzArc;
+  *arc_param = st->aux_param - st->arc_correction;
+}
+
+static void ifd_sampler_destroy(sampler_t *s)
+{
+  free(s->state);
+}
+
+const sampler_ops_t ifd_sampler_ops = {
+  "IFD",                 /* name */
+  FALSE,                 /* divisible */
+  sizeof(ifd_sampler_state_t), /* state_size */
+  ifd_sampler_create,    /* create */
+  ifd_sampler_init,      /* init */
+  ifd_sampler_run,       /* run */
+  ifd_sampler_arc_stats, /* arc_stats */
+  ifd_sampler_destroy    /* destroy */
+};
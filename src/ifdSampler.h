@@ -52,12 +52,16 @@
  ****************************************************************************/
 
 #include "changeStatisticsDirected.h"
+#include "sampler.h"
+
+extern const sampler_ops_t ifd_sampler_ops;
 
 double arcCorrection(const digraph_t *g);
 
 double ifdSampler(digraph_t *g,  uint_t n, uint_t n_attr, uint_t n_dyadic,
                   uint_t n_attr_interaction,
                   change_stats_func_t *change_stats_funcs[],
+                  double lambda_values[],
                   attr_change_stats_func_t *attr_change_stats_funcs[],
                   dyadic_change_stats_func_t *dyadic_change_stats_funcs[],
                   attr_interaction_change_stats_func_t
@@ -69,8 +73,10 @@ double ifdSampler(digraph_t *g,  uint_t n, uint_t n_attr, uint_t n_dyadic,
                   uint_t sampler_m,
                   bool performMove,
                   double ifd_K, double *dzArc, double *ifd_aux_param,
+                  bool *ifd_isDelete,
                   bool useConditionalEstimation,
-                  bool forbidReciprocity);
+                  bool forbidReciprocity,
+                  prng_t *prng, sampler_workspace_t *ws);
 
 #endif /* IFDSAMPLER_H */
 
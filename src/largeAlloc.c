@@ -0,0 +1,267 @@
+/*****************************************************************************
+ *
+ * File:    largeAlloc.c
+ * Author:  Alex Stivala
+ * Created: October 2026
+ *
+ * Allocation of large blocks with huge pages and NUMA interleaving
+ * (see largeAlloc.h).
+ *
+ ****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include "largeAlloc.h"
+
+#ifndef MPOL_INTERLEAVE
+#define MPOL_INTERLEAVE 3 /* from linux/mempolicy.h */
+#endif
+
+#define HUGE_PAGE_BYTES  (2 * 1024 * 1024) /* mappings are a multiple of this */
+#define MAX_NUMA_NODES   1024              /* nodes in interleave mask */
+
+/*****************************************************************************
+ *
+ * File static variables
+ *
+ ****************************************************************************/
+
+static huge_pages_e  alloc_huge_pages = HUGE_PAGES_NONE;
+static numa_policy_e alloc_numa = NUMA_POLICY_LOCAL;
+static bool          warned_hugetlb = FALSE;
+static bool          warned_mbind = FALSE;
+static unsigned long numa_mask[MAX_NUMA_NODES / (8 * sizeof(unsigned long))];
+static int           numa_num_nodes = -1; /* -1 until read */
+
+/*****************************************************************************
+ *
+ * Local functions
+ *
+ ****************************************************************************/
+
+/*
+ * Length of the mapping for a block of size bytes (rounded up to a whole
+ * number of huge pages, as munmap() of MAP_HUGETLB memory requires).
+ */
+static size_t mapping_length(size_t size)
+{
+  return (size + HUGE_PAGE_BYTES - 1) / HUGE_PAGE_BYTES * HUGE_PAGE_BYTES;
+}
+
+/*
+ * Read the online NUMA nodes (e.g. "0-1" or "0,2-3") from sysfs into
+ * numa_mask and numa_num_nodes, which is 0 if they cannot be read.
+ *
+ * Parameters:
+ *   None.
+ *
+ * Return value:
+ *   None.
+ */
+static void read_numa_nodes(void)
+{
+  FILE          *fp;
+  char           buf[4096];
+  char          *p, *endptr;
+  unsigned long  first, last, v;
+  size_t         bits = 8 * sizeof(unsigned long);
+
+  numa_num_nodes = 0;
+  memset(numa_mask, 0, sizeof(numa_mask));
+  if (!(fp = fopen("/sys/devices/system/node/online", "r")))
+    return;
+  if (!fgets(buf, sizeof(buf), fp)) {
+    fclose(fp);
+    return;
+  }
+  fclose(fp);
+  for (p = buf; *p && *p != '\n'; p = endptr + (*endptr == ',')) {
+    first = strtoul(p, &endptr, 10);
+    if (endptr == p)
+      break;
+    last = first;
+    if (*endptr == '-') {
+      p = endptr + 1;
+      last = strtoul(p, &endptr, 10);
+    }
+    for (v = first; v <= last && v < MAX_NUMA_NODES; v++) {
+      numa_mask[v / bits] |= 1UL << (v % bits);
+      numa_num_nodes++;
+    }
+  }
+}
+
+/*
+ * Interleave the (not yet touched) pages of a mapping over all the
+ * NUMA nodes. Does nothing on a machine with only one node, and only
+ * warns (once) if it cannot be done.
+ *
+ * Parameters:
+ *   p   - start of mapping
+ *   len - length of mapping
+ *
+ * Return value:
+ *   None.
+ */
+static void interleave_pages(void *p, size_t len)
+{
+  if (numa_num_nodes < 0)
+    read_numa_nodes();
+  if (numa_num_nodes <= 1)
+    return;
+#ifdef SYS_mbind
+  if (syscall(SYS_mbind, p, len, MPOL_INTERLEAVE, numa_mask,
+              (unsigned long)MAX_NUMA_NODES + 1, 0) == 0)
+    return;
+#else
+  (void)p;
+  (void)len;
+#endif /* SYS_mbind */
+  if (!warned_mbind) {
+    fprintf(stderr, "WARNING: could not interleave memory over NUMA "
+            "nodes\n");
+    warned_mbind = TRUE;
+  }
+}
+
+/*****************************************************************************
+ *
+ * externally visible functions
+ *
+ ****************************************************************************/
+
+/*
+ * Get huge page mode from its name as used in config files.
+ *
+ * Parameters:
+ *    name - "none", "transparent" or "explicit" (case insensitive),
+ *           or NULL for none
+ *
+ * Return value:
+ *    huge page mode, or HUGE_PAGES_INVALID if name is not recognized
+ */
+huge_pages_e huge_pages_from_name(const char *name)
+{
+  if (!name || strcasecmp(name, "none") == 0)
+    return HUGE_PAGES_NONE;
+  if (strcasecmp(name, "transparent") == 0)
+    return HUGE_PAGES_TRANSPARENT;
+  if (strcasecmp(name, "explicit") == 0)
+    return HUGE_PAGES_EXPLICIT;
+  return HUGE_PAGES_INVALID;
+}
+
+/*
+ * Get NUMA placement policy from its name as used in config files.
+ *
+ * Parameters:
+ *    name - "local" or "interleave" (case insensitive), or NULL for
+ *           local
+ *
+ * Return value:
+ *    NUMA policy, or NUMA_POLICY_INVALID if name is not recognized
+ */
+numa_policy_e numa_policy_from_name(const char *name)
+{
+  if (!name || strcasecmp(name, "local") == 0)
+    return NUMA_POLICY_LOCAL;
+  if (strcasecmp(name, "interleave") == 0)
+    return NUMA_POLICY_INTERLEAVE;
+  return NUMA_POLICY_INVALID;
+}
+
+/*
+ * Set the huge page mode and NUMA policy for subsequent large_calloc()
+ * calls.
+ *
+ * Parameters:
+ *    huge_pages - huge page mode
+ *    numa       - NUMA placement policy
+ *
+ * Return value:
+ *    None.
+ */
+void set_large_alloc_policy(huge_pages_e huge_pages, numa_policy_e numa)
+{
+  alloc_huge_pages = huge_pages;
+  alloc_numa = numa;
+}
+
+/*
+ * Allocate a zeroed block like calloc(), but if it is large, map it
+ * with the huge page mode and NUMA policy set by
+ * set_large_alloc_policy(). Exits on failure like safe_calloc().
+ *
+ * Parameters:
+ *    nelem  - number of elements
+ *    elsize - size of each element
+ *
+ * Return value:
+ *    Pointer to the block, to be freed with large_free() with the
+ *    same nelem and elsize.
+ */
+void *large_calloc(size_t nelem, size_t elsize)
+{
+  size_t size = nelem * elsize;
+  size_t len;
+  void  *p = MAP_FAILED;
+
+  if (size < LARGE_ALLOC_MIN_BYTES)
+    return safe_calloc(nelem, elsize);
+  len = mapping_length(size);
+#ifdef MAP_HUGETLB
+  if (alloc_huge_pages == HUGE_PAGES_EXPLICIT) {
+    p = mmap(NULL, len, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (p == MAP_FAILED && !warned_hugetlb) {
+      fprintf(stderr, "WARNING: could not allocate explicit huge pages, "
+              "using transparent huge pages\n");
+      warned_hugetlb = TRUE;
+    }
+  }
+#endif /* MAP_HUGETLB */
+  if (p == MAP_FAILED) {
+    p = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+             -1, 0);
+    if (p == MAP_FAILED) {
+      fprintf(stderr, "mmap failed\n");
+      exit(1);
+    }
+#ifdef MADV_HUGEPAGE
+    if (alloc_huge_pages != HUGE_PAGES_NONE)
+      (void)madvise(p, len, MADV_HUGEPAGE);
+#endif /* MADV_HUGEPAGE */
+  }
+  /* the pages are not touched yet so are placed by this policy */
+  if (alloc_numa == NUMA_POLICY_INTERLEAVE)
+    interleave_pages(p, len);
+  return p;
+}
+
+/*
+ * Free a block allocated by large_calloc().
+ *
+ * Parameters:
+ *    ptr    - block to free, or NULL
+ *    nelem  - number of elements it was allocated with
+ *    elsize - size of each element
+ *
+ * Return value:
+ *    None.
+ */
+void large_free(void *ptr, size_t nelem, size_t elsize)
+{
+  size_t size = nelem * elsize;
+
+  if (!ptr)
+    return;
+  if (size < LARGE_ALLOC_MIN_BYTES)
+    free(ptr);
+  else
+    munmap(ptr, mapping_length(size));
+}
@@ -0,0 +1,53 @@
+#ifndef LARGEALLOC_H
+#define LARGEALLOC_H
+/*****************************************************************************
+ *
+ * File:    largeAlloc.h
+ * Author:  Alex Stivala
+ * Created: October 2026
+ *
+ * Allocation of the large structures of a digraph (the dense two-path
+ * arrays, the two-path hash tables and the arc bit matrix), which can
+ * be many GB and are accessed randomly so suffer many TLB misses with
+ * normal 4 KB pages. Blocks of at least LARGE_ALLOC_MIN_BYTES are
+ * mapped with mmap() and can be backed by huge pages, either
+ * transparent huge pages (madvise(MADV_HUGEPAGE)) or explicit ones
+ * (MAP_HUGETLB, which need to have been reserved, e.g. with
+ * /proc/sys/vm/nr_hugepages, falling back to transparent huge pages if
+ * there are not enough). On a NUMA machine the pages can also be
+ * interleaved over all the nodes, rather than each page being on the
+ * node of the thread that first touched it (the default), which
+ * spreads the memory bandwidth over all the nodes when several threads
+ * share the tables.
+ *
+ * The policy is process-wide, set once from the configuration with
+ * set_large_alloc_policy() before the digraph is loaded.
+ *
+ ****************************************************************************/
+
+#include <stddef.h>
+#include "utils.h"
+
+#define LARGE_ALLOC_MIN_BYTES (2 * 1024 * 1024) /* smaller blocks are just
+                                                   calloc()ed */
+
+typedef enum huge_pages_e {
+  HUGE_PAGES_NONE,         /* normal pages (default) */
+  HUGE_PAGES_TRANSPARENT,  /* madvise(MADV_HUGEPAGE) */
+  HUGE_PAGES_EXPLICIT,     /* MAP_HUGETLB, else transparent */
+  HUGE_PAGES_INVALID       /* unrecognized name */
+} huge_pages_e;
+
+typedef enum numa_policy_e {
+  NUMA_POLICY_LOCAL,       /* first touch (default) */
+  NUMA_POLICY_INTERLEAVE,  /* interleave pages over all nodes */
+  NUMA_POLICY_INVALID      /* unrecognized name */
+} numa_policy_e;
+
+huge_pages_e huge_pages_from_name(const char *name);
+numa_policy_e numa_policy_from_name(const char *name);
+void set_large_alloc_policy(huge_pages_e huge_pages, numa_policy_e numa);
+void *large_calloc(size_t nelem, size_t elsize);
+void large_free(void *ptr, size_t nelem, size_t elsize);
+
+#endif /* LARGEALLOC_H */
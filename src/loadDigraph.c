@@ -7,6 +7,27 @@
  * Load digraph from Pajek format arc list file and optionally compute
  * statistics corresponding to ERGM parameters.
  *
+ * allocate_digraph_from_arclist_file() and
+ * load_digraph_from_arclist_mmap() can also load a plain edge list file
+ * (e.g. from SNAP) with arbitrary node ids, which are numbered 0..N-1
+ * with a hash table.
+ *
+ * allocate_digraph_from_arclist_file() can read the arcs in the same
+ * pass over the file as the number of nodes (or node ids), keeping
+ * them for load_digraph_from_arclist_mmap(), so the file is only read
+ * once.
+ *
+ * load_digraph_from_arclist_mmap() is a faster version of
+ * load_digraph_from_arclist_file() for large networks: the file is
+ * memory mapped and parsed in a single pass with a simple integer
+ * scanner (no stdio, strtok_r() or sscanf()), and if the statistics are
+ * not computed the adjacency lists are built all at once by
+ * build_digraph_arcs() rather than by inserting one arc at a time.
+ *
+ * allocate_pooled_digraph() allocates the disjoint union of several
+ * networks listed in a file, for pooled estimation of one model on
+ * all of them.
+ *
  * Preprocessor defines used:
  *
  *    TWOPATH_LOOKUP      - use two-path lookup tables (arrays by default)
@@ -22,6 +43,7 @@
 #include <assert.h>
 #include <limits.h>
 #include <ctype.h>
+#include <unistd.h>
 #include "utils.h"
 #include "loadDigraph.h"
 
@@ -34,12 +56,885 @@
 
 static const size_t BUFSIZE = 16384;  /* line buffer size for reading files */
 
+static const size_t MIN_ARCS_CAPACITY = 1024; /* initial arcs array length */
+
+/* columns of the network list file for allocate_pooled_digraph() */
+#define NUM_POOLED_COLUMNS 5
+static const char *POOLED_COLUMN_NAMES[NUM_POOLED_COLUMNS] = {
+  "arclistFile", "binattrFile", "catattrFile", "contattrFile", "setattrFile"
+};
+
+/*****************************************************************************
+ *
+ * local functions
+ *
+ ****************************************************************************/
+
+/*
+ * Skip spaces and tabs (and carriage returns) within a line
+ *
+ * Parameters:
+ *    p   - current position
+ *    end - end of text
+ *
+ * Return value:
+ *    Position of next character that is not blank, or end.
+ */
+static const char *skip_blanks(const char *p, const char *end)
+{
+  while (p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+    p++;
+  return p;
+}
+
+/*
+ * Go to the start of the next line
+ *
+ * Parameters:
+ *    p   - current position
+ *    end - end of text
+ *
+ * Return value:
+ *    Position after the next newline, or end if there is none.
+ */
+static const char *next_line(const char *p, const char *end)
+{
+  const char *nl = memchr(p, '\n', (size_t)(end - p));
+  return nl ? nl + 1 : end;
+}
+
+/*
+ * Parse a node number (unsigned decimal integer, which must be followed
+ * by a blank or the end of the line) from an arc line.
+ *
+ * Parameters:
+ *    p     - (in/out) current position, updated to after the number
+ *    end   - end of text
+ *    value - (out) value of number, UINT64_MAX if it is too large
+ *
+ * Return value:
+ *    TRUE if a number was parsed, else FALSE.
+ */
+static bool scan_node_number(const char **p, const char *end, uint64_t *value)
+{
+  const char *q = skip_blanks(*p, end);
+  uint64_t    v = 0;
+
+  if (q == end || (unsigned)(*q - '0') > 9)
+    return FALSE;
+  while (q < end && (unsigned)(*q - '0') <= 9) {
+    if (v < UINT32_MAX)
+      v = v * 10 + (uint64_t)(*q - '0');
+    else
+      v = UINT64_MAX;
+    q++;
+  }
+  if (q < end && !isspace((unsigned char)*q))
+    return FALSE;
+  *p = q;
+  *value = v;
+  return TRUE;
+}
+
+/*
+ * Parse a node id (unsigned decimal integer less than 2^64-1, which must
+ * be followed by a blank, a comma or the end of the line) from an edge
+ * list line.
+ *
+ * Parameters:
+ *    p     - (in/out) current position, updated to after the number
+ *    end   - end of text
+ *    comma - if TRUE skip a comma (between blanks) before the number
+ *    value - (out) value of number
+ *
+ * Return value:
+ *    TRUE if a number was parsed, else FALSE.
+ */
+static bool scan_node_id(const char **p, const char *end, bool comma,
+                         uint64_t *value)
+{
+  const char *q = skip_blanks(*p, end);
+  uint64_t    v = 0, digit;
+
+  if (comma && q < end && *q == ',')
+    q = skip_blanks(q + 1, end);
+  if (q == end || (unsigned)(*q - '0') > 9)
+    return FALSE;
+  while (q < end && (unsigned)(*q - '0') <= 9) {
+    digit = (uint64_t)(*q - '0');
+    if (v > (UINT64_MAX - 1 - digit) / 10)
+      return FALSE; /* too large (UINT64_MAX is not allowed) */
+    v = v * 10 + digit;
+    q++;
+  }
+  if (q < end && *q != ',' && !isspace((unsigned char)*q))
+    return FALSE;
+  *p = q;
+  *value = v;
+  return TRUE;
+}
+
+/*
+ * Print the text at p (up to the end of the line) in an error message.
+ */
+static void arc_line_error(const char *msg, const char *p, const char *end)
+{
+  const char *q;
+
+  p = skip_blanks(p, end);
+  for (q = p; q < end && *q != '\n' && *q != '\r'; q++)
+    /*nothing*/;
+  fprintf(stderr, "ERROR: %s %.*s\n", msg, (int)(q - p), p);
+}
+
+/*
+ * Read the arcs from a Pajek format arc list file (as described for
+ * load_digraph_from_arclist_file()) by memory mapping it, or if it is
+ * compressed, decompressing it into memory.
+ *
+ * Parameters:
+ *    filename     - name of Pajek format arclist file
+ *    num_vertices - (in/out) number of vertices the file must have, or
+ *                   0 to set it to the number in the *vertices line
+ *    num_arcs     - (out) number of arcs in the returned list
+ *    first_node, end_node - only the arcs with at least one end
+ *                   (0-based) in first_node..end_node-1 are returned
+ *                   (0 and UINT_MAX for all of them)
+ *
+ * Return value:
+ *    List of arcs (with 0-based node numbers) in the order in the file,
+ *    including any duplicates, allocated here, or NULL on error
+ *    (message printed to stderr).
+ */
+static nodepair_t *read_arclist_mmap(const char *filename,
+                                     uint_t *num_vertices, arcidx_t *num_arcs,
+                                     uint_t first_node, uint_t end_node)
+{
+  char       *map;
+  size_t      size;
+  bool        compressed;
+  const char *p, *end;
+  uint64_t    i, j, file_vertices;
+  nodepair_t *arcs = NULL;
+  size_t      capacity, count = 0, num_weighted = 0;
+
+  if (!(map = map_input_file(filename, &size, &compressed)))
+    return NULL;
+  if (size == 0) {
+    fprintf(stderr, "ERROR: expected *vertices n line but didn't find it\n");
+    goto error;
+  }
+  p = map;
+  end = map + size;
+
+  /* the first lines should be e.g.
+   * *vertices 36
+   * for Pajek format
+   */
+  if (end - p < 9 || strncasecmp(p, "*vertices", 9) != 0) {
+    fprintf(stderr, "ERROR: expected *vertices n line but didn't find it\n");
+    goto error;
+  }
+  p += 9;
+  if (!scan_node_number(&p, end, &file_vertices)) {
+    fprintf(stderr, "ERROR: expected *vertices n line but didn't find it\n");
+    goto error;
+  }
+  if (*num_vertices == 0) {
+    if (file_vertices < 1 || file_vertices > UINT_MAX) {
+      fprintf(stderr, "ERROR: number of vertices is %lu\n",
+              (unsigned long)file_vertices);
+      goto error;
+    }
+    *num_vertices = (uint_t)file_vertices;
+  } else if (file_vertices != *num_vertices) {
+    fprintf(stderr, "ERROR: expected %u vertices but found %lu\n",
+            *num_vertices, (unsigned long)file_vertices);
+    goto error;
+  }
+  do {
+    p = next_line(p, end);
+  } while (p < end && (end - p < 5 || strncasecmp(p, "*arcs", 5) != 0));
+  if (p == end) {
+    fprintf(stderr, "did not find *arcs line\n");
+    goto error;
+  }
+  p = next_line(p, end);
+  if (p == end) {
+    fprintf(stderr, "ERROR: no arcs after *arcs line\n");
+    goto error;
+  }
+
+  /* guess the number of arcs from the file size, with about 16
+     characters for each arc line */
+  capacity = MAX(MIN_ARCS_CAPACITY, size / 16);
+  arcs = (nodepair_t *)safe_malloc(capacity * sizeof(nodepair_t));
+  while (p < end) {
+    p = skip_blanks(p, end);
+    if (p == end || *p == '\n')
+      break; /* end on blank line (ignore rest of file, used for stats etc.) */
+    if (!scan_node_number(&p, end, &i)) {
+      arc_line_error("bad arc start node", p, end);
+      goto error;
+    }
+    if (!scan_node_number(&p, end, &j)) {
+      arc_line_error("bad arc end node", p, end);
+      goto error;
+    }
+    p = skip_blanks(p, end);
+    if (p < end && *p != '\n')
+      num_weighted++;
+    if (i < 1 || j < 1) {
+      fprintf(stderr, "ERROR: node numbers start at 1, got %lu,%lu\n",
+              (unsigned long)i, (unsigned long)j);
+      goto error;
+    }
+    if (i > *num_vertices || j > *num_vertices) {
+      fprintf(stderr, "ERROR num vertices %u but got edge %lu,%lu\n",
+              *num_vertices, (unsigned long)i, (unsigned long)j);
+      goto error;
+    }
+    p = next_line(p, end);
+    if (!((i - 1 >= first_node && i - 1 < end_node) ||
+          (j - 1 >= first_node && j - 1 < end_node)))
+      continue;
+    if (count == capacity) {
+      capacity *= 2;
+      arcs = (nodepair_t *)safe_realloc(arcs, capacity * sizeof(nodepair_t));
+    }
+    arcs[count].i = (uint_t)(i - 1); /* convert to 0-based */
+    arcs[count].j = (uint_t)(j - 1);
+    count++;
+  }
+  unmap_input_file(map, size, compressed);
+  map = NULL;
+  if (num_weighted > 0)
+    printf("(warning) ignoring Pajek arc weights on %lu arcs\n",
+           (unsigned long)num_weighted);
+  if (count > MAX_NUM_ARCS) {
+    fprintf(stderr, "ERROR: too many arcs (%lu)\n", (unsigned long)count);
+    goto error;
+  }
+  *num_arcs = (arcidx_t)count;
+  return arcs;
+
+error:
+  if (map)
+    unmap_input_file(map, size, compressed);
+  free(arcs);
+  return NULL;
+}
+
+/*
+ * Read an edge list file (as described for
+ * allocate_digraph_from_arclist_file()), adding the node ids in it to a
+ * node id map, or getting its arcs as node numbers from the map, or
+ * both in a single pass over the file.
+ *
+ * Parameters:
+ *    filename - name of edge list file
+ *    node_ids - (in/out) node id map. If it is not yet numbered by
+ *               number_node_ids(), the ids in the file are added to it,
+ *               and it is then numbered if arcs is not NULL. Otherwise
+ *               it must already have them all.
+ *    arcs     - (out) if not NULL, list of arcs in the order in the
+ *               file, including any duplicates but not self-loops,
+ *               allocated here
+ *    num_arcs - (out) if arcs is not NULL, length of the arcs list
+ *
+ * Return value:
+ *    0 if OK else nonzero on error (message printed to stderr).
+ */
+static int scan_edgelist(const char *filename, nodeidmap_t *node_ids,
+                         nodepair_t **arcs, arcidx_t *num_arcs)
+{
+  char       *map;
+  size_t      size;
+  bool        compressed, first = TRUE;
+  bool        numbered = node_ids->ids != NULL;
+  const char *p, *end;
+  uint64_t    i, j;
+  uint64_t   *id_pairs = NULL; /* ids of arcs until node_ids is numbered */
+  size_t      capacity = 0, count = 0, num_extra = 0, num_loops = 0, a;
+
+  if (!(map = map_input_file(filename, &size, &compressed)))
+    return -1;
+  p = map;
+  end = map + size;
+  if (arcs) {
+    *arcs = NULL;
+    /* guess the number of arcs from the file size, with about 16
+       characters for each edge line */
+    capacity = MAX(MIN_ARCS_CAPACITY, size / 16);
+    if (numbered)
+      *arcs = (nodepair_t *)safe_malloc(capacity * sizeof(nodepair_t));
+    else
+      id_pairs = (uint64_t *)safe_malloc(2 * capacity * sizeof(uint64_t));
+  }
+  while (size > 0 && p < end) {
+    p = skip_blanks(p, end);
+    if (p == end)
+      break;
+    if (*p == '\n' || *p == '#' || *p == '%') {
+      p = next_line(p, end); /* blank or comment line */
+      continue;
+    }
+    if (first && (unsigned)(*p - '0') > 9) {
+      first = FALSE;
+      p = next_line(p, end); /* header line (e.g. CSV column names) */
+      continue;
+    }
+    first = FALSE;
+    if (!scan_node_id(&p, end, FALSE, &i)) {
+      arc_line_error("bad edge start node id", p, end);
+      goto error;
+    }
+    if (!scan_node_id(&p, end, TRUE, &j)) {
+      arc_line_error("bad edge end node id", p, end);
+      goto error;
+    }
+    p = skip_blanks(p, end);
+    if (p < end && *p != '\n')
+      num_extra++;
+    if (!numbered) {
+      nodeidmap_add(node_ids, i);
+      nodeidmap_add(node_ids, j);
+      if (node_ids->num_nodes >= NODEIDMAP_NONE - 1) {
+        fprintf(stderr, "ERROR: too many nodes in edge list file %s\n",
+                filename);
+        goto error;
+      }
+    }
+    if (arcs && i == j) {
+      num_loops++;
+    } else if (arcs) {
+      if (count == capacity) {
+        capacity *= 2;
+        if (numbered)
+          *arcs = (nodepair_t *)safe_realloc(*arcs,
+                                             capacity * sizeof(nodepair_t));
+        else
+          id_pairs = (uint64_t *)safe_realloc(id_pairs, 2 * capacity *
+                                              sizeof(uint64_t));
+      }
+      if (numbered) {
+        (*arcs)[count].i = nodeidmap_get(node_ids, i);
+        (*arcs)[count].j = nodeidmap_get(node_ids, j);
+        assert((*arcs)[count].i != NODEIDMAP_NONE &&
+               (*arcs)[count].j != NODEIDMAP_NONE);
+      } else {
+        id_pairs[2 * count] = i;
+        id_pairs[2 * count + 1] = j;
+      }
+      count++;
+    }
+    p = next_line(p, end);
+  }
+  unmap_input_file(map, size, compressed);
+  map = NULL;
+  if (!arcs)
+    return 0;
+  if (num_extra > 0)
+    printf("(warning) ignoring extra columns on %lu edges\n",
+           (unsigned long)num_extra);
+  if (num_loops > 0)
+    printf("(warning) ignoring %lu self-loops\n", (unsigned long)num_loops);
+  if (count > MAX_NUM_ARCS) {
+    fprintf(stderr, "ERROR: too many arcs (%lu)\n", (unsigned long)count);
+    goto error;
+  }
+  if (!numbered) {
+    /* all the ids are known now, so the arcs can be numbered */
+    if (node_ids->num_nodes > 0)
+      number_node_ids(node_ids);
+    *arcs = (nodepair_t *)safe_malloc(MAX(count, 1) * sizeof(nodepair_t));
+    for (a = 0; a < count; a++) {
+      (*arcs)[a].i = nodeidmap_get(node_ids, id_pairs[2 * a]);
+      (*arcs)[a].j = nodeidmap_get(node_ids, id_pairs[2 * a + 1]);
+    }
+    free(id_pairs);
+  }
+  *num_arcs = (arcidx_t)count;
+  return 0;
+
+error:
+  if (map)
+    unmap_input_file(map, size, compressed);
+  free(id_pairs);
+  if (arcs) {
+    free(*arcs);
+    *arcs = NULL;
+  }
+  return -1;
+}
+
+/*
+ * Append the lines of an attribute file of one of the networks pooled
+ * by allocate_pooled_digraph() to the attribute file of the pooled
+ * network. The header line (attribute names) is written for the first
+ * network, and must be the same for the others.
+ *
+ * Parameters:
+ *    out       - pooled attribute file to append to
+ *    filename  - attribute file of the network
+ *    header    - (in/out) header of the first network's file, or NULL
+ *                for the first network (then set here, allocated)
+ *    num_nodes - number of nodes in the network (must be this many
+ *                lines after the header, not counting blank lines)
+ *
+ * Return value:
+ *    0 if OK else nonzero on error (message printed to stderr).
+ */
+static int append_pooled_attr_file(FILE *out, const char *filename,
+                                   char **header, uint_t num_nodes)
+{
+  char       *text, *line, *nl;
+  size_t      size;
+  uint_t      num_lines = 0;
+  bool        first_line = TRUE;
+  int         rc = 0;
+
+  if (!(text = read_input_file(filename, &size)))
+    return -1;
+  text = (char *)safe_realloc(text, size + 1); /* room to terminate last line */
+  for (line = text; line < text + size && rc == 0; line = nl + 1) {
+    if (!(nl = memchr(line, '\n', (size_t)(text + size - line))))
+      nl = text + size;
+    *nl = '\0';
+    rstrip(line);
+    if (first_line) {
+      first_line = FALSE;
+      if (!*header) {
+        *header = safe_strdup(line);
+        fprintf(out, "%s\n", line);
+      } else if (strcmp(line, *header) != 0) {
+        fprintf(stderr, "ERROR: header of attribute file %s is not the same "
+                "as for the first network (%s)\n", filename, *header);
+        rc = -1;
+      }
+    } else if (*line) {
+      fprintf(out, "%s\n", line);
+      num_lines++;
+    }
+  }
+  if (rc == 0 && num_lines != num_nodes) {
+    fprintf(stderr, "ERROR: attribute file %s has %u nodes but network has "
+            "%u\n", filename, num_lines, num_nodes);
+    rc = -1;
+  }
+  free(text);
+  return rc;
+}
+
+/*
+ * Create a temporary file (in the directory $TMPDIR, or /tmp) for an
+ * attribute file of the pooled network.
+ *
+ * Parameters:
+ *    filename - (out) name of the file, allocated here
+ *
+ * Return value:
+ *    File opened for writing, or NULL on error (message printed to stderr).
+ */
+static FILE *create_pooled_attr_file(char **filename)
+{
+  const char *tmpdir = getenv("TMPDIR");
+  FILE       *fp;
+  int         fd;
+
+  if (!tmpdir || !*tmpdir)
+    tmpdir = "/tmp";
+  *filename = (char *)safe_malloc(strlen(tmpdir) + 32);
+  sprintf(*filename, "%s/EstimNetPooledXXXXXX", tmpdir);
+  if ((fd = mkstemp(*filename)) < 0 || !(fp = fdopen(fd, "w"))) {
+    fprintf(stderr, "ERROR: could not create temporary file %s (%s)\n",
+            *filename, strerror(errno));
+    if (fd >= 0) {
+      close(fd);
+      remove(*filename);
+    }
+    free(*filename);
+    *filename = NULL;
+    return NULL;
+  }
+  return fp;
+}
+
 /*****************************************************************************
  *
  * externally visible functions
  *
  ****************************************************************************/
 
+/*
+ * Get arc list file format from its name as used in config files.
+ *
+ * Parameters:
+ *    name - name of format ("pajek" or "edgelist", case insensitive),
+ *           or NULL for Pajek
+ *
+ * Return value:
+ *    arc list file format, or ARCLIST_FORMAT_INVALID if name is not
+ *    recognized
+ */
+arclist_format_e arclist_format_from_name(const char *name)
+{
+  if (!name || strcasecmp(name, "pajek") == 0)
+    return ARCLIST_FORMAT_PAJEK;
+  if (strcasecmp(name, "edgelist") == 0)
+    return ARCLIST_FORMAT_EDGELIST;
+  return ARCLIST_FORMAT_INVALID;
+}
+
+/*
+ * Allocate a digraph (with no arcs) for the network in an arc list file,
+ * to load its node attributes and then its arcs with
+ * load_digraph_from_arclist_mmap().
+ *
+ * A Pajek format file has the number of nodes in its *vertices line.
+ * An edge list file (e.g. from SNAP) has a line for each arc with
+ * the ids of the nodes it is from and to, which can be any integers
+ * from 0 to 2^64-2, separated by blanks or a comma, and anything
+ * after them on the line (e.g. weights) is ignored. Lines starting with
+ * '#' or '%' are comments, and the first other line is a header that
+ * is skipped if it does not start with a number (e.g. CSV column names).
+ * The nodes of the network are those with an id in the file,
+ * numbered in ascending order of id (so ids already numbered 0..N-1
+ * are unchanged), kept in g->node_ids to load the arcs and the
+ * attributes (which are then keyed by node id, see load_attributes()).
+ * Self-loops are ignored (but their nodes are in the network).
+ *
+ * If readArcs is True the arcs are also read in the same pass over the
+ * file, and kept in g->pending_arcs for load_digraph_from_arclist_mmap(),
+ * so a large (or compressed, or remote) file is only read once.
+ * Otherwise only the *vertices line of a Pajek file is read (but all of
+ * an edge list file, for its node ids).
+ *
+ * Parameters:
+ *    filename - name of arc list file
+ *    format   - format of arc list file
+ *    readArcs - if True read the arcs as well as the nodes
+ *
+ * Return value:
+ *    Digraph with no arcs, or NULL if the file cannot be read or has
+ *    an error (message printed to stderr).
+ */
+digraph_t *allocate_digraph_from_arclist_file(const char *filename,
+                                              arclist_format_e format,
+                                              bool readArcs)
+{
+  FILE        *arclist_file;
+  nodeidmap_t *node_ids;
+  nodepair_t  *arcs = NULL;
+  arcidx_t     num_arcs = 0;
+  uint_t       num_vertices = 0;
+  digraph_t   *g;
+
+  if (!(arclist_file = open_input_file(filename))) {
+    fprintf(stderr, "error opening file %s (%s)\n", filename,
+            strerror(errno));
+    return NULL;
+  }
+  if (format == ARCLIST_FORMAT_PAJEK) {
+    if (!readArcs) {
+      /* get_num_vertices_from_arclist_file() closes the file */
+      if (!(num_vertices = get_num_vertices_from_arclist_file(arclist_file)))
+        return NULL;
+      return allocate_digraph(num_vertices);
+    }
+    close_input_file(arclist_file);
+    if (!(arcs = read_arclist_mmap(filename, &num_vertices, &num_arcs,
+                                   0, UINT_MAX)))
+      return NULL;
+    g = allocate_digraph(num_vertices);
+    g->pending_arcs = arcs;
+    g->num_pending_arcs = num_arcs;
+    return g;
+  }
+  close_input_file(arclist_file);
+  node_ids = (nodeidmap_t *)safe_calloc(1, sizeof(nodeidmap_t));
+  if (scan_edgelist(filename, node_ids, readArcs ? &arcs : NULL, &num_arcs)) {
+    free_nodeidmap(node_ids);
+    free(node_ids);
+    return NULL;
+  }
+  if (node_ids->num_nodes == 0) {
+    fprintf(stderr, "ERROR: no edges in edge list file %s\n", filename);
+    free(arcs);
+    free_nodeidmap(node_ids);
+    free(node_ids);
+    return NULL;
+  }
+  if (!readArcs)
+    number_node_ids(node_ids);
+  g = allocate_digraph(node_ids->num_nodes);
+  g->node_ids = node_ids;
+  g->pending_arcs = arcs;
+  g->num_pending_arcs = num_arcs;
+  return g;
+}
+
+/*
+ * Read the arcs of a Pajek format arc list file into g->pending_arcs
+ * (for load_digraph_from_arclist_mmap()), for a digraph allocated by
+ * allocate_digraph_from_arclist_file() with readArcs FALSE. Only
+ * g->pending_arcs and g->num_pending_arcs are set (at the end), so the
+ * node attributes can be loaded into g by another thread meanwhile.
+ *
+ * Parameters:
+ *    filename - name of Pajek format arc list file
+ *    g        - (in/out) digraph with no arcs or pending arcs
+ *
+ * Return value:
+ *    0 if OK else -1 on error (message printed to stderr).
+ */
+int read_pending_arcs(const char *filename, digraph_t *g)
+{
+  nodepair_t *arcs;
+  arcidx_t    num_arcs;
+  uint_t      num_vertices = g->num_nodes;
+
+  assert(!g->pending_arcs && !g->node_ids);
+  if (!(arcs = read_arclist_mmap(filename, &num_vertices, &num_arcs,
+                                 0, UINT_MAX)))
+    return -1;
+  g->pending_arcs = arcs;
+  g->num_pending_arcs = num_arcs;
+  return 0;
+}
+
+/*
+ * Allocate a digraph (with no arcs) that is the disjoint union of
+ * several networks, for pooled estimation of one model on all of them
+ * (see set_digraph_blocks()), and build node attribute files for it
+ * from those of the networks, to load with load_attributes().
+ *
+ * The list file has a header line naming the columns, which are
+ * arclistFile (required) and optionally binattrFile, catattrFile,
+ * contattrFile and setattrFile, in any order, then a line for each
+ * network with its files in those columns (separated by blanks).
+ * Blank lines and lines starting with '#' are ignored. E.g.:
+ *
+ * arclistFile       binattrFile
+ * school1_arcs.txt  school1_binattr.txt
+ * school2_arcs.txt  school2_binattr.txt
+ *
+ * The arc list files are in Pajek format. The nodes of the first
+ * network are numbered first, then those of the second, and so on.
+ * Each attribute file must have the same header (attribute names) as
+ * for the first network. The attribute files of the pooled network are
+ * temporary files (in $TMPDIR or /tmp), to be removed with
+ * remove_pooled_attr_files() after loading them.
+ *
+ * Parameters:
+ *    list_filename - name of list file
+ *    readArcs      - if True read the arcs (kept in g->pending_arcs for
+ *                    load_digraph_from_arclist_mmap()) as well as the
+ *                    nodes, as for allocate_digraph_from_arclist_file()
+ *    attr_files    - (out) attribute files of the pooled network
+ *                    (NULL if the column is not in the list file)
+ *
+ * Return value:
+ *    Digraph with no arcs, or NULL if a file cannot be read or has
+ *    an error (message printed to stderr).
+ */
+digraph_t *allocate_pooled_digraph(const char *list_filename, bool readArcs,
+                                   pooled_attr_files_t *attr_files)
+{
+  const char *delims = " \t\r\n";   /* strtok_r() delimiters */
+  char      **attr_filenames[NUM_POOLED_COLUMNS];
+  FILE       *list_file, *arclist_file, *attr_fp[NUM_POOLED_COLUMNS];
+  char       *headers[NUM_POOLED_COLUMNS];
+  char        buf[BUFSIZE], *saveptr, *token;
+  int         columns[NUM_POOLED_COLUMNS]; /* column index for each file */
+  uint_t      num_columns = 0, num_networks = 0, capacity = 0, c, k, net;
+  char      **filenames = NULL;  /* num_networks x num_columns */
+  uint_t     *sizes = NULL, num_vertices;
+  uint64_t    total_nodes = 0;
+  nodepair_t *arcs = NULL, *net_arcs;
+  arcidx_t    num_arcs = 0, net_num_arcs, a;
+  digraph_t  *g = NULL;
+  bool        header = TRUE, ok = FALSE;
+
+  memset(attr_files, 0, sizeof(pooled_attr_files_t));
+  for (k = 0; k < NUM_POOLED_COLUMNS; k++) {
+    columns[k] = -1;
+    attr_fp[k] = NULL;
+    headers[k] = NULL;
+  }
+  attr_filenames[0] = NULL; /* arc lists are not concatenated */
+  attr_filenames[1] = &attr_files->binattr_filename;
+  attr_filenames[2] = &attr_files->catattr_filename;
+  attr_filenames[3] = &attr_files->contattr_filename;
+  attr_filenames[4] = &attr_files->setattr_filename;
+
+  if (!(list_file = open_input_file(list_filename))) {
+    fprintf(stderr, "error opening file %s (%s)\n", list_filename,
+            strerror(errno));
+    return NULL;
+  }
+  while (fgets(buf, sizeof(buf), list_file)) {
+    if (!(token = strtok_r(buf, delims, &saveptr)) || token[0] == '#')
+      continue;
+    if (header) {
+      header = FALSE;
+      for (; token; token = strtok_r(NULL, delims, &saveptr)) {
+        for (k = 0; k < NUM_POOLED_COLUMNS &&
+               strcasecmp(token, POOLED_COLUMN_NAMES[k]) != 0; k++)
+          /*nothing*/;
+        if (k == NUM_POOLED_COLUMNS || columns[k] >= 0) {
+          fprintf(stderr, "ERROR: %s column %s in network list file %s\n",
+                  k == NUM_POOLED_COLUMNS ? "unknown" : "duplicate", token,
+                  list_filename);
+          goto done;
+        }
+        columns[k] = (int)num_columns++;
+      }
+      if (columns[0] < 0) {
+        fprintf(stderr, "ERROR: no %s column in network list file %s\n",
+                POOLED_COLUMN_NAMES[0], list_filename);
+        goto done;
+      }
+      continue;
+    }
+    if (num_networks == capacity) {
+      capacity = capacity ? 2 * capacity : 16;
+      filenames = (char **)safe_realloc(filenames, (size_t)capacity *
+                                        num_columns * sizeof(char *));
+    }
+    for (c = 0; c < num_columns && token;
+         c++, token = strtok_r(NULL, delims, &saveptr))
+      filenames[num_networks * num_columns + c] = safe_strdup(token);
+    if (c < num_columns || token) {
+      fprintf(stderr, "ERROR: network %u in network list file %s does not "
+              "have %u filenames\n", num_networks + 1, list_filename,
+              num_columns);
+      while (c > 0)
+        free(filenames[num_networks * num_columns + --c]);
+      goto done;
+    }
+    num_networks++;
+  }
+  if (num_networks == 0) {
+    fprintf(stderr, "ERROR: no networks in network list file %s\n",
+            list_filename);
+    goto done;
+  }
+
+  for (k = 1; k < NUM_POOLED_COLUMNS; k++) {
+    if (columns[k] >= 0 &&
+        !(attr_fp[k] = create_pooled_attr_file(attr_filenames[k])))
+      goto done;
+  }
+  sizes = (uint_t *)safe_malloc(num_networks * sizeof(uint_t));
+  for (net = 0; net < num_networks; net++) {
+    const char *arclist_filename = filenames[net * num_columns + columns[0]];
+    num_vertices = 0;
+    if (readArcs) {
+      if (!(net_arcs = read_arclist_mmap(arclist_filename, &num_vertices,
+                                         &net_num_arcs, 0, UINT_MAX)))
+        goto done;
+      arcs = (nodepair_t *)safe_realloc(arcs, (num_arcs + net_num_arcs) *
+                                        sizeof(nodepair_t));
+      for (a = 0; a < net_num_arcs; a++) {
+        arcs[num_arcs + a].i = net_arcs[a].i + (uint_t)total_nodes;
+        arcs[num_arcs + a].j = net_arcs[a].j + (uint_t)total_nodes;
+      }
+      num_arcs += net_num_arcs;
+      free(net_arcs);
+    } else {
+      if (!(arclist_file = open_input_file(arclist_filename))) {
+        fprintf(stderr, "error opening file %s (%s)\n", arclist_filename,
+                strerror(errno));
+        goto done;
+      }
+      /* get_num_vertices_from_arclist_file() closes the file */
+      if (!(num_vertices = get_num_vertices_from_arclist_file(arclist_file)))
+        goto done;
+    }
+    sizes[net] = num_vertices;
+    total_nodes += num_vertices;
+    if (total_nodes > UINT_MAX || num_arcs > MAX_NUM_ARCS) {
+      fprintf(stderr, "ERROR: too many nodes or arcs in pooled networks\n");
+      goto done;
+    }
+    for (k = 1; k < NUM_POOLED_COLUMNS; k++) {
+      if (attr_fp[k] &&
+          append_pooled_attr_file(attr_fp[k],
+                                  filenames[net * num_columns + columns[k]],
+                                  &headers[k], num_vertices))
+        goto done;
+    }
+  }
+  for (k = 1; k < NUM_POOLED_COLUMNS; k++) {
+    if (attr_fp[k]) {
+      if (fclose(attr_fp[k]) != 0) {
+        attr_fp[k] = NULL;
+        fprintf(stderr, "ERROR: writing file %s failed\n",
+                *attr_filenames[k]);
+        goto done;
+      }
+      attr_fp[k] = NULL;
+    }
+  }
+
+  printf("pooling %u networks from %s (%lu nodes)\n", num_networks,
+         list_filename, (unsigned long)total_nodes);
+  g = allocate_digraph((uint_t)total_nodes);
+  g->pending_arcs = arcs;
+  g->num_pending_arcs = num_arcs;
+  arcs = NULL;
+  if (set_digraph_blocks(g, num_networks, sizes)) {
+    free_digraph(g);
+    g = NULL;
+    goto done;
+  }
+  ok = TRUE;
+
+done:
+  close_input_file(list_file);
+  for (k = 1; k < NUM_POOLED_COLUMNS; k++) {
+    if (attr_fp[k])
+      fclose(attr_fp[k]);
+    free(headers[k]);
+  }
+  if (!ok)
+    remove_pooled_attr_files(attr_files);
+  for (c = 0; c < num_networks * num_columns; c++)
+    free(filenames[c]);
+  free(filenames);
+  free(sizes);
+  free(arcs);
+  return g;
+}
+
+/*
+ * Remove the temporary attribute files made by allocate_pooled_digraph()
+ *
+ * Parameters:
+ *    attr_files - (in/out) attribute files, removed, freed and set to NULL
+ *
+ * Return value:
+ *    None.
+ */
+void remove_pooled_attr_files(pooled_attr_files_t *attr_files)
+{
+  char **filenames[4];
+  uint_t k;
+
+  filenames[0] = &attr_files->binattr_filename;
+  filenames[1] = &attr_files->catattr_filename;
+  filenames[2] = &attr_files->contattr_filename;
+  filenames[3] = &attr_files->setattr_filename;
+  for (k = 0; k < 4; k++) {
+    if (*filenames[k]) {
+      remove(*filenames[k]);
+      free(*filenames[k]);
+      *filenames[k] = NULL;
+    }
+  }
+}
+
 
 /*
  * Build digraph from Pajek format arc list file.
@@ -54,8 +949,8 @@ static const size_t BUFSIZE = 16384;  /* line buffer size for reading files */
  * line. In this program the nodes must be numbered 1..N.
  *
  * Parameters:
- *    pajek_file   - Pajek format arclist file handle (open read).
- *                   Closed by this function at end.
+ *    pajek_file   - Pajek format arclist file handle (opened with
+ *                   open_input_file()). Closed by this function at end.
  *   g             - (in/out) digraph object already allocated as above.
  *   computeStats  - if TRUE the observed graph sufficient statistics
  *                   are computed by accumulating the change statistics as
@@ -69,6 +964,8 @@ static const size_t BUFSIZE = 16384;  /* line buffer size for reading files */
  *   n_attr_interaction - number of attribute interaction change stats funcs
  *   change_stats_funcs - array of pointers to change statistics functions
  *                        length is n-n_attr-n_dyadic-n_attr_interaction
+ *   lambda_values - array of lambda (decay) values corresponding to
+ *                   change_stats_funcs (used by alternating statistics)
  *   attr_change_stats_funcs - array of pointers to change statistics functions
  *                             length is n_attr
  *   dyadic_change_stats_funcs - array of pointers to dyadic change stats funcs
@@ -95,9 +992,8 @@ static const size_t BUFSIZE = 16384;  /* line buffer size for reading files */
  *                              not used here)
  *
  * Return value:
- *    digraph object built from files (same as parameter g)
- *
- * Note this function calls exit() on error.
+ *    digraph object built from files (same as parameter g), or NULL on
+ *    error (message printed to stderr); g is then not freed.
  */
 digraph_t *load_digraph_from_arclist_file(FILE *pajek_file, digraph_t *g,
                                           bool computeStats,
@@ -106,6 +1002,7 @@ digraph_t *load_digraph_from_arclist_file(FILE *pajek_file, digraph_t *g,
                                           uint_t n_attr_interaction,
                                           change_stats_func_t
                                                      *change_stats_funcs[],
+                                          double lambda_values[],
                                           attr_change_stats_func_t
                                           *attr_change_stats_funcs[],
                                           dyadic_change_stats_func_t
@@ -146,13 +1043,13 @@ digraph_t *load_digraph_from_arclist_file(FILE *pajek_file, digraph_t *g,
   }
   if (sscanf(buf, "*vertices %d\n", &num_vertices) != 1) {
     fprintf(stderr, "ERROR: expected *vertices n line but didn't find it\n");
-    exit(1);
+    goto error;
   }
 
   if ((uint_t)num_vertices != g->num_nodes) {
     fprintf(stderr, "ERROR: expected %u vertices but found %d\n",
             g->num_nodes, num_vertices);
-    exit(1);
+    goto error;
   }
   
   do {
@@ -160,12 +1057,11 @@ digraph_t *load_digraph_from_arclist_file(FILE *pajek_file, digraph_t *g,
   } while (!feof(pajek_file) && strncasecmp(buf, "*arcs", 5) != 0);
   if (feof(pajek_file)) {
     fprintf(stderr, "did not find *arcs line\n");
-    exit(1);
+    goto error;
   }
   if (!fgets(buf, sizeof(buf)-1, pajek_file)) {
     fprintf(stderr, "ERROR: attempting to read first arc  (%s)\n", strerror(errno));
-    fclose(pajek_file);
-    exit(1);
+    goto error;
   }
 
   if (computeStats)
@@ -183,12 +1079,12 @@ digraph_t *load_digraph_from_arclist_file(FILE *pajek_file, digraph_t *g,
       break; /* end on blank line (ignore rest of file, used for stats etc.) */
     if (sscanf(token, "%d", &i) != 1) {
       fprintf(stderr, "ERROR: bad arc start node %s\n", token ? token : "(null)");
-      exit(1);
+      goto error;
     }
     token = strtok_r(NULL, delims, &saveptr);
     if (!token || sscanf(token, "%d", &j) != 1) {
       fprintf(stderr, "ERROR: bad arc end node %s\n", token ? token : "(null)");
-      exit(1);
+      goto error;
     }
     token = strtok_r(NULL, delims, &saveptr);
     if (token) {
@@ -198,11 +1094,11 @@ digraph_t *load_digraph_from_arclist_file(FILE *pajek_file, digraph_t *g,
     
     if (i < 1 || j < 1) {
       fprintf(stderr, "ERROR: node numbers start at 1, got %d,%d\n", i, j);
-      exit(1);
+      goto error;
     }
     if (i > num_vertices || j > num_vertices) {
       fprintf(stderr, "ERROR num vertices %d but got edge %d,%d\n", num_vertices, i, j);
-      exit(1); 
+      goto error;
     }
     i--; j--; /* convert to 0-based */
 
@@ -210,6 +1106,7 @@ digraph_t *load_digraph_from_arclist_file(FILE *pajek_file, digraph_t *g,
       /* accumulate change statistics in addChangeStats array */
       (void)calcChangeStats(g, i, j, n, n_attr, n_dyadic, n_attr_interaction,
                             change_stats_funcs,
+                            lambda_values,
                             attr_change_stats_funcs,
                             dyadic_change_stats_funcs,
                             attr_interaction_change_stats_funcs,
@@ -235,11 +1132,11 @@ digraph_t *load_digraph_from_arclist_file(FILE *pajek_file, digraph_t *g,
       gettimeofday(&end_timeval, NULL);
       timeval_subtract(&elapsed_timeval, &end_timeval, &start_timeval);
       etime = 1000 * elapsed_timeval.tv_sec + elapsed_timeval.tv_usec/1000;
-      MEMUSAGE_DEBUG_PRINT(("%u arcs, %u mixTwoPathHashtTab entries, %u inTwoPathHashTab entries, %u outTwoPathHashTab entries (%.2f s)...\n",
-                            g->num_arcs,
-                            HASH_COUNT(g->mixTwoPathHashTab),
-                            HASH_COUNT(g->inTwoPathHashTab),
-                            HASH_COUNT(g->outTwoPathHashTab),
+      MEMUSAGE_DEBUG_PRINT(("%lu arcs, %u mixTwoPathHashtTab entries, %u inTwoPathHashTab entries, %u outTwoPathHashTab entries (%.2f s)...\n",
+                            (unsigned long)g->num_arcs,
+                            (uint_t)TWOPATH_HASHTAB_COUNT(g->mixTwoPathHashTab),
+                            (uint_t)TWOPATH_HASHTAB_COUNT(g->inTwoPathHashTab),
+                            (uint_t)TWOPATH_HASHTAB_COUNT(g->outTwoPathHashTab),
                             (double)etime/1000));
     }
 #endif /* DEBUG_MEMUSAGE */
@@ -249,52 +1146,187 @@ digraph_t *load_digraph_from_arclist_file(FILE *pajek_file, digraph_t *g,
     if (!fgets(buf, sizeof(buf)-1, pajek_file)) {
       if (!feof(pajek_file)) {
         fprintf(stderr, "ERROR: attempting to read edge (%s)\n", strerror(errno));
-        fclose(pajek_file);
-        exit(1);
+        goto error;
       }
     }
   }
-  fclose(pajek_file);
+  close_input_file(pajek_file);
 
 #ifdef DEBUG_MEMUSAGE
   for (k = 0; k < g->num_nodes; k++) {
     total_degree += g->outdegree[k];
   }
-  MEMUSAGE_DEBUG_PRINT(("Allocated additional %f MB (twice) for %u arcs\n",
+  MEMUSAGE_DEBUG_PRINT(("Allocated additional %f MB (twice) for %lu arcs\n",
                         ((double)sizeof(uint_t) * total_degree) / (1024*1024),
-                         g->num_arcs));
+                         (unsigned long)g->num_arcs));
 #ifdef TWOPATH_HASHTABLES
   MEMUSAGE_DEBUG_PRINT(("MixTwoPath hash table has %u entries (%f MB) which is %f%% nonzero in dense matrix (which would have taken %f MB)\n",
-                        HASH_COUNT(g->mixTwoPathHashTab),
-                        ((double)HASH_COUNT(g->mixTwoPathHashTab)*2*
-                                 sizeof(twopath_record_t))/(1024*1024),
-                        100*(double)HASH_COUNT(g->mixTwoPathHashTab) /
+                        (uint_t)TWOPATH_HASHTAB_COUNT(g->mixTwoPathHashTab),
+                        (double)TWOPATH_HASHTAB_BYTES(g->mixTwoPathHashTab)/
+                        (1024*1024),
+                        100*(double)TWOPATH_HASHTAB_COUNT(g->mixTwoPathHashTab) /
                         ((double)g->num_nodes*g->num_nodes),
                         ((double)sizeof(uint_t)*num_vertices*num_vertices) /
                         (1024*1024)));
-  MEMUSAGE_DEBUG_PRINT(("MixTwoPath hash table overhead %f MB\n", (double)HASH_OVERHEAD(hh, g->mixTwoPathHashTab)/(1024*1024)));
   MEMUSAGE_DEBUG_PRINT(("InTwoPath hash table has %u entries (%f MB) which is %f%% nonzero in dense matrix (which would have taken %f MB)\n",
-                        HASH_COUNT(g->inTwoPathHashTab),
-                        ((double)HASH_COUNT(g->inTwoPathHashTab)*
-                                 (sizeof(twopath_record_t)))/(1024*1024),
-                        100*(double)HASH_COUNT(g->inTwoPathHashTab) /
+                        (uint_t)TWOPATH_HASHTAB_COUNT(g->inTwoPathHashTab),
+                        (double)TWOPATH_HASHTAB_BYTES(g->inTwoPathHashTab)/
+                        (1024*1024),
+                        100*(double)TWOPATH_HASHTAB_COUNT(g->inTwoPathHashTab) /
                         ((double)g->num_nodes*g->num_nodes),
                         ((double)sizeof(uint_t)*num_vertices*num_vertices) /
                         (1024*1024)));
-  MEMUSAGE_DEBUG_PRINT(("InTwoPath hash table overhead %f MB\n", (double)HASH_OVERHEAD(hh, g->inTwoPathHashTab)/(1024*1024)));
   MEMUSAGE_DEBUG_PRINT(("OutTwoPath hash table has %u entries (%f MB) which is %f%% nonzero in dense matrix (which would have taken %f MB)\n",
-                        HASH_COUNT(g->outTwoPathHashTab),
-                        ((double)HASH_COUNT(g->outTwoPathHashTab)*2*
-                                 sizeof(twopath_record_t))/(1024*1024),
-                        100*(double)HASH_COUNT(g->outTwoPathHashTab) /
+                        (uint_t)TWOPATH_HASHTAB_COUNT(g->outTwoPathHashTab),
+                        (double)TWOPATH_HASHTAB_BYTES(g->outTwoPathHashTab)/
+                        (1024*1024),
+                        100*(double)TWOPATH_HASHTAB_COUNT(g->outTwoPathHashTab) /
                         ((double)g->num_nodes*g->num_nodes),
                         ((double)sizeof(uint_t)*num_vertices*num_vertices) /
                         (1024*1024)));
-  MEMUSAGE_DEBUG_PRINT(("OutTwoPath hash table overhead %f MB\n", (double)HASH_OVERHEAD(hh, g->outTwoPathHashTab)/(1024*1024)));
 #endif /* TWOPATH_HASHTABLES */
 #endif /* DEBUG_MEMUSAGE */
 
   free(changestats);
 
   return(g);
+
+error:
+  close_input_file(pajek_file);
+  free(changestats);
+  return NULL;
+}
+
+
+/*
+ * Build digraph from Pajek format arc list file, the same as
+ * load_digraph_from_arclist_file() but faster for large files, by
+ * memory mapping the file and (if computeStats is FALSE) building
+ * the adjacency lists all at once with build_digraph_arcs().
+ * If g was allocated for an edge list file by
+ * allocate_digraph_from_arclist_file() (so g->node_ids is set), the
+ * file is read as an edge list instead. If the arcs were already read
+ * by allocate_digraph_from_arclist_file() (g->pending_arcs) the file is
+ * not read again. If computeStats is TRUE the arcs are inserted one at
+ * a time, but the adjacency lists and flat arc list are allocated
+ * for all of them first (reserve_digraph_arcs()).
+ *
+ * Parameters:
+ *    filename     - name of Pajek format arclist (or edge list) file
+ *    g            - (in/out) digraph object already allocated (with no
+ *                   arcs) as for load_digraph_from_arclist_file(), or
+ *                   by allocate_digraph_from_arclist_file().
+ *    computeStats and the remaining parameters are as for
+ *                   load_digraph_from_arclist_file(). The observed
+ *                   statistics are accumulated by adding one arc at a
+ *                   time, so are not faster to compute than with that
+ *                   function (but the file is still faster to read).
+ *
+ * Return value:
+ *    digraph object built from files (same as parameter g), or NULL on
+ *    error (message printed to stderr); g is then not freed.
+ */
+digraph_t *load_digraph_from_arclist_mmap(const char *filename, digraph_t *g,
+                                          bool computeStats,
+                                          uint_t n, uint_t n_attr,
+                                          uint_t n_dyadic,
+                                          uint_t n_attr_interaction,
+                                          change_stats_func_t
+                                                     *change_stats_funcs[],
+                                          double lambda_values[],
+                                          attr_change_stats_func_t
+                                          *attr_change_stats_funcs[],
+                                          dyadic_change_stats_func_t
+                                          *dyadic_change_stats_funcs[],
+                                          attr_interaction_change_stats_func_t
+                                         *attr_interaction_change_stats_funcs[],
+                                          uint_t attr_indices[],
+                                          uint_pair_t
+                                          attr_interaction_pair_indices[],
+                                          double *addChangeStats,
+                                          double theta[])
+{
+  nodepair_t *arcs;
+  arcidx_t    num_arcs, a;
+  uint_t      num_vertices, l;
+  double     *changestats;
+
+  if (g->pending_arcs) {
+    /* already read by allocate_digraph_from_arclist_file() */
+    arcs = g->pending_arcs;
+    num_arcs = g->num_pending_arcs;
+    g->pending_arcs = NULL;
+    g->num_pending_arcs = 0;
+  } else if (g->node_ids) {
+    if (scan_edgelist(filename, g->node_ids, &arcs, &num_arcs))
+      return NULL;
+  } else {
+    num_vertices = g->num_nodes;
+    if (!(arcs = read_arclist_mmap(filename, &num_vertices, &num_arcs,
+                                   0, UINT_MAX)))
+      return NULL;
+  }
+  if (!computeStats) {
+    build_digraph_arcs(g, arcs, num_arcs);
+    free(arcs);
+    return g;
+  }
+
+  reserve_digraph_arcs(g, arcs, num_arcs);
+  changestats = (double *)safe_malloc(n*sizeof(double));
+  for (a = 0; a < num_arcs; a++) {
+    /* accumulate change statistics in addChangeStats array */
+    (void)calcChangeStats(g, arcs[a].i, arcs[a].j,
+                          n, n_attr, n_dyadic, n_attr_interaction,
+                          change_stats_funcs,
+                          lambda_values,
+                          attr_change_stats_funcs,
+                          dyadic_change_stats_funcs,
+                          attr_interaction_change_stats_funcs,
+                          attr_indices,
+                          attr_interaction_pair_indices,
+                          theta, FALSE, changestats);
+    for (l = 0; l < n; l++)
+      addChangeStats[l] += changestats[l];
+    if (!isArc(g, arcs[a].i, arcs[a].j))
+      insertArc_allarcs(g, arcs[a].i, arcs[a].j);
+  }
+  free(changestats);
+  free(arcs);
+  return g;
+}
+
+
+/*
+ * Build the part of a digraph from a Pajek format arclist file held
+ * by one task of a partitioned network (see digraphPartition.h): the
+ * arcs with at least one end owned by the task. The rest of the file
+ * is skipped as it is read, so the task never holds the whole list.
+ *
+ * Parameters:
+ *    filename   - name of Pajek format arclist file
+ *    g          - (in/out) digraph object already allocated (with no
+ *                 arcs) by allocate_digraph_from_arclist_file() with
+ *                 readArcs FALSE
+ *    first_node - first node owned by the task
+ *    end_node   - one past the last node owned by the task
+ *
+ * Return value:
+ *    digraph object built from file (same as parameter g), or NULL on
+ *    error (message printed to stderr); g is then not freed.
+ */
+digraph_t *load_digraph_partition_arcs(const char *filename, digraph_t *g,
+                                       uint_t first_node, uint_t end_node)
+{
+  nodepair_t *arcs;
+  arcidx_t    num_arcs;
+  uint_t      num_vertices = g->num_nodes;
+
+  assert(!g->pending_arcs && !g->node_ids);
+  if (!(arcs = read_arclist_mmap(filename, &num_vertices, &num_arcs,
+                                 first_node, end_node)))
+    return NULL;
+  build_digraph_arcs(g, arcs, num_arcs);
+  free(arcs);
+  return g;
 }
@@ -13,6 +13,30 @@
 #include "digraph.h"
 #include "changeStatisticsDirected.h"
 
+/* format of arc list input file */
+typedef enum arclist_format_e {
+  ARCLIST_FORMAT_INVALID  = -1, /* invalid name, used as error return value */
+  ARCLIST_FORMAT_PAJEK    =  0, /* Pajek format with nodes numbered 1..N */
+  ARCLIST_FORMAT_EDGELIST =  1  /* edge list with arbitrary node ids */
+} arclist_format_e;
+
+/* attribute files made by allocate_pooled_digraph() */
+typedef struct pooled_attr_files_s {
+  char *binattr_filename;   /* binary attributes, or NULL if none */
+  char *catattr_filename;   /* categorical attributes, or NULL if none */
+  char *contattr_filename;  /* continuous attributes, or NULL if none */
+  char *setattr_filename;   /* set attributes, or NULL if none */
+} pooled_attr_files_t;
+
+arclist_format_e arclist_format_from_name(const char *name);
+digraph_t *allocate_digraph_from_arclist_file(const char *filename,
+                                              arclist_format_e format,
+                                              bool readArcs);
+int read_pending_arcs(const char *filename, digraph_t *g);
+digraph_t *allocate_pooled_digraph(const char *list_filename, bool readArcs,
+                                   pooled_attr_files_t *attr_files);
+void remove_pooled_attr_files(pooled_attr_files_t *attr_files);
+
 digraph_t *load_digraph_from_arclist_file(FILE *pajek_file, digraph_t *g,
                                           bool computeStats,
                                           uint_t n, uint_t n_attr,
@@ -20,6 +44,27 @@ digraph_t *load_digraph_from_arclist_file(FILE *pajek_file, digraph_t *g,
                                           uint_t n_attr_interaction,
                                           change_stats_func_t
                                                      *change_stats_funcs[],
+                                          double lambda_values[],
+                                          attr_change_stats_func_t
+                                          *attr_change_stats_funcs[],
+                                          dyadic_change_stats_func_t
+                                          *dyadic_change_stats_funcs[],
+                                          attr_interaction_change_stats_func_t
+                                         *attr_interaction_change_stats_funcs[],
+                                          uint_t attr_indices[],
+                                          uint_pair_t
+                                          attr_interaction_pair_indices[],
+                                          double addChangeStats[],
+                                          double theta[]);
+
+digraph_t *load_digraph_from_arclist_mmap(const char *filename, digraph_t *g,
+                                          bool computeStats,
+                                          uint_t n, uint_t n_attr,
+                                          uint_t n_dyadic,
+                                          uint_t n_attr_interaction,
+                                          change_stats_func_t
+                                                     *change_stats_funcs[],
+                                          double lambda_values[],
                                           attr_change_stats_func_t
                                           *attr_change_stats_funcs[],
                                           dyadic_change_stats_func_t
@@ -32,6 +77,9 @@ digraph_t *load_digraph_from_arclist_file(FILE *pajek_file, digraph_t *g,
                                           double addChangeStats[],
                                           double theta[]);
 
+digraph_t *load_digraph_partition_arcs(const char *filename, digraph_t *g,
+                                       uint_t first_node, uint_t end_node);
+
 
 #endif /* LOADDIGRAPH_H */
 
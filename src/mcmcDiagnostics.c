@@ -0,0 +1,274 @@
+/*****************************************************************************
+ *
+ * File:    mcmcDiagnostics.c
+ * Author:  Alex Stivala
+ * Created: October 2026
+ *
+ * Online autocorrelation and effective sample size of the statistics
+ * of simulated network samples (see mcmcDiagnostics.h).
+ *
+ * Reference for batch means:
+ *
+ *   Flegal, J. M., Haran, M., & Jones, G. L. (2008). Markov chain Monte
+ *   Carlo: Can we trust the third significant figure? Statistical
+ *   Science, 23(2), 250-260.
+ *
+ ****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+#include "mcmcDiagnostics.h"
+
+/*****************************************************************************
+ *
+ * externally visible functions
+ *
+ ****************************************************************************/
+
+/*
+ * Initialize diagnostics of n statistics, with no samples.
+ *
+ * Parameters:
+ *   diag - (out) diagnostics, arrays allocated here, free with
+ *          free_mcmc_diag()
+ *   n    - number of statistics
+ *
+ * Return value:
+ *   None.
+ */
+void init_mcmc_diag(mcmc_diag_t *diag, uint_t n)
+{
+  diag->n = n;
+  init_online_stats(&diag->stats, n, FALSE);
+  diag->shift = (double *)safe_calloc(n, sizeof(double));
+  diag->sum = (double *)safe_calloc(n, sizeof(double));
+  diag->prev = (double *)safe_calloc(n, sizeof(double));
+  diag->lag_sum = (double *)safe_calloc(n, sizeof(double));
+  diag->batch_sum = (double *)safe_calloc((size_t)n * MCMC_DIAG_MAX_BATCHES,
+                                          sizeof(double));
+  diag->cur_sum = (double *)safe_calloc(n, sizeof(double));
+  diag->batch_size = 1;
+  diag->num_batches = 0;
+  diag->cur_count = 0;
+}
+
+/*
+ * Add a sample to diagnostics.
+ *
+ * Parameters:
+ *   diag - diagnostics
+ *   x    - value of each of the diag->n statistics in the sample
+ *
+ * Return value:
+ *   None.
+ */
+void add_mcmc_diag_sample(mcmc_diag_t *diag, const double x[])
+{
+  uint_t i, b;
+  double y;
+
+  if (diag->stats.count == 0)
+    memcpy(diag->shift, x, diag->n * sizeof(double));
+  for (i = 0; i < diag->n; i++) {
+    y = x[i] - diag->shift[i];
+    if (diag->stats.count > 0)
+      diag->lag_sum[i] += diag->prev[i] * y;
+    diag->prev[i] = y;
+    diag->sum[i] += y;
+    diag->cur_sum[i] += y;
+  }
+  add_online_stats(&diag->stats, x);
+
+  if (++diag->cur_count < diag->batch_size)
+    return;
+  /* batch complete */
+  for (i = 0; i < diag->n; i++) {
+    diag->batch_sum[i * MCMC_DIAG_MAX_BATCHES + diag->num_batches] =
+      diag->cur_sum[i];
+    diag->cur_sum[i] = 0;
+  }
+  diag->cur_count = 0;
+  if (++diag->num_batches < MCMC_DIAG_MAX_BATCHES)
+    return;
+  /* all batches complete, so merge pairs to make half as many twice
+     as large */
+  for (i = 0; i < diag->n; i++)
+    for (b = 0; b < MCMC_DIAG_MAX_BATCHES / 2; b++)
+      diag->batch_sum[i * MCMC_DIAG_MAX_BATCHES + b] =
+        diag->batch_sum[i * MCMC_DIAG_MAX_BATCHES + 2 * b] +
+        diag->batch_sum[i * MCMC_DIAG_MAX_BATCHES + 2 * b + 1];
+  diag->num_batches = MCMC_DIAG_MAX_BATCHES / 2;
+  diag->batch_size *= 2;
+}
+
+/*
+ * Lag-1 autocorrelation of a statistic.
+ *
+ * Parameters:
+ *   diag - diagnostics
+ *   i    - index of statistic
+ *
+ * Return value:
+ *   Lag-1 autocorrelation of statistic i, or NaN if fewer than two
+ *   samples or the statistic is constant.
+ */
+double mcmc_diag_autocorrelation(const mcmc_diag_t *diag, uint_t i)
+{
+  double count = diag->stats.count;
+  double mean, lag_cov;
+
+  if (diag->stats.count < 2 || diag->stats.m2[i] <= 0)
+    return NAN;
+  /* sum over t > 0 of (y[t-1] - mean)(y[t] - mean), the first sample
+     being 0 after the shift */
+  mean = diag->sum[i] / count;
+  lag_cov = diag->lag_sum[i] - mean * (diag->sum[i] - diag->prev[i]) -
+    mean * diag->sum[i] + (count - 1) * mean * mean;
+  return lag_cov / diag->stats.m2[i];
+}
+
+/*
+ * Effective sample size of a statistic. This is the batch means
+ * estimate, unless the estimate from the lag-1 autocorrelation
+ * (as for an AR(1) process) is smaller: when the batches are not
+ * much longer than the autocorrelation time, the batch means are
+ * almost as correlated as the samples, so the batch means estimate
+ * cannot be much less than the number of batches however badly the
+ * chain mixes.
+ *
+ * Parameters:
+ *   diag - diagnostics
+ *   i    - index of statistic
+ *
+ * Return value:
+ *   Effective sample size of statistic i, or NaN if fewer than two
+ *   complete batches or the statistic is constant.
+ */
+double mcmc_diag_ess(const mcmc_diag_t *diag, uint_t i)
+{
+  const double *batch_sum = diag->batch_sum + (size_t)i * MCMC_DIAG_MAX_BATCHES;
+  uint_t b, k = diag->num_batches;
+  double mean = 0, m2 = 0, delta, var, batch_var, ess, rho;
+
+  if (k < 2 || diag->stats.count < 2 || diag->stats.m2[i] <= 0)
+    return NAN;
+  for (b = 0; b < k; b++)
+    mean += batch_sum[b] / diag->batch_size;
+  mean /= k;
+  for (b = 0; b < k; b++) {
+    delta = batch_sum[b] / diag->batch_size - mean;
+    m2 += delta * delta;
+  }
+  /* asymptotic variance estimate batch_size times variance of means */
+  batch_var = diag->batch_size * m2 / (k - 1);
+  var = diag->stats.m2[i] / (diag->stats.count - 1);
+  ess = batch_var > 0 ? diag->stats.count * var / batch_var :
+    diag->stats.count;
+  rho = mcmc_diag_autocorrelation(diag, i);
+  if (rho > 0)
+    ess = MIN(ess, diag->stats.count * (1 - rho) / (1 + rho));
+  return ess;
+}
+
+/*
+ * Test if the effective sample size of any statistic is projected to
+ * be less than min_ess at the end of the simulation, assuming it grows
+ * in proportion to the number of samples. Only tested once the batches
+ * have more than one sample.
+ *
+ * Parameters:
+ *   diag          - diagnostics
+ *   min_ess       - minimum effective sample size
+ *   total_samples - number of samples there will be at the end
+ *   stat          - (out) index of the first statistic with projected
+ *                   ESS less than min_ess, if any
+ *
+ * Return value:
+ *   TRUE if some statistic is projected to have ESS less than min_ess.
+ */
+bool mcmc_diag_low_ess(const mcmc_diag_t *diag, double min_ess,
+                       uint_t total_samples, uint_t *stat)
+{
+  uint_t i;
+  double ess;
+
+  if (diag->batch_size < 2)
+    return FALSE;
+  for (i = 0; i < diag->n; i++) {
+    ess = mcmc_diag_ess(diag, i);
+    if (!isnan(ess) &&
+        ess * total_samples / diag->stats.count < min_ess) {
+      *stat = i;
+      return TRUE;
+    }
+  }
+  return FALSE;
+}
+
+/*
+ * Write the mean, standard deviation, lag-1 autocorrelation and
+ * effective sample size of each statistic, and a warning (to stderr)
+ * for each with effective sample size less than min_ess.
+ *
+ * Parameters:
+ *   fp      - open (write) file to write the summary to
+ *   diag    - diagnostics
+ *   names   - names of the diag->n statistics separated by spaces
+ *   min_ess - minimum effective sample size, 0 for no warnings
+ *
+ * Return value:
+ *   Number of statistics with effective sample size less than min_ess.
+ */
+uint_t write_mcmc_diag_summary(FILE *fp, const mcmc_diag_t *diag,
+                               const char *names, double min_ess)
+{
+  char   *names_copy = safe_strdup(names ? names : "");
+  char   *saveptr = NULL;
+  char   *name;
+  uint_t  i, num_low = 0;
+  double  ess;
+
+  fprintf(fp, "%-32s %14s %14s %10s %10s\n", "Statistic", "Mean", "SD",
+          "Lag1ACF", "ESS");
+  name = strtok_r(names_copy, " ", &saveptr);
+  for (i = 0; i < diag->n; i++) {
+    ess = mcmc_diag_ess(diag, i);
+    fprintf(fp, "%-32s %14g %14g %10.4f %10.1f\n", name ? name : "?",
+            diag->stats.mean[i], online_stats_sd(&diag->stats, i),
+            mcmc_diag_autocorrelation(diag, i), ess);
+    if (!isnan(ess) && ess < min_ess) {
+      fflush(fp);
+      fprintf(stderr, "WARNING: effective sample size of %s is %.1f, "
+              "less than minESS = %g (interval may be too small)\n",
+              name ? name : "?", ess, min_ess);
+      num_low++;
+    }
+    if (name)
+      name = strtok_r(NULL, " ", &saveptr);
+  }
+  free(names_copy);
+  return num_low;
+}
+
+/*
+ * Free the arrays of diagnostics.
+ *
+ * Parameters:
+ *   diag - diagnostics initialized with init_mcmc_diag()
+ *
+ * Return value:
+ *   None.
+ */
+void free_mcmc_diag(mcmc_diag_t *diag)
+{
+  free_online_stats(&diag->stats);
+  free(diag->shift);
+  free(diag->sum);
+  free(diag->prev);
+  free(diag->lag_sum);
+  free(diag->batch_sum);
+  free(diag->cur_sum);
+}
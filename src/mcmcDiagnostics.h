@@ -0,0 +1,62 @@
+#ifndef MCMCDIAGNOSTICS_H
+#define MCMCDIAGNOSTICS_H
+/*****************************************************************************
+ *
+ * File:    mcmcDiagnostics.h
+ * Author:  Alex Stivala
+ * Created: October 2026
+ *
+ * Online MCMC diagnostics of the statistics of the networks sampled by
+ * SimulateERGM: the lag-1 autocorrelation and effective sample size
+ * (ESS) of each statistic, updated as each sample is added without
+ * storing the samples, so that a too small interval between samples
+ * can be found (or the run stopped) during the simulation rather than
+ * afterwards with plotSimulationDiagnostics.R.
+ *
+ * The ESS is estimated by batch means with a fixed number of batches:
+ * the samples are added to batches of batch_size consecutive samples,
+ * starting at 1, and when MCMC_DIAG_MAX_BATCHES batches are complete
+ * adjacent pairs are merged, doubling batch_size. So there are always
+ * between MCMC_DIAG_MAX_BATCHES/2 and MCMC_DIAG_MAX_BATCHES complete
+ * batches (once that many samples have been added), each of about
+ * 1/32 to 1/64 of the samples. The ESS is the number of samples times
+ * their variance over the variance of the batch means times
+ * batch_size, or the AR(1) estimate n(1 - r)/(1 + r) from the lag-1
+ * autocorrelation r if that is smaller.
+ *
+ ****************************************************************************/
+
+#include <stdio.h>
+#include "utils.h"
+
+#define MCMC_DIAG_MAX_BATCHES 64 /* must be even */
+
+typedef struct mcmc_diag_s {
+  uint_t  n;             /* number of statistics */
+  online_stats_t stats;  /* mean and variance of each statistic */
+  double *shift;         /* first sample, subtracted from each sample so
+                            the batch sums do not lose precision */
+  double *sum;           /* sum of samples (shifted) */
+  double *prev;          /* previous sample (shifted) */
+  double *lag_sum;       /* sum over samples t > 0 of products of
+                            samples t-1 and t (shifted) */
+  double *batch_sum;     /* MCMC_DIAG_MAX_BATCHES sums (shifted) of the
+                            complete batches of each statistic, for
+                            statistic i batch_sum[i*MAX_BATCHES + b] */
+  double *cur_sum;       /* sum (shifted) of incomplete batch */
+  uint_t  batch_size;    /* samples in each complete batch */
+  uint_t  num_batches;   /* number of complete batches */
+  uint_t  cur_count;     /* samples in incomplete batch */
+} mcmc_diag_t;
+
+void init_mcmc_diag(mcmc_diag_t *diag, uint_t n);
+void add_mcmc_diag_sample(mcmc_diag_t *diag, const double x[]);
+double mcmc_diag_autocorrelation(const mcmc_diag_t *diag, uint_t i);
+double mcmc_diag_ess(const mcmc_diag_t *diag, uint_t i);
+bool mcmc_diag_low_ess(const mcmc_diag_t *diag, double min_ess,
+                       uint_t total_samples, uint_t *stat);
+uint_t write_mcmc_diag_summary(FILE *fp, const mcmc_diag_t *diag,
+                               const char *names, double min_ess);
+void free_mcmc_diag(mcmc_diag_t *diag);
+
+#endif /* MCMCDIAGNOSTICS_H */
@@ -0,0 +1,337 @@
+/*****************************************************************************
+ *
+ * File:    mtmSampler.c
+ * Author:  Alex Stivala, Maksym Byshkin
+ * Created: October 2026
+ *
+ * Multiple-try Metropolis (MTM) ERGM distribution sampler. At each
+ * step several random dyads are proposed for toggling, one of them is
+ * selected with probability proportional to its weight, and the move
+ * is accepted with the generalized Metropolis-Hastings ratio of the
+ * weights of the proposals and of a reference set drawn from the
+ * selected move. The change statistics of each set of proposals are
+ * computed together with calcChangeStatsBatch().
+ *
+ * The proposals are drawn in the same way as for the basic sampler,
+ * which is the special case of one try. With more tries, more moves
+ * are accepted for models where the basic sampler rejects most of them,
+ * at the cost of 2K-1 change statistics evaluations per step rather
+ * than one.
+ *
+ * Liu, J. S., Liang, F., & Wong, W. H. (2000). The multiple-try method
+ * and local optimization in Metropolis sampling. Journal of the
+ * American Statistical Association, 95(449), 121-134.
+ *
+ ****************************************************************************/
+
+#include <stdlib.h>
+#include <assert.h>
+#include <math.h>
+#include "utils.h"
+#include "changeStatisticsDirected.h"
+#include "mtmSampler.h"
+
+/*****************************************************************************
+ *
+ * local functions
+ *
+ ****************************************************************************/
+
+/*
+ * Draw a dyad to toggle uniformly at random, in the same way as the
+ * basic sampler (see basicSampler()).
+ *
+ * Parameters:
+ *   g        - digraph object
+ *   useConditionalEstimation - if True only draw dyads that can be
+ *                              toggled in snowball conditional estimation
+ *   forbidReciprocity - if True do not draw adds of reciprocated arcs
+ *   prng     - pseudorandom number generator stream (updated)
+ *   dyad     - (Out) the dyad i, j to toggle arc i -> j of
+ *   isDelete - (Out) TRUE if arc i -> j is in g (so it is a delete move)
+ *
+ * Return value:
+ *   None.
+ */
+static void draw_toggle(const digraph_t *g, bool useConditionalEstimation,
+                        bool forbidReciprocity, prng_t *prng,
+                        nodepair_t *dyad, bool *isDelete)
+{
+  uint_t i, j;
+
+  if (useConditionalEstimation) {
+    assert(!forbidReciprocity); /* TODO not implemented for snowball */
+    do {
+      sample_zone_pair(g, prng, &i, &j);
+      assert(g->zone[i] < g->max_zone && g->zone[j] < g->max_zone);
+      assert(labs((long)g->zone[i] - (long)g->zone[j]) <= 1);
+    } while ((isArcIgnoreDirection(g, i, j) &&
+              ((g->zone[i] > g->zone[j] && g->prev_wave_degree[i] == 1) ||
+               (g->zone[j] > g->zone[i] && g->prev_wave_degree[j] == 1))));
+    *isDelete = isArc(g, i, j);
+  } else {
+    do {
+      if (g->block)
+        sample_block_pair(g, prng, &i, &j);
+      else
+        prng_int_urand_pair(prng, g->num_nodes, &i, &j);
+      *isDelete = isArc(g, i, j);
+    } while (forbidReciprocity && !*isDelete && isArc(g, j, i));
+  }
+  dyad->i = i;
+  dyad->j = j;
+}
+
+/*
+ * Return log(sum(exp(x[k]))) for the K >= 1 values x, without
+ * overflow for large x.
+ */
+static double log_sum_exp(const double x[], uint_t K)
+{
+  double mx = x[0], sum = 0;
+  uint_t k;
+
+  for (k = 1; k < K; k++)
+    mx = MAX(mx, x[k]);
+  for (k = 0; k < K; k++)
+    sum += exp(x[k] - mx);
+  return mx + log(sum);
+}
+
+/*****************************************************************************
+ *
+ * externally visible functions
+ *
+ ****************************************************************************/
+
+/*
+ * Multiple-try Metropolis ERGM MCMC sampler. At each step num_tries
+ * dyads y_1..y_K are drawn uniformly at random as for the basic
+ * sampler, and the change statistics for toggling each of them are
+ * computed in one batch. One of them, y_J, is selected with probability
+ * proportional to its weight w_k = pi(y_k)/pi(x) = exp(theta*dz_k).
+ * Then from the graph with y_J toggled a reference set of K-1 dyads is
+ * drawn in the same way, and the move is accepted with probability
+ *
+ *   min(1, sum_k w_k / (1 + w_J * sum_k w*_k))
+ *
+ * where w*_k are the weights of the reference toggles relative to the
+ * graph with y_J toggled (the 1 is the weight of the current graph x,
+ * the last member of the reference set). With one try this is the basic
+ * sampler.
+ *
+ * Parameters:
+ *   g      - digraph object. Modifed if performMove is true, otherwise
+ *            it is modified during each step but restored.
+ *   n      - number of parameters (length of theta vector and total
+ *            number of change statistics functions)
+ *   n_attr - number of attribute change stats functions
+ *   n_dyadic -number of dyadic covariate change stats funcs
+ *   n_attr_interaction - number of attribute interaction change stats funcs
+ *   change_stats_funcs - array of pointers to change statistics functions
+ *                        length is n-n_attr-n_dyadic-n_attr_interaction
+ *   lambda_values      - array of lambda (decay) values corresponding to
+ *                      change_stats_funcs (used by alternating statistics)
+ *   attr_change_stats_funcs - array of pointers to change statistics functions
+ *                             length is n_attr
+ *   dyadic_change_stats_funcs - array of pointers to dyadic change stats funcs
+ *                             length is n_dyadic
+ *   attr_interaction_change_stats_funcs - array of pointers to attribute
+ *                           interaction (pair) change statistics functions.
+ *                           length is n_attr_interaction.
+ *   attr_indices   - array of n_attr attribute indices (index into g->binattr
+ *                    or g->catattr) corresponding to attr_change_stats_funcs
+ *   attr_interaction_pair_indices - array of n_attr_interaction pairs
+ *                          of attribute inidices similar to above but
+ *                          for attr_interaction_change_setats_funcs which
+ *                          requires pairs of indices.
+ *   theta  - array of n parameter values corresponding to change stats funcs
+ *   addChangeStats - (Out) vector of n change stats for add moves
+ *                    Allocated by caller.
+ *   delChangeStats - (Out) vector of n change stats for delete moves
+ *                    Allocated by caller
+ *   sampler_m   - Number of proposals (sampling iterations)
+ *   performMove - if true, moves are actually performed (digraph updated).
+ *                 Otherwise digraph is restored after each step.
+ *   num_tries   - number of tries K in each step (at least 1)
+ *   useConditionalEstimation - if True do conditional estimation of snowball
+ *                              network sample.
+ *   forbidReciprocity - if True do not allow reciprocated arcs.
+ *   prng - pseudorandom number generator stream to use (updated)
+ *   ws   - sampler workspace (scratch buffers for n parameters)
+ *
+ * Return value:
+ *   Acceptance rate.
+ *
+ * The addChangeStats and delChangeStats arrays are of length n corresponding
+ * to the theta parameter array and change_stats_funcs change statistics
+ * function pointer array. On exit they are set to the sum values of the
+ * change statistics for add and delete moves respectively.
+ *
+ * Since the graph is changed (temporarily if performMove is False) to
+ * draw the reference set, this sampler cannot share the graph with
+ * other threads, even when performMove is False.
+ */
+double mtmSampler(digraph_t *g,  uint_t n, uint_t n_attr, uint_t n_dyadic,
+                  uint_t n_attr_interaction,
+                  change_stats_func_t *change_stats_funcs[],
+                  double lambda_values[],
+                  attr_change_stats_func_t *attr_change_stats_funcs[],
+                  dyadic_change_stats_func_t *dyadic_change_stats_funcs[],
+                  attr_interaction_change_stats_func_t
+                                   *attr_interaction_change_stats_funcs[],
+                  uint_t attr_indices[],
+                  uint_pair_t attr_interaction_pair_indices[],
+                  double theta[],
+                  double addChangeStats[], double delChangeStats[],
+                  uint_t sampler_m,
+                  bool performMove,
+                  uint_t num_tries,
+                  bool useConditionalEstimation,
+                  bool forbidReciprocity,
+                  prng_t *prng, sampler_workspace_t *ws)
+{
+  const uint_t K = num_tries;
+  uint_t      accepted = 0; /* number of accepted moves */
+  uint_t      J;            /* index of selected try */
+  uint_t      k, l, step;
+  double      logW;         /* log of sum of weights of the tries */
+  double      logD;         /* log of sum of weights of the reference set */
+  double      a, cum, u;
+  nodepair_t *tries, *refs;
+  bool       *triesDelete, *refsDelete;
+  batchstat_t *triesStats, *refsStats;
+  double     *triesTotals, *refsTotals;
+  double     *stats;
+  bool        accept;
+
+  assert(K >= 1);
+  for (l = 0; l < n; l++)
+    addChangeStats[l] = delChangeStats[l] = 0;
+
+  /* the tries are the first K of the batch, the reference set the rest */
+  sampler_workspace_reserve_batch(ws, 2*K, 0);
+  tries       = ws->dyads;
+  refs        = ws->dyads + K;
+  triesDelete = ws->isDelete;
+  refsDelete  = ws->isDelete + K;
+  triesStats  = ws->batch_stats;
+  refsStats   = ws->batch_stats + (size_t)n * K;
+  triesTotals = ws->totals;
+  refsTotals  = ws->totals + K;
+
+  for (step = 0; step < sampler_m; step++) {
+    for (k = 0; k < K; k++)
+      draw_toggle(g, useConditionalEstimation, forbidReciprocity, prng,
+                  &tries[k], &triesDelete[k]);
+    calcChangeStatsBatch(g, K, tries, triesDelete, n, n_attr, n_dyadic,
+                         n_attr_interaction, change_stats_funcs,
+                         lambda_values, attr_change_stats_funcs,
+                         dyadic_change_stats_funcs,
+                         attr_interaction_change_stats_funcs,
+                         attr_indices, attr_interaction_pair_indices,
+                         theta, triesStats, triesTotals);
+
+    /* select try J with probability proportional to exp(totals[J]) */
+    logW = log_sum_exp(triesTotals, K);
+    J = 0;
+    if (K > 1) {
+      u = prng_urand(prng);
+      cum = 0;
+      for (J = 0; J < K - 1; J++) {
+        cum += exp(triesTotals[J] - logW);
+        if (u < cum)
+          break;
+      }
+    }
+    SAMPLER_DEBUG_PRINT(("%s %d -> %d\n", triesDelete[J] ? "del" : "add",
+                         tries[J].i, tries[J].j));
+
+    /* draw the reference set from the graph with try J done, the
+       current graph being the last member of the set with weight 1.
+       The try is journalled so that if it is not kept it is undone by
+       a rollback that leaves the arc lists exactly as they were */
+    begin_arc_journal(g);
+    journal_toggle_arc(g, tries[J].i, tries[J].j, triesDelete[J],
+                       useConditionalEstimation);
+    if (K > 1) {
+      for (k = 0; k < K - 1; k++)
+        draw_toggle(g, useConditionalEstimation, forbidReciprocity, prng,
+                    &refs[k], &refsDelete[k]);
+      calcChangeStatsBatch(g, K - 1, refs, refsDelete, n, n_attr, n_dyadic,
+                           n_attr_interaction, change_stats_funcs,
+                           lambda_values, attr_change_stats_funcs,
+                           dyadic_change_stats_funcs,
+                           attr_interaction_change_stats_funcs,
+                           attr_indices, attr_interaction_pair_indices,
+                           theta, refsStats, refsTotals);
+      /* log(1 + exp(a)) for a = log(w_J * sum of reference weights) */
+      a = triesTotals[J] + log_sum_exp(refsTotals, K - 1);
+      logD = a > 0 ? a + log1p(exp(-a)) : log1p(exp(a));
+    } else {
+      logD = 0;
+    }
+
+    /* now exp(logW - logD) is the acceptance probability */
+    accept = prng_accept(prng, logW - logD);
+    if (ws->trace) {
+      /* the statistics of try J, which is the proposal made */
+      for (l = 0; l < n; l++)
+        ws->changestats[l] = triesStats[(size_t)l*K + J];
+      trace_proposal(ws->trace, tries[J].i, tries[J].j,
+                     PROPOSAL_TRACE_JOURNAL |
+                     (triesDelete[J] ? PROPOSAL_TRACE_DELETE : 0) |
+                     (accept ? PROPOSAL_TRACE_ACCEPTED : 0) |
+                     (accept && performMove ? PROPOSAL_TRACE_MOVED : 0),
+                     prng, ws->changestats);
+    }
+    if (accept) {
+      accepted++;
+      if (performMove)
+        commit_arc_journal(g);
+      else
+        rollback_arc_journal(g);
+      /* accumulate the change statistics for add and del moves separately */
+      stats = triesDelete[J] ? delChangeStats : addChangeStats;
+      for (l = 0; l < n; l++)
+        stats[l] += triesStats[(size_t)l*K + J];
+    } else {
+      rollback_arc_journal(g);
+    }
+  }
+  return (double)accepted / sampler_m;
+}
+
+/*****************************************************************************
+ *
+ * sampler interface (see sampler.h)
+ *
+ ****************************************************************************/
+
+static double mtm_sampler_run(sampler_t *s, digraph_t *g, double theta[],
+                              double addChangeStats[], double delChangeStats[],
+                              uint_t sampler_m, bool performMove)
+{
+  const sampler_model_t *m = s->model;
+
+  return mtmSampler(g, m->n, m->n_attr, m->n_dyadic, m->n_attr_interaction,
+                    m->change_stats_funcs, m->lambda_values,
+                    m->attr_change_stats_funcs, m->dyadic_change_stats_funcs,
+                    m->attr_interaction_change_stats_funcs, m->attr_indices,
+                    m->attr_interaction_pair_indices, theta,
+                    addChangeStats, delChangeStats, sampler_m, performMove,
+                    s->options.mtm_tries,
+                    s->options.useConditionalEstimation,
+                    s->options.forbidReciprocity, s->prng, s->ws);
+}
+
+const sampler_ops_t mtm_sampler_ops = {
+  "MTM",              /* name */
+  FALSE,              /* divisible */
+  0,                  /* state_size */
+  NULL,               /* create */
+  NULL,               /* init */
+  mtm_sampler_run,    /* run */
+  NULL,               /* arc_stats */
+  NULL                /* destroy */
+};
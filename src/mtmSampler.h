@@ -0,0 +1,48 @@
+#ifndef MTMSAMPLER_H
+#define MTMSAMPLER_H
+/*****************************************************************************
+ *
+ * File:    mtmSampler.h
+ * Author:  Alex Stivala, Maksym Byshkin
+ * Created: October 2026
+ *
+ * Multiple-try Metropolis (MTM) ERGM distribution sampler. At each
+ * step several random dyads are proposed for toggling, one of them is
+ * selected with probability proportional to its weight, and the move
+ * is accepted with the generalized Metropolis-Hastings ratio of the
+ * weights of the proposals and of a reference set drawn from the
+ * selected move. The change statistics of each set of proposals are
+ * computed together with calcChangeStatsBatch().
+ *
+ * Liu, J. S., Liang, F., & Wong, W. H. (2000). The multiple-try method
+ * and local optimization in Metropolis sampling. Journal of the
+ * American Statistical Association, 95(449), 121-134.
+ *
+ ****************************************************************************/
+
+#include "changeStatisticsDirected.h"
+#include "sampler.h"
+
+extern const sampler_ops_t mtm_sampler_ops;
+
+double mtmSampler(digraph_t *g,  uint_t n, uint_t n_attr, uint_t n_dyadic,
+                  uint_t n_attr_interaction,
+                  change_stats_func_t *change_stats_funcs[],
+                  double lambda_values[],
+                  attr_change_stats_func_t *attr_change_stats_funcs[],
+                  dyadic_change_stats_func_t *dyadic_change_stats_funcs[],
+                  attr_interaction_change_stats_func_t
+                                   *attr_interaction_change_stats_funcs[],
+                  uint_t attr_indices[],
+                  uint_pair_t attr_interaction_pair_indices[],
+                  double theta[],
+                  double addChangeStats[], double delChangeStats[],
+                  uint_t sampler_m,
+                  bool performMove,
+                  uint_t num_tries,
+                  bool useConditionalEstimation,
+                  bool forbidReciprocity,
+                  prng_t *prng, sampler_workspace_t *ws);
+
+
+#endif /* MTMSAMPLER_H */
@@ -0,0 +1,314 @@
+/*****************************************************************************
+ *
+ * File:    partitionedSampler.c
+ * Author:  Alex Stivala, Maksym Byshkin
+ * Created: October 2026
+ *
+ * ERGM distribution sampler for a network partitioned between tasks,
+ * see partitionedSampler.h.
+ *
+ * The change statistics of the moves of a task are computed without
+ * the moves of the other tasks in the same call. Algorithm EE adds up
+ * the change statistics as the difference of the statistics of the
+ * network from the observed, so if moves of different tasks in a call
+ * interact (e.g. two tasks each adding an arc to the same node, each
+ * counting an in-star the other one does not know about), the error
+ * would accumulate over the whole run. So in the next call, once the
+ * moves of all the tasks are known, each task replays them in rank
+ * order: undoing them all back to its first one, then redoing them,
+ * computing the change statistics of each of its own moves given all
+ * the moves before it. The difference from the change statistics it
+ * reported for them is added to those of the call, so the sums over a
+ * run are the actual change in the statistics (of the network the
+ * moves of all tasks in that order make) apart from the last call.
+ *
+ ****************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "utils.h"
+#include "changeStatisticsDirected.h"
+#include "partitionedSampler.h"
+
+/*****************************************************************************
+ *
+ * local functions
+ *
+ ****************************************************************************/
+
+/*
+ * Replay the moves of the last exchange (part->received) in rank order,
+ * undoing them back to the first move of this task and then redoing
+ * them, adding the change statistics of each move of this task given
+ * the moves before it to sums (add moves then delete moves, as in
+ * partitionedSampler()). The nodes the change statistics need must be
+ * present.
+ */
+static void replay_own_moves(digraph_t *g, uint_t n, uint_t n_attr,
+                             uint_t n_dyadic, uint_t n_attr_interaction,
+                             change_stats_func_t *change_stats_funcs[],
+                             double lambda_values[],
+                             attr_change_stats_func_t
+                                             *attr_change_stats_funcs[],
+                             dyadic_change_stats_func_t
+                                             *dyadic_change_stats_funcs[],
+                             attr_interaction_change_stats_func_t
+                                   *attr_interaction_change_stats_funcs[],
+                             uint_t attr_indices[],
+                             uint_pair_t attr_interaction_pair_indices[],
+                             double theta[], digraph_partition_t *part,
+                             double *changestats, double sums[])
+{
+  const uint_t *m = part->received;
+  uint_t        k, l;
+
+  for (k = part->num_received; k > part->own_begin; k -= 3) {
+    (void)partition_apply_move(part, g, m[k-3], m[k-2], !m[k-1]);
+    if (k <= part->own_end) {
+      /* arc is now as it was before the move */
+      (void)calcChangeStats(g, m[k-3], m[k-2], n, n_attr, n_dyadic,
+                            n_attr_interaction, change_stats_funcs,
+                            lambda_values, attr_change_stats_funcs,
+                            dyadic_change_stats_funcs,
+                            attr_interaction_change_stats_funcs,
+                            attr_indices, attr_interaction_pair_indices,
+                            theta, m[k-1], changestats);
+      for (l = 0; l < n; l++)
+        sums[(m[k-1] ? n : 0) + l] += changestats[l];
+    }
+  }
+  for (k = part->own_begin; k < part->num_received; k += 3)
+    (void)partition_apply_move(part, g, m[k], m[k+1], m[k+2]);
+}
+
+/*****************************************************************************
+ *
+ * externally visible functions
+ *
+ ****************************************************************************/
+
+/*
+ * Partitioned ERGM MCMC sampler. Every task calls this with the same
+ * theta and sampler_m; the task proposes its share of the sampler_m
+ * proposals, each a dyad i, j with i uniformly at random from the nodes
+ * it owns and j from all the other nodes, toggling arc i->j.
+ *
+ * Parameters:
+ *   g      - local digraph of this task (see digraphPartition.h).
+ *            Modifed if performMove is true (and by fetching nodes).
+ *   n, n_attr, n_dyadic, n_attr_interaction, change_stats_funcs,
+ *   lambda_values, attr_change_stats_funcs, dyadic_change_stats_funcs,
+ *   attr_interaction_change_stats_funcs, attr_indices,
+ *   attr_interaction_pair_indices, theta - the model and parameters,
+ *            as for basicSampler()
+ *   addChangeStats - (Out) vector of n change stats for add moves
+ *                    (summed over all tasks). Allocated by caller.
+ *   delChangeStats - (Out) vector of n change stats for delete moves
+ *                    (summed over all tasks). Allocated by caller
+ *   ownChangeStats - (In/Out) vector of 2n change stats sums (add then
+ *                    delete moves) of the moves of this task in the
+ *                    last call, which are corrected when the moves of
+ *                    the other tasks are known. All zero before the
+ *                    first call. Allocated by caller.
+ *   sampler_m   - Number of proposals (sampling iterations) of all tasks
+ *   performMove - if true, moves are actually performed (digraph updated).
+ *                 Otherwise digraph is not actually changed.
+ *   part - partition of the network for this task
+ *   prng - pseudorandom number generator stream to use (updated)
+ *   ws   - sampler workspace (scratch buffers for n parameters)
+ *
+ * Return value:
+ *   Acceptance rate (over all tasks).
+ */
+double partitionedSampler(digraph_t *g, uint_t n, uint_t n_attr,
+                          uint_t n_dyadic, uint_t n_attr_interaction,
+                          change_stats_func_t *change_stats_funcs[],
+                          double lambda_values[],
+                          attr_change_stats_func_t *attr_change_stats_funcs[],
+                          dyadic_change_stats_func_t
+                                             *dyadic_change_stats_funcs[],
+                          attr_interaction_change_stats_func_t
+                                   *attr_interaction_change_stats_funcs[],
+                          uint_t attr_indices[],
+                          uint_pair_t attr_interaction_pair_indices[],
+                          double theta[],
+                          double addChangeStats[], double delChangeStats[],
+                          double ownChangeStats[],
+                          uint_t sampler_m,
+                          bool performMove,
+                          digraph_partition_t *part,
+                          prng_t *prng, sampler_workspace_t *ws)
+{
+  uint_t  num_owned = part->end_node - part->first_node;
+  /* this task's share of the proposals, so they add up to sampler_m */
+  uint_t  my_m = (uint_t)((uint64_t)sampler_m * part->end_node /
+                          part->num_nodes -
+                          (uint64_t)sampler_m * part->first_node /
+                          part->num_nodes);
+  uint_t  i, j, k, l;
+  bool    isDelete;
+  double *changestats = ws->changestats;
+  double *sums;
+  double  total, accepted = 0;
+
+  assert(g->num_nodes == part->num_nodes && g->num_nodes > 1);
+  /* the batch change statistics (at least 3n long) hold the sums to add
+     up over the tasks */
+  sampler_workspace_reserve_batch(ws, MAX(my_m, 3), 0);
+  sums = ws->batch_changestats;
+  /* the correction of the change statistics of the last call, see
+     replay_own_moves() */
+  for (l = 0; l < 2 * n; l++)
+    sums[l] = -ownChangeStats[l];
+
+  partition_sync(part, g);
+
+  /* draw the proposals first, so the nodes they need can be fetched
+     together: the other node of each dyad, then once its arcs are
+     here, the neighbours of both nodes. The nodes of the moves of the
+     last call are needed the same way to replay them, including the
+     other end of every move touching a present node, which may have
+     been a neighbour before a later move. */
+  for (k = 0; k < my_m; k++) {
+    i = part->first_node + prng_int_urand(prng, num_owned);
+    j = prng_int_urand(prng, g->num_nodes - 1);
+    if (j >= i)
+      j++;
+    ws->dyads[k].i = i;
+    ws->dyads[k].j = j;
+    ws->urands[k] = prng_urand_log(prng, &ws->log_urands[k]);
+    partition_need_node(part, j);
+  }
+  for (k = part->own_begin; k < part->own_end; k += 3)
+    partition_need_node(part, part->received[k+1]);
+  partition_fetch(part, g);
+  for (k = 0; k < part->num_received; k += 3) {
+    i = part->received[k];
+    j = part->received[k+1];
+    if (PARTITION_NODE_PRESENT(part, i) || PARTITION_NODE_PRESENT(part, j)) {
+      partition_need_node(part, i);
+      partition_need_node(part, j);
+    }
+  }
+  for (k = part->own_begin; k < part->own_end; k += 3) {
+    i = part->received[k];
+    j = part->received[k+1];
+    for (l = 0; l < g->outdegree[i]; l++)
+      partition_need_node(part, g->arclist[i][l]);
+    for (l = 0; l < g->indegree[i]; l++)
+      partition_need_node(part, g->revarclist[i][l]);
+    for (l = 0; l < g->outdegree[j]; l++)
+      partition_need_node(part, g->arclist[j][l]);
+    for (l = 0; l < g->indegree[j]; l++)
+      partition_need_node(part, g->revarclist[j][l]);
+  }
+  for (k = 0; k < my_m; k++) {
+    i = ws->dyads[k].i;
+    j = ws->dyads[k].j;
+    for (l = 0; l < g->outdegree[i]; l++)
+      partition_need_node(part, g->arclist[i][l]);
+    for (l = 0; l < g->indegree[i]; l++)
+      partition_need_node(part, g->revarclist[i][l]);
+    for (l = 0; l < g->outdegree[j]; l++)
+      partition_need_node(part, g->arclist[j][l]);
+    for (l = 0; l < g->indegree[j]; l++)
+      partition_need_node(part, g->revarclist[j][l]);
+  }
+  partition_fetch(part, g);
+  replay_own_moves(g, n, n_attr, n_dyadic, n_attr_interaction,
+                   change_stats_funcs, lambda_values, attr_change_stats_funcs,
+                   dyadic_change_stats_funcs,
+                   attr_interaction_change_stats_funcs, attr_indices,
+                   attr_interaction_pair_indices, theta, part, changestats,
+                   sums);
+
+  memset(ownChangeStats, 0, 2 * n * sizeof(double));
+  for (k = 0; k < my_m; k++) {
+    i = ws->dyads[k].i;
+    j = ws->dyads[k].j;
+    isDelete = isArc(g, i, j);
+    SAMPLER_DEBUG_PRINT(("%s %d -> %d\n",isDelete ? "del" : "add", i, j));
+    total = calcChangeStats(g, i, j, n, n_attr, n_dyadic,
+                            n_attr_interaction, change_stats_funcs,
+                            lambda_values,
+                            attr_change_stats_funcs,
+                            dyadic_change_stats_funcs,
+                            attr_interaction_change_stats_funcs,
+                            attr_indices, attr_interaction_pair_indices,
+                            theta, isDelete, changestats);
+    if (urand_accept(ws->urands[k], ws->log_urands[k], total)) {
+      accepted++;
+      for (l = 0; l < n; l++)
+        sums[(isDelete ? n : 0) + l] += changestats[l];
+      if (performMove) {
+        partition_toggle_arc(part, g, i, j, isDelete);
+        for (l = 0; l < n; l++)
+          ownChangeStats[(isDelete ? n : 0) + l] += changestats[l];
+      }
+    }
+  }
+
+  sums[2 * n] = accepted;
+  partition_allreduce_sum(part, sums, 2 * n + 1);
+  for (l = 0; l < n; l++) {
+    addChangeStats[l] = sums[l];
+    delChangeStats[l] = sums[n + l];
+  }
+  if (performMove)
+    partition_start_exchange(part);
+  return sums[2 * n] / sampler_m;
+}
+
+/*****************************************************************************
+ *
+ * sampler interface (see sampler.h)
+ *
+ ****************************************************************************/
+
+static double partitioned_sampler_run(sampler_t *s, digraph_t *g,
+                                      double theta[],
+                                      double addChangeStats[],
+                                      double delChangeStats[],
+                                      uint_t sampler_m, bool performMove)
+{
+  const sampler_model_t *m = s->model;
+
+  assert(s->options.partition);
+  assert(s->state);
+  return partitionedSampler(g, m->n, m->n_attr, m->n_dyadic,
+                            m->n_attr_interaction, m->change_stats_funcs,
+                            m->lambda_values, m->attr_change_stats_funcs,
+                            m->dyadic_change_stats_funcs,
+                            m->attr_interaction_change_stats_funcs,
+                            m->attr_indices,
+                            m->attr_interaction_pair_indices, theta,
+                            addChangeStats, delChangeStats,
+                            (double *)s->state, sampler_m,
+                            performMove, s->options.partition, s->prng,
+                            s->ws);
+}
+
+/* the state is the ownChangeStats of partitionedSampler(); its size
+   depends on the model, and it is not saved in checkpoints as they are
+   not used with a partitioned network, so state_size is 0 */
+static void partitioned_sampler_create(sampler_t *s)
+{
+  s->state = safe_calloc(2 * s->model->n, sizeof(double));
+}
+
+static void partitioned_sampler_destroy(sampler_t *s)
+{
+  free(s->state);
+}
+
+const sampler_ops_t partitioned_sampler_ops = {
+  "partitioned",           /* name */
+  FALSE,                   /* divisible */
+  0,                       /* state_size */
+  partitioned_sampler_create, /* create */
+  NULL,                    /* init */
+  partitioned_sampler_run, /* run */
+  NULL,                    /* arc_stats */
+  partitioned_sampler_destroy /* destroy */
+};
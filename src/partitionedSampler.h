@@ -0,0 +1,59 @@
+#ifndef PARTITIONEDSAMPLER_H
+#define PARTITIONEDSAMPLER_H
+/*****************************************************************************
+ *
+ * File:    partitionedSampler.h
+ * Author:  Alex Stivala, Maksym Byshkin
+ * Created: October 2026
+ *
+ * ERGM distribution sampler for a network partitioned between tasks
+ * (see digraphPartition.h), where all the tasks together run one chain.
+ *
+ * As in the basic sampler, each proposal is a dyad chosen uniformly at
+ * random, toggling the arc. The proposals of a sampler call are divided
+ * between the tasks in proportion to the number of nodes they own, and
+ * each task proposes dyads from its own nodes, so each arc is only
+ * toggled by the owner of its source node. Before evaluating them a
+ * task fetches the remote nodes the change statistics read (the other
+ * node of each dyad, then the neighbours of both nodes) in two batched
+ * exchanges. The change statistics sums and number of accepted moves
+ * are summed over the tasks, so every task has those of the whole
+ * chain (and so the same theta in Algorithm EE), and the accepted moves
+ * are then sent to the other tasks while Algorithm EE goes on, to be
+ * applied at the start of the next call, when the change statistics of
+ * the moves are corrected for those of the other tasks.
+ *
+ * Within a call, each task sees the moves of the others as they were at
+ * the start of it, so the chain is not exactly that of the basic
+ * sampler, in the same way as for other asynchronous samplers; with
+ * few proposals per call (compared to the number of arcs) the moves of
+ * different tasks in the same call rarely interact.
+ *
+ ****************************************************************************/
+
+#include "changeStatisticsDirected.h"
+#include "digraphPartition.h"
+#include "sampler.h"
+
+extern const sampler_ops_t partitioned_sampler_ops;
+
+double partitionedSampler(digraph_t *g, uint_t n, uint_t n_attr,
+                          uint_t n_dyadic, uint_t n_attr_interaction,
+                          change_stats_func_t *change_stats_funcs[],
+                          double lambda_values[],
+                          attr_change_stats_func_t *attr_change_stats_funcs[],
+                          dyadic_change_stats_func_t
+                                             *dyadic_change_stats_funcs[],
+                          attr_interaction_change_stats_func_t
+                                   *attr_interaction_change_stats_funcs[],
+                          uint_t attr_indices[],
+                          uint_pair_t attr_interaction_pair_indices[],
+                          double theta[],
+                          double addChangeStats[], double delChangeStats[],
+                          double ownChangeStats[],
+                          uint_t sampler_m,
+                          bool performMove,
+                          digraph_partition_t *part,
+                          prng_t *prng, sampler_workspace_t *ws);
+
+#endif /* PARTITIONEDSAMPLER_H */
@@ -0,0 +1,457 @@
+/*****************************************************************************
+ *
+ * File:    postEstimation.c
+ * Author:  Alex Stivala, Maksym Byshkin
+ * Created: October 2026
+ *
+ * Standard errors and confidence intervals of the estimates by
+ * simulation from them, in parallel chains, and optionally a
+ * parametric bootstrap (see postEstimation.h).
+ *
+ ****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <sys/time.h>
+#include "sampler.h"
+#include "changeStatisticsDirected.h"
+#include "estimSummary.h"
+#include "postEstimation.h"
+
+/*****************************************************************************
+ *
+ * local constants
+ *
+ ****************************************************************************/
+
+/* random stream of the first post-estimation chain of a task (the
+   streams below it are used by the Algorithm S and EE threads) */
+static const uint64_t POST_SIM_FIRST_STREAM = 0x80000000ULL;
+
+/* bootstrap replicate b of a task uses the random streams of task
+   number tasknum + (b + 1) * BOOTSTRAP_TASK_STEP */
+static const uint64_t BOOTSTRAP_TASK_STEP = 0x10000ULL;
+
+/* z-score for alpha = 0.05 (95% confidence interval) */
+static const double Z_SIGMA = 1.959964;
+
+/* length of shared memory slot of a chain: number of samples, then n
+   means and n*n covariances of the statistics */
+#define CHAIN_SLOT_LEN(n) (1 + (size_t)(n) + (size_t)(n) * (n))
+
+/* length of shared memory slot of a bootstrap replicate: 1 if it was
+   estimated (else 0), then n estimates */
+#define REPLICATE_SLOT_LEN(n) (1 + (size_t)(n))
+
+/*****************************************************************************
+ *
+ * local functions
+ *
+ ****************************************************************************/
+
+/*
+ * Comparison function for qsort() of doubles into ascending order.
+ *
+ * Parameters:
+ *   a, b - pointers to doubles to compare
+ *
+ * Return value:
+ *   <0, 0, >0 if a is less than, equal to, or greater than b
+ */
+static int compare_double(const void *a, const void *b)
+{
+  double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+/*
+ * Quantile of sorted values, interpolating between them as R's
+ * quantile() does by default (type 7).
+ *
+ * Parameters:
+ *   x - values in ascending order
+ *   m - number of values (at least 1)
+ *   p - probability (0 to 1)
+ *
+ * Return value:
+ *   The p quantile of x.
+ */
+static double sorted_quantile(const double x[], uint_t m, double p)
+{
+  double h = (m - 1) * p;
+  uint_t k = (uint_t)h;
+
+  if (k + 1 >= m)
+    return x[m - 1];
+  return x[k] + (h - k) * (x[k + 1] - x[k]);
+}
+
+/*
+ * Run one post-estimation chain (in a process forked from the task):
+ * sample the statistics at theta into its shared memory slot, then
+ * estimate bootstrap replicates from the queue until there are none
+ * left.
+ *
+ * Parameters:
+ *   config          - configuration settings
+ *   g               - (in/out) network to start from, changed by the chain
+ *   model           - model to simulate
+ *   options         - sampler options
+ *   theta           - parameter values to simulate at
+ *   tasknum         - task number
+ *   chain           - chain number (0 to postSimChains-1)
+ *   chain_slot      - (Out) shared memory slot of the chain
+ *                     (CHAIN_SLOT_LEN doubles)
+ *   next_replicate  - (in/out) shared counter of the next bootstrap
+ *                     replicate to estimate
+ *   replicate_slots - (Out) shared memory slots of the bootstrap
+ *                     replicates (REPLICATE_SLOT_LEN doubles each)
+ *   estimate        - function to estimate the model on a replicate
+ *   data            - passed to estimate
+ *
+ * Return value:
+ *   None.
+ */
+static void run_post_chain(const estim_config_t *config, digraph_t *g,
+                           const sampler_model_t *model,
+                           const sampler_options_t *options,
+                           const double theta[], uint_t tasknum,
+                           uint_t chain, double chain_slot[],
+                           uint64_t *next_replicate,
+                           double replicate_slots[],
+                           post_estimate_func_t *estimate, void *data)
+{
+  uint_t               n = model->n, i, j, s;
+  sampler_workspace_t *ws = allocate_sampler_workspace(n);
+  double              *theta_sim = (double *)safe_malloc(n * sizeof(double));
+  double              *dz = (double *)safe_calloc(n, sizeof(double));
+  prng_t               prng;
+  sampler_t           *sampler;
+  online_stats_t       stats;
+  uint64_t             b;
+  digraph_t           *rep_g;
+  double              *rep;
+  int                  devnull;
+
+  memcpy(theta_sim, theta, n * sizeof(double));
+  prng_init_stream(&prng, POST_SIM_FIRST_STREAM + chain);
+  sampler = allocate_sampler(get_sampler_type(FALSE, config->useTNTsampler,
+                                              config->useMTMsampler),
+                             model, options, &prng, ws);
+  sampler_init(sampler, g, 0);
+  if (config->postSimBurnin > 0)
+    (void)sampler_run(sampler, g, theta_sim, ws->addChangeStats,
+                      ws->delChangeStats, config->postSimBurnin, TRUE);
+
+  /* the statistics are relative to those after the burn-in, which does
+     not change their covariance */
+  init_online_stats(&stats, n, TRUE);
+  for (s = 0; s < config->postSimSamples; s++) {
+    (void)sampler_run(sampler, g, theta_sim, ws->addChangeStats,
+                      ws->delChangeStats, config->postSimInterval, TRUE);
+    for (i = 0; i < n; i++)
+      dz[i] += ws->addChangeStats[i] - ws->delChangeStats[i];
+    add_online_stats(&stats, dz);
+  }
+  chain_slot[0] = stats.count;
+  for (i = 0; i < n; i++) {
+    chain_slot[1 + i] = stats.mean[i];
+    for (j = 0; j < n; j++)
+      chain_slot[1 + n + i * n + j] = online_stats_covariance(&stats, i, j);
+  }
+  free_online_stats(&stats);
+
+  if (config->bootstrapReplicates > 0) {
+    /* the estimation of each replicate prints its progress as the
+       estimation of the task does, which is not wanted here */
+    fflush(stdout);
+    if ((devnull = open("/dev/null", O_WRONLY)) >= 0) {
+      dup2(devnull, STDOUT_FILENO);
+      close(devnull);
+    }
+  }
+  while ((b = __atomic_fetch_add(next_replicate, 1, __ATOMIC_RELAXED)) <
+         config->bootstrapReplicates) {
+    (void)sampler_run(sampler, g, theta_sim, ws->addChangeStats,
+                      ws->delChangeStats, config->postSimInterval, TRUE);
+    /* the estimation changes the network, so it is done on a clone,
+       leaving the network of the chain to continue from afterwards */
+    rep_g = clone_digraph(g);
+    rep = replicate_slots + b * REPLICATE_SLOT_LEN(n);
+    set_prng_task(tasknum + (b + 1) * BOOTSTRAP_TASK_STEP);
+    rep[0] = estimate(rep_g, rep + 1, data) == 0 ? 1 : 0;
+    free_digraph(rep_g);
+  }
+
+  free_sampler(sampler);
+  free_sampler_workspace(ws);
+  free(theta_sim);
+  free(dz);
+}
+
+/*****************************************************************************
+ *
+ * externally visible functions
+ *
+ ****************************************************************************/
+
+/*
+ * Compute standard errors and confidence intervals of the estimates of
+ * a task by simulating from them (and optionally a parametric
+ * bootstrap), as described in postEstimation.h, and write them to
+ * stdout and to the file postEstimationFilePrefix_N.txt if set.
+ *
+ * Parameters:
+ *   config      - configuration settings (with the attribute indices built)
+ *   g           - network at the end of Algorithm EE (not changed, the
+ *                 chains have their own copies)
+ *   num_param   - number of parameters
+ *   theta       - estimates
+ *   param_names - parameter names separated by spaces
+ *   tasknum     - task number
+ *   estimate    - function to estimate the model on a bootstrap replicate
+ *   data        - passed to estimate
+ *
+ * Return value:
+ *   0 if OK else nonzero on error (message printed to stderr).
+ */
+int post_estimation(const estim_config_t *config, digraph_t *g,
+                    uint_t num_param, const double theta[],
+                    const char *param_names, uint_t tasknum,
+                    post_estimate_func_t *estimate, void *data)
+{
+  const param_config_t *pc = &config->param_config;
+  uint_t           n = num_param, num_chains = config->postSimChains;
+  uint_t           num_reps = config->bootstrapReplicates;
+  uint_t           chain, i, j, k, num_valid = 0;
+  sampler_model_t  model;
+  sampler_options_t options;
+  size_t           shared_size;
+  uint64_t        *next_replicate;
+  double          *chain_slots, *replicate_slots, *slot, *rep;
+  double           count = 0;
+  double          *mean, *cov, *se, *values = NULL, *boot_sd = NULL;
+  double          *boot_lower = NULL, *boot_upper = NULL;
+  pid_t           *pids;
+  int              status, rc = 0;
+  bool             singular;
+  char            *names, *tok, *saveptr = NULL;
+  const char      *name;
+  char             filename[PATH_MAX+1];
+  FILE            *fp = NULL;
+  struct timeval   start_timeval, end_timeval, elapsed_timeval;
+  int              etime;
+
+  if (config->useIFDsampler) {
+    fprintf(stderr, "ERROR: postSimSamples cannot be used with "
+            "useIFDsampler\n");
+    return -1;
+  }
+  if (config->postSimInterval < 1 || num_chains < 1 ||
+      config->postSimSamples < 2) {
+    fprintf(stderr, "ERROR: post-estimation simulation requires "
+            "postSimInterval and postSimChains at least 1 and "
+            "postSimSamples at least 2\n");
+    return -1;
+  }
+
+  model.n = n;
+  model.n_attr = pc->num_attr_change_stats_funcs;
+  model.n_dyadic = pc->num_dyadic_change_stats_funcs;
+  model.n_attr_interaction = pc->num_attr_interaction_change_stats_funcs;
+  model.change_stats_funcs = pc->change_stats_funcs;
+  model.lambda_values = pc->param_lambdas;
+  model.attr_change_stats_funcs = pc->attr_change_stats_funcs;
+  model.dyadic_change_stats_funcs = pc->dyadic_change_stats_funcs;
+  model.attr_interaction_change_stats_funcs =
+    pc->attr_interaction_change_stats_funcs;
+  model.attr_indices = pc->attr_indices;
+  model.attr_interaction_pair_indices = pc->attr_interaction_pair_indices;
+  options.ifd_K = config->ifd_K;
+  options.useConditionalEstimation = config->useConditionalEstimation;
+  options.forbidReciprocity = config->forbidReciprocity;
+  options.num_threads = 1;
+  options.mtm_tries = config->mtmTries;
+  options.earlyReject = config->earlyReject;
+  options.degreeProposalWeight = config->degreeProposalWeight;
+  options.partition = NULL;
+
+  /* the chain and replicate results are written by the chains into
+     shared memory, after the replicate counter */
+  shared_size = sizeof(uint64_t) +
+    (num_chains * CHAIN_SLOT_LEN(n) + num_reps * REPLICATE_SLOT_LEN(n)) *
+    sizeof(double);
+  next_replicate = (uint64_t *)mmap(NULL, shared_size, PROT_READ | PROT_WRITE,
+                                    MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (next_replicate == MAP_FAILED) {
+    fprintf(stderr, "ERROR: could not map shared memory for post-estimation "
+            "(%s)\n", strerror(errno));
+    return -1;
+  }
+  chain_slots = (double *)(next_replicate + 1);
+  replicate_slots = chain_slots + num_chains * CHAIN_SLOT_LEN(n);
+
+  printf("task %u: post-estimation simulation: %u chains of %u samples, "
+         "interval %u, burnin %u", tasknum, num_chains,
+         config->postSimSamples, config->postSimInterval,
+         config->postSimBurnin);
+  if (num_reps > 0)
+    printf(", %u bootstrap replicates", num_reps);
+  printf("\n");
+  gettimeofday(&start_timeval, NULL);
+
+  pids = (pid_t *)safe_malloc(num_chains * sizeof(pid_t));
+  fflush(stdout);
+  fflush(stderr);
+  for (chain = 0; chain < num_chains; chain++) {
+    if ((pids[chain] = fork()) < 0) {
+      fprintf(stderr, "ERROR: could not fork post-estimation chain %u (%s)\n",
+              chain, strerror(errno));
+      rc = -1;
+      break;
+    }
+    if (pids[chain] == 0) {
+      run_post_chain(config, g, &model, &options, theta, tasknum, chain,
+                     chain_slots + chain * CHAIN_SLOT_LEN(n), next_replicate,
+                     replicate_slots, estimate, data);
+      /* not exit(), so the output buffers and exit handlers of the task
+         are left to it */
+      fflush(stdout);
+      _exit(0);
+    }
+  }
+  num_chains = chain; /* only wait for those started */
+  for (chain = 0; chain < num_chains; chain++) {
+    if (waitpid(pids[chain], &status, 0) < 0 || !WIFEXITED(status) ||
+        WEXITSTATUS(status) != 0) {
+      fprintf(stderr, "ERROR: post-estimation chain %u failed\n", chain);
+      rc = -1;
+    }
+  }
+  free(pids);
+  if (rc) {
+    munmap(next_replicate, shared_size);
+    return rc;
+  }
+
+  /* pool the means and covariances of the chains */
+  mean = (double *)safe_calloc(n, sizeof(double));
+  cov = (double *)safe_calloc((size_t)n * n, sizeof(double));
+  se = (double *)safe_malloc(n * sizeof(double));
+  for (chain = 0; chain < num_chains; chain++) {
+    slot = chain_slots + chain * CHAIN_SLOT_LEN(n);
+    count += slot[0];
+    for (i = 0; i < n; i++)
+      mean[i] += slot[0] * slot[1 + i];
+  }
+  for (i = 0; i < n; i++)
+    mean[i] /= count;
+  for (chain = 0; chain < num_chains; chain++) {
+    slot = chain_slots + chain * CHAIN_SLOT_LEN(n);
+    for (i = 0; i < n; i++)
+      for (j = 0; j < n; j++)
+        cov[i * n + j] += (slot[0] - 1) * slot[1 + n + i * n + j] +
+          slot[0] * (slot[1 + i] - mean[i]) * (slot[1 + j] - mean[j]);
+  }
+  for (i = 0; i < n; i++)
+    for (j = 0; j < n; j++)
+      cov[i * n + j] /= count - 1;
+  /* the inverse of the covariance of the statistics (Fisher
+     information) is the covariance of the estimates */
+  if ((singular = invert_matrix(cov, n) != 0))
+    fprintf(stderr, "task %u: covariance matrix of simulated statistics is "
+            "singular, no standard errors\n", tasknum);
+  for (i = 0; i < n; i++)
+    se[i] = singular || cov[i * n + i] < 0 ? NAN : sqrt(cov[i * n + i]);
+
+  if (num_reps > 0) {
+    values = (double *)safe_malloc(num_reps * sizeof(double));
+    boot_sd = (double *)safe_malloc(n * sizeof(double));
+    boot_lower = (double *)safe_malloc(n * sizeof(double));
+    boot_upper = (double *)safe_malloc(n * sizeof(double));
+    for (i = 0; i < n; i++) {
+      num_valid = 0;
+      for (k = 0; k < num_reps; k++) {
+        rep = replicate_slots + k * REPLICATE_SLOT_LEN(n);
+        if (rep[0] > 0)
+          values[num_valid++] = rep[1 + i];
+      }
+      boot_sd[i] = boot_lower[i] = boot_upper[i] = NAN;
+      if (num_valid > 1) {
+        (void)mean_and_sd(values, num_valid, &boot_sd[i]);
+        qsort(values, num_valid, sizeof(double), compare_double);
+        boot_lower[i] = sorted_quantile(values, num_valid, 0.025);
+        boot_upper[i] = sorted_quantile(values, num_valid, 0.975);
+      }
+    }
+  }
+  munmap(next_replicate, shared_size);
+
+  gettimeofday(&end_timeval, NULL);
+  timeval_subtract(&elapsed_timeval, &end_timeval, &start_timeval);
+  etime = 1000 * elapsed_timeval.tv_sec + elapsed_timeval.tv_usec/1000;
+  printf("task %u: post-estimation took %.2f s\n", tasknum,
+         (double)etime/1000);
+
+  if (config->post_estimation_file_prefix) {
+    snprintf(filename, sizeof(filename), "%s_%u.txt",
+             config->post_estimation_file_prefix,
+             config->outputFileSuffixBase + tasknum);
+    if (!(fp = fopen(filename, "w"))) {
+      fprintf(stderr, "ERROR: task %u could not open file %s for writing "
+              "(%s)\n", tasknum, filename, strerror(errno));
+      rc = -1;
+    }
+  }
+  if (fp) {
+    fprintf(fp, "# %.0f simulated samples", count);
+    if (num_reps > 0)
+      fprintf(fp, ", %u of %u bootstrap replicates estimated", num_valid,
+              num_reps);
+    fprintf(fp, "\nParameter Estimate StdErr CI.lower CI.upper%s\n",
+            num_reps > 0 ? " BootStdErr BootCI.lower BootCI.upper" : "");
+  }
+  printf("task %u: Parameter Estimate StdErr CI.lower CI.upper%s\n", tasknum,
+         num_reps > 0 ? " BootStdErr BootCI.lower BootCI.upper" : "");
+  names = safe_strdup(param_names);
+  tok = strtok_r(names, " ", &saveptr);
+  for (i = 0; i < n; i++) {
+    name = tok ? tok : "?";
+    printf("task %u: %s %g %g %g %g", tasknum, name, theta[i], se[i],
+           theta[i] - Z_SIGMA * se[i], theta[i] + Z_SIGMA * se[i]);
+    if (num_reps > 0)
+      printf(" %g %g %g", boot_sd[i], boot_lower[i], boot_upper[i]);
+    printf("\n");
+    if (fp) {
+      fprintf(fp, "%s %g %g %g %g", name, theta[i], se[i],
+              theta[i] - Z_SIGMA * se[i], theta[i] + Z_SIGMA * se[i]);
+      if (num_reps > 0)
+        fprintf(fp, " %g %g %g", boot_sd[i], boot_lower[i], boot_upper[i]);
+      fprintf(fp, "\n");
+    }
+    tok = strtok_r(NULL, " ", &saveptr);
+  }
+  free(names);
+  if (fp && fclose(fp) != 0) {
+    fprintf(stderr, "ERROR: task %u writing file %s failed\n", tasknum,
+            filename);
+    rc = -1;
+  }
+
+  free(mean);
+  free(cov);
+  free(se);
+  free(values);
+  free(boot_sd);
+  free(boot_lower);
+  free(boot_upper);
+  return rc;
+}
@@ -0,0 +1,50 @@
+#ifndef POSTESTIMATION_H
+#define POSTESTIMATION_H
+/*****************************************************************************
+ *
+ * File:    postEstimation.h
+ * Author:  Alex Stivala, Maksym Byshkin
+ * Created: October 2026
+ *
+ * Standard errors and confidence intervals of the estimates of an
+ * EstimNetDirected task computed by simulating from them once
+ * Algorithm EE is finished, rather than afterwards from the theta and
+ * dzA files by scripts/computeEstimNetDirectedCovariance.R or
+ * scripts/computeEstimNetDirectedBootstrapCI.R.
+ *
+ * postSimChains chains, each in a process forked from the task (so
+ * sharing its network copy-on-write) with its own random stream, run
+ * the sampler at the estimates from the last network of Algorithm EE.
+ * After postSimBurnin proposals each takes postSimSamples samples of
+ * the statistics, postSimInterval proposals apart. The covariance
+ * matrix of the statistics over the samples of all the chains is an
+ * estimate of the Fisher information, so the standard errors are the
+ * square roots of the diagonal of its inverse, and the 95% confidence
+ * intervals are the estimates +/- 1.96 standard errors.
+ *
+ * With bootstrapReplicates nonzero, the chains then do a parametric
+ * bootstrap. The replicates are a work queue (a counter in shared
+ * memory) from which each chain takes the next when it is free. For a
+ * replicate the chain runs postSimInterval more proposals to get a
+ * network from the estimated model and estimates the model on a clone
+ * of it (clone_digraph()), so the chain goes on from the network as it
+ * was before the estimation. The bootstrap
+ * standard error is the standard deviation of the replicate estimates
+ * and the confidence interval their 2.5th and 97.5th percentiles.
+ *
+ ****************************************************************************/
+
+#include "utils.h"
+#include "digraph.h"
+#include "estimconfigparser.h"
+
+/* Estimate the model on the network g (a bootstrap replicate), setting
+   theta to the estimates. Returns nonzero if they cannot be used. */
+typedef int post_estimate_func_t(digraph_t *g, double theta[], void *data);
+
+int post_estimation(const estim_config_t *config, digraph_t *g,
+                    uint_t num_param, const double theta[],
+                    const char *param_names, uint_t tasknum,
+                    post_estimate_func_t *estimate, void *data);
+
+#endif /* POSTESTIMATION_H */
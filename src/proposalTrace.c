@@ -0,0 +1,289 @@
+/*****************************************************************************
+ *
+ * File:    proposalTrace.c
+ * Author:  Alex Stivala
+ * Created: October 2026
+ *
+ * Trace of the proposals of a sampler run, written by the samplers and
+ * replayed by bench_sampler (see proposalTrace.h).
+ *
+ ****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "proposalTrace.h"
+
+/*****************************************************************************
+ *
+ * Local constants
+ *
+ ****************************************************************************/
+
+static const char *PROPOSAL_TRACE_MAGIC = "EstimNetDirected proposalTrace 1";
+
+#define FNV_OFFSET_BASIS 0xcbf29ce484222325ULL
+#define FNV_PRIME        0x100000001b3ULL
+
+/*****************************************************************************
+ *
+ * Local functions
+ *
+ ****************************************************************************/
+
+/*
+ * Read a "key value" header line of a trace file.
+ *
+ * Parameters:
+ *   fp    - trace file
+ *   key   - the key the line must have
+ *   value - (out) the value
+ *
+ * Return value:
+ *   0 if OK else -1 if the line is not there.
+ */
+static int read_header_value(FILE *fp, const char *key,
+                             unsigned long long *value)
+{
+  char   line[256];
+  size_t len = strlen(key);
+  char  *endptr;
+
+  if (!fgets(line, sizeof(line), fp) || strncmp(line, key, len) != 0 ||
+      line[len] != ' ')
+    return -1;
+  *value = strtoull(line + len + 1, &endptr, 10);
+  return endptr == line + len + 1 || (*endptr != '\n' && *endptr != '\0') ?
+    -1 : 0;
+}
+
+/*****************************************************************************
+ *
+ * External functions
+ *
+ ****************************************************************************/
+
+/*
+ * Hash of the bit patterns of the change statistics of a proposal
+ * (FNV-1a over their bytes), so that they can be checked to agree
+ * exactly without storing them all.
+ *
+ * Parameters:
+ *   n           - number of change statistics
+ *   changestats - the n change statistics
+ *
+ * Return value:
+ *   64 bit hash.
+ */
+uint64_t change_stats_hash(uint_t n, const double changestats[])
+{
+  const unsigned char *p = (const unsigned char *)changestats;
+  uint64_t             h = FNV_OFFSET_BASIS;
+  size_t               k;
+
+  for (k = 0; k < (size_t)n * sizeof(double); k++) {
+    h ^= p[k];
+    h *= FNV_PRIME;
+  }
+  return h;
+}
+
+/*
+ * Create a trace file and write its header and the initial arcs of the
+ * digraph.
+ *
+ * Parameters:
+ *   filename - name of the trace file to write
+ *   g        - digraph in its initial state
+ *   n        - number of change statistics
+ *   inner    - if True the run is conditional, and the initial arcs are
+ *              the inner arcs (allinnerarcs), else all arcs (allarcs)
+ *
+ * Return value:
+ *   Trace to pass to trace_proposal(), or NULL on error (message printed
+ *   to stderr).
+ */
+proposal_trace_t *open_proposal_trace(const char *filename,
+                                      const digraph_t *g, uint_t n,
+                                      bool inner)
+{
+  proposal_trace_t *trace;
+  const nodepair_t *arcs = inner ? g->allinnerarcs : g->allarcs;
+  arcidx_t          num_arcs = inner ? g->num_inner_arcs : g->num_arcs;
+  arcidx_t          k;
+  uint32_t          pair[2];
+
+  trace = (proposal_trace_t *)safe_calloc(1, sizeof(proposal_trace_t));
+  strncpy(trace->filename, filename, sizeof(trace->filename) - 1);
+  if (!(trace->fp = fopen(filename, "w"))) {
+    fprintf(stderr, "ERROR: could not open proposal trace file %s for "
+            "writing (%s)\n", filename, strerror(errno));
+    free(trace);
+    return NULL;
+  }
+  trace->num_nodes = g->num_nodes;
+  trace->n = n;
+  trace->inner = inner;
+  fprintf(trace->fp, "%s\nnodes %u\nparams %u\ninner %d\narcs %lu\ndata\n",
+          PROPOSAL_TRACE_MAGIC, g->num_nodes, n, inner ? 1 : 0,
+          (unsigned long)num_arcs);
+  for (k = 0; k < num_arcs; k++) {
+    pair[0] = (uint32_t)arcs[k].i;
+    pair[1] = (uint32_t)arcs[k].j;
+    fwrite(pair, sizeof(pair), 1, trace->fp);
+  }
+  if (ferror(trace->fp))
+    trace->error = TRUE;
+  return trace;
+}
+
+/*
+ * Write the record of one proposal to a trace file.
+ *
+ * Parameters:
+ *   trace       - trace from open_proposal_trace()
+ *   i           - node the arc is from
+ *   j           - node the arc is to
+ *   flags       - PROPOSAL_TRACE_ flags of the proposal (other than
+ *                 PROPOSAL_TRACE_PARTIAL)
+ *   prng        - pseudorandom number stream of the sampler
+ *   changestats - the change statistics of the proposal, or NULL if it
+ *                 was rejected before they were all computed
+ *
+ * Return value:
+ *   None. A write error is reported by close_proposal_trace().
+ */
+void trace_proposal(proposal_trace_t *trace, uint_t i, uint_t j,
+                    uint32_t flags, const prng_t *prng,
+                    const double changestats[])
+{
+  proposal_trace_record_t r;
+
+  r.prng_ctr = prng->ctr[0];
+  r.i = (uint32_t)i;
+  r.j = (uint32_t)j;
+  r.unused = 0;
+  if (changestats) {
+    r.flags = flags;
+    r.stats_hash = change_stats_hash(trace->n, changestats);
+  } else {
+    r.flags = flags | PROPOSAL_TRACE_PARTIAL;
+    r.stats_hash = 0;
+  }
+  if (fwrite(&r, sizeof(r), 1, trace->fp) != 1)
+    trace->error = TRUE;
+  trace->num_records++;
+}
+
+/*
+ * Open a trace file to replay it: read its header and initial arcs.
+ *
+ * Parameters:
+ *   filename - name of the trace file
+ *   arcs     - (out) the initial arcs, to be freed by caller
+ *   num_arcs - (out) number of initial arcs
+ *
+ * Return value:
+ *   Trace to pass to read_proposal_trace(), or NULL on error (message
+ *   printed to stderr).
+ */
+proposal_trace_t *open_proposal_trace_replay(const char *filename,
+                                             nodepair_t **arcs,
+                                             arcidx_t *num_arcs)
+{
+  proposal_trace_t   *trace;
+  char                line[256];
+  unsigned long long  num_nodes, n, inner, num;
+  arcidx_t            k;
+  uint32_t            pair[2];
+
+  trace = (proposal_trace_t *)safe_calloc(1, sizeof(proposal_trace_t));
+  strncpy(trace->filename, filename, sizeof(trace->filename) - 1);
+  if (!(trace->fp = fopen(filename, "r"))) {
+    fprintf(stderr, "ERROR: could not open proposal trace file %s (%s)\n",
+            filename, strerror(errno));
+    free(trace);
+    return NULL;
+  }
+  if (!fgets(line, sizeof(line), trace->fp) ||
+      strncmp(line, PROPOSAL_TRACE_MAGIC, strlen(PROPOSAL_TRACE_MAGIC)) != 0 ||
+      read_header_value(trace->fp, "nodes", &num_nodes) ||
+      read_header_value(trace->fp, "params", &n) ||
+      read_header_value(trace->fp, "inner", &inner) ||
+      read_header_value(trace->fp, "arcs", &num) ||
+      !fgets(line, sizeof(line), trace->fp) || strcmp(line, "data\n") != 0 ||
+      num_nodes > MAX_NUM_NODES || num > MAX_NUM_ARCS) {
+    fprintf(stderr, "ERROR: %s is not a valid proposal trace file\n",
+            filename);
+    fclose(trace->fp);
+    free(trace);
+    return NULL;
+  }
+  trace->num_nodes = (uint_t)num_nodes;
+  trace->n = (uint_t)n;
+  trace->inner = inner != 0;
+  *num_arcs = (arcidx_t)num;
+  *arcs = (nodepair_t *)safe_malloc((*num_arcs + 1) * sizeof(nodepair_t));
+  for (k = 0; k < *num_arcs; k++) {
+    if (fread(pair, sizeof(pair), 1, trace->fp) != 1 ||
+        pair[0] >= num_nodes || pair[1] >= num_nodes) {
+      fprintf(stderr, "ERROR: initial arcs in proposal trace file %s are "
+              "invalid\n", filename);
+      free(*arcs);
+      *arcs = NULL;
+      fclose(trace->fp);
+      free(trace);
+      return NULL;
+    }
+    (*arcs)[k].i = pair[0];
+    (*arcs)[k].j = pair[1];
+  }
+  return trace;
+}
+
+/*
+ * Read the next records of a trace file opened by
+ * open_proposal_trace_replay().
+ *
+ * Parameters:
+ *   trace   - trace
+ *   records - (out) records read
+ *   max     - maximum number of records to read
+ *
+ * Return value:
+ *   Number of records read, 0 at the end of the file.
+ */
+uint_t read_proposal_trace(proposal_trace_t *trace,
+                           proposal_trace_record_t records[], uint_t max)
+{
+  size_t num = fread(records, sizeof(proposal_trace_record_t), max,
+                     trace->fp);
+
+  trace->num_records += num;
+  return (uint_t)num;
+}
+
+/*
+ * Close a trace file and free the trace.
+ *
+ * Parameters:
+ *   trace - trace from open_proposal_trace() or
+ *           open_proposal_trace_replay()
+ *
+ * Return value:
+ *   0 if OK else -1 if writing the trace file failed (message printed to
+ *   stderr).
+ */
+int close_proposal_trace(proposal_trace_t *trace)
+{
+  int rc = 0;
+
+  if (fclose(trace->fp) != 0 || trace->error) {
+    fprintf(stderr, "ERROR: writing proposal trace file %s failed\n",
+            trace->filename);
+    rc = -1;
+  }
+  free(trace);
+  return rc;
+}
@@ -0,0 +1,83 @@
+#ifndef PROPOSALTRACE_H
+#define PROPOSALTRACE_H
+/*****************************************************************************
+ *
+ * File:    proposalTrace.h
+ * Author:  Alex Stivala
+ * Created: October 2026
+ *
+ * Trace of the proposals of a sampler run (proposalTraceFile in
+ * SimulateERGM), to be replayed by bench_sampler -r: the change
+ * statistics of exactly the same sequence of dyads, on exactly the same
+ * sequence of networks, can then be computed with each two-path lookup
+ * method (or a changed change statistics function) and timed, and
+ * checked to agree bit for bit with those of the run traced, without
+ * the rest of the sampler (random numbers, acceptance) in the timing.
+ *
+ * The file has text header lines:
+ *
+ *   EstimNetDirected proposalTrace 1
+ *   nodes N        number of nodes
+ *   params n       number of change statistics
+ *   inner 0|1      1 if the arcs are the inner arcs (allinnerarcs) of
+ *                  a conditional (snowball sample) run
+ *   arcs A         number of initial arcs
+ *   data
+ *
+ * then the A initial arcs, in the order of the flat arc list, as pairs
+ * of 32 bit node numbers (numbered from 0, as in the digraph, not the
+ * input files), then one proposal_trace_record_t for each proposal, all
+ * in native byte order.
+ *
+ ****************************************************************************/
+
+#include <stdio.h>
+#include <limits.h>
+#include "utils.h"
+#include "digraph.h"
+
+/* flags of a proposal */
+#define PROPOSAL_TRACE_DELETE   0x01 /* delete move (else add) */
+#define PROPOSAL_TRACE_ACCEPTED 0x02 /* move accepted */
+#define PROPOSAL_TRACE_MOVED    0x04 /* move accepted and made */
+#define PROPOSAL_TRACE_PARTIAL  0x08 /* rejected early (earlyReject) before
+                                        all the statistics were computed,
+                                        so stats_hash is not set */
+#define PROPOSAL_TRACE_JOURNAL  0x10 /* move made by journal_toggle_arc()
+                                        (MTM sampler) rather than by
+                                        insertArc_allarcs() etc. */
+
+typedef struct proposal_trace_record_s {
+  uint64_t prng_ctr;   /* counter of the pseudorandom number stream when
+                          the move was decided */
+  uint64_t stats_hash; /* change_stats_hash() of the change statistics */
+  uint32_t i, j;       /* the dyad i->j */
+  uint32_t flags;      /* PROPOSAL_TRACE_ flags */
+  uint32_t unused;     /* 0 */
+} proposal_trace_record_t;
+
+typedef struct proposal_trace_s {
+  FILE        *fp;                   /* the trace file */
+  char         filename[PATH_MAX+1]; /* name of the trace file */
+  uint_t       num_nodes;            /* number of nodes */
+  uint_t       n;                    /* number of change statistics */
+  bool         inner;                /* arcs are inner arcs */
+  ulonglong_t  num_records;          /* records written or read */
+  bool         error;                /* a write failed */
+} proposal_trace_t;
+
+uint64_t change_stats_hash(uint_t n, const double changestats[]);
+proposal_trace_t *open_proposal_trace(const char *filename,
+                                      const digraph_t *g, uint_t n,
+                                      bool inner);
+void trace_proposal(proposal_trace_t *trace, uint_t i, uint_t j,
+                    uint32_t flags, const prng_t *prng,
+                    const double changestats[]);
+proposal_trace_t *open_proposal_trace_replay(const char *filename,
+                                             nodepair_t **arcs,
+                                             arcidx_t *num_arcs);
+uint_t read_proposal_trace(proposal_trace_t *trace,
+                           proposal_trace_record_t records[], uint_t max);
+int close_proposal_trace(proposal_trace_t *trace);
+
+#endif /* PROPOSALTRACE_H */
@@ -0,0 +1,491 @@
+/*****************************************************************************
+ *
+ * File:    runMetrics.c
+ * Author:  Alex Stivala, Maksym Byshkin
+ * Created: October 2026
+ *
+ * Timing and other metrics of an estimation task or simulation
+ * (see runMetrics.h).
+ *
+ ****************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include "runMetrics.h"
+#include "changeStatisticsDirected.h"
+
+/*****************************************************************************
+ *
+ * local functions
+ *
+ ****************************************************************************/
+
+/*
+ * Elapsed time in seconds from start to now.
+ */
+static double seconds_since(struct timeval start)
+{
+  struct timeval now, elapsed;
+
+  gettimeofday(&now, NULL);
+  timeval_subtract(&elapsed, &now, &start);
+  return elapsed.tv_sec + elapsed.tv_usec / 1e6;
+}
+
+/*
+ * Name of the two-path lookup method used by g.
+ */
+static const char *twopath_method_name(const digraph_t *g)
+{
+#ifdef TWOPATH_ADAPTIVE
+  return twopath_backend_name(g->twopath_backend);
+#else
+  (void)g;
+#if defined(TWOPATH_LOOKUP) && defined(TWOPATH_HASHTABLES)
+  return "hash tables";
+#elif defined(TWOPATH_LOOKUP)
+  return "arrays";
+#else
+  return "none (counted on the fly)";
+#endif /* TWOPATH_LOOKUP */
+#endif /* TWOPATH_ADAPTIVE */
+}
+
+/*
+ * Current resident set size in kilobytes (from /proc/self/statm on
+ * Linux), or the peak if it cannot be read.
+ */
+static long current_rss_kb(void)
+{
+  FILE         *fp;
+  long          pages_total, pages_resident;
+  struct rusage usage;
+
+  if ((fp = fopen("/proc/self/statm", "r"))) {
+    if (fscanf(fp, "%ld %ld", &pages_total, &pages_resident) == 2) {
+      fclose(fp);
+      return pages_resident * (sysconf(_SC_PAGESIZE) / 1024);
+    }
+    fclose(fp);
+  }
+  getrusage(RUSAGE_SELF, &usage);
+  return (long)usage.ru_maxrss;
+}
+
+/*
+ * Write a number as a JSON value (null if it is not finite).
+ */
+static void write_json_number(FILE *fp, double x)
+{
+  if (isfinite(x))
+    fprintf(fp, "%.10g", x);
+  else
+    fprintf(fp, "null");
+}
+
+/*
+ * Write the heartbeat file, to a temporary file that is then renamed
+ * over it, so a reader never sees a partly written file.
+ *
+ * Parameters: as update_heartbeat(), with theta and dzA NULL for none
+ *
+ * Return value:
+ *   None (on error a message is printed to stderr and the run carries
+ *   on without the heartbeat being updated).
+ */
+static void write_heartbeat(heartbeat_t *hb, uint_t outer, uint_t inner,
+                            ulonglong_t step, double proposals,
+                            double accepted, const double theta[],
+                            const double dzA[])
+{
+  char           tmp_filename[PATH_MAX+8];
+  char          *names, *name, *saveptr = NULL;
+  FILE          *fp;
+  struct timeval now, elapsed;
+  double         phase_seconds, interval_seconds, steps_per_second;
+  double         interval_proposals, max_abs_dzA = 0;
+  struct rusage  usage;
+  long           rss_kb;
+  uint_t         l;
+  int            err;
+
+  gettimeofday(&now, NULL);
+  timeval_subtract(&elapsed, &now, &hb->phase_start);
+  phase_seconds = elapsed.tv_sec + elapsed.tv_usec / 1e6;
+  timeval_subtract(&elapsed, &now, &hb->last);
+  interval_seconds = elapsed.tv_sec + elapsed.tv_usec / 1e6;
+  interval_proposals = proposals - hb->last_proposals;
+
+  snprintf(tmp_filename, sizeof(tmp_filename), "%s.tmp", hb->filename);
+  if (!(fp = fopen(tmp_filename, "w"))) {
+    fprintf(stderr, "ERROR: could not open heartbeat file %s for writing "
+            "(%s)\n", tmp_filename, strerror(errno));
+    return;
+  }
+  getrusage(RUSAGE_SELF, &usage);
+  fprintf(fp, "{\n");
+  fprintf(fp, "  \"task\": %u,\n", hb->tasknum);
+  fprintf(fp, "  \"time\": %ld,\n", (long)now.tv_sec);
+  fprintf(fp, "  \"phase\": \"%s\",\n", hb->phase);
+  fprintf(fp, "  \"outer_step\": %u,\n", outer);
+  fprintf(fp, "  \"inner_step\": %u,\n", inner);
+  fprintf(fp, "  \"step\": %llu,\n", step);
+  fprintf(fp, "  \"total_steps\": %llu,\n", hb->total_steps);
+  fprintf(fp, "  \"phase_seconds\": %.3f,\n", phase_seconds);
+  fprintf(fp, "  \"proposals_per_second\": ");
+  write_json_number(fp, interval_seconds > 0 ?
+                    interval_proposals / interval_seconds : 0);
+  fprintf(fp, ",\n  \"acceptance_rate\": ");
+  write_json_number(fp, interval_proposals > 0 ?
+                    (accepted - hb->last_accepted) / interval_proposals : 0);
+  fprintf(fp, ",\n");
+  /* ETA from the mean rate of steps since the start of the phase */
+  steps_per_second = phase_seconds > 0 ?
+    (step - hb->first_step) / phase_seconds : 0;
+  if (steps_per_second > 0 && hb->total_steps >= step) {
+    fprintf(fp, "  \"eta_seconds\": %.0f,\n",
+            (hb->total_steps - step) / steps_per_second);
+  }
+  rss_kb = current_rss_kb();
+  fprintf(fp, "  \"rss_kb\": %ld,\n", rss_kb);
+  /* ru_maxrss is in kilobytes on Linux (and counted slightly differently
+     from /proc/self/statm, so may be less than the current value) */
+  fprintf(fp, "  \"peak_rss_kb\": %ld", MAX((long)usage.ru_maxrss, rss_kb));
+  if (dzA) {
+    for (l = 0; l < hb->n; l++)
+      max_abs_dzA = MAX(max_abs_dzA, fabs(dzA[l]));
+    fprintf(fp, ",\n  \"max_abs_dzA\": ");
+    write_json_number(fp, max_abs_dzA);
+  }
+  if (theta) {
+    fprintf(fp, ",\n  \"theta\": {");
+    names = safe_strdup(hb->param_names ? hb->param_names : "");
+    name = strtok_r(names, " ", &saveptr);
+    for (l = 0; l < hb->n; l++) {
+      if (name)
+        fprintf(fp, "%s\"%s\": ", l > 0 ? ", " : "", name);
+      else
+        fprintf(fp, "%s\"theta%u\": ", l > 0 ? ", " : "", l);
+      write_json_number(fp, theta[l]);
+      if (name)
+        name = strtok_r(NULL, " ", &saveptr);
+    }
+    fprintf(fp, "}");
+    free(names);
+  }
+  fprintf(fp, "\n}\n");
+  err = ferror(fp);
+  err |= fclose(fp) != 0;
+  if (err) {
+    fprintf(stderr, "ERROR: writing heartbeat file %s failed\n",
+            tmp_filename);
+    remove(tmp_filename);
+    return;
+  }
+  if (rename(tmp_filename, hb->filename)) {
+    fprintf(stderr, "ERROR: could not rename %s to %s (%s)\n",
+            tmp_filename, hb->filename, strerror(errno));
+    return;
+  }
+  hb->last = now;
+  hb->last_proposals = proposals;
+  hb->last_accepted = accepted;
+}
+
+/*****************************************************************************
+ *
+ * externally visible functions
+ *
+ ****************************************************************************/
+
+/*
+ * Start collecting the metrics of a run, and its first phase.
+ *
+ * Parameters:
+ *   metrics - (Out) metrics of the run, or NULL
+ *
+ * Return value:
+ *   None.
+ */
+void init_run_metrics(run_metrics_t *metrics)
+{
+  if (!metrics)
+    return;
+  memset(metrics, 0, sizeof(*metrics));
+  gettimeofday(&metrics->start, NULL);
+  metrics->phase_start = metrics->start;
+}
+
+/*
+ * Measure the memory of a digraph at the end of each phase of a run
+ * (and at the end of the run in write_run_metrics()).
+ *
+ * Parameters:
+ *   metrics - (in/out) metrics of the run, or NULL
+ *   g       - digraph of the run
+ *
+ * Return value:
+ *   None.
+ */
+void set_run_metrics_digraph(run_metrics_t *metrics, const digraph_t *g)
+{
+  if (metrics)
+    metrics->g = g;
+}
+
+/*
+ * Start timing a phase (from now rather than from the end of the
+ * previous one, so time between them is not part of either).
+ *
+ * Parameters:
+ *   metrics - (in/out) metrics of the run, or NULL
+ *
+ * Return value:
+ *   None.
+ */
+void start_run_phase(run_metrics_t *metrics)
+{
+  if (metrics)
+    gettimeofday(&metrics->phase_start, NULL);
+}
+
+/*
+ * Record the phase that has been running since the last phase ended
+ * (or started with start_run_phase()), and start the next one.
+ *
+ * Parameters:
+ *   metrics   - (in/out) metrics of the run, or NULL
+ *   name      - name of the phase (static string)
+ *   proposals - number of sampler proposals in the phase, or 0
+ *   accepted  - number of those proposals that were accepted
+ *
+ * Return value:
+ *   None.
+ */
+void end_run_phase(run_metrics_t *metrics, const char *name,
+                   double proposals, double accepted)
+{
+  run_phase_t     *phase;
+  digraph_memory_t mem;
+
+  if (!metrics || metrics->num_phases == MAX_RUN_PHASES)
+    return;
+  phase = &metrics->phases[metrics->num_phases++];
+  phase->name = name;
+  phase->seconds = seconds_since(metrics->phase_start);
+  phase->proposals = proposals;
+  phase->accepted = accepted;
+  if (metrics->g) {
+    digraph_memory_usage(metrics->g, &mem);
+    phase->memory_bytes = (double)mem.total;
+    metrics->peak_memory_bytes = MAX(metrics->peak_memory_bytes,
+                                     phase->memory_bytes);
+  }
+  gettimeofday(&metrics->phase_start, NULL);
+}
+
+/*
+ * Write the metrics of a run as a JSON object, with the total elapsed
+ * time until now.
+ *
+ * Parameters:
+ *   filename - name of file to write
+ *   metrics  - metrics of the run, or NULL (nothing written)
+ *   program  - name of the program
+ *   tasknum  - task number (MPI rank)
+ *   g        - the digraph of the run
+ *
+ * Return value:
+ *   0 if OK else nonzero on error (message printed to stderr).
+ */
+int write_run_metrics(const char *filename, const run_metrics_t *metrics,
+                      const char *program, uint_t tasknum,
+                      const digraph_t *g)
+{
+  FILE         *fp;
+  struct rusage usage;
+  double        twopath_bytes, twopath_entries;
+  digraph_memory_t mem;
+  const run_phase_t *phase;
+  uint_t        i;
+  int           err;
+
+  if (!metrics)
+    return 0;
+  if (!(fp = fopen(filename, "w"))) {
+    fprintf(stderr, "ERROR: could not open file %s for writing (%s)\n",
+            filename, strerror(errno));
+    return -1;
+  }
+  getrusage(RUSAGE_SELF, &usage);
+  twopath_table_size(g, &twopath_bytes, &twopath_entries);
+  digraph_memory_usage(g, &mem);
+  fprintf(fp, "{\n");
+  fprintf(fp, "  \"program\": \"%s\",\n", program);
+  fprintf(fp, "  \"task\": %u,\n", tasknum);
+  fprintf(fp, "  \"elapsed_seconds\": %.6f,\n",
+          seconds_since(metrics->start));
+  /* ru_maxrss is in kilobytes on Linux */
+  fprintf(fp, "  \"peak_rss_kb\": %ld,\n", (long)usage.ru_maxrss);
+  fprintf(fp, "  \"num_nodes\": %u,\n", g->num_nodes);
+  fprintf(fp, "  \"num_arcs\": %lu,\n", (unsigned long)g->num_arcs);
+  fprintf(fp, "  \"twopath_lookup\": \"%s\",\n", twopath_method_name(g));
+  fprintf(fp, "  \"changestats_isa\": \"%s\",\n", changestats_isa_name());
+  fprintf(fp, "  \"twopath_table_bytes\": %.0f,\n", twopath_bytes);
+  fprintf(fp, "  \"twopath_table_entries\": %.0f,\n", twopath_entries);
+  fprintf(fp, "  \"digraph_memory\": {\"total\": %lu, \"adjacency\": %lu, "
+          "\"hub_sets\": %lu, \"arc_bitmatrix\": %lu, \"dyad_cache\": %lu, "
+          "\"arc_lists\": %lu, \"attributes\": %lu, "
+          "\"shared_attributes\": %lu, "
+          "\"nodes\": %lu, \"twopath_mix\": %lu, \"twopath_in\": %lu, "
+          "\"twopath_out\": %lu, \"twopath_free\": %lu, "
+          "\"twopath_hubs\": %lu},\n",
+          (unsigned long)mem.total, (unsigned long)mem.adjacency,
+          (unsigned long)mem.hub_sets, (unsigned long)mem.arc_bitmatrix,
+          (unsigned long)mem.dyad_cache, (unsigned long)mem.arc_lists,
+          (unsigned long)mem.attributes,
+          (unsigned long)mem.shared_attributes, (unsigned long)mem.nodes,
+          (unsigned long)mem.twopath_mix, (unsigned long)mem.twopath_in,
+          (unsigned long)mem.twopath_out, (unsigned long)mem.twopath_free,
+          (unsigned long)mem.twopath_hubs);
+  fprintf(fp, "  \"peak_digraph_memory_bytes\": %.0f,\n",
+          MAX(metrics->peak_memory_bytes, (double)mem.total));
+  if (metrics->stop_reason)
+    fprintf(fp, "  \"stop_reason\": \"%s\",\n", metrics->stop_reason);
+  fprintf(fp, "  \"phases\": [");
+  for (i = 0; i < metrics->num_phases; i++) {
+    phase = &metrics->phases[i];
+    fprintf(fp, "%s\n    {\"name\": \"%s\", \"seconds\": %.6f",
+            i > 0 ? "," : "", phase->name, phase->seconds);
+    if (phase->memory_bytes > 0)
+      fprintf(fp, ", \"digraph_memory_bytes\": %.0f", phase->memory_bytes);
+    if (phase->proposals > 0) {
+      fprintf(fp, ", \"proposals\": %.0f, \"accepted\": %.0f, "
+              "\"acceptance_rate\": %g", phase->proposals, phase->accepted,
+              phase->accepted / phase->proposals);
+      if (phase->seconds > 0)
+        fprintf(fp, ", \"proposals_per_second\": %.1f",
+                phase->proposals / phase->seconds);
+    }
+    fprintf(fp, "}");
+  }
+  fprintf(fp, "%s]\n", metrics->num_phases > 0 ? "\n  " : "");
+  fprintf(fp, "}\n");
+  err = ferror(fp);
+  err |= fclose(fp) != 0;
+  if (err)
+    fprintf(stderr, "ERROR: writing file %s failed\n", filename);
+  return err;
+}
+
+/*
+ * Start writing a heartbeat file.
+ *
+ * Parameters:
+ *   hb          - (out) heartbeat, or NULL
+ *   filename    - name of the heartbeat file
+ *   tasknum     - task number (MPI rank)
+ *   interval    - minimum seconds between rewrites of the file
+ *   n           - number of parameters
+ *   param_names - names of the n parameters separated by spaces (not
+ *                 copied, so must remain valid), or NULL
+ *
+ * Return value:
+ *   None.
+ */
+void init_heartbeat(heartbeat_t *hb, const char *filename, uint_t tasknum,
+                    double interval, uint_t n, const char *param_names)
+{
+  if (!hb)
+    return;
+  memset(hb, 0, sizeof(*hb));
+  snprintf(hb->filename, sizeof(hb->filename), "%s", filename);
+  hb->tasknum = tasknum;
+  hb->interval = interval;
+  hb->n = n;
+  hb->param_names = param_names;
+  hb->phase = "starting";
+  gettimeofday(&hb->phase_start, NULL);
+  hb->last = hb->phase_start;
+}
+
+/*
+ * Start a phase of the run (and write the heartbeat file).
+ *
+ * Parameters:
+ *   hb          - (in/out) heartbeat, or NULL
+ *   phase       - name of the phase (static string)
+ *   first_step  - step the phase starts at (nonzero on restart)
+ *   total_steps - number of steps in the phase (for the ETA)
+ *
+ * Return value:
+ *   None.
+ */
+void start_heartbeat_phase(heartbeat_t *hb, const char *phase,
+                           ulonglong_t first_step, ulonglong_t total_steps)
+{
+  if (!hb)
+    return;
+  hb->phase = phase;
+  hb->first_step = first_step;
+  hb->total_steps = total_steps;
+  gettimeofday(&hb->phase_start, NULL);
+  hb->last = hb->phase_start;
+  hb->last_proposals = hb->last_accepted = 0;
+  write_heartbeat(hb, 0, 0, first_step, 0, 0, NULL, NULL);
+}
+
+/*
+ * Note the progress of the current phase, and rewrite the heartbeat
+ * file if it is at least the interval since it was last written.
+ *
+ * Parameters:
+ *   hb        - (in/out) heartbeat, or NULL
+ *   outer     - outer iteration
+ *   inner     - inner iteration
+ *   step      - steps done in the phase
+ *   proposals - sampler proposals in the phase so far
+ *   accepted  - accepted sampler proposals in the phase so far
+ *   theta     - current parameter values (n of them)
+ *   dzA       - current dzA values (n of them)
+ *
+ * Return value:
+ *   None.
+ */
+void update_heartbeat(heartbeat_t *hb, uint_t outer, uint_t inner,
+                      ulonglong_t step, double proposals, double accepted,
+                      const double theta[], const double dzA[])
+{
+  struct timeval now, elapsed;
+
+  if (!hb)
+    return;
+  gettimeofday(&now, NULL);
+  timeval_subtract(&elapsed, &now, &hb->last);
+  if (elapsed.tv_sec + elapsed.tv_usec / 1e6 >= hb->interval)
+    write_heartbeat(hb, outer, inner, step, proposals, accepted, theta, dzA);
+}
+
+/*
+ * Write the heartbeat file for the end of the run.
+ *
+ * Parameters:
+ *   hb - (in/out) heartbeat, or NULL
+ *
+ * Return value:
+ *   None.
+ */
+void finish_heartbeat(heartbeat_t *hb)
+{
+  if (!hb)
+    return;
+  hb->phase = "finished";
+  hb->first_step = hb->total_steps = 0;
+  hb->last_proposals = hb->last_accepted = 0;
+  write_heartbeat(hb, 0, 0, 0, 0, 0, NULL, NULL);
+}
@@ -0,0 +1,96 @@
+#ifndef RUNMETRICS_H
+#define RUNMETRICS_H
+/*****************************************************************************
+ *
+ * File:    runMetrics.h
+ * Author:  Alex Stivala, Maksym Byshkin
+ * Created: October 2026
+ *
+ * Timing and other metrics of an estimation task or simulation, written
+ * as a JSON object so that runs with different configurations or
+ * two-path backends can be compared without scraping the text output.
+ *
+ * A run is divided into phases (e.g. loading the network, Algorithm S,
+ * Algorithm EE), each with its elapsed (wall clock) time and, for
+ * phases that run a sampler, the number of proposals and how many
+ * were accepted. The file also has the total elapsed time, the size of
+ * the network and two-path tables, and the peak resident set size.
+ * If the digraph is given with set_run_metrics_digraph(), its memory
+ * (digraph_memory_usage()) is also measured at the end of each phase,
+ * and the file has its breakdown at the end and the peak over phases
+ * (the digraph structures do not shrink, so the memory at the end of a
+ * phase is its peak during the phase, apart from hub sets).
+ *
+ * A heartbeat file can also be written during a long run, rewritten
+ * (atomically, by renaming a new file over it) at most every interval
+ * seconds, with the current phase and step, the proposals per second
+ * and acceptance rate since the last write, the current theta and
+ * largest |dzA|, the resident set size and an estimate of the time
+ * remaining in the phase, so that job monitoring can detect stalled or
+ * slow chains without waiting for the run to finish.
+ *
+ * The functions all do nothing if the metrics (or heartbeat) pointer is
+ * NULL, so callers need not test whether metrics are being collected.
+ *
+ ****************************************************************************/
+
+#include <limits.h>
+#include <sys/time.h>
+#include "utils.h"
+#include "digraph.h"
+
+#define MAX_RUN_PHASES 8 /* maximum number of phases of a run */
+
+typedef struct run_phase_s {
+  const char *name;        /* name of the phase (static string) */
+  double      seconds;     /* elapsed time */
+  double      proposals;   /* sampler proposals, 0 if no sampler */
+  double      accepted;    /* sampler proposals accepted */
+  double      memory_bytes;/* digraph memory at end of phase, or 0 */
+} run_phase_t;
+
+typedef struct run_metrics_s {
+  struct timeval start;       /* when the run started */
+  struct timeval phase_start; /* when the current phase started */
+  uint_t         num_phases;  /* number of phases finished */
+  run_phase_t    phases[MAX_RUN_PHASES];
+  const char    *stop_reason; /* why Algorithm EE stopped, or NULL */
+  const digraph_t *g;         /* digraph whose memory is measured, or NULL */
+  double         peak_memory_bytes; /* largest memory_bytes of the phases */
+} run_metrics_t;
+
+typedef struct heartbeat_s {
+  char           filename[PATH_MAX+1]; /* heartbeat file */
+  uint_t         tasknum;     /* task number (MPI rank) */
+  double         interval;    /* minimum seconds between writes */
+  uint_t         n;           /* number of parameters */
+  const char    *param_names; /* names of the n parameters separated by
+                                 spaces */
+  const char    *phase;       /* name of current phase (static string) */
+  ulonglong_t    first_step;  /* step the phase started (or restarted) at */
+  ulonglong_t    total_steps; /* steps in the phase */
+  struct timeval phase_start; /* when the current phase started */
+  struct timeval last;        /* when the file was last written */
+  double         last_proposals; /* proposals in phase at last write */
+  double         last_accepted;  /* accepted proposals at last write */
+} heartbeat_t;
+
+void init_run_metrics(run_metrics_t *metrics);
+void set_run_metrics_digraph(run_metrics_t *metrics, const digraph_t *g);
+void start_run_phase(run_metrics_t *metrics);
+void end_run_phase(run_metrics_t *metrics, const char *name,
+                   double proposals, double accepted);
+int write_run_metrics(const char *filename, const run_metrics_t *metrics,
+                      const char *program, uint_t tasknum,
+                      const digraph_t *g);
+
+void init_heartbeat(heartbeat_t *hb, const char *filename, uint_t tasknum,
+                    double interval, uint_t n, const char *param_names);
+void start_heartbeat_phase(heartbeat_t *hb, const char *phase,
+                           ulonglong_t first_step, ulonglong_t total_steps);
+void update_heartbeat(heartbeat_t *hb, uint_t outer, uint_t inner,
+                      ulonglong_t step, double proposals, double accepted,
+                      const double theta[], const double dzA[]);
+void finish_heartbeat(heartbeat_t *hb);
+
+#endif /* RUNMETRICS_H */
@@ -0,0 +1,290 @@
+/*****************************************************************************
+ *
+ * File:    sampler.c
+ * Author:  Alex Stivala, Maksym Byshkin
+ * Created: October 2026
+ *
+ * Common interface to the ERGM samplers (basic, IFD, TNT, MTM,
+ * partitioned) and the scratch storage they share.
+ *
+ * The sampler registry maps each sampler_type_e to the sampler_ops_t
+ * table defined in the sampler's own module, so adding a sampler means
+ * adding its type, its ops table and its entry here.
+ *
+ * A sampler workspace is allocated once per run (estimation task or
+ * simulation) for the number of parameters in the model and passed
+ * down to each sampler call, so that the samplers, which are called
+ * many times with (often) only a few proposals each, do not allocate
+ * and free their buffers on every call. Each thread running a sampler
+ * must have its own workspace.
+ *
+ ****************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "sampler.h"
+#include "basicSampler.h"
+#include "ifdSampler.h"
+#include "tntSampler.h"
+#include "mtmSampler.h"
+#include "partitionedSampler.h"
+
+/*****************************************************************************
+ *
+ * local constants
+ *
+ ****************************************************************************/
+
+/* ops table of each sampler, indexed by sampler_type_e */
+static const sampler_ops_t *const sampler_registry[NUM_SAMPLER_TYPES] = {
+  &basic_sampler_ops, /* SAMPLER_BASIC */
+  &ifd_sampler_ops,   /* SAMPLER_IFD */
+  &tnt_sampler_ops,   /* SAMPLER_TNT */
+  &mtm_sampler_ops,   /* SAMPLER_MTM */
+  &partitioned_sampler_ops /* SAMPLER_PARTITIONED */
+};
+
+/*****************************************************************************
+ *
+ * externally visible functions
+ *
+ ****************************************************************************/
+
+/*
+ * Allocate a sampler workspace for a model with n parameters.
+ *
+ * Parameters:
+ *   n - number of parameters (length of theta and change statistics vectors)
+ *
+ * Return value:
+ *   Pointer to new workspace, free with free_sampler_workspace().
+ *   The proposal batch arrays are not allocated until
+ *   sampler_workspace_reserve_batch() is called.
+ */
+sampler_workspace_t *allocate_sampler_workspace(uint_t n)
+{
+  sampler_workspace_t *ws = (sampler_workspace_t *)
+    safe_calloc(1, sizeof(sampler_workspace_t));
+
+  ws->n = n;
+  ws->changestats = (double *)safe_malloc(n * sizeof(double));
+  ws->addChangeStats = (double *)safe_malloc(n * sizeof(double));
+  ws->delChangeStats = (double *)safe_malloc(n * sizeof(double));
+  return ws;
+}
+
+/*
+ * Make sure the proposal batch arrays of a sampler workspace can hold
+ * at least max_batch proposals, and the node stamp array num_nodes
+ * nodes. Does nothing if they already can (so after the first sampler
+ * call with a given batch size there is no further allocation).
+ *
+ * Parameters:
+ *   ws        - sampler workspace
+ *   max_batch - number of proposals in a batch
+ *   num_nodes - number of nodes in the graph
+ *
+ * Return value:
+ *   None.
+ */
+void sampler_workspace_reserve_batch(sampler_workspace_t *ws,
+                                     uint_t max_batch, uint_t num_nodes)
+{
+  if (max_batch > ws->max_batch) {
+    ws->max_batch = max_batch;
+    ws->dyads = (nodepair_t *)safe_realloc(ws->dyads,
+                                           max_batch * sizeof(nodepair_t));
+    ws->isDelete = (bool *)safe_realloc(ws->isDelete,
+                                        max_batch * sizeof(bool));
+    ws->batch_changestats = (double *)safe_realloc(ws->batch_changestats,
+                                                   (size_t)max_batch * ws->n *
+                                                   sizeof(double));
+    /* batchstat_t is no larger than double */
+    ws->batch_stats = (batchstat_t *)ws->batch_changestats;
+    ws->totals = (double *)safe_realloc(ws->totals,
+                                        max_batch * sizeof(double));
+    ws->urands = (double *)safe_realloc(ws->urands,
+                                        max_batch * sizeof(double));
+    ws->log_urands = (double *)safe_realloc(ws->log_urands,
+                                            max_batch * sizeof(double));
+  }
+  if (num_nodes > ws->num_nodes) {
+    ws->stamp = (uint_t *)safe_realloc(ws->stamp, num_nodes * sizeof(uint_t));
+    memset(ws->stamp + ws->num_nodes, 0,
+           (num_nodes - ws->num_nodes) * sizeof(uint_t));
+    ws->num_nodes = num_nodes;
+  }
+}
+
+/*
+ * Free a sampler workspace allocated with allocate_sampler_workspace().
+ *
+ * Parameters:
+ *   ws - sampler workspace to free
+ *
+ * Return value:
+ *   None.
+ */
+void free_sampler_workspace(sampler_workspace_t *ws)
+{
+  free(ws->changestats);
+  free(ws->addChangeStats);
+  free(ws->delChangeStats);
+  free(ws->dyads);
+  free(ws->isDelete);
+  free(ws->batch_changestats);
+  free(ws->totals);
+  free(ws->urands);
+  free(ws->log_urands);
+  free(ws->stamp);
+  free(ws);
+}
+
+/*
+ * Get the sampler type selected by the configuration settings.
+ *
+ * Parameters:
+ *   useIFDsampler - useIFDsampler configuration setting
+ *   useTNTsampler - useTNTsampler configuration setting
+ *   useMTMsampler - useMTMsampler configuration setting
+ *
+ * Return value:
+ *   Sampler type (the basic sampler if none is set).
+ */
+sampler_type_e get_sampler_type(bool useIFDsampler, bool useTNTsampler,
+                                bool useMTMsampler)
+{
+  assert(useIFDsampler + useTNTsampler + useMTMsampler <= 1);
+  if (useIFDsampler)
+    return SAMPLER_IFD;
+  else if (useTNTsampler)
+    return SAMPLER_TNT;
+  else if (useMTMsampler)
+    return SAMPLER_MTM;
+  else
+    return SAMPLER_BASIC;
+}
+
+/*
+ * Allocate a sampler of the given type.
+ *
+ * Parameters:
+ *   type    - sampler type
+ *   model   - model to sample, not copied so must remain valid until
+ *             the sampler is freed
+ *   options - sampler settings (copied)
+ *   prng    - pseudorandom number generator stream to use (not owned)
+ *   ws      - sampler workspace for model->n parameters (not owned)
+ *
+ * Return value:
+ *   Pointer to new sampler, free with free_sampler(). It must be
+ *   initialized with sampler_init() before each run.
+ */
+sampler_t *allocate_sampler(sampler_type_e type, const sampler_model_t *model,
+                            const sampler_options_t *options,
+                            prng_t *prng, sampler_workspace_t *ws)
+{
+  sampler_t *s = (sampler_t *)safe_calloc(1, sizeof(sampler_t));
+
+  assert(type < NUM_SAMPLER_TYPES);
+  assert(ws->n == model->n);
+  s->type = type;
+  s->ops = sampler_registry[type];
+  s->model = model;
+  s->options = *options;
+  s->prng = prng;
+  s->ws = ws;
+  if (s->ops->create)
+    s->ops->create(s);
+  return s;
+}
+
+/*
+ * Free a sampler allocated with allocate_sampler() (but not its model,
+ * random stream or workspace).
+ *
+ * Parameters:
+ *   s - sampler to free
+ *
+ * Return value:
+ *   None.
+ */
+void free_sampler(sampler_t *s)
+{
+  if (s->ops->destroy)
+    s->ops->destroy(s);
+  free(s);
+}
+
+/*
+ * Start a run (e.g. Algorithm S, Algorithm EE, or a simulation) of a
+ * sampler on a digraph.
+ *
+ * Parameters:
+ *   s         - sampler
+ *   g         - digraph the sampler will be run on
+ *   aux_param - initial value of the auxiliary parameter (IFD sampler),
+ *               ignored by samplers without one
+ *
+ * Return value:
+ *   None.
+ */
+void sampler_init(sampler_t *s, const digraph_t *g, double aux_param)
+{
+  if (s->ops->init)
+    s->ops->init(s, g, aux_param);
+}
+
+/*
+ * Run a sampler for sampler_m proposals.
+ *
+ * Parameters:
+ *   s              - sampler
+ *   g              - digraph object. Modifed if performMove is true.
+ *   theta          - array of n parameter values corresponding to
+ *                    change stats funcs
+ *   addChangeStats - (Out) vector of n change stats for add moves
+ *   delChangeStats - (Out) vector of n change stats for delete moves
+ *   sampler_m      - Number of proposals (sampling iterations)
+ *   performMove    - if true, moves are actually performed (digraph updated).
+ *
+ * Return value:
+ *   Acceptance rate.
+ *
+ * The proposals and accepted moves are added to the sampler's totals
+ * (s->num_proposals and s->num_accepted).
+ */
+double sampler_run(sampler_t *s, digraph_t *g, double theta[],
+                   double addChangeStats[], double delChangeStats[],
+                   uint_t sampler_m, bool performMove)
+{
+  double acceptance_rate = s->ops->run(s, g, theta, addChangeStats,
+                                       delChangeStats, sampler_m,
+                                       performMove);
+  s->num_proposals += sampler_m;
+  s->num_accepted += acceptance_rate * sampler_m;
+  return acceptance_rate;
+}
+
+/*
+ * Get the Arc statistic difference and Arc parameter value
+ * corresponding to the auxiliary parameter of a sampler (IFD) after
+ * its last run.
+ *
+ * Parameters:
+ *   s         - sampler
+ *   dzArc     - (Out) Arc statistic difference (Ndel - Nadd)
+ *   arc_param - (Out) Arc parameter value
+ *
+ * Return value:
+ *   TRUE if the sampler has an auxiliary parameter, else FALSE (and
+ *   dzArc and arc_param are not set).
+ */
+bool sampler_arc_stats(const sampler_t *s, double *dzArc, double *arc_param)
+{
+  if (!s->ops->arc_stats)
+    return FALSE;
+  s->ops->arc_stats(s, dzArc, arc_param);
+  return TRUE;
+}
@@ -0,0 +1,168 @@
+#ifndef SAMPLER_H
+#define SAMPLER_H
+/*****************************************************************************
+ *
+ * File:    sampler.h
+ * Author:  Alex Stivala, Maksym Byshkin
+ * Created: October 2026
+ *
+ * Common interface to the ERGM samplers (basic, IFD, TNT, MTM,
+ * partitioned) and the scratch storage they share.
+ *
+ * Each sampler provides a sampler_ops_t table of functions, and the
+ * sampler to use is looked up by type in a single registry (see
+ * get_sampler_type() for the mapping from configuration settings), so
+ * that the estimation and simulation algorithms do not need to know
+ * which sampler they are running. A sampler_t bundles the ops table
+ * with the model, options, random stream, workspace and any per-sampler
+ * state (such as the IFD auxiliary parameter).
+ *
+ * The ops table works at the level of a whole sampler call (sampler_m
+ * proposals, each proposed, evaluated and accepted or rejected), not a
+ * single proposal, so the inner loop of each sampler is unchanged and
+ * there is only one indirect call per sampler call.
+ *
+ * A sampler workspace is allocated once per run (estimation task or
+ * simulation) for the number of parameters in the model and passed
+ * down to each sampler call, so that the samplers, which are called
+ * many times with (often) only a few proposals each, do not allocate
+ * and free their buffers on every call. Each thread running a sampler
+ * must have its own workspace.
+ *
+ ****************************************************************************/
+
+#include "utils.h"
+#include "digraph.h"
+#include "changeStatisticsDirected.h"
+#include "digraphPartition.h"
+#include "proposalTrace.h"
+
+typedef struct sampler_workspace_s {
+  uint_t      n;              /* number of parameters (change statistics) */
+  double     *changestats;    /* n change statistics for one proposal */
+  double     *addChangeStats; /* n sums of change statistics of add moves */
+  double     *delChangeStats; /* n sums of change statistics of delete moves */
+
+  /* proposal batch, allocated on first use by
+     sampler_workspace_reserve_batch() (NULL and 0 until then) */
+  uint_t      max_batch;      /* number of proposals the arrays can hold */
+  nodepair_t *dyads;          /* proposed dyad of each proposal */
+  bool       *isDelete;       /* if each proposal is a delete move */
+  double     *batch_changestats; /* n change statistics for each proposal */
+  batchstat_t *batch_stats;   /* the same for calcChangeStatsBatch(), in
+                                 the storage of batch_changestats */
+  double     *totals;         /* theta-weighted sum for each proposal */
+  double     *urands;         /* block of uniform random numbers */
+  double     *log_urands;     /* their approximate logs (prng_urand_log()) */
+  uint_t      num_nodes;      /* length of stamp array */
+  uint_t     *stamp;          /* for each node, batch it last changed in */
+  uint_t      batch_num;      /* number of the current batch */
+
+  proposal_trace_t *trace;    /* trace of the proposals to write, or NULL
+                                 (see proposalTrace.h) */
+} sampler_workspace_t;
+
+sampler_workspace_t *allocate_sampler_workspace(uint_t n);
+void sampler_workspace_reserve_batch(sampler_workspace_t *ws,
+                                     uint_t max_batch, uint_t num_nodes);
+void free_sampler_workspace(sampler_workspace_t *ws);
+
+/* The model (change statistics functions and their arguments) to sample */
+typedef struct sampler_model_s {
+  uint_t n;                  /* number of parameters (total change stats) */
+  uint_t n_attr;             /* number of attribute change stats funcs */
+  uint_t n_dyadic;           /* number of dyadic covariate change stats funcs */
+  uint_t n_attr_interaction; /* number of attribute interaction funcs */
+  change_stats_func_t **change_stats_funcs;
+  double *lambda_values;     /* decay values for change_stats_funcs */
+  attr_change_stats_func_t **attr_change_stats_funcs;
+  dyadic_change_stats_func_t **dyadic_change_stats_funcs;
+  attr_interaction_change_stats_func_t **attr_interaction_change_stats_funcs;
+  uint_t *attr_indices;      /* attribute index of each attr func */
+  uint_pair_t *attr_interaction_pair_indices; /* attribute pair of each
+                                                 attr interaction func */
+} sampler_model_t;
+
+/* Settings that apply to every call of a sampler */
+typedef struct sampler_options_s {
+  double ifd_K;                  /* IFD auxiliary parameter step multiplier */
+  bool   useConditionalEstimation; /* conditional on snowball sample */
+  bool   forbidReciprocity;      /* do not allow reciprocated arcs */
+  uint_t num_threads;            /* threads for change statistics when moves
+                                    are performed (basic sampler only) */
+  uint_t mtm_tries;              /* tries per step (MTM sampler only) */
+  bool   earlyReject;            /* reject moves using bounds on the
+                                    neighbour-scanning statistics before
+                                    computing them (basic sampler only) */
+  double degreeProposalWeight;   /* weight of degree-weighted dyad
+                                    proposals, 0 for uniform (basic
+                                    sampler only, see
+                                    degreeProposalSampler()) */
+  digraph_partition_t *partition; /* this task's part of the network
+                                     (partitioned sampler only) */
+} sampler_options_t;
+
+/* The samplers in the registry */
+typedef enum sampler_type_e {
+  SAMPLER_BASIC,
+  SAMPLER_IFD,
+  SAMPLER_TNT,
+  SAMPLER_MTM,
+  SAMPLER_PARTITIONED,
+  NUM_SAMPLER_TYPES /* must be last */
+} sampler_type_e;
+
+typedef struct sampler_s sampler_t;
+
+typedef struct sampler_ops_s {
+  const char *name;
+  /* the proposals of a call can be divided between threads sharing the
+     graph when moves are not performed (no state is carried from one
+     proposal to the next and the graph is not changed) */
+  bool        divisible;
+  /* size of s->state, which must be plain data (no pointers) so that
+     it can be saved in a checkpoint and restored, 0 if no state */
+  size_t      state_size;
+  /* allocate s->state (may be NULL for samplers with no state) */
+  void   (*create)(sampler_t *s);
+  /* start a run on g, aux_param is the initial auxiliary parameter
+     for samplers that have one */
+  void   (*init)(sampler_t *s, const digraph_t *g, double aux_param);
+  /* propose, evaluate and accept or reject sampler_m moves, as the
+     sampler functions themselves (e.g. basicSampler()) */
+  double (*run)(sampler_t *s, digraph_t *g, double theta[],
+                double addChangeStats[], double delChangeStats[],
+                uint_t sampler_m, bool performMove);
+  /* Arc statistic difference and Arc parameter from the auxiliary
+     parameter of the last run, NULL if the sampler has none */
+  void   (*arc_stats)(const sampler_t *s, double *dzArc, double *arc_param);
+  /* free s->state */
+  void   (*destroy)(sampler_t *s);
+} sampler_ops_t;
+
+struct sampler_s {
+  sampler_type_e         type;
+  const sampler_ops_t   *ops;
+  const sampler_model_t *model;
+  sampler_options_t      options;
+  prng_t                *prng;  /* random stream (not owned) */
+  sampler_workspace_t   *ws;    /* workspace for model->n (not owned) */
+  void                  *state; /* per-sampler state, owned by ops,
+                                   ops->state_size bytes */
+  double                 num_proposals; /* proposals in all runs so far */
+  double                 num_accepted;  /* of which accepted */
+};
+
+sampler_type_e get_sampler_type(bool useIFDsampler, bool useTNTsampler,
+                                bool useMTMsampler);
+sampler_t *allocate_sampler(sampler_type_e type, const sampler_model_t *model,
+                            const sampler_options_t *options,
+                            prng_t *prng, sampler_workspace_t *ws);
+void free_sampler(sampler_t *s);
+void sampler_init(sampler_t *s, const digraph_t *g, double aux_param);
+double sampler_run(sampler_t *s, digraph_t *g, double theta[],
+                   double addChangeStats[], double delChangeStats[],
+                   uint_t sampler_m, bool performMove);
+bool sampler_arc_stats(const sampler_t *s, double *dzArc, double *arc_param);
+
+#endif /* SAMPLER_H */
@@ -0,0 +1,443 @@
+/*****************************************************************************
+ *
+ * File:    seriesWriter.c
+ * Author:  Alex Stivala, Maksym Byshkin
+ * Created: October 2026
+ *
+ * Output of the theta and dzA series as text or buffered binary
+ * records (see seriesWriter.h).
+ *
+ ****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include "seriesWriter.h"
+
+/*****************************************************************************
+ *
+ * local functions
+ *
+ ****************************************************************************/
+
+/*
+ * Background thread writing the binary buffers handed to it in
+ * w->pending, until w->quit is set.
+ */
+static void *series_writer_thread(void *arg)
+{
+  series_writer_t *w = (series_writer_t *)arg;
+
+  pthread_mutex_lock(&w->mutex);
+  for (;;) {
+    while (!w->busy && !w->quit)
+      pthread_cond_wait(&w->cond, &w->mutex);
+    if (!w->busy)
+      break;
+    pthread_mutex_unlock(&w->mutex);
+    if (fwrite(w->pending, sizeof(double), w->pending_len, w->fp) !=
+        w->pending_len)
+      w->error = TRUE;
+    pthread_mutex_lock(&w->mutex);
+    w->busy = FALSE;
+    pthread_cond_broadcast(&w->cond);
+  }
+  pthread_mutex_unlock(&w->mutex);
+  return NULL;
+}
+
+/*
+ * Wait until the background thread is not writing a buffer
+ */
+static void series_wait(series_writer_t *w)
+{
+  pthread_mutex_lock(&w->mutex);
+  while (w->busy)
+    pthread_cond_wait(&w->cond, &w->mutex);
+  pthread_mutex_unlock(&w->mutex);
+}
+
+/*
+ * Hand the binary buffer being filled to the sink (discarding what does
+ * not fit in its region), and start filling the other one. With last
+ * True it is the final buffer, handed over even if empty.
+ */
+static void series_sink_submit(series_writer_t *w, bool last)
+{
+  series_sink_t *sink = w->sink;
+  long           start = w->pos - (long)(w->len * sizeof(double));
+  size_t         n = w->len;
+
+  if (start + (long)(n * sizeof(double)) > sink->size) {
+    n = start < sink->size ? (size_t)(sink->size - start) / sizeof(double)
+      : 0;
+    w->error = TRUE;
+  }
+  if ((n > 0 || last) &&
+      sink->write_at(sink->data, sink->offset + start, w->buf[w->cur], n,
+                     last))
+    w->error = TRUE;
+  w->cur = 1 - w->cur;
+  w->len = 0;
+}
+
+/*
+ * Hand the binary buffer being filled to the background thread (after
+ * it has finished the previous one) and start filling the other one.
+ */
+static void series_submit(series_writer_t *w)
+{
+  if (w->len == 0)
+    return;
+  if (w->sink) {
+    series_sink_submit(w, FALSE);
+    return;
+  }
+  pthread_mutex_lock(&w->mutex);
+  while (w->busy)
+    pthread_cond_wait(&w->cond, &w->mutex);
+  w->pending = w->buf[w->cur];
+  w->pending_len = w->len;
+  w->busy = TRUE;
+  pthread_cond_broadcast(&w->cond);
+  pthread_mutex_unlock(&w->mutex);
+  w->cur = 1 - w->cur;
+  w->len = 0;
+}
+
+/*
+ * Append a value to the current record of a series kept in memory.
+ */
+static void series_append(series_data_t *data, double value)
+{
+  if (data->len == data->capacity) {
+    data->capacity = data->capacity ? 2 * data->capacity : 1024;
+    data->values = (double *)safe_realloc(data->values,
+                                          data->capacity * sizeof(double));
+  }
+  data->values[data->len++] = value;
+}
+
+/*****************************************************************************
+ *
+ * externally visible functions
+ *
+ ****************************************************************************/
+
+/*
+ * Open a theta or dzA series output file.
+ *
+ * Parameters:
+ *   filename - name of file to write, or NULL to discard the series
+ *   binary   - if True write binary records, else text
+ *   append   - if True append to existing file (header not written)
+ *              else replace it
+ *   header   - column names separated by spaces (without newline)
+ *
+ * Return value:
+ *   Series writer, to be closed with close_series_writer(),
+ *   or NULL on error (message printed to stderr).
+ */
+series_writer_t *open_series_writer(const char *filename, bool binary,
+                                    bool append, const char *header)
+{
+  series_writer_t *w = (series_writer_t *)safe_calloc(1,
+                                                      sizeof(series_writer_t));
+
+  if (!filename)
+    return w; /* fp is NULL so everything is discarded */
+  strncpy(w->filename, filename, sizeof(w->filename) - 1);
+  w->binary = binary;
+  w->first_field = TRUE;
+  if (!(w->fp = fopen(filename, append ? (binary ? "ab" : "a") :
+                      (binary ? "wb" : "w")))) {
+    fprintf(stderr, "ERROR: could not open file %s for writing (%s)\n",
+            filename, strerror(errno));
+    free(w);
+    return NULL;
+  }
+  if (!append)
+    fprintf(w->fp, "%s\n", header);
+  if (binary) {
+    fseek(w->fp, 0, SEEK_END);
+    w->pos = ftell(w->fp);
+    w->buf[0] = (double *)safe_malloc(SERIES_BUFFER_DOUBLES * sizeof(double));
+    w->buf[1] = (double *)safe_malloc(SERIES_BUFFER_DOUBLES * sizeof(double));
+    pthread_mutex_init(&w->mutex, NULL);
+    pthread_cond_init(&w->cond, NULL);
+    if (pthread_create(&w->thread, NULL, series_writer_thread, w)) {
+      fprintf(stderr, "ERROR: could not create writer thread for %s\n",
+              filename);
+      exit(1);
+    }
+  }
+  return w;
+}
+
+/*
+ * Open a theta or dzA series kept in memory rather than written to a
+ * file. Comments are discarded.
+ *
+ * Parameters:
+ *   data     - (out) series, to be freed with free_series_data() (after
+ *              close_series_writer())
+ *   header   - column names separated by spaces (without newline)
+ *
+ * Return value:
+ *   Series writer, to be closed with close_series_writer().
+ */
+series_writer_t *open_memory_series_writer(series_data_t *data,
+                                           const char *header)
+{
+  series_writer_t *w = (series_writer_t *)safe_calloc(1,
+                                                      sizeof(series_writer_t));
+  const char      *p;
+
+  memset(data, 0, sizeof(series_data_t));
+  data->header = safe_strdup(header);
+  for (p = header; *p; p++) {
+    if (*p != ' ' && (p == header || p[-1] == ' '))
+      data->num_columns++;
+  }
+  w->data = data;
+  w->first_field = TRUE;
+  return w;
+}
+
+/*
+ * Open a theta or dzA series written as binary records into a region of
+ * a shared file (see series_sink_t). Comments are written to stdout.
+ *
+ * Parameters:
+ *   sink     - (in/out) region to write to; its header is set to a copy
+ *              of header, and its num_values at close
+ *   header   - column names separated by spaces (without newline)
+ *
+ * Return value:
+ *   Series writer, to be closed with close_series_writer().
+ */
+series_writer_t *open_sink_series_writer(series_sink_t *sink,
+                                         const char *header)
+{
+  series_writer_t *w = (series_writer_t *)safe_calloc(1,
+                                                      sizeof(series_writer_t));
+
+  strncpy(w->filename, sink->name, sizeof(w->filename) - 1);
+  sink->header = safe_strdup(header);
+  sink->num_values = 0;
+  w->sink = sink;
+  w->binary = TRUE;
+  w->first_field = TRUE;
+  w->buf[0] = (double *)safe_malloc(SERIES_BUFFER_DOUBLES * sizeof(double));
+  w->buf[1] = (double *)safe_malloc(SERIES_BUFFER_DOUBLES * sizeof(double));
+  return w;
+}
+
+/*
+ * Write an integer value (the step number) to the current record.
+ *
+ * Parameters:
+ *   w     - series writer
+ *   value - value to write
+ *
+ * Return value:
+ *   None.
+ */
+void series_write_int(series_writer_t *w, long value)
+{
+  if (w->data)
+    series_append(w->data, (double)value);
+  if (!w->fp && !w->sink)
+    return;
+  if (w->binary) {
+    series_write_double(w, (double)value);
+  } else {
+    fprintf(w->fp, w->first_field ? "%ld" : " %ld", value);
+    w->first_field = FALSE;
+  }
+}
+
+/*
+ * Write a value to the current record.
+ *
+ * Parameters:
+ *   w     - series writer
+ *   value - value to write
+ *
+ * Return value:
+ *   None.
+ */
+void series_write_double(series_writer_t *w, double value)
+{
+  if (w->data)
+    series_append(w->data, value);
+  if (!w->fp && !w->sink)
+    return;
+  if (w->binary) {
+    w->buf[w->cur][w->len++] = value;
+    w->pos += sizeof(double);
+    if (w->len == SERIES_BUFFER_DOUBLES)
+      series_submit(w);
+  } else {
+    fprintf(w->fp, w->first_field ? "%g" : " %g", value);
+    w->first_field = FALSE;
+  }
+}
+
+/*
+ * End the current record.
+ *
+ * Parameters:
+ *   w     - series writer
+ *
+ * Return value:
+ *   None.
+ */
+void series_end_record(series_writer_t *w)
+{
+  if (w->data)
+    w->data->num_records = w->data->len / MAX(w->data->num_columns, 1);
+  if (!w->fp && !w->sink)
+    return;
+  if (!w->binary)
+    fputc('\n', w->fp);
+  w->first_field = TRUE;
+}
+
+/*
+ * Write a comment line, printf() style. A newline is added, and
+ * the comment is written to stdout rather than to a binary file.
+ *
+ * Parameters:
+ *   w      - series writer
+ *   format - printf() format string (the text after "# ")
+ *   ...    - values for format
+ *
+ * Return value:
+ *   None.
+ */
+void series_comment(series_writer_t *w, const char *format, ...)
+{
+  va_list ap;
+  FILE   *fp = w->binary ? stdout : w->fp;
+
+  assert(w->first_field);
+  if (!w->fp && !w->sink)
+    return;
+  va_start(ap, format);
+  if (w->binary)
+    fprintf(fp, "%s: ", w->filename);
+  fprintf(fp, "# ");
+  vfprintf(fp, format, ap);
+  fprintf(fp, "\n");
+  va_end(ap);
+}
+
+/*
+ * Write everything so far to the file. Does nothing for a series
+ * written to a sink, which gets only full buffers until it is closed.
+ *
+ * Parameters:
+ *   w      - series writer
+ *
+ * Return value:
+ *   None.
+ */
+void series_flush(series_writer_t *w)
+{
+  if (!w->fp)
+    return;
+  if (w->binary) {
+    series_submit(w);
+    series_wait(w);
+  }
+  fflush(w->fp);
+}
+
+/*
+ * Length of the file after everything so far is written
+ * (e.g. to truncate to on restart).
+ *
+ * Parameters:
+ *   w      - series writer
+ *
+ * Return value:
+ *   Length of file in bytes.
+ */
+long series_tell(series_writer_t *w)
+{
+  if (w->sink)
+    return w->pos;
+  if (!w->fp)
+    return 0;
+  return w->binary ? w->pos : ftell(w->fp);
+}
+
+/*
+ * Write everything so far and close the series writer.
+ *
+ * Parameters:
+ *   w      - series writer, freed here
+ *
+ * Return value:
+ *   0 if OK else nonzero if a write failed (message printed to stderr).
+ */
+int close_series_writer(series_writer_t *w)
+{
+  int err;
+
+  if (w->sink) {
+    series_sink_submit(w, TRUE);
+    w->sink->num_values = (size_t)MIN(w->pos, w->sink->size) / sizeof(double);
+    if (w->error)
+      fprintf(stderr, "ERROR: writing %s failed (%s)\n", w->filename,
+              w->pos > w->sink->size ? "more records than its region holds" :
+              "write error");
+    err = w->error;
+    free(w->buf[0]);
+    free(w->buf[1]);
+    free(w);
+    return err;
+  }
+  if (!w->fp) {
+    free(w);
+    return 0;
+  }
+  if (w->binary) {
+    series_submit(w);
+    pthread_mutex_lock(&w->mutex);
+    w->quit = TRUE;
+    pthread_cond_broadcast(&w->cond);
+    pthread_mutex_unlock(&w->mutex);
+    pthread_join(w->thread, NULL);
+    pthread_mutex_destroy(&w->mutex);
+    pthread_cond_destroy(&w->cond);
+    free(w->buf[0]);
+    free(w->buf[1]);
+  }
+  err = w->error || ferror(w->fp);
+  err |= fclose(w->fp) != 0;
+  if (err)
+    fprintf(stderr, "ERROR: writing file %s failed\n", w->filename);
+  free(w);
+  return err;
+}
+
+/*
+ * Free a series kept in memory by open_memory_series_writer().
+ *
+ * Parameters:
+ *   data   - series to free (the structure itself is not freed)
+ *
+ * Return value:
+ *   None.
+ */
+void free_series_data(series_data_t *data)
+{
+  free(data->header);
+  free(data->values);
+  memset(data, 0, sizeof(series_data_t));
+}
@@ -0,0 +1,115 @@
+#ifndef SERIESWRITER_H
+#define SERIESWRITER_H
+/*****************************************************************************
+ *
+ * File:    seriesWriter.h
+ * Author:  Alex Stivala, Maksym Byshkin
+ * Created: October 2026
+ *
+ * Output of the theta and dzA series (one record per step of Algorithm
+ * S or EE) either as text (values separated by spaces, one record per
+ * line, as read by the R scripts) or, with binaryOutput, in binary.
+ *
+ * The binary format is the same header line as the text format (column
+ * names separated by spaces, ending in newline), followed by the records,
+ * each the values of every column as a native (usually little-endian
+ * IEEE 754) double, with no separators. Comment lines (starting with
+ * '#') cannot be written to the binary file so are written to stdout
+ * instead, prefixed with the file name.
+ *
+ * Binary records are collected in a large buffer, and full buffers are
+ * written by a background thread, so the sampler does not wait for
+ * formatting or for the file system.
+ *
+ * A series writer opened with no file name discards everything written
+ * to it (e.g. when the estimates are only wanted in memory, through the
+ * estimNetLib.h library). One opened with open_memory_series_writer()
+ * instead keeps the records in memory (series_data_t) for the caller,
+ * e.g. to return the theta and dzA traces to Python.
+ *
+ * One opened with open_sink_series_writer() writes binary records (with
+ * no header line) into a region of a file shared with other writers,
+ * through the write_at callback of a series_sink_t, so that this module
+ * does not depend on how the file is written (e.g. with MPI-IO, see
+ * seriesContainerFile in EstimNetDirectedMPImain.c). Each full buffer is
+ * handed to write_at as it fills, in the calling thread (write_at is
+ * expected not to wait for the write), and the last, partial, buffer
+ * at close with last True. Records beyond the size of the region are
+ * discarded (and an error reported at close).
+ *
+ ****************************************************************************/
+
+#include <stdio.h>
+#include <limits.h>
+#include <pthread.h>
+#include "utils.h"
+
+/* number of doubles in each of the two binary output buffers */
+#define SERIES_BUFFER_DOUBLES (1 << 17)
+
+typedef struct series_data_s { /* a series kept in memory */
+  char   *header;            /* column names separated by spaces */
+  uint_t  num_columns;       /* number of values in each record */
+  size_t  num_records;       /* number of complete records */
+  size_t  len;               /* number of values in values */
+  size_t  capacity;          /* number of values allocated */
+  double *values;            /* the records in order, num_columns values
+                                each */
+} series_data_t;
+
+typedef struct series_sink_s { /* a region of a shared file */
+  /* write n values at byte offset in the file, last True for the final
+     (partial) buffer; returns 0 if OK. values is left unchanged until
+     the next call, except the last, after which it is freed at once */
+  int   (*write_at)(void *data, long offset, const double *values,
+                    size_t n, bool last);
+  void   *data;              /* passed to write_at */
+  long    offset;            /* byte offset of the region in the file */
+  long    size;              /* bytes in the region */
+  const char *name;          /* description for messages */
+  char   *header;            /* (out) column names, set by
+                                open_sink_series_writer() (to be freed
+                                by caller) */
+  size_t  num_values;        /* (out) values written, set at close */
+} series_sink_t;
+
+typedef struct series_writer_s {
+  FILE   *fp;                /* the output file, NULL to discard (or keep
+                                in data) */
+  series_data_t *data;       /* series kept in memory, or NULL */
+  series_sink_t *sink;       /* region of a shared file, or NULL */
+  char    filename[PATH_MAX+1]; /* name of the output file */
+  bool    binary;            /* binary (else text) format */
+  bool    first_field;       /* (text) next value is first of record */
+  double *buf[2];            /* (binary) buffer being filled and one
+                                being written */
+  uint_t  cur;               /* (binary) index of buffer being filled */
+  size_t  len;               /* (binary) values in buffer being filled */
+  long    pos;               /* (binary) bytes in file after all queued
+                                buffers are written */
+  pthread_t thread;          /* (binary) background writer thread */
+  pthread_mutex_t mutex;     /* (binary) protects the following */
+  pthread_cond_t  cond;      /* (binary) signalled when they change */
+  const double *pending;     /* (binary) buffer for thread to write */
+  size_t  pending_len;       /* (binary) values in pending */
+  bool    busy;              /* (binary) thread is writing pending */
+  bool    quit;              /* (binary) thread is to exit */
+  bool    error;             /* a write failed */
+} series_writer_t;
+
+series_writer_t *open_series_writer(const char *filename, bool binary,
+                                    bool append, const char *header);
+series_writer_t *open_memory_series_writer(series_data_t *data,
+                                           const char *header);
+series_writer_t *open_sink_series_writer(series_sink_t *sink,
+                                         const char *header);
+void series_write_int(series_writer_t *w, long value);
+void series_write_double(series_writer_t *w, double value);
+void series_end_record(series_writer_t *w);
+void series_comment(series_writer_t *w, const char *format, ...);
+void series_flush(series_writer_t *w);
+long series_tell(series_writer_t *w);
+int close_series_writer(series_writer_t *w);
+void free_series_data(series_data_t *data);
+
+#endif /* SERIESWRITER_H */
@@ -0,0 +1,342 @@
+/*****************************************************************************
+ *
+ * File:    simEstimate.c
+ * Author:  Alex Stivala
+ * Created: October 2026
+ *
+ * Estimation of a model of each network sampled by SimulateERGM, in
+ * threads running alongside the simulation (see simEstimate.h).
+ *
+ ****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include "simEstimate.h"
+
+/*****************************************************************************
+ *
+ * Local functions
+ *
+ ****************************************************************************/
+
+/*
+ * Read a whole configuration file into a string.
+ *
+ * Parameters:
+ *   filename - name of file to read (may be compressed)
+ *
+ * Return value:
+ *   Contents of the file, to be freed by caller, or NULL on error
+ *   (message printed to stderr).
+ */
+static char *read_config_text(const char *filename)
+{
+  size_t size;
+  bool   compressed;
+  char  *map, *text;
+
+  if (!(map = map_input_file(filename, &size, &compressed))) {
+    fprintf(stderr, "ERROR: could not read estimation configuration "
+            "file %s\n", filename);
+    return NULL;
+  }
+  text = (char *)safe_malloc(size + 1);
+  memcpy(text, map, size);
+  text[size] = '\0';
+  unmap_input_file(map, size, compressed);
+  return text;
+}
+
+/*
+ * Write the results that are done, in sample order, as far as the
+ * first that is not. The header line is written first, from the
+ * parameter names of the first estimate that succeeded, so nothing is
+ * written until there is one (unless final is True). Called with the
+ * mutex held.
+ *
+ * Parameters:
+ *   est   - sim estimator
+ *   final - True when no more results will come (all are done)
+ *
+ * Return value:
+ *   None.
+ */
+static void write_done_results(sim_estimator_t *est, bool final)
+{
+  sim_estimate_result_t *r;
+  const chain_summary_t *first = NULL;
+  char   *names, *name, *saveptr = NULL;
+  uint_t  k, l, n = 0;
+
+  if (!est->header_written) {
+    for (k = 0; k < est->num_samples && !first; k++)
+      if (est->results[k].done && est->results[k].ok)
+        first = &est->results[k].summary;
+    if (!first && !final)
+      return;
+    fprintf(est->fp, "t");
+    if (first) {
+      names = safe_strdup(first->param_names ? first->param_names : "");
+      for (l = 0; l < first->n; l++) {
+        name = strtok_r(l == 0 ? names : NULL, " ", &saveptr);
+        fprintf(est->fp, " %s %s_se", name ? name : "?", name ? name : "?");
+      }
+      free(names);
+    }
+    fprintf(est->fp, "\n");
+    est->header_written = TRUE;
+  }
+  for (k = 0; k < est->num_samples && n == 0; k++)
+    if (est->results[k].ok)
+      n = est->results[k].summary.n;
+  while (est->num_written < est->num_samples &&
+         est->results[est->num_written].done) {
+    r = &est->results[est->num_written];
+    fprintf(est->fp, "%llu", r->iteration);
+    for (l = 0; l < n; l++) {
+      if (r->ok && r->summary.valid)
+        fprintf(est->fp, " %g %g", r->summary.est[l], r->summary.se[l]);
+      else
+        fprintf(est->fp, " NA NA");
+    }
+    fprintf(est->fp, "\n");
+    if (r->ok)
+      free_chain_summary(&r->summary);
+    est->num_written++;
+  }
+  fflush(est->fp);
+  if (ferror(est->fp))
+    est->error = TRUE;
+}
+
+/*
+ * Estimation thread: take clones from the queue and estimate them
+ * until told to quit and the queue is empty.
+ *
+ * Parameters:
+ *   arg - sim estimator
+ *
+ * Return value:
+ *   NULL.
+ */
+static void *sim_estimate_thread(void *arg)
+{
+  sim_estimator_t  *est = (sim_estimator_t *)arg;
+  digraph_t        *g;
+  uint_t            samplenum;
+  estimnet_rng_t    rng;
+  chain_summary_t   summary;
+  estimnet_status_e status;
+
+  pthread_mutex_lock(&est->mutex);
+  for (;;) {
+    while (est->queue_len == 0 && !est->quit)
+      pthread_cond_wait(&est->cond, &est->mutex);
+    if (est->queue_len == 0)
+      break;
+    g = est->queue[est->queue_head];
+    samplenum = est->queue_sample[est->queue_head];
+    est->queue_head = (est->queue_head + 1) % est->num_threads;
+    est->queue_len--;
+    pthread_cond_broadcast(&est->cond);
+    pthread_mutex_unlock(&est->mutex);
+
+    rng.seed = est->seed;
+    rng.stream = est->first_stream + samplenum;
+    /* estimnet_estimate_digraph() frees g */
+    status = estimnet_estimate_digraph(&est->model, g, &rng, &summary);
+    if (status != ESTIMNET_OK)
+      fprintf(stderr, "ERROR: estimation of sample %u failed\n", samplenum);
+
+    pthread_mutex_lock(&est->mutex);
+    est->results[samplenum].done = TRUE;
+    est->results[samplenum].ok = status == ESTIMNET_OK;
+    if (status == ESTIMNET_OK)
+      est->results[samplenum].summary = summary;
+    write_done_results(est, FALSE);
+  }
+  pthread_mutex_unlock(&est->mutex);
+  return NULL;
+}
+
+/*****************************************************************************
+ *
+ * External functions
+ *
+ ****************************************************************************/
+
+/*
+ * Start estimating the networks sampled by a simulation: read the
+ * estimation configuration, open the output file, and start the
+ * estimation threads.
+ *
+ * Parameters:
+ *   config_filename - EstimNetDirected configuration file of the model
+ *                     to estimate (input and output file settings are
+ *                     not used)
+ *   filename        - output filename for the estimates
+ *   num_threads     - number of estimation threads (0 is the same as 1)
+ *   seed            - pseudorandom number seed, 0 for the seed in the
+ *                     estimation configuration (or if that is not set,
+ *                     the time)
+ *   first_stream    - pseudorandom number stream of the first sample
+ *
+ * Return value:
+ *   sim estimator to give the samples to, or NULL on error (message
+ *   printed to stderr).
+ */
+sim_estimator_t *open_sim_estimator(const char *config_filename,
+                                    const char *filename,
+                                    uint_t num_threads, uint64_t seed,
+                                    uint_t first_stream)
+{
+  sim_estimator_t *est;
+  char            *config_text;
+  uint_t           i;
+
+  if (!(config_text = read_config_text(config_filename)))
+    return NULL;
+  est = (sim_estimator_t *)safe_calloc(1, sizeof(sim_estimator_t));
+  if (estimnet_model_from_string(config_text, &est->model) != ESTIMNET_OK) {
+    fprintf(stderr, "ERROR: estimation configuration file %s is not "
+            "valid\n", config_filename);
+    free(config_text);
+    free(est);
+    return NULL;
+  }
+  free(config_text);
+  strncpy(est->filename, filename, sizeof(est->filename) - 1);
+  if (!(est->fp = fopen(filename, "w"))) {
+    fprintf(stderr, "ERROR: could not open estimates file %s for writing "
+            "(%s)\n", filename, strerror(errno));
+    estimnet_free_model(&est->model);
+    free(est);
+    return NULL;
+  }
+  est->seed = seed;
+  est->first_stream = first_stream;
+  est->num_threads = MAX(num_threads, 1);
+  est->queue = (digraph_t **)safe_calloc(est->num_threads,
+                                         sizeof(digraph_t *));
+  est->queue_sample = (uint_t *)safe_calloc(est->num_threads,
+                                            sizeof(uint_t));
+  est->threads = (pthread_t *)safe_calloc(est->num_threads,
+                                          sizeof(pthread_t));
+  pthread_mutex_init(&est->mutex, NULL);
+  pthread_cond_init(&est->cond, NULL);
+  /* the estimations set the pseudorandom number seed of the thread
+     they run in, so are never run in the simulation thread */
+  for (i = 0; i < est->num_threads; i++) {
+    if (pthread_create(&est->threads[i], NULL, sim_estimate_thread, est)) {
+      fprintf(stderr, "WARNING: could only start %u of %u estimation "
+              "threads\n", i, est->num_threads);
+      break;
+    }
+  }
+  if (i == 0) {
+    fprintf(stderr, "ERROR: could not start estimation threads\n");
+    est->num_threads = 0;
+    close_sim_estimator(est);
+    return NULL;
+  }
+  pthread_mutex_lock(&est->mutex);
+  est->num_threads = i;
+  pthread_mutex_unlock(&est->mutex);
+  return est;
+}
+
+/*
+ * Give a sampled network to be estimated. A clone of it is made and
+ * queued for the estimation threads, waiting first if the queue is
+ * full, so g can be changed (by the simulation continuing) as soon as
+ * this returns; but g must not be freed, nor its nodes or attributes
+ * changed, until close_sim_estimator() (as the clones share them).
+ *
+ * Parameters:
+ *   est       - sim estimator
+ *   g         - the sampled network (with no arc journal open)
+ *   iteration - sampler iteration of the sample
+ *
+ * Return value:
+ *   0 if OK else -1 if writing the estimates failed.
+ */
+int estimate_sim_sample(sim_estimator_t *est, const digraph_t *g,
+                        ulonglong_t iteration)
+{
+  digraph_t *c = clone_digraph(g);
+  uint_t     k;
+  int        rc;
+
+  pthread_mutex_lock(&est->mutex);
+  while (est->queue_len == est->num_threads)
+    pthread_cond_wait(&est->cond, &est->mutex);
+  if (est->num_samples == est->results_capacity) {
+    est->results_capacity = MAX(2 * est->results_capacity, 64);
+    est->results = (sim_estimate_result_t *)safe_realloc(
+      est->results, est->results_capacity * sizeof(sim_estimate_result_t));
+  }
+  k = est->num_samples++;
+  memset(&est->results[k], 0, sizeof(sim_estimate_result_t));
+  est->results[k].iteration = iteration;
+  est->queue[(est->queue_head + est->queue_len) % est->num_threads] = c;
+  est->queue_sample[(est->queue_head + est->queue_len) % est->num_threads] =
+    k;
+  est->queue_len++;
+  pthread_cond_broadcast(&est->cond);
+  rc = est->error ? -1 : 0;
+  pthread_mutex_unlock(&est->mutex);
+  return rc;
+}
+
+/*
+ * Wait for the estimations of all the samples given to finish, write
+ * the rest of the estimates, stop the threads, and free the sim
+ * estimator.
+ *
+ * Parameters:
+ *   est - sim estimator
+ *
+ * Return value:
+ *   0 if OK else -1 if writing the estimates failed or every estimation
+ *   failed (message printed to stderr).
+ */
+int close_sim_estimator(sim_estimator_t *est)
+{
+  uint_t k, num_ok = 0;
+  int    rc = 0;
+
+  pthread_mutex_lock(&est->mutex);
+  est->quit = TRUE;
+  pthread_cond_broadcast(&est->cond);
+  pthread_mutex_unlock(&est->mutex);
+  for (k = 0; k < est->num_threads; k++)
+    pthread_join(est->threads[k], NULL);
+  assert(est->queue_len == 0);
+
+  for (k = 0; k < est->num_samples; k++)
+    if (est->results[k].ok)
+      num_ok++;
+  if (est->num_threads > 0)
+    write_done_results(est, TRUE);
+  if (est->num_samples > 0 && num_ok == 0) {
+    fprintf(stderr, "ERROR: estimation of every sample failed\n");
+    rc = -1;
+  }
+  if (fclose(est->fp) != 0 || est->error) {
+    fprintf(stderr, "ERROR: writing estimates file %s failed\n",
+            est->filename);
+    rc = -1;
+  }
+  pthread_mutex_destroy(&est->mutex);
+  pthread_cond_destroy(&est->cond);
+  estimnet_free_model(&est->model);
+  free(est->results);
+  free(est->queue);
+  free(est->queue_sample);
+  free(est->threads);
+  free(est);
+  return rc;
+}
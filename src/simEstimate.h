@@ -0,0 +1,77 @@
+#ifndef SIMESTIMATE_H
+#define SIMESTIMATE_H
+/*****************************************************************************
+ *
+ * File:    simEstimate.h
+ * Author:  Alex Stivala
+ * Created: October 2026
+ *
+ * Estimation of a model of each network sampled by SimulateERGM
+ * (estimationConfigFile), for simulation studies, without writing each
+ * network to a file and starting an EstimNetDirected process to load
+ * it again. At each sample the network is cloned (clone_digraph(), so
+ * the two-path tables are copied rather than built again) and given to
+ * a pool of threads that estimate the model with
+ * estimnet_estimate_digraph() (see estimNetLib.h) while the simulation
+ * continues. At most as many clones as threads wait to be estimated,
+ * after which the simulation waits for a thread to take one.
+ *
+ * The estimates are written to a text file in sample order, in the
+ * same layout as the statistics file: a header line then one line for
+ * each sample, the first column t being the sampler iteration, then
+ * the estimate and standard error of each parameter (columns name and
+ * name_se), NA if the estimation failed or did not converge.
+ *
+ * The estimation of the sample numbered k uses the pseudorandom number
+ * stream first_stream + k with the simulation seed (or the seed of the
+ * estimation configuration, if the simulation seed is not set), so the
+ * estimates do not depend on the number of threads.
+ *
+ ****************************************************************************/
+
+#include <stdio.h>
+#include <limits.h>
+#include <pthread.h>
+#include "utils.h"
+#include "digraph.h"
+#include "estimNetLib.h"
+
+typedef struct sim_estimate_result_s {
+  ulonglong_t     iteration; /* sampler iteration of the sample */
+  bool            done;      /* estimation finished */
+  bool            ok;        /* estimation succeeded */
+  chain_summary_t summary;   /* estimates if ok */
+} sim_estimate_result_t;
+
+typedef struct sim_estimator_s {
+  estimnet_model_t model;            /* the estimation configuration */
+  FILE       *fp;                    /* the output file */
+  char        filename[PATH_MAX+1];  /* name of the output file */
+  uint64_t    seed;                  /* seed, 0 for that of the model */
+  uint_t      first_stream;          /* stream of sample number 0 */
+  uint_t      num_threads;           /* number of estimation threads */
+  pthread_t  *threads;               /* the estimation threads */
+  pthread_mutex_t mutex;             /* protects the following */
+  pthread_cond_t  cond;              /* signalled when they change */
+  digraph_t **queue;                 /* clones waiting, num_threads slots */
+  uint_t     *queue_sample;          /* sample number of each clone */
+  uint_t      queue_head;            /* index of the next clone to take */
+  uint_t      queue_len;             /* number of clones waiting */
+  sim_estimate_result_t *results;    /* result of each sample */
+  uint_t      num_samples;           /* number of samples given */
+  uint_t      results_capacity;      /* number of results allocated */
+  uint_t      num_written;           /* results written (in order) */
+  bool        header_written;        /* header line written */
+  bool        quit;                  /* threads are to exit when idle */
+  bool        error;                 /* a write failed */
+} sim_estimator_t;
+
+sim_estimator_t *open_sim_estimator(const char *config_filename,
+                                    const char *filename,
+                                    uint_t num_threads, uint64_t seed,
+                                    uint_t first_stream);
+int estimate_sim_sample(sim_estimator_t *est, const digraph_t *g,
+                        ulonglong_t iteration);
+int close_sim_estimator(sim_estimator_t *est);
+
+#endif /* SIMESTIMATE_H */
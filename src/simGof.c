@@ -0,0 +1,410 @@
+/*****************************************************************************
+ *
+ * File:    simGof.c
+ * Author:  Alex Stivala
+ * Created: October 2026
+ *
+ * Goodness-of-fit statistics of simulated network samples (see
+ * simGof.h).
+ *
+ * The triad census uses the algorithm of:
+ *
+ *   Batagelj, V., & Mrvar, A. (2001). A subquadratic triad census
+ *   algorithm for large sparse networks with small maximum
+ *   degree. Social Networks, 23(3), 237-243.
+ *
+ * which is O(m * maximum degree) rather than O(n^3).
+ *
+ ****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include "simGof.h"
+
+/*****************************************************************************
+ *
+ * local constants
+ *
+ ****************************************************************************/
+
+static const char *TRIAD_NAMES[SIM_GOF_NUM_TRIAD_TYPES] = {
+  "003", "012", "102", "021D", "021U", "021C", "111D", "111U",
+  "030T", "030C", "201", "120D", "120U", "120C", "210", "300"
+};
+
+/*
+ * Triad type (index in TRIAD_NAMES) of each of the 64 triad codes
+ * computed by triad_code().
+ */
+static const uint_t TRIAD_CODE_TYPE[64] = {
+  0, 1, 1, 2, 1, 3, 5, 7, 1, 5, 4, 6, 2, 7, 6, 10,
+  1, 5, 3, 7, 4, 8, 8, 12, 5, 9, 8, 13, 6, 13, 11, 14,
+  1, 4, 5, 6, 5, 8, 9, 13, 3, 8, 8, 11, 7, 12, 13, 14,
+  2, 6, 7, 10, 6, 11, 13, 14, 7, 13, 12, 14, 10, 14, 14, 15
+};
+
+/*****************************************************************************
+ *
+ * local functions
+ *
+ ****************************************************************************/
+
+/*
+ * Write the bins of gof->hist as columns of the current line.
+ *
+ * Parameters:
+ *   gof - goodness-of-fit writer
+ *
+ * Return value:
+ *   None.
+ */
+static void write_hist(sim_gof_t *gof)
+{
+  uint_t k;
+
+  for (k = 0; k <= gof->max_degree; k++)
+    fprintf(gof->fp, " %llu", gof->hist[k]);
+}
+
+/*
+ * Write the histogram of a node degree array, with the last bin for
+ * degree max_degree or more.
+ *
+ * Parameters:
+ *   gof       - goodness-of-fit writer
+ *   degree    - degree of each node
+ *   num_nodes - number of nodes
+ *
+ * Return value:
+ *   None.
+ */
+static void write_degree_hist(sim_gof_t *gof, const uint_t *degree,
+                              uint_t num_nodes)
+{
+  uint_t i;
+
+  memset(gof->hist, 0, (gof->max_degree + 1) * sizeof(ulonglong_t));
+  for (i = 0; i < num_nodes; i++)
+    gof->hist[MIN(degree[i], gof->max_degree)]++;
+  write_hist(gof);
+}
+
+/*
+ * Find the root of the union-find tree containing node i, halving
+ * the path to it.
+ *
+ * Parameters:
+ *   parent - union-find forest (updated)
+ *   i      - node
+ *
+ * Return value:
+ *   Root node of the tree containing i.
+ */
+static uint_t uf_find(uint_t *parent, uint_t i)
+{
+  while (parent[i] != i) {
+    parent[i] = parent[parent[i]];
+    i = parent[i];
+  }
+  return i;
+}
+
+/*
+ * Number of nodes in the largest weakly connected component of g.
+ *
+ * Parameters:
+ *   gof - goodness-of-fit writer (union-find workspace used)
+ *   g   - digraph
+ *
+ * Return value:
+ *   Size of the giant (weak) component.
+ */
+static uint_t giant_component_size(sim_gof_t *gof, const digraph_t *g)
+{
+  uint_t i, j, k, ri, rj, largest = 0;
+
+  for (i = 0; i < g->num_nodes; i++) {
+    gof->parent[i] = i;
+    gof->size[i] = 1;
+  }
+  for (i = 0; i < g->num_nodes; i++) {
+    for (k = 0; k < g->outdegree[i]; k++) {
+      j = g->arclist[i][k];
+      ri = uf_find(gof->parent, i);
+      rj = uf_find(gof->parent, j);
+      if (ri == rj)
+        continue;
+      if (gof->size[ri] < gof->size[rj]) {
+        gof->parent[ri] = rj;
+        gof->size[rj] += gof->size[ri];
+      } else {
+        gof->parent[rj] = ri;
+        gof->size[ri] += gof->size[rj];
+      }
+    }
+  }
+  for (i = 0; i < g->num_nodes; i++)
+    if (gof->parent[i] == i && gof->size[i] > largest)
+      largest = gof->size[i];
+  return largest;
+}
+
+/*
+ * Code for the arcs between the nodes of a triad: the sum of 1 for
+ * v->u, 2 for u->v, 4 for v->w, 8 for w->v, 16 for u->w and 32 for
+ * w->u, whose type is TRIAD_CODE_TYPE[code].
+ *
+ * Parameters:
+ *   g       - digraph
+ *   v, u, w - nodes of the triad
+ *
+ * Return value:
+ *   Triad code 0..63
+ */
+static uint_t triad_code(const digraph_t *g, uint_t v, uint_t u, uint_t w)
+{
+  return (isArc(g, v, u) ? 1 : 0) | (isArc(g, u, v) ? 2 : 0) |
+    (isArc(g, v, w) ? 4 : 0) | (isArc(g, w, v) ? 8 : 0) |
+    (isArc(g, u, w) ? 16 : 0) | (isArc(g, w, u) ? 32 : 0);
+}
+
+/*
+ * Triad census of g (Batagelj & Mrvar 2001). Each connected triad is
+ * counted once from its pair of adjacent nodes v < u for which the
+ * third node w is either greater than u, or between them and not
+ * adjacent to v; the triads with only the one dyad v, u connected are
+ * counted together, and the empty triads are what is left over.
+ *
+ * Parameters:
+ *   gof    - goodness-of-fit writer, with the CDIGRAPH_NBR lists of g
+ *            in gof->cd
+ *   g      - digraph
+ *   census - (out) number of triads of each type
+ *
+ * Return value:
+ *   None.
+ */
+static void triad_census(sim_gof_t *gof, const digraph_t *g,
+                         ulonglong_t census[SIM_GOF_NUM_TRIAD_TYPES])
+{
+  const cadj_t *nbr = &gof->cd.nbr;
+  uint_t      n = g->num_nodes;
+  uint_t      v, u, w, s, t;
+  cadj_iter_t p, a, b;
+  bool        adjacent_v;
+  ulonglong_t total, connected = 0;
+
+  memset(census, 0, SIM_GOF_NUM_TRIAD_TYPES * sizeof(ulonglong_t));
+  for (v = 0; v < n; v++) {
+    CADJ_FOR_EACH(nbr, v, p) {
+      u = p.v;
+      if (u <= v)
+        continue;
+      /* merge the neighbours of v and u (except v and u themselves) */
+      s = 0;
+      cadj_iter_init(nbr, v, &a);
+      cadj_iter_init(nbr, u, &b);
+      while (!a.done || !b.done) {
+        if (b.done || (!a.done && a.v < b.v)) {
+          w = a.v;
+          cadj_iter_next(&a);
+          adjacent_v = TRUE;
+        } else if (a.done || b.v < a.v) {
+          w = b.v;
+          cadj_iter_next(&b);
+          adjacent_v = FALSE;
+        } else {
+          w = a.v;
+          cadj_iter_next(&a);
+          cadj_iter_next(&b);
+          adjacent_v = TRUE;
+        }
+        if (w == u || w == v)
+          continue;
+        s++;
+        if (u < w || (v < w && w < u && !adjacent_v))
+          census[TRIAD_CODE_TYPE[triad_code(g, v, u, w)]]++;
+      }
+      /* triads of v, u and a node adjacent to neither */
+      census[isArc(g, v, u) && isArc(g, u, v) ? 2 : 1] += n - s - 2;
+    }
+  }
+  for (t = 1; t < SIM_GOF_NUM_TRIAD_TYPES; t++)
+    connected += census[t];
+  /* n choose 3, dividing n(n-1)/2 by 3 first so it cannot overflow
+     unless the result does */
+  total = n < 3 ? 0 : (ulonglong_t)n * (n - 1) / 2;
+  total = total / 3 * (n - 2) + total % 3 * (n - 2) / 3;
+  census[0] = total - connected;
+}
+
+/*****************************************************************************
+ *
+ * externally visible functions
+ *
+ ****************************************************************************/
+
+/*
+ * Create a goodness-of-fit statistics file and write its header.
+ *
+ * Parameters:
+ *   filename   - name of file to write (overwritten)
+ *   num_nodes  - number of nodes in the simulated networks
+ *   max_degree - last bin of degree and ESP histograms (counting
+ *                that value or more)
+ *   degree     - write in- and out-degree distributions
+ *   esp        - write edgewise shared partner distribution
+ *   components - write size of giant component
+ *   triads     - write triad census
+ *
+ * Return value:
+ *   Goodness-of-fit writer, or NULL on error (message printed to
+ *   stderr).
+ */
+sim_gof_t *open_sim_gof(const char *filename, uint_t num_nodes,
+                        uint_t max_degree, bool degree, bool esp,
+                        bool components, bool triads)
+{
+  sim_gof_t *gof = (sim_gof_t *)safe_calloc(1, sizeof(sim_gof_t));
+  uint_t     k, t;
+
+  strncpy(gof->filename, filename, sizeof(gof->filename) - 1);
+  if (!(gof->fp = fopen(filename, "w"))) {
+    fprintf(stderr, "ERROR: could not open file %s for writing (%s)\n",
+            filename, strerror(errno));
+    free(gof);
+    return NULL;
+  }
+  gof->max_degree = max_degree;
+  gof->degree = degree;
+  gof->esp = esp;
+  gof->components = components;
+  gof->triads = triads;
+  gof->hist = (ulonglong_t *)safe_calloc((size_t)max_degree + 1,
+                                         sizeof(ulonglong_t));
+  if (components) {
+    gof->parent = (uint_t *)safe_malloc(num_nodes * sizeof(uint_t));
+    gof->size = (uint_t *)safe_malloc(num_nodes * sizeof(uint_t));
+  }
+
+  fprintf(gof->fp, "t");
+  if (degree) {
+    for (k = 0; k <= max_degree; k++)
+      fprintf(gof->fp, " InDegree%u", k);
+    for (k = 0; k <= max_degree; k++)
+      fprintf(gof->fp, " OutDegree%u", k);
+  }
+  if (esp)
+    for (k = 0; k <= max_degree; k++)
+      fprintf(gof->fp, " ESP%u", k);
+  fprintf(gof->fp, " Reciprocity");
+  if (components)
+    fprintf(gof->fp, " GiantComponent");
+  if (triads)
+    for (t = 0; t < SIM_GOF_NUM_TRIAD_TYPES; t++)
+      fprintf(gof->fp, " Triad%s", TRIAD_NAMES[t]);
+  if (fprintf(gof->fp, "\n") < 0)
+    gof->error = TRUE;
+  return gof;
+}
+
+/*
+ * Write the goodness-of-fit statistics of a sample network.
+ *
+ * Parameters:
+ *   gof       - goodness-of-fit writer
+ *   g         - the sample network, with two-path tables
+ *   iteration - sampler iteration of the sample
+ *
+ * Return value:
+ *   0 if OK else nonzero on error (message printed to stderr).
+ */
+int write_sim_gof_sample(sim_gof_t *gof, const digraph_t *g,
+                         ulonglong_t iteration)
+{
+  ulonglong_t census[SIM_GOF_NUM_TRIAD_TYPES];
+  ulonglong_t reciprocated = 0;
+  uint_t      i, j, k, t, lists = 0;
+  bool        esp_merge = FALSE;
+
+#ifdef TWOPATH_ADAPTIVE
+  /* without a mixed two-path table, intersect the sorted lists for the
+     ESP rather than GET_MIX2PATH_ENTRY() scanning the unsorted arclists */
+  esp_merge = gof->esp && (g->twopath_backend == TWOPATH_BACKEND_NONE ||
+                           !(g->twopath_tables & TWOPATH_TABLE_MIX));
+#endif /* TWOPATH_ADAPTIVE */
+  if (esp_merge)
+    lists |= CDIGRAPH_OUT | CDIGRAPH_IN;
+  if (gof->triads)
+    lists |= CDIGRAPH_NBR;
+  if (lists)
+    build_cdigraph(&gof->cd, g, lists);
+
+  fprintf(gof->fp, "%llu", iteration);
+  if (gof->degree) {
+    write_degree_hist(gof, g->indegree, g->num_nodes);
+    write_degree_hist(gof, g->outdegree, g->num_nodes);
+  }
+  if (gof->esp) {
+    memset(gof->hist, 0, (gof->max_degree + 1) * sizeof(ulonglong_t));
+    for (i = 0; i < g->num_nodes; i++) {
+      for (k = 0; k < g->outdegree[i]; k++) {
+        j = g->arclist[i][k];
+        gof->hist[MIN(esp_merge ?
+                      cadj_count_common(&gof->cd.out, i, &gof->cd.in, j) :
+                      GET_MIX2PATH_ENTRY(g, i, j), gof->max_degree)]++;
+      }
+    }
+    write_hist(gof);
+  }
+  for (i = 0; i < g->num_nodes; i++)
+    for (k = 0; k < g->outdegree[i]; k++)
+      if (isArc(g, g->arclist[i][k], i))
+        reciprocated++;
+  fprintf(gof->fp, " %g", g->num_arcs > 0 ?
+          (double)reciprocated / g->num_arcs : 0.0);
+  if (gof->components)
+    fprintf(gof->fp, " %u", giant_component_size(gof, g));
+  if (gof->triads) {
+    triad_census(gof, g, census);
+    for (t = 0; t < SIM_GOF_NUM_TRIAD_TYPES; t++)
+      fprintf(gof->fp, " %llu", census[t]);
+  }
+  if (fprintf(gof->fp, "\n") < 0 || fflush(gof->fp) != 0) {
+    fprintf(stderr, "ERROR: writing goodness-of-fit statistics to %s "
+            "failed (%s)\n", gof->filename, strerror(errno));
+    gof->error = TRUE;
+    return -1;
+  }
+  return 0;
+}
+
+/*
+ * Close a goodness-of-fit statistics file and free the writer.
+ *
+ * Parameters:
+ *   gof - goodness-of-fit writer
+ *
+ * Return value:
+ *   0 if OK else nonzero if any write failed (message printed to stderr).
+ */
+int close_sim_gof(sim_gof_t *gof)
+{
+  int rc;
+
+  if (fclose(gof->fp) != 0)
+    gof->error = TRUE;
+  if (gof->error)
+    fprintf(stderr, "ERROR: writing goodness-of-fit statistics to %s failed\n",
+            gof->filename);
+  rc = gof->error ? -1 : 0;
+  free(gof->hist);
+  free(gof->parent);
+  free(gof->size);
+  free_cdigraph(&gof->cd);
+  free(gof);
+  return rc;
+}
@@ -0,0 +1,70 @@
+#ifndef SIMGOF_H
+#define SIMGOF_H
+/*****************************************************************************
+ *
+ * File:    simGof.h
+ * Author:  Alex Stivala
+ * Created: October 2026
+ *
+ * Goodness-of-fit statistics of the networks sampled by SimulateERGM,
+ * computed in the simulation at each sample rather than by writing
+ * every network and reading them again in R
+ * (scripts/plotEstimNetDirectedSimFit.R).
+ *
+ * The statistics are written to a text file in the same layout as the
+ * statistics file: a header line then one line for each sample, the
+ * first column t being the sampler iteration. The columns, each group
+ * included only if selected, are:
+ *
+ *   InDegree0 .. InDegreeK    number of nodes with each in-degree, the
+ *                             last (K = max_degree) counting all nodes
+ *                             with in-degree K or more
+ *   OutDegree0 .. OutDegreeK  same for out-degree
+ *   ESP0 .. ESPK              number of arcs i->j with each number of
+ *                             edgewise shared partners (nodes k with
+ *                             i->k->j, statnet "OTP" type), from the
+ *                             two-path tables (or if there are none,
+ *                             by intersecting the sorted neighbour lists
+ *                             of the compressed adjacency); the last
+ *                             counts K or more
+ *   Reciprocity               fraction of arcs that are reciprocated
+ *                             (always included)
+ *   GiantComponent            number of nodes in the largest weakly
+ *                             connected component
+ *   Triad003 .. Triad300      triad census (16 types in the usual order)
+ *
+ ****************************************************************************/
+
+#include <stdio.h>
+#include <limits.h>
+#include "utils.h"
+#include "digraph.h"
+#include "compressedDigraph.h"
+
+#define SIM_GOF_NUM_TRIAD_TYPES 16
+
+typedef struct sim_gof_s {
+  FILE       *fp;                   /* the output file */
+  char        filename[PATH_MAX+1]; /* name of the output file */
+  uint_t      max_degree;           /* last degree / ESP histogram bin */
+  bool        degree;               /* write degree distributions */
+  bool        esp;                  /* write edgewise shared partners */
+  bool        components;           /* write giant component size */
+  bool        triads;               /* write triad census */
+  ulonglong_t *hist;                /* histogram, max_degree+1 bins */
+  uint_t     *parent;               /* union-find forest over nodes, for
+                                       the weakly connected components */
+  uint_t     *size;                 /* size of each union-find tree */
+  cdigraph_t  cd;                   /* compressed adjacency of the sample
+                                       for the triad census and ESP */
+  bool        error;                /* a write failed */
+} sim_gof_t;
+
+sim_gof_t *open_sim_gof(const char *filename, uint_t num_nodes,
+                        uint_t max_degree, bool degree, bool esp,
+                        bool components, bool triads);
+int write_sim_gof_sample(sim_gof_t *gof, const digraph_t *g,
+                         ulonglong_t iteration);
+int close_sim_gof(sim_gof_t *gof);
+
+#endif /* SIMGOF_H */
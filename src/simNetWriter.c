@@ -0,0 +1,231 @@
+/*****************************************************************************
+ *
+ * File:    simNetWriter.c
+ * Author:  Alex Stivala, Maksym Byshkin
+ * Created: October 2026
+ *
+ * Output of simulated network samples as the arcs changed between
+ * samples in one binary file (see simNetWriter.h).
+ *
+ ****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include "simNetWriter.h"
+
+/*****************************************************************************
+ *
+ * local constants
+ *
+ ****************************************************************************/
+
+#define SIMNET_MAGIC       "ENDGSIMN"  /* first 8 bytes of file (no NUL) */
+#define SIMNET_BYTE_ORDER  0x01020304U /* reads differently if swapped */
+
+/*****************************************************************************
+ *
+ * local functions
+ *
+ ****************************************************************************/
+
+/*
+ * Comparison function for qsort() of node numbers into ascending order.
+ *
+ * Parameters:
+ *   a, b - pointers to uint_t node numbers to compare
+ *
+ * Return value:
+ *   <0, 0, >0 if a is less than, equal to, or greater than b
+ */
+static int compare_uint(const void *a, const void *b)
+{
+  uint_t u = *(const uint_t *)a, v = *(const uint_t *)b;
+  return (u > v) - (u < v);
+}
+
+/*
+ * Append the arc (i, j) to the changed arcs of w.
+ *
+ * Parameters:
+ *   w           - simulated network writer
+ *   num_changes - (in/out) number of changed arcs
+ *   i, j        - the arc
+ *
+ * Return value:
+ *   None.
+ */
+static void add_change(sim_net_writer_t *w, size_t *num_changes,
+                       uint_t i, uint_t j)
+{
+  if (*num_changes == w->changes_capacity) {
+    w->changes_capacity = w->changes_capacity ? 2 * w->changes_capacity :
+      1024;
+    w->changes = (uint32_t *)safe_realloc(w->changes, 2 *
+                                          w->changes_capacity *
+                                          sizeof(uint32_t));
+  }
+  w->changes[2 * *num_changes] = i;
+  w->changes[2 * (*num_changes)++ + 1] = j;
+}
+
+/*****************************************************************************
+ *
+ * externally visible functions
+ *
+ ****************************************************************************/
+
+/*
+ * Create a simulated network file and write its header.
+ *
+ * Parameters:
+ *   filename  - name of file to write (overwritten)
+ *   num_nodes - number of nodes in the simulated networks
+ *
+ * Return value:
+ *   Simulated network writer, or NULL on error (message printed to
+ *   stderr).
+ */
+sim_net_writer_t *open_sim_net_writer(const char *filename, uint_t num_nodes)
+{
+  sim_net_writer_t *w = (sim_net_writer_t *)safe_calloc(1,
+                                                     sizeof(sim_net_writer_t));
+  uint32_t version = SIMNET_VERSION, byte_order = SIMNET_BYTE_ORDER;
+  uint64_t nodes = num_nodes;
+
+  strncpy(w->filename, filename, sizeof(w->filename) - 1);
+  if (!(w->fp = fopen(filename, "wb"))) {
+    fprintf(stderr, "ERROR: could not open file %s for writing (%s)\n",
+            filename, strerror(errno));
+    free(w);
+    return NULL;
+  }
+  w->num_nodes = num_nodes;
+  /* the previous sample starts as the empty graph */
+  w->prev_offset = (arcidx_t *)safe_calloc((size_t)num_nodes + 1,
+                                           sizeof(arcidx_t));
+  w->cur_offset = (arcidx_t *)safe_calloc((size_t)num_nodes + 1,
+                                          sizeof(arcidx_t));
+  if (fwrite(SIMNET_MAGIC, 1, 8, w->fp) != 8 ||
+      fwrite(&version, sizeof(version), 1, w->fp) != 1 ||
+      fwrite(&byte_order, sizeof(byte_order), 1, w->fp) != 1 ||
+      fwrite(&nodes, sizeof(nodes), 1, w->fp) != 1)
+    w->error = TRUE;
+  return w;
+}
+
+/*
+ * Write a sample network as the arcs changed since the previous
+ * sample (or the empty graph for the first).
+ *
+ * Parameters:
+ *   w         - simulated network writer
+ *   g         - the sample network, with the nodes in input order (not
+ *               renumbered by reorder_digraph_nodes())
+ *   iteration - sampler iteration of the sample
+ *
+ * Return value:
+ *   0 if OK else nonzero on error (message printed to stderr).
+ */
+int write_sim_net_sample(sim_net_writer_t *w, const digraph_t *g,
+                         ulonglong_t iteration)
+{
+  uint64_t  record[3];
+  size_t    num_changes = 0;
+  uint_t   *tmp;
+  arcidx_t *tmp_offset;
+  arcidx_t  p, q, pend, qend;
+  uint_t    i, k;
+
+  assert(g->num_nodes == w->num_nodes);
+  if (g->orig_node) {
+    fprintf(stderr, "ERROR: cannot write simulated network with "
+            "renumbered nodes to %s\n", w->filename);
+    return -1;
+  }
+  if (g->num_arcs > w->target_capacity) {
+    w->target_capacity = MAX(g->num_arcs, 2 * w->target_capacity);
+    w->prev_target = (uint_t *)safe_realloc(w->prev_target,
+                                            w->target_capacity *
+                                            sizeof(uint_t));
+    w->cur_target = (uint_t *)safe_realloc(w->cur_target,
+                                           w->target_capacity *
+                                           sizeof(uint_t));
+  }
+
+  /* sorted out-neighbours of each node, merged with those of the
+     previous sample to find the arcs in only one of them */
+  for (i = 0; i < g->num_nodes; i++) {
+    w->cur_offset[i + 1] = w->cur_offset[i] + g->outdegree[i];
+    for (k = 0; k < g->outdegree[i]; k++) /* nodeid_t may be narrower */
+      w->cur_target[w->cur_offset[i] + k] = g->arclist[i][k];
+    qsort(w->cur_target + w->cur_offset[i], g->outdegree[i], sizeof(uint_t),
+          compare_uint);
+    p = w->prev_offset[i];
+    pend = w->prev_offset[i + 1];
+    q = w->cur_offset[i];
+    qend = w->cur_offset[i + 1];
+    while (p < pend || q < qend) {
+      if (q == qend ||
+          (p < pend && w->prev_target[p] < w->cur_target[q])) {
+        add_change(w, &num_changes, i, w->prev_target[p++]);
+      } else if (p == pend || w->cur_target[q] < w->prev_target[p]) {
+        add_change(w, &num_changes, i, w->cur_target[q++]);
+      } else {
+        p++;
+        q++;
+      }
+    }
+  }
+  assert(w->cur_offset[g->num_nodes] == g->num_arcs);
+
+  record[0] = iteration;
+  record[1] = g->num_arcs;
+  record[2] = num_changes;
+  if (fwrite(record, sizeof(uint64_t), 3, w->fp) != 3 ||
+      fwrite(w->changes, sizeof(uint32_t), 2 * num_changes, w->fp) !=
+      2 * num_changes) {
+    fprintf(stderr, "ERROR: writing simulated network to %s failed (%s)\n",
+            w->filename, strerror(errno));
+    w->error = TRUE;
+    return -1;
+  }
+
+  tmp_offset = w->prev_offset;
+  w->prev_offset = w->cur_offset;
+  w->cur_offset = tmp_offset;
+  tmp = w->prev_target;
+  w->prev_target = w->cur_target;
+  w->cur_target = tmp;
+  return 0;
+}
+
+/*
+ * Close a simulated network file and free the writer.
+ *
+ * Parameters:
+ *   w - simulated network writer
+ *
+ * Return value:
+ *   0 if OK else nonzero if any write failed (message printed to stderr).
+ */
+int close_sim_net_writer(sim_net_writer_t *w)
+{
+  int rc;
+
+  if (fclose(w->fp) != 0)
+    w->error = TRUE;
+  if (w->error)
+    fprintf(stderr, "ERROR: writing simulated networks to %s failed\n",
+            w->filename);
+  rc = w->error ? -1 : 0;
+  free(w->prev_offset);
+  free(w->prev_target);
+  free(w->cur_offset);
+  free(w->cur_target);
+  free(w->changes);
+  free(w);
+  return rc;
+}
@@ -0,0 +1,70 @@
+#ifndef SIMNETWRITER_H
+#define SIMNETWRITER_H
+/*****************************************************************************
+ *
+ * File:    simNetWriter.h
+ * Author:  Alex Stivala, Maksym Byshkin
+ * Created: October 2026
+ *
+ * Output of the networks sampled by SimulateERGM in one binary file as
+ * the arcs changed since the previous sample, rather than a Pajek
+ * file for each sample. Consecutive samples usually differ in only a
+ * small fraction of their arcs, so this is much smaller and faster to
+ * write than the full arc lists. It is read by
+ * scripts/readSimulatedNetworksBinary.R.
+ *
+ * The file is in native byte order (like the snapshot files, see
+ * digraphSnapshot.h): a header
+ *
+ *   char     magic[8]     "ENDGSIMN" (no NUL)
+ *   uint32_t version      SIMNET_VERSION
+ *   uint32_t byte_order   0x01020304 (reads differently if swapped)
+ *   uint64_t num_nodes    number of nodes
+ *
+ * followed by one record for each sample:
+ *
+ *   uint64_t iteration    sampler iteration of the sample
+ *   uint64_t num_arcs     number of arcs in the sample
+ *   uint64_t num_changes  number of arcs changed since previous sample
+ *   uint32_t changes[2 * num_changes]  each changed arc as (i, j) with
+ *                         0-based node numbers, in ascending order;
+ *                         each is added if it was not in the previous
+ *                         sample, else removed. The first sample is
+ *                         relative to the empty graph (so its changes
+ *                         are all its arcs).
+ *
+ ****************************************************************************/
+
+#include <stdio.h>
+#include <limits.h>
+#include "utils.h"
+#include "digraph.h"
+
+#define SIMNET_VERSION 1 /* increment when format changes */
+
+typedef struct sim_net_writer_s {
+  FILE       *fp;                   /* the output file */
+  char        filename[PATH_MAX+1]; /* name of the output file */
+  uint_t      num_nodes;            /* number of nodes */
+  arcidx_t   *prev_offset;          /* out-neighbours of node i in the
+                                       previous sample are
+                                       prev_target[prev_offset[i]] to
+                                       prev_target[prev_offset[i+1]-1] */
+  uint_t     *prev_target;          /* ascending in each node's range */
+  arcidx_t   *cur_offset;           /* same for the sample being written */
+  uint_t     *cur_target;
+  size_t      target_capacity;      /* allocated length of each target */
+  uint32_t   *changes;              /* arcs changed since previous sample,
+                                       as (i, j) pairs (always 32 bit, not
+                                       nodepair_t, so the file format does
+                                       not depend on NODEID16) */
+  size_t      changes_capacity;     /* allocated length of changes */
+  bool        error;                /* a write failed */
+} sim_net_writer_t;
+
+sim_net_writer_t *open_sim_net_writer(const char *filename, uint_t num_nodes);
+int write_sim_net_sample(sim_net_writer_t *w, const digraph_t *g,
+                         ulonglong_t iteration);
+int close_sim_net_writer(sim_net_writer_t *w);
+
+#endif /* SIMNETWRITER_H */
@@ -52,12 +52,24 @@ const config_param_t SIM_CONFIG_PARAMS[] = {
   {"burnin",  PARAM_TYPE_UINT,     offsetof(sim_config_t, burnin),
    "number of iterations to throw away before first sample"},
 
+  {"numChains",  PARAM_TYPE_UINT,     offsetof(sim_config_t, numChains),
+   "number of chains to run in parallel, sharing the samples between them"},
+
   {"useIFDsampler", PARAM_TYPE_BOOL,    offsetof(sim_config_t, useIFDsampler),
    "use Improved Fixed Density sampler instead of basic of TNT sampler"},
   
   {"useTNTsampler", PARAM_TYPE_BOOL,    offsetof(sim_config_t, useTNTsampler),
    "use Tie-No-Tie sampler instead of basic or IFD sampler"},
 
+  {"useMTMsampler", PARAM_TYPE_BOOL,    offsetof(sim_config_t, useMTMsampler),
+   "use multiple-try Metropolis sampler instead of basic, IFD or TNT sampler"},
+
+  {"mtmTries",      PARAM_TYPE_UINT,    offsetof(sim_config_t, mtmTries),
+   "number of tries per step in multiple-try Metropolis sampler"},
+
+  {"earlyReject",   PARAM_TYPE_BOOL,    offsetof(sim_config_t, earlyReject),
+   "reject moves early using bounds on the change statistics (basic sampler)"},
+
   {"ifd_K",         PARAM_TYPE_DOUBLE,  offsetof(sim_config_t, ifd_K),
    "multiplier for auxiliary parameter step size in IFD sampler"},
 
@@ -65,6 +77,56 @@ const config_param_t SIM_CONFIG_PARAMS[] = {
    offsetof(sim_config_t, outputSimulatedNetworks),
    "output simulated networks in Pajek format"},
 
+  {"binarySimulatedNetworks", PARAM_TYPE_BOOL,
+   offsetof(sim_config_t, binarySimulatedNetworks),
+   "output simulated networks as changed arcs in one binary file"},
+
+  {"recomputeSimulatedStats", PARAM_TYPE_BOOL,
+   offsetof(sim_config_t, recomputeSimulatedStats),
+   "compute statistics of each sample from the whole simulated network"},
+
+  {"gofFile",        PARAM_TYPE_STRING,   offsetof(sim_config_t, gof_filename),
+   "goodness-of-fit statistics of each sample output filename"},
+
+  {"gofMaxDegree",   PARAM_TYPE_UINT,     offsetof(sim_config_t, gofMaxDegree),
+   "last bin (that value or more) of goodness-of-fit degree and ESP counts"},
+
+  {"gofDegree",      PARAM_TYPE_BOOL,     offsetof(sim_config_t, gofDegree),
+   "goodness-of-fit statistics include in- and out-degree distributions"},
+
+  {"gofESP",         PARAM_TYPE_BOOL,     offsetof(sim_config_t, gofESP),
+   "goodness-of-fit statistics include edgewise shared partners"},
+
+  {"gofComponents",  PARAM_TYPE_BOOL,     offsetof(sim_config_t, gofComponents),
+   "goodness-of-fit statistics include giant component size"},
+
+  {"gofTriadCensus", PARAM_TYPE_BOOL,     offsetof(sim_config_t, gofTriadCensus),
+   "goodness-of-fit statistics include triad census"},
+
+  {"minESS",         PARAM_TYPE_DOUBLE,   offsetof(sim_config_t, minESS),
+   "warn if effective sample size of any statistic is less than this"},
+
+  {"abortOnLowESS",  PARAM_TYPE_BOOL,     offsetof(sim_config_t, abortOnLowESS),
+   "stop simulation if effective sample size will be less than minESS"},
+
+  {"initialArclistFile", PARAM_TYPE_STRING,
+   offsetof(sim_config_t, initial_arclist_filename),
+   "Pajek arc list of network to start simulation from"},
+
+  {"initialSnapshotArcs", PARAM_TYPE_BOOL,
+   offsetof(sim_config_t, initialSnapshotArcs),
+   "start simulation from the arcs in snapshotFile"},
+
+  {"stateFile",      PARAM_TYPE_STRING,   offsetof(sim_config_t, state_filename),
+   "simulation chain state (from writeStateFile) to continue from"},
+
+  {"writeStateFile", PARAM_TYPE_STRING,
+   offsetof(sim_config_t, write_state_filename),
+   "simulation chain state at end output filename"},
+
+  {"thetaFile",      PARAM_TYPE_STRING,   offsetof(sim_config_t, theta_filename),
+   "table of parameter values to simulate each of (parameter sweep)"},
+
   {"binattrFile",   PARAM_TYPE_STRING,   offsetof(sim_config_t, binattr_filename),
   "binary attributes file"},
 
@@ -77,6 +139,9 @@ const config_param_t SIM_CONFIG_PARAMS[] = {
   {"setattrFile",   PARAM_TYPE_STRING,   offsetof(sim_config_t, setattr_filename),
   "set attributes file"},
 
+  {"dyadicCovariateFile", PARAM_TYPE_STRING, offsetof(sim_config_t, dyadcov_filename),
+  "dyadic covariates file"},
+
   {"statsFile",  PARAM_TYPE_STRING,  offsetof(sim_config_t, stats_filename),
    "statistics output filename"},
 
@@ -103,6 +168,64 @@ const config_param_t SIM_CONFIG_PARAMS[] = {
   {"numArcs",        PARAM_TYPE_UINT,     offsetof(sim_config_t, numArcs),
    "number of arcs for Improved Fixed Density simulation (useIFDsampler=TRUE)"},
 
+  {"maxMemoryMB",    PARAM_TYPE_UINT,     offsetof(sim_config_t, maxMemoryMB),
+   "memory limit (MB) for two-path tables when choosing lookup method"},
+
+  {"hubDegreeThreshold", PARAM_TYPE_UINT,
+   offsetof(sim_config_t, hubDegreeThreshold),
+   "degree above which nodes have neighbour hash sets (0 for never)"},
+
+  {"useArcBitMatrix", PARAM_TYPE_BOOL,  offsetof(sim_config_t, useArcBitMatrix),
+   "keep n x n bit matrix of arcs for fast arc lookup (n^2/8 bytes)"},
+
+  {"twoPathBackend", PARAM_TYPE_STRING,   offsetof(sim_config_t, twoPathBackend),
+   "two-path lookup method (auto, arrays, hashtables, hybrid, pernode, none)"},
+
+  {"hugePages",      PARAM_TYPE_STRING,   offsetof(sim_config_t, hugePages),
+   "huge pages for large two-path tables (none, transparent, explicit)"},
+
+  {"numaPolicy",     PARAM_TYPE_STRING,   offsetof(sim_config_t, numaPolicy),
+   "NUMA placement of large two-path tables (local, interleave)"},
+
+  {"numThreadsLoad", PARAM_TYPE_UINT,     offsetof(sim_config_t, numThreadsLoad),
+   "number of threads to parse attribute files and build initial graph with"},
+
+  {"seed",           PARAM_TYPE_UINT,     offsetof(sim_config_t, seed),
+   "pseudorandom number generator seed (0 for seed from time)"},
+
+  {"metricsFile",    PARAM_TYPE_STRING,   offsetof(sim_config_t, metrics_filename),
+   "timing and other metrics (JSON) output filename"},
+
+  {"snapshotFile",  PARAM_TYPE_STRING,   offsetof(sim_config_t, snapshot_filename),
+   "binary network snapshot with the nodes, attributes and zones to use"},
+
+  {"writeSnapshotFile", PARAM_TYPE_STRING, offsetof(sim_config_t, write_snapshot_filename),
+   "binary network snapshot of final simulated network output filename"},
+
+  {"dyadCacheMB", PARAM_TYPE_UINT,       offsetof(sim_config_t, dyadCacheMB),
+   "memory limit (MB) for cache of change statistics of each dyad (0 for none)"},
+
+  {"numThreadsHubUpdate", PARAM_TYPE_UINT, offsetof(sim_config_t, numThreadsHubUpdate),
+   "number of threads for two-path array updates of arcs of high degree nodes"},
+
+  {"hubUpdateDegree", PARAM_TYPE_UINT,   offsetof(sim_config_t, hubUpdateDegree),
+   "degree from which two-path array updates use numThreadsHubUpdate threads"},
+
+  {"estimationConfigFile", PARAM_TYPE_STRING, offsetof(sim_config_t, estimation_config_filename),
+   "EstimNetDirected configuration to estimate a model of each sampled network"},
+
+  {"estimationSummaryFile", PARAM_TYPE_STRING, offsetof(sim_config_t, estimation_summary_filename),
+   "estimates of each sampled network (estimationConfigFile) output filename"},
+
+  {"numThreadsEstimation", PARAM_TYPE_UINT, offsetof(sim_config_t, numThreadsEstimation),
+   "number of threads estimating the sampled networks (estimationConfigFile)"},
+
+  {"proposalTraceFile", PARAM_TYPE_STRING, offsetof(sim_config_t, proposal_trace_filename),
+   "trace of the sampler proposals (for bench_sampler -r) output filename"},
+
+  {"degreeProposalWeight", PARAM_TYPE_DOUBLE, offsetof(sim_config_t, degreeProposalWeight),
+   "weight of degree-weighted dyad proposals in the basic sampler (0 uniform)"},
+
   {STRUCT_PARAMS_STR,  PARAM_TYPE_SET,      0, /*no offset, coded explicitly*/
   "structural parameters to estimate"},
 
@@ -138,25 +261,65 @@ sim_config_t SIM_CONFIG = {
   SIM_DEFAULT_SAMPLE_SIZE,/* sampleSize */
   SIM_DEFAULT_INTERVAL,   /* interval */
   SIM_DEFAULT_BURNIN,     /* burnin */
+  1,     /* numChains */
   FALSE, /* useIFDsampler */
   FALSE, /* useTNTsampler */
+  FALSE, /* useMTMsampler */
+  DEFAULT_MTM_TRIES, /* mtmTries */
+  FALSE, /* earlyReject */
   SIM_DEFAULT_IFD_K,   /* ifd_K */
   FALSE, /* outputSimulatedNetworks */
+  FALSE, /* binarySimulatedNetworks */
+  FALSE, /* recomputeSimulatedStats */
+  NULL,  /* gof_filename */
+  SIM_DEFAULT_GOF_MAX_DEGREE, /* gofMaxDegree */
+  TRUE,  /* gofDegree */
+  TRUE,  /* gofESP */
+  TRUE,  /* gofComponents */
+  TRUE,  /* gofTriadCensus */
+  0,     /* minESS */
+  FALSE, /* abortOnLowESS */
+  NULL,  /* initial_arclist_filename */
+  FALSE, /* initialSnapshotArcs */
+  NULL,  /* state_filename */
+  NULL,  /* write_state_filename */
+  NULL,  /* theta_filename */
   NULL,  /* binattr_filename */
   NULL,  /* catattr_filename */
   NULL,  /* contattr_filename */
   NULL,  /* setattr_filename */
+  NULL,  /* dyadcov_filename */
   NULL,  /* stats_filename */
   NULL,  /* sim_net_file_prefix */
   NULL,  /* zone_filename */
   FALSE, /* useConditionalSimulation */
   FALSE, /* forbidReciprocity */
   0,     /* numArcs */
+  SIM_DEFAULT_MAX_MEMORY_MB, /* maxMemoryMB */
+  DEFAULT_HUB_DEGREE_THRESHOLD, /* hubDegreeThreshold */
+  FALSE, /* useArcBitMatrix */
+  NULL,  /* twoPathBackend */
+  NULL,  /* hugePages */
+  NULL,  /* numaPolicy */
+  1,     /* numThreadsLoad */
+  0,     /* seed */
+  NULL,  /* metrics_filename */
+  NULL,  /* snapshot_filename */
+  NULL,  /* write_snapshot_filename */
+  0,     /* dyadCacheMB */
+  1,     /* numThreadsHubUpdate */
+  DEFAULT_HUB_UPDATE_DEGREE, /* hubUpdateDegree */
+  NULL,  /* estimation_config_filename */
+  NULL,  /* estimation_summary_filename */
+  1,     /* numThreadsEstimation */
+  NULL,  /* proposal_trace_filename */
+  0,     /* degreeProposalWeight */
   {
     0,     /* num_change_stats_funcs */
     NULL,  /* change_stats_funcs */
     NULL,  /* param_names */
     NULL,  /* param_values */
+    NULL,  /* param_lambdas */
     0,     /* num_attr_change_stats_funcs */
     NULL,  /* attr_change_stats_funcs */
     NULL,  /* attr_names */
@@ -203,20 +366,59 @@ static bool SIM_CONFIG_IS_SET[] = {
   FALSE, /* sampleSize */
   FALSE, /* interval */
   FALSE, /* burnin */
+  FALSE, /* numChains */
   FALSE, /* useIFDsampler */
   FALSE, /* useTNTsampler */
+  FALSE, /* useMTMsampler */
+  FALSE, /* mtmTries */
+  FALSE, /* earlyReject */
   FALSE, /* ifd_K */
   FALSE, /* outputSimulatedNetworks */
+  FALSE, /* binarySimulatedNetworks */
+  FALSE, /* recomputeSimulatedStats */
+  FALSE, /* gof_filename */
+  FALSE, /* gofMaxDegree */
+  FALSE, /* gofDegree */
+  FALSE, /* gofESP */
+  FALSE, /* gofComponents */
+  FALSE, /* gofTriadCensus */
+  FALSE, /* minESS */
+  FALSE, /* abortOnLowESS */
+  FALSE, /* initial_arclist_filename */
+  FALSE, /* initialSnapshotArcs */
+  FALSE, /* state_filename */
+  FALSE, /* write_state_filename */
+  FALSE, /* theta_filename */
   FALSE, /* binattr_filename */
   FALSE, /* catattr_filename */
   FALSE, /* contattr_filename */
   FALSE, /* setattr_filename */
+  FALSE, /* dyadcov_filename */
   FALSE, /* stats_filename */
   FALSE, /* sim_net_file_prefix */
   FALSE, /* zone_filename */
   FALSE, /* useConditionalSimulation */
   FALSE, /* forbidReciprocity */
   FALSE, /* numArcs */
+  FALSE, /* maxMemoryMB */
+  FALSE, /* hubDegreeThreshold */
+  FALSE, /* useArcBitMatrix */
+  FALSE, /* twoPathBackend */
+  FALSE, /* hugePages */
+  FALSE, /* numaPolicy */
+  FALSE, /* numThreadsLoad */
+  FALSE, /* seed */
+  FALSE, /* metrics_filename */
+  FALSE, /* snapshot_filename */
+  FALSE, /* write_snapshot_filename */
+  FALSE, /* dyadCacheMB */
+  FALSE, /* numThreadsHubUpdate */
+  FALSE, /* hubUpdateDegree */
+  FALSE, /* estimation_config_filename */
+  FALSE, /* estimation_summary_filename */
+  FALSE, /* numThreadsEstimation */
+  FALSE, /* proposal_trace_filename */
+  FALSE, /* degreeProposalWeight */
   FALSE, /* (NOT USED) structParams */
   FALSE, /* (NOT USED) attrParams */
   FALSE, /* (NOT USED) dyadicParams */
@@ -306,9 +508,24 @@ void free_sim_config_struct(sim_config_t *config)
   free(config->catattr_filename);
   free(config->contattr_filename);
   free(config->setattr_filename);
+  free(config->dyadcov_filename);
   free(config->stats_filename);
   free(config->sim_net_file_prefix);
   free(config->zone_filename);
+  free(config->gof_filename);
+  free(config->estimation_config_filename);
+  free(config->estimation_summary_filename);
+  free(config->proposal_trace_filename);
+  free(config->initial_arclist_filename);
+  free(config->state_filename);
+  free(config->write_state_filename);
+  free(config->theta_filename);
+  free(config->metrics_filename);
+  free(config->snapshot_filename);
+  free(config->write_snapshot_filename);
+  free(config->twoPathBackend);
+  free(config->hugePages);
+  free(config->numaPolicy);
   free_param_config_struct(&config->param_config);
 }
 
@@ -25,6 +25,8 @@
 #define SIM_DEFAULT_SAMPLE_SIZE   1000    /* sampleSize */
 #define SIM_DEFAULT_INTERVAL      1000    /* interval */
 #define SIM_DEFAULT_BURNIN        1000    /* burnin */
+#define SIM_DEFAULT_MAX_MEMORY_MB 4096    /* maxMemoryMB */
+#define SIM_DEFAULT_GOF_MAX_DEGREE 30     /* gofMaxDegree */
 
 /*****************************************************************************
  *
@@ -41,20 +43,74 @@ typedef struct sim_config_s {
   uint_t sampleSize;      /* number of network samples */
   uint_t interval;        /* interval (iterations) between samples */
   uint_t burnin;          /* iterations to throw out before 1st sample */
+  uint_t numChains;       /* chains run in parallel, each in a process */
   bool   useIFDsampler;   /* Use IFD sampler instead of basic sampler */
   bool   useTNTsampler;   /* Use TNT sampler (not basic or IFD sampler) */
+  bool   useMTMsampler;   /* Use multiple-try Metropolis sampler */
+  uint_t mtmTries;        /* number of tries per step in MTM sampler */
+  bool   earlyReject;     /* reject using change statistic bounds */
   double ifd_K;           /* multiplier for aux parameter step size in IFD sampler */
   bool  outputSimulatedNetworks; /* output simulated networks  */
+  bool  binarySimulatedNetworks; /* output them in one binary file
+                                    (simNetWriter.h) not Pajek files */
+  bool  recomputeSimulatedStats; /* statistics of each sample computed
+                                    directly (graph_stats()), not summed
+                                    change statistics */
+  char *gof_filename;     /* goodness-of-fit statistics output filename
+                             (simGof.h) or NULL */
+  uint_t gofMaxDegree;    /* last bin of degree and ESP distributions */
+  bool  gofDegree;        /* goodness-of-fit in- and out-degree */
+  bool  gofESP;           /* goodness-of-fit edgewise shared partners */
+  bool  gofComponents;    /* goodness-of-fit giant component size */
+  bool  gofTriadCensus;   /* goodness-of-fit triad census */
+  double minESS;          /* warn if effective sample size of any
+                             statistic is less than this (0 for never) */
+  bool  abortOnLowESS;    /* stop simulation when ESS projected to be
+                             less than minESS */
+  char *initial_arclist_filename; /* Pajek arc list of network to start
+                                     simulation from or NULL */
+  bool  initialSnapshotArcs; /* start simulation from snapshotFile arcs */
+  char *state_filename;   /* chain state to continue from or NULL */
+  char *write_state_filename; /* chain state to write at end or NULL */
+  char *theta_filename;   /* parameter vectors to simulate or NULL */
   char *binattr_filename; /* filename of binary attributes file or NULL */
   char *catattr_filename; /* filename of categorical attributes file or NULL */
   char *contattr_filename;/* filename of continuous attributes file or NULL */
   char *setattr_filename; /* filename of set attributes file or NULL */
+  char *dyadcov_filename; /* filename of dyadic covariates file or NULL */
   char *stats_filename;   /* statistics output filename */
   char *sim_net_file_prefix; /* simulated network output filename prefix */
   char *zone_filename;    /* filename of snowball sampling zone file or NULL */
   bool  useConditionalSimulation; /*conditional simulation of snowball sample */
   bool  forbidReciprocity; /* do not allow reciprocated arcs in sampler */
   uint_t numArcs;         /* number of arcs for IFD simulation (fixed density)*/
+  uint_t maxMemoryMB;     /* memory limit (MB) for two-path tables */
+  uint_t hubDegreeThreshold; /* degree above which to use hub neighbour sets */
+  bool   useArcBitMatrix; /* keep n x n bit matrix of arcs */
+  char  *twoPathBackend;  /* two-path lookup method or NULL for auto */
+  char  *hugePages;       /* huge pages for large tables or NULL for none */
+  char  *numaPolicy;      /* NUMA placement of large tables or NULL */
+  uint_t numThreadsLoad;  /* number of threads to parse attribute files
+                             and build initial graph and its statistics */
+  uint_t seed;            /* PRNG seed, 0 to seed from time */
+  char  *metrics_filename; /* timing metrics output filename or NULL */
+  char  *snapshot_filename; /* network snapshot to load nodes from or NULL */
+  char  *write_snapshot_filename; /* network snapshot to write or NULL */
+  uint_t dyadCacheMB;     /* memory limit (MB) for dyad change statistics
+                             cache, 0 for none */
+  uint_t numThreadsHubUpdate; /* number of threads for two-path array
+                                 updates of arcs of high degree nodes */
+  uint_t hubUpdateDegree; /* degree from which they use the threads */
+  char  *estimation_config_filename; /* EstimNetDirected configuration to
+                                        estimate a model of each sample
+                                        network with, or NULL */
+  char  *estimation_summary_filename; /* estimates of each sample output
+                                         filename */
+  uint_t numThreadsEstimation; /* threads estimating the samples */
+  char  *proposal_trace_filename; /* trace of the sampler proposals to
+                                     write (see proposalTrace.h) or NULL */
+  double degreeProposalWeight; /* weight of degree-weighted dyad proposals
+                                  in the basic sampler, 0 for uniform */
 
   /*
    * values built by confiparser.c functions from parsed config settings
@@ -17,10 +17,16 @@
 #include <limits.h>
 #include "utils.h"
 #include "digraph.h"
-#include "basicSampler.h"
 #include "ifdSampler.h"
-#include "tntSampler.h"
 #include "simulation.h"
+#include "runMetrics.h"
+#include "digraphSnapshot.h"
+#include "simNetWriter.h"
+#include "simGof.h"
+#include "mcmcDiagnostics.h"
+#include "loadDigraph.h"
+#include "checkpoint.h"
+#include "largeAlloc.h"
 
 
 /*****************************************************************************
@@ -30,11 +36,102 @@
  ****************************************************************************/
 
 
+/*
+ * Choose m distinct arcs (without self-loops) uniformly at random, for
+ * an Erdos-Renyi G(n, m) random digraph. Rather than choosing random
+ * node pairs and rejecting those already chosen, each cell of the
+ * n x n adjacency matrix is taken with probability p slightly larger
+ * than m over the number of dyads, by skipping a geometrically
+ * distributed number of cells to the next one taken (so only the
+ * cells taken are visited), and then a uniform random m of them are
+ * kept (repeating with larger p in the unlikely case that fewer than
+ * m were taken). With forbidReciprocity, only cells above the
+ * diagonal are taken and each is then given a random direction.
+ *
+ * Parameters:
+ *   n                 - number of nodes
+ *   m                 - number of arcs
+ *   forbidReciprocity - if True no two arcs are reciprocal
+ *   prng              - pseudorandom number generator stream (updated)
+ *
+ * Return value:
+ *   Array of m arcs in random order (caller frees), or NULL if there
+ *   are not m possible arcs (message printed to stderr).
+ */
+static nodepair_t *sample_random_arcs(uint_t n, uint_t m,
+                                      bool forbidReciprocity, prng_t *prng)
+{
+  uint64_t    cells = (uint64_t)n * n;
+  double      dyads = forbidReciprocity ? (double)n * (n - 1) / 2 :
+                                          (double)n * (n - 1);
+  double      p, logq, u, skip;
+  uint64_t    d, t, num_taken, capacity;
+  nodepair_t *arcs, tmp;
+  uint_t      i, j;
+
+  if ((double)m > dyads) {
+    fprintf(stderr, "ERROR: numArcs = %u but there are only %.0f possible "
+            "arcs\n", m, dyads);
+    return NULL;
+  }
+  /* expected number taken is about 4 standard deviations more than m */
+  p = MIN(1, (m + 4 * sqrt((double)m) + 16) / dyads);
+  capacity = (uint64_t)(p * dyads * 1.1) + 1;
+  arcs = (nodepair_t *)safe_malloc(capacity * sizeof(nodepair_t));
+  do {
+    logq = log1p(-p);
+    num_taken = 0;
+    d = 0; /* next cell, row-major */
+    for (;;) {
+      do {
+        u = prng_urand(prng);
+      } while (u <= 0);
+      skip = floor(log(u) / logq); /* 0 when p = 1 */
+      if (skip >= (double)(cells - d))
+        break;
+      d += (uint64_t)skip;
+      i = (uint_t)(d / n);
+      j = (uint_t)(d % n);
+      d++;
+      if (i == j || (forbidReciprocity && j < i))
+        continue;
+      if (num_taken == capacity) {
+        capacity *= 2;
+        arcs = (nodepair_t *)safe_realloc(arcs,
+                                          capacity * sizeof(nodepair_t));
+      }
+      arcs[num_taken].i = i;
+      arcs[num_taken++].j = j;
+    }
+    p = MIN(1, p * 1.1);
+  } while (num_taken < m);
+
+  /* random m of those taken (in random order) by partial shuffle */
+  for (t = 0; t < m; t++) {
+    d = t + prng_int_urand64(prng, num_taken - t);
+    tmp = arcs[t];
+    arcs[t] = arcs[d];
+    arcs[d] = tmp;
+    if (forbidReciprocity && prng_int_urand(prng, 2)) {
+      i = arcs[t].i;
+      arcs[t].i = arcs[t].j;
+      arcs[t].j = i;
+    }
+  }
+  return arcs;
+}
+
 /*
  * Make an Erdos-Renyi aka Bernoulli directed random graph G(n, m)
  * with n nodes and m m edges. I.e. the m edges are placed between
  * dyads chosen uniformly at random.
  *
+ * Without conditional estimation, the arcs are chosen all at once by
+ * sample_random_arcs() and, if graph_stats() can compute all the
+ * statistics, added with build_digraph_arcs() and the statistics
+ * computed directly, rather than adding each arc in turn and summing
+ * its change statistics.
+ *
  * Parameters:
  *   g                        - digraph object. Modifed.
  *   numArcs                  - number of arcs [m in G(n,m) notation]
@@ -45,6 +142,8 @@
  *   n_attr_interaction - number of attribute interaction change stats funcs
  *   change_stats_funcs - array of pointers to change statistics functions
  *                        length is n-n_attr-n_dyadic-n_attr_interaction
+ *   lambda_values - array of lambda (decay) values corresponding to
+ *                   change_stats_funcs (used by alternating statistics)
  *   attr_change_stats_funcs - array of pointers to change statistics functions
  *                             length is n_attr
  *   dyadic_change_stats_funcs - array of pointers to dyadic change stats funcs
@@ -64,36 +163,63 @@
  *   useConditionalEstimation - if True preserve snowball sampling zone 
  *                              structure.
  *   forbidReciprocity        - if True do not allow reciprocated arcs.
- *   addChangeStats           - (Out) vector of n change stats for add moves
- *                              Allocated by caller. Assuming we start
- *                              with the empty graph, this will then
- *                              have the counts of statistics in the 
- *                              graph at the end.
+ *   dzA                      - (in/out) vector of n statistics.
+ *                              Allocated by caller, set to the values
+ *                              for the empty graph (empty_graph_stats()),
+ *                              this will then have the statistics of
+ *                              the graph at the end.
  *  theta                     - parameter values (required by 
  *                              calcChangeStats for total but value
  *                              not used here)
+ *  prng                      - pseudorandom number generator stream (updated)
+ *  ws                        - sampler workspace for n parameters
  *
  * Return value:
- *   None. The digraph parameter g is updated.
+ *   0 if OK, -1 on error (message printed to stderr). The digraph
+ *   parameter g is updated.
  */
-static void make_erdos_renyi_digraph(digraph_t *g, uint_t numArcs,
-                                     uint_t n, uint_t n_attr, uint_t n_dyadic,
-                                     uint_t n_attr_interaction,
-                                     change_stats_func_t *change_stats_funcs[],
-                                     attr_change_stats_func_t
-                                                    *attr_change_stats_funcs[],
-                                     dyadic_change_stats_func_t
-                                                 *dyadic_change_stats_funcs[],
-                                     attr_interaction_change_stats_func_t
-                                     *attr_interaction_change_stats_funcs[],
-                                     uint_t attr_indices[],
-                                     uint_pair_t attr_interaction_pair_indices[],                                     
-                                     bool useConditionalEstimation,
-                                     bool forbidReciprocity,
-                                     double addChangeStats[], double theta[])
+static int make_erdos_renyi_digraph(digraph_t *g, uint_t numArcs,
+                                    uint_t n, uint_t n_attr, uint_t n_dyadic,
+                                    uint_t n_attr_interaction,
+                                    change_stats_func_t *change_stats_funcs[],
+                                    double lambda_values[],
+                                    attr_change_stats_func_t
+                                                   *attr_change_stats_funcs[],
+                                    dyadic_change_stats_func_t
+                                                *dyadic_change_stats_funcs[],
+                                    attr_interaction_change_stats_func_t
+                                    *attr_interaction_change_stats_funcs[],
+                                    uint_t attr_indices[],
+                                    uint_pair_t attr_interaction_pair_indices[],                                     
+                                    bool useConditionalEstimation,
+                                    bool forbidReciprocity,
+                                    double dzA[], double theta[],
+                                    prng_t *prng, sampler_workspace_t *ws)
 {
   uint_t i, j, k, l;
-  double *changestats = (double *)safe_malloc(n*sizeof(double));
+  double *changestats = ws->changestats;
+  nodepair_t *arcs = NULL;
+
+  if (!useConditionalEstimation) {
+    if (!(arcs = sample_random_arcs(g->num_nodes, numArcs, forbidReciprocity,
+                                    prng)))
+      return -1;
+    if (graph_stats_supported(n, n_attr, n_dyadic, n_attr_interaction,
+                              change_stats_funcs, attr_change_stats_funcs,
+                              dyadic_change_stats_funcs,
+                              attr_interaction_change_stats_funcs)) {
+      if (g->allarcs) /* digraph reused in a parameter sweep */
+        replace_digraph_arcs(g, arcs, numArcs, FALSE);
+      else
+        build_digraph_arcs(g, arcs, numArcs);
+      free(arcs);
+      return graph_stats(g, n, n_attr, n_dyadic, n_attr_interaction,
+                         change_stats_funcs, lambda_values,
+                         attr_change_stats_funcs, dyadic_change_stats_funcs,
+                         attr_interaction_change_stats_funcs, attr_indices,
+                         attr_interaction_pair_indices, dzA);
+    }
+  }
   
   for (k = 0; k < numArcs; k++) {
     if (useConditionalEstimation) {
@@ -104,33 +230,22 @@ static void make_erdos_renyi_digraph(digraph_t *g, uint_t numArcs,
          random nodes until such a pair is found. For conditional
          estimation we also have the extra constraint that the nodes
          must be in the same wave or adjacent waves for the tie to
-         be added. */
+         be added, which sample_zone_pair() ensures. */
       do {
-        i = g->inner_nodes[int_urand(g->num_inner_nodes)];          
-        do {
-          j = g->inner_nodes[int_urand(g->num_inner_nodes)];        
-        } while (i == j);
+        sample_zone_pair(g, prng, &i, &j);
         assert(g->zone[i] < g->max_zone && g->zone[j] < g->max_zone);
-      } while (isArc(g, i, j) ||
-               (labs((long)g->zone[i] - (long)g->zone[j]) > 1));
+        assert(labs((long)g->zone[i] - (long)g->zone[j]) <= 1);
+      } while (isArc(g, i, j));
     } else {
-      /* not using conditional estimation */
-      /* Add move. Find two nodes i, j without arc i->j uniformly at
-         random. Because graph is sparse, it is not too inefficient
-         to just pick random nodes until such a pair is found */
-      do {
-        do {
-          i = int_urand(g->num_nodes);
-          do {
-            j = int_urand(g->num_nodes);
-          } while (i == j);
-        } while (isArc(g, i, j));
-      } while (forbidReciprocity && isArc(g, j, i));
+      /* not using conditional estimation, arcs chosen already */
+      i = arcs[k].i;
+      j = arcs[k].j;
     }
 
-    /* add change statistics to addChangeStats array */
+    /* add change statistics to dzA array */
     (void)calcChangeStats(g, i, j, n, n_attr, n_dyadic, n_attr_interaction,
                           change_stats_funcs,
+                          lambda_values,
                           attr_change_stats_funcs,
                           dyadic_change_stats_funcs,
                           attr_interaction_change_stats_funcs,
@@ -138,7 +253,7 @@ static void make_erdos_renyi_digraph(digraph_t *g, uint_t numArcs,
                           attr_interaction_pair_indices,
                           theta, FALSE, changestats);
     for (l = 0; l < n; l++)
-      addChangeStats[l] += changestats[l];
+      dzA[l] += changestats[l];
     
     /* actually do the move by adding the arc */
     if (useConditionalEstimation) {
@@ -147,7 +262,186 @@ static void make_erdos_renyi_digraph(digraph_t *g, uint_t numArcs,
       insertArc_allarcs(g, i, j);
     }
   }
-  free(changestats);
+  free(arcs);
+  return 0;
+}
+
+/*
+ * Compute the statistics of the initial network the simulation starts
+ * from (initialArclistFile or initialSnapshotArcs), directly with
+ * graph_stats() if it supports the model, otherwise by removing the
+ * arcs one at a time, from the last, and summing the change statistics
+ * (with the zones ignored, so that every arc counts).
+ *
+ * Parameters:
+ *   config - configuration settings
+ *   g      - digraph with the initial network
+ *   n      - number of parameters
+ *   theta  - parameter values (for calcChangeStats())
+ *   ws     - sampler workspace (changestats array used)
+ *   dzA    - (in/out) statistics of the empty graph, the statistics of
+ *            the initial network are added
+ *
+ * Return value:
+ *   None.
+ */
+static void initial_digraph_stats(const sim_config_t *config, digraph_t *g,
+                                  uint_t n, double theta[],
+                                  sampler_workspace_t *ws, double dzA[])
+{
+  const param_config_t *pc = &config->param_config;
+  double *changestats = ws->changestats;
+  arcidx_t num_arcs = g->num_arcs, k = num_arcs;
+  uint_t  l;
+  uint_t *zone = g->zone;
+
+  /* graph_stats() gives the total including the empty graph values */
+  if (graph_stats(g, n, pc->num_attr_change_stats_funcs,
+                  pc->num_dyadic_change_stats_funcs,
+                  pc->num_attr_interaction_change_stats_funcs,
+                  pc->change_stats_funcs,
+                  pc->param_lambdas,
+                  pc->attr_change_stats_funcs,
+                  pc->dyadic_change_stats_funcs,
+                  pc->attr_interaction_change_stats_funcs,
+                  pc->attr_indices,
+                  pc->attr_interaction_pair_indices,
+                  dzA) == 0)
+    return;
+  g->zone = (uint_t *)safe_calloc(g->num_nodes, sizeof(uint_t));
+  while (k-- > 0) {
+    removeArc(g, g->allarcs[k].i, g->allarcs[k].j);
+    (void)calcChangeStats(g, g->allarcs[k].i, g->allarcs[k].j, n,
+                          pc->num_attr_change_stats_funcs,
+                          pc->num_dyadic_change_stats_funcs,
+                          pc->num_attr_interaction_change_stats_funcs,
+                          pc->change_stats_funcs,
+                          pc->param_lambdas,
+                          pc->attr_change_stats_funcs,
+                          pc->dyadic_change_stats_funcs,
+                          pc->attr_interaction_change_stats_funcs,
+                          pc->attr_indices,
+                          pc->attr_interaction_pair_indices,
+                          theta, FALSE, changestats);
+    for (l = 0; l < n; l++)
+      dzA[l] += changestats[l];
+  }
+  /* removeArc() does not change allarcs, so it still has them all */
+  for (k = 0; k < num_arcs; k++)
+    insertArc(g, g->allarcs[k].i, g->allarcs[k].j);
+  free(g->zone);
+  g->zone = zone;
+}
+
+/*
+ * Read the table of parameter vectors for a parameter sweep (thetaFile).
+ * The first line is a header of column names separated by whitespace,
+ * and each following (nonblank) line has the values of the columns for
+ * one run. Every parameter of the model must have a column, named as in
+ * the statistics file header (case insensitive); other columns, such as
+ * t in a theta output file of EstimNetDirected, are ignored.
+ *
+ * Parameters:
+ *   filename - name of the file to read
+ *   names    - names of the n parameters separated by spaces
+ *   n        - number of parameters
+ *   num_rows - (out) number of parameter vectors read
+ *
+ * Return value:
+ *   Array of num_rows vectors of n parameter values (row r is
+ *   elements r*n to r*n+n-1), allocated here, or NULL on error (message
+ *   printed to stderr).
+ */
+static double *load_theta_table(const char *filename, const char *names,
+                                uint_t n, uint_t *num_rows)
+{
+#define THETA_LINE_MAX 65536
+  const char *delims = " \t\r\n";
+  char       *buf = (char *)safe_malloc(THETA_LINE_MAX);
+  char       *names_copy = safe_strdup(names);
+  char      **param_names = (char **)safe_calloc(n, sizeof(char *));
+  char       *saveptr = NULL, *token, *endptr;
+  int        *column_param = NULL; /* parameter of each column, or -1 */
+  uint_t      num_columns = 0, col, i, rows = 0;
+  double     *table = NULL;
+  FILE       *fp;
+  int         rc = 0;
+
+  for (i = 0, token = strtok_r(names_copy, " ", &saveptr); i < n && token;
+       i++, token = strtok_r(NULL, " ", &saveptr))
+    param_names[i] = token;
+  if (!(fp = fopen(filename, "r"))) {
+    fprintf(stderr, "ERROR: could not open thetaFile %s (%s)\n",
+            filename, strerror(errno));
+    rc = -1;
+  } else if (!fgets(buf, THETA_LINE_MAX, fp)) {
+    fprintf(stderr, "ERROR: no header line in thetaFile %s\n", filename);
+    rc = -1;
+  }
+  if (rc == 0) {
+    /* map each column to its parameter (by name) */
+    saveptr = NULL;
+    for (token = strtok_r(buf, delims, &saveptr); token;
+         token = strtok_r(NULL, delims, &saveptr)) {
+      column_param = (int *)safe_realloc(column_param,
+                                         (num_columns + 1) * sizeof(int));
+      column_param[num_columns] = -1;
+      for (i = 0; i < n; i++)
+        if (param_names[i] && strcasecmp(token, param_names[i]) == 0)
+          column_param[num_columns] = (int)i;
+      num_columns++;
+    }
+    for (i = 0; i < n && rc == 0; i++) {
+      for (col = 0; col < num_columns && column_param[col] != (int)i; col++)
+        /*nothing*/;
+      if (col == num_columns) {
+        fprintf(stderr, "ERROR: parameter %s has no column in thetaFile "
+                "%s\n", param_names[i] ? param_names[i] : "?", filename);
+        rc = -1;
+      }
+    }
+  }
+  /* one row of values for each run */
+  while (rc == 0 && fgets(buf, THETA_LINE_MAX, fp)) {
+    saveptr = NULL;
+    if (!(token = strtok_r(buf, delims, &saveptr)))
+      continue; /* blank line */
+    table = (double *)safe_realloc(table, (size_t)(rows + 1) * n *
+                                   sizeof(double));
+    for (col = 0; col < num_columns && rc == 0; col++) {
+      if (!token) {
+        fprintf(stderr, "ERROR: too few values in row %u of thetaFile %s\n",
+                rows + 1, filename);
+        rc = -1;
+      } else {
+        if (column_param[col] >= 0)
+          table[(size_t)rows * n + column_param[col]] = strtod(token, &endptr);
+        if (column_param[col] >= 0 && *endptr != '\0') {
+          fprintf(stderr, "ERROR: invalid value %s in row %u of thetaFile "
+                  "%s\n", token, rows + 1, filename);
+          rc = -1;
+        }
+        token = strtok_r(NULL, delims, &saveptr);
+      }
+    }
+    rows++;
+  }
+  if (rc == 0 && rows == 0) {
+    fprintf(stderr, "ERROR: no parameter values in thetaFile %s\n", filename);
+    rc = -1;
+  }
+  if (fp)
+    fclose(fp);
+  free(column_param);
+  free(param_names);
+  free(names_copy);
+  free(buf);
+  if (rc) {
+    free(table);
+    return NULL;
+  }
+  *num_rows = rows;
+  return table;
 }
 
 
@@ -164,160 +458,124 @@ static void make_erdos_renyi_digraph(digraph_t *g, uint_t numArcs,
  * Parameters:
  *   g      - (in/out) Initial digraph object (empty graph with N nodes
  *            intiially where N is number of nodes in graphs to simulate).
- *   n      - number of parameters (length of theta vector and total
- *            number of change statistics functions)
- *   n_attr - number of attribute change statistics functions
- *   n_dyadic -number of dyadic covariate change stats funcs
- *   n_attr_interaction - number of attribute interaction change stats funcs
- *   change_stats_funcs - array of pointers to change statistics functions
- *                        length is n - n_attr - n_dyadic - n_attr_interaction
- *   attr_change_stats_funcs - array of pointers to change statistics functions
- *                             length is n_attr
- *   dyadic_change_stats_funcs - array of pointers to dyadic change stats funcs
- *                             length is n_dyadic
- *   attr_interaction_change_stats_funcs - array of pointers to attribute
- *                           interaction (pair) change statistics functions.
- *                           length is n_attr_interaction.
- *   attr_indices   - array of n_attr attribute indices (index into g->binattr
- *                    or g->catattr) corresponding to attr_change_stats_funcs
- *                    E.g. for Sender effect on the first binary attribute,
- *                    attr_indices[x] = 0 and attr_change_stats_funcs[x] =
- *                    changeSender
- *   attr_interaction_pair_indices - array of n_attr_interaction pairs
- *                          of attribute inidices similar to above but
- *                          for attr_interaction_change_setats_funcs which
- *                          requires pairs of indices.
+ *   sampler - sampler for the model (with n parameters) to simulate from
  *   sample_size    - number of samples to take from ERGM simulation
  *   interval       - sampler iterations between each sample
  *   burnin         - number of iterations to discard initially 
  *   theta          - array of n parameter values corresponding to
  *                    change stats funcs. Allocated by caller.
  *                    iteration, not just every outer iteration.
- *   useIFDsampler  - if true, use the IFD sampler instead of the basic 
- *                    sampler
- *   ifd_K          - consant for multiplying IFD auxiliary parameter
- *                    (only used if useIFDsampler is True).
- *   useConditionalSimulation - if True, do conditional simulation of 
- *                              snowball network samples.
- *   forbidReciprocity - if True, constrain ERGM sampling so that reciprocated
- *                       arcs are not allowed to be created (so simulation
- *                       is conditional on no reciprocated arcs, should have
- *                       none in input observed graph).
  *   sim_net_file_prefix -  simulated network output filename prefix 
  *   dzA_outfile         - open (write) file to write dzA values to.
  *   outputSimulatedNetworks - if True write simulated networks in Pajek format.
+ *   sim_net_writer      - if not NULL, write the simulated networks to this
+ *                         (see simNetWriter.h) instead of Pajek files.
+ *   sim_gof             - if not NULL, write goodness-of-fit statistics
+ *                         of each sample to this (see simGof.h).
+ *   sim_estimator       - if not NULL, estimate a model of each sample
+ *                         network with this (see simEstimate.h).
+ *   diag                - if not NULL, add the statistics of each sample
+ *                         to these MCMC diagnostics (mcmcDiagnostics.h).
+ *   abort_min_ess       - if nonzero, stop with an error as soon as the
+ *                         effective sample size of any statistic is
+ *                         projected to be less than this after all
+ *                         samples (diag must not be NULL).
+ *   restart             - if not NULL, the chain state (from a previous
+ *                         run) that g and dzA have been set to, whose
+ *                         random stream and sampler state are restored
+ *                         here to continue the chain, with no burn-in.
+ *   recomputeStats      - if True the statistics of each sample are
+ *                         computed directly from the sample network with
+ *                         graph_stats() (which must support the model)
+ *                         before they are written, rather than just
+ *                         accumulated from the change statistics.
  *   arc_param_index     - index in theta[] parameter of Arc parameter value.
- *                         Only used for useIFDsampler=TRUE
+ *                         Only used for IFD sampler
  *   dzA               - (in/Out) vector of n change stats
  *                             Allocated by caller, set to initial graph values
- *   useTNTsampler     - use TNT sampler not IFD or basic.
  *
  * Return value:
  *   Nonzero on error, 0 if OK.
 
  *
  */
-int simulate_ergm(digraph_t *g, uint_t n, uint_t n_attr, uint_t n_dyadic,
-                  uint_t n_attr_interaction,
-                  change_stats_func_t *change_stats_funcs[],
-                  attr_change_stats_func_t *attr_change_stats_funcs[],
-                  dyadic_change_stats_func_t *dyadic_change_stats_funcs[],
-                  attr_interaction_change_stats_func_t
-                  *attr_interaction_change_stats_funcs[],
-                  uint_t attr_indices[],
-                  uint_pair_t attr_interaction_pair_indices[],
+int simulate_ergm(digraph_t *g, sampler_t *sampler,
                   uint_t sample_size, uint_t interval, uint_t burnin,
                   double theta[],
-                  bool useIFDsampler, double ifd_K,
-                  bool useConditionalSimulation,
-                  bool forbidReciprocity,
                   char *sim_net_file_prefix,
                   FILE *dzA_outfile,
                   bool outputSimulatedNetworks,
+                  sim_net_writer_t *sim_net_writer,
+                  sim_gof_t *sim_gof,
+                  sim_estimator_t *sim_estimator,
+                  mcmc_diag_t *diag,
+                  double abort_min_ess,
+                  const ee_checkpoint_t *restart,
+                  bool recomputeStats,
                   uint_t arc_param_index,
-                  double dzA[],
-		  bool useTNTsampler)
+                  double dzA[])
 {
+  const sampler_model_t *model = sampler->model;
   FILE          *sim_outfile;
   char           sim_outfilename[PATH_MAX+1];
   double acceptance_rate = 0;
-  double *addChangeStats = (double *)safe_malloc(n*sizeof(double));
-  double *delChangeStats = (double *)safe_malloc(n*sizeof(double));
-  double dzArc; /* only used for IFD sampler */
-  double ifd_aux_param;  /* auxiliary parameter for IFD sampler */
+  uint_t n = sampler->model->n;
+  double *addChangeStats = sampler->ws->addChangeStats;
+  double *delChangeStats = sampler->ws->delChangeStats;
+  double ifd_aux_param = 0;  /* auxiliary parameter for IFD sampler */
   uint_t l;
   uint_t      samplenum;
-  ulonglong_t iternum;
+  ulonglong_t iternum, first_iter = burnin;
   struct timeval start_timeval, end_timeval, elapsed_timeval;
   int            etime;
   char           suffix[16]; /* only has to be large enough for "_x.txt" 
                                 where fx is iteration number */
 
-  assert(!(useIFDsampler && useTNTsampler));
-  
-  if (useIFDsampler)
+  if (sampler->type == SAMPLER_IFD)
     ifd_aux_param = theta[arc_param_index] + arcCorrection(g);
-  
+  set_change_stats_caches(g, n - model->n_attr - model->n_dyadic -
+                          model->n_attr_interaction,
+                          model->change_stats_funcs, model->lambda_values,
+                          model->n_attr, model->attr_change_stats_funcs,
+                          model->attr_indices, model->n_attr_interaction,
+                          model->attr_interaction_change_stats_funcs,
+                          model->attr_interaction_pair_indices);
+  sampler_init(sampler, g, ifd_aux_param);
+  if (restart) {
+    *sampler->prng = restart->prng;
+    if (sampler->ops->state_size > 0)
+      memcpy(sampler->state, restart->sampler_state,
+             sampler->ops->state_size);
+    first_iter = restart->iterations;
+    burnin = 0; /* already done by the chain */
+    printf("continuing chain from iteration %llu\n", first_iter);
+  }
 
   printf("sampleSize = %u, interval = %u burnin = %u\n",
          sample_size, interval, burnin);
-  if (useIFDsampler)
+  if (sampler->type == SAMPLER_IFD)
     printf("IFD sampler ifd_K = %g initial auxiliary parameter V = %g\n",
-           ifd_K, ifd_aux_param);
-  else if (useTNTsampler)
+           sampler->options.ifd_K, ifd_aux_param);
+  else if (sampler->type == SAMPLER_TNT)
     printf("TNT sampler\n");
-  if (useConditionalSimulation)
+  else if (sampler->type == SAMPLER_MTM)
+    printf("MTM sampler mtmTries = %u\n", sampler->options.mtm_tries);
+  else if (sampler->options.earlyReject)
+    printf("basic sampler with early rejection\n");
+  if (sampler->type == SAMPLER_BASIC &&
+      sampler->options.degreeProposalWeight > 0)
+    printf("degree-weighted dyad proposals degreeProposalWeight = %g\n",
+           sampler->options.degreeProposalWeight);
+  if (sampler->options.useConditionalEstimation)
     printf("Doing conditional simulation of snowball sample\n");
-  if (forbidReciprocity)
+  if (sampler->options.forbidReciprocity)
     printf("Simulation is conditional on no reciprocated arcs\n");
 
   if (burnin > 0) {
     gettimeofday(&start_timeval, NULL);
-    if (useIFDsampler) {
-      acceptance_rate = ifdSampler(g, n, n_attr, n_dyadic, n_attr_interaction,
-                                   change_stats_funcs, 
-                                   attr_change_stats_funcs,
-                                   dyadic_change_stats_funcs,
-                                   attr_interaction_change_stats_funcs,
-                                   attr_indices,
-                                   attr_interaction_pair_indices,
-                                   theta,
-                                   addChangeStats, delChangeStats, burnin,
-                                   TRUE, /*actually do moves */
-                                   ifd_K, &dzArc, &ifd_aux_param,
-                                   useConditionalSimulation,
-                                   forbidReciprocity);
-    } else if (useTNTsampler) {
-      acceptance_rate = tntSampler(g, n, n_attr, n_dyadic,
-				   n_attr_interaction,
-				   change_stats_funcs, 
-				   attr_change_stats_funcs,
-				   dyadic_change_stats_funcs,
-				   attr_interaction_change_stats_funcs,
-				   attr_indices,
-				   attr_interaction_pair_indices,
-				   theta,
-				   addChangeStats, delChangeStats,
-				   burnin,
-				   TRUE,/*actually do moves*/
-				   useConditionalSimulation,
-				   forbidReciprocity);
-    } else {
-      acceptance_rate = basicSampler(g, n, n_attr, n_dyadic,
-                                     n_attr_interaction,
-                                     change_stats_funcs, 
-                                     attr_change_stats_funcs,
-                                     dyadic_change_stats_funcs,
-                                     attr_interaction_change_stats_funcs,
-                                     attr_indices,
-                                     attr_interaction_pair_indices,
-                                     theta,
-                                     addChangeStats, delChangeStats,
-                                     burnin,
-                                     TRUE,/*actually do moves*/
-                                     useConditionalSimulation,
-                                     forbidReciprocity);
-    }
+    acceptance_rate = sampler_run(sampler, g, theta,
+                                  addChangeStats, delChangeStats, burnin,
+                                  TRUE /*actually do moves */);
     for (l = 0; l < n; l++) {
       dzA[l] += addChangeStats[l] - delChangeStats[l]; /* dzA accumulates */
       /* but during burn-in we do not output these values */
@@ -329,61 +587,47 @@ int simulate_ergm(digraph_t *g, uint_t n, uint_t n_attr, uint_t n_dyadic,
   }
 
   for (samplenum = 0; samplenum < sample_size; samplenum++) {
-    if (useIFDsampler) {
-      acceptance_rate = ifdSampler(g, n, n_attr, n_dyadic, n_attr_interaction,
-                                   change_stats_funcs, 
-                                   attr_change_stats_funcs,
-                                   dyadic_change_stats_funcs,
-                                   attr_interaction_change_stats_funcs,
-                                   attr_indices,
-                                   attr_interaction_pair_indices,
-                                   theta,
-                                   addChangeStats, delChangeStats, interval,
-                                   TRUE, /*actually do moves */
-                                   ifd_K, &dzArc, &ifd_aux_param,
-                                   useConditionalSimulation,
-                                   forbidReciprocity);
-    } else if (useTNTsampler) {
-      acceptance_rate = tntSampler(g, n, n_attr, n_dyadic,
-				   n_attr_interaction,
-				   change_stats_funcs, 
-				   attr_change_stats_funcs,
-				   dyadic_change_stats_funcs,
-				   attr_interaction_change_stats_funcs,
-				   attr_indices,
-				   attr_interaction_pair_indices,
-				   theta,
-				   addChangeStats, delChangeStats,
-                                     interval,
-				   TRUE,/*actually do moves*/
-				   useConditionalSimulation,
-				   forbidReciprocity);
-    } else {
-      acceptance_rate = basicSampler(g, n, n_attr, n_dyadic,
-                                     n_attr_interaction,
-                                     change_stats_funcs, 
-                                     attr_change_stats_funcs,
-                                     dyadic_change_stats_funcs,
-                                     attr_interaction_change_stats_funcs,
-                                     attr_indices,
-                                     attr_interaction_pair_indices,
-                                     theta,
-                                     addChangeStats, delChangeStats,
-                                     interval,
-                                     TRUE,/*actually do moves*/
-                                     useConditionalSimulation,
-                                     forbidReciprocity);
-    }
-    iternum = burnin + interval*(samplenum+1);
-    fprintf(dzA_outfile, "%llu ", iternum);
-    for (l = 0; l < n; l++) {
+    acceptance_rate = sampler_run(sampler, g, theta,
+                                  addChangeStats, delChangeStats, interval,
+                                  TRUE /*actually do moves */);
+    iternum = first_iter + (ulonglong_t)interval*(samplenum+1);
+    for (l = 0; l < n; l++)
       dzA[l] += addChangeStats[l] - delChangeStats[l]; /* dzA accumulates */
+    if (recomputeStats &&
+        graph_stats(g, n, model->n_attr, model->n_dyadic,
+                    model->n_attr_interaction, model->change_stats_funcs,
+                    model->lambda_values, model->attr_change_stats_funcs,
+                    model->dyadic_change_stats_funcs,
+                    model->attr_interaction_change_stats_funcs,
+                    model->attr_indices, model->attr_interaction_pair_indices,
+                    dzA))
+      return -1;
+    fprintf(dzA_outfile, "%llu ", iternum);
+    for (l = 0; l < n; l++)
       fprintf(dzA_outfile, "%g ", dzA[l]);
-    }
     fprintf(dzA_outfile, "%g\n", acceptance_rate);
     fflush(dzA_outfile);
+    if (sim_gof && write_sim_gof_sample(sim_gof, g, iternum))
+      return -1;
+    if (sim_estimator && estimate_sim_sample(sim_estimator, g, iternum))
+      return -1;
+    if (diag) {
+      add_mcmc_diag_sample(diag, dzA);
+      if (abort_min_ess > 0 &&
+          mcmc_diag_low_ess(diag, abort_min_ess, sample_size, &l)) {
+        fprintf(stderr, "ERROR: effective sample size of statistic %u "
+                "(column %u of statistics file) will be less than %g "
+                "after %u of %u samples, stopping simulation (increase "
+                "interval)\n", l, l + 2, abort_min_ess, samplenum + 1,
+                sample_size);
+        return -1;
+      }
+    }
 
-    if (outputSimulatedNetworks) {
+    if (outputSimulatedNetworks && sim_net_writer) {
+      if (write_sim_net_sample(sim_net_writer, g, iternum))
+        return -1;
+    } else if (outputSimulatedNetworks) {
       strncpy(sim_outfilename, sim_net_file_prefix,
               sizeof(sim_outfilename)-1);
       sprintf(suffix, "_%llu.net", iternum);
@@ -397,24 +641,80 @@ int simulate_ergm(digraph_t *g, uint_t n, uint_t n_attr, uint_t n_dyadic,
   
   fprintf(stdout, "acceptance rate = %g\n", acceptance_rate);
 
-  free(addChangeStats);
-  free(delChangeStats);
   
   return 0;
 }
 
+/*
+ * Get the name of the output file of one chain of several run in
+ * parallel: the chain number is added with an underscore before the
+ * extension (if any) of the file name, e.g. stats.txt becomes
+ * stats_2.txt for chain 2, and a prefix (with no extension) becomes
+ * prefix_2. With only one chain the name is unchanged.
+ *
+ * Parameters:
+ *   buf        - (out) buffer for the file name
+ *   size       - size of buf
+ *   filename   - file name (or prefix) for all the chains
+ *   num_chains - number of chains
+ *   chain      - chain number (0 to num_chains-1)
+ *
+ * Return value:
+ *   buf
+ */
+char *sim_chain_filename(char *buf, size_t size, const char *filename,
+                         uint_t num_chains, uint_t chain)
+{
+  const char *dot = strrchr(filename, '.');
+  const char *slash = strrchr(filename, '/');
+  int         base_len;
+
+  if (num_chains <= 1) {
+    snprintf(buf, size, "%s", filename);
+    return buf;
+  }
+  if (!dot || (slash && dot < slash) || dot == filename ||
+      (slash && dot == slash + 1))
+    dot = filename + strlen(filename); /* no extension */
+  base_len = (int)(dot - filename);
+  snprintf(buf, size, "%.*s_%u%s", base_len, filename, chain, dot);
+  return buf;
+}
+
 /*
  * Do simulation process using basic or IFD or TNT sampler to draw samples
  * from ERGM digraph distribution.
  *
+ * With config->numChains greater than 1, this runs one of the chains
+ * (each run in its own process): the chain gets its share of the
+ * sampleSize samples (after its own burnin), and writes its own output
+ * files, named by sim_chain_filename(). The caller must have called
+ * init_prng() with the chain number, so each chain has its own
+ * pseudorandom number streams.
+ *
+ * With config->theta_filename (thetaFile) set, this is a parameter
+ * sweep: the graph, attributes and two-path tables are loaded once, and
+ * each row of parameter values in the file (every numChains-th row,
+ * starting at the chain number) is simulated in turn with all the
+ * samples, the graph being reset to its initial arcs between them. Each
+ * row uses the pseudorandom stream of its row number (so the caller
+ * must not give each chain its own task number with init_prng()) and
+ * writes its own output files, named by sim_chain_filename() with the
+ * row number.
+ *
  * Parameters:
- *   config - (in/out)configuration settings structure  - this is modified
- *            by calling build_attr_indices_from_names() etc.
+ *   config     - (in/out)configuration settings structure  - this is
+ *                modified by calling build_attr_indices_from_names() etc.
+ *   chain      - chain (or sweep process) number (0 to numChains-1)
+ *   load_attrs - function to load the node attributes into the digraph,
+ *                or NULL for load_attributes() (not used with a
+ *                snapshot)
  *
  * Return value:
  *    0 if OK else -ve value for error.
  */
-int do_simulation(sim_config_t * config)
+int do_simulation(sim_config_t *config, uint_t chain,
+                  load_attributes_func_t *load_attrs)
 {
   struct timeval start_timeval, end_timeval, elapsed_timeval;
   int            etime;
@@ -428,23 +728,185 @@ int do_simulation(sim_config_t * config)
   bool   foundArc        = FALSE;
   uint_t arc_param_index = 0;
   double *dzA = NULL;
+  prng_t  prng;
+  sampler_workspace_t *ws;
+  sampler_model_t   model;
+  sampler_options_t options;
+  sampler_t        *sampler;
+  run_metrics_t     run_metrics;
+  run_metrics_t    *metrics = config->metrics_filename ? &run_metrics : NULL;
+  sim_net_writer_t *sim_net_writer = NULL;
+  sim_gof_t        *sim_gof = NULL;
+  sim_estimator_t  *sim_estimator = NULL;
+  mcmc_diag_t       diag;
+  double            min_ess;
+  char              sim_net_filename[PATH_MAX+5]; /* prefix and ".bin" */
+  char              stats_filename[PATH_MAX+1];
+  char              gof_filename[PATH_MAX+1];
+  char              estimation_filename[PATH_MAX+1];
+  char              trace_filename[PATH_MAX+1];
+  char              sim_net_prefix[PATH_MAX+1];
+  char              snapshot_filename[PATH_MAX+1];
+  char              metrics_filename[PATH_MAX+1];
+  char              state_filename[PATH_MAX+1];
+  char              write_state_filename[PATH_MAX+1];
+  ee_checkpoint_t   state;
+  arcidx_t          expected_arcs = config->numArcs;
+  uint_t            num_chains = MAX(config->numChains, 1);
+  uint_t            sample_size;
+  bool              sweep = config->theta_filename != NULL;
+  double           *theta_table = NULL;
+  uint_t            num_runs = 1, run, num_files, file_index;
+  nodepair_t       *initial_arcs = NULL;
+  arcidx_t          num_initial_arcs = 0;
+  char             *saveptr = NULL;
+  char             *name;
+  char             *names;
+  const char      **columns = NULL;
+  uint_t            num_columns = 0;
+  int               rc;
+#ifdef TWOPATH_ADAPTIVE
+  twopath_backend_e backend;
+#endif /* TWOPATH_ADAPTIVE */
     
 
+  init_run_metrics(metrics);
   if (!config->stats_filename) {
     fprintf(stderr, "ERROR: statistics output filename statsFile not set\n");
     return -1;
   }
+  if (config->estimation_config_filename &&
+      !config->estimation_summary_filename) {
+    fprintf(stderr, "ERROR: estimationConfigFile requires "
+            "estimationSummaryFile\n");
+    return -1;
+  }
+  if (!load_attrs)
+    load_attrs = load_attributes;
+  if (sweep && config->state_filename) {
+    fprintf(stderr, "ERROR: stateFile cannot be used with thetaFile\n");
+    return -1;
+  }
+  if (config->state_filename)
+    sim_chain_filename(state_filename, sizeof(state_filename),
+                       config->state_filename, num_chains, chain);
+  if (sweep) {
+    /* each row of thetaFile is simulated with all the samples */
+    sample_size = config->sampleSize;
+  } else {
+    /* each chain has its share of the samples */
+    sample_size = config->sampleSize / num_chains +
+      (chain < config->sampleSize % num_chains ? 1 : 0);
+    if (num_chains > 1)
+      printf("chain %u of %u: %u samples\n", chain, num_chains, sample_size);
+  }
+
+  if (config->seed != 0) /* reproducible run instead of seed from time */
+    set_prng_seed(config->seed);
+  prng_init_stream(&prng, 0);
+
+  if (huge_pages_from_name(config->hugePages) == HUGE_PAGES_INVALID) {
+    fprintf(stderr, "ERROR: unknown hugePages %s (must be none, "
+            "transparent, or explicit)\n", config->hugePages);
+    return -1;
+  }
+  if (numa_policy_from_name(config->numaPolicy) == NUMA_POLICY_INVALID) {
+    fprintf(stderr, "ERROR: unknown numaPolicy %s (must be local or "
+            "interleave)\n", config->numaPolicy);
+    return -1;
+  }
+  set_large_alloc_policy(huge_pages_from_name(config->hugePages),
+                         numa_policy_from_name(config->numaPolicy));
+#ifdef TWOPATH_ADAPTIVE
+  backend = twopath_backend_from_name(config->twoPathBackend);
+  if (backend == TWOPATH_BACKEND_INVALID) {
+    fprintf(stderr, "ERROR: unknown twoPathBackend %s (must be auto, arrays, "
+            "hashtables, hybrid, pernode, or none)\n", config->twoPathBackend);
+    return -1;
+  }
+#endif /* TWOPATH_ADAPTIVE */
   
-  g = allocate_digraph(config->numNodes);
-  if (load_attributes(g, config->binattr_filename,
-                      config->catattr_filename,
-                      config->contattr_filename,
-                      config->setattr_filename)) {
+  if (config->snapshot_filename) {
+    /* only the nodes, attributes and zones of the snapshot are used,
+       the simulation starts from the empty graph as usual unless
+       initialSnapshotArcs is set */
+    if (config->binattr_filename || config->catattr_filename ||
+        config->contattr_filename || config->setattr_filename ||
+        config->dyadcov_filename || config->zone_filename) {
+      fprintf(stderr, "ERROR: attribute, dyadic covariate and zone files "
+              "cannot be used with snapshotFile\n");
+      return -1;
+    }
+    if (!config->write_snapshot_filename &&
+        !config->estimation_config_filename)
+      num_columns = get_model_attribute_names(&config->param_config,
+                                              &columns);
+    g = load_digraph_snapshot(config->snapshot_filename, num_columns,
+                              columns);
+    free(columns);
+    if (!g)
+      return -1;
+    if (config->numNodes != 0 && config->numNodes != g->num_nodes) {
+      fprintf(stderr, "ERROR: numNodes is %u but snapshot %s has %u nodes\n",
+              config->numNodes, config->snapshot_filename, g->num_nodes);
+      return -1;
+    }
+  } else {
+    g = allocate_digraph(config->numNodes);
+    /* only the attribute columns the model refers to, unless they are
+       all kept for a snapshot, or for the model of estimationConfigFile */
+    if (!config->write_snapshot_filename &&
+        !config->estimation_config_filename) {
+      num_columns = get_model_attribute_names(&config->param_config,
+                                              &columns);
+      set_attribute_columns(g, num_columns, columns);
+      free(columns);
+    }
+  }
+  set_run_metrics_digraph(metrics, g);
+  set_hub_degree_threshold(g, config->hubDegreeThreshold);
+  set_arc_bitmatrix(g, config->useArcBitMatrix);
+  set_twopath_build_threads(g, config->numThreadsLoad);
+  set_twopath_update_threads(g, config->numThreadsHubUpdate,
+                             config->hubUpdateDegree);
+  if (!config->snapshot_filename &&
+      load_attrs(g, config->binattr_filename,
+                 config->catattr_filename,
+                 config->contattr_filename,
+                 config->setattr_filename,
+                 config->dyadcov_filename)) {
     fprintf(stderr, "ERROR: loading node attributes failed\n");
     return -1;
   }
 
-  if (config->zone_filename) {
+  /* the arcs of an initial network (e.g. one simulated or estimated
+     before) must be added before the zones, as in estimation */
+  if (config->initial_arclist_filename && config->initialSnapshotArcs) {
+    fprintf(stderr, "ERROR: only one of initialArclistFile and "
+            "initialSnapshotArcs may be used\n");
+    return -1;
+  }
+  if (config->initial_arclist_filename) {
+    if (!load_digraph_from_arclist_mmap(config->initial_arclist_filename, g,
+                                        FALSE, 0, 0, 0, 0, NULL, NULL, NULL,
+                                        NULL, NULL, NULL, NULL, NULL, NULL))
+      return -1;
+  } else if (config->initialSnapshotArcs) {
+    if (!config->snapshot_filename) {
+      fprintf(stderr, "ERROR: initialSnapshotArcs requires snapshotFile\n");
+      return -1;
+    }
+    if (load_digraph_snapshot_arcs(g))
+      return -1;
+  }
+
+  if (config->snapshot_filename) {
+    if (load_digraph_snapshot_zones(g)) {
+      fprintf(stderr, "ERROR: snowball sampling zones in %s are invalid\n",
+              config->snapshot_filename);
+      return -1;
+    }
+  } else if (config->zone_filename) {
     if (add_snowball_zones_to_digraph(g, config->zone_filename)) {
       fprintf(stderr, "ERROR: reading snowball sampling zones from %s failed\n",
               config->zone_filename);
@@ -454,6 +916,7 @@ int do_simulation(sim_config_t * config)
     dump_zone_info(g);
 #endif /* DEBUG_SNOWBALL */
   }
+  end_run_phase(metrics, "load", 0, 0);
   
   /* now that we have attributes loaded in g, build the attr_indices
      array in the config struct */
@@ -480,11 +943,60 @@ int do_simulation(sim_config_t * config)
   n_dyadic = config->param_config.num_dyadic_change_stats_funcs;
   n_attr_interaction = config->param_config.num_attr_interaction_change_stats_funcs;
   num_param =  n_struct + n_attr + n_dyadic + n_attr_interaction;
+
+  /* headers for statistics output file (also the parameter names) */
+  sprintf(fileheader, "t");
+  for (i = 0; i < config->param_config.num_change_stats_funcs; i++) 
+    snprintf(fileheader+strlen(fileheader), HEADER_MAX," %s", config->param_config.param_names[i]);
+  
+  for (i = 0; i < config->param_config.num_attr_change_stats_funcs; i++) 
+    snprintf(fileheader+strlen(fileheader), HEADER_MAX, " %s_%s",
+             config->param_config.attr_param_names[i],
+             config->param_config.attr_names[i]);
+  
+   for (i = 0; i < config->param_config.num_dyadic_change_stats_funcs; i++)
+     if (config->param_config.dyadic_types[i] == DYADIC_TYPE_COVARIATE)
+       snprintf(fileheader+strlen(fileheader), HEADER_MAX, " %s_%s",
+                config->param_config.dyadic_param_names[i],
+                config->param_config.dyadic_names[i]);
+     else
+       snprintf(fileheader+strlen(fileheader), HEADER_MAX, " %s",
+                config->param_config.dyadic_param_names[i]);
+
+   for (i = 0; i < config->param_config.num_attr_interaction_change_stats_funcs; i++) 
+     snprintf(fileheader+strlen(fileheader), HEADER_MAX, " %s_%s_%s",
+              config->param_config.attr_interaction_param_names[i],
+              config->param_config.attr_interaction_pair_names[i].first,
+              config->param_config.attr_interaction_pair_names[i].second);
+
+  /* the parameter values of each run of a sweep */
+  if (sweep && !(theta_table = load_theta_table(config->theta_filename,
+                                                fileheader + 1, num_param,
+                                                &num_runs)))
+    return -1;
+
+  /* the state of the chain at the end of a previous run, to continue it */
+  if (config->state_filename) {
+    if (read_ee_checkpoint(state_filename, &state))
+      return -1;
+    if (state.n != num_param || state.num_nodes != g->num_nodes) {
+      fprintf(stderr, "ERROR: state file %s does not match the "
+              "configuration\n", state_filename);
+      return -1;
+    }
+    if (state.inner_arcs != config->useConditionalSimulation) {
+      fprintf(stderr, "ERROR: state file %s does not match "
+              "useConditionalSimulation\n", state_filename);
+      return -1;
+    }
+    expected_arcs = state.num_arcs;
+  }
     
    /* Ensure that if conditional simulation is to be used, the snowball
       sampling zone structure was specified */
    if (config->useConditionalSimulation) {
-     if (!config->zone_filename) {
+     if (!config->zone_filename &&
+         !(config->snapshot_filename && digraph_snapshot_has_zones(g))) {
        fprintf(stderr,
            "ERROR: conditional simulation requested but no zones specified\n");
        return -1;
@@ -499,48 +1011,95 @@ int do_simulation(sim_config_t * config)
 
    
    /* 
-    *set parameter values from the configuration settings and write
-    *  parameters and their values to stdout 
+    *set parameter values from the configuration settings (or thetaFile
+    * for each run of a sweep) and write parameters and their values to
+    * stdout 
     */
    theta = (double *)safe_calloc(num_param, sizeof(double));
-   theta_i = 0;
-   printf("\n");
-   for (i = 0; i < config->param_config.num_change_stats_funcs; i++, theta_i++){
-     theta[theta_i] = config->param_config.param_values[i];
-     printf("%s = %g\n", config->param_config.param_names[i], theta[theta_i]);
-   }
+   if (sweep) {
+     printf("\n%u parameter vectors from thetaFile %s\n", num_runs,
+            config->theta_filename);
+   } else {
+     theta_i = 0;
+     printf("\n");
+     for (i = 0; i < config->param_config.num_change_stats_funcs; i++, theta_i++){
+       theta[theta_i] = config->param_config.param_values[i];
+       printf("%s = %g\n", config->param_config.param_names[i], theta[theta_i]);
+     }
    
-   for (i = 0; i < config->param_config.num_attr_change_stats_funcs;
-        i++, theta_i++)  {
-     theta[theta_i] = config->param_config.attr_param_values[i];
-     printf("%s_%s = %g\n", config->param_config.attr_param_names[i],
-            config->param_config.attr_names[i], theta[theta_i]);
-   }
+     for (i = 0; i < config->param_config.num_attr_change_stats_funcs;
+          i++, theta_i++)  {
+       theta[theta_i] = config->param_config.attr_param_values[i];
+       printf("%s_%s = %g\n", config->param_config.attr_param_names[i],
+              config->param_config.attr_names[i], theta[theta_i]);
+     }
    
-   for (i = 0; i < config->param_config.num_dyadic_change_stats_funcs;
-        i++, theta_i++) {
-     theta[theta_i] = config->param_config.dyadic_param_values[i];
-     printf("%s = %g\n", config->param_config.dyadic_param_names[i],
-            theta[theta_i]);
-   }
+     for (i = 0; i < config->param_config.num_dyadic_change_stats_funcs;
+          i++, theta_i++) {
+       theta[theta_i] = config->param_config.dyadic_param_values[i];
+       if (config->param_config.dyadic_types[i] == DYADIC_TYPE_COVARIATE)
+         printf("%s_%s = %g\n", config->param_config.dyadic_param_names[i],
+                config->param_config.dyadic_names[i], theta[theta_i]);
+       else
+         printf("%s = %g\n", config->param_config.dyadic_param_names[i],
+                theta[theta_i]);
+     }
    
-   for (i = 0; i < config->param_config.num_attr_interaction_change_stats_funcs;
-        i++, theta_i++)  {
-     fprintf(stderr, "TODO: initial values not implemented for interaction effects yet\n");assert(FALSE);     
-     /*TODO: theta_theta[i] = config->param_config.attr_interaction_param_values[i]; */
-     printf("%s_%s_%s = %g\n",
-            config->param_config.attr_interaction_param_names[i],
-            config->param_config.attr_interaction_pair_names[i].first,
-            config->param_config.attr_interaction_pair_names[i].second,
-            theta[theta_i]);
+     for (i = 0; i < config->param_config.num_attr_interaction_change_stats_funcs;
+          i++, theta_i++)  {
+       fprintf(stderr, "TODO: initial values not implemented for interaction effects yet\n");assert(FALSE);     
+       /*TODO: theta_theta[i] = config->param_config.attr_interaction_param_values[i]; */
+       printf("%s_%s_%s = %g\n",
+              config->param_config.attr_interaction_param_names[i],
+              config->param_config.attr_interaction_pair_names[i].first,
+              config->param_config.attr_interaction_pair_names[i].second,
+              theta[theta_i]);
+     }
+     printf("\n");
+   }
+   if (config->state_filename) {
+     for (i = 0; i < num_param; i++) {
+       if (!DOUBLE_APPROX_EQ(theta[i], state.theta[i])) {
+         fprintf(stderr, "WARNING: parameter values differ from those "
+                 "of the chain in state file %s\n", state_filename);
+         break;
+       }
+     }
    }
-   printf("\n");
 
    /* Only one sampler can be used (only binary attributes in config,
       did not include multiple options (maybe should) */
-   if (config->useIFDsampler && config->useTNTsampler) {
-     fprintf(stderr, "ERROR: Only one of the useIFDsampler and"
-	     " useTNTsampler options may be used\n");
+   if (config->useIFDsampler + config->useTNTsampler +
+       config->useMTMsampler > 1) {
+     fprintf(stderr, "ERROR: Only one of the useIFDsampler,"
+	     " useTNTsampler and useMTMsampler options may be used\n");
+     return -1;
+   }
+   if (config->mtmTries < 1) {
+     fprintf(stderr, "ERROR: mtmTries must be at least 1\n");
+     return -1;
+   }
+   if (config->degreeProposalWeight < 0 || config->degreeProposalWeight > 1) {
+     fprintf(stderr, "ERROR: degreeProposalWeight must be in [0, 1]\n");
+     return -1;
+   }
+   if (config->degreeProposalWeight > 0 &&
+       (config->useIFDsampler || config->useTNTsampler ||
+        config->useMTMsampler || config->useConditionalSimulation ||
+        config->forbidReciprocity)) {
+     fprintf(stderr, "ERROR: degreeProposalWeight can only be used with the "
+             "basic sampler, without useConditionalSimulation or "
+             "forbidReciprocity\n");
+     return -1;
+   }
+   if (config->recomputeSimulatedStats &&
+       !graph_stats_supported(num_param, n_attr, n_dyadic, n_attr_interaction,
+                              config->param_config.change_stats_funcs,
+                              config->param_config.attr_change_stats_funcs,
+                              config->param_config.dyadic_change_stats_funcs,
+                              config->param_config.attr_interaction_change_stats_funcs)) {
+     fprintf(stderr, "ERROR: recomputeSimulatedStats cannot be used as "
+             "some statistics in the model cannot be computed directly\n");
      return -1;
    }
 
@@ -561,7 +1120,14 @@ int do_simulation(sim_config_t * config)
                ARC_PARAM_STR);
        return -1;
      }
-     if (config->numArcs == 0) {
+     if (config->state_filename || g->num_arcs > 0) {
+       /* the number of arcs is that of the initial network or state */
+       if (config->numArcs != 0 && config->numArcs != expected_arcs) {
+         fprintf(stderr, "WARNING: numArcs is set to %u but the initial "
+                 "network has %lu arcs, which the IFD sampler keeps\n",
+                 config->numArcs, (unsigned long)expected_arcs);
+       }
+     } else if (config->numArcs == 0) {
        fprintf(stderr, "ERROR: must specify nonzero numArcs when "
                "using IFD sampler\n");
        return -1;
@@ -583,113 +1149,339 @@ int do_simulation(sim_config_t * config)
    }
 
 
+#ifdef TWOPATH_ADAPTIVE
+   /* choose two-path lookup method before any arcs are inserted (other
+      than those of an initial network), using numArcs (only set for
+      IFD sampler) or the arcs of the state as expected number of arcs,
+      keeping only the two-path tables the model's statistics look up */
+   set_twopath_tables(g, twopath_tables_used(
+                        config->param_config.num_change_stats_funcs,
+                        config->param_config.change_stats_funcs));
+   if (backend == TWOPATH_BACKEND_AUTO)
+     backend = choose_twopath_backend(g, expected_arcs, config->maxMemoryMB);
+   if (backend == TWOPATH_BACKEND_HYBRID)
+     set_twopath_hub_cutoff(g, choose_twopath_hub_cutoff(g,
+                                                         config->maxMemoryMB));
+   set_twopath_backend(g, backend);
+   printf("two-path lookup: %s\n", twopath_backend_name(g->twopath_backend));
+   if (g->twopath_backend != TWOPATH_BACKEND_NONE)
+     printf("two-path tables kept:%s%s%s\n",
+            g->twopath_tables & TWOPATH_TABLE_MIX ? " mix" : "",
+            g->twopath_tables & TWOPATH_TABLE_IN ? " in" : "",
+            g->twopath_tables & TWOPATH_TABLE_OUT ? " out" : "");
+   if (g->twopath_backend == TWOPATH_BACKEND_HYBRID)
+     printf("two-path hubs: nodes of degree over %u\n",
+            g->twopath_hub_cutoff);
+   end_run_phase(metrics, "twopath_build", 0, 0);
+#endif /* TWOPATH_ADAPTIVE */
+   printf("change statistics kernels: %s\n", changestats_isa_name());
+
    /* allocate change statistics array  */
    dzA = (double *)safe_calloc(num_param, sizeof(double));
-   /* set values of graph stats for empty graph; most (but not all) are zero */
-    empty_graph_stats(g, num_param, n_attr, n_dyadic,
-                      n_attr_interaction,
-                      config->param_config.change_stats_funcs,
-                      config->param_config.attr_change_stats_funcs,
-                      config->param_config.dyadic_change_stats_funcs,
-                      config->param_config.attr_interaction_change_stats_funcs,
-                      config->param_config.attr_indices,
-                      config->param_config.attr_interaction_pair_indices,
-                      dzA);
+   ws = allocate_sampler_workspace(num_param);
 
-   
-   if (config->useIFDsampler) {
-     /* Initialize the graph to random (E-R aka Bernoulli) graph with
-        specified number of arcs for fixed density simulation (IFD sampler),
-	and also for TNT sampler since it does 50% add/delete moves */
-     make_erdos_renyi_digraph(g, config->numArcs,
-                              num_param, n_attr, n_dyadic, n_attr_interaction,
-                              config->param_config.change_stats_funcs,
-                              config->param_config.attr_change_stats_funcs,
-                              config->param_config.dyadic_change_stats_funcs,
-                              config->param_config.attr_interaction_change_stats_funcs,
-                              config->param_config.attr_indices,
-                              config->param_config.attr_interaction_pair_indices,                              
-                              config->useConditionalSimulation,
-                              config->forbidReciprocity,
-                              dzA, theta);
-   } else if (config->numArcs != 0) {
-     fprintf(stderr, "WARNING: numArcs is set to %u but not using IFD sampler"
-             " so numArcs parameter is ignored\n", config->numArcs);
+   model.n = num_param;
+   model.n_attr = n_attr;
+   model.n_dyadic = n_dyadic;
+   model.n_attr_interaction = n_attr_interaction;
+   model.change_stats_funcs = config->param_config.change_stats_funcs;
+   model.lambda_values = config->param_config.param_lambdas;
+   model.attr_change_stats_funcs = config->param_config.attr_change_stats_funcs;
+   model.dyadic_change_stats_funcs =
+     config->param_config.dyadic_change_stats_funcs;
+   model.attr_interaction_change_stats_funcs =
+     config->param_config.attr_interaction_change_stats_funcs;
+   model.attr_indices = config->param_config.attr_indices;
+   model.attr_interaction_pair_indices =
+     config->param_config.attr_interaction_pair_indices;
+   options.ifd_K = config->ifd_K;
+   options.useConditionalEstimation = config->useConditionalSimulation;
+   options.forbidReciprocity = config->forbidReciprocity;
+   options.num_threads = 1;
+   options.mtm_tries = config->mtmTries;
+   options.earlyReject = config->earlyReject;
+   options.degreeProposalWeight = config->degreeProposalWeight;
+   options.partition = NULL;
+
+   /* the dyad cache is only used by the basic sampler */
+   if (config->dyadCacheMB > 0 &&
+       get_sampler_type(config->useIFDsampler, config->useTNTsampler,
+                        config->useMTMsampler) == SAMPLER_BASIC) {
+     if (set_dyad_cache(g, num_param, config->dyadCacheMB))
+       printf("dyad change statistics cache %.1f MB\n",
+              dyad_cache_bytes(g->num_nodes, num_param) / (1024.0 * 1024.0));
+     else
+       printf("(warning) dyad change statistics cache would take %.1f MB, "
+              "more than dyadCacheMB, not used\n",
+              dyad_cache_bytes(g->num_nodes, num_param) / (1024.0 * 1024.0));
    }
-   
 
-   /* Open the output file for writing */
-   if (!(dzA_outfile = fopen(config->stats_filename, "w"))) {
-     fprintf(stderr, "ERROR: could not open file %s for writing "
-             "(%s)\n", config->stats_filename, strerror(errno));
-     return -1;
+   if (sweep) {
+     /* each run of the sweep starts from the same network, the digraph
+        (with its attributes and two-path tables) being reused */
+     num_initial_arcs = config->useConditionalSimulation ?
+       g->num_inner_arcs : g->num_arcs;
+     initial_arcs = (nodepair_t *)safe_malloc((num_initial_arcs + 1) *
+                                              sizeof(nodepair_t));
+     memcpy(initial_arcs, config->useConditionalSimulation ?
+            g->allinnerarcs : g->allarcs,
+            num_initial_arcs * sizeof(nodepair_t));
+     /* the effective sample sizes are those of each run */
+     min_ess = config->minESS;
+   } else {
+     /* the effective sample sizes of the chains add up, so each needs
+        its share of minESS */
+     min_ess = config->minESS / num_chains;
    }
 
-   /* write headers for statistics output file */
-  sprintf(fileheader, "t");
-  for (i = 0; i < config->param_config.num_change_stats_funcs; i++) 
-    snprintf(fileheader+strlen(fileheader), HEADER_MAX," %s", config->param_config.param_names[i]);
-  
-  for (i = 0; i < config->param_config.num_attr_change_stats_funcs; i++) 
-    snprintf(fileheader+strlen(fileheader), HEADER_MAX, " %s_%s",
-             config->param_config.attr_param_names[i],
-             config->param_config.attr_names[i]);
-  
-   for (i = 0; i < config->param_config.num_dyadic_change_stats_funcs; i++)
-     snprintf(fileheader+strlen(fileheader), HEADER_MAX, " %s",
-              config->param_config.dyadic_param_names[i]);
+   /* without a sweep there is just one run, otherwise the rows of
+      thetaFile are divided between the numChains processes */
+   for (run = sweep ? chain : 0; run < num_runs;
+        run += sweep ? num_chains : 1) {
+     /* each chain (or row of a sweep) has its own output files */
+     num_files = sweep ? num_runs : num_chains;
+     file_index = sweep ? run : chain;
+     sim_chain_filename(stats_filename, sizeof(stats_filename),
+                        config->stats_filename, num_files, file_index);
+     sim_chain_filename(sim_net_prefix, sizeof(sim_net_prefix),
+                        config->sim_net_file_prefix, num_files, file_index);
+     if (config->write_snapshot_filename)
+       sim_chain_filename(snapshot_filename, sizeof(snapshot_filename),
+                          config->write_snapshot_filename, num_files,
+                          file_index);
+     if (config->metrics_filename)
+       sim_chain_filename(metrics_filename, sizeof(metrics_filename),
+                          config->metrics_filename, num_files, file_index);
+     if (config->gof_filename)
+       sim_chain_filename(gof_filename, sizeof(gof_filename),
+                          config->gof_filename, num_files, file_index);
+     if (config->estimation_config_filename)
+       sim_chain_filename(estimation_filename, sizeof(estimation_filename),
+                          config->estimation_summary_filename, num_files,
+                          file_index);
+     if (config->write_state_filename)
+       sim_chain_filename(write_state_filename,
+                          sizeof(write_state_filename),
+                          config->write_state_filename, num_files,
+                          file_index);
+     if (config->proposal_trace_filename)
+       sim_chain_filename(trace_filename, sizeof(trace_filename),
+                          config->proposal_trace_filename, num_files,
+                          file_index);
 
-   for (i = 0; i < config->param_config.num_attr_interaction_change_stats_funcs; i++) 
-     snprintf(fileheader+strlen(fileheader), HEADER_MAX, " %s_%s_%s",
-              config->param_config.attr_interaction_param_names[i],
-              config->param_config.attr_interaction_pair_names[i].first,
-              config->param_config.attr_interaction_pair_names[i].second);
+     if (sweep) {
+       /* the stream is the row number, so the results do not depend on
+          how the rows are divided between processes */
+       if (run != chain) {
+         init_run_metrics(metrics);
+         set_run_metrics_digraph(metrics, g);
+         replace_digraph_arcs(g, initial_arcs, num_initial_arcs,
+                              config->useConditionalSimulation);
+       }
+       prng_init_stream(&prng, run);
+       memcpy(theta, theta_table + (size_t)run * num_param,
+              num_param * sizeof(double));
+       printf("\nrun %u of %u:\n", run, num_runs);
+       names = safe_strdup(fileheader + 1);
+       name = strtok_r(names, " ", &saveptr);
+       for (i = 0; i < num_param && name; i++) {
+         printf("%s = %g\n", name, theta[i]);
+         name = strtok_r(NULL, " ", &saveptr);
+       }
+       free(names);
+       printf("\n");
+     }
 
-   fprintf(dzA_outfile,  "%s AcceptanceRate\n", fileheader);
+     /* set values of graph stats for empty graph; most (but not all) are zero */
+     empty_graph_stats(g, num_param, n_attr, n_dyadic,
+                       n_attr_interaction,
+                       config->param_config.change_stats_funcs,
+                       config->param_config.param_lambdas,
+                       config->param_config.attr_change_stats_funcs,
+                       config->param_config.dyadic_change_stats_funcs,
+                       config->param_config.attr_interaction_change_stats_funcs,
+                       config->param_config.attr_indices,
+                       config->param_config.attr_interaction_pair_indices,
+                       dzA);
 
-   print_data_summary(g);
-   print_zone_summary(g);
+     if (config->state_filename) {
+       /* continue the chain from its state, the statistics of which were
+          saved with it */
+       replace_digraph_arcs(g, state.arcs, state.num_arcs, state.inner_arcs);
+       memcpy(dzA, state.dzA, num_param * sizeof(double));
+     } else if (g->num_arcs > 0) {
+       start_run_phase(metrics);
+       initial_digraph_stats(config, g, num_param, theta, ws, dzA);
+       end_run_phase(metrics, "initial_graph", 0, 0);
+     } else if (config->useIFDsampler) {
+       start_run_phase(metrics);
+       /* Initialize the graph to random (E-R aka Bernoulli) graph with
+          specified number of arcs for fixed density simulation (IFD sampler),
+          and also for TNT sampler since it does 50% add/delete moves */
+       if (make_erdos_renyi_digraph(g, config->numArcs,
+                                num_param, n_attr, n_dyadic, n_attr_interaction,
+                                config->param_config.change_stats_funcs,
+                                config->param_config.param_lambdas,
+                                config->param_config.attr_change_stats_funcs,
+                                config->param_config.dyadic_change_stats_funcs,
+                                config->param_config.attr_interaction_change_stats_funcs,
+                                config->param_config.attr_indices,
+                                config->param_config.attr_interaction_pair_indices,
+                                config->useConditionalSimulation,
+                                config->forbidReciprocity,
+                                dzA, theta, &prng, ws))
+         return -1;
+       end_run_phase(metrics, "initial_graph", 0, 0);
+     } else if (config->numArcs != 0) {
+       fprintf(stderr, "WARNING: numArcs is set to %u but not using IFD sampler"
+               " so numArcs parameter is ignored\n", config->numArcs);
+     }
+   
+
+     /* Open the output file for writing */
+     if (!(dzA_outfile = fopen(stats_filename, "w"))) {
+       fprintf(stderr, "ERROR: could not open file %s for writing "
+               "(%s)\n", stats_filename, strerror(errno));
+       return -1;
+     }
+
+     fprintf(dzA_outfile,  "%s AcceptanceRate\n", fileheader);
+
+     print_data_summary(g);
+     print_zone_summary(g);
 
 #ifdef DEBUG_SIMULATE
-   printf("initial graph stats: ");   
-   for(i = 0; i < num_param; i++) {
-     printf("%g ", dzA[i]);
-   }
-   printf("\n");
+     printf("initial graph stats: ");   
+     for(i = 0; i < num_param; i++) {
+       printf("%g ", dzA[i]);
+     }
+     printf("\n");
 #endif
 
 
-   printf("\nrunning simulation...\n");
-   gettimeofday(&start_timeval, NULL);
+     printf("\nrunning simulation...\n");
+     gettimeofday(&start_timeval, NULL);
    
-   simulate_ergm(g, num_param, n_attr, n_dyadic, n_attr_interaction,
-                 config->param_config.change_stats_funcs,
-                 config->param_config.attr_change_stats_funcs,
-                 config->param_config.dyadic_change_stats_funcs,
-                 config->param_config.attr_interaction_change_stats_funcs,
-                 config->param_config.attr_indices,
-                 config->param_config.attr_interaction_pair_indices,
-                 config->sampleSize, config->interval, config->burnin,
-                 theta,
-                 config->useIFDsampler, config->ifd_K,
-                 config->useConditionalSimulation,
-                 config->forbidReciprocity,
-                 config->sim_net_file_prefix,
-                 dzA_outfile,
-                 config->outputSimulatedNetworks, arc_param_index,
-                 dzA, config->useTNTsampler);
-
-   gettimeofday(&end_timeval, NULL);
-   timeval_subtract(&elapsed_timeval, &end_timeval, &start_timeval);
-   etime = 1000 * elapsed_timeval.tv_sec + elapsed_timeval.tv_usec/1000;
-   printf("simulation took %.2f s\n", (double)etime/1000);
-
-   fclose(dzA_outfile);
-
-   print_data_summary(g);
+     sampler = allocate_sampler(get_sampler_type(config->useIFDsampler,
+                                                 config->useTNTsampler,
+                                                 config->useMTMsampler),
+                                &model, &options, &prng, ws);
+     if (config->state_filename &&
+         state.sampler_state_size != sampler->ops->state_size) {
+       fprintf(stderr, "ERROR: state file %s is for a different sampler\n",
+               state_filename);
+       return -1;
+     }
+     if (config->outputSimulatedNetworks && config->binarySimulatedNetworks) {
+       snprintf(sim_net_filename, sizeof(sim_net_filename), "%s.bin",
+                sim_net_prefix);
+       if (!(sim_net_writer = open_sim_net_writer(sim_net_filename,
+                                                  g->num_nodes)))
+         return -1;
+     }
+     if (config->gof_filename &&
+         !(sim_gof = open_sim_gof(gof_filename, g->num_nodes,
+                                  config->gofMaxDegree, config->gofDegree,
+                                  config->gofESP, config->gofComponents,
+                                  config->gofTriadCensus)))
+       return -1;
+     /* each chain (or row) has its own streams for the estimations */
+     if (config->estimation_config_filename &&
+         !(sim_estimator = open_sim_estimator(
+             config->estimation_config_filename, estimation_filename,
+             config->numThreadsEstimation, config->seed,
+             file_index * config->sampleSize)))
+       return -1;
+     /* the trace starts from the initial network of the run */
+     if (config->proposal_trace_filename &&
+         !(ws->trace = open_proposal_trace(trace_filename, g, num_param,
+                                           config->useConditionalSimulation)))
+       return -1;
+     init_mcmc_diag(&diag, num_param);
+     start_run_phase(metrics);
+     rc = simulate_ergm(g, sampler, sample_size, config->interval,
+                        config->burnin, theta,
+                        sim_net_prefix,
+                        dzA_outfile,
+                        config->outputSimulatedNetworks, sim_net_writer,
+                        sim_gof, sim_estimator, &diag,
+                        config->abortOnLowESS ? min_ess : 0,
+                        config->state_filename ? &state : NULL,
+                        config->recomputeSimulatedStats,
+                        arc_param_index,
+                        dzA);
+     end_run_phase(metrics, "simulation", sampler->num_proposals,
+                   sampler->num_accepted);
+     if (rc == 0 && config->write_state_filename) {
+       /* save the state of the chain so the next run can continue it */
+       ee_checkpoint_t end_state;
+       memset(&end_state, 0, sizeof(end_state));
+       end_state.num_nodes = g->num_nodes;
+       end_state.n = num_param;
+       end_state.iterations = (config->state_filename ? state.iterations :
+                               config->burnin) +
+         (ulonglong_t)config->interval * sample_size;
+       end_state.prng = *sampler->prng;
+       end_state.inner_arcs = config->useConditionalSimulation;
+       end_state.num_arcs = end_state.inner_arcs ? g->num_inner_arcs :
+         g->num_arcs;
+       end_state.arcs = end_state.inner_arcs ? g->allinnerarcs : g->allarcs;
+       end_state.sampler_state_size = sampler->ops->state_size;
+       end_state.sampler_state = sampler->state;
+       end_state.theta = theta;
+       end_state.D0 = theta; /* not used */
+       end_state.dzA = dzA;
+       if (write_ee_checkpoint(write_state_filename, &end_state))
+         rc = -1;
+     }
+     if (config->state_filename)
+       free_ee_checkpoint(&state);
+     free_sampler(sampler);
+     if (sim_net_writer && close_sim_net_writer(sim_net_writer))
+       rc = -1;
+     sim_net_writer = NULL;
+     if (sim_gof && close_sim_gof(sim_gof))
+       rc = -1;
+     sim_gof = NULL;
+     if (sim_estimator && close_sim_estimator(sim_estimator))
+       rc = -1;
+     sim_estimator = NULL;
+     if (ws->trace && close_proposal_trace(ws->trace))
+       rc = -1;
+     ws->trace = NULL;
+     if (rc == 0) {
+       printf("MCMC diagnostics of statistics:\n");
+       write_mcmc_diag_summary(stdout, &diag, fileheader + 1, min_ess);
+     }
+     free_mcmc_diag(&diag);
+     if (rc)
+       return -1;
+
+     gettimeofday(&end_timeval, NULL);
+     timeval_subtract(&elapsed_timeval, &end_timeval, &start_timeval);
+     etime = 1000 * elapsed_timeval.tv_sec + elapsed_timeval.tv_usec/1000;
+     printf("simulation took %.2f s\n", (double)etime/1000);
+     if (g->dyad_cache)
+       printf("dyad change statistics cache: %.0f hits, %.0f misses\n",
+              g->dyad_cache->hits, g->dyad_cache->misses);
+     print_memory_summary(g);
+
+     fclose(dzA_outfile);
+
+     print_data_summary(g);
+     if (config->write_snapshot_filename &&
+         write_digraph_snapshot(g, snapshot_filename, FALSE))
+       return -1;
+     if (metrics)
+       write_run_metrics(metrics_filename, metrics, "SimulateERGM",
+                         file_index, g);
+   }
      
+   free(initial_arcs);
+   free(theta_table);
    free(theta);
    free(dzA);
+   free_sampler_workspace(ws);
    free_digraph(g);
    
   return 0;
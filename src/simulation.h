@@ -11,28 +11,33 @@
 
 #include "simconfigparser.h"
 #include "changeStatisticsDirected.h"
+#include "sampler.h"
+#include "simNetWriter.h"
+#include "simGof.h"
+#include "simEstimate.h"
+#include "mcmcDiagnostics.h"
+#include "checkpoint.h"
 
-int simulate_ergm(digraph_t *g, uint_t n, uint_t n_attr, uint_t n_dyadic,
-                  uint_t n_attr_interaction,
-                  change_stats_func_t *change_stats_funcs[],
-                  attr_change_stats_func_t *attr_change_stats_funcs[],
-                  dyadic_change_stats_func_t *dyadic_change_stats_funcs[],
-                  attr_interaction_change_stats_func_t
-                  *attr_interaction_change_stats_funcs[],
-                  uint_t attr_indices[],
-                  uint_pair_t attr_interaction_pair_indices[],
+int simulate_ergm(digraph_t *g, sampler_t *sampler,
                   uint_t sample_size, uint_t interval, uint_t burnin,
                   double theta[],
-                  bool useIFDsampler, double ifd_K,
-                  bool useConditionalEstimation,
-                  bool forbidReciprocity,
                   char *sim_net_file_prefix,
                   FILE *dzA_outfile,
                   bool outputSimulatedNetworks,
+                  sim_net_writer_t *sim_net_writer,
+                  sim_gof_t *sim_gof,
+                  sim_estimator_t *sim_estimator,
+                  mcmc_diag_t *diag,
+                  double abort_min_ess,
+                  const ee_checkpoint_t *restart,
+                  bool recomputeStats,
                   uint_t arc_param_index,
-                  double addChangeStats[], bool useTNTsampler);
+                  double dzA[]);
 
-int do_simulation(sim_config_t *config);
+char *sim_chain_filename(char *buf, size_t size, const char *filename,
+                         uint_t num_chains, uint_t chain);
+int do_simulation(sim_config_t *config, uint_t chain,
+                  load_attributes_func_t *load_attrs);
 
 
 #endif /* SIMULATION_H */
@@ -0,0 +1,462 @@
+/*****************************************************************************
+ *
+ * File:    snowballSample.c
+ * Author:  Alex Stivala
+ * Created: October 2026
+ *
+ * Snowball sampling of a loaded network, keeping the zone (wave) of
+ * each sampled node, and writing the sampled network, zones and node
+ * attributes in the formats used by EstimNetDirected (see
+ * snowballSample.h).
+ *
+ ****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <limits.h>
+#include "snowballSample.h"
+
+/*****************************************************************************
+ *
+ * Local constants
+ *
+ ****************************************************************************/
+
+static const char *ATTR_DELIMS = " \t"; /* between tokens on attribute line */
+
+/*****************************************************************************
+ *
+ * Local functions
+ *
+ ****************************************************************************/
+
+/*
+ * Compare two uint_t values, for qsort().
+ */
+static int compare_uint(const void *a, const void *b)
+{
+  uint_t x = *(const uint_t *)a, y = *(const uint_t *)b;
+  return x < y ? -1 : x > y ? 1 : 0;
+}
+
+/*
+ * Open a file for writing in the output directory.
+ *
+ * Parameters:
+ *   filename  - (out) name of the file, PATH_MAX+1 chars
+ *   outputdir - output directory
+ *   name      - file name prefix (e.g. "subgraph")
+ *   samplenum - sample number, appended to name with ".txt"
+ *
+ * Return value:
+ *   File opened for writing, or NULL on error (message printed to stderr).
+ */
+static FILE *open_sample_file(char *filename, const char *outputdir,
+                              const char *name, uint_t samplenum)
+{
+  FILE *fp;
+
+  if (snprintf(filename, PATH_MAX + 1, "%s/%s%u.txt", outputdir, name,
+               samplenum) > PATH_MAX) {
+    fprintf(stderr, "ERROR: output filename too long in %s\n", outputdir);
+    return NULL;
+  }
+  if (!(fp = fopen(filename, "w")))
+    fprintf(stderr, "ERROR: could not open %s for writing (%s)\n",
+            filename, strerror(errno));
+  return fp;
+}
+
+/*
+ * Close a file written by write_snowball_sample(), checking for errors.
+ *
+ * Parameters:
+ *   fp       - file to close
+ *   filename - its name, for error messages
+ *
+ * Return value:
+ *   0 if OK else -1 on error (message printed to stderr).
+ */
+static int close_sample_file(FILE *fp, const char *filename)
+{
+  int err = ferror(fp);
+
+  err |= fclose(fp) != 0;
+  if (err) {
+    fprintf(stderr, "ERROR: writing %s failed (%s)\n", filename,
+            strerror(errno));
+    return -1;
+  }
+  return 0;
+}
+
+/*
+ * Skip the first token (node id) of a line of an attributes file of a
+ * network loaded from an edge list, and the delimiters after it.
+ *
+ * Parameters:
+ *   p   - start of line
+ *   end - end of line
+ *
+ * Return value:
+ *   Start of the rest of the line.
+ */
+static const char *skip_id_token(const char *p, const char *end)
+{
+  while (p < end && !strchr(ATTR_DELIMS, *p))
+    p++;
+  while (p < end && strchr(ATTR_DELIMS, *p))
+    p++;
+  return p;
+}
+
+/*
+ * Write the lines of an attributes file of the network for the sampled
+ * nodes, in the order of the sample, with the header line. For a
+ * network loaded from an edge list the lines start with the node id
+ * (see load_attributes()), which is removed, as the sampled network is
+ * written as a Pajek arc list with the attribute lines in node order.
+ *
+ * Parameters:
+ *   g            - digraph sampled from
+ *   sample       - snowball sample
+ *   work         - position in sample of each sampled node, else
+ *                  SNOWBALL_NOT_SAMPLED
+ *   in_filename  - attributes file of g
+ *   out_filename - file to write (overwritten)
+ *
+ * Return value:
+ *   0 if OK else -1 on error (message printed to stderr).
+ */
+static int write_sample_attributes(const digraph_t *g,
+                                   const snowball_sample_t *sample,
+                                   const uint_t work[],
+                                   const char *in_filename,
+                                   const char *out_filename)
+{
+  size_t       size;
+  bool         compressed;
+  char        *text, *endptr;
+  const char  *p, *eol, *end, *start;
+  const char **lines;
+  size_t      *lens;
+  uint_t       row = 0, v, k;
+  unsigned long long id;
+  FILE        *fp;
+  int          rc = 0;
+
+  if (!(text = map_input_file(in_filename, &size, &compressed))) {
+    fprintf(stderr, "ERROR: could not read attributes file %s\n",
+            in_filename);
+    return -1;
+  }
+  lines = (const char **)safe_calloc(sample->num_nodes, sizeof(char *));
+  lens = (size_t *)safe_calloc(sample->num_nodes, sizeof(size_t));
+  end = text + size;
+  if (!(eol = memchr(text, '\n', size)))
+    eol = end;
+  for (p = eol < end ? eol + 1 : end; p < end; p = eol < end ? eol + 1 : end) {
+    if (!(eol = memchr(p, '\n', (size_t)(end - p))))
+      eol = end;
+    if (eol == p || (eol == p + 1 && *p == '\r'))
+      continue; /* blank line */
+    start = p;
+    if (g->node_ids) {
+      errno = 0;
+      id = strtoull(p, &endptr, 10);
+      if (endptr == p || errno) {
+        fprintf(stderr, "ERROR: bad node id in attributes file %s\n",
+                in_filename);
+        rc = -1;
+        break;
+      }
+      v = nodeidmap_get(g->node_ids, (uint64_t)id);
+      start = skip_id_token(p, eol);
+    } else {
+      v = row++;
+    }
+    if (v < g->num_nodes && work[v] != SNOWBALL_NOT_SAMPLED) {
+      lines[work[v]] = start;
+      lens[work[v]] = (size_t)(eol - start);
+    }
+  }
+  for (k = 0; rc == 0 && k < sample->num_nodes; k++) {
+    if (!lines[k]) {
+      fprintf(stderr, "ERROR: no line for node %u in attributes file %s\n",
+              sample->nodes[k] + 1, in_filename);
+      rc = -1;
+    }
+  }
+  if (rc == 0 && !(fp = fopen(out_filename, "w"))) {
+    fprintf(stderr, "ERROR: could not open %s for writing (%s)\n",
+            out_filename, strerror(errno));
+    rc = -1;
+  }
+  if (rc == 0) {
+    eol = memchr(text, '\n', size) ? (const char *)memchr(text, '\n', size) :
+      end;
+    start = g->node_ids ? skip_id_token(text, eol) : text;
+    fwrite(start, 1, (size_t)(eol - start), fp);
+    fputc('\n', fp);
+    for (k = 0; k < sample->num_nodes; k++) {
+      fwrite(lines[k], 1, lens[k], fp);
+      fputc('\n', fp);
+    }
+    rc = close_sample_file(fp, out_filename);
+  }
+  free(lines);
+  free(lens);
+  unmap_input_file(text, size, compressed);
+  return rc;
+}
+
+/*****************************************************************************
+ *
+ * External functions
+ *
+ ****************************************************************************/
+
+/*
+ * Choose the seeds of the snowball samples: num_samples * num_seeds
+ * distinct nodes chosen uniformly at random, the first num_seeds for
+ * the first sample and so on (so no node is a seed of more than one
+ * sample).
+ *
+ * Parameters:
+ *   g           - digraph
+ *   num_samples - number of samples
+ *   num_seeds   - number of seeds in each sample
+ *   prng        - pseudorandom number stream
+ *
+ * Return value:
+ *   Array of num_samples * num_seeds nodes (to be freed by caller), or
+ *   NULL if g has fewer nodes than that (message printed to stderr).
+ */
+uint_t *snowball_seeds(const digraph_t *g, uint_t num_samples,
+                       uint_t num_seeds, prng_t *prng)
+{
+  uint64_t total = (uint64_t)num_samples * num_seeds;
+  uint_t  *perm, *seeds, k, r, tmp;
+
+  if (total > g->num_nodes) {
+    fprintf(stderr, "ERROR: %lu seeds needed but there are only %u nodes\n",
+            (unsigned long)total, g->num_nodes);
+    return NULL;
+  }
+  /* partial Fisher-Yates shuffle */
+  perm = (uint_t *)safe_malloc(MAX(g->num_nodes, 1) * sizeof(uint_t));
+  for (k = 0; k < g->num_nodes; k++)
+    perm[k] = k;
+  for (k = 0; k < total; k++) {
+    r = k + prng_int_urand(prng, g->num_nodes - k);
+    tmp = perm[k];
+    perm[k] = perm[r];
+    perm[r] = tmp;
+  }
+  seeds = (uint_t *)safe_malloc(MAX(total, 1) * sizeof(uint_t));
+  memcpy(seeds, perm, total * sizeof(uint_t));
+  free(perm);
+  return seeds;
+}
+
+/*
+ * Snowball sample from a set of seeds for a number of waves, ignoring
+ * arc directions. Each wave is found from the previous one as the
+ * frontier of a breadth-first search from all the seeds at once.
+ *
+ * Parameters:
+ *   g         - digraph to sample from
+ *   seeds     - distinct seed nodes
+ *   num_seeds - number of seeds
+ *   num_waves - number of waves
+ *   work      - work array of g->num_nodes entries, all
+ *               SNOWBALL_NOT_SAMPLED (as they are again on return)
+ *   sample    - (out) the sample, to be freed with
+ *               free_snowball_sample()
+ *
+ * Return value:
+ *   None.
+ */
+void snowball_sample(const digraph_t *g, const uint_t seeds[],
+                     uint_t num_seeds, uint_t num_waves, uint_t work[],
+                     snowball_sample_t *sample)
+{
+  uint_t  num_nodes = 0, capacity = MAX(num_seeds, 16);
+  uint_t *nodes = (uint_t *)safe_malloc(capacity * sizeof(uint_t));
+  uint_t  wave, wave_start, wave_end, k, l, u, v, deg;
+  const nodeid_t *adj;
+
+  for (k = 0; k < num_seeds; k++) {
+    assert(work[seeds[k]] == SNOWBALL_NOT_SAMPLED);
+    work[seeds[k]] = 0;
+    nodes[num_nodes++] = seeds[k];
+  }
+  wave_start = 0;
+  for (wave = 1; wave <= num_waves && wave_start < num_nodes; wave++) {
+    wave_end = num_nodes;
+    for (k = wave_start; k < wave_end; k++) {
+      u = nodes[k];
+      /* out-neighbours then in-neighbours */
+      for (adj = g->arclist[u], deg = g->outdegree[u]; adj;
+           adj = adj == g->arclist[u] ? g->revarclist[u] : NULL,
+             deg = g->indegree[u]) {
+        for (l = 0; l < deg; l++) {
+          v = adj[l];
+          if (work[v] != SNOWBALL_NOT_SAMPLED)
+            continue;
+          work[v] = wave;
+          if (num_nodes == capacity) {
+            capacity *= 2;
+            nodes = (uint_t *)safe_realloc(nodes, capacity * sizeof(uint_t));
+          }
+          nodes[num_nodes++] = v;
+        }
+      }
+    }
+    wave_start = wave_end;
+  }
+  qsort(nodes, num_nodes, sizeof(uint_t), compare_uint);
+  sample->num_nodes = num_nodes;
+  sample->nodes = nodes;
+  sample->zone = (uint_t *)safe_malloc(MAX(num_nodes, 1) * sizeof(uint_t));
+  for (k = 0; k < num_nodes; k++) {
+    sample->zone[k] = work[nodes[k]];
+    work[nodes[k]] = SNOWBALL_NOT_SAMPLED;
+  }
+}
+
+/*
+ * Free a snowball sample.
+ *
+ * Parameters:
+ *   sample - snowball sample from snowball_sample()
+ *
+ * Return value:
+ *   None.
+ */
+void free_snowball_sample(snowball_sample_t *sample)
+{
+  free(sample->nodes);
+  free(sample->zone);
+  sample->nodes = sample->zone = NULL;
+  sample->num_nodes = 0;
+}
+
+/*
+ * Write the files of a snowball sample in the output directory, with
+ * the same names and formats as scripts/snowballSample.py etc.: the
+ * sampled network as a Pajek arc list (subgraphN.txt, nodes numbered
+ * 1..n in ascending order of their node number in g), the zone of each
+ * node (subzoneN.txt), the original node number (Pajek) or id (edge
+ * list) of each node (subnodeidN.txt), and the lines of each attributes
+ * file for the sampled nodes (subactorbinN.txt, subactorcatN.txt,
+ * subactorcontN.txt, subactorsetN.txt), N being samplenum. The line
+ * for the sample description file (sampledesc.txt) is also made: the
+ * number of nodes, then the zone, arc list and attribute filenames.
+ *
+ * Parameters:
+ *   g          - digraph sampled from
+ *   sample     - snowball sample
+ *   work       - work array of g->num_nodes entries, all
+ *                SNOWBALL_NOT_SAMPLED (as they are again on return)
+ *   outputdir  - directory to write files in (which must exist)
+ *   samplenum  - sample number for filenames
+ *   attr_files - attribute files of g to write for the sample
+ *   desc_line  - (out) line for sample description file (without
+ *                newline)
+ *   desc_len   - size of desc_line buffer
+ *
+ * Return value:
+ *   0 if OK else -1 on error (message printed to stderr).
+ */
+int write_snowball_sample(const digraph_t *g, const snowball_sample_t *sample,
+                          uint_t work[], const char *outputdir,
+                          uint_t samplenum,
+                          const snowball_attr_files_t *attr_files,
+                          char *desc_line, size_t desc_len)
+{
+  static const char *attr_prefixes[] = {"subactorbin", "subactorcat",
+                                        "subactorcont", "subactorset"};
+  const char *attr_filenames[4];
+  char        filename[PATH_MAX + 1], zone_filename[PATH_MAX + 1];
+  FILE       *fp;
+  uint_t      k, l, u, v, a;
+  size_t      len;
+  int         rc = 0;
+
+  attr_filenames[0] = attr_files->binattr_filename;
+  attr_filenames[1] = attr_files->catattr_filename;
+  attr_filenames[2] = attr_files->contattr_filename;
+  attr_filenames[3] = attr_files->setattr_filename;
+  for (k = 0; k < sample->num_nodes; k++)
+    work[sample->nodes[k]] = k;
+
+  if (!(fp = open_sample_file(zone_filename, outputdir, "subzone",
+                              samplenum))) {
+    rc = -1;
+  } else {
+    fprintf(fp, "zone\n");
+    for (k = 0; k < sample->num_nodes; k++)
+      fprintf(fp, "%u\n", sample->zone[k]);
+    rc = close_sample_file(fp, zone_filename);
+  }
+
+  if (rc == 0 && !(fp = open_sample_file(filename, outputdir, "subnodeid",
+                                         samplenum))) {
+    rc = -1;
+  } else if (rc == 0) {
+    fprintf(fp, "nodeid\n");
+    for (k = 0; k < sample->num_nodes; k++)
+      fprintf(fp, "%lu\n", g->node_ids ?
+              (unsigned long)g->node_ids->ids[sample->nodes[k]] :
+              (unsigned long)sample->nodes[k] + 1);
+    rc = close_sample_file(fp, filename);
+  }
+
+  /* arc list last so its name is left in filename for desc_line */
+  for (a = 0; rc == 0 && a < 4; a++) {
+    if (!attr_filenames[a])
+      continue;
+    if (snprintf(filename, sizeof(filename), "%s/%s%u.txt", outputdir,
+                 attr_prefixes[a], samplenum) >= (int)sizeof(filename)) {
+      fprintf(stderr, "ERROR: output filename too long in %s\n", outputdir);
+      rc = -1;
+    } else {
+      rc = write_sample_attributes(g, sample, work, attr_filenames[a],
+                                   filename);
+    }
+  }
+  if (rc == 0 && !(fp = open_sample_file(filename, outputdir, "subgraph",
+                                         samplenum))) {
+    rc = -1;
+  } else if (rc == 0) {
+    fprintf(fp, "*vertices %u\n", sample->num_nodes);
+    fprintf(fp, "*arcs\n");
+    for (k = 0; k < sample->num_nodes; k++) {
+      u = sample->nodes[k];
+      for (l = 0; l < g->outdegree[u]; l++) {
+        v = g->arclist[u][l];
+        if (work[v] != SNOWBALL_NOT_SAMPLED)
+          fprintf(fp, "%u %u\n", k + 1, work[v] + 1);
+      }
+    }
+    rc = close_sample_file(fp, filename);
+  }
+
+  if (rc == 0) {
+    len = (size_t)snprintf(desc_line, desc_len, "%u %s %s",
+                           sample->num_nodes, zone_filename, filename);
+    for (a = 0; a < 4; a++) {
+      if (attr_filenames[a] && len < desc_len)
+        len += (size_t)snprintf(desc_line + len, desc_len - len,
+                                " %s/%s%u.txt", outputdir, attr_prefixes[a],
+                                samplenum);
+    }
+  }
+  for (k = 0; k < sample->num_nodes; k++)
+    work[sample->nodes[k]] = SNOWBALL_NOT_SAMPLED;
+  return rc;
+}
@@ -0,0 +1,58 @@
+#ifndef SNOWBALLSAMPLE_H
+#define SNOWBALLSAMPLE_H
+/*****************************************************************************
+ *
+ * File:    snowballSample.h
+ * Author:  Alex Stivala
+ * Created: October 2026
+ *
+ * Snowball sampling of a loaded network, keeping the zone (wave) of
+ * each sampled node, for conditional estimation
+ * (useConditionalEstimation), as done by scripts/snowballSample.py and
+ * the other snowball sampling scripts, but fast enough for networks of
+ * tens of millions of arcs.
+ *
+ * Arc directions are ignored: the seeds are zone 0, and wave w adds
+ * every node adjacent (by an arc in either direction) to a node of
+ * wave w-1 that is not already sampled, with zone w. The sampled
+ * network is the subgraph of the directed network induced by the
+ * sampled nodes.
+ *
+ * The files written for each sample are in the same formats, with the
+ * same names, as written by the scripts (see write_snowball_sample()).
+ *
+ ****************************************************************************/
+
+#include <limits.h>
+#include "utils.h"
+#include "digraph.h"
+
+#define SNOWBALL_NOT_SAMPLED UINT_MAX /* work[] value of unsampled nodes */
+
+typedef struct snowball_sample_s {
+  uint_t  num_nodes; /* number of nodes in sample */
+  uint_t *nodes;     /* the sampled nodes of the network, ascending */
+  uint_t *zone;      /* zone of each sampled node (0 for seeds) */
+} snowball_sample_t;
+
+/* attribute files of the network to write for the sampled nodes */
+typedef struct snowball_attr_files_s {
+  const char *binattr_filename;  /* binary attributes, or NULL */
+  const char *catattr_filename;  /* categorical attributes, or NULL */
+  const char *contattr_filename; /* continuous attributes, or NULL */
+  const char *setattr_filename;  /* set attributes, or NULL */
+} snowball_attr_files_t;
+
+uint_t *snowball_seeds(const digraph_t *g, uint_t num_samples,
+                       uint_t num_seeds, prng_t *prng);
+void snowball_sample(const digraph_t *g, const uint_t seeds[],
+                     uint_t num_seeds, uint_t num_waves, uint_t work[],
+                     snowball_sample_t *sample);
+void free_snowball_sample(snowball_sample_t *sample);
+int write_snowball_sample(const digraph_t *g, const snowball_sample_t *sample,
+                          uint_t work[], const char *outputdir,
+                          uint_t samplenum,
+                          const snowball_attr_files_t *attr_files,
+                          char *desc_line, size_t desc_len);
+
+#endif /* SNOWBALLSAMPLE_H */
@@ -55,6 +55,48 @@
 #include "tntSampler.h"
 
 
+/*****************************************************************************
+ *
+ * local functions
+ *
+ ****************************************************************************/
+
+/*
+ * Probability that the TNT sampler proposes a delete move, given the
+ * number of arcs that could be deleted and the number of empty dyads
+ * where an arc could be added: prob, unless there is nothing to
+ * delete (or nothing to add) in which case the other move is forced.
+ */
+static double tnt_delete_prob(double num_full, double num_empty, double prob)
+{
+  if (num_full <= 0)
+    return 0;
+  if (num_empty <= 0)
+    return 1;
+  return prob;
+}
+
+/*
+ * Count the reciprocated dyads (pairs of nodes with arcs in both
+ * directions) in a digraph, using the allarcs flat arc list.
+ */
+static arcidx_t count_mutual_dyads(const digraph_t *g)
+{
+  arcidx_t k, count = 0;
+
+  for (k = 0; k < g->num_arcs; k++) {
+    if (g->allarcs[k].i < g->allarcs[k].j &&
+        isArc(g, g->allarcs[k].j, g->allarcs[k].i))
+      count++;
+  }
+  return count;
+}
+
+/*****************************************************************************
+ *
+ * externally visible functions
+ *
+ ****************************************************************************/
 
 /*
  * Tie-no-tie (TNT) ERGM MCMC sampler, described in:
@@ -72,6 +114,17 @@
  * baic sampler (which by choosing uniformly at random dyads will very
  * often propose add moves in a sparse network).
  *
+ * The Hastings ratio uses the exact sizes of the sets the moves are
+ * drawn from: the arcs that can be deleted, and the empty dyads where
+ * an arc can be added, which excludes dyads with an arc in the reverse
+ * direction if forbidReciprocity, and dyads not in the same or
+ * adjacent snowball waves for conditional estimation. (For conditional
+ * estimation the arcs that cannot be deleted because they are the last
+ * tie of a node to the preceding wave are not counted, and a move can
+ * change the number of deletable arcs by two, see
+ * num_deletable_inner_arcs_after().) If one of the sets is empty the
+ * other move is forced, and this is included in the ratio also.
+ *
  * Parameters:
  *   g      - digraph object. Modifed if performMove is true.
  *   n      - number of parameters (length of theta vector and total
@@ -81,6 +134,8 @@
  *   n_attr_interaction - number of attribute interaction change stats funcs
  *   change_stats_funcs - array of pointers to change statistics functions
  *                        length is n-n_attr-n_dyadic-n_attr_interaction
+ *   lambda_values - array of lambda (decay) values corresponding to
+ *                   change_stats_funcs (used by alternating statistics)
  *   attr_change_stats_funcs - array of pointers to change statistics functions
  *                             length is n_attr
  *   dyadic_change_stats_funcs - array of pointers to dyadic change stats funcs
@@ -108,6 +163,12 @@
  *   useConditionalEstimation - if True do conditional estimation of snowball
  *                              network sample.
  *   forbidReciprocity - if True do not allow reciprocated arcs.
+ *   num_mutual - (In/Out) number of reciprocated dyads in g, only used if
+ *                forbidReciprocity (when g may still have reciprocated
+ *                arcs from the observed network, which can be deleted).
+ *                Updated if performMove.
+ *   prng - pseudorandom number generator stream to use (updated)
+ *   ws   - sampler workspace (scratch buffers for n parameters)
  *
  * Return value:
  *   Acceptance rate.
@@ -117,35 +178,45 @@
  * function pointer array. On exit they are set to the sum values of the
  * change statistics for add and delete moves respectively.
  */
-double tntSampler(digraph_t *g,  uint_t n, uint_t n_attr, uint_t n_dyadic,
-                  uint_t n_attr_interaction,
-                  change_stats_func_t *change_stats_funcs[],
-                  attr_change_stats_func_t *attr_change_stats_funcs[],
-                  dyadic_change_stats_func_t *dyadic_change_stats_funcs[],
-                  attr_interaction_change_stats_func_t
+static inline double tntSamplerLoop(digraph_t *g,  uint_t n, uint_t n_attr,
+                                   uint_t n_dyadic, uint_t n_attr_interaction,
+                                   change_stats_func_t *change_stats_funcs[],
+                                   double lambda_values[],
+                                   attr_change_stats_func_t
+                                                  *attr_change_stats_funcs[],
+                                   dyadic_change_stats_func_t
+                                                *dyadic_change_stats_funcs[],
+                                   attr_interaction_change_stats_func_t
                                    *attr_interaction_change_stats_funcs[],
-                  uint_t attr_indices[],
-                  uint_pair_t attr_interaction_pair_indices[],
-                  double theta[],
-                  double addChangeStats[], double delChangeStats[],
-                  uint_t sampler_m,
-                  bool performMove,
-                  bool useConditionalEstimation,
-                  bool forbidReciprocity)
+                                   uint_t attr_indices[],
+                                   uint_pair_t
+                                           attr_interaction_pair_indices[],
+                                   double theta[],
+                                   double addChangeStats[],
+                                   double delChangeStats[],
+                                   uint_t sampler_m,
+                                   bool performMove,
+                                   bool useConditionalEstimation,
+                                   bool forbidReciprocity,
+                                   arcidx_t *num_mutual,
+                                   prng_t *prng, sampler_workspace_t *ws)
 {
   bool    isDelete;
-  double *changestats = (double *)safe_malloc(n*sizeof(double));
+  bool    isReverseArc = FALSE; /* arc j->i exists, for forbidReciprocity */
+  double *changestats = ws->changestats;
   double  total;        /* sum of theta*changestats */
   ulong_t accepted = 0; /* number of accepted moves */
   double  acceptance_rate;
   uint_t  i,j,k,l;
-  uint_t  arcidx = 0;
-  double  alpha;
+  arcidx_t arcidx = 0;
+  bool    accept;
   const double prob      = 0.5; /* equal probability of add or delete */
-  const double odds      = prob / (1 - prob);
   double       N         = g->num_nodes;
   double       num_dyads = N*(N-1);/*directed so not div by 2*/
-    
+  double       num_full;  /* number of arcs that can be deleted */
+  double       num_empty; /* number of empty dyads where arc can be added */
+  double       delete_prob, new_full, new_empty;
+
     
   for (i = 0; i < n; i++) {
     addChangeStats[i] = delChangeStats[i] = 0;
@@ -153,17 +224,22 @@ double tntSampler(digraph_t *g,  uint_t n, uint_t n_attr, uint_t n_dyadic,
 
   for (k = 0; k < sampler_m; k++) {
 
-    if (g->num_arcs > 0)
-      isDelete = (urand() < prob); /*add or delete move with equal probability*/
-    else
-      isDelete = FALSE; /* force an add move on empty graph */
+    if (useConditionalEstimation) {
+      num_full = g->num_deletable_inner_arcs;
+      num_empty = (double)g->zone_pair_cumcount[2*g->max_zone - 2] -
+        g->num_inner_arcs;
+    } else {
+      num_full = g->num_arcs;
+      /* with forbidReciprocity, each unreciprocated arc rules out both
+         its own dyad and the reverse one */
+      num_empty = forbidReciprocity ?
+        num_dyads - 2.0 * (g->num_arcs - *num_mutual) :
+        num_dyads - g->num_arcs;
+    }
+    /* add or delete move with equal probability, unless one is forced */
+    delete_prob = tnt_delete_prob(num_full, num_empty, prob);
+    isDelete = delete_prob > 0 && prng_urand(prng) < delete_prob;
 
-    /* TODO with conditional estimation may still crash as
-       g->num_inner_arcs it the relevant count not g->num_arcs.  Also
-       (not conditional estimation) should handle case of graph
-       becoming full i.e. g->num_arcs == num_dyads in which case we
-       cannot do an add move */
-    
     if (useConditionalEstimation) {
       assert(!forbidReciprocity); /* TODO not implemented for snowball */
       if (isDelete) {
@@ -172,20 +248,20 @@ double tntSampler(digraph_t *g,  uint_t n, uint_t n_attr, uint_t n_dyadic,
            outermost wave and between outermost and second-outermost
            waves) uniformly at random to delete.  Extra constraint for
            conditional estimation that a tie cannot be deleted if it
-           is last remaining tie connecting node to preceding wave.
+           is last remaining tie connecting node to preceding wave,
+           so it is chosen from only the arcs that can be deleted
+           (and there is at least one, or the move would be an add).
            Note ignoring arc direction here as assumed snowball sample
            ignored arc directions.
          */
-        do {
-          arcidx = int_urand(g->num_inner_arcs);
-          i = g->allinnerarcs[arcidx].i;
-          j = g->allinnerarcs[arcidx].j;
-          SAMPLER_DEBUG_PRINT(("conditional del arcidx %u (%u -> %u) zones %u %u\n", arcidx, i, j, g->zone[i], g->zone[j]));
-          assert(g->zone[i] < g->max_zone && g->zone[j] < g->max_zone);
-          /* any tie must be within same zone or between adjacent zones */
-          assert(labs((long)g->zone[i] - (long)g->zone[j]) <= 1);
-        } while ((g->zone[i] > g->zone[j] && g->prev_wave_degree[i] == 1) ||
-                 (g->zone[j] > g->zone[i] && g->prev_wave_degree[j] == 1));
+        arcidx = get_deletable_inner_arc(g, ARC_URAND(prng,
+                                             g->num_deletable_inner_arcs));
+        i = g->allinnerarcs[arcidx].i;
+        j = g->allinnerarcs[arcidx].j;
+        SAMPLER_DEBUG_PRINT(("conditional del arcidx %lu (%u -> %u) zones %u %u\n", (unsigned long)arcidx, i, j, g->zone[i], g->zone[j]));
+        assert(g->zone[i] < g->max_zone && g->zone[j] < g->max_zone);
+        /* any tie must be within same zone or between adjacent zones */
+        assert(labs((long)g->zone[i] - (long)g->zone[j]) <= 1);
       } else {
         /* Add move for conditional estimation. Find two nodes i, j in
            inner waves without arc i->j uniformly at random. Because
@@ -193,21 +269,18 @@ double tntSampler(digraph_t *g,  uint_t n, uint_t n_attr, uint_t n_dyadic,
            random nodes until such a pair is found. For conditional
            estimation we also have the extra constraint that the nodes
            must be in the same wave or adjacent waves for the tie to
-           be added. */
+           be added, which sample_zone_pair() ensures. */
         do {
-          i = g->inner_nodes[int_urand(g->num_inner_nodes)];          
-          do {
-            j = g->inner_nodes[int_urand(g->num_inner_nodes)];        
-          } while (i == j);
+          sample_zone_pair(g, prng, &i, &j);
           assert(g->zone[i] < g->max_zone && g->zone[j] < g->max_zone);
-        } while (isArc(g, i, j) ||
-                 (labs((long)g->zone[i] - (long)g->zone[j]) > 1));
+          assert(labs((long)g->zone[i] - (long)g->zone[j]) <= 1);
+        } while (isArc(g, i, j));
       }
     } else {
       /* not using conditional estimation */
       if (isDelete) {
         /* Delete move. Find an existing arc uniformly at random to delete. */
-        arcidx = int_urand(g->num_arcs);
+        arcidx = ARC_URAND(prng, g->num_arcs);
         i = g->allarcs[arcidx].i;
         j = g->allarcs[arcidx].j;
         /*removed as slows significantly: assert(isArc(g, i, j));*/
@@ -216,30 +289,17 @@ double tntSampler(digraph_t *g,  uint_t n, uint_t n_attr, uint_t n_dyadic,
         /* Add move. Find two nodes i, j without arc i->j uniformly at
            random. Because graph is sparse, it is not too inefficient
            to just pick random nodes until such a pair is found */
-        do {
-          do {
-            i = int_urand(g->num_nodes);
-            do {
-              j = int_urand(g->num_nodes);
-            } while (i == j);
-          } while (isArc(g, i, j));
-        } while (forbidReciprocity && isArc(g, j, i));
+        sample_empty_dyad(g, prng, forbidReciprocity, &i, &j);
       }
     }
     
     /* The change statistics are all computed on the basis of adding arc i->j
-       so for a delete move, we (perhaps temporarily) remove it to compute the
-       change statistics, and negate them */
-    if (isDelete) {
-      if (useConditionalEstimation){
-        removeArc_allinnerarcs(g, i, j, arcidx);
-      } else {
-        removeArc_allarcs(g, i, j, arcidx);        
-      }
-    }
-
+       so for a delete move, they are computed as if it were absent
+       (without modifying g), and negated. The arc is only removed if
+       the move is accepted. */
     total = calcChangeStats(g, i, j, n, n_attr, n_dyadic, n_attr_interaction,
                             change_stats_funcs,
+                            lambda_values,
                             attr_change_stats_funcs,
                             dyadic_change_stats_funcs,
                             attr_interaction_change_stats_funcs,
@@ -248,44 +308,54 @@ double tntSampler(digraph_t *g,  uint_t n, uint_t n_attr, uint_t n_dyadic,
                             theta, isDelete, changestats);
 
     
-    /* adjust the acceptance probability as done in MHproposals.c
-       MH_TNT() in statnet ergm code */
-    /* FIXME this may not be correct if conditional estimation
-       is used as then g->num_inner_arcs is the relevant number
-       not g->num_arcs */
+    /* adjust the acceptance probability by the Hastings ratio
+       q(reverse move) / q(move), where the probability of proposing
+       a move is the probability of its type divided by the size of
+       the set it is drawn from, before and after the move */
     if (isDelete) {
-      total += log( g->num_arcs == 1 ? 1.0 / (prob * num_dyads + (1 - prob)) :
-		    g->num_arcs / (odds * num_dyads + g->num_arcs) );
+      /* deleting i->j frees its dyad, and with forbidReciprocity also
+         the reverse dyad unless arc j->i remains */
+      isReverseArc = forbidReciprocity && isArc(g, j, i);
+      new_full = useConditionalEstimation ?
+        num_deletable_inner_arcs_after(g, i, j, TRUE) : num_full - 1;
+      new_empty = num_empty + (forbidReciprocity ? (isReverseArc ? 0 : 2) : 1);
+      total += log((1 - tnt_delete_prob(new_full, new_empty, prob)) /
+                   new_empty * num_full / delete_prob);
     } else {
-      total += log( g->num_arcs == 0 ? prob * num_dyads + (1 - prob) :
-		    1 + (odds * num_dyads) / (g->num_arcs + 1) );
+      new_full = useConditionalEstimation ?
+        num_deletable_inner_arcs_after(g, i, j, FALSE) : num_full + 1;
+      new_empty = num_empty - (forbidReciprocity ? 2 : 1);
+      total += log(tnt_delete_prob(new_full, new_empty, prob) /
+                   new_full * num_empty / (1 - delete_prob));
     }
 
     /* now exp(total) is the acceptance probability */
-    alpha = exp(total);
-    
     SAMPLER_DEBUG_PRINT(("%s %d -> %d alpha = %g\n",
-			 isDelete ? "del" : "add", i, j, alpha));
+			 isDelete ? "del" : "add", i, j, exp(total)));
 
-    if (urand() < alpha) {
+    accept = prng_accept(prng, total);
+    if (ws->trace)
+      trace_proposal(ws->trace, i, j,
+                     (isDelete ? PROPOSAL_TRACE_DELETE : 0) |
+                     (accept ? PROPOSAL_TRACE_ACCEPTED : 0) |
+                     (accept && performMove ? PROPOSAL_TRACE_MOVED : 0),
+                     prng, changestats);
+    if (accept) {
       accepted++;
-      SAMPLER_DEBUG_PRINT(("[%s] accepted = %lu (%g) num_arcs = %u\n", 
+      SAMPLER_DEBUG_PRINT(("[%s] accepted = %lu (%g) num_arcs = %lu\n", 
 			   isDelete ? "del" :  "add",
-			   accepted, k>0?(double)accepted/k:-1, g->num_arcs));
+			   accepted, k>0?(double)accepted/k:-1, (unsigned long)g->num_arcs));
       if (performMove) {
-        /* actually do the move. If deleting, already done it. For add, add
-           the arc now */
-        if (!isDelete) {
+        /* actually do the move */
+        if (isDelete) {
           if (useConditionalEstimation) {
-            insertArc_allinnerarcs(g, i, j);
+            removeArc_allinnerarcs(g, i, j, arcidx);
           } else {
-            insertArc_allarcs(g, i, j);
+            removeArc_allarcs(g, i, j, arcidx);
           }
-        }
-      } else {
-        /* not actually doing the moves, so reverse change for delete move
-           to restore g to original state */
-        if (isDelete) {
+          if (isReverseArc)
+            (*num_mutual)--;
+        } else {
           if (useConditionalEstimation) {
             insertArc_allinnerarcs(g, i, j);
           } else {
@@ -301,19 +371,122 @@ double tntSampler(digraph_t *g,  uint_t n, uint_t n_attr, uint_t n_dyadic,
         for (l = 0; l < n; l++)
           addChangeStats[l] += changestats[l];
       }
-    } else {
-      /* move not acceptd, so reverse change for delete */
-      if (isDelete) {
-        if (useConditionalEstimation) {
-          insertArc_allinnerarcs(g, i, j);
-        } else {
-          insertArc_allarcs(g, i, j);          
-        }
-      }
     }
   }
   
   acceptance_rate = (double)accepted / sampler_m;
-  free(changestats);
   return acceptance_rate;
 }
+
+/*
+ * Call tntSamplerLoop() with constant flags, so each call is an instance
+ * of the loop specialised for them, as BASIC_SAMPLER_LOOP() in
+ * basicSampler.c.
+ */
+#define TNT_SAMPLER_LOOP(performMove, useConditionalEstimation,           \
+                         forbidReciprocity)                                \
+  tntSamplerLoop(g, n, n_attr, n_dyadic, n_attr_interaction,               \
+                 change_stats_funcs, lambda_values,                        \
+                 attr_change_stats_funcs, dyadic_change_stats_funcs,       \
+                 attr_interaction_change_stats_funcs, attr_indices,        \
+                 attr_interaction_pair_indices, theta, addChangeStats,     \
+                 delChangeStats, sampler_m, (performMove),                 \
+                 (useConditionalEstimation), (forbidReciprocity),          \
+                 num_mutual, prng, ws)
+
+/*
+ * TNT sampler: tntSamplerLoop() (see that for the parameters and return
+ * value), dispatching once on the flags to the instance of the loop
+ * specialised for them.
+ */
+double tntSampler(digraph_t *g,  uint_t n, uint_t n_attr, uint_t n_dyadic,
+                  uint_t n_attr_interaction,
+                  change_stats_func_t *change_stats_funcs[],
+                  double lambda_values[],
+                  attr_change_stats_func_t *attr_change_stats_funcs[],
+                  dyadic_change_stats_func_t *dyadic_change_stats_funcs[],
+                  attr_interaction_change_stats_func_t
+                                   *attr_interaction_change_stats_funcs[],
+                  uint_t attr_indices[],
+                  uint_pair_t attr_interaction_pair_indices[],
+                  double theta[],
+                  double addChangeStats[], double delChangeStats[],
+                  uint_t sampler_m,
+                  bool performMove,
+                  bool useConditionalEstimation,
+                  bool forbidReciprocity, arcidx_t *num_mutual,
+                  prng_t *prng, sampler_workspace_t *ws)
+{
+  if (useConditionalEstimation) {
+    assert(!forbidReciprocity); /* TODO not implemented for snowball */
+    return performMove ? TNT_SAMPLER_LOOP(TRUE, TRUE, FALSE) :
+      TNT_SAMPLER_LOOP(FALSE, TRUE, FALSE);
+  }
+  if (forbidReciprocity)
+    return performMove ? TNT_SAMPLER_LOOP(TRUE, FALSE, TRUE) :
+      TNT_SAMPLER_LOOP(FALSE, FALSE, TRUE);
+  return performMove ? TNT_SAMPLER_LOOP(TRUE, FALSE, FALSE) :
+    TNT_SAMPLER_LOOP(FALSE, FALSE, FALSE);
+}
+
+/*****************************************************************************
+ *
+ * sampler interface (see sampler.h)
+ *
+ ****************************************************************************/
+
+/* state of the TNT sampler between calls */
+typedef struct tnt_sampler_state_s {
+  arcidx_t num_mutual; /* reciprocated dyads in the digraph
+                          (forbidReciprocity) */
+} tnt_sampler_state_t;
+
+static void tnt_sampler_create(sampler_t *s)
+{
+  s->state = safe_calloc(1, sizeof(tnt_sampler_state_t));
+}
+
+static void tnt_sampler_init(sampler_t *s, const digraph_t *g,
+                             double aux_param)
+{
+  tnt_sampler_state_t *st = (tnt_sampler_state_t *)s->state;
+
+  (void)aux_param;
+  st->num_mutual = (s->options.forbidReciprocity &&
+                    !s->options.useConditionalEstimation) ?
+    count_mutual_dyads(g) : 0;
+}
+
+static double tnt_sampler_run(sampler_t *s, digraph_t *g, double theta[],
+                              double addChangeStats[], double delChangeStats[],
+                              uint_t sampler_m, bool performMove)
+{
+  const sampler_model_t *m = s->model;
+  tnt_sampler_state_t   *st = (tnt_sampler_state_t *)s->state;
+
+  return tntSampler(g, m->n, m->n_attr, m->n_dyadic, m->n_attr_interaction,
+                    m->change_stats_funcs, m->lambda_values,
+                    m->attr_change_stats_funcs, m->dyadic_change_stats_funcs,
+                    m->attr_interaction_change_stats_funcs, m->attr_indices,
+                    m->attr_interaction_pair_indices, theta,
+                    addChangeStats, delChangeStats, sampler_m, performMove,
+                    s->options.useConditionalEstimation,
+                    s->options.forbidReciprocity, &st->num_mutual,
+                    s->prng, s->ws);
+}
+
+static void tnt_sampler_destroy(sampler_t *s)
+{
+  free(s->state);
+}
+
+const sampler_ops_t tnt_sampler_ops = {
+  "TNT",              /* name */
+  TRUE,               /* divisible */
+  sizeof(tnt_sampler_state_t), /* state_size */
+  tnt_sampler_create, /* create */
+  tnt_sampler_init,   /* init */
+  tnt_sampler_run,    /* run */
+  NULL,               /* arc_stats */
+  tnt_sampler_destroy /* destroy */
+};
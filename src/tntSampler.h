@@ -51,11 +51,15 @@
  ****************************************************************************/
 
 #include "changeStatisticsDirected.h"
+#include "sampler.h"
+
+extern const sampler_ops_t tnt_sampler_ops;
 
 
 double tntSampler(digraph_t *g,  uint_t n, uint_t n_attr, uint_t n_dyadic,
                   uint_t n_attr_interaction,
                   change_stats_func_t *change_stats_funcs[],
+                  double lambda_values[],
                   attr_change_stats_func_t *attr_change_stats_funcs[],
                   dyadic_change_stats_func_t *dyadic_change_stats_funcs[],
                   attr_interaction_change_stats_func_t
@@ -67,7 +71,8 @@ double tntSampler(digraph_t *g,  uint_t n, uint_t n_attr, uint_t n_dyadic,
                   uint_t sampler_m,
                   bool performMove,
                   bool useConditionalEstimation,
-                  bool forbidReciprocity);
+                  bool forbidReciprocity, arcidx_t *num_mutual,
+                  prng_t *prng, sampler_workspace_t *ws);
 
 
 #endif /* TNTSAMPLER_H */
@@ -18,10 +18,17 @@
 #include <unistd.h>
 #include <errno.h>
 #include <math.h>
+#include <assert.h>
 #include <time.h>
 #include <limits.h>
 #include <string.h>
 #include <ctype.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <pthread.h>
 #include "utils.h"
 
 #ifdef USE_RANDOM123
@@ -32,14 +39,26 @@
 
 /*****************************************************************************
  *
- * externally visible variables
+ * file static variables
  *
  ****************************************************************************/
 
 #ifdef USE_POW_LOOKUP
-/* Lookup table of integer power y of double x, faster than pow(x, y)
-   intialized by init_powtable() */
-double POWTABLE[POWTABLE_SIZE];
+/* Lookup table of integer powers of base, values[y] = pow(base, y)
+   for 0 <= y < size */
+typedef struct powtable_s {
+  double  base;
+  double *values;
+  uint_t  size;
+} powtable_t;
+
+/* One lookup table for each distinct base used (there is one for each
+   distinct lambda value of the alternating statistics), built by
+   pow_lookup() on first use. The tables are per thread, so that sampler
+   threads and estimations run in different threads do not share them */
+static __thread powtable_t *powtables = NULL;
+static __thread uint_t      num_powtables = 0;
+static __thread uint_t      last_powtable = 0; /* most recently used table */
 #endif
 
 /*****************************************************************************
@@ -48,31 +67,237 @@ double POWTABLE[POWTABLE_SIZE];
  *
  ****************************************************************************/
 
+/* The seed and task number set by init_prng() (or set_prng_seed()) for
+   this task. Generator state itself is in a prng_t owned by the caller;
+   the key of each stream is (seed, task and stream number), so that
+   every (seed, task, stream) triple is an independent sequence. They
+   are per thread, so that estimations run in different threads (e.g.
+   through the estimNetLib.h library) can each have their own seed;
+   the streams of sampler threads are initialized by the thread that
+   starts them. */
 #ifdef USE_RANDOM123
-/* TODO don't use static variables so we can use threads */
-static threefry2x64_ctr_t ctr = {{0, 0}};
-static threefry2x64_key_t key = {{0xdeadbeef, 0xbadcafe}};
+static __thread uint64_t prng_seed = 0xdeadbeef;
+static __thread uint64_t prng_task = 0;
+
+/* Number of consecutive outputs of a stream computed together */
+#define PRNG_BLOCK_SIZE 64
+
+/* The next outputs of the stream this thread last drew from, computed
+   together by prng_fill_block() so that the block cipher rounds are
+   vectorized over the counters, then handed out one at a time by
+   prng_next(). The block is only a cache of values determined by the
+   key and counter of the stream, so the sequence is the same as
+   computing each output when it is drawn; it is refilled whenever the
+   stream (key) or its counter is not the one it continues, e.g. when
+   another stream is used. */
+typedef struct prng_block_s {
+  uint64_t key[2];   /* key of the stream the block is from */
+  uint64_t ctr[2];   /* counter of the output before word0[pos] */
+  uint_t   pos;      /* next output to hand out */
+  uint_t   len;      /* number of outputs in block (0 if none) */
+  uint64_t word0[PRNG_BLOCK_SIZE];    /* first word of each output */
+  uint64_t word1[PRNG_BLOCK_SIZE];    /* second word of each output */
+  double   log_urand[PRNG_BLOCK_SIZE];/* approximate log of prng_urand()
+                                         value of each output, or NaN if
+                                         it is 0 (see prng_urand_log()) */
+} prng_block_t;
+
+static __thread prng_block_t prng_block;
 #endif
 
 /*
  * Initialize the pseudorandom number genrator for given task number
- * (make sure seed is different for each task).
+ * (make sure seed is different for each task). The seed is taken from
+ * the current time; use set_prng_seed() afterwards for a reproducible
+ * seed.
  */
 void init_prng(int tasknum)
 {
 #ifdef USE_RANDOM123
   assert(sizeof(unsigned long long) == 8); /* since we use ULLONG_MAX */
-  assert(sizeof(ctr.v[0]) == sizeof(unsigned long long));
-  key.v[0] = time(NULL) + tasknum*123;
+  assert(sizeof(((prng_t *)0)->ctr[0]) == sizeof(unsigned long long));
+  prng_seed = time(NULL);
+  prng_task = (uint64_t)tasknum;
 #else
   srand(time(NULL) + tasknum*123); 
 #endif
 }
 
+/*
+ * Use the given seed (instead of the time set by init_prng(), which must
+ * have been called first) for all streams of this task. Tasks still get
+ * different streams as the task number is also part of the key.
+ */
+void set_prng_seed(uint64_t seed)
+{
+#ifdef USE_RANDOM123
+  prng_seed = seed;
+#else
+  srand(seed + prng_task*123);
+#endif
+}
+
+/*
+ * Use the given task number (instead of the one set by init_prng()) for
+ * the streams started from now on, keeping the seed, e.g. so that the
+ * estimation of each bootstrap replicate in a process forked from a
+ * task has streams of its own.
+ */
+void set_prng_task(uint64_t tasknum)
+{
+#ifdef USE_RANDOM123
+  prng_task = tasknum;
+#else
+  (void)tasknum;
+#endif
+}
+
+/*
+ * Initialize a pseudorandom number generator state to the start of the
+ * given stream of this task (as seeded by init_prng()). Different
+ * stream numbers give independent sequences; by convention the main
+ * thread uses stream 0 and each other thread its own stream number.
+ *
+ * Parameters:
+ *    prng   - (Out) generator state to initialize
+ *    stream - stream number (less than 2^32)
+ *
+ * Return value:
+ *   None.
+ */
+void prng_init_stream(prng_t *prng, uint64_t stream)
+{
+#ifdef USE_RANDOM123
+  assert(stream <= 0xffffffffULL);
+  prng->ctr[0] = prng->ctr[1] = 0;
+  prng->key[0] = prng_seed;
+  prng->key[1] = (prng_task << 32) | stream;
+#else
+  (void)prng; (void)stream;
+#endif
+}
+
+#ifdef USE_RANDOM123
+/*
+ * Integer 0 <= v < 2^52 as a double, by putting it in the mantissa of
+ * 2^52 and subtracting 2^52, without an integer to floating point
+ * conversion instruction (there are no vector ones for 64 bit integers
+ * before AVX-512).
+ */
+static inline double small_uint_to_double(uint64_t v)
+{
+  const double TWO52 = 4503599627370496.0;
+  uint64_t bits = 0x4330000000000000ULL | v; /* 2^52 + v */
+  double   x;
+
+  memcpy(&x, &bits, sizeof(x));
+  return x - TWO52;
+}
+
+/*
+ * Approximate natural logarithm of a positive normal double x, with
+ * absolute error much less than PRNG_LOG_URAND_ERROR for the values
+ * 2^-64 <= x <= 1 of prng_urand(). x = m * 2^e with m in [sqrt(1/2),
+ * sqrt(2)), and log(m) = 2 atanh(s) = 2(s + s^3/3 + s^5/5 + ...) for
+ * s = (m-1)/(m+1), |s| < 0.172, so terms up to s^15 give an error
+ * below 1e-14. This has no branches or library calls, so the loop
+ * over a block vectorizes.
+ */
+static inline double approx_log(double x)
+{
+  const uint64_t MANTISSA = 0x000fffffffffffffULL;
+  const uint64_t SQRT2_MANTISSA = 0x0006a09e667f3bcdULL; /* of sqrt(2) */
+  const double   LN2 = 0.69314718055994530942;
+  uint64_t bits, big;
+  double   m, s, s2, e;
+
+  /* the exponent and mantissa are adjusted for m > sqrt(2) with integer
+     operations, so there is no conditional floating point operation in
+     the loop (which would stop it being vectorized) */
+  memcpy(&bits, &x, sizeof(bits));
+  big = (bits & MANTISSA) > SQRT2_MANTISSA;
+  e = small_uint_to_double((bits >> 52) + big) - 1023;
+  bits = (bits & MANTISSA) | ((1023 - big) << 52);
+  memcpy(&m, &bits, sizeof(m));
+  s = (m - 1) / (m + 1);
+  s2 = s * s;
+  return e * LN2 + 2 * s * (1 + s2 * (1.0/3 + s2 * (1.0/5 + s2 * (1.0/7 +
+           s2 * (1.0/9 + s2 * (1.0/11 + s2 * (1.0/13 + s2 * (1.0/15))))))));
+}
+
+/*
+ * Compute the PRNG_BLOCK_SIZE outputs of the stream after its current
+ * counter into this thread's block.
+ */
+CPU_DISPATCH
+static void prng_fill_block(prng_block_t *b, const prng_t *prng)
+{
+  threefry2x64_ctr_t ctr, randv;
+  threefry2x64_key_t key;
+  double   u, l;
+  uint64_t lbits;
+  uint_t   k;
+
+  key.v[0] = prng->key[0]; key.v[1] = prng->key[1];
+  for (k = 0; k < PRNG_BLOCK_SIZE; k++) {
+    /* counter incremented k+1 times, wrapping into the second word */
+    ctr.v[0] = prng->ctr[0] + k + 1;
+    ctr.v[1] = prng->ctr[1] + (ctr.v[0] < prng->ctr[0]);
+    randv = threefry2x64(ctr, key);
+    b->word0[k] = randv.v[0];
+    b->word1[k] = randv.v[1];
+  }
+  for (k = 0; k < PRNG_BLOCK_SIZE; k++) {
+    /* word0/2^64 as prng_urand() but from two 32 bit halves, so within
+       rounding of it */
+    u = small_uint_to_double(b->word0[k] >> 32) * 0x1p-32 +
+      small_uint_to_double(b->word0[k] & 0xffffffffULL) * 0x1p-64;
+    l = approx_log(u);
+    /* NaN (all exponent bits and the quiet bit set) if u is 0 */
+    memcpy(&lbits, &l, sizeof(lbits));
+    lbits |= -(uint64_t)(b->word0[k] == 0) & 0x7ff8000000000000ULL;
+    memcpy(&b->log_urand[k], &lbits, sizeof(lbits));
+  }
+  b->key[0] = prng->key[0]; b->key[1] = prng->key[1];
+  b->ctr[0] = prng->ctr[0]; b->ctr[1] = prng->ctr[1];
+  b->pos = 0;
+  b->len = PRNG_BLOCK_SIZE;
+}
+
+/*
+ * Advance the stream to its next output (counter wraps into second
+ * word), returning the index of that output in this thread's block.
+ */
+static inline uint_t prng_next_index(prng_t *prng)
+{
+  prng_block_t *b = &prng_block;
+
+  if (b->pos == b->len || b->ctr[0] != prng->ctr[0] ||
+      b->ctr[1] != prng->ctr[1] || b->key[0] != prng->key[0] ||
+      b->key[1] != prng->key[1])
+    prng_fill_block(b, prng);
+  prng->ctr[0]++;
+  if (prng->ctr[0] == 0) /* just in case we actually wrap 64 bit counter */
+    prng->ctr[1]++;
+  b->ctr[0] = prng->ctr[0]; b->ctr[1] = prng->ctr[1];
+  return b->pos++;
+}
+
+/* next 128 random bits from the stream */
+static inline threefry2x64_ctr_t prng_next(prng_t *prng)
+{
+  threefry2x64_ctr_t randv;
+  uint_t k = prng_next_index(prng);
+  randv.v[0] = prng_block.word0[k];
+  randv.v[1] = prng_block.word1[k];
+  return randv;
+}
+#endif
+
 /*
  * Uniform random number in closed interval [0,1]
  */
-double urand(void)
+double prng_urand(prng_t *prng)
 {
   /* TODO This is still not "really" uniform, although it is
      apparently what actual libraries use, due to non-uniform
@@ -84,36 +309,217 @@ double urand(void)
      http://www.doornik.com/research/randomdouble.pdf
      but it should be good enough */
 #ifdef USE_RANDOM123
-  double r;
-  ctr.v[0]++;
-  if (ctr.v[0] == 0) /* just in case we actually wrap 64 bit counter */
-    ctr.v[1]++;
-  threefry2x64_ctr_t randv = threefry2x64(ctr, key);
-  r = (double)randv.v[0]/ULLONG_MAX;
-  return r;
+  threefry2x64_ctr_t randv = prng_next(prng);
+  return (double)randv.v[0]/ULLONG_MAX;
 #else
+  (void)prng;
   return (double)rand()/RAND_MAX; 
 #endif
 }
 
+/*
+ * Uniform random number in closed interval [0,1], the same as
+ * prng_urand() (and drawn from the stream in the same way), and also
+ * its natural logarithm approximately, within PRNG_LOG_URAND_ERROR
+ * (computed with the rest of the block of outputs, so without a
+ * library call for each one).
+ *
+ * Parameters:
+ *    prng  - generator state, updated
+ *    log_u - (Out) approximately log of the return value, or NaN
+ *            if it is 0
+ *
+ * Return value:
+ *    Uniform random number u in [0,1].
+ */
+double prng_urand_log(prng_t *prng, double *log_u)
+{
+#ifdef USE_RANDOM123
+  uint_t k = prng_next_index(prng);
+  *log_u = prng_block.log_urand[k];
+  return (double)prng_block.word0[k]/ULLONG_MAX;
+#else
+  double u = prng_urand(prng);
+  *log_u = u > 0 ? log(u) : NAN;
+  return u;
+#endif
+}
+
+/*
+ * Metropolis acceptance test: u < exp(log_alpha) for a uniform random
+ * number u from prng_urand_log(), giving exactly the same result as
+ * computing exp(log_alpha), but without computing it unless log_alpha
+ * is within PRNG_LOG_URAND_ERROR of the approximate log(u).
+ *
+ * Parameters:
+ *    u         - uniform random number
+ *    log_u     - approximate log(u) from prng_urand_log()
+ *    log_alpha - log of the acceptance probability (may be greater
+ *                than 0, or -HUGE_VAL)
+ *
+ * Return value:
+ *    TRUE if u < exp(log_alpha) else FALSE.
+ */
+bool urand_accept(double u, double log_u, double log_alpha)
+{
+  if (log_alpha > log_u + PRNG_LOG_URAND_ERROR)
+    return TRUE;
+  if (log_alpha < log_u - PRNG_LOG_URAND_ERROR)
+    return FALSE;
+  return u < exp(log_alpha); /* also when log_u or log_alpha is NaN */
+}
+
+/*
+ * Draw a uniform random number u and return u < exp(log_alpha), i.e.
+ * accept a move with acceptance probability exp(log_alpha). This gives
+ * exactly the same result as prng_urand(prng) < exp(log_alpha), but
+ * see urand_accept().
+ *
+ * Parameters:
+ *    prng      - generator state, updated
+ *    log_alpha - log of the acceptance probability
+ *
+ * Return value:
+ *    TRUE to accept else FALSE.
+ */
+bool prng_accept(prng_t *prng, double log_alpha)
+{
+  double log_u;
+  double u = prng_urand_log(prng, &log_u);
+  return urand_accept(u, log_u, log_alpha);
+}
+
+#ifdef USE_RANDOM123
+/*
+ * Map 32 random bits x to a uniform integer in 0..n-1 by Lemire's
+ * multiply-shift method: the high word of x*n, rejecting (and drawing
+ * new bits from prng) the few x values that would make some results
+ * more likely than others. This needs no division except on the rare
+ * occasions the low word falls below n.
+ *
+ * Lemire, D. (2019). Fast random integer generation in an interval.
+ * ACM Transactions on Modeling and Computer Simulation (TOMACS), 29(1), 3.
+ */
+static uint_t bounded_urand(prng_t *prng, uint32_t x, uint_t n)
+{
+  uint64_t m = (uint64_t)x * n;
+  uint32_t l = (uint32_t)m;
+  uint32_t t;
+
+  if (l < n) {
+    t = (uint32_t)(-n) % n; /* 2^32 mod n: number of values to reject */
+    while (l < t) {
+      x = (uint32_t)prng_next(prng).v[0];
+      m = (uint64_t)x * n;
+      l = (uint32_t)m;
+    }
+  }
+  return (uint_t)(m >> 32);
+}
+#endif
+
 /*
  * Uniform random integer in 0..n-1 (inclusive)
  */
-uint_t int_urand(uint_t n)
+uint_t prng_int_urand(prng_t *prng, uint_t n)
 {
-/* TODO using modulo here introdues bias; this is not really a uniform
-   distirbutin at all. Should fix this by using rejection sampling,
-   but not as important as having a large period on the PRNG
-   (probably) */
 #ifdef USE_RANDOM123
-  ctr.v[0]++;
-  threefry2x64_ctr_t randv = threefry2x64(ctr, key);
-  return randv.v[0] % n;
+  return bounded_urand(prng, (uint32_t)prng_next(prng).v[0], n);
 #else
+  (void)prng;
   return rand() % n; 
 #endif
 }
 
+/*
+ * Uniform random 64 bit integer in 0..n-1 (inclusive), for ranges too
+ * large for prng_int_urand(). The random word is masked down to the
+ * smallest power of two no less than n and values n or more rejected,
+ * so on average fewer than two words are needed.
+ */
+uint64_t prng_int_urand64(prng_t *prng, uint64_t n)
+{
+  uint64_t mask = n - 1, r;
+
+  assert(n > 0);
+  mask |= mask >> 1;  mask |= mask >> 2;  mask |= mask >> 4;
+  mask |= mask >> 8;  mask |= mask >> 16; mask |= mask >> 32;
+  do {
+#ifdef USE_RANDOM123
+    r = prng_next(prng).v[0] & mask;
+#else
+    (void)prng;
+    r = (((uint64_t)rand() << 32) ^ (uint64_t)rand()) & mask;
+#endif
+  } while (r >= n);
+  return r;
+}
+
+/*
+ * Uniform random ordered pair of distinct integers in 0..n-1 (n >= 2).
+ * Both come from one 64 bit random word (32 bits each), the second
+ * being drawn from the n-1 values other than the first so that there is
+ * no retry loop for i == j.
+ *
+ * Parameters:
+ *    prng - generator state, updated
+ *    n    - number of values to choose from
+ *    i    - (Out) first integer
+ *    j    - (Out) second integer, not equal to i
+ *
+ * Return value:
+ *   None.
+ */
+void prng_int_urand_pair(prng_t *prng, uint_t n, uint_t *i, uint_t *j)
+{
+  uint_t a, b;
+#ifdef USE_RANDOM123
+  uint64_t r = prng_next(prng).v[0];
+  assert(n >= 2);
+  a = bounded_urand(prng, (uint32_t)r, n);
+  b = bounded_urand(prng, (uint32_t)(r >> 32), n - 1);
+#else
+  a = prng_int_urand(prng, n);
+  b = prng_int_urand(prng, n - 1);
+#endif
+  b += (b >= a); /* skip over a (without an unpredictable branch) */
+  *i = a;
+  *j = b;
+}
+
+/*
+ * Fill an array with uniform random numbers in closed interval [0,1].
+ * This uses both 64 bit words of each generator output, so costs half
+ * the block cipher evaluations of the same number of prng_urand()
+ * calls (but gives a different sequence).
+ *
+ * Parameters:
+ *    prng  - generator state, updated
+ *    r     - (Out) array of count random numbers, allocated by caller
+ *    count - number of random numbers to generate
+ *
+ * Return value:
+ *   None.
+ */
+void prng_urand_block(prng_t *prng, double r[], uint_t count)
+{
+#ifdef USE_RANDOM123
+  uint_t i;
+  threefry2x64_ctr_t randv;
+  for (i = 0; i + 1 < count; i += 2) {
+    randv = prng_next(prng);
+    r[i]   = (double)randv.v[0]/ULLONG_MAX;
+    r[i+1] = (double)randv.v[1]/ULLONG_MAX;
+  }
+  if (i < count)
+    r[i] = prng_urand(prng);
+#else
+  uint_t i;
+  for (i = 0; i < count; i++)
+    r[i] = prng_urand(prng);
+#endif
+}
+
 
 
 
@@ -206,6 +612,181 @@ double mean_and_sd(double values[], uint_t nvalues, double *sd)
 }
 
 
+/*
+ * Compute lag-1 autocorrelation and effective sample size of a series
+ *
+ * Parameters:
+ *    values  - array of values of the series in order
+ *    nvalues - length of values array (at least 2)
+ *    ess     - (Out) effective sample size nvalues * (1 - r) / (1 + r)
+ *              (for an AR(1) series with lag-1 autocorrelation r)
+ *
+ * Return value:
+ *   lag-1 autocorrelation r of the values, 0 if they are all equal
+ *
+ */
+double lag1_autocorrelation(const double values[], uint_t nvalues,
+                            double *ess)
+{
+  uint_t  i;
+  double  mean = 0, var = 0, cov = 0;
+  double  r;
+
+  for (i = 0; i < nvalues; i++)
+    mean += values[i];
+  mean /= nvalues;
+  for (i = 0; i < nvalues; i++) {
+    var += (values[i] - mean) * (values[i] - mean);
+    if (i + 1 < nvalues)
+      cov += (values[i] - mean) * (values[i+1] - mean);
+  }
+  r = var > 0 ? cov / var : 0;
+  /* the estimate can be (just) outside [-1, 1] for short series */
+  r = MAX(MIN(r, 1), -1);
+  *ess = r > -1 ? nvalues * (1 - r) / (1 + r) : nvalues;
+  return r;
+}
+
+
+/*
+ * Initialize running statistics of n variables, with no observations.
+ *
+ * The mean and variance (and optionally covariance) are updated as
+ * each observation is added with Welford's algorithm, so they can be
+ * computed in one pass without storing the observations.
+ *
+ * Parameters:
+ *    stats      - (Out) running statistics, arrays allocated here,
+ *                 free with free_online_stats()
+ *    n          - number of variables
+ *    covariance - if True also compute the covariance of every pair of
+ *                 variables (O(n^2) time per observation)
+ *
+ * Return value:
+ *   None.
+ *
+ */
+void init_online_stats(online_stats_t *stats, uint_t n, bool covariance)
+{
+  stats->n = n;
+  stats->mean = (double *)safe_malloc(n * sizeof(double));
+  stats->m2 = (double *)safe_malloc(n * sizeof(double));
+  stats->comoment = covariance ?
+    (double *)safe_malloc((size_t)n * n * sizeof(double)) : NULL;
+  reset_online_stats(stats);
+}
+
+/*
+ * Discard all observations from running statistics.
+ *
+ * Parameters:
+ *    stats - running statistics
+ *
+ * Return value:
+ *   None.
+ *
+ */
+void reset_online_stats(online_stats_t *stats)
+{
+  uint_t i;
+
+  stats->count = 0;
+  for (i = 0; i < stats->n; i++)
+    stats->mean[i] = stats->m2[i] = 0;
+  if (stats->comoment)
+    for (i = 0; i < stats->n * stats->n; i++)
+      stats->comoment[i] = 0;
+}
+
+/*
+ * Add an observation to running statistics.
+ *
+ * Parameters:
+ *    stats - running statistics
+ *    x     - observed value of each of the stats->n variables
+ *
+ * Return value:
+ *   None.
+ *
+ */
+void add_online_stats(online_stats_t *stats, const double x[])
+{
+  uint_t i, j;
+  double delta;
+
+  stats->count++;
+  if (stats->comoment) {
+    /* comoment[i][j] += (x[i] - old mean[i]) * (x[j] - new mean[j]),
+       so update the means after computing all the old differences */
+    for (i = 0; i < stats->n; i++) {
+      delta = (x[i] - stats->mean[i]) / stats->count;
+      for (j = 0; j < stats->n; j++)
+        stats->comoment[i * stats->n + j] += (stats->count - 1) * delta *
+          (x[j] - stats->mean[j]);
+    }
+  }
+  for (i = 0; i < stats->n; i++) {
+    delta = x[i] - stats->mean[i];
+    stats->mean[i] += delta / stats->count;
+    stats->m2[i] += delta * (x[i] - stats->mean[i]);
+  }
+}
+
+/*
+ * Standard deviation of a variable from running statistics, dividing
+ * by the number of observations (as mean_and_sd()).
+ *
+ * Parameters:
+ *    stats - running statistics
+ *    i     - index of variable
+ *
+ * Return value:
+ *   standard deviation of variable i, 0 if no observations
+ *
+ */
+double online_stats_sd(const online_stats_t *stats, uint_t i)
+{
+  return stats->count > 0 ? sqrt(MAX(stats->m2[i], 0) / stats->count) : 0;
+}
+
+/*
+ * Sample covariance of two variables from running statistics
+ * (which must have been initialized with covariance True).
+ *
+ * Parameters:
+ *    stats - running statistics
+ *    i, j  - indices of variables
+ *
+ * Return value:
+ *   covariance of variables i and j, 0 if fewer than two observations
+ *
+ */
+double online_stats_covariance(const online_stats_t *stats, uint_t i, uint_t j)
+{
+  assert(stats->comoment);
+  return stats->count > 1 ?
+    stats->comoment[i * stats->n + j] / (stats->count - 1) : 0;
+}
+
+/*
+ * Free the arrays of running statistics.
+ *
+ * Parameters:
+ *    stats - running statistics initialized with init_online_stats()
+ *
+ * Return value:
+ *   None.
+ *
+ */
+void free_online_stats(online_stats_t *stats)
+{
+  free(stats->mean);
+  free(stats->m2);
+  free(stats->comoment);
+  stats->mean = stats->m2 = stats->comoment = NULL;
+}
+
+
 /*
  * iDivUp(a,b) = ceil(a / b) 
  */
@@ -272,6 +853,257 @@ char *rstrip(char *s)
 }
 
 
+/*
+ * Compressed input files are read through a decompressor process
+ * (gzip or zstd, which must be in the PATH) so the decompression runs
+ * concurrently with the parsing and no library is needed. These are
+ * the streams opened that way, which have to be closed with pclose().
+ * Files can be opened and closed by several threads at once (e.g. the
+ * arc list and the attribute files with overlapLoad), so the table is
+ * protected by input_pipes_lock.
+ */
+#define MAX_INPUT_PIPES 16
+#define MIN_INPUT_BUFFER (1 << 20) /* initial buffer size for reading a
+                                      compressed file into memory */
+static FILE *input_pipes[MAX_INPUT_PIPES];
+static pthread_mutex_t input_pipes_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ * Command (without the filename) to decompress a file to stdout,
+ * according to the magic number at its start, or NULL if it is not
+ * compressed (or cannot be read).
+ */
+static const char *input_decompressor(const char *filename)
+{
+  static const unsigned char gzip_magic[] = {0x1f, 0x8b};
+  static const unsigned char zstd_magic[] = {0x28, 0xb5, 0x2f, 0xfd};
+  unsigned char magic[4];
+  size_t        len;
+  FILE         *fp;
+
+  if (!(fp = fopen(filename, "rb")))
+    return NULL;
+  len = fread(magic, 1, sizeof(magic), fp);
+  fclose(fp);
+  if (len >= sizeof(gzip_magic) &&
+      memcmp(magic, gzip_magic, sizeof(gzip_magic)) == 0)
+    return "gzip -dc";
+  if (len >= sizeof(zstd_magic) &&
+      memcmp(magic, zstd_magic, sizeof(zstd_magic)) == 0)
+    return "zstd -dcq";
+  return NULL;
+}
+
+/*
+ * Test if a file is gzip or zstd compressed.
+ *
+ * Parameters:
+ *    filename - name of file
+ *
+ * Return value:
+ *    True if the file is compressed (so has to be read with
+ *    open_input_file()) else False.
+ */
+bool is_compressed_file(const char *filename)
+{
+  return input_decompressor(filename) != NULL;
+}
+
+/*
+ * Open a text input file for reading, decompressing it as it is read
+ * if it is gzip or zstd compressed (detected from its contents, not
+ * its name).
+ *
+ * Parameters:
+ *    filename - name of file to open
+ *
+ * Return value:
+ *    Stream to read the (decompressed) file from, to be closed with
+ *    close_input_file(), or NULL on error (with errno set) as fopen().
+ */
+FILE *open_input_file(const char *filename)
+{
+  const char *decompressor = input_decompressor(filename);
+  const char *p;
+  char       *command, *q;
+  FILE       *fp;
+  uint_t      k;
+
+  if (!decompressor)
+    return fopen(filename, "r");
+  /* the slot is held by the lock until the stream is stored in it */
+  pthread_mutex_lock(&input_pipes_lock);
+  for (k = 0; k < MAX_INPUT_PIPES && input_pipes[k]; k++)
+    /*nothing*/;
+  if (k == MAX_INPUT_PIPES) {
+    pthread_mutex_unlock(&input_pipes_lock);
+    errno = EMFILE;
+    return NULL;
+  }
+  /* the filename is quoted for the shell, with each ' as '\'' */
+  command = (char *)safe_malloc(strlen(decompressor) +
+                                4 * strlen(filename) + 16);
+  q = command + sprintf(command, "exec %s -- '", decompressor);
+  for (p = filename; *p; p++) {
+    if (*p == '\'') {
+      strcpy(q, "'\\''");
+      q += 4;
+    } else {
+      *q++ = *p;
+    }
+  }
+  strcpy(q, "'");
+  fflush(NULL); /* so buffered output is not duplicated in the child */
+  fp = popen(command, "r");
+  free(command);
+  input_pipes[k] = fp;
+  pthread_mutex_unlock(&input_pipes_lock);
+  return fp;
+}
+
+/*
+ * Close a stream opened with open_input_file().
+ *
+ * Parameters:
+ *    fp - stream to close
+ *
+ * Return value:
+ *    0 if OK else nonzero on error, including the decompressor failing
+ *    (message printed to stderr).
+ */
+int close_input_file(FILE *fp)
+{
+  uint_t k;
+  int    status;
+
+  pthread_mutex_lock(&input_pipes_lock);
+  for (k = 0; k < MAX_INPUT_PIPES && input_pipes[k] != fp; k++)
+    /*nothing*/;
+  if (k < MAX_INPUT_PIPES)
+    input_pipes[k] = NULL;
+  pthread_mutex_unlock(&input_pipes_lock);
+  if (k < MAX_INPUT_PIPES) {
+    status = pclose(fp);
+    /* the decompressor gets SIGPIPE if the file was not read to the
+       end (e.g. only the header of an arc list), which is not an error */
+    if (status != 0 &&
+        !(WIFSIGNALED(status) && WTERMSIG(status) == SIGPIPE)) {
+      fprintf(stderr, "ERROR: decompressing input failed (status %d)\n",
+              status);
+      return -1;
+    }
+    return 0;
+  }
+  return fclose(fp);
+}
+
+/*
+ * Read the whole of a (compressed) input file into memory.
+ *
+ * Parameters:
+ *    filename - name of file to read, through open_input_file()
+ *    size     - (out) number of bytes read
+ *
+ * Return value:
+ *    Contents of the file (decompressed), allocated here, or NULL on
+ *    error (message printed to stderr).
+ */
+char *read_input_file(const char *filename, size_t *size)
+{
+  FILE   *fp;
+  char   *buf;
+  size_t  capacity = MIN_INPUT_BUFFER, len = 0, n;
+  int     err;
+
+  if (!(fp = open_input_file(filename))) {
+    fprintf(stderr, "ERROR: could not open file %s (%s)\n", filename,
+            strerror(errno));
+    return NULL;
+  }
+  buf = (char *)safe_malloc(capacity);
+  while ((n = fread(buf + len, 1, capacity - len, fp)) > 0) {
+    len += n;
+    if (len == capacity) {
+      capacity *= 2;
+      buf = (char *)safe_realloc(buf, capacity);
+    }
+  }
+  err = ferror(fp);
+  err |= close_input_file(fp) != 0;
+  if (err) {
+    fprintf(stderr, "ERROR: reading file %s failed\n", filename);
+    free(buf);
+    return NULL;
+  }
+  *size = len;
+  return buf;
+}
+
+/*
+ * Map a text input file into memory, or if it is compressed,
+ * decompress it into memory.
+ *
+ * Parameters:
+ *    filename   - name of file to read
+ *    size       - (out) number of bytes in file (decompressed)
+ *    compressed - (out) TRUE if the file was compressed
+ *
+ * Return value:
+ *    Contents of the file (not terminated), to be released with
+ *    unmap_input_file(); not valid if size is 0. NULL on error (message
+ *    printed to stderr).
+ */
+char *map_input_file(const char *filename, size_t *size, bool *compressed)
+{
+  int         fd;
+  struct stat st;
+  static char empty[1];  /* returned for an empty file (size 0) */
+  char       *map = empty;
+
+  if ((*compressed = is_compressed_file(filename)))
+    return read_input_file(filename, size);
+  if ((fd = open(filename, O_RDONLY)) < 0 || fstat(fd, &st) != 0) {
+    fprintf(stderr, "ERROR: could not open file %s (%s)\n", filename,
+            strerror(errno));
+    if (fd >= 0)
+      close(fd);
+    return NULL;
+  }
+  *size = (size_t)st.st_size;
+  if (*size > 0) {
+    map = mmap(NULL, *size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+      fprintf(stderr, "ERROR: could not map file %s (%s)\n", filename,
+              strerror(errno));
+      close(fd);
+      return NULL;
+    }
+    (void)madvise(map, *size, MADV_SEQUENTIAL);
+  }
+  close(fd);
+  return map;
+}
+
+/*
+ * Release a file read by map_input_file().
+ *
+ * Parameters:
+ *    map        - contents of file from map_input_file()
+ *    size       - number of bytes in file
+ *    compressed - TRUE if the file was compressed
+ *
+ * Return value:
+ *    None.
+ */
+void unmap_input_file(char *map, size_t size, bool compressed)
+{
+  if (compressed)
+    free(map);
+  else if (size > 0)
+    munmap(map, size);
+}
+
+
 
 /* compute three-dimensional Euclidean distance between two points with
    x,y,z coordinates */
@@ -282,19 +1114,54 @@ double euclidean_distance(double x1, double y1, double z1,
 }
 
 
+#ifdef USE_POW_LOOKUP
 /*
- * Initialize the integer power y of double x lookup table
+ * Integer power y of double x, from the lookup table for x.
+ * The table is created on the first call with x, and grown (doubling
+ * from POWTABLE_SIZE entries) whenever y is beyond its end, so there
+ * is no fallback to pow() for large y (e.g. the degree of a hub node).
+ *
+ * Parameters:
+ *    x - base
+ *    y - exponent
+ *
+ * Return value:
+ *    pow(x, y)
  */
-void init_powtable(double x)
+double pow_lookup(double x, uint_t y)
 {
-#ifdef USE_POW_LOOKUP
-  uint_t y;
+  powtable_t *t;
+  uint_t      k, newsize;
 
-  for (y = 0; y < POWTABLE_SIZE; y++) {
-    POWTABLE[y] = pow(x, y);
+  if (num_powtables == 0 ||
+      !DOUBLE_APPROX_EQ(powtables[last_powtable].base, x)) {
+    for (k = 0; k < num_powtables; k++) {
+      if (DOUBLE_APPROX_EQ(powtables[k].base, x))
+        break;
+    }
+    if (k == num_powtables) {
+      powtables = (powtable_t *)safe_realloc(powtables, (num_powtables + 1) *
+                                             sizeof(powtable_t));
+      powtables[k].base = x;
+      powtables[k].values = NULL;
+      powtables[k].size = 0;
+      num_powtables++;
+    }
+    last_powtable = k;
   }
-#endif
+  t = &powtables[last_powtable];
+  if (y >= t->size) {
+    newsize = t->size < POWTABLE_SIZE ? POWTABLE_SIZE : t->size;
+    while (newsize <= y)
+      newsize = newsize > UINT_MAX / 2 ? UINT_MAX : 2 * newsize;
+    t->values = (double *)safe_realloc(t->values, newsize * sizeof(double));
+    for (k = t->size; k < newsize; k++)
+      t->values[k] = pow(x, k);
+    t->size = newsize;
+  }
+  return t->values[y];
 }
+#endif
 
 
 /*****************************************************************************
@@ -305,6 +1172,7 @@ void init_powtable(double x)
 
 
 const long double pi = 3.14159265358979323846;
+static const double mean_earth_radius = 6371; /* km */
 
 /* convert degrees to radians */
 long double deg2rad(long double deg)
@@ -322,7 +1190,6 @@ long double rad2deg(long double rad)
    specifed by latitude and longitude in degrees
    see e.g. https://en.wikipedia.org/wiki/Great-circle_distance*/
 double geo_distance(double lat1, double lon1, double lat2, double lon2) {
-  const double mean_earth_radius = 6371; /* km */
   long double theta, central_angle, dist;
   theta = lon1 - lon2;
   central_angle = acos( sin(deg2rad(lat1)) * sin(deg2rad(lat2))
@@ -332,3 +1199,38 @@ double geo_distance(double lat1, double lon1, double lat2, double lon2) {
   return dist;
 }
 
+/* convert latitude and longitude in degrees to the (x, y, z) cartesian
+   coordinates of the point on the unit sphere, so that the distance
+   between two points can be computed by geo_distance_unit_vectors()
+   with no trigonometric functions other than a single acos() */
+void geo_unit_vector(double lat, double lon, double *x, double *y, double *z)
+{
+  double phi = deg2rad(lat), lambda = deg2rad(lon);
+  *x = cos(phi) * cos(lambda);
+  *y = cos(phi) * sin(lambda);
+  *z = sin(phi);
+}
+
+/* compute geographical (great-circle) distance in km between two points
+   specified as unit vectors from geo_unit_vector(). The cosine of the
+   central angle is just the dot product (clamped to [-1, 1] in case
+   of rounding error so acos() cannot return NaN) */
+double geo_distance_unit_vectors(double x1, double y1, double z1,
+                                 double x2, double y2, double z2)
+{
+  return geo_distance_cos(x1*x2 + y1*y2 + z1*z2);
+}
+
+/* compute geographical (great-circle) distance in km from the cosine
+   of the central angle (the dot product of the unit vectors), as
+   geo_distance_unit_vectors() does, for the batched change statistics
+   that compute the dot products of many pairs first */
+double geo_distance_cos(double cos_angle)
+{
+  if (cos_angle > 1)
+    cos_angle = 1;
+  else if (cos_angle < -1)
+    cos_angle = -1;
+  return mean_earth_radius * acos(cos_angle);
+}
+
@@ -14,6 +14,7 @@
  *
  ****************************************************************************/
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
 #include <sys/time.h>
@@ -83,19 +84,72 @@ extern "C" {
 #define TRUE 1
 
 #define MAX(a, b) ( (a) > (b) ? (a) : (b) )
+#define MIN(a, b) ( (a) < (b) ? (a) : (b) )
+
+/*
+ * CPU_DISPATCH before a function definition compiles it for
+ * several instruction sets with GCC function multiversioning, and the
+ * dynamic loader (ifunc, so Linux/glibc) resolves calls to the best one
+ * for the CPU at startup. The x86 clones are the x86-64 microarchitecture
+ * levels (v2: SSE4.2 and POPCNT, v3: AVX2, v4: AVX-512), the ARM ones SVE
+ * and SVE2 (NEON is always available on AArch64). As common.mk compiles
+ * with -ffp-contract=off, the clones with FMA give exactly the same
+ * results as the baseline one.
+ */
+#if !defined(NO_CPU_DISPATCH) && defined(__linux__) && \
+    defined(__GNUC__) && !defined(__clang__) && \
+    defined(__x86_64__) && __GNUC__ >= 12
+#define CPU_DISPATCH __attribute__((target_clones("arch=x86-64-v4", \
+                                                   "arch=x86-64-v3", \
+                                                   "arch=x86-64-v2", \
+                                                   "default")))
+#define CPU_DISPATCH_X86
+#elif !defined(NO_CPU_DISPATCH) && defined(__linux__) && \
+    defined(__GNUC__) && !defined(__clang__) && \
+    defined(__aarch64__) && __GNUC__ >= 14
+#define CPU_DISPATCH __attribute__((target_clones("sve2", "sve", \
+                                                   "default")))
+#define CPU_DISPATCH_AARCH64
+#else
+#define CPU_DISPATCH
+#endif
+
   
+/* Bound on the error of the approximate log(u) from prng_urand_log()
+   (the actual error is much smaller, see approx_log() in utils.c) */
+#define PRNG_LOG_URAND_ERROR 1e-10
+
 /* Index into 2d n x n array stored row-major in contiguous memory  */
 #define INDEX2D(i,j,n) ( ((size_t)(i)*(n) + (j)) )
+
+/* Index into upper triangle (including diagonal) of n x n array stored
+   row-major packed in contiguous memory of n(n+1)/2 entries; requires i <= j */
+#define INDEX_UPPERTRI(i,j,n) ( (size_t)(i)*(n) - \
+                                ((size_t)(i)*((size_t)(i)-1))/2 + ((j)-(i)) )
+
+/* Index into symmetric n x n array stored as packed upper triangle */
+#define INDEX_SYM2D(i,j,n) ( (i) <= (j) ? INDEX_UPPERTRI((i),(j),(n)) : \
+                                          INDEX_UPPERTRI((j),(i),(n)) )
   
+/* Hint to fetch the cache line containing addr (no effect if the compiler
+   has no such builtin) */
+#ifdef __GNUC__
+#define PREFETCH(addr) __builtin_prefetch(addr)
+#else
+#define PREFETCH(addr) ((void)(addr))
+#endif
+
 /* Approximate double floating point equality */
 #define DOUBLE_APPROX_EQ(a, b) ( fabs((a) - (b)) <= DBL_EPSILON )
 
 #ifdef USE_POW_LOOKUP
-/* Integer power y of double x, may be faster than pow(x, y). x set in
-   init_powtable(). Note CANNOT compile with -ffast-math on gcc as we
-   depend on IEEE handling of NaN in changeStatisticsDirected.c */
-#define POWTABLE_SIZE 10000 /* number of entries in POW_TABLE */
-#define POW_LOOKUP(x, y) ((y) < POWTABLE_SIZE ? POWTABLE[(y)] : pow((x), (y)))
+/* Integer power y of double x, may be faster than pow(x, y). There is
+   a lookup table for each distinct x, built on first use and grown as
+   needed so pow() is only called to fill it. Note CANNOT compile with
+   -ffast-math on gcc as we depend on IEEE handling of NaN in
+   changeStatisticsDirected.c */
+#define POWTABLE_SIZE 10000 /* initial number of entries in a power table */
+#define POW_LOOKUP(x, y) (pow_lookup((x), (y)))
 #else
 #define POW_LOOKUP(x, y) (pow((x), (y)))
 #endif
@@ -118,20 +172,32 @@ typedef struct string_pair_s /* pair (tuple) of strings */
   char *second;
 } string_pair_t;
 
+/* State of one pseudorandom number stream (counter-based generator, so
+   the state is just the counter and the key identifying the stream).
+   Each thread must use its own. The words are those of the Random123
+   threefry2x64 counter and key, kept as plain integers here so that
+   Random123 is only included by utils.c. */
+typedef struct prng_s {
+  uint64_t ctr[2]; /* counter, incremented for each output */
+  uint64_t key[2]; /* (seed, task and stream number) */
+} prng_t;
+
 typedef struct uint_pair_s /* pair (tuple) of unsigned integers */
 {
   uint_t first;
   uint_t second;
 } uint_pair_t;
 
-/*****************************************************************************
- *
- * externally visible variable declarations
- *
- ****************************************************************************/
+typedef struct online_stats_s /* running mean and (co)variance (Welford) */
+{
+  uint_t  n;        /* number of variables */
+  uint_t  count;    /* number of observations added */
+  double *mean;     /* n running means */
+  double *m2;       /* n sums of squared differences from the mean */
+  double *comoment; /* n*n sums of products of differences from the means,
+                       NULL if covariance not computed */
+} online_stats_t;
 
-extern double POWTABLE[];
-  
 /*****************************************************************************
  *
  * function prototypes
@@ -142,8 +208,18 @@ extern double POWTABLE[];
 /* pseudorandom numbers */
 
 void init_prng(int tasknum); /* initialize the pseudorandom number generator */
-double urand(void); /* uniform random double in [0,1] */
-uint_t int_urand(uint_t n); /* uniform random int in 0...n-1 inclusive */
+void set_prng_seed(uint64_t seed); /* use given seed rather than time */
+void set_prng_task(uint64_t tasknum); /* use given task number for streams */
+void prng_init_stream(prng_t *prng, uint64_t stream); /* start stream of task */
+double prng_urand(prng_t *prng); /* uniform random double in [0,1] */
+double prng_urand_log(prng_t *prng, double *log_u); /* and its log */
+bool urand_accept(double u, double log_u, double log_alpha);
+bool prng_accept(prng_t *prng, double log_alpha); /* urand < exp(log_alpha) */
+uint_t prng_int_urand(prng_t *prng, uint_t n); /* uniform random int 0..n-1 */
+uint64_t prng_int_urand64(prng_t *prng, uint64_t n); /* 64 bit int 0..n-1 */
+void prng_int_urand_pair(prng_t *prng, uint_t n, uint_t *i, uint_t *j);
+                          /* uniform random i != j in 0..n-1 */
+void prng_urand_block(prng_t *prng, double r[], uint_t count); /* count urands */
   
 /* memory allocation */
 
@@ -155,13 +231,34 @@ char *safe_strdup(const char *s);
 /* simple stats functions */
 
 double mean_and_sd(double values[], uint_t nvalues, double *sd);
+double lag1_autocorrelation(const double values[], uint_t nvalues,
+                            double *ess);
+void init_online_stats(online_stats_t *stats, uint_t n, bool covariance);
+void reset_online_stats(online_stats_t *stats);
+void add_online_stats(online_stats_t *stats, const double x[]);
+double online_stats_sd(const online_stats_t *stats, uint_t i);
+double online_stats_covariance(const online_stats_t *stats, uint_t i, uint_t j);
+void free_online_stats(online_stats_t *stats);
 
 /* geographical functions */
   
 long double deg2rad(long double deg);
 long double rad2deg(long double rad);
 double geo_distance(double lat1, double lon1, double lat2, double lon2);
+void geo_unit_vector(double lat, double lon, double *x, double *y, double *z);
+double geo_distance_unit_vectors(double x1, double y1, double z1,
+                                 double x2, double y2, double z2);
+double geo_distance_cos(double cos_angle);
+
+
+/* input files (optionally compressed) */
 
+bool is_compressed_file(const char *filename);
+FILE *open_input_file(const char *filename);
+int close_input_file(FILE *fp);
+char *read_input_file(const char *filename, size_t *size);
+char *map_input_file(const char *filename, size_t *size, bool *compressed);
+void unmap_input_file(char *map, size_t size, bool compressed);
 
 /* miscellaneous */
 
@@ -174,7 +271,9 @@ int timeval_subtract (struct timeval *result, struct timeval *x,
                        struct timeval *y);
 char *rstrip(char *s);
 
-void init_powtable(double x);
+#ifdef USE_POW_LOOKUP
+double pow_lookup(double x, uint_t y);
+#endif
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,298 @@
+/*****************************************************************************
+ *
+ * File:    warmStart.c
+ * Author:  Alex Stivala
+ * Created: October 2026
+ *
+ * Starting values of theta and D0 for an estimation from a previous
+ * one (see warmStart.h).
+ *
+ ****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include "warmStart.h"
+
+/*****************************************************************************
+ *
+ * Local constants
+ *
+ ****************************************************************************/
+
+#define WARM_START_MAX_TOKENS 65536 /* max tokens on a line */
+
+static const char *WARM_START_DELIMS = " \t\r=";
+
+/*****************************************************************************
+ *
+ * Local functions
+ *
+ ****************************************************************************/
+
+/*
+ * Split a line into tokens, in place.
+ *
+ * Parameters:
+ *   line   - (in/out) line (without newline), modified
+ *   tokens - (out) the tokens, WARM_START_MAX_TOKENS entries
+ *
+ * Return value:
+ *   Number of tokens.
+ */
+static uint_t split_line(char *line, char *tokens[])
+{
+  char   *saveptr = NULL, *tok;
+  uint_t  num = 0;
+
+  for (tok = strtok_r(line, WARM_START_DELIMS, &saveptr);
+       tok && num < WARM_START_MAX_TOKENS;
+       tok = strtok_r(NULL, WARM_START_DELIMS, &saveptr))
+    tokens[num++] = tok;
+  return num;
+}
+
+/*
+ * Parse a token as a number.
+ *
+ * Parameters:
+ *   tok   - token
+ *   value - (out) its value
+ *
+ * Return value:
+ *   TRUE if the whole token is a number (not NA) else FALSE.
+ */
+static bool parse_number(const char *tok, double *value)
+{
+  char *endptr;
+
+  *value = strtod(tok, &endptr);
+  return endptr != tok && *endptr == '\0' && strcasecmp(tok, "NA") != 0 &&
+    strcasecmp(tok, "nan") != 0;
+}
+
+/*
+ * Find a parameter of the model by name.
+ *
+ * Parameters:
+ *   names - the n parameter names of the model
+ *   n     - number of parameters
+ *   name  - name to find
+ *
+ * Return value:
+ *   Index of the parameter, or n if it is not in the model.
+ */
+static uint_t find_param(char *const names[], uint_t n, const char *name)
+{
+  uint_t l;
+
+  for (l = 0; l < n && strcmp(names[l], name) != 0; l++)
+    ;
+  return l;
+}
+
+/*****************************************************************************
+ *
+ * External functions
+ *
+ ****************************************************************************/
+
+/*
+ * Read starting values of theta and D0 for the parameters of a model
+ * from a file in one of the formats described in warmStart.h.
+ *
+ * Parameters:
+ *   filename    - name of file to read (may be compressed)
+ *   param_names - the n parameter names of the model (in the order of
+ *                 theta) separated by spaces
+ *   n           - number of parameters
+ *   warm_start  - (out) the starting values, to be freed with
+ *                 free_warm_start(); Ssteps is set to 0
+ *
+ * Return value:
+ *   0 if OK else -1 on error (message printed to stderr).
+ */
+int read_warm_start(const char *filename, const char *param_names,
+                    uint_t n, ee_warm_start_t *warm_start)
+{
+  size_t  size;
+  bool    compressed;
+  char   *map, *text, *line, *eol;
+  char  **names, **tokens, **header = NULL, **last = NULL;
+  char   *names_copy, *saveptr = NULL;
+  uint_t  num_tokens, num_header = 0, num_last = 0, l, k;
+  bool    summary, series, in_pooled = FALSE;
+  bool   *found_theta;
+  double  value;
+  int     rc = 0;
+
+  memset(warm_start, 0, sizeof(ee_warm_start_t));
+  if (!(map = map_input_file(filename, &size, &compressed))) {
+    fprintf(stderr, "ERROR: could not read warm start file %s\n", filename);
+    return -1;
+  }
+  text = (char *)safe_malloc(size + 1);
+  memcpy(text, map, size);
+  text[size] = '\0';
+  unmap_input_file(map, size, compressed);
+
+  names_copy = safe_strdup(param_names);
+  names = (char **)safe_malloc((n + 1) * sizeof(char *));
+  for (l = 0; l < n; l++) {
+    names[l] = strtok_r(l == 0 ? names_copy : NULL, " ", &saveptr);
+    if (!names[l])
+      names[l] = names_copy + strlen(names_copy); /* "" */
+  }
+  tokens = (char **)safe_malloc(WARM_START_MAX_TOKENS * sizeof(char *));
+  warm_start->n = n;
+  warm_start->theta = (double *)safe_calloc(MAX(n, 1), sizeof(double));
+  warm_start->D0 = (double *)safe_calloc(MAX(n, 1), sizeof(double));
+  found_theta = (bool *)safe_calloc(MAX(n, 1), sizeof(bool));
+
+  /* a summary file has a line "Pooled", a theta file a header line
+     starting with "t" */
+  summary = strstr(text, "\nPooled\n") != NULL ||
+    strstr(text, "\nPooled\r\n") != NULL;
+  line = text + strspn(text, " \t\r\n");
+  series = !summary && line[0] == 't' && (line[1] == ' ' || line[1] == '\t');
+
+  for (line = text; line && *line; line = eol) {
+    if ((eol = strchr(line, '\n')))
+      *eol++ = '\0';
+    num_tokens = split_line(line, tokens);
+    if (summary) {
+      /* the pooled estimates are from "Pooled" to a blank line (or
+         TotalRuns) */
+      if (num_tokens == 1 && strcmp(tokens[0], "Pooled") == 0)
+        in_pooled = TRUE;
+      else if (num_tokens == 0 || strcmp(tokens[0], "TotalRuns") == 0)
+        in_pooled = FALSE;
+      else if (in_pooled && num_tokens >= 2 &&
+               (l = find_param(names, n, tokens[0])) < n &&
+               parse_number(tokens[1], &value)) {
+        warm_start->theta[l] = value;
+        found_theta[l] = TRUE;
+      }
+    } else if (series) {
+      /* keep the header and the last line, matched up afterwards */
+      if (num_tokens == 0)
+        continue;
+      if (!header) {
+        header = (char **)safe_malloc(num_tokens * sizeof(char *));
+        last = (char **)safe_malloc(num_tokens * sizeof(char *));
+        memcpy(header, tokens, num_tokens * sizeof(char *));
+        num_header = num_tokens;
+      } else {
+        num_last = MIN(num_tokens, num_header);
+        memcpy(last, tokens, num_last * sizeof(char *));
+      }
+    } else if (num_tokens >= 2 &&
+               (l = find_param(names, n, tokens[0])) < n &&
+               parse_number(tokens[1], &value)) {
+      /* name value [D0] */
+      warm_start->theta[l] = value;
+      found_theta[l] = TRUE;
+      if (num_tokens >= 3 && parse_number(tokens[2], &value) && value > 0)
+        warm_start->D0[l] = value;
+    }
+  }
+  if (series) {
+    /* the tokens point into text, so are still valid */
+    for (k = 0; k < num_last; k++) {
+      if ((l = find_param(names, n, header[k])) < n &&
+          parse_number(last[k], &value)) {
+        warm_start->theta[l] = value;
+        found_theta[l] = TRUE;
+      }
+    }
+  }
+
+  for (l = 0; l < n; l++) {
+    if (found_theta[l])
+      warm_start->num_theta++;
+    if (warm_start->D0[l] > 0)
+      warm_start->num_D0++;
+  }
+  if (warm_start->num_theta == 0) {
+    fprintf(stderr, "ERROR: no values for the parameters of the model "
+            "in warm start file %s\n", filename);
+    free_warm_start(warm_start);
+    rc = -1;
+  } else {
+    for (l = 0; l < n; l++)
+      if (!found_theta[l])
+        printf("parameter %s not in warm start file %s, starting from 0\n",
+               names[l], filename);
+  }
+  free(found_theta);
+  free(header);
+  free(last);
+  free(tokens);
+  free(names);
+  free(names_copy);
+  free(text);
+  return rc;
+}
+
+/*
+ * Free the starting values read by read_warm_start().
+ *
+ * Parameters:
+ *   warm_start - starting values
+ *
+ * Return value:
+ *   None.
+ */
+void free_warm_start(ee_warm_start_t *warm_start)
+{
+  free(warm_start->theta);
+  free(warm_start->D0);
+  warm_start->theta = warm_start->D0 = NULL;
+  warm_start->num_theta = warm_start->num_D0 = 0;
+}
+
+/*
+ * Write a warm start file for a later estimation: a header line then
+ * the name, estimate and D0 of each parameter.
+ *
+ * Parameters:
+ *   filename    - name of file to write
+ *   param_names - the n parameter names separated by spaces
+ *   n           - number of parameters
+ *   theta       - the n estimates
+ *   D0          - the n final D0 values
+ *
+ * Return value:
+ *   0 if OK else -1 on error (message printed to stderr).
+ */
+int write_warm_start(const char *filename, const char *param_names,
+                     uint_t n, const double theta[], const double D0[])
+{
+  FILE   *fp;
+  char   *names_copy, *name, *saveptr = NULL;
+  uint_t  l;
+  int     err;
+
+  if (!(fp = fopen(filename, "w"))) {
+    fprintf(stderr, "ERROR: could not open warm start file %s for writing "
+            "(%s)\n", filename, strerror(errno));
+    return -1;
+  }
+  names_copy = safe_strdup(param_names);
+  fprintf(fp, "Parameter Theta D0\n");
+  for (l = 0; l < n; l++) {
+    name = strtok_r(l == 0 ? names_copy : NULL, " ", &saveptr);
+    fprintf(fp, "%s %.17g %.17g\n", name ? name : "?", theta[l], D0[l]);
+  }
+  free(names_copy);
+  err = ferror(fp);
+  err |= fclose(fp) != 0;
+  if (err) {
+    fprintf(stderr, "ERROR: writing warm start file %s failed (%s)\n",
+            filename, strerror(errno));
+    return -1;
+  }
+  return 0;
+}
@@ -0,0 +1,50 @@
+#ifndef WARMSTART_H
+#define WARMSTART_H
+/*****************************************************************************
+ *
+ * File:    warmStart.h
+ * Author:  Alex Stivala
+ * Created: October 2026
+ *
+ * Starting values of theta and D0 (the derivative estimates from
+ * Algorithm S, as adjusted by Algorithm EE) for an estimation, from a
+ * previous estimation of the same or a similar model (warmStartFile),
+ * so that Algorithm S can be shortened or skipped.
+ *
+ * The values are matched to the parameters of the model by name (as in
+ * the headers of the theta and dzA files), so parameters can be added
+ * to or removed from the model: parameters not in the file start from
+ * zero with D0 estimated by Algorithm S, and values in the file for
+ * parameters not in the model are ignored. The file can be:
+ *
+ *   - a warm start file written by a previous estimation
+ *     (writeWarmStartFilePrefix): a header line then one line for each
+ *     parameter with its name, estimate and final D0
+ *   - a parameter file with a line for each parameter with its name
+ *     and value (optionally "name = value"), and optionally D0 after it
+ *   - a summary file (summaryFile) of a previous estimation, whose
+ *     pooled estimates are used (no D0)
+ *   - a (text) theta file of a previous estimation, whose last line is
+ *     used (no D0)
+ *
+ ****************************************************************************/
+
+#include "utils.h"
+
+typedef struct ee_warm_start_s {
+  uint_t  n;         /* number of parameters */
+  double *theta;     /* n starting values (0 if not in the file) */
+  double *D0;        /* n starting D0 values (0 if not in the file) */
+  uint_t  num_theta; /* number of parameters with values in the file */
+  uint_t  num_D0;    /* number of parameters with D0 in the file */
+  uint_t  Ssteps;    /* Algorithm S steps from the starting values, 0 to
+                        skip Algorithm S if num_D0 == n */
+} ee_warm_start_t;
+
+int read_warm_start(const char *filename, const char *param_names,
+                    uint_t n, ee_warm_start_t *warm_start);
+void free_warm_start(ee_warm_start_t *warm_start);
+int write_warm_start(const char *filename, const char *param_names,
+                     uint_t n, const double theta[], const double D0[]);
+
+#endif /* WARMSTART_H */